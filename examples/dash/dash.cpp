@@ -42,8 +42,9 @@ static std::shared_ptr<egt::experimental::NeedleLayer> create_needle(egt::experi
         return nullptr;
 
     auto needle_box = svg.id_box(id);
-    auto needle = std::make_shared<egt::experimental::NeedleLayer>(svg.render(id, needle_box),
+    auto needle = std::make_shared<egt::experimental::NeedleLayer>(egt::Image(),
                   min, max, min_angle, max_angle);
+    needle->image(svg, id, needle_box);
     auto needle_point = svg.id_box(point_id).center();
     needle->needle_point(needle_point);
     needle->needle_center(needle_point - needle_box.point());
@@ -64,7 +65,8 @@ create_layer(egt::experimental::Gauge& gauge, egt::SvgImage& svg,
         return nullptr;
 
     auto box = svg.id_box(id);
-    auto layer = std::make_shared<egt::experimental::GaugeLayer>(svg.render(id, box));
+    auto layer = std::make_shared<egt::experimental::GaugeLayer>();
+    layer->image(svg, id, box);
     layer->box(egt::Rect(std::floor(box.x()),
                          std::floor(box.y()),
                          std::ceil(box.width()),
@@ -99,8 +101,9 @@ int main(int argc, char** argv)
 
     auto dash_background = std::make_unique<egt::SvgImage>("file:dash_background.svg", egt::SizeF(win.content_area().width(), 0));
 
-    // create a background layer
-    auto gauge_background = std::make_shared<egt::experimental::GaugeLayer>(dash_background->render("#background"));
+    // create a background layer, the layers are rendered by worker threads
+    auto gauge_background = std::make_shared<egt::experimental::GaugeLayer>();
+    gauge_background->image(*dash_background, "#background");
     gauge.add(gauge_background);
 
     std::vector<std::unique_ptr<egt::PeriodicTimer>> timers;
@@ -6,7 +6,6 @@
 #include <egt/detail/meta.h>
 #include <egt/ui>
 #include <iostream>
-#include <locale>
 #include <libintl.h>
 #include <string>
 #include <utf8.h>
@@ -55,27 +54,6 @@ protected:
     egt::ListBox& m_list;
 };
 
-static std::string get_translated_string(const std::locale& loc)
-{
-    std::string ts;
-    std::cout.imbue(loc);
-    auto& facet = std::use_facet<std::messages<char>>(loc);
-    auto cat = facet.open("i18n", loc);
-    if (cat < 0)
-    {
-        std::cout << "Could not open \"i18n\" message catalog\n";
-    }
-    else
-    {
-        ts = facet.get(cat, 0, 0, "Hello World");
-        std::cout << "\"Hello World\" in "
-                  << "\"" << loc.name().c_str() << "\"" << " : "
-                  << ts << '\n';
-    }
-    facet.close(cat);
-    return ts;
-}
-
 int main(int argc, char** argv)
 {
     egt::Application app(argc, argv, "i18n");
@@ -234,7 +212,8 @@ int main(int argc, char** argv)
     page2.hide();
     window.add(egt::expand(page2));
 
-    auto label = std::make_shared<egt::Label>(_("Hello World"));
+    auto label = std::make_shared<egt::Label>();
+    label->translate("Hello World");
     const auto label_font_size = scaled_font_size(40);
     label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
     egt::Rect label_box;
@@ -256,16 +235,9 @@ int main(int argc, char** argv)
     {
         if (english->checked())
         {
-            try
-            {
-                std::locale loc_en("en_US.utf8");
-                label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_en));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for en_US.utf8" << std::endl;
-            }
+            label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
+            // the messages are in english
+            egt::Translator::instance().language("en_US");
         }
     });
 
@@ -274,16 +246,9 @@ int main(int argc, char** argv)
     {
         if (french->checked())
         {
-            try
-            {
-                std::locale loc_fr("fr_FR.utf8");
-                label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_fr));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for fr_FR.utf8" << std::endl;
-            }
+            label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
+            if (!egt::Translator::instance().language("fr_FR"))
+                std::cout << "no fr_FR message catalog" << std::endl;
         }
     });
 
@@ -292,16 +257,9 @@ int main(int argc, char** argv)
     {
         if (german->checked())
         {
-            try
-            {
-                std::locale loc_de("de_DE.utf8");
-                label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_de));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for de_DE.utf8" << std::endl;
-            }
+            label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
+            if (!egt::Translator::instance().language("de_DE"))
+                std::cout << "no de_DE message catalog" << std::endl;
         }
     });
 
@@ -310,16 +268,9 @@ int main(int argc, char** argv)
     {
         if (spanish->checked())
         {
-            try
-            {
-                std::locale loc_es("es_ES.utf8");
-                label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_es));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for es_ES.utf8" << std::endl;
-            }
+            label->font(egt::Font("Free Sans", label_font_size, egt::Font::Weight::bold));
+            if (!egt::Translator::instance().language("es_ES"))
+                std::cout << "no es_ES message catalog" << std::endl;
         }
     });
 
@@ -328,16 +279,9 @@ int main(int argc, char** argv)
     {
         if (hindi->checked())
         {
-            try
-            {
-                std::locale loc_hi("hi_IN.utf8");
-                label->font(egt::Font("Lohit Devanagari", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_hi));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for hi_IN.utf8" << std::endl;
-            }
+            label->font(egt::Font("Lohit Devanagari", label_font_size, egt::Font::Weight::bold));
+            if (!egt::Translator::instance().language("hi_IN"))
+                std::cout << "no hi_IN message catalog" << std::endl;
         }
     });
 
@@ -346,16 +290,9 @@ int main(int argc, char** argv)
     {
         if (chinese->checked())
         {
-            try
-            {
-                std::locale loc_zh("zh_CN.utf8");
-                label->font(egt::Font("Noto Sans CJK SC", label_font_size, egt::Font::Weight::bold));
-                label->text(get_translated_string(loc_zh));
-            }
-            catch (std::runtime_error&)
-            {
-                std::cout << "can't create locale for zh_CN.utf8" << std::endl;
-            }
+            label->font(egt::Font("Noto Sans CJK SC", label_font_size, egt::Font::Weight::bold));
+            if (!egt::Translator::instance().language("zh_CN"))
+                std::cout << "no zh_CN message catalog" << std::endl;
         }
     });
 
@@ -0,0 +1,46 @@
+--
+-- Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+--
+-- SPDX-License-Identifier: Apache-2.0
+--
+
+-- ./luarepl ./scripts/bench.lua
+--
+-- Measure how many widget value updates per second a script can make, one
+-- call per widget, then batched with egt.set_values().
+
+local count = 20
+local rounds = 5000
+
+win = egt.TopWindow()
+
+local widgets = {}
+for i = 1, count do
+   local w = egt.ValueRangeWidgetI(egt.Rect(0, 0, 10, 10), 0, 1000, 0)
+   win:add(w)
+   widgets[i] = w
+end
+
+local values = {}
+
+local function bench(name, update)
+   local start = os.clock()
+   for r = 1, rounds do
+      for i = 1, count do
+         values[i] = (r + i) % 1000
+      end
+      update()
+   end
+   local elapsed = os.clock() - start
+   print(string.format("%-10s %12.0f updates/s", name, count * rounds / elapsed))
+end
+
+bench("per call", function()
+   for i = 1, count do
+      widgets[i]:value(values[i])
+   end
+end)
+
+bench("batched", function()
+   egt.set_values(widgets, values)
+end)
@@ -58,7 +58,7 @@ int main(int argc, char** argv)
     sizer1.add(expand(sizer3));
 
     egt::LineChart line2;
-    line2.label("", "Value", "Random");
+    line2.label("", "%", "Memory");
     line2.line_width(2);
     line2.grid_style(egt::LineChart::GridFlag::box_major_ticks_coord);
     line2.color(egt::Palette::ColorId::label_text, egt::Palette::white);
@@ -95,15 +95,12 @@ int main(int argc, char** argv)
 
     size_t sample_counter = 0;
 
-    egt::experimental::CPUMonitorUsage tools;
-    egt::PeriodicTimer timer1(std::chrono::seconds(1));
-    timer1.on_timeout([&]()
+    egt::experimental::MetricsSampler sampler;
+    sampler.on_update([&](const egt::experimental::SystemMetrics & metrics)
     {
-        tools.update();
-
         static const int chart_limit = 30;
 
-        auto i1 = tools.usage();
+        auto i1 = metrics.cpu;
         egt::ChartItemArray data1;
         data1.add(sample_counter, i1);
         line1.add_data(data1);
@@ -111,7 +108,7 @@ int main(int argc, char** argv)
             line1.remove_data(1);
         label3.text(egt::detail::format(i1, 0));
 
-        auto i2 = dist(e1);
+        auto i2 = metrics.memory_usage();
         egt::ChartItemArray data2;
         data2.add(sample_counter, i2);
         line2.add_data(data2);
@@ -129,7 +126,7 @@ int main(int argc, char** argv)
 
         sample_counter++;
     });
-    timer1.start();
+    sampler.start();
 
     win.show();
 
@@ -213,8 +213,26 @@ int main(int argc, char** argv)
     SevenSegment seven3(150);
     sizer.add(seven3);
 
+    egt::SevenSegment counter(4);
+    counter.font(egt::Font(64));
+    counter.color(egt::Palette::ColorId::label_text, egt::Palette::red);
+    counter.unlit(egt::Color(egt::Palette::red, 0x20));
+    counter.margin(10);
+    counter.align(egt::AlignFlag::center_horizontal | egt::AlignFlag::bottom);
+    window.add(counter);
+
     window.show();
 
+    int count = 0;
+    egt::PeriodicTimer counter_timer(std::chrono::milliseconds(100));
+    counter_timer.on_timeout([&]()
+    {
+        counter.value(count / 10., 1);
+        if (++count > 9999)
+            count = 0;
+    });
+    counter_timer.start();
+
     int digit = -1;
     egt::PeriodicTimer timer(std::chrono::seconds(1));
     timer.on_timeout([&]()
@@ -173,17 +173,20 @@ int main(int argc, char** argv)
     });
     cputimer.start();
 
-    std::vector<std::unique_ptr<egt::AnimationSequence>> animations;
+    // all stars twinkle in one batch, stepped in a single pass per frame
+    egt::AnimationBatch twinkle(egt::easing_spring);
+    std::vector<std::shared_ptr<Ball>> stars;
+
+    std::random_device r;
+    std::default_random_engine e1 {r()};
+    std::uniform_int_distribution<int> d_dist {500, 4000};
 
     if (argc > 1)
     {
         // create star field effect
 
-        std::random_device r;
-        std::default_random_engine e1 {r()};
         std::uniform_int_distribution<int> x_dist {0, 800};
         std::uniform_int_distribution<int> y_dist {0, 480};
-        std::uniform_int_distribution<int> d_dist {500, 4000};
         std::uniform_int_distribution<int> s_dist {10, 30};
 
         for (int i = 0; i < 25; i++)
@@ -192,29 +195,32 @@ int main(int argc, char** argv)
             star->resize_by_ratio(s_dist(e1));
             star->image_align(egt::AlignFlag::expand);
             star->move_to_center(egt::Point(x_dist(e1), y_dist(e1)));
+            star->alpha(0);
             win.add(star);
+            stars.push_back(star);
 
-            auto in = std::make_shared<egt::PropertyAnimatorF>(0, 1,
-                      std::chrono::milliseconds(d_dist(e1)),
-                      egt::easing_spring);
-            in->on_change([star](egt::PropertyAnimatorF::Value value) { star->alpha(value); });
-
-            auto out = std::make_shared<egt::PropertyAnimatorF>(1, 0,
-                       std::chrono::milliseconds(d_dist(e1)),
-                       egt::easing_spring);
-            out->reverse(true);
-            out->on_change([star](egt::PropertyAnimatorF::Value value) { star->alpha(value); });
-
-            auto delay = std::make_shared<egt::AnimationDelay>(std::chrono::milliseconds(d_dist(e1)));
-
-            animations.emplace_back(std::make_unique<egt::AnimationSequence>(true));
-
-            auto& sequence = animations.back();
-            sequence->add(delay);
-            sequence->add(in);
-            sequence->add(out);
-            sequence->start();
+            twinkle.add(0, 1, std::chrono::milliseconds(d_dist(e1)),
+                        std::chrono::milliseconds(d_dist(e1)));
         }
+
+        twinkle.on_change([&](const std::vector<egt::AnimationBatch::Index>& changed)
+        {
+            for (auto i : changed)
+            {
+                stars[i]->alpha(twinkle.value(i));
+
+                // fade back out, or in again after a delay
+                if (twinkle.done(i))
+                {
+                    if (twinkle.value(i) > 0.5f)
+                        twinkle.restart(i, 1, 0, std::chrono::milliseconds(d_dist(e1)));
+                    else
+                        twinkle.restart(i, 0, 1, std::chrono::milliseconds(d_dist(e1)),
+                                        std::chrono::milliseconds(d_dist(e1)));
+                }
+            }
+        });
+        twinkle.start();
     }
 
     try
@@ -143,7 +143,7 @@ public:
           m_penpicker(egt::Palette::blue),
           m_fillpicker(egt::Palette::red),
           m_widthpicker(2),
-          m_canvas(screen()->size(), egt::PixelFormat::argb8888)
+          m_drawing(screen()->size())
     {
         // don't draw background, we'll do it in draw()
         fill_flags().clear();
@@ -216,10 +216,7 @@ public:
 
     void clear()
     {
-        egt::Painter painter(m_canvas.context());
-        cairo_set_operator(painter.context().get(), CAIRO_OPERATOR_SOURCE);
-        painter.set(egt::Palette::transparent);
-        painter.paint();
+        m_drawing.clear();
     }
 
     void handle(egt::Event& event) override
@@ -231,7 +228,9 @@ public:
         case egt::EventId::pointer_click:
         {
             const auto mouse = display_to_local(event.pointer().point);
-            egt::Painter painter(m_canvas.context());
+            // flood works on the pixels of everything drawn so far
+            m_drawing.flatten();
+            egt::Painter painter(m_drawing.layer().context());
             cairo_set_antialias(painter.context().get(), CAIRO_ANTIALIAS_NONE);
             painter.flood(mouse, m_fillpicker.selected_color());
             damage();
@@ -248,21 +247,21 @@ public:
             if (m_last != mouse)
             {
                 const auto width = m_widthpicker.width();
+                const auto& color = m_penpicker.selected_color();
 
                 egt::Line line(m_last, mouse);
-                egt::Painter painter(m_canvas.context());
-                cairo_set_antialias(painter.context().get(), CAIRO_ANTIALIAS_NONE);
-                painter.line_width(width);
-                auto cr = painter.context();
-                cairo_set_line_cap(cr.get(), CAIRO_LINE_CAP_ROUND);
-                painter.set(m_penpicker.selected_color());
-                painter.draw(line.start(), line.end());
-                painter.stroke();
+                auto r = m_drawing.record([&](egt::Painter & painter)
+                {
+                    cairo_set_antialias(painter.context().get(), CAIRO_ANTIALIAS_NONE);
+                    painter.line_width(width);
+                    auto cr = painter.context();
+                    cairo_set_line_cap(cr.get(), CAIRO_LINE_CAP_ROUND);
+                    painter.set(color);
+                    painter.draw(line.start(), line.end());
+                    painter.stroke();
+                });
 
                 // damage only the rectangle containing the new line
-                auto r = line.rect();
-                r += egt::Size(width * 2, width * 2);
-                r -= egt::Point(width, width);
                 damage(r);
             }
 
@@ -281,8 +280,7 @@ public:
         painter.draw(rect);
         painter.fill();
 
-        painter.draw(rect.point());
-        painter.draw(rect, egt::Image(m_canvas.surface()));
+        m_drawing.draw(painter, rect);
 
         egt::TopWindow::draw(painter, rect);
     }
@@ -301,7 +299,7 @@ protected:
     ColorPickerWindow m_penpicker;
     ColorPickerWindow m_fillpicker;
     WidthPickerWindow m_widthpicker;
-    egt::Canvas m_canvas;
+    egt::DisplayList m_drawing;
 };
 
 static int run(int argc, char** argv)
@@ -14,8 +14,11 @@
 #include <chrono>
 #include <egt/detail/meta.h>
 #include <egt/easing.h>
+#include <egt/eventloop.h>
 #include <egt/geometry.h>
+#include <egt/signal.h>
 #include <egt/timer.h>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -42,6 +45,8 @@ using EasingFunc = std::function<EasingScalar(EasingScalar percent)>;
 
 namespace detail
 {
+class AnimationTicker;
+class VisibilityPolicy;
 
 /**
  * Interpolate function used internally.
@@ -227,6 +232,15 @@ public:
      */
     bool next() override;
 
+    /**
+     * Step the animation to a point in time.
+     *
+     * Same as next(), with the time of the step given instead of taken from
+     * the clock, so animations stepped together use the same time.  A time
+     * before the last step does not move the animation back.
+     */
+    virtual bool advance(std::chrono::steady_clock::time_point now);
+
     /// Stop the animation.
     void stop() override;
 
@@ -496,8 +510,16 @@ protected:
  * Animation object with built in timer.
  *
  * An Animation usually involves setting up a timer to run the animation
- * at a periodic interval. This wraps an animation around a built in
- * timer to run the animation.
+ * at a periodic interval. This runs the animation at an interval without
+ * any setup.
+ *
+ * All running AutoAnimation objects are stepped together, in one batch and
+ * with the same timestamp, by a single timer of the EventLoop, or once per
+ * frame when the frame clock is enabled.  Any number of animations then
+ * costs one wakeup and one draw per step.
+ *
+ * An animation of a widget can be bound to it with bind() to not be stepped
+ * while the widget cannot be seen.
  *
  * @ingroup animation
  */
@@ -527,25 +549,91 @@ public:
                            const EasingFunc& func = easing_linear,
                            const AnimationCallback& callback = nullptr);
 
+    AutoAnimation(const AutoAnimation&) = delete;
+    AutoAnimation& operator=(const AutoAnimation&) = delete;
+    AutoAnimation(AutoAnimation&&) = delete;
+    AutoAnimation& operator=(AutoAnimation&&) = delete;
+
+    /**
+     * Invoked when the animation stops, either because it is done or
+     * because stop() is called while it runs.
+     */
+    Signal<> on_stopped;
+
     void start() override;
     void stop() override;
     void resume() override;
 
     /**
-     * Change the interval of the internal timer.
+     * Change the interval the animation is stepped at.
+     *
+     * The interval defaults to 30ms.  Animations share one timer, which runs
+     * at the shortest interval of all running animations, so an animation
+     * with a longer interval may step up to half that interval early.
      *
-     * The internal timer defaults to an interval of 30ms.  See
-     * @ref Timer::change_duration() for more information on the ramifications
-     * of making this change on a running timer.
+     * @note When the EventLoop frame clock is enabled, the animation runs
+     * once per frame instead and this interval is not used.
      */
     void interval(std::chrono::milliseconds duration);
 
-protected:
+    /**
+     * Get the interval the animation is stepped at.
+     */
+    EGT_NODISCARD std::chrono::milliseconds interval() const { return m_interval; }
+
+    /**
+     * Only step the animation while a widget can be seen.
+     *
+     * Like Timer::bind(), the animation is suspended while the widget or one
+     * of its parents is hidden, clipped out of view, or covered by a plane.
+     * The animation keeps running() while suspended, and its first step when
+     * the widget can be seen again catches up with the time that passed.
+     *
+     * @param[in] widget The widget, which must outlive the binding or
+     *            unbind() it.  A widget being destroyed unbinds itself.
+     */
+    void bind(Widget& widget);
+
+    /**
+     * Stop following the visibility of a widget, see bind().
+     */
+    void unbind();
 
     /**
-     * Periodic timer used to run the animation.
+     * Returns true if the animation is suspended because the widget it is
+     * bound to cannot be seen.
      */
-    PeriodicTimer m_timer;
+    EGT_NODISCARD bool suspended() const { return m_suspended; }
+
+    ~AutoAnimation() noexcept override;
+
+protected:
+
+    /// Start running the animation from the timer or the frame clock.
+    void start_ticks();
+
+    /// Stop running the animation from the timer or the frame clock.
+    void stop_ticks();
+
+    /// Interval the animation is stepped at.
+    std::chrono::milliseconds m_interval{30};
+
+    /// Time of the last step.
+    std::chrono::steady_clock::time_point m_last_tick{};
+
+    /// Started or resumed, and not stopped since.
+    bool m_active{false};
+
+    /// Not stepped while the widget it is bound to cannot be seen.
+    bool m_suspended{false};
+
+private:
+
+    /// Suspend or resume the animation, for the widget it is bound to.
+    void suspend(bool suspend);
+
+    friend class detail::AnimationTicker;
+    friend class detail::VisibilityPolicy;
 };
 
 /**
@@ -643,6 +731,172 @@ using PropertyAnimator = PropertyAnimatorType<DefaultDim>;
  */
 using PropertyAnimatorF = PropertyAnimatorType<float>;
 
+/**
+ * Many animated values, stepped together in one pass.
+ *
+ * An AutoAnimation per value costs a heap object, a virtual call and a
+ * callback per step.  For hundreds or thousands of values moving at once,
+ * like the stars of a starfield, this keeps each value as an entry of
+ * arrays instead, which are evaluated with one loop per step: progress,
+ * easing through a batched easing_table, and interpolation.  Then a single
+ * callback gets the indexes of all of the values that changed, to apply
+ * them to widgets in bulk, so their damage is merged into one frame.
+ *
+ * Every value has its own start, end, duration and delay, and all of them
+ * share the easing function of the batch.
+ *
+ * @code{.cpp}
+ * AnimationBatch batch(easing_cubic_easein);
+ * for (auto& star : stars)
+ *     batch.add(0, 480, std::chrono::seconds(2));
+ * batch.on_change([&](const std::vector<AnimationBatch::Index>& changed)
+ * {
+ *     for (auto i : changed)
+ *         stars[i]->y(batch.value(i));
+ * });
+ * batch.start();
+ * @endcode
+ *
+ * The batch stops once all of its values are done.
+ *
+ * @ingroup animation
+ */
+class EGT_API AnimationBatch : public AutoAnimation
+{
+public:
+
+    /// Index of a value of the batch.
+    using Index = size_t;
+
+    /// Callback with the indexes of the values that changed in a step.
+    using ChangeCallback = std::function<void(const std::vector<Index>& changed)>;
+
+    /**
+     * @param[in] func The easing function of all values.  Anything but
+     *            easing_linear() is sampled into an easing_table.
+     */
+    explicit AnimationBatch(const EasingFunc& func = easing_linear);
+
+    /**
+     * Add a value.
+     *
+     * Values added while the batch is not running start moving when start()
+     * is called.  Indexes of removed values are reused.
+     *
+     * @param[in] start The starting value.
+     * @param[in] end The ending value.
+     * @param[in] duration The duration of the animation of the value.
+     * @param[in] delay Time before the value starts moving.
+     * @return The index of the value.
+     */
+    Index add(EasingScalar start, EasingScalar end,
+              std::chrono::milliseconds duration,
+              std::chrono::milliseconds delay = {});
+
+    /**
+     * Animate a value again, from now.
+     *
+     * @param[in] index The index of the value.
+     * @param[in] start The starting value.
+     * @param[in] end The ending value.
+     * @param[in] duration The duration of the animation of the value.
+     * @param[in] delay Time before the value starts moving.
+     */
+    void restart(Index index, EasingScalar start, EasingScalar end,
+                 std::chrono::milliseconds duration,
+                 std::chrono::milliseconds delay = {});
+
+    /// Remove a value.
+    void remove(Index index);
+
+    /// Remove all values.
+    void clear();
+
+    /// Get the current value at an index.
+    EGT_NODISCARD EasingScalar value(Index index) const { return m_values.at(index); }
+
+    /**
+     * Get all of the current values, by index.
+     *
+     * Entries of removed values are unspecified.
+     */
+    EGT_NODISCARD const std::vector<EasingScalar>& values() const { return m_values; }
+
+    /// Returns true if the value at an index reached its end.
+    EGT_NODISCARD bool done(Index index) const;
+
+    /// Number of values in the batch.
+    EGT_NODISCARD size_t size() const { return m_state.size() - m_free.size(); }
+
+    /// Number of values still moving, or waiting for their delay.
+    EGT_NODISCARD size_t pending() const { return m_pending; }
+
+    /**
+     * Register a callback for the values that changed in a step.
+     *
+     * It is called once per step, after all values are evaluated.  It may
+     * add, restart or remove values.
+     */
+    void on_change(ChangeCallback callback)
+    {
+        if (callback)
+            m_change_callbacks.emplace_back(std::move(callback));
+    }
+
+    /// Start running the values, from where they are.
+    void start() override;
+
+    bool advance(std::chrono::steady_clock::time_point now) override;
+
+protected:
+
+    /// State of an entry of the arrays.
+    enum class State : uint8_t
+    {
+        free,
+        pending,
+        done,
+    };
+
+    /// Time of the batch, in milliseconds, at a point in time.
+    EGT_NODISCARD EasingScalar clock(std::chrono::steady_clock::time_point now) const;
+
+    /// Set up an entry of the arrays.
+    void set(Index index, EasingScalar start, EasingScalar end,
+             std::chrono::milliseconds duration,
+             std::chrono::milliseconds delay);
+
+    /// Evaluate all values at the current time of the batch.
+    void evaluate();
+
+    /// Starting values.
+    std::vector<EasingScalar> m_from;
+    /// Ending values.
+    std::vector<EasingScalar> m_to;
+    /// Time of the batch, in milliseconds, the values start moving at.
+    std::vector<EasingScalar> m_begin;
+    /// Inverse of the durations, in milliseconds.
+    std::vector<EasingScalar> m_rate;
+    /// Current values.
+    std::vector<EasingScalar> m_values;
+    /// State of the entries.
+    std::vector<State> m_state;
+    /// Progress of the values of the step being evaluated.
+    std::vector<EasingScalar> m_progress;
+    /// Eased progress of the values of the step being evaluated.
+    std::vector<EasingScalar> m_eased;
+    /// Indexes of free entries.
+    std::vector<Index> m_free;
+    /// Indexes of the values that changed in the step being evaluated.
+    std::vector<Index> m_changed;
+    /// Number of pending values.
+    size_t m_pending{0};
+    /// Easing function baked into a table, unless it is linear.
+    std::unique_ptr<easing_table> m_table;
+    /// Registered change callbacks.
+    std::vector<ChangeCallback> m_change_callbacks;
+};
+
 /**
  * Simple delay, useful to insert a delay in an AnimationSequence.
  *
@@ -6,11 +6,16 @@
 #ifndef EGT_APP_H
 #define EGT_APP_H
 
+#include <chrono>
 #include <clocale>
+#include <cstdint>
+#include <functional>
 #include <egt/asio.hpp>
 #include <egt/detail/meta.h>
 #include <egt/eventloop.h>
+#include <egt/geometry.h>
 #include <egt/object.h>
+#include <egt/types.h>
 #include <iosfwd>
 #include <memory>
 #include <ostream>
@@ -38,6 +43,17 @@ class Input;
 class Window;
 class Timer;
 
+namespace experimental
+{
+class RfbServer;
+class PerfHud;
+}
+
+namespace detail
+{
+class InputRecorder;
+}
+
 /**
  * Application definition.
  *
@@ -147,6 +163,59 @@ public:
      */
     void paint_to_file(const std::string& filename = {});
 
+    /// File format of a snapshot.
+    enum class SnapshotFormat
+    {
+        /// PNG, compressed with SnapshotOptions::level.
+        png,
+        /// EGT raw image, run length encoded.
+        eraw,
+        /// EGT raw image, uncompressed, the fastest to write.
+        eraw_raw,
+    };
+
+    /// Options of snapshot().
+    struct SnapshotOptions
+    {
+        /// File format.
+        SnapshotFormat format{SnapshotFormat::png};
+        /**
+         * zlib compression level of a PNG, from 0, stored uncompressed, to 9.
+         * Level 1 is much faster than the usual default of 6, for files a
+         * little larger.
+         */
+        int level{1};
+        /// Region of the screen, the whole screen if empty.
+        Rect region;
+    };
+
+    /**
+     * Save what is shown on the Screen to a file, without waiting for the
+     * file to be written.
+     *
+     * The pixels of the region are copied from the composition buffer of
+     * the screen, or painted from the windows if it cannot be read, then
+     * encoded and written on a worker thread.
+     *
+     * @param[in] filename File to write.
+     * @param[in] options Format and region of the snapshot.
+     * @param[in] done Called in the event loop once written, with false on
+     *            error.
+     * @return A handle to EventLoop::cancel() the snapshot.
+     */
+    EventLoop::WorkHandle snapshot(const std::string& filename,
+                                   const SnapshotOptions& options,
+                                   std::function<void(bool ok)> done = {});
+
+    /**
+     * Save the whole Screen to a PNG file, without waiting for the file to
+     * be written.
+     *
+     * @see snapshot(const std::string&, const SnapshotOptions&, std::function<void(bool)>)
+     */
+    EventLoop::WorkHandle snapshot(const std::string& filename,
+                                   std::function<void(bool ok)> done = {});
+
     /**
      * Dump the widget hierarchy and properties to the specified std::ostream.
      *
@@ -184,6 +253,38 @@ public:
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
     EGT_NODISCARD inline const char** argv() const { return const_cast<const char**>(m_argv); }
 
+    /**
+     * A step of the construction of the Application.
+     */
+    struct StartupStage
+    {
+        /// Name of the step.
+        std::string name;
+        /// When the step started, from the start of the construction.
+        std::chrono::microseconds start{};
+        /// Time the step took.
+        std::chrono::microseconds duration{};
+    };
+
+    /**
+     * Get the steps of the construction, in the order they started.
+     *
+     * The splash image set with the EGT_SPLASH environment variable is shown
+     * as soon as the screen is set up, before the inputs.  The fonts of the
+     * EGT_FONT_MANIFEST are preloaded in a thread meanwhile, so that step
+     * overlaps the others.  The timeline is logged at the debug level.
+     *
+     * With the EGT_STARTUP_SNAPSHOT environment variable set to a path, the
+     * first stable screen is saved there as an uncompressed eraw file, and
+     * the next start shows it instead of the splash image: it is mapped and
+     * flipped before any widget is constructed, and replaced by the first
+     * frame drawn.
+     */
+    EGT_NODISCARD const std::vector<StartupStage>& startup_timeline() const
+    {
+        return m_startup;
+    }
+
     virtual ~Application() noexcept;
 
 protected:
@@ -197,6 +298,16 @@ protected:
     /// @private
     void setup_backend(bool primary, const std::string& name);
     /// @private
+    void setup_splash();
+    /// @private
+    bool show_snapshot();
+    /// @private
+    void wait_snapshot();
+    /// @private
+    void save_snapshot();
+    /// @private
+    static void setup_fonts();
+    /// @private
     void setup_inputs();
     /// @private
     void setup_events();
@@ -231,12 +342,27 @@ private:
     /// Signal handler to handle some default signals to the application.
     void signal_handler(const asio::error_code& error, int signum);
 
+    /// Paint the visible windows into an image of the size of the screen.
+    shared_cairo_surface_t paint_windows();
+
+    /// Copy a region of what is shown on the screen into an image.
+    shared_cairo_surface_t copy_screen(const Rect& region);
+
     /// The screen instance.
     std::unique_ptr<Screen> m_screen;
 
     /// Array of inputs.
     std::vector<std::unique_ptr<Input>> m_inputs;
 
+    /// Remote framebuffer server, if any.
+    std::unique_ptr<experimental::RfbServer> m_rfb;
+
+    /// Input recorder, if any.
+    std::unique_ptr<detail::InputRecorder> m_recorder;
+
+    /// Performance overlay, if any.
+    std::unique_ptr<experimental::PerfHud> m_hud;
+
     /// Internal registration handle
     Object::RegisterHandle m_handle{0};
 
@@ -252,6 +378,21 @@ private:
     /// All allocated timers.
     std::vector<Timer*> m_timers;
 
+    /// Steps of the construction.
+    std::vector<StartupStage> m_startup;
+
+    /// Path of the startup snapshot, if any.
+    std::string m_snapshot;
+
+    /// Checks when the screen is stable to save the startup snapshot.
+    asio::steady_timer m_snapshot_timer;
+
+    /// Frames flipped when the snapshot timer was last checked.
+    uint64_t m_snapshot_frames{0};
+
+    /// Were frames flipped since the construction.
+    bool m_snapshot_drawn{false};
+
     friend class Window;
     friend class Timer;
 };
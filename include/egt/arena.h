@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_ARENA_H
+#define EGT_ARENA_H
+
+/**
+ * @file
+ * @brief Arena allocation of widget trees.
+ */
+
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Blocks of memory allocations are carved from, shared by an Arena and the
+ * objects allocated from it.
+ */
+class EGT_API ArenaBlocks
+{
+public:
+
+    explicit ArenaBlocks(size_t block_size);
+
+    ArenaBlocks(const ArenaBlocks&) = delete;
+    ArenaBlocks& operator=(const ArenaBlocks&) = delete;
+
+    /// Allocate size bytes aligned on align.
+    void* allocate(size_t size, size_t align);
+
+    /// Release an allocation, which is reclaimed with all the others.
+    void deallocate(void* p, size_t size) noexcept;
+
+    /// Bytes allocated and not released.
+    size_t bytes{0};
+    /// Allocations not released.
+    size_t allocations{0};
+    /// Allocations made so far.
+    size_t total_allocations{0};
+    /// Bytes of the blocks held.
+    size_t reserved{0};
+
+private:
+
+    /// Start a new block, large enough for size bytes aligned on align.
+    void add_block(size_t size, size_t align);
+
+    size_t m_block_size;
+    std::vector<std::unique_ptr<unsigned char[]>> m_blocks;
+    size_t m_block_capacity{0};
+    size_t m_offset{0};
+};
+
+}
+
+namespace experimental
+{
+
+/**
+ * Allocator of widgets that are released together.
+ *
+ * Each widget is a separate allocation, so building a screen makes many small
+ * allocations that fragment the heap.  An Arena instead carves the widgets,
+ * and their reference counts, out of a few large blocks.  Releasing a widget
+ * does not free its memory: the blocks are reclaimed at once when all the
+ * widgets allocated from the arena are released, and reused by the next ones.
+ *
+ * Widgets keep the blocks alive, so they may outlive the Arena.
+ *
+ * @code{.cpp}
+ * auto arena = std::make_shared<egt::experimental::Arena>();
+ * egt::experimental::UiLoader loader;
+ * loader.arena(arena);
+ * auto window = loader.load("file:ui.xml");
+ * std::cout << arena->stats().bytes << " bytes in "
+ *           << arena->stats().allocations << " allocations" << std::endl;
+ * @endcode
+ *
+ * @note Only the widgets themselves are allocated from the arena; what they
+ * allocate, like their name or their children list, is not.  An Arena is not
+ * thread safe: widgets are created and released in the thread of the event
+ * loop.
+ */
+class EGT_API Arena
+{
+public:
+
+    /**
+     * Allocation statistics.
+     */
+    struct Stats
+    {
+        /// Bytes allocated and not released.
+        size_t bytes{0};
+        /// Allocations not released.
+        size_t allocations{0};
+        /// Allocations made so far.
+        size_t total_allocations{0};
+        /// Bytes of the blocks held, including what is not allocated.
+        size_t reserved{0};
+    };
+
+    /**
+     * Standard allocator allocating from an Arena.
+     */
+    template<class T>
+    class Allocator
+    {
+    public:
+        /// @private
+        using value_type = T;
+
+        /// @private
+        explicit Allocator(std::shared_ptr<detail::ArenaBlocks> blocks) noexcept
+            : m_blocks(std::move(blocks))
+        {}
+
+        /// @private
+        template<class U>
+        Allocator(const Allocator<U>& rhs) noexcept
+            : m_blocks(rhs.m_blocks)
+        {}
+
+        /// @private
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(m_blocks->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        /// @private
+        void deallocate(T* p, size_t n) noexcept
+        {
+            m_blocks->deallocate(p, n * sizeof(T));
+        }
+
+        /// @private
+        template<class U>
+        bool operator==(const Allocator<U>& rhs) const noexcept
+        {
+            return m_blocks == rhs.m_blocks;
+        }
+
+        /// @private
+        template<class U>
+        bool operator!=(const Allocator<U>& rhs) const noexcept
+        {
+            return m_blocks != rhs.m_blocks;
+        }
+
+    private:
+
+        std::shared_ptr<detail::ArenaBlocks> m_blocks;
+
+        template<class U>
+        friend class Allocator;
+    };
+
+    /**
+     * @param[in] block_size Size of the blocks allocations are carved from.
+     *            Larger allocations get a block of their own.
+     */
+    explicit Arena(size_t block_size = 16 * 1024);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Create an object allocated from the arena, like std::make_shared().
+     */
+    template<class T, class... Args>
+    std::shared_ptr<T> make_shared(Args&& ... args)
+    {
+        return std::allocate_shared<T>(allocator<T>(), std::forward<Args>(args)...);
+    }
+
+    /**
+     * Get an allocator allocating from the arena.
+     */
+    template<class T>
+    EGT_NODISCARD Allocator<T> allocator() const
+    {
+        return Allocator<T>(m_blocks);
+    }
+
+    /**
+     * Get the allocation statistics.
+     */
+    EGT_NODISCARD Stats stats() const;
+
+private:
+
+    std::shared_ptr<detail::ArenaBlocks> m_blocks;
+};
+
+}
+}
+}
+
+#endif
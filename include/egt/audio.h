@@ -16,11 +16,15 @@
  * Image and video related classes.
  */
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/object.h>
 #include <egt/signal.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -32,9 +36,35 @@ namespace detail
 struct AudioPlayerImpl;
 }
 
+/**
+ * Statistics of the playback of an AudioPlayer.
+ *
+ * @see AudioPlayer::stats()
+ */
+struct AudioPlayerStats
+{
+    /// Number of times the decoded audio ran out while playing, each heard as a gap.
+    uint64_t underruns{0};
+    /// Decoded audio buffered ahead of the sound card.
+    std::chrono::milliseconds fill{0};
+    /// Latency of the pipeline, up to the sound card.
+    std::chrono::milliseconds latency{0};
+    /// The thread writing to the sound card runs with a real-time priority.
+    bool realtime{false};
+};
+
 /**
  * Audio player.
  *
+ * The player can play a playlist of tracks.  The next track is prepared
+ * while the current one ends, so there is no gap between them.
+ *
+ * @code{.cpp}
+ * AudioPlayer player;
+ * player.playlist({"file:intro.mp3", "file:song.mp3"});
+ * player.play();
+ * @endcode
+ *
  * @ingroup media
  */
 class EGT_API AudioPlayer : public Object
@@ -64,6 +94,11 @@ public:
      * Invoked when the state of the player changes.
      */
     Signal<> on_state_changed;
+
+    /**
+     * Invoked when the player moves to another track of the playlist.
+     */
+    Signal<> on_track_changed;
     /** @} */
 
     AudioPlayer();
@@ -86,6 +121,74 @@ public:
      */
     bool media(const std::string& uri);
 
+    /**
+     * Set a playlist, starting at its first track.
+     *
+     * The tracks are played one after the other, without gap, and on_eos()
+     * is invoked at the end of the last one.
+     *
+     * @param uris URIs of the tracks.
+     * @return true on success
+     */
+    bool playlist(const std::vector<std::string>& uris);
+
+    /**
+     * Get the playlist.
+     */
+    EGT_NODISCARD std::vector<std::string> playlist() const;
+
+    /**
+     * Add a track at the end of the playlist.
+     *
+     * @param uri file URI
+     */
+    void enqueue(const std::string& uri);
+
+    /**
+     * Get the index of the current track in the playlist.
+     */
+    EGT_NODISCARD size_t track() const;
+
+    /**
+     * Skip to the next track of the playlist.
+     *
+     * @return true on success, false if this is the last track.
+     */
+    bool next();
+
+    /**
+     * Set the duration of decoded audio buffered ahead of the sound card.
+     *
+     * A longer buffer keeps the audio playing while the CPU is busy, at the
+     * cost of memory.  By default, 500 ms.  The buffer doubles, up to 4 s,
+     * each time the decoded audio runs out while playing.
+     */
+    void buffer(std::chrono::milliseconds duration);
+
+    /**
+     * Get the duration of decoded audio buffered ahead of the sound card.
+     */
+    EGT_NODISCARD std::chrono::milliseconds buffer() const;
+
+    /**
+     * Set the latency of the sound card, taking effect on the next media.
+     *
+     * A lower latency makes pause, volume and mute changes quicker, but
+     * requires waking up more often to feed the sound card.  Zero, the
+     * default, keeps the one of the audio sink.
+     */
+    void latency(std::chrono::milliseconds latency);
+
+    /**
+     * Get the latency of the sound card.
+     */
+    EGT_NODISCARD std::chrono::milliseconds latency() const;
+
+    /**
+     * Get the statistics of the playback.
+     */
+    EGT_NODISCARD AudioPlayerStats stats() const;
+
     /**
      * Send pipeline to play state
      * @return true on success
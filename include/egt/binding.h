@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_BINDING_H
+#define EGT_BINDING_H
+
+/**
+ * @file
+ * @brief Observable values propagated once per frame.
+ */
+
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * A node of the graph of observable values.
+ *
+ * Changing a node only marks it dirty and schedules a flush of all dirty
+ * nodes, right before the next frame.  The flush propagates nodes by
+ * increasing depth, so a node depending on several changed nodes is
+ * propagated once, after all of them.
+ */
+class EGT_API BindingNode
+{
+public:
+
+    BindingNode() = default;
+    BindingNode(const BindingNode&) = delete;
+    BindingNode& operator=(const BindingNode&) = delete;
+
+    virtual ~BindingNode() noexcept;
+
+protected:
+
+    /// Depend on another node, which must outlive this one.
+    void depends(BindingNode& source);
+
+    /// Mark the node dirty, to be propagated in the next flush.
+    void invalidate();
+
+    /// Mark the nodes depending on this one dirty.
+    void invalidate_dependents();
+
+    /// Propagate a change, called by the flush.
+    virtual void propagate() = 0;
+
+private:
+
+    /// Nodes this one depends on.
+    std::vector<BindingNode*> m_sources;
+    /// Nodes depending on this one.
+    std::vector<BindingNode*> m_dependents;
+    /// Longest path from a node without source.
+    uint32_t m_depth{0};
+    /// Waiting for a flush.
+    bool m_dirty{false};
+    /// Last flush the node was propagated in.
+    uint64_t m_flushed{0};
+
+    friend class BindingScheduler;
+};
+
+}
+
+/**
+ * A value notifying its changes once per frame.
+ *
+ * Setting a ValueWidget from several places, i.e. sensors, settings, and
+ * touch, invokes its handlers, damages it, and may lay it out again on each
+ * set, even when the value set is the one it already has.  Instead, an
+ * Observable only records the value set.  Right before the next frame, all
+ * changed observables and the Computed values depending on them are
+ * propagated together: handlers are invoked once, with the last value set,
+ * and only if it differs from the value they were last invoked with.  The
+ * widgets they update are then damaged together and drawn in that frame.
+ *
+ * @code{.cpp}
+ * egt::Observable<int> speed(0);
+ * egt::bind(speed, gauge);
+ *
+ * speed = 42;
+ * speed = 43; // only 43 is set on the gauge, before the next frame
+ * @endcode
+ *
+ * @note Observables are used in the thread of the event loop. Values from
+ * other threads are posted with an UpdateChannel.  Without an Application,
+ * changes are propagated as soon as they are set.
+ */
+template<class T>
+class Observable : public detail::BindingNode
+{
+public:
+
+    /**
+     * Invoked with the value, once per frame, when it changed.
+     */
+    Signal<const T&> on_change;
+
+    /**
+     * @param[in] value The initial value.
+     */
+    explicit Observable(T value = {})
+        : m_value(value),
+          m_notified(std::move(value))
+    {}
+
+    /**
+     * Set the value, notified before the next frame.
+     *
+     * Setting the value it has does nothing.
+     */
+    void set(const T& value)
+    {
+        if (value == m_value)
+            return;
+
+        m_value = value;
+        invalidate();
+    }
+
+    /// @see set()
+    Observable& operator=(const T& value)
+    {
+        set(value);
+        return *this;
+    }
+
+    /// Get the last value set, notified or not.
+    EGT_NODISCARD const T& get() const { return m_value; }
+
+    /// @see get()
+    operator const T& () const { return m_value; }
+
+protected:
+
+    void propagate() override
+    {
+        // set back to the notified value before the flush
+        if (m_value == m_notified)
+            return;
+
+        m_notified = m_value;
+        on_change.invoke(m_notified);
+        invalidate_dependents();
+    }
+
+    /// Last value set.
+    T m_value;
+    /// Last value handlers were invoked with.
+    T m_notified;
+};
+
+/**
+ * A value computed from other observable values.
+ *
+ * It is computed again once per frame when any of its sources changed, and
+ * notified like an Observable when the result changed.
+ *
+ * @code{.cpp}
+ * egt::Observable<int> voltage(12);
+ * egt::Observable<int> current(2);
+ * egt::Computed<int> power([&]() { return voltage * current; }, voltage, current);
+ * egt::bind(power, label);
+ * @endcode
+ */
+template<class T>
+class Computed : public Observable<T>
+{
+public:
+
+    /// Computes the value.
+    using Function = std::function<T()>;
+
+    /**
+     * @param[in] compute Computes the value from the sources.
+     * @param[in] sources The observables or computed values used, which
+     *            must outlive this one.
+     */
+    template<class... Sources>
+    explicit Computed(Function compute, Sources&... sources)
+        : Observable<T>(compute()),
+          m_compute(std::move(compute))
+    {
+        (this->depends(sources), ...);
+    }
+
+    // not settable
+    void set(const T& value) = delete;
+    Computed& operator=(const T& value) = delete;
+
+protected:
+
+    void propagate() override
+    {
+        this->m_value = m_compute();
+        Observable<T>::propagate();
+    }
+
+    Function m_compute;
+};
+
+/**
+ * Set the value of a widget, or anything with a value(T) setter, from an
+ * Observable or a Computed value.
+ *
+ * The widget takes the current value right away, then each value notified.
+ *
+ * @return A handle to pass to Observable::on_change.remove() to unbind.
+ */
+template<class T, class Target>
+typename Signal<const T&>::RegisterHandle bind(Observable<T>& source, Target& target)
+{
+    target.value(source.get());
+    return source.on_change([&target](const T & value)
+    {
+        target.value(value);
+    });
+}
+
+}
+}
+
+#endif
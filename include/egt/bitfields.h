@@ -134,6 +134,12 @@ public:
         return m_word == 0;
     }
 
+    /// Get the raw underlying value.
+    EGT_NODISCARD constexpr uint32_t raw() const noexcept
+    {
+        return m_word;
+    }
+
     EGT_NODISCARD constexpr bool is_set(const T& field) const noexcept
     {
         const auto& f = static_cast<const BitField&>(field);
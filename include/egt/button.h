@@ -29,6 +29,11 @@ inline namespace v1
 class Frame;
 class Painter;
 
+namespace detail
+{
+class StateCache;
+}
+
 /**
  * @defgroup controls Controls
  * User interface control widgets.
@@ -119,8 +124,8 @@ public:
 
     Button(const Button&) = delete;
     Button& operator=(const Button&) = delete;
-    Button(Button&&) noexcept = default;
-    Button& operator=(Button&&) noexcept = default;
+    Button(Button&&) noexcept;
+    Button& operator=(Button&&) noexcept;
 
     void handle(Event& event) override;
 
@@ -130,6 +135,31 @@ public:
 
     void draw(Painter& painter, const Rect& rect) override;
 
+    using TextWidget::damage;
+
+    void damage(const Rect& rect) override;
+
+    /**
+     * Set the cache_states state.
+     *
+     * @param[in] value When true, the button is drawn once in each of its
+     *            states, normal, pressed, checked and disabled, into
+     *            surfaces of its size.  Pressing, releasing, checking or
+     *            disabling the button then only paints the surface of its
+     *            new state.
+     *
+     * The states are drawn again when the button is damaged for any other
+     * change, so this is meant for buttons whose content rarely changes.
+     *
+     * By default, this state is false.
+     */
+    void cache_states(bool value);
+
+    /**
+     * Return the cache_states state of the button.
+     */
+    EGT_NODISCARD bool cache_states() const { return m_state_cache != nullptr; }
+
     /**
      * Add an event handler to be called when the widget receives an
      * EventId::pointer_click event.
@@ -140,9 +170,10 @@ public:
      *
      * @see detail::Object::on_event()
      */
-    RegisterHandle on_click(const EventCallback& handler)
+    template<class F>
+    RegisterHandle on_click(F&& handler)
     {
-        return on_event(handler, {EventId::pointer_click});
+        return on_event(std::forward<F>(handler), {EventId::pointer_click});
     }
 
     /// Default draw method for the widget.
@@ -167,6 +198,17 @@ protected:
 
     void set_parent(Widget* parent) override;
 
+    void damage_state() override;
+
+    /**
+     * Paint the button from the rendering of its current state, when
+     * cache_states() is set.
+     *
+     * To be called first by draw(), which must draw the button itself when
+     * this returns false.
+     */
+    bool draw_state(Painter& painter, const Rect& rect);
+
 private:
 
     static Size default_button_size_value;
@@ -182,6 +224,12 @@ private:
      */
     ButtonGroup* m_group{nullptr};
 
+    /// Renderings of the states, when cache_states() is set.
+    std::unique_ptr<detail::StateCache> m_state_cache;
+
+    /// Damage is for a change of state only.
+    bool m_state_damage{false};
+
     friend ButtonGroup;
 };
 
@@ -307,6 +355,7 @@ public:
     {
         if (detail::change_if_diff<>(m_switch_align, align))
         {
+            invalidate_size_hint();
             damage();
             layout();
         }
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_CACHEBUDGET_H
+#define EGT_CACHEBUDGET_H
+
+/**
+ * @file
+ * @brief Memory budget of the caches.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+/**
+ * Memory budget shared by the caches, and purging of them when memory runs
+ * low.
+ *
+ * The caches of EGT, like the image cache, the font cache, pooled surfaces
+ * and the page caches of Notebook widgets, are registered here along with a
+ * priority.  Their total size is kept within budget(), and when the system
+ * runs low on memory they are purged, the caches cheapest to fill again
+ * first: pixels that are only drawn again before images that are decoded
+ * again, before fonts.  Applications can register their own caches too.
+ *
+ * Low memory is detected with the memory pressure stall information of
+ * Linux, /proc/pressure/memory, or otherwise with the memory.events file of
+ * the cgroup of the application, when it has a memory.high or memory.max
+ * limit.  Each report of pressure soon after the previous one purges one
+ * more priority.
+ *
+ * This is used from the event loop thread.
+ *
+ * @code{.cpp}
+ * egt::experimental::cache_budget().budget(16 * 1024 * 1024);
+ * @endcode
+ */
+class EGT_API CacheBudget : private detail::NonCopyable<CacheBudget>
+{
+public:
+
+    /// Priority of a cache, purged from the first to the last.
+    enum class Priority
+    {
+        /// Pixels drawn again when needed, like cached pages.
+        surfaces,
+        /// Images decoded or rendered again when needed.
+        images,
+        /// Fonts and their glyphs.
+        fonts,
+    };
+
+    /// Get the size of a cache in bytes.
+    using BytesCallback = std::function<size_t()>;
+
+    /// Free what a cache holds, least recently used first, down to a size in bytes.
+    using TrimCallback = std::function<void(size_t bytes)>;
+
+    /// Handle of a registered cache.
+    using Handle = uint64_t;
+
+    /// Size of a registered cache.
+    struct Usage
+    {
+        std::string name;
+        Priority priority;
+        size_t bytes;
+    };
+
+    /// Default time within which pressure reports escalate purging.
+    static constexpr std::chrono::milliseconds ESCALATION_WINDOW{5000};
+
+    /**
+     * Invoked after caches were purged because memory ran low, with the
+     * last priority purged.
+     */
+    Signal<Priority> on_pressure;
+
+    /**
+     * The budget defaults to the EGT_CACHE_BUDGET environment variable, in
+     * bytes, if set, or no budget.
+     */
+    CacheBudget();
+
+    /**
+     * Register a cache.
+     *
+     * @param[in] name Name of the cache, for usage().
+     * @param[in] priority Priority of the cache.
+     * @param[in] bytes Get the size of the cache.
+     * @param[in] trim Free what the cache holds, down to a size.
+     * @return A handle to remove() the cache.
+     */
+    Handle add(const std::string& name, Priority priority,
+               BytesCallback bytes, TrimCallback trim);
+
+    /**
+     * Unregister a cache.
+     */
+    void remove(Handle handle);
+
+    /**
+     * Set the total size of the caches, in bytes, trimming them to fit.
+     *
+     * 0 is no budget.
+     */
+    void budget(size_t bytes);
+
+    /// Get the total size of the caches, or 0 if there is no budget.
+    EGT_NODISCARD size_t budget() const { return m_budget; }
+
+    /// Get the total size of the caches, in bytes.
+    EGT_NODISCARD size_t bytes() const;
+
+    /// Get the size of every cache.
+    EGT_NODISCARD std::vector<Usage> usage() const;
+
+    /**
+     * Trim the caches to the budget, by priority.
+     *
+     * This is done periodically by the event loop when it is idle, and when
+     * memory runs low.
+     *
+     * @return The number of bytes freed.
+     */
+    size_t enforce();
+
+    /**
+     * Empty the caches of a priority and all priorities before it.
+     *
+     * @return The number of bytes freed.
+     */
+    size_t purge(Priority priority = Priority::fonts);
+
+    /**
+     * Start watching the memory pressure of the system.
+     *
+     * Called by the Application, unless the EGT_NO_MEMORY_PRESSURE
+     * environment variable is set.
+     *
+     * @return false if the memory pressure cannot be watched.
+     */
+    bool watch();
+
+    /// Stop watching the memory pressure of the system.
+    void unwatch();
+
+    /// Returns true if the memory pressure of the system is watched.
+    EGT_NODISCARD bool watching() const;
+
+    /// Handle a report of memory pressure, escalating the priority purged.
+    void pressure();
+
+    ~CacheBudget() noexcept;
+
+private:
+
+    struct Cache
+    {
+        Handle handle;
+        std::string name;
+        Priority priority;
+        BytesCallback bytes;
+        TrimCallback trim;
+    };
+
+    struct Watcher;
+
+    /// Trim the caches of a priority, down to a size in bytes.
+    size_t trim(Priority priority, size_t bytes);
+
+    /// Wait for the next report of memory pressure.
+    void wait();
+
+    std::vector<Cache> m_caches;
+    Handle m_handle{0};
+    size_t m_budget{0};
+    /// Last priority purged, and when.
+    Priority m_level{Priority::surfaces};
+    std::chrono::steady_clock::time_point m_last_pressure{};
+    std::unique_ptr<Watcher> m_watcher;
+};
+
+/**
+ * Get the memory budget of the caches.
+ */
+EGT_API CacheBudget& cache_budget();
+
+}
+}
+}
+
+#endif
@@ -11,8 +11,11 @@
  * @brief Camera window support.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/window.h>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -26,9 +29,65 @@ namespace detail
 class CameraImpl;
 }
 
+/**
+ * A frame captured by a CameraWindow.
+ *
+ * The frame is the camera buffer itself, mapped read-only without a copy.
+ * The camera captures into a fixed number of buffers, and a buffer is only
+ * reused once no frame references it any more, so a frame must be released
+ * as soon as processed.
+ */
+class EGT_API CameraFrame
+{
+public:
+
+    /// Get the data of the frame.
+    EGT_NODISCARD const unsigned char* data() const { return m_data; }
+
+    /// Get the length of the data of the frame in bytes.
+    EGT_NODISCARD size_t length() const { return m_length; }
+
+    /// Get the size of the frame in pixels.
+    EGT_NODISCARD Size size() const { return m_size; }
+
+    /// Get the length of a line of the frame in bytes.
+    EGT_NODISCARD size_t stride() const { return m_stride; }
+
+    /// Get the pixel format of the frame.
+    EGT_NODISCARD PixelFormat format() const { return m_format; }
+
+    /// Get the timestamp of the frame in nanoseconds.
+    EGT_NODISCARD int64_t timestamp() const { return m_timestamp; }
+
+    /**
+     * Get the dmabuf file descriptor of the frame, or -1.
+     *
+     * The frame can be passed to other devices with it, as long as the frame
+     * is referenced.
+     */
+    EGT_NODISCARD int dmabuf() const { return m_dmabuf; }
+
+private:
+
+    CameraFrame() = default;
+
+    const unsigned char* m_data{nullptr};
+    size_t m_length{0};
+    Size m_size;
+    size_t m_stride{0};
+    PixelFormat m_format{PixelFormat::invalid};
+    int64_t m_timestamp{0};
+    int m_dmabuf{-1};
+    /// Keeps the buffer mapped.
+    std::shared_ptr<void> m_buffer;
+
+    friend class detail::CameraImpl;
+};
+
 /**
  * A CameraWindow is a widget to capture image feed from the camera
- * sensor and render it on screen using gstreamer media framework.
+ * sensor and render it on screen using gstreamer media framework, or
+ * straight from V4L2, see the EGT_CAMERA_BACKEND environment variable.
  *
  * It has a bounding rectangle, device, format and WindowHint. These
  * properties can be manipulated to create a camera window either as
@@ -157,6 +216,25 @@ public:
      */
     void stop();
 
+    /**
+     * Get the last frame captured, or nullptr.
+     *
+     * The preview keeps running while the frame is processed, for example
+     * from another thread.
+     */
+    EGT_NODISCARD std::shared_ptr<const CameraFrame> frame() const;
+
+    /// Type used for the callback of each frame captured.
+    using FrameCallback = std::function<void(std::shared_ptr<const CameraFrame> frame)>;
+
+    /**
+     * Set a callback invoked with each frame captured.
+     *
+     * The callback is invoked from the capture thread, so it must return
+     * quickly: keep the frame and process it in another thread.
+     */
+    void frame_callback(FrameCallback callback);
+
     using Window::scale;
 
     void scale(float hscale, float vscale) override;
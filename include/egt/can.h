@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_CAN_H
+#define EGT_CAN_H
+
+/**
+ * @file
+ * @brief SocketCAN frames and signals.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/fdmonitor.h>
+#include <egt/updatechannel.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+/**
+ * A classic CAN frame.
+ */
+struct CanFrame
+{
+    /// Identifier, 11 bits, or 29 bits if extended.
+    uint32_t id{0};
+    /// The identifier is 29 bits.
+    bool extended{false};
+    /// Number of data bytes, up to 8.
+    uint8_t size{0};
+    /// Data bytes.
+    std::array<uint8_t, 8> data{};
+};
+
+/**
+ * A kernel filter of CAN frames.
+ *
+ * A frame is received when its identifier, masked, is the filter
+ * identifier, masked.
+ */
+struct CanFilter
+{
+    /// Identifier.
+    uint32_t id{0};
+    /// Bits of the identifier compared, all of them by default.
+    uint32_t mask{0x1fffffff};
+    /// Only receive extended frames, else only standard frames.
+    bool extended{false};
+};
+
+/**
+ * A value stored in the bits of CAN frames, as described in a DBC file.
+ *
+ * The value is the raw integer of the bits times scale, plus offset.
+ */
+struct EGT_API CanSignal
+{
+    /// Identifier of the frames holding the signal.
+    uint32_t id{0};
+    /// The identifier is 29 bits.
+    bool extended{false};
+    /**
+     * First bit, numbered from the least significant bit of the first data
+     * byte.  For big endian signals, this is the most significant bit of
+     * the signal, like in DBC files.
+     */
+    uint8_t start{0};
+    /// Number of bits, up to 64.
+    uint8_t length{8};
+    /// Bytes are in big endian (Motorola) order, else little endian (Intel).
+    bool big_endian{false};
+    /// The raw value is signed.
+    bool is_signed{false};
+    /// Scale of the raw value.
+    double scale{1.0};
+    /// Offset added to the scaled value.
+    double offset{0.0};
+
+    /**
+     * Decode the signal from a frame.
+     *
+     * @param[in] frame A frame with the identifier of the signal.
+     * @param[out] value The value.
+     * @return false if the frame is too short.
+     */
+    bool decode(const CanFrame& frame, double& value) const;
+};
+
+/**
+ * Reads frames from a SocketCAN interface.
+ *
+ * Only the frames the filters accept are received, the kernel drops the
+ * others.  Frames are read in the event loop, as many as are pending with
+ * each recvmmsg() system call, and handed to the callback in batches.
+ *
+ * @see CanBinding to update widgets from the signals of the frames.
+ */
+class EGT_API CanSocket : private detail::NonCopyable<CanSocket>
+{
+public:
+
+    /// Called with the frames read.
+    using Callback = std::function<void(const CanFrame* frames, size_t count)>;
+
+    /// Number of frames read with each system call.
+    static constexpr size_t BATCH = 64;
+
+    /**
+     * @param[in] interface The interface, like can0.
+     * @param[in] callback Called with the frames read.
+     * @param[in] filters Frames to receive, all of them if empty.
+     * @throws std::runtime_error if unable to open the interface.
+     */
+    CanSocket(const std::string& interface, Callback callback,
+              const std::vector<CanFilter>& filters = {});
+
+    /**
+     * Set the frames to receive.
+     *
+     * @param[in] filters Frames to receive, all of them if empty.
+     * @return false on error.
+     */
+    bool filters(const std::vector<CanFilter>& filters);
+
+    /**
+     * Send a frame.
+     *
+     * @return false on error, like when the transmit queue is full.
+     */
+    bool write(const CanFrame& frame);
+
+    /// Number of frames read.
+    EGT_NODISCARD uint64_t frames() const { return m_count; }
+
+    ~CanSocket() noexcept;
+
+private:
+
+    /// Read the pending frames.
+    void read();
+
+    Callback m_callback;
+    std::unique_ptr<FdMonitor> m_monitor;
+    std::vector<CanFrame> m_frames;
+    uint64_t m_count{0};
+};
+
+/**
+ * Updates widgets from the signals of CAN frames.
+ *
+ * A bus carries thousands of frames per second, and drawing is only done for
+ * each frame of the screen.  Each bound signal is decoded only from the last
+ * frame of each batch, and applied at most once per frame of the screen,
+ * with its latest value, with an UpdateChannel.
+ *
+ * @code{.cpp}
+ * egt::CanBinding binding(app.event());
+ * binding.bind({0x100, false, 0, 16}, [&gauge](double rpm)
+ * {
+ *     gauge.value(rpm);
+ * });
+ *
+ * egt::CanSocket socket("can0", [&binding](const egt::CanFrame* frames, size_t count)
+ * {
+ *     binding.feed(frames, count);
+ * }, binding.filters());
+ * @endcode
+ */
+class EGT_API CanBinding : private detail::NonCopyable<CanBinding>
+{
+public:
+
+    /// Applies a value.
+    using Callback = std::function<void(const double& value)>;
+
+    /**
+     * @param[in] loop The event loop the values are applied in.
+     */
+    explicit CanBinding(EventLoop& loop);
+
+    /**
+     * Bind a signal.
+     *
+     * @param[in] signal The signal.
+     * @param[in] callback Applies its value, i.e. to a widget.
+     */
+    void bind(const CanSignal& signal, Callback callback);
+
+    /// Remove all bindings.
+    void clear();
+
+    /**
+     * Decode the bound signals from frames, and post their values.
+     *
+     * Frames are in the order they were received.
+     */
+    void feed(const CanFrame* frames, size_t count);
+
+    /// Kernel filters receiving only the frames of the bound signals.
+    EGT_NODISCARD std::vector<CanFilter> filters() const;
+
+    ~CanBinding() noexcept;
+
+private:
+
+    struct Binding
+    {
+        CanSignal signal;
+        std::unique_ptr<UpdateChannel<double>> channel;
+    };
+
+    /// Key of the frames of a signal, with the extended bit.
+    static uint32_t key(uint32_t id, bool extended)
+    {
+        return extended ? (id | 0x80000000) : id;
+    }
+
+    EventLoop& m_loop;
+    std::unordered_map<uint32_t, std::vector<Binding>> m_bindings;
+    /// Keys seen while feeding a batch.
+    std::vector<uint32_t> m_seen;
+};
+
+}
+}
+
+#endif
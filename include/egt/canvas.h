@@ -14,11 +14,14 @@
 #include <egt/detail/meta.h>
 #include <egt/geometry.h>
 #include <egt/types.h>
+#include <functional>
+#include <vector>
 
 namespace egt
 {
 inline namespace v1
 {
+class Painter;
 
 /**
  * Manages a unique drawing surface and context.
@@ -147,6 +150,139 @@ protected:
     shared_cairo_t m_cr;
 };
 
+/**
+ * Retained drawing, as a list of recorded paint operations.
+ *
+ * Each operation is recorded once with its bounding box, and replayed by
+ * draw() only where it intersects the area being drawn.  So, after a popup
+ * is closed or some content is scrolled, only the operations under the
+ * damaged area are drawn again and the application does not have to keep a
+ * copy of what it drew.
+ *
+ * Past a threshold of operations, the list is flattened: the operations are
+ * drawn once into a bitmap layer, which is drawn under the operations
+ * recorded after it.  This bounds both the memory used and the time to
+ * draw any area.
+ *
+ * Operations are composited over each other, like with the default
+ * operator, so use clear() to erase everything.
+ *
+ * @b Example
+ * @code{.cpp}
+ * DisplayList list(Size(800, 480));
+ * auto box = list.record([](Painter& painter)
+ * {
+ *     painter.draw(Point(10, 10), Point(100, 100));
+ *     painter.stroke();
+ * });
+ * damage(box);
+ * ...
+ * void MyWidget::draw(Painter& painter, const Rect& rect)
+ * {
+ *     list.draw(painter, rect);
+ * }
+ * @endcode
+ *
+ * @ingroup drawing
+ */
+class EGT_API DisplayList
+{
+public:
+
+    /// Type of a recorded paint operation.
+    using Operation = std::function<void(Painter& painter)>;
+
+    /**
+     * @param[in] size The size of the drawing.  Nothing outside of it is kept.
+     * @param[in] threshold Number of operations flattened to the bitmap layer
+     *            at once.
+     */
+    explicit DisplayList(const Size& size, size_t threshold = 256);
+
+    /**
+     * Record a paint operation.
+     *
+     * The operation is called once, with a Painter to a recording surface.
+     *
+     * @return The bounding box of what the operation drew, empty if nothing.
+     */
+    Rect record(const Operation& operation);
+
+    /**
+     * Draw the list, limited to a rectangle.
+     *
+     * Only the bitmap layer and the operations that intersect the rectangle
+     * are drawn.
+     *
+     * @param[in] painter The painter to draw with.
+     * @param[in] rect The area to draw, relative to origin.
+     * @param[in] origin Where the top left corner of the list is drawn.
+     */
+    void draw(Painter& painter, const Rect& rect, const Point& origin = {}) const;
+
+    /**
+     * Draw every operation into the bitmap layer, and empty the list.
+     *
+     * This is done automatically past the threshold, but also allows working
+     * on the pixels of the drawing with layer().
+     */
+    void flatten();
+
+    /**
+     * Remove all operations and clear the bitmap layer.
+     */
+    void clear();
+
+    /**
+     * The bitmap layer, drawn under the operations.
+     *
+     * Call flatten() first to get everything drawn so far.  The layer may be
+     * drawn to directly, for example to work on its pixels.
+     */
+    EGT_NODISCARD Canvas& layer();
+
+    /**
+     * Number of operations not flattened yet.
+     */
+    EGT_NODISCARD size_t size() const { return m_operations.size(); }
+
+    /**
+     * Size of the drawing.
+     */
+    EGT_NODISCARD Size canvas_size() const { return m_layer.size(); }
+
+    /**
+     * Bounding box of everything drawn, flattened or not.
+     */
+    EGT_NODISCARD Rect bounding_box() const { return m_box; }
+
+protected:
+
+    /// A recorded operation.
+    struct Recording
+    {
+        /// Recording surface of the operation.
+        shared_cairo_surface_t surface;
+        /// Bounding box of the operation.
+        Rect box;
+    };
+
+    /// Operations recorded after the last flatten().
+    std::vector<Recording> m_operations;
+
+    /// Operations drawn to the bitmap layer by flatten().
+    Canvas m_layer;
+
+    /// Number of operations that trigger a flatten().
+    size_t m_threshold;
+
+    /// Bounding box of what is drawn in the bitmap layer.
+    Rect m_layer_box;
+
+    /// Bounding box of everything drawn.
+    Rect m_box;
+};
+
 }
 }
 
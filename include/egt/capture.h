@@ -8,9 +8,12 @@
 
 /**
  * @file
- * @brief Camera capture support.
+ * @brief Camera and screen capture support.
  */
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <egt/object.h>
 #include <egt/signal.h>
 #include <egt/types.h>
@@ -21,10 +24,12 @@ namespace egt
 {
 inline namespace v1
 {
+class Screen;
 
 namespace detail
 {
 class CaptureImpl;
+class ScreenRecorderImpl;
 }
 
 namespace experimental
@@ -66,6 +71,10 @@ public:
 
     /**
      * Output container type.
+     *
+     * An avi contains raw video. An mpeg2ts contains H.264 video when a
+     * hardware H.264 encoder is available, or else MPEG-2 video encoded in
+     * software.
      */
     enum class ContainerType
     {
@@ -117,6 +126,58 @@ public:
      */
     void stop();
 
+    /**
+     * Set the bitrate of the encoded video, before start().
+     *
+     * The encoder keeps a constant bitrate when it supports it.
+     *
+     * @param[in] kbps Bitrate in kbit/s, or 0 for the encoder default.
+     */
+    void bitrate(uint32_t kbps);
+
+    /**
+     * Get the bitrate of the encoded video in kbit/s, or 0 for the encoder
+     * default.
+     */
+    EGT_NODISCARD uint32_t bitrate() const;
+
+    /**
+     * Encode for low latency, before start().
+     *
+     * Key frames are more frequent, so a stream can be joined or cut sooner,
+     * at the cost of a larger output.
+     */
+    void low_latency(bool enable);
+
+    /**
+     * Is the video encoded for low latency.
+     */
+    EGT_NODISCARD bool low_latency() const;
+
+    /**
+     * Split the output in files of a duration, before start().
+     *
+     * A new file is started at the first key frame after the duration, without
+     * stopping the capture. The output file path must then contain a printf
+     * style number pattern, like "capture%05d.ts", or one is added before the
+     * extension.
+     *
+     * @param[in] duration Duration of a file, or 0 for a single file.
+     */
+    void segment_duration(std::chrono::seconds duration);
+
+    /**
+     * Get the duration of a file of the output, or 0 for a single file.
+     */
+    EGT_NODISCARD std::chrono::seconds segment_duration() const;
+
+    /**
+     * Get the video encoder used by the capture, once started.
+     *
+     * For example "v4l2h264enc", or an empty string for raw video.
+     */
+    EGT_NODISCARD std::string encoder() const;
+
     ~CameraCapture() override;
 
 protected:
@@ -125,6 +186,118 @@ protected:
     std::unique_ptr<detail::CaptureImpl> m_impl;
 };
 
+/**
+ * Statistics of a ScreenRecorder.
+ *
+ * @see ScreenRecorder::stats()
+ */
+struct ScreenRecorderStats
+{
+    /// Number of frames flipped while recording.
+    size_t frames{0};
+    /// Number of frames dropped, because all the buffers were being encoded.
+    size_t dropped{0};
+    /// Number of pixels copied for the encoder.
+    size_t copied_pixels{0};
+};
+
+/**
+ * Record the frames of a screen to an MPEG-TS file.
+ *
+ * The video is H.264 when a hardware H.264 encoder is available, or else
+ * MPEG-2 video encoded in software.
+ *
+ * Recording uses a fixed number of frame buffers, as many as fit in the
+ * memory budget.  When a frame is flipped, it is copied to the free buffer
+ * filled most recently, only where the buffer missed some damage since, and
+ * the buffer is handed to the encoder without another copy.  If all the
+ * buffers are still being encoded, the frame is dropped instead of stalling
+ * the flip: its damage is copied with the next frame recorded.
+ *
+ * @code{.cpp}
+ * experimental::ScreenRecorder recorder(*app.screen(), "/tmp/ui.ts");
+ * recorder.start();
+ * ...
+ * recorder.stop();
+ * @endcode
+ *
+ * @note The screen must outlive the recorder.
+ */
+class EGT_API ScreenRecorder : public Object
+{
+public:
+
+    /**
+     * Event signal.
+     * @{
+     */
+    /**
+     * Invoked when an error occurs.
+     */
+    Signal<const std::string&> on_error;
+    /** @} */
+
+    /// Default memory budget of the frame buffers, in bytes.
+    static constexpr size_t DEFAULT_BUDGET = 16 * 1024 * 1024;
+
+    /**
+     * @param[in] screen The screen to record.
+     * @param[in] output The output file path.
+     * @param[in] budget Memory for the frame buffers, in bytes.  It must fit
+     *            at least one frame.
+     */
+    explicit ScreenRecorder(Screen& screen,
+                            const std::string& output = "screen.ts",
+                            size_t budget = DEFAULT_BUDGET);
+
+    ScreenRecorder(const ScreenRecorder&) = delete;
+    ScreenRecorder& operator=(const ScreenRecorder&) = delete;
+    ScreenRecorder(ScreenRecorder&&) = delete;
+    ScreenRecorder& operator=(ScreenRecorder&&) = delete;
+
+    /**
+     * Start recording the frames flipped.
+     *
+     * @return true on success
+     */
+    bool start();
+
+    /**
+     * Stop recording and finish the output.
+     */
+    void stop();
+
+    /**
+     * Set the bitrate of the encoded video, before start().
+     *
+     * @param[in] kbps Bitrate in kbit/s, or 0 for the encoder default.
+     */
+    void bitrate(uint32_t kbps);
+
+    /**
+     * Get the bitrate of the encoded video in kbit/s, or 0 for the encoder
+     * default.
+     */
+    EGT_NODISCARD uint32_t bitrate() const;
+
+    /**
+     * Get the video encoder used by the recording, once started.
+     */
+    EGT_NODISCARD std::string encoder() const;
+
+    /**
+     * Get the statistics of the recording.
+     */
+    EGT_NODISCARD ScreenRecorderStats stats() const;
+
+    ~ScreenRecorder() override;
+
+protected:
+
+    /// Internal recorder implementation.
+    std::unique_ptr<detail::ScreenRecorderImpl> m_impl;
+};
+
 }
 }
 }
@@ -11,8 +11,10 @@
  * @brief Working with charts.
  */
 
+#include <chrono>
 #include <deque>
 #include <egt/widget.h>
+#include <vector>
 
 namespace egt
 {
@@ -140,6 +142,22 @@ public:
         box_minor_ticks_coord = 3,
     };
 
+    /**
+     * How data points are reduced before being drawn.
+     *
+     * Only used by LineChart and PointChart, for data sorted by x.  Data with
+     * less than four points per pixel column is always drawn as is.
+     */
+    enum class Decimation
+    {
+        /// draw all the points
+        none,
+        /// keep the first, lowest, highest and last point of each pixel column
+        minmax,
+        /// largest-triangle-three-buckets, about a point per pixel column
+        lttb,
+    };
+
     void draw(Painter& painter, const Rect& rect) override;
 
     virtual void create_impl() = 0;
@@ -170,6 +188,44 @@ public:
     */
     size_t data_size() const;
 
+    /**
+     * Append a data point.
+     *
+     * Unlike add_data(), the data is not copied into a ChartItemArray, and
+     * while the axes do not change, only the part of the chart from the
+     * previous last point is damaged.
+     *
+     * @param[in] x The x value of the point.
+     * @param[in] y The y value of the point.
+     */
+    void push(double x, double y);
+
+    /**
+     * Append data points.
+     *
+     * @param[in] x The x values of the points.
+     * @param[in] y The y values of the points, as many as x values.
+     *
+     * @see push(double, double)
+     */
+    void push_batch(const std::vector<double>& x, const std::vector<double>& y);
+
+    /**
+     * Set the maximum number of data points.
+     *
+     * When more points are added, the oldest ones are dropped, so the data
+     * is a ring buffer.  Dropping points does not move the others until as
+     * many are dropped as are left.
+     *
+     * @param[in] count Maximum number of points, 0 for no limit.
+     */
+    void capacity(size_t count);
+
+    /**
+     * Get the maximum number of data points, 0 for no limit.
+     */
+    size_t capacity() const;
+
     /**
      * Remove data items from top in an array.
      *
@@ -264,6 +320,19 @@ public:
      */
     float bank() const;
 
+    /**
+     * Set how data points are reduced before being drawn.
+     *
+     * Defaults to Decimation::minmax, which looks the same as drawing all the
+     * points.
+     */
+    void decimation(Decimation mode);
+
+    /**
+     * Get how data points are reduced before being drawn.
+     */
+    Decimation decimation() const;
+
     void serialize(Serializer& serializer) const;
 
     void deserialize(Serializer::Properties& props);
@@ -430,7 +499,10 @@ private:
  * Vertical BarChart Widget is used for displaying a
  * set of categorical data.
  *
- * The Vertical BarChart widget is using plplot library api's.
+ * The axes of the Vertical BarChart widget are drawn with the plplot
+ * library api's, only when they change.  The bars are drawn natively, and
+ * move to changed values with a transition, drawing again only the bars that
+ * move.
  */
 class EGT_API BarChart: public ChartBase
 {
@@ -485,6 +557,21 @@ public:
      */
     EGT_NODISCARD BarPattern bar_style() const;
 
+    /**
+     * Set the duration of the transition of the bars to changed values.
+     *
+     * The bars are stepped by the animation ticker.  A duration of zero
+     * shows changes at once.
+     *
+     * @param[in] duration Duration of the transition, 250 ms by default.
+     */
+    void transition(std::chrono::milliseconds duration);
+
+    /**
+     * Get the duration of the transition of the bars to changed values.
+     */
+    EGT_NODISCARD std::chrono::milliseconds transition() const;
+
     void serialize(Serializer& serializer) const override;
 
     ~BarChart() override;
@@ -509,7 +596,7 @@ private:
  * Horizontal BarChart Widget is used for displaying a set
  * of categorical data.
  *
- * The Horizontal BarChart Widget is using plplot library api's.
+ * The Horizontal BarChart Widget is drawn like the BarChart.
  */
 class EGT_API HorizontalBarChart: public BarChart
 {
@@ -550,7 +637,9 @@ public:
  * PieChart Widget is a circular statistical graphic, which
  * is divided into slices to illustrate numerical proportion
  *
- * The PieChart Widget is using plplot library api's.
+ * Values are percents of the circle.  The PieChart Widget is drawn natively,
+ * and its slices move to changed values with a transition, drawing again only
+ * the slices that move.
  */
 class EGT_API PieChart: public Widget
 {
@@ -638,6 +727,21 @@ public:
      */
     void resize(const Size& size) override;
 
+    /**
+     * Set the duration of the transition of the slices to changed values.
+     *
+     * The slices are stepped by the animation ticker.  A duration of zero
+     * shows changes at once.
+     *
+     * @param[in] duration Duration of the transition, 250 ms by default.
+     */
+    void transition(std::chrono::milliseconds duration);
+
+    /**
+     * Get the duration of the transition of the slices to changed values.
+     */
+    EGT_NODISCARD std::chrono::milliseconds transition() const;
+
     void serialize(Serializer& serializer) const override;
 
     ~PieChart() override;
@@ -19,7 +19,6 @@
 #include <egt/detail/string.h>
 #include <initializer_list>
 #include <iosfwd>
-#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -607,16 +606,16 @@ public:
     void step(const Color& color)
     {
         m_steps.emplace_back(color);
-        for (auto& x : m_cache)
-            x.clear();
+        m_lut.clear();
+        m_cache.clear();
     }
 
     /// Set the color steps.
     void steps(const StepsArray& steps)
     {
         m_steps = steps;
-        for (auto& x : m_cache)
-            x.clear();
+        m_lut.clear();
+        m_cache.clear();
     }
 
     /**
@@ -629,13 +628,37 @@ public:
     /**
      * Get a color at the specified offset.
      *
-     * This will use a cache to speed up repetitive calls to interpolate.
+     * This reads the nearest color in a table baked with accuracy + 1 colors,
+     * to speed up repetitive calls to interpolate.
      *
      * @param[in] t Offset from 0 to 1.
      * @param[in] accuracy Accuracy of the cached result.
      */
     Color interp_cached(float t, size_t accuracy = 1000) const;
 
+    /**
+     * Bake the table of colors used by map().
+     *
+     * The colors are evenly spaced from offset 0 to 1, and interpolated once
+     * in the color space of the map, so HSV and HSL cost the same as RGBA
+     * afterwards.
+     *
+     * @param[in] resolution Number of colors in the table, at least 2.
+     */
+    void bake(size_t resolution = 256);
+
+    /**
+     * Get the colors at many offsets, like a heat map does for its cells.
+     *
+     * Each offset reads the nearest color in the baked table, which is baked
+     * if needed.
+     *
+     * @param[in] offsets Offsets from 0 to 1.
+     * @param[out] pixels The colors, as ARGB8888 pixels.
+     * @param[in] count Number of offsets.
+     */
+    void map(const float* offsets, uint32_t* pixels, size_t count) const;
+
     /// Get a reference to the color steps array.
     const StepsArray& steps() const { return m_steps; }
 
@@ -650,8 +673,17 @@ protected:
     /// Steps in the color map.
     StepsArray m_steps;
 
-    /// Interpolation cache.
-    mutable std::array<std::map<size_t, Color>, 3> m_cache{};
+    /// Bake a table of colors with a resolution, unless already baked.
+    void bake(std::vector<uint32_t>& table, size_t resolution) const;
+
+    /// Table of colors used by map(), as ARGB8888 pixels.
+    mutable std::vector<uint32_t> m_lut;
+
+    /// Table of colors used by interp_cached().
+    mutable std::vector<uint32_t> m_cache;
+
+    /// Resolution of the table used by map().
+    size_t m_resolution{256};
 
     /// Interpolation color space method.
     Interpolation m_interp{Interpolation::rgba};
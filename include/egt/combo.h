@@ -39,6 +39,10 @@ class ComboBoxPopup;
  * This manages a list of selectable items, but otherwise just shows only what
  * is selected.
  *
+ * The popup listing the items is only created when a combo box is first
+ * opened, and is shared by all combo boxes.  It is a VirtualListBox, so it
+ * only has widgets for the items it shows, whatever the number of items.
+ *
  * @ingroup controls
  */
 class EGT_API ComboBox : public Widget
@@ -128,7 +132,7 @@ public:
     /**
      * Get the index of the selected item.
      */
-    EGT_NODISCARD ssize_t selected() const { return m_list.selected(); }
+    EGT_NODISCARD ssize_t selected() const { return m_selected; }
 
     /**
      * Append a new item to the ComboBox.
@@ -163,7 +167,7 @@ public:
      */
     EGT_NODISCARD std::shared_ptr<StringItem> item_at(size_t index) const
     {
-        return m_list.item_at(index);
+        return index < m_items.size() ? m_items[index] : nullptr;
     }
 
     /**
@@ -171,7 +175,7 @@ public:
      */
     EGT_NODISCARD size_t item_count() const
     {
-        return m_list.item_count();
+        return m_items.size();
     }
 
     /**
@@ -191,15 +195,21 @@ public:
 
     void serialize(Serializer& serializer) const override;
 
+    ~ComboBox() noexcept override;
+
 protected:
 
-    void set_parent(Widget* parent) override;
+    /// Update the popup, if it shows this ComboBox.
+    void items_changed();
+
+    /// Items.
+    ItemArray m_items;
 
-    /// Internal list.
-    ListBox m_list;
+    /// Index of the selected item, or -1.
+    ssize_t m_selected{-1};
 
-    /// Popup associated with the ComboBox.
-    std::shared_ptr<detail::ComboBoxPopup> m_popup;
+    /// Popup shared by all ComboBox, once this one was shown.
+    mutable std::shared_ptr<detail::ComboBoxPopup> m_popup;
 
     friend class detail::ComboBoxPopup;
 
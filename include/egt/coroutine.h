@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_COROUTINE_H
+#define EGT_COROUTINE_H
+
+/**
+ * @file
+ * @brief Coroutines run by the event loop.
+ *
+ * This header is only available to applications built as C++20.  The library
+ * itself is C++17 and does not depend on it.
+ */
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <coroutine>
+#include <egt/animation.h>
+#include <egt/app.h>
+#include <egt/asio.hpp>
+#include <egt/signal.h>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#ifdef EGT_HAS_HTTP
+#include <egt/network/http.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#endif
+
+#ifdef EGT_HAS_VIDEO
+#include <egt/video.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+
+template<class T = void>
+class Task;
+
+namespace detail
+{
+
+/// Resume a coroutine from the event loop, outside of the current handler.
+inline void resume_later(std::coroutine_handle<> handle)
+{
+    asio::post(Application::instance().event().io(), [handle]()
+    {
+        handle.resume();
+    });
+}
+
+/**
+ * Promise of a Task, without the result.
+ */
+struct TaskPromiseBase
+{
+    /// Resumes the awaiting coroutine once the task is done.
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+        {
+            if (handle.promise().continuation)
+                return handle.promise().continuation;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() noexcept
+    {
+        exception = std::current_exception();
+    }
+
+    /// The coroutine awaiting the task.
+    std::coroutine_handle<> continuation;
+    /// Exception thrown by the task, rethrown to the awaiting coroutine.
+    std::exception_ptr exception;
+};
+
+template<class T>
+struct TaskPromise : public TaskPromiseBase
+{
+    Task<T> get_return_object() noexcept;
+
+    template<class U>
+    void return_value(U&& value)
+    {
+        result.emplace(std::forward<U>(value));
+    }
+
+    T take()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template<>
+struct TaskPromise<void> : public TaskPromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void take()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+}
+
+/**
+ * A coroutine run by the event loop, returning a T.
+ *
+ * A Task starts when it is awaited by another coroutine, or when it is passed
+ * to spawn().  Awaiting it returns its result, or rethrows the exception it
+ * threw.  Waiting for a timer, an animation or a signal in a Task does not
+ * block the event loop: the Task is suspended, and resumed by the event loop.
+ *
+ * @code{.cpp}
+ * egt::Task<> fade_in(egt::Widget& widget)
+ * {
+ *     egt::PropertyAnimatorF animation(0, 1, 500ms);
+ *     animation.on_change([&widget](float value) { widget.alpha(value); });
+ *     animation.start();
+ *     co_await egt::finished(animation);
+ *     co_await egt::sleep(1s);
+ *     widget.hide();
+ * }
+ *
+ * egt::spawn(fade_in(label));
+ * @endcode
+ */
+template<class T>
+class Task
+{
+public:
+
+    /// Promise type of the coroutine.
+    using promise_type = detail::TaskPromise<T>;
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task(Task&& rhs) noexcept
+        : m_handle(std::exchange(rhs.m_handle, nullptr))
+    {}
+
+    Task& operator=(Task&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(rhs.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    /// @private
+    bool await_ready() const noexcept
+    {
+        return !m_handle || m_handle.done();
+    }
+
+    /// @private
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+
+    /// @private
+    T await_resume()
+    {
+        return m_handle.promise().take();
+    }
+
+    ~Task()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+private:
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> m_handle;
+
+    friend promise_type;
+};
+
+namespace detail
+{
+
+template<class T>
+inline Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * A coroutine nobody awaits, destroyed once done.
+ */
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const
+        {
+            // thrown out of the event loop, like from any other handler
+            asio::post(Application::instance().event().io(),
+                       [e = std::current_exception()]()
+            {
+                std::rethrow_exception(e);
+            });
+        }
+    };
+};
+
+inline Detached run_detached(Task<void> task)
+{
+    co_await task;
+}
+
+/**
+ * Waits for a duration, with a timer of the event loop.
+ */
+class SleepAwaiter
+{
+public:
+
+    explicit SleepAwaiter(std::chrono::milliseconds duration)
+        : m_duration(duration),
+          m_timer(Application::instance().event().io())
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return m_duration <= std::chrono::milliseconds::zero();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_timer.expires_after(m_duration);
+        m_timer.async_wait([handle](const asio::error_code & error)
+        {
+            // cancelled when the event loop is destroyed
+            if (!error)
+                handle.resume();
+        });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+
+    std::chrono::milliseconds m_duration;
+    asio::steady_timer m_timer;
+};
+
+/**
+ * Waits for a Signal to be invoked.
+ */
+template<class... Args>
+class SignalAwaiter
+{
+public:
+
+    explicit SignalAwaiter(Signal<Args...>& signal)
+        : m_signal(signal)
+    {}
+
+    SignalAwaiter(const SignalAwaiter&) = delete;
+    SignalAwaiter& operator=(const SignalAwaiter&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_registration = m_signal.on_event([this, handle](Args...)
+        {
+            if (m_invoked)
+                return;
+            m_invoked = true;
+
+            // the handler cannot be removed while the signal invokes it
+            asio::post(Application::instance().event().io(), [this, handle]()
+            {
+                m_signal.remove(m_registration);
+                handle.resume();
+            });
+        });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+
+    Signal<Args...>& m_signal;
+    typename Signal<Args...>::RegisterHandle m_registration{};
+    bool m_invoked{false};
+};
+
+/**
+ * Waits for an AutoAnimation to stop.
+ */
+class AnimationAwaiter : public SignalAwaiter<>
+{
+public:
+
+    explicit AnimationAwaiter(AutoAnimation& animation)
+        : SignalAwaiter<>(animation.on_stopped),
+          m_animation(animation)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return !m_animation.running();
+    }
+
+private:
+
+    AutoAnimation& m_animation;
+};
+
+#ifdef EGT_HAS_HTTP
+/**
+ * Downloads a URL.
+ */
+class HttpGetAwaiter
+{
+public:
+
+    explicit HttpGetAwaiter(std::string url)
+        : m_url(std::move(url))
+    {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_request.start_async(m_url, [this, handle](const unsigned char* data, size_t len, bool done)
+        {
+            if (data && len)
+                m_data.insert(m_data.end(), data, data + len);
+
+            // the request is destroyed with the coroutine frame, not in its callback
+            if (done)
+                resume_later(handle);
+        });
+    }
+
+    std::vector<unsigned char> await_resume()
+    {
+        if (!m_request.ok())
+            throw std::runtime_error("http request failed: " + m_url);
+        return std::move(m_data);
+    }
+
+private:
+
+    std::string m_url;
+    experimental::HttpClientRequest m_request;
+    std::vector<unsigned char> m_data;
+};
+#endif
+
+}
+
+/**
+ * Run a Task without awaiting it.
+ *
+ * The Task runs until its first suspension before this returns, and is
+ * destroyed once done.  An exception it throws is rethrown from the event
+ * loop.
+ */
+inline void spawn(Task<void> task)
+{
+    detail::run_detached(std::move(task));
+}
+
+/**
+ * Suspend the coroutine for a duration.
+ *
+ * @code{.cpp}
+ * co_await egt::sleep(std::chrono::seconds(1));
+ * @endcode
+ */
+inline detail::SleepAwaiter sleep(std::chrono::milliseconds duration)
+{
+    return detail::SleepAwaiter(duration);
+}
+
+/**
+ * Suspend the coroutine until a Signal is invoked.
+ *
+ * @note The object owning the signal must outlive the wait.
+ */
+template<class... Args>
+inline detail::SignalAwaiter<Args...> signaled(Signal<Args...>& signal)
+{
+    return detail::SignalAwaiter<Args...>(signal);
+}
+
+/**
+ * Suspend the coroutine until an animation stops.
+ *
+ * This does not suspend if the animation is not running.
+ */
+inline detail::AnimationAwaiter finished(AutoAnimation& animation)
+{
+    return detail::AnimationAwaiter(animation);
+}
+
+#ifdef EGT_HAS_VIDEO
+/**
+ * Suspend the coroutine until the end of stream of a video.
+ */
+inline detail::SignalAwaiter<> eos(VideoWindow& video)
+{
+    return detail::SignalAwaiter<>(video.on_eos);
+}
+#endif
+
+#ifdef EGT_HAS_HTTP
+/**
+ * Download a URL, and resume the coroutine with its content.
+ *
+ * @throws std::runtime_error if the request fails.
+ *
+ * @code{.cpp}
+ * auto data = co_await egt::http_get("http://example.com/data.json");
+ * @endcode
+ */
+inline detail::HttpGetAwaiter http_get(const std::string& url)
+{
+    return detail::HttpGetAwaiter(url);
+}
+#endif
+
+}
+}
+
+#endif
+
+#endif
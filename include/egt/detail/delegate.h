@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_DELEGATE_H
+#define EGT_DETAIL_DELEGATE_H
+
+/**
+ * @file
+ * @brief Lightweight callable wrapper.
+ */
+
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+template<class Signature>
+class Delegate;
+
+/**
+ * Copyable callable, like std::function, for event handlers.
+ *
+ * Callables up to BUFFER_SIZE bytes, which covers lambdas capturing a few
+ * pointers and std::function itself, are stored inline and never allocate.
+ * Calling costs one indirect call.
+ */
+template<class R, class... Args>
+class Delegate<R(Args...)>
+{
+public:
+
+    /// Size of the inline storage.
+    static constexpr size_t BUFFER_SIZE = 4 * sizeof(void*);
+
+    Delegate() noexcept = default;
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    Delegate(std::nullptr_t) noexcept
+    {}
+
+    template<class F,
+             class = typename std::enable_if<!std::is_same<typename std::decay<F>::type,
+                                                           Delegate>::value>::type>
+    // NOLINTNEXTLINE(bugprone-forwarding-reference-overload,google-explicit-constructor)
+    Delegate(F&& f)
+    {
+        using T = typename std::decay<F>::type;
+
+        // an empty std::function or a null function pointer is no callable
+        if constexpr (std::is_constructible<bool, const T&>::value)
+        {
+            if (!static_cast<bool>(f))
+                return;
+        }
+
+        if constexpr (fits<T>())
+        {
+            new (m_storage) T(std::forward<F>(f));
+            m_ops = inline_ops<T>();
+        }
+        else
+        {
+            *reinterpret_cast<T**>(m_storage) = new T(std::forward<F>(f));
+            m_ops = heap_ops<T>();
+        }
+    }
+
+    Delegate(const Delegate& rhs)
+    {
+        if (rhs.m_ops)
+        {
+            rhs.m_ops->copy(m_storage, rhs.m_storage);
+            m_ops = rhs.m_ops;
+        }
+    }
+
+    Delegate& operator=(const Delegate& rhs)
+    {
+        if (this != &rhs)
+        {
+            Delegate tmp(rhs);
+            reset();
+            take(tmp);
+        }
+        return *this;
+    }
+
+    Delegate(Delegate&& rhs) noexcept
+    {
+        take(rhs);
+    }
+
+    Delegate& operator=(Delegate&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            take(rhs);
+        }
+        return *this;
+    }
+
+    ~Delegate() noexcept
+    {
+        reset();
+    }
+
+    /// Call the callable.
+    R operator()(Args... args) const
+    {
+        return m_ops->invoke(m_storage, std::forward<Args>(args)...);
+    }
+
+    /// Is there a callable.
+    explicit operator bool() const noexcept
+    {
+        return m_ops;
+    }
+
+    /// Does a callable of type T fit in the inline storage.
+    template<class T>
+    static constexpr bool fits()
+    {
+        return sizeof(T) <= BUFFER_SIZE &&
+               alignof(T) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<T>::value;
+    }
+
+protected:
+
+    struct Ops
+    {
+        R(*invoke)(void* storage, Args&& ... args);
+        void (*copy)(void* dst, const void* src);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    /// Call, dropping the result of callables that return one for void.
+    template<class Result, class T>
+    static Result invoke_as(T& callable, Args&& ... args)
+    {
+        if constexpr (std::is_void<Result>::value)
+            callable(std::forward<Args>(args)...);
+        else
+            return callable(std::forward<Args>(args)...);
+    }
+
+    template<class T>
+    static const Ops* inline_ops()
+    {
+        static const Ops ops =
+        {
+            [](void* storage, Args && ... args) -> R
+            {
+                return invoke_as<R>((*static_cast<T*>(storage)), std::forward<Args>(args)...);
+            },
+            [](void* dst, const void* src)
+            {
+                new (dst) T(*static_cast<const T*>(src));
+            },
+            [](void* dst, void* src) noexcept
+            {
+                new (dst) T(std::move(*static_cast<T*>(src)));
+                static_cast<T*>(src)->~T();
+            },
+            [](void* storage) noexcept { static_cast<T*>(storage)->~T(); },
+        };
+        return &ops;
+    }
+
+    template<class T>
+    static const Ops* heap_ops()
+    {
+        static const Ops ops =
+        {
+            [](void* storage, Args && ... args) -> R
+            {
+                return invoke_as<R>((**static_cast<T**>(storage)), std::forward<Args>(args)...);
+            },
+            [](void* dst, const void* src)
+            {
+                *static_cast<T**>(dst) = new T(**static_cast<T* const*>(src));
+            },
+            [](void* dst, void* src) noexcept
+            {
+                *static_cast<T**>(dst) = *static_cast<T**>(src);
+            },
+            [](void* storage) noexcept { delete *static_cast<T**>(storage); },
+        };
+        return &ops;
+    }
+
+    void take(Delegate& rhs) noexcept
+    {
+        if (rhs.m_ops)
+        {
+            rhs.m_ops->move(m_storage, rhs.m_storage);
+            m_ops = rhs.m_ops;
+            rhs.m_ops = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    /// Callables are called through a const Delegate, like std::function.
+    alignas(std::max_align_t) mutable unsigned char m_storage[BUFFER_SIZE];
+    const Ops* m_ops{nullptr};
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_DRAWDIAGNOSTICS_H
+#define EGT_DETAIL_DRAWDIAGNOSTICS_H
+
+/**
+ * @file
+ * @brief Overdraw and redundant work diagnostics.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/screen.h>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+class Painter;
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Finds where drawing does more work than it needs to.
+ *
+ * In overdraw mode, the pixels given to every widget drawn on a screen are
+ * counted for each frame, and the frame copied to the display is tinted
+ * with how many times each damaged pixel was written: not at all when once,
+ * blue twice, green three times, pink four times, and red more.  A widget
+ * counts as writing its whole rectangle, whatever it actually paints.
+ *
+ * In report mode, these are counted for each widget name:
+ * - damage that did not change any pixel, like setting the same text again.
+ * - frames the widget was laid out more than once.
+ * - draws entirely outside the clip or the surface, which cannot be seen.
+ * Along with the average and maximum number of times a damaged pixel was
+ * written.  See write_report().
+ *
+ * Set the EGT_OVERDRAW_ENABLE environment variable to a non-empty value to
+ * enable overdraw mode at startup, and EGT_DRAW_REPORT to a file name to
+ * enable report mode and write the report to that file when
+ * EventLoop::run() returns.
+ *
+ * Both modes need a composition buffer.  When disabled, each hook costs a
+ * single branch.
+ *
+ * @note Only the event loop thread is diagnosed.  Window::parallel_draw()
+ * bands are drawn on other threads, and are not counted.
+ */
+class EGT_API DrawDiagnostics
+{
+public:
+
+    /**
+     * What was counted for a widget name.
+     */
+    struct WidgetStats
+    {
+        /// Damage that did not change any pixel.
+        uint64_t unchanged_damage{0};
+        /// Pixels of the damage that did not change.
+        uint64_t unchanged_pixels{0};
+        /// Frames the widget was laid out more than once.
+        uint64_t relayout_frames{0};
+        /// Most layouts of the widget in one frame.
+        uint64_t max_layouts{0};
+        /// Draws outside of the clip or the surface.
+        uint64_t hidden_draws{0};
+    };
+
+    /**
+     * Get a reference to the DrawDiagnostics instance.
+     */
+    static DrawDiagnostics& instance();
+
+    DrawDiagnostics(const DrawDiagnostics&) = delete;
+    DrawDiagnostics& operator=(const DrawDiagnostics&) = delete;
+    DrawDiagnostics(DrawDiagnostics&&) = delete;
+    DrawDiagnostics& operator=(DrawDiagnostics&&) = delete;
+    ~DrawDiagnostics() noexcept;
+
+    /**
+     * Enable or disable overdraw mode.
+     */
+    void overdraw(bool enable);
+
+    /**
+     * Is overdraw mode enabled.
+     */
+    EGT_NODISCARD bool overdraw() const { return m_overdraw; }
+
+    /**
+     * Enable or disable report mode.
+     */
+    void report(bool enable);
+
+    /**
+     * Is report mode enabled.
+     */
+    EGT_NODISCARD bool report() const { return m_report; }
+
+    /**
+     * Is any mode enabled.
+     */
+    EGT_NODISCARD bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get what was counted for each widget name.
+     */
+    EGT_NODISCARD const std::map<std::string, WidgetStats>& widgets() const
+    {
+        return m_widgets;
+    }
+
+    /**
+     * Number of frames counted.
+     */
+    EGT_NODISCARD uint64_t frames() const { return m_frames; }
+
+    /**
+     * Average number of times a pixel drawn was written.
+     */
+    EGT_NODISCARD double average_overdraw() const;
+
+    /**
+     * Most times a pixel was written in a frame.
+     */
+    EGT_NODISCARD uint32_t max_overdraw() const { return m_max_overdraw; }
+
+    /**
+     * Drop everything counted.
+     */
+    void reset();
+
+    /**
+     * Write the report, widgets with the most waste first.
+     */
+    void write_report(std::ostream& out) const;
+
+    /**
+     * Write the report to a file.
+     */
+    void write_report(const std::string& filename) const;
+
+    /**
+     * Hooks called by the library.
+     * @{
+     */
+    /// Called by Widget::damage(), so damage is blamed on the widget.
+    class DamageScope
+    {
+    public:
+        explicit DamageScope(const Widget& widget) noexcept
+        {
+            auto& diagnostics = DrawDiagnostics::instance();
+            if (egt_unlikely(diagnostics.enabled()) && !diagnostics.m_origin)
+            {
+                diagnostics.m_origin = &widget;
+                m_diagnostics = &diagnostics;
+            }
+        }
+
+        DamageScope(const DamageScope&) = delete;
+        DamageScope& operator=(const DamageScope&) = delete;
+
+        ~DamageScope() noexcept
+        {
+            if (m_diagnostics)
+                m_diagnostics->m_origin = nullptr;
+        }
+
+    private:
+        DrawDiagnostics* m_diagnostics{nullptr};
+    };
+
+    /// A widget with a screen added damage, in the coordinates of the screen.
+    void damaged(const Widget& widget, const Screen& screen, const Rect& rect);
+
+    /// A widget was laid out.
+    void laid_out(const Widget& widget);
+
+    /// A window starts drawing on its screen.
+    void begin_draw(Screen& screen);
+
+    /// A widget is drawn in the rectangle, in the coordinates of the painter.
+    void drawn(Painter& painter, const Rect& rect, const Widget& widget);
+
+    /// A window is done drawing on its screen.
+    void end_draw(Screen& screen);
+
+    /// Tint the damage with the overdraw of the surface, see overdraw().
+    void paint_overdraw(cairo_t* cr, cairo_surface_t* surface,
+                        const Screen::DamageArray& damage) const;
+
+    /// A frame ended.
+    void end_frame();
+    /** @} */
+
+private:
+
+    DrawDiagnostics();
+
+    void update_enabled();
+
+    struct DrawDiagnosticsImpl;
+    std::unique_ptr<DrawDiagnosticsImpl> m_impl;
+
+    std::atomic<bool> m_enabled{false};
+    bool m_overdraw{false};
+    bool m_report{false};
+
+    /// Widget that damage is blamed on, see DamageScope.
+    const Widget* m_origin{nullptr};
+
+    std::map<std::string, WidgetStats> m_widgets;
+    uint64_t m_frames{0};
+    uint64_t m_writes{0};
+    uint64_t m_written_pixels{0};
+    uint32_t m_max_overdraw{0};
+};
+
+}
+}
+}
+
+#endif
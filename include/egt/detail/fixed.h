@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_FIXED_H
+#define EGT_DETAIL_FIXED_H
+
+/**
+ * @file
+ * @brief Fixed point arithmetic.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <functional>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Q16.16 fixed point number.
+ *
+ * A signed 32 bit integer with 16 bits of fraction, for the animation and
+ * layout math of CPUs without a fast FPU.  Products and quotients use a 64
+ * bit intermediate, and are rounded to the nearest fraction.
+ *
+ * There is no overflow check: values must stay within +/-32767.
+ */
+class Fixed
+{
+public:
+
+    /// Number of bits of fraction.
+    static constexpr int FRACTION_BITS = 16;
+
+    /// Raw value of 1.0.
+    static constexpr int32_t ONE = 1 << FRACTION_BITS;
+
+    /// Values of animations below this, in magnitude, can be interpolated.
+    static constexpr float INTERPOLATE_RANGE = 8192.f;
+
+    constexpr Fixed() noexcept = default;
+
+    /// Create from a raw Q16.16 value.
+    static constexpr Fixed from_raw(int32_t raw) noexcept
+    {
+        Fixed result;
+        result.m_raw = raw;
+        return result;
+    }
+
+    /// Create from an integer.
+    static constexpr Fixed from_int(int32_t value) noexcept
+    {
+        return from_raw(value * ONE);
+    }
+
+    /// Create from a floating point value, rounded to the nearest fraction.
+    static constexpr Fixed from_float(float value) noexcept
+    {
+        return from_raw(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5f : 0.5f)));
+    }
+
+    /// Create from the ratio of two integers.
+    static constexpr Fixed ratio(int64_t numerator, int64_t denominator) noexcept
+    {
+        return from_raw(static_cast<int32_t>(numerator * ONE / denominator));
+    }
+
+    /// 1.0
+    static constexpr Fixed one() noexcept { return from_raw(ONE); }
+
+    /// Get the raw Q16.16 value.
+    EGT_NODISCARD constexpr int32_t raw() const noexcept { return m_raw; }
+
+    /// Convert to floating point.
+    EGT_NODISCARD constexpr float to_float() const noexcept
+    {
+        return static_cast<float>(m_raw) / ONE;
+    }
+
+    /// Convert to the nearest integer, halfway cases away from zero like std::round().
+    EGT_NODISCARD constexpr int32_t to_int() const noexcept
+    {
+        return m_raw < 0 ? -((-m_raw + ONE / 2) / ONE) : (m_raw + ONE / 2) / ONE;
+    }
+
+    constexpr Fixed operator-() const noexcept { return from_raw(-m_raw); }
+
+    constexpr Fixed& operator+=(Fixed rhs) noexcept
+    {
+        m_raw += rhs.m_raw;
+        return *this;
+    }
+
+    constexpr Fixed& operator-=(Fixed rhs) noexcept
+    {
+        m_raw -= rhs.m_raw;
+        return *this;
+    }
+
+    constexpr Fixed& operator*=(Fixed rhs) noexcept
+    {
+        const auto product = static_cast<int64_t>(m_raw) * rhs.m_raw;
+        m_raw = static_cast<int32_t>((product + (product < 0 ? -ONE / 2 : ONE / 2)) / ONE);
+        return *this;
+    }
+
+    constexpr Fixed& operator/=(Fixed rhs) noexcept
+    {
+        m_raw = static_cast<int32_t>(static_cast<int64_t>(m_raw) * ONE / rhs.m_raw);
+        return *this;
+    }
+
+private:
+    int32_t m_raw{0};
+};
+
+constexpr Fixed operator+(Fixed lhs, Fixed rhs) noexcept { return lhs += rhs; }
+constexpr Fixed operator-(Fixed lhs, Fixed rhs) noexcept { return lhs -= rhs; }
+constexpr Fixed operator*(Fixed lhs, Fixed rhs) noexcept { return lhs *= rhs; }
+constexpr Fixed operator/(Fixed lhs, Fixed rhs) noexcept { return lhs /= rhs; }
+constexpr bool operator==(Fixed lhs, Fixed rhs) noexcept { return lhs.raw() == rhs.raw(); }
+constexpr bool operator!=(Fixed lhs, Fixed rhs) noexcept { return lhs.raw() != rhs.raw(); }
+constexpr bool operator<(Fixed lhs, Fixed rhs) noexcept { return lhs.raw() < rhs.raw(); }
+constexpr bool operator>(Fixed lhs, Fixed rhs) noexcept { return lhs.raw() > rhs.raw(); }
+
+/**
+ * Percentage of an integer, without going through floating point.
+ *
+ * This truncates like the conversion of the floating point product to an
+ * integer does, without its rounding errors.
+ */
+template<class T>
+constexpr T percent_of(T value, T percent) noexcept
+{
+    return static_cast<T>(static_cast<int64_t>(value) * percent / 100);
+}
+
+/**
+ * Easing function sampled into a table of Q16.16 values.
+ *
+ * Evaluating it only takes integer operations: a lookup and a linear
+ * interpolation of the two nearest samples.
+ */
+class EGT_API FixedEasing
+{
+public:
+
+    /// Default number of samples.
+    static constexpr size_t DEFAULT_SAMPLES = 1024;
+
+    /**
+     * @param[in] func The easing function to sample.
+     * @param[in] samples Number of samples, at least 2.
+     */
+    explicit FixedEasing(const std::function<float(float)>& func,
+                         size_t samples = DEFAULT_SAMPLES);
+
+    /// Get the easing value, with the progress clamped to 0 to 1.
+    EGT_NODISCARD Fixed operator()(Fixed p) const noexcept;
+
+    /**
+     * Get the shared table of an easing function.
+     *
+     * Tables are only made for plain functions, like easing_linear(), which
+     * are always the same curve.  For anything else, like a lambda or a
+     * easing_cubic_bezier, this returns nullptr.
+     */
+    static const FixedEasing* cached(const std::function<float(float)>& func);
+
+private:
+
+    /// Samples, evenly spaced from progress 0 to 1.
+    std::vector<int32_t> m_table;
+};
+
+}
+}
+}
+
+#endif
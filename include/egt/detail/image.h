@@ -12,6 +12,7 @@
  */
 
 #include <egt/detail/meta.h>
+#include <egt/geometry.h>
 #include <egt/types.h>
 #include <string>
 
@@ -19,6 +20,8 @@ namespace egt
 {
 inline namespace v1
 {
+class ResourceStream;
+
 namespace detail
 {
 
@@ -31,10 +34,21 @@ EGT_API shared_cairo_surface_t load_image_from_memory(const unsigned char* data,
 
 /**
  * Load an image from ResourceManager.
+ *
+ * A compressed resource is decoded while it is decompressed.
+ *
  * @see ResourceManager
  */
 EGT_API shared_cairo_surface_t load_image_from_resource(const std::string& name);
 
+/**
+ * Load an image from a stream, decoding it while it is read when possible.
+ *
+ * This only uses the stream, so it can be called from any thread.
+ */
+EGT_API shared_cairo_surface_t load_image_from_stream(ResourceStream& stream,
+        const std::string& name = {});
+
 /**
  * Load an image from the filesystem.
  */
@@ -45,6 +59,62 @@ EGT_API shared_cairo_surface_t load_image_from_filesystem(const std::string& pat
  */
 EGT_API shared_cairo_surface_t load_image_from_network(const std::string& url);
 
+/**
+ * Load an image from memory, decoded straight at a smaller scale.
+ *
+ * JPEG images are decoded by libjpeg at 1/2, 1/4 or 1/8 of their size, the
+ * smallest still as large as the scale, and scaled the rest of the way.
+ * PNG images, with libpng, are decoded row by row into a surface of the
+ * scaled size, without ever holding the image at its full size.
+ *
+ * This only uses the memory, so it can be called from any thread.
+ *
+ * @param[in] data Encoded image.
+ * @param[in] len Size of the encoded image.
+ * @param[in] name Name of the image, for errors.
+ * @param[in] hscale Horizontal scale, at most 1.
+ * @param[in] vscale Vertical scale, at most 1.
+ * @return The image, the size of the image times the scale, or nullptr if
+ * the image cannot be decoded at a scale and must be decoded whole.
+ */
+EGT_API shared_cairo_surface_t load_scaled_image_from_memory(const unsigned char* data,
+        size_t len, const std::string& name,
+        float hscale, float vscale);
+
+/**
+ * Load an image from the filesystem, decoded straight at a smaller scale.
+ *
+ * @see load_scaled_image_from_memory()
+ */
+EGT_API shared_cairo_surface_t load_scaled_image_from_filesystem(const std::string& path,
+        float hscale, float vscale);
+
+/**
+ * Load an image, decoded straight at a smaller scale.
+ *
+ * Images in the filesystem and uncompressed resources can be decoded at a
+ * scale, see load_scaled_image_from_memory().
+ *
+ * @param[in] uri Resource path. @see @ref resources
+ * @param[in] hscale Horizontal scale, at most 1.
+ * @param[in] vscale Vertical scale, at most 1.
+ * @return The image, or nullptr if it must be decoded whole.
+ */
+EGT_API shared_cairo_surface_t load_scaled_image(const std::string& uri,
+        float hscale, float vscale);
+
+/**
+ * Load a region of an image.
+ *
+ * Tiled ERAW images only decode the tiles overlapping the region, and
+ * uncompressed ERAW files only read the region.  Other images are loaded
+ * whole through the image cache and copied.
+ *
+ * @param[in] uri Resource path. @see @ref resources
+ * @param[in] region Region of the image.
+ */
+EGT_API shared_cairo_surface_t load_image_region(const std::string& uri, const Rect& region);
+
 /**
   * Return the mime type string for a file.
   *
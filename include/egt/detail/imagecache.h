@@ -6,16 +6,34 @@
 #ifndef EGT_DETAIL_IMAGECACHE_H
 #define EGT_DETAIL_IMAGECACHE_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <egt/detail/lrucache.h>
 #include <egt/detail/meta.h>
+#include <egt/eventloop.h>
 #include <egt/painter.h>
+#include <egt/types.h>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace egt
 {
 inline namespace v1
 {
+namespace experimental
+{
+class HttpClientRequest;
+}
+
 namespace detail
 {
 
@@ -27,24 +45,192 @@ namespace detail
  * the image to the same scale multiple times.
  *
  * This is a trade off in consuming more memory instead of possibly
- * constantly reloading or scaling the same image.
+ * constantly reloading or scaling the same image.  The memory is bounded by
+ * max_bytes(), counting the pixels of every image, and the least recently
+ * used images are evicted first.  Images still in use are only released once
+ * no longer used.
+ *
+ * Images can also be prefetched: decoded and scaled by worker threads, and
+ * added to the cache from the event loop.
+ *
+ * Scaled resource images start from the closest variant baked at build time,
+ * if any, and are only scaled at runtime if the variant does not match.
+ * Without a variant, and without the original in the cache, JPEG and PNG
+ * images shrunk are decoded straight at their scale, see
+ * load_scaled_image().
+ *
+ * Images without transparency are stored opaque, in the pixel format of the
+ * screen, so they are drawn without blending or converting them.
+ *
+ * get() and load() can be called from any thread.  The images are split
+ * into shards by their key, each with its own lock and its part of
+ * max_bytes(), so threads looking up different images rarely wait for each
+ * other.  An image is only loaded once at a time: loads of an image being
+ * loaded, by get(), load() or prefetch(), wait for the same shared future.
+ * The rest of the cache is used from the event loop.
  */
-class EGT_API ImageCache
+class EGT_API ImageCache : private NonCopyable<ImageCache>
 {
 public:
 
     /**
-     * Get an image surface.
+     * Called by prefetch() from the event loop, with the image, or nullptr if
+     * it could not be loaded.
+     */
+    using PrefetchCallback = std::function<void(const shared_cairo_surface_t&)>;
+
+    /// Default maximum size of the images, in bytes.
+    static constexpr size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+
+    /**
+     * The maximum size defaults to the EGT_IMAGE_CACHE_SIZE environment
+     * variable if set, or DEFAULT_MAX_BYTES.
+     */
+    ImageCache();
+
+    ~ImageCache() noexcept;
+
+    /**
+     * Get an image surface, loading it if not in the cache.
+     *
+     * This can be called from any thread, see load().
+     *
+     * @throws std::runtime_error if the image cannot be loaded.
      */
     shared_cairo_surface_t get(const std::string& uri,
                                float hscale = 1.0, float vscale = 1.0,
                                bool approximate = true);
 
+    /**
+     * Get a future of an image surface.
+     *
+     * If the image is in the cache, the future is ready.  If the image is
+     * being loaded, by another thread or by prefetch(), the future is the
+     * one of that load.  Otherwise, the image is loaded on the calling
+     * thread before returning.
+     *
+     * This can be called from any thread.  Resources must not be added or
+     * removed meanwhile, and network images are downloaded on the calling
+     * thread.
+     *
+     * @param[in] uri Resource path.
+     * @param[in] hscale Horizontal scale of the image.
+     * @param[in] vscale Vertical scale of the image.
+     * @param[in] approximate Approximate the scale like get().
+     * @return The future image, which holds the error if it cannot be loaded.
+     */
+    std::shared_future<shared_cairo_surface_t> load(const std::string& uri,
+            float hscale = 1.0, float vscale = 1.0,
+            bool approximate = true);
+
+    /**
+     * Load an image surface in the background.
+     *
+     * The image is decoded and scaled by a worker thread, so the event loop
+     * is not blocked.  Once done, the image is added to the cache, and the
+     * callback is called from the event loop.  When the image is already in
+     * the cache, the callback is called right away.  Requests of the same
+     * image only load it once.
+     *
+     * Network images are downloaded by the event loop along with other
+     * downloads, without blocking it, with the HTTP cache of
+     * experimental::HttpClientRequest, unlike get().
+     *
+     * @param[in] uri Resource path.
+     * @param[in] hscale Horizontal scale of the image.
+     * @param[in] vscale Vertical scale of the image.
+     * @param[in] approximate Approximate the scale like get().
+     * @param[in] callback Called with the image.
+     * @return An id to cancel() the callback, or 0 if it already was called.
+     */
+    uint64_t prefetch(const std::string& uri,
+                      float hscale = 1.0, float vscale = 1.0,
+                      bool approximate = true,
+                      PrefetchCallback callback = nullptr);
+
+    /**
+     * Run a job on the worker threads of the event loop, like prefetch().
+     *
+     * This is for other images rendered in the background, like SVG images.
+     * The job must not use the cache, or anything else only used from the
+     * event loop.
+     *
+     * @param[in] job Called from a worker thread.
+     * @param[in] done Called from the event loop once the job is done.
+     * @return An id to cancel() the done callback.
+     */
+    uint64_t post(std::function<void()> job, std::function<void()> done);
+
+    /**
+     * Don't call the callback of a prefetch() or post().
+     *
+     * The image is still loaded and cached.
+     */
+    void cancel(uint64_t id);
+
+    /**
+     * Drop the prefetches and jobs not done yet without calling their
+     * callbacks.
+     *
+     * Called when the Application is destroyed.  The event loop then waits
+     * for the worker threads decoding an image.
+     */
+    void shutdown();
+
     /**
      * Clear the image cache.
      */
     void clear();
 
+    /**
+     * Evict the least recently used images, down to a size in bytes.
+     *
+     * Images still in use are only released once no longer used.
+     */
+    void trim(size_t bytes);
+
+    /**
+     * Set the maximum size of the images, in bytes, evicting images over it.
+     *
+     * 0 is no limit.
+     */
+    void max_bytes(size_t bytes);
+
+    /// Get the maximum size of the images, in bytes.
+    EGT_NODISCARD size_t max_bytes() const { return m_max_bytes; }
+
+    /// Get the size of the images in the cache, in bytes.
+    EGT_NODISCARD size_t bytes() const;
+
+    /// Get the number of images in the cache.
+    EGT_NODISCARD size_t size() const;
+
+    /// Get the hit, miss, and eviction counters of the cache.
+    EGT_NODISCARD CacheStats stats() const;
+
+    /**
+     * Set the pixel format of the screen, clearing the cache if changed.
+     *
+     * Opaque images are converted to PixelFormat::rgb565 when set, and are
+     * otherwise kept as 32 bpp without alpha.  Set by the Application to the
+     * format of its screen.
+     */
+    void format(PixelFormat format);
+
+    /// Get the pixel format of the screen.
+    EGT_NODISCARD PixelFormat format() const { return m_format; }
+
+    /**
+     * Convert an image without transparency to an opaque surface.
+     *
+     * @param[in] image The image surface.
+     * @param[in] format Pixel format of the screen.
+     * @return The opaque surface, or image if it has transparency or is
+     * already opaque in that format.
+     */
+    static shared_cairo_surface_t native(const shared_cairo_surface_t& image,
+                                         PixelFormat format);
+
     static shared_cairo_surface_t scale_surface(const shared_cairo_surface_t& old_surface,
             float old_width, float old_height,
             float new_width, float new_height);
@@ -53,9 +239,200 @@ protected:
 
     static float round(float v, float fraction);
 
-    static std::string id(const std::string& name, float hscale, float vscale);
+    /**
+     * Find the baked variant of a resource image to scale from.
+     *
+     * Variants are resources named after the image with the scale they were
+     * baked at, like "image_png@0.5".  The smallest variant at least as large
+     * as the requested scale is picked, because shrinking looks better than
+     * enlarging, otherwise the largest one.  The original image counts as a
+     * variant at scale 1.0.
+     *
+     * @param[in] uri Resource path.
+     * @param[in] hscale Horizontal scale of the image.
+     * @param[in] vscale Vertical scale of the image.
+     * @param[out] source Resource path of the variant, or uri.
+     * @return Scale of the variant.
+     */
+    static float baked_scale(const std::string& uri, float hscale, float vscale,
+                             std::string& source);
+
+    /// Throw if an image failed to load.
+    static void check_image(const shared_cairo_surface_t& image, const std::string& uri);
+
+    /// Scale an image relative to its size.
+    static shared_cairo_surface_t scale_image(const shared_cairo_surface_t& image,
+            float hscale, float vscale);
+
+    /// Loads an image on a worker thread.
+    using Loader = std::function<shared_cairo_surface_t()>;
+
+    /// Result of a load, shared with the threads waiting for it.
+    using Promise = std::shared_ptr<std::promise<shared_cairo_surface_t>>;
+
+    /// Images loaded on a worker thread.
+    struct Decoded
+    {
+        shared_cairo_surface_t original;
+        shared_cairo_surface_t image;
+        std::string error;
+    };
+
+    /**
+     * Load an image with load, unless back is given, and scale it, on a
+     * worker thread, then call prefetched().
+     *
+     * When the image is shrunk from its original, load_scaled, if given,
+     * first tries to decode it straight at the scale, and the original is
+     * then not cached.
+     */
+    void decode(const std::string& uri, const std::string& source,
+                float hscale, float vscale, float scale,
+                const Promise& promise,
+                const shared_cairo_surface_t& back, Loader load,
+                Loader load_scaled = nullptr);
+
+    /**
+     * Download a network image without blocking the event loop, along with
+     * other downloads, then decode() it.
+     */
+    void download(const std::string& uri, const std::string& url,
+                  float hscale, float vscale, const Promise& promise);
+
+    /// Wait on a worker thread for an image loaded by another thread, then call prefetched().
+    void wait(const std::string& uri, float hscale, float vscale,
+              const std::shared_future<shared_cairo_surface_t>& future);
+
+    /// Load an image not in the cache, on the calling thread.
+    shared_cairo_surface_t load_now(const std::string& uri, float hscale, float vscale);
+
+    /**
+     * Register the load of an image, unless it is already being loaded or
+     * is in the cache.
+     *
+     * @param[in,out] future The future of the load, replaced by the one of
+     *                the image if already being loaded or in the cache.
+     * @return true if the caller loads the image, then calls loaded().
+     */
+    bool loading(const std::string& uri, float hscale, float vscale,
+                 std::shared_future<shared_cairo_surface_t>& future);
+
+    /// Unregister the load of an image, once in the cache.
+    void loaded(const std::string& uri, float hscale, float vscale);
+
+    /// Destroy a download once done.
+    void finished(experimental::HttpClientRequest* request);
+
+    /// Add the images loaded by a prefetch() and call its callbacks.
+    void prefetched(const std::string& uri, const std::string& source,
+                    float hscale, float vscale,
+                    const shared_cairo_surface_t& original,
+                    const shared_cairo_surface_t& image,
+                    const std::string& error);
+
+    /// Hash of an image uri at a scale.
+    static size_t hash(std::string_view uri, float hscale, float vscale) noexcept;
+
+    /// Key of an image: its uri at a scale.
+    struct Key
+    {
+        Key(std::string u, float h, float v)
+            : uri(std::move(u)),
+              hscale(h),
+              vscale(v),
+              hash(ImageCache::hash(uri, h, v))
+        {}
+
+        std::string uri;
+        float hscale;
+        float vscale;
+        size_t hash;
+    };
+
+    /// View of a Key, so finding an image does not allocate a Key.
+    struct KeyView
+    {
+        KeyView(std::string_view u, float h, float v) noexcept
+            : uri(u),
+              hscale(h),
+              vscale(v),
+              hash(ImageCache::hash(u, h, v))
+        {}
+
+        explicit KeyView(const Key& key) noexcept
+            : uri(key.uri),
+              hscale(key.hscale),
+              vscale(key.vscale),
+              hash(key.hash)
+        {}
+
+        bool operator==(const KeyView& rhs) const noexcept
+        {
+            // scales are rounded, or taken as they are, so exactly the same
+            return hash == rhs.hash &&
+                   hscale == rhs.hscale &&
+                   vscale == rhs.vscale &&
+                   uri == rhs.uri;
+        }
+
+        std::string_view uri;
+        float hscale;
+        float vscale;
+        size_t hash;
+    };
+
+    /// The hash of a KeyView is computed along with it.
+    struct KeyHash
+    {
+        size_t operator()(const KeyView& key) const noexcept
+        {
+            return key.hash;
+        }
+    };
+
+    /// Find an image in the cache, from any thread.
+    bool find(const KeyView& key, shared_cairo_surface_t& image);
+
+    /// Insert an image in the cache, from any thread.
+    void insert(Key key, const shared_cairo_surface_t& image);
+
+    /// Number of shards of the cache.
+    static constexpr size_t SHARDS = 8;
+
+    /// Images of the keys with the same hash modulo SHARDS.
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        LruCache<Key, shared_cairo_surface_t, HashedIndex<Key, KeyView, KeyHash>> cache;
+    };
+
+    std::array<Shard, SHARDS> m_shards;
+
+    /// Maximum size of the images.
+    size_t m_max_bytes{0};
+
+    /// Loads in progress, by uri and scale.
+    std::map<std::tuple<std::string, float, float>,
+        std::shared_future<shared_cairo_surface_t>> m_loading;
+
+    /// Protects m_loading.
+    std::mutex m_loading_mutex;
+
+    /// Callbacks of the prefetches not done yet, by uri and scale.
+    std::map<std::tuple<std::string, float, float>,
+        std::vector<std::pair<uint64_t, PrefetchCallback>>> m_prefetches;
+
+    /// Jobs of post() not done yet, by id.
+    std::map<uint64_t, EventLoop::WorkHandle> m_jobs;
+
+    /// Id of the last prefetch() or post() callback.
+    uint64_t m_prefetch_id{0};
+
+    /// Network images being downloaded by prefetch().
+    std::vector<std::shared_ptr<experimental::HttpClientRequest>> m_downloads;
 
-    std::map<std::string, shared_cairo_surface_t> m_cache;
+    /// Pixel format of the screen.
+    std::atomic<PixelFormat> m_format{PixelFormat::argb8888};
 };
 
 /**
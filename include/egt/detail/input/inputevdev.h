@@ -11,9 +11,11 @@
  * @brief Working with input devices.
  */
 
+#include <chrono>
 #include <egt/asio.hpp>
 #include <egt/detail/meta.h>
 #include <egt/input.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -26,6 +28,7 @@ class Application;
 namespace detail
 {
 class InputKeyboard;
+class InputThread;
 
 /**
  * Handles reading input events from evdev devices.
@@ -44,6 +47,15 @@ public:
 private:
     void handle_read(const asio::error_code& error, std::size_t length);
 
+    /// Read the device, in the input thread.
+    bool read_device();
+
+    /// Turn the events read in the input buffer into events to dispatch.
+    void process(std::size_t length);
+
+    /// Dispatch an event, or queue it when read in the input thread.
+    void report(Event& event);
+
     /**
      * Input handler to read from the evdev fd.
      */
@@ -68,6 +80,21 @@ private:
      * Internal descriptor;
      */
     int m_fd{-1};
+
+    /**
+     * Event times are from CLOCK_MONOTONIC.
+     */
+    bool m_monotonic{false};
+
+    /**
+     * Time of the event being processed.
+     */
+    std::chrono::steady_clock::time_point m_time{};
+
+    /**
+     * Thread reading the device, if enabled.
+     */
+    std::unique_ptr<InputThread> m_thread;
 };
 
 }
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_INPUT_INPUTREPLAY_H
+#define EGT_DETAIL_INPUT_INPUTREPLAY_H
+
+/**
+ * @file
+ * @brief Recording and replaying input events.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <egt/input.h>
+#include <egt/signal.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Application;
+
+namespace detail
+{
+
+/**
+ * Records the events of every Input to a file, to be replayed by InputReplay.
+ *
+ * Events are captured as the backends dispatch them, before the screen
+ * rotates them and before motion is coalesced, with the time they were
+ * reported.  The file is a short header followed by a fixed size record per
+ * event, in the byte order of the target.
+ *
+ * While several recorders may exist, only the last one created records.
+ *
+ * This is enabled at startup with the EGT_INPUT_RECORD environment variable.
+ */
+class EGT_API InputRecorder
+{
+public:
+
+    /**
+     * @param[in] path File to record to, replaced if it exists.
+     * @throws std::runtime_error if unable to create the file.
+     */
+    explicit InputRecorder(const std::string& path);
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+    InputRecorder(InputRecorder&&) = delete;
+    InputRecorder& operator=(InputRecorder&&) = delete;
+
+    /// Number of events recorded.
+    EGT_NODISCARD size_t count() const { return m_count; }
+
+    /// Write the recorded events to the file.
+    void flush();
+
+    /**
+     * Record an event to the active recorder, if any.
+     *
+     * Called by Input::dispatch() for every event.
+     *
+     * @param[in] event The event, as reported by the backend.
+     * @param[in] when When the backend reported the event.
+     */
+    static void capture(const Event& event, std::chrono::steady_clock::time_point when);
+
+    ~InputRecorder() noexcept;
+
+private:
+
+    /// Output file.
+    std::ofstream m_out;
+
+    /// Time of the first event recorded.
+    std::chrono::steady_clock::time_point m_start{};
+
+    /// Number of events recorded.
+    size_t m_count{0};
+
+    /// Recorder that captures events.
+    static InputRecorder* m_active;
+
+    /// Recorder active before this one.
+    InputRecorder* m_previous{nullptr};
+};
+
+/**
+ * Replays the events recorded by InputRecorder.
+ *
+ * The events are dispatched like those of any other Input, at the recorded
+ * pace or faster, and the profiler is enabled meanwhile to collect the frame
+ * times of the run.  Running the same recording on different builds gives
+ * comparable Stats.
+ *
+ * This is enabled at startup with the EGT_INPUT_REPLAY environment variable.
+ */
+class EGT_API InputReplay : public Input
+{
+public:
+
+    /**
+     * Measurements of a replay.
+     */
+    struct Stats
+    {
+        /// Number of events dispatched.
+        size_t events{0};
+        /// Number of frames drawn.
+        size_t frames{0};
+        /// Wall time of the replay.
+        std::chrono::nanoseconds duration{};
+        /// Mean frame time.
+        std::chrono::nanoseconds mean_frame{};
+        /// 95th percentile of the frame time.
+        std::chrono::nanoseconds p95_frame{};
+        /// Longest frame time.
+        std::chrono::nanoseconds max_frame{};
+        /// Processor time used by the process.
+        std::chrono::nanoseconds cpu{};
+        /// Peak resident memory of the process, in kB, or 0 if unknown.
+        uint64_t max_rss{0};
+    };
+
+    /**
+     * @param[in] app Application instance.
+     * @param[in] path File recorded by InputRecorder.
+     * @throws std::runtime_error if unable to read the file.
+     */
+    InputReplay(Application& app, const std::string& path);
+
+    /**
+     * Set the speed of the replay.
+     *
+     * @param[in] value 1 for the recorded pace, 2 for twice as fast, and so
+     *            on.  Must be positive.
+     */
+    void speed(float value);
+
+    /// Get the speed of the replay.
+    EGT_NODISCARD float speed() const { return m_speed; }
+
+    /**
+     * Start the replay from the first event.
+     *
+     * This may be called before the event loop runs, as the replay starts
+     * once it does.
+     */
+    void start();
+
+    /// Stop the replay, without invoking on_finished.
+    void stop();
+
+    /// Returns true while replaying.
+    EGT_NODISCARD bool running() const { return m_running; }
+
+    /// Number of events in the recording.
+    EGT_NODISCARD size_t count() const { return m_records.size(); }
+
+    /**
+     * Get the measurements of the last replay.
+     *
+     * Only valid once on_finished has been invoked.
+     */
+    EGT_NODISCARD const Stats& stats() const { return m_stats; }
+
+    /**
+     * Invoked when the replay finished, shortly after the last event so the
+     * frame it caused is part of the stats().
+     */
+    Signal<> on_finished;
+
+    ~InputReplay() noexcept override;
+
+    /// @private
+    struct Record
+    {
+        uint64_t time;
+        uint32_t id;
+        int32_t a;
+        int32_t b;
+        uint32_t c;
+    };
+
+private:
+
+    /// Dispatch the events that are due, and wait for the next one.
+    void next();
+
+    /// Wait until a time to dispatch the next events.
+    void wait(std::chrono::steady_clock::time_point when);
+
+    /// Timer handler.
+    void handle_timer(const asio::error_code& error);
+
+    /// Collect the stats and invoke on_finished.
+    void finish();
+
+    /// Time a recorded event is due.
+    std::chrono::steady_clock::time_point due(const Record& record) const;
+
+    /// Recorded events.
+    std::vector<Record> m_records;
+
+    /// Index of the next event to dispatch.
+    size_t m_next{0};
+
+    /// Replay speed.
+    float m_speed{1.f};
+
+    /// Is the replay running.
+    bool m_running{false};
+
+    /// Did the replay enable the profiler.
+    bool m_profiler{false};
+
+    /// When the replay started.
+    std::chrono::steady_clock::time_point m_start{};
+
+    /// Processor time at the start of the replay.
+    std::chrono::nanoseconds m_cpu_start{};
+
+    /// Timer waiting for the next event.
+    asio::steady_timer m_timer;
+
+    /// Measurements of the last replay.
+    Stats m_stats;
+};
+
+}
+}
+}
+
+#endif
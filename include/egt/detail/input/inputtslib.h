@@ -25,6 +25,7 @@ class Application;
 
 namespace detail
 {
+class InputThread;
 struct tslibimpl;
 
 /**
@@ -45,6 +46,12 @@ private:
 
     void handle_read(const asio::error_code& error);
 
+    /// Read the pending samples, in the event loop or the input thread.
+    void read_device();
+
+    /// Dispatch an event, or queue it when read in the input thread.
+    void report(Event& event);
+
     /**
      * Input handler to read from the evdev fd.
      */
@@ -64,6 +71,11 @@ private:
      * The last point seen, used for reference internally.
      */
     std::array<DisplayPoint, 2> m_last_point;
+
+    /**
+     * Thread reading the device, if enabled.
+     */
+    std::unique_ptr<InputThread> m_thread;
 };
 
 }
@@ -9,6 +9,7 @@
 #include <egt/detail/meta.h>
 #include <egt/geometry.h>
 #include <egt/widgetflags.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -107,6 +108,52 @@ EGT_API void flex_layout(const Rect& parent,
                          Orientation orient,
                          const AlignFlags& align);
 
+/**
+ * Flex layout that keeps its layout context between runs.
+ *
+ * flex_layout() builds a new layout context, and inserts every child in it,
+ * on each call.  This keeps the context, and its items, and only updates
+ * the sizes, margins, and behavior of children that changed since the last
+ * run.  When nothing changed at all, the previous result is returned
+ * without running the layout.
+ *
+ * The context is only rebuilt when the number of children changes.
+ */
+class EGT_API FlexLayout
+{
+public:
+
+    FlexLayout();
+    FlexLayout(const FlexLayout&) = delete;
+    FlexLayout& operator=(const FlexLayout&) = delete;
+    FlexLayout(FlexLayout&&) noexcept;
+    FlexLayout& operator=(FlexLayout&&) noexcept;
+    ~FlexLayout() noexcept;
+
+    /**
+     * Perform a flex layout, same as flex_layout().
+     */
+    void run(const Rect& parent,
+             std::vector<LayoutRect>& children,
+             Justification justify,
+             Orientation orient);
+
+    /**
+     * Number of runs that had to rebuild the layout context.
+     */
+    EGT_NODISCARD size_t rebuilds() const;
+
+    /**
+     * Number of runs that were skipped because nothing changed.
+     */
+    EGT_NODISCARD size_t skips() const;
+
+private:
+
+    struct FlexLayoutImpl;
+    std::unique_ptr<FlexLayoutImpl> m_impl;
+};
+
 /**
  * Compute lib lay contains from @justify and @orient parameters.
  */
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_LRUCACHE_H
+#define EGT_DETAIL_LRUCACHE_H
+
+/**
+ * @file
+ * @brief Bounded cache evicting the least recently used entries.
+ */
+
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Counters of a cache.
+ */
+struct CacheStats
+{
+    /// Lookups that found an entry.
+    size_t hits{0};
+    /// Lookups that found no entry.
+    size_t misses{0};
+    /// Entries evicted to stay within the limits.
+    size_t evictions{0};
+};
+
+/**
+ * Index of an LruCache ordered by its keys.
+ */
+template<class Key, class Compare = std::less<Key>>
+struct OrderedIndex
+{
+    /// Type looked up in the index.
+    using lookup_type = Key;
+
+    /// Map from lookup_type to T.
+    template<class T>
+    using map = std::map<Key, T, Compare>;
+
+    /// Get the lookup_type of a key.
+    static const Key& lookup(const Key& key) { return key; }
+};
+
+/**
+ * Index of an LruCache hashed by its keys.
+ *
+ * The lookup_type may be a view of the key, like a std::string_view of a
+ * std::string, so that looking up an entry does not need to allocate a key.
+ * A view in the index refers to the key of its entry.
+ */
+template<class Key, class LookupType = Key,
+         class Hash = std::hash<LookupType>, class Equal = std::equal_to<LookupType>>
+struct HashedIndex
+{
+    /// Type looked up in the index.
+    using lookup_type = LookupType;
+
+    /// Map from lookup_type to T.
+    template<class T>
+    using map = std::unordered_map<LookupType, T, Hash, Equal>;
+
+    /// Get the lookup_type of a key.
+    static LookupType lookup(const Key& key) { return LookupType(key); }
+};
+
+/**
+ * Cache of a bounded number of entries and cost, evicting the least recently
+ * used entries first.
+ *
+ * Every entry has a cost, like its size in bytes, and the cache evicts entries
+ * when the total cost or the number of entries is over its limits.  A limit of
+ * 0 is no limit.  The most recently inserted entry is never evicted, even when
+ * over the limits on its own.
+ *
+ * Entries are iterated from the most recently used one.  This is not thread
+ * safe.
+ *
+ * Entries are found through an Index, OrderedIndex by default, or HashedIndex.
+ */
+template<class Key, class Value, class Index = OrderedIndex<Key>>
+class LruCache
+{
+public:
+
+    /// Type used to look up entries.
+    using lookup_type = typename Index::lookup_type;
+
+    /// An entry of the cache.
+    struct Entry
+    {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    using const_iterator = typename std::list<Entry>::const_iterator;
+
+    /**
+     * @param[in] max_cost Maximum total cost of the entries.
+     * @param[in] max_entries Maximum number of entries.
+     */
+    explicit LruCache(size_t max_cost = 0, size_t max_entries = 0) noexcept
+        : m_max_cost(max_cost),
+          m_max_entries(max_entries)
+    {}
+
+    /**
+     * Find an entry, and make it the most recently used one.
+     *
+     * @return nullptr when there is no entry for the key.
+     */
+    Value* find(const lookup_type& key)
+    {
+        auto i = m_index.find(key);
+        if (i == m_index.end())
+        {
+            ++m_stats.misses;
+            return nullptr;
+        }
+
+        ++m_stats.hits;
+        m_entries.splice(m_entries.begin(), m_entries, i->second);
+        return &i->second->value;
+    }
+
+    /**
+     * Insert or replace an entry, and evict entries over the limits.
+     *
+     * @return The entry in the cache.
+     */
+    Value& insert(Key key, Value value, size_t cost = 0)
+    {
+        erase(Index::lookup(key));
+
+        m_entries.push_front(Entry{std::move(key), std::move(value), cost});
+        m_index.emplace(Index::lookup(m_entries.front().key), m_entries.begin());
+        m_cost += cost;
+
+        evict();
+
+        return m_entries.front().value;
+    }
+
+    /// Remove an entry.
+    void erase(const lookup_type& key)
+    {
+        auto i = m_index.find(key);
+        if (i == m_index.end())
+            return;
+
+        // the index may refer to the key of the entry
+        auto entry = i->second;
+        m_index.erase(i);
+        m_cost -= entry->cost;
+        m_entries.erase(entry);
+    }
+
+    /// Remove all entries.  This is not counted as evictions.
+    void clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+        m_cost = 0;
+    }
+
+    /**
+     * Evict the least recently used entries until the total cost is at most
+     * @b cost, like when memory runs low.  Unlike the limits, this may evict
+     * all entries.
+     */
+    void trim(size_t cost)
+    {
+        while (m_cost > cost && evict_last())
+        {}
+    }
+
+    /// Evict the least recently used entry, returns false if there is none.
+    bool evict_last()
+    {
+        if (m_entries.empty())
+            return false;
+
+        auto& last = m_entries.back();
+        m_cost -= last.cost;
+        m_index.erase(Index::lookup(last.key));
+        m_entries.pop_back();
+        ++m_stats.evictions;
+        return true;
+    }
+
+    /// Set the maximum total cost of the entries, evicting entries over it.
+    void max_cost(size_t max)
+    {
+        m_max_cost = max;
+        evict();
+    }
+
+    /// Get the maximum total cost of the entries.
+    EGT_NODISCARD size_t max_cost() const { return m_max_cost; }
+
+    /// Set the maximum number of entries, evicting entries over it.
+    void max_entries(size_t max)
+    {
+        m_max_entries = max;
+        evict();
+    }
+
+    /// Get the maximum number of entries.
+    EGT_NODISCARD size_t max_entries() const { return m_max_entries; }
+
+    /// Get the total cost of the entries.
+    EGT_NODISCARD size_t cost() const { return m_cost; }
+
+    /// Get the number of entries.
+    EGT_NODISCARD size_t size() const { return m_entries.size(); }
+
+    /// Is the cache empty.
+    EGT_NODISCARD bool empty() const { return m_entries.empty(); }
+
+    /// Get the counters of the cache.
+    EGT_NODISCARD const CacheStats& stats() const { return m_stats; }
+
+    /// Reset the counters of the cache.
+    void reset_stats() { m_stats = {}; }
+
+    /// Iterator to the most recently used entry.
+    EGT_NODISCARD const_iterator begin() const { return m_entries.begin(); }
+
+    /// Iterator past the least recently used entry.
+    EGT_NODISCARD const_iterator end() const { return m_entries.end(); }
+
+protected:
+
+    /// Evict the least recently used entries while over the limits.
+    void evict()
+    {
+        while (m_entries.size() > 1 &&
+               ((m_max_cost && m_cost > m_max_cost) ||
+                (m_max_entries && m_entries.size() > m_max_entries)))
+            evict_last();
+    }
+
+    /// Entries, from the most recently used one.
+    std::list<Entry> m_entries;
+
+    /// Entries by key.
+    typename Index::template map<typename std::list<Entry>::iterator> m_index;
+
+    size_t m_max_cost;
+    size_t m_max_entries;
+    size_t m_cost{0};
+    CacheStats m_stats;
+};
+
+}
+}
+}
+
+#endif
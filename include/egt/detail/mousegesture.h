@@ -11,12 +11,13 @@
  * @brief Mouse gesture support.
  */
 
+#include <array>
 #include <chrono>
 #include <egt/detail/meta.h>
 #include <egt/event.h>
 #include <egt/geometry.h>
-#include <egt/timer.h>
-#include <string>
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace egt
@@ -26,6 +27,8 @@ inline namespace v1
 namespace detail
 {
 
+class TimerNode;
+
 /**
  * Basic class for interpreting mouse events.
  *
@@ -33,12 +36,28 @@ namespace detail
  * The premise behind this class is to interpret raw mouse events and turn them
  * into higher level meaning.  Because some of those events can be asynchronous,
  * all events are generated through callbacks registered with on_async_event().
+ *
+ * Long clicks are derived from the time the pointer went down, not from when
+ * its event was handled, and wait on the timer wheel of the event loop rather
+ * than on a timer of their own.  The velocity of the pointer is estimated from
+ * the time of its recent moves, and given with EventId::pointer_drag_stop for
+ * kinetic scrolling.
  */
 class EGT_API MouseGesture
 {
 public:
 
-    MouseGesture() noexcept;
+    /// Type of the time of events.
+    using Clock = std::chrono::steady_clock;
+
+    /// Time from the pointer going down to the first EventId::pointer_hold,
+    /// and between the following ones.
+    static constexpr std::chrono::milliseconds LONG_CLICK{500};
+
+    MouseGesture();
+    MouseGesture(const MouseGesture&) = delete;
+    MouseGesture& operator=(const MouseGesture&) = delete;
+    ~MouseGesture() noexcept;
 
     /// Type for mouse event callback.
     using MouseCallback = std::function<void(Event& event)>;
@@ -51,12 +70,47 @@ public:
     /**
      * Pass the raw EventId to this function to get the emulated mouse event.
      */
-    Event handle(const Event& event);
+    Event handle(const Event& event)
+    {
+        return handle(event, Clock::now());
+    }
+
+    /**
+     * Pass the raw EventId to this function to get the emulated mouse event.
+     *
+     * @param[in] event The raw event.
+     * @param[in] when When the input device reported the event.
+     */
+    Event handle(const Event& event, Clock::time_point when);
 
     /**
      * Start.
      */
-    void start(const DisplayPoint& point);
+    void start(const DisplayPoint& point)
+    {
+        start(point, Clock::now());
+    }
+
+    /**
+     * Start.
+     *
+     * @param[in] point Where the pointer went down.
+     * @param[in] when When the pointer went down.
+     */
+    void start(const DisplayPoint& point, Clock::time_point when);
+
+    /**
+     * Get the velocity of the pointer, in pixels per second.
+     *
+     * This is the average of the moves in the last VELOCITY_WINDOW before
+     * now, or zero if the pointer did not move in that time.
+     *
+     * @param[in] now Time at which the velocity is estimated.
+     */
+    EGT_NODISCARD PointF velocity(Clock::time_point now) const;
+
+    /// Only moves this recent are used for the velocity.
+    static constexpr std::chrono::milliseconds VELOCITY_WINDOW{100};
 
     /// Get pointer start position.
     EGT_NODISCARD const DisplayPoint& mouse_start() const
@@ -96,6 +150,15 @@ protected:
     /// Invoke an event on each of the handlers.
     void invoke_handlers(Event& event);
 
+    /// Called when the long click deadline is reached.
+    void hold();
+
+    /// Stop waiting for a long click.
+    void cancel_hold();
+
+    /// Add a point to the recent moves.
+    void add_sample(const DisplayPoint& point, Clock::time_point when);
+
     /// Currently processing subsequent events.
     bool m_active{false};
 
@@ -114,8 +177,27 @@ protected:
     /// Registered callback functions.
     CallbackArray m_callbacks;
 
-    /// Async timer for detecting long clicks.
-    PeriodicTimer m_long_click_timer;
+    /// Long click deadline, scheduled on the timer wheel of the event loop.
+    std::unique_ptr<TimerNode> m_hold_timer;
+
+    /// When the next EventId::pointer_hold is due.
+    Clock::time_point m_hold_deadline;
+
+    /// A recent move of the pointer.
+    struct Sample
+    {
+        DisplayPoint point;
+        Clock::time_point when;
+    };
+
+    /// Recent moves of the pointer, oldest overwritten first.
+    std::array<Sample, 8> m_samples{};
+
+    /// Next sample written.
+    size_t m_sample_next{0};
+
+    /// Number of valid samples.
+    size_t m_sample_count{0};
 
     /// Cursor distance to enable the drag mode.
     static DefaultDim m_drag_enable_distance;
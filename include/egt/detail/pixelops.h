@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_PIXELOPS_H
+#define EGT_DETAIL_PIXELOPS_H
+
+/**
+ * @file
+ * @brief Software pixel copy, conversion, and blending kernels, and other
+ * kernels with a NEON version.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Copy a rectangle of pixels between two buffers of the same format.
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[out] dst First pixel of the destination rectangle.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] bytes Bytes to copy for each row.
+ * @param[in] height Number of rows.
+ */
+EGT_API void copy_rect(const uint8_t* src, size_t src_stride,
+                       uint8_t* dst, size_t dst_stride,
+                       size_t bytes, size_t height);
+
+/**
+ * Fill a rectangle of pixels with a value.
+ *
+ * On ARM, rows are written with arm_memset16() or arm_memset32().
+ *
+ * @param[out] dst First pixel of the rectangle.
+ * @param[in] dst_stride Bytes between two rows.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ * @param[in] bpp Bytes per pixel: 2 or 4.
+ * @param[in] value Pixel value, in the format of the buffer.
+ */
+EGT_API void fill_rect(uint8_t* dst, size_t dst_stride,
+                       size_t width, size_t height,
+                       size_t bpp, uint32_t value);
+
+/**
+ * Copy a rectangle of pixels between two buffers of the same format, rotated
+ * clockwise.
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[out] dst First pixel of the destination rectangle, which is height
+ *            pixels wide and width pixels high when rotated by 90 or 270
+ *            degrees.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] width Number of pixels in each source row.
+ * @param[in] height Number of source rows.
+ * @param[in] bpp Bytes per pixel: 1, 2 or 4.
+ * @param[in] degrees Rotation: 0, 90, 180 or 270.
+ */
+EGT_API void rotate_rect(const uint8_t* src, size_t src_stride,
+                         uint8_t* dst, size_t dst_stride,
+                         size_t width, size_t height,
+                         size_t bpp, uint32_t degrees);
+
+/**
+ * Convert a rectangle of ARGB8888 pixels to RGB565.
+ *
+ * The alpha channel is ignored.
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[out] dst First pixel of the destination rectangle.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ */
+EGT_API void argb8888_to_rgb565(const uint32_t* src, size_t src_stride,
+                                uint16_t* dst, size_t dst_stride,
+                                size_t width, size_t height);
+
+/**
+ * Convert a rectangle of ARGB8888 pixels to 8-bit luminance.
+ *
+ * The alpha channel is ignored.
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[out] dst First pixel of the destination rectangle.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ */
+EGT_API void argb8888_to_l8(const uint32_t* src, size_t src_stride,
+                            uint8_t* dst, size_t dst_stride,
+                            size_t width, size_t height);
+
+/**
+ * Convert a rectangle of ARGB8888 pixels to RGB332.
+ *
+ * The alpha channel is ignored.  With dither, a 4x4 ordered dither hides
+ * the banding of the 3 and 2 bit channels.  The pattern is anchored at the
+ * position of the rectangle in the frame, so converting a frame in several
+ * rectangles gives the same pixels as converting it at once.
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[out] dst First pixel of the destination rectangle.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ * @param[in] x Horizontal position of the rectangle in the frame.
+ * @param[in] y Vertical position of the rectangle in the frame.
+ * @param[in] dither Apply ordered dithering.
+ */
+EGT_API void argb8888_to_rgb332(const uint32_t* src, size_t src_stride,
+                                uint8_t* dst, size_t dst_stride,
+                                size_t width, size_t height,
+                                size_t x, size_t y, bool dither);
+
+/**
+ * ARGB8888 colors of the 256 RGB332 values, to load in the color lookup
+ * table of a display showing PixelFormat::c8.
+ */
+EGT_API const uint32_t* rgb332_palette();
+
+/**
+ * Blend a rectangle of premultiplied ARGB8888 pixels over another one.
+ *
+ * This is the cairo OVER operator: dst = src + dst * (1 - src alpha).
+ *
+ * @param[in] src First pixel of the source rectangle.
+ * @param[in] src_stride Bytes between two source rows.
+ * @param[in,out] dst First pixel of the destination rectangle.
+ * @param[in] dst_stride Bytes between two destination rows.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ */
+EGT_API void blend_over(const uint32_t* src, size_t src_stride,
+                        uint32_t* dst, size_t dst_stride,
+                        size_t width, size_t height);
+
+/**
+ * Blur a rectangle of premultiplied ARGB8888 pixels with a box filter.
+ *
+ * A horizontal and a vertical pass average each pixel with the radius
+ * pixels on each side of it.  Pixels past the edges repeat the ones on the
+ * edges, so the edges do not darken.
+ *
+ * @param[in,out] data First pixel of the rectangle.
+ * @param[in] stride Bytes between two rows, a multiple of 4.
+ * @param[in] width Number of pixels in each row.
+ * @param[in] height Number of rows.
+ * @param[in] radius Pixels on each side of a pixel averaged with it.
+ */
+EGT_API void box_blur(uint32_t* data, size_t stride,
+                      size_t width, size_t height, size_t radius);
+
+/**
+ * Sample a table at many positions, with linear interpolation.
+ *
+ * The table holds samples evenly spaced from position 0 to 1.  Positions
+ * are clamped to that range, and NaN is sampled at 0.
+ *
+ * @param[in] table The samples.
+ * @param[in] size Number of samples, at least 2.
+ * @param[in] positions Positions to sample at.
+ * @param[out] out The sampled values.
+ * @param[in] count Number of positions.
+ */
+EGT_API void sample_table(const float* table, size_t size,
+                          const float* positions, float* out, size_t count);
+
+/**
+ * Look up the nearest entry of a table of pixels for many positions.
+ *
+ * The table holds pixels evenly spaced from position 0 to 1.  Positions
+ * are clamped to that range, and NaN looks up position 0.
+ *
+ * @param[in] table The pixels.
+ * @param[in] size Number of pixels, at least 2.
+ * @param[in] positions Positions to look up.
+ * @param[out] out The pixels looked up.
+ * @param[in] count Number of positions.
+ */
+EGT_API void lut_lookup(const uint32_t* table, size_t size,
+                        const float* positions, uint32_t* out, size_t count);
+
+/**
+ * Mix two arrays of ARGB8888 pixels, channel by channel.
+ *
+ * Each channel is a + (b - a) * weight / 256, like Color::interp_rgba().
+ *
+ * @param[in] a The pixels at weight 0.
+ * @param[in] b The pixels at weight 256.
+ * @param[out] out The mixed pixels, which may be a or b.
+ * @param[in] count Number of pixels.
+ * @param[in] weight Weight of b, from 0 to 256.
+ */
+EGT_API void mix_argb8888(const uint32_t* a, const uint32_t* b,
+                          uint32_t* out, size_t count, uint32_t weight);
+
+/**
+ * Rectangles stored as arrays of their edges, see RectBatch.
+ *
+ * The right and bottom edges are exclusive, like Rect::right() and
+ * Rect::bottom().
+ */
+struct RectEdges
+{
+    const int32_t* left;
+    const int32_t* top;
+    const int32_t* right;
+    const int32_t* bottom;
+    size_t count;
+};
+
+/**
+ * Test which rectangles overlap a rectangle, like Rect::intersect().
+ *
+ * @param[in] rects The rectangles.
+ * @param[in] left Left edge of the rectangle to test.
+ * @param[in] top Top edge of the rectangle to test.
+ * @param[in] right Right edge of the rectangle to test.
+ * @param[in] bottom Bottom edge of the rectangle to test.
+ * @param[out] mask 1 for each rectangle that overlaps, 0 otherwise.
+ * @return Number of rectangles that overlap.
+ */
+EGT_API size_t rects_intersect(const RectEdges& rects,
+                               int32_t left, int32_t top,
+                               int32_t right, int32_t bottom,
+                               uint8_t* mask);
+
+/**
+ * Get the edges of the rectangle containing all rectangles, like merging
+ * them with Rect::merge().
+ *
+ * @param[in] rects The rectangles.
+ * @param[out] bounds Left, top, right, and bottom edges, all 0 if there is
+ *             no rectangle.
+ */
+EGT_API void rects_bounds(const RectEdges& rects, int32_t* bounds);
+
+/**
+ * Find the last rectangle containing a point, like Rect::intersect() with a
+ * point, so edges included.
+ *
+ * @param[in] rects The rectangles.
+ * @param[in] x X coordinate of the point.
+ * @param[in] y Y coordinate of the point.
+ * @return Index of the rectangle, or rects.count if none contains the point.
+ */
+EGT_API size_t rects_last_hit(const RectEdges& rects, int32_t x, int32_t y);
+
+/**
+ * Get the number of leading ASCII bytes of a buffer, so bytes below 0x80.
+ *
+ * Most text is pure ASCII, which has one code point per byte, so this lets
+ * UTF-8 text skip decoding.
+ *
+ * @param[in] data The bytes.
+ * @param[in] size Number of bytes.
+ * @return Index of the first byte that is not ASCII, or size.
+ */
+EGT_API size_t ascii_length(const char* data, size_t size);
+
+/**
+ * Returns true if the NEON kernels are in use.
+ *
+ * The NEON kernels are used by default when the library was built for ARM
+ * and the CPU reports NEON support at runtime.
+ */
+EGT_API bool pixelops_neon();
+
+/**
+ * Select between the NEON and the generic kernels.
+ *
+ * @param[in] enable Use the NEON kernels if they are available.
+ * @return true if the NEON kernels are in use after the call.
+ */
+EGT_API bool pixelops_neon(bool enable);
+
+}
+}
+}
+
+#endif
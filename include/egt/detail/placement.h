@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_PLACEMENT_H
+#define EGT_DETAIL_PLACEMENT_H
+
+/**
+ * @file
+ * @brief Memory the pixels of surfaces are placed in.
+ */
+
+#include <cairo.h>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/types.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Memory the pixels of an image surface are placed in.
+ *
+ * Drawing with cairo reads back the pixels it blends with, so surfaces drawn
+ * on belong in cached memory.  The screen buffers scanned out by the display
+ * controller are allocated by the driver, usually write-combined, which is
+ * fine to copy frames to and slow to read back.
+ */
+enum class Placement
+{
+    /// Huge pages for buffers of at least HUGEPAGE_THRESHOLD bytes, the heap otherwise.
+    automatic,
+    /// Cached memory from the heap.
+    cached,
+    /// Cached memory in huge pages, fewer TLB misses for large buffers.
+    hugepage,
+    /// Physically contiguous memory from the CMA dma-buf heap.
+    cma,
+};
+
+/// Smallest buffer placed in huge pages by Placement::automatic, in bytes.
+constexpr size_t HUGEPAGE_THRESHOLD = 2 * 1024 * 1024;
+
+/**
+ * Create an image surface with its pixels in the given memory, cleared.
+ *
+ * When the memory is not available, like without huge pages or a CMA heap,
+ * the pixels are placed in cached memory from the heap, see placement().
+ *
+ * @param[in] format Format of the surface.
+ * @param[in] size Size of the surface.
+ * @param[in] placement Memory to place the pixels in.
+ */
+EGT_API shared_cairo_surface_t create_surface(cairo_format_t format, const Size& size,
+        Placement placement = Placement::automatic);
+
+/**
+ * Get the memory the pixels of a surface were placed in.
+ *
+ * This is Placement::cached for surfaces not created by create_surface().
+ */
+EGT_API Placement placement(cairo_surface_t* surface);
+
+/**
+ * Get the memory composition buffers are placed in.
+ *
+ * This is Placement::automatic, unless set by the EGT_COMPOSITION_MEMORY
+ * environment variable to "cached", "hugepage" or "cma".
+ */
+EGT_API Placement composition_placement();
+
+/**
+ * Get the name of a placement.
+ */
+EGT_API const char* placement_name(Placement placement);
+
+/**
+ * Measure how fast memory is read, in bytes per second.
+ *
+ * @param[in] data The memory.
+ * @param[in] bytes Number of bytes to read.
+ */
+EGT_API double read_throughput(const uint8_t* data, size_t bytes);
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_RASTERIZER_H
+#define EGT_DETAIL_RASTERIZER_H
+
+/**
+ * @file
+ * @brief Rasterizers behind Painter.
+ */
+
+#include <cairo.h>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+class Image;
+
+namespace detail
+{
+
+/**
+ * Rasterizer of the Painter operations.
+ *
+ * The cairo context of a Painter stays the state of the drawing: the
+ * source, the transformation, the clip, and the path.  Painter offers each
+ * operation producing pixels to the rasterizer first, which either writes
+ * the pixels of the target, and returns true, or returns false to leave the
+ * operation to cairo.  So a rasterizer only has to handle the cases it is
+ * faster for, and widgets drawing with Painter, or with cairo directly, are
+ * not changed.
+ *
+ * The rasterizers built in are "direct", which writes untransformed images
+ * and solid rectangles with the pixel kernels, and "cairo", which leaves
+ * everything to cairo.  The default is chosen when building the library,
+ * with EGT_RASTERIZER, and can be changed with the EGT_RASTERIZER
+ * environment variable.
+ */
+class EGT_API Rasterizer
+{
+public:
+
+    Rasterizer() noexcept = default;
+    Rasterizer(const Rasterizer&) = delete;
+    Rasterizer& operator=(const Rasterizer&) = delete;
+
+    /// Name of the rasterizer.
+    EGT_NODISCARD virtual const char* name() const = 0;
+
+    /**
+     * Fill the current path, and clear it.
+     *
+     * @param[in] cr The context.
+     */
+    virtual bool fill(cairo_t* cr)
+    {
+        detail::ignoreparam(cr);
+        return false;
+    }
+
+    /**
+     * Stroke the current path, and clear it.
+     *
+     * @param[in] cr The context.
+     */
+    virtual bool stroke(cairo_t* cr)
+    {
+        detail::ignoreparam(cr);
+        return false;
+    }
+
+    /**
+     * Fill a rectangle, without changing the current path.
+     *
+     * @param[in] cr The context.
+     * @param[in] rect The rectangle, in user space.
+     */
+    virtual bool fill(cairo_t* cr, const RectF& rect)
+    {
+        detail::ignoreparam(cr);
+        detail::ignoreparam(rect);
+        return false;
+    }
+
+    /**
+     * Draw an image.
+     *
+     * @param[in] cr The context.
+     * @param[in] image The image.
+     * @param[in] point Position of the image, in user space.
+     */
+    virtual bool draw(cairo_t* cr, const Image& image, const PointF& point)
+    {
+        detail::ignoreparam(cr);
+        detail::ignoreparam(image);
+        detail::ignoreparam(point);
+        return false;
+    }
+
+    virtual ~Rasterizer() noexcept = default;
+};
+
+/**
+ * Get the rasterizer used by Painter.
+ */
+EGT_API Rasterizer& rasterizer();
+
+/**
+ * Select the rasterizer used by Painter.
+ *
+ * @param[in] name Name of a rasterizer, see rasterizers().
+ * @throws std::runtime_error If there is no such rasterizer.
+ */
+EGT_API void rasterizer(const std::string& name);
+
+/**
+ * Get the names of the rasterizers built in.
+ */
+EGT_API std::vector<std::string> rasterizers();
+
+}
+}
+}
+
+#endif
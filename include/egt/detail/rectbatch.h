@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_RECTBATCH_H
+#define EGT_DETAIL_RECTBATCH_H
+
+/**
+ * @file
+ * @brief Testing many rectangles at once.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/detail/pixelops.h>
+#include <egt/geometry.h>
+#include <limits>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Array of rectangles stored as arrays of their edges, so a rectangle or a
+ * point is tested against all of them at once with the vector units.
+ *
+ * This is meant for the boxes of many subordinates, when culling the ones
+ * outside of a damage rectangle, or finding the one under a pointer.
+ */
+class RectBatch
+{
+public:
+
+    /// Returned by last_hit() when no rectangle contains the point.
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    /// Remove all rectangles.
+    void clear()
+    {
+        m_left.clear();
+        m_top.clear();
+        m_right.clear();
+        m_bottom.clear();
+    }
+
+    /// Reserve space for a number of rectangles.
+    void reserve(size_t count)
+    {
+        m_left.reserve(count);
+        m_top.reserve(count);
+        m_right.reserve(count);
+        m_bottom.reserve(count);
+    }
+
+    /// Add a rectangle at the end.
+    void push_back(const Rect& rect)
+    {
+        m_left.push_back(rect.left());
+        m_top.push_back(rect.top());
+        m_right.push_back(rect.right());
+        m_bottom.push_back(rect.bottom());
+    }
+
+    /// Number of rectangles.
+    EGT_NODISCARD size_t size() const { return m_left.size(); }
+
+    /// Returns true if there is no rectangle.
+    EGT_NODISCARD bool empty() const { return m_left.empty(); }
+
+    /// Get a rectangle.
+    EGT_NODISCARD Rect at(size_t index) const
+    {
+        return {m_left[index], m_top[index],
+                m_right[index] - m_left[index], m_bottom[index] - m_top[index]};
+    }
+
+    /**
+     * Test which rectangles overlap a rectangle, like Rect::intersect().
+     *
+     * @param[in] rect The rectangle to test.
+     * @param[out] mask Resized to size(), with 1 for each rectangle that
+     *             overlaps and 0 for the others.
+     * @return Number of rectangles that overlap.
+     */
+    size_t intersect(const Rect& rect, std::vector<uint8_t>& mask) const
+    {
+        mask.resize(size());
+        return rects_intersect(edges(size()), rect.left(), rect.top(),
+                               rect.right(), rect.bottom(), mask.data());
+    }
+
+    /**
+     * Get the rectangle containing all rectangles, like merging them with
+     * Rect::merge().
+     */
+    EGT_NODISCARD Rect bounds() const
+    {
+        int32_t b[4];
+        rects_bounds(edges(size()), b);
+        return {b[0], b[1], b[2] - b[0], b[3] - b[1]};
+    }
+
+    /**
+     * Find the last rectangle containing a point, like Rect::intersect()
+     * with a point.
+     *
+     * Passing the previous result as end continues the search below it.
+     *
+     * @param[in] point The point.
+     * @param[in] end Only look at the rectangles before this index.
+     * @return Index of the rectangle, or npos.
+     */
+    EGT_NODISCARD size_t last_hit(const Point& point, size_t end = npos) const
+    {
+        end = std::min(end, size());
+        const auto i = rects_last_hit(edges(end), point.x(), point.y());
+        return i == end ? npos : i;
+    }
+
+private:
+
+    RectEdges edges(size_t count) const
+    {
+        return {m_left.data(), m_top.data(), m_right.data(), m_bottom.data(), count};
+    }
+
+    std::vector<int32_t> m_left;
+    std::vector<int32_t> m_top;
+    std::vector<int32_t> m_right;
+    std::vector<int32_t> m_bottom;
+};
+
+}
+}
+}
+
+#endif
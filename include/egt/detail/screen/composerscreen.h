@@ -11,8 +11,11 @@
  * @brief Working with an in-memory screen to be used with the MGC.
  */
 
+#include <atomic>
+#include <cstdint>
 #include <egt/screen.h>
 #include <egt/signal.h>
+#include <string>
 
 namespace egt
 {
@@ -28,16 +31,97 @@ class EGT_API ComposerScreen : public Screen
 {
 public:
 
+    /**
+     * Header of the file the screen is exported to.
+     *
+     * The pixels follow the header, at offset bytes from its start.  A
+     * reader waits for sequence to change to an even value, copies the
+     * damage rectangles, and reads sequence again: if it changed, the frame
+     * was written meanwhile and the copy must be done again.  If sequence
+     * moved by more than 2 since the last frame read, or damage_count is 0,
+     * the whole frame must be copied.
+     */
+    struct ExportHeader
+    {
+        /// Magic number, for a valid header.
+        static constexpr uint32_t MAGIC = 0x43544745; // "EGTC"
+        /// Version of the layout.
+        static constexpr uint32_t VERSION = 1;
+        /// Maximum number of damage rectangles.
+        static constexpr uint32_t MAX_DAMAGE = 16;
+
+        /// MAGIC once the rest of the header is valid.
+        uint32_t magic;
+        /// Layout version.
+        uint32_t version;
+        /// Width of the frame, in pixels.
+        uint32_t width;
+        /// Height of the frame, in pixels.
+        uint32_t height;
+        /// Bytes between two rows.
+        uint32_t stride;
+        /// PixelFormat of the frame.
+        uint32_t format;
+        /// Offset of the pixels from the start of the header.
+        uint32_t offset;
+        /// Incremented before and after each frame, so odd while it is written.
+        std::atomic<uint32_t> sequence;
+        /// Number of rectangles in damage, or 0 if the whole frame changed.
+        uint32_t damage_count;
+        /// Rectangles changed by the last frame, as x, y, width and height.
+        int32_t damage[MAX_DAMAGE][4];
+    };
+
     explicit ComposerScreen(const Size& size = Size(800, 480));
 
+    ComposerScreen(const ComposerScreen&) = delete;
+    ComposerScreen& operator=(const ComposerScreen&) = delete;
+    ComposerScreen(ComposerScreen&&) = delete;
+    ComposerScreen& operator=(ComposerScreen&&) = delete;
+
+    void flip(const DamageArray& damage) override;
+
     void schedule_flip() override {}
 
     EGT_NODISCARD bool is_composer() const override { return true; }
 
     EGT_NODISCARD unsigned char* get_pixmap();
 
+    /**
+     * Change the size of the screen.
+     *
+     * Fonts following the screen size are resized, and the main window is
+     * laid out again.  The layout of the main window at each of the last few
+     * sizes is kept, and restored without a layout when coming back to one of
+     * them, as long as nothing in the window asked for a layout since.
+     *
+     * @param[in] size The new size of the screen.
+     */
     void resize(const Size& size);
 
+    /**
+     * Export the frames to a file mapped in memory, like one in /dev/shm.
+     *
+     * Each frame only copies its damage to the file, and then publishes the
+     * damage rectangles with a new sequence number in an ExportHeader, so
+     * an external tool, like a UI designer, can show a live preview without
+     * copying whole frames.  The export follows the size of the screen.
+     *
+     * This is enabled at startup with the EGT_COMPOSER_EXPORT environment
+     * variable.
+     *
+     * @param[in] path File to export to, or empty to stop exporting.
+     * @return true if the frames are exported to the file.
+     */
+    bool export_to(const std::string& path);
+
+    /**
+     * Returns the header of the exported file, or nullptr if not exporting.
+     */
+    EGT_NODISCARD ExportHeader* export_header() const { return m_export_header; }
+
+    ~ComposerScreen() noexcept override;
+
     /**
      * Register a handler to manage screen size changes.
      *
@@ -78,6 +162,24 @@ public:
 private:
     /// Invoked by resize().
     static Signal<> on_screen_resized;
+
+    /// Map the export file for the size, and draw to it.
+    bool map_export(const Size& size);
+
+    /// Unmap the export file.
+    void unmap_export();
+
+    /// File the frames are exported to.
+    std::string m_export_path;
+
+    /// Mapping of the export file.
+    ExportHeader* m_export_header{nullptr};
+
+    /// Size of the mapping.
+    size_t m_export_size{0};
+
+    /// Must the next frame be published as a whole?
+    bool m_export_full{true};
 };
 
 }
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_SCREEN_EPDSCREEN_H
+#define EGT_DETAIL_SCREEN_EPDSCREEN_H
+
+/**
+ * @file
+ * @brief Working with an electronic paper display.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <egt/screen.h>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Application;
+
+namespace detail
+{
+
+/**
+ * Waveform used to refresh part of an electronic paper display.
+ */
+enum class EpdWaveform
+{
+    /**
+     * Fast waveform that only drives pixels to black or white, like DU.
+     *
+     * It takes a fraction of the time of a quality refresh, and leaves
+     * ghosting behind.
+     */
+    fast,
+
+    /**
+     * Waveform with all the gray levels, like GC16.
+     */
+    quality,
+};
+
+/**
+ * Refresh of a region of an electronic paper display.
+ */
+struct EpdUpdate
+{
+    /// Region of the screen to refresh.
+    Rect rect;
+    /// Waveform to refresh it with.
+    EpdWaveform waveform{EpdWaveform::quality};
+    /// Refresh every pixel, flashing the display to remove ghosting.
+    bool full{false};
+};
+
+/**
+ * Turns the damage of frames into refreshes of an electronic paper display.
+ *
+ * Damage is added as frames are flipped, and taken as refreshes once the
+ * coalescing window of the screen expires, so many small changes collapse
+ * into a few refreshes.  Small regions only made of black and white pixels,
+ * like text, are refreshed with the fast waveform, and the rest with the
+ * quality waveform.  Once enough partial refreshes were done, or when most
+ * of the screen changed, the whole screen is refreshed with the quality
+ * waveform instead, which clears the ghosting partial refreshes leave.
+ */
+class EGT_API EpdRefresh
+{
+public:
+
+    /**
+     * Parameters of the refreshes.
+     */
+    struct Config
+    {
+        /// Time damage is coalesced before the display is refreshed.
+        std::chrono::milliseconds window{100};
+        /// Partial refreshes between full refreshes, or zero for no limit.
+        uint32_t full_interval{32};
+        /// Largest region, in pixels, refreshed with the fast waveform.
+        uint64_t fast_max_pixels{200 * 200};
+        /// Fraction, from 0.0 to 1.0, of the screen that changed above which
+        /// the whole screen is refreshed.
+        float full_fraction{0.5f};
+    };
+
+    explicit EpdRefresh(const Size& size);
+
+    EpdRefresh(const Size& size, const Config& config);
+
+    /**
+     * Add damage to refresh.
+     *
+     * @param rect Region of the screen that changed.
+     * @param monochrome The region is only made of black and white pixels.
+     */
+    void add(const Rect& rect, bool monochrome);
+
+    /**
+     * Returns true if damage is waiting to be refreshed.
+     */
+    EGT_NODISCARD bool pending() const
+    {
+        return !m_fast.empty() || !m_quality.empty();
+    }
+
+    /**
+     * Take the refreshes for the damage added so far.
+     */
+    std::vector<EpdUpdate> take();
+
+    /**
+     * Refresh the whole screen with the next take().
+     */
+    void force_full() { m_force_full = true; }
+
+    /**
+     * Number of partial refreshes since the last full refresh.
+     */
+    EGT_NODISCARD uint32_t partials() const { return m_partials; }
+
+    /**
+     * Get the parameters of the refreshes.
+     */
+    EGT_NODISCARD const Config& config() const { return m_config; }
+
+    /**
+     * Set the parameters of the refreshes.
+     */
+    void config(const Config& config) { m_config = config; }
+
+    /**
+     * Returns true if the region of an image surface only has pixels close
+     * to black or white.
+     *
+     * Only 32 bit and RGB565 surfaces are supported, others are never
+     * monochrome.
+     */
+    static bool monochrome(cairo_surface_t* surface, const Rect& rect);
+
+private:
+
+    /// Size of the screen.
+    Size m_size;
+    /// Parameters of the refreshes.
+    Config m_config;
+    /// Damage to refresh with the fast waveform.
+    Screen::DamageArray m_fast;
+    /// Damage to refresh with the quality waveform.
+    Screen::DamageArray m_quality;
+    /// Partial refreshes since the last full refresh.
+    uint32_t m_partials{0};
+    /// Refresh the whole screen with the next take().
+    bool m_force_full{true};
+};
+
+/**
+ * Screen on an electronic paper display, with the Linux framebuffer
+ * interface of the i.MX EPDC driver.
+ *
+ * Frames are copied to the framebuffer as they are flipped, but the
+ * display is only refreshed once the coalescing window expires, with the
+ * refreshes chosen by EpdRefresh.
+ *
+ * It is configured with environment variables: EGT_EPD_DEVICE selects the
+ * framebuffer device, EGT_EPD_WINDOW the coalescing window in milliseconds,
+ * EGT_EPD_FULL_REFRESH the partial refreshes between full refreshes, and
+ * EGT_EPD_WAVEFORMS the modes of the fast and quality waveforms of the
+ * panel.
+ */
+class EGT_API EpdScreen : public Screen
+{
+public:
+
+    /**
+     * @param app Application instance this screen is associated with.
+     * @param device Framebuffer device of the display.
+     */
+    explicit EpdScreen(Application& app, const std::string& device = "/dev/fb0");
+
+    EpdScreen(const EpdScreen&) = delete;
+    EpdScreen& operator=(const EpdScreen&) = delete;
+    EpdScreen(EpdScreen&&) = delete;
+    EpdScreen& operator=(EpdScreen&&) = delete;
+
+    void flip(const DamageArray& damage) override;
+
+    void schedule_flip() override {}
+
+    /**
+     * Refresh the display with the damage coalesced so far, without
+     * waiting for the window to expire.
+     */
+    void refresh();
+
+    /**
+     * Get the refresh policy of the screen.
+     */
+    EpdRefresh& refresh_policy() { return m_refresh; }
+
+    ~EpdScreen() noexcept override;
+
+protected:
+
+    /// Send a refresh to the driver.
+    void send(const EpdUpdate& update);
+
+    /// Framebuffer device.
+    int m_fd{-1};
+
+    /// Mapped framebuffer.
+    void* m_fb{nullptr};
+
+    /// Size of the mapped framebuffer.
+    size_t m_fb_size{0};
+
+    /// Refresh policy.
+    EpdRefresh m_refresh;
+
+    /// Expires at the end of the coalescing window.
+    asio::steady_timer m_timer;
+
+    /// Is the coalescing window open.
+    bool m_waiting{false};
+
+    /// Driver waveform modes of EpdWaveform::fast and EpdWaveform::quality.
+    uint32_t m_waveforms[2]{1, 2};
+
+    /// Marker of the last refresh sent.
+    uint32_t m_marker{0};
+};
+
+}
+}
+}
+
+#endif
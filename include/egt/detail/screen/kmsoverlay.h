@@ -11,11 +11,14 @@
  * @brief Working with KMS screens.
  */
 
+#include <array>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/detail/screen/kmstype.h>
 #include <egt/input.h>
 #include <egt/screen.h>
 #include <egt/widgetflags.h>
+#include <map>
 #include <memory>
 
 struct plane_data;
@@ -27,6 +30,7 @@ inline namespace v1
 namespace detail
 {
 struct FlipThread;
+class KMSFrame;
 
 /**
  * Screen in a KMS dumb buffer inside of an overlay plane.
@@ -106,13 +110,63 @@ public:
 
     uint32_t index() override;
 
+    EGT_NODISCARD bool flip_ready() const override;
+
+    /**
+     * Import a dmabuf as a framebuffer that can be shown on the plane.
+     *
+     * The framebuffer has the size and format of the plane.  It is kept
+     * until release_dmabufs(), so importing the same buffer again is free.
+     *
+     * @param[in] fd The dmabuf file descriptor.
+     * @param[in] pitches Bytes per line of each plane of the buffer.
+     * @param[in] offsets Offset of each plane in the buffer.
+     * @return The framebuffer id, or 0 on failure.
+     */
+    uint32_t import_dmabuf(int fd,
+                           const std::array<uint32_t, 4>& pitches,
+                           const std::array<uint32_t, 4>& offsets);
+
+    /**
+     * Show a framebuffer returned by import_dmabuf() on the plane, without
+     * copying it to the plane buffers.
+     *
+     * This returns once the framebuffer is shown.  The next schedule_flip()
+     * shows the plane buffers again.
+     */
+    bool flip_framebuffer(uint32_t fb);
+
+    /// Release the framebuffers imported by import_dmabuf().
+    void release_dmabufs();
+
+    ~KMSOverlay() noexcept override;
+
 protected:
+
+    /// Get the builder of the atomic commit of the frame, if any.
+    EGT_NODISCARD KMSFrame* frame() const;
+
     /// Plane instance pointer.
     unique_plane_t m_plane;
     /// Current flip index.
     uint32_t m_index{0};
     /// Internal thread pool for flipping.
     std::unique_ptr<FlipThread> m_pool;
+
+    /// A framebuffer imported by import_dmabuf().
+    struct Dmabuf
+    {
+        /// Framebuffer id.
+        uint32_t fb{0};
+        /// GEM handle of the buffer.
+        uint32_t handle{0};
+    };
+
+    /// Framebuffers imported by import_dmabuf(), by inode of the dmabuf.
+    std::map<uint64_t, Dmabuf> m_dmabufs;
+
+    /// Position of the plane.
+    DisplayPoint m_position;
 };
 
 }
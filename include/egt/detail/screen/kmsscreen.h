@@ -31,11 +31,25 @@ namespace detail
 struct planeid;
 class KMSOverlay;
 struct FlipThread;
+struct KMSDevice;
+class KMSFrame;
 
 /**
  * Screen in an KMS dumb buffer.
  *
  * This uses libplanes to modeset and configure planes.
+ *
+ * There is one KMSScreen per output of the display controller.  The screens
+ * of all outputs share the DRM device, but each one has its own primary
+ * plane, buffers, damage and flip thread, so each output flips at the pace
+ * of its own display.
+ *
+ * @code{.cpp}
+ * egt::Application app;
+ * egt::detail::KMSScreen hdmi(true, egt::PixelFormat::xrgb8888, 1);
+ * egt::TopWindow window;
+ * window.output(hdmi);
+ * @endcode
  */
 class EGT_API KMSScreen : public Screen
 {
@@ -45,9 +59,11 @@ public:
      * @param allocate_primary_plane Allocate a primary plane, or create a trash
      *        buffer instead.
      * @param format Requested format for the screen.
+     * @param output Index of the output, or connector, to drive.
      */
     explicit KMSScreen(bool allocate_primary_plane = true,
-                       PixelFormat format = PixelFormat::rgb565);
+                       PixelFormat format = PixelFormat::rgb565,
+                       uint32_t output = 0);
 
     KMSScreen(const KMSScreen&) = delete;
     KMSScreen& operator=(const KMSScreen&) = delete;
@@ -67,13 +83,35 @@ public:
      */
     uint32_t count_planes(plane_type type = plane_type::overlay);
 
-    /// Get a pointer to the KMSScreen instance.
+    /// Get a pointer to the KMSScreen instance of the first output.
     static KMSScreen* instance();
 
+    /// Get a pointer to the KMSScreen instance of an output, if there is one.
+    static KMSScreen* instance(uint32_t output);
+
+    /// Get the index of the output of the screen.
+    EGT_NODISCARD uint32_t output() const { return m_output; }
+
+    /// Get the number of outputs of the display controller.
+    EGT_NODISCARD uint32_t outputs() const;
+
     void schedule_flip() override;
 
     uint32_t index() override;
 
+    EGT_NODISCARD bool flip_ready() const override;
+
+    void end_frame() override;
+
+    /**
+     * Get the builder of the atomic commit of the frame, shared by the
+     * screens of all outputs.
+     *
+     * This is null if the driver does not support atomic commits, in which
+     * case each plane is flipped and applied on its own.
+     */
+    EGT_NODISCARD KMSFrame* frame() const;
+
     /// Close and release the screen.
     void close();
 
@@ -88,6 +126,9 @@ public:
     /// Get the number of buffers to use for KMS planes.
     static uint32_t max_buffers();
 
+    /// Get the rotation of the screen, in degrees, to use for the primary plane.
+    static uint32_t screen_rotation();
+
     /// Allocate an overlay plane.
     unique_plane_t allocate_overlay(const Size& size,
                                     PixelFormat format = PixelFormat::argb8888,
@@ -99,11 +140,22 @@ public:
     EGT_NODISCARD bool have_planes() const override { return true; }
 
 protected:
+
+    void copy_to_buffer(ScreenBuffer& buffer) override;
+
+    /// Returns true if the primary plane can be rotated by degrees.
+    EGT_NODISCARD bool primary_rotation(uint32_t degrees) const;
+
+    /// Load the RGB332 colors in the lookup table of the CRTC, for PixelFormat::c8.
+    void load_palette();
+
     /// Allocate an overlay plane.
     plane_data* overlay_plane_create(const Size& size,
                                      PixelFormat format,
                                      plane_type type);
 
+    /// DRM device shared by the screens of all outputs.
+    std::shared_ptr<KMSDevice> m_shared;
     /// Internal DRM/KMS file descriptor.
     int m_fd{-1};
     /// Instance of the KMS device.
@@ -112,6 +164,8 @@ protected:
     unique_plane_t m_plane;
     /// Current flip index.
     uint32_t m_index{0};
+    /// Index of the output.
+    uint32_t m_output{0};
     /// Global array used to keep track of allocated planes
     static std::vector<planeid> m_used;
     /// Internal thread pool for flipping.
@@ -62,7 +62,9 @@ protected:
 
     void pointer_event(EventId e, const Pointer& pointer);
     void key_event(EventId e, const Key& key);
-    void sdl_draw(const DamageArray& damage);
+    /// Upload the pending damage to the texture and present it, in the SDL thread.
+    void sdl_draw();
+    void copy_to_buffer(ScreenBuffer& buffer) override;
     static KeyboardCode sdl_to_egtkeys(int key);
 
     /// @private
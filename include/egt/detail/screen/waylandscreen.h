@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_SCREEN_WAYLANDSCREEN_H
+#define EGT_DETAIL_SCREEN_WAYLANDSCREEN_H
+
+/**
+ * @file
+ * @brief Wayland screen support.
+ */
+
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <egt/input.h>
+#include <egt/screen.h>
+#include <memory>
+#include <string>
+
+namespace egt
+{
+inline namespace v1
+{
+class Application;
+
+namespace detail
+{
+struct WaylandData;
+struct WaylandSurface;
+
+/**
+ * Screen in a Wayland window.
+ *
+ * Frames are copied to one of two shared memory buffers, and only their
+ * damage is submitted to the compositor.  A frame is only submitted once the
+ * compositor is done with the previous one: damage flipped meanwhile is
+ * submitted with the next frame.
+ */
+class EGT_API WaylandScreen : public Screen
+{
+public:
+
+    WaylandScreen() = delete;
+
+    /**
+     * @param app Application instance this screen is associated with.
+     * @param size Size of the screen.
+     * @param name Title of the window.
+     */
+    explicit WaylandScreen(Application& app, const Size& size = Size(800, 480),
+                           const std::string& name = {});
+
+    WaylandScreen(const WaylandScreen&) = delete;
+    WaylandScreen& operator=(const WaylandScreen&) = delete;
+    WaylandScreen(WaylandScreen&&) = delete;
+    WaylandScreen& operator=(WaylandScreen&&) = delete;
+
+    void schedule_flip() override
+    {}
+
+    void flip(const DamageArray& damage) override;
+
+    uint32_t index() override;
+
+    ~WaylandScreen() noexcept override;
+
+protected:
+
+    /// Callback for Wayland server data.
+    void handle_read(const asio::error_code& error);
+
+    /// Read and dispatch the events from the Wayland server.
+    void dispatch();
+
+    /// Application reference.
+    Application& m_app;
+
+    /// @private
+    std::unique_ptr<detail::WaylandData> m_priv;
+
+    /// Input stream for handling Wayland server events
+    asio::posix::stream_descriptor m_input;
+
+    /**
+     * Wayland input dispatcher.
+     *
+     * Because a WaylandScreen also handles input from the compositor, this
+     * needs to have its own Input device.
+     * @private
+     */
+    struct WaylandInput : public Input
+    {
+        using Input::Input;
+        friend class WaylandScreen;
+    };
+
+    /// Custom input for dispatching events.
+    WaylandInput m_in;
+
+    friend class WaylandSubsurface;
+};
+
+/**
+ * Screen in a subsurface of a WaylandScreen.
+ *
+ * The compositor composes it over the window, like a hardware plane over
+ * the primary plane, so plane windows use it.
+ */
+class EGT_API WaylandSubsurface : public Screen
+{
+public:
+
+    /**
+     * @param parent The screen of the window the subsurface is in.
+     * @param size Size of the subsurface.
+     */
+    WaylandSubsurface(WaylandScreen& parent, const Size& size);
+
+    WaylandSubsurface(const WaylandSubsurface&) = delete;
+    WaylandSubsurface& operator=(const WaylandSubsurface&) = delete;
+    WaylandSubsurface(WaylandSubsurface&&) = delete;
+    WaylandSubsurface& operator=(WaylandSubsurface&&) = delete;
+
+    void schedule_flip() override
+    {}
+
+    void flip(const DamageArray& damage) override;
+
+    uint32_t index() override;
+
+    /**
+     * Change the size of the subsurface, which then needs to be drawn again.
+     */
+    void resize(const Size& size);
+
+    /**
+     * Move the subsurface, relative to the window.
+     */
+    void position(const DisplayPoint& point);
+
+    /**
+     * Show the subsurface again, after hide().
+     */
+    void show();
+
+    /**
+     * Hide the subsurface.
+     */
+    void hide();
+
+    ~WaylandSubsurface() noexcept override;
+
+protected:
+
+    /// The screen of the window.
+    WaylandScreen& m_parent;
+
+    /// @private
+    std::unique_ptr<detail::WaylandSurface> m_surface;
+};
+
+}
+}
+}
+
+#endif
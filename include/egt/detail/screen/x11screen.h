@@ -65,6 +65,9 @@ protected:
     /// Callback for X11 server data.
     void handle_read(const asio::error_code& error);
 
+    /// Dispatch the events read from the X11 server.
+    void process_events();
+
     void copy_to_buffer(ScreenBuffer& buffer) override;
 
     /// Application reference.
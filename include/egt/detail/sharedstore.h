@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_SHAREDSTORE_H
+#define EGT_DETAIL_SHAREDSTORE_H
+
+/**
+ * @file
+ * @brief Decoded images shared by processes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/types.h>
+#include <mutex>
+#include <string>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Store of decoded images shared by every EGT process of the system.
+ *
+ * An image decoded by a process is published to a directory, normally on a
+ * tmpfs like /dev/shm, as an uncompressed ERAW file named after a hash of
+ * the encoded image and the scale it is decoded at.  The process, and every
+ * other one decoding the same image, then maps the file read-only instead
+ * of holding its own pixels, so the pixels are in memory once for the whole
+ * system.
+ *
+ * Files are written aside and renamed, so they are never read partially,
+ * and removing them does not affect the processes that have them mapped.
+ *
+ * The directory defaults to the EGT_SHARED_CACHE_DIR environment variable,
+ * and the maximum size of the store to EGT_SHARED_CACHE_SIZE, in bytes.
+ * Without a directory the store is disabled.
+ *
+ * This can be used from any thread.
+ */
+class EGT_API SharedImageStore : private NonCopyable<SharedImageStore>
+{
+public:
+
+    SharedImageStore();
+
+    /**
+     * @param[in] dir Directory of the store, created if needed.
+     * @param[in] max_bytes Maximum size of the store, or 0 for no limit.
+     */
+    explicit SharedImageStore(const std::string& dir, size_t max_bytes = 0);
+
+    /// Set the directory of the store, created if needed, or empty to disable it.
+    void dir(const std::string& dir);
+
+    /// Get the directory of the store.
+    EGT_NODISCARD std::string dir() const;
+
+    /// Returns true if images are shared.
+    EGT_NODISCARD bool enabled() const;
+
+    /**
+     * Set the maximum size of the files of the store, in bytes.
+     *
+     * The least recently used files are removed when an image is published
+     * over it.  0 is no limit.
+     */
+    void max_bytes(size_t bytes);
+
+    /// Get the maximum size of the files of the store, in bytes.
+    EGT_NODISCARD size_t max_bytes() const;
+
+    /// Hash of an encoded image.
+    static uint64_t hash(const unsigned char* data, size_t len) noexcept;
+
+    /**
+     * Map an image published by any process.
+     *
+     * @param[in] hash Hash of the encoded image.
+     * @param[in] hscale Horizontal scale it is decoded at.
+     * @param[in] vscale Vertical scale it is decoded at.
+     * @return The image, or nullptr if it is not published.
+     */
+    shared_cairo_surface_t find(uint64_t hash, float hscale, float vscale) const;
+
+    /**
+     * Publish a decoded image.
+     *
+     * Only ARGB32 and RGB24 image surfaces are published.
+     *
+     * @return The published image mapped from the store, or the image itself
+     * if it cannot be published.
+     */
+    shared_cairo_surface_t publish(uint64_t hash, float hscale, float vscale,
+                                   const shared_cairo_surface_t& image);
+
+    /**
+     * Get an image from the store, or decode and publish it.
+     *
+     * @param[in] data Encoded image.
+     * @param[in] len Size of the encoded image.
+     * @param[in] hscale Horizontal scale it is decoded at.
+     * @param[in] vscale Vertical scale it is decoded at.
+     * @param[in] decode Decode the image.
+     */
+    template<class Decode>
+    shared_cairo_surface_t get(const unsigned char* data, size_t len,
+                               float hscale, float vscale, Decode&& decode)
+    {
+        if (!enabled() || !data || !len)
+            return decode();
+
+        const auto h = hash(data, len);
+        if (auto image = find(h, hscale, vscale))
+            return image;
+
+        return publish(h, hscale, vscale, decode());
+    }
+
+    /// Get the size of the files of the store, in bytes.
+    EGT_NODISCARD size_t bytes() const;
+
+    /**
+     * Remove the least recently used files, down to a size in bytes.
+     *
+     * @return The number of bytes removed.
+     */
+    size_t trim(size_t bytes);
+
+    /// Remove all files of the store.
+    void clear();
+
+private:
+
+    /// Path of an image in the store.
+    std::string path(uint64_t hash, float hscale, float vscale) const;
+
+    mutable std::mutex m_mutex;
+    std::string m_dir;
+    size_t m_max_bytes{0};
+};
+
+/**
+ * Get the store of decoded images shared by processes.
+ */
+EGT_API SharedImageStore& shared_image_store();
+
+}
+}
+}
+
+#endif
@@ -6,7 +6,9 @@
 #ifndef EGT_DETAIL_STRINGHASH_H
 #define EGT_DETAIL_STRINGHASH_H
 
+#include <egt/detail/meta.h>
 #include <string>
+#include <string_view>
 
 namespace egt
 {
@@ -49,6 +51,32 @@ inline unsigned int hash(const std::string& str)
     return hash(str.c_str());
 }
 
+/**
+ * Perform a hash of a string, giving the same value as the constexpr hash()
+ * of the same characters.
+ */
+inline unsigned int hash(std::string_view str)
+{
+    // the recursive version hashes the last character first
+    unsigned int h = 5381;
+    for (auto i = str.size(); i > 0; --i)
+        h = (h * 33) ^ static_cast<unsigned int>(str[i - 1]);
+    return h;
+}
+
+/**
+ * Get the interned copy of a string.
+ *
+ * Interned strings are kept until the program exits, and equal strings
+ * share the same copy, so the returned view stays valid and can be
+ * compared by address.  This is meant for the small set of strings used
+ * over and over as names and keys, like widget type names and property
+ * names.
+ *
+ * @note This may be called from any thread.
+ */
+EGT_API std::string_view intern(std::string_view str);
+
 }
 }
 }
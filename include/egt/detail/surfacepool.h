@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_SURFACEPOOL_H
+#define EGT_DETAIL_SURFACEPOOL_H
+
+/**
+ * @file
+ * @brief Pool of temporary surfaces.
+ */
+
+#include <cairo.h>
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/types.h>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Pool of the pixels of temporary image surfaces.
+ *
+ * Layers, snapshots and other surfaces only needed for a while take their
+ * pixels from here instead of allocating and freeing them each time.  The
+ * pixels are kept by format and size rounded up to a bucket, and the
+ * surfaces given have the exact size asked for, with the stride of the
+ * bucket.  Pixels go back to the pool when cairo destroys the surface, so
+ * patterns still using it are safe.
+ *
+ * Pixels not in use are bounded by max_idle_bytes(), the least recently used
+ * ones are freed first.  Surfaces destroyed after the pool free their pixels.
+ */
+class EGT_API SurfacePool : private NonCopyable<SurfacePool>
+{
+public:
+
+    /// Default maximum size of the pixels not in use, in bytes.
+    static constexpr size_t DEFAULT_MAX_IDLE_BYTES = 8 * 1024 * 1024;
+
+    /// Widths and heights are rounded up to a multiple of this.
+    static constexpr int BUCKET = 64;
+
+    SurfacePool();
+
+    /**
+     * Get an image surface, cleared like a new one.
+     *
+     * @param[in] format Format of the surface.
+     * @param[in] size Size of the surface.
+     */
+    shared_cairo_surface_t acquire(cairo_format_t format, const Size& size);
+
+    /// Free the pixels not in use.
+    void clear();
+
+    /// Free the least recently used pixels not in use, down to a size in bytes.
+    void trim(size_t bytes);
+
+    /// Get the size of the pixels not in use, in bytes.
+    EGT_NODISCARD size_t idle_bytes() const;
+
+    /// Get the maximum size of the pixels not in use, in bytes.
+    EGT_NODISCARD size_t max_idle_bytes() const;
+
+    /// Set the maximum size of the pixels not in use, in bytes.
+    void max_idle_bytes(size_t bytes);
+
+    /// Number of surfaces created from pixels of the pool.
+    EGT_NODISCARD size_t reused() const;
+
+    ~SurfacePool() noexcept;
+
+private:
+
+    struct Impl;
+    struct Buffer;
+
+    /// Take back the pixels of a surface destroyed by cairo.
+    static void release(void* data);
+
+    /// Shared with the surfaces in use, which may be destroyed after the pool.
+    std::shared_ptr<Impl> m_impl;
+};
+
+/**
+ * Get the pool of temporary surfaces.
+ */
+EGT_API SurfacePool& surface_pool();
+
+/**
+ * Get a context only used to measure text and create fonts, one per thread.
+ *
+ * Its target is a single pixel, and users set the state they depend on,
+ * like the font, since others use the same context.
+ */
+EGT_API shared_cairo_t measure_context();
+
+}
+}
+}
+
+#endif
@@ -11,7 +11,11 @@
  * @brief Animation easing functions.
  */
 
+#include <cstddef>
 #include <egt/detail/meta.h>
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace egt
 {
@@ -269,6 +273,60 @@ struct EGT_API easing_cubic_bezier
     EasingScalar m_p3{};
 };
 
+/**
+ * Easing function baked into a table.
+ *
+ * Evaluating an easing function like easing_bounce() takes several calls to
+ * std::pow() or std::sin(), which are slow on CPUs without a fast FPU.  This
+ * samples any easing function once, and evaluates it with a lookup and a
+ * linear interpolation.  It can be used anywhere an easing function can.
+ *
+ * @code{.cpp}
+ * static const easing_table bounce(easing_bounce);
+ * PropertyAnimator animation(0, 100, std::chrono::seconds(1), bounce);
+ * @endcode
+ *
+ * Copies share the same table.
+ *
+ * @ingroup easing_functions
+ */
+struct EGT_API easing_table
+{
+    /// Default number of samples.
+    static constexpr size_t DEFAULT_SAMPLES = 256;
+
+    /**
+     * @param[in] func The easing function to sample.
+     * @param[in] samples Number of samples, at least 2.
+     */
+    explicit easing_table(const std::function<EasingScalar(EasingScalar)>& func,
+                          size_t samples = DEFAULT_SAMPLES);
+
+    /// Get the easing value.
+    EasingScalar operator()(EasingScalar p) const;
+
+    /**
+     * Get the easing values of many progress values at once.
+     *
+     * For animations sharing an easing function, this evaluates all of them
+     * in one call, using NEON when available.  Progress values are clamped
+     * to the range 0 to 1.
+     *
+     * @param[in] p Progress values.
+     * @param[out] out Easing values.
+     * @param[in] count Number of values.
+     */
+    void operator()(const EasingScalar* p, EasingScalar* out, size_t count) const;
+
+    /// Get the number of samples.
+    EGT_NODISCARD size_t samples() const { return m_table->size(); }
+
+private:
+
+    /// Samples, evenly spaced from progress 0 to 1.
+    std::shared_ptr<const std::vector<EasingScalar>> m_table;
+};
+
 /** @} */
 
 }
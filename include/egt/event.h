@@ -145,6 +145,14 @@ struct EGT_API Pointer
      */
     DisplayPoint drag_start;
 
+    /**
+     * Velocity of the pointer when the drag stopped, in display pixels per
+     * second, for kinetic scrolling.
+     *
+     * Only valid with EventId::pointer_drag_stop.
+     */
+    PointF velocity;
+
     /// The event slot.  Used for multi-touch.
     size_t slot{};
 };
@@ -11,9 +11,15 @@
  * @brief Working with the event loop.
  */
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace egt
@@ -29,7 +35,10 @@ class Application;
 
 namespace detail
 {
+class AnimationTicker;
 class PriorityQueue;
+class TimerWheel;
+struct UpdateState;
 }
 
 /**
@@ -106,12 +115,341 @@ public:
 
     /**
      * Add a callback to be called any time the event loop is idle.
+     *
+     * Callbacks are invoked every 100 ms without events.  Without idle
+     * callbacks, the event loop sleeps until an event occurs, so prefer
+     * idle_timeout() where power matters.
      */
     void add_idle_callback(IdleCallback func);
 
+    /**
+     * Enable or disable the frame clock.
+     *
+     * By default, run() draws right after handling events.  With the frame
+     * clock enabled, damage instead requests a frame and all damage is drawn
+     * at most once per @p period.  When the Screen reports flip completion
+     * the frames are aligned to it, so they follow the vertical blanking of
+     * the display.  Frame callbacks, like animations, are invoked right
+     * before each frame is drawn.
+     *
+     * The frame clock can also be enabled with the EGT_FRAME_CLOCK
+     * environment variable.
+     *
+     * @param enable Enable or disable the frame clock.
+     * @param period Minimum time between two frames.
+     */
+    void frame_clock(bool enable,
+                     std::chrono::microseconds period = std::chrono::microseconds(16667));
+
+    /**
+     * Returns true if the frame clock is enabled.
+     */
+    EGT_NODISCARD bool frame_clock() const { return m_frame_clock; }
+
+    /**
+     * Enable or disable deferred layout.
+     *
+     * By default, anything that changes the geometry or content of a widget,
+     * like resize(), text changes, or adding children, lays out its parent
+     * right away.  Changing the text of 50 labels in a sizer then lays out
+     * the sizer 50 times.  With deferred layout enabled, these only mark the
+     * widget with Widget::request_layout(), and every marked widget is laid
+     * out once, top down, right before the next frame is drawn.
+     *
+     * Geometry of children is then only up to date after the next frame, or
+     * after calling Widget::flush_layout().
+     *
+     * Deferred layout can also be enabled with the EGT_DEFERRED_LAYOUT
+     * environment variable.
+     */
+    void deferred_layout(bool enable) { m_deferred_layout = enable; }
+
+    /**
+     * Returns true if deferred layout is enabled.
+     */
+    EGT_NODISCARD bool deferred_layout() const { return m_deferred_layout; }
+
+    /**
+     * Enable or disable pointer motion coalescing.
+     *
+     * By default, every EventId::raw_pointer_move sample an input device
+     * reports is dispatched, along with the drag events it causes.  A touch
+     * controller reporting at 1 kHz then runs handlers many times per frame.
+     * With coalescing enabled, consecutive motion samples are merged and
+     * dispatched once, with the latest point, right before the next frame is
+     * drawn, or before the next event of another kind.  The merged points
+     * are available from Input::motion_history().
+     *
+     * Motion coalescing can also be enabled with the EGT_COALESCE_MOTION
+     * environment variable.
+     */
+    void coalesce_motion(bool enable) { m_coalesce_motion = enable; }
+
+    /**
+     * Returns true if pointer motion coalescing is enabled.
+     */
+    EGT_NODISCARD bool coalesce_motion() const { return m_coalesce_motion; }
+
+    /**
+     * Set the time budget for handling events before a frame.
+     *
+     * Completion handlers of input devices and timers are queued by
+     * priority: input first, then timers, then background work.  Once the
+     * budget is used up, everything but input is deferred until after the
+     * next frame is drawn, so a burst of timers can not delay the response
+     * to input by more than the budget.
+     *
+     * @param budget Time budget, or 0 for no budget.
+     */
+    void dispatch_budget(std::chrono::microseconds budget) { m_dispatch_budget = budget; }
+
+    /**
+     * Get the time budget for handling events before a frame.
+     */
+    EGT_NODISCARD std::chrono::microseconds dispatch_budget() const { return m_dispatch_budget; }
+
+    /**
+     * Set the time a timer may fire late, to fire along with later timers.
+     *
+     * All timers share a single system timer.  By default it wakes up for
+     * every timer that expires.  With a slack, it wakes up the slack after
+     * the earliest timer expires, and every timer that expired by then fires
+     * in the same wakeup.  Applications with many timers then wake up far
+     * less often.  Timers never fire early.
+     *
+     * The slack can also be set in milliseconds with the EGT_TIMER_SLACK
+     * environment variable.
+     *
+     * @param slack Time a timer may fire late, or 0 for none.
+     */
+    void timer_slack(std::chrono::milliseconds slack);
+
+    /**
+     * Get the time a timer may fire late.
+     */
+    EGT_NODISCARD std::chrono::milliseconds timer_slack() const;
+
+    /**
+     * Enable or disable adaptive fidelity.
+     *
+     * When enabled, once several frames in a row took longer than the budget
+     * to lay out and draw, the screen is switched to Screen::low_fidelity(),
+     * so animations and scrolling keep their frame rate.  Once no frame was
+     * drawn for the idle time, the screen is switched back to
+     * Screen::high_fidelity() and the windows are drawn again.
+     *
+     * Adaptive fidelity can also be enabled with the EGT_ADAPTIVE_FIDELITY
+     * environment variable.
+     *
+     * @param enable Enable adaptive fidelity.
+     * @param budget Time a frame may take to draw in high fidelity.
+     * @param idle Time without frames before high fidelity is restored.
+     */
+    void adaptive_fidelity(bool enable,
+                           std::chrono::microseconds budget = std::chrono::microseconds(16667),
+                           std::chrono::milliseconds idle = std::chrono::milliseconds(300));
+
+    /**
+     * Returns true if adaptive fidelity is enabled.
+     */
+    EGT_NODISCARD bool adaptive_fidelity() const { return m_adaptive_fidelity; }
+
+    /**
+     * Idle state callback function definition.
+     *
+     * The argument is true when entering the idle state, and false when
+     * leaving it.
+     */
+    using IdleStateCallback = std::function<void (bool idle)>;
+
+    /**
+     * Enter an idle state after a time without input.
+     *
+     * Once no input event was dispatched for the timeout, the screen
+     * brightness is lowered, frame callbacks are suspended, and the callback
+     * is invoked.  The next input event restores the brightness and the frame
+     * callbacks, and invokes the callback again.
+     *
+     * @param timeout Time without input, or 0 to disable the idle state.
+     * @param brightness Screen brightness while idle.
+     * @param callback Callback invoked when entering and leaving the idle state.
+     */
+    void idle_timeout(std::chrono::milliseconds timeout, size_t brightness = 0,
+                      IdleStateCallback callback = nullptr);
+
+    /**
+     * Get the time without input before entering the idle state, or 0.
+     */
+    EGT_NODISCARD std::chrono::milliseconds idle_timeout() const { return m_idle_timeout; }
+
+    /**
+     * Returns true in the idle state.
+     */
+    EGT_NODISCARD bool idle() const { return m_idle_state; }
+
+    /**
+     * Counters of the times the event loop woke up to handle events, by the
+     * source of the first event.
+     */
+    struct WakeupStats
+    {
+        /// Input devices.
+        uint64_t input{0};
+        /// Timers and animations.
+        uint64_t timer{0};
+        /// Background work, like completed jobs.
+        uint64_t background{0};
+        /// Anything else, like frame clock ticks, flip completions, or sockets.
+        uint64_t other{0};
+        /// When the counters were reset.
+        std::chrono::steady_clock::time_point since{std::chrono::steady_clock::now()};
+
+        /// Get the number of wakeups from all sources.
+        EGT_NODISCARD uint64_t total() const
+        {
+            return input + timer + background + other;
+        }
+
+        /// Get the rate of a counter, in wakeups per second since the reset.
+        EGT_NODISCARD double per_second(uint64_t count) const
+        {
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - since;
+            return elapsed.count() > 0 ? count / elapsed.count() : 0.;
+        }
+    };
+
+    /**
+     * Get the wakeup statistics collected since the last reset_wakeup_stats().
+     */
+    EGT_NODISCARD const WakeupStats& wakeup_stats() const { return m_wakeup_stats; }
+
+    /**
+     * Reset the wakeup statistics.
+     */
+    void reset_wakeup_stats() { m_wakeup_stats = {}; }
+
+    /**
+     * Request a frame to be drawn on the next tick of the frame clock.
+     *
+     * @note This does nothing if the frame clock is disabled.
+     */
+    void request_frame();
+
+    /**
+     * Frame callback function definition.
+     *
+     * The callback gets the time of the frame.
+     */
+    using FrameCallback = std::function<void (std::chrono::steady_clock::time_point)>;
+
+    /// Handle type for registered frame callbacks.
+    using FrameHandle = uint64_t;
+
+    /**
+     * Add a callback to be called before every frame of the frame clock.
+     *
+     * As long as any frame callback is registered, frames are continuously
+     * requested.
+     *
+     * @return A handle that can be used with remove_frame_callback().
+     */
+    FrameHandle add_frame_callback(FrameCallback func);
+
+    /**
+     * Remove a callback previously added with add_frame_callback().
+     *
+     * @note This may be called from within a frame callback.
+     */
+    void remove_frame_callback(FrameHandle handle);
+
+    /// Priority of a job run by the worker threads.
+    enum class WorkPriority
+    {
+        low,
+        normal,
+        high,
+    };
+
+    /// Handle of a job run by the worker threads.
+    using WorkHandle = uint64_t;
+
+    /**
+     * Run a job on a worker thread, then a callback with its result in the
+     * event loop.
+     *
+     * Loading files, decoding images or preparing the data of a chart then
+     * does not delay drawing.  The worker threads are started by the first
+     * job, one less than the number of cores.  Queued jobs run by priority,
+     * and in the order they were submitted for the same priority.  The
+     * callbacks are background work of the event loop, run within the
+     * dispatch budget.
+     *
+     * If the job throws, the error is logged and the callback is not called.
+     *
+     * @code{.cpp}
+     * app.event().submit([path]() { return load_samples(path); },
+     *                    [&chart](egt::ChartItemArray data) { chart.data(data); });
+     * @endcode
+     *
+     * @param[in] job Called on a worker thread, and may return a result.
+     * @param[in] done Called in the event loop, with the result if any.
+     * @param[in] priority Priority of the job.
+     * @return A handle to cancel() the job.
+     */
+    template<class Job, class Done = std::nullptr_t>
+    WorkHandle submit(Job job, Done done = nullptr,
+                      WorkPriority priority = WorkPriority::normal)
+    {
+        using Result = decltype(job());
+        if constexpr (std::is_void<Result>::value)
+        {
+            return submit_work(std::move(job), std::move(done), priority);
+        }
+        else
+        {
+            auto result = std::make_shared<std::optional<Result>>();
+            std::function<void()> then;
+            if constexpr (!std::is_null_pointer<Done>::value)
+            {
+                then = [result, done = std::move(done)]() mutable
+                {
+                    done(std::move(**result));
+                };
+            }
+
+            return submit_work([result, job = std::move(job)]() mutable
+            {
+                result->emplace(job());
+            }, std::move(then), priority);
+        }
+    }
+
+    /**
+     * Cancel a job.
+     *
+     * A job not started yet will not run, and the callback of the job will
+     * not be called.
+     */
+    void cancel(WorkHandle handle);
+
+    /**
+     * Queue an update to be applied with the others, from any thread.
+     *
+     * @see UpdateChannel
+     * @private
+     */
+    void queue_update(const std::shared_ptr<detail::UpdateState>& update);
+
     /// @private
     detail::PriorityQueue& queue();
 
+    /// @private
+    detail::TimerWheel& timer_wheel();
+
+    /// @private
+    detail::AnimationTicker& animation_ticker();
+
     ~EventLoop() noexcept;
 
 protected:
@@ -122,6 +460,37 @@ protected:
     /// Invoke idle callbacks.
     void invoke_idle_callbacks();
 
+    /// Run queued handlers, within the dispatch budget from start.
+    void execute_queue(std::chrono::steady_clock::time_point start);
+
+    /// Invoke frame callbacks and draw.
+    void frame();
+
+    /// Called when the screen completed a flip.
+    void flip_completed(std::chrono::steady_clock::time_point when);
+
+    /// Apply queued updates.
+    void apply_updates();
+
+    /// Adapt the fidelity to the time a frame took to draw.
+    void govern_fidelity(std::chrono::steady_clock::duration elapsed);
+
+    /// Switch the screens to low or high fidelity.
+    void fidelity(bool low);
+
+    /// Count a wakeup of wait(), by the source of the first event.
+    void count_wakeup();
+
+    /// Enter or leave the idle state.
+    void idle_state(bool idle);
+
+    /// Wait for the idle timeout after the last input.
+    void wait_idle();
+
+    /// Run a job on a worker thread, then done in the event loop.
+    WorkHandle submit_work(std::function<void()> job, std::function<void()> done,
+                           WorkPriority priority);
+
     struct EventLoopImpl;
 
     /// Internal event loop implementation.
@@ -130,6 +499,75 @@ protected:
     /// Registered idle callbacks.
     std::vector<IdleCallback> m_idle;
 
+    /// Registered frame callbacks.
+    std::vector<std::pair<FrameHandle, FrameCallback>> m_frame_callbacks;
+
+    /// Last frame callback handle.
+    FrameHandle m_frame_handle{0};
+
+    /// Is the frame clock enabled?
+    bool m_frame_clock{false};
+
+    /// Is deferred layout enabled?
+    bool m_deferred_layout{false};
+
+    /// Is pointer motion coalescing enabled?
+    bool m_coalesce_motion{false};
+
+    /// Is a frame scheduled?
+    bool m_frame_scheduled{false};
+
+    /// Is adaptive fidelity enabled?
+    bool m_adaptive_fidelity{false};
+
+    /// Did adaptive fidelity switch the screens to low fidelity?
+    bool m_low_fidelity{false};
+
+    /// Number of frames in a row over the fidelity budget.
+    uint32_t m_slow_frames{0};
+
+    /// Time a frame may take to draw in high fidelity.
+    std::chrono::microseconds m_fidelity_budget{16667};
+
+    /// Time without frames before high fidelity is restored.
+    std::chrono::milliseconds m_fidelity_idle{300};
+
+    /// Time without input before entering the idle state, or 0.
+    std::chrono::milliseconds m_idle_timeout{0};
+
+    /// Screen brightness while idle.
+    size_t m_idle_brightness{0};
+
+    /// Screen brightness to restore when leaving the idle state.
+    size_t m_active_brightness{0};
+
+    /// Idle state callback.
+    IdleStateCallback m_idle_callback;
+
+    /// Is the event loop in the idle state?
+    bool m_idle_state{false};
+
+    /// Handle of the input handler watching for activity.
+    uint64_t m_idle_handle{0};
+
+    /// Time of the last input event.
+    std::chrono::steady_clock::time_point m_last_input{};
+
+    /// Wakeup statistics.
+    WakeupStats m_wakeup_stats;
+
+    /// Are frame callbacks being invoked?
+    bool m_in_frame{false};
+
+    /// Minimum time between two frames.
+    std::chrono::microseconds m_frame_period{16667};
+
+    /// Time budget for handling events before a frame.
+    std::chrono::microseconds m_dispatch_budget{8000};
+
+    /// Time of the last frame.
+    std::chrono::steady_clock::time_point m_last_frame{};
+
     /// Used internally to determine whether the event loop should exit.
     bool m_do_quit{false};
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_FDMONITOR_H
+#define EGT_FDMONITOR_H
+
+/**
+ * @file
+ * @brief Monitor a file descriptor in the event loop.
+ */
+
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <functional>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+
+/**
+ * Calls a function in the event loop whenever a file descriptor is
+ * readable.
+ *
+ * The function is queued with the priority of the monitor, like the
+ * handlers of the event loop itself, so i.e. hardware buttons are handled
+ * with touch events, before timers and drawing.
+ *
+ * The function must read what is available, without blocking, or it is
+ * called again right away.
+ *
+ * @code{.cpp}
+ * egt::FdMonitor monitor(fd, [fd]()
+ * {
+ *     char buffer[64];
+ *     while (read(fd, buffer, sizeof(buffer)) > 0)
+ *     {
+ *         ...
+ *     }
+ * });
+ * @endcode
+ */
+class EGT_API FdMonitor : private detail::NonCopyable<FdMonitor>
+{
+public:
+
+    /// Priority of the function in the event loop.
+    enum class Priority
+    {
+        /// After timers and everything else.
+        background,
+        /// With timers.
+        normal,
+        /// With input devices, before anything else.
+        input,
+    };
+
+    /// Called when the file descriptor is readable.
+    using Callback = std::function<void()>;
+
+    /**
+     * Start monitoring a file descriptor.
+     *
+     * @param[in] fd The file descriptor, which is made non-blocking.
+     * @param[in] callback Called when the file descriptor is readable.
+     * @param[in] priority Priority of the callback.
+     * @param[in] own Close the file descriptor when destroyed.
+     */
+    FdMonitor(int fd, Callback callback,
+              Priority priority = Priority::input, bool own = false);
+
+    /// Get the file descriptor.
+    EGT_NODISCARD int fd() const;
+
+    /// Stop calling the function, until start() is called.
+    void stop();
+
+    /// Call the function again when the file descriptor is readable.
+    void start();
+
+    /// Returns true unless stopped, or the file descriptor failed.
+    EGT_NODISCARD bool running() const { return m_running; }
+
+    ~FdMonitor() noexcept;
+
+private:
+
+    /// Wait for the file descriptor to be readable.
+    void wait();
+
+    std::unique_ptr<asio::posix::stream_descriptor> m_stream;
+    Callback m_callback;
+    Priority m_priority;
+    bool m_own;
+    bool m_running{false};
+    bool m_waiting{false};
+};
+
+}
+}
+
+#endif
@@ -21,12 +21,17 @@
 #include <egt/signal.h>
 #include <egt/sizer.h>
 #include <egt/text.h>
+#include <memory>
 #include <string>
 
 namespace egt
 {
 inline namespace v1
 {
+namespace detail
+{
+class DirectoryScanner;
+}
 
 /**
  * A FileDialog is a widget that allows user to:
@@ -35,8 +40,11 @@ inline namespace v1
  * 2. View the contents of file system directories.
  * 3. Select a location for saving a file.
  *
- * @note FileDialog widget is using a std::experimental::filesystem
- * library
+ * Directories are listed on a worker thread, and their entries are shown
+ * while they are read, so a directory of thousands of files does not freeze
+ * the dialog.  Directories are listed first, then files, sorted by name.
+ *
+ * @note FileDialog widget is using a std::filesystem library
  */
 class EGT_API FileDialog : public Dialog
 {
@@ -97,18 +105,41 @@ public:
 
     void show_centered() override;
 
+    /**
+     * Only list the files matching a shell wildcard pattern, like "*.png".
+     *
+     * Directories are always listed.  An empty pattern lists all files.
+     */
+    void filter(const std::string& pattern);
+
+    /**
+     * Get the file filter pattern.
+     */
+    EGT_NODISCARD std::string filter() const;
+
     void serialize(Serializer& serializer) const override;
 
+    ~FileDialog() noexcept override;
+
 protected:
     /// List Box for file listing.
-    std::shared_ptr<ListBox> m_flist;
+    std::shared_ptr<VirtualListBox> m_flist;
 
     /// File path of a directory.
     std::string m_filepath;
 
-    /// List the contents of file path directory.
+    /**
+     * List the contents of file path directory.
+     *
+     * This only starts listing it, entries are added as they are read.
+     *
+     * @return false if the directory does not exist.
+     */
     bool list_files(const std::string& filepath);
 
+    /// Stop listing files and empty the list.
+    void clear_files();
+
     /// Get the List Item selected index.
     void list_item_selected(int index);
 
@@ -124,6 +155,15 @@ private:
     void initialize();
 
     void deserialize(Serializer::Properties& props);
+
+    /// Update the list with the entries read.
+    void update_files();
+
+    /// Number of entries before the directory entries, "./" and "../".
+    size_t m_fixed_entries{0};
+
+    /// Lists directories on a worker thread.
+    std::unique_ptr<detail::DirectoryScanner> m_scanner;
 };
 
 /**
@@ -11,12 +11,14 @@
  * @brief Working with fonts.
  */
 
+#include <egt/detail/lrucache.h>
 #include <egt/detail/math.h>
 #include <egt/serialize.h>
 #include <egt/types.h>
 #include <iosfwd>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -66,6 +68,9 @@ public:
     /// Default font slant
     static constexpr Font::Slant DEFAULT_SLANT = Font::Slant::normal;
 
+    /// Default maximum number of fonts in the font cache.
+    static constexpr size_t DEFAULT_FONT_CACHE_SIZE = 128;
+
     Font();
 
     /**
@@ -78,6 +83,9 @@ public:
     /**
      * Create a font from an in-memory font.
      *
+     * The data is not copied, and must outlive the font.  Every font created
+     * from the same data shares one FreeType face.
+     *
      * @param[in] data Raw memory to the font.
      * @param[in] len Size of bytes of the ram memory.
      * @param[in] size The size of the font.
@@ -174,7 +182,11 @@ public:
      * Generates a FontConfig scaled font instance.
      *
      * Internally, this may use a font cache to limit regeneration of the same
-     * font more than once.
+     * font more than once.  The returned font is owned by the font cache, and
+     * is only valid until it is evicted, when more fonts than
+     * font_cache_size() are used after it.  Font files are memory-mapped, and every font of
+     * the same file shares one FreeType face, so the file is only resident
+     * once however many processes and fonts use it.
      */
     EGT_NODISCARD cairo_scaled_font_t* scaled_font() const;
 
@@ -186,7 +198,7 @@ public:
     /**
      * Deserialize.
      */
-    void deserialize(const std::string& name, const std::string& value,
+    void deserialize(std::string_view name, const std::string& value,
                      const Serializer::Attributes& attrs);
 
     /**
@@ -205,6 +217,40 @@ public:
      */
     static void reset_font_cache();
 
+    /**
+     * Set the maximum number of fonts in the font cache.
+     *
+     * The least recently used fonts are evicted when there are more, so
+     * fonts of many sizes, like animated sizes, don't accumulate.  0 is no
+     * limit.  Defaults to the EGT_FONT_CACHE_SIZE environment variable if
+     * set, or DEFAULT_FONT_CACHE_SIZE.
+     */
+    static void font_cache_size(size_t fonts);
+
+    /**
+     * Get the maximum number of fonts in the font cache.
+     */
+    EGT_NODISCARD static size_t font_cache_size();
+
+    /**
+     * Get the hit, miss, and eviction counters of the font cache.
+     */
+    EGT_NODISCARD static detail::CacheStats font_cache_stats();
+
+    /**
+     * Get the size of the glyphs rasterized for the fonts of the font cache,
+     * in bytes.
+     */
+    EGT_NODISCARD static size_t font_cache_bytes();
+
+    /**
+     * Evict the least recently used fonts from the font cache, until their
+     * glyphs take at most a size in bytes.
+     *
+     * Fonts still in use are only released once no longer used.
+     */
+    static void trim_font_cache(size_t bytes);
+
     /**
      * Basically, this will clear the font cache and shutdown FontConfig which
      * will release all memory allocated by FontConfig.
@@ -216,6 +262,56 @@ public:
      */
     static void shutdown_fonts();
 
+    /**
+     * Create fonts ahead of their first use.
+     *
+     * Creating a font the first time it is used looks it up and loads its
+     * face, which stalls the first frame drawing it.  Fonts preloaded during
+     * startup are already in the font cache when drawn.
+     *
+     * This can be called from another thread than the one drawing.  Fonts
+     * created from memory are not cached, and are skipped.
+     *
+     * @param[in] fonts The fonts to create.
+     * @return The number of fonts created or already cached.
+     */
+    static size_t preload(const std::vector<Font>& fonts);
+
+    /**
+     * Create the fonts of a manifest saved by save_manifest().
+     *
+     * Fontconfig resolutions saved in the manifest are used instead of
+     * looking up the fonts again, unless their font files are gone.
+     *
+     * @param[in] manifest Path to the manifest.
+     * @return false if the manifest could not be read.
+     */
+    static bool preload(const std::string& manifest);
+
+    /**
+     * Save the fonts in the font cache, and how Fontconfig resolved them, to
+     * a manifest for preload().
+     *
+     * @param[in] manifest Path to the manifest.
+     * @return false if the manifest could not be written.
+     */
+    static bool save_manifest(const std::string& manifest);
+
+    /**
+     * Enable or disable drawing text from glyph atlases.
+     *
+     * When enabled, the glyphs of each font are rasterized once into an
+     * atlas, and drawing text blits them from it instead of rasterizing them
+     * again.  Enabled by default, unless the EGT_NO_GLYPH_ATLAS environment
+     * variable is set.
+     */
+    static void glyph_atlas(bool enable);
+
+    /**
+     * Is drawing text from glyph atlases enabled.
+     */
+    EGT_NODISCARD static bool glyph_atlas();
+
 protected:
 
     void direct_allocate();
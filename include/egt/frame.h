@@ -25,6 +25,11 @@ namespace egt
 {
 inline namespace v1
 {
+namespace detail
+{
+class HitGrid;
+}
+
 /**
  * A Frame is a Widget that has children widgets.
  *
@@ -76,8 +81,8 @@ public:
 
     Frame(const Frame&) = delete;
     Frame& operator=(const Frame&) = delete;
-    Frame(Frame&&) noexcept = default;
-    Frame& operator=(Frame&&) noexcept = default;
+    Frame(Frame&&) noexcept;
+    Frame& operator=(Frame&&) noexcept;
 
     ~Frame() noexcept override;
 
@@ -268,6 +273,28 @@ public:
      */
     Widget* hit_test(const DisplayPoint& point);
 
+    /**
+     * Enable or disable the spatial index of the subordinates.
+     *
+     * Without it, every pointer event tests the boxes of all subordinates
+     * until it finds one under the pointer.  With it, pointer events only
+     * test the few subordinates in a grid cell under the pointer, so the cost
+     * stays flat as the number of widgets grows.  The index is rebuilt on
+     * the first pointer event after widgets were added, removed, moved,
+     * resized, or reordered.
+     *
+     * This is worth it for frames with many children, like a keypad.
+     */
+    void spatial_index(bool enable);
+
+    /**
+     * Is the spatial index of the subordinates enabled.
+     */
+    EGT_NODISCARD bool spatial_index() const
+    {
+        return !!m_hit_grid;
+    }
+
     /**
      * Create a child widget of the specified type.
      *
@@ -300,6 +327,11 @@ public:
     /// Overridden to be called recursively on all children.
     void on_screen_resized() override;
 
+    Widget* subordinate_at(const Point& point) override;
+
+    /// Spatial index of the subordinates, when enabled.
+    std::unique_ptr<detail::HitGrid> m_hit_grid;
+
 private:
 
     void remove_all_basic();
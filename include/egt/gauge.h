@@ -11,6 +11,8 @@
  * @brief Working with gauges.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <egt/color.h>
 #include <egt/detail/math.h>
 #include <egt/detail/meta.h>
@@ -18,12 +20,20 @@
 #include <egt/image.h>
 #include <egt/widget.h>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace egt
 {
 inline namespace v1
 {
+class SvgImage;
+
+namespace detail
+{
+struct NeedleFrames;
+}
+
 namespace experimental
 {
 class Gauge;
@@ -31,6 +41,7 @@ class Gauge;
 /**
  * A layer of a Gauge.
  */
+// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions,hicpp-special-member-functions)
 class EGT_API GaugeLayer : public Widget
 {
 public:
@@ -50,6 +61,8 @@ public:
      */
     explicit GaugeLayer(Gauge& gauge, const Image& image = {}) noexcept;
 
+    ~GaugeLayer() noexcept override;
+
     void draw(Painter& painter, const Rect& rect) override;
 
     /**
@@ -59,12 +72,32 @@ public:
      *
      * @param[in] image The image to display.
      */
-    void image(const Image& image)
-    {
-        m_image = image;
-        resize(m_image.size());
-        damage();
-    }
+    void image(const Image& image);
+
+    /**
+     * Get the image of the gauge layer.
+     */
+    EGT_NODISCARD const Image& image() const { return m_image; }
+
+    /**
+     * Set the image of the gauge layer, rendered from an SVG in the
+     * background.
+     *
+     * This is the same as image(svg.render(id, rect)), except the image is
+     * rendered by a worker thread with SvgImage::render_async().  The layers
+     * of gauges are then rendered at the same time on multicore processors,
+     * which shortens the start of an application.
+     *
+     * The layer is resized right away, and is transparent until the image is
+     * rendered.  The SvgImage does not have to outlive the rendering.
+     *
+     * @note Only available when EGT is built with librsvg.
+     *
+     * @param[in] svg The SVG.
+     * @param[in] id Optional id of the SVG element to render.
+     * @param[in] rect Optional rect to clip to.
+     */
+    void image(const SvgImage& svg, const std::string& id = {}, const RectF& rect = {});
 
     void mask_color(const Color& color)
     {
@@ -102,6 +135,9 @@ protected:
     /// Optional mask color
     Color m_mask_color;
 
+    /// Id of the image being rendered in the background, or 0.
+    uint64_t m_render{0};
+
     friend class Gauge;
 };
 
@@ -237,10 +273,18 @@ public:
 
         if (!detail::float_equal(m_value, value))
         {
-            damage(rectangle_of_rotated());
+            const auto prev = drawn_value();
+            const auto rect = rectangle_of_rotated();
             m_value = value;
+
+            // with pre-rotated frames, the needle may not move
+            if (!detail::float_equal(prev, drawn_value()))
+            {
+                damage(rect);
+                damage(rectangle_of_rotated());
+            }
+
             on_value_changed.invoke();
-            damage(rectangle_of_rotated());
         }
 
         return orig;
@@ -308,10 +352,43 @@ public:
             damage();
     }
 
+    /**
+     * Draw the needle from pre-rotated frames, instead of rotating its image
+     * on every draw.
+     *
+     * The needle is rendered once at a number of angles, evenly spread over
+     * its range, into an atlas.  Drawing then copies the frame nearest to the
+     * value, which on boards without a GPU costs much less than resampling a
+     * rotated image.  The frames are rendered again if the image or the
+     * geometry of the needle changes.
+     *
+     * @param[in] steps Number of frames over the range of the needle, or 0
+     *            to rotate the image on every draw, which is the default.
+     *            Values are integers, so more than max() - min() + 1 frames
+     *            are never used.
+     * @param[in] max_bytes Memory budget of the atlas. Fewer frames are
+     *            rendered when they do not fit.
+     */
+    void prerotate(size_t steps, size_t max_bytes = 4 * 1024 * 1024);
+
+    /**
+     * Get the number of pre-rotated frames requested, or 0 if none.
+     */
+    EGT_NODISCARD size_t prerotate() const { return m_steps; }
+
 protected:
 
     Rect rectangle_of_rotated();
 
+    /// Number of frames that fit in the memory budget, or 0 for none.
+    EGT_NODISCARD size_t frame_steps() const;
+
+    /// The value drawn, which is the value of the nearest frame, if any.
+    EGT_NODISCARD float drawn_value() const;
+
+    /// Get the pre-rotated frames, rendering them if needed.
+    const detail::NeedleFrames* frames();
+
     /// @private
     void gauge(Gauge* gauge) override;
 
@@ -338,6 +415,15 @@ protected:
 
     /// Rotate point of the needle on the gauge.
     PointF m_point;
+
+    /// Number of pre-rotated frames requested.
+    size_t m_steps{0};
+
+    /// Memory budget of the pre-rotated frames.
+    size_t m_max_bytes{0};
+
+    /// Pre-rotated frames.
+    std::shared_ptr<detail::NeedleFrames> m_frames;
 };
 
 /**
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_GPIO_H
+#define EGT_GPIO_H
+
+/**
+ * @file
+ * @brief GPIO line events.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <egt/fdmonitor.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace egt
+{
+inline namespace v1
+{
+
+/**
+ * Change of the level of a GPIO line.
+ */
+struct GpioEvent
+{
+    /// Offset of the line on its chip.
+    uint32_t line{0};
+    /// Level of the line after the change.
+    bool value{false};
+    /**
+     * Time the kernel saw the edge, on the CLOCK_MONOTONIC clock since
+     * Linux 5.7, CLOCK_REALTIME before.
+     *
+     * With debouncing, this is the time of the last edge before the line
+     * settled.
+     */
+    std::chrono::nanoseconds timestamp{};
+};
+
+/**
+ * Reports the changes of the level of a GPIO line, like a hardware button,
+ * through the GPIO character device.
+ *
+ * Edges are read with their kernel timestamp, all the ones pending at once,
+ * and handled in the event loop with the priority of input devices, so
+ * before timers and drawing.
+ *
+ * With debouncing, a change is only reported once the line kept its level
+ * for the debounce time after the last edge.
+ *
+ * @code{.cpp}
+ * egt::GpioMonitor button("/dev/gpiochip0", 29, [](const egt::GpioEvent& event)
+ * {
+ *     ...
+ * }, egt::GpioMonitor::Edge::falling, std::chrono::milliseconds(10));
+ * @endcode
+ */
+class EGT_API GpioMonitor : private detail::NonCopyable<GpioMonitor>
+{
+public:
+
+    /// Changes to report.
+    enum class Edge
+    {
+        /// From low to high.
+        rising,
+        /// From high to low.
+        falling,
+        /// Both.
+        both,
+    };
+
+    /// Called in the event loop for each change.
+    using Callback = std::function<void(const GpioEvent& event)>;
+
+    /**
+     * @param[in] chip GPIO character device, like /dev/gpiochip0.
+     * @param[in] line Offset of the line on the chip.
+     * @param[in] callback Called for each change.
+     * @param[in] edge Changes to report.
+     * @param[in] debounce Time the line must keep its level, or 0 to
+     *            report every edge.
+     * @throws std::runtime_error if the line cannot be requested.
+     */
+    GpioMonitor(const std::string& chip, uint32_t line, Callback callback,
+                Edge edge = Edge::both,
+                std::chrono::microseconds debounce = {});
+
+    /// Get the offset of the line.
+    EGT_NODISCARD uint32_t line() const { return m_line; }
+
+    /// Get the level of the line last reported, or read when created.
+    EGT_NODISCARD bool value() const { return m_value; }
+
+    ~GpioMonitor() noexcept;
+
+private:
+
+    /// Read the pending edges.
+    void read();
+
+    /// Read the level of the line, once it settled.
+    void settle();
+
+    /// Report a level, if it changed.
+    void report(bool value, std::chrono::nanoseconds timestamp);
+
+    /// Read the level of the line.
+    bool read_value() const;
+
+    uint32_t m_line;
+    Callback m_callback;
+    Edge m_edge;
+    std::chrono::microseconds m_debounce;
+    bool m_value{false};
+    /// Time of the last edge, while settling.
+    std::chrono::nanoseconds m_edge_time{};
+    std::unique_ptr<asio::steady_timer> m_timer;
+    std::unique_ptr<FdMonitor> m_monitor;
+};
+
+}
+}
+
+#endif
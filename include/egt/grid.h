@@ -312,6 +312,23 @@ protected:
      */
     void reposition();
 
+    /**
+     * Get the rectangle of a cell, relative to the content area.
+     *
+     * Cells all have the same size, so this does not depend on the other
+     * cells.
+     */
+    EGT_NODISCARD Rect cell_rect(size_t column, size_t row) const;
+
+    /**
+     * Get the cell at a point relative to the content area.
+     *
+     * @param[in] point The point.
+     * @param[out] cell The cell, when there is one.
+     * @return false if the point is in a space between cells or outside.
+     */
+    bool cell_at(const Point& point, GridPoint& cell) const;
+
     /// Type for cell array.
     using CellArray = std::vector<std::vector<std::weak_ptr<Widget>>>;
 
@@ -333,6 +350,15 @@ protected:
 
 private:
 
+    /// Position of a cell in the order add() fills cells.
+    EGT_NODISCARD size_t fill_index(size_t column, size_t row) const;
+
+    /// Cells before this position in the fill order are used.
+    size_t m_fill_hint{0};
+
+    /// Column priority m_fill_hint was computed with.
+    bool m_fill_priority{false};
+
     void deserialize(Serializer::Properties& props);
 };
 
@@ -442,6 +468,9 @@ protected:
     /// Dimension of the highlight border.
     DefaultDim m_selection_highlight{5};
 
+    /// Rectangle of the selected cell to damage, empty without highlight.
+    EGT_NODISCARD Rect selected_box() const;
+
     explicit SelectableGrid(Serializer::Properties& props, bool is_derived);
 
 private:
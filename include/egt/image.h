@@ -182,6 +182,18 @@ public:
         return !surface();
     }
 
+    /**
+     * Is the image opaque.
+     *
+     * An opaque image has no alpha channel, so drawing it replaces what is
+     * under it.  Images loaded without transparency are opaque.
+     */
+    EGT_NODISCARD bool opaque() const
+    {
+        return !empty() &&
+               cairo_surface_get_content(surface().get()) == CAIRO_CONTENT_COLOR;
+    }
+
     /**
      * Get a reference to the internal image surface.
      */
@@ -252,6 +264,12 @@ public:
 
     void reset_uri() { uri({}); }
 
+    /**
+     * Copy a region of the image to a new image.
+     *
+     * This needs the whole image to be loaded.  To load only the region of an
+     * image, see detail::load_image_region().
+     */
     Image crop(const RectF& rect);
 
     Image crop(const Rect& rect)
@@ -267,7 +285,7 @@ public:
     /**
      * Deserialized property.
      */
-    void deserialize(const std::string& name, const std::string& value,
+    void deserialize(std::string_view name, const std::string& value,
                      const Serializer::Attributes& attrs);
 
 protected:
@@ -31,7 +31,7 @@ public:
     bool reset(Palette::GroupId group);
 
     void serialize(Serializer& serializer) const;
-    bool deserialize(const std::string& name, const std::string& value);
+    bool deserialize(std::string_view name, const std::string& value);
 
 private:
 
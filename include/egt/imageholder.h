@@ -12,6 +12,8 @@
  */
 
 #include "egt/detail/alignment.h"
+#include <cstdint>
+#include <egt/detail/imagecache.h>
 #include <egt/detail/meta.h>
 #include <egt/frame.h>
 #include <egt/geometry.h>
@@ -21,12 +23,15 @@
 #include <egt/text.h>
 #include <egt/textwidget.h>
 #include <egt/widget.h>
+#include <type_traits>
 
 namespace egt
 {
 inline namespace v1
 {
 
+class Button;
+
 template<class T,
          Palette::ColorId id_bg,
          Palette::ColorId id_border,
@@ -120,7 +125,10 @@ public:
     ImageHolder(ImageHolder&&) noexcept = default;
     ImageHolder& operator=(ImageHolder&&) noexcept = default;
 
-    virtual ~ImageHolder() = default;
+    virtual ~ImageHolder()
+    {
+        detail::image_cache().cancel(m_image_request);
+    }
 
     EGT_NODISCARD std::string type() const override
     {
@@ -143,6 +151,7 @@ public:
      */
     void uri(const std::string& uri)
     {
+        cancel_image_async();
         m_image.uri(uri);
         refresh();
     }
@@ -152,6 +161,7 @@ public:
      */
     void reset_uri()
     {
+        cancel_image_async();
         m_image.reset_uri();
         refresh();
     }
@@ -214,9 +224,54 @@ public:
      */
     void image(const Image& image)
     {
+        cancel_image_async();
         do_set_image(image);
     }
 
+    /**
+     * Load a new image in the background.
+     *
+     * The image is decoded by a worker thread, so loading many or large
+     * images does not block the event loop.  The placeholder is shown until
+     * the image is loaded, and then the image is shown.  If the image can't
+     * be loaded, the placeholder stays.
+     *
+     * Setting another image before it is loaded cancels it.
+     *
+     * @param[in] uri Resource path. @see @ref resources
+     * @param[in] hscale Horizontal scale of the image, with 1.0 being 100%.
+     * @param[in] vscale Vertical scale of the image, with 1.0 being 100%.
+     * @param[in] placeholder The image shown until loaded.  Allowed to be empty.
+     *
+     * @see detail::ImageCache::prefetch().
+     */
+    void image_async(const std::string& uri,
+                     float hscale = 1.0, float vscale = 1.0,
+                     const Image& placeholder = {})
+    {
+        cancel_image_async();
+        do_set_image(placeholder);
+
+        m_image_request = detail::image_cache().prefetch(uri, hscale, vscale, false,
+                          [this, uri, hscale, vscale](const shared_cairo_surface_t & surface)
+        {
+            m_image_request = 0;
+            if (!surface)
+                return;
+
+            // now a hit in the image cache
+            Image image;
+            image.load(uri, hscale, vscale);
+            do_set_image(image);
+            this->parent_layout();
+        });
+    }
+
+    /**
+     * Is an image loaded by image_async() not shown yet.
+     */
+    EGT_NODISCARD bool image_loading() const { return m_image_request != 0; }
+
     /**
      * Scale the image.
      *
@@ -316,7 +371,10 @@ public:
     void image_align(const AlignFlags& align)
     {
         if (detail::change_if_diff<>(m_image_align, align))
+        {
+            this->invalidate_size_hint();
             this->damage();
+        }
     }
 
     /**
@@ -342,6 +400,12 @@ public:
 
     void draw(Painter& painter, const Rect& rect) override
     {
+        if constexpr (std::is_base_of<Button, T>::value)
+        {
+            if (this->draw_state(painter, rect))
+                return;
+        }
+
         Drawer<ImageHolder>::draw(*this, painter, rect);
     }
 
@@ -359,6 +423,7 @@ public:
             if (!widget.image().empty())
             {
                 detail::draw_text(painter,
+                                  widget.text_run(),
                                   widget.content_area(),
                                   text,
                                   widget.font(),
@@ -372,6 +437,7 @@ public:
             else
             {
                 detail::draw_text(painter,
+                                  widget.text_run(),
                                   widget.content_area(),
                                   text,
                                   widget.font(),
@@ -401,10 +467,18 @@ protected:
 
     void refresh()
     {
+        this->invalidate_size_hint();
         this->damage();
         this->layout();
     }
 
+    /// Cancel loading an image with image_async().
+    void cancel_image_async()
+    {
+        detail::image_cache().cancel(m_image_request);
+        m_image_request = 0;
+    }
+
     /// @private
     void do_set_image(const Image& image)
     {
@@ -412,6 +486,7 @@ protected:
             this->resize(image.size() + Size(this->moat() * 2, this->moat() * 2));
 
         m_image = image;
+        this->invalidate_size_hint();
         this->damage();
     }
 
@@ -498,6 +573,9 @@ protected:
 
     /// Alignment of the image relative to the text.
     AlignFlags m_image_align{AlignFlag::left | AlignFlag::expand};
+
+    /// Id of the callback of the image loaded by image_async(), or 0.
+    uint64_t m_image_request{0};
 };
 
 }
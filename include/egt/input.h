@@ -11,11 +11,13 @@
  * @brief Working with input devices.
  */
 
+#include <chrono>
 #include <egt/detail/meta.h>
 #include <egt/event.h>
 #include <egt/object.h>
 #include <egt/signal.h>
 #include <memory>
+#include <vector>
 
 namespace egt
 {
@@ -68,15 +70,84 @@ public:
         return m_global_handler;
     }
 
+    /**
+     * Dispatch the pointer motion held back by motion coalescing, of all
+     * inputs.
+     *
+     * Called by EventLoop::draw() before every frame.
+     *
+     * @see EventLoop::coalesce_motion()
+     */
+    static void flush_motion();
+
+    /**
+     * Get the points of the EventId::raw_pointer_move events merged into the
+     * event being dispatched, oldest first.
+     *
+     * The last point is the point of the event itself.  This is only valid
+     * while a coalesced event is being dispatched, and otherwise empty.
+     */
+    static const std::vector<DisplayPoint>& motion_history();
+
+    /**
+     * Predict where the pointer will be.
+     *
+     * Extrapolates the velocity of the recent pointer motion of any input,
+     * so a drag that is drawn one frame late can be drawn where the pointer
+     * will be when the frame reaches the display.  Without pointer motion
+     * since the last press, this is the last known point.
+     *
+     * @param[in] ahead How far ahead to predict, at most 100 ms.
+     */
+    static DisplayPoint predict_pointer(std::chrono::microseconds ahead);
+
     virtual ~Input() noexcept;
 
 protected:
 
     /**
      * Dispatch an event from this input.
+     *
+     * With motion coalescing enabled, EventId::raw_pointer_move events are
+     * held back and merged, keeping the latest point, until the next frame
+     * or the next event of another kind.
      */
     virtual void dispatch(Event& event);
 
+    /**
+     * Dispatch an event right away, without coalescing.
+     *
+     * @param[in] event The event.
+     * @param[in] when When the device reported the event.
+     */
+    void dispatch_now(Event& event, std::chrono::steady_clock::time_point when);
+
+    /**
+     * Dispatch an event right away, without coalescing, reported now.
+     */
+    void dispatch_now(Event& event)
+    {
+        dispatch_now(event, std::chrono::steady_clock::now());
+    }
+
+    /**
+     * Dispatch the pointer motion held back by coalescing, if any.
+     */
+    void dispatch_motion();
+
+    /**
+     * Set the time the device reported the next event to dispatch.
+     *
+     * Backends call this with the kernel time of the event, from the
+     * monotonic clock std::chrono::steady_clock uses, so the time it took to
+     * reach the display can be measured.  Without it, the time of dispatch
+     * is used.
+     */
+    void timestamp(std::chrono::steady_clock::time_point when)
+    {
+        m_timestamp = when;
+    }
+
     /**
      * This is the single global input handler.  Anything can attach to this
      * object and receive all events unfiltered.
@@ -94,6 +165,31 @@ protected:
      * Currently dispatching an event when true.
      */
     bool m_dispatching{false};
+
+    /**
+     * Latest EventId::raw_pointer_move held back by coalescing.
+     */
+    Event m_motion;
+
+    /**
+     * When the device reported the latest held back motion event.
+     */
+    std::chrono::steady_clock::time_point m_motion_time{};
+
+    /**
+     * Points of the held back motion events, oldest first.
+     */
+    std::vector<DisplayPoint> m_motion_history;
+
+    /**
+     * Is motion being held back.
+     */
+    bool m_motion_pending{false};
+
+    /**
+     * Time set by timestamp() for the next event.
+     */
+    std::chrono::steady_clock::time_point m_timestamp{};
 };
 
 namespace detail
@@ -124,6 +220,46 @@ EGT_API void keyboard_focus(Widget* widget);
  */
 EGT_API Widget* keyboard_focus();
 
+/**
+ * Get the widget the keyboard focus moves to from a widget.
+ *
+ * This follows the order of the focusable widgets of the window of the
+ * widget, wrapping around at its ends, and skips disabled and readonly
+ * widgets.  It does not search the widget tree.
+ *
+ * @param[in] widget The widget to start from.
+ * @param[in] backward Move to the previous widget instead of the next one.
+ * @return The widget, or nullptr if no other widget can take the focus.
+ *
+ * @see Widget::focusable()
+ */
+EGT_API Widget* next_focus(const Widget& widget, bool backward = false);
+
+/**
+ * Move the keyboard focus to the next, or previous, focusable widget.
+ *
+ * Without a focused widget, the focus moves to the first, or last, focusable
+ * widget of the modal window or else of the top visible window.
+ *
+ * @param[in] backward Move to the previous widget instead of the next one.
+ * @return The widget with the keyboard focus.
+ */
+EGT_API Widget* move_focus(bool backward = false);
+
+/**
+ * Set the keys that move the keyboard focus.
+ *
+ * These keys are handled before the events are dispatched to the widget
+ * with the focus.  When both keys are the same, the previous widget is
+ * selected with the key and the shift modifier.  By default, this is
+ * EKEY_TAB, like a keyboard, but a keypad or a rotary encoder can use any
+ * other keys.
+ *
+ * @param[in] next Key moving the focus to the next widget.
+ * @param[in] previous Key moving the focus to the previous widget.
+ */
+EGT_API void focus_keys(KeyboardCode next, KeyboardCode previous);
+
 /**
  * Get the current widget which is being dragged, or nullptr.
  */
@@ -18,7 +18,9 @@
 #include <egt/string.h>
 #include <egt/view.h>
 #include <egt/widget.h>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -195,6 +197,16 @@ public:
      */
     void scroll_end();
 
+    /**
+     * Enable kinetic scrolling, see ScrolledView::kinetic().
+     */
+    void kinetic(bool enable) { m_view.kinetic(enable); }
+
+    /**
+     * Returns true if kinetic scrolling is enabled.
+     */
+    EGT_NODISCARD bool kinetic() const { return m_view.kinetic(); }
+
     /**
      * Set the orientation of the list: either vertical or horizontal.
      */
@@ -228,6 +240,183 @@ private:
     void deserialize(Serializer::Properties& props);
 };
 
+/**
+ * ListBox for a large number of items, provided on demand.
+ *
+ * Instead of a widget for each item, a VirtualListBox only has the
+ * StringItem widgets needed to fill its height.  When it is scrolled, the
+ * widgets of the items scrolled out are reused for the items scrolled in,
+ * and a binder function sets them up for their new item.  So the time to
+ * create the list and the memory it uses do not depend on the number of
+ * items.
+ *
+ * All items have the same height.
+ *
+ * @code{.cpp}
+ * std::vector<std::string> lines = ...;
+ * egt::VirtualListBox list(lines.size(), [&lines](egt::StringItem& item, size_t index)
+ * {
+ *     item.text(lines[index]);
+ * });
+ * @endcode
+ *
+ * @ingroup controls
+ *
+ * @note This interface only supports a vertical Orientation.
+ */
+class EGT_API VirtualListBox : public Widget
+{
+public:
+
+    /**
+     * Event signal.
+     * @{
+     */
+    /**
+     * Invoked when the selection changes.
+     */
+    Signal<> on_selected_changed;
+
+    /**
+     * Invoked when an item is selected with the index of the item selected.
+     */
+    Signal<size_t> on_selected;
+
+    /**
+     * Invoked when the number of items changes.
+     */
+    Signal<> on_items_changed;
+    /** @} */
+
+    /**
+     * Function setting up the widget of an item.
+     *
+     * @param item Widget to set up, previously used for any other item.
+     * @param index Index of the item.
+     */
+    using ItemBinder = std::function<void(StringItem& item, size_t index)>;
+
+    /**
+     * @param[in] count Number of items.
+     * @param[in] binder Function setting up the widget of an item.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    explicit VirtualListBox(size_t count = 0, ItemBinder binder = {},
+                            const Rect& rect = {}) noexcept;
+
+    /**
+     * @param[in] parent The parent Frame.
+     * @param[in] count Number of items.
+     * @param[in] binder Function setting up the widget of an item.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    VirtualListBox(Frame& parent, size_t count, ItemBinder binder,
+                   const Rect& rect = {}) noexcept;
+
+    void handle(Event& event) override;
+
+    void resize(const Size& s) override;
+
+    /**
+     * Set the number of items.
+     *
+     * The items shown are set up again.
+     */
+    void item_count(size_t count);
+
+    /**
+     * Return the number of items in the list.
+     */
+    EGT_NODISCARD size_t item_count() const { return m_count; }
+
+    /**
+     * Set the function setting up the widget of an item.
+     */
+    void binder(ItemBinder binder);
+
+    /**
+     * Set the height of the items.
+     */
+    void item_height(DefaultDim height);
+
+    /**
+     * Get the height of the items.
+     */
+    EGT_NODISCARD DefaultDim item_height() const { return m_item_height; }
+
+    /**
+     * Set up the items shown again, i.e. when the data they show changed.
+     */
+    void refresh();
+
+    /**
+     * Select an item by index.
+     */
+    void selected(size_t index);
+
+    /**
+     * Get the currently selected index.
+     *
+     * @return The selected index, or -1 if there is no selection.
+     */
+    EGT_NODISCARD ssize_t selected() const { return m_selected; }
+
+    /**
+     * Scroll so that an item is at the top of the list, or as close as
+     * possible.
+     */
+    void scroll_to(size_t index);
+
+    /**
+     * Scroll all the way to the top of the list.
+     */
+    void scroll_top();
+
+    /**
+     * Scroll all the way to the bottom of the list.
+     */
+    void scroll_bottom();
+
+    /**
+     * Enable kinetic scrolling, see ScrolledView::kinetic().
+     */
+    void kinetic(bool enable) { m_view.kinetic(enable); }
+
+    /**
+     * Returns true if kinetic scrolling is enabled.
+     */
+    EGT_NODISCARD bool kinetic() const { return m_view.kinetic(); }
+
+protected:
+
+    /// Bind and place the widgets of the items shown.
+    void update_rows(bool rebind);
+
+    /// View scrolling the canvas.
+    ScrolledView m_view;
+
+    /// Frame as high as all the items, holding the widgets of those shown.
+    Frame m_canvas;
+
+    /// Widgets of the items, reused as the list scrolls.
+    std::vector<std::shared_ptr<StringItem>> m_rows;
+
+    /// Index of the item each widget is set up for.
+    std::vector<size_t> m_bound;
+
+    /// Function setting up the widget of an item.
+    ItemBinder m_binder;
+
+    /// Number of items.
+    size_t m_count{0};
+
+    /// Height of an item.
+    DefaultDim m_item_height{40};
+
+    /// Index of the selected item, or -1.
+    ssize_t m_selected{-1};
+};
+
 }
 }
 
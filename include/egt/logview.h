@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_LOGVIEW_H
+#define EGT_LOGVIEW_H
+
+/**
+ * @file
+ * @brief Working with log views.
+ */
+
+#include <egt/detail/meta.h>
+#include <egt/slider.h>
+#include <egt/textwidget.h>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Frame;
+class Painter;
+
+/**
+ * A read-only view of appended lines of text, like a console.
+ *
+ * Lines are kept in a ring buffer of max_lines(), dropping the oldest ones
+ * when full, so memory is bounded however long the view runs.  Lines all
+ * have the height of the font, so only the lines in view are drawn, and
+ * appending costs the same no matter how many lines there are.
+ *
+ * A vertical slider scrolls through the lines when they don't fit.  When
+ * auto_scroll() is enabled and the last line is in view, appending keeps
+ * the last line in view.
+ *
+ * Lines are drawn like TextBox draws text, aligned left, and are not
+ * wrapped.
+ *
+ * @ingroup controls
+ */
+class EGT_API LogView : public TextWidget
+{
+public:
+
+    /// Default maximum number of lines.
+    static constexpr size_t DEFAULT_MAX_LINES = 1000;
+
+    /**
+     * @param[in] rect Initial rectangle of the widget.
+     * @param[in] max_lines Maximum number of lines kept.
+     */
+    explicit LogView(const Rect& rect = {},
+                     size_t max_lines = DEFAULT_MAX_LINES) noexcept;
+
+    /**
+     * @param[in] parent The parent Frame.
+     * @param[in] rect Initial rectangle of the widget.
+     * @param[in] max_lines Maximum number of lines kept.
+     */
+    explicit LogView(Frame& parent,
+                     const Rect& rect = {},
+                     size_t max_lines = DEFAULT_MAX_LINES) noexcept;
+
+    /**
+     * @param[in] props list of widget argument and its properties.
+     */
+    explicit LogView(Serializer::Properties& props) noexcept
+        : LogView(props, false)
+    {
+    }
+
+protected:
+
+    explicit LogView(Serializer::Properties& props, bool is_derived) noexcept;
+
+public:
+
+    LogView(const LogView&) = delete;
+    LogView& operator=(const LogView&) = delete;
+    LogView(LogView&&) = delete;
+    LogView& operator=(LogView&&) = delete;
+    ~LogView() noexcept override = default;
+
+    /**
+     * Append text.
+     *
+     * Every newline starts a new line, and text after the last one
+     * continues the last line.
+     *
+     * @param[in] str The text to append.
+     */
+    void append(const std::string& str);
+
+    /// Replace all lines with the lines of a text.
+    void text(const std::string& str) override;
+
+    /// Get all lines, joined by newlines.
+    EGT_NODISCARD const std::string& text() const override;
+
+    /// Get the length of text().
+    EGT_NODISCARD size_t len() const override;
+
+    /// Remove all lines.
+    void clear() override;
+
+    /// Get the number of lines.
+    EGT_NODISCARD size_t line_count() const { return m_count; }
+
+    /// Get a line, from the oldest one.
+    EGT_NODISCARD const std::string& line(size_t index) const;
+
+    /// Get the maximum number of lines kept.
+    EGT_NODISCARD size_t max_lines() const { return m_lines.size(); }
+
+    /**
+     * Set the maximum number of lines kept.
+     *
+     * The oldest lines are dropped if there are more.
+     */
+    void max_lines(size_t max);
+
+    /// Enable or disable keeping the last line in view when appending.
+    void auto_scroll(bool enable) { m_auto_scroll = enable; }
+
+    /// Is the last line kept in view when appending.
+    EGT_NODISCARD bool auto_scroll() const { return m_auto_scroll; }
+
+    /// Scroll to the last line.
+    void scroll_to_end();
+
+    /// Get the index of the first line in view.
+    EGT_NODISCARD size_t first_visible_line() const;
+
+    /// Get the number of lines that fit in view.
+    EGT_NODISCARD size_t visible_lines() const;
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    void resize(const Size& size) override;
+
+    using TextWidget::min_size_hint;
+
+    EGT_NODISCARD Size min_size_hint() const override;
+
+    void serialize(Serializer& serializer) const override;
+
+protected:
+
+    /// Get a line, from the oldest one.
+    std::string& entry(size_t index)
+    {
+        return m_lines[(m_head + index) % m_lines.size()];
+    }
+
+    /// Add a line, dropping the oldest one when full.
+    void push_line(std::string str);
+
+    /// Return the rectangle where lines are drawn.
+    EGT_NODISCARD Rect text_area() const;
+
+    /// Get the height of a line with the current font.
+    EGT_NODISCARD DefaultDim line_height() const;
+
+    /// Update the range and the visibility of the slider.
+    void update_slider();
+
+    /// Damage lines from index to the last one, but only if in view.
+    void damage_lines(size_t index);
+
+    /// Ring buffer of lines.
+    std::vector<std::string> m_lines;
+
+    /// Index of the oldest line in m_lines.
+    size_t m_head{0};
+
+    /// Number of lines in m_lines.
+    size_t m_count{0};
+
+    /// Is the last line not ended by a newline yet.
+    bool m_partial{false};
+
+    /// Keep the last line in view when appending.
+    bool m_auto_scroll{true};
+
+    /// Cache for text().
+    mutable std::string m_joined;
+    mutable bool m_joined_valid{false};
+
+    /// Vertical slider shown when lines don't fit.
+    Slider m_slider;
+
+    /// Width of the slider when shown.
+    DefaultDim m_slider_dim{8};
+
+private:
+
+    void initialize(size_t max_lines);
+
+    void deserialize(Serializer::Properties& props);
+};
+
+}
+}
+
+#endif
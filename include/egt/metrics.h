@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_METRICS_H
+#define EGT_METRICS_H
+
+/**
+ * @file
+ * @brief System and frame metrics.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <egt/timer.h>
+#include <memory>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+/**
+ * Metrics of the system and of the application, sampled by MetricsSampler.
+ *
+ * Rates and usages are over the interval since the previous sample.
+ */
+struct SystemMetrics
+{
+    /// Usage of all CPUs, from 0 to 100.
+    double cpu{0};
+    /// Usage of each CPU, from 0 to 100.
+    std::vector<double> cores;
+    /// Memory of the system, in bytes.
+    uint64_t memory_total{0};
+    /// Memory available without swapping, in bytes.
+    uint64_t memory_available{0};
+    /// Heap allocated by the application, in bytes, or 0 if unknown.
+    uint64_t heap{0};
+    /// Frames flipped per second.
+    double fps{0};
+    /// Pixels damaged per frame.
+    double damaged_pixels{0};
+    /// Event loop wakeups per second.
+    double wakeups{0};
+    /**
+     * Usage of the busiest GPU or 2D engine used by the application, from 0
+     * to 100, or -1 if the driver does not report it.
+     */
+    double gpu{-1};
+    /// Time of the sample.
+    std::chrono::steady_clock::time_point when{};
+
+    /// Get the memory used, from 0 to 100.
+    EGT_NODISCARD double memory_usage() const
+    {
+        return memory_total ?
+               100. * (memory_total - memory_available) / memory_total : 0.;
+    }
+};
+
+/**
+ * Samples SystemMetrics periodically.
+ *
+ * The files sampled, /proc/stat, /proc/meminfo, and the DRM fdinfo of the
+ * application, are opened once and read with a single pread() each, so a
+ * sample does not parse anything but the numbers used, and allocates
+ * nothing.  Frame metrics come from the Screen and the EventLoop of the
+ * Application, without resetting their statistics.
+ *
+ * All metrics are published by one sample, so a widget showing them, like
+ * an overlay, updates once per interval.
+ *
+ * @code{.cpp}
+ * egt::experimental::MetricsSampler sampler;
+ * sampler.on_update([&label](const egt::experimental::SystemMetrics& metrics)
+ * {
+ *     label.text(std::to_string(metrics.cpu));
+ * });
+ * sampler.start();
+ * @endcode
+ */
+class EGT_API MetricsSampler
+{
+public:
+
+    /**
+     * Invoked after each sample.
+     */
+    Signal<const SystemMetrics&> on_update;
+
+    /**
+     * @param[in] interval Time between samples.
+     */
+    explicit MetricsSampler(std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+    MetricsSampler(const MetricsSampler&) = delete;
+    MetricsSampler& operator=(const MetricsSampler&) = delete;
+
+    /// Start sampling periodically.
+    void start();
+
+    /// Stop sampling.
+    void stop();
+
+    /// Take a sample now, and invoke on_update.
+    void sample();
+
+    /// Get the last sample.
+    EGT_NODISCARD const SystemMetrics& metrics() const { return m_metrics; }
+
+    ~MetricsSampler() noexcept;
+
+private:
+
+    struct Impl;
+
+    SystemMetrics m_metrics;
+    PeriodicTimer m_timer;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_NETWORK_EVENTSOURCE_H
+#define EGT_NETWORK_EVENTSOURCE_H
+
+/**
+ * @file
+ * @brief Working with server-sent events.
+ */
+
+#include <chrono>
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace egt
+{
+inline namespace v1
+{
+
+template<class T>
+class Observable;
+
+namespace detail
+{
+struct EventSourceImpl;
+}
+
+namespace experimental
+{
+
+/**
+ * An event received by an EventSource.
+ *
+ * The views are only valid during the call of the handlers.
+ */
+struct EventSourceMessage
+{
+    /// Type of the event, "message" if the server did not name it.
+    std::string_view event;
+    /// Data of the event, lines joined with '\n'.
+    std::string_view data;
+    /// Last event ID received.
+    std::string_view id;
+};
+
+/**
+ * A server-sent events (text/event-stream) client, on the event loop.
+ *
+ * The server keeps the response open and pushes events as they happen, so
+ * there is no polling.  The request is an HttpClientRequest, handled by the
+ * event loop like any other event.  When the connection is lost, it is opened
+ * again after the retry delay, with the Last-Event-ID header so the server
+ * can send the events missed.
+ *
+ * Events are parsed as the data is received: the data of an event held in a
+ * single line of a received chunk is passed to on_message without a copy.
+ *
+ * Events update widgets through an Observable bound with bind(): however
+ * many events arrive between two frames, the widgets are updated once.
+ *
+ * @code{.cpp}
+ * egt::Observable<std::string> temperature;
+ * egt::bind(temperature, label);
+ *
+ * egt::experimental::EventSource source;
+ * source.bind("temperature", temperature);
+ * source.open("https://example.com/events");
+ * @endcode
+ */
+class EGT_API EventSource
+{
+public:
+
+    /**
+     * Event signal.
+     * @{
+     */
+    /// Invoked once the stream is open.
+    Signal<> on_open;
+
+    /// Invoked with each event received.
+    Signal<const EventSourceMessage&> on_message;
+
+    /// Invoked when the stream fails or ends.
+    Signal<const std::string&> on_error;
+    /** @} */
+
+    EventSource();
+
+    EventSource(const EventSource&) = delete;
+    EventSource& operator=(const EventSource&) = delete;
+
+    /**
+     * Open the stream, closing the current one.
+     *
+     * @param[in] url URL of the stream.
+     */
+    void open(const std::string& url);
+
+    /**
+     * Close the stream, it is not opened again.
+     */
+    void close();
+
+    /**
+     * Is the stream open.
+     */
+    EGT_NODISCARD bool is_open() const;
+
+    /**
+     * Add a header to the request, before calling open().
+     *
+     * @param[in] name Name of the header.
+     * @param[in] value Value of the header.
+     */
+    void header(const std::string& name, const std::string& value);
+
+    /**
+     * Set the data of events of a type to an Observable.
+     *
+     * The Observable must outlive the EventSource.
+     *
+     * @param[in] event Type of the events, "message" for unnamed events.
+     * @param[in] value Observable set with the data of each event.
+     */
+    void bind(const std::string& event, Observable<std::string>& value);
+
+    /**
+     * Set the delay before opening the stream again when it is lost.
+     *
+     * By default 3 s, and the server can change it with a retry field.
+     */
+    void retry(std::chrono::milliseconds delay);
+
+    /**
+     * Get the last event ID received.
+     */
+    EGT_NODISCARD std::string last_event_id() const;
+
+    ~EventSource() noexcept;
+
+protected:
+
+    /// Implementation pointer.
+    std::shared_ptr<detail::EventSourceImpl> m_impl;
+};
+
+}
+}
+}
+
+#endif
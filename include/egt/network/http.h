@@ -11,6 +11,8 @@
  * @brief Working with http.
  */
 
+#include <chrono>
+#include <cstddef>
 #include <egt/app.h>
 #include <egt/detail/meta.h>
 #include <memory>
@@ -31,12 +33,34 @@ class HttpClientRequestManager;
 namespace experimental
 {
 
+/**
+ * Statistics of the HTTP client requests.
+ *
+ * @see HttpClientRequest::stats()
+ */
+struct HttpClientStats
+{
+    /// Number of requests done.
+    size_t requests{0};
+    /// Number of connections opened, the other requests reused one.
+    size_t connections{0};
+    /// Total time of the requests, from start_async() until done.
+    std::chrono::microseconds total_time{0};
+    /// Longest time of a request.
+    std::chrono::microseconds max_time{0};
+};
+
 /**
  * An HTTP client request.
  *
  * This works as an asynchronous HTTP request handler that uses the EGT event
  * loop to process the request.
  *
+ * All requests share a pool of connections: once a request is done, its
+ * connection is kept alive and reused by the next request to the same host.
+ * HTTP/2 is negotiated over TLS, and then concurrent requests to the same host
+ * are multiplexed on a single connection.
+ *
  * @code{.cpp}
  * HttpClientRequest request("http://example.com");
  * request.start_async(url, [](const unsigned char* data, size_t len, bool done){
@@ -51,6 +75,13 @@ public:
     /// Type used for callback on read.
     using ReadCallback = std::function < void(const unsigned char* data, size_t len, bool done) >;
 
+    /**
+     * Type used for callback on streamed read.
+     *
+     * Returns false if the data cannot be consumed yet, to pause the transfer.
+     */
+    using StreamCallback = std::function < bool(const unsigned char* data, size_t len, bool done) >;
+
     /**
      * Create a request for the specified URL.
      */
@@ -63,9 +94,144 @@ public:
 
     /**
      * Start the download.
+     *
+     * When the cache_dir() is set, a response cached by a previous request of
+     * the same URL is validated with the server, and read from the cache if
+     * not modified.
      */
     virtual void start_async(const std::string& url, ReadCallback callback);
 
+    /**
+     * Start the download, with flow control.
+     *
+     * The data is passed to the callback straight from the receive buffer,
+     * without a copy, and is only valid during the call.  When the callback
+     * returns false, the transfer is paused: nothing more is received, and
+     * the same data is passed again once resume() is called, possibly from
+     * resume() itself.  So at most buffer_size() bytes are held while the
+     * consumer catches up, whatever the size of the response.
+     *
+     * A response read from the cache is passed at once, ignoring the
+     * return value.
+     */
+    void start_stream(const std::string& url, StreamCallback callback);
+
+    /**
+     * Resume a transfer paused by the StreamCallback.
+     */
+    void resume();
+
+    /**
+     * Is the transfer paused by the StreamCallback.
+     */
+    EGT_NODISCARD bool paused() const;
+
+    /**
+     * Set the size of the receive buffer, before calling start_async().
+     *
+     * This is the most data passed to the callback at once.  By default,
+     * 16 KiB.
+     */
+    void buffer_size(size_t size);
+
+    /**
+     * Set how long the transfer may stall, before calling start_async().
+     *
+     * The transfer fails when less than 10 bytes per second are received for
+     * this time.  By default 3 s, and 0 never fails, for long-lived responses
+     * where the server only sends data now and then.
+     */
+    void stall_timeout(std::chrono::seconds timeout);
+
+    /**
+     * Add a header to the request, before calling start_async().
+     *
+     * @param[in] name Name of the header.
+     * @param[in] value Value of the header.
+     */
+    void header(const std::string& name, const std::string& value);
+
+    /**
+     * Get the HTTP status code of the response, once its headers are
+     * received.
+     *
+     * This is 0 if no response was received, or for protocols other than
+     * HTTP.
+     */
+    EGT_NODISCARD long status() const;
+
+    /**
+     * Get a header of the response, once received, or an empty string.
+     *
+     * @param[in] name Name of the header, not case sensitive.
+     */
+    EGT_NODISCARD std::string response_header(const std::string& name) const;
+
+    /**
+     * Did the request succeed, once done.
+     *
+     * The transfer completed, and the response is not an HTTP error.
+     */
+    EGT_NODISCARD bool ok() const;
+
+    /**
+     * Was the response read from the cache, once done.
+     */
+    EGT_NODISCARD bool cached() const;
+
+    /**
+     * Set the directory where HTTP responses are cached.
+     *
+     * Successful responses with an ETag or Last-Modified header are saved
+     * there, keyed on the URL.  A later request of the same URL asks the
+     * server if the response was modified, and reads it from the cache if
+     * not, even in another run of the application.
+     *
+     * The directory must exist.  Empty, the default unless the
+     * EGT_HTTP_CACHE_DIR environment variable is set, disables the cache.
+     */
+    static void cache_dir(const std::string& dir);
+
+    /**
+     * Get the directory where HTTP responses are cached.
+     */
+    EGT_NODISCARD static std::string cache_dir();
+
+    /**
+     * Run the requests in a network thread.
+     *
+     * Socket I/O, TLS handshakes and the parsing of the responses are then
+     * done in a thread of their own, instead of between frames in the event
+     * loop.  The data received is passed to the callbacks in the event loop,
+     * along with the other updates from threads, right before the next
+     * frame.
+     *
+     * This must be set before the first request.  By default disabled, unless
+     * the EGT_HTTP_THREAD environment variable is set to 1.
+     */
+    static void network_thread(bool enable);
+
+    /**
+     * Are the requests run in a network thread.
+     */
+    EGT_NODISCARD static bool network_thread();
+
+    /**
+     * Set the maximum number of connections to the same host.
+     *
+     * Requests over the limit are queued until a connection is available.
+     * The default is 6, and 0 means no limit.
+     */
+    static void max_host_connections(long max);
+
+    /**
+     * Get statistics of the requests done so far.
+     *
+     * The connection reuse ratio is 1 - connections / requests, and the
+     * average latency total_time / requests.
+     */
+    EGT_NODISCARD static HttpClientStats stats();
+
     /// @private
     inline detail::HttpClientRequestData* impl()
     {
@@ -83,7 +249,7 @@ protected:
     void cleanup();
 
     /// Implementation pointer.
-    std::unique_ptr<detail::HttpClientRequestData> m_impl;
+    std::shared_ptr<detail::HttpClientRequestData> m_impl;
 
     friend class detail::HttpClientRequestManager;
 };
@@ -92,7 +258,8 @@ protected:
  * Blocking helper to download a file from the network using http.
  *
  * @warning This downloads the entire file into memory - which means this
- * should be used with severe caution.
+ * should be used with severe caution.  Prefer save_file_from_network(), or
+ * HttpClientRequest::start_stream() for large files.
  */
 template<class T>
 T load_file_from_network(const std::string& url)
@@ -117,6 +284,18 @@ T load_file_from_network(const std::string& url)
     return buffer;
 }
 
+/**
+ * Blocking helper to download a file from the network to the filesystem.
+ *
+ * The file is written as it is received, so only a small buffer is ever held
+ * in memory.  It is only created once the download succeeded.
+ *
+ * @param[in] url URL to download.
+ * @param[in] path Path of the file to create.
+ * @return true on success.
+ */
+EGT_API bool save_file_from_network(const std::string& url, const std::string& path);
+
 }
 }
 }
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_NETWORK_RFB_H
+#define EGT_NETWORK_RFB_H
+
+/**
+ * @file
+ * @brief Remote framebuffer (VNC) server.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+class Screen;
+
+namespace detail
+{
+struct RfbServerImpl;
+}
+
+namespace experimental
+{
+
+/**
+ * Statistics of an RfbServer.
+ *
+ * @see RfbServer::stats()
+ */
+struct RfbStats
+{
+    /// Number of clients connected.
+    size_t clients{0};
+    /// Number of updates sent to the clients.
+    size_t updates{0};
+    /// Number of frames merged into a later update, because a client was not
+    /// ready for them.
+    size_t dropped{0};
+    /// Bytes of the updates sent.
+    size_t bytes{0};
+};
+
+/**
+ * Server of the screen to VNC clients, with the RFB protocol.
+ *
+ * Viewers see the screen and drive it with their pointer and keyboard, which
+ * is useful to support devices in the field.
+ *
+ * The only work done in the thread of the event loop is sharing the damage of
+ * each frame flipped with the server.  The server runs in a thread of its own,
+ * and sends each client the damaged rectangles, encoded with ZRLE when the
+ * library was built with zlib.  A client only gets an update once it
+ * received the last one: frames flipped meanwhile are merged into the next
+ * update, so a slow connection gets fewer frames instead of falling behind.
+ * The compression level also follows the bandwidth of each connection.
+ *
+ * Pointer and key events of the clients are dispatched with
+ * Input::dispatch(), in the thread of the event loop.
+ *
+ * @code{.cpp}
+ * egt::Application app;
+ * egt::experimental::RfbServer server(*app.screen());
+ * @endcode
+ *
+ * The server can also be started by the Application with the EGT_RFB_PORT
+ * environment variable.
+ *
+ * @warning There is no authentication: only use it on a trusted network.
+ * @note The screen must outlive the server.
+ */
+class EGT_API RfbServer
+{
+public:
+
+    /**
+     * @param screen The screen to serve.
+     * @param port TCP port to listen on.
+     */
+    explicit RfbServer(Screen& screen, uint16_t port = 5900);
+
+    RfbServer(const RfbServer&) = delete;
+    RfbServer& operator=(const RfbServer&) = delete;
+
+    /**
+     * Get the TCP port the server listens on.
+     */
+    EGT_NODISCARD uint16_t port() const;
+
+    /**
+     * Get the statistics of the server.
+     */
+    EGT_NODISCARD RfbStats stats() const;
+
+    ~RfbServer() noexcept;
+
+private:
+
+    std::unique_ptr<detail::RfbServerImpl> m_impl;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_NETWORK_WEBSOCKET_H
+#define EGT_NETWORK_WEBSOCKET_H
+
+/**
+ * @file
+ * @brief Working with WebSockets.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+class EventLoop;
+
+namespace detail
+{
+struct WebSocketImpl;
+}
+
+namespace experimental
+{
+
+/**
+ * A message received by a WebSocket.
+ *
+ * The data is only valid during the call of the handlers.
+ */
+struct WebSocketMessage
+{
+    /// Payload of the message.
+    const unsigned char* data{nullptr};
+    /// Size of the payload, in bytes.
+    size_t size{0};
+    /// The message is binary, or else UTF-8 text.
+    bool binary{false};
+
+    /// Get the payload as text.
+    EGT_NODISCARD std::string_view text() const
+    {
+        return {reinterpret_cast<const char*>(data), size};
+    }
+};
+
+/**
+ * A WebSocket client, on the event loop.
+ *
+ * Unlike polling with an HttpClientRequest, the server pushes messages as
+ * soon as it has them.  The connection is handled by the asio io_context of
+ * the EventLoop, like any other event, so there is no thread.  wss:// URLs
+ * use TLS, verifying the server with the certificates of the system, when
+ * EGT is built with OpenSSL.
+ *
+ * A message received in a single frame is passed to on_message straight from
+ * the receive buffer, without a copy, so its data is only valid during the
+ * call.  Only fragmented messages are assembled in a separate buffer.
+ *
+ * Handlers are invoked in the thread of the event loop, so they can set an
+ * egt::Observable: however many messages arrive between two frames, the
+ * widgets bound to it are updated once, with the last value.
+ *
+ * @code{.cpp}
+ * egt::Observable<std::string> price;
+ * egt::bind(price, label);
+ *
+ * egt::experimental::WebSocket ws(app.event());
+ * ws.on_message([&price](const egt::experimental::WebSocketMessage& message)
+ * {
+ *     price = std::string(message.text());
+ * });
+ * ws.open("wss://example.com/prices");
+ * @endcode
+ */
+class EGT_API WebSocket
+{
+public:
+
+    /// State of the connection.
+    enum class State
+    {
+        connecting,
+        open,
+        closing,
+        closed,
+    };
+
+    /**
+     * Event signal.
+     * @{
+     */
+    /// Invoked once the connection is open.
+    Signal<> on_open;
+
+    /// Invoked with each message received.
+    Signal<const WebSocketMessage&> on_message;
+
+    /// Invoked when the connection is closed, with the close code and reason.
+    Signal<uint16_t, const std::string&> on_close;
+
+    /// Invoked when the connection fails, before on_close.
+    Signal<const std::string&> on_error;
+    /** @} */
+
+    /**
+     * @param[in] loop The event loop the connection is handled in.
+     */
+    explicit WebSocket(EventLoop& loop);
+
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+
+    /**
+     * Open a connection, closing the current one.
+     *
+     * @param[in] url A ws:// or wss:// URL.
+     * @param[in] protocols Sub-protocols requested, if any.
+     */
+    void open(const std::string& url, const std::vector<std::string>& protocols = {});
+
+    /**
+     * Add a header to the opening handshake, before calling open().
+     *
+     * @param[in] name Name of the header.
+     * @param[in] value Value of the header.
+     */
+    void header(const std::string& name, const std::string& value);
+
+    /**
+     * Send a text message.
+     *
+     * @return false if the connection is not open.
+     */
+    bool send(std::string_view text);
+
+    /**
+     * Send a binary message.
+     *
+     * @return false if the connection is not open.
+     */
+    bool send(const void* data, size_t size);
+
+    /**
+     * Close the connection.
+     *
+     * @param[in] code Close code, 1000 for a normal closure.
+     * @param[in] reason Reason of the closure.
+     */
+    void close(uint16_t code = 1000, const std::string& reason = {});
+
+    /**
+     * Get the state of the connection.
+     */
+    EGT_NODISCARD State state() const;
+
+    /**
+     * Get the sub-protocol chosen by the server, once open.
+     */
+    EGT_NODISCARD std::string protocol() const;
+
+    /**
+     * Set the interval of the pings sent to keep the connection alive.
+     *
+     * The connection fails if nothing is received for twice the interval.
+     * By default 30 s, and 0 disables pings.
+     */
+    void ping_interval(std::chrono::seconds interval);
+
+    /**
+     * Set the delay before opening the connection again when it is lost.
+     *
+     * By default 0, the connection is not opened again.  A connection closed
+     * with close() is never opened again.
+     */
+    void reconnect(std::chrono::milliseconds delay);
+
+    /**
+     * Set the largest message received, in bytes.
+     *
+     * The connection fails on a larger message.  By default 1 MiB.
+     */
+    void max_message_size(size_t size);
+
+    ~WebSocket() noexcept;
+
+protected:
+
+    /// Implementation pointer.
+    std::shared_ptr<detail::WebSocketImpl> m_impl;
+};
+
+}
+}
+}
+
+#endif
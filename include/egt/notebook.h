@@ -11,6 +11,8 @@
  * @brief Working with notebooks.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/frame.h>
 #include <egt/signal.h>
@@ -24,6 +26,12 @@ inline namespace v1
 {
 
 class Notebook;
+
+namespace detail
+{
+class PageCache;
+}
+
 /**
  * A single layer of a Notebook.
  */
@@ -33,7 +41,7 @@ public:
 
     NotebookTab()
     {
-        name("NotebookTab" + std::to_string(m_widgetid));
+        default_name("NotebookTab", m_widgetid);
 
         // tabs are not transparent by default
         fill_flags(Theme::FillFlag::solid);
@@ -166,6 +174,26 @@ public:
      */
     EGT_NODISCARD NotebookTab* get(size_t index) const;
 
+    /**
+     * Keep the rendering of recently shown tabs, so switching back to them
+     * is instant.
+     *
+     * Each shown tab is rendered into its own surface, see
+     * Widget::cache_subtree(), which is kept when the tab is hidden.  Showing
+     * the tab again paints that surface, and only what was damaged in the
+     * tab since is drawn again.  The tabs shown least recently lose their
+     * surface when the total is over the budget.
+     *
+     * @param[in] max_bytes Memory budget of the surfaces, or 0 to disable,
+     *            which is the default.
+     */
+    void page_cache(size_t max_bytes);
+
+    /**
+     * Get the memory budget of the tab surfaces, or 0 if disabled.
+     */
+    EGT_NODISCARD size_t page_cache() const { return m_page_cache_bytes; }
+
     void serialize(Serializer& serializer) const override;
 
     /**
@@ -173,6 +201,8 @@ public:
      */
     void post_deserialize(Serializer::Properties& props) override;
 
+    ~Notebook() noexcept override;
+
 protected:
 
     /// Type of array of notebook tabs.
@@ -183,6 +213,18 @@ protected:
 
     /// Currently selected index.
     ssize_t m_selected{-1};
+
+    /// Add the selected tab to the page cache, as the most recent one.
+    void cache_selected();
+
+    /// Memory budget of the page cache.
+    size_t m_page_cache_bytes{0};
+
+    /// Tabs keeping their rendering, from the most recently shown one.
+    std::shared_ptr<detail::PageCache> m_page_cache;
+
+    /// Handle of the page cache in the cache budget, or 0.
+    uint64_t m_page_cache_handle{0};
 };
 
 }
@@ -13,11 +13,13 @@
 
 #include <cstdint>
 #include <egt/detail/cow.h>
+#include <egt/detail/delegate.h>
 #include <egt/detail/meta.h>
 #include <egt/event.h>
 #include <egt/flagsbase.h>
 #include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace egt
@@ -39,7 +41,12 @@ public:
     Object& operator=(Object&&) = default;
 
     /// Get the name of the Object.
-    EGT_NODISCARD const std::string& name() const { return m_name; }
+    EGT_NODISCARD const std::string& name() const
+    {
+        if (egt_unlikely(!m_name_prefix.empty()))
+            build_name();
+        return m_name;
+    }
 
     /**
      * Set the name of the Object.
@@ -49,11 +56,24 @@ public:
      *
      * @param[in] name Name to set for the Object.
      */
-    void name(const std::string& name) { m_name = name; }
+    void name(const std::string& name)
+    {
+        m_name = name;
+        m_name_prefix = {};
+    }
 
     /// Event handler callback function.
     using EventCallback = std::function<void (Event& event)>;
 
+    /**
+     * Stored event handler.
+     *
+     * Handlers passed as anything else than an EventCallback are stored
+     * without going through one, so small lambdas are stored inline and
+     * called with a single indirect call.
+     */
+    using CallbackDelegate = detail::Delegate<void (Event& event)>;
+
     /// Event handler EventId filter.
     using FilterFlags = FlagsBase<EventId>;
 
@@ -78,6 +98,30 @@ public:
     RegisterHandle on_event(const EventCallback& handler,
                             const FilterFlags& mask = {});
 
+    /**
+     * Add an event handler of any callable type.
+     *
+     * @see on_event(const EventCallback&, const FilterFlags&)
+     */
+    template<class F,
+             class = typename std::enable_if<!std::is_same<typename std::decay<F>::type,
+                                                           EventCallback>::value>::type>
+    RegisterHandle on_event(F&& handler, const FilterFlags& mask = {})
+    {
+        return add_handler(CallbackDelegate(std::forward<F>(handler)), mask);
+    }
+
+    /**
+     * Is any handler registered for an EventId.
+     *
+     * Checked by invoke_handlers() before walking the handlers, and can be
+     * used to skip building an Event nobody handles.
+     */
+    EGT_NODISCARD bool has_handlers(EventId id) const
+    {
+        return m_handler_mask.is_set(id);
+    }
+
     /**
      * Invoke all handlers with the specified event.
      *
@@ -108,6 +152,12 @@ public:
 
 protected:
 
+    /// Register a handler.
+    RegisterHandle add_handler(CallbackDelegate handler, const FilterFlags& mask);
+
+    /// Update m_handler_mask from the registered handlers.
+    void update_handler_mask();
+
     /// Counter used to generate unique handles for each callback registration.
     RegisterHandle m_handle_counter{0};
 
@@ -121,7 +171,7 @@ protected:
          * @param[in] m Filter mask for events.
          * @param[in] h Handle for this registration.
          */
-        CallbackMeta(EventCallback c,
+        CallbackMeta(CallbackDelegate c,
                      // NOLINTNEXTLINE(modernize-pass-by-value)
                      const FilterFlags& m,
                      RegisterHandle h) noexcept
@@ -131,7 +181,7 @@ protected:
         {}
 
         /// Event callback function.
-        EventCallback callback;
+        CallbackDelegate callback;
         /// Filter mask for events.
         FilterFlags mask;
         /// Handle for this registration.
@@ -144,8 +194,34 @@ protected:
     /// Array of callbacks.
     detail::CopyOnWriteAllocate<CallbackArray> m_callbacks;
 
+    /// EventId values any registered handler is invoked with.
+    FilterFlags m_handler_mask;
+
+    /**
+     * Set a default name made of a prefix and a number, like "Button12".
+     *
+     * Most names are only used for debugging, so the name is only built
+     * when name() is first called.  Until then, this keeps the interned
+     * prefix and the number.
+     *
+     * @param[in] prefix Prefix of the name, usually the type name.
+     * @param[in] number Number appended to the prefix.
+     */
+    void default_name(std::string_view prefix, uint64_t number);
+
     /// A user defined name for the Object.
-    std::string m_name;
+    mutable std::string m_name;
+
+private:
+
+    /// Build the default name.
+    void build_name() const;
+
+    /// Interned prefix of the default name, empty once built.
+    mutable std::string_view m_name_prefix;
+
+    /// Number of the default name.
+    uint64_t m_name_number{0};
 };
 
 }
@@ -16,6 +16,8 @@
 #include <egt/fixedvector.h>
 #include <egt/pattern.h>
 #include <egt/serialize.h>
+#include <array>
+#include <cstdint>
 #include <initializer_list>
 #include <iosfwd>
 #include <memory>
@@ -268,14 +270,40 @@ public:
         label_text,
     };
 
+    /// Number of GroupId values.
+    static constexpr size_t GROUP_COUNT = 4;
+
+    /// Number of ColorId values.
+    static constexpr size_t COLOR_COUNT = 10;
+
     using PatternArray = FixedVector<std::pair<GroupId,
-          FixedVector<std::pair<ColorId, Pattern>, 10>>, 4>;
+          FixedVector<std::pair<ColorId, Pattern>, COLOR_COUNT>>, GROUP_COUNT>;
 
     Palette() = default;
 
+    /**
+     * The palette is indexed when it is built or changed, so color() is a
+     * lookup in a flat table instead of a search.
+     */
     explicit constexpr Palette(std::initializer_list<PatternArray::value_type> colors) noexcept
         : m_colors(colors)
-    {}
+    {
+        reindex();
+    }
+
+    /**
+     * Index of a color in a flat table of all the colors of all the groups.
+     *
+     * @return COLOR_COUNT * GROUP_COUNT if @b id or @b group is invalid.
+     */
+    static constexpr size_t index(ColorId id, GroupId group)
+    {
+        const auto c = static_cast<size_t>(id) - 1;
+        const auto g = static_cast<size_t>(group) - 1;
+        if (c >= COLOR_COUNT || g >= GROUP_COUNT)
+            return COLOR_COUNT * GROUP_COUNT;
+        return g * COLOR_COUNT + c;
+    }
 
     Palette& operator=(const PatternArray& colors);
 
@@ -356,13 +384,52 @@ public:
     /**
      * Deserialize.
      */
-    void deserialize(const std::string& name, const std::string& value,
+    void deserialize(std::string_view name, const std::string& value,
                      const Serializer::Attributes& attrs);
 
 protected:
 
+    /// Value of m_index for a color not in the palette.
+    static constexpr uint8_t NO_COLOR = 0;
+
+    /// Find a color with m_index.
+    EGT_NODISCARD constexpr const Pattern* find(ColorId id, GroupId group) const
+    {
+        const auto i = index(id, group);
+        if (i >= m_index.size() || m_index[i] == NO_COLOR)
+            return nullptr;
+        const auto position = m_index[i] - 1;
+        return &m_colors[position >> 4].second[position & 0xf].second;
+    }
+
+    /// Rebuild m_index after m_colors changed.
+    constexpr void reindex()
+    {
+        for (auto& i : m_index)
+            i = NO_COLOR;
+
+        // the first color for an id and group is used, like a search would
+        for (size_t g = 0; g < m_colors.size(); ++g)
+        {
+            const auto& colors = m_colors[g].second;
+            for (size_t c = 0; c < colors.size(); ++c)
+            {
+                const auto i = index(colors[c].first, m_colors[g].first);
+                if (i < m_index.size() && m_index[i] == NO_COLOR)
+                    m_index[i] = static_cast<uint8_t>((g << 4 | c) + 1);
+            }
+        }
+    }
+
     /// Patterns in the palette.
     PatternArray m_colors{};
+
+    /**
+     * Position of each color in m_colors, by index(), plus one.  The position
+     * is the one of the group in the high 4 bits, and of the color in the low
+     * ones.
+     */
+    std::array<uint8_t, COLOR_COUNT * GROUP_COUNT> m_index{};
 };
 
 static_assert(detail::rule_of_5<Palette>(), "must fulfill rule of 5");
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_PARTICLES_H
+#define EGT_PARTICLES_H
+
+/**
+ * @file
+ * @brief Working with many copies of an image.
+ */
+
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/image.h>
+#include <egt/screen.h>
+#include <egt/widget.h>
+#include <functional>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Frame;
+
+/**
+ * One copy of the image of a ParticleField.
+ */
+struct Particle
+{
+    /// Center of the particle, relative to the widget.
+    PointF center;
+    /// Alpha of the particle, from 0.0 to 1.0.
+    float alpha{1.f};
+    /// Scale of the image of the particle.
+    float scale{1.f};
+};
+
+/**
+ * Widget drawing many copies of a small image.
+ *
+ * A widget per moving object, like an ImageLabel per star, costs its own
+ * damage, its own traversal of the tree and its own paint.  This widget
+ * keeps the particles as a compact array instead, and draws all of them
+ * from its single draw(), only visiting the particles inside of the
+ * damaged rectangle.
+ *
+ * Changing particles damages the rectangles they leave and enter.  Changes
+ * made together with particles() or update() have their damage merged
+ * into at most DamageCost::max_rects rectangles, which wastes at most a
+ * fraction of their area, before it is given to the window.
+ *
+ * Particles drawn at full alpha and scale go through the fast image path
+ * of the rasterizer.
+ *
+ * @ingroup media
+ */
+class EGT_API ParticleField : public Widget
+{
+public:
+
+    /**
+     * @param[in] image The image of the particles.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    explicit ParticleField(const Image& image = {}, const Rect& rect = {});
+
+    /**
+     * @param[in] parent The parent Frame.
+     * @param[in] image The image of the particles.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    ParticleField(Frame& parent, const Image& image, const Rect& rect = {});
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    /**
+     * Set the image of the particles.
+     */
+    void image(const Image& image);
+
+    /**
+     * Get the image of the particles.
+     */
+    EGT_NODISCARD const Image& image() const { return m_image; }
+
+    /**
+     * Add a particle.
+     *
+     * @return The index of the particle.
+     */
+    size_t add(const Particle& particle);
+
+    /**
+     * Remove a particle.
+     *
+     * The last particle takes its index.
+     */
+    void remove(size_t index);
+
+    /// Remove all particles.
+    void clear();
+
+    /// Get the number of particles.
+    EGT_NODISCARD size_t count() const { return m_particles.size(); }
+
+    /// Get a particle.
+    EGT_NODISCARD const Particle& particle(size_t index) const { return m_particles.at(index); }
+
+    /// Change a particle.
+    void particle(size_t index, const Particle& particle);
+
+    /// Get all of the particles.
+    EGT_NODISCARD const std::vector<Particle>& particles() const { return m_particles; }
+
+    /// Replace all of the particles.
+    void particles(std::vector<Particle> particles);
+
+    /**
+     * Change the particles in place.
+     *
+     * The function may change any particle.  Particles it does not change
+     * are not damaged.  It must not add or remove particles.
+     *
+     * @param[in] func Function changing the particles.
+     */
+    void update(const std::function<void(std::vector<Particle>& particles)>& func);
+
+    /**
+     * Set the merge parameters of the damage of the particles.
+     */
+    void damage_cost(const Screen::DamageCost& cost) { m_cost = cost; }
+
+    /**
+     * Get the merge parameters of the damage of the particles.
+     */
+    EGT_NODISCARD const Screen::DamageCost& damage_cost() const { return m_cost; }
+
+protected:
+
+    /// Rectangle covered by a particle, relative to the widget.
+    EGT_NODISCARD Rect bounds(const Particle& particle) const;
+
+    /// Damage the rectangles changed particles leave and enter.
+    void damage_changes(const std::vector<Particle>& before);
+
+    /// Give merged damage, relative to the widget, to the window.
+    void flush_damage(const Screen::DamageArray& rects);
+
+    /// Image of the particles.
+    Image m_image;
+
+    /// The particles.
+    std::vector<Particle> m_particles;
+
+    /// Merge parameters of the damage of the particles.
+    Screen::DamageCost m_cost;
+};
+
+}
+}
+
+#endif
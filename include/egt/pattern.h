@@ -197,6 +197,24 @@ public:
     /// Get all of the steps of the pattern
     EGT_NODISCARD const StepArray& steps() const;
 
+    /**
+     * Get the cairo gradient of the steps, and how to map it to the geometry
+     * of the pattern.
+     *
+     * The gradient is in a space where a linear pattern goes from (0, 0) to
+     * (1, 0), and the end circle of a radial pattern is centered on (0, 0)
+     * with a radius of 1.  It is shared by copies of the pattern, and only
+     * created again when the steps, or the proportions of a radial pattern,
+     * change.  Drawing patterns that only differ by their geometry, like the
+     * background of widgets of different sizes, then creates no cairo
+     * pattern.
+     *
+     * @param[out] matrix Transformation from the space of the gradient to
+     *             the space of the pattern.
+     * @return nullptr for a solid color, or a degenerate geometry.
+     */
+    EGT_NODISCARD cairo_pattern_t* gradient(cairo_matrix_t& matrix) const;
+
     /// Get internal pattern representation.
     EGT_NODISCARD cairo_pattern_t* pattern() const
     {
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_PERFHUD_H
+#define EGT_PERFHUD_H
+
+/**
+ * @file
+ * @brief Performance overlay.
+ */
+
+#include <array>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/metrics.h>
+#include <egt/window.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+/**
+ * Overlay showing the frame rate, a graph of the frame times, the damage
+ * per frame, the flip latency, and the CPU and heap usage.
+ *
+ * It is a window on an overlay plane when the screen has one available, so
+ * it is composed by the display controller and neither damages nor slows
+ * down the windows it measures.  Otherwise it falls back to a window
+ * composed like the others, added to the main window, which does show up
+ * in the damage and composition times.
+ *
+ * Frame times come from the Profiler, which is enabled while the overlay
+ * exists.  The overlay is only drawn again when metrics are sampled.
+ *
+ * Set the EGT_HUD environment variable to show it in any application.
+ */
+class EGT_API PerfHud : public Window
+{
+public:
+
+    /// Number of frames in the graph.
+    static constexpr size_t HISTORY = 120;
+
+    /**
+     * @param[in] rect Rectangle of the overlay, on the screen.
+     * @param[in] interval Time between two updates.
+     */
+    explicit PerfHud(const Rect& rect = Rect(0, 0, 240, 112),
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+
+    PerfHud(const PerfHud&) = delete;
+    PerfHud& operator=(const PerfHud&) = delete;
+    PerfHud(PerfHud&&) = delete;
+    PerfHud& operator=(PerfHud&&) = delete;
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    /// Get the sampler of the metrics shown.
+    MetricsSampler& sampler() { return m_sampler; }
+
+    ~PerfHud() noexcept override;
+
+private:
+
+    /// Take the frames recorded since the last update.
+    void update();
+
+    MetricsSampler m_sampler;
+    /// Work time of the last frames, in milliseconds, a ring.
+    std::array<float, HISTORY> m_frame_times{};
+    /// Next entry of m_frame_times written.
+    size_t m_next{0};
+    /// Last frame taken from the Profiler.
+    uint64_t m_last_frame{0};
+    /// Average and longest work time since the last update.
+    float m_frame_mean{0};
+    float m_frame_max{0};
+    /// Average flip latency since the last update.
+    float m_flip_mean{0};
+    /// Was the Profiler enabled by the overlay.
+    bool m_profiler{false};
+};
+
+}
+}
+}
+
+#endif
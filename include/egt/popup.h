@@ -79,7 +79,7 @@ public:
      * Show the window in modal mode.
      *
      * This means it will explicitly steal all input events as long as it is
-     * visible.
+     * visible.  Use Window::backdrop() to dim or blur what is under it.
      */
     virtual void show_modal(bool center = false)
     {
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_PROFILER_H
+#define EGT_PROFILER_H
+
+/**
+ * @file
+ * @brief Frame time profiler.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+class Widget;
+
+/**
+ * Frame time profiler.
+ *
+ * When enabled, every frame records the time spent waiting for events, in
+ * layout, drawing, copying to the screen buffer, and the time it took for
+ * its flip to complete.  The draw time of every widget is recorded, and
+ * accumulated in a histogram for each widget name.
+ *
+ * Frames and events are kept in fixed size rings, so the most recent ones are
+ * always available, and recording them never takes a lock.  Only the first
+ * draw of a widget name allocates, for its histogram.  When disabled, each
+ * instrumentation point costs a single branch.
+ *
+ * The recorded events can be written as a Chrome trace, which can be loaded
+ * in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Set the EGT_PROFILE environment variable to a file name to enable the
+ * profiler at startup and write the trace to that file when EventLoop::run()
+ * returns.
+ *
+ * When the library is built with allocation counting, every frame and event
+ * also records the number of heap allocations made by the event loop thread,
+ * and a frame can be given an allocation budget.  See allocation_budget().
+ *
+ * @note Recording happens in the event loop thread, which is the thread that
+ * enables the profiler.  Scopes on other threads, like Window::parallel_draw()
+ * bands, are not recorded.  frames() and events() may be called from any
+ * thread, everything else only from the event loop thread.
+ */
+class EGT_API Profiler
+{
+public:
+
+    /// Clock used for all timestamps.
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * What a frame spends time on.
+     */
+    enum class Phase : uint32_t
+    {
+        /// Waiting for, and handling, events.
+        wait,
+        /// Widget layout.
+        layout,
+        /// Drawing widgets.
+        draw,
+        /// Copying to the screen buffer, and scheduling the flip.
+        copy,
+        /// From scheduling a flip to its completion.
+        flip,
+    };
+
+    /// Number of Phase values.
+    static constexpr size_t PHASE_COUNT = 5;
+
+    /**
+     * What to do when a frame goes over its allocation budget.
+     */
+    enum class BudgetAction : uint32_t
+    {
+        /// Log a warning.
+        warn,
+        /// Throw std::runtime_error from end_frame().
+        fail,
+    };
+
+    /**
+     * Timing of one frame.
+     *
+     * Times of wait, layout, draw, and copy exclude each other, so a draw
+     * that triggers a layout does not count the layout time as draw time.
+     * The same goes for allocations.
+     */
+    struct FrameRecord
+    {
+        /// Frame number, starting at 1.
+        uint64_t frame{0};
+        /// When the first phase of the frame started.
+        Clock::time_point start{};
+        /// When the frame ended.
+        Clock::time_point end{};
+        /// Time spent in each phase.
+        std::array<std::chrono::nanoseconds, PHASE_COUNT> time{};
+        /// Number of widgets drawn.
+        uint32_t draws{0};
+        /// Number of size hints computed, because they were not cached.
+        uint32_t size_hints{0};
+        /// Heap allocations made in each phase.
+        std::array<uint64_t, PHASE_COUNT> allocs{};
+        /// When the oldest input event handled for this frame was reported.
+        Clock::time_point input{};
+        /**
+         * From input to the frame reaching the display, or 0 without input.
+         *
+         * This ends at the completion of the flip, for screens that report
+         * it, otherwise at the end of the frame.
+         */
+        std::chrono::nanoseconds latency{};
+
+        /// Get the time spent in a phase.
+        EGT_NODISCARD std::chrono::nanoseconds phase(Phase p) const
+        {
+            return time[static_cast<uint32_t>(p)];
+        }
+
+        /// Get the heap allocations made in a phase.
+        EGT_NODISCARD uint64_t allocations(Phase p) const
+        {
+            return allocs[static_cast<uint32_t>(p)];
+        }
+
+        /// Get the heap allocations made in all phases.
+        EGT_NODISCARD uint64_t allocations() const
+        {
+            uint64_t total = 0;
+            for (auto a : allocs)
+                total += a;
+            return total;
+        }
+    };
+
+    /**
+     * One timed span, either a phase or the draw of a widget.
+     */
+    struct Event
+    {
+        /// Frame number the event is part of.
+        uint64_t frame{0};
+        /// Phase of the event.
+        Phase phase{Phase::wait};
+        /// Start of the event.
+        Clock::time_point start{};
+        /// Duration of the event, including nested events.
+        std::chrono::nanoseconds duration{};
+        /// Heap allocations made during the event, including nested events.
+        uint64_t allocs{0};
+        /// Widget name for widget draws, otherwise empty.
+        char name[32]{};
+    };
+
+    /**
+     * Distribution of the draw times of a widget.
+     */
+    struct Histogram
+    {
+        /// Number of buckets.
+        static constexpr size_t BUCKET_COUNT = 16;
+
+        /**
+         * Bucket 0 counts draws under 1 microsecond, and bucket n counts draws
+         * from 2^(n-1) up to 2^n microseconds.  The last bucket counts
+         * everything longer.
+         */
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        /// Number of draws.
+        uint64_t count{0};
+        /// Total time of all draws.
+        std::chrono::nanoseconds total{};
+        /// Longest draw.
+        std::chrono::nanoseconds max{};
+
+        /// Add a draw time.
+        void add(std::chrono::nanoseconds duration);
+
+        /// Average draw time.
+        EGT_NODISCARD std::chrono::nanoseconds mean() const
+        {
+            return count ? total / static_cast<int64_t>(count) : std::chrono::nanoseconds();
+        }
+    };
+
+    /**
+     * Times a phase, or the draw of a widget, for the lifetime of the object.
+     */
+    class Scope
+    {
+    public:
+
+        /**
+         * @param[in] phase The phase being timed.
+         * @param[in] widget For Phase::draw, the widget being drawn.
+         */
+        explicit Scope(Phase phase, const Widget* widget = nullptr) noexcept
+        {
+            auto& profiler = Profiler::instance();
+            if (egt_unlikely(profiler.enabled()) && profiler.begin(phase, widget))
+                m_profiler = &profiler;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() noexcept
+        {
+            if (m_profiler)
+                m_profiler->end();
+        }
+
+    private:
+        Profiler* m_profiler{nullptr};
+    };
+
+    /**
+     * Get a reference to the Profiler instance.
+     */
+    static Profiler& instance();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    Profiler(Profiler&&) = delete;
+    Profiler& operator=(Profiler&&) = delete;
+    ~Profiler() noexcept;
+
+    /**
+     * Enable or disable recording.
+     */
+    void enable(bool value);
+
+    /**
+     * Is recording enabled.
+     */
+    EGT_NODISCARD bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the most recent frames, oldest first.
+     */
+    EGT_NODISCARD std::vector<FrameRecord> frames() const;
+
+    /**
+     * Get the most recent events, oldest first.
+     */
+    EGT_NODISCARD std::vector<Event> events() const;
+
+    /**
+     * Get the draw time histogram of every widget name.
+     */
+    EGT_NODISCARD std::map<std::string, Histogram> histograms() const;
+
+    /**
+     * Get the distribution of input to display latency of all frames.
+     *
+     * When enabled, the input devices report when every event happened,
+     * using the kernel time of the event where the device provides it.  For
+     * each frame drawn after input, the time from its oldest input event to
+     * the frame reaching the display is added here, and kept in
+     * FrameRecord::latency.
+     */
+    EGT_NODISCARD Histogram input_latency() const;
+
+    /**
+     * Is the library built with allocation counting.
+     *
+     * Without it, all allocation counts are 0.
+     */
+    EGT_NODISCARD static bool allocation_counting();
+
+    /**
+     * Set the number of heap allocations a frame may make.
+     *
+     * Checked by end_frame() for every frame recorded while enabled.  A frame
+     * that goes over the budget is reported with the allocations made in
+     * each phase.
+     *
+     * Set the EGT_ALLOC_BUDGET environment variable to a count, optionally
+     * followed by ":fail", to enable the profiler with a budget at startup.
+     *
+     * @param[in] count Allocations allowed per frame, or 0 for no budget.
+     * @param[in] action What to do when a frame goes over the budget.
+     */
+    void allocation_budget(uint64_t count, BudgetAction action = BudgetAction::warn);
+
+    /**
+     * Get the number of heap allocations a frame may make, 0 for no budget.
+     */
+    EGT_NODISCARD uint64_t allocation_budget() const
+    {
+        return m_budget;
+    }
+
+    /**
+     * Drop everything recorded.
+     */
+    void reset();
+
+    /**
+     * Write the recorded events as Chrome trace JSON.
+     */
+    void write_trace(std::ostream& out) const;
+
+    /**
+     * Write the recorded events as Chrome trace JSON to a file.
+     */
+    void write_trace(const std::string& filename) const;
+
+    /**
+     * @private
+     *
+     * @return false if called from another thread than the one that enabled
+     * recording, and nothing was recorded.
+     */
+    bool begin(Phase phase, const Widget* widget = nullptr);
+
+    /// @private
+    void end();
+
+    /**
+     * End the current frame.
+     *
+     * Called by the EventLoop after drawing.  Frames that did not draw
+     * anything are merged into the next one.
+     *
+     * @throws std::runtime_error if the frame went over its allocation
+     * budget, and the budget action is BudgetAction::fail.
+     */
+    void end_frame();
+
+    /**
+     * Record that an input event happened.
+     *
+     * Called by Input for every event it dispatches.
+     *
+     * @param[in] when When the input device reported the event.
+     */
+    void input(Clock::time_point when);
+
+    /**
+     * Record that a widget computed its size hint.
+     *
+     * Called by Widget::cached_min_size_hint() when the hint is not cached,
+     * and counted in FrameRecord::size_hints.
+     */
+    void size_hint()
+    {
+        if (egt_unlikely(enabled()))
+            count_size_hint();
+    }
+
+    /**
+     * Record that a flip was scheduled for the current frame.
+     *
+     * @param[in] source The screen that scheduled the flip.
+     */
+    void flip_scheduled(const void* source);
+
+    /**
+     * Record that the oldest flip scheduled by a source completed.
+     *
+     * @param[in] source The screen that scheduled the flip.
+     * @param[in] when When the flip completed.
+     */
+    void flip_completed(const void* source, Clock::time_point when);
+
+protected:
+
+    Profiler();
+
+    /// @private
+    void count_size_hint();
+
+    struct ProfilerImpl;
+
+    /// @private
+    std::unique_ptr<ProfilerImpl> m_impl;
+
+    /// @private
+    std::atomic<bool> m_enabled{false};
+
+    /// @private
+    uint64_t m_budget{0};
+
+    /// @private
+    BudgetAction m_budget_action{BudgetAction::warn};
+};
+
+}
+}
+
+#endif
@@ -10,6 +10,8 @@
  * @file
  * @brief Working with progress meters.
  */
+#include <algorithm>
+#include <cmath>
 #include <egt/app.h>
 #include <egt/detail/alignment.h>
 #include <egt/detail/enum.h>
@@ -59,7 +61,7 @@ public:
                                 T start = {}, T end = 100, T value = {}) noexcept
         : ValueRangeWidget<T>(rect, start, end, value)
     {
-        this->name("ProgressBar" + std::to_string(this->m_widgetid));
+        this->default_name("ProgressBar", this->m_widgetid);
         this->fill_flags(Theme::FillFlag::blend);
         this->border(this->theme().default_border());
     }
@@ -110,52 +112,9 @@ public:
         widget.draw_box(painter, Palette::ColorId::bg, Palette::ColorId::border);
 
         auto b = widget.content_area();
-        auto style = widget.style();
-        auto draw_bar = false;
-        Rect r;
+        const auto r = widget.bar_box(widget.value());
 
-        if (style == ProgressBarStyle::left_to_right ||
-            style == ProgressBarStyle::right_to_left)
-        {
-            /*
-             * Convert directly into DefaultDim to avoid rounding issues
-             * of '- width' when computing 'x' for the 'right_to_left' style.
-             */
-            DefaultDim width = detail::normalize<float>(widget.value(),
-                               widget.starting(),
-                               widget.ending(), 0, b.width());
-
-            if (width && b.height())
-            {
-                auto x = b.x();
-                if (style == ProgressBarStyle::right_to_left)
-                    x = b.x() + b.width() - width;
-                r = Rect(x, b.y(), width, b.height());
-                draw_bar = true;
-            }
-        }
-        else if (style == ProgressBarStyle::top_to_bottom ||
-                 style == ProgressBarStyle::bottom_to_top)
-        {
-            /*
-             * Convert directly into DefaultDim to avoid rounding issues
-             * of '- height' when computing 'y' for the 'bottom_to_top' style.
-             */
-            DefaultDim height = detail::normalize<float>(widget.value(),
-                                widget.starting(),
-                                widget.ending(), 0, b.height());
-
-            if (height && b.width())
-            {
-                auto y = b.y();
-                if (style == ProgressBarStyle::bottom_to_top)
-                    y = b.y() + b.height() - height;
-                r = Rect(b.x(), y, b.width(), height);
-                draw_bar = true;
-            }
-        }
-
-        if (draw_bar)
+        if (!r.empty())
         {
             widget.theme().draw_box(painter,
                                     Theme::FillFlag::blend,
@@ -190,6 +149,56 @@ public:
         }
     }
 
+    /**
+     * Get the box of the bar for the specified value, empty if there is no
+     * bar to draw.
+     */
+    EGT_NODISCARD Rect bar_box(T value) const
+    {
+        const auto b = this->content_area();
+
+        if (m_style == ProgressBarStyle::left_to_right ||
+            m_style == ProgressBarStyle::right_to_left)
+        {
+            /*
+             * Convert directly into DefaultDim to avoid rounding issues
+             * of '- width' when computing 'x' for the 'right_to_left' style.
+             */
+            DefaultDim width = detail::normalize<float>(value,
+                               this->starting(),
+                               this->ending(), 0, b.width());
+
+            if (width && b.height())
+            {
+                auto x = b.x();
+                if (m_style == ProgressBarStyle::right_to_left)
+                    x = b.x() + b.width() - width;
+                return {x, b.y(), width, b.height()};
+            }
+        }
+        else if (m_style == ProgressBarStyle::top_to_bottom ||
+                 m_style == ProgressBarStyle::bottom_to_top)
+        {
+            /*
+             * Convert directly into DefaultDim to avoid rounding issues
+             * of '- height' when computing 'y' for the 'bottom_to_top' style.
+             */
+            DefaultDim height = detail::normalize<float>(value,
+                                this->starting(),
+                                this->ending(), 0, b.height());
+
+            if (height && b.width())
+            {
+                auto y = b.y();
+                if (m_style == ProgressBarStyle::bottom_to_top)
+                    y = b.y() + b.height() - height;
+                return {b.x(), y, b.width(), height};
+            }
+        }
+
+        return {};
+    }
+
     using ValueRangeWidget<T>::min_size_hint;
 
     /// Default ProgressBar size.
@@ -264,6 +273,53 @@ public:
     void serialize(Serializer& serializer) const override;
 
 protected:
+
+    /// Damage the end of the bar that changed, and the label.
+    void damage_value(T prev) override
+    {
+        const auto before = bar_box(prev);
+        const auto after = bar_box(this->m_value);
+
+        auto changed = before.empty() ? after :
+                       after.empty() ? before : Rect::merge(before, after);
+
+        // both bars start on the same side, so only the end of the longer one
+        // changes, with the rounded corners of the shorter one
+        const auto common = Rect::intersection(before, after);
+        if (!common.empty())
+        {
+            const auto radius = static_cast<DefaultDim>(std::ceil(this->border_radius()));
+
+            switch (m_style)
+            {
+            case ProgressBarStyle::left_to_right:
+                changed.x(std::max(changed.x(), common.right() - radius));
+                changed.width(std::max(before.right(), after.right()) - changed.x());
+                break;
+            case ProgressBarStyle::right_to_left:
+                changed.width(std::min(changed.right(), common.left() + radius) - changed.x());
+                break;
+            case ProgressBarStyle::top_to_bottom:
+                changed.y(std::max(changed.y(), common.bottom() - radius));
+                changed.height(std::max(before.bottom(), after.bottom()) - changed.y());
+                break;
+            case ProgressBarStyle::bottom_to_top:
+                changed.height(std::min(changed.bottom(), common.top() + radius) - changed.y());
+                break;
+            }
+        }
+
+        this->damage(changed);
+
+        // the label is scaled to fit in the middle of the content area
+        if (m_show_label)
+        {
+            const auto b = this->content_area();
+            this->damage(detail::align_algorithm(Size(b.width() * 0.75, b.height() * 0.75),
+                                                 b, AlignFlag::center));
+        }
+    }
+
     /**
      * When true, the label text is shown.
      */
@@ -402,6 +458,7 @@ void ProgressBarType<T>::default_size(const Size& size)
         unregister_handler();
 
     ProgressBarType<T>::m_default_size = size;
+    Widget::invalidate_all_size_hints();
 }
 
 /// Enum string conversion map
@@ -430,7 +487,7 @@ public:
                               T start = 0, T end = 100, T value = 0) noexcept
         : ValueRangeWidget<T>(rect, start, end, value)
     {
-        this->name("SpinProgress" + std::to_string(this->m_widgetid));
+        this->default_name("SpinProgress", this->m_widgetid);
         this->fill_flags(Theme::FillFlag::blend);
     }
 
@@ -642,6 +699,7 @@ void SpinProgressType<T>::default_size(const Size& size)
         unregister_handler();
 
     SpinProgressType<T>::m_default_size = size;
+    Widget::invalidate_all_size_hints();
 }
 
 template <class T>
@@ -691,7 +749,7 @@ public:
                             T start = 0, T end = 100, T value = 0) noexcept
         : ValueRangeWidget<T>(rect, start, end, value)
     {
-        this->name("LevelMeter" + std::to_string(this->m_widgetid));
+        this->default_name("LevelMeter", this->m_widgetid);
         this->fill_flags(Theme::FillFlag::blend);
         this->padding(2);
     }
@@ -891,6 +949,7 @@ void LevelMeterType<T>::default_size(const Size& size)
         unregister_handler();
 
     LevelMeterType<T>::m_default_size = size;
+    Widget::invalidate_all_size_hints();
 }
 
 template <class T>
@@ -936,7 +995,7 @@ public:
     explicit AnalogMeterType(const Rect& rect = {}) noexcept
         : ValueRangeWidget<T>(rect, 0, 100, 0)
     {
-        this->name("AnalogMeter" + std::to_string(this->m_widgetid));
+        this->default_name("AnalogMeter", this->m_widgetid);
         this->fill_flags(Theme::FillFlag::blend);
     }
 
@@ -963,7 +1022,7 @@ protected:
     explicit AnalogMeterType(Serializer::Properties& props, bool is_derived) noexcept
         : ValueRangeWidget<T>(props, true)
     {
-        this->name("AnalogMeter" + std::to_string(this->m_widgetid));
+        this->default_name("AnalogMeter", this->m_widgetid);
         this->fill_flags(Theme::FillFlag::blend);
 
         if (!is_derived)
@@ -1132,6 +1191,7 @@ void AnalogMeterType<T>::default_size(const Size& size)
         unregister_handler();
 
     AnalogMeterType<T>::m_default_size = size;
+    Widget::invalidate_all_size_hints();
 }
 
 }
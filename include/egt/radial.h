@@ -7,6 +7,7 @@
 #define EGT_RADIAL_H
 
 #include <algorithm>
+#include <cmath>
 #include <egt/detail/math.h>
 #include <egt/detail/meta.h>
 #include <egt/flags.h>
@@ -16,6 +17,7 @@
 #include <egt/text.h>
 #include <egt/value.h>
 #include <egt/widget.h>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -85,7 +87,7 @@ public:
     explicit RadialType(const Rect& rect = {}) noexcept
         : Widget(rect)
     {
-        this->name("Radial" + std::to_string(m_widgetid));
+        this->default_name("Radial", m_widgetid);
         this->grab_mouse(true);
     }
 
@@ -112,7 +114,7 @@ protected:
     explicit RadialType(Serializer::Properties& props, bool is_derived) noexcept
         : Widget(props, true)
     {
-        this->name("Radial" + std::to_string(m_widgetid));
+        this->default_name("Radial", m_widgetid);
         this->grab_mouse(true);
 
         if (!is_derived)
@@ -138,11 +140,13 @@ public:
         // TODO: m_handle_counter can wrap, making the handle non-unique
         auto handle = ++this->m_handle_counter;
         this->m_values.emplace_back(range, color, width, flags, handle);
+        this->m_values.back().degrees = value_to_degrees(range->start(), range->end(),
+                                        range->value());
 
         // when a value changes, damage
-        range->on_value_changed([this, flags]()
+        range->on_value_changed([this, handle]()
         {
-            this->damage();
+            this->damage_value(handle);
         });
 
         damage();
@@ -160,7 +164,7 @@ public:
         auto i = std::find_if(this->m_values.begin(), this->m_values.end(),
                               [&handle](const auto & obj)
         {
-            return obj->handle == handle;
+            return obj.handle == handle;
         });
 
         if (i != this->m_values.end())
@@ -359,6 +363,100 @@ protected:
 
     bool internal_drag() const override { return true; }
 
+    /// Damage the part of the arc of a range value that changed.
+    void damage_value(Object::RegisterHandle handle)
+    {
+        auto i = std::find_if(this->m_values.begin(), this->m_values.end(),
+                              [&handle](const auto & obj)
+        {
+            return obj.handle == handle;
+        });
+
+        if (i == this->m_values.end())
+            return;
+
+        const auto prev = i->degrees;
+        i->degrees = value_to_degrees(i->range->start(), i->range->end(),
+                                      i->range->value());
+
+        // the center text changes too
+        if (i->flags.is_set(RadialFlag::text_value))
+        {
+            this->damage();
+            return;
+        }
+
+        const auto b = this->content_area();
+        const auto smalldim = std::min(b.width(), b.height());
+
+        DefaultDim maxwidth = 0;
+        for (auto& value : this->m_values)
+            maxwidth = std::max(maxwidth, value.width);
+
+        // arcs are drawn from the start angle, so all angles are after it
+        const auto start = detail::to_radians<float>(-90, start_angle());
+        auto unwrap = [start](float degrees)
+        {
+            auto angle = detail::to_radians<float>(-90, degrees);
+            while (angle < start)
+                angle += 2 * detail::pi<float>();
+            return angle;
+        };
+
+        auto angle1 = unwrap(prev);
+        auto angle2 = unwrap(i->degrees);
+        if (angle1 > angle2)
+            std::swap(angle1, angle2);
+
+        this->damage(arc_box(b.center(), smalldim * 0.5f - (maxwidth * 0.5f),
+                             i->width, angle1, angle2,
+                             i->flags.is_set(RadialFlag::rounded_cap)));
+    }
+
+    /**
+     * Get the bounding box of an arc stroked from angle1 to angle2, in
+     * radians.
+     */
+    static Rect arc_box(const Point& center, float radius, DefaultDim width,
+                        float angle1, float angle2, bool rounded_cap)
+    {
+        const auto inner = std::max(radius - width * 0.5f, 0.f);
+        const auto outer = radius + width * 0.5f;
+
+        auto xmin = std::numeric_limits<float>::max();
+        auto ymin = std::numeric_limits<float>::max();
+        auto xmax = std::numeric_limits<float>::lowest();
+        auto ymax = std::numeric_limits<float>::lowest();
+        auto add = [&](float r, float angle)
+        {
+            const auto x = center.x() + r * std::cos(angle);
+            const auto y = center.y() + r * std::sin(angle);
+            xmin = std::min(xmin, x);
+            ymin = std::min(ymin, y);
+            xmax = std::max(xmax, x);
+            ymax = std::max(ymax, y);
+        };
+
+        add(inner, angle1);
+        add(outer, angle1);
+        add(inner, angle2);
+        add(outer, angle2);
+
+        // the arc reaches further where it crosses an axis
+        const auto quarter = detail::pi<float>() / 2;
+        for (auto angle = std::ceil(angle1 / quarter) * quarter; angle < angle2; angle += quarter)
+            add(outer, angle);
+
+        // round caps go past the ends, and antialiasing a pixel further
+        const auto margin = (rounded_cap ? width * 0.5f : 0.f) + 1.f;
+
+        const auto x = static_cast<DefaultDim>(std::floor(xmin - margin));
+        const auto y = static_cast<DefaultDim>(std::floor(ymin - margin));
+        return {x, y,
+                static_cast<DefaultDim>(std::ceil(xmax + margin)) - x,
+                static_cast<DefaultDim>(std::ceil(ymax + margin)) - y};
+    }
+
     /// @private
     template<class T2>
     struct ValueData
@@ -381,6 +479,8 @@ protected:
         DefaultDim width{};
         RadialFlags flags{};
         Object::RegisterHandle handle{0};
+        /// Value, in degrees, last damaged.
+        float degrees{0.f};
     };
 
     /// Center text of the widget.
@@ -15,6 +15,7 @@
 #include <cstdint>
 #include <egt/detail/meta.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,61 @@ namespace egt
 inline namespace v1
 {
 
+/**
+ * Sequential reader of resource data.
+ *
+ * Data compressed with gzip is decompressed as it is read, a buffer at a
+ * time, so it never has to be in memory whole.  A stream only uses its own
+ * state, so it can be read from any thread, but the data must remain
+ * available while the stream is used.
+ *
+ * @see ResourceManager::open()
+ */
+class EGT_API ResourceStream
+{
+public:
+
+    /**
+     * @param[in] data The data, compressed with gzip or not.
+     * @param[in] len Length of the data.
+     */
+    ResourceStream(const unsigned char* data, size_t len);
+
+    ResourceStream(const ResourceStream&) = delete;
+    ResourceStream& operator=(const ResourceStream&) = delete;
+    ResourceStream(ResourceStream&&) noexcept;
+    ResourceStream& operator=(ResourceStream&&) noexcept;
+
+    ~ResourceStream() noexcept;
+
+    /**
+     * Read the next bytes of the data.
+     *
+     * @param[out] data Where to read the bytes.
+     * @param[in] length Number of bytes to read.
+     * @return The number of bytes read, less than length only at the end.
+     * @throw std::runtime_error If the compressed data is invalid.
+     */
+    size_t read(unsigned char* data, size_t length);
+
+    /**
+     * Restart reading from the beginning.
+     */
+    void reset();
+
+    /**
+     * Is the data decompressed as it is read.
+     */
+    EGT_NODISCARD bool compressed() const;
+
+private:
+
+    struct StreamImpl;
+
+    /// Implementation pointer.
+    std::unique_ptr<StreamImpl> m_impl;
+};
+
 /**
  * Manages EGT resource data blobs.
  *
@@ -31,6 +87,11 @@ inline namespace v1
  * prefix the name in the URI with scheme 'res' to make EGT read the resource
  * from ResourceManager.
  *
+ * Resources compressed with gzip are decompressed the first time data() or
+ * size() is called, and kept decompressed.  Reading them with open(), or
+ * stream_read(), decompresses them as they are read instead, which is how
+ * images are loaded from them.
+ *
  * @see @ref resources
  */
 class EGT_API ResourceManager
@@ -90,6 +151,21 @@ public:
     bool read(const char* name, unsigned char* data,
               size_t length, size_t offset = 0);
 
+    /**
+     * @return true if the resource is compressed, and not decompressed yet.
+     */
+    bool compressed(const char* name);
+
+    /**
+     * Open a stream to read a resource from the beginning.
+     *
+     * A compressed resource is decompressed as it is read, unless it already
+     * is.  The resource must not be removed while the stream is used.
+     *
+     * @return The stream, or nullptr if the resource is not registered.
+     */
+    std::unique_ptr<ResourceStream> open(const char* name);
+
     /// Item array type.
     using ItemArray = std::vector<std::string>;
 
@@ -98,6 +174,11 @@ public:
      */
     EGT_NODISCARD ItemArray list() const;
 
+    /**
+     * Get a list of registered resource names starting with a prefix.
+     */
+    EGT_NODISCARD ItemArray list(const std::string& prefix) const;
+
     /**
      * Reset internal read stream offset.
      *
@@ -107,6 +188,9 @@ public:
 
     /**
      * Read starting from internal stream offset.
+     *
+     * A compressed resource is decompressed as it is read, unless it already
+     * is.
      */
     bool stream_read(const char* name, unsigned char* data, size_t length);
 
@@ -12,9 +12,14 @@
  */
 
 #include <cairo.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <egt/detail/meta.h>
 #include <egt/geometry.h>
+#include <egt/signal.h>
 #include <egt/types.h>
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <vector>
@@ -39,6 +44,42 @@ public:
      */
     using DamageArray = std::vector<Rect>;
 
+    /**
+     * Strategy used to merge damage rectangles.
+     */
+    enum class DamageMode
+    {
+        /**
+         * Merge rectangles as soon as they intersect.
+         */
+        intersect,
+
+        /**
+         * Merge rectangles only when the merged rectangle is cheaper to paint
+         * than the separate rectangles, as configured by DamageCost.
+         */
+        cost,
+    };
+
+    /**
+     * Parameters for DamageMode::cost.
+     */
+    struct DamageCost
+    {
+        /**
+         * Maximum fraction, from 0.0 to 1.0, of a merged rectangle that is
+         * allowed to be area that was not actually damaged.
+         */
+        float max_waste{0.25f};
+
+        /**
+         * Maximum number of rectangles to keep before merges are forced.
+         *
+         * Zero means no limit.
+         */
+        size_t max_rects{16};
+    };
+
     Screen() noexcept;
     Screen(const Screen&) = default;
     Screen& operator=(const Screen&) = default;
@@ -63,12 +104,29 @@ public:
      */
     virtual void schedule_flip()  = 0;
 
+    /**
+     * Called by the event loop once the windows of a frame are drawn.
+     *
+     * Screens batching the changes of a frame, like the flips of several
+     * planes, submit them here.
+     */
+    virtual void end_frame() {}
+
     /**
      * If the screen implementation manages multiple buffers, this will
      * return the index of the current buffer.
      */
     virtual uint32_t index() { return 0; }
 
+    /**
+     * Returns false while every buffer of the screen waits to be flipped.
+     *
+     * A frame flipped now would block until the display catches up, so
+     * windows keep their damage for a later frame instead.  This is what
+     * keeps a slow display from stalling the windows of the other ones.
+     */
+    EGT_NODISCARD virtual bool flip_ready() const { return true; }
+
     /**
      * Size of the screen.
      */
@@ -97,6 +155,220 @@ public:
      */
     static void damage_algorithm(Screen::DamageArray& damage, Rect rect);
 
+    /**
+     * Cost based version of the algorithm for adding damage rectangles to a
+     * list.
+     *
+     * The new rectangle is only merged with an existing rectangle when the
+     * merged rectangle wastes less than DamageCost::max_waste of its area.
+     * When the list would grow past DamageCost::max_rects, the new rectangle
+     * is merged with the existing rectangle that wastes the least area.
+     *
+     * @param[in,out] damage The starting and ending damage array.
+     * @param[in] rect The new rectangle to add.
+     * @param[in] cost Merge parameters.
+     */
+    static void damage_algorithm(Screen::DamageArray& damage, Rect rect,
+                                 const DamageCost& cost);
+
+    /**
+     * Compact an arbitrary list of damage rectangles in O(n log n).
+     *
+     * This sorts the rectangles and only considers neighbors for merging,
+     * which is appropriate for large damage lists where the incremental
+     * algorithm becomes quadratic.
+     *
+     * @param[in,out] damage The damage array to compact.
+     * @param[in] cost Merge parameters.
+     */
+    static void damage_optimize(Screen::DamageArray& damage,
+                                const DamageCost& cost);
+
+    /**
+     * Add a damage rectangle to a list using the damage mode of this screen.
+     *
+     * @param[in,out] damage The starting and ending damage array.
+     * @param[in] rect The new rectangle to add.
+     */
+    void add_damage(Screen::DamageArray& damage, const Rect& rect) const;
+
+    /**
+     * Set the damage mode used by add_damage().
+     */
+    void damage_mode(DamageMode mode)
+    {
+        m_damage_mode = mode;
+    }
+
+    /**
+     * Get the damage mode used by add_damage().
+     */
+    EGT_NODISCARD DamageMode damage_mode() const { return m_damage_mode; }
+
+    /**
+     * Set the parameters used with DamageMode::cost.
+     */
+    void damage_cost(const DamageCost& cost)
+    {
+        m_damage_cost = cost;
+    }
+
+    /**
+     * Get the parameters used with DamageMode::cost.
+     */
+    EGT_NODISCARD const DamageCost& damage_cost() const { return m_damage_cost; }
+
+    /**
+     * Render directly into the screen buffers.
+     *
+     * Normally, every frame is drawn into a composition buffer and the damaged
+     * areas are then copied into the next screen buffer before it is flipped.
+     * When enabled, context() instead targets the next screen buffer itself,
+     * which removes the copy. Each buffer keeps track of the damage it missed
+     * since it was last drawn, and that damage is redrawn along with the
+     * damage of the frame, see add_buffer_damage().
+     *
+     * @param enable Enable or disable rendering directly into screen buffers.
+     * @return true if zero copy is enabled after the call.
+     *
+     * @note This requires the screen to manage at least one buffer.
+     */
+    bool zero_copy(bool enable);
+
+    /**
+     * Returns true if rendering directly into the screen buffers.
+     */
+    EGT_NODISCARD bool zero_copy() const { return m_zero_copy; }
+
+    /**
+     * Let the event loop enable zero_copy() when it is safe.
+     *
+     * While a single opaque window covers the screen, the composition buffer
+     * only adds a copy, and the screen renders directly into its buffers.  As
+     * soon as another composed window, like a Popup or a Dialog, is shown,
+     * the screen goes back to composition.
+     *
+     * @note Disabling it leaves zero_copy() as it is.
+     */
+    void auto_zero_copy(bool enable) { m_auto_zero_copy = enable; }
+
+    /**
+     * Returns true if the event loop switches zero_copy() automatically.
+     */
+    EGT_NODISCARD bool auto_zero_copy() const { return m_auto_zero_copy; }
+
+    /**
+     * Read throughput of the buffers of the screen, in bytes per second.
+     *
+     * Drawing reads back the pixels it blends with.  The composition buffer
+     * is in cached memory, see the EGT_COMPOSITION_MEMORY environment
+     * variable, while the screen buffers are usually write-combined, fast to
+     * copy frames to and slow to read back, which is what zero_copy() draws
+     * on.
+     */
+    struct Readback
+    {
+        /// Read throughput of the composition buffer, zero if not measured.
+        double composition{0};
+        /// Read throughput of the screen buffers, zero if not measured.
+        double scanout{0};
+    };
+
+    /**
+     * Get the read throughput of the buffers of the screen.
+     *
+     * It is measured the first time, on part of the buffers, as long as
+     * the screen manages buffers and draws to its composition buffer.
+     */
+    const Readback& readback();
+
+    /**
+     * Dither the frames copied to 8-bit RGB screen buffers.
+     *
+     * With PixelFormat::rgb332 and PixelFormat::c8, the 32-bit composition
+     * buffer is reduced to 3 bits of red and green and 2 bits of blue when it
+     * is copied to the screen buffers.  Ordered dithering trades the banding
+     * of gradients for a fixed pattern.  It is enabled by default.
+     */
+    void dither(bool enable) { m_dither = enable; }
+
+    /**
+     * Returns true if the frames copied to 8-bit RGB buffers are dithered.
+     */
+    EGT_NODISCARD bool dither() const { return m_dither; }
+
+    /**
+     * Add the damage the current buffer missed since it was last drawn.
+     *
+     * This only does something in zero_copy() mode, where the returned area of
+     * the buffer has to be redrawn because the buffer holds stale content.
+     *
+     * @param[in,out] damage Damage array of the frame about to be drawn.
+     */
+    void add_buffer_damage(DamageArray& damage);
+
+    /**
+     * Counters of the pixels handled by flip().
+     *
+     * The difference between copied_pixels and damaged_pixels is the overdraw
+     * caused by merging damage rectangles and by bringing every buffer up to
+     * date with the frames it missed.
+     */
+    struct FlipStats
+    {
+        /// Number of frames flipped.
+        uint64_t frames{0};
+        /// Pixels damaged by the frames.
+        uint64_t damaged_pixels{0};
+        /// Pixels copied from the composition buffer to the screen buffers.
+        uint64_t copied_pixels{0};
+    };
+
+    /**
+     * Get the flip statistics collected since the last reset_flip_stats().
+     */
+    EGT_NODISCARD const FlipStats& flip_stats() const { return m_flip_stats; }
+
+    /**
+     * Reset the flip statistics.
+     */
+    void reset_flip_stats() { m_flip_stats = {}; }
+
+    /// Type used for flip completion callbacks.
+    using FlipCallback = std::function<void(std::chrono::steady_clock::time_point)>;
+
+    /**
+     * Set a callback that is invoked each time a scheduled flip completed.
+     *
+     * The callback is invoked from the event loop with the time the flip
+     * completed.  Screens that flip synchronously, or do not report flip
+     * completion, never invoke it.
+     *
+     * @param callback The callback, or nullptr to remove it.
+     */
+    void on_flip(FlipCallback callback)
+    {
+        m_flip_callback = std::move(callback);
+    }
+
+    /**
+     * Invoked with the damage of each frame flipped.
+     *
+     * Handlers are invoked by flip(), before the frame is copied to the screen
+     * buffers, while the target of context() holds the frame.
+     */
+    Signal<const DamageArray&> on_damage;
+
+    /**
+     * Get the time the last scheduled flip completed.
+     *
+     * This is the epoch of the clock if no completion was reported yet.
+     */
+    EGT_NODISCARD std::chrono::steady_clock::time_point last_flip() const
+    {
+        return m_last_flip;
+    }
+
     /**
      * Set if asynchronous buffer flips are used.
      */
@@ -105,6 +377,34 @@ public:
         m_async = async;
     }
 
+    /**
+     * Get the rotation of the screen, in degrees clockwise: 0, 90, 180 or 270.
+     *
+     * size() is the size of the screen once rotated, which is what windows
+     * are laid out in.
+     *
+     * @note Only the KMS screen supports rotation, set with the
+     * EGT_SCREEN_ROTATION environment variable.
+     */
+    EGT_NODISCARD uint32_t rotation() const { return m_rotation; }
+
+    /**
+     * Returns true if the display controller rotates the screen, instead of
+     * the screen buffers being drawn rotated.
+     */
+    EGT_NODISCARD bool hardware_rotation() const { return m_hardware_rotation; }
+
+    /**
+     * Map a point of the display, as reported by input devices, to the
+     * rotated screen.
+     */
+    EGT_NODISCARD DisplayPoint rotate_point(const DisplayPoint& point) const;
+
+    /**
+     * Map a rectangle of the rotated screen to the screen buffers.
+     */
+    EGT_NODISCARD Rect buffer_rect(const Rect& rect) const;
+
     /**
      * Get the max brightness of the screen.
      *
@@ -132,7 +432,10 @@ public:
      * Configure low fidelity options.
      *
      * This configures settings related to font hinting, font aliasing, and
-     * shape aliasing.
+     * shape aliasing.  Painters of the context also draw images, gradients
+     * and shadows in cheaper ways, see Painter::low_fidelity().
+     *
+     * @see EventLoop::adaptive_fidelity()
      */
     virtual void low_fidelity();
 
@@ -190,23 +493,92 @@ protected:
 
         unique_cairo_surface_t surface;
 
+        /**
+         * Context used to draw directly to the buffer in zero copy mode.
+         */
+        shared_cairo_t cr;
+
         /**
          * Each rect that needs to be copied from the back buffer.
          */
         DamageArray damage;
 
+        /**
+         * Frame last drawn to the buffer, or zero if its content is undefined.
+         */
+        uint64_t frame{0};
+
         void add_damage(const Rect& rect)
         {
             Screen::damage_algorithm(damage, rect);
         }
     };
 
-    /// Copy the framebuffer to the current composition buffer.
+    /**
+     * Copy the framebuffer to the current composition buffer.
+     *
+     * When the screen buffers are drawn rotated, the damage of the buffer is
+     * mapped to the buffer by buffer_rect() once copied.
+     */
     virtual void copy_to_buffer(ScreenBuffer& buffer);
 
     /// Copy the framebuffer to the current composition buffer.
     void copy_to_buffer_software(ScreenBuffer& buffer);
 
+    /// Copy and rotate the framebuffer to the current composition buffer.
+    void copy_to_buffer_rotated(ScreenBuffer& buffer);
+
+    /**
+     * Convert the framebuffer to the current 8 bits per pixel buffer.
+     *
+     * The composition buffer stays 32 bits per pixel, and the damage is
+     * converted to the format of the screen while it is copied.
+     */
+    void copy_to_buffer_8bpp(ScreenBuffer& buffer);
+
+    /**
+     * Set the rotation of the screen, before init().
+     *
+     * @param degrees Rotation in degrees clockwise: 0, 90, 180 or 270.
+     * @param hardware If true, the display controller rotates the screen and
+     *        init() expects buffers the size of the rotated screen.
+     *        Otherwise, the screen buffers are drawn rotated.
+     */
+    void rotation(uint32_t degrees, bool hardware);
+
+    /// Returns true if the screen buffers are drawn rotated.
+    EGT_NODISCARD bool software_rotation() const
+    {
+        return m_rotation && !m_hardware_rotation;
+    }
+
+    /// Called by implementations, in the event loop, when a flip completed.
+    void flip_completed(std::chrono::steady_clock::time_point when);
+
+    /// Select the buffer that context() draws to in zero copy mode.
+    void select_buffer(uint32_t index);
+
+    /**
+     * Get the age of a buffer in frames.
+     *
+     * Relative to the frame being drawn, an age of 1 means the buffer holds
+     * the previous frame, 2 the frame before that, and so on.  An age of zero
+     * means the content of the buffer is undefined.
+     */
+    EGT_NODISCARD uint64_t buffer_age(const ScreenBuffer& buffer) const
+    {
+        return buffer.frame ? m_frame + 1 - buffer.frame : 0;
+    }
+
+    /**
+     * Add the union of the damage of all frames a buffer missed since it was
+     * last drawn, based on its buffer_age().
+     *
+     * @param[in,out] damage The damage array to add to.
+     * @param buffer The buffer to get the missed damage of.
+     */
+    void add_missed_damage(DamageArray& damage, const ScreenBuffer& buffer) const;
+
     /// Composition surface.
     shared_cairo_surface_t m_surface;
 
@@ -227,6 +599,51 @@ protected:
 
     /// Format of the screen.
     PixelFormat m_format{};
+
+    /// Damage rectangle merge strategy.
+    DamageMode m_damage_mode{DamageMode::intersect};
+
+    /// Parameters for DamageMode::cost.
+    DamageCost m_damage_cost{};
+
+    /// Render directly into the screen buffers.
+    bool m_zero_copy{false};
+
+    /// Switch zero copy with the windows of the screen.
+    bool m_auto_zero_copy{false};
+
+    /// Dither the frames copied to 8-bit RGB buffers.
+    bool m_dither{true};
+
+    /// Bytes of each buffer read by readback().
+    static constexpr size_t READBACK_BYTES = 256 * 1024;
+
+    /// Measured read throughput of the buffers.
+    Readback m_readback{};
+
+    /// Scratch rows for rotating converted pixels.
+    std::vector<uint8_t> m_convert;
+
+    /// Number of the last frame flipped.
+    uint64_t m_frame{0};
+
+    /// Damage of the most recent frames, newest first.
+    std::deque<DamageArray> m_damage_history;
+
+    /// Pixel counters of flip().
+    FlipStats m_flip_stats{};
+
+    /// Flip completion callback.
+    FlipCallback m_flip_callback;
+
+    /// Time the last flip completed.
+    std::chrono::steady_clock::time_point m_last_flip{};
+
+    /// Rotation of the screen, in degrees clockwise.
+    uint32_t m_rotation{0};
+
+    /// Is the rotation done by the display controller.
+    bool m_hardware_rotation{false};
 };
 
 }
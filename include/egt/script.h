@@ -11,7 +11,11 @@
  * @brief Working with scripts.
  */
 
+#include <chrono>
 #include <egt/detail/meta.h>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
 
 namespace egt
@@ -30,6 +34,77 @@ namespace experimental
  */
 EGT_API double lua_evaluate(const std::string& expr);
 
+/**
+ * Evaluates LUA expressions on a worker thread.
+ *
+ * The worker has its own LUA state, separate from any other, which is kept
+ * between evaluations, so globals set by an expression can be used by the
+ * next ones.  Expressions are evaluated one at a time, in order, and an
+ * evaluation running longer than the timeout is stopped with an error, so a
+ * script can neither block the event loop nor stall the worker.
+ *
+ * @b Example
+ * @code{.cpp}
+ * egt::experimental::ScriptWorker worker;
+ * worker.evaluate("2^10", [](double result, const std::string& error)
+ * {
+ *     // called from the event loop
+ * });
+ * @endcode
+ */
+class EGT_API ScriptWorker
+{
+public:
+
+    /**
+     * Type of the function called with the result of an evaluation.
+     *
+     * @param result Result of the expression, or 0 on error.
+     * @param error Error message, or empty.
+     */
+    using Callback = std::function<void(double result, const std::string& error)>;
+
+    /**
+     * @param timeout Maximum time an evaluation may run.
+     */
+    explicit ScriptWorker(std::chrono::milliseconds timeout = std::chrono::milliseconds(100));
+
+    ScriptWorker(const ScriptWorker&) = delete;
+    ScriptWorker& operator=(const ScriptWorker&) = delete;
+    ScriptWorker(ScriptWorker&&) = delete;
+    ScriptWorker& operator=(ScriptWorker&&) = delete;
+
+    /**
+     * Evaluate an expression.
+     *
+     * @param expr LUA expression.
+     * @return The result, or an exception if the evaluation failed.
+     */
+    std::future<double> evaluate(const std::string& expr);
+
+    /**
+     * Evaluate an expression, and call a function with its result from the
+     * event loop.
+     *
+     * @param expr LUA expression.
+     * @param callback Called with the result.
+     */
+    void evaluate(const std::string& expr, Callback callback);
+
+    /// Set the maximum time an evaluation may run.
+    void timeout(std::chrono::milliseconds timeout);
+
+    /// Get the maximum time an evaluation may run.
+    EGT_NODISCARD std::chrono::milliseconds timeout() const;
+
+    ~ScriptWorker() noexcept;
+
+private:
+
+    struct ScriptWorkerImpl;
+    std::unique_ptr<ScriptWorkerImpl> m_impl;
+};
+
 }
 }
 }
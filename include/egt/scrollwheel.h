@@ -12,11 +12,14 @@
  *
  */
 
+#include <egt/animation.h>
 #include <egt/button.h>
 #include <egt/detail/meta.h>
 #include <egt/grid.h>
 #include <egt/label.h>
 #include <egt/signal.h>
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -28,7 +31,10 @@ inline namespace v1
  * Scrollwheel widget.
  *
  * Manages a list of selectable items. Only the one selected is shown.
- * Navigation through the list is done with the top and bottom arrows.
+ * Navigation through the list is done with the top and bottom arrows, or by
+ * dragging the wheel: the selection moves one item for each item dragged,
+ * and keeps moving at the speed of the drag when it ends, slowing down until
+ * it stops.
  *
  * @ingroup controls
  */
@@ -47,6 +53,9 @@ public:
     /// Item array type.
     using ItemArray = std::vector<std::string>;
 
+    /// Type of the callback returning the item at an index.
+    using ItemCallback = std::function<std::string(size_t index)>;
+
     /**
      * @param[in] items Array of items to build the list.
      */
@@ -90,6 +99,8 @@ protected:
 public:
 
     /**
+     * The items of the range are given on demand, see items().
+     *
      * @param[in] min The range minimum value.
      * @param[in] max The range maximum value.
      * @param[in] step The value of step to create a list from the minimum value to the maximum one.
@@ -122,6 +133,23 @@ public:
      */
     EGT_NODISCARD std::string value() const;
 
+    /**
+     * Use items returned on demand by a callback instead of an array.
+     *
+     * Only the items shown are asked for, so a wheel over a wide range, i.e.
+     * years, does not hold all of them.  Adding or removing an item turns
+     * them into an array.
+     *
+     * @param[in] count The number of items.
+     * @param[in] callback Returns the item at an index.
+     */
+    void items(size_t count, ItemCallback callback);
+
+    /**
+     * Returns the item at an index.
+     */
+    EGT_NODISCARD std::string item(size_t index) const;
+
     /**
      * Add an item at the end of the array.
      */
@@ -150,7 +178,10 @@ public:
     /**
      * Return the number of items.
      */
-    EGT_NODISCARD size_t item_count() const { return m_items.size(); }
+    EGT_NODISCARD size_t item_count() const
+    {
+        return m_item_callback ? m_item_count : m_items.size();
+    }
 
     /**
      * Enable or disable the reversed mode. When enabled the behavior of
@@ -163,15 +194,28 @@ public:
      */
     EGT_NODISCARD bool reversed() const { return m_reversed; }
 
+    void handle(Event& event) override;
+
     void serialize(Serializer& serializer) const override;
 
 protected:
+
+    bool internal_drag() const override { return true; }
+
     /// @private
     void init(bool in_deserialize = false);
     /// @private
     void update_orientation();
+    /// @private
+    void materialize();
+    /// Select the item a drag, or what follows it, has moved to.
+    void scroll(float offset);
     /// Array of items.
     ItemArray m_items;
+    /// Callback returning the items, instead of the array.
+    ItemCallback m_item_callback;
+    /// Number of items returned by the callback.
+    size_t m_item_count{0};
     /// Currently selected index.
     size_t m_selected{0};
     /// Layout grid.
@@ -186,6 +230,16 @@ protected:
     bool m_reversed{false};
     /// Orientation of the Scrollwheel.
     Orientation m_orient{Orientation::vertical};
+    /// Selected index when the drag started.
+    size_t m_drag_selected{0};
+    /// Distance of the drag along the wheel.
+    float m_drag_offset{0};
+    /// Distance of the drag when the wheel starts moving on its own.
+    float m_fling_start{0};
+    /// How far the wheel moves after a drag.
+    float m_fling_distance{0};
+    /// Moves the wheel after a drag.
+    AutoAnimation m_fling{0, 1, std::chrono::milliseconds(750), easing_cubic_easeout};
 
 private:
 
@@ -17,6 +17,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace egt
@@ -44,7 +45,14 @@ public:
     /// Attributes array type.
     using Attributes = std::list<std::pair<std::string, std::string>>;
 
-    using Properties = std::list<std::tuple<std::string, std::string, Serializer::Attributes>>;
+    /**
+     * Properties array type, of name, value and attributes.
+     *
+     * Names are views, which must stay valid as long as the properties are
+     * used.  The loader interns them with detail::intern(), as the same few
+     * names are used by every widget.
+     */
+    using Properties = std::list<std::tuple<std::string_view, std::string, Serializer::Attributes>>;
 
     /// Add a widget to the serializer.
     virtual bool add(const Widget* widget) = 0;
@@ -154,6 +162,9 @@ private:
  * xml.write(std::cout);
  * @endcode
  *
+ * The XML is written as widgets are added, without building a document in
+ * memory first.
+ *
  * @see Widget::walk()
  */
 class EGT_API XmlWidgetSerializer : public Serializer
@@ -196,6 +207,62 @@ private:
     std::unique_ptr<XmlSerializerImpl> m_impl;
 };
 
+/**
+ * Serialize a widget tree to a compiled UI file.
+ *
+ * The document is the same one XmlWidgetSerializer writes, in the format the
+ * ui-compile tool produces, so experimental::UiLoader loads it back without
+ * parsing.
+ *
+ * @code{.cpp}
+ * // already have a Window variable named win
+ * BinaryWidgetSerializer binary;
+ * binary.add(&win);
+ * binary.write("output.eui");
+ * @endcode
+ *
+ * @see XmlWidgetSerializer
+ */
+class EGT_API BinaryWidgetSerializer : public Serializer
+{
+public:
+    BinaryWidgetSerializer();
+    BinaryWidgetSerializer(const BinaryWidgetSerializer&) = delete;
+    BinaryWidgetSerializer& operator=(const BinaryWidgetSerializer&) = delete;
+    BinaryWidgetSerializer(BinaryWidgetSerializer&&) noexcept = default;
+    BinaryWidgetSerializer& operator=(BinaryWidgetSerializer&&) noexcept = default;
+
+    /// Clear or reset, the serializer for re-use.
+    void reset();
+
+    bool add(const Widget* widget) override;
+
+    Context* begin_child(const std::string& nodename) override;
+
+    void end_child(Context* context) override;
+
+    using Serializer::add_property;
+
+    void add_property(const std::string& name, const std::string& value,
+                      const Attributes& attrs = {}) override;
+
+    void add_property(const std::string& name, const Pattern& value,
+                      const Attributes& attrs = {}) override;
+
+    /// Write to the specified file path.
+    void write(const std::string& filename);
+
+    /// Write to the specified ostream.
+    void write(std::ostream& out) override;
+
+    ~BinaryWidgetSerializer() noexcept override;
+
+private:
+
+    struct BinarySerializerImpl;
+    std::unique_ptr<BinarySerializerImpl> m_impl;
+};
+
 class EGT_API Deserializer
 {
 public:
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SEVENSEGMENT_H
+#define EGT_SEVENSEGMENT_H
+
+/**
+ * @file
+ * @brief Working with seven segment displays.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/color.h>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/palette.h>
+#include <egt/types.h>
+#include <egt/widget.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Frame;
+
+/**
+ * Numeric readout drawn as seven segment digits.
+ *
+ * The widget has a fixed number of digits, each in a cell of the same size,
+ * so changing the value never changes its size hint or causes a layout.
+ * Only the cells of the digits that changed are damaged.
+ *
+ * The segments of every digit shown are rendered once, for the size of the
+ * cells, into an alpha mask.  Drawing a digit paints the color of the text
+ * through its mask, and the unlit segments with the unlit color, if any.
+ *
+ * The digits 0 to 9, the letters A to F, H, L, P, U, n, o, r, and '-', '_'
+ * and ' ' can be shown.  A '.' or a ',' lights the decimal point of the
+ * digit before it.
+ *
+ * @b Example
+ * @code{.cpp}
+ * SevenSegment rpm(5);
+ * rpm.value(2450);
+ * @endcode
+ *
+ * @ingroup controls
+ */
+class EGT_API SevenSegment : public Widget
+{
+public:
+
+    /**
+     * @param[in] digits The number of digits.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    explicit SevenSegment(size_t digits = 4, const Rect& rect = {});
+
+    /**
+     * @param[in] parent The parent Frame.
+     * @param[in] digits The number of digits.
+     * @param[in] rect Initial rectangle of the widget.
+     */
+    SevenSegment(Frame& parent, size_t digits, const Rect& rect = {});
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    using Widget::min_size_hint;
+
+    /**
+     * Size of the digits at the height of the font, without any value.
+     */
+    EGT_NODISCARD Size min_size_hint() const override;
+
+    /**
+     * Set the text shown.
+     *
+     * The text is aligned to the right of the digits.  When it has more
+     * digits than the widget, only the last ones are shown.
+     *
+     * @throws std::runtime_error if the text has a character that cannot be
+     *         shown.
+     */
+    void text(const std::string& text);
+
+    /**
+     * Get the text shown.
+     */
+    EGT_NODISCARD const std::string& text() const { return m_text; }
+
+    /**
+     * Show a value.
+     *
+     * @param[in] value The value.
+     * @param[in] precision The number of digits after the decimal point.
+     */
+    void value(double value, int precision = 0);
+
+    /**
+     * Set the number of digits.
+     */
+    void digits(size_t digits);
+
+    /**
+     * Get the number of digits.
+     */
+    EGT_NODISCARD size_t digits() const { return m_segments.size(); }
+
+    /**
+     * Set the color of the unlit segments.
+     *
+     * Unlit segments are not drawn with a transparent color, the default.
+     */
+    void unlit(const Color& color);
+
+    /**
+     * Get the color of the unlit segments.
+     */
+    EGT_NODISCARD const Color& unlit() const { return m_unlit; }
+
+    /**
+     * Get the segments lit for a character, with bit 0 for the segment a to
+     * bit 6 for the segment g, and bit 7 for the decimal point.
+     *
+     * @throws std::runtime_error if the character cannot be shown.
+     */
+    static uint8_t segments(char c);
+
+protected:
+
+    /// Rectangle of the cell of a digit.
+    EGT_NODISCARD Rect cell(size_t index) const;
+
+    /// Mask of segments, rendered for the size of the cells if needed.
+    cairo_surface_t* mask(uint8_t segments);
+
+    /// Text shown.
+    std::string m_text;
+
+    /// Segments lit for each digit.
+    std::vector<uint8_t> m_segments;
+
+    /// Color of the unlit segments.
+    Color m_unlit{Palette::transparent};
+
+    /// Masks of the segments drawn, for the size of the cells.
+    std::map<uint8_t, shared_cairo_surface_t> m_masks;
+
+    /// Size of the cells the masks are rendered for.
+    Size m_mask_size;
+};
+
+}
+}
+
+#endif
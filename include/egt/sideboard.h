@@ -29,6 +29,10 @@ inline namespace v1
  * This is a widget that manages a Window that slides on and off the screen,
  * with only a small portion of it, the "handle", shown so that sliding it out
  * can be initiated by default.
+ *
+ * While it slides, the window is moved to an overlay plane if one is free,
+ * so each step only moves the plane instead of composing the board again,
+ * see Window::animating().
  */
 class EGT_API SideBoard : public Window
 {
@@ -13,6 +13,7 @@
 
 #include <cstdint>
 #include <egt/detail/cow.h>
+#include <egt/detail/delegate.h>
 #include <egt/detail/meta.h>
 #include <functional>
 #include <vector>
@@ -40,6 +41,14 @@ public:
      */
     using EventCallback = std::function<void(Args...)>;
 
+    /**
+     * Stored event handler.
+     *
+     * Handlers are stored without going through EventCallback, so small
+     * lambdas are stored inline and called with a single indirect call.
+     */
+    using CallbackDelegate = detail::Delegate<void(Args...)>;
+
     /**
      * Handle type.
      */
@@ -52,17 +61,20 @@ public:
      * handler function can be registered multiple times, optionally with
      * different masks.
      *
-     * @param handler The callback to invoke on event.
+     * @param handler The callback to invoke on event.  Any callable taking
+     *                the arguments of the signal.
      * @return A handle used to identify the registration.  This can then be
      *         passed to remove_handler().
      */
-    RegisterHandle on_event(const EventCallback& handler)
+    template<class F>
+    RegisterHandle on_event(F&& handler)
     {
-        if (handler)
+        CallbackDelegate callback(std::forward<F>(handler));
+        if (callback)
         {
             // TODO: m_handle_counter can wrap, making the handle non-unique
             auto handle = ++m_handle_counter;
-            m_callbacks->emplace_back(handler, handle);
+            m_callbacks->emplace_back(std::move(callback), handle);
             return handle;
         }
 
@@ -72,9 +84,10 @@ public:
     /**
      * Convenience wrapper for on_event().
      */
-    inline RegisterHandle operator()(const EventCallback& handler)
+    template<class F>
+    inline RegisterHandle operator()(F&& handler)
     {
-        return on_event(handler);
+        return on_event(std::forward<F>(handler));
     }
 
     /**
@@ -159,13 +172,13 @@ private:
      */
     struct CallbackMeta
     {
-        CallbackMeta(EventCallback c,
+        CallbackMeta(CallbackDelegate c,
                      RegisterHandle h) noexcept
             : callback(std::move(c)),
               handle(h)
         {}
 
-        EventCallback callback;
+        CallbackDelegate callback;
         RegisterHandle handle{0};
     };
 
@@ -12,10 +12,12 @@
  */
 
 #include <egt/detail/alignment.h>
+#include <egt/detail/layout.h>
 #include <egt/detail/meta.h>
 #include <egt/frame.h>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace egt
 {
@@ -58,7 +60,7 @@ public:
         : m_orient(orient),
           m_justify(justify)
     {
-        name("BoxSizer" + std::to_string(m_widgetid));
+        default_name("BoxSizer", m_widgetid);
     }
 
     /**
@@ -182,6 +184,12 @@ protected:
     /// @private
     Justification m_justify{Justification::start};
 
+    /// @private
+    detail::FlexLayout m_flex;
+
+    /// @private
+    std::vector<detail::LayoutRect> m_rects;
+
 private:
 
     void deserialize(Serializer::Properties& props);
@@ -202,7 +210,7 @@ public:
     explicit HorizontalBoxSizer(Justification justify = Justification::middle)
         : BoxSizer(Orientation::horizontal, justify)
     {
-        name("HorizontalBoxSizer" + std::to_string(m_widgetid));
+        default_name("HorizontalBoxSizer", m_widgetid);
     }
 
     explicit HorizontalBoxSizer(Serializer::Properties& props)
@@ -245,7 +253,7 @@ public:
     explicit VerticalBoxSizer(Justification justify = Justification::middle)
         : BoxSizer(Orientation::vertical, justify)
     {
-        name("VerticalBoxSizer" + std::to_string(m_widgetid));
+        default_name("VerticalBoxSizer", m_widgetid);
     }
 
     explicit VerticalBoxSizer(Serializer::Properties& props)
@@ -288,7 +296,7 @@ public:
     explicit FlexBoxSizer(Justification justify = Justification::middle)
         : BoxSizer(Orientation::flex, justify)
     {
-        name("FlexBoxSizer" + std::to_string(m_widgetid));
+        default_name("FlexBoxSizer", m_widgetid);
     }
 
     /**
@@ -333,21 +333,7 @@ protected:
         T prev_value = this->m_value;
         if (this->set_value(value))
         {
-            auto r = Rect::merge(handle_box(prev_value), handle_box());
-            this->damage(r);
-
-            if (slider_flags().is_set(SliderFlag::show_label))
-            {
-                std::string text;
-                Canvas canvas(Size(100, 100));
-                Painter painter(canvas.context());
-
-                auto label_rect = label_box(painter, prev_value, text);
-                this->damage(label_rect);
-
-                label_rect = label_box(painter, this->m_value, text);
-                this->damage(label_rect);
-            }
+            damage_value(prev_value);
 
             if (m_live_update)
             {
@@ -358,6 +344,24 @@ protected:
         }
     }
 
+    /// Damage the handle, and its label, at the previous and current value.
+    void damage_value(T prev) override
+    {
+        // the line only changes between the two handles
+        this->damage(Rect::merge(handle_box(prev), handle_box()));
+
+        if (slider_flags().is_set(SliderFlag::show_label))
+        {
+            // only used to measure text
+            std::string text;
+            Canvas canvas(Size(1, 1));
+            Painter painter(canvas.context());
+
+            this->damage(label_box(painter, prev, text));
+            this->damage(label_box(painter, this->m_value, text));
+        }
+    }
+
     /// Get the calculated handle width.
     EGT_NODISCARD int handle_width() const;
 
@@ -543,6 +547,7 @@ void SliderType<T>::default_size(const Size& size)
         unregister_handler();
 
     SliderType<T>::m_default_size = size;
+    Widget::invalidate_all_size_hints();
 }
 
 template <class T>
@@ -551,7 +556,7 @@ SliderType<T>::SliderType(const Rect& rect, T start, T end, T value,
     : ValueRangeWidget<T>(rect, start, end, value),
       m_orient(orient)
 {
-    this->name("Slider" + std::to_string(this->m_widgetid));
+    this->default_name("Slider", this->m_widgetid);
     this->fill_flags(Theme::FillFlag::blend);
     this->grab_mouse(true);
     this->slider_flags().set(SliderFlag::rectangle_handle);
@@ -11,9 +11,13 @@
  * @brief Working with sound.
  */
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -23,11 +27,33 @@ inline namespace v1
 namespace detail
 {
 struct soundimpl;
+struct soundbankimpl;
 }
 
 namespace experimental
 {
 
+/**
+ * Statistics of the playback of the sounds of a device.
+ *
+ * @see Sound::stats()
+ */
+struct SoundStats
+{
+    /// Number of underruns of the device, each heard as a glitch.
+    uint64_t xruns{0};
+    /// Latency of the device, the duration of its buffer.
+    std::chrono::microseconds latency{0};
+    /// Duration of a period, mixed and written to the device at once.
+    std::chrono::microseconds period{0};
+    /// Fill level of the buffer of the device before the last write, from 0 to 100.
+    unsigned int fill{0};
+    /// Longest delay of the mixer writing a period after the device had room for it.
+    std::chrono::microseconds max_wakeup_latency{0};
+    /// The mixer runs with a real-time priority.
+    bool realtime{false};
+};
+
 /**
  * Simple class to manage playing raw or WAV PCM sound files.
  *
@@ -36,6 +62,24 @@ namespace experimental
  * Sound sound("file:myfile.wav", "1:0")
  * @endcode
  *
+ * The sound file is loaded in memory when set, and shared with the other
+ * Sound instances, or the SoundBank, of the same file.  All the sounds of a
+ * device are
+ * mixed together on a single stream, so they can play at the same time, and
+ * start within a few milliseconds of play().  A limited number of sounds play
+ * at once on a device, the oldest one being stopped for a new one.
+ *
+ * Sound files that would take more than 256 KiB decoded, or that are
+ * compressed, like Ogg Vorbis, Opus, FLAC or ADPCM WAV files with sndfile,
+ * are not loaded in memory: they are decoded while they play, a few
+ * milliseconds ahead, so they only cost a few kilobytes.  A SoundBank still
+ * loads them.
+ *
+ * The latency of the device starts low, and grows when the mixer is late
+ * writing to the device, like when the CPU is busy, so that it does not
+ * underrun again.  The EGT_AUDIO_LATENCY environment variable sets a fixed
+ * latency instead, and stats() tells how the playback went.
+ *
  * Another way to configure the default sound card is at the system level.
  *
  * List available sound cards:
@@ -90,8 +134,18 @@ public:
      */
     void play(bool repeat = false);
 
+    /**
+     * Stop playing the sound.
+     */
     void stop();
 
+    /**
+     * Get the statistics of the playback on the device of the sound.
+     *
+     * They are shared by all the sounds of the device.
+     */
+    EGT_NODISCARD SoundStats stats() const;
+
     virtual ~Sound() noexcept;
 
     /**
@@ -117,6 +171,81 @@ protected:
     std::string m_uri;
 };
 
+/**
+ * Sounds kept loaded in memory for a device.
+ *
+ * A sound is decoded and converted to the rate and format of the device once,
+ * when loaded, and then shared by every Sound of the same file on that device.
+ * So creating or playing such a Sound costs no file access.
+ *
+ * @code{.cpp}
+ * SoundBank bank;
+ * bank.load("file:click.wav");
+ * ...
+ * Sound click("file:click.wav");
+ * click.play();
+ * @endcode
+ */
+class EGT_API SoundBank
+{
+public:
+
+    /**
+     * @param device ALSA sound device.
+     */
+    explicit SoundBank(const std::string& device = "default");
+
+    SoundBank(const SoundBank&) = delete;
+    SoundBank& operator=(const SoundBank&) = delete;
+    SoundBank(SoundBank&&) noexcept;
+    SoundBank& operator=(SoundBank&&) noexcept;
+
+    /**
+     * Load a sound.
+     *
+     * @param uri The WAV file to load.
+     * @param rate Rate of the sound file, when not supported by sndfile.
+     * @param channels The number of channels in the sound file, when not
+     *                 supported by sndfile.
+     * @return true on success.
+     */
+    bool load(const std::string& uri, unsigned int rate = 0, int channels = 0);
+
+    /**
+     * Unload a sound.
+     *
+     * The sound is still available to the Sound instances using it.
+     */
+    void unload(const std::string& uri);
+
+    /**
+     * Unload all the sounds.
+     */
+    void clear();
+
+    /**
+     * Is a sound loaded.
+     */
+    EGT_NODISCARD bool loaded(const std::string& uri) const;
+
+    /**
+     * Get the memory used by the loaded sounds, in bytes.
+     */
+    EGT_NODISCARD size_t memory() const;
+
+    /**
+     * Get the statistics of the playback on the device.
+     */
+    EGT_NODISCARD SoundStats stats() const;
+
+    virtual ~SoundBank() noexcept;
+
+protected:
+
+    /// Implementation pointer.
+    std::unique_ptr<detail::soundbankimpl> m_impl;
+};
+
 }
 }
 }
@@ -11,6 +11,7 @@
  * @brief Working with sprites.
  */
 
+#include <chrono>
 #include <egt/detail/meta.h>
 #include <egt/window.h>
 #include <memory>
@@ -56,6 +57,10 @@ class HardwareSprite;
  *
  * There is no requirement on how many frames are on a line or how many rows of
  * frames there are.
+ *
+ * With hardware planes, the whole sprite sheet is drawn once into the plane
+ * and a frame is shown by only changing the pan position of the plane, so
+ * animating costs no drawing at all.
  */
 class EGT_API Sprite : public Window
 {
@@ -150,6 +155,28 @@ public:
      */
     void change_strip(uint32_t id);
 
+    /**
+     * Animate the frames of the current strip, starting with the first one.
+     *
+     * The frames are stepped by the same timer as every AutoAnimation, or by
+     * the frame clock when it is enabled.
+     *
+     * @param[in] frame_interval How long each frame is shown.
+     * @param[in] loop Start again with the first frame after the last one,
+     *            otherwise stop on the last frame.
+     */
+    void play(std::chrono::milliseconds frame_interval, bool loop = true);
+
+    /**
+     * Stop animating the frames, on the current frame.
+     */
+    void stop();
+
+    /**
+     * Returns true if the frames are being animated.
+     */
+    EGT_NODISCARD bool playing() const;
+
     /**
      * Add a new strip.
      *
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_STREAMCHART_H
+#define EGT_STREAMCHART_H
+
+/**
+ * @file
+ * @brief Working with streaming charts.
+ */
+
+#include <egt/color.h>
+#include <egt/detail/meta.h>
+#include <egt/font.h>
+#include <egt/types.h>
+#include <egt/widget.h>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Frame;
+class Painter;
+
+/**
+ * A line chart of samples appended over time, like an oscilloscope.
+ *
+ * The last capacity() samples of each series are kept in a ring buffer, and
+ * drawn from right to left, the newest one at the right edge.  The chart is
+ * drawn natively in two cached layers: the grid and the axis labels, only
+ * redrawn when the range or the size changes, and the series.  Appending a
+ * sample scrolls the series layer and only draws the new segment, so its cost
+ * does not depend on the number of samples shown.
+ *
+ * The first series is drawn with the Palette::ColorId::button_fg color, the
+ * grid with Palette::ColorId::button_bg, and the labels with
+ * Palette::ColorId::label_text.
+ *
+ * @ingroup controls
+ */
+class EGT_API StreamChart : public Widget
+{
+public:
+
+    /// Default number of samples kept per series.
+    static constexpr size_t DEFAULT_CAPACITY = 100;
+
+    /**
+     * @param[in] rect Initial rectangle of the widget.
+     * @param[in] capacity Number of samples kept per series.
+     */
+    explicit StreamChart(const Rect& rect = {},
+                         size_t capacity = DEFAULT_CAPACITY) noexcept;
+
+    /**
+     * @param[in] parent The parent Frame.
+     * @param[in] rect Initial rectangle of the widget.
+     * @param[in] capacity Number of samples kept per series.
+     */
+    explicit StreamChart(Frame& parent,
+                         const Rect& rect = {},
+                         size_t capacity = DEFAULT_CAPACITY) noexcept;
+
+    /**
+     * @param[in] props list of widget argument and its properties.
+     */
+    explicit StreamChart(Serializer::Properties& props) noexcept
+        : StreamChart(props, false)
+    {
+    }
+
+protected:
+
+    explicit StreamChart(Serializer::Properties& props, bool is_derived) noexcept;
+
+public:
+
+    StreamChart(const StreamChart&) = delete;
+    StreamChart& operator=(const StreamChart&) = delete;
+    StreamChart(StreamChart&&) = delete;
+    StreamChart& operator=(StreamChart&&) = delete;
+    ~StreamChart() noexcept override = default;
+
+    /**
+     * Add a series.
+     *
+     * This removes all samples.
+     *
+     * @param[in] color Color of the series.
+     * @return Index of the series.
+     */
+    size_t add_series(const Color& color);
+
+    /// Get the number of series, at least one.
+    EGT_NODISCARD size_t series_count() const { return m_colors.size() + 1; }
+
+    /// Append a sample to the first series.
+    void append(double value);
+
+    /**
+     * Append a sample to each series.
+     *
+     * Series without a value repeat their last sample.
+     */
+    void append(const std::vector<double>& values);
+
+    /// Get the number of samples of each series.
+    EGT_NODISCARD size_t sample_count() const { return m_count; }
+
+    /**
+     * Get a sample, from the oldest one.
+     *
+     * @throw std::out_of_range if there is no such sample.
+     */
+    EGT_NODISCARD double sample(size_t series, size_t index) const;
+
+    /// Remove all samples.
+    void clear();
+
+    /// Get the number of samples kept per series.
+    EGT_NODISCARD size_t capacity() const { return m_capacity; }
+
+    /**
+     * Set the number of samples kept per series.
+     *
+     * The oldest samples are dropped if there are more.
+     */
+    void capacity(size_t capacity);
+
+    /**
+     * Set the range of values shown on the vertical axis.
+     */
+    void range(double min, double max);
+
+    /// Get the lowest value shown.
+    EGT_NODISCARD double range_min() const { return m_min; }
+
+    /// Get the highest value shown.
+    EGT_NODISCARD double range_max() const { return m_max; }
+
+    /**
+     * Grow the range when a sample is out of it, enabled by default.
+     *
+     * Otherwise, samples out of the range are clipped.
+     */
+    void auto_range(bool enable) { m_auto_range = enable; }
+
+    /// Does the range grow when a sample is out of it.
+    EGT_NODISCARD bool auto_range() const { return m_auto_range; }
+
+    /**
+     * Set the number of grid columns and rows.
+     *
+     * A label is drawn for each row.
+     */
+    void grid(size_t columns, size_t rows);
+
+    /// Get the number of grid columns.
+    EGT_NODISCARD size_t grid_columns() const { return m_columns; }
+
+    /// Get the number of grid rows.
+    EGT_NODISCARD size_t grid_rows() const { return m_rows; }
+
+    /// Set the width of the series lines.
+    void line_width(DefaultDim width);
+
+    /// Get the width of the series lines.
+    EGT_NODISCARD DefaultDim line_width() const { return m_line_width; }
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    void resize(const Size& size) override;
+
+    void serialize(Serializer& serializer) const override;
+
+protected:
+
+    /// Get a sample slot, from the oldest one.
+    double* entry(size_t index)
+    {
+        return &m_samples[((m_head + index) % m_capacity) * series_count()];
+    }
+
+    /// Get a sample slot, from the oldest one.
+    EGT_NODISCARD const double* entry(size_t index) const
+    {
+        return &m_samples[((m_head + index) % m_capacity) * series_count()];
+    }
+
+    /// Return the rectangle where series are drawn.
+    EGT_NODISCARD Rect plot_area() const;
+
+    /// Get the horizontal distance between samples, in pixels.
+    EGT_NODISCARD DefaultDim step() const;
+
+    /// Get the vertical position of a value in the series layer.
+    EGT_NODISCARD double value_y(double value) const;
+
+    /// Get the width of the labels on the left of the plot area.
+    EGT_NODISCARD DefaultDim label_width() const;
+
+    /// Invalidate both layers and damage the widget.
+    void invalidate();
+
+    /// Draw the grid and the labels layer.
+    void draw_axes();
+
+    /// Draw the series layer from all the samples.
+    void draw_series();
+
+    /// Scroll the series layer and draw the newest segment.
+    void scroll_series();
+
+    /// Ring buffer of samples, with series_count() values per sample.
+    std::vector<double> m_samples;
+
+    /// Index of the oldest sample in m_samples.
+    size_t m_head{0};
+
+    /// Number of samples in m_samples.
+    size_t m_count{0};
+
+    /// Number of samples kept.
+    size_t m_capacity{DEFAULT_CAPACITY};
+
+    /// Colors of the series after the first one.
+    std::vector<Color> m_colors;
+
+    double m_min{0.0};
+    double m_max{1.0};
+    bool m_auto_range{true};
+    size_t m_columns{10};
+    size_t m_rows{4};
+    DefaultDim m_line_width{2};
+
+    /// Grid and labels layer, the size of the content area.
+    shared_cairo_surface_t m_axes;
+
+    /// Series layer, the size of the plot area.
+    shared_cairo_surface_t m_series;
+
+    /// Is the series layer up to date with the samples.
+    bool m_series_valid{false};
+
+    /// Font and colors the layers were drawn with.
+    Font m_layer_font;
+    Color m_layer_line;
+    Color m_layer_grid;
+    Color m_layer_text;
+
+private:
+
+    void initialize(size_t capacity);
+
+    void deserialize(Serializer::Properties& props);
+};
+
+}
+}
+
+#endif
@@ -11,10 +11,12 @@
  * @brief Working with images.
  */
 
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/geometry.h>
 #include <egt/image.h>
 #include <egt/types.h>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -99,6 +101,29 @@ public:
      */
     EGT_NODISCARD Image render(const std::string& id = {}, const RectF& rect = {}) const;
 
+    /**
+     * Render the SVG in the background, like render().
+     *
+     * The image is rendered by a worker thread, so several images, even of
+     * the same SVG, are rendered at the same time, and the event loop is not
+     * blocked.  The callback is called from the event loop with the image, or
+     * an empty image if it could not be rendered.
+     *
+     * The SvgImage does not have to outlive the rendering.
+     *
+     * @param[in] id Optional id of the SVG element to render.
+     * @param[in] rect Optional rect to clip to.
+     * @param[in] callback Called with the image.
+     * @return An id to cancel() the callback, or 0 if it already was called.
+     */
+    uint64_t render_async(const std::string& id, const RectF& rect,
+                          std::function<void(const Image&)> callback) const;
+
+    /**
+     * Don't call the callback of a render_async().
+     */
+    static void cancel(uint64_t id);
+
     /**
      * Render the image of the specific element in the SVG file.
      *
@@ -168,6 +193,26 @@ public:
      */
     void uri(const std::string& uri);
 
+    /**
+     * Set the directory where rendered images are cached.
+     *
+     * Rendered images are saved there as eraw files, keyed on the content of
+     * the SVG, the element id, the size, and the clip rect, along with the
+     * size and element boxes of each SVG.  An SVG fully found in the cache is
+     * never parsed, so the next run of an application skips librsvg.
+     *
+     * The directory must exist.  It defaults to the EGT_SVG_CACHE_DIR
+     * environment variable, or else to the directory of the shared image
+     * store, see EGT_SHARED_CACHE_DIR.  Empty disables the cache.  This
+     * applies to SVG files loaded afterwards.
+     */
+    static void cache_dir(const std::string& dir);
+
+    /**
+     * Get the directory where rendered images are cached.
+     */
+    EGT_NODISCARD static std::string cache_dir();
+
 protected:
 
     /// Load the SVG file.
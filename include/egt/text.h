@@ -90,6 +90,16 @@ public:
     TextRect& consolidate(const TextRect& r, cairo_t* cr) noexcept;
     TextRect split(size_t pos, cairo_t* cr) noexcept;
 
+    /**
+     * Get the advance of every prefix of the text, from the empty one.
+     *
+     * Characters are measured on the first call only.
+     */
+    const std::vector<float>& advances(cairo_t* cr) const;
+
+    /// Get how many characters of the text fit within a width.
+    size_t fitting_length(float width, cairo_t* cr) const;
+
 private:
 
     /// Text to be displayed
@@ -106,6 +116,9 @@ private:
 
     /// Cairo text extents
     cairo_text_extents_t m_te;
+
+    /// Cache for advances().
+    mutable std::vector<float> m_advances;
 };
 
 using TextRects = std::list<TextRect>;
@@ -279,6 +292,7 @@ public:
     {
         if (detail::change_if_diff<>(m_text_flags, text_flags))
         {
+            invalidate_size_hint();
             resize_sliders();
             damage();
         }
@@ -542,9 +556,22 @@ protected:
     /// Split the text into atomic tokens that fill the TextRects parameter.
     void tokenize(TextRects& rects);
 
+    /**
+     * Split some text into atomic tokens that fill the TextRects parameter.
+     *
+     * @param[in] text The text.
+     * @param[out] rects The tokens.
+     * @param[in] behave Behavior flags of the first token.
+     */
+    void tokenize(const std::string& text, TextRects& rects, uint32_t behave);
+
     /// Compute the text layout from the tokens contained in the TextRects.
     void compute_layout(TextRects& rects);
 
+    /// Compute the layout of the tokens in [begin, end) within boundaries.
+    void compute_layout(TextRects::iterator begin, TextRects::iterator end,
+                        const Rect& boundaries);
+
     /// Merge adjacent TextRect items, when possible.
     void consolidate(TextRects& rects);
 
@@ -618,6 +645,62 @@ protected:
     /// Tokenize and compute the layout of a text; fill TextRects accordingly.
     void prepare_text(TextRects& rects);
 
+    /**
+     * A paragraph of the text: a line ending with a newline, or the end of
+     * the text.
+     */
+    struct Paragraph
+    {
+        /// Text of the paragraph, newline included.
+        std::string text;
+        /// UTF-8 length of the text.
+        size_t length{0};
+        /// UTF-8 offset of the paragraph in the text.
+        size_t pos{0};
+        /// First TextRect of the paragraph in m_rects, or the next one if none.
+        TextRects::iterator first;
+        /// Top of the paragraph.
+        DefaultDim top{0};
+        /// Height of the paragraph.
+        DefaultDim height{0};
+        /// Merged Rect of the text of the paragraph, newlines excluded.
+        Rect rect;
+    };
+
+    /**
+     * Can paragraphs be laid out independently: multiline text aligned left
+     * or expanded horizontally, and top or expanded vertically.
+     */
+    EGT_NODISCARD bool paragraph_layout() const;
+
+    /**
+     * Update m_rects after the text, or the text boundaries, changed.
+     *
+     * When paragraph_layout(), only the paragraphs whose text changed are
+     * tokenized and laid out again, and the ones after them are moved.
+     * Otherwise, the whole text is.
+     *
+     * @param[in] tag Damage what changed.
+     */
+    void layout_text(bool tag);
+
+    /// Move a range of TextRects, and the paragraphs from first, by an offset.
+    void move_text(TextRects::iterator begin,
+                   std::vector<Paragraph>::iterator first,
+                   const Point& offset);
+
+    /// Update the first TextRect of every paragraph after m_rects was rebuilt.
+    void index_paragraphs();
+
+    /**
+     * Get where to start walking m_rects to reach a position: the first
+     * TextRect of the paragraph containing it.
+     *
+     * @param[in] cursor_pos The position.
+     * @param[out] pos Position of the returned TextRect.
+     */
+    TextRects::const_iterator paragraph_start(size_t cursor_pos, size_t& pos) const;
+
     /// Update m_cursor_rect based on the current position of the cursor.
     void get_cursor_rect();
 
@@ -724,12 +807,45 @@ protected:
     TextRects m_rects;
     Rect m_cursor_rect;
 
+    /**
+     * Paragraphs of m_rects, when laid out one by one, or empty.
+     *
+     * Lines of different paragraphs never share a TextRect, so they are
+     * ordered by position and top, and searched with a binary search.
+     */
+    std::vector<Paragraph> m_paragraphs;
+
+    /// Boundaries m_paragraphs were laid out within.
+    Rect m_paragraph_boundaries;
+
+    /// Font m_paragraphs were laid out with.
+    Font m_paragraph_font{Font::Size(1)};
+
+    /// Flags m_paragraphs were laid out with.
+    TextFlags m_paragraph_flags{};
+
     /**
      * Given text, return the number of UTF8 characters that will fit on a
      * single line inside of the widget.
      */
     EGT_NODISCARD size_t width_to_len(const std::string& str) const;
 
+    /**
+     * Given text inserted at a position of the current text, return the
+     * number of UTF8 characters of the result that will fit on a single line
+     * inside of the widget.
+     *
+     * Only the inserted text is measured: the current text is measured from
+     * the advances of its line.
+     */
+    EGT_NODISCARD size_t width_to_len(size_t pos, const std::string& str) const;
+
+    /// Get the advance of every prefix of the line of a single line text.
+    EGT_NODISCARD const std::vector<float>& line_advances() const;
+
+    /// Cache for line_advances().
+    mutable std::vector<float> m_line_advances;
+
 private:
     class State
     {
@@ -821,6 +937,8 @@ private:
 
 namespace detail
 {
+class TextRun;
+
 /// Internal draw text function.
 EGT_API void draw_text(Painter& painter,
                        const Rect& b,
@@ -836,6 +954,22 @@ EGT_API void draw_text(Painter& painter,
                        size_t select_start = 0,
                        size_t select_len = 0);
 
+/// Internal draw text function, laying out the text only if run is stale.
+EGT_API void draw_text(Painter& painter,
+                       TextRun& run,
+                       const Rect& b,
+                       const std::string& text,
+                       const Font& font,
+                       const TextBox::TextFlags& flags,
+                       const AlignFlags& text_align,
+                       Justification justify,
+                       const Pattern& text_color,
+                       const std::function<void(const Point& offset, size_t height)>& draw_cursor = nullptr,
+                       size_t cursor_pos = 0,
+                       const Pattern& highlight_color = {},
+                       size_t select_start = 0,
+                       size_t select_len = 0);
+
 /// Internal draw text function with associated image.
 EGT_API void draw_text(Painter& painter,
                        const Rect& b,
@@ -852,6 +986,25 @@ EGT_API void draw_text(Painter& painter,
                        const Pattern& highlight_color = {},
                        size_t select_start = 0,
                        size_t select_len = 0);
+
+/// Internal draw text function with associated image, laying out the text
+/// only if run is stale.
+EGT_API void draw_text(Painter& painter,
+                       TextRun& run,
+                       const Rect& b,
+                       const std::string& text,
+                       const Font& font,
+                       const TextBox::TextFlags& flags,
+                       const AlignFlags& text_align,
+                       Justification justify,
+                       const Pattern& text_color,
+                       const AlignFlags& image_align,
+                       const Image& image,
+                       const std::function<void(const Point& offset, size_t height)>& draw_cursor = nullptr,
+                       size_t cursor_pos = 0,
+                       const Pattern& highlight_color = {},
+                       size_t select_start = 0,
+                       size_t select_len = 0);
 }
 
 }
@@ -11,6 +11,7 @@
  * @brief Base class TextWidget definition.
  */
 
+#include <egt/detail/lrucache.h>
 #include <egt/detail/meta.h>
 #include <egt/image.h>
 #include <egt/signal.h>
@@ -22,6 +23,11 @@ namespace egt
 {
 inline namespace v1
 {
+namespace detail
+{
+class TextRun;
+class Utf8Index;
+}
 
 /**
  * A widget with text and text related properties.
@@ -66,6 +72,13 @@ protected:
 
 public:
 
+    TextWidget(const TextWidget&) = delete;
+    TextWidget& operator=(const TextWidget&) = delete;
+    TextWidget(TextWidget&&) noexcept;
+    TextWidget& operator=(TextWidget&&) noexcept;
+
+    ~TextWidget() noexcept override;
+
     /**
      * Set the text.
      *
@@ -83,6 +96,22 @@ public:
      */
     EGT_NODISCARD virtual const std::string& text() const { return m_text; }
 
+    /**
+     * Set the text to the translation of a message, and translate it again
+     * whenever the language changes.
+     *
+     * @param[in] msgid The untranslated message, or empty to stop
+     *            translating the text.
+     *
+     * @see Translator
+     */
+    void translate(const std::string& msgid);
+
+    /**
+     * Get the untranslated message of the text, empty if not translated.
+     */
+    EGT_NODISCARD const std::string& msgid() const { return m_msgid; }
+
     /**
      * Set the text alignment within the Label.
      *
@@ -110,19 +139,64 @@ public:
      */
     static Font scale_font(const Size& target, const std::string& text, const Font& font);
 
+    /**
+     * Set the maximum number of text layouts in the layout cache.
+     *
+     * Wrapped and aligned text is laid out once for its text, font, box size
+     * and flags, and the layout is shared by all the widgets drawing the
+     * same text the same way.  The least recently used layouts are evicted
+     * when there are more.  0 is no limit.
+     */
+    static void layout_cache_size(size_t layouts);
+
+    /**
+     * Get the maximum number of text layouts in the layout cache.
+     */
+    EGT_NODISCARD static size_t layout_cache_size();
+
+    /**
+     * Get the hit, miss, and eviction counters of the layout cache.
+     */
+    EGT_NODISCARD static detail::CacheStats layout_cache_stats();
+
+    /**
+     * Drop all the text layouts of the layout cache, and reset its counters.
+     *
+     * Widgets keep the layout they were drawn with.
+     */
+    static void reset_layout_cache();
+
     void serialize(Serializer& serializer) const override;
 
+    /// @private
+    EGT_NODISCARD detail::TextRun& text_run() const;
+
+    /// @private
+    EGT_NODISCARD const detail::Utf8Index& text_index() const;
+
 protected:
 
     /// Get the size of the text.
     EGT_NODISCARD Size text_size(const std::string& text) const;
 
+    /// Rebuild text_index() when next used, after changing m_text.
+    void invalidate_text_index();
+
     /// Alignment of the text.
     AlignFlags m_text_align{AlignFlag::center};
 
     /// The text.
     std::string m_text;
 
+    /// Layout and size of the text, from the last draw and measure.
+    mutable std::unique_ptr<detail::TextRun> m_text_run;
+
+    /// Offsets of the code points of the text.
+    mutable std::unique_ptr<detail::Utf8Index> m_text_index;
+
+    /// The untranslated message of the text, if translated.
+    std::string m_msgid;
+
 private:
 
     void deserialize(Serializer::Properties& props);
@@ -28,6 +28,11 @@ inline namespace v1
 class Widget;
 class Painter;
 
+namespace detail
+{
+class BoxSkinCache;
+}
+
 /**
  * Drawable function object.
  *
@@ -230,6 +235,7 @@ public:
     void palette(const Palette& palette)
     {
         m_palette = palette;
+        clear_box_cache();
     }
 
     /**
@@ -278,6 +284,34 @@ public:
                           const BorderFlags& border_flags = {},
                           Image* background = nullptr) const;
 
+    /**
+     * Enable caching of the boxes drawn by draw_box().
+     *
+     * A box is drawn once in a skin surface, keyed on its border, radius, and
+     * fill, and copied from there every time the same box is drawn again.
+     * The skin only has the corners and one row and column of the middle
+     * when the fill does not change in a direction, and is stretched to the
+     * size of the box, so boxes of different sizes share it.  For example, a
+     * keypad with identical buttons then draws a button shape once.
+     *
+     * Boxes with a background image, a drop shadow, a transparent fill, or a
+     * Painter that is scaled or rotated, are always drawn directly.
+     *
+     * The cache is cleared when the theme is applied, or its palette is set.
+     * It is enabled by default.
+     */
+    void box_cache(bool enable);
+
+    /**
+     * Returns true if caching of the boxes drawn by draw_box() is enabled.
+     */
+    EGT_NODISCARD bool box_cache() const { return m_box_cache_enabled; }
+
+    /**
+     * Clear the boxes cached by draw_box().
+     */
+    void clear_box_cache();
+
     /**
      * Draw a circle using properties directly from the widget.
      */
@@ -316,6 +350,7 @@ public:
      */
     virtual void apply()
     {
+        clear_box_cache();
         init_palette();
         init_font();
         init_draw();
@@ -334,6 +369,37 @@ protected:
 
     virtual void rounded_box(Painter& painter, const RectF& box, float border_radius) const;
 
+    /**
+     * Draw a box without the cache.
+     *
+     * @see draw_box()
+     */
+    void draw_box_direct(Painter& painter,
+                         const FillFlags& type,
+                         const Rect& rect,
+                         const Pattern& border,
+                         const Pattern& bg,
+                         DefaultDim border_width,
+                         DefaultDim margin_width,
+                         float border_radius,
+                         const BorderFlags& border_flags,
+                         Image* background) const;
+
+    /**
+     * Draw a box from the cache.
+     *
+     * @return false if the box cannot be cached, and was not drawn.
+     */
+    bool draw_box_cached(Painter& painter,
+                         const FillFlags& type,
+                         const Rect& rect,
+                         const Pattern& border,
+                         const Pattern& bg,
+                         DefaultDim border_width,
+                         DefaultDim margin_width,
+                         float border_radius,
+                         const BorderFlags& border_flags) const;
+
     /// Palette instance used by the theme.
     Palette m_palette;
 
@@ -343,6 +409,12 @@ protected:
     /// Default font instance used by the theme.
     Font m_font;
 
+    /// Is the draw_box() cache enabled?
+    bool m_box_cache_enabled{true};
+
+    /// Boxes drawn by draw_box(), shared by copies of the theme.
+    mutable std::shared_ptr<detail::BoxSkinCache> m_box_cache;
+
     /**
      * Setup for initializing the palette.
      *
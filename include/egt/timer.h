@@ -21,6 +21,13 @@ namespace egt
 {
 inline namespace v1
 {
+class Widget;
+
+namespace detail
+{
+class VisibilityPolicy;
+}
+
 /**
  * @defgroup timers Timers
  * Timer related widgets.
@@ -63,6 +70,13 @@ inline namespace v1
  * timer.start();
  * @endcode
  *
+ * All timers share a single system timer of the EventLoop, which can be
+ * allowed to fire them late to save wakeups.  See EventLoop::timer_slack().
+ *
+ * A timer that only does something for a widget, like blinking a cursor or
+ * polling for what the widget shows, can be bound to it with bind() to not
+ * fire while the widget cannot be seen.
+ *
  * @ingroup timers
  * @see PeriodicTimer
  */
@@ -159,6 +173,34 @@ public:
      */
     EGT_NODISCARD bool running() const { return m_running; }
 
+    /**
+     * Only run the timer while a widget can be seen.
+     *
+     * The timer is suspended while the widget or one of its parents is
+     * hidden, while it is scrolled or clipped out of its parents, and while
+     * it is covered by an opaque plane.  The timer keeps running() while
+     * suspended.  If it expired meanwhile, it fires once as soon as the
+     * widget can be seen again, and a PeriodicTimer then goes on at its
+     * interval.
+     *
+     * This is checked once per frame drawn by the EventLoop.
+     *
+     * @param[in] widget The widget, which must outlive the binding or
+     *            unbind() it.  A widget being destroyed unbinds itself.
+     */
+    void bind(Widget& widget);
+
+    /**
+     * Stop following the visibility of a widget, see bind().
+     */
+    void unbind();
+
+    /**
+     * Returns true if the timer is suspended because the widget it is bound
+     * to cannot be seen.
+     */
+    EGT_NODISCARD bool suspended() const;
+
     /// Handle type.
     using RegisterHandle = uint64_t;
 
@@ -233,9 +275,6 @@ protected:
     /// Type for array of registered callbacks.
     using CallbackArray = std::vector<CallbackMeta>;
 
-    /// Asio timer object.
-    asio::steady_timer m_timer;
-
     /// The duration of the timer.
     std::chrono::milliseconds m_duration{};
 
@@ -253,8 +292,13 @@ protected:
 
 private:
 
-    void internal_timer_callback(const asio::error_code& error);
+    void internal_timer_callback();
     void do_cancel();
+
+    /// Suspend or resume the timer, for the widget it is bound to.
+    void suspend(bool suspend);
+
+    friend class detail::VisibilityPolicy;
 };
 
 /**
@@ -287,7 +331,7 @@ public:
 
 private:
 
-    void internal_timer_callback(const asio::error_code& error);
+    void internal_timer_callback();
 };
 
 }
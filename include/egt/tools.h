@@ -9,6 +9,7 @@
 #include <chrono>
 #include <cstdint>
 #include <egt/detail/meta.h>
+#include <memory>
 
 /**
  * @file
@@ -19,15 +20,28 @@ namespace egt
 {
 inline namespace v1
 {
+namespace detail
+{
+class ProcFile;
+}
+
 namespace experimental
 {
 /**
  * Monitor CPU usage of the system.
+ *
+ * /proc/stat is kept open and read again by each update().
+ *
+ * @see MetricsSampler for the usage of each CPU, and other metrics.
  */
 class EGT_API CPUMonitorUsage
 {
 public:
 
+    CPUMonitorUsage();
+    CPUMonitorUsage(CPUMonitorUsage&&) noexcept;
+    CPUMonitorUsage& operator=(CPUMonitorUsage&&) noexcept;
+
     /**
      * Get the total CPU usage as a percentage.
      */
@@ -40,10 +54,13 @@ public:
      */
     void update();
 
+    ~CPUMonitorUsage() noexcept;
+
 private:
 
-    size_t m_last_total_time{0};
-    size_t m_last_idle_time{0};
+    std::unique_ptr<detail::ProcFile> m_stat;
+    uint64_t m_last_total_time{0};
+    uint64_t m_last_idle_time{0};
     double m_cpu_usage{0};
 };
 
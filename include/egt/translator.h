@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_TRANSLATOR_H
+#define EGT_TRANSLATOR_H
+
+/**
+ * @file
+ * @brief Cached translation of messages.
+ */
+
+#include <egt/detail/meta.h>
+#include <egt/signal.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+class MoCatalog;
+}
+
+/**
+ * Translates messages, caching the translations of the current language.
+ *
+ * By default, messages are translated with gettext(), for the locale of the
+ * process, and each message is only looked up once.
+ *
+ * Setting a language() instead loads the message catalog of the text
+ * domain for that language, mapped from its .mo file, and switches all
+ * widgets given a message with TextWidget::translate() at once.  Widgets
+ * whose translated text takes the same space are not laid out again.
+ * Catalogs stay loaded, so switching back to a language is cheap.
+ *
+ * @code{.cpp}
+ * auto label = std::make_shared<egt::Label>();
+ * label->translate("Hello World");
+ * ...
+ * egt::Translator::instance().language("fr");
+ * @endcode
+ */
+class EGT_API Translator
+{
+public:
+
+    /**
+     * Event signal.
+     * @{
+     */
+    /**
+     * Invoked when the language changed, after the widgets are translated.
+     */
+    Signal<> on_language_changed;
+    /** @} */
+
+    /// Get the instance.
+    static Translator& instance();
+
+    Translator(const Translator&) = delete;
+    Translator& operator=(const Translator&) = delete;
+    Translator(Translator&&) = delete;
+    Translator& operator=(Translator&&) = delete;
+
+    /**
+     * Set the text domain, and the directory of its catalogs.
+     *
+     * By default, the domain set with textdomain(), as the Application does,
+     * and its directory bound with bindtextdomain().  Catalogs are looked for
+     * in directory/language/LC_MESSAGES/domain.mo.
+     *
+     * @param[in] domain Text domain.
+     * @param[in] directory Directory of the catalogs.
+     */
+    void domain(const std::string& domain, const std::string& directory = {});
+
+    /// Get the text domain.
+    EGT_NODISCARD std::string domain() const;
+
+    /**
+     * Switch to a language, and translate all widgets again.
+     *
+     * The language is a locale name, like "fr_FR.UTF-8", "fr_FR", or "fr",
+     * and the catalog of the most specific of these is used.  An empty
+     * language goes back to gettext() and the locale of the process.
+     *
+     * @param[in] language The language.
+     * @return false if there is no catalog for the language, in which case
+     *         messages are shown untranslated.
+     */
+    bool language(const std::string& language);
+
+    /// Get the language, empty for the locale of the process.
+    EGT_NODISCARD const std::string& language() const { return m_language; }
+
+    /**
+     * Translate a message.
+     *
+     * @param[in] msgid The untranslated message.
+     * @return The translation, or msgid if there is none, valid until the
+     *         language changes.
+     */
+    const std::string& translate(const std::string& msgid);
+
+    /**
+     * Translate all widgets given a message again.
+     *
+     * This is done when the language changes.  Call it after changing the
+     * locale of the process while using gettext().
+     */
+    void retranslate();
+
+    ~Translator() noexcept;
+
+private:
+
+    Translator();
+
+    /// Find the catalog of a language.
+    std::shared_ptr<detail::MoCatalog> load(const std::string& language);
+
+    std::string m_domain;
+    std::string m_directory;
+    std::string m_language;
+    /// Catalog of the language, null for gettext().
+    std::shared_ptr<detail::MoCatalog> m_catalog;
+    /// Catalogs loaded, by language, null when there is none.
+    std::map<std::string, std::shared_ptr<detail::MoCatalog>> m_catalogs;
+    /// Translations of the language.
+    std::unordered_map<std::string, std::string> m_cache;
+};
+
+/**
+ * Translate a message with Translator::translate().
+ */
+EGT_API const std::string& tr(const std::string& msgid);
+
+}
+}
+
+#endif
@@ -105,11 +105,14 @@ enum class PixelFormat
     nv61,
     yuy2,     ///< Packed YUY 4:2:2
     uyvy,     ///< Reverse byte order of YUY2
+    l8,       ///< 8 bpp, 8-bit luminance
+    rgb332,   ///< 8 bpp, 3-bit red, 3-bit green and 2-bit blue
+    c8,       ///< 8 bpp, index in a color lookup table holding the RGB332 colors
 };
 
 /// Enum string conversion map
 template<>
-EGT_API const std::pair<PixelFormat, char const*> detail::EnumStrings<PixelFormat>::data[11];
+EGT_API const std::pair<PixelFormat, char const*> detail::EnumStrings<PixelFormat>::data[14];
 
 /// Overloaded std::ostream insertion operator
 EGT_API std::ostream& operator<<(std::ostream& os, const PixelFormat& format);
@@ -11,9 +11,11 @@
  * @brief UI XML loader.
  */
 
+#include <egt/arena.h>
 #include <egt/detail/meta.h>
 #include <memory>
 #include <string>
+#include <utility>
 
 namespace egt
 {
@@ -24,9 +26,106 @@ class Widget;
 namespace experimental
 {
 
+/**
+ * Creates copies of a widget and its children.
+ *
+ * Building the same widgets many times, like the rows of a list or the keys
+ * of a keypad, either calls the constructors and property setters of each
+ * widget, or has a UiLoader parse the same file again for each copy.  A
+ * prototype walks the widget once, keeping the type and properties of each
+ * widget, already parsed, in a tree.  Each instance() then only creates the
+ * widgets and applies their properties.
+ *
+ * The palette and font of the widgets are not copied: the copies share them
+ * with the prototype, until one of them changes its own, see
+ * Widget::share_style().  Images already share their surfaces.  The copies
+ * are created with the boxes the prototype widgets were laid out with, so a
+ * layout of them has nothing to move.
+ *
+ * Only widget types a UiLoader can create can be copied.
+ *
+ * @b Example
+ * @code{.cpp}
+ * auto tile = std::make_shared<egt::Button>("0");
+ * tile->font(egt::Font(30));
+ * egt::experimental::WidgetPrototype prototype(tile);
+ *
+ * for (auto i = 0; i < 500; i++)
+ *     grid.add(prototype.instance());
+ * @endcode
+ */
+class EGT_API WidgetPrototype
+{
+public:
+
+    /**
+     * @param widget The widget to copy, kept by the prototype.
+     *
+     * @throws std::runtime_error if a widget type cannot be created.
+     */
+    explicit WidgetPrototype(std::shared_ptr<Widget> widget);
+
+    /**
+     * Create a copy of the widget.
+     */
+    EGT_NODISCARD std::shared_ptr<Widget> instance() const;
+
+    /**
+     * Create a copy of the widget, of its type.
+     */
+    template<class T>
+    EGT_NODISCARD std::shared_ptr<T> instance() const
+    {
+        return std::dynamic_pointer_cast<T>(instance());
+    }
+
+    /**
+     * Get the widget copied.
+     */
+    EGT_NODISCARD const std::shared_ptr<Widget>& widget() const { return m_widget; }
+
+    /**
+     * Allocate the copies from an Arena.
+     *
+     * @param arena The arena, or nullptr to allocate them from the heap.
+     */
+    void arena(std::shared_ptr<Arena> arena) { m_arena = std::move(arena); }
+
+    WidgetPrototype(const WidgetPrototype&) = default;
+    WidgetPrototype& operator=(const WidgetPrototype&) = default;
+    WidgetPrototype(WidgetPrototype&&) noexcept = default;
+    WidgetPrototype& operator=(WidgetPrototype&&) noexcept = default;
+    ~WidgetPrototype() noexcept;
+
+    /// @private
+    struct Node;
+
+private:
+
+    /// The widget copied.
+    std::shared_ptr<Widget> m_widget;
+    /// Parsed tree of the widget, shared by the copies of the prototype.
+    std::shared_ptr<const Node> m_root;
+    /// Arena the copies are allocated from, if any.
+    std::shared_ptr<Arena> m_arena;
+};
+
 /**
  * Parses and loads a UI XML file.
  *
+ * A UI file compiled with the ui-compile tool is loaded the same way, and
+ * faster: it is memory mapped and used in place, without parsing.
+ *
+ * A widget element with a @c lazy attribute set to @c true is created with
+ * its properties, but its children are only created the first time it is
+ * shown.  This is useful for the tabs of a Notebook, or a Dialog, so the time
+ * to load and the memory used follow the part of the UI that is visible.  With
+ * @c lazy set to @c unload, the children are also destroyed when the widget
+ * is hidden, and created again when it is shown.
+ * @code{.xml}
+ * <widget name="settings" type="egt::v1::NotebookTab" lazy="true">
+ * @endcode
+ *
  * @b Example
  * @code{.cpp}
  * egt::experimental::UiLoader loader;
@@ -41,9 +140,37 @@ public:
     /**
      * Parses and loads UI XML and returns the parent Widget.
      *
-     * @param uri URI to the XML to load.
+     * @param uri URI to the XML, or compiled UI file, to load.
      */
     virtual std::shared_ptr<Widget> load(const std::string& uri);
+
+    /**
+     * Load a UI file once, to create any number of its widgets with a
+     * WidgetPrototype.
+     *
+     * @param uri URI to the XML, or compiled UI file, to load.
+     */
+    WidgetPrototype prototype(const std::string& uri);
+
+    /**
+     * Allocate the widgets loaded from an Arena, including the children of
+     * lazy widgets created later.
+     *
+     * @param arena The arena, or nullptr to allocate them from the heap.
+     */
+    void arena(std::shared_ptr<Arena> arena) { m_arena = std::move(arena); }
+
+    /**
+     * Get the Arena the widgets loaded are allocated from, if any.
+     */
+    EGT_NODISCARD const std::shared_ptr<Arena>& arena() const { return m_arena; }
+
+    virtual ~UiLoader() = default;
+
+private:
+
+    /// Arena the widgets are allocated from.
+    std::shared_ptr<Arena> m_arena;
 };
 
 }
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_UPDATECHANNEL_H
+#define EGT_UPDATECHANNEL_H
+
+/**
+ * @file
+ * @brief Updates posted from other threads.
+ */
+
+#include <atomic>
+#include <egt/detail/meta.h>
+#include <egt/eventloop.h>
+#include <functional>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * An update queued in an EventLoop, at most once until it is applied.
+ */
+struct EGT_API UpdateState
+{
+    UpdateState() = default;
+    UpdateState(const UpdateState&) = delete;
+    UpdateState& operator=(const UpdateState&) = delete;
+    virtual ~UpdateState() = default;
+
+    /// Apply the pending update, in the thread of the event loop.
+    virtual void apply() = 0;
+
+    /// Is it queued, set by the thread queuing it.
+    std::atomic<bool> queued{false};
+    /// Next in the queue.
+    UpdateState* next{nullptr};
+    /// Keeps it alive while queued.
+    std::shared_ptr<UpdateState> self;
+    /// Set when the owner is gone, in the thread of the event loop.
+    bool cancelled{false};
+};
+
+}
+
+/**
+ * A value posted from any thread, and applied in the event loop.
+ *
+ * Posting a callback to EventLoop::io() from a thread reading a sensor, for
+ * every value read, queues as many handlers as there are values.  Instead,
+ * an UpdateChannel only keeps the last value posted: values posted before it
+ * is applied are replaced.  One channel is used for each property updated,
+ * i.e. the value of a gauge, and all channels with a pending value are
+ * applied together.  That is right before the next frame with the frame
+ * clock, and as soon as possible otherwise.
+ *
+ * Posting does not lock: it swaps the value in, and the first value posted
+ * since the last time the channel was applied queues it.  The event loop is
+ * only woken up when the first channel is queued.
+ *
+ * @code{.cpp}
+ * egt::UpdateChannel<int> speed(app.event(), [&gauge](const int& value)
+ * {
+ *     gauge.value(value);
+ * });
+ *
+ * // from the thread reading the CAN bus
+ * speed.post(rpm);
+ * @endcode
+ *
+ * @note The channel must be created and destroyed in the thread of the event
+ * loop, and not be destroyed while another thread posts to it.  Once it is
+ * destroyed, pending values are dropped.
+ */
+template<class T>
+class UpdateChannel
+{
+public:
+
+    /// Callback applying a value.
+    using Callback = std::function<void(const T&)>;
+
+    /**
+     * @param[in] loop The event loop the values are applied in.
+     * @param[in] callback Applies a value.
+     */
+    UpdateChannel(EventLoop& loop, Callback callback)
+        : m_loop(loop),
+          m_state(std::make_shared<State>(std::move(callback)))
+    {}
+
+    UpdateChannel(const UpdateChannel&) = delete;
+    UpdateChannel& operator=(const UpdateChannel&) = delete;
+    UpdateChannel(UpdateChannel&&) = delete;
+    UpdateChannel& operator=(UpdateChannel&&) = delete;
+
+    /**
+     * Post a value, from any thread.
+     *
+     * The value replaces any value posted and not applied yet.
+     */
+    void post(T value)
+    {
+        delete m_state->pending.exchange(new T(std::move(value)), std::memory_order_acq_rel);
+        m_loop.queue_update(m_state);
+    }
+
+    ~UpdateChannel()
+    {
+        m_state->cancelled = true;
+    }
+
+private:
+
+    struct State : public detail::UpdateState
+    {
+        explicit State(Callback c)
+            : callback(std::move(c))
+        {}
+
+        ~State() override
+        {
+            delete pending.load(std::memory_order_acquire);
+        }
+
+        void apply() override
+        {
+            std::unique_ptr<T> value(pending.exchange(nullptr, std::memory_order_acq_rel));
+            if (value && !cancelled && callback)
+                callback(*value);
+        }
+
+        Callback callback;
+        std::atomic<T*> pending{nullptr};
+    };
+
+    EventLoop& m_loop;
+    std::shared_ptr<State> m_state;
+};
+
+}
+}
+
+#endif
@@ -160,7 +160,7 @@ public:
 
         if (set_value(value))
         {
-            damage();
+            damage_value(orig);
             on_value_changed.invoke();
         }
 
@@ -254,6 +254,20 @@ protected:
         return detail::change_if_diff<>(m_value, value);
     }
 
+    /**
+     * Damage what looks different after the value changed.
+     *
+     * This damages the whole widget.  Widgets that only draw part of
+     * themselves differently, like the end of a bar or a handle, override it.
+     *
+     * @param[in] prev The previous value.
+     */
+    virtual void damage_value(T prev)
+    {
+        detail::ignoreparam(prev);
+        damage();
+    }
+
     /// The start value.
     T m_start;
 
@@ -11,6 +11,8 @@
  * @brief Working with video.
  */
 
+#include <chrono>
+#include <cstdint>
 #include <egt/detail/meta.h>
 #include <egt/signal.h>
 #include <egt/window.h>
@@ -33,6 +35,24 @@ class GstKmsSinkImpl;
 class GstAppSinkImpl;
 }
 
+/**
+ * Statistics of the frames of a VideoWindow.
+ *
+ * @see VideoWindow::stats()
+ */
+struct VideoStats
+{
+    /// Number of frames shown.
+    uint64_t rendered{0};
+    /// Number of frames never shown, skipped by the decoder or replaced
+    /// by a newer frame before being shown.
+    uint64_t dropped{0};
+    /// Number of frames shown more than a frame duration after their time.
+    uint64_t late{0};
+    /// Average delay of the frames shown after their time.
+    std::chrono::microseconds latency{0};
+};
+
 /**
  * A VideoWindow is a widget to decode video and render it to a screen.
  *
@@ -141,6 +161,20 @@ public:
         return m_uri;
     }
 
+    /**
+     * Prepare a media to be played next.
+     *
+     * The media is discovered and its pipeline pre-rolled in the background,
+     * so that a later call to media() with the same uri switches to it
+     * without a gap. Up to 3 media are kept prepared, the oldest being
+     * released.
+     *
+     * @param uri Media file
+     *
+     * @note Only supported by a VideoWindow decoding in software.
+     */
+    void preload(const std::string& uri);
+
     /**
      * Play the video.
      *
@@ -252,6 +286,17 @@ public:
      */
     EGT_NODISCARD bool has_audio() const;
 
+    /**
+     * Get statistics of the frames of the media being played.
+     *
+     * When frames are shown late, the decoder is asked to skip frames
+     * instead of decoding frames that would never be shown, which are
+     * then counted as dropped.
+     *
+     * @note The statistics are reset when the media changes.
+     */
+    EGT_NODISCARD VideoStats stats() const;
+
     void serialize(Serializer& serializer) const override;
 
     ~VideoWindow() noexcept override;
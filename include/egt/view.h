@@ -11,10 +11,13 @@
  * @brief View definition.
  */
 
+#include <egt/animation.h>
 #include <egt/canvas.h>
 #include <egt/detail/meta.h>
 #include <egt/frame.h>
+#include <egt/signal.h>
 #include <egt/slider.h>
+#include <chrono>
 #include <memory>
 
 namespace egt
@@ -22,6 +25,11 @@ namespace egt
 inline namespace v1
 {
 
+namespace detail
+{
+class SpanIndex;
+}
+
 /**
  * A scrollable view.
  *
@@ -30,12 +38,26 @@ inline namespace v1
  * it through the window.  The surface can be scrolled, or panned, in a single
  * Orientation to see the rest.
  *
+ * With many children, they are indexed by their position along the axis the
+ * view scrolls in, so drawing and finding the child under the pointer only
+ * visit the children in view, whatever the size of the content.
+ *
  * This is used internally by Widgets, but can also be used directly.
  */
 class EGT_API ScrolledView : public Frame
 {
 public:
 
+    /**
+     * Event signal.
+     * @{
+     */
+    /**
+     * Invoked when the offset changes.
+     */
+    Signal<> on_offset_changed;
+    /** @} */
+
     /**
      * Scrollbar policy.
      */
@@ -210,6 +232,40 @@ public:
             damage();
     }
 
+    /**
+     * Enable kinetic scrolling.
+     *
+     * The content then keeps moving at the speed of a drag when it ends, and
+     * slows down until it stops.  This is stepped like any AutoAnimation, so
+     * once per frame with the frame clock.  Another drag stops it.
+     *
+     * By default, this is disabled.
+     */
+    void kinetic(bool enable);
+
+    /**
+     * Returns true if kinetic scrolling is enabled.
+     */
+    EGT_NODISCARD bool kinetic() const { return m_kinetic; }
+
+    /**
+     * Defer the layout of the children out of view.
+     *
+     * Children with a size of their own are then only laid out when they
+     * are scrolled into view, before the frame showing them is drawn.  This
+     * saves laying out the whole content of a long form or gallery up front.
+     * The size of a child only changes when it is laid out, so the scroll
+     * range may grow as the content is scrolled.
+     *
+     * By default, this is disabled.
+     */
+    void defer_offscreen_layout(bool enable);
+
+    /**
+     * Returns true if the layout of the children out of view is deferred.
+     */
+    EGT_NODISCARD bool defer_offscreen_layout() const { return m_defer_offscreen_layout; }
+
     /**
      * Serialize the widget to the specified serializer.
      */
@@ -223,6 +279,8 @@ public:
     static std::string policy2str(Policy policy);
     static Policy str2policy(const std::string& str);
 
+    ~ScrolledView() noexcept override;
+
 protected:
 
     bool internal_drag() const override { return true; }
@@ -234,6 +292,19 @@ protected:
 
     Point point_from_subordinate(const Widget& subordinate) const override;
 
+    Widget* subordinate_at(const Point& point) override;
+
+    bool defer_subordinate_layout(const Widget& subordinate) override;
+
+    /// Get the part of the content in view, in child coordinates.
+    EGT_NODISCARD Rect viewport() const;
+
+    /// Get the index of the children, up to date, or nullptr with few children.
+    detail::SpanIndex* viewport_index();
+
+    /// Lay out the children whose layout was deferred, if they are in view.
+    void resume_deferred_layout();
+
     /// Horizontal scrollable
     EGT_NODISCARD bool hscrollable() const
     {
@@ -260,6 +331,12 @@ protected:
     /// Initialize the sliders properties.
     void init_sliders();
 
+    /**
+     * Move the content already drawn by @b delta, or damage it when it
+     * cannot be moved.
+     */
+    void scroll_content(const Point& delta);
+
     /// Update properties of the sliders.
     void update_sliders();
 
@@ -301,6 +378,27 @@ protected:
 
     /// Width/height of the slider when shown.
     DefaultDim m_slider_dim{8};
+
+    /// Is kinetic scrolling enabled?
+    bool m_kinetic{false};
+
+    /// Offset when the content starts moving after a drag.
+    Point m_fling_start;
+
+    /// How far the content moves after a drag.
+    Point m_fling_distance;
+
+    /// Moves the content after a drag.
+    AutoAnimation m_fling{0, 1, std::chrono::milliseconds(750), easing_cubic_easeout};
+
+    /// Children sorted along the axis the view scrolls in.
+    std::unique_ptr<detail::SpanIndex> m_viewport_index;
+
+    /// Is the layout of the children out of view deferred?
+    bool m_defer_offscreen_layout{false};
+
+    /// Was the layout of a child deferred since the view last scrolled?
+    bool m_layout_deferred{false};
 };
 
 }
@@ -18,6 +18,7 @@
 #include <egt/notebook.h>
 #include <egt/popup.h>
 #include <egt/sizer.h>
+#include <egt/widget.h>
 #include <memory>
 #include <string>
 #include <vector>
@@ -34,6 +35,10 @@ inline namespace v1
  * By default, a Qwerty keyboard is provided but you can easily create your own
  * keyboard by giving a list of keys divided in panels and rows. A base size of
  * the keys is automatically computed.
+ *
+ * Each panel is a single widget: its keys are rendered once, released and
+ * pressed, and then copied from that rendering.  A pointer event is sent to
+ * the key under it, and pressing a key only damages that key.
  */
 class EGT_API VirtualKeyboard : public Frame
 {
@@ -169,6 +174,11 @@ public:
          */
         std::shared_ptr<Panel> m_multichoice_panel {nullptr};
 
+        /**
+         * Panel drawing the key.
+         */
+        Panel* m_panel {nullptr};
+
         friend class VirtualKeyboard;
     };
 
@@ -216,16 +226,36 @@ public:
 protected:
     /**
      * Internal representation of a panel i.e. a set of keys organized by rows.
+     *
+     * The buttons of the keys are not widgets of the panel: they are only
+     * drawn, at their box, into an atlas holding the panel with every key
+     * released and then pressed.
      * @private
      */
-    struct Panel : public VerticalBoxSizer
+    struct Panel : public Widget
     {
         // cppcheck-suppress noExplicitConstructor
         explicit Panel(const PanelKeys& keys);
+        ~Panel() override;
+        void handle(Event& event) override;
+        void draw(Painter& painter, const Rect& rect) override;
+        void resize(const Size& s) override;
         void update_key_space(unsigned key_space);
         void update_key_size(const Size& s);
+        /// Place the keys in the rows, centered in the panel.
+        void layout_keys();
+        /// Render the atlas again when next drawn.
+        void invalidate();
+        /// Show a key pressed, or none.
+        void press(const std::shared_ptr<Key>& key);
+        /// Key at a point relative to the panel.
+        std::shared_ptr<Key> key_at(const Point& point) const;
 
         PanelKeys m_keys;
+        Size m_key_size;
+        DefaultDim m_top{0};
+        std::shared_ptr<Key> m_pressed;
+        shared_cairo_surface_t m_atlas;
     };
 
     /**
@@ -30,6 +30,7 @@
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -38,6 +39,16 @@ inline namespace v1
 class Painter;
 class Frame;
 class Screen;
+class Window;
+
+namespace detail
+{
+class FocusChain;
+class LayoutCache;
+class RectBatch;
+class StateCache;
+struct WidgetExtra;
+}
 
 /**
  * Base Widget class.
@@ -151,6 +162,29 @@ public:
          * cross the widget boundaries.
          */
         user_track_drag = detail::bit(14),
+
+        /**
+         * Cache the rendering of the widget and all of its children.
+         *
+         * The subtree is drawn once into an offscreen surface, which is then
+         * painted by the parent until damage comes from inside the subtree.
+         * Damage from siblings or the parent only blits the surface.
+         */
+        cache_subtree = detail::bit(15),
+
+        /**
+         * The widget can be drawn from several threads at the same time,
+         * each with its own Painter and damage rectangle.
+         *
+         * See Window::parallel_draw().
+         */
+        thread_safe_draw = detail::bit(16),
+
+        /**
+         * The widget can take the keyboard focus when it is moved with
+         * detail::move_focus().
+         */
+        focusable = detail::bit(17),
     };
 
     /// Widget flags
@@ -207,8 +241,8 @@ public:
 
     Widget(const Widget&) = delete;
     Widget& operator=(const Widget&) = delete;
-    Widget(Widget&&) noexcept = default;
-    Widget& operator=(Widget&&) noexcept = default;
+    Widget(Widget&&) noexcept;
+    Widget& operator=(Widget&&) noexcept;
 
     /**
      * Draw the widget.
@@ -237,6 +271,22 @@ public:
      */
     virtual void draw(Painter& painter, const Rect& rect);
 
+    /**
+     * Get the rectangle this widget completely covers when drawn.
+     *
+     * When drawing, the parent does not draw its own box or earlier siblings
+     * underneath this rectangle.  The default implementation returns the box
+     * inside the margin for a visible widget with alpha 1.0 that has a solid
+     * fill of an opaque color, no border radius, an opaque border, and no
+     * background image.  Otherwise, an empty rectangle is returned.
+     *
+     * A derived class that draws differently should override this, and
+     * return an empty rectangle if unsure.
+     *
+     * @return A rectangle in the same coordinates as box().
+     */
+    EGT_NODISCARD virtual Rect opaque_rect() const;
+
     /**
      * Handle an event.
      *
@@ -653,6 +703,60 @@ public:
      */
     EGT_NODISCARD bool no_layout() const;
 
+    /**
+     * Set the cache_subtree state.
+     *
+     * @param[in] value When true, the rendering of the widget and its
+     *            children is cached and only redrawn when damaged.
+     *
+     * Anything drawn outside of the widget box is not part of the cache, so
+     * this should not be combined with Widget::Flag::no_clip children.
+     *
+     * The cache is kept while the widget is hidden, and only the parts of it
+     * damaged since it was rendered are drawn again.
+     *
+     * By default, this state is false.
+     */
+    void cache_subtree(bool value);
+
+    /**
+     * Return the cache_subtree state of the widget.
+     */
+    EGT_NODISCARD bool cache_subtree() const;
+
+    /**
+     * Set the thread_safe_draw state.
+     *
+     * @param[in] value When true, draw() does not modify any state shared
+     *            with other widgets or other draw() calls of this widget, so
+     *            it can run in parallel for different damage rectangles.
+     *
+     * By default, this state is false.
+     */
+    void thread_safe_draw(bool value);
+
+    /**
+     * Return the thread_safe_draw state of the widget.
+     */
+    EGT_NODISCARD bool thread_safe_draw() const;
+
+    /**
+     * Set the focusable state.
+     *
+     * @param[in] value When true, the widget is in the order the keyboard
+     *            focus moves in while it and its parents are visible.
+     *
+     * By default, this state is false, except for widgets taking text.
+     *
+     * @see detail::move_focus()
+     */
+    void focusable(bool value);
+
+    /**
+     * Return the focusable state of the widget.
+     */
+    EGT_NODISCARD bool focusable() const;
+
     /**
      * Get the alpha property.
      *
@@ -811,7 +915,7 @@ public:
     /**
      * Check whether the widget has a custom palette.
      */
-    EGT_NODISCARD bool has_palette() const { return (bool)m_palette; }
+    EGT_NODISCARD bool has_palette() const;
 
     /**
      * Get a Widget color.
@@ -1042,77 +1146,55 @@ public:
      * @param[in] vertical Vertical ratio of parent height, with 100 being 100%.
      */
     void ratio(DefaultDim horizontal,
-               DefaultDim vertical)
-    {
-        auto a = detail::change_if_diff<>(m_horizontal_ratio, horizontal);
-        auto b = detail::change_if_diff<>(m_vertical_ratio, vertical);
-        if (a || b)
-            parent_layout();
-    }
+               DefaultDim vertical);
 
     /**
      * Set the vertical ratio relative to parent.
      *
      * @param[in] vertical Vertical ratio of parent height, with 100 being 100%.
      */
-    void vertical_ratio(DefaultDim vertical)
-    {
-        if (detail::change_if_diff<>(m_vertical_ratio, vertical))
-            parent_layout();
-    }
+    void vertical_ratio(DefaultDim vertical);
 
     /**
      * Get the vertical ratio relative to parent.
      */
-    EGT_NODISCARD DefaultDim vertical_ratio() const { return m_vertical_ratio; }
+    EGT_NODISCARD DefaultDim vertical_ratio() const;
 
     /**
      * Set the horizontal ratio relative to parent.
      *
      * @param[in] horizontal Horizontal ratio of parent width, with 100 being 100%.
      */
-    void horizontal_ratio(DefaultDim horizontal)
-    {
-        if (detail::change_if_diff<>(m_horizontal_ratio, horizontal))
-            parent_layout();
-    }
+    void horizontal_ratio(DefaultDim horizontal);
 
     /**
      * Get the horizontal ratio relative to parent.
      */
-    EGT_NODISCARD DefaultDim horizontal_ratio() const { return m_horizontal_ratio; }
+    EGT_NODISCARD DefaultDim horizontal_ratio() const;
 
     /**
      * Set the Y position ratio relative to parent.
      *
      * @param[in] yratio Y ratio of parent height, with 100 being 100%.
      */
-    void yratio(DefaultDim yratio)
-    {
-        if (detail::change_if_diff<>(m_yratio, yratio))
-            parent_layout();
-    }
+    void yratio(DefaultDim yratio);
 
     /**
      * Get the Y position ratio relative to parent.
      */
-    EGT_NODISCARD DefaultDim yratio() const { return m_yratio; }
+    EGT_NODISCARD DefaultDim yratio() const;
 
     /**
      * Set the X position ratio relative to parent.
      *
      * @param[in] xratio X ratio of parent width, with 100 being 100%.
      */
-    void xratio(DefaultDim xratio)
-    {
-        if (detail::change_if_diff<>(m_xratio, xratio))
-            parent_layout();
-    }
+    void xratio(DefaultDim xratio);
 
     /**
      * Get the X position ratio relative to parent.
      */
-    EGT_NODISCARD DefaultDim xratio() const { return m_xratio; }
+    EGT_NODISCARD DefaultDim xratio() const;
 
     /**
      * Get a minimum size hint for the Widget.
@@ -1137,6 +1219,35 @@ public:
             parent_layout();
     }
 
+    /**
+     * Get min_size_hint(), computed once until something it depends on
+     * changes.
+     *
+     * Sizers ask for the hints of their children in every layout pass, and
+     * nested layouts ask again for the same subtrees, so they use this
+     * instead.
+     *
+     * @see invalidate_size_hint()
+     */
+    EGT_NODISCARD Size cached_min_size_hint() const;
+
+    /**
+     * Drop the cached min_size_hint() of this widget and of its parents.
+     *
+     * This is done when the text, font, moat, or minimum size of the widget
+     * changes, and whenever parent_layout() is called.  A widget whose
+     * min_size_hint() depends on anything else calls this when it changes.
+     */
+    void invalidate_size_hint();
+
+    /**
+     * Drop the cached min_size_hint() of all widgets.
+     *
+     * This is done when something all widgets of a type depend on changes,
+     * like their default size, or the global font or theme.
+     */
+    static void invalidate_all_size_hints();
+
     /**
      * Paint the Widget using a Painter.
      *
@@ -1349,6 +1460,33 @@ public:
      */
     virtual void layout();
 
+    /**
+     * Request a layout of the Widget.
+     *
+     * This calls layout() right away, unless deferred layout is enabled with
+     * EventLoop::deferred_layout().  In that case the widget is only marked,
+     * and all marked widgets are laid out once before the next frame is
+     * drawn, no matter how many times they were marked.
+     */
+    void request_layout();
+
+    /**
+     * Returns true if a deferred layout of the widget, or of any of its
+     * children, is pending.
+     */
+    EGT_NODISCARD bool layout_pending() const
+    {
+        return m_layout_dirty || m_child_layout_dirty;
+    }
+
+    /**
+     * Run the deferred layout pending for the widget and its children.
+     *
+     * This is done by the EventLoop before every frame, and can be called to
+     * get the final geometry of widgets right away.
+     */
+    void flush_layout();
+
     /**
      * Helper function to draw this widget's box using the appropriate
      * theme.
@@ -1397,16 +1535,7 @@ public:
      * Sets the widget font which means the widget instance will no longer use
      * its Theme font.
      */
-    void font(const Font& font)
-    {
-        if (m_font && *m_font == font)
-            return;
-
-        m_font = std::make_unique<Font>(font);
-        damage();
-        layout();
-        parent_layout();
-    }
+    void font(const Font& font);
 
     /**
      * Reset the widget's Font.
@@ -1414,21 +1543,23 @@ public:
      * This is the inverse of setting a custom font for this widget instance
      * with font().
      */
-    void reset_font()
-    {
-        if (m_font)
-        {
-            m_font.reset();
-            damage();
-            layout();
-            parent_layout();
-        }
-    }
+    void reset_font();
 
     /**
      * Check whether the widget has a custom Font.
      */
-    bool has_font() const { return (bool)m_font; }
+    bool has_font() const;
+
+    /**
+     * Share the palette and Font set on another widget.
+     *
+     * They are not copied: both widgets refer to the same ones until either
+     * changes them, and then gets a copy of its own.  Many widgets built
+     * alike, e.g. from a WidgetPrototype, so hold a single palette and font.
+     *
+     * @param[in] widget The widget to share with.
+     */
+    void share_style(const Widget& widget);
 
     /**
      * Get the boolean checked state of the a widget.
@@ -1513,6 +1644,18 @@ public:
 
 protected:
 
+    /**
+     * Damage the widget for a change of its state only, like being pressed,
+     * checked or disabled, which changes nothing else it draws.
+     *
+     * This is the same as damage(), unless a widget keeps renderings of its
+     * states.
+     */
+    virtual void damage_state()
+    {
+        damage();
+    }
+
     /**
      * Special variation of damage() that is to be called explicitly by
      * subordinate widgets.
@@ -1528,6 +1671,51 @@ protected:
         return point();
     }
 
+    /**
+     * Find the subordinate that gets a pointer event.
+     *
+     * The default walks the subordinates from the top of the z-order down.
+     *
+     * @param[in] point Point relative to the origin of this widget.
+     * @return The topmost subordinate that can handle events and contains
+     * the point, or nullptr.
+     */
+    virtual Widget* subordinate_at(const Point& point);
+
+    /**
+     * Decide whether the pending layout of a subordinate can wait.
+     *
+     * Called by layout() for every subordinate, and by flush_layout() for
+     * every subordinate with a pending layout.  One that waits is left
+     * pending, and only laid out once this widget
+     * marks its children as pending again, with m_child_layout_dirty and
+     * parent_layout_pending(), and then no longer defers it.
+     *
+     * @param[in] subordinate The subordinate.
+     */
+    virtual bool defer_subordinate_layout(const Widget& subordinate)
+    {
+        detail::ignoreparam(subordinate);
+        return false;
+    }
+
+    /**
+     * Record that the subordinates, or the geometry of one of them, changed.
+     *
+     * Anything cached from the boxes of the subordinates compares
+     * subordinates_generation() to know when to recompute.
+     */
+    void subordinates_changed()
+    {
+        ++m_subordinates_generation;
+    }
+
+    /// Get the counter incremented by subordinates_changed().
+    EGT_NODISCARD uint32_t subordinates_generation() const
+    {
+        return m_subordinates_generation;
+    }
+
     /**
      * Cause the widget to draw itself and all of its children.
      *
@@ -1629,7 +1817,7 @@ protected:
      * is done for several reasons, including if this widget is moved, all of the
      * damage rects are still valid.
      */
-    void add_damage(const Rect& rect);
+    virtual void add_damage(const Rect& rect);
 
     /**
      * Helper type that defines the special draw child callback.
@@ -1639,10 +1827,7 @@ protected:
     /**
      * Get the special child draw callback.
      */
-    EGT_NODISCARD ChildDrawCallback special_child_draw_callback() const
-    {
-        return m_special_child_draw_callback;
-    }
+    EGT_NODISCARD ChildDrawCallback special_child_draw_callback() const;
 
     /**
      * Get the child draw callback of the parent.
@@ -1659,10 +1844,7 @@ protected:
     /**
      * Set the special child draw callback.
      */
-    void special_child_draw_callback(ChildDrawCallback func)
-    {
-        m_special_child_draw_callback = std::move(func);
-    }
+    void special_child_draw_callback(ChildDrawCallback func);
 
     /**
      * Special draw function that can be invoked when drawing each child.
@@ -1673,13 +1855,7 @@ protected:
      * @param painter An instance of the Painter to use.
      * @param widget The widget.
      */
-    void special_child_draw(Painter& painter, Widget* widget)
-    {
-        if (m_special_child_draw_callback)
-            m_special_child_draw_callback(painter, widget);
-        else if (parent())
-            parent()->special_child_draw(painter, widget);
-    }
+    void special_child_draw(Painter& painter, Widget* widget);
 
     /**
      * Starting from this Widget, find the Widget that has a Screen.
@@ -1713,6 +1889,17 @@ protected:
         return nullptr;
     }
 
+    /**
+     * Find where a rectangle of the Widget is drawn on the Widget that has a
+     * Screen, if nothing else is drawn over it.
+     *
+     * @param[in] rect Rectangle in the coordinates of box().
+     * @return The rectangle in the coordinates of the Widget that has a
+     * Screen, or an empty rectangle if a widget drawn after this one may cover
+     * it, a parent clips it, or a parent blends it with what is under it.
+     */
+    EGT_NODISCARD Rect unobscured_rect(Rect rect) const;
+
     /**
      * Get a const ref of the flags.
      */
@@ -1806,19 +1993,68 @@ protected:
 
     /**
      * Call our parent to do a layout.
+     *
+     * This also drops the cached size hint, see invalidate_size_hint().
      */
     void parent_layout();
 
+    /**
+     * Call our parent to do a layout, keeping the cached size hint, when
+     * only the box of the widget changed.
+     */
+    void relayout_parent();
+
+    /**
+     * Call our parent to do a layout, unless min_size_hint() is still the
+     * size hint cached before something it may depend on changed.
+     *
+     * The parent lays out its children from their size hints, so it would
+     * only end up with the same layout.
+     */
+    void parent_layout_if_hint_changed();
+
+    /**
+     * Drop the cached size hints of the subordinates, recursively, when
+     * something they inherit changes.
+     */
+    void invalidate_subordinate_size_hints();
+
     /**
      * Minimum size of the widget when not an empty value.
      */
     Size m_min_size;
 
+    /**
+     * Cached result of min_size_hint(), see cached_min_size_hint().
+     */
+    mutable Size m_size_hint;
+
+    /**
+     * Generation of the size hints m_size_hint was computed in, 0 when it
+     * is not valid.
+     */
+    mutable uint32_t m_size_hint_generation{0};
+
     /**
      * Status for whether this widget is currently performing layout.
      */
     bool m_in_layout{false};
 
+    /**
+     * Is a deferred layout of this widget pending.
+     */
+    bool m_layout_dirty{false};
+
+    /**
+     * Is a deferred layout of any child pending.
+     */
+    bool m_child_layout_dirty{false};
+
+    /**
+     * Mark the parents of this widget as having a pending child layout.
+     */
+    void parent_layout_pending();
+
     /**
      * Deserialize widget properties that require to call overridden methods.
      *
@@ -1834,11 +2070,22 @@ protected:
     /// @private
     void draw_subordinate(Painter& painter, const Rect& crect, Widget* child);
 
-    /// Used internally for calling the special child draw function.
-    ChildDrawCallback m_special_child_draw_callback;
+    /**
+     * Can everything a draw() of the rectangle reaches be drawn from several
+     * threads at once.
+     *
+     * @param[in] rect Damage rectangle, in the same coordinates as draw().
+     */
+    EGT_NODISCARD bool thread_safe_subtree(const Rect& rect) const;
 
-    /// Helper type for an array of subordinate widgets.
-    using SubordinatesArray = std::list<std::shared_ptr<Widget>>;
+    /**
+     * Helper type for an array of subordinate widgets.
+     *
+     * This is contiguous, so the draw, layout, and event loops over children
+     * walk memory in order.  Inserting or removing a subordinate invalidates
+     * iterators, so loops that may change the array use indexes.
+     */
+    using SubordinatesArray = std::vector<std::shared_ptr<Widget>>;
 
     /// Array of subordinates widgets split in child widgets and component widgets.
     SubordinatesArray m_subordinates;
@@ -1876,15 +2123,18 @@ protected:
     /**
      * Update the 'm_children' and 'm_components' members.
      *
-     * @note Should be called any time 'm_components_begin',
-     * m_subordonates.begin() or m_subordinates.end() have changed.
+     * @note Should be called any time 'm_children_count' or m_subordinates
+     * have changed.
      */
     void update_subordinates_ranges()
     {
+        const auto components_begin = m_subordinates.begin() +
+                                      static_cast<SubordinatesArray::difference_type>(m_children_count);
         m_children.begin(m_subordinates.begin());
-        m_children.end(m_components_begin);
-        m_components.begin(m_components_begin);
+        m_children.end(components_begin);
+        m_components.begin(components_begin);
         m_components.end(m_subordinates.end());
+        subordinates_changed();
     }
 
     /// Return either components() or children() depending on widget.component()
@@ -1911,12 +2161,15 @@ protected:
     /// Get the component status.
     EGT_NODISCARD bool component() const;
     /**
-     * Iterator for the beginning of components which are positionned after
-     * children in the subordinates array. Components are child widget as well,
-     * but not added through the Frame interface. Components are composition
-     * widgets and users must not be able to add extra ones or to remove them.
+     * Number of children, which is also the index of the first component in
+     * the subordinates array. Components are child widget as well, but not
+     * added through the Frame interface. Components are composition widgets
+     * and users must not be able to add extra ones or to remove them.
      */
-    SubordinatesArray::iterator m_components_begin;
+    size_t m_children_count{0};
+
+    /// Incremented by subordinates_changed().
+    uint32_t m_subordinates_generation{0};
 
     /// The damage array for this widget.
     Screen::DamageArray m_damage;
@@ -1927,20 +2180,28 @@ protected:
 private:
 
     /**
-     * Palette for the widget.
-     *
-     * This may or may not be a complete palette.  If a color does not exist in
-     * this instance, it will refer to the default_palette().
+     * State most widgets leave at its default, allocated the first time it is
+     * changed.
      *
-     * @note This should not be accessed directly.  Always use the access
-     * functions because this may not be a complete Palette.
+     * This is the palette, font and backgrounds overriding the theme, the
+     * ratios relative to the parent, the special child draw callback, and the
+     * subtree cache.
+     */
+    std::unique_ptr<detail::WidgetExtra> m_extra;
+
+    /**
+     * Get the extra state, allocating it if needed.
      */
-    std::unique_ptr<Palette> m_palette;
+    detail::WidgetExtra& extra();
 
     /**
-     * Optional background images.
+     * Get the boxes of the subordinates, to test them in batches, or nullptr
+     * if there are too few subordinates for it to pay off.
+     *
+     * @param[in] hit Get the boxes in the coordinates of the points given to
+     *            subordinate_at(), instead of the ones of box().
      */
-    ImageGroup m_backgrounds{"bg"};
+    const detail::RectBatch* subordinate_boxes(bool hit);
 
     /**
      * Flags for the widget.
@@ -1978,64 +2239,77 @@ private:
     DefaultDim m_margin{0};
 
     /**
-     * Alignment X ratio.
+     * Focus state.
      */
-    DefaultDim m_xratio{0};
+    bool m_focus{false};
 
     /**
-     * Alignment Y ratio.
+     * Widget alpha.
      */
-    DefaultDim m_yratio{0};
+    float m_alpha{1.0f};
 
     /**
-     * Horizontal alignment ratio.
+     * Fill flags.
      */
-    DefaultDim m_horizontal_ratio{0};
+    Theme::FillFlags m_fill_flags{};
 
     /**
-     * Vertical alignment ratio.
+     * Common initializations done by all constructors.
      */
-    DefaultDim m_vertical_ratio{0};
+    void init(void);
 
     /**
-     * Focus state.
+     * Deserialize widget properties.
      */
-    bool m_focus{false};
+    void deserialize(Serializer::Properties& props);
 
     /**
-     * Widget alpha.
+     * Paint the widget from its subtree cache, rendering the cache first if
+     * it is not valid, or only its damaged part.
      */
-    float m_alpha{1.0f};
+    void draw_cached(Painter& painter, const Rect& rect, float alpha = 1.f);
 
     /**
-     * Fill flags.
+     * Damage where the widget is drawn, for a change that does not change
+     * the rendering of its subtree, like showing or hiding it.
      */
-    Theme::FillFlags m_fill_flags{};
+    void damage_placement();
 
     /**
-     * Common initializations done by all constructors.
+     * Draw the widget, and the subordinates under owner, from a snapshot
+     * dimmed with dim and blurred by blur pixels, with a shadow of shadow
+     * pixels around owner.
      */
-    void init(void);
+    void backdrop(const Widget& owner, const Color& dim,
+                  DefaultDim blur, DefaultDim shadow);
 
     /**
-     * Font instance for the widget.
-     *
-     * @note This should not be accessed directly.  Always use the access
-     * functions because this is not set until it is modified.
+     * Stop drawing the backdrop of owner, if it has one.
      */
-    std::unique_ptr<Font> m_font;
+    void remove_backdrop(const Widget& owner);
 
     /**
-     * Deserialize widget properties.
+     * Paint the backdrop, rendering its damaged part of the snapshot first.
      */
-    void deserialize(Serializer::Properties& props);
+    void draw_backdrop(Painter& painter, const Rect& rect, const Widget& owner);
+
+    /**
+     * Resize the local font, if it follows the screen size.
+     *
+     * @return true if the widget has a local font.
+     */
+    bool resize_font();
 
     friend class Frame;
+    friend class Window;
+    friend class detail::FocusChain;
+    friend class detail::LayoutCache;
+    friend class detail::StateCache;
 };
 
 /// Enum string conversion map
 template<>
-EGT_API const std::pair<Widget::Flag, char const*> detail::EnumStrings<Widget::Flag>::data[15];
+EGT_API const std::pair<Widget::Flag, char const*> detail::EnumStrings<Widget::Flag>::data[18];
 
 /// Overloaded std::ostream insertion operator
 EGT_API std::ostream& operator<<(std::ostream& os, const Widget::Flag& flag);
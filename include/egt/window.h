@@ -18,6 +18,8 @@
 #include <egt/screen.h>
 #include <egt/widgetflags.h>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace egt
 {
@@ -28,6 +30,11 @@ namespace detail
 {
 class WindowImpl;
 class PlaneWindow;
+class TileDamage;
+class PlanePolicy;
+class ScanoutPolicy;
+class OcclusionPolicy;
+class SubsurfaceWindow;
 }
 
 /**
@@ -134,6 +141,18 @@ public:
 
     EGT_NODISCARD bool has_screen() const override;
 
+    /**
+     * Show the window on another output, such as the screen of a second
+     * display.
+     *
+     * The window covers the screen of the output, and is drawn and flipped
+     * at its pace, independently of the main window.  Only a window without
+     * a parent can be moved to an output.
+     *
+     * @param screen The screen of the output.  It must outlive the window.
+     */
+    void output(Screen& screen);
+
     void move(const Point& point) override;
 
     void show() override;
@@ -209,18 +228,193 @@ public:
      */
     EGT_NODISCARD WindowHint window_hint() const { return m_hint; }
 
+    /**
+     * Track damage with a grid of fixed size tiles.
+     *
+     * Instead of keeping a list of damage rectangles that is merged on every
+     * damage() call, dirty tiles are marked in a bitmap and converted to a
+     * list of row coalesced rectangles once per frame. This makes damage()
+     * constant time per tile row and puts an upper bound on the number of
+     * rectangles drawn and flipped each frame.
+     *
+     * @param[in] tile Size of a tile. An empty size disables tile damage
+     *            tracking.
+     */
+    void damage_tiles(const Size& tile);
+
+    /**
+     * Get the tile size used to track damage.
+     *
+     * @return An empty size if tile damage tracking is disabled.
+     */
+    EGT_NODISCARD Size damage_tiles() const;
+
+    /**
+     * Draw large damage rectangles on several threads.
+     *
+     * A large damage rectangle is split into horizontal bands, and each band
+     * is drawn by a thread of a shared pool, with its own Painter on the rows
+     * of the screen buffer it covers.  This is only done when every widget
+     * the rectangle reaches, including the window, has
+     * Widget::Flag::thread_safe_draw set, and the screen buffer is an image
+     * surface.  Anything else is drawn on the event loop thread as usual.
+     *
+     * The number of threads is set with the EGT_DRAW_THREADS environment
+     * variable, and defaults to one less than the number of cores.
+     *
+     * By default, this is disabled.
+     */
+    void parallel_draw(bool enable)
+    {
+        m_parallel_draw = enable;
+    }
+
+    /**
+     * Returns true if large damage rectangles may be drawn on several threads.
+     */
+    EGT_NODISCARD bool parallel_draw() const { return m_parallel_draw; }
+
+    /**
+     * Move content already drawn in the window, instead of drawing it again.
+     *
+     * On the next frame, the pixels of @b rect are moved by @b delta in the
+     * screen buffer, and only the part of @b rect they leave uncovered is
+     * damaged and drawn.  Damage not drawn yet moves along with them.  This
+     * is what a ScrolledView uses to scroll.
+     *
+     * The caller must make sure the content of @b rect is drawn as is, with
+     * nothing covering it.  When the pixels cannot be moved, like with a
+     * Screen in zero copy mode, @b rect is damaged instead.
+     *
+     * @param[in] rect Rectangle to move, in the coordinates of damage().
+     * @param[in] delta How far to move the content of the rectangle.
+     */
+    void scroll(const Rect& rect, const Point& delta);
+
+    /**
+     * Allow the window to be moved between a hardware plane and composition
+     * at runtime, depending on how often it is damaged.
+     *
+     * A window damaged in most frames, like a video, sprite, or animated
+     * needle, is then moved to a free overlay plane and moved back when it
+     * becomes idle.  If no plane is available, the window stays composed.
+     *
+     * This is enabled for windows created with WindowHint::automatic when
+     * the EGT_AUTO_PLANES environment variable is set.
+     *
+     * @note A window on a plane is always displayed above the composed
+     * content, so this is only suitable for windows that are not covered by
+     * other widgets.
+     */
+    void auto_plane(bool enable)
+    {
+        m_auto_plane = enable;
+    }
+
+    /**
+     * Returns true if the window may be moved to a hardware plane at runtime.
+     */
+    EGT_NODISCARD bool auto_plane() const { return m_auto_plane; }
+
+    /**
+     * Move the window to a hardware plane while it is animated.
+     *
+     * Each step of moving a composed window damages, and composes again,
+     * both where it was and where it is.  On a plane, a step only changes
+     * the position of the plane.  When set, the window is moved to a free
+     * overlay plane, if any, and when cleared it goes back to composition
+     * before the next frame, so clearing and setting it again in between,
+     * like when an animation is replaced by another, keeps the plane.
+     *
+     * Windows already on a plane, the main window, and windows created with
+     * WindowHint::software are left where they are.
+     *
+     * SideBoard does this for its open and close animations.
+     */
+    void animating(bool active);
+
+    /**
+     * Returns true if the window is being animated.
+     */
+    EGT_NODISCARD bool animating() const { return m_animating; }
+
+    /**
+     * Draw a backdrop under the window while it is visible.
+     *
+     * The parent draws what is under the window from a snapshot, dimmed with
+     * @b dim and blurred by @b blur pixels, with a soft shadow of @b shadow
+     * pixels around the window.  The snapshot is rendered when the window is
+     * shown, and then only where something under the window is damaged, so
+     * moving or animating the window, like a modal Dialog, does not draw what
+     * is under it again.
+     *
+     * A transparent dim with no blur and no shadow removes the backdrop.
+     *
+     * @param[in] dim Color blended over what is under the window.
+     * @param[in] blur Blur radius, in pixels.
+     * @param[in] shadow Size of the shadow, in pixels.
+     */
+    void backdrop(const Color& dim, DefaultDim blur = 0, DefaultDim shadow = 0);
+
+    /**
+     * Returns true if a backdrop is drawn under the window.
+     */
+    EGT_NODISCARD bool backdrop() const
+    {
+        return m_backdrop_dim.alpha() || m_backdrop_blur > 0 || m_backdrop_shadow > 0;
+    }
+
     void serialize(Serializer& serializer) const override;
 
     ~Window() noexcept override;
 
 protected:
 
+    void add_damage(const Rect& rect) override;
+
+    void set_parent(Widget* parent) override;
+
+    /**
+     * Switch the window backend between a hardware plane and composition.
+     *
+     * @return true if the window uses the requested backend after the call.
+     */
+    bool switch_plane(bool enable);
+
     /**
      * Perform the actual drawing.  Allocate the Painter and call draw() on each
      * child.
      */
     virtual void do_draw();
 
+    /**
+     * Move the damage covered by opaque planes above the window aside, to
+     * be drawn once they no longer cover it.
+     */
+    void occlude_damage();
+
+    /**
+     * Draw a damage rectangle in bands on the draw threads.
+     *
+     * @return false if the rectangle cannot be drawn in parallel, and was
+     * not drawn.
+     */
+    bool draw_bands(Painter& painter, const Rect& rect);
+
+    /**
+     * Move the content of the rectangles passed to scroll() in the screen
+     * buffer.
+     *
+     * @param[out] moved Areas of the screen buffer changed, to flip.
+     */
+    void move_scrolled(Screen::DamageArray& moved);
+
+    /// Add or remove the backdrop in the parent, depending on the visibility.
+    void update_backdrop();
+
+    /// Damage the area of the parent covered by the shadow of the backdrop.
+    void damage_shadow();
+
     /// @private
     virtual void allocate_screen();
 
@@ -297,8 +491,54 @@ protected:
     /// @private
     WindowHint m_hint;
 
+    /// Tile damage tracker, if enabled.
+    std::unique_ptr<detail::TileDamage> m_tile_damage;
+
+    /// Can the window be moved to a plane at runtime?
+    bool m_auto_plane{false};
+
+    /// Is the window being animated?
+    bool m_animating{false};
+
+    /// Was the window moved to a plane for an animation?
+    bool m_animation_plane{false};
+
+    /// May large damage rectangles be drawn on several threads?
+    bool m_parallel_draw{false};
+
+    /// Rectangles, and how far to move them, passed to scroll() since the last frame.
+    std::vector<std::pair<Rect, Point>> m_scrolls;
+
+    /// Was the window damaged since the last frame?
+    bool m_damaged{false};
+
+    /// One bit per recent frame, set if the window was damaged in it.
+    uint32_t m_damage_history{0};
+
+    /// Number of frames the window was alone on its screen.
+    uint32_t m_scanout_frames{0};
+
+    /// Parts of the window covered by opaque planes above it.
+    std::vector<Rect> m_occluders;
+
+    /// Damage not drawn because it is covered by m_occluders.
+    Screen::DamageArray m_occluded;
+
+    /// Color the backdrop is dimmed with.
+    Color m_backdrop_dim;
+
+    /// Blur radius of the backdrop.
+    DefaultDim m_backdrop_blur{0};
+
+    /// Size of the shadow of the backdrop.
+    DefaultDim m_backdrop_shadow{0};
+
     friend class detail::WindowImpl;
     friend class detail::PlaneWindow;
+    friend class detail::PlanePolicy;
+    friend class detail::ScanoutPolicy;
+    friend class detail::OcclusionPolicy;
+    friend class detail::SubsurfaceWindow;
 };
 
 /**
@@ -44,6 +44,54 @@ private:
 
 %}
 
+%wrapper %{
+/*
+ * egt.set_values(widgets, values)
+ *
+ * Set the value of many ValueRangeWidgetI or ValueRangeWidgetF at once, i.e.
+ * from a sensor feed, with one call from Lua instead of one per widget.
+ * Returns the number of widgets set.
+ */
+static int egt_lua_set_values(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TTABLE);
+    luaL_checktype(L, 2, LUA_TTABLE);
+
+    swig_type_info* int_type = SWIGTYPE_p_egt__v1__ValueRangeWidgetT_int_t;
+    swig_type_info* float_type = SWIGTYPE_p_egt__v1__ValueRangeWidgetT_float_t;
+
+    const auto count = luaL_len(L, 1);
+    int set = 0;
+    for (lua_Integer i = 1; i <= count; ++i)
+    {
+        lua_rawgeti(L, 1, i);
+        lua_rawgeti(L, 2, i);
+
+        void* ptr = nullptr;
+        if (lua_isnumber(L, -1))
+        {
+            if (SWIG_IsOK(SWIG_ConvertPtr(L, -2, &ptr, int_type, 0)) && ptr)
+            {
+                static_cast<ValueRangeWidget<int>*>(ptr)->value(static_cast<int>(lua_tointeger(L, -1)));
+                ++set;
+            }
+            else if (SWIG_IsOK(SWIG_ConvertPtr(L, -2, &ptr, float_type, 0)) && ptr)
+            {
+                static_cast<ValueRangeWidget<float>*>(ptr)->value(static_cast<float>(lua_tonumber(L, -1)));
+                ++set;
+            }
+        }
+
+        lua_pop(L, 2);
+    }
+
+    lua_pushinteger(L, set);
+    return 1;
+}
+%}
+
+%native(set_values) int egt_lua_set_values(lua_State* L);
+
 %luacode
 {
   -- print "EGT module loaded ok"
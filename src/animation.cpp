@@ -3,19 +3,58 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "egt/detail/math.h"
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/animationticker.h"
+#include "detail/window/visibilitypolicy.h"
 #include "egt/animation.h"
 #include "egt/app.h"
+#include "egt/detail/fixed.h"
 #include "egt/detail/math.h"
 #include "egt/widget.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <stdexcept>
 
 namespace egt
 {
 inline namespace v1
 {
 
+#ifdef HAVE_FIXED_POINT
+/**
+ * Q16.16 version of detail::interpolate(), and of the rounding of the result.
+ *
+ * Returns false when the easing function has no table, or when the values
+ * are out of the range of the table, to use the floating point path.
+ */
+static bool fixed_interpolate(const EasingFunc& easing, EasingScalar percent,
+                              EasingScalar start, EasingScalar end,
+                              bool reverse, bool round, EasingScalar& result)
+{
+    using detail::Fixed;
+
+    if (std::abs(start) >= Fixed::INTERPOLATE_RANGE ||
+        std::abs(end) >= Fixed::INTERPOLATE_RANGE)
+        return false;
+
+    const auto table = detail::FixedEasing::cached(easing);
+    if (!table)
+        return false;
+
+    const auto p = Fixed::from_float(percent);
+    const auto eased = reverse ? Fixed::one() - (*table)(Fixed::one() - p) : (*table)(p);
+    const auto from = Fixed::from_float(start);
+    const auto value = from + (Fixed::from_float(end) - from) * eased;
+
+    result = round ? static_cast<EasingScalar>(value.to_int()) : value.to_float();
+    return true;
+}
+#endif
+
 Animation::Animation(EasingScalar start, EasingScalar end,
                      const AnimationCallback& callback,
                      std::chrono::milliseconds duration,
@@ -41,13 +80,20 @@ void Animation::start()
 }
 
 bool Animation::next()
+{
+    return advance(std::chrono::steady_clock::now());
+}
+
+bool Animation::advance(std::chrono::steady_clock::time_point now)
 {
     if (!running())
         return false;
 
-    auto now = std::chrono::steady_clock::now();
-    m_elapsed += std::chrono::duration<EasingScalar, std::milli>(now - m_intermediate_time).count();
-    m_intermediate_time = now;
+    if (now > m_intermediate_time)
+    {
+        m_elapsed += std::chrono::duration<EasingScalar, std::milli>(now - m_intermediate_time).count();
+        m_intermediate_time = now;
+    }
 
     auto percent = m_elapsed / m_duration.count();
 
@@ -62,10 +108,16 @@ bool Animation::next()
     }
     else
     {
-        auto result = detail::interpolate(m_easing, percent, m_start, m_end, m_reverse);
+        EasingScalar result;
+#ifdef HAVE_FIXED_POINT
+        if (!fixed_interpolate(m_easing, percent, m_start, m_end, m_reverse, m_round, result))
+#endif
+        {
+            result = detail::interpolate(m_easing, percent, m_start, m_end, m_reverse);
 
-        if (m_round)
-            result = std::round(result);
+            if (m_round)
+                result = std::round(result);
+        }
 
         if (!detail::float_equal(result, m_current))
         {
@@ -103,16 +155,8 @@ AutoAnimation::AutoAnimation(EasingScalar start, EasingScalar end,
                              std::chrono::milliseconds duration,
                              const EasingFunc& func,
                              const AnimationCallback& callback)
-    : Animation(start, end, callback, duration, func),
-      m_timer(std::chrono::milliseconds(30))
+    : Animation(start, end, callback, duration, func)
 {
-    m_timer.on_timeout([this]()
-    {
-        if (!next())
-        {
-            stop();
-        }
-    });
 }
 
 AutoAnimation::AutoAnimation(std::chrono::milliseconds duration,
@@ -124,24 +168,293 @@ AutoAnimation::AutoAnimation(std::chrono::milliseconds duration,
 void AutoAnimation::start()
 {
     Animation::start();
-    m_timer.start();
+    m_active = running();
+    start_ticks();
 }
 
 void AutoAnimation::stop()
 {
-    m_timer.cancel();
+    stop_ticks();
     Animation::stop();
+
+    // the ticker stops a finished animation, which is no longer running
+    if (m_active)
+    {
+        m_active = false;
+        on_stopped.invoke();
+    }
 }
 
 void AutoAnimation::resume()
 {
     Animation::resume();
-    m_timer.start();
+    m_active = running();
+    start_ticks();
+}
+
+void AutoAnimation::start_ticks()
+{
+    if (Application::check_instance() && running() && !m_suspended)
+        Application::instance().event().animation_ticker().add(*this);
+}
+
+void AutoAnimation::stop_ticks()
+{
+    if (Application::check_instance())
+        Application::instance().event().animation_ticker().remove(*this);
+}
+
+void AutoAnimation::bind(Widget& widget)
+{
+    detail::VisibilityPolicy::bind(*this, widget);
+}
+
+void AutoAnimation::unbind()
+{
+    detail::VisibilityPolicy::unbind(*this);
+    suspend(false);
+}
+
+void AutoAnimation::suspend(bool suspend)
+{
+    if (m_suspended == suspend)
+        return;
+
+    m_suspended = suspend;
+
+    // the first step after resuming advances by all the time that passed
+    if (suspend)
+        stop_ticks();
+    else
+        start_ticks();
+}
+
+AutoAnimation::~AutoAnimation() noexcept
+{
+    stop_ticks();
+    detail::VisibilityPolicy::unbind(*this);
 }
 
 void AutoAnimation::interval(std::chrono::milliseconds duration)
 {
-    m_timer.change_duration(duration);
+    m_interval = duration;
+
+    // the ticker may have to run more often
+    start_ticks();
+}
+
+AnimationBatch::AnimationBatch(const EasingFunc& func)
+    : AutoAnimation(std::chrono::milliseconds(0), func)
+{
+    using Function = EasingScalar(*)(EasingScalar);
+
+    const auto target = func.target<Function>();
+    if (const auto table = func.target<easing_table>())
+        m_table = std::make_unique<easing_table>(*table);
+    else if (!target || *target != easing_linear)
+        m_table = std::make_unique<easing_table>(func);
+}
+
+EasingScalar AnimationBatch::clock(std::chrono::steady_clock::time_point now) const
+{
+    // the time since the last step, when running, is not in m_elapsed yet
+    if (running() && now > m_intermediate_time)
+        return m_elapsed + std::chrono::duration<EasingScalar, std::milli>(now - m_intermediate_time).count();
+    return m_elapsed;
+}
+
+void AnimationBatch::set(Index index, EasingScalar start, EasingScalar end,
+                         std::chrono::milliseconds duration,
+                         std::chrono::milliseconds delay)
+{
+    if (m_state[index] == State::pending)
+        --m_pending;
+
+    m_values[index] = m_round ? std::round(start) : start;
+
+    if (duration.count() <= 0 && delay.count() <= 0)
+    {
+        // done right away, and never changes while evaluated
+        m_from[index] = end;
+        m_to[index] = end;
+        m_begin[index] = 0;
+        m_rate[index] = 0;
+        m_values[index] = m_round ? std::round(end) : end;
+        m_state[index] = State::done;
+        return;
+    }
+
+    m_from[index] = start;
+    m_to[index] = end;
+    m_begin[index] = clock(std::chrono::steady_clock::now()) + delay.count();
+    m_rate[index] = duration.count() > 0 ? 1.f / duration.count() : 1e6f;
+    m_state[index] = State::pending;
+    ++m_pending;
+}
+
+AnimationBatch::Index AnimationBatch::add(EasingScalar start, EasingScalar end,
+        std::chrono::milliseconds duration,
+        std::chrono::milliseconds delay)
+{
+    Index index;
+    if (!m_free.empty())
+    {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        index = m_state.size();
+        m_from.push_back(0);
+        m_to.push_back(0);
+        m_begin.push_back(0);
+        m_rate.push_back(0);
+        m_values.push_back(0);
+        m_state.push_back(State::free);
+    }
+
+    set(index, start, end, duration, delay);
+    return index;
+}
+
+void AnimationBatch::restart(Index index, EasingScalar start, EasingScalar end,
+                             std::chrono::milliseconds duration,
+                             std::chrono::milliseconds delay)
+{
+    if (index >= m_state.size() || m_state[index] == State::free)
+        throw std::runtime_error("invalid animation batch index");
+
+    set(index, start, end, duration, delay);
+}
+
+void AnimationBatch::remove(Index index)
+{
+    if (index >= m_state.size() || m_state[index] == State::free)
+        return;
+
+    if (m_state[index] == State::pending)
+        --m_pending;
+
+    // free entries evaluate to a constant, and are never reported
+    m_from[index] = 0;
+    m_to[index] = 0;
+    m_begin[index] = 0;
+    m_rate[index] = 0;
+    m_values[index] = 0;
+    m_state[index] = State::free;
+    m_free.push_back(index);
+}
+
+void AnimationBatch::clear()
+{
+    m_from.clear();
+    m_to.clear();
+    m_begin.clear();
+    m_rate.clear();
+    m_values.clear();
+    m_state.clear();
+    m_free.clear();
+    m_pending = 0;
+}
+
+bool AnimationBatch::done(Index index) const
+{
+    return m_state.at(index) == State::done;
+}
+
+void AnimationBatch::start()
+{
+    m_intermediate_time = std::chrono::steady_clock::now();
+    m_running = true;
+    m_active = true;
+    start_ticks();
+}
+
+bool AnimationBatch::advance(std::chrono::steady_clock::time_point now)
+{
+    if (!running())
+        return false;
+
+    if (now > m_intermediate_time)
+    {
+        m_elapsed += std::chrono::duration<EasingScalar, std::milli>(now - m_intermediate_time).count();
+        m_intermediate_time = now;
+    }
+
+    if (m_pending)
+        evaluate();
+
+    m_running = m_pending != 0;
+    return m_running;
+}
+
+void AnimationBatch::evaluate()
+{
+    const auto count = m_state.size();
+    const auto time = m_elapsed;
+
+    m_progress.resize(count);
+    m_eased.resize(count);
+
+    // each pass is a plain loop over arrays, which the compiler vectorizes
+    auto progress = m_progress.data();
+    for (size_t i = 0; i < count; ++i)
+        progress[i] = std::min(std::max((time - m_begin[i]) * m_rate[i], 0.f), 1.f);
+
+    auto eased = m_eased.data();
+    if (m_reverse)
+    {
+        for (size_t i = 0; i < count; ++i)
+            eased[i] = 1.f - progress[i];
+        if (m_table)
+            (*m_table)(eased, eased, count);
+        for (size_t i = 0; i < count; ++i)
+            eased[i] = 1.f - eased[i];
+    }
+    else if (m_table)
+    {
+        (*m_table)(progress, eased, count);
+    }
+    else
+    {
+        std::copy(progress, progress + count, eased);
+    }
+
+    // reuse the eased progress for the new values
+    for (size_t i = 0; i < count; ++i)
+        eased[i] = m_from[i] * (1.f - eased[i]) + m_to[i] * eased[i];
+
+    if (m_round)
+    {
+        for (size_t i = 0; i < count; ++i)
+            eased[i] = std::round(eased[i]);
+    }
+
+    m_changed.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (m_state[i] != State::pending)
+            continue;
+
+        if (progress[i] >= 1.f)
+        {
+            m_state[i] = State::done;
+            --m_pending;
+            eased[i] = m_round ? std::round(m_to[i]) : m_to[i];
+        }
+
+        if (!detail::float_equal(eased[i], m_values[i]))
+        {
+            m_values[i] = eased[i];
+            m_changed.push_back(i);
+        }
+    }
+
+    if (m_changed.empty())
+        return;
+
+    for (auto& callback : m_change_callbacks)
+        callback(m_changed);
 }
 
 }
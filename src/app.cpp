@@ -8,23 +8,40 @@
 #endif
 
 #include "detail/egtlog.h"
+#include "detail/eraw.h"
+#include "detail/erawimage.h"
+#include "detail/snapshot.h"
 #include "egt/app.h"
+#include "egt/cachebudget.h"
 #include "egt/detail/filesystem.h"
+#include "egt/detail/imagecache.h"
+#include "egt/detail/pixelops.h"
+#include "egt/detail/input/inputreplay.h"
 #include "egt/detail/screen/composerscreen.h"
+#include "egt/detail/screen/epdscreen.h"
 #include "egt/detail/screen/kmsscreen.h"
 #include "egt/detail/screen/memoryscreen.h"
 #include "egt/detail/string.h"
+#include "egt/detail/surfacepool.h"
 #include "egt/eventloop.h"
+#include "egt/font.h"
 #include "egt/input.h"
+#include "egt/network/rfb.h"
 #include "egt/painter.h"
+#include "egt/perfhud.h"
 #include "egt/respath.h"
 #include "egt/serialize.h"
 #include "egt/timer.h"
 #include "egt/utils.h"
 #include "egt/version.h"
 #include "egt/window.h"
+#include <algorithm>
+#include <cerrno>
 #include <clocale>
 #include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <future>
 #include <iostream>
 #ifdef HAVE_LIBINTL
 #include <libintl.h>
@@ -41,6 +58,10 @@
 #include "egt/detail/screen/sdlscreen.h"
 #endif
 
+#ifdef HAVE_WAYLAND
+#include "egt/detail/screen/waylandscreen.h"
+#endif
+
 #ifdef HAVE_LIBINPUT
 #include "egt/detail/input/inputlibinput.h"
 #endif
@@ -84,13 +105,32 @@ bool Application::check_instance()
 #define SIGUSR2 SIGTERM
 #endif
 
+static const char* font_manifest()
+{
+    auto path = getenv("EGT_FONT_MANIFEST");
+    return path && strlen(path) ? path : nullptr;
+}
+
 Application::Application(int argc, char** argv,
                          const std::string& name, bool primary)
     : m_event(*this),
       m_argc(argc),
       m_argv(argv),
-      m_signals(event().io(), SIGUSR1, SIGUSR2)
+      m_signals(event().io(), SIGUSR1, SIGUSR2),
+      m_snapshot_timer(event().io())
 {
+    const auto origin = std::chrono::steady_clock::now();
+    const auto since = [origin](std::chrono::steady_clock::time_point when)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(when - origin);
+    };
+    const auto stage = [this, &since](const char* stage_name, const std::function<void()>& func)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        m_startup.push_back({stage_name, since(start), since(std::chrono::steady_clock::now()) - since(start)});
+    };
+
     setup_logging();
 
     setup_info();
@@ -104,15 +144,51 @@ Application::Application(int argc, char** argv,
         the_app = this;
     }
 
-    setup_search_paths();
+    stage("search paths", []() { setup_search_paths(); });
 
-    setup_locale(name);
+    stage("locale", [&name]() { setup_locale(name); });
 
-    setup_backend(primary, name);
+    // fonts are preloaded while the screen and inputs are set up
+    StartupStage fonts{"fonts", {}, {}};
+    std::future<void> fonts_done;
+    if (font_manifest())
+    {
+        fonts_done = std::async(std::launch::async, [&fonts, &since]()
+        {
+            const auto start = std::chrono::steady_clock::now();
+            setup_fonts();
+            fonts.start = since(start);
+            fonts.duration = since(std::chrono::steady_clock::now()) - fonts.start;
+        });
+    }
+
+    stage("backend", [this, primary, &name]() { setup_backend(primary, name); });
+
+    stage("splash", [this]() { setup_splash(); });
+
+    stage("inputs", [this]() { setup_inputs(); });
+
+    stage("events", [this]() { setup_events(); });
+
+    if (fonts_done.valid())
+    {
+        fonts_done.get();
+        m_startup.push_back(fonts);
+        std::stable_sort(m_startup.begin(), m_startup.end(),
+                         [](const StartupStage & lhs, const StartupStage & rhs)
+        {
+            return lhs.start < rhs.start;
+        });
+    }
 
-    setup_inputs();
+    for (const auto& s : m_startup)
+        detail::debug("startup {} at {} us took {} us", s.name, s.start.count(), s.duration.count());
 
-    setup_events();
+    if (!m_snapshot.empty())
+    {
+        m_snapshot_frames = m_screen->flip_stats().frames;
+        wait_snapshot();
+    }
 }
 
 void Application::setup_events()
@@ -125,11 +201,14 @@ void Application::setup_events()
         if (event.key().keycode == EKEY_SNAPSHOT)
         {
             if (m_argc)
-                paint_to_file(fmt::format("{}.png", m_argv[0]));
+                snapshot(fmt::format("{}.png", m_argv[0]));
             else
-                paint_to_file();
+                snapshot("screen.png");
         }
     }, {EventId::keyboard_down});
+
+    if (!getenv("EGT_NO_MEMORY_PRESSURE"))
+        experimental::cache_budget().watch();
 }
 
 void Application::setup_info()
@@ -176,6 +255,10 @@ void Application::setup_logging()
         auto loglevel = std::stoi(level);
         detail::loglevel(loglevel);
     }
+
+    auto async = getenv("EGT_LOG_ASYNC");
+    if (async && strlen(async))
+        detail::log_async(true);
 }
 
 void Application::setup_search_paths(const std::vector<std::string>& extra_paths)
@@ -205,6 +288,13 @@ void Application::setup_search_paths(const std::vector<std::string>& extra_paths
     add_search_path(detail::exe_pwd());
 }
 
+void Application::setup_fonts()
+{
+    auto manifest = font_manifest();
+    if (manifest && !Font::preload(manifest))
+        EGTLOG_DEBUG("no font manifest at {}", manifest);
+}
+
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
 void Application::setup_backend(bool primary, const std::string& name)
 {
@@ -235,6 +325,9 @@ void Application::setup_backend(bool primary, const std::string& name)
     // backends listed in order of automatic priority
     const std::pair<const char*, std::function<std::unique_ptr<egt::Screen>()>> backends[] =
     {
+#ifdef HAVE_WAYLAND
+        {"wayland", [this, &size, &name]() { return std::make_unique<detail::WaylandScreen>(*this, size, name); }},
+#endif
 #ifdef HAVE_LIBPLANES
         {"kms", [&primary]() { return std::make_unique<detail::KMSScreen>(primary); }},
 #endif
@@ -246,15 +339,28 @@ void Application::setup_backend(bool primary, const std::string& name)
 #endif
         {"memory", [&size]() { return std::make_unique<detail::MemoryScreen>(size); }},
         {"composer", [&size]() { return std::make_unique<detail::ComposerScreen>(size); }},
+        {
+            "epd", [this]()
+            {
+                auto device = getenv("EGT_EPD_DEVICE");
+                return std::make_unique<detail::EpdScreen>(*this, device && strlen(device) ? device : "/dev/fb0");
+            }
+        },
     };
 
     if (backend != "none")
     {
         for (auto& b : backends)
         {
+            // a compositor is only used when running under one
+            if (backend.empty() && b.first == std::string("wayland") && !getenv("WAYLAND_DISPLAY"))
+                continue;
+
             if (backend.empty() || b.first == backend)
             {
                 m_screen = b.second();
+                // images are stored in the format of the screen
+                detail::image_cache().format(m_screen->format());
                 return;
             }
         }
@@ -263,6 +369,138 @@ void Application::setup_backend(bool primary, const std::string& name)
     detail::info("no screen backend");
 }
 
+void Application::setup_splash()
+{
+    if (!m_screen)
+        return;
+
+    auto snapshot = getenv("EGT_STARTUP_SNAPSHOT");
+    if (snapshot && strlen(snapshot))
+    {
+        m_snapshot = snapshot;
+        if (show_snapshot())
+            return;
+    }
+
+    auto splash = getenv("EGT_SPLASH");
+    if (!splash || !strlen(splash))
+        return;
+
+    // an eraw image is mapped and drawn without decoding
+    try
+    {
+        Image image(splash);
+        const Rect rect(Point(), m_screen->size());
+        Painter painter(m_screen->context());
+        painter.set(Palette::black);
+        painter.draw(rect);
+        painter.fill();
+        painter.draw(rect.center() - Point(image.width() / 2, image.height() / 2));
+        painter.draw(image);
+        m_screen->flip({rect});
+    }
+    catch (const std::exception& e)
+    {
+        detail::warn("unable to show splash {}: {}", splash, e.what());
+    }
+}
+
+bool Application::show_snapshot()
+{
+    if (!detail::exists(m_snapshot))
+        return false;
+
+    try
+    {
+        // the raw pixels are mapped and copied once, to the screen
+        auto surface = detail::load_eraw(m_snapshot);
+        const Rect rect(Point(), m_screen->size());
+        if (cairo_image_surface_get_width(surface.get()) != rect.width() ||
+            cairo_image_surface_get_height(surface.get()) != rect.height())
+        {
+            detail::info("startup snapshot {} does not match the screen", m_snapshot);
+            return false;
+        }
+
+        auto cr = m_screen->context();
+        cairo_save(cr.get());
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(cr.get(), surface.get(), 0, 0);
+        cairo_paint(cr.get());
+        cairo_restore(cr.get());
+        m_screen->flip({rect});
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        detail::warn("unable to show startup snapshot {}: {}", m_snapshot, e.what());
+    }
+
+    return false;
+}
+
+void Application::wait_snapshot()
+{
+    m_snapshot_timer.expires_after(std::chrono::milliseconds(500));
+    m_snapshot_timer.async_wait([this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        // the screen is stable once frames were drawn, and none since the last check
+        const auto frames = m_screen->flip_stats().frames;
+        if (frames == m_snapshot_frames && m_snapshot_drawn)
+        {
+            save_snapshot();
+            return;
+        }
+
+        m_snapshot_drawn = m_snapshot_drawn || frames != m_snapshot_frames;
+        m_snapshot_frames = frames;
+        wait_snapshot();
+    });
+}
+
+void Application::save_snapshot()
+{
+    auto surface = paint_windows();
+    cairo_surface_flush(surface.get());
+    auto data = cairo_image_surface_get_data(surface.get());
+    const auto width = cairo_image_surface_get_width(surface.get());
+    const auto height = cairo_image_surface_get_height(surface.get());
+    const auto stride = cairo_image_surface_get_stride(surface.get());
+
+    // writing the same snapshot again at every start would only wear the flash
+    if (detail::exists(m_snapshot))
+    {
+        try
+        {
+            auto previous = detail::load_eraw(m_snapshot);
+            if (cairo_image_surface_get_width(previous.get()) == width &&
+                cairo_image_surface_get_height(previous.get()) == height &&
+                cairo_image_surface_get_stride(previous.get()) == stride &&
+                !memcmp(cairo_image_surface_get_data(previous.get()), data,
+                        static_cast<size_t>(stride) * height))
+                return;
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    // written aside and renamed, so that a power loss does not leave half a file
+    const auto tmp = m_snapshot + ".tmp";
+    detail::ErawImage::save(tmp, data, width, height, detail::ErawImage::Format::raw);
+    if (std::rename(tmp.c_str(), m_snapshot.c_str()))
+    {
+        detail::warn("unable to save startup snapshot {}: {}", m_snapshot, strerror(errno));
+        std::remove(tmp.c_str());
+        return;
+    }
+
+    detail::debug("saved startup snapshot {}", m_snapshot);
+}
+
 void Application::setup_inputs()
 {
     m_input_devices.clear();
@@ -355,6 +593,76 @@ void Application::setup_inputs()
     if (m_inputs.empty())
         m_inputs.push_back(std::make_unique<detail::InputLibInput>(*this));
 #endif
+
+    // EGT_RFB_PORT=5900
+    auto port = getenv("EGT_RFB_PORT");
+    if (port && strlen(port))
+    {
+        try
+        {
+            m_rfb = std::make_unique<experimental::RfbServer>(*m_screen, std::stoi(port));
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("unable to start rfb server: {}", e.what());
+        }
+    }
+
+    // EGT_INPUT_RECORD=/tmp/session.input
+    auto record = getenv("EGT_INPUT_RECORD");
+    if (record && strlen(record))
+    {
+        try
+        {
+            m_recorder = std::make_unique<detail::InputRecorder>(record);
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("unable to record input: {}", e.what());
+        }
+    }
+
+    // EGT_INPUT_REPLAY=/tmp/session.input
+    auto replay = getenv("EGT_INPUT_REPLAY");
+    if (replay && strlen(replay))
+    {
+        try
+        {
+            auto input = std::make_unique<detail::InputReplay>(*this, replay);
+
+            auto speed = getenv("EGT_INPUT_REPLAY_SPEED");
+            if (speed && strlen(speed))
+                input->speed(std::stof(speed));
+
+            // a replay is a benchmark run: report and quit
+            auto r = input.get();
+            r->on_finished([this, r]()
+            {
+                const auto& stats = r->stats();
+                using std::chrono::duration_cast;
+                using std::chrono::microseconds;
+                using std::chrono::milliseconds;
+                fmt::print("input replay: {} events, {} frames in {} ms, "
+                           "frame time mean {} us p95 {} us max {} us, "
+                           "cpu {} ms, max rss {} kB\n",
+                           stats.events, stats.frames,
+                           duration_cast<milliseconds>(stats.duration).count(),
+                           duration_cast<microseconds>(stats.mean_frame).count(),
+                           duration_cast<microseconds>(stats.p95_frame).count(),
+                           duration_cast<microseconds>(stats.max_frame).count(),
+                           duration_cast<milliseconds>(stats.cpu).count(),
+                           stats.max_rss);
+                quit();
+            });
+
+            r->start();
+            m_inputs.push_back(std::move(input));
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("unable to replay input: {}", e.what());
+        }
+    }
 }
 
 void Application::signal_handler(const asio::error_code& error, int signum)
@@ -367,9 +675,9 @@ void Application::signal_handler(const asio::error_code& error, int signum)
     else if (signum == SIGUSR2)
     {
         if (m_argc)
-            paint_to_file(std::string(m_argv[0]) + ".png");
+            snapshot(std::string(m_argv[0]) + ".png");
         else
-            paint_to_file();
+            snapshot("screen.png");
     }
 
     m_signals.async_wait(std::bind(&Application::signal_handler, this,
@@ -383,6 +691,14 @@ bool Application::is_composer() const
 
 int Application::run()
 {
+    // EGT_HUD=1
+    auto hud = getenv("EGT_HUD");
+    if (hud && strlen(hud) && !m_hud && m_main_window)
+    {
+        m_hud = std::make_unique<experimental::PerfHud>();
+        m_hud->show();
+    }
+
     return m_event.run();
 }
 
@@ -391,19 +707,9 @@ void Application::quit(int exit_value)
     m_event.quit(exit_value);
 }
 
-void Application::paint_to_file(const std::string& filename)
+shared_cairo_surface_t Application::paint_windows()
 {
-#if CAIRO_HAS_PNG_FUNCTIONS == 1
-    auto name = filename;
-    if (name.empty())
-    {
-        name = "screen.png";
-    }
-
-    auto surface = shared_cairo_surface_t(
-                       cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
-                               screen()->size().width(), screen()->size().height()),
-                       cairo_surface_destroy);
+    auto surface = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, screen()->size());
 
     auto cr = shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
 
@@ -419,11 +725,106 @@ void Application::paint_to_file(const std::string& filename)
             w->paint(painter);
     }
 
-    cairo_surface_write_to_png(surface.get(), name.c_str());
-#else
-    detail::ignoreparam(filename);
-    detail::error("png support not available");
-#endif
+    return surface;
+}
+
+shared_cairo_surface_t Application::copy_screen(const Rect& region)
+{
+    const auto rect = Rect::intersection(region, Rect(Point(), m_screen->size()));
+    if (rect.empty())
+        return {};
+
+    // the composition buffer holds the frame, unless windows are on planes,
+    // or the screen draws in its buffers
+    auto source = cairo_get_target(m_screen->context().get());
+    bool composed = !m_screen->zero_copy() &&
+                    cairo_surface_get_type(source) == CAIRO_SURFACE_TYPE_IMAGE &&
+                    (cairo_image_surface_get_format(source) == CAIRO_FORMAT_ARGB32 ||
+                     cairo_image_surface_get_format(source) == CAIRO_FORMAT_RGB24);
+    for (auto& w : windows())
+    {
+        if (w->visible() && w->plane_window())
+            composed = false;
+    }
+
+    shared_cairo_surface_t painted;
+    if (!composed)
+    {
+        painted = paint_windows();
+        source = painted.get();
+    }
+
+    cairo_surface_flush(source);
+    const auto format = cairo_image_surface_get_format(source);
+    auto surface = shared_cairo_surface_t(
+                       cairo_image_surface_create(format, rect.width(), rect.height()),
+                       cairo_surface_destroy);
+
+    const auto src_stride = cairo_image_surface_get_stride(source);
+    const auto dst_stride = cairo_image_surface_get_stride(surface.get());
+    detail::copy_rect(cairo_image_surface_get_data(source) +
+                      rect.y() * src_stride + rect.x() * 4, src_stride,
+                      cairo_image_surface_get_data(surface.get()), dst_stride,
+                      rect.width() * 4, rect.height());
+    cairo_surface_mark_dirty(surface.get());
+    return surface;
+}
+
+EventLoop::WorkHandle Application::snapshot(const std::string& filename,
+        const SnapshotOptions& options,
+        std::function<void(bool ok)> done)
+{
+    // only the copy is done now, the encoding does not hold the event loop
+    const auto region = options.region.empty() ? Rect(Point(), m_screen->size()) : options.region;
+    auto surface = copy_screen(region);
+
+    return m_event.submit([surface, filename, options]()
+    {
+        if (!surface)
+            return false;
+
+        bool ok = false;
+        switch (options.format)
+        {
+        case SnapshotFormat::png:
+            ok = detail::write_png(filename, surface, options.level);
+            break;
+        case SnapshotFormat::eraw:
+            ok = detail::write_eraw(filename, surface, true);
+            break;
+        case SnapshotFormat::eraw_raw:
+            ok = detail::write_eraw(filename, surface, false);
+            break;
+        }
+        return ok;
+    }, [filename, done = std::move(done)](bool ok)
+    {
+        if (!ok)
+            detail::warn("unable to write snapshot {}", filename);
+        if (done)
+            done(ok);
+    }, EventLoop::WorkPriority::low);
+}
+
+EventLoop::WorkHandle Application::snapshot(const std::string& filename,
+        std::function<void(bool ok)> done)
+{
+    return snapshot(filename, SnapshotOptions(), std::move(done));
+}
+
+void Application::paint_to_file(const std::string& filename)
+{
+    auto name = filename;
+    if (name.empty())
+    {
+        name = "screen.png";
+    }
+
+    // written before returning, so it is there even if the application exits
+    auto surface = paint_windows();
+    cairo_surface_flush(surface.get());
+    if (!detail::write_png(name, surface, SnapshotOptions().level))
+        detail::warn("unable to write {}", name);
 }
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
@@ -468,6 +869,21 @@ Application::~Application() noexcept
 {
     Input::global_input().remove_handler(m_handle);
 
+    // a window, so gone while this is still the instance
+    m_hud.reset();
+
+    // prefetches post back to this event loop
+    if (the_app == this)
+    {
+        detail::image_cache().shutdown();
+        experimental::cache_budget().unwatch();
+    }
+
+    // the fonts used this run are preloaded the next one
+    auto manifest = font_manifest();
+    if (manifest && the_app == this && !Font::save_manifest(manifest))
+        detail::warn("unable to save font manifest {}", manifest);
+
     if (the_app == this)
         the_app = nullptr;
 }
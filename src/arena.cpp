@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+ArenaBlocks::ArenaBlocks(size_t block_size)
+    : m_block_size(std::max<size_t>(block_size, 64))
+{}
+
+void* ArenaBlocks::allocate(size_t size, size_t align)
+{
+    if (!size)
+        size = 1;
+
+    auto p = m_blocks.empty() ? 0 : reinterpret_cast<uintptr_t>(m_blocks.back().get()) + m_offset;
+    auto padding = (align - p % align) % align;
+    if (m_blocks.empty() || m_offset + padding + size > m_block_capacity)
+    {
+        add_block(size, align);
+        p = reinterpret_cast<uintptr_t>(m_blocks.back().get());
+        padding = (align - p % align) % align;
+    }
+
+    m_offset += padding + size;
+    bytes += size;
+    ++allocations;
+    ++total_allocations;
+    return reinterpret_cast<void*>(p + padding);
+}
+
+void ArenaBlocks::deallocate(void*, size_t size) noexcept
+{
+    bytes -= size;
+    if (--allocations)
+        return;
+
+    // everything is released: keep the first block to carve the next ones from
+    if (m_blocks.size() > 1)
+        m_blocks.resize(1);
+    m_block_capacity = reserved = m_blocks.empty() ? 0 : m_block_size;
+    m_offset = 0;
+}
+
+void ArenaBlocks::add_block(size_t size, size_t align)
+{
+    // a large allocation gets a block of its own, and the first block, which
+    // is kept, always has the usual size
+    auto capacity = std::max(m_block_size, size + align);
+    if (m_blocks.empty() && capacity != m_block_size)
+    {
+        m_blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[m_block_size]));
+        reserved += m_block_size;
+    }
+
+    m_blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[capacity]));
+    m_block_capacity = capacity;
+    m_offset = 0;
+    reserved += capacity;
+}
+
+}
+
+namespace experimental
+{
+
+Arena::Arena(size_t block_size)
+    : m_blocks(std::make_shared<detail::ArenaBlocks>(block_size))
+{}
+
+Arena::Stats Arena::stats() const
+{
+    Stats result;
+    result.bytes = m_blocks->bytes;
+    result.allocations = m_blocks->allocations;
+    result.total_allocations = m_blocks->total_allocations;
+    result.reserved = m_blocks->reserved;
+    return result;
+}
+
+}
+}
+}
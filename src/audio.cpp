@@ -11,10 +11,16 @@
 #include "egt/detail/meta.h"
 #include "egt/respath.h"
 #include "egt/video.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <gst/gst.h>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
 #include <sstream>
-#include <thread>
 
 namespace egt
 {
@@ -57,14 +63,29 @@ struct AudioPlayerImpl
     AudioPlayer& player;
     GstElement* m_pipeline {nullptr};
     GstElement* m_volume {nullptr};
+    GstElement* m_queue {nullptr};
     gint64 m_position {0};
     gint64 m_duration {0};
-    std::string m_uri;
+    std::chrono::milliseconds m_buffer {500};
+    std::chrono::milliseconds m_latency {0};
+    /// Playlist, as given by the user and resolved for GStreamer.
+    std::vector<std::string> m_playlist;
+    std::vector<std::string> m_uris;
+    size_t m_track {0};
+    /// The next track was queued by about-to-finish, but is not playing yet.
+    bool m_next_pending {false};
+    mutable std::mutex m_playlist_mutex;
     int m_volume_value {100};
-    GMainLoop* m_gmain_loop {nullptr};
-    std::thread m_gmain_thread;
+    std::shared_ptr<detail::GstMainLoop> m_gmain_loop;
+    guint m_bus_watchid {0};
     guint m_eventsource_id {0};
     bool m_no_events{false};
+    /// Underruns of the queue while playing, counted by the streaming thread.
+    std::atomic<uint64_t> m_underruns {0};
+    /// The queue was flushed, so it is expected to run out once.
+    std::atomic<bool> m_flushed {true};
+    /// The sink thread got a real-time priority.
+    std::atomic<bool> m_realtime {false};
 };
 
 }
@@ -98,6 +119,117 @@ static gboolean query_position(gpointer data)
     return true;
 }
 
+/*
+ * Called by playbin from a streaming thread when the current track is about
+ * to end, so the next one is decoded in time to follow it without gap.
+ */
+static void about_to_finish(GstElement* playbin, gpointer data)
+{
+    auto impl = static_cast<detail::AudioPlayerImpl*>(data);
+
+    std::lock_guard<std::mutex> lock(impl->m_playlist_mutex);
+    if (!impl->m_next_pending && impl->m_track + 1 < impl->m_uris.size())
+    {
+        impl->m_next_pending = true;
+        g_object_set(playbin, "uri", impl->m_uris[impl->m_track + 1].c_str(), nullptr);
+    }
+}
+
+/*
+ * Called when autoaudiosink creates the actual sink, to set its latency.
+ */
+static void audio_sink_added(GstBin* bin, GstElement* element, gpointer data)
+{
+    detail::ignoreparam(bin);
+
+    auto impl = static_cast<detail::AudioPlayerImpl*>(data);
+    if (impl->m_latency.count() <= 0)
+        return;
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(element), "buffer-time"))
+    {
+        const gint64 buffer_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(impl->m_latency).count();
+        const gint64 latency_time = std::min<gint64>(buffer_time / 2, 10000);
+        g_object_set(element,
+                     "buffer-time", buffer_time,
+                     "latency-time", latency_time,
+                     nullptr);
+    }
+}
+
+/// Longest buffer the player grows to after underruns.
+static constexpr std::chrono::milliseconds MAX_BUFFER{4000};
+
+/*
+ * Called by the queue, from the streaming thread, when the decoded audio ran
+ * out.  Unless the queue was just flushed, this is a gap heard.
+ */
+static void queue_underrun(GstElement* queue, gpointer data)
+{
+    detail::ignoreparam(queue);
+
+    auto impl = static_cast<detail::AudioPlayerImpl*>(data);
+    if (impl->m_flushed.exchange(false))
+        return;
+
+    if (GST_STATE(impl->m_pipeline) != GST_STATE_PLAYING)
+        return;
+
+    ++impl->m_underruns;
+    EGTLOG_DEBUG("audio player underrun");
+
+    if (Application::check_instance())
+    {
+        asio::post(Application::instance().event().io(), [impl]()
+        {
+            const auto buffer = impl->player.buffer();
+            if (buffer < MAX_BUFFER)
+                impl->player.buffer(std::min(2 * buffer, MAX_BUFFER));
+        });
+    }
+}
+
+/*
+ * Called synchronously from the thread of the audio sink when it starts,
+ * to give it a real-time priority.  Best effort, like for Sound.
+ */
+static GstBusSyncReply bus_sync_handler(GstBus* bus, GstMessage* message, gpointer data)
+{
+    detail::ignoreparam(bus);
+
+    if (GST_MESSAGE_TYPE(message) != GST_MESSAGE_STREAM_STATUS)
+        return GST_BUS_PASS;
+
+    GstStreamStatusType type;
+    GstElement* owner = nullptr;
+    gst_message_parse_stream_status(message, &type, &owner);
+
+    // only audio sinks have a buffer-time
+    if (type != GST_STREAM_STATUS_TYPE_ENTER || !owner ||
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        !g_object_class_find_property(G_OBJECT_GET_CLASS(owner), "buffer-time"))
+        return GST_BUS_PASS;
+
+    int priority = sched_get_priority_min(SCHED_FIFO);
+    const auto value = std::getenv("EGT_AUDIO_PRIORITY");
+    if (value && strlen(value))
+        priority = std::atoi(value);
+
+    if (priority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+            EGTLOG_DEBUG("audio sink running without real-time priority");
+        else
+            static_cast<detail::AudioPlayerImpl*>(data)->m_realtime = true;
+    }
+
+    return GST_BUS_PASS;
+}
+
 static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data)
 {
     detail::ignoreparam(bus);
@@ -159,6 +291,7 @@ static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data)
     }
     case GST_MESSAGE_EOS:
     {
+        impl->m_flushed = true;
         gst_element_seek(impl->m_pipeline, 1.0, GST_FORMAT_TIME,
                          GST_SEEK_FLAG_FLUSH,
                          GST_SEEK_TYPE_SET, 0,
@@ -178,6 +311,31 @@ static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data)
 
         break;
     }
+    case GST_MESSAGE_STREAM_START:
+    {
+        bool changed = false;
+        {
+            std::lock_guard<std::mutex> lock(impl->m_playlist_mutex);
+            if (impl->m_next_pending)
+            {
+                impl->m_next_pending = false;
+                impl->m_track++;
+                changed = true;
+            }
+        }
+
+        if (changed && !impl->m_no_events)
+        {
+            if (Application::check_instance())
+            {
+                asio::post(Application::instance().event().io(), [impl]()
+                {
+                    impl->player.on_track_changed.invoke();
+                });
+            }
+        }
+        break;
+    }
     case GST_MESSAGE_STATE_CHANGED:
     {
         GstState old_state;
@@ -258,28 +416,35 @@ void AudioPlayer::destroyPipeline()
         m_impl->m_volume = nullptr;
     }
 
+    if (m_impl->m_queue)
+    {
+        g_object_unref(m_impl->m_queue);
+        m_impl->m_queue = nullptr;
+    }
+
     if (m_impl->m_pipeline)
     {
         g_object_unref(m_impl->m_pipeline);
         m_impl->m_pipeline = nullptr;
     }
 
+    if (m_impl->m_bus_watchid > 0)
+    {
+        g_source_remove(m_impl->m_bus_watchid);
+        m_impl->m_bus_watchid = 0;
+    }
+
     if (m_impl->m_eventsource_id > 0)
     {
         g_source_remove(m_impl->m_eventsource_id);
+        m_impl->m_eventsource_id = 0;
     }
 
     if (m_impl->m_gmain_loop)
     {
-        // check loop is running to avoid race condition when stop is called too early
-        if (g_main_loop_is_running(m_impl->m_gmain_loop))
-        {
-            //stop loop and wait
-            g_main_loop_quit(m_impl->m_gmain_loop);
-        }
-        m_impl->m_gmain_thread.join();
-        g_main_loop_unref(m_impl->m_gmain_loop);
-        m_impl->m_gmain_loop = nullptr;
+        // the loop is shared, only wait for our callbacks to be done
+        m_impl->m_gmain_loop->sync();
+        m_impl->m_gmain_loop.reset();
     }
 }
 
@@ -304,39 +469,157 @@ bool AudioPlayer::null()
     return m_impl->change_state(this, GST_STATE_NULL);
 }
 
+/// Resolve a uri for GStreamer.
+static std::string resolve_uri(const std::string& uri)
+{
+    if (uri.empty())
+    {
+        throw std::runtime_error("invalid uri");
+    }
+
+    std::string path;
+    auto type = detail::resolve_path(uri, path);
+    switch (type)
+    {
+    case detail::SchemeType::filesystem:
+        return std::string("file://") + path;
+    case detail::SchemeType::network:
+        return uri;
+    default:
+        throw std::runtime_error("unsupported uri: " + uri);
+    }
+}
+
 bool AudioPlayer::media(const std::string& uri)
 {
-    bool result = false;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+        if (m_impl->m_playlist.size() == 1 && m_impl->m_playlist.front() == uri)
+            return false;
+    }
 
-    if (uri.empty())
+    return playlist({uri});
+}
+
+bool AudioPlayer::playlist(const std::vector<std::string>& uris)
+{
+    if (uris.empty())
     {
         throw std::runtime_error("invalid uri");
     }
 
-    if (detail::change_if_diff(m_impl->m_uri, uri))
+    std::vector<std::string> resolved;
+    resolved.reserve(uris.size());
+    for (const auto& uri : uris)
+        resolved.push_back(resolve_uri(uri));
+
     {
-        std::string path;
-        auto type = detail::resolve_path(uri, path);
-        switch (type)
-        {
-        case detail::SchemeType::filesystem:
-        {
-            result = createPipeline(std::string("file://") + path);
-            break;
-        }
-        case detail::SchemeType::network:
-        {
-            result = createPipeline(uri);
-            break;
-        }
-        default:
+        std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+        m_impl->m_playlist = uris;
+        m_impl->m_uris = resolved;
+        m_impl->m_track = 0;
+    }
+
+    return createPipeline(resolved.front());
+}
+
+std::vector<std::string> AudioPlayer::playlist() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+    return m_impl->m_playlist;
+}
+
+void AudioPlayer::enqueue(const std::string& uri)
+{
+    auto resolved = resolve_uri(uri);
+
+    std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+    m_impl->m_playlist.push_back(uri);
+    m_impl->m_uris.push_back(std::move(resolved));
+}
+
+size_t AudioPlayer::track() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+    return m_impl->m_track;
+}
+
+bool AudioPlayer::next()
+{
+    std::string uri;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+        if (m_impl->m_track + 1 >= m_impl->m_uris.size())
+            return false;
+
+        m_impl->m_track++;
+        uri = m_impl->m_uris[m_impl->m_track];
+    }
+
+    const auto was_playing = playing();
+    if (!createPipeline(uri))
+        return false;
+
+    on_track_changed.invoke();
+
+    return was_playing ? play() : true;
+}
+
+void AudioPlayer::buffer(std::chrono::milliseconds duration)
+{
+    m_impl->m_buffer = duration;
+
+    if (m_impl->m_queue)
+    {
+        const guint64 time =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        g_object_set(m_impl->m_queue, "max-size-time", time, nullptr);
+    }
+}
+
+std::chrono::milliseconds AudioPlayer::buffer() const
+{
+    return m_impl->m_buffer;
+}
+
+void AudioPlayer::latency(std::chrono::milliseconds latency)
+{
+    m_impl->m_latency = latency;
+}
+
+std::chrono::milliseconds AudioPlayer::latency() const
+{
+    return m_impl->m_latency;
+}
+
+AudioPlayerStats AudioPlayer::stats() const
+{
+    AudioPlayerStats stats;
+    stats.underruns = m_impl->m_underruns;
+    stats.realtime = m_impl->m_realtime;
+
+    if (m_impl->m_queue)
+    {
+        guint64 level = 0;
+        g_object_get(m_impl->m_queue, "current-level-time", &level, nullptr);
+        stats.fill = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::nanoseconds(level));
+    }
+
+    if (m_impl->m_pipeline)
+    {
+        GstQuery* query = gst_query_new_latency();
+        if (gst_element_query(m_impl->m_pipeline, query))
         {
-            throw std::runtime_error("unsupported uri: " + uri);
-        }
+            GstClockTime min_latency = 0;
+            gst_query_parse_latency(query, nullptr, &min_latency, nullptr);
+            stats.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::nanoseconds(min_latency));
         }
+        gst_query_unref(query);
     }
 
-    return result;
+    return stats;
 }
 
 bool AudioPlayer::volume(int volume)
@@ -409,6 +692,7 @@ bool AudioPlayer::seek(uint64_t pos)
 {
     if (m_impl->m_pipeline)
     {
+        m_impl->m_flushed = true;
         if (gst_element_seek(m_impl->m_pipeline, 1.0, GST_FORMAT_TIME,
                              GST_SEEK_FLAG_FLUSH,
                              GST_SEEK_TYPE_SET, sec_to_nsec(pos),
@@ -423,16 +707,36 @@ bool AudioPlayer::seek(uint64_t pos)
 
 bool AudioPlayer::createPipeline(const std::string& uri)
 {
-    // Make sure we don't leave orphan references
-    destroyPipeline();
+    if (m_impl->m_pipeline)
+    {
+        /*
+         * Changing the uri of playbin only needs it to be stopped, so the
+         * pipeline and its thread are kept from one media to the other.
+         */
+        (void)gst_element_set_state(m_impl->m_pipeline, GST_STATE_NULL);
+        {
+            std::lock_guard<std::mutex> lock(m_impl->m_playlist_mutex);
+            m_impl->m_next_pending = false;
+        }
+        g_object_set(m_impl->m_pipeline, "uri", uri.c_str(), nullptr);
+        m_impl->m_flushed = true;
+        m_impl->m_position = 0;
+        m_impl->m_duration = 0;
+        return true;
+    }
 
-    const auto pipeline = fmt::format("uridecodebin uri={} expose-all-streams=false caps=audio/x-raw " \
-                                      "! audioconvert ! volume name=volume ! autoaudiosink", uri);
+    /*
+     * The queue holds decoded audio ahead of the sink, so that playback goes
+     * on while the decoder is starved of CPU.
+     */
+    const auto sink = fmt::format("queue name=queue max-size-buffers=0 max-size-bytes=0 " \
+                                  "max-size-time={} ! audioconvert ! volume name=volume ! " \
+                                  "autoaudiosink name=sink",
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(m_impl->m_buffer).count());
 
-    EGTLOG_DEBUG(pipeline);
+    EGTLOG_DEBUG("playbin uri={} audio-sink={}", uri, sink);
 
-    GError* error = nullptr;
-    m_impl->m_pipeline = gst_parse_launch(pipeline.c_str(), &error);
+    m_impl->m_pipeline = gst_element_factory_make("playbin", nullptr);
     if (!m_impl->m_pipeline)
     {
         detail::error("failed to create audio pipeline");
@@ -440,8 +744,27 @@ bool AudioPlayer::createPipeline(const std::string& uri)
         return false;
     }
 
+    GError* error = nullptr;
+    GstElement* bin = gst_parse_bin_from_description(sink.c_str(), TRUE, &error);
+    detail::GstErrorHandle error_handle(error);
+    if (!bin)
+    {
+        detail::error("failed to create audio sink: {}", error ? error->message : "");
+        on_error.invoke("failed to create audio pipeline");
+        gst_object_unref(m_impl->m_pipeline);
+        m_impl->m_pipeline = nullptr;
+        return false;
+    }
+
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
-    m_impl->m_volume = gst_bin_get_by_name(GST_BIN(m_impl->m_pipeline), "volume");
+    gst_util_set_object_arg(G_OBJECT(m_impl->m_pipeline), "flags", "audio");
+    g_object_set(m_impl->m_pipeline,
+                 "uri", uri.c_str(),
+                 "audio-sink", bin,
+                 nullptr);
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    m_impl->m_volume = gst_bin_get_by_name(GST_BIN(bin), "volume");
     if (!m_impl->m_volume)
     {
         detail::error("failed to get volume element");
@@ -449,18 +772,31 @@ bool AudioPlayer::createPipeline(const std::string& uri)
         return false;
     }
 
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    m_impl->m_queue = gst_bin_get_by_name(GST_BIN(bin), "queue");
+    if (m_impl->m_queue)
+        g_signal_connect(m_impl->m_queue, "underrun", G_CALLBACK(queue_underrun), m_impl.get());
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    GstElement* audiosink = gst_bin_get_by_name(GST_BIN(bin), "sink");
+    if (audiosink)
+    {
+        g_signal_connect(audiosink, "element-added", G_CALLBACK(audio_sink_added), m_impl.get());
+        gst_object_unref(audiosink);
+    }
+
+    g_signal_connect(m_impl->m_pipeline, "about-to-finish", G_CALLBACK(about_to_finish), m_impl.get());
+
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
     GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(m_impl->m_pipeline));
-    gst_bus_add_watch(bus, &bus_callback, m_impl.get());
+    m_impl->m_bus_watchid = gst_bus_add_watch(bus, &bus_callback, m_impl.get());
+    gst_bus_set_sync_handler(bus, &bus_sync_handler, m_impl.get(), nullptr);
     gst_object_unref(bus);
 
     m_impl->m_eventsource_id = g_timeout_add(900, &query_position, m_impl.get());
 
     if (!m_impl->m_gmain_loop)
-    {
-        m_impl->m_gmain_loop = g_main_loop_new(nullptr, FALSE);
-        m_impl->m_gmain_thread = std::thread(g_main_loop_run, m_impl->m_gmain_loop);
-    }
+        m_impl->m_gmain_loop = detail::GstMainLoop::get();
 
     return true;
 }
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/app.h"
+#include "egt/binding.h"
+#include "egt/eventloop.h"
+#include "egt/updatechannel.h"
+#include <algorithm>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Propagates the dirty nodes, once per frame.
+ *
+ * The flush is an update of the event loop, so it runs right before the
+ * next frame with the frame clock, and all the widgets it changes are
+ * damaged before that frame is drawn.
+ */
+class BindingScheduler
+{
+public:
+
+    static BindingScheduler& instance()
+    {
+        static const std::unique_ptr<BindingScheduler> i(new BindingScheduler());
+        return *i;
+    }
+
+    /// Add a dirty node to the next flush.
+    void schedule(BindingNode* node)
+    {
+        // a node changed again after it was propagated, i.e. by a cycle of
+        // handlers, waits for the next flush
+        if (m_flushing && node->m_flushed == m_generation)
+        {
+            m_next.push_back(node);
+            return;
+        }
+
+        push(node);
+        if (!m_flushing)
+            queue();
+    }
+
+    /// Remove a node being destroyed.
+    void remove(BindingNode* node)
+    {
+        for (auto& pending : m_pending)
+        {
+            if (pending.node == node)
+                pending.node = nullptr;
+        }
+
+        m_next.erase(std::remove(m_next.begin(), m_next.end(), node), m_next.end());
+    }
+
+private:
+
+    struct Flush : public UpdateState
+    {
+        void apply() override
+        {
+            BindingScheduler::instance().flush();
+        }
+    };
+
+    struct Pending
+    {
+        uint32_t depth;
+        uint64_t order;
+        BindingNode* node;
+    };
+
+    /// Order of the heap, so the first node is the least deep, then the first dirty.
+    static bool after(const Pending& lhs, const Pending& rhs)
+    {
+        if (lhs.depth != rhs.depth)
+            return lhs.depth > rhs.depth;
+        return lhs.order > rhs.order;
+    }
+
+    void push(BindingNode* node)
+    {
+        m_pending.push_back({node->m_depth, ++m_order, node});
+        std::push_heap(m_pending.begin(), m_pending.end(), after);
+    }
+
+    void queue()
+    {
+        if (!Application::check_instance())
+        {
+            flush();
+            return;
+        }
+
+        // dropped with the event loop of a previous Application otherwise
+        if (!m_flush.expired())
+            return;
+
+        auto flush = std::make_shared<Flush>();
+        m_flush = flush;
+        Application::instance().event().queue_update(flush);
+    }
+
+    void flush()
+    {
+        m_flush.reset();
+        m_flushing = true;
+        ++m_generation;
+
+        while (!m_pending.empty())
+        {
+            std::pop_heap(m_pending.begin(), m_pending.end(), after);
+            auto node = m_pending.back().node;
+            m_pending.pop_back();
+            if (!node)
+                continue;
+
+            node->m_dirty = false;
+            node->m_flushed = m_generation;
+            node->propagate();
+        }
+
+        m_flushing = false;
+
+        if (!m_next.empty())
+        {
+            for (auto node : m_next)
+                push(node);
+            m_next.clear();
+
+            // without an event loop to pace them, they wait for the next set
+            if (Application::check_instance())
+                queue();
+        }
+    }
+
+    /// Heap of the dirty nodes.
+    std::vector<Pending> m_pending;
+    /// Nodes dirty again in the flush they were propagated in.
+    std::vector<BindingNode*> m_next;
+    /// Flush queued in the event loop.
+    std::weak_ptr<Flush> m_flush;
+    uint64_t m_order{0};
+    uint64_t m_generation{0};
+    bool m_flushing{false};
+};
+
+void BindingNode::depends(BindingNode& source)
+{
+    m_sources.push_back(&source);
+    source.m_dependents.push_back(this);
+    m_depth = std::max(m_depth, source.m_depth + 1);
+}
+
+void BindingNode::invalidate()
+{
+    if (m_dirty)
+        return;
+
+    m_dirty = true;
+    BindingScheduler::instance().schedule(this);
+}
+
+void BindingNode::invalidate_dependents()
+{
+    for (auto dependent : m_dependents)
+        dependent->invalidate();
+}
+
+BindingNode::~BindingNode() noexcept
+{
+    if (m_dirty)
+        BindingScheduler::instance().remove(this);
+
+    for (auto source : m_sources)
+    {
+        auto& dependents = source->m_dependents;
+        dependents.erase(std::remove(dependents.begin(), dependents.end(), this),
+                         dependents.end());
+    }
+
+    for (auto dependent : m_dependents)
+    {
+        auto& sources = dependent->m_sources;
+        sources.erase(std::remove(sources.begin(), sources.end(), this),
+                      sources.end());
+    }
+}
+
+}
+}
+}
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/statecache.h"
 #include "detail/utf8text.h"
 #include "egt/app.h"
 #include "egt/button.h"
@@ -60,6 +61,7 @@ void Button::default_size(const Size& size)
         unregister_handler();
 
     default_button_size_value = size;
+    Widget::invalidate_all_size_hints();
 }
 
 AlignFlags Button::default_text_align()
@@ -81,7 +83,7 @@ Button::Button(const std::string& text,
                const AlignFlags& text_align) noexcept
     : TextWidget(text, rect, text_align)
 {
-    name("Button" + std::to_string(m_widgetid));
+    default_name("Button", m_widgetid);
 
     fill_flags(Theme::FillFlag::blend);
     border_radius(4.0);
@@ -138,22 +140,65 @@ void Button::text(const std::string& text)
 {
     if (detail::change_if_diff<>(m_text, text))
     {
+        invalidate_text_index();
         on_text_changed.invoke();
         damage();
         layout();
     }
 }
 
+Button::Button(Button&&) noexcept = default;
+Button& Button::operator=(Button&&) noexcept = default;
+
 void Button::draw(Painter& painter, const Rect& rect)
 {
+    if (draw_state(painter, rect))
+        return;
+
     Drawer<Button>::draw(*this, painter, rect);
 }
 
+void Button::cache_states(bool value)
+{
+    if (value == cache_states())
+        return;
+
+    if (value)
+        m_state_cache = std::make_unique<detail::StateCache>();
+    else
+        m_state_cache.reset();
+}
+
+bool Button::draw_state(Painter& painter, const Rect& rect)
+{
+    if (!m_state_cache || m_state_cache->rendering())
+        return false;
+
+    m_state_cache->draw(*this, painter, rect);
+    return true;
+}
+
+void Button::damage(const Rect& rect)
+{
+    if (m_state_cache && !m_state_damage)
+        m_state_cache->invalidate();
+
+    TextWidget::damage(rect);
+}
+
+void Button::damage_state()
+{
+    m_state_damage = true;
+    TextWidget::damage_state();
+    m_state_damage = false;
+}
+
 void Button::default_draw(const Button& widget, Painter& painter, const Rect& /*rect*/)
 {
     widget.draw_box(painter, Palette::ColorId::button_bg, Palette::ColorId::border);
 
     detail::draw_text(painter,
+                      widget.text_run(),
                       widget.content_area(),
                       widget.text(),
                       widget.font(),
@@ -178,7 +223,7 @@ void Button::checked(bool value)
         /* Check if the button group has not canceled the change. */
         if (flags().is_set(Widget::Flag::checked) == value)
         {
-            damage();
+            damage_state();
             on_checked_changed.invoke();
         }
     }
@@ -228,7 +273,7 @@ Switch::Switch(const std::string& text,
                const Rect& rect) noexcept
     : Button(text, rect)
 {
-    name("Switch" + std::to_string(m_widgetid));
+    default_name("Switch", m_widgetid);
 
     fill_flags().clear();
     padding(5);
@@ -287,6 +332,9 @@ void Switch::deserialize(Serializer::Properties& props)
 
 void Switch::draw(Painter& painter, const Rect& rect)
 {
+    if (draw_state(painter, rect))
+        return;
+
     Drawer<Switch>::draw(*this, painter, rect);
 }
 
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/procfile.h"
+#include "egt/app.h"
+#include "egt/cachebudget.h"
+#include "egt/detail/imagecache.h"
+#include "egt/detail/surfacepool.h"
+#include "egt/eventloop.h"
+#include "egt/font.h"
+#include "egt/timer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <egt/asio.hpp>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+/// Memory stall, in microseconds per window, reported as pressure.
+static constexpr const char* PSI_TRIGGER = "some 200000 2000000";
+
+/// Interval of trimming the caches to the budget.
+static constexpr std::chrono::milliseconds ENFORCE_INTERVAL{1000};
+
+constexpr std::chrono::milliseconds CacheBudget::ESCALATION_WINDOW;
+
+struct CacheBudget::Watcher
+{
+    explicit Watcher(asio::io_context& io)
+        : descriptor(io)
+    {}
+
+    /// PSI trigger, or cgroup memory.events, notified with POLLPRI.
+    asio::posix::stream_descriptor descriptor;
+    /// memory.events of the cgroup, read again on each notification.
+    std::unique_ptr<detail::ProcFile> events;
+    uint64_t high{0};
+    uint64_t max{0};
+    /// Trims the caches to the budget, while there is one.
+    std::unique_ptr<PeriodicTimer> enforcer;
+};
+
+/// Open a PSI trigger on the memory stall of the system.
+static int open_psi()
+{
+    const auto fd = ::open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        EGTLOG_DEBUG("no memory pressure stall information: {}", strerror(errno));
+        return -1;
+    }
+
+    if (::write(fd, PSI_TRIGGER, strlen(PSI_TRIGGER) + 1) < 0)
+    {
+        EGTLOG_DEBUG("unable to set memory pressure trigger: {}", strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/// Get the path of memory.events of the cgroup v2 of the process, or empty.
+static std::string cgroup_events()
+{
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // the unified hierarchy is "0::/path"
+        if (line.compare(0, 3, "0::") == 0)
+        {
+            auto path = "/sys/fs/cgroup" + line.substr(3);
+            if (path.back() != '/')
+                path += '/';
+            return path + "memory.events";
+        }
+    }
+    return {};
+}
+
+/// Read the high and max counters of memory.events.
+static void read_events(detail::ProcFile& file, uint64_t& high, uint64_t& max)
+{
+    const auto text = file.read();
+    detail::parse_field(text, "high", high);
+    detail::parse_field(text, "max", max);
+}
+
+CacheBudget::CacheBudget()
+{
+    const auto value = std::getenv("EGT_CACHE_BUDGET");
+    if (value && strlen(value))
+        m_budget = std::strtoull(value, nullptr, 10);
+
+    add("surface pool", Priority::surfaces,
+        []() { return detail::surface_pool().idle_bytes(); },
+        [](size_t bytes) { detail::surface_pool().trim(bytes); });
+    add("images", Priority::images,
+        []() { return detail::image_cache().bytes(); },
+        [](size_t bytes) { detail::image_cache().trim(bytes); });
+    add("fonts", Priority::fonts,
+        []() { return Font::font_cache_bytes(); },
+        [](size_t bytes) { Font::trim_font_cache(bytes); });
+}
+
+CacheBudget::Handle CacheBudget::add(const std::string& name, Priority priority,
+                                     BytesCallback bytes, TrimCallback trim)
+{
+    m_caches.push_back({++m_handle, name, priority, std::move(bytes), std::move(trim)});
+    return m_handle;
+}
+
+void CacheBudget::remove(Handle handle)
+{
+    m_caches.erase(std::remove_if(m_caches.begin(), m_caches.end(),
+                                  [handle](const Cache & cache) { return cache.handle == handle; }),
+                   m_caches.end());
+}
+
+void CacheBudget::budget(size_t bytes)
+{
+    m_budget = bytes;
+
+    if (m_watcher && m_watcher->enforcer)
+    {
+        if (m_budget)
+            m_watcher->enforcer->start();
+        else
+            m_watcher->enforcer->cancel();
+    }
+
+    enforce();
+}
+
+size_t CacheBudget::bytes() const
+{
+    size_t total = 0;
+    for (const auto& cache : m_caches)
+        total += cache.bytes();
+    return total;
+}
+
+std::vector<CacheBudget::Usage> CacheBudget::usage() const
+{
+    std::vector<Usage> result;
+    result.reserve(m_caches.size());
+    for (const auto& cache : m_caches)
+        result.push_back({cache.name, cache.priority, cache.bytes()});
+    return result;
+}
+
+size_t CacheBudget::trim(Priority priority, size_t bytes)
+{
+    size_t freed = 0;
+    for (auto& cache : m_caches)
+    {
+        if (cache.priority != priority)
+            continue;
+
+        const auto before = cache.bytes();
+        if (before <= bytes)
+            continue;
+
+        cache.trim(bytes);
+        const auto after = cache.bytes();
+        if (after < before)
+            freed += before - after;
+    }
+    return freed;
+}
+
+size_t CacheBudget::enforce()
+{
+    if (!m_budget)
+        return 0;
+
+    auto total = bytes();
+    if (total <= m_budget)
+        return 0;
+
+    size_t freed = 0;
+    for (auto priority : {Priority::surfaces, Priority::images, Priority::fonts})
+    {
+        // each cache of the priority gives up its share of the excess
+        for (auto& cache : m_caches)
+        {
+            if (cache.priority != priority || total <= m_budget)
+                continue;
+
+            const auto before = cache.bytes();
+            const auto excess = total - m_budget;
+            cache.trim(before > excess ? before - excess : 0);
+            const auto after = cache.bytes();
+            if (after < before)
+            {
+                freed += before - after;
+                total -= before - after;
+            }
+        }
+    }
+
+    if (freed)
+        EGTLOG_DEBUG("cache budget {} bytes: freed {} bytes", m_budget, freed);
+    return freed;
+}
+
+size_t CacheBudget::purge(Priority priority)
+{
+    size_t freed = 0;
+    for (auto p : {Priority::surfaces, Priority::images, Priority::fonts})
+    {
+        if (p > priority)
+            break;
+        freed += trim(p, 0);
+    }
+    return freed;
+}
+
+void CacheBudget::pressure()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const bool escalate = m_last_pressure.time_since_epoch().count() &&
+                          now - m_last_pressure < ESCALATION_WINDOW;
+    if (!escalate)
+        m_level = Priority::surfaces;
+    else if (m_level == Priority::surfaces)
+        m_level = Priority::images;
+    else
+        m_level = Priority::fonts;
+    m_last_pressure = now;
+
+    const auto freed = purge(m_level);
+    detail::info("memory pressure: freed {} bytes of caches", freed);
+
+    on_pressure.invoke(m_level);
+}
+
+bool CacheBudget::watch()
+{
+    if (m_watcher)
+        return watching();
+
+    m_watcher = std::make_unique<Watcher>(Application::instance().event().io());
+
+    m_watcher->enforcer = std::make_unique<PeriodicTimer>(ENFORCE_INTERVAL);
+    m_watcher->enforcer->on_timeout([this]() { enforce(); });
+    if (m_budget)
+        m_watcher->enforcer->start();
+
+    auto fd = open_psi();
+    if (fd < 0)
+    {
+        const auto path = cgroup_events();
+        if (!path.empty())
+        {
+            auto events = std::make_unique<detail::ProcFile>(path);
+            if (events->is_open())
+            {
+                fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd >= 0)
+                {
+                    read_events(*events, m_watcher->high, m_watcher->max);
+                    m_watcher->events = std::move(events);
+                    EGTLOG_DEBUG("memory pressure from {}", path);
+                }
+            }
+        }
+    }
+    else
+    {
+        EGTLOG_DEBUG("memory pressure from /proc/pressure/memory");
+    }
+
+    if (fd < 0)
+        return false;
+
+    m_watcher->descriptor.assign(fd);
+    wait();
+    return true;
+}
+
+void CacheBudget::wait()
+{
+    m_watcher->descriptor.async_wait(asio::posix::stream_descriptor::wait_error,
+                                     [this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        auto& watcher = *m_watcher;
+        if (watcher.events)
+        {
+            // memory.events changes for other counters too
+            const auto high = watcher.high;
+            const auto max = watcher.max;
+            read_events(*watcher.events, watcher.high, watcher.max);
+            if (watcher.high != high || watcher.max != max)
+                pressure();
+        }
+        else
+        {
+            pressure();
+        }
+
+        wait();
+    });
+}
+
+void CacheBudget::unwatch()
+{
+    m_watcher.reset();
+}
+
+bool CacheBudget::watching() const
+{
+    return m_watcher && m_watcher->descriptor.is_open();
+}
+
+CacheBudget::~CacheBudget() noexcept = default;
+
+CacheBudget& cache_budget()
+{
+    static CacheBudget budget;
+    return budget;
+}
+
+}
+}
+}
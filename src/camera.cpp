@@ -3,15 +3,63 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "egt/camera.h"
+#ifdef HAVE_GSTREAMER
 #include "detail/camera/gstcameraimpl.h"
+#endif
+#ifdef HAVE_LINUX_VIDEODEV2_H
+#include "detail/camera/v4l2cameraimpl.h"
+#endif
 #include "egt/video.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
 
 namespace egt
 {
 inline namespace v1
 {
 
+namespace detail
+{
+
+// shared with VideoWindow, which is only built along with the camera
+WindowHint check_windowhint(WindowHint& hint)
+{
+    if (hint == WindowHint::cursor_overlay)
+    {
+        throw std::runtime_error("Cannot create Videowindow with cursor_overlay hint");
+    }
+    return hint;
+}
+
+}
+
+/**
+ * Create the backend of a camera.
+ *
+ * GStreamer is used when available, unless the EGT_CAMERA_BACKEND
+ * environment variable is "v4l2".
+ */
+static std::unique_ptr<detail::CameraImpl> create_camera(CameraWindow& window,
+        const Rect& rect, const std::string& device)
+{
+#if defined(HAVE_GSTREAMER) && defined(HAVE_LINUX_VIDEODEV2_H)
+    const auto backend = std::getenv("EGT_CAMERA_BACKEND");
+    if (backend && !strcmp(backend, "v4l2"))
+        return std::make_unique<detail::V4l2CameraImpl>(window, rect, device);
+    return std::make_unique<detail::GstCameraImpl>(window, rect, device);
+#elif defined(HAVE_GSTREAMER)
+    return std::make_unique<detail::GstCameraImpl>(window, rect, device);
+#else
+    return std::make_unique<detail::V4l2CameraImpl>(window, rect, device);
+#endif
+}
+
 CameraWindow::CameraWindow(const std::string& device,
                            PixelFormat format_hint,
                            WindowHint hint)
@@ -23,12 +71,12 @@ CameraWindow::CameraWindow(const Rect& rect,
                            PixelFormat format_hint,
                            WindowHint hint)
     : Window(rect, format_hint, detail::check_windowhint(hint)),
-      m_camera_impl(std::make_unique<detail::CameraImpl>(*this, rect, device))
+      m_camera_impl(create_camera(*this, rect, device))
 {}
 
 CameraWindow::CameraWindow(Serializer::Properties& props, bool is_derived)
     : Window(props, true),
-      m_camera_impl(std::make_unique<detail::CameraImpl>(*this, box(), ""))
+      m_camera_impl(create_camera(*this, box(), ""))
 {
     deserialize(props);
 
@@ -85,6 +133,16 @@ void CameraWindow::stop()
     m_camera_impl->stop();
 }
 
+std::shared_ptr<const CameraFrame> CameraWindow::frame() const
+{
+    return m_camera_impl->frame();
+}
+
+void CameraWindow::frame_callback(FrameCallback callback)
+{
+    m_camera_impl->frame_callback(std::move(callback));
+}
+
 void CameraWindow::serialize(Serializer& serializer) const
 {
     serializer.add_property("device", device());
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "egt/can.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+
+bool CanSignal::decode(const CanFrame& frame, double& value) const
+{
+    if (!length || length > 64)
+        return false;
+
+    uint64_t raw = 0;
+    if (big_endian)
+    {
+        // position of the most significant bit, from the most significant
+        // bit of the first byte
+        const size_t first = (start / 8) * 8 + (7 - start % 8);
+        const size_t end = first + length;
+        if (end > 64 || (end + 7) / 8 > frame.size)
+            return false;
+
+        uint64_t bits = 0;
+        for (size_t i = 0; i < 8; ++i)
+            bits = (bits << 8) | frame.data[i];
+        raw = bits >> (64 - end);
+    }
+    else
+    {
+        const size_t end = start + length;
+        if (end > 64 || (end + 7) / 8 > frame.size)
+            return false;
+
+        uint64_t bits = 0;
+        for (size_t i = 8; i > 0; --i)
+            bits = (bits << 8) | frame.data[i - 1];
+        raw = bits >> start;
+    }
+
+    const auto mask = length == 64 ? ~uint64_t(0) : (uint64_t(1) << length) - 1;
+    raw &= mask;
+
+    if (is_signed)
+    {
+        if (length < 64 && (raw & (uint64_t(1) << (length - 1))))
+            raw |= ~mask;
+        value = static_cast<double>(static_cast<int64_t>(raw)) * scale + offset;
+    }
+    else
+    {
+        value = static_cast<double>(raw) * scale + offset;
+    }
+
+    return true;
+}
+
+CanSocket::CanSocket(const std::string& interface, Callback callback,
+                     const std::vector<CanFilter>& filters)
+    : m_callback(std::move(callback))
+{
+    auto fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+    if (fd < 0)
+        throw std::runtime_error(std::string("unable to open CAN socket: ") + strerror(errno));
+
+    ifreq ifr{};
+    strncpy(ifr.ifr_name, interface.c_str(), sizeof(ifr.ifr_name) - 1);
+    auto ret = ioctl(fd, SIOCGIFINDEX, &ifr);
+    if (ret >= 0)
+    {
+        sockaddr_can addr{};
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifr.ifr_ifindex;
+        ret = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+
+    if (ret < 0)
+    {
+        const auto error = errno;
+        close(fd);
+        throw std::runtime_error("unable to open " + interface + ": " + strerror(error));
+    }
+
+    m_monitor = std::make_unique<FdMonitor>(fd, [this]() { read(); },
+                FdMonitor::Priority::normal, true);
+    m_frames.reserve(BATCH);
+
+    if (!filters.empty())
+        this->filters(filters);
+}
+
+bool CanSocket::filters(const std::vector<CanFilter>& filters)
+{
+    std::vector<can_filter> kernel;
+    kernel.reserve(filters.size());
+    for (const auto& filter : filters)
+    {
+        // the flags are compared too, so standard and extended frames
+        // with the same identifier, and remote frames, are told apart
+        can_filter f{};
+        if (filter.extended)
+        {
+            f.can_id = (filter.id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            f.can_mask = (filter.mask & CAN_EFF_MASK) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+        else
+        {
+            f.can_id = filter.id & CAN_SFF_MASK;
+            f.can_mask = (filter.mask & CAN_SFF_MASK) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+        }
+        kernel.push_back(f);
+    }
+
+    // one filter accepting everything
+    if (kernel.empty())
+        kernel.push_back({0, 0});
+
+    if (setsockopt(m_monitor->fd(), SOL_CAN_RAW, CAN_RAW_FILTER, kernel.data(),
+                   kernel.size() * sizeof(can_filter)) < 0)
+    {
+        detail::warn("unable to set CAN filters: {}", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool CanSocket::write(const CanFrame& frame)
+{
+    can_frame f{};
+    f.can_id = frame.extended ? ((frame.id & CAN_EFF_MASK) | CAN_EFF_FLAG) :
+               (frame.id & CAN_SFF_MASK);
+    f.can_dlc = std::min<uint8_t>(frame.size, CAN_MAX_DLEN);
+    memcpy(f.data, frame.data.data(), f.can_dlc);
+
+    return ::write(m_monitor->fd(), &f, sizeof(f)) == static_cast<ssize_t>(sizeof(f));
+}
+
+void CanSocket::read()
+{
+    std::array<can_frame, BATCH> buffers;
+    std::array<iovec, BATCH> iovs;
+    std::array<mmsghdr, BATCH> messages;
+
+    while (true)
+    {
+        for (size_t i = 0; i < BATCH; ++i)
+        {
+            iovs[i] = {&buffers[i], sizeof(can_frame)};
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const auto count = recvmmsg(m_monitor->fd(), messages.data(), BATCH, MSG_DONTWAIT, nullptr);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                detail::warn("unable to read CAN frames: {}", strerror(errno));
+            return;
+        }
+
+        m_frames.clear();
+        for (auto i = 0; i < count; ++i)
+        {
+            const auto& f = buffers[i];
+            if (messages[i].msg_len < sizeof(can_frame) ||
+                (f.can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG)))
+                continue;
+
+            CanFrame frame;
+            frame.extended = f.can_id & CAN_EFF_FLAG;
+            frame.id = f.can_id & (frame.extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+            frame.size = std::min<uint8_t>(f.can_dlc, CAN_MAX_DLEN);
+            memcpy(frame.data.data(), f.data, frame.size);
+            m_frames.push_back(frame);
+        }
+
+        m_count += m_frames.size();
+        if (!m_frames.empty() && m_callback)
+            m_callback(m_frames.data(), m_frames.size());
+
+        if (static_cast<size_t>(count) < BATCH)
+            return;
+    }
+}
+
+CanSocket::~CanSocket() noexcept = default;
+
+CanBinding::CanBinding(EventLoop& loop)
+    : m_loop(loop)
+{}
+
+void CanBinding::bind(const CanSignal& signal, Callback callback)
+{
+    m_bindings[key(signal.id, signal.extended)].push_back(
+        Binding{signal, std::make_unique<UpdateChannel<double>>(m_loop, std::move(callback))});
+}
+
+void CanBinding::clear()
+{
+    m_bindings.clear();
+}
+
+void CanBinding::feed(const CanFrame* frames, size_t count)
+{
+    // only the last frame with each identifier matters
+    m_seen.clear();
+    for (size_t i = count; i > 0; --i)
+    {
+        const auto& frame = frames[i - 1];
+        const auto k = key(frame.id, frame.extended);
+        auto bindings = m_bindings.find(k);
+        if (bindings == m_bindings.end() ||
+            std::find(m_seen.begin(), m_seen.end(), k) != m_seen.end())
+            continue;
+
+        m_seen.push_back(k);
+        for (auto& binding : bindings->second)
+        {
+            double value;
+            if (binding.signal.decode(frame, value))
+                binding.channel->post(value);
+        }
+    }
+}
+
+std::vector<CanFilter> CanBinding::filters() const
+{
+    std::vector<CanFilter> filters;
+    for (const auto& bindings : m_bindings)
+    {
+        const auto& signal = bindings.second.front().signal;
+        CanFilter filter;
+        filter.id = signal.id;
+        filter.extended = signal.extended;
+        filters.push_back(filter);
+    }
+    return filters;
+}
+
+CanBinding::~CanBinding() noexcept = default;
+
+}
+}
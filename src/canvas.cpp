@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "egt/canvas.h"
+#include "egt/painter.h"
+#include <algorithm>
+#include <cmath>
 
 namespace egt
 {
@@ -107,5 +110,111 @@ void Canvas::copy(const shared_cairo_surface_t& surface, const RectF& rect)
     cairo_restore(m_cr.get());
 }
 
+DisplayList::DisplayList(const Size& size, size_t threshold)
+    : m_layer(size),
+      m_threshold(std::max<size_t>(threshold, 1))
+{
+    m_layer.zero();
+}
+
+Rect DisplayList::record(const Operation& operation)
+{
+    const cairo_rectangle_t extents{0, 0,
+                                    static_cast<double>(m_layer.size().width()),
+                                    static_cast<double>(m_layer.size().height())};
+
+    shared_cairo_surface_t surface(cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA,
+                                   &extents),
+                                   cairo_surface_destroy);
+    {
+        Painter painter(shared_cairo_t(cairo_create(surface.get()), cairo_destroy));
+        operation(painter);
+    }
+
+    double x;
+    double y;
+    double width;
+    double height;
+    cairo_recording_surface_ink_extents(surface.get(), &x, &y, &width, &height);
+
+    // operations are replayed on whole pixels
+    const auto x1 = static_cast<DefaultDim>(std::floor(x));
+    const auto y1 = static_cast<DefaultDim>(std::floor(y));
+    const auto box = Rect::intersection(Rect(x1, y1,
+                                        static_cast<DefaultDim>(std::ceil(x + width)) - x1,
+                                        static_cast<DefaultDim>(std::ceil(y + height)) - y1),
+                                        Rect({}, m_layer.size()));
+    if (box.empty())
+        return {};
+
+    m_operations.push_back({std::move(surface), box});
+    m_box = m_box.empty() ? box : Rect::merge(m_box, box);
+
+    if (m_operations.size() >= m_threshold)
+        flatten();
+
+    return box;
+}
+
+static void replay(cairo_t* cr, cairo_surface_t* surface, const Rect& rect, const Point& origin)
+{
+    cairo_save(cr);
+    cairo_rectangle(cr, origin.x() + rect.x(), origin.y() + rect.y(),
+                    rect.width(), rect.height());
+    cairo_clip(cr);
+    cairo_set_source_surface(cr, surface, origin.x(), origin.y());
+    cairo_paint(cr);
+    cairo_restore(cr);
+}
+
+void DisplayList::draw(Painter& painter, const Rect& rect, const Point& origin) const
+{
+    auto cr = painter.context().get();
+
+    const auto layer = Rect::intersection(rect, m_layer_box);
+    if (!layer.empty())
+        replay(cr, m_layer.surface().get(), layer, origin);
+
+    for (const auto& operation : m_operations)
+    {
+        const auto r = Rect::intersection(rect, operation.box);
+        if (!r.empty())
+            replay(cr, operation.surface.get(), r, origin);
+    }
+}
+
+void DisplayList::flatten()
+{
+    if (m_operations.empty())
+        return;
+
+    auto cr = m_layer.context().get();
+    for (const auto& operation : m_operations)
+    {
+        replay(cr, operation.surface.get(), operation.box, {});
+        m_layer_box = m_layer_box.empty() ? operation.box :
+                      Rect::merge(m_layer_box, operation.box);
+    }
+    cairo_surface_flush(m_layer.surface().get());
+
+    m_operations.clear();
+}
+
+Canvas& DisplayList::layer()
+{
+    // the layer may be drawn to anywhere
+    m_layer_box = Rect({}, m_layer.size());
+    m_box = m_layer_box;
+    return m_layer;
+}
+
+void DisplayList::clear()
+{
+    m_operations.clear();
+    m_layer.zero();
+    m_layer_box = {};
+    m_box = {};
+}
+
 }
 }
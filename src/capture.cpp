@@ -5,6 +5,7 @@
  */
 #include "egt/capture.h"
 #include "detail/camera/gstcaptureimpl.h"
+#include "detail/video/gstrecorderimpl.h"
 
 namespace egt
 {
@@ -43,8 +44,82 @@ void CameraCapture::stop()
     m_impl->stop();
 }
 
+void CameraCapture::bitrate(uint32_t kbps)
+{
+    m_impl->bitrate(kbps);
+}
+
+uint32_t CameraCapture::bitrate() const
+{
+    return m_impl->bitrate();
+}
+
+void CameraCapture::low_latency(bool enable)
+{
+    m_impl->low_latency(enable);
+}
+
+bool CameraCapture::low_latency() const
+{
+    return m_impl->low_latency();
+}
+
+void CameraCapture::segment_duration(std::chrono::seconds duration)
+{
+    m_impl->segment_duration(duration);
+}
+
+std::chrono::seconds CameraCapture::segment_duration() const
+{
+    return m_impl->segment_duration();
+}
+
+std::string CameraCapture::encoder() const
+{
+    return m_impl->encoder();
+}
+
 CameraCapture::~CameraCapture() = default;
 
+ScreenRecorder::ScreenRecorder(Screen& screen,
+                               const std::string& output,
+                               size_t budget)
+    : m_impl(std::make_unique<detail::ScreenRecorderImpl>(*this, screen,
+             output, budget))
+{}
+
+bool ScreenRecorder::start()
+{
+    return m_impl->start();
+}
+
+void ScreenRecorder::stop()
+{
+    m_impl->stop();
+}
+
+void ScreenRecorder::bitrate(uint32_t kbps)
+{
+    m_impl->bitrate(kbps);
+}
+
+uint32_t ScreenRecorder::bitrate() const
+{
+    return m_impl->bitrate();
+}
+
+std::string ScreenRecorder::encoder() const
+{
+    return m_impl->encoder();
+}
+
+ScreenRecorderStats ScreenRecorder::stats() const
+{
+    return m_impl->stats();
+}
+
+ScreenRecorder::~ScreenRecorder() = default;
+
 }
 }
 }
@@ -38,6 +38,26 @@ size_t ChartBase::data_size() const
     return m_impl->data_size();
 }
 
+void ChartBase::push(double x, double y)
+{
+    m_impl->push(&x, &y, 1);
+}
+
+void ChartBase::push_batch(const std::vector<double>& x, const std::vector<double>& y)
+{
+    m_impl->push(x.data(), y.data(), std::min(x.size(), y.size()));
+}
+
+void ChartBase::capacity(size_t count)
+{
+    m_impl->capacity(count);
+}
+
+size_t ChartBase::capacity() const
+{
+    return m_impl->capacity();
+}
+
 void ChartBase::remove_data(uint32_t count)
 {
     m_impl->remove_data(count);
@@ -122,6 +142,16 @@ float ChartBase::bank() const
     return m_impl->bank();
 }
 
+void ChartBase::decimation(Decimation mode)
+{
+    m_impl->decimation(mode);
+}
+
+ChartBase::Decimation ChartBase::decimation() const
+{
+    return m_impl->decimation();
+}
+
 void ChartBase::serialize(Serializer& serializer) const
 {
     Widget::serialize(serializer);
@@ -148,6 +178,15 @@ void ChartBase::serialize(Serializer& serializer) const
 
     serializer.add_property("gridwidth", grid_width());
 
+    if (capacity())
+        serializer.add_property("capacity", static_cast<unsigned int>(capacity()));
+
+    auto mode = decimation();
+    if (mode == Decimation::none)
+        serializer.add_property("decimation", "none");
+    else if (mode == Decimation::lttb)
+        serializer.add_property("decimation", "lttb");
+
     ChartItemArray items = data();
     if (!items.get_data().empty())
     {
@@ -223,6 +262,24 @@ void ChartBase::deserialize(Serializer::Properties& props)
             grid_width(std::stoi(value));
             break;
         }
+        case detail::hash("capacity"):
+        {
+            capacity(std::stoul(value));
+            break;
+        }
+        case detail::hash("decimation"):
+        {
+            if (value == "none")
+                decimation(Decimation::none);
+            else if (value == "minmax")
+                decimation(Decimation::minmax);
+            else if (value == "lttb")
+                decimation(Decimation::lttb);
+            else
+                egt::detail::warn("unhandled property {}", name);
+
+            break;
+        }
         default:
             return false;
         }
@@ -233,7 +290,7 @@ void ChartBase::deserialize(Serializer::Properties& props)
 LineChart::LineChart(const Rect& rect)
     : ChartBase(rect)
 {
-    name("LineChart" + std::to_string(m_widgetid));
+    default_name("LineChart", m_widgetid);
 
     create_impl();
 }
@@ -329,7 +386,7 @@ LineChart::~LineChart() = default;
 PointChart::PointChart(const Rect& rect)
     : ChartBase(rect)
 {
-    name("PointChart" + std::to_string(m_widgetid));
+    default_name("PointChart", m_widgetid);
 
     create_impl();
 }
@@ -413,7 +470,7 @@ PointChart::~PointChart() = default;
 BarChart::BarChart(const Rect& rect)
     : ChartBase(rect)
 {
-    name("BarChart" + std::to_string(m_widgetid));
+    default_name("BarChart", m_widgetid);
 
     create_impl();
 }
@@ -432,7 +489,7 @@ BarChart::BarChart(Serializer::Properties& props, bool is_derived)
 BarChart::BarChart(const Rect& rect, std::unique_ptr<detail::PlPlotImpl>&& impl)
     : ChartBase(rect)
 {
-    name("BarChart" + std::to_string(m_widgetid));
+    default_name("BarChart", m_widgetid);
 
     m_impl = std::move(impl);
 }
@@ -460,6 +517,16 @@ BarChart::BarPattern BarChart::bar_style() const
     return static_cast<BarChart::BarPattern>(m_impl->line_style());
 }
 
+void BarChart::transition(std::chrono::milliseconds duration)
+{
+    static_cast<detail::PlPlotBarChart*>(m_impl.get())->transition().duration(duration);
+}
+
+std::chrono::milliseconds BarChart::transition() const
+{
+    return static_cast<detail::PlPlotBarChart*>(m_impl.get())->transition().duration();
+}
+
 void BarChart::serialize(Serializer& serializer) const
 {
     ChartBase::serialize(serializer);
@@ -547,7 +614,7 @@ BarChart::~BarChart() = default;
 HorizontalBarChart::HorizontalBarChart(const Rect& rect)
     : BarChart(rect, std::make_unique<detail::PlPlotHBarChart>(*this))
 {
-    name("HorizontalBarChart" + std::to_string(m_widgetid));
+    default_name("HorizontalBarChart", m_widgetid);
 }
 
 HorizontalBarChart::HorizontalBarChart(Serializer::Properties& props, bool is_derived)
@@ -563,7 +630,7 @@ PieChart::PieChart(const Rect& rect)
     : Widget(rect),
       m_impl(std::make_unique<detail::PlPlotPieChart>(*this))
 {
-    name("PieChart" + std::to_string(m_widgetid));
+    default_name("PieChart", m_widgetid);
 }
 
 PieChart::PieChart(Serializer::Properties& props, bool is_derived)
@@ -630,6 +697,16 @@ void PieChart::resize(const Size& size)
     }
 }
 
+void PieChart::transition(std::chrono::milliseconds duration)
+{
+    m_impl->transition().duration(duration);
+}
+
+std::chrono::milliseconds PieChart::transition() const
+{
+    return m_impl->transition().duration();
+}
+
 void PieChart::serialize(Serializer& serializer) const
 {
     Widget::serialize(serializer);
@@ -19,7 +19,7 @@ CheckBox::CheckBox(const std::string& text,
                    const Rect& rect) noexcept
     : Switch(text, rect)
 {
-    name("CheckBox" + std::to_string(m_widgetid));
+    default_name("CheckBox", m_widgetid);
 }
 
 CheckBox::CheckBox(Frame& parent,
@@ -32,6 +32,9 @@ CheckBox::CheckBox(Frame& parent,
 
 void CheckBox::draw(Painter& painter, const Rect& rect)
 {
+    if (draw_state(painter, rect))
+        return;
+
     Drawer<CheckBox>::draw(*this, painter, rect);
 }
 
@@ -68,7 +71,7 @@ void CheckBox::draw_switch(Painter& painter, const Rect& handle) const
 ToggleBox::ToggleBox(const Rect& rect) noexcept
     : CheckBox( {}, rect)
 {
-    name("ToggleBox" + std::to_string(m_widgetid));
+    default_name("ToggleBox", m_widgetid);
 
     fill_flags(Theme::FillFlag::blend);
     border(theme().default_border());
@@ -91,6 +94,9 @@ ToggleBox::ToggleBox(Serializer::Properties& props, bool is_derived) noexcept
 }
 void ToggleBox::draw(Painter& painter, const Rect& rect)
 {
+    if (draw_state(painter, rect))
+        return;
+
     Drawer<ToggleBox>::draw(*this, painter, rect);
 }
 
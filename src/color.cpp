@@ -6,6 +6,7 @@
 #include "detail/fmt.h"
 #include "egt/color.h"
 #include "egt/detail/math.h"
+#include "egt/detail/pixelops.h"
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
@@ -352,20 +353,43 @@ Color ColorMap::interp(float t) const
     return result;
 }
 
+void ColorMap::bake(std::vector<uint32_t>& table, size_t resolution) const
+{
+    resolution = std::max<size_t>(resolution, 2);
+    if (table.size() == resolution)
+        return;
+
+    table.resize(resolution);
+    for (size_t i = 0; i < resolution; ++i)
+        table[i] = interp(static_cast<float>(i) / (resolution - 1)).pixel32();
+}
+
 Color ColorMap::interp_cached(float t, size_t accuracy) const
 {
     if (empty())
         return {};
 
-    const float sf = detail::clamp<float>(t, 0.f, 1.f);
-    const size_t index = sf * accuracy;
-    auto i = m_cache[static_cast<size_t>(m_interp)].find(index);
-    if (i != m_cache[static_cast<size_t>(m_interp)].end())
-        return i->second;
+    bake(m_cache, accuracy + 1);
+    const auto index = std::lround(detail::clamp<float>(t, 0.f, 1.f) * (m_cache.size() - 1));
+    return Color::pixel32(m_cache[index]);
+}
 
-    auto result = ColorMap::interp(t);
-    m_cache[static_cast<size_t>(m_interp)].insert(std::make_pair(index, result));
-    return result;
+void ColorMap::bake(size_t resolution)
+{
+    m_resolution = std::max<size_t>(resolution, 2);
+    bake(m_lut, m_resolution);
+}
+
+void ColorMap::map(const float* offsets, uint32_t* pixels, size_t count) const
+{
+    if (empty())
+    {
+        std::fill(pixels, pixels + count, 0);
+        return;
+    }
+
+    bake(m_lut, m_resolution);
+    detail::lut_lookup(m_lut.data(), m_lut.size(), offsets, pixels, count);
 }
 
 }
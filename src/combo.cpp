@@ -12,7 +12,9 @@
 #include "egt/painter.h"
 #include "egt/string.h"
 #include "egt/window.h"
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
 
 namespace egt
 {
@@ -26,14 +28,20 @@ namespace detail
 {
 
 /**
-* Popup class used by ComboBox.
-*/
+ * Popup listing the items of a ComboBox.
+ *
+ * One popup is shared by all ComboBox, and shows the items of the last one
+ * opened.  It is created the first time a ComboBox is opened, and lives as
+ * long as a ComboBox that was opened, or the main window.
+ */
 class EGT_API ComboBoxPopup : public Popup
 {
 public:
 
-    /// Construct a ComboBoxPopup with associated ComboBox
-    explicit ComboBoxPopup(ComboBox& parent);
+    /// Get the popup, created and added to the main window if needed.
+    static std::shared_ptr<ComboBoxPopup> get();
+
+    ComboBoxPopup();
 
     /// @ref PopupType::handle()
     void handle(Event& event) override;
@@ -41,22 +49,58 @@ public:
     /// @ref PopupType::show()
     void show() override;
 
+    /// Show the items of a ComboBox.
+    void open(ComboBox& combo);
+
+    /// Stop showing the items of a ComboBox.
+    void close(const ComboBox& combo);
+
+    /// The items of the ComboBox shown changed.
+    void items_changed(const ComboBox& combo);
+
+    /// Is it showing the items of a ComboBox.
+    EGT_NODISCARD bool showing(const ComboBox& combo) const
+    {
+        return m_combo == &combo;
+    }
+
 protected:
 
     /// Position algorithm.
     void smart_pos();
 
-    /// Parent ComboBox.
-    ComboBox& m_parent;
+    /// List of the items, with widgets only for those shown.
+    VirtualListBox m_list;
+
+    /// ComboBox shown, if any.
+    ComboBox* m_combo{nullptr};
 
     friend class egt::ComboBox;
 };
 
-ComboBoxPopup::ComboBoxPopup(ComboBox& parent)
-    : Popup(Size(parent.size().width(), 40)),
-      m_parent(parent)
+std::shared_ptr<ComboBoxPopup> ComboBoxPopup::get()
+{
+    static std::weak_ptr<ComboBoxPopup> shared;
+
+    auto main_window = Application::instance().main_window();
+    if (!main_window)
+        throw std::runtime_error("no main window");
+
+    auto popup = shared.lock();
+    if (!popup || popup->parent() != main_window)
+    {
+        popup = std::make_shared<ComboBoxPopup>();
+        main_window->add(popup);
+        shared = popup;
+    }
+
+    return popup;
+}
+
+ComboBoxPopup::ComboBoxPopup()
+    : Popup(Size(100, 40))
 {
-    name("ComboBoxPopup" + std::to_string(m_widgetid));
+    default_name("ComboBoxPopup", m_widgetid);
     border(20);
     if (!plane_window())
         fill_flags(Theme::FillFlag::blend);
@@ -64,20 +108,80 @@ ComboBoxPopup::ComboBoxPopup(ComboBox& parent)
     auto black = Palette::gray;
     black.alpha(0x30);
     color(egt::Palette::ColorId::border, black);
+
+    m_list.align(AlignFlag::expand);
+    add(m_list);
+
+    m_list.binder([this](StringItem & row, size_t index)
+    {
+        const auto item = m_combo ? m_combo->item_at(index) : nullptr;
+        if (!item)
+            return;
+
+        row.text(item->text());
+        row.image(item->image());
+        row.text_align(item->text_align());
+    });
+
+    m_list.on_selected([this](size_t index)
+    {
+        if (m_combo)
+            m_combo->selected(index);
+    });
 }
 
-void ComboBoxPopup::smart_pos()
+void ComboBoxPopup::open(ComboBox& combo)
 {
-    if (Application::instance().screen())
+    m_combo = &combo;
+    special_child_draw_callback(combo.special_child_draw_callback(combo.parent()));
+
+    m_list.item_count(combo.item_count());
+    m_list.refresh();
+    if (combo.selected() >= 0)
+    {
+        m_list.selected(combo.selected());
+        m_list.scroll_to(combo.selected());
+    }
+    else
     {
-        const auto& list = m_parent.m_list;
+        m_list.scroll_top();
+    }
+
+    show_modal();
+}
+
+void ComboBoxPopup::close(const ComboBox& combo)
+{
+    if (!showing(combo))
+        return;
 
+    hide();
+    m_combo = nullptr;
+}
+
+void ComboBoxPopup::items_changed(const ComboBox& combo)
+{
+    if (!showing(combo))
+        return;
+
+    m_list.item_count(combo.item_count());
+    m_list.refresh();
+    if (visible())
+        smart_pos();
+}
+
+void ComboBoxPopup::smart_pos()
+{
+    const auto width = m_combo ? m_combo->size().width() : 100;
+
+    if (Application::instance().screen() && m_combo)
+    {
         /*
          * 'reserved_height' is the fixed height of the decorations that surround
          * the item list within the popup.
          */
         DefaultDim reserved_height = (margin() + border() + padding()) * 2;
-        reserved_height += (list.margin() + list.border() + list.padding()) * 2;
+        reserved_height += (m_list.margin() + m_list.border() + m_list.padding()) * 2;
 
         /*
          * 'max_items_height' is the maxium height available for the item list,
@@ -88,29 +192,19 @@ void ComboBoxPopup::smart_pos()
 
         /*
          * 'total_items_height' is the real height of the item list if no boundaries
-         * existed.
+         * existed, all items are as high.
          */
-        DefaultDim total_items_height = 0;
-        size_t count = m_parent.item_count();
-        for (size_t index = 0; index < count; ++index)
-        {
-            /*
-             * TODO: ListBox::item_at() returns a std::shared_ptr<StringItem>.
-             * Creating such a shared pointer is not really efficient; maybe
-             * extend the API later to return a raw pointer instead.
-             */
-            auto item = m_parent.item_at(index);
-            total_items_height += item->height();
-        }
+        const auto total_items_height =
+            static_cast<DefaultDim>(m_combo->item_count()) * m_list.item_height();
 
         DefaultDim items_height = std::min(total_items_height, max_items_height);
 
         DefaultDim height = items_height + reserved_height;
-        resize(Size(m_parent.size().width(), height));
+        resize(Size(width, height));
     }
     else
     {
-        resize(Size(m_parent.size().width(), 100));
+        resize(Size(width, 100));
     }
 
     const auto ss = Application::instance().screen()->size() / 2;
@@ -153,23 +247,12 @@ ComboBox::ComboBox(const Rect& rect) noexcept
 {
 }
 
-/**
- * @todo ComboBox needs the ability to update list, and this needs to
- * be propagated to ComboBoxPopup, which right now won't because it only
- * happens in constructor.
- */
-
 ComboBox::ComboBox(const ItemArray& items,
                    const Rect& rect) noexcept
     : Widget(rect),
-      m_popup(std::make_shared<detail::ComboBoxPopup>(*this))
+      m_items(items)
 {
-    name("ComboBox" + std::to_string(m_widgetid));
-
-    for (auto& i : items)
-    {
-        m_list.add_item(i);
-    }
+    default_name("ComboBox", m_widgetid);
 
     initialize();
 }
@@ -181,8 +264,7 @@ ComboBox::ComboBox(Frame& parent, const ItemArray& items, const Rect& rect) noex
 }
 
 ComboBox::ComboBox(Serializer::Properties& props, bool is_derived) noexcept
-    : Widget(props, true),
-      m_popup(std::make_shared<detail::ComboBoxPopup>(*this))
+    : Widget(props, true)
 {
     initialize(false);
 
@@ -204,58 +286,63 @@ void ComboBox::initialize(bool init_inherited_properties)
         grab_mouse(true);
     }
 
-    m_popup->add(m_list);
-
-    m_list.align(AlignFlag::expand);
-
     // automatically select the first item
-    if (m_list.item_count())
-        m_list.selected(0);
-
-    m_list.on_selected_changed([this]()
-    {
-        damage();
-        on_selected_changed.invoke();
-    });
+    if (!m_items.empty())
+        m_selected = 0;
 }
 
 void ComboBox::add_item(const std::shared_ptr<StringItem>& item)
 {
-    m_list.add_item(item);
+    m_items.push_back(item);
 
-    if (m_list.item_count() == 1)
-        m_list.selected(0);
+    if (m_items.size() == 1)
+        m_selected = 0;
 
+    items_changed();
     damage();
 }
 
 void ComboBox::remove_item(StringItem* item)
 {
-    return m_list.remove_item(item);
+    auto i = std::find_if(m_items.begin(), m_items.end(),
+                          [item](const auto & ptr) { return ptr.get() == item; });
+    if (i == m_items.end())
+        return;
+
+    const auto index = std::distance(m_items.begin(), i);
+    m_items.erase(i);
+
+    // like ListBox, removing the selected item selects the last one
+    if (index == m_selected)
+    {
+        m_selected = static_cast<ssize_t>(m_items.size()) - 1;
+        if (m_selected >= 0)
+            on_selected_changed.invoke();
+    }
+    else if (index < m_selected)
+    {
+        --m_selected;
+    }
+
+    items_changed();
+    damage();
 }
 
 void ComboBox::clear()
 {
-    if (m_list.item_count())
+    if (!m_items.empty())
     {
-        m_list.clear();
+        m_items.clear();
+        m_selected = -1;
+        items_changed();
         damage();
     }
 }
 
-void ComboBox::set_parent(Widget* parent)
+void ComboBox::items_changed()
 {
-    Widget::set_parent(parent);
-
-    if (!Application::instance().main_window())
-        throw std::runtime_error("no main window");
-
-    if (!m_popup->parent())
-    {
-        Application::instance().main_window()->add(m_popup);
-
-        m_popup->special_child_draw_callback(special_child_draw_callback(parent));
-    }
+    if (m_popup)
+        m_popup->items_changed(*this);
 }
 
 void ComboBox::handle(Event& event)
@@ -267,9 +354,7 @@ void ComboBox::handle(Event& event)
     case EventId::pointer_click:
     {
         if (hit(event.pointer().point))
-        {
-            m_popup->show_modal();
-        }
+            show_popup();
 
         break;
     }
@@ -280,14 +365,19 @@ void ComboBox::handle(Event& event)
 
 void ComboBox::selected(size_t index)
 {
-    m_list.selected(index);
+    if (index >= m_items.size() || static_cast<ssize_t>(index) == m_selected)
+        return;
+
+    m_selected = index;
+    damage();
+    on_selected_changed.invoke();
 }
 
 void ComboBox::resize(const Size& s)
 {
     Widget::resize(s);
 
-    if (m_popup->visible())
+    if (m_popup && m_popup->showing(*this) && m_popup->visible())
         m_popup->smart_pos();
 }
 
@@ -295,7 +385,7 @@ void ComboBox::move(const Point& point)
 {
     Widget::move(point);
 
-    if (m_popup->visible())
+    if (m_popup && m_popup->showing(*this) && m_popup->visible())
         m_popup->smart_pos();
 }
 
@@ -334,6 +424,7 @@ void ComboBox::default_size(const Size& size)
         unregister_handler();
 
     default_combobox_size_value = size;
+    Widget::invalidate_all_size_hints();
 }
 
 Size ComboBox::min_size_hint() const
@@ -346,12 +437,16 @@ Size ComboBox::min_size_hint() const
 
 void ComboBox::show_popup() const
 {
-    m_popup->show_modal();
+    if (!m_popup)
+        m_popup = detail::ComboBoxPopup::get();
+
+    m_popup->open(const_cast<ComboBox&>(*this));
 }
 
 void ComboBox::hide_popup() const
 {
-    m_popup->hide();
+    if (m_popup)
+        m_popup->close(*this);
 }
 
 void ComboBox::draw(Painter& painter, const Rect& rect)
@@ -382,12 +477,12 @@ void ComboBox::default_draw(ComboBox& widget, Painter& painter, const Rect& /*re
     painter.line_width(widget.theme().default_border());
     painter.stroke();
 
-    if (widget.m_list.selected() >= 0 && widget.m_list.selected() < static_cast<ssize_t>(widget.m_list.item_count()))
+    if (widget.m_selected >= 0 && widget.m_selected < static_cast<ssize_t>(widget.m_items.size()))
     {
         // text
         painter.set(widget.color(Palette::ColorId::text));
         painter.set(widget.font());
-        const auto item = widget.m_list.item_at(widget.m_list.selected());
+        const auto& item = widget.m_items[widget.m_selected];
         const auto size = painter.text_size(item->text());
         const auto target = detail::align_algorithm(size,
                             text,
@@ -401,10 +496,10 @@ void ComboBox::serialize(Serializer& serializer) const
 {
     Widget::serialize(serializer);
 
-    for (size_t i = 0; i < m_list.item_count(); i++)
+    for (size_t i = 0; i < m_items.size(); i++)
     {
         Serializer::Attributes attrs;
-        auto item = m_list.item_at(i);
+        const auto& item = m_items[i];
         if (item)
         {
             if (!item->image().empty())
@@ -421,6 +516,12 @@ void ComboBox::serialize(Serializer& serializer) const
     }
 }
 
+ComboBox::~ComboBox() noexcept
+{
+    if (m_popup && Application::check_instance())
+        m_popup->close(*this);
+}
+
 void ComboBox::deserialize(Serializer::Properties& props)
 {
     props.erase(std::remove_if(props.begin(), props.end(), [&](auto & p)
@@ -3,7 +3,12 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "egt/detail/alignment.h"
+#include "egt/detail/fixed.h"
 
 namespace egt
 {
@@ -12,6 +17,20 @@ inline namespace v1
 namespace detail
 {
 
+#ifdef HAVE_FIXED_POINT
+/// Ratio, in percent, of a length.
+static inline DefaultDim ratio_of(DefaultDim length, DefaultDim ratio)
+{
+    return percent_of(length, ratio);
+}
+#else
+/// Ratio, in percent, of a length.
+static inline float ratio_of(DefaultDim length, DefaultDim ratio)
+{
+    return static_cast<float>(length) * (static_cast<float>(ratio) / 100.0f);
+}
+#endif
+
 Rect align_algorithm_force(const Rect& orig, const Rect& bounding,
                            const AlignFlags& align, DefaultDim padding,
                            DefaultDim horizontal_ratio,
@@ -34,9 +53,7 @@ Rect align_algorithm_force(const Rect& orig, const Rect& bounding,
 
     if (xratio)
     {
-        p.x(bounding.x() + padding +
-            static_cast<float>(bounding.width() - padding * 2) *
-            (static_cast<float>(xratio) / 100.0f));
+        p.x(bounding.x() + padding + ratio_of(bounding.width() - padding * 2, xratio));
     }
     else if (align.is_set(AlignFlag::left))
         p.x(bounding.x() + padding);
@@ -49,9 +66,7 @@ Rect align_algorithm_force(const Rect& orig, const Rect& bounding,
 
     if (yratio)
     {
-        p.y(bounding.y() + padding +
-            static_cast<float>(bounding.height() - padding * 2) *
-            (static_cast<float>(yratio) / 100.0f));
+        p.y(bounding.y() + padding + ratio_of(bounding.height() - padding * 2, yratio));
     }
     else if (align.is_set(AlignFlag::top))
         p.y(bounding.y() + padding);
@@ -64,8 +79,7 @@ Rect align_algorithm_force(const Rect& orig, const Rect& bounding,
 
     if (horizontal_ratio)
     {
-        s.width(static_cast<float>(bounding.width() - padding * 2) *
-                (static_cast<float>(horizontal_ratio) / 100.0f));
+        s.width(ratio_of(bounding.width() - padding * 2, horizontal_ratio));
     }
     else if (align.is_set(AlignFlag::expand_horizontal))
     {
@@ -75,8 +89,7 @@ Rect align_algorithm_force(const Rect& orig, const Rect& bounding,
 
     if (vertical_ratio)
     {
-        s.height(static_cast<float>(bounding.height() - padding * 2) *
-                 (static_cast<float>(vertical_ratio) / 100.0f));
+        s.height(ratio_of(bounding.height() - padding * 2, vertical_ratio));
     }
     else if (align.is_set(AlignFlag::expand_vertical))
     {
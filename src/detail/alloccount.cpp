@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/alloccount.h"
+#include "egt/detail/meta.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef HAVE_ALLOC_COUNTING
+
+/*
+ * Counts are per thread, so allocations made by other threads, like the flip
+ * thread, do not show up in the event loop.  The counter is constant
+ * initialized, so using it never allocates.
+ */
+static thread_local uint64_t allocations = 0;
+
+static void* allocate(std::size_t size, std::size_t alignment)
+{
+    ++allocations;
+
+    if (!size)
+        size = 1;
+
+    while (true)
+    {
+        void* p = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+            p = std::malloc(size);
+        else if (posix_memalign(&p, alignment, size))
+            p = nullptr;
+
+        if (p)
+            return p;
+
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+EGT_API void* operator new(std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+EGT_API void* operator new[](std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+EGT_API void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+EGT_API void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+EGT_API void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete[](void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+EGT_API void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+bool allocation_counting() noexcept
+{
+#ifdef HAVE_ALLOC_COUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t allocation_count() noexcept
+{
+#ifdef HAVE_ALLOC_COUNTING
+    return allocations;
+#else
+    return 0;
+#endif
+}
+
+}
+}
+}
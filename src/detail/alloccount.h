@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_ALLOCCOUNT_H
+#define EGT_SRC_DETAIL_ALLOCCOUNT_H
+
+#include <cstdint>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Is the library built with allocation counting.
+ *
+ * Allocation counting replaces the global operator new, so it is only
+ * available when configured with ENABLE_ALLOC_COUNTING, or
+ * --enable-alloc-counting.
+ */
+bool allocation_counting() noexcept;
+
+/**
+ * Number of heap allocations made by the calling thread so far.
+ *
+ * Always 0 when allocation_counting() is false.
+ */
+uint64_t allocation_count() noexcept;
+
+}
+}
+}
+
+#endif
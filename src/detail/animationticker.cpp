@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/animationticker.h"
+#include "detail/priorityqueue.h"
+#include "egt/animation.h"
+#include <algorithm>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+AnimationTicker::AnimationTicker(EventLoop& event, TimerWheel& wheel, PriorityQueue& queue)
+    : m_event(event),
+      m_wheel(wheel),
+      m_queue(queue)
+{
+    // the wheel only queues the tick, so it runs within the dispatch budget
+    m_node.callback = [this]()
+    {
+        m_queue.add(priorities::timer, [this]() { tick(Clock::now(), false); }, this);
+    };
+}
+
+AnimationTicker::~AnimationTicker() noexcept
+{
+    // the frame callbacks of the event loop are already gone by now
+    m_queue.cancel(this);
+}
+
+void AnimationTicker::add(AutoAnimation& animation)
+{
+    const auto now = Clock::now();
+
+    if (std::find(m_animations.begin(), m_animations.end(), &animation) == m_animations.end())
+    {
+        animation.m_last_tick = now;
+        m_animations.push_back(&animation);
+    }
+
+    if (m_frame_handle)
+        return;
+
+    if (!m_node.scheduled() || animation.m_interval < m_period)
+    {
+        m_period = m_node.scheduled() ? std::min(m_period, animation.m_interval) :
+                   animation.m_interval;
+        schedule(now);
+    }
+}
+
+void AnimationTicker::remove(AutoAnimation& animation) noexcept
+{
+    auto i = std::find(m_animations.begin(), m_animations.end(), &animation);
+    if (i == m_animations.end())
+        return;
+
+    // tick() is iterating, so only clear the slot and let it compact
+    if (m_ticking)
+    {
+        *i = nullptr;
+        return;
+    }
+
+    m_animations.erase(i);
+    if (m_animations.empty())
+        unschedule();
+}
+
+void AnimationTicker::tick(Clock::time_point now, bool frame)
+{
+    m_ticking = true;
+
+    auto period = std::chrono::milliseconds::max();
+
+    // animations may start or stop animations, so don't hold onto any
+    for (size_t i = 0; i < m_animations.size(); ++i)
+    {
+        auto animation = m_animations[i];
+        if (!animation)
+            continue;
+
+        // without the frame clock, animations with a longer interval than the
+        // ticker skip ticks, with half a tick of tolerance
+        if (frame || now - animation->m_last_tick >= animation->m_interval - m_period / 2)
+        {
+            animation->m_last_tick = now;
+            if (!animation->advance(now))
+                animation->stop();
+        }
+
+        if (m_animations[i])
+            period = std::min(period, animation->m_interval);
+    }
+
+    m_animations.erase(std::remove(m_animations.begin(), m_animations.end(), nullptr),
+                       m_animations.end());
+    m_ticking = false;
+
+    if (m_animations.empty())
+    {
+        unschedule();
+    }
+    else if (!frame)
+    {
+        m_period = period;
+        schedule(now);
+    }
+}
+
+size_t AnimationTicker::size() const
+{
+    return std::count_if(m_animations.begin(), m_animations.end(),
+                         [](const AutoAnimation * animation) { return animation; });
+}
+
+void AnimationTicker::schedule(Clock::time_point now)
+{
+    if (m_event.frame_clock())
+    {
+        if (!m_frame_handle)
+        {
+            m_frame_handle = m_event.add_frame_callback([this](Clock::time_point when)
+            {
+                tick(when, true);
+            });
+        }
+    }
+    else
+    {
+        m_wheel.schedule(m_node, now + m_period);
+    }
+}
+
+void AnimationTicker::unschedule() noexcept
+{
+    m_wheel.cancel(m_node);
+    m_queue.cancel(this);
+
+    if (m_frame_handle)
+    {
+        m_event.remove_frame_callback(m_frame_handle);
+        m_frame_handle = 0;
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_ANIMATIONTICKER_H
+#define EGT_SRC_DETAIL_ANIMATIONTICKER_H
+
+#include "detail/timerwheel.h"
+#include <chrono>
+#include <egt/detail/meta.h>
+#include <egt/eventloop.h>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class AutoAnimation;
+
+namespace detail
+{
+class PriorityQueue;
+
+/**
+ * Steps all running AutoAnimation objects of an EventLoop together.
+ *
+ * One timer, or one frame callback when the frame clock is enabled, runs
+ * every animation in the same batch with the same timestamp, so any number
+ * of animations costs one wakeup and results in one draw.
+ *
+ * With the timer, the ticker runs at the shortest interval of the running
+ * animations, and animations with a longer interval skip ticks.  With the
+ * frame clock, every animation steps once per frame.
+ */
+class AnimationTicker : private NonCopyable<AnimationTicker>
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    AnimationTicker(EventLoop& event, TimerWheel& wheel, PriorityQueue& queue);
+    AnimationTicker(AnimationTicker&&) = delete;
+    AnimationTicker& operator=(AnimationTicker&&) = delete;
+    ~AnimationTicker() noexcept;
+
+    /**
+     * Start stepping an animation, or pick up a change of its interval if
+     * already stepping it.
+     */
+    void add(AutoAnimation& animation);
+
+    /**
+     * Stop stepping an animation.  May be called while ticking.
+     */
+    void remove(AutoAnimation& animation) noexcept;
+
+    /**
+     * Step all animations.
+     *
+     * @param[in] now Timestamp of the step.
+     * @param[in] frame Is this a frame of the frame clock.
+     */
+    void tick(Clock::time_point now, bool frame);
+
+    /// Number of animations being stepped.
+    EGT_NODISCARD size_t size() const;
+
+private:
+
+    /// Arm the timer, or register the frame callback.
+    void schedule(Clock::time_point now);
+
+    /// Disarm the timer, and remove the frame callback.
+    void unschedule() noexcept;
+
+    EventLoop& m_event;
+    TimerWheel& m_wheel;
+    PriorityQueue& m_queue;
+    /// Animations being stepped, nullptr when removed while ticking.
+    std::vector<AutoAnimation*> m_animations;
+    TimerNode m_node;
+    EventLoop::FrameHandle m_frame_handle{0};
+    /// Interval of the timer.
+    std::chrono::milliseconds m_period{0};
+    bool m_ticking{false};
+};
+
+}
+}
+}
+
+#endif
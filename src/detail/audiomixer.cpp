@@ -0,0 +1,562 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/audiomixer.h"
+#include "detail/egtlog.h"
+#include <algorithm>
+#include <alsa/asoundlib.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+std::shared_ptr<AudioMixer> AudioMixer::get(const std::string& device)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<AudioMixer>> mixers;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = mixers[device];
+    auto mixer = entry.lock();
+    if (!mixer)
+    {
+        mixer = std::make_shared<AudioMixer>(device);
+        entry = mixer;
+    }
+    return mixer;
+}
+
+AudioMixer::AudioMixer(const std::string& device)
+{
+    static const auto MAX_RETRIES = 10;
+    int tries = 0;
+    int err;
+
+    do
+    {
+        err = snd_pcm_open(&m_handle, device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+        if (err == -EBUSY)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    } while (err == -EBUSY && ++tries <= MAX_RETRIES);
+
+    if (err < 0)
+    {
+        throw std::runtime_error(fmt::format("can't open '{}' PCM device: {}",
+                                             device, snd_strerror(err)));
+    }
+
+    const auto latency = std::getenv("EGT_AUDIO_LATENCY");
+    if (latency && strlen(latency))
+    {
+        m_latency = static_cast<unsigned int>(std::max(1000UL, std::strtoul(latency, nullptr, 10)));
+        m_target_latency = m_latency;
+        m_adaptive = false;
+    }
+
+    err = configure(m_latency);
+    if (err < 0)
+    {
+        snd_pcm_close(m_handle);
+        throw std::runtime_error(fmt::format("can't set '{}' PCM parameters: {}",
+                                             device, snd_strerror(err)));
+    }
+
+    EGTLOG_TRACE("PCM name: {}", snd_pcm_name(m_handle));
+
+    m_thread = std::thread(&AudioMixer::run, this);
+}
+
+int AudioMixer::configure(unsigned int latency)
+{
+    /*
+     * The mixer always works in the same format, the plug layer of ALSA
+     * converting it to one supported by the hardware if needed.
+     */
+    auto err = snd_pcm_set_params(m_handle, SND_PCM_FORMAT_S16_LE,
+                                  SND_PCM_ACCESS_RW_INTERLEAVED,
+                                  m_channels, m_rate, 1, latency);
+    if (err < 0)
+        return err;
+
+    snd_pcm_uframes_t buffer_size = 0;
+    snd_pcm_uframes_t period_size = 0;
+    snd_pcm_get_params(m_handle, &buffer_size, &period_size);
+    m_period = period_size ? period_size : m_rate / 1000;
+    m_buffer = std::max<size_t>(buffer_size, m_period);
+    m_latency = latency;
+    m_mix.resize(m_period * m_channels);
+
+    m_stats.latency = std::chrono::microseconds(m_buffer * 1000000ULL / m_rate);
+    m_stats.period = std::chrono::microseconds(m_period * 1000000ULL / m_rate);
+
+    EGTLOG_DEBUG("PCM buffer: {} period: {}", m_buffer, m_period);
+    return 0;
+}
+
+void AudioMixer::retune()
+{
+    if (m_target_latency == m_latency)
+        return;
+
+    snd_pcm_drop(m_handle);
+    const auto err = configure(m_target_latency);
+    if (err < 0)
+    {
+        detail::warn("can't set PCM latency to {} us: {}", m_target_latency, snd_strerror(err));
+        m_target_latency = m_latency;
+        configure(m_latency);
+    }
+    snd_pcm_prepare(m_handle);
+}
+
+void AudioMixer::measure()
+{
+    if (snd_pcm_state(m_handle) != SND_PCM_STATE_RUNNING)
+        return;
+
+    snd_pcm_sframes_t delay = 0;
+    if (snd_pcm_delay(m_handle, &delay) < 0)
+        return;
+
+    /*
+     * The previous write returned with the buffer full, so what is missing
+     * is how late the thread is, waking up and mixing.
+     */
+    const auto buffer = static_cast<snd_pcm_sframes_t>(m_buffer);
+    delay = std::clamp<snd_pcm_sframes_t>(delay, 0, buffer);
+    const auto late = std::chrono::microseconds((buffer - delay) * 1000000LL / m_rate);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.fill = static_cast<unsigned int>(delay * 100 / buffer);
+    if (late > m_stats.max_wakeup_latency)
+        m_stats.max_wakeup_latency = late;
+
+    // twice as late still leaves a period in the buffer
+    if (m_adaptive)
+    {
+        const auto required = static_cast<unsigned int>(2 * late.count() + m_stats.period.count());
+        if (required > m_target_latency)
+            m_target_latency = std::min(required, MAX_LATENCY_US);
+    }
+}
+
+experimental::SoundStats AudioMixer::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+AudioMixer::~AudioMixer() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_condition.notify_all();
+    }
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    snd_pcm_drop(m_handle);
+    snd_pcm_close(m_handle);
+}
+
+/**
+ * Get the sample of a channel of the mixer from a frame, the channels being
+ * duplicated or mixed down.
+ */
+static inline int64_t channel_sample(const int16_t* frame, unsigned int channels,
+                                     unsigned int out_channels, unsigned int channel)
+{
+    if (out_channels == 1 && channels > 1)
+    {
+        int64_t sum = 0;
+        for (unsigned int c = 0; c < channels; ++c)
+            sum += frame[c];
+        return sum / channels;
+    }
+    return frame[std::min(channel, channels - 1)];
+}
+
+SoundBuffer AudioMixer::convert(const int16_t* data, size_t frames,
+                                unsigned int rate, unsigned int channels) const
+{
+    if (!data || !frames || !rate || !channels)
+        return {};
+
+    const auto sample = [&](size_t frame, unsigned int channel)
+    {
+        return channel_sample(data + frame * channels, channels, m_channels, channel);
+    };
+
+    const auto out_frames = static_cast<size_t>(static_cast<uint64_t>(frames) * m_rate / rate);
+    SoundBuffer out(out_frames * m_channels);
+
+    for (size_t f = 0; f < out_frames; ++f)
+    {
+        // position in the input, in 1/65536 of frame
+        const auto position = (static_cast<uint64_t>(f) * rate << 16) / m_rate;
+        const auto index = static_cast<size_t>(position >> 16);
+        const auto next = std::min(index + 1, frames - 1);
+        const auto fraction = static_cast<int64_t>(position & 0xffff);
+
+        for (unsigned int c = 0; c < m_channels; ++c)
+        {
+            const auto a = sample(index, c);
+            const auto b = sample(next, c);
+            out[f * m_channels + c] = static_cast<int16_t>(a + (b - a) * fraction / 65536);
+        }
+    }
+
+    return out;
+}
+
+std::shared_ptr<const SoundBuffer> AudioMixer::load(const std::string& key,
+        const std::function<SoundBuffer()>& decode)
+{
+    std::lock_guard<std::mutex> lock(m_sounds_mutex);
+
+    auto sound = m_sounds[key].lock();
+    if (sound)
+        return sound;
+
+    auto buffer = decode();
+    if (buffer.empty())
+    {
+        m_sounds.erase(key);
+        return nullptr;
+    }
+
+    buffer.shrink_to_fit();
+    sound = std::make_shared<const SoundBuffer>(std::move(buffer));
+
+    // forget the sounds no longer used
+    for (auto i = m_sounds.begin(); i != m_sounds.end();)
+    {
+        if (i->second.expired())
+            i = m_sounds.erase(i);
+        else
+            ++i;
+    }
+
+    m_sounds[key] = sound;
+    return sound;
+}
+
+std::shared_ptr<const SoundBuffer> AudioMixer::find(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_sounds_mutex);
+
+    auto i = m_sounds.find(key);
+    return i != m_sounds.end() ? i->second.lock() : nullptr;
+}
+
+uint64_t AudioMixer::play(std::shared_ptr<const SoundBuffer> buffer, bool repeat)
+{
+    if (!buffer || buffer->empty())
+        return 0;
+
+    return add({0, std::move(buffer), 0, repeat, nullptr});
+}
+
+uint64_t AudioMixer::play(SoundSourceFactory open, bool repeat)
+{
+    if (!open)
+        return 0;
+
+    auto stream = std::make_shared<Stream>();
+    stream->open = std::move(open);
+    stream->repeat = repeat;
+    return add({0, nullptr, 0, repeat, std::move(stream)});
+}
+
+uint64_t AudioMixer::add(Voice voice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_voices.size() >= MAX_VOICES)
+        m_voices.pop_front();
+
+    voice.id = m_next_id++;
+    const auto id = voice.id;
+    m_voices.push_back(std::move(voice));
+    m_condition.notify_one();
+    return id;
+}
+
+void AudioMixer::decode(Stream& stream) const
+{
+    // frames read from the source at once
+    static constexpr size_t CHUNK_FRAMES = 1024;
+
+    // a few periods ahead, so a slow read does not starve the mix
+    const auto ahead = std::max<size_t>(4 * m_period, 2048) * m_channels;
+
+    if (stream.read)
+    {
+        stream.decoded.erase(stream.decoded.begin(),
+                             stream.decoded.begin() + stream.read);
+        stream.read = 0;
+    }
+
+    if (!stream.source && !stream.ended)
+    {
+        stream.source = stream.open();
+        if (!stream.source || !stream.source->rate() || !stream.source->channels())
+        {
+            stream.source.reset();
+            stream.ended = true;
+        }
+    }
+
+    bool rewound = false;
+    while (!stream.ended && stream.decoded.size() < ahead)
+    {
+        const auto channels = stream.source->channels();
+        auto index = static_cast<size_t>(stream.position >> 16);
+
+        if (index + 1 >= stream.input_frames)
+        {
+            // the last frame is kept to interpolate from it
+            if (stream.input_frames)
+            {
+                std::copy_n(stream.input.begin() + (stream.input_frames - 1) * channels,
+                            channels, stream.input.begin());
+                stream.position -= static_cast<uint64_t>(stream.input_frames - 1) << 16;
+                stream.input_frames = 1;
+            }
+
+            stream.input.resize((CHUNK_FRAMES + 1) * channels);
+            const auto count = stream.source->read(stream.input.data() +
+                                                   stream.input_frames * channels,
+                                                   CHUNK_FRAMES);
+            if (!count)
+            {
+                // an empty sound does not repeat forever
+                if (stream.repeat && !rewound && stream.source->rewind())
+                {
+                    rewound = true;
+                    continue;
+                }
+
+                stream.ended = true;
+                stream.source.reset();
+                break;
+            }
+
+            rewound = false;
+            stream.input_frames += count;
+            continue;
+        }
+
+        const auto fraction = static_cast<int64_t>(stream.position & 0xffff);
+        const auto a = stream.input.data() + index * channels;
+        const auto b = a + channels;
+        for (unsigned int c = 0; c < m_channels; ++c)
+        {
+            const auto sa = channel_sample(a, channels, m_channels, c);
+            const auto sb = channel_sample(b, channels, m_channels, c);
+            stream.decoded.push_back(static_cast<int16_t>(sa + (sb - sa) * fraction / 65536));
+        }
+
+        stream.position += (static_cast<uint64_t>(stream.source->rate()) << 16) / m_rate;
+    }
+}
+
+void AudioMixer::stop(uint64_t voice)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_voices.erase(std::remove_if(m_voices.begin(), m_voices.end(),
+                                  [voice](const Voice & v) { return v.id == voice; }),
+                   m_voices.end());
+}
+
+bool AudioMixer::playing(uint64_t voice) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::any_of(m_voices.begin(), m_voices.end(),
+                       [voice](const Voice & v) { return v.id == voice; });
+}
+
+bool AudioMixer::mix(int16_t* out)
+{
+    const auto samples = m_mix.size();
+    const auto played = !m_voices.empty();
+
+    std::fill(m_mix.begin(), m_mix.end(), 0);
+
+    for (auto v = m_voices.begin(); v != m_voices.end();)
+    {
+        if (v->stream)
+        {
+            // what is not decoded yet is heard on a later period
+            auto& stream = *v->stream;
+            const auto count = std::min(samples, stream.decoded.size() - stream.read);
+            for (size_t s = 0; s < count; ++s)
+                m_mix[s] += stream.decoded[stream.read + s];
+            stream.read += count;
+
+            if (stream.ended && stream.read >= stream.decoded.size())
+                v = m_voices.erase(v);
+            else
+                ++v;
+            continue;
+        }
+
+        const auto& data = *v->buffer;
+        size_t i = 0;
+        while (i < samples)
+        {
+            if (v->position >= data.size())
+            {
+                if (!v->repeat)
+                    break;
+                v->position = 0;
+            }
+
+            const auto count = std::min(samples - i, data.size() - v->position);
+            for (size_t s = 0; s < count; ++s)
+                m_mix[i + s] += data[v->position + s];
+            i += count;
+            v->position += count;
+        }
+
+        if (!v->repeat && v->position >= data.size())
+            v = m_voices.erase(v);
+        else
+            ++v;
+    }
+
+    for (size_t i = 0; i < samples; ++i)
+        out[i] = static_cast<int16_t>(std::clamp<int32_t>(m_mix[i], INT16_MIN, INT16_MAX));
+
+    return played;
+}
+
+void AudioMixer::run()
+{
+    /*
+     * Best effort: without the privilege, the mixer still works with a normal
+     * priority, but is more likely to underrun under load.
+     */
+    int priority = sched_get_priority_min(SCHED_FIFO);
+    const auto value = std::getenv("EGT_AUDIO_PRIORITY");
+    if (value && strlen(value))
+        priority = std::atoi(value);
+
+    if (priority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+        {
+            EGTLOG_DEBUG("audio mixer running without real-time priority");
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.realtime = true;
+        }
+    }
+
+    // silence played before stopping the device, about half a second
+    const auto max_idle = std::max<size_t>(1, m_rate / 2 / m_period);
+    auto idle = max_idle;
+    std::vector<int16_t> out(m_mix.size());
+    std::vector<std::shared_ptr<Stream>> streams;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (idle >= max_idle && m_voices.empty())
+            {
+                snd_pcm_drop(m_handle);
+                snd_pcm_prepare(m_handle);
+                retune();
+                out.resize(m_mix.size());
+                m_condition.wait(lock, [this]() { return m_stop || !m_voices.empty(); });
+                idle = 0;
+            }
+
+            if (m_stop)
+                return;
+
+            streams.clear();
+            for (const auto& voice : m_voices)
+                if (voice.stream)
+                    streams.push_back(voice.stream);
+        }
+
+        // decoding is done without blocking play() and stop()
+        for (const auto& stream : streams)
+            decode(*stream);
+        streams.clear();
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (mix(out.data()))
+                idle = 0;
+            else
+                ++idle;
+        }
+
+        measure();
+
+        bool underrun = false;
+        size_t offset = 0;
+        while (offset < m_period)
+        {
+            auto err = snd_pcm_writei(m_handle, out.data() + offset * m_channels,
+                                      m_period - offset);
+            if (err == -EPIPE)
+            {
+                EGTLOG_DEBUG("audio mixer underrun");
+                underrun = true;
+            }
+
+            if (err < 0)
+                err = snd_pcm_recover(m_handle, err, 1);
+
+            if (err < 0)
+            {
+                detail::error("can't write to PCM device: {}", snd_strerror(err));
+                break;
+            }
+
+            offset += err;
+        }
+
+        if (underrun)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.xruns;
+
+            // the sound glitched already, the device is set up again now
+            if (m_adaptive)
+            {
+                m_target_latency = std::min(std::max(m_target_latency, 2 * m_latency),
+                                            MAX_LATENCY_US);
+                retune();
+                out.resize(m_mix.size());
+            }
+        }
+    }
+}
+
+}
+}
+}
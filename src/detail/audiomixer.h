@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_AUDIOMIXER_H
+#define EGT_SRC_DETAIL_AUDIOMIXER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <egt/detail/meta.h>
+#include <egt/sound.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef struct _snd_pcm snd_pcm_t;
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Samples of a sound in the format of an AudioMixer: interleaved signed 16
+ * bit, at the rate and with the channels of the mixer.
+ */
+using SoundBuffer = std::vector<int16_t>;
+
+/**
+ * Source of a sound decoded while it plays, by the thread of an AudioMixer.
+ */
+class SoundSource
+{
+public:
+    /// Rate of the sound.
+    EGT_NODISCARD virtual unsigned int rate() const = 0;
+
+    /// Number of channels of the sound.
+    EGT_NODISCARD virtual unsigned int channels() const = 0;
+
+    /**
+     * Read interleaved signed 16 bit frames.
+     *
+     * @return The number of frames read, 0 at the end of the sound.
+     */
+    virtual size_t read(int16_t* data, size_t frames) = 0;
+
+    /// Go back to the start of the sound, returns false on error.
+    virtual bool rewind() = 0;
+
+    virtual ~SoundSource() noexcept = default;
+};
+
+/// Function opening a SoundSource, returning nullptr on error.
+using SoundSourceFactory = std::function<std::unique_ptr<SoundSource>()>;
+
+/**
+ * Mixer of the sounds played on a PCM device.
+ *
+ * The device is opened once, and a thread mixes every sound playing, the
+ * voices, into it.  A voice only copies its samples into the mix, so
+ * starting one costs no device setup, and it is heard after at most the
+ * latency of the device.  While no voice plays, the device is stopped and the
+ * thread sleeps.
+ *
+ * The latency starts at LATENCY_US.  Before writing a period, the fill level
+ * of the device tells how late the thread woke up, and the latency grows to
+ * twice the longest delay seen, or after an underrun, up to MAX_LATENCY_US.
+ * The device is set up again with it while stopped, or right after an
+ * underrun, as the sound glitched anyway.
+ *
+ * A voice can also stream a SoundSource: the thread opens and decodes it
+ * ahead of the mix, a few periods at a time, so only those are in memory.
+ */
+class AudioMixer : private NonCopyable<AudioMixer>
+{
+public:
+
+    /// Initial latency of the device, so of starting a voice.
+    static constexpr unsigned int LATENCY_US = 8000;
+
+    /// Latency the device grows to at most.
+    static constexpr unsigned int MAX_LATENCY_US = 100000;
+
+    /// Voices played at once, the oldest being stopped for a new one.
+    static constexpr size_t MAX_VOICES = 16;
+
+    /**
+     * Get the mixer of a PCM device.
+     *
+     * The mixer is shared by all the users of the device, and closed when the
+     * last one releases it.
+     *
+     * @throw std::runtime_error if the device cannot be opened.
+     */
+    static std::shared_ptr<AudioMixer> get(const std::string& device);
+
+    explicit AudioMixer(const std::string& device);
+    AudioMixer(AudioMixer&&) = delete;
+    AudioMixer& operator=(AudioMixer&&) = delete;
+    ~AudioMixer() noexcept;
+
+    /// Rate of the mixer.
+    EGT_NODISCARD unsigned int rate() const { return m_rate; }
+
+    /// Number of channels of the mixer.
+    EGT_NODISCARD unsigned int channels() const { return m_channels; }
+
+    /**
+     * Convert interleaved signed 16 bit samples to the format of the mixer.
+     *
+     * The channels are duplicated or mixed down, and the rate is converted
+     * with a linear interpolation.
+     */
+    EGT_NODISCARD SoundBuffer convert(const int16_t* data, size_t frames,
+                                      unsigned int rate, unsigned int channels) const;
+
+    /**
+     * Get a sound loaded in the mixer, or load it.
+     *
+     * Sounds are shared between all the users of the mixer as long as one of
+     * them holds the buffer, so a sound is only decoded and converted once.
+     *
+     * @param key Identifier of the sound, i.e. its path.
+     * @param decode Function loading the sound, returning an empty buffer on
+     *               error.
+     * @return The sound, or nullptr on error.
+     */
+    std::shared_ptr<const SoundBuffer> load(const std::string& key,
+                                            const std::function<SoundBuffer()>& decode);
+
+    /// Get a sound loaded in the mixer, or nullptr.
+    std::shared_ptr<const SoundBuffer> find(const std::string& key);
+
+    /**
+     * Start playing a sound.
+     *
+     * @return Identifier of the voice.
+     */
+    uint64_t play(std::shared_ptr<const SoundBuffer> buffer, bool repeat);
+
+    /**
+     * Start streaming a sound.
+     *
+     * The source is opened, decoded and converted by the thread of the mixer,
+     * so this does not access the sound.
+     *
+     * @return Identifier of the voice.
+     */
+    uint64_t play(SoundSourceFactory open, bool repeat);
+
+    /// Stop playing a voice.
+    void stop(uint64_t voice);
+
+    /// Is a voice still playing.
+    EGT_NODISCARD bool playing(uint64_t voice) const;
+
+    /// Get the statistics of the playback.
+    EGT_NODISCARD experimental::SoundStats stats() const;
+
+private:
+
+    /**
+     * Sound decoded ahead of the mix.
+     *
+     * Only the thread of the mixer uses it, so it needs no lock.
+     */
+    struct Stream
+    {
+        SoundSourceFactory open;
+        std::unique_ptr<SoundSource> source;
+        bool repeat{false};
+        /// The source has nothing more to decode.
+        bool ended{false};
+        /// Frames read from the source, the first one being the last of the previous read.
+        std::vector<int16_t> input;
+        size_t input_frames{0};
+        /// Position in input, in 1/65536 of frame.
+        uint64_t position{0};
+        /// Samples converted to the format of the mixer, from read on.
+        SoundBuffer decoded;
+        size_t read{0};
+    };
+
+    struct Voice
+    {
+        uint64_t id;
+        std::shared_ptr<const SoundBuffer> buffer;
+        size_t position;
+        bool repeat;
+        std::shared_ptr<Stream> stream;
+    };
+
+    /// Add a voice, stopping the oldest one if needed.
+    uint64_t add(Voice voice);
+
+    /// Decode a stream until a few periods are ahead of the mix.
+    void decode(Stream& stream) const;
+
+    /// Mix a period of the voices, returns false if none played.
+    bool mix(int16_t* out);
+
+    void run();
+
+    /// Set up the device for a latency.
+    int configure(unsigned int latency);
+
+    /// Set up the device again for m_target_latency, if it changed.
+    void retune();
+
+    /**
+     * Measure how late the thread is to write a period, and choose a higher
+     * latency if needed.
+     */
+    void measure();
+
+    snd_pcm_t* m_handle{nullptr};
+    unsigned int m_rate{48000};
+    unsigned int m_channels{2};
+    size_t m_period{0};
+    size_t m_buffer{0};
+
+    /// Latency the device is set up for.
+    unsigned int m_latency{LATENCY_US};
+    /// Latency to set up the device for, when it differs from m_latency.
+    unsigned int m_target_latency{LATENCY_US};
+    /// The latency follows the delays measured.
+    bool m_adaptive{true};
+
+    /// Statistics, protected by m_mutex.
+    experimental::SoundStats m_stats;
+
+    std::deque<Voice> m_voices;
+    uint64_t m_next_id{1};
+    std::vector<int32_t> m_mix;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop{false};
+    std::thread m_thread;
+
+    std::map<std::string, std::weak_ptr<const SoundBuffer>> m_sounds;
+    std::mutex m_sounds_mutex;
+};
+
+}
+}
+}
+
+#endif
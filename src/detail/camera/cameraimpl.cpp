@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/camera/cameraimpl.h"
+#include "detail/egtlog.h"
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+CameraImpl::CameraImpl(CameraWindow& iface, const Rect& rect,
+                       // NOLINTNEXTLINE(modernize-pass-by-value)
+                       const std::string& device)
+    : m_interface(iface),
+      m_devnode(device),
+      m_rect(rect)
+{}
+
+void CameraImpl::scale(float scalex, float scaley)
+{
+    m_interface.resize(Size(m_rect.width() * scalex, m_rect.height() * scaley));
+}
+
+void CameraImpl::frame_callback(CameraWindow::FrameCallback callback)
+{
+    std::lock_guard<std::mutex> lock(m_frame_mutex);
+    m_frame_callback = std::move(callback);
+}
+
+Rect CameraImpl::camera_box()
+{
+    Rect box;
+    /*
+     * At this stage, the interface m_box may no longer represent the original
+     * size requested by the user if scaling occured. So compute the content
+     * area based on the m_user_requested_box. If the user requested box is
+     * empty, let's consider the user relies on automatic layout, then use the
+     * window box.
+     */
+    if (!m_interface.user_requested_box().empty())
+    {
+        box = m_interface.user_requested_box();
+        auto m = m_interface.moat();
+        box += Point(m, m);
+        box -= Size(2. * m, 2. * m);
+        if (box.empty())
+            box = Rect(m_interface.point(), m_interface.size());
+    }
+    else
+    {
+        box = m_interface.content_area();
+    }
+    EGTLOG_DEBUG("box = {}", box);
+
+    /*
+     * if user constructs a default constructor, then size of
+     * the camerawindow is zero for BasicWindow and 32x32 for
+     * plane window. due to which pipeline initialization fails
+     * incase of BasicWindow. as a fix resize the camerawindow
+     * to 32x32.
+     */
+    if ((box.width() < 32) && (box.height() < 32))
+    {
+        m_interface.resize(Size(32, 32));
+        m_rect.size(Size(32, 32));
+        box = m_interface.content_area();
+    }
+
+    return box;
+}
+
+std::shared_ptr<const CameraFrame> CameraImpl::create_frame(const unsigned char* data,
+        size_t length, const Size& size, size_t stride, PixelFormat format,
+        int64_t timestamp, int dmabuf, std::shared_ptr<void> buffer)
+{
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    frame->m_data = data;
+    frame->m_length = length;
+    frame->m_size = size;
+    frame->m_stride = stride;
+    frame->m_format = format;
+    frame->m_timestamp = timestamp;
+    frame->m_dmabuf = dmabuf;
+    frame->m_buffer = std::move(buffer);
+    return frame;
+}
+
+}
+}
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_CAMERA_CAMERAIMPL_H
+#define EGT_SRC_DETAIL_CAMERA_CAMERAIMPL_H
+
+#include "egt/camera.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Backend of a CameraWindow.
+ *
+ * The GStreamer backend converts and scales the camera frames to the
+ * window, the V4L2 backend streams them as the camera captures them.
+ */
+class CameraImpl
+{
+public:
+    CameraImpl(CameraWindow& iface, const Rect& rect,
+               const std::string& device);
+
+    // special functions deleted because they are never used
+    CameraImpl(const CameraImpl&) = delete;
+    CameraImpl& operator=(const CameraImpl&) = delete;
+    CameraImpl(CameraImpl&&) = delete;
+    CameraImpl& operator=(CameraImpl&&) = delete;
+
+    virtual void draw(Painter& painter, const Rect& rect) = 0;
+
+    virtual bool start() = 0;
+
+    virtual void stop() = 0;
+
+    /// Change the device, restarting the camera.
+    virtual void device(const std::string& device) = 0;
+
+    std::string device() const { return m_devnode; }
+
+    void scale(float scalex, float scaley);
+
+    virtual std::vector<std::string> list_devices() = 0;
+
+    virtual std::shared_ptr<const CameraFrame> frame() const = 0;
+
+    void frame_callback(CameraWindow::FrameCallback callback);
+
+    virtual ~CameraImpl() noexcept = default;
+
+protected:
+
+    /**
+     * Get the area the camera is shown in, resizing the window to a minimum
+     * size if it has none.
+     */
+    Rect camera_box();
+
+    /// Create a frame of a camera buffer, kept as long as the frame.
+    static std::shared_ptr<const CameraFrame> create_frame(const unsigned char* data,
+            size_t length, const Size& size, size_t stride, PixelFormat format,
+            int64_t timestamp, int dmabuf, std::shared_ptr<void> buffer);
+
+    CameraWindow& m_interface;
+    std::string m_devnode;
+    Rect m_rect;
+
+    mutable std::mutex m_frame_mutex;
+    CameraWindow::FrameCallback m_frame_callback;
+};
+
+}
+}
+}
+
+#endif
@@ -17,8 +17,14 @@
 #endif
 #include "egt/types.h"
 #include "egt/video.h"
+#include <algorithm>
 #include <exception>
 #include <gst/gst.h>
+#include <iterator>
+
+#ifdef HAVE_GSTREAMER_DMABUF
+#include <gst/allocators/gstdmabuf.h>
+#endif
 
 namespace egt
 {
@@ -27,12 +33,9 @@ inline namespace v1
 namespace detail
 {
 
-CameraImpl::CameraImpl(CameraWindow& iface, const Rect& rect,
-                       // NOLINTNEXTLINE(modernize-pass-by-value)
-                       const std::string& device)
-    : m_interface(iface),
-      m_devnode(device),
-      m_rect(rect)
+GstCameraImpl::GstCameraImpl(CameraWindow& iface, const Rect& rect,
+                             const std::string& device)
+    : CameraImpl(iface, rect, device)
 {
     static constexpr auto plugins =
     {
@@ -53,8 +56,7 @@ CameraImpl::CameraImpl(CameraWindow& iface, const Rect& rect,
     };
     detail::gstreamer_init_plugins(plugins);
 
-    m_gmain_loop = g_main_loop_new(nullptr, FALSE);
-    m_gmain_thread = std::thread(g_main_loop_run, m_gmain_loop);
+    m_gmain_loop = GstMainLoop::get();
 
     m_device_monitor = gst_device_monitor_new();
 
@@ -82,11 +84,11 @@ CameraImpl::CameraImpl(CameraWindow& iface, const Rect& rect,
     gst_device_monitor_start(m_device_monitor);
 }
 
-gboolean CameraImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer data)
+gboolean GstCameraImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer data)
 {
     ignoreparam(bus);
 
-    auto impl = static_cast<CameraImpl*>(data);
+    auto impl = static_cast<GstCameraImpl*>(data);
 
     EGTLOG_TRACE("gst message: {}", GST_MESSAGE_TYPE_NAME(message));
 
@@ -200,13 +202,25 @@ gboolean CameraImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer dat
 /*
  * Its a Basic window: copying buffer to cairo surface.
  */
-void CameraImpl::draw(Painter& painter, const Rect& rect)
+void GstCameraImpl::draw(Painter& painter, const Rect& rect)
 {
     ignoreparam(rect);
 
     if (m_camerasample)
     {
         GstCaps* caps = gst_sample_get_caps(m_camerasample);
+        if (!caps)
+            return;
+
+        // the buffers are the same until the caps change
+        if (!m_frame_caps || !gst_caps_is_equal(m_frame_caps, caps))
+        {
+            m_frame_surfaces.clear();
+            if (m_frame_caps)
+                gst_caps_unref(m_frame_caps);
+            m_frame_caps = gst_caps_ref(caps);
+        }
+
         GstStructure* capsStruct = gst_caps_get_structure(caps, 0);
         int width = 0;
         int height = 0;
@@ -215,64 +229,214 @@ void CameraImpl::draw(Painter& painter, const Rect& rect)
 
         EGTLOG_TRACE("videowidth = {}  videoheight = {}", width, height);
 
-        gst_sample_ref(m_camerasample);
         GstBuffer* buffer = gst_sample_get_buffer(m_camerasample);
 
         GstMapInfo map;
-        if (gst_buffer_map(buffer, &map, GST_MAP_READ))
+        if (buffer && gst_buffer_map(buffer, &map, GST_MAP_READ))
         {
-            const auto box = m_interface.content_area();
-            const auto surface = unique_cairo_surface_t(
-                                     cairo_image_surface_create_for_data(map.data,
-                                             CAIRO_FORMAT_RGB16_565,
-                                             width,
-                                             height,
-                                             cairo_format_stride_for_width(CAIRO_FORMAT_RGB16_565, width)));
-
-            if (cairo_surface_status(surface.get()) == CAIRO_STATUS_SUCCESS)
+            auto i = std::find_if(m_frame_surfaces.begin(), m_frame_surfaces.end(),
+                                  [&map](const auto & s) { return s.first == map.data; });
+            if (i == m_frame_surfaces.end())
             {
+                auto surface = unique_cairo_surface_t(
+                                   cairo_image_surface_create_for_data(map.data,
+                                           CAIRO_FORMAT_RGB16_565,
+                                           width,
+                                           height,
+                                           cairo_format_stride_for_width(CAIRO_FORMAT_RGB16_565, width)));
+                m_frame_surfaces.emplace_back(map.data, std::move(surface));
+                i = std::prev(m_frame_surfaces.end());
+            }
+            else
+            {
+                cairo_surface_mark_dirty(i->second.get());
+            }
+
+            const auto surface = i->second.get();
+            if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS)
+            {
+                const auto box = m_interface.content_area();
                 auto cr = painter.context().get();
+                cairo_save(cr);
                 if (width != box.width() || height != box.height())
                 {
                     double scalex = static_cast<double>(box.width()) / width;
                     double scaley = static_cast<double>(box.height()) / height;
                     cairo_scale(cr, scalex, scaley);
                 }
-                cairo_set_source_surface(cr, surface.get(), box.x(), box.y());
+                cairo_set_source_surface(cr, surface, box.x(), box.y());
                 cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
                 cairo_paint(cr);
+                cairo_restore(cr);
             }
             gst_buffer_unmap(buffer, &map);
         }
-        gst_sample_unref(m_camerasample);
     }
 }
 
-GstFlowReturn CameraImpl::on_new_buffer(GstElement* elt, gpointer data)
+std::shared_ptr<const CameraFrame> GstCameraImpl::make_frame(GstSample* sample) const
 {
-    auto impl = static_cast<CameraImpl*>(data);
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstCaps* caps = gst_sample_get_caps(sample);
+    if (!buffer || !caps)
+        return nullptr;
+
+    struct Mapping
+    {
+        GstBuffer* buffer;
+        GstMapInfo map;
+    };
+
+    auto mapping = new Mapping{gst_buffer_ref(buffer), {}};
+    if (!gst_buffer_map(buffer, &mapping->map, GST_MAP_READ))
+    {
+        gst_buffer_unref(buffer);
+        delete mapping;
+        return nullptr;
+    }
+
+    // the buffer goes back to the camera once the last frame is released
+    std::shared_ptr<Mapping> ref(mapping, [](Mapping * m)
+    {
+        gst_buffer_unmap(m->buffer, &m->map);
+        gst_buffer_unref(m->buffer);
+        delete m;
+    });
+
+    GstStructure* capsStruct = gst_caps_get_structure(caps, 0);
+    int width = 0;
+    int height = 0;
+    gst_structure_get_int(capsStruct, "width", &width);
+    gst_structure_get_int(capsStruct, "height", &height);
+
+    int dmabuf = -1;
+#ifdef HAVE_GSTREAMER_DMABUF
+    if (gst_buffer_n_memory(buffer) == 1 &&
+        gst_is_dmabuf_memory(gst_buffer_peek_memory(buffer, 0)))
+        dmabuf = gst_dmabuf_memory_get_fd(gst_buffer_peek_memory(buffer, 0));
+#endif
+
+    return create_frame(mapping->map.data, mapping->map.size, Size(width, height),
+                        height ? mapping->map.size / height : 0,
+                        m_interface.format(), GST_BUFFER_TIMESTAMP(buffer),
+                        dmabuf, std::move(ref));
+}
+
+std::shared_ptr<const CameraFrame> GstCameraImpl::frame() const
+{
+    std::lock_guard<std::mutex> lock(m_frame_mutex);
+    if (!m_last_sample)
+        return nullptr;
+    return make_frame(m_last_sample);
+}
+
+bool GstCameraImpl::flip_dmabuf(GstSample* sample)
+{
+#ifdef HAVE_LIBPLANES
+    if (!m_dmabuf)
+        return false;
+
+    auto screen = reinterpret_cast<detail::KMSOverlay*>(m_interface.screen());
+    if (!gstreamer_flip_dmabuf(screen, sample))
+    {
+        // copy the buffers from now on
+        m_dmabuf = false;
+        return false;
+    }
+
+    // the previous buffer was replaced once the flip returns, but the current
+    // one is still shown
+    if (m_scanout_prev)
+        gst_sample_unref(m_scanout_prev);
+    m_scanout_prev = m_scanout;
+    m_scanout = gst_sample_ref(sample);
+
+    return true;
+#else
+    ignoreparam(sample);
+    return false;
+#endif
+}
+
+void GstCameraImpl::release_frames()
+{
+#ifdef HAVE_LIBPLANES
+    // the imported framebuffers keep the camera buffers until released
+    if (m_interface.plane_window() && m_interface.screen())
+        reinterpret_cast<detail::KMSOverlay*>(m_interface.screen())->release_dmabufs();
+#endif
+
+    for (auto sample : {&m_scanout, &m_scanout_prev, &m_camerasample})
+    {
+        if (*sample)
+        {
+            gst_sample_unref(*sample);
+            *sample = nullptr;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_frame_mutex);
+        if (m_last_sample)
+        {
+            gst_sample_unref(m_last_sample);
+            m_last_sample = nullptr;
+        }
+    }
+
+    m_frame_surfaces.clear();
+    if (m_frame_caps)
+    {
+        gst_caps_unref(m_frame_caps);
+        m_frame_caps = nullptr;
+    }
+    m_dmabuf = true;
+}
+
+GstFlowReturn GstCameraImpl::on_new_buffer(GstElement* elt, gpointer data)
+{
+    auto impl = static_cast<GstCameraImpl*>(data);
 
     GstSample* sample;
     g_signal_emit_by_name(elt, "pull-sample", &sample);
     if (sample)
     {
+        CameraWindow::FrameCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(impl->m_frame_mutex);
+            if (impl->m_last_sample)
+                gst_sample_unref(impl->m_last_sample);
+            impl->m_last_sample = gst_sample_ref(sample);
+            callback = impl->m_frame_callback;
+        }
+
+        if (callback)
+        {
+            if (auto frame = impl->make_frame(sample))
+                callback(std::move(frame));
+        }
+
 #ifdef HAVE_LIBPLANES
         // TODO: this is not thread safe accessing impl here
         if (impl->m_interface.plane_window())
         {
-            GstBuffer* buffer = gst_sample_get_buffer(sample);
-            if (buffer)
+            // camera buffers are shown as they are
+            if (!impl->flip_dmabuf(sample))
             {
-                GstMapInfo map;
-                if (gst_buffer_map(buffer, &map, GST_MAP_READ))
+                GstBuffer* buffer = gst_sample_get_buffer(sample);
+                if (buffer)
                 {
-                    auto screen =
-                        reinterpret_cast<detail::KMSOverlay*>(impl->m_interface.screen());
-                    assert(screen);
-                    if (screen)
+                    GstMapInfo map;
+                    if (gst_buffer_map(buffer, &map, GST_MAP_READ))
                     {
-                        memcpy(screen->raw(), map.data, map.size);
-                        screen->schedule_flip();
+                        auto screen =
+                            reinterpret_cast<detail::KMSOverlay*>(impl->m_interface.screen());
+                        assert(screen);
+                        if (screen)
+                        {
+                            memcpy(screen->raw(), map.data, map.size);
+                            screen->schedule_flip();
+                        }
                         gst_buffer_unmap(buffer, &map);
                     }
                 }
@@ -299,7 +463,7 @@ GstFlowReturn CameraImpl::on_new_buffer(GstElement* elt, gpointer data)
     return GST_FLOW_ERROR;
 }
 
-void CameraImpl::get_camera_device_caps()
+void GstCameraImpl::get_camera_device_caps()
 {
     GList* devlist = gst_device_monitor_get_devices(m_device_monitor);
     for (GList* i = g_list_first(devlist); i; i = g_list_next(i))
@@ -359,46 +523,11 @@ void CameraImpl::get_camera_device_caps()
     g_list_free(devlist);
 }
 
-bool CameraImpl::start()
+bool GstCameraImpl::start()
 {
     get_camera_device_caps();
 
-    Rect box;
-    /*
-     * At this stage, the interface m_box may no longer represent the original
-     * size requested by the user if scaling occured. So compute the content
-     * area based on the m_user_requested_box. If the user requested box is
-     * empty, let's consider the user relies on automatic layout, then use the
-     * window box.
-     */
-    if (!m_interface.user_requested_box().empty())
-    {
-        box = m_interface.user_requested_box();
-        auto m = m_interface.moat();
-        box += Point(m, m);
-        box -= Size(2. * m, 2. * m);
-        if (box.empty())
-            box = Rect(m_interface.point(), m_interface.size());
-    }
-    else
-    {
-        box = m_interface.content_area();
-    }
-    EGTLOG_DEBUG("box = {}", box);
-
-    /*
-     * if user constructs a default constructor, then size of
-     * the camerawindow is zero for BasicWindow and 32x32 for
-     * plane window. due to which pipeline initialization fails
-     * incase of BasicWindow. as a fix resize the camerawindow
-     * to 32x32.
-     */
-    if ((box.width() < 32) && (box.height() < 32))
-    {
-        m_interface.resize(Size(32, 32));
-        m_rect.size(Size(32, 32));
-        box = m_interface.content_area();
-    }
+    const auto box = camera_box();
 
     /*
      * Here we try to match camera resolution with camerawindow size
@@ -430,11 +559,21 @@ bool CameraImpl::start()
     const auto gst_format = detail::gstreamer_format(m_interface.format());
     EGTLOG_DEBUG("format: {}  ", gst_format);
 
+    /*
+     * The camera buffers are exported as dmabufs to show them on the plane
+     * without a copy.
+     */
+    std::string io_mode;
+#if defined(HAVE_LIBPLANES) && defined(HAVE_GSTREAMER_DMABUF)
+    if (m_interface.plane_window())
+        io_mode = "io-mode=dmabuf";
+#endif
+
     static constexpr auto appsink_pipe =
-        "v4l2src device={} ! videoconvert ! video/x-raw,width={},height={},format={} ! {} " \
+        "v4l2src device={} {} ! videoconvert ! video/x-raw,width={},height={},format={} ! {} " \
         "appsink name=appsink async=false enable-last-sample=false sync=true";
 
-    const std::string pipe = fmt::format(appsink_pipe, m_devnode, w, h, gst_format, vscale);
+    const std::string pipe = fmt::format(appsink_pipe, m_devnode, io_mode, w, h, gst_format, vscale);
 
     EGTLOG_DEBUG(pipe);
 
@@ -491,17 +630,12 @@ bool CameraImpl::start()
     return true;
 }
 
-void CameraImpl::scale(float scalex, float scaley)
-{
-    m_interface.resize(Size(m_rect.width() * scalex, m_rect.height() * scaley));
-}
-
-std::vector<std::string> CameraImpl::list_devices()
+std::vector<std::string> GstCameraImpl::list_devices()
 {
     return get_camera_device_list();
 }
 
-void CameraImpl::device(const std::string& device)
+void GstCameraImpl::device(const std::string& device)
 {
     if ((m_devnode != device) || !m_pipeline)
     {
@@ -511,12 +645,7 @@ void CameraImpl::device(const std::string& device)
     }
 }
 
-std::string CameraImpl::device() const
-{
-    return m_devnode;
-}
-
-void CameraImpl::stop()
+void GstCameraImpl::stop()
 {
     if (m_pipeline)
     {
@@ -532,31 +661,24 @@ void CameraImpl::stop()
         g_object_unref(m_pipeline);
         m_pipeline = nullptr;
     }
+
+    release_frames();
 }
 
-CameraImpl::~CameraImpl() noexcept
+GstCameraImpl::~CameraImpl() noexcept
 {
+    // the frames reference the pipeline buffers
+    stop();
 
     GstBus* bus = gst_device_monitor_get_bus(m_device_monitor);
     gst_bus_remove_watch(bus);
     gst_device_monitor_stop(m_device_monitor);
 
-    if (m_gmain_loop)
-    {
-        /*
-         * check loop is running to avoid race condition when stop is called too early
-         */
-        if (g_main_loop_is_running(m_gmain_loop))
-        {
-            //stop loop and wait
-            g_main_loop_quit(m_gmain_loop);
-        }
-        m_gmain_thread.join();
-        g_main_loop_unref(m_gmain_loop);
-    }
+    // the loop is shared, only wait for our callbacks to be done
+    m_gmain_loop->sync();
 }
 
-std::vector<std::string> CameraImpl::get_camera_device_list()
+std::vector<std::string> GstCameraImpl::get_camera_device_list()
 {
     return m_devices;
 }
@@ -6,10 +6,13 @@
 #ifndef EGT_SRC_DETAIL_CAMERA_GSTCAMERAIMPL_H
 #define EGT_SRC_DETAIL_CAMERA_GSTCAMERAIMPL_H
 
-#include "egt/camera.h"
+#include "detail/camera/cameraimpl.h"
 #include <gst/gst.h>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <thread>
+#include <utility>
+#include <vector>
 
 namespace egt
 {
@@ -18,49 +21,70 @@ inline namespace v1
 namespace detail
 {
 
-class CameraImpl
+class GstMainLoop;
+
+class GstCameraImpl : public CameraImpl
 {
 public:
-    CameraImpl(CameraWindow& iface, const Rect& rect,
-               const std::string& device);
-
-    // special functions deleted because they are never used
-    CameraImpl(const CameraImpl&) = delete;
-    CameraImpl& operator=(const CameraImpl&) = delete;
-    CameraImpl(CameraImpl&&) = delete;
-    CameraImpl& operator=(CameraImpl&&) = delete;
-
-    void draw(Painter& painter, const Rect& rect);
+    GstCameraImpl(CameraWindow& iface, const Rect& rect,
+                  const std::string& device);
 
-    bool start();
+    void draw(Painter& painter, const Rect& rect) override;
 
-    void stop();
+    bool start() override;
 
-    void device(const std::string& device);
+    void stop() override;
 
-    std::string device() const;
+    void device(const std::string& device) override;
 
-    void scale(float scalex, float scaley);
+    std::vector<std::string> list_devices() override;
 
-    std::vector<std::string> list_devices();
+    std::shared_ptr<const CameraFrame> frame() const override;
 
-    ~CameraImpl() noexcept;
+    ~GstCameraImpl() noexcept override;
 
 protected:
-    CameraWindow& m_interface;
-    std::string m_devnode;
     std::vector<std::string> m_devices;
     GstDeviceMonitor* m_device_monitor{nullptr};
     GstElement* m_pipeline{nullptr};
     GstElement* m_appsink{nullptr};
     GstSample* m_camerasample{nullptr};
-    Rect m_rect;
-    GMainLoop* m_gmain_loop{nullptr};
-    std::thread m_gmain_thread;
+    std::shared_ptr<GstMainLoop> m_gmain_loop;
     std::string m_caps_name;
     std::string m_caps_format;
     std::vector<std::tuple<int, int>> m_resolutions;
 
+    /// Last sample captured, for frame(), protected by m_frame_mutex.
+    GstSample* m_last_sample{nullptr};
+
+    /**
+     * Samples shown on the plane without a copy: the current one, and the
+     * previous one until the current one replaced it.
+     */
+    GstSample* m_scanout{nullptr};
+    GstSample* m_scanout_prev{nullptr};
+
+    /// Try to show dmabuf samples on the plane without a copy.
+    bool m_dmabuf{true};
+
+    /**
+     * Surfaces wrapping the camera buffers, by address of their data.
+     *
+     * The camera captures into a fixed set of buffers, so their surfaces are
+     * reused until the caps change.
+     */
+    std::vector<std::pair<const void*, unique_cairo_surface_t>> m_frame_surfaces;
+    GstCaps* m_frame_caps{nullptr};
+
+    /// Create a frame referencing the buffer of a sample.
+    std::shared_ptr<const CameraFrame> make_frame(GstSample* sample) const;
+
+    /// Show a dmabuf sample on the plane without a copy.
+    bool flip_dmabuf(GstSample* sample);
+
+    /// Release the samples and surfaces of the frames.
+    void release_frames();
+
     std::vector<std::string> get_camera_device_list();
     void get_camera_device_caps();
 
@@ -16,7 +16,9 @@
 #include "egt/types.h"
 #include <exception>
 #include <gst/gst.h>
+#include <memory>
 #include <sstream>
+#include <vector>
 
 namespace egt
 {
@@ -51,11 +53,12 @@ CaptureImpl::CaptureImpl(experimental::CameraCapture& iface,
         "libgstmpegtsmux.so",
         "libgstlibav.so",
         "libgstvideoparsersbad.so",
+        "libgstmultifile.so",
+        "libgstomx.so",
     };
     detail::gstreamer_init_plugins(plugins);
 
-    m_gmainLoop = g_main_loop_new(nullptr, FALSE);
-    m_gmainThread = std::thread(g_main_loop_run, m_gmainLoop);
+    m_gmain_loop = GstMainLoop::get();
 }
 
 gboolean CaptureImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer data)
@@ -185,47 +188,96 @@ void CaptureImpl::get_camera_device_caps()
     m_devnode = std::get<0>(caps);
 }
 
-bool CaptureImpl::start()
+std::string CaptureImpl::encoder_pipe(const std::string& encoder) const
 {
-    std::string pipe;
+    return gstreamer_encoder_pipe(encoder, m_bitrate, m_low_latency);
+}
 
-    get_camera_device_caps();
+bool CaptureImpl::launch(const std::string& encoder, bool report)
+{
+    const auto format = detail::gstreamer_format(m_format);
 
+    std::string muxer;
     switch (m_container)
     {
     case experimental::CameraCapture::ContainerType::avi:
-    {
-        static constexpr auto avi_pipe =
-            "v4l2src device={} ! videoconvert ! video/x-raw,width={},height={},format={},framerate=30/1 ! " \
-            "avimux ! filesink location={}";
-
-        const auto format = detail::gstreamer_format(m_format);
-        pipe = fmt::format(avi_pipe, m_devnode, 320, 240, format, m_output);
+        muxer = "avimux";
         break;
-    }
     case experimental::CameraCapture::ContainerType::mpeg2ts:
-    {
-        static constexpr auto mpeg2ts_pipe =
-            "v4l2src device={} ! videoconvert ! video/x-raw,width={},height={},format={},framerate=30/1 ! " \
-            "avenc_mpeg2video ! mpegtsmux ! filesink location={}";
+        muxer = "mpegtsmux";
+        break;
+    }
 
-        const auto format = detail::gstreamer_format(m_format);
-        pipe = fmt::format(mpeg2ts_pipe, m_devnode, 320, 240, format, m_output);
+    std::string sink;
+    if (m_segment_duration.count() > 0)
+    {
+        // files are numbered
+        auto location = m_output;
+        if (location.find('%') == std::string::npos)
+        {
+            const auto dot = location.rfind('.');
+            const auto slash = location.rfind('/');
+            if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+                location.insert(dot, "%05d");
+            else
+                location += "%05d";
+        }
 
-        break;
+        // the muxer is set once the pipeline is created
+        sink = fmt::format("splitmuxsink name=sink location={} max-size-time={}",
+                           location,
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(m_segment_duration).count());
     }
+    else
+    {
+        sink = fmt::format("{} ! filesink location={}", muxer, m_output);
     }
 
-    EGTLOG_DEBUG(pipe);
+    static constexpr auto capture_pipe =
+        "v4l2src device={} ! videoconvert ! video/x-raw,width={},height={},format={},framerate=30/1 ! " \
+        "{}{}";
 
-    /* Make sure we don't leave orphan references */
-    stop();
+    const auto pipe = fmt::format(capture_pipe, m_devnode, 320, 240, format,
+                                  encoder.empty() ? "" : encoder_pipe(encoder), sink);
+
+    EGTLOG_DEBUG(pipe);
 
     GError* error = nullptr;
     m_pipeline = gst_parse_launch(pipe.c_str(), &error);
     if (!m_pipeline)
     {
-        m_interface.on_error.invoke(fmt::format("failed to create pipeline: {}", error->message));
+        if (report)
+            m_interface.on_error.invoke(fmt::format("failed to create pipeline: {}", error->message));
+        return false;
+    }
+
+    if (m_segment_duration.count() > 0)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        GstElement* split = gst_bin_get_by_name(GST_BIN(m_pipeline), "sink");
+        if (split)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+            g_object_set(G_OBJECT(split), "muxer",
+                         gst_element_factory_make(muxer.c_str(), nullptr), nullptr);
+            gst_object_unref(split);
+        }
+    }
+
+    /*
+     * An encoder may only fail once it opens its device, so wait for the
+     * pipeline to run before picking it.
+     */
+    auto ret = gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+    if (ret != GST_STATE_CHANGE_FAILURE)
+        ret = gst_element_get_state(m_pipeline, nullptr, nullptr, GST_SECOND);
+    if (ret == GST_STATE_CHANGE_FAILURE)
+    {
+        if (report)
+            m_interface.on_error.invoke("failed to set pipeline to play state");
+        gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        g_object_unref(m_pipeline);
+        m_pipeline = nullptr;
         return false;
     }
 
@@ -234,14 +286,49 @@ bool CaptureImpl::start()
     gst_bus_add_watch(bus, &bus_callback, this);
     gst_object_unref(bus);
 
-    int ret = gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
-    if (ret == GST_STATE_CHANGE_FAILURE)
+    return true;
+}
+
+bool CaptureImpl::start()
+{
+    get_camera_device_caps();
+
+    /* Make sure we don't leave orphan references */
+    stop();
+
+    // encoders by preference, the last one being the software fallback
+    std::vector<std::string> encoders;
+    switch (m_container)
     {
-        m_interface.on_error.invoke("failed to set pipeline to play state");
-        stop();
-        return false;
+    case experimental::CameraCapture::ContainerType::avi:
+    {
+        // raw video
+        encoders.emplace_back();
+        break;
     }
-    return true;
+    case experimental::CameraCapture::ContainerType::mpeg2ts:
+    {
+        encoders = gstreamer_video_encoders();
+        break;
+    }
+    }
+
+    for (const auto& encoder : encoders)
+    {
+        const auto last = &encoder == &encoders.back();
+        if (launch(encoder, last))
+        {
+            m_encoder = encoder;
+            EGTLOG_DEBUG("capture encoder: {}", m_encoder);
+            return true;
+        }
+
+        if (!last)
+            detail::warn("capture encoder {} failed, falling back", encoder);
+    }
+
+    m_encoder.clear();
+    return false;
 }
 
 void CaptureImpl::stop()
@@ -263,6 +350,9 @@ void CaptureImpl::stop()
             detail::error("set pipeline to NULL state failed");
         }
 
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        gst_bus_remove_watch(GST_ELEMENT_BUS(m_pipeline));
+
         g_object_unref(m_pipeline);
         m_pipeline = nullptr;
     }
@@ -272,19 +362,8 @@ CaptureImpl::~CaptureImpl() noexcept
 {
     stop();
 
-    if (m_gmainLoop)
-    {
-        /*
-         * check loop is running to avoid race condition when stop is called too early
-         */
-        if (g_main_loop_is_running(m_gmainLoop))
-        {
-            //stop loop and wait
-            g_main_loop_quit(m_gmainLoop);
-        }
-        m_gmainThread.join();
-        g_main_loop_unref(m_gmainLoop);
-    }
+    // the loop is shared, only wait for our callbacks to be done
+    m_gmain_loop->sync();
 }
 
 }
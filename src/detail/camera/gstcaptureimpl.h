@@ -7,11 +7,12 @@
 #define EGT_SRC_DETAIL_CAMERA_GSTCAPTUREIMPL_H
 
 #include "egt/capture.h"
+#include <chrono>
 #include <condition_variable>
 #include <gst/gst.h>
+#include <memory>
 #include <mutex>
 #include <string>
-#include <thread>
 
 namespace egt
 {
@@ -20,6 +21,8 @@ inline namespace v1
 namespace detail
 {
 
+class GstMainLoop;
+
 class CaptureImpl
 {
 public:
@@ -43,6 +46,20 @@ public:
 
     void stop();
 
+    void bitrate(uint32_t kbps) { m_bitrate = kbps; }
+
+    uint32_t bitrate() const { return m_bitrate; }
+
+    void low_latency(bool enable) { m_low_latency = enable; }
+
+    bool low_latency() const { return m_low_latency; }
+
+    void segment_duration(std::chrono::seconds duration) { m_segment_duration = duration; }
+
+    std::chrono::seconds segment_duration() const { return m_segment_duration; }
+
+    std::string encoder() const { return m_encoder; }
+
     ~CaptureImpl() noexcept;
 
 protected:
@@ -53,10 +70,19 @@ protected:
     std::string m_devnode;
     GstElement* m_pipeline{nullptr};
     GstSample* m_camerasample{nullptr};
-    GMainLoop* m_gmainLoop{nullptr};
-    std::thread m_gmainThread;
+    std::shared_ptr<GstMainLoop> m_gmain_loop;
     std::mutex m_mutex;
     std::condition_variable m_condition;
+    uint32_t m_bitrate{0};
+    bool m_low_latency{false};
+    std::chrono::seconds m_segment_duration{0};
+    std::string m_encoder;
+
+    /// Get the description of the encoder part of the pipeline.
+    std::string encoder_pipe(const std::string& encoder) const;
+
+    /// Try to start the pipeline with an encoder.
+    bool launch(const std::string& encoder, bool report);
     static GstFlowReturn on_new_buffer(GstElement* elt, gpointer data);
     static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data);
     void get_camera_device_caps();
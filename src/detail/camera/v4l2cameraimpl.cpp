@@ -0,0 +1,636 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/camera/v4l2cameraimpl.h"
+#include "detail/egtlog.h"
+#include "egt/app.h"
+#ifdef HAVE_LIBPLANES
+#include "egt/detail/screen/kmsoverlay.h"
+#endif
+#include "egt/painter.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <egt/asio.hpp>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Number of buffers the camera captures into.
+static constexpr uint32_t BUFFER_COUNT = 4;
+
+/// ioctl() retried when interrupted.
+template<class T>
+static int xioctl(int fd, unsigned long request, T* arg)
+{
+    int ret;
+    do
+    {
+        ret = ::ioctl(fd, request, arg);
+    }
+    while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+/// Is a device a camera that can stream.
+static bool capture_device(int fd)
+{
+    v4l2_capability cap{};
+    if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0)
+        return false;
+
+    const auto caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ?
+                      cap.device_caps : cap.capabilities;
+    return (caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_STREAMING);
+}
+
+struct V4l2CameraImpl::Stream
+{
+    struct Mapping
+    {
+        void* data{MAP_FAILED};
+        size_t length{0};
+        /// Exported dmabuf, or -1.
+        int dmabuf{-1};
+    };
+
+    int fd{-1};
+    v4l2_pix_format format{};
+    std::vector<Mapping> buffers;
+    std::atomic<bool> streaming{false};
+
+    /// Give a buffer back to the camera, unless stopped.
+    void queue(uint32_t index) const
+    {
+        if (!streaming)
+            return;
+
+        v4l2_buffer buffer{};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = index;
+        if (xioctl(fd, VIDIOC_QBUF, &buffer) < 0)
+            EGTLOG_DEBUG("unable to queue buffer {}: {}", index, strerror(errno));
+    }
+
+    ~Stream()
+    {
+        for (auto& mapping : buffers)
+        {
+            if (mapping.data != MAP_FAILED)
+                ::munmap(mapping.data, mapping.length);
+            if (mapping.dmabuf >= 0)
+                ::close(mapping.dmabuf);
+        }
+        if (fd >= 0)
+            ::close(fd);
+    }
+};
+
+/// A buffer dequeued from the camera, queued again once released.
+struct V4l2CameraImpl::Buffer
+{
+    Buffer(std::shared_ptr<Stream> s, uint32_t i, size_t bytes, int64_t time)
+        : stream(std::move(s)),
+          index(i),
+          bytesused(bytes),
+          timestamp(time)
+    {}
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    ~Buffer()
+    {
+        stream->queue(index);
+    }
+
+    std::shared_ptr<Stream> stream;
+    uint32_t index;
+    size_t bytesused;
+    int64_t timestamp;
+};
+
+V4l2CameraImpl::V4l2CameraImpl(CameraWindow& iface, const Rect& rect,
+                               const std::string& device)
+    : CameraImpl(iface, rect, device)
+{}
+
+uint32_t V4l2CameraImpl::fourcc(PixelFormat format)
+{
+    // the same memory layout as the DRM format of the plane
+    switch (format)
+    {
+    case PixelFormat::rgb565:
+        return V4L2_PIX_FMT_RGB565;
+    case PixelFormat::argb8888:
+        return V4L2_PIX_FMT_ABGR32;
+    case PixelFormat::xrgb8888:
+        return V4L2_PIX_FMT_XBGR32;
+    case PixelFormat::yuyv:
+    case PixelFormat::yuy2:
+        return V4L2_PIX_FMT_YUYV;
+    case PixelFormat::nv21:
+        return V4L2_PIX_FMT_NV21;
+    case PixelFormat::yuv420:
+        return V4L2_PIX_FMT_YUV420;
+    case PixelFormat::yvyu:
+        return V4L2_PIX_FMT_YVYU;
+    case PixelFormat::nv61:
+        return V4L2_PIX_FMT_NV61;
+    case PixelFormat::uyvy:
+        return V4L2_PIX_FMT_UYVY;
+    case PixelFormat::l8:
+        return V4L2_PIX_FMT_GREY;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/// Pick the smallest size the camera captures that covers a box.
+static Size capture_size(int fd, uint32_t fourcc, const Size& box)
+{
+    std::vector<Size> sizes;
+
+    v4l2_frmsizeenum frmsize{};
+    frmsize.pixel_format = fourcc;
+    while (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0)
+    {
+        if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE)
+        {
+            sizes.emplace_back(frmsize.discrete.width, frmsize.discrete.height);
+        }
+        else
+        {
+            // any size within the range
+            const auto& s = frmsize.stepwise;
+            return Size(detail::clamp<int>(box.width(), s.min_width, s.max_width),
+                        detail::clamp<int>(box.height(), s.min_height, s.max_height));
+        }
+        ++frmsize.index;
+    }
+
+    if (sizes.empty())
+        return box;
+
+    std::sort(sizes.begin(), sizes.end(), [](const Size & a, const Size & b)
+    {
+        return a.width() * a.height() < b.width() * b.height();
+    });
+
+    for (const auto& size : sizes)
+    {
+        if (size.width() >= box.width() && size.height() >= box.height())
+            return size;
+    }
+    return sizes.back();
+}
+
+std::shared_ptr<V4l2CameraImpl::Stream> V4l2CameraImpl::open(const Rect& box)
+{
+    const auto pixelformat = fourcc(m_interface.format());
+    if (!pixelformat)
+    {
+        m_interface.on_error.invoke(fmt::format("format not supported by v4l2 camera: {}",
+                                                detail::enum_to_string(m_interface.format())));
+        return nullptr;
+    }
+
+    auto stream = std::make_shared<Stream>();
+    stream->fd = ::open(m_devnode.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (stream->fd < 0)
+    {
+        m_interface.on_error.invoke(fmt::format("unable to open {}: {}", m_devnode, strerror(errno)));
+        return nullptr;
+    }
+
+    if (!capture_device(stream->fd))
+    {
+        m_interface.on_error.invoke(fmt::format("{} is not a streaming camera", m_devnode));
+        return nullptr;
+    }
+
+    // the format of the window, so the buffers can be shown as they are
+    v4l2_format format{};
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    const auto size = capture_size(stream->fd, pixelformat, box.size());
+    format.fmt.pix.width = size.width();
+    format.fmt.pix.height = size.height();
+    format.fmt.pix.pixelformat = pixelformat;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(stream->fd, VIDIOC_S_FMT, &format) < 0 ||
+        format.fmt.pix.pixelformat != pixelformat)
+    {
+        m_interface.on_error.invoke(fmt::format("{} does not capture in format {}",
+                                                m_devnode, detail::enum_to_string(m_interface.format())));
+        return nullptr;
+    }
+    stream->format = format.fmt.pix;
+
+    EGTLOG_DEBUG("capturing {} at {}x{}, {} bytes per line", m_devnode,
+                 stream->format.width, stream->format.height, stream->format.bytesperline);
+
+    v4l2_requestbuffers request{};
+    request.count = BUFFER_COUNT;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(stream->fd, VIDIOC_REQBUFS, &request) < 0 || request.count < 2)
+    {
+        m_interface.on_error.invoke(fmt::format("unable to allocate buffers of {}", m_devnode));
+        return nullptr;
+    }
+
+    stream->buffers.resize(request.count);
+    for (uint32_t i = 0; i < request.count; ++i)
+    {
+        v4l2_buffer buffer{};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        buffer.index = i;
+        if (xioctl(stream->fd, VIDIOC_QUERYBUF, &buffer) < 0)
+        {
+            m_interface.on_error.invoke(fmt::format("unable to query buffer of {}", m_devnode));
+            return nullptr;
+        }
+
+        auto& mapping = stream->buffers[i];
+        mapping.length = buffer.length;
+        mapping.data = ::mmap(nullptr, buffer.length, PROT_READ, MAP_SHARED,
+                              stream->fd, buffer.m.offset);
+        if (mapping.data == MAP_FAILED)
+        {
+            m_interface.on_error.invoke(fmt::format("unable to map buffer of {}", m_devnode));
+            return nullptr;
+        }
+
+        // exported to show the buffer on the plane without a copy
+        if (m_interface.plane_window())
+        {
+            v4l2_exportbuffer exported{};
+            exported.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            exported.index = i;
+            exported.flags = O_RDONLY | O_CLOEXEC;
+            if (xioctl(stream->fd, VIDIOC_EXPBUF, &exported) == 0)
+                mapping.dmabuf = exported.fd;
+        }
+
+        if (xioctl(stream->fd, VIDIOC_QBUF, &buffer) < 0)
+        {
+            m_interface.on_error.invoke(fmt::format("unable to queue buffer of {}", m_devnode));
+            return nullptr;
+        }
+    }
+
+    return stream;
+}
+
+bool V4l2CameraImpl::start()
+{
+    /* Make sure we don't leave orphan references */
+    stop();
+
+    const auto box = camera_box();
+
+    auto stream = open(box);
+    if (!stream)
+        return false;
+
+    // the plane shows the buffers at their size
+    const Size size(stream->format.width, stream->format.height);
+    if (m_interface.plane_window() && size != box.size())
+    {
+        EGTLOG_DEBUG("resizing camera window from {} to {}", box.size(), size);
+        m_interface.resize(size + Size(2 * m_interface.moat(), 2 * m_interface.moat()));
+    }
+
+    auto type = static_cast<int>(V4L2_BUF_TYPE_VIDEO_CAPTURE);
+    if (xioctl(stream->fd, VIDIOC_STREAMON, &type) < 0)
+    {
+        m_interface.on_error.invoke(fmt::format("unable to start {}: {}", m_devnode, strerror(errno)));
+        return false;
+    }
+    stream->streaming = true;
+
+    m_wakeup = ::eventfd(0, EFD_CLOEXEC);
+    if (m_wakeup < 0)
+    {
+        stream->streaming = false;
+        xioctl(stream->fd, VIDIOC_STREAMOFF, &type);
+        m_interface.on_error.invoke("unable to create camera thread");
+        return false;
+    }
+
+    m_surfaces.resize(stream->buffers.size());
+    m_stream = stream;
+    m_thread = std::thread([this, stream, wakeup = m_wakeup]()
+    {
+        capture(stream, wakeup);
+    });
+
+    return true;
+}
+
+void V4l2CameraImpl::capture(const std::shared_ptr<Stream>& stream, int wakeup)
+{
+    std::array<pollfd, 2> fds{};
+    fds[0] = {stream->fd, POLLIN, 0};
+    fds[1] = {wakeup, POLLIN, 0};
+
+    while (true)
+    {
+        if (::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        v4l2_buffer b{};
+        b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        b.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(stream->fd, VIDIOC_DQBUF, &b) < 0)
+        {
+            if (errno == EAGAIN)
+                continue;
+
+            // unplugged
+            EGTLOG_DEBUG("camera {} stopped: {}", m_devnode, strerror(errno));
+            if (Application::check_instance())
+            {
+                asio::post(Application::instance().event().io(), [this, devnode = m_devnode]()
+                {
+                    m_interface.on_disconnect.invoke(devnode);
+                });
+            }
+            break;
+        }
+
+        const auto timestamp = static_cast<int64_t>(b.timestamp.tv_sec) * 1000000000LL +
+                               static_cast<int64_t>(b.timestamp.tv_usec) * 1000LL;
+        captured(std::make_shared<Buffer>(stream, b.index, b.bytesused, timestamp));
+    }
+}
+
+void V4l2CameraImpl::captured(const std::shared_ptr<Buffer>& buffer)
+{
+    CameraWindow::FrameCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(m_frame_mutex);
+        m_last = buffer;
+        callback = m_frame_callback;
+    }
+
+    if (callback)
+        callback(make_frame(buffer));
+
+#ifdef HAVE_LIBPLANES
+    if (m_interface.plane_window())
+    {
+        // camera buffers are shown as they are
+        if (!flip_dmabuf(buffer))
+        {
+            auto screen = reinterpret_cast<detail::KMSOverlay*>(m_interface.screen());
+            if (screen)
+            {
+                const auto& mapping = buffer->stream->buffers[buffer->index];
+                memcpy(screen->raw(), mapping.data, buffer->bytesused);
+                screen->schedule_flip();
+            }
+        }
+        return;
+    }
+#endif
+
+    if (Application::check_instance())
+    {
+        asio::post(Application::instance().event().io(), [this, buffer]()
+        {
+            m_drawn = buffer;
+            m_interface.damage();
+        });
+    }
+}
+
+bool V4l2CameraImpl::flip_dmabuf(const std::shared_ptr<Buffer>& buffer)
+{
+#ifdef HAVE_LIBPLANES
+    const auto& mapping = buffer->stream->buffers[buffer->index];
+    if (!m_dmabuf || mapping.dmabuf < 0)
+        return false;
+
+    const auto& format = buffer->stream->format;
+    const auto stride = format.bytesperline;
+    std::array<uint32_t, 4> pitches{stride};
+    std::array<uint32_t, 4> offsets{};
+    switch (format.pixelformat)
+    {
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_NV61:
+        pitches[1] = stride;
+        offsets[1] = stride * format.height;
+        break;
+    case V4L2_PIX_FMT_YUV420:
+        pitches[1] = pitches[2] = stride / 2;
+        offsets[1] = stride * format.height;
+        offsets[2] = offsets[1] + stride / 2 * format.height / 2;
+        break;
+    default:
+        break;
+    }
+
+    auto screen = reinterpret_cast<detail::KMSOverlay*>(m_interface.screen());
+    const auto fb = screen ? screen->import_dmabuf(mapping.dmabuf, pitches, offsets) : 0;
+    if (!fb || !screen->flip_framebuffer(fb))
+    {
+        // copy the buffers from now on
+        detail::warn("unable to show camera dmabuf, copying it instead");
+        m_dmabuf = false;
+        return false;
+    }
+
+    // the previous buffer was replaced once the flip returns, but the current
+    // one is still shown
+    m_scanout_prev = std::move(m_scanout);
+    m_scanout = buffer;
+
+    return true;
+#else
+    ignoreparam(buffer);
+    return false;
+#endif
+}
+
+std::shared_ptr<const CameraFrame> V4l2CameraImpl::make_frame(const std::shared_ptr<Buffer>& buffer) const
+{
+    const auto& mapping = buffer->stream->buffers[buffer->index];
+    const auto& format = buffer->stream->format;
+
+    // the buffer goes back to the camera once the last frame is released
+    return create_frame(static_cast<const unsigned char*>(mapping.data),
+                        buffer->bytesused, Size(format.width, format.height),
+                        format.bytesperline, m_interface.format(),
+                        buffer->timestamp, mapping.dmabuf, buffer);
+}
+
+std::shared_ptr<const CameraFrame> V4l2CameraImpl::frame() const
+{
+    std::lock_guard<std::mutex> lock(m_frame_mutex);
+    if (!m_last)
+        return nullptr;
+    return make_frame(m_last);
+}
+
+void V4l2CameraImpl::draw(Painter& painter, const Rect& rect)
+{
+    ignoreparam(rect);
+
+    if (!m_drawn)
+        return;
+
+    const auto format = detail::cairo_format(m_interface.format());
+    if (format == CAIRO_FORMAT_INVALID)
+        return;
+
+    const auto& mapping = m_drawn->stream->buffers[m_drawn->index];
+    const auto width = static_cast<int>(m_drawn->stream->format.width);
+    const auto height = static_cast<int>(m_drawn->stream->format.height);
+
+    // the camera captures into the same buffers until stopped
+    auto& surface = m_surfaces[m_drawn->index];
+    if (!surface)
+    {
+        surface = unique_cairo_surface_t(
+                      cairo_image_surface_create_for_data(static_cast<unsigned char*>(mapping.data),
+                              format, width, height,
+                              m_drawn->stream->format.bytesperline));
+    }
+    else
+    {
+        cairo_surface_mark_dirty(surface.get());
+    }
+
+    if (cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS)
+        return;
+
+    const auto box = m_interface.content_area();
+    auto cr = painter.context().get();
+    cairo_save(cr);
+    if (width != box.width() || height != box.height())
+    {
+        double scalex = static_cast<double>(box.width()) / width;
+        double scaley = static_cast<double>(box.height()) / height;
+        cairo_scale(cr, scalex, scaley);
+    }
+    cairo_set_source_surface(cr, surface.get(), box.x(), box.y());
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_paint(cr);
+    cairo_restore(cr);
+}
+
+void V4l2CameraImpl::stop()
+{
+    if (m_thread.joinable())
+    {
+        const uint64_t value = 1;
+        if (::write(m_wakeup, &value, sizeof(value)) < 0)
+            detail::error("unable to stop camera thread: {}", strerror(errno));
+        m_thread.join();
+    }
+
+    if (m_wakeup >= 0)
+    {
+        ::close(m_wakeup);
+        m_wakeup = -1;
+    }
+
+    if (m_stream)
+    {
+        // frames still referenced keep the buffers mapped
+        m_stream->streaming = false;
+        auto type = static_cast<int>(V4L2_BUF_TYPE_VIDEO_CAPTURE);
+        xioctl(m_stream->fd, VIDIOC_STREAMOFF, &type);
+    }
+
+#ifdef HAVE_LIBPLANES
+    // the imported framebuffers keep the camera buffers until released
+    if (m_interface.plane_window() && m_interface.screen())
+        reinterpret_cast<detail::KMSOverlay*>(m_interface.screen())->release_dmabufs();
+#endif
+
+    m_scanout.reset();
+    m_scanout_prev.reset();
+    m_drawn.reset();
+    {
+        std::lock_guard<std::mutex> lock(m_frame_mutex);
+        m_last.reset();
+    }
+    m_surfaces.clear();
+    m_stream.reset();
+    m_dmabuf = true;
+}
+
+void V4l2CameraImpl::device(const std::string& device)
+{
+    if ((m_devnode != device) || !m_stream)
+    {
+        stop();
+        m_devnode = device;
+        start();
+    }
+}
+
+std::vector<std::string> V4l2CameraImpl::list_devices()
+{
+    std::vector<std::string> devices;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev", ec))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.compare(0, 5, "video") != 0)
+            continue;
+
+        const auto fd = ::open(entry.path().c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        if (capture_device(fd))
+            devices.push_back(entry.path().string());
+        ::close(fd);
+    }
+
+    std::sort(devices.begin(), devices.end());
+    return devices;
+}
+
+V4l2CameraImpl::~V4l2CameraImpl() noexcept
+{
+    stop();
+}
+
+}
+}
+}
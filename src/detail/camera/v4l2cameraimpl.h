@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_CAMERA_V4L2CAMERAIMPL_H
+#define EGT_SRC_DETAIL_CAMERA_V4L2CAMERAIMPL_H
+
+#include "detail/camera/cameraimpl.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Camera backend streaming straight from a V4L2 device, without GStreamer.
+ *
+ * The camera is set to capture in the format of the window, at the closest
+ * size it supports, into memory mapped buffers.  A capture thread dequeues
+ * them and shows them on the plane: exported as dmabufs and scanned out
+ * without a copy when possible, copied to the plane otherwise.  Nothing is
+ * converted, so the camera must support the format of the window.
+ */
+class V4l2CameraImpl : public CameraImpl
+{
+public:
+    V4l2CameraImpl(CameraWindow& iface, const Rect& rect,
+                   const std::string& device);
+
+    void draw(Painter& painter, const Rect& rect) override;
+
+    bool start() override;
+
+    void stop() override;
+
+    void device(const std::string& device) override;
+
+    std::vector<std::string> list_devices() override;
+
+    std::shared_ptr<const CameraFrame> frame() const override;
+
+    /// Get the V4L2 pixel format of a pixel format, or 0.
+    static uint32_t fourcc(PixelFormat format);
+
+    ~V4l2CameraImpl() noexcept override;
+
+protected:
+
+    struct Stream;
+    struct Buffer;
+
+    /// Dequeue buffers until stopped, on the capture thread.
+    void capture(const std::shared_ptr<Stream>& stream, int wakeup);
+
+    /// Handle a buffer captured, on the capture thread.
+    void captured(const std::shared_ptr<Buffer>& buffer);
+
+    /// Create a frame referencing a buffer.
+    std::shared_ptr<const CameraFrame> make_frame(const std::shared_ptr<Buffer>& buffer) const;
+
+    /// Show a buffer on the plane without a copy.
+    bool flip_dmabuf(const std::shared_ptr<Buffer>& buffer);
+
+    /// Open the device, negotiate the format and map its buffers.
+    std::shared_ptr<Stream> open(const Rect& box);
+
+    /// Buffers of the camera, shared with the frames.
+    std::shared_ptr<Stream> m_stream;
+
+    std::thread m_thread;
+
+    /// Wakes up the capture thread to stop it.
+    int m_wakeup{-1};
+
+    /// Last buffer captured, for frame(), protected by m_frame_mutex.
+    std::shared_ptr<Buffer> m_last;
+
+    /// Buffer drawn by a window without a plane.
+    std::shared_ptr<Buffer> m_drawn;
+
+    /**
+     * Buffers shown on the plane without a copy: the current one, and the
+     * previous one until the current one replaced it.
+     */
+    std::shared_ptr<Buffer> m_scanout;
+    std::shared_ptr<Buffer> m_scanout_prev;
+
+    /// Try to show buffers on the plane without a copy.
+    bool m_dmabuf{true};
+
+    /// Surfaces wrapping the buffers, by index.
+    std::vector<unique_cairo_surface_t> m_surfaces;
+};
+
+}
+}
+}
+
+#endif
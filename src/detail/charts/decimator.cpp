@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/charts/decimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+void Decimator::invalidate(size_t from)
+{
+    // appending extends the pyramid, any other change rebuilds it
+    if (from < m_valid)
+    {
+        m_valid = 0;
+        m_sorted = true;
+    }
+}
+
+void Decimator::build(const std::vector<double>& x, const std::vector<double>& y)
+{
+    const auto n = std::min(x.size(), y.size());
+    if (n < m_valid)
+    {
+        m_valid = 0;
+        m_sorted = true;
+    }
+
+    if (n == m_valid)
+        return;
+
+    for (auto i = std::max<size_t>(m_valid, 1); i < n && m_sorted; ++i)
+    {
+        if (x[i] < x[i - 1])
+            m_sorted = false;
+    }
+
+    if (!m_sorted)
+    {
+        m_levels.clear();
+        m_valid = n;
+        return;
+    }
+
+    // only the buckets from the first new sample are computed again
+    auto count = n;
+    auto start = m_valid;
+    size_t level = 0;
+    for (; count > 1; ++level)
+    {
+        const auto buckets = (count + 1) / 2;
+        const auto first = start / 2;
+
+        if (m_levels.size() <= level)
+            m_levels.emplace_back();
+        auto& current = m_levels[level];
+        current.resize(buckets);
+
+        for (auto b = first; b < buckets; ++b)
+        {
+            const auto l = 2 * b;
+            const auto r = std::min(2 * b + 1, count - 1);
+            const auto left = level ? m_levels[level - 1][l] : Bucket{l, l};
+            const auto right = level ? m_levels[level - 1][r] : Bucket{r, r};
+            current[b] = {y[right.min] < y[left.min] ? right.min : left.min,
+                          y[right.max] > y[left.max] ? right.max : left.max
+                         };
+        }
+
+        count = buckets;
+        start = first;
+    }
+
+    m_levels.resize(level);
+    m_valid = n;
+}
+
+bool Decimator::decimate(const std::vector<double>& x, const std::vector<double>& y,
+                         size_t first, double xmin, double xmax, size_t columns,
+                         ChartBase::Decimation mode,
+                         std::vector<double>& outx, std::vector<double>& outy)
+{
+    outx.clear();
+    outy.clear();
+
+    const auto n = std::min(x.size(), y.size());
+    if (mode == ChartBase::Decimation::none || !columns || first >= n ||
+        n - first <= columns * 4 || !(xmax > xmin))
+        return false;
+
+    build(x, y);
+    if (!m_sorted)
+        return false;
+
+    // the coarsest level with at least two buckets per column shown
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && ((n - first) >> (level + 2)) >= columns * 2)
+        ++level;
+    const auto& buckets = m_levels[level];
+    const auto size = static_cast<size_t>(2) << level;
+
+    const auto column = [&](size_t i)
+    {
+        // scaled before dividing, so samples on the edge of a column are not
+        // rounded into the previous one
+        const auto c = std::floor((x[i] - xmin) * columns / (xmax - xmin));
+        return static_cast<size_t>(std::clamp(c, 0.0, columns - 1.0));
+    };
+
+    std::vector<size_t> points;
+    points.reserve(columns * 4);
+
+    size_t current = 0;
+    size_t begin = 0;
+    size_t last = 0;
+    size_t min = 0;
+    size_t max = 0;
+
+    const auto flush = [&]()
+    {
+        size_t p[] = {begin, min, max, last};
+        std::sort(std::begin(p), std::end(p));
+        for (auto i : p)
+        {
+            if (points.empty() || points.back() != i)
+                points.push_back(i);
+        }
+    };
+
+    for (auto b = first / size; b < buckets.size(); ++b)
+    {
+        const auto start = std::max(b * size, first);
+        const auto end = std::min((b + 1) * size, n);
+
+        auto bucket = buckets[b];
+        if (start != b * size)
+        {
+            // the bucket starts with samples not shown
+            bucket = {start, start};
+            for (auto i = start; i < end; ++i)
+            {
+                if (y[i] < y[bucket.min])
+                    bucket.min = i;
+                if (y[i] > y[bucket.max])
+                    bucket.max = i;
+            }
+        }
+
+        const auto c = column(start);
+        if (start == first || c != current)
+        {
+            if (start != first)
+                flush();
+            current = c;
+            begin = start;
+            min = bucket.min;
+            max = bucket.max;
+        }
+        else
+        {
+            if (y[bucket.min] < y[min])
+                min = bucket.min;
+            if (y[bucket.max] > y[max])
+                max = bucket.max;
+        }
+        last = end - 1;
+    }
+    flush();
+
+    if (mode == ChartBase::Decimation::lttb)
+        lttb(x, y, points, columns);
+
+    outx.reserve(points.size());
+    outy.reserve(points.size());
+    for (auto i : points)
+    {
+        outx.push_back(x[i]);
+        outy.push_back(y[i]);
+    }
+
+    return true;
+}
+
+void Decimator::lttb(const std::vector<double>& x, const std::vector<double>& y,
+                     std::vector<size_t>& points, size_t threshold)
+{
+    if (threshold < 3 || points.size() <= threshold)
+        return;
+
+    std::vector<size_t> sampled;
+    sampled.reserve(threshold);
+    sampled.push_back(points.front());
+
+    const auto every = static_cast<double>(points.size() - 2) / (threshold - 2);
+    size_t a = 0;
+
+    for (size_t i = 0; i < threshold - 2; ++i)
+    {
+        // average of the next bucket
+        const auto avg_start = static_cast<size_t>((i + 1) * every) + 1;
+        const auto avg_end = std::min(static_cast<size_t>((i + 2) * every) + 1,
+                                      points.size());
+        double avg_x = 0;
+        double avg_y = 0;
+        for (auto j = avg_start; j < avg_end; ++j)
+        {
+            avg_x += x[points[j]];
+            avg_y += y[points[j]];
+        }
+        avg_x /= avg_end - avg_start;
+        avg_y /= avg_end - avg_start;
+
+        // the point of this bucket making the largest triangle
+        const auto ax = x[points[a]];
+        const auto ay = y[points[a]];
+        const auto range_start = static_cast<size_t>(i * every) + 1;
+        const auto range_end = static_cast<size_t>((i + 1) * every) + 1;
+        double max_area = -1;
+        auto next = range_start;
+        for (auto j = range_start; j < range_end; ++j)
+        {
+            const auto area = std::abs((ax - avg_x) * (y[points[j]] - ay) -
+                                       (ax - x[points[j]]) * (avg_y - ay));
+            if (area > max_area)
+            {
+                max_area = area;
+                next = j;
+            }
+        }
+
+        sampled.push_back(points[next]);
+        a = next;
+    }
+
+    sampled.push_back(points.back());
+    points = std::move(sampled);
+}
+
+}
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_CHARTS_DECIMATOR_H
+#define EGT_SRC_DETAIL_CHARTS_DECIMATOR_H
+
+#include "egt/chart.h"
+#include "egt/detail/meta.h"
+#include <cstddef>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Reduce the points of a chart to what can be seen at its width.
+ *
+ * A pyramid of the minimum and maximum of the samples is kept: each level
+ * holds buckets twice as large as the one below.  Decimating picks the level
+ * with a few buckets per pixel column, and keeps the first, lowest, highest
+ * and last point of each column, so the result looks the same as drawing all
+ * the points, for a cost proportional to the width instead of the number of
+ * samples.
+ *
+ * The pyramid is only extended when samples are appended, and samples before
+ * the first one shown are skipped, so it is kept when the oldest samples are
+ * dropped.  Samples must be sorted by x, otherwise they are not decimated.
+ */
+class EGT_API Decimator
+{
+public:
+
+    /// Tell the samples changed, starting from the sample at index from.
+    void invalidate(size_t from = 0);
+
+    /**
+     * Decimate samples for a chart columns pixels wide.
+     *
+     * @param[in] x,y Samples.
+     * @param[in] first Index of the first sample shown.
+     * @param[in] xmin,xmax Range of x shown.
+     * @param[in] columns Width of the chart, in pixels.
+     * @param[in] mode Decimation to use.
+     * @param[out] outx,outy Decimated samples.
+     * @return false if the samples are not decimated, and should all be drawn.
+     */
+    bool decimate(const std::vector<double>& x, const std::vector<double>& y,
+                  size_t first, double xmin, double xmax, size_t columns,
+                  ChartBase::Decimation mode,
+                  std::vector<double>& outx, std::vector<double>& outy);
+
+private:
+
+    /// Indexes of the lowest and highest sample of a bucket.
+    struct Bucket
+    {
+        size_t min;
+        size_t max;
+    };
+
+    /// Extend the pyramid to the samples.
+    void build(const std::vector<double>& x, const std::vector<double>& y);
+
+    /// Largest-triangle-three-buckets of the points selected by index.
+    static void lttb(const std::vector<double>& x, const std::vector<double>& y,
+                     std::vector<size_t>& points, size_t threshold);
+
+    /// Level n holds buckets of 2^(n+1) samples.
+    std::vector<std::vector<Bucket>> m_levels;
+
+    /// Number of samples the pyramid is valid for.
+    size_t m_valid{0};
+
+    /// Are the valid samples sorted by x.
+    bool m_sorted{true};
+};
+
+}
+}
+}
+
+#endif
@@ -6,9 +6,12 @@
 #define _USE_MATH_DEFINES
 #include "detail/egtlog.h"
 #include "detail/charts/plplotimpl.h"
+#include "detail/glyphatlas.h"
 #include "egt/app.h"
 #include "egt/canvas.h"
+#include "egt/detail/surfacepool.h"
 #include "egt/screen.h"
+#include <algorithm>
 #include <cmath>
 #include <type_traits>
 
@@ -66,12 +69,15 @@ inline bool change_if_diff(T1& first, T2& second, const T3& to)
 
 void PlPlotImpl::data(const ChartItemArray& data)
 {
+    compact();
+
     if (data.IsStringArray())
     {
         auto sdata = data.get_sdata();
         if (change_if_diff(m_ydata, m_sdata, sdata))
         {
             m_xdata.clear();
+            m_decimator.invalidate();
             plplot_verify_viewport();
             invoke_damage();
         }
@@ -82,6 +88,9 @@ void PlPlotImpl::data(const ChartItemArray& data)
         if (change_if_diff(m_xdata, m_ydata, cdata))
         {
             m_sdata.clear();
+            m_decimator.invalidate();
+            if (m_capacity && m_xdata.size() > m_capacity)
+                drop(m_xdata.size() - m_capacity);
             plplot_verify_viewport();
             invoke_damage();
         }
@@ -93,8 +102,8 @@ ChartItemArray PlPlotImpl::data() const
     ChartItemArray data;
     if (!m_xdata.empty() && (!m_ydata.empty()))
     {
-        int size = std::min(m_xdata.size(), m_ydata.size());
-        for (int i = 0; i < size; i++)
+        auto size = std::min(m_xdata.size(), m_ydata.size());
+        for (auto i = m_dropped; i < size; i++)
             data.add(m_xdata[i], m_ydata[i]);
     }
     else if (!m_ydata.empty() && (!m_sdata.empty()))
@@ -110,6 +119,7 @@ void PlPlotImpl::add_data(const ChartItemArray& data)
 {
     if ((!data.get_data().empty()) || (!data.get_sdata().empty()))
     {
+        compact();
 
         if (!data.IsStringArray())
         {
@@ -119,11 +129,17 @@ void PlPlotImpl::add_data(const ChartItemArray& data)
              */
             m_sdata.clear();
 
+            // only the new points are added to the decimation
+            m_decimator.invalidate(m_xdata.size());
+
             for (auto& elem : data.get_data())
             {
                 m_xdata.push_back(elem.first);
                 m_ydata.push_back(elem.second);
             }
+
+            if (m_capacity && m_xdata.size() > m_capacity)
+                drop(m_xdata.size() - m_capacity);
         }
         else
         {
@@ -132,6 +148,7 @@ void PlPlotImpl::add_data(const ChartItemArray& data)
              * exist together
              */
             m_xdata.clear();
+            m_decimator.invalidate();
 
             for (auto& elem : data.get_sdata())
             {
@@ -149,7 +166,7 @@ void PlPlotImpl::add_data(const ChartItemArray& data)
 size_t PlPlotImpl::data_size() const
 {
     if (!m_xdata.empty())
-        return m_xdata.size();
+        return m_xdata.size() - m_dropped;
 
     if (!m_sdata.empty())
         return m_sdata.size();
@@ -162,6 +179,16 @@ void PlPlotImpl::remove_data(uint32_t count)
     if (!count)
         return;
 
+    // the oldest points are only erased once enough are removed
+    if (!m_xdata.empty() && m_sdata.empty())
+    {
+        drop(std::min<size_t>(count, m_xdata.size() - m_dropped));
+        invoke_damage();
+        return;
+    }
+
+    compact();
+
     bool damage = false;
 
     if (!m_sdata.empty())
@@ -193,6 +220,7 @@ void PlPlotImpl::remove_data(uint32_t count)
 
     if (damage)
     {
+        m_decimator.invalidate();
         plplot_verify_viewport();
         invoke_damage();
     }
@@ -207,10 +235,127 @@ void PlPlotImpl::clear()
         m_xdata.clear();
         m_sdata.clear();
         m_ydata.clear();
+        m_dropped = 0;
+        m_decimator.invalidate();
         invoke_damage();
     }
 }
 
+void PlPlotImpl::push(const PLFLT* x, const PLFLT* y, size_t count)
+{
+    if (!count)
+        return;
+
+    // both m_sdata and m_xdata cannot exist together
+    if (!m_sdata.empty())
+    {
+        m_sdata.clear();
+        m_ydata.clear();
+        m_bounds_valid = false;
+    }
+
+    const auto previous = m_xdata.size() - m_dropped;
+    const auto dropped = m_dropped;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_xdata.push_back(x[i]);
+        m_ydata.push_back(y[i]);
+    }
+
+    if (m_capacity && m_xdata.size() - m_dropped > m_capacity)
+        drop(m_xdata.size() - m_dropped - m_capacity);
+
+    /*
+     * As long as the window does not change and no point is dropped, only
+     * the part of the plot from the previous last point to the new points
+     * changed.
+     */
+    const auto extend = m_bounds_valid && m_dropped == dropped && previous;
+    auto changed = false;
+    if (extend)
+    {
+        auto xmin = m_data_xmin;
+        auto xmax = m_data_xmax;
+        auto ymin = m_data_ymin;
+        auto ymax = m_data_ymax;
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_data_xmin = std::min(m_data_xmin, x[i]);
+            m_data_xmax = std::max(m_data_xmax, x[i]);
+            m_data_ymin = std::min(m_data_ymin, y[i]);
+            m_data_ymax = std::max(m_data_ymax, y[i]);
+        }
+
+        changed = !detail::float_equal(xmin, m_data_xmin) ||
+                  !detail::float_equal(xmax, m_data_xmax) ||
+                  !detail::float_equal(ymin, m_data_ymin) ||
+                  !detail::float_equal(ymax, m_data_ymax);
+        if (changed)
+            plplot_window();
+    }
+    else
+    {
+        m_bounds_valid = false;
+    }
+
+    if (!extend || changed || m_plot_area.empty())
+    {
+        invoke_damage();
+        return;
+    }
+
+    auto left = m_xdata[m_xdata.size() - count - 1];
+    auto right = left;
+    for (size_t i = 0; i < count; ++i)
+    {
+        left = std::min(left, x[i]);
+        right = std::max(right, x[i]);
+    }
+
+    const auto scale = m_plot_area.width() / (m_xmax - m_xmin);
+    const auto x0 = m_plot_area.x() + (left - m_xmin) * scale;
+    const auto x1 = m_plot_area.x() + (right - m_xmin) * scale;
+
+    invoke_damage(Rect(std::floor(x0) - m_plot_margin,
+                       m_plot_area.y() - m_plot_margin,
+                       std::ceil(x1 - x0) + 1 + m_plot_margin * 2,
+                       m_plot_area.height() + m_plot_margin * 2));
+}
+
+void PlPlotImpl::capacity(size_t count)
+{
+    if (!detail::change_if_diff<>(m_capacity, count))
+        return;
+
+    if (m_capacity && m_xdata.size() - m_dropped > m_capacity)
+    {
+        drop(m_xdata.size() - m_dropped - m_capacity);
+        invoke_damage();
+    }
+}
+
+void PlPlotImpl::drop(size_t count)
+{
+    m_dropped += count;
+    m_bounds_valid = false;
+
+    // erasing once as many points are dropped as are left costs O(1) per point
+    if (m_dropped >= m_xdata.size() - m_dropped)
+        compact();
+}
+
+void PlPlotImpl::compact()
+{
+    if (!m_dropped)
+        return;
+
+    m_xdata.erase(m_xdata.begin(), m_xdata.begin() + m_dropped);
+    m_ydata.erase(m_ydata.begin(), m_ydata.begin() + m_dropped);
+    m_dropped = 0;
+    m_decimator.invalidate();
+}
+
 void PlPlotImpl::title(const std::string& title)
 {
     if (detail::change_if_diff<>(m_title, title))
@@ -268,25 +413,38 @@ void PlPlotImpl::point_type(int ptype)
         invoke_damage();
 }
 
-/**
- * Plplot reports error while creating a viewport
- * if x_min & x_max and y_min & y_max values are
- * same. as workaround modifying these value's.
- */
 void PlPlotImpl::plplot_verify_viewport()
 {
-    if (!m_xdata.empty())
+    if (m_xdata.size() > m_dropped)
     {
-        m_xmin = std::round(*std::min_element(m_xdata.begin(), m_xdata.end()));
-        m_xmax = std::round(*std::max_element(m_xdata.begin(), m_xdata.end()));
+        const auto x = std::minmax_element(m_xdata.begin() + m_dropped, m_xdata.end());
+        m_data_xmin = *x.first;
+        m_data_xmax = *x.second;
     }
 
-    if (!m_ydata.empty())
+    if (m_ydata.size() > m_dropped)
     {
-        m_ymin = std::round(*std::min_element(m_ydata.begin(), m_ydata.end()));
-        m_ymax = std::round(*std::max_element(m_ydata.begin(), m_ydata.end()));
+        const auto y = std::minmax_element(m_ydata.begin() + m_dropped, m_ydata.end());
+        m_data_ymin = *y.first;
+        m_data_ymax = *y.second;
     }
 
+    m_bounds_valid = true;
+    plplot_window();
+}
+
+/**
+ * Plplot reports error while creating a viewport
+ * if x_min & x_max and y_min & y_max values are
+ * same. as workaround modifying these value's.
+ */
+void PlPlotImpl::plplot_window()
+{
+    m_xmin = std::round(m_data_xmin);
+    m_xmax = std::round(m_data_xmax);
+    m_ymin = std::round(m_data_ymin);
+    m_ymax = std::round(m_data_ymax);
+
     if (!detail::float_equal(m_bank, 0.0f))
     {
         auto xdiff = (m_xmax - m_xmin) * m_bank;
@@ -347,6 +505,49 @@ void PlPlotImpl::bank(float bank)
     }
 }
 
+void PlPlotImpl::decimation(ChartBase::Decimation mode)
+{
+    if (detail::change_if_diff<>(m_decimation, mode))
+        invoke_damage();
+}
+
+void PlPlotImpl::plplot_plot_area(const Rect& b)
+{
+    PLFLT xmin;
+    PLFLT xmax;
+    PLFLT ymin;
+    PLFLT ymax;
+    m_plstream->gvpd(xmin, xmax, ymin, ymax);
+
+    m_plot_area = Rect(b.x() + xmin * b.width(),
+                       b.y() + (1. - ymax) * b.height(),
+                       (xmax - xmin) * b.width(),
+                       (ymax - ymin) * b.height());
+
+    // lines and points may be drawn that far from their position
+    PLFLT def_ht;
+    PLFLT scale_ht;
+    m_plstream->gchr(def_ht, scale_ht);
+    m_plot_margin = std::ceil(std::max<PLFLT>(m_line_width, (scale_ht / 25.4) * 96.0)) + 1;
+}
+
+PLINT PlPlotImpl::plplot_points(const PLFLT*& x, const PLFLT*& y)
+{
+    if (m_decimator.decimate(m_xdata, m_ydata, m_dropped, m_xmin, m_xmax,
+                             m_plot_area.width(), m_decimation,
+                             m_xdecimated, m_ydecimated))
+    {
+        x = m_xdecimated.data();
+        y = m_ydecimated.data();
+        return m_xdecimated.size();
+    }
+
+    // the points are drawn from where they are stored
+    x = m_xdata.data() + m_dropped;
+    y = m_ydata.data() + m_dropped;
+    return m_xdata.size() - m_dropped;
+}
+
 void PlPlotImpl::plplot_box(bool xtick_label, bool ytick_label)
 {
     PLINT val = axis();
@@ -509,6 +710,9 @@ void PlPlotLineChart::draw(Painter& painter, const Rect& rect)
 
     auto b = m_interface.content_area();
 
+    if (!m_bounds_valid)
+        plplot_verify_viewport();
+
     if (!m_initalize)
     {
         m_plstream->spage(0, 0, b.width(), b.height(),  b.x(), b.y());
@@ -533,11 +737,13 @@ void PlPlotLineChart::draw(Painter& painter, const Rect& rect)
 
     plplot_viewport(size);
 
+    plplot_plot_area(b);
+
     m_plstream->wind(m_xmin, m_xmax, m_ymin, m_ymax);
 
     plplot_box(true, true);
 
-    if (m_xdata.size() > 1 && m_ydata.size() > 1)
+    if (m_xdata.size() > m_dropped + 1)
     {
         //set line style
         m_plstream->lsty(m_pattern <= 0 ? 1 : m_pattern);
@@ -547,8 +753,11 @@ void PlPlotLineChart::draw(Painter& painter, const Rect& rect)
 
         plplot_color(m_interface.color(Palette::ColorId::button_fg).first());
 
-        // plot
-        m_plstream->line(m_xdata.size(), m_xdata.data(), m_ydata.data());
+        // plot what can be seen at the width of the viewport
+        const PLFLT* x;
+        const PLFLT* y;
+        auto n = plplot_points(x, y);
+        m_plstream->line(n, x, y);
     }
 
     plplot_label(cr, b, m_interface.font(), m_interface.color(Palette::ColorId::label_text).first());
@@ -569,6 +778,9 @@ void PlPlotPointChart::draw(Painter& painter, const Rect& rect)
 
     auto b = m_interface.content_area();
 
+    if (!m_bounds_valid)
+        plplot_verify_viewport();
+
     if (!m_initalize)
     {
         m_plstream->spage(0, 0, b.width(), b.height(),  b.x(), b.y());
@@ -592,313 +804,594 @@ void PlPlotPointChart::draw(Painter& painter, const Rect& rect)
 
     plplot_viewport(m_interface.font().size());
 
+    plplot_plot_area(b);
+
     m_plstream->wind(m_xmin, m_xmax, m_ymin, m_ymax);
 
     plplot_box(true, true);
 
-    if (!m_xdata.empty() && !m_ydata.empty())
+    if (m_xdata.size() > m_dropped)
     {
         plplot_color(m_interface.color(Palette::ColorId::button_fg).first());
 
-        // draw points
-        m_plstream->poin(m_xdata.size(), m_xdata.data(), m_ydata.data(), m_pointtype);
+        // draw what can be seen at the width of the viewport
+        const PLFLT* x;
+        const PLFLT* y;
+        auto n = plplot_points(x, y);
+        m_plstream->poin(n, x, y, m_pointtype);
     }
 
     plplot_label(cr, b, m_interface.font(), m_interface.color(Palette::ColorId::label_text).first());
 }
 
-PlPlotBarChart::PlPlotBarChart(BarChart& iface)
-    : m_interface(iface)
-{
-}
-
-void PlPlotBarChart::plfbox(PLFLT x0, PLFLT y0)
+/**
+ * Colors of the bars and slices, the default color map 0 of PlPlot.
+ */
+static const Color& bar_color(size_t index)
 {
-    PLFLT x[4];
-    PLFLT y[4];
+    static const Color colors[] =
+    {
+        Color::rgb(0x000000), Color::rgb(0xff0000), Color::rgb(0xffff00), Color::rgb(0x00ff00),
+        Color::rgb(0x7fffd4), Color::rgb(0xffc0cb), Color::rgb(0xf5deb3), Color::rgb(0xbebebe),
+        Color::rgb(0xa52a2a), Color::rgb(0x0000ff), Color::rgb(0x8a2be2), Color::rgb(0x00ffff),
+        Color::rgb(0x40e0d0), Color::rgb(0xff00ff), Color::rgb(0xfa8072), Color::rgb(0xffffff),
+    };
 
-    x[0] = x0;
-    x[1] = x0;
-    x[2] = x0 + 1.;
-    x[3] = x0 + 1.;
-    y[0] = 0.;
-    y[1] = y0;
-    y[2] = y0;
-    y[3] = 0.;
-    m_plstream->fill(4, x, y);
-    m_plstream->width(m_line_width);
-    plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
-    m_plstream->lsty(1);
-    m_plstream->line(4, x, y);
+    return colors[index % (sizeof(colors) / sizeof(colors[0]))];
 }
 
-void PlPlotBarChart::draw(Painter& painter, const Rect& rect)
-{
-    detail::ignoreparam(rect);
-
-    m_interface.draw_box(painter, Palette::ColorId::bg,
-                         Palette::ColorId::border);
+/// Space between the lines of the patterns of PlPlot, 2mm at 96 dpi.
+static constexpr double PATTERN_SPACE = 2. / 25.4 * 96.;
 
-    auto b = m_interface.content_area();
+/**
+ * Fill a path with one of the patterns of PlPlot psty().
+ *
+ * Only solid, horizontal, vertical and horizontal with vertical lines are
+ * used by the charts.
+ */
+static void fill_pattern(cairo_t* cr, PLINT pattern, const Color& color, const RectF& bounds)
+{
+    cairo_set_source_rgba(cr, color.redf(), color.greenf(), color.bluef(), color.alphaf());
 
-    if (!m_initalize)
+    if (pattern <= 0)
     {
-        m_plstream->spage(0, 0, b.width(), b.height(),  b.x(), b.y());
-        m_plstream->init();
-        m_initalize = true;
+        cairo_fill(cr);
+        return;
     }
 
-    auto cr = painter.context();
+    cairo_save(cr);
+    cairo_clip(cr);
+    cairo_set_line_width(cr, 1);
 
-    painter.translate(b.point());
+    if (pattern == 1 || pattern == 7)
+    {
+        for (auto y = std::floor(bounds.y()) + 0.5; y < bounds.y() + bounds.height(); y += PATTERN_SPACE)
+        {
+            cairo_move_to(cr, bounds.x(), y);
+            cairo_line_to(cr, bounds.x() + bounds.width(), y);
+        }
+    }
 
-    m_plstream->cmd(PLESC_DEVINIT, cr.get());
+    if (pattern == 2 || pattern == 7)
+    {
+        for (auto x = std::floor(bounds.x()) + 0.5; x < bounds.x() + bounds.width(); x += PATTERN_SPACE)
+        {
+            cairo_move_to(cr, x, bounds.y());
+            cairo_line_to(cr, x, bounds.y() + bounds.height());
+        }
+    }
 
-    m_plstream->adv(0);
+    cairo_stroke(cr);
+    cairo_restore(cr);
+}
 
-    //set axis color.
-    plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
+bool PlPlotBarChart::Layout::operator==(const Layout& rhs) const
+{
+    return detail::float_equal(xmin, rhs.xmin) &&
+           detail::float_equal(xmax, rhs.xmax) &&
+           detail::float_equal(ymin, rhs.ymin) &&
+           detail::float_equal(ymax, rhs.ymax) &&
+           positions == rhs.positions &&
+           categories == rhs.categories &&
+           xlabel == rhs.xlabel &&
+           ylabel == rhs.ylabel &&
+           title == rhs.title &&
+           grid == rhs.grid &&
+           grid_width == rhs.grid_width &&
+           line_width == rhs.line_width &&
+           pattern == rhs.pattern;
+}
 
-    m_plstream->width(m_grid_width);
+PlPlotBarChart::PlPlotBarChart(BarChart& iface, bool horizontal)
+    : m_interface(iface),
+      m_horizontal(horizontal),
+      m_transition(iface, [this](const std::vector<AnimationBatch::Index>& changed)
+{
+    refresh(changed);
+})
+{
+}
 
-    plplot_viewport(m_interface.font().size());
+PlPlotBarChart::Layout PlPlotBarChart::layout() const
+{
+    Layout result;
 
-    if ((!m_ydata.empty()) && (!m_sdata.empty()))
+    if (!m_sdata.empty())
     {
-        std::size_t xmax = m_sdata.size() * 2;
-        m_plstream->wind(0.0, xmax, 0.0, m_ymax);
-
-        plplot_box(false, true);
+        // categories are laid out every two units, from zero
+        const auto count = static_cast<PLFLT>(m_sdata.size() * 2);
+        result.xmin = 0;
+        result.xmax = m_horizontal ? m_ymax : count;
+        result.ymin = 0;
+        result.ymax = m_horizontal ? count : m_ymax;
+        result.categories = m_sdata;
     }
     else
     {
-        m_plstream->wind(m_xmin, m_xmax, m_ymin, m_ymax);
-        plplot_box(true, true);
+        result.xmin = m_xmin;
+        result.xmax = m_xmax;
+        result.ymin = m_ymin;
+        result.ymax = m_ymax;
+        result.positions = m_horizontal ? m_ydata : m_xdata;
     }
 
-    if (!m_ydata.empty())
-    {
-        std::size_t n = m_ydata.size();
-        for (std::size_t i = 0; i < n; i++)
-        {
-            // set Bar color : using default colors from plplot
-            m_plstream->col0(i % 16);
+    result.xlabel = m_xlabel;
+    result.ylabel = m_ylabel;
+    result.title = m_title;
+    result.grid = m_grid;
+    result.grid_width = m_grid_width;
+    result.line_width = m_line_width;
+    result.pattern = m_pattern;
+    return result;
+}
 
-            // set Bar patterns : solid color or line patterns
-            m_plstream->psty(m_pattern);
+const std::vector<PLFLT>& PlPlotBarChart::values() const
+{
+    if (m_horizontal && m_sdata.empty())
+        return m_xdata;
 
-            if (!m_sdata.empty())
-            {
-                EGTLOG_TRACE("m_ydata[{}] = {} ", i, m_ydata.at(i));
-                plfbox((i * 2), m_ydata.at(i));
-
-                if (axis() >= 0)
-                {
-                    plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
-                    auto pos = static_cast<PLFLT>(i) / static_cast<PLFLT>(n);
-                    m_plstream->mtex("b", 1.0, pos, 0, m_sdata.at(i).c_str());
-                }
-            }
-            else if (!m_xdata.empty())
-            {
-                plfbox(m_xdata.at(i), m_ydata.at(i));
-            }
-        }
+    return m_ydata;
+}
+
+void PlPlotBarChart::invoke_damage()
+{
+    // the points are indexed from the first one stored
+    compact();
+    if (!m_bounds_valid)
+        plplot_verify_viewport();
+
+    auto layout = this->layout();
+    const auto same = m_transition.target(values()) && layout == m_layout;
+
+    if (!same || !m_axes)
+    {
+        // the bars are laid out again with the axes
+        m_layout = std::move(layout);
+        m_axes.reset();
+        m_interface.damage();
+        return;
     }
 
-    plplot_label(cr, b, m_interface.font(), m_interface.color(Palette::ColorId::label_text).first());
+    // values reaching their end at once are not reported by the transition
+    std::vector<AnimationBatch::Index> all(m_bars.size());
+    for (size_t i = 0; i < all.size(); ++i)
+        all[i] = i;
+    refresh(all);
 }
 
-PlPlotHBarChart::PlPlotHBarChart(HorizontalBarChart& iface)
-    : m_interface(iface)
+void PlPlotBarChart::resize()
 {
+    PlPlotImpl::resize();
+    m_axes.reset();
 }
 
-void PlPlotHBarChart::plfHbox(PLFLT x0, PLFLT y0)
+RectF PlPlotBarChart::bar(size_t index, PLFLT value) const
 {
-    PLFLT x[4];
-    PLFLT y[4];
+    // a bar is one unit wide, from the axis to its value
+    PLFLT position = !m_layout.categories.empty() ? index * 2. : m_layout.positions[index];
+
+    PLFLT x0 = position;
+    PLFLT x1 = position + 1.;
+    PLFLT y0 = 0;
+    PLFLT y1 = value;
+    if (m_horizontal)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
 
-    x[0] = 0;
-    x[1] = x0;
-    x[2] = x0;
-    x[3] = 0;
+    const auto area = m_plot_area;
+    const auto sx = area.width() / (m_layout.xmax - m_layout.xmin);
+    const auto sy = area.height() / (m_layout.ymax - m_layout.ymin);
 
-    y[0] = y0;
-    y[1] = y0;
-    y[2] = y0 + 1.;
-    y[3] = y0 + 1.;
+    auto left = area.x() + (std::min(x0, x1) - m_layout.xmin) * sx;
+    auto right = area.x() + (std::max(x0, x1) - m_layout.xmin) * sx;
+    auto top = area.y() + area.height() - (std::max(y0, y1) - m_layout.ymin) * sy;
+    auto bottom = area.y() + area.height() - (std::min(y0, y1) - m_layout.ymin) * sy;
 
-    m_plstream->fill(4, x, y);
-    m_plstream->width(m_line_width);
-    plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
-    m_plstream->lsty(1);
-    m_plstream->line(4, x, y);
+    // PlPlot clips what it draws to the viewport
+    left = detail::clamp<PLFLT>(left, area.x(), area.x() + area.width());
+    right = detail::clamp<PLFLT>(right, area.x(), area.x() + area.width());
+    top = detail::clamp<PLFLT>(top, area.y(), area.y() + area.height());
+    bottom = detail::clamp<PLFLT>(bottom, area.y(), area.y() + area.height());
+
+    return {static_cast<float>(left), static_cast<float>(top),
+            static_cast<float>(right - left), static_cast<float>(bottom - top)};
 }
 
-void PlPlotHBarChart::draw(Painter& painter, const Rect& rect)
+Rect PlPlotBarChart::bar_bounds(const RectF& bar) const
 {
-    detail::ignoreparam(rect);
+    const auto margin = m_line_width / 2. + 1.;
+    const auto left = std::floor(bar.x() - margin);
+    const auto top = std::floor(bar.y() - margin);
+    return {static_cast<DefaultDim>(left),
+            static_cast<DefaultDim>(top),
+            static_cast<DefaultDim>(std::ceil(bar.x() + bar.width() + margin) - left),
+            static_cast<DefaultDim>(std::ceil(bar.y() + bar.height() + margin) - top)};
+}
 
-    m_interface.draw_box(painter, Palette::ColorId::bg,
-                         Palette::ColorId::border);
+void PlPlotBarChart::refresh(const std::vector<AnimationBatch::Index>& changed)
+{
+    // a full damage is pending while the bars are not laid out
+    if (!m_axes || m_bars.size() != m_transition.size())
+        return;
 
-    auto b = m_interface.content_area();
+    const auto origin = m_interface.content_area().point();
+    const auto& shown = m_transition.shown();
+    for (auto i : changed)
+    {
+        if (i >= m_bars.size())
+            continue;
+
+        const auto moved = bar(i, shown[i]);
+        if (moved == m_bars[i])
+            continue;
+
+        m_interface.damage(Rect::merge(bar_bounds(m_bars[i]), bar_bounds(moved)) + origin);
+        m_bars[i] = moved;
+    }
+}
+
+void PlPlotBarChart::draw_axes(const Size& size)
+{
+    m_axes = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, size);
+    shared_cairo_t cr(cairo_create(m_axes.get()), cairo_destroy);
 
     if (!m_initalize)
     {
-        m_plstream->spage(0, 0, b.width(), b.height(),  b.x(), b.y());
+        m_plstream->spage(0, 0, size.width(), size.height(), 0, 0);
         m_plstream->init();
         m_initalize = true;
     }
 
-    auto cr = painter.context();
-
-    painter.translate(b.point());
-
     m_plstream->cmd(PLESC_DEVINIT, cr.get());
 
     m_plstream->adv(0);
 
     //set axis color.
-    plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
+    plplot_color(m_layer_line);
 
     m_plstream->width(m_grid_width);
 
-    plplot_viewport(m_interface.font().size());
+    plplot_viewport(m_layer_font.size());
 
-    if ((!m_sdata.empty()) && (!m_ydata.empty()))
+    plplot_plot_area(Rect(Point(), size));
+
+    m_plstream->wind(m_layout.xmin, m_layout.xmax, m_layout.ymin, m_layout.ymax);
+
+    if (!m_layout.categories.empty())
     {
-        m_plstream->wind(0.0, m_ymax, 0.0, (m_sdata.size() * 2));
-        plplot_box(true, false);
+        plplot_box(m_horizontal, !m_horizontal);
+
+        if (axis() >= 0)
+        {
+            const auto n = static_cast<PLFLT>(m_layout.categories.size());
+            for (size_t i = 0; i < m_layout.categories.size(); ++i)
+            {
+                const auto pos = static_cast<PLFLT>(i) / n;
+                if (m_horizontal)
+                    m_plstream->mtex("lv", 1.0, pos, 1, m_layout.categories[i].c_str());
+                else
+                    m_plstream->mtex("b", 1.0, pos, 0, m_layout.categories[i].c_str());
+            }
+        }
     }
     else
     {
-        m_plstream->wind(m_xmin, m_xmax, m_ymin, m_ymax);
         plplot_box(true, true);
     }
 
-    std::size_t n = m_ydata.size();
-    int i = 0;
-    for (auto& data : m_ydata)
+    plplot_label(cr, Rect(Point(), size), m_layer_font, m_layer_text);
+
+    const auto& shown = m_transition.shown();
+    m_bars.resize(m_transition.size());
+    for (size_t i = 0; i < m_bars.size(); ++i)
+        m_bars[i] = bar(i, shown[i]);
+}
+
+void PlPlotBarChart::draw(Painter& painter, const Rect& rect)
+{
+    m_interface.draw_box(painter, Palette::ColorId::bg,
+                         Palette::ColorId::border);
+
+    const auto b = m_interface.content_area();
+    if (b.empty())
+        return;
+
+    // the layer is drawn again if the font or the palette changed
+    const auto line = m_interface.color(Palette::ColorId::button_bg).first();
+    const auto text = m_interface.color(Palette::ColorId::label_text).first();
+    if (m_layer_font != m_interface.font() || m_layer_line != line || m_layer_text != text)
     {
-        // set HBar color
-        m_plstream->col0(i % 16);
+        m_layer_font = m_interface.font();
+        m_layer_line = line;
+        m_layer_text = text;
+        m_axes.reset();
+    }
 
-        // Set HBar pattern
-        m_plstream->psty(m_pattern);
+    if (!m_axes ||
+        cairo_image_surface_get_width(m_axes.get()) != b.width() ||
+        cairo_image_surface_get_height(m_axes.get()) != b.height())
+    {
+        if (!m_bounds_valid)
+            plplot_verify_viewport();
+        m_layout = layout();
+        m_transition.target(values());
+        draw_axes(b.size());
+    }
 
-        if (!m_sdata.empty())
-        {
-            // Draw HBar
-            plfHbox(data, (i * 2));
+    auto cr = painter.context().get();
+    Painter::AutoSaveRestore sr(painter);
 
-            //Set Y-axis text
-            if (axis() >= 0)
-            {
-                auto pos = static_cast<PLFLT>(i) / static_cast<PLFLT>(n);
-                m_plstream->mtex("lv", 1.0, pos, 1, m_sdata.at(i).c_str());
-            }
-        }
-        else
-        {
-            // Draw HBar
-            plfHbox(m_xdata.at(i), data);
-        }
-        ++i;
+    const auto axes = Rect::intersection(b, rect);
+    cairo_set_source_surface(cr, m_axes.get(), b.x(), b.y());
+    cairo_rectangle(cr, axes.x(), axes.y(), axes.width(), axes.height());
+    cairo_fill(cr);
+
+    cairo_translate(cr, b.x(), b.y());
+    cairo_set_line_width(cr, m_line_width);
+
+    const auto damaged = rect - b.point();
+    for (size_t i = 0; i < m_bars.size(); ++i)
+    {
+        const auto& r = m_bars[i];
+        if (!damaged.intersect(bar_bounds(r)))
+            continue;
+
+        cairo_rectangle(cr, r.x(), r.y(), r.width(), r.height());
+        fill_pattern(cr, m_pattern, bar_color(i), r);
+
+        cairo_rectangle(cr, r.x(), r.y(), r.width(), r.height());
+        cairo_set_source_rgba(cr, line.redf(), line.greenf(), line.bluef(), line.alphaf());
+        cairo_stroke(cr);
     }
+}
 
-    plplot_label(cr, b, m_interface.font(), m_interface.color(Palette::ColorId::label_text).first());
+PlPlotHBarChart::PlPlotHBarChart(HorizontalBarChart& iface)
+    : PlPlotBarChart(iface, true)
+{
 }
 
 PlPlotPieChart::PlPlotPieChart(PieChart& iface)
-    : m_interface(iface)
+    : m_interface(iface),
+      m_transition(iface, [this](const std::vector<AnimationBatch::Index>& changed)
+{
+    refresh(changed);
+})
 {
 }
 
-void PlPlotPieChart::draw(Painter& painter, const Rect& rect)
+void PlPlotPieChart::invoke_damage()
 {
-    detail::ignoreparam(rect);
+    static const std::vector<PLFLT> none;
 
-    m_interface.draw_box(painter, Palette::ColorId::bg,
-                         Palette::ColorId::border);
+    // slices are only drawn for labeled values
+    const auto& values = m_sdata.empty() ? none : m_ydata;
+    const auto same = m_transition.target(values) &&
+                      m_labels == m_sdata && m_layout_title == m_title;
 
-    auto b = m_interface.content_area();
+    if (!same || !m_valid)
+    {
+        m_valid = false;
+        m_interface.damage();
+        return;
+    }
 
-    if (!m_initalize)
+    // values reaching their end at once are not reported by the transition
+    refresh({0});
+}
+
+void PlPlotPieChart::resize()
+{
+    PlPlotImpl::resize();
+    m_valid = false;
+}
+
+PlPlotPieChart::Slice PlPlotPieChart::slice(size_t index, float start, float value) const
+{
+    Slice result;
+    result.start = start;
+    result.end = start + value / 100.f * 2.f * detail::pi<float>();
+
+    // points on the circle, in the content area, where y goes down
+    auto point = [this](float angle)
     {
-        m_plstream->spage(0, 0, b.width(), b.height(),  b.x(), b.y());
-        m_plstream->init();
-        m_initalize = true;
+        return PointF(m_center.x() + m_radius * std::cos(angle),
+                      m_center.y() - m_radius * std::sin(angle));
+    };
+
+    auto left = m_center.x();
+    auto right = m_center.x();
+    auto top = m_center.y();
+    auto bottom = m_center.y();
+    auto extend = [&](const PointF & p)
+    {
+        left = std::min(left, p.x());
+        right = std::max(right, p.x());
+        top = std::min(top, p.y());
+        bottom = std::max(bottom, p.y());
+    };
+
+    extend(point(result.start));
+    extend(point(result.end));
+    // the extremes of the circle the slice goes through
+    const auto quarter = detail::pi<float>() / 2.f;
+    for (auto angle = std::ceil(result.start / quarter) * quarter; angle < result.end; angle += quarter)
+        extend(point(angle));
+
+    const auto margin = m_line_width / 2.f + 1.f;
+    left -= margin;
+    top -= margin;
+    right += margin;
+    bottom += margin;
+
+    // the label is left of the slice on the left half of the circle
+    const auto middle = (result.start + result.end) / 2.f;
+    const auto& size = m_label_sizes[index];
+    const auto anchor = PointF(m_center.x() + m_radius * 1.08f * std::cos(middle),
+                               m_center.y() - m_radius * 1.08f * std::sin(middle));
+    const auto x = std::cos(middle) >= 0 ? anchor.x() : anchor.x() - size.width();
+    result.label = PointF(x, anchor.y() + size.height() / 2.f);
+
+    left = std::min(left, x);
+    right = std::max(right, x + size.width());
+    top = std::min(top, anchor.y() - size.height() / 2.f);
+    bottom = std::max(bottom, anchor.y() + size.height() / 2.f);
+
+    result.bounds = Rect(std::floor(left), std::floor(top),
+                         std::ceil(right) - std::floor(left),
+                         std::ceil(bottom) - std::floor(top));
+    return result;
+}
+
+void PlPlotPieChart::layout(const Size& size)
+{
+    m_size = size;
+    m_labels = m_sdata;
+    m_layout_title = m_title;
+    m_layout_font = m_interface.font();
+
+    cairo_font_extents_t fe;
+    cairo_scaled_font_extents(m_layout_font.scaled_font(), &fe);
+
+    m_label_sizes.clear();
+    for (const auto& label : m_labels)
+    {
+        cairo_text_extents_t te;
+        cairo_scaled_font_text_extents(m_layout_font.scaled_font(), label.c_str(), &te);
+        m_label_sizes.emplace_back(te.x_advance, fe.ascent);
     }
 
-    auto cr = painter.context();
+    // the title is centered above the pie
+    float top = 0;
+    m_title_bounds = {};
+    if (!m_title.empty())
+    {
+        cairo_text_extents_t te;
+        cairo_scaled_font_text_extents(m_layout_font.scaled_font(), m_title.c_str(), &te);
+        m_title_point = PointF((size.width() - te.x_advance) / 2., fe.ascent);
+        m_title_bounds = Rect(std::floor(m_title_point.x()), 0,
+                              std::ceil(te.x_advance) + 1, std::ceil(fe.height));
+        top = fe.height;
+    }
 
-    painter.translate(b.point());
+    m_center = PointF(size.width() / 2.f, top + (size.height() - top) / 2.f);
+    m_radius = std::max(0.f, std::min<float>(size.width(), size.height() - top) * 0.3f);
 
-    m_plstream->cmd(PLESC_DEVINIT, cr.get());
+    const auto& shown = m_transition.shown();
+    m_slices.resize(m_transition.size());
+    float start = 0;
+    for (size_t i = 0; i < m_slices.size(); ++i)
+    {
+        m_slices[i] = slice(i, start, shown[i]);
+        start = m_slices[i].end;
+    }
 
-    m_plstream->adv(0);
-    // Ensure window has aspect ratio of one so plotted as a circle.
-    m_plstream->vasp(1.0);
-    m_plstream->wind(0.1, 10.0, 0.1, 10.0);
+    m_valid = true;
+}
 
-    // get labels color & set title color
-    plplot_color(m_interface.color(Palette::ColorId::label_text).first());
+void PlPlotPieChart::refresh(const std::vector<AnimationBatch::Index>& changed)
+{
+    // a full damage is pending while the slices are not laid out
+    if (!m_valid || changed.empty() || m_slices.size() != m_transition.size())
+        return;
 
-    if ((!m_ydata.empty()) && (!m_sdata.empty()))
+    // the slices after the first one that changed start somewhere else
+    const auto first = *std::min_element(changed.begin(), changed.end());
+    const auto origin = m_interface.content_area().point();
+    const auto& shown = m_transition.shown();
+    float start = first ? m_slices[first - 1].end : 0.f;
+    for (auto i = first; i < m_slices.size(); ++i)
     {
-        int theta;
-        int theta0 = 0;
-        int color = 1;
-        int size = m_ydata.size();
-        for (int i = 0; i < size; i++)
-        {
-            std::vector<PLFLT> x;
-            std::vector<PLFLT> y;
-            x.push_back(5.);
-            y.push_back(5.);
+        const auto moved = slice(i, start, shown[i]);
+        start = moved.end;
 
-            int theta1 = theta0 + 5 * m_ydata.at(i);
-            if (i == size)
-                theta1 = 500;
+        if (detail::float_equal(moved.start, m_slices[i].start) &&
+            detail::float_equal(moved.end, m_slices[i].end))
+            continue;
 
-            for (theta = theta0; theta <= theta1; theta += 1)
-            {
-                x.push_back(5 + 3 * cos((2. * M_PI / 500.) * theta));
-                y.push_back(5 + 3 * sin((2. * M_PI / 500.) * theta));
-            }
+        m_interface.damage(Rect::merge(m_slices[i].bounds, moved.bounds) + origin);
+        m_slices[i] = moved;
+    }
+}
+
+void PlPlotPieChart::draw(Painter& painter, const Rect& rect)
+{
+    m_interface.draw_box(painter, Palette::ColorId::bg,
+                         Palette::ColorId::border);
 
-            m_plstream->col0(color++ % 16);
-            m_plstream->psty(m_pattern);
-            m_plstream->fill(x.size(), x.data(), y.data());
+    const auto b = m_interface.content_area();
+    if (b.empty())
+        return;
 
-            //Draw pie border
-            m_plstream->width(m_line_width);
-            // get line color
-            plplot_color(m_interface.color(Palette::ColorId::button_bg).first());
-            m_plstream->line(x.size(), x.data(), y.data());
+    if (!m_valid || m_size != b.size() || m_layout_font != m_interface.font())
+    {
+        const auto& values = m_sdata.empty() ? std::vector<PLFLT>() : m_ydata;
+        m_transition.target(values);
+        layout(b.size());
+    }
 
-            PLFLT just = (2. * M_PI / 500.) * (theta0 + theta1) / 2.;
-            PLFLT dx = .25 * cos(just);
-            PLFLT dy = .25 * sin(just);
+    auto cr = painter.context().get();
+    Painter::AutoSaveRestore sr(painter);
 
-            if ((theta0 + theta1) < 250 || (theta0 + theta1) > 750)
-                just = 0.;
-            else
-                just = 1.;
+    cairo_translate(cr, b.x(), b.y());
+    cairo_set_scaled_font(cr, m_layout_font.scaled_font());
 
-            // set pie label color
-            plplot_color(m_interface.color(Palette::ColorId::label_text).first());
+    const auto damaged = rect - b.point();
+    const auto line = m_interface.color(Palette::ColorId::button_bg).first();
+    const auto text = m_interface.color(Palette::ColorId::label_text).first();
 
-            //set pie label
-            m_plstream->ptex((x[x.size() / 2] + dx), (y[y.size() / 2] + dy), 1.0, 0.0, just, m_sdata.at(i).c_str());
-            theta0 = theta - 1;
-        }
+    if (!m_title.empty() && damaged.intersect(m_title_bounds))
+    {
+        cairo_set_source_rgba(cr, text.redf(), text.greenf(), text.bluef(), text.alphaf());
+        detail::show_text(cr, m_title, m_title_point.x(), m_title_point.y());
     }
 
-    plplot_label(cr, b, m_interface.font(), m_interface.color(Palette::ColorId::label_text).first());
+    cairo_set_line_width(cr, m_line_width);
 
+    for (size_t i = 0; i < m_slices.size(); ++i)
+    {
+        const auto& s = m_slices[i];
+        if (!damaged.intersect(s.bounds))
+            continue;
+
+        // counterclockwise, with y going down
+        cairo_move_to(cr, m_center.x(), m_center.y());
+        cairo_arc_negative(cr, m_center.x(), m_center.y(), m_radius, -s.start, -s.end);
+        cairo_close_path(cr);
+        const RectF bounds(m_center.x() - m_radius, m_center.y() - m_radius,
+                           m_radius * 2, m_radius * 2);
+        fill_pattern(cr, m_pattern, bar_color(i + 1), bounds);
+
+        cairo_move_to(cr, m_center.x(), m_center.y());
+        cairo_arc_negative(cr, m_center.x(), m_center.y(), m_radius, -s.start, -s.end);
+        cairo_close_path(cr);
+        cairo_set_source_rgba(cr, line.redf(), line.greenf(), line.bluef(), line.alphaf());
+        cairo_stroke(cr);
+
+        cairo_set_source_rgba(cr, text.redf(), text.greenf(), text.bluef(), text.alphaf());
+        detail::show_text(cr, m_labels[i], s.label.x(), s.label.y());
+    }
 }
 
 } // end of namespace detail
@@ -6,6 +6,8 @@
 #ifndef EGT_SRC_DETAIL_CHARTS_PLPLOTIMPL_H
 #define EGT_SRC_DETAIL_CHARTS_PLPLOTIMPL_H
 
+#include "detail/charts/decimator.h"
+#include "detail/charts/transition.h"
 #include "egt/chart.h"
 #include "egt/painter.h"
 #include <memory>
@@ -50,6 +52,15 @@ public:
 
     void clear();
 
+    void push(const PLFLT* x, const PLFLT* y, size_t count);
+
+    void capacity(size_t count);
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
     void grid_style(ChartBase::GridFlag flag);
 
     ChartBase::GridFlag grid_style() const
@@ -109,8 +120,21 @@ public:
         return m_bank;
     }
 
+    void decimation(ChartBase::Decimation mode);
+
+    ChartBase::Decimation decimation() const
+    {
+        return m_decimation;
+    }
+
     virtual void invoke_damage() = 0;
 
+    virtual void invoke_damage(const Rect& rect)
+    {
+        detail::ignoreparam(rect);
+        invoke_damage();
+    }
+
     virtual ~PlPlotImpl();
 
 protected:
@@ -150,8 +174,12 @@ protected:
 
     void plplot_color(const Color& color);
 
+    /// Find the range of the points, then set the window.
     void plplot_verify_viewport();
 
+    /// Set the window from the range of the points.
+    void plplot_window();
+
     void plplot_viewport(PLFLT size);
 
     void plplot_box(bool xtick_label, bool ytick_label);
@@ -159,6 +187,47 @@ protected:
     void plplot_label(const shared_cairo_t& cr, Rect b, const Font& font, const Color& color);
 
     float m_bank{0};
+
+    /// Save where the viewport is drawn, in the content area b.
+    void plplot_plot_area(const Rect& b);
+
+    /**
+     * Get the data points to draw.
+     *
+     * @param[out] x,y Points to draw.
+     * @return Number of points to draw.
+     */
+    PLINT plplot_points(const PLFLT*& x, const PLFLT*& y);
+
+    /// Drop the oldest points.
+    void drop(size_t count);
+
+    /// Erase the points dropped from m_xdata and m_ydata.
+    void compact();
+
+    /// Maximum number of points, or 0.
+    size_t m_capacity{0};
+
+    /// Points dropped at the start of m_xdata and m_ydata, not yet erased.
+    size_t m_dropped{0};
+
+    /// Range of the points, valid if m_bounds_valid.
+    PLFLT m_data_xmin{0};
+    PLFLT m_data_xmax{0};
+    PLFLT m_data_ymin{0};
+    PLFLT m_data_ymax{0};
+    bool m_bounds_valid{false};
+
+    /// Where the viewport was last drawn.
+    Rect m_plot_area;
+
+    /// How far from the viewport lines and points may be drawn.
+    DefaultDim m_plot_margin{0};
+
+    ChartBase::Decimation m_decimation{ChartBase::Decimation::minmax};
+    Decimator m_decimator;
+    std::vector<PLFLT> m_xdecimated;
+    std::vector<PLFLT> m_ydecimated;
 };
 
 class PlPlotLineChart: public PlPlotImpl
@@ -173,6 +242,11 @@ public:
         m_interface.damage();
     }
 
+    void invoke_damage(const Rect& rect) override
+    {
+        m_interface.damage(rect);
+    }
+
 protected:
     LineChart& m_interface;
 };
@@ -189,48 +263,114 @@ public:
         m_interface.damage();
     }
 
+    void invoke_damage(const Rect& rect) override
+    {
+        m_interface.damage(rect);
+    }
+
 protected:
     PointChart& m_interface;
 };
 
+/**
+ * Bars drawn natively, over axes drawn by PlPlot.
+ *
+ * The axes, the grid and the labels are drawn by PlPlot into a layer, only
+ * when the window, the categories, the labels, the style or the size change.
+ * The rectangle of each bar is cached, and when only values change the bars
+ * move to them with a ValueTransition, damaging only the bars that moved.
+ */
 class PlPlotBarChart: public PlPlotImpl
 {
 public:
-    explicit PlPlotBarChart(BarChart& iface);
+    explicit PlPlotBarChart(BarChart& iface, bool horizontal = false);
 
     void draw(Painter& painter, const Rect& rect) override;
 
-    void invoke_damage() override
-    {
-        m_interface.damage();
-    }
+    void invoke_damage() override;
 
-protected:
-    void plfbox(PLFLT x0, PLFLT y0);
+    void resize() override;
+
+    /// Transition of the values of the bars.
+    ValueTransition& transition() { return m_transition; }
 
 protected:
+
+    /// Everything the chart is laid out from, but the values of the bars.
+    struct Layout
+    {
+        /// Window, in the order of PlPlot wind().
+        PLFLT xmin{0};
+        PLFLT xmax{0};
+        PLFLT ymin{0};
+        PLFLT ymax{0};
+        /// Positions of the bars, empty for categories.
+        std::vector<PLFLT> positions;
+        std::vector<std::string> categories;
+        std::string xlabel;
+        std::string ylabel;
+        std::string title;
+        ChartBase::GridFlag grid{ChartBase::GridFlag::none};
+        PLINT grid_width{0};
+        PLINT line_width{0};
+        PLINT pattern{0};
+
+        bool operator==(const Layout& rhs) const;
+    };
+
+    /// Get the layout of the data and the style of the chart.
+    EGT_NODISCARD Layout layout() const;
+
+    /// Get the values of the bars.
+    EGT_NODISCARD const std::vector<PLFLT>& values() const;
+
+    /// Draw the axes layer, and lay out the bars in it.
+    void draw_axes(const Size& size);
+
+    /// Get the rectangle of a bar, relative to the content area.
+    EGT_NODISCARD RectF bar(size_t index, PLFLT value) const;
+
+    /// Area damaged by a bar, relative to the content area.
+    EGT_NODISCARD Rect bar_bounds(const RectF& bar) const;
+
+    /// Move the bars that changed, and damage them.
+    void refresh(const std::vector<AnimationBatch::Index>& changed);
+
     BarChart& m_interface;
-};
 
-class PlPlotHBarChart: public PlPlotImpl
-{
-public:
-    explicit PlPlotHBarChart(HorizontalBarChart& iface);
+    /// Bars are horizontal, with their values along x.
+    bool m_horizontal{false};
 
-    void draw(Painter& painter, const Rect& rect) override;
+    ValueTransition m_transition;
 
-    void invoke_damage() override
-    {
-        m_interface.damage();
-    }
+    /// Layout the axes layer and the bars are drawn for.
+    Layout m_layout;
 
-protected:
-    void plfHbox(PLFLT x0, PLFLT y0);
+    /// Axes, grid and labels layer, the size of the content area.
+    shared_cairo_surface_t m_axes;
 
-protected:
-    HorizontalBarChart& m_interface;
+    /// Bars, at the values shown, valid with m_axes.
+    std::vector<RectF> m_bars;
+
+    /// Font and colors the layer was drawn with.
+    Font m_layer_font;
+    Color m_layer_line;
+    Color m_layer_text;
+};
+
+class PlPlotHBarChart: public PlPlotBarChart
+{
+public:
+    explicit PlPlotHBarChart(HorizontalBarChart& iface);
 };
 
+/**
+ * Pie drawn natively.
+ *
+ * The angles, bounds and label positions of the slices are cached, and when
+ * only values change the slices move to them with a ValueTransition,
+ * damaging only the slices that moved.  Values are percents of the circle.
+ */
 class PlPlotPieChart: public PlPlotImpl
 {
 public:
@@ -239,13 +379,62 @@ public:
 
     void draw(Painter& painter, const Rect& rect) override;
 
-    void invoke_damage() override
-    {
-        m_interface.damage();
-    }
+    void invoke_damage() override;
+
+    void resize() override;
+
+    /// Transition of the values of the slices.
+    ValueTransition& transition() { return m_transition; }
 
 protected:
+
+    /// Geometry of a slice, relative to the content area.
+    struct Slice
+    {
+        /// Angles, counterclockwise from the right, in radians.
+        float start{0};
+        float end{0};
+        /// Baseline of the label.
+        PointF label;
+        /// Area covered by the slice and its label.
+        Rect bounds;
+    };
+
+    /// Lay out the pie and all the slices for the content area.
+    void layout(const Size& size);
+
+    /// Get the geometry of a slice.
+    EGT_NODISCARD Slice slice(size_t index, float start, float value) const;
+
+    /// Move the slices from the first one that changed, and damage them.
+    void refresh(const std::vector<AnimationBatch::Index>& changed);
+
     PieChart& m_interface;
+
+    ValueTransition m_transition;
+
+    /// Are the slices laid out.
+    bool m_valid{false};
+
+    /// Size of the content area the slices are laid out for.
+    Size m_size;
+
+    PointF m_center;
+    float m_radius{0};
+
+    /// Labels and title the slices are laid out for.
+    std::vector<std::string> m_labels;
+    std::string m_layout_title;
+    Font m_layout_font;
+
+    /// Size of each label.
+    std::vector<SizeF> m_label_sizes;
+
+    /// Baseline of the title, relative to the content area.
+    PointF m_title_point;
+    Rect m_title_bounds;
+
+    std::vector<Slice> m_slices;
 };
 
 } // end of namespace detail
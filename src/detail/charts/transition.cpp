@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/charts/transition.h"
+#include "egt/app.h"
+#include "egt/detail/math.h"
+#include <algorithm>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+ValueTransition::ValueTransition(Widget& widget, ChangeCallback callback)
+    : m_batch(easing_cubic_easeinout)
+{
+    m_batch.on_change(std::move(callback));
+    m_batch.bind(widget);
+}
+
+std::chrono::milliseconds ValueTransition::effective() const
+{
+    // nothing steps the batch without an event loop
+    if (!Application::check_instance())
+        return {};
+
+    return m_duration;
+}
+
+bool ValueTransition::target(const std::vector<double>& values)
+{
+    const auto duration = effective();
+    const auto resized = values.size() != m_targets.size();
+
+    if (resized)
+    {
+        // indexes of the batch follow the values after adding all of them again
+        const auto& current = m_batch.values();
+        const std::vector<EasingScalar> shown(current.begin(),
+                                              current.begin() + std::min(current.size(), values.size()));
+
+        m_batch.clear();
+        m_targets.assign(values.begin(), values.end());
+        for (size_t i = 0; i < m_targets.size(); ++i)
+            m_batch.add(i < shown.size() ? shown[i] : 0.f, m_targets[i], duration);
+    }
+    else
+    {
+        for (size_t i = 0; i < m_targets.size(); ++i)
+        {
+            const auto value = static_cast<EasingScalar>(values[i]);
+            if (detail::float_equal(m_targets[i], value))
+                continue;
+
+            m_targets[i] = value;
+            m_batch.restart(i, m_batch.value(i), value, duration);
+        }
+    }
+
+    if (m_batch.pending() && !m_batch.running())
+        m_batch.start();
+
+    return !resized;
+}
+
+}
+}
+}
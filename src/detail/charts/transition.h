@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_CHARTS_TRANSITION_H
+#define EGT_SRC_DETAIL_CHARTS_TRANSITION_H
+
+#include "egt/animation.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Values of a chart shown on the way to the values it holds.
+ *
+ * When a value changes, the value shown moves to it over the duration of the
+ * transition, stepped by the shared animation ticker.  All the values move
+ * in one AnimationBatch, and each step reports the indexes of the values
+ * shown that changed, so only their part of the chart is drawn again.
+ *
+ * Without an Application, or with a duration of zero, changes are
+ * shown at once.
+ */
+class ValueTransition
+{
+public:
+
+    /// Callback with the indexes of the values shown that changed.
+    using ChangeCallback = std::function<void(const std::vector<AnimationBatch::Index>& changed)>;
+
+    /**
+     * @param[in] widget The chart, the values are not moved while it cannot
+     *            be seen.
+     * @param[in] callback Called for each step of the transition.
+     */
+    ValueTransition(Widget& widget, ChangeCallback callback);
+
+    /**
+     * Move to new values.
+     *
+     * Values at the same index move from the value shown, new values move
+     * from zero, and the values past the new size are dropped at once.
+     * Values reaching their end at once, without a transition, are not
+     * reported to the callback.
+     *
+     * @return false if the number of values changed.
+     */
+    bool target(const std::vector<double>& values);
+
+    /// Get the values shown, by index.
+    EGT_NODISCARD const std::vector<EasingScalar>& shown() const { return m_batch.values(); }
+
+    /// Get the number of values.
+    EGT_NODISCARD size_t size() const { return m_targets.size(); }
+
+    /// Set the duration of the transition.
+    void duration(std::chrono::milliseconds duration) { m_duration = duration; }
+
+    /// Get the duration of the transition.
+    EGT_NODISCARD std::chrono::milliseconds duration() const { return m_duration; }
+
+    /// Returns true while values are moving.
+    EGT_NODISCARD bool running() const { return m_batch.pending() != 0; }
+
+private:
+
+    /// Duration of the transition for a change, zero if it cannot run.
+    EGT_NODISCARD std::chrono::milliseconds effective() const;
+
+    /// Values held by the chart.
+    std::vector<EasingScalar> m_targets;
+
+    /// Values shown, one per index.
+    AnimationBatch m_batch;
+
+    /// Duration of the transition.
+    std::chrono::milliseconds m_duration{250};
+};
+
+}
+}
+}
+
+#endif
@@ -13,19 +13,53 @@ inline namespace v1
 namespace detail
 {
 
+/// Images without alpha are opaque everywhere.
+static inline bool has_alpha(cairo_surface_t* image)
+{
+    assert(cairo_image_surface_get_format(image) == CAIRO_FORMAT_ARGB32 ||
+           cairo_surface_get_content(image) == CAIRO_CONTENT_COLOR);
+    return cairo_image_surface_get_format(image) == CAIRO_FORMAT_ARGB32;
+}
+
+/// Is any pixel of an image, at its origin, inside area opaque.
+static bool any_opaque(const Rect& origin, cairo_surface_t* image, const Rect& area)
+{
+    if (!has_alpha(image))
+        return true;
+
+    const auto data = reinterpret_cast<unsigned int*>(cairo_image_surface_get_data(image));
+    const auto pitch = cairo_image_surface_get_stride(image) / sizeof(uint32_t);
+
+    for (auto y = area.top(); y < area.bottom(); y++)
+    {
+        for (auto x = area.left(); x < area.right(); x++)
+        {
+            const auto p = data[static_cast<uint32_t>((x - origin.left()) + (y - origin.top()) * pitch)];
+            if ((p >> 24u) & 0xffu)
+                return true;
+        }
+    }
+
+    return false;
+}
+
 bool alpha_collision(const Rect& lhs, cairo_surface_t* limage,
                      const Rect& rhs, cairo_surface_t* rimage)
 {
     if (lhs.intersect(rhs))
     {
-        assert(cairo_image_surface_get_format(limage) == CAIRO_FORMAT_ARGB32);
-        assert(cairo_image_surface_get_format(rimage) == CAIRO_FORMAT_ARGB32);
+        const auto i = Rect::intersection(lhs, rhs);
+
+        if (!has_alpha(limage))
+            return any_opaque(rhs, rimage, i);
+
+        if (!has_alpha(rimage))
+            return any_opaque(lhs, limage, i);
 
         const auto ldata = reinterpret_cast<unsigned int*>(cairo_image_surface_get_data(limage));
         const auto rdata = reinterpret_cast<unsigned int*>(cairo_image_surface_get_data(rimage));
         const auto lpitch = cairo_image_surface_get_stride(limage) / sizeof(uint32_t);
         const auto rpitch = cairo_image_surface_get_stride(rimage) / sizeof(uint32_t);
-        const auto i = Rect::intersection(lhs, rhs);
 
         for (auto y = i.top(); y < i.bottom(); y++)
         {
@@ -50,7 +84,8 @@ bool alpha_collision(const Rect& lhs, cairo_surface_t* limage,
 {
     if (lhs.intersect(rhs))
     {
-        assert(cairo_image_surface_get_format(limage) == CAIRO_FORMAT_ARGB32);
+        if (!has_alpha(limage))
+            return true;
 
         const auto ldata = reinterpret_cast<unsigned int*>(cairo_image_surface_get_data(limage));
         const auto pitch = cairo_image_surface_get_stride(limage) / sizeof(uint32_t);
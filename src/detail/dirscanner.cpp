@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/dirscanner.h"
+#include "detail/egtlog.h"
+#include "detail/priorityqueue.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fnmatch.h>
+#include <iterator>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static bool before(const DirectoryEntry& lhs, const DirectoryEntry& rhs)
+{
+    if (lhs.directory != rhs.directory)
+        return lhs.directory;
+    return lhs.name < rhs.name;
+}
+
+DirectoryScanner::Snapshot::~Snapshot() noexcept
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (fd >= 0 && wd >= 0)
+        inotify_rm_watch(fd, wd);
+#endif
+}
+
+DirectoryScanner::DirectoryScanner(EventLoop& loop, Callback callback)
+    : m_loop(loop),
+      m_callback(std::move(callback))
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0)
+    {
+        EGTLOG_DEBUG("inotify unavailable, directories are not cached");
+        return;
+    }
+
+    m_inotify_stream = std::make_unique<asio::posix::stream_descriptor>(loop.io(), m_inotify);
+    wait_changes();
+#endif
+}
+
+void DirectoryScanner::scan(const std::string& path)
+{
+    start(path, false);
+}
+
+void DirectoryScanner::filter(const std::string& pattern)
+{
+    if (m_pattern == pattern)
+        return;
+
+    m_pattern = pattern;
+    if (!m_path.empty())
+        start(m_path, false);
+}
+
+void DirectoryScanner::clear()
+{
+    cancel();
+    m_path.clear();
+    m_listing.reset();
+    m_complete = false;
+}
+
+const DirectoryListing& DirectoryScanner::listing() const
+{
+    static const DirectoryListing empty;
+    return m_listing ? *m_listing : empty;
+}
+
+void DirectoryScanner::start(const std::string& path, bool keep)
+{
+    cancel();
+    m_path = path;
+
+    auto cached = m_cache.find(path);
+    if (cached && (*cached)->pattern == m_pattern)
+    {
+        m_listing = (*cached)->listing;
+        m_complete = true;
+        if (m_callback)
+            m_callback();
+        return;
+    }
+
+    // a cached listing with another filter watches the same directory
+    m_cache.erase(path);
+
+    if (!keep)
+    {
+        m_listing.reset();
+        m_complete = false;
+        if (m_callback)
+            m_callback();
+    }
+
+    auto scan = std::make_shared<Scan>();
+    scan->path = path;
+    scan->pattern = m_pattern;
+    m_scan = scan;
+
+    // watched before reading, so changes while reading are seen
+    const auto wd = watch(path);
+    if (wd >= 0)
+        m_snapshot = std::make_shared<Snapshot>(m_inotify, wd);
+
+    auto& loop = m_loop;
+    m_work = m_loop.submit([&loop, this, scan]()
+    {
+        run(loop, this, scan);
+    }, nullptr, EventLoop::WorkPriority::high);
+}
+
+void DirectoryScanner::run(EventLoop& loop, DirectoryScanner* self,
+                           const std::shared_ptr<Scan>& scan)
+{
+    DirectoryListing listing;
+    DirectoryListing batch;
+    batch.reserve(BATCH);
+
+    // batches are sorted, then merged, so the listing is always sorted
+    auto merge = [&listing, &batch]()
+    {
+        std::sort(batch.begin(), batch.end(), before);
+        const auto middle = listing.size();
+        listing.insert(listing.end(),
+                       std::make_move_iterator(batch.begin()),
+                       std::make_move_iterator(batch.end()));
+        std::inplace_merge(listing.begin(), listing.begin() + middle,
+                           listing.end(), before);
+        batch.clear();
+    };
+
+    std::error_code ec;
+    fs::directory_iterator i(scan->path, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && i != fs::directory_iterator(); i.increment(ec))
+    {
+        if (scan->cancelled.load(std::memory_order_relaxed))
+            return;
+
+        std::error_code type_ec;
+        DirectoryEntry entry{i->path().filename().string(), i->is_directory(type_ec)};
+        if (!entry.directory && !scan->pattern.empty() &&
+            fnmatch(scan->pattern.c_str(), entry.name.c_str(), 0) != 0)
+            continue;
+
+        batch.push_back(std::move(entry));
+        if (batch.size() == BATCH)
+        {
+            merge();
+            post(loop, self, scan, listing, false);
+        }
+    }
+
+    if (ec)
+        EGTLOG_DEBUG("unable to list {}: {}", scan->path, ec.message());
+
+    merge();
+    post(loop, self, scan, std::move(listing), true);
+}
+
+void DirectoryScanner::post(EventLoop& loop, DirectoryScanner* self,
+                            const std::shared_ptr<Scan>& scan,
+                            DirectoryListing listing, bool complete)
+{
+    auto pending = std::make_shared<const DirectoryListing>(std::move(listing));
+
+    std::lock_guard<std::mutex> lock(scan->mutex);
+    scan->pending = std::move(pending);
+    scan->pending_complete = complete;
+
+    // one post until the event loop takes it, later batches replace it
+    if (scan->posted)
+        return;
+    scan->posted = true;
+
+    asio::post(loop.io(), loop.queue().wrap(priorities::background, [self, scan]()
+    {
+        // cancelled in the event loop, so self is still there otherwise
+        if (!scan->cancelled.load(std::memory_order_relaxed))
+            self->take(scan);
+    }, self));
+}
+
+void DirectoryScanner::take(const std::shared_ptr<Scan>& scan)
+{
+    {
+        std::lock_guard<std::mutex> lock(scan->mutex);
+        m_listing = std::move(scan->pending);
+        m_complete = scan->pending_complete;
+        scan->posted = false;
+    }
+
+    if (m_complete)
+    {
+        m_work = 0;
+        m_scan.reset();
+
+        if (m_snapshot && !scan->stale)
+        {
+            m_snapshot->pattern = scan->pattern;
+            m_snapshot->listing = m_listing;
+            m_cache.insert(scan->path, std::move(m_snapshot));
+        }
+        m_snapshot.reset();
+    }
+
+    if (m_callback)
+        m_callback();
+}
+
+void DirectoryScanner::cancel()
+{
+    if (m_scan)
+    {
+        m_scan->cancelled.store(true, std::memory_order_relaxed);
+        m_scan.reset();
+    }
+
+    if (m_work)
+    {
+        m_loop.cancel(m_work);
+        m_work = 0;
+    }
+
+    m_snapshot.reset();
+}
+
+int DirectoryScanner::watch(const std::string& path)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (m_inotify >= 0)
+    {
+        return inotify_add_watch(m_inotify, path.c_str(),
+                                 IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                 IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    }
+#else
+    detail::ignoreparam(path);
+#endif
+    return -1;
+}
+
+void DirectoryScanner::wait_changes()
+{
+    m_inotify_stream->async_read_some(asio::buffer(m_inotify_buffer),
+                                      m_loop.queue().wrap(priorities::background,
+                                              [this](const asio::error_code & error, std::size_t bytes)
+    {
+        if (error)
+            return;
+
+        changed(bytes);
+        wait_changes();
+    }, this));
+}
+
+void DirectoryScanner::changed(size_t bytes)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    std::vector<int> changes;
+    bool overflow = false;
+    for (size_t offset = 0; offset + sizeof(inotify_event) <= bytes;)
+    {
+        inotify_event event;
+        memcpy(&event, m_inotify_buffer.data() + offset, sizeof(event));
+        offset += sizeof(event) + event.len;
+
+        if (event.mask & IN_Q_OVERFLOW)
+            overflow = true;
+        else if (!(event.mask & IN_IGNORED))
+            changes.push_back(event.wd);
+    }
+
+    auto changed = [&changes, overflow](int wd)
+    {
+        return overflow || std::find(changes.begin(), changes.end(), wd) != changes.end();
+    };
+
+    if (m_snapshot && changed(m_snapshot->wd) && m_scan)
+        m_scan->stale = true;
+
+    std::vector<std::string> dropped;
+    for (const auto& entry : m_cache)
+    {
+        if (changed(entry.value->wd))
+            dropped.push_back(entry.key);
+    }
+
+    for (const auto& path : dropped)
+    {
+        EGTLOG_DEBUG("{} changed", path);
+        m_cache.erase(path);
+
+        // list again the directory shown, keeping it shown meanwhile
+        if (path == m_path && m_complete)
+            start(m_path, true);
+    }
+#else
+    detail::ignoreparam(bytes);
+#endif
+}
+
+DirectoryScanner::~DirectoryScanner() noexcept
+{
+    cancel();
+
+    // watches are removed before inotify is closed
+    m_cache.clear();
+
+    m_loop.queue().cancel(this);
+    m_inotify_stream.reset();
+}
+
+}
+}
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_DIRSCANNER_H
+#define EGT_SRC_DETAIL_DIRSCANNER_H
+
+#include "egt/detail/lrucache.h"
+#include "egt/detail/meta.h"
+#include "egt/eventloop.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <egt/asio.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Entry of a directory listing.
+ */
+struct DirectoryEntry
+{
+    /// Name of the entry.
+    std::string name;
+    /// Is the entry a directory.
+    bool directory{false};
+};
+
+/**
+ * Entries of a directory, directories first, then sorted by name.
+ */
+using DirectoryListing = std::vector<DirectoryEntry>;
+
+/**
+ * Lists directories on a worker thread.
+ *
+ * Reading a directory of thousands of files, i.e. on a USB stick, takes
+ * seconds.  Instead, a worker thread reads it, filters and sorts the
+ * entries, and posts the listing read so far to the event loop every BATCH
+ * entries, so it is shown while the rest is read.  Batches the event loop
+ * did not take yet are replaced by the next one.
+ *
+ * Complete listings of the last directories are cached, and dropped when
+ * inotify reports a change in the directory.  A change in the directory
+ * listed lists it again.
+ */
+class DirectoryScanner : private NonCopyable<DirectoryScanner>
+{
+public:
+
+    /// Number of entries read between two posts of the listing.
+    static constexpr size_t BATCH = 256;
+
+    /// Number of directories cached.
+    static constexpr size_t CACHED = 8;
+
+    /// Called in the event loop when the listing changed.
+    using Callback = std::function<void()>;
+
+    /**
+     * @param[in] loop The event loop listings are posted to.
+     * @param[in] callback Called when the listing changed.
+     */
+    DirectoryScanner(EventLoop& loop, Callback callback);
+
+    /**
+     * List a directory, instead of the one being listed.
+     *
+     * The listing is emptied, unless the directory is cached.
+     */
+    void scan(const std::string& path);
+
+    /**
+     * Only list the files matching a shell wildcard pattern, like "*.png".
+     *
+     * Directories are always listed.  An empty pattern lists all files.
+     * This lists the directory again.
+     */
+    void filter(const std::string& pattern);
+
+    /// Get the filter pattern.
+    EGT_NODISCARD const std::string& filter() const { return m_pattern; }
+
+    /// Stop listing, and empty the listing.
+    void clear();
+
+    /// Get the listing, complete or read so far.
+    EGT_NODISCARD const DirectoryListing& listing() const;
+
+    /// Returns true if the listing is complete.
+    EGT_NODISCARD bool complete() const { return m_complete; }
+
+    ~DirectoryScanner() noexcept;
+
+private:
+
+    /// State of a scan, shared with its worker thread.
+    struct Scan
+    {
+        std::string path;
+        std::string pattern;
+        /// Set in the event loop to stop the worker.
+        std::atomic<bool> cancelled{false};
+        /// Set when the directory changed while it was read.
+        bool stale{false};
+
+        std::mutex mutex;
+        /// Listing posted and not taken by the event loop yet.
+        std::shared_ptr<const DirectoryListing> pending;
+        bool pending_complete{false};
+        bool posted{false};
+    };
+
+    /// A cached listing, watching its directory until dropped.
+    struct Snapshot
+    {
+        Snapshot(int fd, int wd) noexcept
+            : fd(fd), wd(wd)
+        {}
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        ~Snapshot() noexcept;
+
+        int fd;
+        int wd;
+        std::string pattern;
+        std::shared_ptr<const DirectoryListing> listing;
+    };
+
+    /// Read a directory, on a worker thread.
+    static void run(EventLoop& loop, DirectoryScanner* self,
+                    const std::shared_ptr<Scan>& scan);
+
+    /// Post a listing to the event loop, from a worker thread.
+    static void post(EventLoop& loop, DirectoryScanner* self,
+                     const std::shared_ptr<Scan>& scan,
+                     DirectoryListing listing, bool complete);
+
+    /// Take the listing posted, in the event loop.
+    void take(const std::shared_ptr<Scan>& scan);
+
+    /// Start listing a directory, keeping the current listing until then.
+    void start(const std::string& path, bool keep);
+
+    /// Stop the worker of the current scan.
+    void cancel();
+
+    /// Watch a directory for changes, -1 on error.
+    int watch(const std::string& path);
+
+    /// Wait for inotify events.
+    void wait_changes();
+
+    /// Handle inotify events.
+    void changed(size_t bytes);
+
+    EventLoop& m_loop;
+    Callback m_callback;
+    std::string m_path;
+    std::string m_pattern;
+
+    std::shared_ptr<Scan> m_scan;
+    EventLoop::WorkHandle m_work{0};
+    std::shared_ptr<const DirectoryListing> m_listing;
+    bool m_complete{false};
+
+    LruCache<std::string, std::shared_ptr<Snapshot>> m_cache{0, CACHED};
+    /// Snapshot of the directory being read, cached once complete.
+    std::shared_ptr<Snapshot> m_snapshot;
+
+    int m_inotify{-1};
+    std::unique_ptr<asio::posix::stream_descriptor> m_inotify_stream;
+    std::array<char, 4096> m_inotify_buffer{};
+};
+
+}
+}
+}
+
+#endif
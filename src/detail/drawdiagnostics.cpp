@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/fmt.h"
+#include "egt/detail/drawdiagnostics.h"
+#include "egt/painter.h"
+#include "egt/widget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Damage recorded before it is drawn.
+static constexpr size_t MAX_PENDING = 1024;
+
+/// Writes of each pixel of a surface in the current frame.
+struct Heat
+{
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> counts;
+    bool used{false};
+};
+
+/// Damage blamed on a widget, with the pixels under it before drawing.
+struct PendingDamage
+{
+    std::string name;
+    const Screen* screen;
+    Rect rect;
+    std::vector<unsigned char> before;
+};
+
+/// Layouts of a widget in the current frame.
+struct LayoutCount
+{
+    std::string name;
+    uint64_t count{0};
+};
+
+struct DrawDiagnostics::DrawDiagnosticsImpl
+{
+    std::unordered_map<const cairo_surface_t*, Heat> heat;
+    /// Surface a window is drawing on, and its heat.
+    cairo_surface_t* target{nullptr};
+    Heat* current{nullptr};
+    std::vector<PendingDamage> pending;
+    std::unordered_map<const Widget*, LayoutCount> layouts;
+    /// Tint painted over the damage, see paint_overdraw().
+    unique_cairo_surface_t overlay;
+};
+
+static size_t pixel_bytes(cairo_surface_t* surface)
+{
+    switch (cairo_image_surface_get_format(surface))
+    {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+        return 4;
+    case CAIRO_FORMAT_RGB16_565:
+        return 2;
+    case CAIRO_FORMAT_A8:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static Rect surface_rect(cairo_surface_t* surface)
+{
+    return {0, 0, cairo_image_surface_get_width(surface),
+            cairo_image_surface_get_height(surface)};
+}
+
+/// Copy the pixels of a rectangle of an image surface.
+static void read_rect(cairo_surface_t* surface, const Rect& rect,
+                      std::vector<unsigned char>& out)
+{
+    const auto bytes = pixel_bytes(surface);
+    const auto stride = cairo_image_surface_get_stride(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    const auto row = rect.width() * bytes;
+
+    out.resize(row * rect.height());
+    for (auto y = 0; y < rect.height(); ++y)
+        std::memcpy(out.data() + y * row,
+                    data + (rect.y() + y) * stride + rect.x() * bytes, row);
+}
+
+/// Compare the pixels of a rectangle of an image surface.
+static bool same_rect(cairo_surface_t* surface, const Rect& rect,
+                      const std::vector<unsigned char>& before)
+{
+    const auto bytes = pixel_bytes(surface);
+    const auto stride = cairo_image_surface_get_stride(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    const auto row = rect.width() * bytes;
+
+    for (auto y = 0; y < rect.height(); ++y)
+    {
+        if (std::memcmp(before.data() + y * row,
+                        data + (rect.y() + y) * stride + rect.x() * bytes, row))
+            return false;
+    }
+
+    return true;
+}
+
+DrawDiagnostics& DrawDiagnostics::instance()
+{
+    static const std::unique_ptr<DrawDiagnostics> i(new DrawDiagnostics());
+    return *i;
+}
+
+DrawDiagnostics::DrawDiagnostics()
+    : m_impl(std::make_unique<DrawDiagnosticsImpl>())
+{
+    const auto overdraw = std::getenv("EGT_OVERDRAW_ENABLE");
+    if (overdraw && strlen(overdraw))
+        m_overdraw = true;
+
+    const auto report = std::getenv("EGT_DRAW_REPORT");
+    if (report && strlen(report))
+        m_report = true;
+
+    update_enabled();
+}
+
+DrawDiagnostics::~DrawDiagnostics() noexcept = default;
+
+void DrawDiagnostics::update_enabled()
+{
+    m_enabled.store(m_overdraw || m_report, std::memory_order_relaxed);
+}
+
+void DrawDiagnostics::overdraw(bool enable)
+{
+    m_overdraw = enable;
+    update_enabled();
+}
+
+void DrawDiagnostics::report(bool enable)
+{
+    m_report = enable;
+    if (!enable)
+    {
+        m_impl->pending.clear();
+        m_impl->layouts.clear();
+    }
+    update_enabled();
+}
+
+double DrawDiagnostics::average_overdraw() const
+{
+    return m_written_pixels ? static_cast<double>(m_writes) / m_written_pixels : 0.;
+}
+
+void DrawDiagnostics::reset()
+{
+    m_impl->pending.clear();
+    m_impl->layouts.clear();
+    m_widgets.clear();
+    m_frames = 0;
+    m_writes = 0;
+    m_written_pixels = 0;
+    m_max_overdraw = 0;
+}
+
+void DrawDiagnostics::damaged(const Widget& widget, const Screen& screen, const Rect& rect)
+{
+    if (!m_report || rect.empty())
+        return;
+
+    auto& pending = m_impl->pending;
+    if (pending.size() >= MAX_PENDING)
+        return;
+
+    const auto& origin = m_origin ? *m_origin : widget;
+    pending.push_back({origin.name(), &screen, rect, {}});
+}
+
+void DrawDiagnostics::laid_out(const Widget& widget)
+{
+    if (!m_report)
+        return;
+
+    auto& layout = m_impl->layouts[&widget];
+    if (!layout.count)
+        layout.name = widget.name();
+    ++layout.count;
+}
+
+void DrawDiagnostics::begin_draw(Screen& screen)
+{
+    auto& impl = *m_impl;
+    impl.target = nullptr;
+    impl.current = nullptr;
+
+    auto target = cairo_get_target(screen.context().get());
+    if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE ||
+        !pixel_bytes(target))
+        return;
+
+    cairo_surface_flush(target);
+
+    const auto bounds = surface_rect(target);
+    auto& heat = impl.heat[target];
+    if (heat.width != bounds.width() || heat.height != bounds.height())
+    {
+        heat.width = bounds.width();
+        heat.height = bounds.height();
+        heat.counts.assign(static_cast<size_t>(heat.width) * heat.height, 0);
+    }
+    heat.used = true;
+
+    impl.target = target;
+    impl.current = &heat;
+
+    if (!m_report)
+        return;
+
+    for (auto& pending : impl.pending)
+    {
+        if (pending.screen != &screen)
+            continue;
+
+        pending.rect = Rect::intersection(pending.rect, bounds);
+        if (!pending.rect.empty())
+            read_rect(target, pending.rect, pending.before);
+    }
+}
+
+void DrawDiagnostics::drawn(Painter& painter, const Rect& rect, const Widget& widget)
+{
+    auto cr = painter.context().get();
+
+    double x0;
+    double y0;
+    double x1;
+    double y1;
+    cairo_clip_extents(cr, &x0, &y0, &x1, &y1);
+    x0 = std::max<double>(x0, rect.left());
+    y0 = std::max<double>(y0, rect.top());
+    x1 = std::min<double>(x1, rect.right());
+    y1 = std::min<double>(y1, rect.bottom());
+
+    if (x0 >= x1 || y0 >= y1)
+    {
+        if (m_report)
+            ++m_widgets[widget.name()].hidden_draws;
+        return;
+    }
+
+    auto& impl = *m_impl;
+    if (!impl.current || cairo_get_target(cr) != impl.target)
+        return;
+
+    cairo_user_to_device(cr, &x0, &y0);
+    cairo_user_to_device(cr, &x1, &y1);
+
+    auto& heat = *impl.current;
+    const auto left = std::max(0, static_cast<int>(std::floor(std::min(x0, x1))));
+    const auto top = std::max(0, static_cast<int>(std::floor(std::min(y0, y1))));
+    const auto right = std::min(heat.width, static_cast<int>(std::ceil(std::max(x0, x1))));
+    const auto bottom = std::min(heat.height, static_cast<int>(std::ceil(std::max(y0, y1))));
+
+    for (auto y = top; y < bottom; ++y)
+    {
+        auto count = heat.counts.data() + static_cast<size_t>(y) * heat.width;
+        for (auto x = left; x < right; ++x)
+        {
+            if (count[x] != 255)
+                ++count[x];
+        }
+    }
+}
+
+void DrawDiagnostics::end_draw(Screen& screen)
+{
+    auto& impl = *m_impl;
+
+    if (m_report)
+    {
+        auto& pending = impl.pending;
+        for (auto i = pending.begin(); i != pending.end();)
+        {
+            if (i->screen != &screen)
+            {
+                ++i;
+                continue;
+            }
+
+            if (impl.target && !i->rect.empty() && !i->before.empty())
+            {
+                cairo_surface_flush(impl.target);
+                if (same_rect(impl.target, i->rect, i->before))
+                {
+                    auto& stats = m_widgets[i->name];
+                    ++stats.unchanged_damage;
+                    stats.unchanged_pixels += i->rect.area();
+                    EGTLOG_DEBUG("{} damaged {} without changing it", i->name, i->rect);
+                }
+            }
+
+            i = pending.erase(i);
+        }
+    }
+
+    impl.target = nullptr;
+    impl.current = nullptr;
+}
+
+void DrawDiagnostics::paint_overdraw(cairo_t* cr, cairo_surface_t* surface,
+                                     const Screen::DamageArray& damage) const
+{
+    auto& impl = *m_impl;
+    const auto i = impl.heat.find(surface);
+    if (i == impl.heat.end() || !i->second.used)
+        return;
+
+    const auto& heat = i->second;
+    auto& overlay = impl.overlay;
+    if (!overlay ||
+        cairo_image_surface_get_width(overlay.get()) != heat.width ||
+        cairo_image_surface_get_height(overlay.get()) != heat.height)
+    {
+        overlay.reset(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, heat.width, heat.height));
+    }
+
+    // premultiplied, half transparent: none, blue, green, pink, red
+    static const uint32_t tints[] =
+    {
+        0x00000000,
+        0x00000000,
+        0x80000080,
+        0x80008000,
+        0x80803c5a,
+        0x80800000,
+    };
+
+    cairo_surface_flush(overlay.get());
+    const auto stride = cairo_image_surface_get_stride(overlay.get());
+    const auto data = cairo_image_surface_get_data(overlay.get());
+    const Rect bounds(0, 0, heat.width, heat.height);
+
+    cairo_save(cr);
+    for (const auto& d : damage)
+    {
+        const auto rect = Rect::intersection(d, bounds);
+        if (rect.empty())
+            continue;
+
+        for (auto y = rect.top(); y < rect.bottom(); ++y)
+        {
+            auto count = heat.counts.data() + static_cast<size_t>(y) * heat.width;
+            auto pixel = reinterpret_cast<uint32_t*>(data + y * stride);
+            for (auto x = rect.left(); x < rect.right(); ++x)
+                pixel[x] = tints[std::min<size_t>(count[x], 5)];
+        }
+
+        cairo_rectangle(cr, rect.x(), rect.y(), rect.width(), rect.height());
+    }
+    cairo_surface_mark_dirty(overlay.get());
+
+    cairo_set_source_surface(cr, overlay.get(), 0, 0);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
+void DrawDiagnostics::end_frame()
+{
+    auto& impl = *m_impl;
+
+    for (const auto& layout : impl.layouts)
+    {
+        if (layout.second.count > 1)
+        {
+            auto& stats = m_widgets[layout.second.name];
+            ++stats.relayout_frames;
+            stats.max_layouts = std::max(stats.max_layouts, layout.second.count);
+            EGTLOG_DEBUG("{} laid out {} times in a frame", layout.second.name,
+                         layout.second.count);
+        }
+    }
+    impl.layouts.clear();
+
+    auto drawn = false;
+    for (auto& entry : impl.heat)
+    {
+        auto& heat = entry.second;
+        if (!heat.used)
+            continue;
+
+        for (auto& count : heat.counts)
+        {
+            if (count)
+            {
+                m_writes += count;
+                ++m_written_pixels;
+                m_max_overdraw = std::max<uint32_t>(m_max_overdraw, count);
+                count = 0;
+            }
+        }
+
+        heat.used = false;
+        drawn = true;
+    }
+
+    if (drawn)
+        ++m_frames;
+}
+
+void DrawDiagnostics::write_report(std::ostream& out) const
+{
+    out << fmt::format("{} frames, {:.2f} writes per pixel drawn, at most {}\n",
+                       m_frames, average_overdraw(), m_max_overdraw);
+
+    std::vector<std::pair<std::string, WidgetStats>> widgets(m_widgets.begin(), m_widgets.end());
+    auto waste = [](const WidgetStats & stats)
+    {
+        return stats.unchanged_damage + stats.relayout_frames + stats.hidden_draws;
+    };
+    std::stable_sort(widgets.begin(), widgets.end(),
+                     [&waste](const std::pair<std::string, WidgetStats>& lhs,
+                              const std::pair<std::string, WidgetStats>& rhs)
+    {
+        return waste(lhs.second) > waste(rhs.second);
+    });
+
+    out << fmt::format("{:<32} {:>10} {:>12} {:>10} {:>8} {:>8}\n", "widget",
+                       "unchanged", "pixels", "relayouts", "max", "hidden");
+    for (const auto& widget : widgets)
+    {
+        const auto& stats = widget.second;
+        out << fmt::format("{:<32} {:>10} {:>12} {:>10} {:>8} {:>8}\n", widget.first,
+                           stats.unchanged_damage, stats.unchanged_pixels,
+                           stats.relayout_frames, stats.max_layouts,
+                           stats.hidden_draws);
+    }
+}
+
+void DrawDiagnostics::write_report(const std::string& filename) const
+{
+    std::ofstream out(filename);
+    if (!out.is_open())
+        throw std::runtime_error(fmt::format("unable to open report file: {}", filename));
+
+    write_report(out);
+    EGTLOG_INFO("wrote draw report to {}", filename);
+}
+
+}
+}
+}
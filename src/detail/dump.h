@@ -14,6 +14,7 @@
 #include "detail/fmt.h"
 #include <chrono>
 #include <iomanip>
+#include <type_traits>
 #include <vector>
 
 namespace egt
@@ -23,6 +24,21 @@ inline namespace v1
 namespace detail
 {
 
+/**
+ * Get the prefix of a code_timer().
+ *
+ * The prefix may be a callable returning it, so that it is only built when
+ * timing is enabled.
+ */
+template<class Prefix>
+inline auto code_timer_prefix(const Prefix& prefix)
+{
+    if constexpr (std::is_invocable<const Prefix&>::value)
+        return prefix();
+    else
+        return prefix;
+}
+
 template<class Prefix, class T>
 inline void code_timer(bool enable, const Prefix& prefix, T&& callback)
 {
@@ -35,7 +51,7 @@ inline void code_timer(bool enable, const Prefix& prefix, T&& callback)
         const auto end = std::chrono::steady_clock::now();
         const auto diff = end - start;
 
-        fmt::print("{} {}\n", prefix,
+        fmt::print("{} {}\n", code_timer_prefix(prefix),
                    std::chrono::duration<double, std::milli>(diff).count());
     }
     else
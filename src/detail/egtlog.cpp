@@ -4,6 +4,15 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/egtlog.h"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace egt
 {
@@ -11,16 +20,145 @@ inline namespace v1
 {
 namespace detail
 {
-static int l = EGTLOG_LEVEL_WARN;
+int current_loglevel = EGTLOG_LEVEL_WARN;
 
 void loglevel(int level)
 {
-    l = level;
+    current_loglevel = level;
 }
 
-int loglevel()
+/**
+ * Ring of log messages written by a thread.
+ */
+class AsyncLogger
+{
+public:
+
+    /// Number of messages the ring holds.
+    static constexpr size_t SLOTS = 512;
+    /// Maximum size of a message.
+    static constexpr size_t SLOT_SIZE = 256;
+
+    AsyncLogger()
+        : m_thread([this]() { run(); })
+    {}
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+    AsyncLogger(AsyncLogger&&) = delete;
+    AsyncLogger& operator=(AsyncLogger&&) = delete;
+
+    void push(const char* data, size_t size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_count == SLOTS)
+        {
+            m_dropped++;
+            return;
+        }
+
+        auto& slot = m_slots[(m_head + m_count) % SLOTS];
+        slot.size = std::min(size, SLOT_SIZE);
+        std::memcpy(slot.data.data(), data, slot.size);
+        // keep the newline of truncated messages
+        slot.data[slot.size - 1] = '\n';
+
+        // the thread only sleeps on an empty ring
+        if (m_count++ == 0)
+        {
+            lock.unlock();
+            m_cv.notify_one();
+        }
+    }
+
+    ~AsyncLogger() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+private:
+
+    void run()
+    {
+        std::vector<char> out;
+        out.reserve(SLOTS * SLOT_SIZE);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(lock, [this]() { return m_count || m_stop; });
+            if (!m_count && m_stop)
+                break;
+
+            // take the messages, and write them without holding the lock
+            out.clear();
+            for (; m_count; m_count--)
+            {
+                const auto& slot = m_slots[m_head];
+                out.insert(out.end(), slot.data.data(), slot.data.data() + slot.size);
+                m_head = (m_head + 1) % SLOTS;
+            }
+            const auto dropped = m_dropped;
+            m_dropped = 0;
+            lock.unlock();
+
+            if (dropped)
+                fmt::print("[{} log messages dropped]\n", dropped);
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+
+            lock.lock();
+        }
+    }
+
+    struct Slot
+    {
+        std::array<char, SLOT_SIZE> data;
+        size_t size{0};
+    };
+
+    std::array<Slot, SLOTS> m_slots{};
+    size_t m_head{0};
+    size_t m_count{0};
+    uint64_t m_dropped{0};
+    bool m_stop{false};
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+static std::unique_ptr<AsyncLogger>& async_logger()
+{
+    static std::unique_ptr<AsyncLogger> logger;
+    return logger;
+}
+
+void log_async(bool enable)
+{
+    auto& logger = async_logger();
+    if (enable && !logger)
+        logger = std::make_unique<AsyncLogger>();
+    else if (!enable)
+        logger.reset();
+}
+
+bool log_async()
+{
+    return !!async_logger();
+}
+
+void log_write(const char* data, size_t size)
 {
-    return l;
+    auto& logger = async_logger();
+    if (logger)
+        logger->push(data, size);
+    else
+        std::fwrite(data, 1, size, stdout);
 }
 
 }
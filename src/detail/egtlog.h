@@ -14,6 +14,8 @@
 #include "detail/fmt.h"
 #include "egt/detail/meta.h"
 #include <chrono>
+#include <cstddef>
+#include <iterator>
 
 #define EGTLOG_LEVEL_TRACE 0
 #define EGTLOG_LEVEL_DEBUG 1
@@ -64,11 +66,37 @@ constexpr const char* loglevel_name(int level)
     return names[level];
 }
 
+/// Current log level, only read through loglevel().
+extern int current_loglevel;
+
 /// Set the log level.
 void loglevel(int level);
 
 /// Get the log level.
-int loglevel();
+inline int loglevel()
+{
+    return current_loglevel;
+}
+
+/**
+ * Write log messages from a thread.
+ *
+ * Formatted messages are copied to a ring of fixed size slots, and a thread
+ * writes them out, so logging never waits for the console or a slow serial
+ * line.  When the ring is full, messages are dropped and counted.  Messages
+ * longer than a slot are truncated.
+ *
+ * This is enabled at startup with the EGT_LOG_ASYNC environment variable.
+ *
+ * @note Switch it while no other thread logs.
+ */
+void log_async(bool enable);
+
+/// Returns true if log messages are written from a thread.
+bool log_async();
+
+/// Write a formatted log message, ending with a newline.
+void log_write(const char* data, size_t size);
 
 template<typename T>
 using basic_string_view_t = fmt::basic_string_view<T>;
@@ -83,8 +111,11 @@ void log(int level, const Args& ... args)
         auto t = std::chrono::steady_clock::now();
         auto ms = std::chrono::time_point_cast<std::chrono::milliseconds>(t);
         auto now = ms.time_since_epoch().count();
-        auto user = fmt::format(args...);
-        fmt::print("{} [{}] {}\n", now, loglevel_name(level), user);
+        fmt::memory_buffer buffer;
+        fmt::format_to(std::back_inserter(buffer), "{} [{}] ", now, loglevel_name(level));
+        fmt::format_to(std::back_inserter(buffer), args...);
+        buffer.push_back('\n');
+        log_write(buffer.data(), buffer.size());
     }
 }
 
@@ -109,9 +140,12 @@ void log(int level, const char* file, int line,
     {
         auto ms = std::chrono::time_point_cast<std::chrono::milliseconds>(t);
         auto now = ms.time_since_epoch().count();
-        auto user = fmt::format(args...);
-        fmt::print("{} [{}] {}:{} {}\n", now, loglevel_name(level),
-                   file_name(file), line, user);
+        fmt::memory_buffer buffer;
+        fmt::format_to(std::back_inserter(buffer), "{} [{}] {}:{} ", now,
+                       loglevel_name(level), file_name(file), line);
+        fmt::format_to(std::back_inserter(buffer), args...);
+        buffer.push_back('\n');
+        log_write(buffer.data(), buffer.size());
     }
 }
 
@@ -149,32 +183,44 @@ inline void error(string_view_t fmt, const Args& ... args)
 }
 }
 
+/**
+ * Log at a level, if the runtime log level allows it.
+ *
+ * The arguments, like the time, are only evaluated when the message is
+ * logged.  Levels below EGTLOG_ACTIVE_LEVEL are removed at compile time.
+ */
+#define EGTLOG_AT(level, ...) \
+    do { \
+        if (egt_unlikely(detail::loglevel() <= (level))) \
+            detail::log(level, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__); \
+    } while (0)
+
 #if EGTLOG_ACTIVE_LEVEL <= EGTLOG_LEVEL_TRACE
-#define EGTLOG_TRACE(...) detail::log(EGTLOG_LEVEL_TRACE, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__)
+#define EGTLOG_TRACE(...) EGTLOG_AT(EGTLOG_LEVEL_TRACE, __VA_ARGS__)
 #else
 #define EGTLOG_TRACE(...) (void)0
 #endif
 
 #if EGTLOG_ACTIVE_LEVEL <= EGTLOG_LEVEL_DEBUG
-#define EGTLOG_DEBUG(...) detail::log(EGTLOG_LEVEL_DEBUG, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__)
+#define EGTLOG_DEBUG(...) EGTLOG_AT(EGTLOG_LEVEL_DEBUG, __VA_ARGS__)
 #else
 #define EGTLOG_DEBUG(...) (void)0
 #endif
 
 #if EGTLOG_ACTIVE_LEVEL <= EGTLOG_LEVEL_INFO
-#define EGTLOG_INFO(...) detail::log(EGTLOG_LEVEL_INFO, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__)
+#define EGTLOG_INFO(...) EGTLOG_AT(EGTLOG_LEVEL_INFO, __VA_ARGS__)
 #else
 #define EGTLOG_INFO(...) (void)0
 #endif
 
 #if EGTLOG_ACTIVE_LEVEL <= EGTLOG_LEVEL_WARN
-#define EGTLOG_WARN(...) detail::log(EGTLOG_LEVEL_WARN, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__)
+#define EGTLOG_WARN(...) EGTLOG_AT(EGTLOG_LEVEL_WARN, __VA_ARGS__)
 #else
 #define EGTLOG_WARN(...) (void)0
 #endif
 
 #if EGTLOG_ACTIVE_LEVEL <= EGTLOG_LEVEL_ERROR
-#define EGTLOG_ERROR(...) detail::log(EGTLOG_LEVEL_ERROR, __FILE__, __LINE__, std::chrono::steady_clock::now(), __VA_ARGS__)
+#define EGTLOG_ERROR(...) EGTLOG_AT(EGTLOG_LEVEL_ERROR, __VA_ARGS__)
 #else
 #define EGTLOG_ERROR(...) (void)0
 #endif
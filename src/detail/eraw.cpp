@@ -3,8 +3,22 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "detail/eraw.h"
 #include "detail/erawimage.h"
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace egt
 {
@@ -13,8 +27,88 @@ inline namespace v1
 namespace detail
 {
 
+#ifdef HAVE_SYS_MMAN_H
+namespace
+{
+
+/// A mapped file, unmapped with the surface using it.
+struct ErawMapping
+{
+    void* map;
+    size_t len;
+};
+
+cairo_user_data_key_t mapping_key;
+
+void unmap_eraw(void* data)
+{
+    auto mapping = static_cast<ErawMapping*>(data);
+    munmap(mapping->map, mapping->len);
+    delete mapping;
+}
+
+/**
+ * Map the pixels of a raw ERAW file into a surface.
+ *
+ * The mapping is private, so the pages are shared with the page cache until
+ * written to, and can be reclaimed under memory pressure.
+ */
+shared_cairo_surface_t map_eraw(const std::string& filename)
+{
+    auto fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    uint32_t header[ErawImage::header_size() / sizeof(uint32_t)] {};
+    struct stat st {};
+    if (fstat(fd, &st) != 0 ||
+        pread(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        header[0] != ErawImage::egt_magic() ||
+        header[6] != static_cast<uint32_t>(ErawImage::Format::raw) ||
+        static_cast<size_t>(st.st_size) < ErawImage::raw_offset() +
+        ErawImage::raw_size(header[1], header[2]))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    const auto width = header[1];
+    const auto height = header[2];
+    const size_t len = st.st_size;
+    auto map = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return nullptr;
+
+    auto surface = shared_cairo_surface_t(
+                       cairo_image_surface_create_for_data(
+                           static_cast<unsigned char*>(map) + ErawImage::raw_offset(),
+                           CAIRO_FORMAT_ARGB32, width, height,
+                           width * sizeof(uint32_t)),
+                       cairo_surface_destroy);
+
+    auto mapping = new ErawMapping{map, len};
+    if (cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS ||
+        cairo_surface_set_user_data(surface.get(), &mapping_key,
+                                    mapping, unmap_eraw) != CAIRO_STATUS_SUCCESS)
+    {
+        unmap_eraw(mapping);
+        return nullptr;
+    }
+
+    return surface;
+}
+
+}
+#endif
+
 shared_cairo_surface_t load_eraw(const std::string& filename)
 {
+#ifdef HAVE_SYS_MMAN_H
+    if (auto surface = map_eraw(filename))
+        return surface;
+#endif
+
     return ErawImage::load(filename);
 }
 
@@ -23,6 +117,35 @@ shared_cairo_surface_t load_eraw(const unsigned char* buf, size_t len)
     return ErawImage::load(buf, len);
 }
 
+shared_cairo_surface_t load_eraw(const std::string& filename, const Rect& region)
+{
+#ifdef HAVE_SYS_MMAN_H
+    // only the mapped pages of the region are read
+    if (auto surface = map_eraw(filename))
+    {
+        const auto r = Rect::intersection(region,
+                                          Rect(0, 0,
+                                               cairo_image_surface_get_width(surface.get()),
+                                               cairo_image_surface_get_height(surface.get())));
+        if (r.empty())
+            return nullptr;
+        return ErawImage::copy_region(surface, r);
+    }
+#endif
+
+    std::ifstream i(filename, std::ios_base::binary);
+    if (!i)
+        return nullptr;
+    const std::vector<unsigned char> buf((std::istreambuf_iterator<char>(i)),
+                                         std::istreambuf_iterator<char>());
+    return ErawImage::load(buf.data(), buf.size(), region);
+}
+
+shared_cairo_surface_t load_eraw(const unsigned char* buf, size_t len, const Rect& region)
+{
+    return ErawImage::load(buf, len, region);
+}
+
 }
 }
 }
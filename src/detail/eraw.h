@@ -20,7 +20,10 @@ namespace detail
 /**
  * Load an ERAW file into a surface.
  *
- * @param[in] filename The path of the SVG file.
+ * An uncompressed ERAW file is memory mapped, and the surface uses the
+ * mapped pixels without copying them.
+ *
+ * @param[in] filename The path of the ERAW file.
  */
 shared_cairo_surface_t load_eraw(const std::string& filename);
 
@@ -33,6 +36,26 @@ shared_cairo_surface_t load_eraw(const std::string& filename);
 shared_cairo_surface_t load_eraw(const unsigned char* buf,
                                  size_t len);
 
+/**
+ * Load part of an ERAW file into a surface.
+ *
+ * Only the tiles of a tiled ERAW file overlapping the region are decoded.
+ *
+ * @param[in] filename The path of the ERAW file.
+ * @param[in] region Region of the image.
+ */
+shared_cairo_surface_t load_eraw(const std::string& filename, const Rect& region);
+
+/**
+ * Load part of an ERAW image into a surface.
+ *
+ * @param[in] buf Pointer to the in-memory data.
+ * @param[in] len Size of the data.
+ * @param[in] region Region of the image.
+ */
+shared_cairo_surface_t load_eraw(const unsigned char* buf,
+                                 size_t len, const Rect& region);
+
 }
 }
 }
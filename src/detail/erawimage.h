@@ -6,12 +6,16 @@
 #ifndef EGT_SRC_DETAIL_ERAWIMAGE_H
 #define EGT_SRC_DETAIL_ERAWIMAGE_H
 
+#include <algorithm>
 #include <cairo.h>
 #include <cstring>
 #include <egt/geometry.h>
 #include <egt/types.h>
 #include <fstream>
+#include <istream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 extern "C" {
     extern void* arm_memset32(uint32_t*, uint32_t, size_t);
@@ -82,6 +86,154 @@ private:
         return data + sizeof(T);
     }
 
+    static bool read_raw_data(std::istream& i, const shared_cairo_surface_t& surface,
+                              uint32_t width, uint32_t height)
+    {
+        // skip the padding after the header
+        i.seekg(raw_offset());
+        if (!i.read(reinterpret_cast<char*>(cairo_image_surface_get_data(surface.get())),
+                    raw_size(width, height)))
+            return false;
+
+        cairo_surface_mark_dirty(surface.get());
+        return true;
+    }
+
+    /// Decode run length encoded blocks until data reaches end.
+    static const unsigned char* read_blocks(const unsigned char* buf, const unsigned char* buf_end,
+                                            uint32_t* data, const uint32_t* end)
+    {
+        while (data < end)
+        {
+            alignas(4) uint16_t block = 0;
+            buf = readw(buf, block, buf_end);
+            if (!buf)
+                return nullptr;
+            if (block & 0x8000)
+            {
+                block &= 0x7fff;
+                alignas(4) uint32_t value = 0;
+                buf = readw(buf, value, buf_end);
+                if (!buf || data + block > end)
+                    return nullptr;
+                memset32(data, value, block);
+            }
+            else if (block)
+            {
+                if (buf + block * sizeof(uint32_t) > buf_end || data + block > end)
+                    return nullptr;
+
+                memcpy(data, buf, block * sizeof(uint32_t));
+                buf += (block * sizeof(uint32_t));
+            }
+            data += block;
+        }
+
+        return buf;
+    }
+
+    /// Encode pixels as run length encoded blocks, returning the bytes written.
+    static size_t write_blocks(std::ostream& o, uint32_t* offset, const uint32_t* end)
+    {
+        size_t length = 0;
+        while (offset < end)
+        {
+            uint32_t value = 0;
+            auto same = next_same_block(offset, end, value);
+            if (same)
+            {
+                offset += same;
+                same |= 0x8000;
+                o.write(reinterpret_cast<const char*>(&same), sizeof(same));
+                o.write(reinterpret_cast<const char*>(&value), sizeof(value));
+                length += sizeof(same) + sizeof(value);
+            }
+            else
+            {
+                auto diff = next_diff_block(offset, end);
+                if (diff)
+                {
+                    o.write(reinterpret_cast<const char*>(&diff), sizeof(diff));
+                    o.write(reinterpret_cast<const char*>(offset), diff * sizeof(uint32_t));
+                    length += sizeof(diff) + diff * sizeof(uint32_t);
+                    offset += diff;
+                }
+            }
+        }
+
+        return length;
+    }
+
+    /**
+     * Decode the tiles of a Format::tiled image that overlap region.
+     *
+     * buf points right after the header, where the tile size and the offsets
+     * of the tiles, from the start of the data, are stored.
+     */
+    static shared_cairo_surface_t read_tiled_data(const unsigned char* buf, const unsigned char* buf_end,
+            uint32_t width, uint32_t height, const Rect& region)
+    {
+        const auto start = buf - header_size();
+
+        alignas(4) uint32_t tile = 0;
+        buf = readw(buf, tile, buf_end);
+        if (!buf || !tile)
+            return nullptr;
+
+        const size_t columns = (width + tile - 1) / tile;
+        const size_t rows = (height + tile - 1) / tile;
+        const auto offsets = buf;
+        if (static_cast<size_t>(buf_end - offsets) < (columns * rows + 1) * sizeof(uint32_t))
+            return nullptr;
+
+        auto surface =
+            shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                   region.width(), region.height()),
+                                   cairo_surface_destroy);
+        const auto data = cairo_image_surface_get_data(surface.get());
+        const auto stride = cairo_image_surface_get_stride(surface.get());
+
+        std::vector<uint32_t> pixels(static_cast<size_t>(tile) * tile);
+
+        for (size_t row = region.y() / tile; row * tile < static_cast<size_t>(region.bottom()); ++row)
+        {
+            for (size_t column = region.x() / tile; column * tile < static_cast<size_t>(region.right()); ++column)
+            {
+                alignas(4) uint32_t begin = 0;
+                alignas(4) uint32_t end = 0;
+                const auto offset = offsets + (row * columns + column) * sizeof(uint32_t);
+                readw(offset, begin, buf_end);
+                readw(offset + sizeof(uint32_t), end, buf_end);
+                if (begin > end || end > static_cast<size_t>(buf_end - start))
+                    return nullptr;
+
+                const int x = column * tile;
+                const int y = row * tile;
+                const int w = std::min<size_t>(tile, width - x);
+                const int h = std::min<size_t>(tile, height - y);
+                if (!read_blocks(start + begin, start + end, pixels.data(), pixels.data() + w * h))
+                    return nullptr;
+
+                // copy the part of the tile inside the region
+                const auto x0 = std::max(x, region.x());
+                const auto x1 = std::min(x + w, region.right());
+                const auto y0 = std::max(y, region.y());
+                const auto y1 = std::min(y + h, region.bottom());
+                for (auto line = y0; line < y1; ++line)
+                {
+                    memcpy(data + (line - region.y()) * stride + (x0 - region.x()) * sizeof(uint32_t),
+                           pixels.data() + (line - y) * w + (x0 - x),
+                           (x1 - x0) * sizeof(uint32_t));
+                }
+            }
+        }
+
+        // must mark surface dirty once we manually fill it in
+        cairo_surface_mark_dirty(surface.get());
+
+        return surface;
+    }
+
 public:
 
     static constexpr uint32_t egt_magic()
@@ -89,6 +241,43 @@ public:
         return 0x50502AA2;
     }
 
+    /**
+     * Layout of the pixel data, stored in the last word of the header.
+     */
+    enum class Format : uint32_t
+    {
+        /// Run length encoded blocks right after the header.
+        rle = 0,
+        /// Uncompressed pixels at raw_offset(), ready to be memory mapped.
+        raw = 1,
+        /// Square tiles of run length encoded blocks, that can be decoded alone.
+        tiled = 2,
+    };
+
+    /// Default width and height of the tiles of a Format::tiled image.
+    static constexpr uint32_t default_tile_size()
+    {
+        return 64;
+    }
+
+    /// Size of the header, in bytes.
+    static constexpr size_t header_size()
+    {
+        return 7 * sizeof(uint32_t);
+    }
+
+    /// Offset of the pixels of a Format::raw image, aligned to a cache line.
+    static constexpr size_t raw_offset()
+    {
+        return 64;
+    }
+
+    /// Size of the pixels of a Format::raw image.
+    static constexpr size_t raw_size(uint32_t width, uint32_t height)
+    {
+        return static_cast<size_t>(width) * height * sizeof(uint32_t);
+    }
+
     static shared_cairo_surface_t load(const std::string& filename)
     {
         std::ifstream i(filename, std::ios_base::binary);
@@ -98,6 +287,7 @@ public:
         alignas(4) uint32_t width = 0;
         alignas(4) uint32_t height = 0;
         alignas(4) uint32_t reserved = 0;
+        alignas(4) uint32_t format = 0;
         i.read(reinterpret_cast<char*>(&magic), sizeof(magic));
         if (magic != egt_magic())
             return nullptr;
@@ -106,13 +296,29 @@ public:
             !i.read(reinterpret_cast<char*>(&reserved), sizeof(reserved)) ||
             !i.read(reinterpret_cast<char*>(&reserved), sizeof(reserved)) ||
             !i.read(reinterpret_cast<char*>(&reserved), sizeof(reserved)) ||
-            !i.read(reinterpret_cast<char*>(&reserved), sizeof(reserved)))
+            !i.read(reinterpret_cast<char*>(&format), sizeof(format)))
             return nullptr;
 
+        if (format == static_cast<uint32_t>(Format::tiled))
+        {
+            i.seekg(0);
+            const std::vector<unsigned char> buf((std::istreambuf_iterator<char>(i)),
+                                                 std::istreambuf_iterator<char>());
+            return load(buf.data(), buf.size());
+        }
+
         auto surface =
             shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
                                    width, height),
                                    cairo_surface_destroy);
+
+        if (format == static_cast<uint32_t>(Format::raw))
+        {
+            if (!read_raw_data(i, surface, width, height))
+                return nullptr;
+            return surface;
+        }
+
         auto data =
             reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(surface.get()));
         auto end = data + (width * height);
@@ -146,42 +352,35 @@ public:
         return surface;
     }
 
-    static shared_cairo_surface_t read_surface_data(const unsigned char* buf, const unsigned char* buf_end, uint32_t width, uint32_t height)
+    static shared_cairo_surface_t read_surface_data(const unsigned char* buf, const unsigned char* buf_end, uint32_t width, uint32_t height,
+            uint32_t format = static_cast<uint32_t>(Format::rle))
     {
+        if (format == static_cast<uint32_t>(Format::tiled))
+            return read_tiled_data(buf, buf_end, width, height, Rect(0, 0, width, height));
+
         auto surface =
             shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
                                    width, height),
                                    cairo_surface_destroy);
-        auto data =
-            reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(surface.get()));
-        auto end = data + (width * height);
 
-        while (data < end)
+        if (format == static_cast<uint32_t>(Format::raw))
         {
-            alignas(4) uint16_t block = 0;
-            buf = readw(buf, block, buf_end);
-            if (!buf)
+            // buf is right after the header, the pixels are after the padding
+            buf += raw_offset() - header_size();
+            if (buf > buf_end ||
+                static_cast<size_t>(buf_end - buf) < raw_size(width, height))
                 return nullptr;
-            if (block & 0x8000)
-            {
-                block &= 0x7fff;
-                alignas(4) uint32_t value = 0;
-                buf = readw(buf, value, buf_end);
-                if (!buf)
-                    return nullptr;
-                memset32(data, value, block);
-            }
-            else if (block)
-            {
-                if (buf + block * sizeof(uint32_t) > buf_end)
-                    return nullptr;
 
-                memcpy(data, buf, block * sizeof(uint32_t));
-                buf += (block * sizeof(uint32_t));
-            }
-            data += block;
+            memcpy(cairo_image_surface_get_data(surface.get()), buf, raw_size(width, height));
+            cairo_surface_mark_dirty(surface.get());
+            return surface;
         }
 
+        auto data =
+            reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(surface.get()));
+        if (!read_blocks(buf, buf_end, data, data + (width * height)))
+            return nullptr;
+
         // must mark surface dirty once we manually fill it in
         cairo_surface_mark_dirty(surface.get());
 
@@ -194,6 +393,7 @@ public:
         alignas(4) uint32_t magic = 0;
         alignas(4) uint32_t width = 0;
         alignas(4) uint32_t height = 0;
+        alignas(4) uint32_t format = 0;
 
         buf = readw(buf, magic, buf_end);
         if (!buf)
@@ -206,9 +406,12 @@ public:
         buf = readw(buf, height, buf_end);
         if (!buf)
             return nullptr;
-        buf += (sizeof(uint32_t) * 4);
+        buf += (sizeof(uint32_t) * 3);
+        buf = readw(buf, format, buf_end);
+        if (!buf)
+            return nullptr;
 
-        return read_surface_data(buf, buf_end, width, height);
+        return read_surface_data(buf, buf_end, width, height, format);
     }
 
     static shared_cairo_surface_t load(const unsigned char* buf, size_t len, std::shared_ptr<Rect>& rect)
@@ -219,6 +422,7 @@ public:
         alignas(4) uint32_t height = 0;
         alignas(4) int32_t x = 0;
         alignas(4) int32_t y = 0;
+        alignas(4) uint32_t format = 0;
 
         buf = readw(buf, magic, buf_end);
         if (!buf)
@@ -237,14 +441,95 @@ public:
         buf = readw(buf, y, buf_end);
         if (!buf)
             return nullptr;
-        buf += (sizeof(uint32_t) * 2);
+        buf += sizeof(uint32_t);
+        buf = readw(buf, format, buf_end);
+        if (!buf)
+            return nullptr;
 
         rect->x(x);
         rect->y(y);
         rect->width(width);
         rect->height(height);
 
-        return read_surface_data(buf, buf_end, width, height);
+        return read_surface_data(buf, buf_end, width, height, format);
+    }
+
+    /**
+     * Load part of an image.
+     *
+     * Only the tiles overlapping the region of a Format::tiled image are
+     * decoded.  Other images are decoded whole and then copied.
+     *
+     * @param[in] buf Pointer to the in-memory data.
+     * @param[in] len Size of the data.
+     * @param[in] region Region of the image, clipped to the image.
+     */
+    static shared_cairo_surface_t load(const unsigned char* buf, size_t len, const Rect& region)
+    {
+        const auto buf_end = buf + len;
+        alignas(4) uint32_t magic = 0;
+        alignas(4) uint32_t width = 0;
+        alignas(4) uint32_t height = 0;
+        alignas(4) uint32_t format = 0;
+
+        buf = readw(buf, magic, buf_end);
+        if (!buf)
+            return nullptr;
+        if (magic != egt_magic())
+            return nullptr;
+        buf = readw(buf, width, buf_end);
+        if (!buf)
+            return nullptr;
+        buf = readw(buf, height, buf_end);
+        if (!buf)
+            return nullptr;
+        buf += (sizeof(uint32_t) * 3);
+        buf = readw(buf, format, buf_end);
+        if (!buf)
+            return nullptr;
+
+        const auto r = Rect::intersection(region, Rect(0, 0, width, height));
+        if (r.empty())
+            return nullptr;
+
+        if (format == static_cast<uint32_t>(Format::tiled))
+            return read_tiled_data(buf, buf_end, width, height, r);
+
+        return copy_region(read_surface_data(buf, buf_end, width, height, format), r);
+    }
+
+    /**
+     * Copy a region of an image surface to a new surface.
+     *
+     * @param[in] surface The image surface.
+     * @param[in] region Region of the image, inside the image.
+     */
+    static shared_cairo_surface_t copy_region(const shared_cairo_surface_t& surface, const Rect& region)
+    {
+        if (!surface)
+            return nullptr;
+
+        auto result =
+            shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                   region.width(), region.height()),
+                                   cairo_surface_destroy);
+
+        cairo_surface_flush(surface.get());
+        const auto src = cairo_image_surface_get_data(surface.get());
+        const auto src_stride = cairo_image_surface_get_stride(surface.get());
+        const auto dst = cairo_image_surface_get_data(result.get());
+        const auto dst_stride = cairo_image_surface_get_stride(result.get());
+
+        for (auto line = 0; line < region.height(); ++line)
+        {
+            memcpy(dst + line * dst_stride,
+                   src + (region.y() + line) * src_stride + region.x() * sizeof(uint32_t),
+                   region.width() * sizeof(uint32_t));
+        }
+
+        cairo_surface_mark_dirty(result.get());
+
+        return result;
     }
 
     static uint16_t next_diff_block(uint32_t* data, const uint32_t* end)
@@ -277,7 +562,8 @@ public:
         return 0;
     }
 
-    static void save(const std::string& path, unsigned char* data, uint32_t width, uint32_t height)
+    static void save(const std::string& path, unsigned char* data, uint32_t width, uint32_t height,
+                     Format format = Format::rle)
     {
         std::ofstream o(path, std::ios_base::binary);
         const auto magic = egt_magic();
@@ -288,35 +574,69 @@ public:
         o.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
         o.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
         o.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
-        o.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        o.write(reinterpret_cast<const char*>(&format), sizeof(format));
+
+        if (format == Format::raw)
+        {
+            static const char padding[raw_offset() - header_size()] = {};
+            o.write(padding, sizeof(padding));
+            o.write(reinterpret_cast<const char*>(data), raw_size(width, height));
+            o.close();
+            return;
+        }
+
+        if (format == Format::tiled)
+        {
+            save_tiles(o, data, width, height, default_tile_size());
+            o.close();
+            return;
+        }
 
         const auto start = reinterpret_cast<uint32_t*>(data);
-        auto offset = reinterpret_cast<uint32_t*>(data);
-        const auto end = reinterpret_cast<uint32_t*>(start + (width * height));
+        write_blocks(o, start, start + (width * height));
+        o.close();
+    }
 
-        while (offset < end)
+    /**
+     * Write the tile size, the tile offsets and the tiles of a Format::tiled
+     * image, right after the header.
+     */
+    static void save_tiles(std::ostream& o, unsigned char* data, uint32_t width, uint32_t height,
+                           uint32_t tile)
+    {
+        const size_t columns = (width + tile - 1) / tile;
+        const size_t rows = (height + tile - 1) / tile;
+        std::vector<uint32_t> offsets(columns * rows + 1);
+
+        o.write(reinterpret_cast<const char*>(&tile), sizeof(tile));
+        const auto table = o.tellp();
+        o.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+
+        uint32_t offset = header_size() + (offsets.size() + 1) * sizeof(uint32_t);
+        const auto pixels = reinterpret_cast<const uint32_t*>(data);
+        std::vector<uint32_t> buffer(static_cast<size_t>(tile) * tile);
+
+        for (size_t row = 0; row < rows; ++row)
         {
-            uint32_t value = 0;
-            auto same = next_same_block(offset, end, value);
-            if (same)
-            {
-                offset += same;
-                same |= 0x8000;
-                o.write(reinterpret_cast<const char*>(&same), sizeof(same));
-                o.write(reinterpret_cast<const char*>(&value), sizeof(value));
-            }
-            else
+            for (size_t column = 0; column < columns; ++column)
             {
-                auto diff = next_diff_block(offset, end);
-                if (diff)
-                {
-                    o.write(reinterpret_cast<const char*>(&diff), sizeof(diff));
-                    o.write(reinterpret_cast<const char*>(offset), diff * sizeof(uint32_t));
-                    offset += diff;
-                }
+                const auto x = column * tile;
+                const auto y = row * tile;
+                const auto w = std::min<size_t>(tile, width - x);
+                const auto h = std::min<size_t>(tile, height - y);
+
+                // gather the rows of the tile
+                for (size_t line = 0; line < h; ++line)
+                    memcpy(buffer.data() + line * w, pixels + (y + line) * width + x, w * sizeof(uint32_t));
+
+                offsets[row * columns + column] = offset;
+                offset += write_blocks(o, buffer.data(), buffer.data() + w * h);
             }
         }
-        o.close();
+        offsets.back() = offset;
+
+        o.seekp(table);
+        o.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint32_t));
     }
 
     static void save(const std::string& path, unsigned char* data, int32_t x, int32_t y, uint32_t width, uint32_t height, uint32_t* len)
@@ -343,35 +663,7 @@ public:
         length += (2 * sizeof(reserved));
 
         const auto start = reinterpret_cast<uint32_t*>(data);
-        auto offset = reinterpret_cast<uint32_t*>(data);
-        const auto end = reinterpret_cast<uint32_t*>(start + (width * height));
-
-        while (offset < end)
-        {
-            uint32_t value = 0;
-            auto same = next_same_block(offset, end, value);
-            if (same)
-            {
-                offset += same;
-                same |= 0x8000;
-                o.write(reinterpret_cast<const char*>(&same), sizeof(same));
-                length += sizeof(same);
-                o.write(reinterpret_cast<const char*>(&value), sizeof(value));
-                length += sizeof(value);
-            }
-            else
-            {
-                auto diff = next_diff_block(offset, end);
-                if (diff)
-                {
-                    o.write(reinterpret_cast<const char*>(&diff), sizeof(diff));
-                    length += sizeof(diff);
-                    o.write(reinterpret_cast<const char*>(offset), diff * sizeof(uint32_t));
-                    length += diff * sizeof(uint32_t);
-                    offset += diff;
-                }
-            }
-        }
+        length += write_blocks(o, start, start + (width * height));
         o.close();
 
         *len = length;
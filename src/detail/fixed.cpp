@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/detail/fixed.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+FixedEasing::FixedEasing(const std::function<float(float)>& func, size_t samples)
+{
+    samples = std::max<size_t>(samples, 2);
+
+    m_table.resize(samples);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        const auto p = static_cast<float>(i) / static_cast<float>(samples - 1);
+        m_table[i] = Fixed::from_float(func(p)).raw();
+    }
+}
+
+Fixed FixedEasing::operator()(Fixed p) const noexcept
+{
+    const auto raw = std::min(std::max(p.raw(), 0), Fixed::ONE);
+
+    const auto position = static_cast<int64_t>(raw) * static_cast<int64_t>(m_table.size() - 1);
+    const auto index = static_cast<size_t>(position >> Fixed::FRACTION_BITS);
+    if (index + 1 >= m_table.size())
+        return Fixed::from_raw(m_table.back());
+
+    const auto fraction = position & (Fixed::ONE - 1);
+    const auto a = m_table[index];
+    const auto b = m_table[index + 1];
+    return Fixed::from_raw(a + static_cast<int32_t>((static_cast<int64_t>(b - a) * fraction) >> Fixed::FRACTION_BITS));
+}
+
+const FixedEasing* FixedEasing::cached(const std::function<float(float)>& func)
+{
+    using Function = float(*)(float);
+
+    const auto target = func.target<Function>();
+    if (!target || !*target)
+        return nullptr;
+
+    static std::mutex lock;
+    static std::map<Function, std::unique_ptr<FixedEasing>> tables;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto& table = tables[*target];
+    if (!table)
+        table = std::make_unique<FixedEasing>(*target);
+    return table.get();
+}
+
+}
+}
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/focuschain.h"
+#include "egt/widget.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+
+/// Neighbours of a widget in the ring of its window.
+struct Link
+{
+    Widget* prev{nullptr};
+    Widget* next{nullptr};
+};
+
+std::unordered_map<const Widget*, Link>& links()
+{
+    static std::unordered_map<const Widget*, Link> value;
+    return value;
+}
+
+/// Can a widget in a ring take the focus.
+bool can_focus(const Widget& widget)
+{
+    return !widget.disabled() && !widget.readonly();
+}
+
+void unlink(const Widget& widget)
+{
+    auto& l = links();
+    auto i = l.find(&widget);
+    if (i == l.end())
+        return;
+
+    const auto link = i->second;
+    l.erase(i);
+    if (link.next != &widget)
+    {
+        l[link.prev].next = link.next;
+        l[link.next].prev = link.prev;
+    }
+}
+
+}
+
+/// Walks the part of the tree of a window, in the order of the ring.
+class FocusChain::Tree
+{
+public:
+
+    static bool is_window(const Widget& widget)
+    {
+        return widget.flags().is_set(Widget::Flag::window);
+    }
+
+    /// Is a widget in a ring, or should be, if it is focusable.
+    static bool in_window(const Widget& widget)
+    {
+        auto node = &widget;
+        while (!is_window(*node))
+        {
+            if (!node->visible())
+                return false;
+            node = node->parent();
+            if (!node)
+                return false;
+        }
+        return true;
+    }
+
+    /// Collect the focusable widgets of a subtree that are not linked yet.
+    static void collect(Widget& widget, std::vector<Widget*>& members)
+    {
+        if (widget.focusable() && !FocusChain::linked(widget))
+            members.push_back(&widget);
+
+        for (auto& child : widget.m_subordinates)
+            if (child->visible() && !is_window(*child))
+                collect(*child, members);
+    }
+
+    /// Unlink all of the widgets of a subtree.
+    static void unlink_all(const Widget& widget)
+    {
+        unlink(widget);
+
+        for (const auto& child : widget.m_subordinates)
+            if (child->visible() && !is_window(*child))
+                unlink_all(*child);
+    }
+
+    /// First linked widget of a subtree.
+    static Widget* first(const Widget& widget)
+    {
+        if (FocusChain::linked(widget))
+            return const_cast<Widget*>(&widget);
+
+        for (const auto& child : widget.m_subordinates)
+            if (child->visible() && !is_window(*child))
+                if (auto member = first(*child))
+                    return member;
+
+        return nullptr;
+    }
+
+    /// Last linked widget of a subtree.
+    static Widget* last(const Widget& widget)
+    {
+        for (auto i = widget.m_subordinates.rbegin(); i != widget.m_subordinates.rend(); ++i)
+            if ((*i)->visible() && !is_window(**i))
+                if (auto member = last(**i))
+                    return member;
+
+        if (FocusChain::linked(widget))
+            return const_cast<Widget*>(&widget);
+
+        return nullptr;
+    }
+
+    /// Closest linked widget before a subtree, in its window.
+    static Widget* predecessor(const Widget& widget)
+    {
+        auto node = &widget;
+        while (!is_window(*node) && node->parent())
+        {
+            const auto parent = node->parent();
+            const auto& subordinates = parent->m_subordinates;
+            auto i = std::find_if(subordinates.begin(), subordinates.end(),
+                                  [node](const auto & ptr) { return ptr.get() == node; });
+            while (i != subordinates.begin())
+            {
+                --i;
+                if ((*i)->visible() && !is_window(**i))
+                    if (auto member = last(**i))
+                        return member;
+            }
+
+            if (FocusChain::linked(*parent))
+                return const_cast<Widget*>(parent);
+
+            node = parent;
+        }
+        return nullptr;
+    }
+
+    /// Closest linked widget after a subtree, in its window.
+    static Widget* successor(const Widget& widget)
+    {
+        auto node = &widget;
+        while (!is_window(*node) && node->parent())
+        {
+            const auto parent = node->parent();
+            const auto& subordinates = parent->m_subordinates;
+            auto i = std::find_if(subordinates.begin(), subordinates.end(),
+                                  [node](const auto & ptr) { return ptr.get() == node; });
+            if (i != subordinates.end())
+            {
+                for (++i; i != subordinates.end(); ++i)
+                    if ((*i)->visible() && !is_window(**i))
+                        if (auto member = first(**i))
+                            return member;
+            }
+
+            node = parent;
+        }
+        return nullptr;
+    }
+};
+
+void FocusChain::attach(const Widget& widget)
+{
+    if (Tree::is_window(widget) || !Tree::in_window(widget))
+        return;
+
+    std::vector<Widget*> members;
+    Tree::collect(const_cast<Widget&>(widget), members);
+    if (members.empty())
+        return;
+
+    auto& l = links();
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        auto& link = l[members[i]];
+        link.prev = i ? members[i - 1] : nullptr;
+        link.next = i + 1 < members.size() ? members[i + 1] : nullptr;
+    }
+
+    auto front = members.front();
+    auto back = members.back();
+
+    Widget* prev = Tree::predecessor(widget);
+    Widget* next = nullptr;
+    if (prev)
+    {
+        next = l[prev].next;
+    }
+    else
+    {
+        next = Tree::successor(widget);
+        if (next)
+            prev = l[next].prev;
+    }
+
+    if (!prev)
+    {
+        // the only focusable widgets of the window
+        prev = back;
+        next = front;
+    }
+
+    l[prev].next = front;
+    l[front].prev = prev;
+    l[back].next = next;
+    l[next].prev = back;
+}
+
+void FocusChain::detach(const Widget& widget)
+{
+    if (links().empty() || Tree::is_window(widget))
+        return;
+
+    Tree::unlink_all(widget);
+}
+
+void FocusChain::erase(const Widget& widget) noexcept
+{
+    if (links().empty())
+        return;
+
+    unlink(widget);
+}
+
+Widget* FocusChain::next(const Widget& widget, bool backward)
+{
+    auto& l = links();
+    auto i = l.find(&widget);
+    if (i == l.end())
+        return nullptr;
+
+    auto link = i->second;
+    for (auto w = backward ? link.prev : link.next; w != &widget;)
+    {
+        if (can_focus(*w))
+            return w;
+
+        link = l[w];
+        w = backward ? link.prev : link.next;
+    }
+
+    return nullptr;
+}
+
+Widget* FocusChain::first(const Widget& window, bool backward)
+{
+    if (links().empty())
+        return nullptr;
+
+    auto member = backward ? Tree::last(window) : Tree::first(window);
+    if (!member || can_focus(*member))
+        return member;
+
+    return next(*member, backward);
+}
+
+bool FocusChain::linked(const Widget& widget)
+{
+    return links().count(&widget) != 0;
+}
+
+}
+}
+}
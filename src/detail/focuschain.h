@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_FOCUSCHAIN_H
+#define EGT_SRC_DETAIL_FOCUSCHAIN_H
+
+namespace egt
+{
+inline namespace v1
+{
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Order in which keyboard focus moves between widgets.
+ *
+ * Every window has a ring of the focusable widgets it holds, in tree order,
+ * linking each one to the previous and the next one.  Windows inside a
+ * window have their own ring.  A widget is in the ring of its window while it
+ * and all of its parents up to the window are visible.
+ *
+ * The rings are updated as widgets are added, removed, hidden, shown or
+ * reordered, by only looking at the subtree that changed and at its
+ * neighbours, so moving the focus never searches the tree.
+ *
+ * @see Widget::focusable()
+ */
+class FocusChain
+{
+public:
+
+    /// Link the focusable widgets of a subtree that joined its window.
+    static void attach(const Widget& widget);
+
+    /// Unlink the focusable widgets of a subtree leaving its window.
+    static void detach(const Widget& widget);
+
+    /// Unlink a widget being destroyed.
+    static void erase(const Widget& widget) noexcept;
+
+    /**
+     * Get the focusable widget after, or before, a widget.
+     *
+     * Disabled and readonly widgets are skipped.  Returns nullptr if the
+     * widget is not in a ring, or if no other widget of its ring can take the
+     * focus.
+     */
+    static Widget* next(const Widget& widget, bool backward);
+
+    /**
+     * Get the first, or the last, focusable widget of a window.
+     *
+     * Disabled and readonly widgets are skipped.
+     */
+    static Widget* first(const Widget& window, bool backward);
+
+    /// Returns true if a widget is in a ring.
+    static bool linked(const Widget& widget);
+
+private:
+
+    class Tree;
+};
+
+}
+}
+}
+
+#endif
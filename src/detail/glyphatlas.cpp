@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/glyphatlas.h"
+#include "egt/font.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utf8.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static inline bool is_translation(const cairo_matrix_t& matrix)
+{
+    return matrix.xx == 1. && matrix.yy == 1. && matrix.xy == 0. && matrix.yx == 0.;
+}
+
+static void destroy_atlas(void* atlas)
+{
+    delete static_cast<GlyphAtlas*>(atlas);
+}
+
+/// The atlas attached to a scaled font.
+static const cairo_user_data_key_t atlas_key{};
+
+GlyphAtlas* GlyphAtlas::get(cairo_t* cr)
+{
+    if (!Font::glyph_atlas())
+        return nullptr;
+
+    if (cairo_get_operator(cr) != CAIRO_OPERATOR_OVER)
+        return nullptr;
+
+    cairo_matrix_t matrix;
+    cairo_get_matrix(cr, &matrix);
+    if (!is_translation(matrix))
+        return nullptr;
+
+    auto font = cairo_get_scaled_font(cr);
+    if (cairo_scaled_font_status(font))
+        return nullptr;
+
+    // fonts may be shared by draw threads
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto atlas = static_cast<GlyphAtlas*>(cairo_scaled_font_get_user_data(font, &atlas_key));
+    if (!atlas)
+    {
+        auto created = std::make_unique<GlyphAtlas>(font);
+        if (cairo_scaled_font_set_user_data(font, &atlas_key, created.get(), destroy_atlas))
+            return nullptr;
+        atlas = created.release();
+    }
+
+    return atlas->m_usable ? atlas : nullptr;
+}
+
+GlyphAtlas::GlyphAtlas(cairo_scaled_font_t* font)
+    : m_font(font)
+{
+    cairo_matrix_t ctm;
+    cairo_scaled_font_get_ctm(font, &ctm);
+
+    std::unique_ptr<cairo_font_options_t, decltype(cairo_font_options_destroy)*>
+    options(cairo_font_options_create(), cairo_font_options_destroy);
+    cairo_scaled_font_get_font_options(font, options.get());
+
+    // subpixel glyphs have color, which an A8 surface can't hold
+    m_usable = is_translation(ctm) &&
+               cairo_font_options_get_antialias(options.get()) != CAIRO_ANTIALIAS_SUBPIXEL;
+}
+
+GlyphAtlas::Glyph& GlyphAtlas::glyph(uint32_t codepoint)
+{
+    auto i = m_glyphs.find(codepoint);
+    if (i != m_glyphs.end())
+        return i->second;
+
+    Glyph glyph;
+
+    char utf8[4];
+    const auto end = utf8::unchecked::append(codepoint, utf8);
+
+    cairo_glyph_t* glyphs = nullptr;
+    int count = 0;
+    if (cairo_scaled_font_text_to_glyphs(m_font, 0, 0, utf8, end - utf8,
+                                         &glyphs, &count,
+                                         nullptr, nullptr, nullptr) == CAIRO_STATUS_SUCCESS &&
+        count > 0)
+        glyph.index = glyphs[0].index;
+    cairo_glyph_free(glyphs);
+
+    const cairo_glyph_t origin{glyph.index, 0, 0};
+    cairo_scaled_font_glyph_extents(m_font, &origin, 1, &glyph.extents);
+
+    const auto& e = glyph.extents;
+    if (e.width > 0 && e.height > 0)
+    {
+        glyph.left = static_cast<int>(std::floor(e.x_bearing)) - PADDING;
+        glyph.top = static_cast<int>(std::floor(e.y_bearing)) - PADDING;
+        glyph.width = static_cast<int>(std::ceil(e.x_bearing + e.width)) + PADDING - glyph.left;
+        glyph.height = static_cast<int>(std::ceil(e.y_bearing + e.height)) + PADDING - glyph.top;
+    }
+
+    return m_glyphs.emplace(codepoint, std::move(glyph)).first->second;
+}
+
+void GlyphAtlas::reset(int width, int height)
+{
+    // glyphs will rasterize again when next drawn
+    for (auto& glyph : m_glyphs)
+        glyph.second.surface.reset();
+
+    m_surface = shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_A8, width, height),
+                                       cairo_surface_destroy);
+    m_width = width;
+    m_height = height;
+    m_shelf_x = 0;
+    m_shelf_y = 0;
+    m_shelf_height = 0;
+}
+
+bool GlyphAtlas::rasterize(Glyph& glyph, shared_cairo_t& cr)
+{
+    if (glyph.surface)
+        return true;
+
+    if (glyph.width > MAX_SIZE || glyph.height > MAX_SIZE)
+        return false;
+
+    if (!m_surface)
+        reset(INITIAL_SIZE, INITIAL_SIZE);
+
+    for (;;)
+    {
+        if (m_shelf_x + glyph.width > m_width)
+        {
+            m_shelf_y += m_shelf_height;
+            m_shelf_x = 0;
+            m_shelf_height = 0;
+        }
+
+        if (glyph.width <= m_width && m_shelf_y + glyph.height <= m_height)
+            break;
+
+        if (m_width < MAX_SIZE)
+            reset(m_width * 2, m_height * 2);
+        else
+            reset(m_width, m_height);
+        cr.reset();
+    }
+
+    // the context refers to the font, so it can't be held by the atlas
+    if (!cr)
+    {
+        cr = shared_cairo_t(cairo_create(m_surface.get()), cairo_destroy);
+        cairo_set_scaled_font(cr.get(), m_font);
+    }
+
+    const auto x = m_shelf_x;
+    const auto y = m_shelf_y;
+
+    cairo_save(cr.get());
+    cairo_rectangle(cr.get(), x, y, glyph.width, glyph.height);
+    cairo_clip(cr.get());
+    const cairo_glyph_t position{glyph.index,
+                                 static_cast<double>(x - glyph.left),
+                                 static_cast<double>(y - glyph.top)};
+    cairo_show_glyphs(cr.get(), &position, 1);
+    cairo_restore(cr.get());
+
+    glyph.surface = shared_cairo_surface_t(cairo_surface_create_for_rectangle(m_surface.get(),
+                                           x, y, glyph.width, glyph.height),
+                                           cairo_surface_destroy);
+
+    m_shelf_x += glyph.width + PADDING;
+    m_shelf_height = std::max(m_shelf_height, glyph.height + PADDING);
+
+    return true;
+}
+
+bool GlyphAtlas::text_extents(const std::string& text, cairo_text_extents_t& extents)
+{
+    if (!utf8::is_valid(text.begin(), text.end()))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // the union of the ink of every glyph, like cairo
+    auto min_x = std::numeric_limits<double>::max();
+    auto min_y = std::numeric_limits<double>::max();
+    auto max_x = std::numeric_limits<double>::lowest();
+    auto max_y = std::numeric_limits<double>::lowest();
+    double x = 0;
+    double y = 0;
+
+    for (auto i = text.begin(); i != text.end();)
+    {
+        const auto& e = glyph(utf8::unchecked::next(i)).extents;
+        if (e.width > 0 && e.height > 0)
+        {
+            min_x = std::min(min_x, x + e.x_bearing);
+            min_y = std::min(min_y, y + e.y_bearing);
+            max_x = std::max(max_x, x + e.x_bearing + e.width);
+            max_y = std::max(max_y, y + e.y_bearing + e.height);
+        }
+        x += e.x_advance;
+        y += e.y_advance;
+    }
+
+    extents = {};
+    if (min_x <= max_x)
+    {
+        extents.x_bearing = min_x;
+        extents.y_bearing = min_y;
+        extents.width = max_x - min_x;
+        extents.height = max_y - min_y;
+    }
+    extents.x_advance = x;
+    extents.y_advance = y;
+
+    return true;
+}
+
+bool GlyphAtlas::show_text(cairo_t* cr, const std::string& text, double x, double y)
+{
+    if (!utf8::is_valid(text.begin(), text.end()))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // blit in device space, where glyphs land on whole pixels
+    cairo_user_to_device(cr, &x, &y);
+    cairo_save(cr);
+    cairo_identity_matrix(cr);
+
+    shared_cairo_t target;
+    for (auto i = text.begin(); i != text.end();)
+    {
+        auto& g = glyph(utf8::unchecked::next(i));
+        if (g.width)
+        {
+            if (rasterize(g, target))
+            {
+                cairo_mask_surface(cr, g.surface.get(),
+                                   std::lround(x) + g.left,
+                                   std::lround(y) + g.top);
+            }
+            else
+            {
+                const cairo_glyph_t position{g.index, x, y};
+                cairo_show_glyphs(cr, &position, 1);
+            }
+        }
+        x += g.extents.x_advance;
+        y += g.extents.y_advance;
+    }
+
+    cairo_restore(cr);
+
+    return true;
+}
+
+size_t GlyphAtlas::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::count_if(m_glyphs.begin(), m_glyphs.end(),
+                         [](const std::pair<const uint32_t, Glyph>& glyph)
+    {
+        return static_cast<bool>(glyph.second.surface);
+    });
+}
+
+Size GlyphAtlas::surface_size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_width, m_height};
+}
+
+size_t GlyphAtlas::bytes(cairo_scaled_font_t* font)
+{
+    auto atlas = static_cast<GlyphAtlas*>(cairo_scaled_font_get_user_data(font, &atlas_key));
+    if (!atlas)
+        return 0;
+
+    const auto size = atlas->surface_size();
+    return static_cast<size_t>(cairo_format_stride_for_width(CAIRO_FORMAT_A8, size.width())) *
+           size.height();
+}
+
+void text_extents(cairo_t* cr, const std::string& text, cairo_text_extents_t& extents)
+{
+    auto atlas = GlyphAtlas::get(cr);
+    if (!atlas || !atlas->text_extents(text, extents))
+        cairo_text_extents(cr, text.c_str(), &extents);
+}
+
+void show_text(cairo_t* cr, const std::string& text, double x, double y)
+{
+    auto atlas = GlyphAtlas::get(cr);
+    if (!atlas || !atlas->show_text(cr, text, x, y))
+    {
+        cairo_move_to(cr, x, y);
+        cairo_show_text(cr, text.c_str());
+    }
+}
+
+}
+}
+}
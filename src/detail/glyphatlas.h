@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_GLYPHATLAS_H
+#define EGT_SRC_DETAIL_GLYPHATLAS_H
+
+#include <cairo.h>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/types.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Pre-rasterized glyphs of a scaled font.
+ *
+ * Glyphs are rasterized once into an A8 surface, packed in shelves, and text
+ * is drawn by masking the source of the context with the glyphs, one blit
+ * per glyph.  The metrics of every character are cached along with it, so
+ * neither drawing nor measuring text looks up glyphs again.
+ *
+ * The atlas is attached to the scaled font, which FontCache shares between
+ * every Font of the same face, size, weight, and slant, and is destroyed
+ * along with it.  When the atlas is full, it grows up to MAX_SIZE, and then
+ * starts over.
+ *
+ * Like cairo with image surfaces, glyphs are drawn at whole pixels.  An
+ * atlas can be used from any thread.
+ */
+class GlyphAtlas : private NonCopyable<GlyphAtlas>
+{
+public:
+
+    /// Initial width and height of the atlas surface.
+    static constexpr int INITIAL_SIZE = 256;
+    /// Maximum width and height of the atlas surface.
+    static constexpr int MAX_SIZE = 1024;
+
+    /**
+     * Get the atlas of the current font of a context, creating it if needed.
+     *
+     * @return nullptr when text can't be drawn from an atlas on the context,
+     * because atlases are disabled, the transform of the context or the font
+     * is more than a translation, the operator is not OVER, or the font uses
+     * subpixel antialiasing.
+     */
+    static GlyphAtlas* get(cairo_t* cr);
+
+    explicit GlyphAtlas(cairo_scaled_font_t* font);
+    GlyphAtlas(GlyphAtlas&&) = delete;
+    GlyphAtlas& operator=(GlyphAtlas&&) = delete;
+    ~GlyphAtlas() noexcept = default;
+
+    /**
+     * Compute the extents of text, like cairo_text_extents().
+     *
+     * @return false if the text is not valid UTF-8.
+     */
+    bool text_extents(const std::string& text, cairo_text_extents_t& extents);
+
+    /**
+     * Draw text with the source of a context, like cairo_show_text().
+     *
+     * @param[in] cr The context.
+     * @param[in] text The text.
+     * @param[in] x Origin of the text in user space.
+     * @param[in] y Origin of the text in user space.
+     * @return false if the text is not valid UTF-8, and nothing was drawn.
+     */
+    bool show_text(cairo_t* cr, const std::string& text, double x, double y);
+
+    /// Number of glyphs in the atlas surface.
+    EGT_NODISCARD size_t size() const;
+
+    /// Size of the atlas surface.
+    EGT_NODISCARD Size surface_size() const;
+
+    /// Size of the atlas surface of a scaled font in bytes, or 0 without one.
+    EGT_NODISCARD static size_t bytes(cairo_scaled_font_t* font);
+
+private:
+
+    /// Padding around glyphs, so antialiasing does not bleed between them.
+    static constexpr int PADDING = 1;
+
+    struct Glyph
+    {
+        unsigned long index{0};
+        /// Metrics, relative to the origin.
+        cairo_text_extents_t extents{};
+        /// Pixels covered by the glyph, relative to the origin.
+        int left{0};
+        int top{0};
+        int width{0};
+        int height{0};
+        /// Sub-surface of the atlas, empty when not rasterized.
+        shared_cairo_surface_t surface;
+    };
+
+    /// Get the glyph of a character, with its metrics.
+    Glyph& glyph(uint32_t codepoint);
+
+    /// Rasterize a glyph into the atlas, if not already.
+    bool rasterize(Glyph& glyph, shared_cairo_t& cr);
+
+    /// Start over with an empty surface.
+    void reset(int width, int height);
+
+    /// The font owns the atlas, so no reference is held.
+    cairo_scaled_font_t* m_font;
+    /// Is the font usable with an atlas.
+    bool m_usable{true};
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint32_t, Glyph> m_glyphs;
+    shared_cairo_surface_t m_surface;
+    int m_width{0};
+    int m_height{0};
+    /// Position of the next glyph on the current shelf.
+    int m_shelf_x{0};
+    int m_shelf_y{0};
+    int m_shelf_height{0};
+};
+
+/**
+ * Compute the extents of text with the glyph atlas of the current font of a
+ * context when possible, and with cairo_text_extents() otherwise.
+ */
+void text_extents(cairo_t* cr, const std::string& text, cairo_text_extents_t& extents);
+
+/**
+ * Draw text at a point with the glyph atlas of the current font of a context
+ * when possible, and with cairo_show_text() otherwise.
+ */
+void show_text(cairo_t* cr, const std::string& text, double x, double y);
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/hitgrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Upper limit of columns and rows.
+static constexpr size_t MAX_CELLS = 64;
+
+size_t HitGrid::cell(int value, int origin, int size, size_t count)
+{
+    if (value <= origin)
+        return 0;
+    return std::min(static_cast<size_t>((value - origin) / size), count - 1);
+}
+
+void HitGrid::build(const std::vector<Rect>& boxes)
+{
+    m_offsets.clear();
+    m_indexes.clear();
+    m_columns = m_rows = 0;
+    dirty = false;
+
+    if (boxes.empty())
+        return;
+
+    // right() and bottom() are inclusive for Rect::intersect(Point)
+    auto left = boxes.front().left();
+    auto top = boxes.front().top();
+    auto right = boxes.front().right();
+    auto bottom = boxes.front().bottom();
+    for (const auto& box : boxes)
+    {
+        left = std::min(left, box.left());
+        top = std::min(top, box.top());
+        right = std::max(right, box.right());
+        bottom = std::max(bottom, box.bottom());
+    }
+
+    m_bounds = Rect(left, top, right - left, bottom - top);
+
+    const auto cells = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(boxes.size()))));
+    m_columns = std::min(std::max<size_t>(cells, 1), MAX_CELLS);
+    m_rows = m_columns;
+    m_cell_width = std::max(1, static_cast<int>((m_bounds.width() + m_columns) / m_columns));
+    m_cell_height = std::max(1, static_cast<int>((m_bounds.height() + m_rows) / m_rows));
+
+    // count, then fill, so every cell is a contiguous run of indexes
+    m_offsets.assign(m_columns * m_rows + 1, 0);
+
+    const auto visit = [this](const Rect & box, auto && func)
+    {
+        const auto x0 = cell(box.left(), m_bounds.left(), m_cell_width, m_columns);
+        const auto x1 = cell(box.right(), m_bounds.left(), m_cell_width, m_columns);
+        const auto y0 = cell(box.top(), m_bounds.top(), m_cell_height, m_rows);
+        const auto y1 = cell(box.bottom(), m_bounds.top(), m_cell_height, m_rows);
+        for (auto y = y0; y <= y1; ++y)
+            for (auto x = x0; x <= x1; ++x)
+                func(y * m_columns + x);
+    };
+
+    for (const auto& box : boxes)
+        visit(box, [this](size_t c) { ++m_offsets[c + 1]; });
+
+    for (size_t c = 1; c < m_offsets.size(); ++c)
+        m_offsets[c] += m_offsets[c - 1];
+
+    m_indexes.resize(m_offsets.back());
+    std::vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t index = 0; index < boxes.size(); ++index)
+    {
+        visit(boxes[index], [this, &fill, index](size_t c)
+        {
+            m_indexes[fill[c]++] = static_cast<uint32_t>(index);
+        });
+    }
+}
+
+std::pair<const uint32_t*, const uint32_t*> HitGrid::query(const Point& point) const
+{
+    if (!m_columns || !m_bounds.intersect(point))
+        return {nullptr, nullptr};
+
+    const auto x = cell(point.x(), m_bounds.left(), m_cell_width, m_columns);
+    const auto y = cell(point.y(), m_bounds.top(), m_cell_height, m_rows);
+    const auto c = y * m_columns + x;
+    const auto data = m_indexes.data();
+    return {data + m_offsets[c], data + m_offsets[c + 1]};
+}
+
+}
+}
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_HITGRID_H
+#define EGT_SRC_DETAIL_HITGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <egt/geometry.h>
+#include <utility>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Uniform grid of rectangles, used to find the rectangles under a point
+ * without testing all of them.
+ *
+ * Rectangles are identified by their index in the array given to build().
+ * Every cell lists, in increasing order, the rectangles that overlap it, so
+ * walking a cell backwards visits the topmost rectangles first.
+ */
+class HitGrid
+{
+public:
+
+    /**
+     * Rebuild the grid for a set of rectangles.
+     *
+     * The number of cells grows with the square root of the number of
+     * rectangles, so every cell lists only a few of them.
+     */
+    void build(const std::vector<Rect>& boxes);
+
+    /**
+     * Get the indexes of the rectangles that may contain a point.
+     *
+     * @return Start and end of the indexes, in increasing order.  The caller
+     * still has to test the rectangles, because a cell covers more than the
+     * point.
+     */
+    std::pair<const uint32_t*, const uint32_t*> query(const Point& point) const;
+
+    /**
+     * Value of the owner's generation counter when the grid was built.
+     */
+    uint32_t generation{0};
+
+    /**
+     * Set when the grid needs to be built before use.
+     */
+    bool dirty{true};
+
+protected:
+
+    /// Column or row of a coordinate, clamped to the grid.
+    static size_t cell(int value, int origin, int size, size_t count);
+
+    Rect m_bounds;
+    int m_cell_width{1};
+    int m_cell_height{1};
+    size_t m_columns{0};
+    size_t m_rows{0};
+    /// Start of every cell in m_indexes, plus the end of the last one.
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_indexes;
+};
+
+}
+}
+}
+
+#endif
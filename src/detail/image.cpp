@@ -10,11 +10,19 @@
 #include "detail/egtlog.h"
 #include "detail/eraw.h"
 #include "egt/app.h"
+#include "egt/canvas.h"
 #include "egt/detail/filesystem.h"
 #include "egt/detail/image.h"
+#include "egt/detail/imagecache.h"
+#include "egt/detail/sharedstore.h"
 #include "egt/resource.h"
+#include "egt/respath.h"
 #include "images/bmp/cairo_bmp.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <vector>
 
 #ifdef HAVE_LIBCURL
@@ -35,6 +43,10 @@ extern "C" {
 #endif
 #endif
 
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
 #ifdef HAVE_LIBRSVG
 #include "detail/svg.h"
 #endif
@@ -79,57 +91,120 @@ static constexpr auto MIME_ZIP = "application/zip";
 static constexpr auto MIME_GZIP = "application/gzip";
 static constexpr auto MIME_ERAW = "image/eraw";
 
-EGT_API shared_cairo_surface_t load_image_from_memory(const unsigned char* data,
-        size_t len,
-        const std::string& name)
+/// Reads a ResourceStream, after the first bytes already read from it.
+struct ResourceStreamObject
 {
-    if (!data || !len)
-        return {};
+    ResourceStream& stream;
+    const unsigned char* head{nullptr};
+    size_t head_len{0};
+    size_t offset{0};
+};
 
-    shared_cairo_surface_t image;
+static cairo_status_t read_resource_stream_object(void* closure, unsigned char* data,
+        unsigned int length)
+{
+    auto object = static_cast<ResourceStreamObject*>(closure);
 
-    const auto mimetype = get_mime_type(data, len);
-    if (mimetype.empty())
-        throw std::runtime_error("unable to determine mimetype for: " + name);
+    const auto count = std::min<size_t>(length, object->head_len - object->offset);
+    memcpy(data, object->head + object->offset, count);
+    object->offset += count;
 
-    EGTLOG_DEBUG("mimetype of {} is {}", name, mimetype);
+    try
+    {
+        if (object->stream.read(data + count, length - count) != length - count)
+            return CAIRO_STATUS_READ_ERROR;
+    }
+    catch (const std::exception& e)
+    {
+        detail::warn("{}", e.what());
+        return CAIRO_STATUS_READ_ERROR;
+    }
+
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/// Can an image be decoded from a cairo stream.
+static bool streamable(const std::string& mimetype)
+{
+    return mimetype == MIME_BMP
+#ifdef HAVE_LIBJPEG
+           || mimetype == MIME_JPEG
+#endif
+#if CAIRO_HAS_PNG_FUNCTIONS == 1
+           || mimetype == MIME_PNG
+#endif
+           ;
+}
+
+/// Decode an image from a cairo stream, if streamable().
+static shared_cairo_surface_t load_image_from_cairo_stream(const std::string& mimetype,
+        cairo_read_func_t func, void* closure)
+{
+    shared_cairo_surface_t image;
 
     if (mimetype == MIME_BMP)
     {
-        StreamObject stream = {data, len, 0};
         image = shared_cairo_surface_t(
                     cairo_image_surface_create_from_bmp_stream(
-                        read_stream, &stream),
+                        func, closure),
                     cairo_surface_destroy);
     }
-    else if (mimetype == MIME_ERAW)
-    {
-        image = load_eraw(data, len);
-    }
 #ifdef HAVE_LIBJPEG
     else if (mimetype == MIME_JPEG)
     {
-        StreamObject stream = {data, len, 0};
         image = shared_cairo_surface_t(
                     cairo_image_surface_create_from_jpeg_stream(
-                        read_stream, &stream),
+                        func, closure),
                     cairo_surface_destroy);
     }
 #endif
 #if CAIRO_HAS_PNG_FUNCTIONS == 1
     else if (mimetype == MIME_PNG)
     {
-        StreamObject stream = {data, len, 0};
         image = shared_cairo_surface_t(
                     cairo_image_surface_create_from_png_stream(
-                        read_stream, &stream),
+                        func, closure),
                     cairo_surface_destroy);
     }
 #endif
+
+    return image;
+}
+
+EGT_API shared_cairo_surface_t load_image_from_memory(const unsigned char* data,
+        size_t len,
+        const std::string& name)
+{
+    if (!data || !len)
+        return {};
+
+    shared_cairo_surface_t image;
+
+    const auto mimetype = get_mime_type(data, len);
+    if (mimetype.empty())
+        throw std::runtime_error("unable to determine mimetype for: " + name);
+
+    EGTLOG_DEBUG("mimetype of {} is {}", name, mimetype);
+
+    if (streamable(mimetype))
+    {
+        image = shared_image_store().get(data, len, 1.0f, 1.0f, [&]()
+        {
+            StreamObject stream = {data, len, 0};
+            return load_image_from_cairo_stream(mimetype, read_stream, &stream);
+        });
+    }
+    else if (mimetype == MIME_ERAW)
+    {
+        image = load_eraw(data, len);
+    }
 #ifdef HAVE_LIBRSVG
     else if (mimetype == MIME_SVGXML || mimetype == MIME_SVG)
     {
-        image = load_svg(data, len);
+        image = shared_image_store().get(data, len, 1.0f, 1.0f, [&]()
+        {
+            return load_svg(data, len);
+        });
     }
 #endif
     else
@@ -140,11 +215,47 @@ EGT_API shared_cairo_surface_t load_image_from_memory(const unsigned char* data,
     return image;
 }
 
+shared_cairo_surface_t load_image_from_stream(ResourceStream& stream, const std::string& name)
+{
+    // enough to determine the mimetype
+    unsigned char head[64];
+    const auto head_len = stream.read(head, sizeof(head));
+
+    const auto mimetype = get_mime_type(head, head_len);
+    if (mimetype.empty())
+        throw std::runtime_error("unable to determine mimetype for: " + name);
+
+    EGTLOG_DEBUG("mimetype of {} is {}", name, mimetype);
+
+    if (streamable(mimetype))
+    {
+        ResourceStreamObject object{stream, head, head_len};
+        return load_image_from_cairo_stream(mimetype, read_resource_stream_object, &object);
+    }
+
+    // other formats are decoded from memory, freed right after
+    std::vector<unsigned char> data(head, head + head_len);
+    const size_t BUFSIZE = 8 * 1024;
+    unsigned char buffer[BUFSIZE];
+    size_t count;
+    while ((count = stream.read(buffer, BUFSIZE)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+
+    return load_image_from_memory(data.data(), data.size(), name);
+}
+
 shared_cairo_surface_t load_image_from_resource(const std::string& name)
 {
     if (!ResourceManager::instance().exists(name.c_str()))
         throw std::runtime_error("resource not found: " + name);
 
+    if (ResourceManager::instance().compressed(name.c_str()))
+    {
+        // decoded while decompressed, instead of decompressing the whole resource
+        auto stream = ResourceManager::instance().open(name.c_str());
+        return load_image_from_stream(*stream, name);
+    }
+
     ResourceManager::instance().stream_reset(name.c_str());
 
     return load_image_from_memory(ResourceManager::instance().data(name.c_str()),
@@ -152,16 +263,9 @@ shared_cairo_surface_t load_image_from_resource(const std::string& name)
                                   name);
 }
 
-shared_cairo_surface_t load_image_from_filesystem(const std::string& path)
+/// Decode an image file of a mimetype.
+static shared_cairo_surface_t decode_file(const std::string& path, const std::string& mimetype)
 {
-    if (!detail::exists(path))
-        throw std::runtime_error("file not found: " + path);
-
-    const auto mimetype = get_mime_type(path);
-    if (mimetype.empty())
-        throw std::runtime_error("unable to determine mimetype for: " + path);
-    EGTLOG_DEBUG("mimetype of {} is {}", path, mimetype);
-
     shared_cairo_surface_t image;
 
     if (mimetype == MIME_BMP)
@@ -204,6 +308,33 @@ shared_cairo_surface_t load_image_from_filesystem(const std::string& path)
     return image;
 }
 
+shared_cairo_surface_t load_image_from_filesystem(const std::string& path)
+{
+    if (!detail::exists(path))
+        throw std::runtime_error("file not found: " + path);
+
+    const auto mimetype = get_mime_type(path);
+    if (mimetype.empty())
+        throw std::runtime_error("unable to determine mimetype for: " + path);
+    EGTLOG_DEBUG("mimetype of {} is {}", path, mimetype);
+
+    // ERAW files are mapped already
+    auto& store = shared_image_store();
+    if (mimetype == MIME_ERAW || !store.enabled())
+        return decode_file(path, mimetype);
+
+    // other processes decoding the same content share its pixels
+    const auto hash = [&path]()
+    {
+        const auto data = read_file(path);
+        return SharedImageStore::hash(data.data(), data.size());
+    }();
+    if (auto image = store.find(hash, 1.0f, 1.0f))
+        return image;
+
+    return store.publish(hash, 1.0f, 1.0f, decode_file(path, mimetype));
+}
+
 EGT_API shared_cairo_surface_t load_image_from_network(const std::string& url)
 {
     shared_cairo_surface_t image;
@@ -222,6 +353,324 @@ EGT_API shared_cairo_surface_t load_image_from_network(const std::string& url)
     return image;
 }
 
+/// Can an image be decoded at a scale.
+static bool scalable(const std::string& mimetype)
+{
+    detail::ignoreparam(mimetype);
+    return false
+#ifdef HAVE_LIBJPEG
+           || mimetype == MIME_JPEG
+#endif
+#ifdef HAVE_LIBPNG
+           || mimetype == MIME_PNG
+#endif
+           ;
+}
+
+/// Size of an image at a scale, like ImageCache::scale_image().
+static Size scaled_size(int width, int height, float hscale, float vscale)
+{
+    return {std::max(static_cast<int>(width * hscale), 1),
+            std::max(static_cast<int>(height * vscale), 1)};
+}
+
+#ifdef HAVE_LIBJPEG
+static shared_cairo_surface_t load_scaled_jpeg(const unsigned char* data, size_t len,
+        float hscale, float vscale)
+{
+    // owned by the decoder
+    auto copy = malloc(len);
+    if (!copy)
+        return {};
+    memcpy(copy, data, len);
+
+    int width = 0;
+    int height = 0;
+    auto image = shared_cairo_surface_t(
+                     cairo_image_surface_create_from_jpeg_mem_scaled(copy, len,
+                             std::max(hscale, vscale), &width, &height),
+                     cairo_surface_destroy);
+    if (cairo_surface_status(image.get()) != CAIRO_STATUS_SUCCESS)
+        return image;
+
+    // the DCT only scales by powers of 2
+    const auto size = scaled_size(width, height, hscale, vscale);
+    const auto decoded = Size(cairo_image_surface_get_width(image.get()),
+                              cairo_image_surface_get_height(image.get()));
+    if (decoded == size)
+        return image;
+
+    return ImageCache::scale_surface(image, decoded.width(), decoded.height(),
+                                     size.width(), size.height());
+}
+#endif
+
+#ifdef HAVE_LIBPNG
+/// State of load_scaled_png(), kept out of the frame longjmp() returns to.
+struct PngDecoder
+{
+    png_structp png{nullptr};
+    png_infop info{nullptr};
+    StreamObject stream;
+    float hscale{1};
+    float vscale{1};
+    shared_cairo_surface_t image;
+    /// One row of the image, as RGBA.
+    std::vector<png_byte> row;
+    /// Premultiplied ARGB sums of the pixels of each column of a row of the image.
+    std::vector<uint64_t> sums;
+    /// Number of pixels of a row of the image in each column.
+    std::vector<uint32_t> counts;
+};
+
+static void png_read_data(png_structp png, png_bytep data, png_size_t length)
+{
+    auto stream = static_cast<StreamObject*>(png_get_io_ptr(png));
+    if (stream->offset + length > stream->len)
+        png_error(png, "read past end of data stream");
+
+    memcpy(data, stream->data + stream->offset, length);
+    stream->offset += length;
+}
+
+/// Write the average of the sums to a row of the image, and clear them.
+static void flush_png_row(PngDecoder& decoder, uint32_t y, uint32_t rows)
+{
+    auto dst = reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(decoder.image.get()) +
+                                           y * cairo_image_surface_get_stride(decoder.image.get()));
+
+    for (size_t x = 0; x < decoder.counts.size(); ++x)
+    {
+        const uint64_t n = static_cast<uint64_t>(decoder.counts[x]) * rows;
+        auto sum = &decoder.sums[x * 4];
+        uint32_t pixel = 0;
+        for (auto c = 0; c < 4; ++c)
+            pixel = (pixel << 8u) | static_cast<uint32_t>(n ? (sum[c] + n / 2) / n : 0);
+        dst[x] = pixel;
+    }
+
+    std::fill(decoder.sums.begin(), decoder.sums.end(), 0);
+}
+
+/**
+ * Decode the rows of a PNG image, averaging them into the image.
+ *
+ * Errors of libpng longjmp() back here, so this only has trivial locals.
+ */
+static bool decode_png_rows(PngDecoder& decoder)
+{
+    auto png = decoder.png;
+    auto info = decoder.info;
+
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+
+    png_set_read_fn(png, &decoder.stream, png_read_data);
+    png_read_info(png, info);
+
+    png_uint_32 width;
+    png_uint_32 height;
+    int depth;
+    int color;
+    int interlace;
+    png_get_IHDR(png, info, &width, &height, &depth, &color, &interlace, nullptr, nullptr);
+
+    // interlaced rows come in several passes
+    if (interlace != PNG_INTERLACE_NONE)
+        return false;
+
+    const auto size = scaled_size(width, height, decoder.hscale, decoder.vscale);
+    if (static_cast<png_uint_32>(size.width()) > width ||
+        static_cast<png_uint_32>(size.height()) > height)
+        return false;
+
+    // to 8 bit RGBA
+    const bool alpha = (color & PNG_COLOR_MASK_ALPHA) || png_get_valid(png, info, PNG_INFO_tRNS);
+    if (color == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png);
+    if (color == PNG_COLOR_TYPE_GRAY && depth < 8)
+        png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(png);
+    if (depth == 16)
+        png_set_strip_16(png);
+    if (color == PNG_COLOR_TYPE_GRAY || color == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(png);
+    if (!alpha)
+        png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+    png_read_update_info(png, info);
+
+    decoder.image = shared_cairo_surface_t(
+                        cairo_image_surface_create(alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+                                size.width(), size.height()),
+                        cairo_surface_destroy);
+    if (cairo_surface_status(decoder.image.get()) != CAIRO_STATUS_SUCCESS)
+        return false;
+
+    decoder.row.resize(png_get_rowbytes(png, info));
+    decoder.sums.assign(size.width() * 4, 0);
+    decoder.counts.assign(size.width(), 0);
+    for (png_uint_32 x = 0; x < width; ++x)
+        decoder.counts[static_cast<uint64_t>(x) * size.width() / width]++;
+
+    uint32_t y = 0;
+    uint32_t rows = 0;
+    for (png_uint_32 row = 0; row < height; ++row)
+    {
+        png_read_row(png, decoder.row.data(), nullptr);
+
+        const auto to = static_cast<uint32_t>(static_cast<uint64_t>(row) * size.height() / height);
+        if (to != y)
+        {
+            flush_png_row(decoder, y, rows);
+            y = to;
+            rows = 0;
+        }
+
+        for (png_uint_32 x = 0; x < width; ++x)
+        {
+            const auto src = &decoder.row[x * 4];
+            auto sum = &decoder.sums[static_cast<uint64_t>(x) * size.width() / width * 4];
+            const uint32_t a = src[3];
+            sum[0] += a;
+            sum[1] += (src[0] * a + 127) / 255;
+            sum[2] += (src[1] * a + 127) / 255;
+            sum[3] += (src[2] * a + 127) / 255;
+        }
+        ++rows;
+    }
+    flush_png_row(decoder, y, rows);
+
+    png_read_end(png, nullptr);
+    cairo_surface_mark_dirty(decoder.image.get());
+    return true;
+}
+
+static shared_cairo_surface_t load_scaled_png(const unsigned char* data, size_t len,
+        const std::string& name, float hscale, float vscale)
+{
+    PngDecoder decoder;
+    decoder.stream = {data, len, 0};
+    decoder.hscale = hscale;
+    decoder.vscale = vscale;
+
+    decoder.png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!decoder.png)
+        return {};
+    decoder.info = png_create_info_struct(decoder.png);
+
+    const auto ok = decoder.info && decode_png_rows(decoder);
+    png_destroy_read_struct(&decoder.png, decoder.info ? &decoder.info : nullptr, nullptr);
+
+    if (!ok)
+    {
+        detail::debug("unable to decode {} at a scale", name);
+        return {};
+    }
+
+    return decoder.image;
+}
+#endif
+
+shared_cairo_surface_t load_scaled_image_from_memory(const unsigned char* data,
+        size_t len, const std::string& name,
+        float hscale, float vscale)
+{
+    if (!data || !len ||
+        hscale <= 0 || hscale > 1 || vscale <= 0 || vscale > 1)
+        return {};
+
+    const auto mimetype = get_mime_type(data, len);
+    if (!scalable(mimetype))
+        return {};
+
+    detail::debug("decoding {} at hscale:{} vscale:{}", name, hscale, vscale);
+
+    return shared_image_store().get(data, len, hscale, vscale,
+                                    [&]() -> shared_cairo_surface_t
+    {
+#ifdef HAVE_LIBJPEG
+        if (mimetype == MIME_JPEG)
+            return load_scaled_jpeg(data, len, hscale, vscale);
+#endif
+#ifdef HAVE_LIBPNG
+        if (mimetype == MIME_PNG)
+            return load_scaled_png(data, len, name, hscale, vscale);
+#endif
+        return {};
+    });
+}
+
+shared_cairo_surface_t load_scaled_image_from_filesystem(const std::string& path,
+        float hscale, float vscale)
+{
+    if (!detail::exists(path) || !scalable(get_mime_type(path)))
+        return {};
+
+    std::ifstream in(path, std::ios::binary);
+    const std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)),
+                                          std::istreambuf_iterator<char>());
+
+    return load_scaled_image_from_memory(data.data(), data.size(), path, hscale, vscale);
+}
+
+shared_cairo_surface_t load_scaled_image(const std::string& uri, float hscale, float vscale)
+{
+    std::string path;
+    const auto type = resolve_path(uri, path);
+
+    if (type == SchemeType::filesystem)
+        return load_scaled_image_from_filesystem(path, hscale, vscale);
+
+    // compressed resources are decoded while decompressed
+    if (type == SchemeType::resource &&
+        ResourceManager::instance().exists(path.c_str()) &&
+        !ResourceManager::instance().compressed(path.c_str()))
+    {
+        return load_scaled_image_from_memory(ResourceManager::instance().data(path.c_str()),
+                                             ResourceManager::instance().size(path.c_str()),
+                                             path, hscale, vscale);
+    }
+
+    return {};
+}
+
+shared_cairo_surface_t load_image_region(const std::string& uri, const Rect& region)
+{
+    std::string path;
+    const auto type = resolve_path(uri, path);
+
+    shared_cairo_surface_t image;
+
+    if (type == SchemeType::filesystem &&
+        get_mime_type(path) == MIME_ERAW)
+    {
+        image = load_eraw(path, region);
+    }
+    else if (type == SchemeType::resource &&
+             ResourceManager::instance().exists(path.c_str()) &&
+             get_mime_type(ResourceManager::instance().data(path.c_str()),
+                           ResourceManager::instance().size(path.c_str())) == MIME_ERAW)
+    {
+        image = load_eraw(ResourceManager::instance().data(path.c_str()),
+                          ResourceManager::instance().size(path.c_str()),
+                          region);
+    }
+    else
+    {
+        // other formats can only be decoded whole
+        Canvas canvas(region.size());
+        canvas.copy(image_cache().get(uri), RectF(region.x(), region.y(),
+                    region.width(), region.height()));
+        image = canvas.surface();
+    }
+
+    if (!image)
+        throw std::runtime_error("unable to load image region: " + uri);
+
+    return image;
+}
+
 #ifdef HAVE_LIBMAGIC
 /*
  * There is a known memory leak in magic_load() that may or may not be fixed:
@@ -9,10 +9,23 @@
 
 #include "detail/dump.h"
 #include "detail/egtlog.h"
+#include "egt/app.h"
 #include "egt/detail/image.h"
 #include "egt/detail/imagecache.h"
 #include "egt/detail/math.h"
+#include "egt/eventloop.h"
+#include "egt/resource.h"
 #include "egt/respath.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <egt/asio.hpp>
+#include <exception>
+#include <functional>
+
+#ifdef HAVE_LIBCURL
+#include "egt/network/http.h"
+#endif
 
 #ifdef HAVE_SIMD
 #include "Simd/SimdLib.hpp"
@@ -25,8 +38,72 @@ inline namespace v1
 namespace detail
 {
 
+/// Surface whose pixels another surface uses.
+static const cairo_user_data_key_t pixels_owner_key{};
+
+constexpr size_t ImageCache::DEFAULT_MAX_BYTES;
+constexpr size_t ImageCache::SHARDS;
+
+static size_t default_max_bytes()
+{
+    auto value = std::getenv("EGT_IMAGE_CACHE_SIZE");
+    if (value && strlen(value))
+    {
+        try
+        {
+            return std::stoul(value);
+        }
+        catch (const std::exception&)
+        {
+            detail::warn("invalid EGT_IMAGE_CACHE_SIZE: {}", value);
+        }
+    }
+
+    return ImageCache::DEFAULT_MAX_BYTES;
+}
+
+ImageCache::ImageCache()
+{
+    max_bytes(default_max_bytes());
+}
+
+ImageCache::~ImageCache() noexcept
+{
+    shutdown();
+}
+
+/// Is an image shrunk by a scale, so it can be decoded at the scale.
+static bool shrink(float hscale, float vscale)
+{
+    return hscale < 1.0f && vscale < 1.0f;
+}
+
+/// Size of the pixels of a surface, 0 if not an image surface.
+static size_t surface_bytes(cairo_surface_t* surface)
+{
+    if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE)
+        return 0;
+
+    return static_cast<size_t>(cairo_image_surface_get_stride(surface)) *
+           cairo_image_surface_get_height(surface);
+}
+
 shared_cairo_surface_t ImageCache::get(const std::string& uri,
                                        float hscale, float vscale, bool approximate)
+{
+    return load(uri, hscale, vscale, approximate).get();
+}
+
+/// A future of an image already at hand.
+static std::shared_future<shared_cairo_surface_t> ready(const shared_cairo_surface_t& image)
+{
+    std::promise<shared_cairo_surface_t> promise;
+    promise.set_value(image);
+    return promise.get_future().share();
+}
+
+std::shared_future<shared_cairo_surface_t> ImageCache::load(const std::string& uri,
+        float hscale, float vscale, bool approximate)
 {
     if (approximate)
     {
@@ -34,12 +111,83 @@ shared_cairo_surface_t ImageCache::get(const std::string& uri,
         vscale = ImageCache::round(vscale, 0.01);
     }
 
-    const auto nameid = id(uri, hscale, vscale);
+    shared_cairo_surface_t image;
+    if (find(KeyView(uri, hscale, vscale), image))
+        return ready(image);
 
-    auto i = m_cache.find(nameid);
-    if (i != m_cache.end())
-        return i->second;
+    std::promise<shared_cairo_surface_t> promise;
+    auto future = promise.get_future().share();
+    if (!loading(uri, hscale, vscale, future))
+        return future;
 
+    try
+    {
+        image = load_now(uri, hscale, vscale);
+        insert(Key(uri, hscale, vscale), image);
+        promise.set_value(image);
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+
+    loaded(uri, hscale, vscale);
+    return future;
+}
+
+bool ImageCache::loading(const std::string& uri, float hscale, float vscale,
+                         std::shared_future<shared_cairo_surface_t>& future)
+{
+    std::lock_guard<std::mutex> lock(m_loading_mutex);
+
+    auto i = m_loading.find(std::make_tuple(uri, hscale, vscale));
+    if (i != m_loading.end())
+    {
+        future = i->second;
+        return false;
+    }
+
+    // inserted by a load finished since the image was looked up
+    shared_cairo_surface_t image;
+    if (find(KeyView(uri, hscale, vscale), image))
+    {
+        future = ready(image);
+        return false;
+    }
+
+    m_loading.emplace(std::make_tuple(uri, hscale, vscale), future);
+    return true;
+}
+
+void ImageCache::loaded(const std::string& uri, float hscale, float vscale)
+{
+    std::lock_guard<std::mutex> lock(m_loading_mutex);
+    m_loading.erase(std::make_tuple(uri, hscale, vscale));
+}
+
+bool ImageCache::find(const KeyView& key, shared_cairo_surface_t& image)
+{
+    auto& shard = m_shards[key.hash % SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto i = shard.cache.find(key);
+    if (!i)
+        return false;
+
+    image = *i;
+    return true;
+}
+
+void ImageCache::insert(Key key, const shared_cairo_surface_t& image)
+{
+    auto& shard = m_shards[key.hash % SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    shard.cache.insert(std::move(key), image, surface_bytes(image.get()));
+}
+
+shared_cairo_surface_t ImageCache::load_now(const std::string& uri, float hscale, float vscale)
+{
     EGTLOG_DEBUG("image cache miss {} hscale:{} vscale:{}", uri, hscale, vscale);
 
     shared_cairo_surface_t image;
@@ -75,20 +223,46 @@ shared_cairo_surface_t ImageCache::get(const std::string& uri,
     }
     else
     {
-        shared_cairo_surface_t back = get(uri, 1.0);
+        std::string source;
+        const auto scale = baked_scale(uri, hscale, vscale, source);
 
-        auto width = cairo_image_surface_get_width(back.get());
-        auto height = cairo_image_surface_get_height(back.get());
+        // without the original at hand, decode straight at the scale if possible
+        shared_cairo_surface_t original;
+        if (shrink(hscale, vscale) && source == uri &&
+            !find(KeyView(uri, 1.0f, 1.0f), original))
+        {
+            detail::code_timer(false, "scaled decode: ", [&]()
+            {
+                image = detail::load_scaled_image(uri, hscale, vscale);
+            });
+        }
 
-        detail::code_timer(false, "scale: ", [&]()
+        if (!image)
         {
-            image = scale_surface(back,
-                                  width, height,
-                                  width * hscale,
-                                  height * vscale);
-        });
+            shared_cairo_surface_t back = get(source, 1.0);
+
+            if (detail::float_equal(hscale, scale) &&
+                detail::float_equal(vscale, scale))
+            {
+                image = back;
+            }
+            else
+            {
+                detail::code_timer(false, "scale: ", [&]()
+                {
+                    image = scale_image(back, hscale / scale, vscale / scale);
+                });
+            }
+        }
     }
 
+    check_image(image, uri);
+
+    return native(image, m_format);
+}
+
+void ImageCache::check_image(const shared_cairo_surface_t& image, const std::string& uri)
+{
     if (!image)
     {
         throw std::runtime_error(fmt::format("unable to load image: {}", uri));
@@ -99,15 +273,594 @@ shared_cairo_surface_t ImageCache::get(const std::string& uri,
         throw std::runtime_error(fmt::format(
                                      "cairo: {}: {}", cairo_status_to_string(cairo_surface_status(image.get())), uri));
     }
+}
+
+/// Is the alpha of every pixel of an ARGB32 image surface 0xff.
+static bool opaque_pixels(cairo_surface_t* image)
+{
+    cairo_surface_flush(image);
+
+    const auto data = cairo_image_surface_get_data(image);
+    const auto stride = cairo_image_surface_get_stride(image);
+    const auto width = cairo_image_surface_get_width(image);
+    const auto height = cairo_image_surface_get_height(image);
+
+    for (auto y = 0; y < height; ++y)
+    {
+        const auto row = reinterpret_cast<const uint32_t*>(data + y * stride);
+        for (auto x = 0; x < width; ++x)
+        {
+            if ((row[x] >> 24u) != 0xffu)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+shared_cairo_surface_t ImageCache::native(const shared_cairo_surface_t& image,
+        PixelFormat format)
+{
+    if (!image || cairo_surface_get_type(image.get()) != CAIRO_SURFACE_TYPE_IMAGE)
+        return image;
+
+    const auto from = cairo_image_surface_get_format(image.get());
+    if (from == CAIRO_FORMAT_ARGB32)
+    {
+        if (!opaque_pixels(image.get()))
+            return image;
+    }
+    else if (from != CAIRO_FORMAT_RGB24)
+    {
+        return image;
+    }
+
+    // 32 bpp screens draw RGB24 as fast as their own format
+    const auto to = format == PixelFormat::rgb565 ? CAIRO_FORMAT_RGB16_565 : CAIRO_FORMAT_RGB24;
+    if (from == to)
+        return image;
+
+    const auto width = cairo_image_surface_get_width(image.get());
+    const auto height = cairo_image_surface_get_height(image.get());
+
+    if (to == CAIRO_FORMAT_RGB24)
+    {
+        /*
+         * The same pixels, only without alpha, so they are used in place
+         * instead of copied, which also keeps images mapped from the shared
+         * store shared.
+         */
+        cairo_surface_flush(image.get());
+        auto result = shared_cairo_surface_t(
+                          cairo_image_surface_create_for_data(cairo_image_surface_get_data(image.get()),
+                                  to, width, height,
+                                  cairo_image_surface_get_stride(image.get())),
+                          cairo_surface_destroy);
+        auto owner = new shared_cairo_surface_t(image);
+        if (cairo_surface_set_user_data(result.get(), &pixels_owner_key, owner,
+                                        [](void* data) { delete static_cast<shared_cairo_surface_t*>(data); })
+            == CAIRO_STATUS_SUCCESS)
+            return result;
+
+        delete owner;
+    }
+
+    auto result = shared_cairo_surface_t(cairo_image_surface_create(to, width, height),
+                                         cairo_surface_destroy);
+
+    {
+        auto cr = shared_cairo_t(cairo_create(result.get()), cairo_destroy);
+        cairo_set_source_surface(cr.get(), image.get(), 0, 0);
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_paint(cr.get());
+    }
 
-    m_cache.insert(std::make_pair(nameid, image));
+    return result;
+}
 
-    return image;
+void ImageCache::format(PixelFormat format)
+{
+    if (m_format.exchange(format) != format)
+        clear();
+}
+
+float ImageCache::baked_scale(const std::string& uri, float hscale, float vscale,
+                              std::string& source)
+{
+    source = uri;
+
+    std::string path;
+    if (detail::resolve_path(uri, path) != detail::SchemeType::resource)
+        return 1.0f;
+
+    const auto target = std::max(hscale, vscale);
+    const auto covers = [target](float scale)
+    {
+        return scale > target || detail::float_equal(scale, target);
+    };
+
+    auto best = 1.0f;
+    const auto prefix = path + "@";
+    for (const auto& name : ResourceManager::instance().list(prefix))
+    {
+        char* end = nullptr;
+        const auto scale = std::strtof(name.c_str() + prefix.size(), &end);
+        if (*end || scale <= 0)
+            continue;
+
+        const auto better = covers(scale) ?
+                            !covers(best) || scale < best :
+                            !covers(best) && scale > best;
+        if (better)
+        {
+            best = scale;
+            source = "res:" + name;
+        }
+    }
+
+    return best;
+}
+
+shared_cairo_surface_t ImageCache::scale_image(const shared_cairo_surface_t& image,
+        float hscale, float vscale)
+{
+    auto width = cairo_image_surface_get_width(image.get());
+    auto height = cairo_image_surface_get_height(image.get());
+
+    return scale_surface(image,
+                         width, height,
+                         width * hscale,
+                         height * vscale);
+}
+
+uint64_t ImageCache::prefetch(const std::string& uri,
+                              float hscale, float vscale, bool approximate,
+                              PrefetchCallback callback)
+{
+    if (approximate)
+    {
+        hscale = ImageCache::round(hscale, 0.01);
+        vscale = ImageCache::round(vscale, 0.01);
+    }
+
+    shared_cairo_surface_t image;
+    if (find(KeyView(uri, hscale, vscale), image))
+    {
+        if (callback)
+            callback(image);
+        return 0;
+    }
+
+    const auto id = ++m_prefetch_id;
+
+    auto& callbacks = m_prefetches[std::make_tuple(uri, hscale, vscale)];
+    const auto prefetching = !callbacks.empty();
+    callbacks.emplace_back(id, std::move(callback));
+    if (prefetching)
+        return id;
+
+    // loads of the image by other threads wait for this one, and the other way around
+    auto promise = std::make_shared<std::promise<shared_cairo_surface_t>>();
+    auto future = promise->get_future().share();
+    if (!loading(uri, hscale, vscale, future))
+    {
+        wait(uri, hscale, vscale, future);
+        return id;
+    }
+
+    EGTLOG_DEBUG("image prefetch {} hscale:{} vscale:{}", uri, hscale, vscale);
+
+    // scale from the closest baked variant, if any
+    auto source = uri;
+    auto scale = 1.0f;
+    if (!detail::float_equal(hscale, 1.0f) ||
+        !detail::float_equal(vscale, 1.0f))
+        scale = baked_scale(uri, hscale, vscale, source);
+
+    const auto scaled = !detail::float_equal(hscale, scale) ||
+                        !detail::float_equal(vscale, scale);
+
+    // the cache and resources are only used from the event loop
+    shared_cairo_surface_t back;
+    if (scaled || source != uri)
+        find(KeyView(source, 1.0f, 1.0f), back);
+
+    if (back)
+    {
+        decode(uri, source, hscale, vscale, scale, promise, back, nullptr);
+        return id;
+    }
+
+    std::string path;
+    auto type = detail::resolve_path(source, path);
+
+    switch (type)
+    {
+    case detail::SchemeType::resource:
+    {
+        if (!ResourceManager::instance().exists(path.c_str()))
+        {
+            decode(uri, source, hscale, vscale, scale, promise, nullptr,
+                   [path]() -> shared_cairo_surface_t
+            {
+                throw std::runtime_error("resource not found: " + path);
+            });
+        }
+        else if (ResourceManager::instance().compressed(path.c_str()))
+        {
+            // a compressed resource is decompressed by the worker, while decoded
+            std::shared_ptr<ResourceStream> stream = ResourceManager::instance().open(path.c_str());
+            decode(uri, source, hscale, vscale, scale, promise, nullptr, [stream, path]()
+            {
+                return detail::load_image_from_stream(*stream, path);
+            });
+        }
+        else
+        {
+            const auto data = ResourceManager::instance().data(path.c_str());
+            const auto len = ResourceManager::instance().size(path.c_str());
+            decode(uri, source, hscale, vscale, scale, promise, nullptr, [data, len, path]()
+            {
+                return detail::load_image_from_memory(data, len, path);
+            }, [data, len, path, hscale, vscale]()
+            {
+                return detail::load_scaled_image_from_memory(data, len, path, hscale, vscale);
+            });
+        }
+        break;
+    }
+    case detail::SchemeType::filesystem:
+    {
+        decode(uri, source, hscale, vscale, scale, promise, nullptr, [path]()
+        {
+            return detail::load_image_from_filesystem(path);
+        }, [path, hscale, vscale]()
+        {
+            return detail::load_scaled_image_from_filesystem(path, hscale, vscale);
+        });
+        break;
+    }
+    case detail::SchemeType::network:
+    {
+        download(uri, path, hscale, vscale, promise);
+        break;
+    }
+    default:
+    {
+        decode(uri, source, hscale, vscale, scale, promise, nullptr,
+               [uri]() -> shared_cairo_surface_t
+        {
+            throw std::runtime_error("unsupported uri: " + uri);
+        });
+        break;
+    }
+    }
+
+    return id;
+}
+
+void ImageCache::decode(const std::string& uri, const std::string& source,
+                        float hscale, float vscale, float scale,
+                        const Promise& promise,
+                        const shared_cairo_surface_t& back, Loader load,
+                        Loader load_scaled)
+{
+    const auto scaled = !detail::float_equal(hscale, scale) ||
+                        !detail::float_equal(vscale, scale);
+
+    // the original is not kept when decoded straight at the scale
+    if (back || source != uri || !shrink(hscale, vscale))
+        load_scaled = nullptr;
+
+    const PixelFormat format = m_format;
+
+    Application::instance().event().submit([uri, hscale, vscale, scale, scaled, back, load,
+                                                         load_scaled, format, promise]()
+    {
+        Decoded decoded;
+
+        try
+        {
+            if (load_scaled)
+            {
+                decoded.image = load_scaled();
+                if (decoded.image)
+                {
+                    check_image(decoded.image, uri);
+                    decoded.image = native(decoded.image, format);
+                    promise->set_value(decoded.image);
+                    return decoded;
+                }
+            }
+
+            if (!back)
+            {
+                decoded.original = load();
+                check_image(decoded.original, uri);
+                decoded.original = native(decoded.original, format);
+            }
+
+            if (scaled)
+            {
+                decoded.image = scale_image(back ? back : decoded.original,
+                                            hscale / scale, vscale / scale);
+                check_image(decoded.image, uri);
+                decoded.image = native(decoded.image, format);
+            }
+            else
+            {
+                decoded.image = back ? back : decoded.original;
+            }
+
+            promise->set_value(decoded.image);
+        }
+        catch (const std::exception& e)
+        {
+            decoded.error = e.what();
+            decoded.image.reset();
+            promise->set_exception(std::current_exception());
+        }
+
+        return decoded;
+    }, [this, uri, source, hscale, vscale](Decoded decoded)
+    {
+        prefetched(uri, source, hscale, vscale, decoded.original, decoded.image, decoded.error);
+        loaded(uri, hscale, vscale);
+    });
+}
+
+void ImageCache::wait(const std::string& uri, float hscale, float vscale,
+                      const std::shared_future<shared_cairo_surface_t>& future)
+{
+    Application::instance().event().submit([future]()
+    {
+        Decoded decoded;
+
+        try
+        {
+            decoded.image = future.get();
+        }
+        catch (const std::exception& e)
+        {
+            decoded.error = e.what();
+        }
+
+        return decoded;
+    }, [this, uri, hscale, vscale](Decoded decoded)
+    {
+        prefetched(uri, uri, hscale, vscale, nullptr, decoded.image, decoded.error);
+    });
+}
+
+void ImageCache::download(const std::string& uri, const std::string& url,
+                          float hscale, float vscale, const Promise& promise)
+{
+#ifdef HAVE_LIBCURL
+    auto data = std::make_shared<std::vector<unsigned char>>();
+
+    m_downloads.push_back(std::make_shared<experimental::HttpClientRequest>());
+    auto request = m_downloads.back().get();
+
+    try
+    {
+        request->start_async(url, [this, request, data, uri, url, hscale, vscale, promise]
+                             (const unsigned char* buf, size_t len, bool done)
+        {
+            if (buf && len)
+                data->insert(data->end(), buf, buf + len);
+
+            if (!done)
+                return;
+
+            const auto ok = request->ok();
+            const auto status = request->status();
+
+            // the request is used after its callback, so it is destroyed later
+            asio::post(Application::instance().event().io(), [this, request]()
+            {
+                finished(request);
+            });
+
+            decode(uri, uri, hscale, vscale, 1.0f, promise, nullptr, [data, ok, status, url]()
+            {
+                if (!ok)
+                    throw std::runtime_error(fmt::format("unable to download {}: status {}", url, status));
+
+                return detail::load_image_from_memory(data->data(), data->size(), url);
+            });
+        });
+    }
+    catch (const std::exception& e)
+    {
+        finished(request);
+
+        const std::string error = e.what();
+        decode(uri, uri, hscale, vscale, 1.0f, promise, nullptr,
+               [error]() -> shared_cairo_surface_t
+        {
+            throw std::runtime_error(error);
+        });
+    }
+#else
+    // warns network support is not available
+    decode(uri, uri, hscale, vscale, 1.0f, promise, nullptr, [url]()
+    {
+        return detail::load_image_from_network(url);
+    });
+#endif
+}
+
+void ImageCache::finished(experimental::HttpClientRequest* request)
+{
+    auto i = std::find_if(m_downloads.begin(), m_downloads.end(),
+                          [request](const auto & download) { return download.get() == request; });
+    if (i != m_downloads.end())
+        m_downloads.erase(i);
+}
+
+void ImageCache::prefetched(const std::string& uri, const std::string& source,
+                            float hscale, float vscale,
+                            const shared_cairo_surface_t& original,
+                            const shared_cairo_surface_t& image,
+                            const std::string& error)
+{
+    if (original && (original != image || source != uri))
+        insert(Key(source, 1.0f, 1.0f), original);
+    if (image)
+        insert(Key(uri, hscale, vscale), image);
+    else
+        detail::warn("unable to prefetch image {}: {}", uri, error);
+
+    auto i = m_prefetches.find(std::make_tuple(uri, hscale, vscale));
+    if (i == m_prefetches.end())
+        return;
+
+    // callbacks may prefetch or cancel
+    auto callbacks = std::move(i->second);
+    m_prefetches.erase(i);
+
+    for (auto& callback : callbacks)
+    {
+        if (callback.second)
+            callback.second(image);
+    }
+}
+
+uint64_t ImageCache::post(std::function<void()> job, std::function<void()> done)
+{
+    const auto id = ++m_prefetch_id;
+
+    const auto handle = Application::instance().event().submit([job = std::move(job)]()
+    {
+        try
+        {
+            job();
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("image job failed: {}", e.what());
+        }
+    }, [this, id, done = std::move(done)]()
+    {
+        // the callback may post or cancel
+        m_jobs.erase(id);
+
+        if (done)
+            done();
+    });
+    m_jobs.emplace(id, handle);
+
+    return id;
+}
+
+void ImageCache::cancel(uint64_t id)
+{
+    if (!id)
+        return;
+
+    auto i = m_jobs.find(id);
+    if (i != m_jobs.end())
+    {
+        Application::instance().event().cancel(i->second);
+        m_jobs.erase(i);
+        return;
+    }
+
+    for (auto& prefetch : m_prefetches)
+    {
+        for (auto& callback : prefetch.second)
+        {
+            if (callback.first == id)
+            {
+                // the image is still loaded
+                callback.second = nullptr;
+                return;
+            }
+        }
+    }
+}
+
+void ImageCache::shutdown()
+{
+    // decoding images still running is waited for by the event loop
+    if (Application::check_instance())
+    {
+        for (auto& job : m_jobs)
+            Application::instance().event().cancel(job.second);
+    }
+
+    m_prefetches.clear();
+    m_jobs.clear();
+    m_downloads.clear();
+
+    std::lock_guard<std::mutex> lock(m_loading_mutex);
+    m_loading.clear();
 }
 
 void ImageCache::clear()
 {
-    m_cache.clear();
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.clear();
+    }
+}
+
+void ImageCache::trim(size_t bytes)
+{
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.trim(bytes / SHARDS);
+    }
+}
+
+void ImageCache::max_bytes(size_t bytes)
+{
+    m_max_bytes = bytes;
+
+    // each shard holds its part, at least a byte so there is a limit
+    const auto max = bytes ? std::max<size_t>(bytes / SHARDS, 1) : 0;
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.max_cost(max);
+    }
+}
+
+size_t ImageCache::bytes() const
+{
+    size_t total = 0;
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.cache.cost();
+    }
+    return total;
+}
+
+size_t ImageCache::size() const
+{
+    size_t total = 0;
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.cache.size();
+    }
+    return total;
+}
+
+CacheStats ImageCache::stats() const
+{
+    CacheStats total;
+    for (auto& shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total.hits += shard.cache.stats().hits;
+        total.misses += shard.cache.stats().misses;
+        total.evictions += shard.cache.stats().evictions;
+    }
+    return total;
 }
 
 float ImageCache::round(float v, float fraction)
@@ -115,9 +868,46 @@ float ImageCache::round(float v, float fraction)
     return floorf(v) + floorf((v - floorf(v)) / fraction) * fraction;
 }
 
-std::string ImageCache::id(const std::string& name, float hscale, float vscale)
+size_t ImageCache::hash(std::string_view uri, float hscale, float vscale) noexcept
 {
-    return fmt::format("{}-{}-{}", name, hscale * 100, vscale * 100);
+    auto seed = std::hash<std::string_view>()(uri);
+    for (auto scale : {hscale, vscale})
+        seed ^= std::hash<float>()(scale) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+}
+
+/// Scale an image surface with cairo.
+static shared_cairo_surface_t scale_surface_cairo(const shared_cairo_surface_t& old_surface,
+        float old_width, float old_height,
+        float new_width, float new_height)
+{
+    auto new_surface = shared_cairo_surface_t(
+                           cairo_surface_create_similar(old_surface.get(),
+                                   cairo_surface_get_content(old_surface.get()),
+                                   new_width,
+                                   new_height),
+                           cairo_surface_destroy);
+    auto cr = shared_cairo_t(cairo_create(new_surface.get()),
+                             cairo_destroy);
+
+    /* Scale *before* setting the source surface (1) */
+    cairo_scale(cr.get(),
+                new_width / old_width,
+                new_height / old_height);
+    cairo_set_source_surface(cr.get(), old_surface.get(), 0, 0);
+
+    /* To avoid getting the edge pixels blended with 0 alpha, which would
+     * occur with the default EXTEND_NONE. Use EXTEND_PAD for 1.2 or newer (2)
+     */
+    cairo_pattern_set_extend(cairo_get_source(cr.get()), CAIRO_EXTEND_REFLECT);
+
+    /* Replace the destination with the source instead of overlaying */
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+
+    /* Do the actual drawing */
+    cairo_paint(cr.get());
+
+    return new_surface;
 }
 
 #ifdef HAVE_SIMD
@@ -126,11 +916,16 @@ ImageCache::scale_surface(const shared_cairo_surface_t& old_surface,
                           float old_width, float old_height,
                           float new_width, float new_height)
 {
+    // resized as 4 channels of 8 bits
+    if (cairo_image_surface_get_format(old_surface.get()) != CAIRO_FORMAT_ARGB32 &&
+        cairo_image_surface_get_format(old_surface.get()) != CAIRO_FORMAT_RGB24)
+        return scale_surface_cairo(old_surface, old_width, old_height, new_width, new_height);
+
     cairo_surface_flush(old_surface.get());
 
     auto new_surface = shared_cairo_surface_t(
                            cairo_surface_create_similar(old_surface.get(),
-                                   CAIRO_CONTENT_COLOR_ALPHA,
+                                   cairo_surface_get_content(old_surface.get()),
                                    new_width,
                                    new_height),
                            cairo_surface_destroy);
@@ -155,33 +950,7 @@ ImageCache::scale_surface(const shared_cairo_surface_t& old_surface,
                           float old_width, float old_height,
                           float new_width, float new_height)
 {
-    auto new_surface = shared_cairo_surface_t(
-                           cairo_surface_create_similar(old_surface.get(),
-                                   CAIRO_CONTENT_COLOR_ALPHA,
-                                   new_width,
-                                   new_height),
-                           cairo_surface_destroy);
-    auto cr = shared_cairo_t(cairo_create(new_surface.get()),
-                             cairo_destroy);
-
-    /* Scale *before* setting the source surface (1) */
-    cairo_scale(cr.get(),
-                new_width / old_width,
-                new_height / old_height);
-    cairo_set_source_surface(cr.get(), old_surface.get(), 0, 0);
-
-    /* To avoid getting the edge pixels blended with 0 alpha, which would
-     * occur with the default EXTEND_NONE. Use EXTEND_PAD for 1.2 or newer (2)
-     */
-    cairo_pattern_set_extend(cairo_get_source(cr.get()), CAIRO_EXTEND_REFLECT);
-
-    /* Replace the destination with the source instead of overlaying */
-    cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
-
-    /* Do the actual drawing */
-    cairo_paint(cr.get());
-
-    return new_surface;
+    return scale_surface_cairo(old_surface, old_width, old_height, new_width, new_height);
 }
 #endif
 
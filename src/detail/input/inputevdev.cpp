@@ -5,18 +5,23 @@
  */
 #include "detail/egtlog.h"
 #include "detail/input/inputkeyboard.h"
+#include "detail/input/inputthread.h"
+#include "detail/priorityqueue.h"
 #include "egt/app.h"
 #include "egt/detail/input/inputevdev.h"
 #include "egt/geometry.h"
 #include "egt/keycode.h"
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <fcntl.h>
 #include <linux/input.h>
 #include <string>
+#include <sys/ioctl.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -27,6 +32,20 @@ inline namespace v1
 namespace detail
 {
 
+/// Time of an event, from CLOCK_MONOTONIC like std::chrono::steady_clock.
+static inline std::chrono::steady_clock::time_point event_time(const struct input_event& e)
+{
+#ifdef input_event_sec
+    const auto sec = e.input_event_sec;
+    const auto usec = e.input_event_usec;
+#else
+    const auto sec = e.time.tv_sec;
+    const auto usec = e.time.tv_usec;
+#endif
+    return std::chrono::steady_clock::time_point(std::chrono::seconds(sec) +
+            std::chrono::microseconds(usec));
+}
+
 InputEvDev::InputEvDev(Application& app, const std::string& path)
     : m_input(app.event().io()),
       m_input_buf(sizeof(struct input_event) * 10),
@@ -37,13 +56,31 @@ InputEvDev::InputEvDev(Application& app, const std::string& path)
     {
         detail::info("input device: {}", path);
 
+        // report event times from the clock the profiler uses
+        int clock = CLOCK_MONOTONIC;
+        m_monotonic = ioctl(m_fd, EVIOCSCLOCKID, &clock) == 0;
+
+        if (input_thread_enabled())
+        {
+            m_thread = std::make_unique<InputThread>(app, m_fd,
+                       std::bind(&InputEvDev::read_device, this),
+                       [this](Event & event, std::chrono::steady_clock::time_point when)
+            {
+                timestamp(when);
+                dispatch(event);
+                timestamp({});
+            });
+            return;
+        }
+
         m_input.assign(m_fd);
 
         asio::async_read(m_input, asio::buffer(m_input_buf.data(), m_input_buf.size()),
                          egt::asio::transfer_at_least(sizeof(struct input_event)),
-                         std::bind(&InputEvDev::handle_read, this,
-                                   std::placeholders::_1,
-                                   std::placeholders::_2));
+                         app.event().queue().wrap(detail::priorities::input,
+                                 std::bind(&InputEvDev::handle_read, this,
+                                           std::placeholders::_1,
+                                           std::placeholders::_2), this));
     }
     else
     {
@@ -51,6 +88,35 @@ InputEvDev::InputEvDev(Application& app, const std::string& path)
     }
 }
 
+bool InputEvDev::read_device()
+{
+    const auto length = ::read(m_fd, m_input_buf.data(), m_input_buf.size());
+    if (length < 0)
+        return errno == EINTR || errno == EAGAIN;
+    if (length == 0)
+        return false;
+
+    // without kernel times, the time of the read is still closer than the
+    // time of dispatch
+    if (!m_monotonic)
+        m_time = std::chrono::steady_clock::now();
+
+    process(length);
+    return true;
+}
+
+void InputEvDev::report(Event& event)
+{
+    if (m_thread)
+    {
+        m_thread->push(event, m_time);
+        return;
+    }
+
+    timestamp(m_time);
+    dispatch(event);
+}
+
 void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
 {
     if (error)
@@ -59,6 +125,22 @@ void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
         return;
     }
 
+    process(length);
+
+    // don't let the time of this read apply to a later event
+    m_time = {};
+    timestamp({});
+
+    asio::async_read(m_input, asio::buffer(m_input_buf.data(), m_input_buf.size()),
+                     egt::asio::transfer_at_least(sizeof(struct input_event)),
+                     Application::instance().event().queue().wrap(detail::priorities::input,
+                             std::bind(&InputEvDev::handle_read, this,
+                                       std::placeholders::_1,
+                                       std::placeholders::_2), this));
+}
+
+void InputEvDev::process(std::size_t length)
+{
     const auto ev = reinterpret_cast<struct input_event*>(m_input_buf.data());
     const struct input_event* e;
 
@@ -80,6 +162,9 @@ void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
     {
         auto value = e->value;
 
+        if (m_monotonic)
+            m_time = event_time(*e);
+
         EGTLOG_DEBUG("event type: {}", e->type);
         switch (e->type)
         {
@@ -147,28 +232,28 @@ void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
             {
                 Event event(value ? EventId::raw_pointer_down : EventId::raw_pointer_up,
                             Pointer(m_last_point, Pointer::Button::left));
-                dispatch(event);
+                report(event);
                 break;
             }
             case BTN_RIGHT:
             {
                 Event event(value ? EventId::raw_pointer_down : EventId::raw_pointer_up,
                             Pointer(m_last_point, Pointer::Button::right));
-                dispatch(event);
+                report(event);
                 break;
             }
             case BTN_MIDDLE:
             {
                 Event event(value ? EventId::raw_pointer_down : EventId::raw_pointer_up,
                             Pointer(m_last_point, Pointer::Button::middle));
-                dispatch(event);
+                report(event);
                 break;
             }
             case BTN_TOUCH:
             {
                 Event event(value ? EventId::raw_pointer_down : EventId::raw_pointer_up,
                             Pointer(m_last_point, Pointer::Button::none));
-                dispatch(event);
+                report(event);
                 break;
             }
             default:
@@ -179,21 +264,21 @@ void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
                 {
                     const auto unicode = m_keyboard->on_key(e->code, EventId::keyboard_up);
                     Event event(EventId::keyboard_up, Key(linux_to_ekey(e->code), unicode));
-                    dispatch(event);
+                    report(event);
                     break;
                 }
                 case 1:
                 {
                     const auto unicode = m_keyboard->on_key(e->code, EventId::keyboard_down);
                     Event event(EventId::keyboard_down, Key(linux_to_ekey(e->code), unicode));
-                    dispatch(event);
+                    report(event);
                     break;
                 }
                 case 2:
                 {
                     const auto unicode = m_keyboard->on_key(e->code, EventId::keyboard_repeat);
                     Event event(EventId::keyboard_repeat, Key(linux_to_ekey(e->code), unicode));
-                    dispatch(event);
+                    report(event);
                     break;
                 }
                 default:
@@ -210,24 +295,24 @@ void InputEvDev::handle_read(const asio::error_code& error, std::size_t length)
     {
         m_last_point = DisplayPoint(m_last_point.x() + dx, m_last_point.y() + dy);
         Event event(EventId::raw_pointer_move, Pointer(m_last_point));
-        dispatch(event);
+        report(event);
     }
     else if (x != last_x || y != last_y)
     {
         m_last_point = DisplayPoint(x, y);
         Event event(EventId::raw_pointer_move, Pointer(m_last_point));
-        dispatch(event);
+        report(event);
     }
-
-    asio::async_read(m_input, asio::buffer(m_input_buf.data(), m_input_buf.size()),
-                     egt::asio::transfer_at_least(sizeof(struct input_event)),
-                     std::bind(&InputEvDev::handle_read, this,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
 }
 
 InputEvDev::~InputEvDev() noexcept
 {
+    // stop reading before closing the device
+    m_thread.reset();
+
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+
     if (m_fd >= 0)
         close(m_fd);
 }
@@ -7,6 +7,7 @@
 #include "detail/asioallocator.h"
 #include "detail/dump.h"
 #include "detail/input/inputkeyboard.h"
+#include "detail/priorityqueue.h"
 #include "egt/app.h"
 #include "egt/detail/input/inputlibinput.h"
 #include "egt/detail/meta.h"
@@ -14,6 +15,7 @@
 #include "egt/eventloop.h"
 #include "egt/keycode.h"
 #include "egt/screen.h"
+#include <chrono>
 #include <cstdarg>
 #include <filesystem>
 #include <libinput.h>
@@ -44,6 +46,12 @@ inline namespace v1
 namespace detail
 {
 
+/// libinput event times are from CLOCK_MONOTONIC, like std::chrono::steady_clock.
+static inline std::chrono::steady_clock::time_point event_time(uint64_t usec)
+{
+    return std::chrono::steady_clock::time_point(std::chrono::microseconds(usec));
+}
+
 struct InputLibInput::LibInputImpl
 {
     detail::HandlerAllocator allocator;
@@ -171,21 +179,13 @@ InputLibInput::InputLibInput(Application& app, const std::filesystem::path& devi
     m_input.assign(libinput_get_fd(m_libinput_handle));
 
     // go ahead and enumerate devices and start the first async_read
-#ifdef USE_PRIORITY_QUEUE
     asio::async_read(m_input, asio::null_buffers(),
-                     m_app.event().queue().wrap(detail::priorities::moderate,
-                             [this](const asio::error_code & error, std::size_t)
+                     m_app.event().queue().wrap(detail::priorities::input,
+                             detail::make_custom_alloc_handler(m_impl->allocator,
+                                     [this](const asio::error_code & error, std::size_t)
     {
         handle_read(error);
-    }));
-#else
-    asio::async_read(m_input, asio::null_buffers(),
-                     detail::make_custom_alloc_handler(m_impl->allocator,
-                             [this](const asio::error_code & error, std::size_t)
-    {
-        handle_read(error);
-    }));
-#endif
+    }), this));
 }
 
 void InputLibInput::handle_event_device_notify(struct libinput_event* ev)
@@ -232,6 +232,8 @@ void InputLibInput::handle_event_touch(struct libinput_event* ev)
     if (slot < 0 || slot >= static_cast<decltype(slot)>(m_last_point.size()))
         return;
 
+    timestamp(event_time(libinput_event_touch_get_time_usec(t)));
+
     switch (libinput_event_get_type(ev))
     {
     case LIBINPUT_EVENT_TOUCH_UP:
@@ -275,6 +277,8 @@ void InputLibInput::handle_event_pointer_motion(struct libinput_event* ev)
     const auto x = libinput_event_pointer_get_dx(t);
     const auto y = libinput_event_pointer_get_dy(t);
 
+    timestamp(event_time(libinput_event_pointer_get_time_usec(t)));
+
     m_last_point[0] += DisplayPoint(x, y);
     Event event(EventId::raw_pointer_move, Pointer(m_last_point[0], 0));
     dispatch(event);
@@ -288,6 +292,8 @@ void InputLibInput::handle_event_pointer_motion_absolute(struct libinput_event*
     const auto x = libinput_event_pointer_get_absolute_x_transformed(t, screen_size.width());
     const auto y = libinput_event_pointer_get_absolute_y_transformed(t, screen_size.height());
 
+    timestamp(event_time(libinput_event_pointer_get_time_usec(t)));
+
     m_last_point[0] = DisplayPoint(x, y);
     Event event(EventId::raw_pointer_move, Pointer(m_last_point[0], 0));
     dispatch(event);
@@ -302,6 +308,8 @@ void InputLibInput::handle_event_keyboard(struct libinput_event* ev)
 
     static const auto EVDEV_OFFSET = 8;
 
+    timestamp(event_time(libinput_event_keyboard_get_time_usec(k)));
+
     switch (libinput_event_keyboard_get_key_state(k))
     {
     case LIBINPUT_KEY_STATE_PRESSED:
@@ -349,6 +357,7 @@ void InputLibInput::handle_event_button(struct libinput_event* ev)
     if (b != Pointer::Button::none)
     {
         const bool is_press = libinput_event_pointer_get_button_state(p) == LIBINPUT_BUTTON_STATE_PRESSED;
+        timestamp(event_time(libinput_event_pointer_get_time_usec(p)));
         Event event(is_press ? EventId::raw_pointer_down : EventId::raw_pointer_up,
                     Pointer(m_last_point[0], b));
         dispatch(event);
@@ -433,26 +442,19 @@ void InputLibInput::handle_read(const asio::error_code& error)
             libinput_event_destroy(ev);
         }
 
-#ifdef USE_PRIORITY_QUEUE
-        asio::async_read(m_input, asio::null_buffers(),
-                         m_app.event().queue().wrap(detail::priorities::moderate,
-                                 [this](const asio::error_code & error, std::size_t)
-        {
-            handle_read(error);
-        }));
-#else
         asio::async_read(m_input, asio::null_buffers(),
-                         detail::make_custom_alloc_handler(m_impl->allocator,
-                                 [this](const asio::error_code & error, std::size_t)
+                         m_app.event().queue().wrap(detail::priorities::input,
+                                 detail::make_custom_alloc_handler(m_impl->allocator,
+                                         [this](const asio::error_code & error, std::size_t)
         {
             handle_read(error);
-        }));
-#endif
+        }), this));
     });
 }
 
 InputLibInput::~InputLibInput() noexcept
 {
+    m_app.event().queue().cancel(this);
     libinput_unref(m_libinput_handle);
 }
 
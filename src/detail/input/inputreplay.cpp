@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "config.h"
+#include "detail/egtlog.h"
+#include "detail/priorityqueue.h"
+#include "egt/app.h"
+#include "egt/detail/input/inputreplay.h"
+#include "egt/profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <stdexcept>
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Magic number at the start of a recording: "EGTI".
+static constexpr uint32_t RECORD_MAGIC = 0x49544745;
+
+/// Version of the record layout.
+static constexpr uint32_t RECORD_VERSION = 1;
+
+static_assert(sizeof(InputReplay::Record) == 24, "records must stay compact");
+
+/// Events coming from the backends, as opposed to the ones synthesized from them.
+static bool recordable(EventId id)
+{
+    switch (id)
+    {
+    case EventId::raw_pointer_down:
+    case EventId::raw_pointer_up:
+    case EventId::raw_pointer_move:
+    case EventId::pointer_dblclick:
+    case EventId::keyboard_down:
+    case EventId::keyboard_up:
+    case EventId::keyboard_repeat:
+        return true;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static bool is_key(EventId id)
+{
+    return id == EventId::keyboard_down ||
+           id == EventId::keyboard_up ||
+           id == EventId::keyboard_repeat;
+}
+
+/// Key modifiers, stored as their bits.
+static constexpr Key::KeyMod key_mods[] =
+{
+    Key::KeyMod::shift,
+    Key::KeyMod::control,
+    Key::KeyMod::lock,
+};
+
+InputRecorder* InputRecorder::m_active = nullptr;
+
+InputRecorder::InputRecorder(const std::string& path)
+    : m_out(path, std::ios::binary | std::ios::trunc)
+{
+    if (!m_out)
+        throw std::runtime_error(fmt::format("unable to create input recording: {}", path));
+
+    const uint32_t header[] = {RECORD_MAGIC, RECORD_VERSION};
+    m_out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    m_previous = m_active;
+    m_active = this;
+
+    detail::info("recording input to {}", path);
+}
+
+void InputRecorder::capture(const Event& event, std::chrono::steady_clock::time_point when)
+{
+    auto recorder = m_active;
+    if (!recorder || !recordable(event.id()))
+        return;
+
+    if (!recorder->m_count)
+        recorder->m_start = when;
+
+    InputReplay::Record record{};
+    record.time = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::max(when - recorder->m_start, std::chrono::steady_clock::duration())).count();
+    record.id = static_cast<uint32_t>(event.id());
+    if (is_key(event.id()))
+    {
+        record.a = event.key().keycode;
+        record.b = static_cast<int32_t>(event.key().unicode);
+        for (auto mod : key_mods)
+            if (event.key().state.is_set(mod))
+                record.c |= static_cast<uint32_t>(mod);
+    }
+    else
+    {
+        record.a = event.pointer().point.x();
+        record.b = event.pointer().point.y();
+        record.c = (static_cast<uint32_t>(event.pointer().slot) << 8) |
+                   static_cast<uint32_t>(event.pointer().btn);
+    }
+
+    recorder->m_out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    recorder->m_count++;
+}
+
+void InputRecorder::flush()
+{
+    m_out.flush();
+}
+
+InputRecorder::~InputRecorder() noexcept
+{
+    if (m_active == this)
+        m_active = m_previous;
+
+    flush();
+}
+
+InputReplay::InputReplay(Application& app, const std::string& path)
+    : m_timer(app.event().io())
+{
+    std::ifstream in(path, std::ios::binary);
+    uint32_t header[2] = {};
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != RECORD_MAGIC || header[1] != RECORD_VERSION)
+        throw std::runtime_error(fmt::format("invalid input recording: {}", path));
+
+    Record record{};
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+    {
+        if (recordable(static_cast<EventId>(record.id)))
+            m_records.push_back(record);
+    }
+
+    detail::info("replaying {} input events from {}", m_records.size(), path);
+}
+
+void InputReplay::speed(float value)
+{
+    if (value <= 0.f)
+        throw std::runtime_error("invalid input replay speed");
+
+    m_speed = value;
+}
+
+/// Processor time used by the process.
+static std::chrono::nanoseconds cpu_time()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::duration<double>(static_cast<double>(std::clock()) / CLOCKS_PER_SEC));
+}
+
+void InputReplay::start()
+{
+    stop();
+
+    auto& profiler = Profiler::instance();
+    m_profiler = !profiler.enabled();
+    if (m_profiler)
+        profiler.enable(true);
+
+    m_stats = {};
+    m_next = 0;
+    m_running = true;
+
+    // the clock starts once the event loop runs
+    m_start = {};
+    wait(std::chrono::steady_clock::now());
+}
+
+void InputReplay::stop()
+{
+    if (!m_running)
+        return;
+
+    m_running = false;
+    m_timer.cancel();
+
+    if (m_profiler)
+    {
+        Profiler::instance().enable(false);
+        m_profiler = false;
+    }
+}
+
+std::chrono::steady_clock::time_point InputReplay::due(const Record& record) const
+{
+    return m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double, std::micro>(record.time / m_speed));
+}
+
+void InputReplay::next()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    // events that came together are dispatched together, like a backend does
+    while (m_next < m_records.size() && due(m_records[m_next]) <= now)
+    {
+        const auto& record = m_records[m_next++];
+        const auto id = static_cast<EventId>(record.id);
+
+        Event event(id);
+        if (is_key(id))
+        {
+            Key::KeyState state;
+            for (auto mod : key_mods)
+                if (record.c & static_cast<uint32_t>(mod))
+                    state.set(mod);
+            event.key() = Key(static_cast<KeyboardCode>(record.a),
+                              static_cast<uint32_t>(record.b), state);
+        }
+        else
+        {
+            event.pointer() = Pointer(DisplayPoint(record.a, record.b),
+                                      static_cast<Pointer::Button>(record.c & 0xff),
+                                      record.c >> 8);
+        }
+
+        timestamp(due(record));
+        dispatch(event);
+        m_stats.events++;
+
+        if (!m_running)
+            return;
+    }
+
+    if (m_next < m_records.size())
+        wait(due(m_records[m_next]));
+    else // let the frame of the last event be drawn
+        wait(now + std::chrono::milliseconds(100));
+}
+
+void InputReplay::wait(std::chrono::steady_clock::time_point when)
+{
+    m_timer.expires_at(when);
+    m_timer.async_wait(Application::instance().event().queue().wrap(
+                           detail::priorities::input,
+                           std::bind(&InputReplay::handle_timer, this,
+                                     std::placeholders::_1), this));
+}
+
+void InputReplay::handle_timer(const asio::error_code& error)
+{
+    if (error || !m_running)
+        return;
+
+    if (m_start == std::chrono::steady_clock::time_point())
+    {
+        m_start = std::chrono::steady_clock::now();
+        m_cpu_start = cpu_time();
+    }
+
+    if (m_next < m_records.size())
+        next();
+    else
+        finish();
+}
+
+void InputReplay::finish()
+{
+    const auto end = std::chrono::steady_clock::now();
+    m_stats.duration = end - m_start;
+    m_stats.cpu = cpu_time() - m_cpu_start;
+
+    std::vector<std::chrono::nanoseconds> times;
+    for (const auto& frame : Profiler::instance().frames())
+    {
+        if (frame.start >= m_start)
+            times.push_back(frame.end - frame.start);
+    }
+
+    m_stats.frames = times.size();
+    if (!times.empty())
+    {
+        std::sort(times.begin(), times.end());
+        std::chrono::nanoseconds total{};
+        for (const auto& t : times)
+            total += t;
+        m_stats.mean_frame = total / static_cast<int64_t>(times.size());
+        m_stats.p95_frame = times[(times.size() - 1) * 95 / 100];
+        m_stats.max_frame = times.back();
+    }
+
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rusage usage{};
+    if (!getrusage(RUSAGE_SELF, &usage))
+        m_stats.max_rss = usage.ru_maxrss;
+#endif
+
+    stop();
+    on_finished.invoke();
+}
+
+InputReplay::~InputReplay() noexcept
+{
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+    stop();
+}
+
+}
+}
+}
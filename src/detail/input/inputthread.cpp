@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/input/inputthread.h"
+#include "detail/priorityqueue.h"
+#include "egt/app.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static void signal_fd(int fd)
+{
+    const uint64_t value = 1;
+    while (::write(fd, &value, sizeof(value)) < 0 && errno == EINTR)
+    {}
+}
+
+bool input_thread_enabled()
+{
+    // EGT_INPUT_THREAD=1
+    static const bool enabled = []()
+    {
+        auto value = std::getenv("EGT_INPUT_THREAD");
+        return value && strlen(value) && std::string(value) != "0";
+    }();
+    return enabled;
+}
+
+InputThread::InputThread(Application& app, int fd,
+                         ReadFunction read, DispatchFunction dispatch,
+                         size_t capacity)
+    : m_items(std::max<size_t>(capacity, 4) + 1),
+      m_fd(fd),
+      m_stop_fd(eventfd(0, EFD_CLOEXEC)),
+      m_read(std::move(read)),
+      m_dispatch(std::move(dispatch))
+{
+    const auto ready = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stop_fd < 0 || ready < 0)
+    {
+        if (ready >= 0)
+            ::close(ready);
+        if (m_stop_fd >= 0)
+            ::close(m_stop_fd);
+        throw std::runtime_error("unable to create input thread eventfd");
+    }
+
+    m_ready = std::make_unique<asio::posix::stream_descriptor>(app.event().io(), ready);
+    wait_ready();
+
+    m_thread = std::thread(&InputThread::run, this);
+}
+
+void InputThread::run()
+{
+    // EGT_INPUT_THREAD_CPU=1
+    auto cpu = std::getenv("EGT_INPUT_THREAD_CPU");
+    if (cpu && strlen(cpu))
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(std::atoi(cpu), &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            detail::warn("unable to run input thread on cpu {}", cpu);
+    }
+
+    struct pollfd fds[2] = {{m_fd, POLLIN, 0}, {m_stop_fd, POLLIN, 0}};
+    while (true)
+    {
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            detail::error("input thread poll failed: {}", strerror(errno));
+            return;
+        }
+
+        if (fds[1].revents)
+            return;
+
+        if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))
+        {
+            detail::error("input thread device error");
+            return;
+        }
+
+        if ((fds[0].revents & POLLIN) && !m_read())
+            return;
+    }
+}
+
+void InputThread::push(const Event& event, Clock::time_point when)
+{
+    const auto head = m_head.load(std::memory_order_relaxed);
+    const auto next = (head + 1) % m_items.size();
+    const auto tail = m_tail.load(std::memory_order_acquire);
+
+    // keep the last quarter of the ring for presses and keys, so a stalled
+    // event loop loses motion before anything else
+    const auto used = (head + m_items.size() - tail) % m_items.size();
+    if (next == tail ||
+        (event.id() == EventId::raw_pointer_move && used >= (m_items.size() - 1) * 3 / 4))
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_items[head] = {event, when};
+    m_head.store(next, std::memory_order_release);
+
+    // one wakeup for all the events queued until the event loop drains them
+    if (!m_signalled.exchange(true, std::memory_order_acq_rel))
+        signal_fd(m_ready->native_handle());
+}
+
+void InputThread::wait_ready()
+{
+    m_ready->async_read_some(asio::buffer(&m_ready_count, sizeof(m_ready_count)),
+                             Application::instance().event().queue().wrap(detail::priorities::input,
+                                     [this](const asio::error_code & error, std::size_t)
+    {
+        if (error)
+            return;
+
+        drain();
+        wait_ready();
+    }, this));
+}
+
+void InputThread::drain()
+{
+    // cleared first, so an event queued while draining signals again, and
+    // with an exchange, so the events queued before it are seen
+    m_signalled.exchange(false, std::memory_order_acq_rel);
+
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    while (tail != m_head.load(std::memory_order_acquire))
+    {
+        auto item = m_items[tail];
+        tail = (tail + 1) % m_items.size();
+        m_tail.store(tail, std::memory_order_release);
+
+        m_dispatch(item.event, item.when);
+    }
+
+    const auto dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reported)
+    {
+        detail::warn("input thread dropped {} events", dropped - m_reported);
+        m_reported = dropped;
+    }
+}
+
+InputThread::~InputThread() noexcept
+{
+    signal_fd(m_stop_fd);
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+
+    // closes the ready eventfd
+    m_ready.reset();
+    ::close(m_stop_fd);
+}
+
+}
+}
+}
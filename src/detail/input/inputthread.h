@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_INPUT_INPUTTHREAD_H
+#define EGT_SRC_DETAIL_INPUT_INPUTTHREAD_H
+
+#include "egt/detail/meta.h"
+#include "egt/event.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Application;
+
+namespace detail
+{
+
+/**
+ * Thread reading an input device, so reading and filtering its events does
+ * not wait for drawing, and drawing does not wait for them.
+ *
+ * The thread waits for the device to be readable and calls the read
+ * function, which turns what it read into events given to push().  Events
+ * go to the event loop through a fixed size single producer, single
+ * consumer ring, with the time they were read, so they never take a lock.
+ * The event loop is woken up with an eventfd once for all the events queued
+ * meanwhile, and hands them to the dispatch function in order.
+ *
+ * This is enabled for the evdev and tslib backends with the
+ * EGT_INPUT_THREAD environment variable.
+ */
+class InputThread : private NonCopyable<InputThread>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Reads the device, on the thread. Returns false on a fatal error.
+    using ReadFunction = std::function<bool()>;
+
+    /// Dispatches an event, in the event loop.
+    using DispatchFunction = std::function<void(Event& event, Clock::time_point when)>;
+
+    /**
+     * @param[in] app Application instance, whose event loop dispatches the
+     *            events.
+     * @param[in] fd Device to wait for.
+     * @param[in] read Reads the device.
+     * @param[in] dispatch Dispatches an event.
+     * @param[in] capacity Number of events the ring holds.
+     * @throws std::runtime_error if unable to start the thread.
+     */
+    InputThread(Application& app, int fd,
+                ReadFunction read, DispatchFunction dispatch,
+                size_t capacity = 256);
+
+    /**
+     * Queue an event for the event loop, from the read function.
+     *
+     * When the ring is full, because the event loop is stalled, the event is
+     * dropped.
+     */
+    void push(const Event& event, Clock::time_point when);
+
+    /// Number of events dropped because the ring was full.
+    EGT_NODISCARD uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    ~InputThread() noexcept;
+
+private:
+
+    struct Item
+    {
+        Event event;
+        Clock::time_point when;
+    };
+
+    /// Body of the thread.
+    void run();
+
+    /// Wait for the thread to signal queued events.
+    void wait_ready();
+
+    /// Dispatch the queued events, in the event loop.
+    void drain();
+
+    /// Ring of events, one slot is always left empty.
+    std::vector<Item> m_items;
+    /// Next slot written by the thread.
+    std::atomic<size_t> m_head{0};
+    /// Next slot read by the event loop.
+    std::atomic<size_t> m_tail{0};
+    /// Set once the thread signalled, until the event loop drains the ring.
+    std::atomic<bool> m_signalled{false};
+    /// Number of events dropped.
+    std::atomic<uint64_t> m_dropped{0};
+    /// Number of events dropped already reported in the log.
+    uint64_t m_reported{0};
+    /// Device to wait for.
+    int m_fd{-1};
+    /// Wakes up the thread to stop it.
+    int m_stop_fd{-1};
+    /// Signals the event loop that events are queued.
+    std::unique_ptr<asio::posix::stream_descriptor> m_ready;
+    uint64_t m_ready_count{0};
+    ReadFunction m_read;
+    DispatchFunction m_dispatch;
+    std::thread m_thread;
+};
+
+/**
+ * Returns true if input devices are read in their own thread.
+ *
+ * Set with the EGT_INPUT_THREAD environment variable.
+ */
+bool input_thread_enabled();
+
+}
+}
+}
+
+#endif
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/egtlog.h"
+#include "detail/input/inputthread.h"
+#include "detail/priorityqueue.h"
 #include "egt/app.h"
 #include "egt/detail/input/inputtslib.h"
 #include <chrono>
@@ -44,10 +46,30 @@ InputTslib::InputTslib(Application& app, const std::string& path)
             m_impl->samp_mt[i] = new ts_sample_mt[CHANNELS]();
         }
 
+        if (input_thread_enabled())
+        {
+            // the tslib filters, like median and dejitter, then run in the
+            // thread too
+            m_thread = std::make_unique<InputThread>(app, ts_fd(m_impl->ts),
+                       [this]()
+            {
+                read_device();
+                return true;
+            },
+            [this](Event & event, std::chrono::steady_clock::time_point when)
+            {
+                timestamp(when);
+                dispatch(event);
+                timestamp({});
+            });
+            return;
+        }
+
         m_input.assign(ts_fd(m_impl->ts));
 
         asio::async_read(m_input, asio::null_buffers(),
-                         std::bind(&InputTslib::handle_read, this, std::placeholders::_1));
+                         app.event().queue().wrap(detail::priorities::input,
+                                 std::bind(&InputTslib::handle_read, this, std::placeholders::_1), this));
     }
     else
     {
@@ -65,13 +87,9 @@ void InputTslib::handle_read(const asio::error_code& error)
 {
     auto async_read = detail::on_scope_exit([this]()
     {
-#ifdef USE_PRIORITY_QUEUE
-        asio::async_read(m_input, asio::null_buffers(),
-                         m_app.event().queue().wrap(detail::priorities::moderate, std::bind(&InputTslib::handle_read, this, std::placeholders::_1)));
-#else
         asio::async_read(m_input, asio::null_buffers(),
-                         std::bind(&InputTslib::handle_read, this, std::placeholders::_1));
-#endif
+                         Application::instance().event().queue().wrap(detail::priorities::input,
+                                 std::bind(&InputTslib::handle_read, this, std::placeholders::_1), this));
     });
 
     if (error)
@@ -80,6 +98,19 @@ void InputTslib::handle_read(const asio::error_code& error)
         return;
     }
 
+    read_device();
+}
+
+void InputTslib::report(Event& event)
+{
+    if (m_thread)
+        m_thread->push(event, std::chrono::steady_clock::now());
+    else
+        dispatch(event);
+}
+
+void InputTslib::read_device()
+{
     struct ts_sample_mt** samp_mt = m_impl->samp_mt;
 
     do
@@ -136,7 +167,7 @@ void InputTslib::handle_read(const asio::error_code& error)
                         m_last_point[slot] = DisplayPoint(x, y);
                         Event event(EventId::raw_pointer_up, Pointer(m_last_point[slot],
                                     Pointer::Button::left));
-                        dispatch(event);
+                        report(event);
                     }
                     else
                     {
@@ -166,7 +197,7 @@ void InputTslib::handle_read(const asio::error_code& error)
                         {
                             Event event(EventId::pointer_dblclick,
                                         Pointer(m_last_point[slot], Pointer::Button::left));
-                            dispatch(event);
+                            report(event);
                         }
                         else
                         {
@@ -176,7 +207,7 @@ void InputTslib::handle_read(const asio::error_code& error)
 
                             Event event(EventId::raw_pointer_down,
                                         Pointer(m_last_point[slot], Pointer::Button::left));
-                            dispatch(event);
+                            report(event);
                         }
 
                         m_impl->last_down[slot] = tv;
@@ -193,7 +224,7 @@ void InputTslib::handle_read(const asio::error_code& error)
 
                 Event event(EventId::raw_pointer_move,
                             Pointer(m_last_point[slot], Pointer::Button::left));
-                dispatch(event);
+                report(event);
             }
         }
     } while (true);
@@ -201,6 +232,12 @@ void InputTslib::handle_read(const asio::error_code& error)
 
 InputTslib::~InputTslib() noexcept
 {
+    // stop reading before closing the device
+    m_thread.reset();
+
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+
     ts_close(m_impl->ts);
 
     // NOLINTNEXTLINE(modernize-loop-convert)
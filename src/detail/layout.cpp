@@ -18,20 +18,9 @@ inline namespace v1
 namespace detail
 {
 
-static void run_and_apply(lay_context& ctx, lay_id parent,
-                          std::vector<LayoutRect>& children)
+static void apply(lay_context& ctx, lay_id parent,
+                  std::vector<LayoutRect>& children)
 {
-    for (const auto& child : children)
-    {
-        lay_id c = lay_item(&ctx);
-        lay_set_size_xy(&ctx, c, child.rect.width(), child.rect.height());
-        lay_set_margins_ltrb(&ctx, c, child.lmargin, child.tmargin, child.rmargin, child.bmargin);
-        lay_set_behave(&ctx, c, child.behave);
-        lay_insert(&ctx, parent, c);
-    }
-
-    lay_run_context(&ctx);
-
     auto re = children.begin();
     auto child = lay_first_child(&ctx, parent);
     while (child != LAY_INVALID_ID)
@@ -47,6 +36,23 @@ static void run_and_apply(lay_context& ctx, lay_id parent,
     }
 }
 
+static void run_and_apply(lay_context& ctx, lay_id parent,
+                          std::vector<LayoutRect>& children)
+{
+    for (const auto& child : children)
+    {
+        lay_id c = lay_item(&ctx);
+        lay_set_size_xy(&ctx, c, child.rect.width(), child.rect.height());
+        lay_set_margins_ltrb(&ctx, c, child.lmargin, child.tmargin, child.rmargin, child.bmargin);
+        lay_set_behave(&ctx, c, child.behave);
+        lay_insert(&ctx, parent, c);
+    }
+
+    lay_run_context(&ctx);
+
+    apply(ctx, parent, children);
+}
+
 uint32_t justify_to_contains(Justification justify, Orientation orient)
 {
     uint32_t contains = 0;
@@ -154,6 +160,173 @@ void flex_layout(const Rect& parent,
     run_and_apply(ctx, inner_parent, children);
 }
 
+/// What a child was laid out with on the last run.
+struct FlexInput
+{
+    Size size;
+    uint32_t behave;
+    uint32_t lmargin;
+    uint32_t tmargin;
+    uint32_t rmargin;
+    uint32_t bmargin;
+    Rect rect;
+};
+
+struct FlexLayout::FlexLayoutImpl
+{
+    FlexLayoutImpl() noexcept
+    {
+        lay_init_context(&ctx);
+    }
+
+    FlexLayoutImpl(const FlexLayoutImpl&) = delete;
+    FlexLayoutImpl& operator=(const FlexLayoutImpl&) = delete;
+
+    ~FlexLayoutImpl() noexcept
+    {
+        lay_destroy_context(&ctx);
+    }
+
+    lay_context ctx{};
+    lay_id parent{LAY_INVALID_ID};
+    Size parent_size;
+    uint32_t contains{0};
+    std::vector<FlexInput> inputs;
+    size_t rebuilds{0};
+    size_t skips{0};
+};
+
+FlexLayout::FlexLayout()
+    : m_impl(std::make_unique<FlexLayoutImpl>())
+{}
+
+FlexLayout::FlexLayout(FlexLayout&&) noexcept = default;
+FlexLayout& FlexLayout::operator=(FlexLayout&&) noexcept = default;
+FlexLayout::~FlexLayout() noexcept = default;
+
+void FlexLayout::run(const Rect& parent,
+                     std::vector<LayoutRect>& children,
+                     Justification justify,
+                     Orientation orient)
+{
+    auto& impl = *m_impl;
+    auto& ctx = impl.ctx;
+    const auto contains = justify_to_contains(justify, orient);
+    // wrapping inserts breaks in the behavior of children, which have to be
+    // cleared before running again
+    const auto wrap = (contains & LAY_WRAP) != 0;
+
+    auto rebuilt = false;
+    auto changed = false;
+
+    if (impl.parent == LAY_INVALID_ID || impl.inputs.size() != children.size())
+    {
+        lay_reset_context(&ctx);
+        lay_reserve_items_capacity(&ctx, children.size() + 1);
+
+        impl.parent = lay_item(&ctx);
+        impl.inputs.clear();
+        impl.inputs.reserve(children.size());
+        for (const auto& child : children)
+        {
+            lay_id c = lay_item(&ctx);
+            lay_set_size_xy(&ctx, c, child.rect.width(), child.rect.height());
+            lay_set_margins_ltrb(&ctx, c, child.lmargin, child.tmargin, child.rmargin, child.bmargin);
+            lay_set_behave(&ctx, c, child.behave);
+            lay_insert(&ctx, impl.parent, c);
+
+            impl.inputs.push_back({child.rect.size(), child.behave,
+                                   child.lmargin, child.tmargin,
+                                   child.rmargin, child.bmargin, {}});
+        }
+
+        impl.rebuilds++;
+        rebuilt = true;
+        changed = true;
+    }
+    else
+    {
+        // items are in the order they were inserted
+        auto input = impl.inputs.begin();
+        auto c = lay_first_child(&ctx, impl.parent);
+        for (const auto& child : children)
+        {
+            if (input->size != child.rect.size())
+            {
+                lay_set_size_xy(&ctx, c, child.rect.width(), child.rect.height());
+                input->size = child.rect.size();
+                changed = true;
+            }
+
+            if (input->lmargin != child.lmargin || input->tmargin != child.tmargin ||
+                input->rmargin != child.rmargin || input->bmargin != child.bmargin)
+            {
+                lay_set_margins_ltrb(&ctx, c, child.lmargin, child.tmargin, child.rmargin, child.bmargin);
+                input->lmargin = child.lmargin;
+                input->tmargin = child.tmargin;
+                input->rmargin = child.rmargin;
+                input->bmargin = child.bmargin;
+                changed = true;
+            }
+
+            if (input->behave != child.behave)
+            {
+                if (!wrap)
+                    lay_set_behave(&ctx, c, child.behave);
+                input->behave = child.behave;
+                changed = true;
+            }
+
+            c = lay_get_item(&ctx, c)->next_sibling;
+            ++input;
+        }
+    }
+
+    if (rebuilt || impl.parent_size != parent.size() || impl.contains != contains)
+    {
+        lay_set_size_xy(&ctx, impl.parent, parent.width(), parent.height());
+        lay_set_contain(&ctx, impl.parent, contains);
+        impl.parent_size = parent.size();
+        impl.contains = contains;
+        changed = true;
+    }
+
+    if (!changed)
+    {
+        for (size_t i = 0; i < children.size(); ++i)
+            children[i].rect = impl.inputs[i].rect;
+        impl.skips++;
+        return;
+    }
+
+    if (wrap && !rebuilt)
+    {
+        auto input = impl.inputs.begin();
+        for (auto c = lay_first_child(&ctx, impl.parent); c != LAY_INVALID_ID;
+             c = lay_get_item(&ctx, c)->next_sibling)
+        {
+            lay_set_behave(&ctx, c, input->behave);
+            ++input;
+        }
+    }
+
+    lay_run_context(&ctx);
+    apply(ctx, impl.parent, children);
+
+    for (size_t i = 0; i < children.size(); ++i)
+        impl.inputs[i].rect = children[i].rect;
+}
+
+size_t FlexLayout::rebuilds() const
+{
+    return m_impl->rebuilds;
+}
+
+size_t FlexLayout::skips() const
+{
+    return m_impl->skips;
+}
+
 }
 }
 }
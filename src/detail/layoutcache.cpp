@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/layoutcache.h"
+#include "egt/widget.h"
+#include <algorithm>
+#include <list>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+
+/// Box of a widget, in the order the tree is walked.
+struct Entry
+{
+    const Widget* widget;
+    Rect box;
+};
+
+/// Layout of a tree at a screen size.
+struct Layout
+{
+    Size screen;
+    const Widget* root{nullptr};
+    uint64_t epoch{0};
+    std::vector<Entry> entries;
+};
+
+/// Saved layouts, the most recently saved first.
+std::list<Layout>& layouts()
+{
+    static std::list<Layout> value;
+    return value;
+}
+
+}
+
+/// Walks the tree, with access to the boxes of the widgets.
+class LayoutCache::Tree
+{
+public:
+
+    static void save(const Widget& widget, std::vector<Entry>& entries)
+    {
+        entries.push_back({&widget, widget.m_box});
+        for (const auto& subordinate : widget.m_subordinates)
+            save(*subordinate, entries);
+    }
+
+    /// Is the tree still made of the same widgets, in the same order.
+    static bool matches(const Widget& widget, const std::vector<Entry>& entries, size_t& index)
+    {
+        if (index >= entries.size() || entries[index].widget != &widget)
+            return false;
+
+        ++index;
+        for (const auto& subordinate : widget.m_subordinates)
+            if (!matches(*subordinate, entries, index))
+                return false;
+
+        return true;
+    }
+
+    static void restore(Widget& widget, const std::vector<Entry>& entries, size_t& index)
+    {
+        widget.resize_font();
+
+        const auto& box = entries[index++].box;
+        if (widget.m_box != box)
+        {
+            widget.damage();
+            widget.m_box = box;
+            widget.damage();
+
+            if (widget.m_parent)
+                widget.m_parent->subordinates_changed();
+        }
+
+        for (auto& subordinate : widget.m_subordinates)
+            restore(*subordinate, entries, index);
+    }
+};
+
+void LayoutCache::save(const Size& screen, Widget& root)
+{
+    // the layout saved is the one the tree is drawn with
+    root.flush_layout();
+
+    auto& l = layouts();
+    l.remove_if([&screen](const Layout & layout) { return layout.screen == screen; });
+
+    Layout layout;
+    layout.screen = screen;
+    layout.root = &root;
+    layout.epoch = epoch();
+    Tree::save(root, layout.entries);
+    l.push_front(std::move(layout));
+
+    if (l.size() > MAX_SIZES)
+        l.pop_back();
+}
+
+bool LayoutCache::restore(const Size& screen, Widget& root)
+{
+    auto& l = layouts();
+    auto i = std::find_if(l.begin(), l.end(),
+                          [&screen](const Layout & layout) { return layout.screen == screen; });
+    if (i == l.end())
+        return false;
+
+    // the widgets of the layout are only compared with the ones of the tree
+    // until it is known to be the same tree
+    size_t index = 0;
+    if (i->root != &root || i->epoch != epoch() ||
+        !Tree::matches(root, i->entries, index) || index != i->entries.size())
+    {
+        l.erase(i);
+        return false;
+    }
+
+    index = 0;
+    Tree::restore(root, i->entries, index);
+    root.damage();
+    return true;
+}
+
+void LayoutCache::clear()
+{
+    layouts().clear();
+}
+
+}
+}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_LAYOUTCACHE_H
+#define EGT_SRC_DETAIL_LAYOUTCACHE_H
+
+#include "egt/geometry.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace egt
+{
+inline namespace v1
+{
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Layout of a widget tree, kept for each screen size it was shown at.
+ *
+ * When the screen leaves a size, the boxes of all the widgets of the tree are
+ * saved for it.  When the screen comes back to that size, and nothing asked
+ * for a layout since the boxes were saved, they are restored as they were
+ * instead of laying out the whole tree again.  Switching between portrait and
+ * landscape, or between the preset sizes of a preview, then only resizes the
+ * fonts following the screen, which get their scaled fonts back from the font
+ * cache.
+ *
+ * Any change that may move a widget, like adding, removing, hiding or showing
+ * a widget, or changing a size hint, ends the epoch the layouts were saved in,
+ * except while the screen changes size.
+ */
+class LayoutCache
+{
+public:
+
+    /// Number of screen sizes a layout is kept for.
+    static constexpr size_t MAX_SIZES = 4;
+
+    /// Ends the epoch of the saved layouts, while no Guard exists.
+    static void changed() noexcept
+    {
+        if (!guarded())
+            ++epoch();
+    }
+
+    /// Changes made while it exists are caused by the screen size.
+    class Guard
+    {
+    public:
+        Guard() noexcept { ++guarded(); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() noexcept { --guarded(); }
+    };
+
+    /**
+     * Save the layout of a tree for the screen size it is shown at.
+     *
+     * Pending layouts of the tree are flushed first.
+     */
+    static void save(const Size& screen, Widget& root);
+
+    /**
+     * Restore the layout saved for a screen size.
+     *
+     * The local fonts following the screen size are resized as well.
+     *
+     * @return false if no layout of the tree is saved for the size, or if it
+     *         is not valid anymore.
+     */
+    static bool restore(const Size& screen, Widget& root);
+
+    /// Drop all the saved layouts.
+    static void clear();
+
+private:
+
+    static uint64_t& epoch() noexcept
+    {
+        static uint64_t value = 0;
+        return value;
+    }
+
+    static uint32_t& guarded() noexcept
+    {
+        static uint32_t value = 0;
+        return value;
+    }
+
+    class Tree;
+};
+
+}
+}
+}
+
+#endif
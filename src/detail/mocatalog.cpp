@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/mocatalog.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static constexpr uint32_t MO_MAGIC = 0x950412de;
+static constexpr uint32_t MO_MAGIC_SWAPPED = 0xde120495;
+
+MoCatalog::MoCatalog(const std::string& path)
+{
+#ifdef HAVE_SYS_MMAN_H
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            auto map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                m_data = static_cast<const char*>(map);
+                m_size = st.st_size;
+                m_mapped = true;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (!m_data)
+    {
+        std::ifstream in(path, std::ios_base::binary);
+        if (!in)
+            throw std::runtime_error("unable to open message catalog: " + path);
+
+        m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    try
+    {
+        parse(path);
+    }
+    catch (...)
+    {
+#ifdef HAVE_SYS_MMAN_H
+        if (m_mapped)
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+        throw;
+    }
+}
+
+void MoCatalog::parse(const std::string& path)
+{
+    auto word = [this](size_t offset)
+    {
+        uint32_t value;
+        memcpy(&value, m_data + offset, sizeof(value));
+        return value;
+    };
+
+    // header: magic, revision, count, originals offset, translations offset
+    if (m_size < 5 * sizeof(uint32_t))
+        throw std::runtime_error("invalid message catalog: " + path);
+
+    const auto magic = word(0);
+    if (magic != MO_MAGIC && magic != MO_MAGIC_SWAPPED)
+        throw std::runtime_error("invalid message catalog: " + path);
+
+    const auto swapped = magic == MO_MAGIC_SWAPPED;
+    auto read = [&word, swapped](size_t offset)
+    {
+        const auto value = word(offset);
+        return swapped ? __builtin_bswap32(value) : value;
+    };
+
+    const size_t count = read(8);
+    const size_t originals = read(12);
+    const size_t translations = read(16);
+    if (originals > m_size || translations > m_size ||
+        count > (m_size - originals) / 8 || count > (m_size - translations) / 8)
+        throw std::runtime_error("invalid message catalog: " + path);
+
+    // plural messages hold their forms separated by a nul, the first one
+    // is the singular
+    auto string = [this, &read](size_t entry, std::string_view & str)
+    {
+        const size_t length = read(entry);
+        const size_t offset = read(entry + 4);
+        if (offset > m_size || length >= m_size - offset)
+            return false;
+        str = std::string_view(m_data + offset, strnlen(m_data + offset, length));
+        return true;
+    };
+
+    m_strings.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string_view msgid;
+        std::string_view translation;
+        if (!string(originals + i * 8, msgid) ||
+            !string(translations + i * 8, translation))
+            throw std::runtime_error("invalid message catalog: " + path);
+
+        // the empty message holds the header of the catalog
+        if (!msgid.empty())
+            m_strings.emplace(msgid, translation);
+    }
+}
+
+bool MoCatalog::find(std::string_view msgid, std::string_view& translation) const
+{
+    auto i = m_strings.find(msgid);
+    if (i == m_strings.end())
+        return false;
+
+    translation = i->second;
+    return true;
+}
+
+MoCatalog::~MoCatalog() noexcept
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (m_mapped)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+}
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_MOCATALOG_H
+#define EGT_SRC_DETAIL_MOCATALOG_H
+
+#include "egt/detail/meta.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * A gettext binary message catalog, a .mo file as written by msgfmt.
+ *
+ * The file is mapped, and its strings are looked up in a hash table
+ * pointing into the mapping, so loading a catalog copies no string, and
+ * does not depend on the hash table msgfmt may or may not write.
+ *
+ * Only the singular form of plural messages is looked up.
+ */
+class MoCatalog : private NonCopyable<MoCatalog>
+{
+public:
+
+    /**
+     * @param[in] path Path of the .mo file.
+     * @throws std::runtime_error if the file cannot be read, or is not a
+     *         message catalog.
+     */
+    explicit MoCatalog(const std::string& path);
+
+    /**
+     * Find the translation of a message.
+     *
+     * @param[in] msgid The untranslated message.
+     * @param[out] translation The translation, which points into the
+     *             catalog.
+     * @return false if the message is not in the catalog.
+     */
+    bool find(std::string_view msgid, std::string_view& translation) const;
+
+    /// Number of messages in the catalog.
+    EGT_NODISCARD size_t size() const { return m_strings.size(); }
+
+    ~MoCatalog() noexcept;
+
+private:
+
+    /// Index the strings of the file.
+    void parse(const std::string& path);
+
+    const char* m_data{nullptr};
+    size_t m_size{0};
+    bool m_mapped{false};
+    /// The file, when it cannot be mapped.
+    std::vector<char> m_buffer;
+    std::unordered_map<std::string_view, std::string_view> m_strings;
+};
+
+}
+}
+}
+
+#endif
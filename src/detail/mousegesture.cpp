@@ -3,7 +3,11 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/priorityqueue.h"
+#include "detail/timerwheel.h"
+#include "egt/app.h"
 #include "egt/detail/mousegesture.h"
+#include "egt/eventloop.h"
 #include "egt/input.h"
 
 namespace egt
@@ -14,17 +18,40 @@ namespace detail
 {
 
 DefaultDim MouseGesture::m_drag_enable_distance = 10;
+constexpr std::chrono::milliseconds MouseGesture::LONG_CLICK;
+constexpr std::chrono::milliseconds MouseGesture::VELOCITY_WINDOW;
 
-MouseGesture::MouseGesture() noexcept
+MouseGesture::MouseGesture()
+    : m_hold_timer(std::make_unique<TimerNode>())
 {
-    // setup long click timer handler
-    m_long_click_timer.on_timeout([this]()
+    // the wheel only queues the hold, so it is dispatched with the input
+    m_hold_timer->callback = [this]()
     {
-        if (!m_holding)
-            m_holding = true;
-        Event event(EventId::pointer_hold, Pointer(mouse_start()));
-        invoke_handlers(event);
-    });
+        Application::instance().event().queue().add(detail::priorities::input,
+                [this]() { hold(); }, this);
+    };
+}
+
+void MouseGesture::hold()
+{
+    if (!m_active || m_dragging)
+        return;
+
+    m_holding = true;
+
+    // the following holds are spaced from the first, not from when it was
+    // dispatched, so a busy event loop does not make them drift, and the
+    // ones missed meanwhile are skipped rather than sent at once
+    const auto now = Clock::now();
+    do
+    {
+        m_hold_deadline += LONG_CLICK;
+    }
+    while (m_hold_deadline <= now);
+    Application::instance().event().timer_wheel().schedule(*m_hold_timer, m_hold_deadline);
+
+    Event event(EventId::pointer_hold, Pointer(mouse_start()));
+    invoke_handlers(event);
 }
 
 void MouseGesture::on_async_event(MouseCallback callback)
@@ -32,13 +59,13 @@ void MouseGesture::on_async_event(MouseCallback callback)
     m_callbacks.emplace_back(std::move(callback));
 }
 
-Event MouseGesture::handle(const Event& event)
+Event MouseGesture::handle(const Event& event, Clock::time_point when)
 {
     switch (event.id())
     {
     case EventId::raw_pointer_down:
     {
-        start(event.pointer().point);
+        start(event.pointer().point, when);
         break;
     }
     case EventId::raw_pointer_up:
@@ -54,6 +81,7 @@ Event MouseGesture::handle(const Event& event)
             {
                 Event eevent(EventId::pointer_drag_stop, event.pointer());
                 eevent.pointer().drag_start = mouse_start();
+                eevent.pointer().velocity = velocity(when);
                 return eevent;
             }
             else if (!holding)
@@ -65,6 +93,8 @@ Event MouseGesture::handle(const Event& event)
     {
         if (m_active)
         {
+            add_sample(event.pointer().point, when);
+
             bool dragging_started = false;
             if (!m_dragging)
             {
@@ -73,6 +103,8 @@ Event MouseGesture::handle(const Event& event)
                 {
                     m_dragging = true;
                     dragging_started = true;
+                    // a pointer that moved away is not held
+                    cancel_hold();
                 }
             }
 
@@ -100,12 +132,21 @@ Event MouseGesture::handle(const Event& event)
     return {};
 }
 
-void MouseGesture::start(const DisplayPoint& point)
+void MouseGesture::start(const DisplayPoint& point, Clock::time_point when)
 {
-    m_long_click_timer.start(std::chrono::milliseconds(500));
     m_mouse_start_pos = point;
     m_active = true;
     m_dragging = false;
+    m_holding = false;
+    m_sample_count = 0;
+    add_sample(point, when);
+
+    cancel_hold();
+    if (Application::check_instance())
+    {
+        m_hold_deadline = when + LONG_CLICK;
+        Application::instance().event().timer_wheel().schedule(*m_hold_timer, m_hold_deadline);
+    }
 }
 
 void MouseGesture::stop()
@@ -113,7 +154,58 @@ void MouseGesture::stop()
     m_active = false;
     m_dragging = false;
     m_holding = false;
-    m_long_click_timer.cancel();
+    cancel_hold();
+}
+
+void MouseGesture::cancel_hold()
+{
+    if (!Application::check_instance())
+        return;
+
+    Application::instance().event().timer_wheel().cancel(*m_hold_timer);
+    Application::instance().event().queue().cancel(this);
+}
+
+void MouseGesture::add_sample(const DisplayPoint& point, Clock::time_point when)
+{
+    m_samples[m_sample_next] = {point, when};
+    m_sample_next = (m_sample_next + 1) % m_samples.size();
+    m_sample_count = std::min(m_sample_count + 1, m_samples.size());
+}
+
+PointF MouseGesture::velocity(Clock::time_point now) const
+{
+    const auto at = [this](size_t age) -> const Sample&
+    {
+        return m_samples[(m_sample_next + m_samples.size() - 1 - age) % m_samples.size()];
+    };
+
+    if (m_sample_count < 2 || now - at(0).when > VELOCITY_WINDOW)
+        return {};
+
+    // the oldest sample in the window gives the least noisy velocity
+    const auto& last = at(0);
+    const auto* first = &last;
+    for (size_t age = 1; age < m_sample_count; ++age)
+    {
+        const auto& sample = at(age);
+        if (now - sample.when > VELOCITY_WINDOW)
+            break;
+        first = &sample;
+    }
+
+    const auto span = std::chrono::duration<float>(last.when - first->when).count();
+    if (span <= 0.f)
+        return {};
+
+    return {static_cast<float>(last.point.x() - first->point.x()) / span,
+            static_cast<float>(last.point.y() - first->point.y()) / span};
+}
+
+MouseGesture::~MouseGesture() noexcept
+{
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
 }
 
 void MouseGesture::invoke_handlers(Event& event)
@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/pixelopsimpl.h"
+#include "egt/detail/pixelops.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#ifdef __arm__
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+
+extern "C" {
+    extern void* arm_memset16(uint16_t*, uint16_t, size_t);
+    extern void* arm_memset32(uint32_t*, uint32_t, size_t);
+}
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+template<class T>
+static inline const T* row(const T* base, size_t stride, size_t y)
+{
+    return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(base) + stride * y);
+}
+
+template<class T>
+static inline T* row(T* base, size_t stride, size_t y)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(base) + stride * y);
+}
+
+static void generic_copy_rect(const uint8_t* src, size_t src_stride,
+                              uint8_t* dst, size_t dst_stride,
+                              size_t bytes, size_t height)
+{
+    if (src_stride == dst_stride && src_stride == bytes)
+    {
+        std::memcpy(dst, src, bytes * height);
+        return;
+    }
+
+    for (size_t y = 0; y < height; ++y)
+        std::memcpy(row(dst, dst_stride, y), row(src, src_stride, y), bytes);
+}
+
+static void generic_argb8888_to_rgb565(const uint32_t* src, size_t src_stride,
+                                       uint16_t* dst, size_t dst_stride,
+                                       size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto s = row(src, src_stride, y);
+        auto d = row(dst, dst_stride, y);
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            const auto p = s[x];
+            d[x] = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+        }
+    }
+}
+
+/// x * a / 255, rounded, for 8 bit values.
+static inline uint32_t mul_un8(uint32_t x, uint32_t a)
+{
+    const auto t = x * a + 0x80;
+    return (t + (t >> 8)) >> 8;
+}
+
+static void generic_blend_over(const uint32_t* src, size_t src_stride,
+                               uint32_t* dst, size_t dst_stride,
+                               size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto s = row(src, src_stride, y);
+        auto d = row(dst, dst_stride, y);
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            const auto sp = s[x];
+            const auto ia = 255 - (sp >> 24);
+
+            if (ia == 0)
+            {
+                d[x] = sp;
+                continue;
+            }
+
+            const auto dp = d[x];
+            uint32_t result = 0;
+            for (auto shift = 0; shift < 32; shift += 8)
+            {
+                auto c = ((sp >> shift) & 0xff) + mul_un8((dp >> shift) & 0xff, ia);
+                if (c > 255)
+                    c = 255;
+                result |= c << shift;
+            }
+            d[x] = result;
+        }
+    }
+}
+
+static void generic_sample_table(const float* table, size_t size,
+                                 const float* positions, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = sample_table_at(table, size, positions[i]);
+}
+
+static void generic_argb8888_to_l8(const uint32_t* src, size_t src_stride,
+                                   uint8_t* dst, size_t dst_stride,
+                                   size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto s = row(src, src_stride, y);
+        auto d = row(dst, dst_stride, y);
+
+        for (size_t x = 0; x < width; ++x)
+            d[x] = pixel_to_l8(s[x]);
+    }
+}
+
+static void generic_argb8888_to_rgb332(const uint32_t* src, size_t src_stride,
+                                       uint8_t* dst, size_t dst_stride,
+                                       size_t width, size_t height,
+                                       size_t x0, size_t y0, bool dither)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto s = row(src, src_stride, y);
+        auto d = row(dst, dst_stride, y);
+        const auto bayer = bayer4[(y0 + y) & 3];
+
+        for (size_t x = 0; x < width; ++x)
+            d[x] = pixel_to_rgb332(s[x], dither ? bayer[(x0 + x) & 3] : 0);
+    }
+}
+
+static size_t generic_rects_intersect(const RectEdges& rects,
+                                      int32_t left, int32_t top,
+                                      int32_t right, int32_t bottom,
+                                      uint8_t* mask)
+{
+    size_t hits = 0;
+
+    // no branches, so compilers vectorize the loop with SSE or NEON
+    for (size_t i = 0; i < rects.count; ++i)
+    {
+        const uint8_t hit = (rects.left[i] < right) & (rects.right[i] > left) &
+                            (rects.top[i] < bottom) & (rects.bottom[i] > top);
+        mask[i] = hit;
+        hits += hit;
+    }
+
+    return hits;
+}
+
+static void generic_rects_bounds(const RectEdges& rects, int32_t* bounds)
+{
+    if (!rects.count)
+    {
+        std::fill(bounds, bounds + 4, 0);
+        return;
+    }
+
+    auto left = rects.left[0];
+    auto top = rects.top[0];
+    auto right = rects.right[0];
+    auto bottom = rects.bottom[0];
+    for (size_t i = 1; i < rects.count; ++i)
+    {
+        left = std::min(left, rects.left[i]);
+        top = std::min(top, rects.top[i]);
+        right = std::max(right, rects.right[i]);
+        bottom = std::max(bottom, rects.bottom[i]);
+    }
+
+    bounds[0] = left;
+    bounds[1] = top;
+    bounds[2] = right;
+    bounds[3] = bottom;
+}
+
+static size_t generic_rects_last_hit(const RectEdges& rects, int32_t x, int32_t y)
+{
+    for (auto i = rects.count; i--;)
+    {
+        if (rect_hit(rects, i, x, y))
+            return i;
+    }
+
+    return rects.count;
+}
+
+static void generic_lut_lookup(const uint32_t* table, size_t size,
+                               const float* positions, uint32_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = table[lut_index(size, positions[i])];
+}
+
+static void generic_mix_argb8888(const uint32_t* a, const uint32_t* b,
+                                 uint32_t* out, size_t count, uint32_t weight)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = mix_pixel(a[i], b[i], weight);
+}
+
+static size_t generic_ascii_length(const char* data, size_t size)
+{
+    size_t i = 0;
+
+    // a word at a time, any high bit ends the run
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080))
+            break;
+    }
+
+    for (; i < size; ++i)
+    {
+        if (static_cast<unsigned char>(data[i]) & 0x80)
+            break;
+    }
+
+    return i;
+}
+
+static const PixelOps generic_ops =
+{
+    generic_copy_rect,
+    generic_argb8888_to_rgb565,
+    generic_blend_over,
+    generic_sample_table,
+    generic_argb8888_to_l8,
+    generic_argb8888_to_rgb332,
+    generic_rects_intersect,
+    generic_rects_bounds,
+    generic_rects_last_hit,
+    generic_lut_lookup,
+    generic_mix_argb8888,
+    generic_ascii_length,
+};
+
+static const PixelOps* detect_neon()
+{
+#ifdef __arm__
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+        return neon_pixel_ops();
+#endif
+    return nullptr;
+}
+
+static const PixelOps*& pixel_ops()
+{
+    static const PixelOps* ops = []()
+    {
+        auto neon = detect_neon();
+        if (neon)
+            EGTLOG_DEBUG("using NEON pixel kernels");
+        return neon ? neon : &generic_ops;
+    }();
+    return ops;
+}
+
+void copy_rect(const uint8_t* src, size_t src_stride,
+               uint8_t* dst, size_t dst_stride,
+               size_t bytes, size_t height)
+{
+    pixel_ops()->copy_rect(src, src_stride, dst, dst_stride, bytes, height);
+}
+
+void fill_rect(uint8_t* dst, size_t dst_stride,
+               size_t width, size_t height,
+               size_t bpp, uint32_t value)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto d = row(dst, dst_stride, y);
+        if (bpp == 2)
+        {
+#ifdef __arm__
+            arm_memset16(reinterpret_cast<uint16_t*>(d), value, width);
+#else
+            std::fill_n(reinterpret_cast<uint16_t*>(d), width, value);
+#endif
+        }
+        else if (bpp == 4)
+        {
+#ifdef __arm__
+            arm_memset32(reinterpret_cast<uint32_t*>(d), value, width);
+#else
+            std::fill_n(reinterpret_cast<uint32_t*>(d), width, value);
+#endif
+        }
+    }
+}
+
+template<class T>
+static void rotate_pixels(const uint8_t* src, size_t src_stride,
+                          uint8_t* dst, size_t dst_stride,
+                          size_t width, size_t height, uint32_t degrees)
+{
+    // destination of the first pixel of source row y, and the step between
+    // two pixels of the row
+    ptrdiff_t start;
+    ptrdiff_t row_step;
+    ptrdiff_t step;
+    switch (degrees)
+    {
+    case 90:
+        start = (height - 1) * sizeof(T);
+        row_step = -static_cast<ptrdiff_t>(sizeof(T));
+        step = dst_stride;
+        break;
+    case 180:
+        start = (height - 1) * dst_stride + (width - 1) * sizeof(T);
+        row_step = -static_cast<ptrdiff_t>(dst_stride);
+        step = -static_cast<ptrdiff_t>(sizeof(T));
+        break;
+    default:
+        start = (width - 1) * dst_stride;
+        row_step = sizeof(T);
+        step = -static_cast<ptrdiff_t>(dst_stride);
+        break;
+    }
+
+    // walk the source in tiles, so the destination rows written by a tile
+    // stay in the cache when rotating by 90 or 270 degrees
+    static constexpr size_t tile = 32;
+    for (size_t ty = 0; ty < height; ty += tile)
+    {
+        const auto ey = std::min(ty + tile, height);
+        for (size_t tx = 0; tx < width; tx += tile)
+        {
+            const auto ex = std::min(tx + tile, width);
+            for (size_t y = ty; y < ey; ++y)
+            {
+                auto s = reinterpret_cast<const T*>(src + y * src_stride) + tx;
+                auto d = dst + start + static_cast<ptrdiff_t>(y) * row_step +
+                         static_cast<ptrdiff_t>(tx) * step;
+                for (size_t x = tx; x < ex; ++x, d += step)
+                    *reinterpret_cast<T*>(d) = *s++;
+            }
+        }
+    }
+}
+
+void rotate_rect(const uint8_t* src, size_t src_stride,
+                 uint8_t* dst, size_t dst_stride,
+                 size_t width, size_t height,
+                 size_t bpp, uint32_t degrees)
+{
+    if (!width || !height)
+        return;
+
+    if (degrees == 0)
+        copy_rect(src, src_stride, dst, dst_stride, width * bpp, height);
+    else if (bpp == 1)
+        rotate_pixels<uint8_t>(src, src_stride, dst, dst_stride, width, height, degrees);
+    else if (bpp == 2)
+        rotate_pixels<uint16_t>(src, src_stride, dst, dst_stride, width, height, degrees);
+    else if (bpp == 4)
+        rotate_pixels<uint32_t>(src, src_stride, dst, dst_stride, width, height, degrees);
+}
+
+/*
+ * Average count pixels, step pixels apart, over a window of radius pixels on
+ * each side, using line as scratch space.
+ */
+static void blur_line(uint32_t* pixels, size_t step, size_t count,
+                      size_t radius, uint32_t* line)
+{
+    const auto at = [pixels, step, count](ptrdiff_t i)
+    {
+        i = std::max<ptrdiff_t>(0, std::min<ptrdiff_t>(i, count - 1));
+        return pixels[i * step];
+    };
+
+    const auto r = static_cast<ptrdiff_t>(radius);
+    const uint32_t size = radius * 2 + 1;
+
+    uint32_t sum[4] = {};
+    const auto add = [&sum](uint32_t p)
+    {
+        for (auto c = 0; c < 4; ++c)
+            sum[c] += (p >> (c * 8)) & 0xff;
+    };
+    const auto sub = [&sum](uint32_t p)
+    {
+        for (auto c = 0; c < 4; ++c)
+            sum[c] -= (p >> (c * 8)) & 0xff;
+    };
+
+    for (auto i = -r; i <= r; ++i)
+        add(at(i));
+
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(count); ++i)
+    {
+        uint32_t result = 0;
+        for (auto c = 0; c < 4; ++c)
+            result |= ((sum[c] + size / 2) / size) << (c * 8);
+        line[i] = result;
+
+        sub(at(i - r));
+        add(at(i + r + 1));
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        pixels[i * step] = line[i];
+}
+
+void box_blur(uint32_t* data, size_t stride,
+              size_t width, size_t height, size_t radius)
+{
+    if (!radius || !width || !height)
+        return;
+
+    std::vector<uint32_t> line(std::max(width, height));
+
+    for (size_t y = 0; y < height; ++y)
+        blur_line(row(data, stride, y), 1, width, radius, line.data());
+
+    for (size_t x = 0; x < width; ++x)
+        blur_line(data + x, stride / 4, height, radius, line.data());
+}
+
+void argb8888_to_rgb565(const uint32_t* src, size_t src_stride,
+                        uint16_t* dst, size_t dst_stride,
+                        size_t width, size_t height)
+{
+    pixel_ops()->argb8888_to_rgb565(src, src_stride, dst, dst_stride, width, height);
+}
+
+void argb8888_to_l8(const uint32_t* src, size_t src_stride,
+                    uint8_t* dst, size_t dst_stride,
+                    size_t width, size_t height)
+{
+    pixel_ops()->argb8888_to_l8(src, src_stride, dst, dst_stride, width, height);
+}
+
+void argb8888_to_rgb332(const uint32_t* src, size_t src_stride,
+                        uint8_t* dst, size_t dst_stride,
+                        size_t width, size_t height,
+                        size_t x, size_t y, bool dither)
+{
+    pixel_ops()->argb8888_to_rgb332(src, src_stride, dst, dst_stride,
+                                    width, height, x, y, dither);
+}
+
+const uint32_t* rgb332_palette()
+{
+    static const auto palette = []()
+    {
+        std::array<uint32_t, 256> colors{};
+        for (uint32_t i = 0; i < colors.size(); ++i)
+        {
+            // spread the bits of each channel over 8 bits
+            const auto r = ((i >> 5) & 7) * 255 / 7;
+            const auto g = ((i >> 2) & 7) * 255 / 7;
+            const auto b = (i & 3) * 255 / 3;
+            colors[i] = 0xff000000 | (r << 16) | (g << 8) | b;
+        }
+        return colors;
+    }();
+    return palette.data();
+}
+
+void blend_over(const uint32_t* src, size_t src_stride,
+                uint32_t* dst, size_t dst_stride,
+                size_t width, size_t height)
+{
+    pixel_ops()->blend_over(src, src_stride, dst, dst_stride, width, height);
+}
+
+void sample_table(const float* table, size_t size,
+                  const float* positions, float* out, size_t count)
+{
+    pixel_ops()->sample_table(table, size, positions, out, count);
+}
+
+size_t rects_intersect(const RectEdges& rects,
+                       int32_t left, int32_t top,
+                       int32_t right, int32_t bottom,
+                       uint8_t* mask)
+{
+    return pixel_ops()->rects_intersect(rects, left, top, right, bottom, mask);
+}
+
+void rects_bounds(const RectEdges& rects, int32_t* bounds)
+{
+    pixel_ops()->rects_bounds(rects, bounds);
+}
+
+size_t rects_last_hit(const RectEdges& rects, int32_t x, int32_t y)
+{
+    return pixel_ops()->rects_last_hit(rects, x, y);
+}
+
+void lut_lookup(const uint32_t* table, size_t size,
+                const float* positions, uint32_t* out, size_t count)
+{
+    pixel_ops()->lut_lookup(table, size, positions, out, count);
+}
+
+void mix_argb8888(const uint32_t* a, const uint32_t* b,
+                  uint32_t* out, size_t count, uint32_t weight)
+{
+    pixel_ops()->mix_argb8888(a, b, out, count, std::min<uint32_t>(weight, 256));
+}
+
+size_t ascii_length(const char* data, size_t size)
+{
+    return pixel_ops()->ascii_length(data, size);
+}
+
+bool pixelops_neon()
+{
+    return pixel_ops() != &generic_ops;
+}
+
+bool pixelops_neon(bool enable)
+{
+    const PixelOps* neon = enable ? detect_neon() : nullptr;
+    pixel_ops() = neon ? neon : &generic_ops;
+    return pixelops_neon();
+}
+
+#ifndef __arm__
+const PixelOps* neon_pixel_ops()
+{
+    return nullptr;
+}
+#endif
+
+}
+}
+}
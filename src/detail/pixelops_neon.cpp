@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/pixelopsimpl.h"
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+static void neon_copy_rect(const uint8_t* src, size_t src_stride,
+                           uint8_t* dst, size_t dst_stride,
+                           size_t bytes, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto s = src + src_stride * y;
+        auto d = dst + dst_stride * y;
+        auto n = bytes;
+
+        while (n >= 64)
+        {
+            const auto a = vld1q_u8(s);
+            const auto b = vld1q_u8(s + 16);
+            const auto c = vld1q_u8(s + 32);
+            const auto e = vld1q_u8(s + 48);
+            vst1q_u8(d, a);
+            vst1q_u8(d + 16, b);
+            vst1q_u8(d + 32, c);
+            vst1q_u8(d + 48, e);
+            s += 64;
+            d += 64;
+            n -= 64;
+        }
+
+        while (n >= 16)
+        {
+            vst1q_u8(d, vld1q_u8(s));
+            s += 16;
+            d += 16;
+            n -= 16;
+        }
+
+        if (n)
+            std::memcpy(d, s, n);
+    }
+}
+
+static inline uint16_t pixel_to_rgb565(uint32_t p)
+{
+    return ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+}
+
+static void neon_argb8888_to_rgb565(const uint32_t* src, size_t src_stride,
+                                    uint16_t* dst, size_t dst_stride,
+                                    size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto s = reinterpret_cast<const uint8_t*>(src) + src_stride * y;
+        auto d = reinterpret_cast<uint16_t*>(reinterpret_cast<uint8_t*>(dst) + dst_stride * y);
+        size_t x = 0;
+
+        for (; x + 8 <= width; x += 8)
+        {
+            // little endian ARGB8888 is b, g, r, a in memory
+            const auto p = vld4_u8(s + x * 4);
+            auto r = vshll_n_u8(p.val[2], 8);
+            r = vsriq_n_u16(r, vshll_n_u8(p.val[1], 8), 5);
+            r = vsriq_n_u16(r, vshll_n_u8(p.val[0], 8), 11);
+            vst1q_u16(d + x, r);
+        }
+
+        auto s32 = reinterpret_cast<const uint32_t*>(s);
+        for (; x < width; ++x)
+            d[x] = pixel_to_rgb565(s32[x]);
+    }
+}
+
+/// x * a / 255, rounded, for 8 bit values.
+static inline uint32_t mul_un8(uint32_t x, uint32_t a)
+{
+    const auto t = x * a + 0x80;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline uint8x8_t neon_mul_un8(uint8x8_t x, uint8x8_t a)
+{
+    const auto t = vaddq_u16(vmull_u8(x, a), vdupq_n_u16(0x80));
+    return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+static void neon_blend_over(const uint32_t* src, size_t src_stride,
+                            uint32_t* dst, size_t dst_stride,
+                            size_t width, size_t height)
+{
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto s = reinterpret_cast<const uint8_t*>(src) + src_stride * y;
+        auto d = reinterpret_cast<uint8_t*>(dst) + dst_stride * y;
+        size_t x = 0;
+
+        for (; x + 8 <= width; x += 8)
+        {
+            const auto sp = vld4_u8(s + x * 4);
+            auto dp = vld4_u8(d + x * 4);
+            const auto ia = vmvn_u8(sp.val[3]);
+
+            for (auto c = 0; c < 4; ++c)
+                dp.val[c] = vqadd_u8(sp.val[c], neon_mul_un8(dp.val[c], ia));
+
+            vst4_u8(d + x * 4, dp);
+        }
+
+        auto s32 = reinterpret_cast<const uint32_t*>(s);
+        auto d32 = reinterpret_cast<uint32_t*>(d);
+        for (; x < width; ++x)
+        {
+            const auto sp = s32[x];
+            const auto ia = 255 - (sp >> 24);
+            const auto dp = d32[x];
+            uint32_t result = 0;
+            for (auto shift = 0; shift < 32; shift += 8)
+            {
+                auto c = ((sp >> shift) & 0xff) + mul_un8((dp >> shift) & 0xff, ia);
+                if (c > 255)
+                    c = 255;
+                result |= c << shift;
+            }
+            d32[x] = result;
+        }
+    }
+}
+
+static void neon_sample_table(const float* table, size_t size,
+                              const float* positions, float* out, size_t count)
+{
+    const auto zero = vdupq_n_f32(0.f);
+    const auto one = vdupq_n_f32(1.f);
+    const auto scale = vdupq_n_f32(static_cast<float>(size - 1));
+    const auto last = vdupq_n_u32(static_cast<uint32_t>(size - 2));
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // select instead of max, so NaN becomes 0 like the scalar version
+        auto p = vld1q_f32(positions + i);
+        p = vbslq_f32(vcgtq_f32(p, zero), p, zero);
+        p = vminq_f32(p, one);
+
+        const auto scaled = vmulq_f32(p, scale);
+        const auto index = vminq_u32(vcvtq_u32_f32(scaled), last);
+        const auto fraction = vsubq_f32(scaled, vcvtq_f32_u32(index));
+
+        // NEON has no gather, so load the neighbours one lane at a time
+        uint32_t lanes[4];
+        vst1q_u32(lanes, index);
+        float a[4];
+        float b[4];
+        for (auto lane = 0; lane < 4; ++lane)
+        {
+            a[lane] = table[lanes[lane]];
+            b[lane] = table[lanes[lane] + 1];
+        }
+
+        const auto va = vld1q_f32(a);
+        const auto vb = vld1q_f32(b);
+        vst1q_f32(out + i, vmlaq_f32(va, vsubq_f32(vb, va), fraction));
+    }
+
+    for (; i < count; ++i)
+        out[i] = sample_table_at(table, size, positions[i]);
+}
+
+static void neon_argb8888_to_l8(const uint32_t* src, size_t src_stride,
+                                uint8_t* dst, size_t dst_stride,
+                                size_t width, size_t height)
+{
+    const auto kr = vdup_n_u8(77);
+    const auto kg = vdup_n_u8(150);
+    const auto kb = vdup_n_u8(29);
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto s = reinterpret_cast<const uint8_t*>(src) + src_stride * y;
+        auto d = dst + dst_stride * y;
+        size_t x = 0;
+
+        for (; x + 8 <= width; x += 8)
+        {
+            const auto p = vld4_u8(s + x * 4);
+            auto l = vmull_u8(p.val[2], kr);
+            l = vmlal_u8(l, p.val[1], kg);
+            l = vmlal_u8(l, p.val[0], kb);
+            vst1_u8(d + x, vrshrn_n_u16(l, 8));
+        }
+
+        auto s32 = reinterpret_cast<const uint32_t*>(s);
+        for (; x < width; ++x)
+            d[x] = pixel_to_l8(s32[x]);
+    }
+}
+
+static void neon_argb8888_to_rgb332(const uint32_t* src, size_t src_stride,
+                                    uint8_t* dst, size_t dst_stride,
+                                    size_t width, size_t height,
+                                    size_t x0, size_t y0, bool dither)
+{
+    const auto mask = vdup_n_u8(0xe0);
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        auto s = reinterpret_cast<const uint8_t*>(src) + src_stride * y;
+        auto d = dst + dst_stride * y;
+        const auto bayer = bayer4[(y0 + y) & 3];
+        size_t x = 0;
+
+        // 8 pixels span the row of the pattern twice, so the bias of each
+        // lane is the same for the whole row
+        uint8_t bias[8] = {};
+        if (dither)
+        {
+            for (auto lane = 0; lane < 8; ++lane)
+                bias[lane] = bayer[(x0 + lane) & 3];
+        }
+        const auto bias2 = vshl_n_u8(vld1_u8(bias), 1);
+        const auto bias4 = vshl_n_u8(vld1_u8(bias), 2);
+
+        for (; x + 8 <= width; x += 8)
+        {
+            const auto p = vld4_u8(s + x * 4);
+            const auto r = vand_u8(vqadd_u8(p.val[2], bias2), mask);
+            const auto g = vshr_n_u8(vand_u8(vqadd_u8(p.val[1], bias2), mask), 3);
+            const auto b = vshr_n_u8(vqadd_u8(p.val[0], bias4), 6);
+            vst1_u8(d + x, vorr_u8(vorr_u8(r, g), b));
+        }
+
+        auto s32 = reinterpret_cast<const uint32_t*>(s);
+        for (; x < width; ++x)
+            d[x] = pixel_to_rgb332(s32[x], dither ? bayer[(x0 + x) & 3] : 0);
+    }
+}
+
+static size_t neon_rects_intersect(const RectEdges& rects,
+                                   int32_t left, int32_t top,
+                                   int32_t right, int32_t bottom,
+                                   uint8_t* mask)
+{
+    const auto l = vdupq_n_s32(left);
+    const auto t = vdupq_n_s32(top);
+    const auto r = vdupq_n_s32(right);
+    const auto b = vdupq_n_s32(bottom);
+
+    // lanes are all ones or zero, so the shift gives 1 or 0
+    auto test = [&](size_t i)
+    {
+        auto hit = vcltq_s32(vld1q_s32(rects.left + i), r);
+        hit = vandq_u32(hit, vcgtq_s32(vld1q_s32(rects.right + i), l));
+        hit = vandq_u32(hit, vcltq_s32(vld1q_s32(rects.top + i), b));
+        hit = vandq_u32(hit, vcgtq_s32(vld1q_s32(rects.bottom + i), t));
+        return vshrq_n_u32(hit, 31);
+    };
+
+    auto sum = vdupq_n_u32(0);
+    size_t i = 0;
+
+    for (; i + 8 <= rects.count; i += 8)
+    {
+        const auto a = test(i);
+        const auto c = test(i + 4);
+        sum = vaddq_u32(sum, vaddq_u32(a, c));
+        vst1_u8(mask + i, vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(c))));
+    }
+
+    uint32_t lanes[4];
+    vst1q_u32(lanes, sum);
+    size_t hits = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    for (; i < rects.count; ++i)
+    {
+        const uint8_t hit = (rects.left[i] < right) & (rects.right[i] > left) &
+                            (rects.top[i] < bottom) & (rects.bottom[i] > top);
+        mask[i] = hit;
+        hits += hit;
+    }
+
+    return hits;
+}
+
+static void neon_rects_bounds(const RectEdges& rects, int32_t* bounds)
+{
+    if (rects.count < 4)
+    {
+        std::fill(bounds, bounds + 4, 0);
+        for (size_t i = 0; i < rects.count; ++i)
+        {
+            bounds[0] = i ? std::min(bounds[0], rects.left[i]) : rects.left[i];
+            bounds[1] = i ? std::min(bounds[1], rects.top[i]) : rects.top[i];
+            bounds[2] = i ? std::max(bounds[2], rects.right[i]) : rects.right[i];
+            bounds[3] = i ? std::max(bounds[3], rects.bottom[i]) : rects.bottom[i];
+        }
+        return;
+    }
+
+    auto l = vld1q_s32(rects.left);
+    auto t = vld1q_s32(rects.top);
+    auto r = vld1q_s32(rects.right);
+    auto b = vld1q_s32(rects.bottom);
+
+    // the last vector overlaps the previous one rather than a scalar tail
+    for (size_t i = 4; i < rects.count; i += 4)
+    {
+        const auto j = std::min(i, rects.count - 4);
+        l = vminq_s32(l, vld1q_s32(rects.left + j));
+        t = vminq_s32(t, vld1q_s32(rects.top + j));
+        r = vmaxq_s32(r, vld1q_s32(rects.right + j));
+        b = vmaxq_s32(b, vld1q_s32(rects.bottom + j));
+    }
+
+    auto l2 = vpmin_s32(vget_low_s32(l), vget_high_s32(l));
+    auto t2 = vpmin_s32(vget_low_s32(t), vget_high_s32(t));
+    auto r2 = vpmax_s32(vget_low_s32(r), vget_high_s32(r));
+    auto b2 = vpmax_s32(vget_low_s32(b), vget_high_s32(b));
+    bounds[0] = vget_lane_s32(vpmin_s32(l2, l2), 0);
+    bounds[1] = vget_lane_s32(vpmin_s32(t2, t2), 0);
+    bounds[2] = vget_lane_s32(vpmax_s32(r2, r2), 0);
+    bounds[3] = vget_lane_s32(vpmax_s32(b2, b2), 0);
+}
+
+static size_t neon_rects_last_hit(const RectEdges& rects, int32_t x, int32_t y)
+{
+    auto i = rects.count;
+
+    // from the end, so the rest is a multiple of 4
+    while (i % 4)
+    {
+        if (rect_hit(rects, --i, x, y))
+            return i;
+    }
+
+    const auto px = vdupq_n_s32(x);
+    const auto py = vdupq_n_s32(y);
+
+    while (i)
+    {
+        i -= 4;
+        auto hit = vcleq_s32(vld1q_s32(rects.left + i), px);
+        hit = vandq_u32(hit, vcgeq_s32(vld1q_s32(rects.right + i), px));
+        hit = vandq_u32(hit, vcleq_s32(vld1q_s32(rects.top + i), py));
+        hit = vandq_u32(hit, vcgeq_s32(vld1q_s32(rects.bottom + i), py));
+
+        const auto any = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+        if (vget_lane_u32(vpmax_u32(any, any), 0))
+        {
+            uint32_t lanes[4];
+            vst1q_u32(lanes, hit);
+            for (auto lane = 3; lane >= 0; --lane)
+            {
+                if (lanes[lane])
+                    return i + static_cast<size_t>(lane);
+            }
+        }
+    }
+
+    return rects.count;
+}
+
+static void neon_lut_lookup(const uint32_t* table, size_t size,
+                            const float* positions, uint32_t* out, size_t count)
+{
+    const auto zero = vdupq_n_f32(0.f);
+    const auto one = vdupq_n_f32(1.f);
+    const auto half = vdupq_n_f32(0.5f);
+    const auto scale = vdupq_n_f32(static_cast<float>(size - 1));
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // select instead of max, so NaN becomes 0 like the scalar version
+        auto p = vld1q_f32(positions + i);
+        p = vbslq_f32(vcgtq_f32(p, zero), p, zero);
+        p = vminq_f32(p, one);
+
+        // NEON has no gather, so load the entries one lane at a time
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vcvtq_u32_f32(vmlaq_f32(half, p, scale)));
+        for (auto lane = 0; lane < 4; ++lane)
+            out[i + lane] = table[lanes[lane]];
+    }
+
+    for (; i < count; ++i)
+        out[i] = table[lut_index(size, positions[i])];
+}
+
+static void neon_mix_argb8888(const uint32_t* a, const uint32_t* b,
+                              uint32_t* out, size_t count, uint32_t weight)
+{
+    const auto wa = static_cast<uint16_t>(256 - weight);
+    const auto wb = static_cast<uint16_t>(weight);
+    size_t i = 0;
+
+    // (a * (256 - weight) + b * weight) fits 16 bits for 8 bit channels
+    for (; i + 4 <= count; i += 4)
+    {
+        const auto pa = vld1q_u8(reinterpret_cast<const uint8_t*>(a + i));
+        const auto pb = vld1q_u8(reinterpret_cast<const uint8_t*>(b + i));
+        auto lo = vmulq_n_u16(vmovl_u8(vget_low_u8(pa)), wa);
+        lo = vmlaq_n_u16(lo, vmovl_u8(vget_low_u8(pb)), wb);
+        auto hi = vmulq_n_u16(vmovl_u8(vget_high_u8(pa)), wa);
+        hi = vmlaq_n_u16(hi, vmovl_u8(vget_high_u8(pb)), wb);
+        vst1q_u8(reinterpret_cast<uint8_t*>(out + i),
+                 vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+    }
+
+    for (; i < count; ++i)
+        out[i] = mix_pixel(a[i], b[i], weight);
+}
+
+static size_t neon_ascii_length(const char* data, size_t size)
+{
+    const auto bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 16)
+    {
+        const auto v = vld1q_u8(bytes + i);
+        const auto any = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+        if (vget_lane_u64(vreinterpret_u64_u8(any), 0) & UINT64_C(0x8080808080808080))
+            break;
+    }
+
+    for (; i < size; ++i)
+    {
+        if (bytes[i] & 0x80)
+            break;
+    }
+
+    return i;
+}
+
+static const PixelOps neon_ops =
+{
+    neon_copy_rect,
+    neon_argb8888_to_rgb565,
+    neon_blend_over,
+    neon_sample_table,
+    neon_argb8888_to_l8,
+    neon_argb8888_to_rgb332,
+    neon_rects_intersect,
+    neon_rects_bounds,
+    neon_rects_last_hit,
+    neon_lut_lookup,
+    neon_mix_argb8888,
+    neon_ascii_length,
+};
+
+const PixelOps* neon_pixel_ops()
+{
+    return &neon_ops;
+}
+
+#else
+
+const PixelOps* neon_pixel_ops()
+{
+    return nullptr;
+}
+
+#endif
+
+}
+}
+}
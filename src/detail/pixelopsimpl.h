@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_PIXELOPSIMPL_H
+#define EGT_SRC_DETAIL_PIXELOPSIMPL_H
+
+#include "egt/detail/pixelops.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Table of pixel kernels, see egt/detail/pixelops.h.
+ */
+struct PixelOps
+{
+    void (*copy_rect)(const uint8_t* src, size_t src_stride,
+                      uint8_t* dst, size_t dst_stride,
+                      size_t bytes, size_t height);
+
+    void (*argb8888_to_rgb565)(const uint32_t* src, size_t src_stride,
+                               uint16_t* dst, size_t dst_stride,
+                               size_t width, size_t height);
+
+    void (*blend_over)(const uint32_t* src, size_t src_stride,
+                       uint32_t* dst, size_t dst_stride,
+                       size_t width, size_t height);
+
+    void (*sample_table)(const float* table, size_t size,
+                         const float* positions, float* out, size_t count);
+
+    void (*argb8888_to_l8)(const uint32_t* src, size_t src_stride,
+                           uint8_t* dst, size_t dst_stride,
+                           size_t width, size_t height);
+
+    void (*argb8888_to_rgb332)(const uint32_t* src, size_t src_stride,
+                               uint8_t* dst, size_t dst_stride,
+                               size_t width, size_t height,
+                               size_t x, size_t y, bool dither);
+
+    size_t (*rects_intersect)(const RectEdges& rects,
+                              int32_t left, int32_t top,
+                              int32_t right, int32_t bottom,
+                              uint8_t* mask);
+
+    void (*rects_bounds)(const RectEdges& rects, int32_t* bounds);
+
+    size_t (*rects_last_hit)(const RectEdges& rects, int32_t x, int32_t y);
+
+    void (*lut_lookup)(const uint32_t* table, size_t size,
+                       const float* positions, uint32_t* out, size_t count);
+
+    void (*mix_argb8888)(const uint32_t* a, const uint32_t* b,
+                         uint32_t* out, size_t count, uint32_t weight);
+
+    size_t (*ascii_length)(const char* data, size_t size);
+};
+
+/**
+ * 4x4 ordered dither matrix, with values from 0 to 15.
+ */
+static constexpr uint8_t bayer4[4][4] =
+{
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+/**
+ * Convert an ARGB8888 pixel to its 8-bit luminance.
+ */
+static inline uint8_t pixel_to_l8(uint32_t p)
+{
+    const auto r = (p >> 16) & 0xff;
+    const auto g = (p >> 8) & 0xff;
+    const auto b = p & 0xff;
+    return (r * 77 + g * 150 + b * 29 + 128) >> 8;
+}
+
+/**
+ * Convert an ARGB8888 pixel to RGB332, adding a dither value from 0 to 15
+ * scaled to the step of each channel before truncating it.
+ */
+static inline uint8_t pixel_to_rgb332(uint32_t p, uint32_t dither)
+{
+    const auto r = std::min<uint32_t>(((p >> 16) & 0xff) + dither * 2, 255);
+    const auto g = std::min<uint32_t>(((p >> 8) & 0xff) + dither * 2, 255);
+    const auto b = std::min<uint32_t>((p & 0xff) + dither * 4, 255);
+    return (r & 0xe0) | ((g & 0xe0) >> 3) | (b >> 6);
+}
+
+/**
+ * Get the sample of a table at a position, see sample_table().
+ */
+static inline float sample_table_at(const float* table, size_t size, float position)
+{
+    // also turns NaN into 0
+    if (!(position > 0.f))
+        position = 0.f;
+    else if (position > 1.f)
+        position = 1.f;
+
+    const auto scaled = position * static_cast<float>(size - 1);
+    auto index = static_cast<size_t>(scaled);
+    if (index > size - 2)
+        index = size - 2;
+    const auto fraction = scaled - static_cast<float>(index);
+    return table[index] + (table[index + 1] - table[index]) * fraction;
+}
+
+/**
+ * Get the index of the nearest entry of a table at a position, see
+ * lut_lookup().
+ */
+static inline size_t lut_index(size_t size, float position)
+{
+    // also turns NaN into 0
+    if (!(position > 0.f))
+        position = 0.f;
+    else if (position > 1.f)
+        position = 1.f;
+
+    return static_cast<size_t>(position * static_cast<float>(size - 1) + 0.5f);
+}
+
+/**
+ * Mix two ARGB8888 pixels, see mix_argb8888().
+ */
+static inline uint32_t mix_pixel(uint32_t a, uint32_t b, uint32_t weight)
+{
+    uint32_t result = 0;
+    for (auto shift = 0; shift < 32; shift += 8)
+    {
+        const auto ca = (a >> shift) & 0xff;
+        const auto cb = (b >> shift) & 0xff;
+        result |= ((ca * (256 - weight) + cb * weight) >> 8) << shift;
+    }
+    return result;
+}
+
+/**
+ * Returns true if a rectangle contains a point, see rects_last_hit().
+ */
+static inline bool rect_hit(const RectEdges& rects, size_t i, int32_t x, int32_t y)
+{
+    return x >= rects.left[i] && x <= rects.right[i] &&
+           y >= rects.top[i] && y <= rects.bottom[i];
+}
+
+/**
+ * Get the NEON kernels.
+ *
+ * @return nullptr if the library was not built with NEON support.
+ */
+const PixelOps* neon_pixel_ops();
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "egt/detail/placement.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/dma-heap.h>)
+#include <linux/dma-heap.h>
+#define EGT_HAVE_DMA_HEAP
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Size of a huge page, the pixels are rounded up to it.
+static constexpr size_t HUGEPAGE_SIZE = 2 * 1024 * 1024;
+
+namespace
+{
+
+/// Pixels allocated outside of cairo, freed with the surface.
+struct Allocation
+{
+    Placement placement{Placement::cached};
+    void* data{nullptr};
+    size_t length{0};
+    /// dma-buf of a CMA allocation.
+    int fd{-1};
+
+    ~Allocation()
+    {
+        if (data)
+            ::munmap(data, length);
+        if (fd >= 0)
+            ::close(fd);
+    }
+};
+
+const cairo_user_data_key_t allocation_key{};
+
+/// Keeps the reads of read_throughput() from being optimized out.
+volatile uint64_t read_sink;
+
+void free_allocation(void* data)
+{
+    delete static_cast<Allocation*>(data);
+}
+
+bool allocate_hugepage(Allocation& allocation, size_t bytes)
+{
+    allocation.length = (bytes + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+
+    void* data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // reserved huge pages, if the system has any
+    data = ::mmap(nullptr, allocation.length, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED)
+    {
+        allocation.data = data;
+        return true;
+    }
+#endif
+
+    // otherwise, transparent huge pages
+    data = ::mmap(nullptr, allocation.length, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return false;
+
+    allocation.data = data;
+#ifdef MADV_HUGEPAGE
+    if (!::madvise(data, allocation.length, MADV_HUGEPAGE))
+        return true;
+#endif
+
+    EGTLOG_DEBUG("no huge pages: {}", strerror(errno));
+    return false;
+}
+
+bool allocate_cma(Allocation& allocation, size_t bytes)
+{
+#ifdef EGT_HAVE_DMA_HEAP
+    const auto heap = ::open("/dev/dma_heap/linux,cma", O_RDWR | O_CLOEXEC);
+    if (heap < 0)
+    {
+        EGTLOG_DEBUG("no CMA heap: {}", strerror(errno));
+        return false;
+    }
+
+    dma_heap_allocation_data data{};
+    data.len = bytes;
+    data.fd_flags = O_RDWR | O_CLOEXEC;
+    const auto ret = ::ioctl(heap, DMA_HEAP_IOCTL_ALLOC, &data);
+    ::close(heap);
+    if (ret < 0)
+    {
+        EGTLOG_DEBUG("CMA allocation of {} bytes failed: {}", bytes, strerror(errno));
+        return false;
+    }
+
+    allocation.fd = data.fd;
+    allocation.length = bytes;
+    auto pixels = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, data.fd, 0);
+    if (pixels == MAP_FAILED)
+        return false;
+
+    // the heap does not clear what it hands out
+    std::memset(pixels, 0, bytes);
+    allocation.data = pixels;
+    return true;
+#else
+    detail::ignoreparam(allocation);
+    detail::ignoreparam(bytes);
+    return false;
+#endif
+}
+
+}
+
+shared_cairo_surface_t create_surface(cairo_format_t format, const Size& size,
+                                      Placement placement)
+{
+    const auto stride = cairo_format_stride_for_width(format, size.width());
+    const auto bytes = static_cast<size_t>(stride) * std::max(size.height(), 0);
+
+    if (placement == Placement::automatic)
+        placement = bytes >= HUGEPAGE_THRESHOLD ? Placement::hugepage : Placement::cached;
+
+    if (placement != Placement::cached && bytes)
+    {
+        std::unique_ptr<Allocation> allocation(new Allocation);
+        allocation->placement = placement;
+
+        const auto allocated = placement == Placement::hugepage ?
+                               allocate_hugepage(*allocation, bytes) :
+                               allocate_cma(*allocation, bytes);
+        if (allocated)
+        {
+            auto surface = cairo_image_surface_create_for_data(
+                               static_cast<unsigned char*>(allocation->data), format,
+                               size.width(), size.height(), stride);
+            if (cairo_surface_set_user_data(surface, &allocation_key, allocation.get(),
+                                            free_allocation) == CAIRO_STATUS_SUCCESS)
+            {
+                // owned by the surface now
+                allocation.release();
+                return {surface, cairo_surface_destroy};
+            }
+
+            cairo_surface_destroy(surface);
+        }
+
+        EGTLOG_DEBUG("{} memory not available, using cached memory", placement_name(placement));
+    }
+
+    return {cairo_image_surface_create(format, size.width(), size.height()),
+            cairo_surface_destroy};
+}
+
+Placement placement(cairo_surface_t* surface)
+{
+    auto allocation = static_cast<Allocation*>(cairo_surface_get_user_data(surface,
+                      &allocation_key));
+    return allocation ? allocation->placement : Placement::cached;
+}
+
+Placement composition_placement()
+{
+    static const Placement value = []()
+    {
+        const auto env = std::getenv("EGT_COMPOSITION_MEMORY");
+        if (env && strlen(env))
+        {
+            for (auto p : {Placement::automatic, Placement::cached, Placement::hugepage, Placement::cma})
+            {
+                if (!strcmp(env, placement_name(p)))
+                    return p;
+            }
+
+            detail::warn("unknown EGT_COMPOSITION_MEMORY: {}", env);
+        }
+        return Placement::automatic;
+    }();
+    return value;
+}
+
+const char* placement_name(Placement placement)
+{
+    switch (placement)
+    {
+    case Placement::automatic:
+        return "automatic";
+    case Placement::cached:
+        return "cached";
+    case Placement::hugepage:
+        return "hugepage";
+    case Placement::cma:
+        return "cma";
+    }
+    return "unknown";
+}
+
+double read_throughput(const uint8_t* data, size_t bytes)
+{
+    if (!data || bytes < sizeof(uint64_t))
+        return 0;
+
+    const auto words = reinterpret_cast<const uint64_t*>(data);
+    const auto count = bytes / sizeof(uint64_t);
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i)
+        sum += words[i];
+    const auto end = std::chrono::steady_clock::now();
+
+    read_sink = sum;
+
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    return seconds > 0 ? count * sizeof(uint64_t) / seconds : 0;
+}
+
+}
+}
+}
@@ -11,10 +11,16 @@
 #ifndef EGT_SRC_DETAIL_PRIORITYQUEUE_H
 #define EGT_SRC_DETAIL_PRIORITYQUEUE_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <egt/asio.hpp>
-#include <functional>
-#include <queue>
+#include <egt/detail/meta.h>
+#include <new>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace egt
 {
@@ -23,38 +29,262 @@ inline namespace v1
 namespace detail
 {
 
+/**
+ * Priorities of queued handlers, highest first.
+ */
 enum class priorities
 {
-    low = 0,
-    moderate = 50,
-    high = 100,
+    /// Work that only runs when nothing else is pending.
+    idle = 0,
+    /// Background work.
+    background = 25,
+    /// Timers.
+    timer = 50,
+    /// Input devices.  Never deferred by the time budget.
+    input = 100,
 };
 
+/**
+ * Move-only callable with no arguments.
+ *
+ * Callables up to BUFFER_SIZE bytes, which is enough for the completion
+ * handlers of the event loop, are stored inline and never allocate.
+ */
+class QueuedFunction
+{
+public:
+
+    /// Size of the inline storage.
+    static constexpr size_t BUFFER_SIZE = 64;
+
+    QueuedFunction() noexcept = default;
+
+    template<class F,
+             class = typename std::enable_if<!std::is_same<typename std::decay<F>::type,
+                                                           QueuedFunction>::value>::type>
+    // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
+    QueuedFunction(F&& f)
+    {
+        using T = typename std::decay<F>::type;
+        if constexpr (fits<T>())
+        {
+            new (m_storage) T(std::forward<F>(f));
+            m_ops = inline_ops<T>();
+        }
+        else
+        {
+            *reinterpret_cast<T**>(m_storage) = new T(std::forward<F>(f));
+            m_ops = heap_ops<T>();
+        }
+    }
+
+    QueuedFunction(const QueuedFunction&) = delete;
+    QueuedFunction& operator=(const QueuedFunction&) = delete;
+
+    QueuedFunction(QueuedFunction&& rhs) noexcept
+    {
+        take(rhs);
+    }
+
+    QueuedFunction& operator=(QueuedFunction&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            take(rhs);
+        }
+        return *this;
+    }
+
+    ~QueuedFunction() noexcept
+    {
+        reset();
+    }
+
+    /// Call the function.
+    void operator()()
+    {
+        m_ops->invoke(m_storage);
+    }
+
+    /// Is there a function.
+    explicit operator bool() const noexcept
+    {
+        return m_ops;
+    }
+
+    /// Does a callable of type T fit in the inline storage.
+    template<class T>
+    static constexpr bool fits()
+    {
+        return sizeof(T) <= BUFFER_SIZE &&
+               alignof(T) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<T>::value;
+    }
+
+protected:
+
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<class T>
+    static const Ops* inline_ops()
+    {
+        static const Ops ops =
+        {
+            [](void* storage) { (*static_cast<T*>(storage))(); },
+            [](void* dst, void* src) noexcept
+            {
+                new (dst) T(std::move(*static_cast<T*>(src)));
+                static_cast<T*>(src)->~T();
+            },
+            [](void* storage) noexcept { static_cast<T*>(storage)->~T(); },
+        };
+        return &ops;
+    }
+
+    template<class T>
+    static const Ops* heap_ops()
+    {
+        static const Ops ops =
+        {
+            [](void* storage) { (**static_cast<T**>(storage))(); },
+            [](void* dst, void* src) noexcept
+            {
+                *static_cast<T**>(dst) = *static_cast<T**>(src);
+            },
+            [](void* storage) noexcept { delete *static_cast<T**>(storage); },
+        };
+        return &ops;
+    }
+
+    void take(QueuedFunction& rhs) noexcept
+    {
+        if (rhs.m_ops)
+        {
+            rhs.m_ops->move(m_storage, rhs.m_storage);
+            m_ops = rhs.m_ops;
+            rhs.m_ops = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[BUFFER_SIZE];
+    const Ops* m_ops{nullptr};
+};
+
+/**
+ * Queue of completion handlers, run in order of priority.
+ *
+ * Handlers wrapped with wrap() are not run by asio when they complete, but
+ * added here, and run by execute().  Handlers of the same priority run in
+ * the order they completed.
+ */
 class PriorityQueue
 {
 public:
 
-    void add(priorities priority, std::function<void()> function)
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Add a handler.
+     *
+     * @param[in] priority Priority of the handler.
+     * @param[in] function The handler.
+     * @param[in] owner Object the handler belongs to, for cancel().
+     */
+    void add(priorities priority, QueuedFunction function, const void* owner = nullptr)
     {
-        m_handlers.push(queued_handler(priority, std::move(function)));
+        m_handlers.push_back({priority, m_sequence++, owner, std::move(function)});
+        std::push_heap(m_handlers.begin(), m_handlers.end());
     }
 
-    void execute_all()
+    /**
+     * Run handlers, highest priority first.
+     *
+     * Once the deadline has passed, only input handlers are run, and the
+     * rest is left for the next call.  Handlers added while running are run
+     * by the same call.
+     *
+     * @return true if handlers were left in the queue.
+     */
+    bool execute(Clock::time_point deadline)
     {
         while (!m_handlers.empty())
         {
-            queued_handler handler = m_handlers.top();
-            m_handlers.pop();
-            handler.execute();
+            if (m_handlers.front().priority < priorities::input &&
+                deadline != Clock::time_point::max() &&
+                Clock::now() >= deadline)
+                return true;
+
+            std::pop_heap(m_handlers.begin(), m_handlers.end());
+            auto function = std::move(m_handlers.back().function);
+            m_handlers.pop_back();
+            function();
         }
+
+        return false;
     }
 
+    /**
+     * Run all handlers.
+     */
+    void execute_all()
+    {
+        execute(Clock::time_point::max());
+    }
+
+    /**
+     * Drop the handlers that belong to an object.
+     *
+     * Objects that wrap handlers with themselves as owner call this when
+     * destroyed, so none of their handlers run after.
+     */
+    void cancel(const void* owner)
+    {
+        if (!owner)
+            return;
+
+        const auto end = std::remove_if(m_handlers.begin(), m_handlers.end(),
+                                        [owner](const Entry & entry)
+        {
+            return entry.owner == owner;
+        });
+
+        if (end != m_handlers.end())
+        {
+            m_handlers.erase(end, m_handlers.end());
+            std::make_heap(m_handlers.begin(), m_handlers.end());
+        }
+    }
+
+    /// Are there no handlers queued.
+    EGT_NODISCARD bool empty() const { return m_handlers.empty(); }
+
+    /// Number of handlers queued.
+    EGT_NODISCARD size_t size() const { return m_handlers.size(); }
+
+    /// Priority of the next handler to run.  The queue must not be empty.
+    EGT_NODISCARD priorities top() const { return m_handlers.front().priority; }
+
     template <typename Handler>
     class WrappedHandler
     {
     public:
-        WrappedHandler(PriorityQueue& q, priorities p, Handler h)
-            : queue_(q), m_priority(p), handler_(h)
+        WrappedHandler(PriorityQueue& q, priorities p, Handler h, const void* owner)
+            : queue_(q), m_priority(p), m_owner(owner), handler_(std::move(h))
         {
         }
 
@@ -77,49 +307,67 @@ public:
 
         PriorityQueue& queue_;
         priorities m_priority;
+        const void* m_owner;
         Handler handler_;
     };
 
+    /**
+     * Wrap a completion handler, so it is queued when it completes.
+     *
+     * @param[in] priority Priority of the handler.
+     * @param[in] handler The handler.
+     * @param[in] owner Object the handler belongs to, for cancel().
+     */
     template <typename Handler>
-    WrappedHandler<Handler> wrap(priorities priority, Handler handler)
+    WrappedHandler<Handler> wrap(priorities priority, Handler handler,
+                                 const void* owner = nullptr)
     {
-        return WrappedHandler<Handler>(*this, priority, handler);
+        return WrappedHandler<Handler>(*this, priority, std::move(handler), owner);
     }
 
 private:
 
-    class queued_handler
+    struct Entry
     {
-    public:
-        queued_handler(priorities p, std::function<void()> f)
-            : m_priority(p), m_function(std::move(f))
-        {
-        }
+        priorities priority;
+        uint64_t sequence;
+        const void* owner;
+        QueuedFunction function;
 
-        void execute()
+        /// Heap order: highest priority, then oldest, on top.
+        friend bool operator<(const Entry& a, const Entry& b)
         {
-            m_function();
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+            return a.sequence > b.sequence;
         }
-
-        friend bool operator<(const queued_handler& a,
-                              const queued_handler& b)
-        {
-            return a.m_priority < b.m_priority;
-        }
-
-    private:
-        priorities m_priority;
-        std::function<void()> m_function;
     };
 
-    std::priority_queue<queued_handler> m_handlers;
+    std::vector<Entry> m_handlers;
+    uint64_t m_sequence{0};
 };
 
 template <typename Function, typename Handler>
 void asio_handler_invoke(Function f,
                          PriorityQueue::WrappedHandler<Handler>* h)
 {
-    h->queue_.add(h->m_priority, std::forward<Function>(f));
+    h->queue_.add(h->m_priority, std::move(f), h->m_owner);
+}
+
+/// Allocate the operation of a wrapped handler like the handler itself does.
+template <typename Handler>
+void* asio_handler_allocate(std::size_t size,
+                            PriorityQueue::WrappedHandler<Handler>* h)
+{
+    return egt_asio_handler_alloc_helpers::allocate(size, h->handler_);
+}
+
+/// Free the operation of a wrapped handler like the handler itself does.
+template <typename Handler>
+void asio_handler_deallocate(void* pointer, std::size_t size,
+                             PriorityQueue::WrappedHandler<Handler>* h)
+{
+    egt_asio_handler_alloc_helpers::deallocate(pointer, size, h->handler_);
 }
 
 }
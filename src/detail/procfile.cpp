@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/procfile.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+ProcFile::ProcFile(const std::string& path)
+    : m_fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)),
+      m_buffer(4096)
+{}
+
+std::string_view ProcFile::read()
+{
+    if (m_fd < 0)
+        return {};
+
+    while (true)
+    {
+        const auto size = ::pread(m_fd, m_buffer.data(), m_buffer.size(), 0);
+        if (size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return {};
+        }
+
+        // a full buffer may have cut the file, so read it again bigger
+        if (static_cast<size_t>(size) == m_buffer.size())
+        {
+            m_buffer.resize(m_buffer.size() * 2);
+            continue;
+        }
+
+        return {m_buffer.data(), static_cast<size_t>(size)};
+    }
+}
+
+ProcFile::~ProcFile() noexcept
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+bool parse_number(std::string_view text, size_t& pos, uint64_t& value)
+{
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+        ++pos;
+
+    if (pos >= text.size() || text[pos] < '0' || text[pos] > '9')
+        return false;
+
+    value = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+        value = value * 10 + (text[pos++] - '0');
+    return true;
+}
+
+void parse_cpu_times(std::string_view stat, std::vector<CpuTimes>& times)
+{
+    times.clear();
+
+    size_t line = 0;
+    while (line < stat.size() && stat.compare(line, 3, "cpu") == 0)
+    {
+        auto pos = stat.find(' ', line);
+        if (pos == std::string_view::npos)
+            break;
+
+        // user nice system idle iowait irq softirq steal, guest times are
+        // already counted in user and nice
+        CpuTimes cpu;
+        uint64_t value{};
+        for (auto field = 0; field < 8 && parse_number(stat, pos, value); ++field)
+        {
+            if (field == 3 || field == 4)
+                cpu.idle += value;
+            cpu.total += value;
+        }
+        times.push_back(cpu);
+
+        line = stat.find('\n', pos);
+        if (line == std::string_view::npos)
+            break;
+        ++line;
+    }
+}
+
+double cpu_usage(const CpuTimes& previous, const CpuTimes& current)
+{
+    if (current.total <= previous.total || current.idle < previous.idle)
+        return 0.;
+
+    const double total = current.total - previous.total;
+    const double idle = current.idle - previous.idle;
+    return idle >= total ? 0. : 100. * (1. - idle / total);
+}
+
+bool parse_field(std::string_view text, std::string_view key, uint64_t& value)
+{
+    size_t pos = 0;
+    while ((pos = text.find(key, pos)) != std::string_view::npos)
+    {
+        // only at the start of a line
+        if (pos == 0 || text[pos - 1] == '\n')
+        {
+            pos += key.size();
+            return parse_number(text, pos, value);
+        }
+        pos += key.size();
+    }
+
+    return false;
+}
+
+}
+}
+}
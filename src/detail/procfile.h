@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_PROCFILE_H
+#define EGT_SRC_DETAIL_PROCFILE_H
+
+#include "egt/detail/meta.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * A file of /proc or /sys read again and again, like /proc/stat.
+ *
+ * The file is opened once, and each read is a single pread() from the
+ * start into a buffer kept between reads, so sampling it allocates and
+ * opens nothing.
+ */
+class ProcFile : private NonCopyable<ProcFile>
+{
+public:
+
+    /**
+     * @param[in] path Path of the file.  Failing to open it is not an error,
+     *            reads just fail.
+     */
+    explicit ProcFile(const std::string& path);
+
+    /// Returns true if the file is open.
+    EGT_NODISCARD bool is_open() const { return m_fd >= 0; }
+
+    /**
+     * Read the whole file again.
+     *
+     * @return The content, valid until the next read, or empty on error.
+     */
+    std::string_view read();
+
+    ~ProcFile() noexcept;
+
+private:
+
+    int m_fd{-1};
+    std::vector<char> m_buffer;
+};
+
+/**
+ * Times a CPU spent, from a "cpu" line of /proc/stat, in clock ticks.
+ */
+struct CpuTimes
+{
+    /// Ticks idle, or waiting for I/O.
+    uint64_t idle{0};
+    /// Ticks in all states.
+    uint64_t total{0};
+};
+
+/**
+ * Parse the "cpu" lines of /proc/stat.
+ *
+ * @param[in] stat Content of /proc/stat.
+ * @param[out] times Times of all CPUs first, then of each CPU.
+ */
+void parse_cpu_times(std::string_view stat, std::vector<CpuTimes>& times);
+
+/**
+ * Get the usage of a CPU between two samples, from 0 to 100.
+ */
+double cpu_usage(const CpuTimes& previous, const CpuTimes& current);
+
+/**
+ * Parse a number, after spaces, and move pos past it.
+ *
+ * @return false if there is no number at pos.
+ */
+bool parse_number(std::string_view text, size_t& pos, uint64_t& value);
+
+/**
+ * Find the number after a key, like "MemTotal:" in /proc/meminfo.
+ *
+ * @return false if the key is not found.
+ */
+bool parse_field(std::string_view text, std::string_view key, uint64_t& value);
+
+}
+}
+}
+
+#endif
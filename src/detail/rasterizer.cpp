@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "egt/detail/pixelops.h"
+#include "egt/detail/rasterizer.h"
+#include "egt/image.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifndef EGT_RASTERIZER
+#define EGT_RASTERIZER "direct"
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+
+/**
+ * Image surface targeted by a context, when it can be written directly
+ * instead of by cairo.
+ *
+ * That is when the transformation is a translation by whole pixels and the
+ * clip is made of whole pixel rectangles, which is how widgets draw.  Other
+ * surfaces, like the ones of the 2D engine, are left to cairo.
+ */
+class DirectTarget
+{
+public:
+
+    explicit DirectTarget(cairo_t* cr)
+        : m_clip(nullptr, cairo_rectangle_list_destroy)
+    {
+        cairo_matrix_t ctm;
+        cairo_get_matrix(cr, &ctm);
+        if (ctm.xx != 1 || ctm.yy != 1 || ctm.xy != 0 || ctm.yx != 0)
+            return;
+
+        auto target = cairo_get_group_target(cr);
+        if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE)
+            return;
+
+        // pixels of the target, the one of a pushed group only covers the clip
+        double offset_x;
+        double offset_y;
+        cairo_surface_get_device_offset(target, &offset_x, &offset_y);
+        m_x = ctm.x0 + offset_x;
+        m_y = ctm.y0 + offset_y;
+        if (!whole(m_x) || !whole(m_y))
+            return;
+
+        m_clip.reset(cairo_copy_clip_rectangle_list(cr));
+        if (m_clip->status != CAIRO_STATUS_SUCCESS)
+            return;
+
+        for (auto i = 0; i < m_clip->num_rectangles; ++i)
+        {
+            const auto& r = m_clip->rectangles[i];
+            if (!whole(r.x) || !whole(r.y) || !whole(r.width) || !whole(r.height))
+                return;
+        }
+
+        m_surface = target;
+    }
+
+    /// Can the target be written directly?
+    bool valid() const { return m_surface; }
+
+    cairo_surface_t* surface() const { return m_surface; }
+
+    cairo_format_t format() const { return cairo_image_surface_get_format(m_surface); }
+
+    /**
+     * Get a rectangle of the user space in pixels of the target.
+     *
+     * @return An empty rectangle if it is not made of whole pixels.
+     */
+    Rect pixels(const RectF& rect) const
+    {
+        if (!whole(rect.x()) || !whole(rect.y()) ||
+            !whole(rect.width()) || !whole(rect.height()))
+            return {};
+
+        return {static_cast<int>(rect.x() + m_x), static_cast<int>(rect.y() + m_y),
+                static_cast<int>(rect.width()), static_cast<int>(rect.height())};
+    }
+
+    /**
+     * Call a function with each part of a rectangle, in pixels of the
+     * target, which is inside the clip and the target, and mark it dirty.
+     */
+    template<class F>
+    void each(const Rect& rect, const F& func) const
+    {
+        cairo_surface_flush(m_surface);
+
+        const Rect bounds(0, 0, cairo_image_surface_get_width(m_surface),
+                          cairo_image_surface_get_height(m_surface));
+        const auto area = Rect::intersection(rect, bounds);
+
+        for (auto i = 0; i < m_clip->num_rectangles; ++i)
+        {
+            const auto& r = m_clip->rectangles[i];
+            const Rect clip(static_cast<int>(r.x + m_x), static_cast<int>(r.y + m_y),
+                            static_cast<int>(r.width), static_cast<int>(r.height));
+            const auto part = Rect::intersection(area, clip);
+            if (part.empty())
+                continue;
+
+            func(part);
+
+            cairo_surface_mark_dirty_rectangle(m_surface, part.x(), part.y(),
+                                               part.width(), part.height());
+        }
+    }
+
+    /// Get the first pixel of a rectangle of the target.
+    uint8_t* data(const Point& point, size_t bpp) const
+    {
+        return cairo_image_surface_get_data(m_surface) +
+               point.y() * cairo_image_surface_get_stride(m_surface) +
+               point.x() * bpp;
+    }
+
+    size_t stride() const { return cairo_image_surface_get_stride(m_surface); }
+
+private:
+
+    static bool whole(double value) { return value == std::round(value); }
+
+    cairo_surface_t* m_surface{nullptr};
+    double m_x{0};
+    double m_y{0};
+    std::unique_ptr<cairo_rectangle_list_t, decltype(&cairo_rectangle_list_destroy)> m_clip;
+};
+
+}
+
+/**
+ * Draw an image on an image surface of the same 32-bit format with the
+ * pixel kernels, instead of going through a cairo pattern.
+ *
+ * Only done for the OVER operator.  Opaque images are copied, others are
+ * blended.
+ */
+static bool blit(cairo_t* cr, const Image& image, const PointF& point)
+{
+    if (cairo_get_operator(cr) != CAIRO_OPERATOR_OVER)
+        return false;
+
+    const DirectTarget target(cr);
+    if (!target.valid())
+        return false;
+
+    auto source = image.surface().get();
+    if (target.surface() == source ||
+        cairo_surface_get_type(source) != CAIRO_SURFACE_TYPE_IMAGE)
+        return false;
+
+    const auto format = target.format();
+    if (format != cairo_image_surface_get_format(source) ||
+        (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24))
+        return false;
+
+    const auto dst = target.pixels(RectF(point, image.size()));
+    if (dst.empty())
+        return false;
+
+    cairo_surface_flush(source);
+
+    const auto src_stride = cairo_image_surface_get_stride(source);
+    const auto src_data = cairo_image_surface_get_data(source);
+    const auto opaque = image.opaque();
+
+    target.each(dst, [&](const Rect & area)
+    {
+        auto d = target.data(area.point(), 4);
+        auto s = src_data + (area.y() - dst.y()) * src_stride + (area.x() - dst.x()) * 4;
+
+        if (opaque)
+            copy_rect(s, src_stride, d, target.stride(),
+                      area.width() * 4, area.height());
+        else
+            blend_over(reinterpret_cast<const uint32_t*>(s), src_stride,
+                       reinterpret_cast<uint32_t*>(d), target.stride(),
+                       area.width(), area.height());
+    });
+
+    return true;
+}
+
+/**
+ * Fill a rectangle of an image surface with an opaque solid color with
+ * fill_rect(), instead of rasterizing it with cairo.
+ */
+static bool fill_direct(cairo_t* cr, const RectF& rect)
+{
+    const auto op = cairo_get_operator(cr);
+    if (op != CAIRO_OPERATOR_OVER && op != CAIRO_OPERATOR_SOURCE)
+        return false;
+
+    double r;
+    double g;
+    double b;
+    double a;
+    if (cairo_pattern_get_rgba(cairo_get_source(cr), &r, &g, &b, &a) != CAIRO_STATUS_SUCCESS ||
+        a != 1.)
+        return false;
+
+    const DirectTarget target(cr);
+    if (!target.valid())
+        return false;
+
+    const auto dst = target.pixels(rect);
+    if (dst.empty())
+        return false;
+
+    // rounded like cairo does, with 8 bits colors being exact
+    const auto channel = [](double value)
+    {
+        return static_cast<uint32_t>(value * 65535. + 0.5) >> 8;
+    };
+
+    size_t bpp;
+    uint32_t value;
+    switch (target.format())
+    {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+        bpp = 4;
+        value = 0xff000000 | (channel(r) << 16) | (channel(g) << 8) | channel(b);
+        break;
+    case CAIRO_FORMAT_RGB16_565:
+        bpp = 2;
+        value = ((channel(r) & 0xf8) << 8) | ((channel(g) & 0xfc) << 3) | (channel(b) >> 3);
+        break;
+    default:
+        return false;
+    }
+
+    target.each(dst, [&](const Rect & area)
+    {
+        fill_rect(target.data(area.point(), bpp), target.stride(),
+                   area.width(), area.height(), bpp, value);
+    });
+
+    return true;
+}
+
+/**
+ * Writes untransformed images and opaque solid rectangles directly.
+ */
+class DirectRasterizer : public Rasterizer
+{
+public:
+
+    using Rasterizer::fill;
+
+    const char* name() const override { return "direct"; }
+
+    bool fill(cairo_t* cr, const RectF& rect) override
+    {
+        return fill_direct(cr, rect);
+    }
+
+    bool draw(cairo_t* cr, const Image& image, const PointF& point) override
+    {
+        return blit(cr, image, point);
+    }
+};
+
+/**
+ * Leaves everything to cairo.
+ */
+class CairoRasterizer : public Rasterizer
+{
+public:
+
+    const char* name() const override { return "cairo"; }
+};
+
+/**
+ * Create a rasterizer built in.
+ *
+ * Other rasterizers, like one rendering paths on several threads, are
+ * added here.
+ */
+static std::unique_ptr<Rasterizer> create_rasterizer(const std::string& name)
+{
+    if (name == "direct")
+        return std::make_unique<DirectRasterizer>();
+    if (name == "cairo")
+        return std::make_unique<CairoRasterizer>();
+    return nullptr;
+}
+
+static std::unique_ptr<Rasterizer>& current_rasterizer()
+{
+    static std::unique_ptr<Rasterizer> instance = []()
+    {
+        std::unique_ptr<Rasterizer> result;
+        const auto env = std::getenv("EGT_RASTERIZER");
+        if (env && std::strlen(env))
+        {
+            result = create_rasterizer(env);
+            if (!result)
+                detail::warn("unknown rasterizer: {}", env);
+        }
+        if (!result)
+            result = create_rasterizer(EGT_RASTERIZER);
+        if (!result)
+            result = std::make_unique<CairoRasterizer>();
+        EGTLOG_DEBUG("rasterizer is {}", result->name());
+        return result;
+    }();
+    return instance;
+}
+
+Rasterizer& rasterizer()
+{
+    return *current_rasterizer();
+}
+
+void rasterizer(const std::string& name)
+{
+    auto result = create_rasterizer(name);
+    if (!result)
+        throw std::runtime_error("unknown rasterizer: " + name);
+    current_rasterizer() = std::move(result);
+}
+
+std::vector<std::string> rasterizers()
+{
+    return {"direct", "cairo"};
+}
+
+}
+}
+}
@@ -3,12 +3,25 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "detail/egtlog.h"
+#include "detail/layoutcache.h"
 #include "egt/app.h"
 #include "egt/detail/screen/composerscreen.h"
 #include "egt/font.h"
 #include "egt/theme.h"
 #include "egt/window.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <unistd.h>
 
 namespace egt
 {
@@ -26,13 +39,28 @@ ComposerScreen::ComposerScreen(const Size& size)
     detail::info("fb size {}", size);
 
     init(size);
+
+    // EGT_COMPOSER_EXPORT=/dev/shm/egt-preview
+    auto path = std::getenv("EGT_COMPOSER_EXPORT");
+    if (path && strlen(path) && !export_to(path))
+        detail::warn("unable to export composer screen to {}", path);
 }
 
 void ComposerScreen::resize(const Size& size)
 {
     if (m_size != size)
     {
-        init(size);
+        auto window = Application::instance().main_window();
+
+        // the layout at the size left is restored when coming back to it
+        if (window)
+            LayoutCache::save(m_size, *window);
+
+        if (!m_export_header || !map_export(size))
+            init(size);
+
+        // what changes from here on follows the screen size
+        LayoutCache::Guard guard;
 
         on_screen_resized.invoke();
 
@@ -41,7 +69,14 @@ void ComposerScreen::resize(const Size& size)
         if (global_font())
             const_cast<Font*>(global_font())->on_screen_resized();
 
-        Application::instance().main_window()->on_screen_resized();
+        // default sizes and fonts follow the screen, so do all size hints
+        Widget::invalidate_all_size_hints();
+
+        if (window && !LayoutCache::restore(size, *window))
+        {
+            window->on_screen_resized();
+            window->flush_layout();
+        }
     }
 }
 
@@ -51,6 +86,137 @@ unsigned char* ComposerScreen::get_pixmap()
 }
 
 
+void ComposerScreen::flip(const DamageArray& damage)
+{
+    if (!m_export_header || damage.empty())
+    {
+        Screen::flip(damage);
+        return;
+    }
+
+    auto header = m_export_header;
+    header->sequence.fetch_add(1, std::memory_order_acq_rel);
+
+    // only the damage is copied to the exported buffer
+    Screen::flip(damage);
+
+    if (m_export_full || damage.size() > ExportHeader::MAX_DAMAGE)
+    {
+        header->damage_count = 0;
+        m_export_full = false;
+    }
+    else
+    {
+        header->damage_count = static_cast<uint32_t>(damage.size());
+        for (size_t i = 0; i < damage.size(); ++i)
+        {
+            header->damage[i][0] = damage[i].x();
+            header->damage[i][1] = damage[i].y();
+            header->damage[i][2] = damage[i].width();
+            header->damage[i][3] = damage[i].height();
+        }
+    }
+
+    header->sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool ComposerScreen::export_to(const std::string& path)
+{
+    if (path == m_export_path && (m_export_header || path.empty()))
+        return true;
+
+    unmap_export();
+    m_export_path = path;
+
+    if (path.empty())
+    {
+        // the new composition buffer is drawn from scratch
+        if (Application::check_instance() && Application::instance().main_window())
+            Application::instance().main_window()->damage();
+        return true;
+    }
+
+    if (map_export(m_size))
+        return true;
+
+    m_export_path.clear();
+    return false;
+}
+
+bool ComposerScreen::map_export(const Size& size)
+{
+#ifdef HAVE_SYS_MMAN_H
+    unmap_export();
+
+    const auto stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, size.width());
+    // the pixels start on a cache line
+    const size_t offset = (sizeof(ExportHeader) + 63) & ~size_t(63);
+    const size_t bytes = offset + stride * size.height();
+
+    const auto fd = open(m_export_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, bytes) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    auto map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    auto header = new (map) ExportHeader{};
+    header->version = ExportHeader::VERSION;
+    header->width = size.width();
+    header->height = size.height();
+    header->stride = stride;
+    header->format = static_cast<uint32_t>(PixelFormat::argb8888);
+    header->offset = offset;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ExportHeader::MAGIC;
+
+    m_export_header = header;
+    m_export_size = bytes;
+    m_export_full = true;
+
+    // the composition is copied to the exported buffer like to a framebuffer
+    void* pixels = static_cast<unsigned char*>(map) + offset;
+    init(&pixels, 1, size);
+
+    detail::info("composer screen exported to {}", m_export_path);
+
+    if (Application::check_instance() && Application::instance().main_window())
+        Application::instance().main_window()->damage();
+
+    return true;
+#else
+    detail::ignoreparam(size);
+    return false;
+#endif
+}
+
+void ComposerScreen::unmap_export()
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (m_export_header)
+    {
+        // the surfaces drawing to the mapping go first
+        init(m_size);
+        munmap(m_export_header, m_export_size);
+        m_export_header = nullptr;
+        m_export_size = 0;
+    }
+#endif
+}
+
+ComposerScreen::~ComposerScreen() noexcept
+{
+    unmap_export();
+}
+
 Signal<>::RegisterHandle ComposerScreen::register_screen_resize_hook(const Signal<>::EventCallback& handler)
 {
     return on_screen_resized(handler);
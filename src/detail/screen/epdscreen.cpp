@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "egt/app.h"
+#include "egt/detail/screen/epdscreen.h"
+#include "egt/detail/string.h"
+#include "egt/eventloop.h"
+#include <algorithm>
+#include <cairo.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/fb.h>)
+#include <linux/fb.h>
+#define EGT_HAVE_LINUX_FB
+#if __has_include(<linux/mxcfb.h>)
+#include <linux/mxcfb.h>
+#define EGT_HAVE_LINUX_MXCFB
+#endif
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+#if defined(EGT_HAVE_LINUX_FB) && !defined(EGT_HAVE_LINUX_MXCFB)
+/*
+ * Update interface of the i.MX EPDC framebuffer driver, from linux/mxcfb.h,
+ * which only ships with the kernel headers of the boards that have one.
+ */
+struct mxcfb_rect
+{
+    uint32_t top;
+    uint32_t left;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct mxcfb_alt_buffer_data
+{
+    uint32_t phys_addr;
+    uint32_t width;
+    uint32_t height;
+    struct mxcfb_rect alt_update_region;
+};
+
+struct mxcfb_update_data
+{
+    struct mxcfb_rect update_region;
+    uint32_t waveform_mode;
+    uint32_t update_mode;
+    uint32_t update_marker;
+    int temp;
+    unsigned int flags;
+    int dither_mode;
+    int quant_bit;
+    struct mxcfb_alt_buffer_data alt_buffer_data;
+};
+
+#define UPDATE_MODE_PARTIAL 0x0
+#define UPDATE_MODE_FULL 0x1
+#define TEMP_USE_AMBIENT 0x1000
+#define MXCFB_SEND_UPDATE _IOW('F', 0x2E, struct mxcfb_update_data)
+#endif
+
+EpdRefresh::EpdRefresh(const Size& size)
+    : EpdRefresh(size, Config())
+{}
+
+EpdRefresh::EpdRefresh(const Size& size, const Config& config)
+    : m_size(size),
+      m_config(config)
+{}
+
+void EpdRefresh::add(const Rect& rect, bool monochrome)
+{
+    const auto r = Rect::intersection(rect, Rect(Point(), m_size));
+    if (r.empty())
+        return;
+
+    if (monochrome && static_cast<uint64_t>(r.area()) <= m_config.fast_max_pixels)
+        Screen::damage_algorithm(m_fast, r);
+    else
+        Screen::damage_algorithm(m_quality, r);
+}
+
+std::vector<EpdUpdate> EpdRefresh::take()
+{
+    std::vector<EpdUpdate> updates;
+    if (!pending() && !m_force_full)
+        return updates;
+
+    // fast regions overlapping gray ones have to wait for them anyway
+    Screen::DamageArray fast;
+    for (const auto& rect : m_fast)
+    {
+        const auto overlaps = std::any_of(m_quality.begin(), m_quality.end(),
+                                          [&rect](const Rect & quality)
+        {
+            return rect.intersect(quality);
+        });
+
+        if (overlaps)
+            Screen::damage_algorithm(m_quality, rect);
+        else
+            fast.push_back(rect);
+    }
+
+    uint64_t pixels = 0;
+    for (const auto& rect : fast)
+        pixels += rect.area();
+    for (const auto& rect : m_quality)
+        pixels += rect.area();
+
+    const auto count = static_cast<uint32_t>(fast.size() + m_quality.size());
+    const auto screen = static_cast<uint64_t>(m_size.width()) * m_size.height();
+
+    if (m_force_full ||
+        (m_config.full_interval && m_partials + count > m_config.full_interval) ||
+        pixels > m_config.full_fraction * screen)
+    {
+        updates.push_back({Rect(Point(), m_size), EpdWaveform::quality, true});
+        m_partials = 0;
+        m_force_full = false;
+    }
+    else
+    {
+        for (const auto& rect : fast)
+            updates.push_back({rect, EpdWaveform::fast, false});
+        for (const auto& rect : m_quality)
+            updates.push_back({rect, EpdWaveform::quality, false});
+        m_partials += count;
+    }
+
+    m_fast.clear();
+    m_quality.clear();
+
+    return updates;
+}
+
+/// Is a color channel close enough to black or white for the fast waveform.
+static inline int mono_level(uint32_t c)
+{
+    if (c < 0x20)
+        return 0;
+    if (c >= 0xe0)
+        return 1;
+    return -1;
+}
+
+bool EpdRefresh::monochrome(cairo_surface_t* surface, const Rect& rect)
+{
+    const auto format = cairo_image_surface_get_format(surface);
+    const auto r = Rect::intersection(rect, Rect(0, 0,
+                                      cairo_image_surface_get_width(surface),
+                                      cairo_image_surface_get_height(surface)));
+    if (r.empty())
+        return true;
+
+    cairo_surface_flush(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    const auto stride = cairo_image_surface_get_stride(surface);
+    if (!data)
+        return false;
+
+    for (auto y = r.y(); y < r.y() + r.height(); ++y)
+    {
+        const auto row = data + static_cast<size_t>(y) * stride;
+        for (auto x = r.x(); x < r.x() + r.width(); ++x)
+        {
+            uint32_t red;
+            uint32_t green;
+            uint32_t blue;
+            if (format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24)
+            {
+                const auto pixel = reinterpret_cast<const uint32_t*>(row)[x];
+                red = (pixel >> 16) & 0xff;
+                green = (pixel >> 8) & 0xff;
+                blue = pixel & 0xff;
+            }
+            else if (format == CAIRO_FORMAT_RGB16_565)
+            {
+                const auto pixel = reinterpret_cast<const uint16_t*>(row)[x];
+                red = (pixel >> 8) & 0xf8;
+                green = (pixel >> 3) & 0xfc;
+                blue = (pixel << 3) & 0xf8;
+                // so white still reaches the top of the range
+                red |= red >> 5;
+                green |= green >> 6;
+                blue |= blue >> 5;
+            }
+            else
+            {
+                return false;
+            }
+
+            const auto level = mono_level(red);
+            if (level < 0 || mono_level(green) != level || mono_level(blue) != level)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+EpdScreen::EpdScreen(Application& app, const std::string& device)
+    : m_refresh(Size()),
+      m_timer(app.event().io())
+{
+#ifdef EGT_HAVE_LINUX_FB
+    detail::info("EPD Screen");
+
+    m_fd = ::open(device.c_str(), O_RDWR | O_CLOEXEC);
+    if (m_fd < 0)
+        throw std::runtime_error("could not open " + device + ": " + strerror(errno));
+
+    struct fb_var_screeninfo var{};
+    struct fb_fix_screeninfo fix{};
+    if (::ioctl(m_fd, FBIOGET_VSCREENINFO, &var) < 0 ||
+        ::ioctl(m_fd, FBIOGET_FSCREENINFO, &fix) < 0)
+    {
+        ::close(m_fd);
+        throw std::runtime_error("could not get screen info of " + device);
+    }
+
+    PixelFormat format;
+    switch (var.bits_per_pixel)
+    {
+    case 8:
+        format = PixelFormat::l8;
+        break;
+    case 16:
+        format = PixelFormat::rgb565;
+        break;
+    case 32:
+        format = PixelFormat::xrgb8888;
+        break;
+    default:
+        ::close(m_fd);
+        throw std::runtime_error("unsupported EPD bits per pixel: " +
+                                 std::to_string(var.bits_per_pixel));
+    }
+
+    const Size size(var.xres, var.yres);
+    const auto bytes = var.bits_per_pixel / 8;
+    if (fix.line_length != size.width() * bytes)
+    {
+        ::close(m_fd);
+        throw std::runtime_error("unsupported EPD line length: " +
+                                 std::to_string(fix.line_length));
+    }
+
+    m_fb_size = fix.smem_len;
+    m_fb = ::mmap(nullptr, m_fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_fb == MAP_FAILED)
+    {
+        m_fb = nullptr;
+        ::close(m_fd);
+        throw std::runtime_error("could not map " + device);
+    }
+
+    detail::info("fb size {} {}bpp", size, var.bits_per_pixel);
+
+    EpdRefresh::Config config;
+
+    const auto window = std::getenv("EGT_EPD_WINDOW");
+    if (window && strlen(window))
+        config.window = std::chrono::milliseconds(std::strtoul(window, nullptr, 10));
+
+    const auto full = std::getenv("EGT_EPD_FULL_REFRESH");
+    if (full && strlen(full))
+        config.full_interval = std::strtoul(full, nullptr, 10);
+
+    const auto waveforms = std::getenv("EGT_EPD_WAVEFORMS");
+    if (waveforms && strlen(waveforms))
+    {
+        std::vector<std::string> modes;
+        detail::tokenize(waveforms, ',', modes);
+        if (modes.size() == 2)
+        {
+            m_waveforms[0] = std::stoul(modes[0]);
+            m_waveforms[1] = std::stoul(modes[1]);
+        }
+        else
+        {
+            detail::warn("invalid EGT_EPD_WAVEFORMS: {}", waveforms);
+        }
+    }
+
+    m_refresh = EpdRefresh(size, config);
+
+    init(&m_fb, 1, size, format);
+#else
+    detail::ignoreparam(device);
+    throw std::runtime_error("EPD screen needs the Linux framebuffer");
+#endif
+}
+
+void EpdScreen::flip(const DamageArray& damage)
+{
+    if (damage.empty())
+        return;
+
+    // classified before the copy, while the surface holds the frame
+    for (const auto& rect : damage)
+        m_refresh.add(rect, EpdRefresh::monochrome(m_surface.get(), rect));
+
+    Screen::flip(damage);
+
+    if (m_waiting)
+        return;
+
+    m_waiting = true;
+    m_timer.expires_after(m_refresh.config().window);
+    m_timer.async_wait([this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        m_waiting = false;
+        refresh();
+    });
+}
+
+void EpdScreen::refresh()
+{
+    for (const auto& update : m_refresh.take())
+        send(update);
+}
+
+void EpdScreen::send(const EpdUpdate& update)
+{
+#ifdef EGT_HAVE_LINUX_FB
+    const auto rect = buffer_rect(update.rect);
+
+    struct mxcfb_update_data data{};
+    data.update_region.left = rect.x();
+    data.update_region.top = rect.y();
+    data.update_region.width = rect.width();
+    data.update_region.height = rect.height();
+    data.waveform_mode = m_waveforms[update.waveform == EpdWaveform::fast ? 0 : 1];
+    data.update_mode = update.full ? UPDATE_MODE_FULL : UPDATE_MODE_PARTIAL;
+    data.update_marker = ++m_marker;
+    data.temp = TEMP_USE_AMBIENT;
+
+    if (::ioctl(m_fd, MXCFB_SEND_UPDATE, &data) < 0)
+        detail::warn("EPD update of {} failed: {}", rect, strerror(errno));
+#else
+    detail::ignoreparam(update);
+#endif
+}
+
+EpdScreen::~EpdScreen() noexcept
+{
+    m_timer.cancel();
+
+    if (m_fd >= 0)
+    {
+        // what is still coalesced would never reach the display
+        refresh();
+
+        if (m_fb)
+            ::munmap(m_fb, m_fb_size);
+        ::close(m_fd);
+    }
+}
+
+}
+}
+}
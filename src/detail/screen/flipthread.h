@@ -4,13 +4,23 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/egtlog.h"
+#include "egt/app.h"
 #include "egt/detail/meta.h"
+#include "egt/eventloop.h"
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
-#include <deque>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <functional>
 #include <memory>
-#include <mutex>
+#include <planes/plane.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
 #include <thread>
+#include <unistd.h>
+#include <vector>
 
 namespace egt
 {
@@ -19,73 +29,234 @@ inline namespace v1
 namespace detail
 {
 
+/**
+ * A single flip of a plane to one of its buffers.
+ */
+struct FlipJob
+{
+    FlipJob() noexcept = default;
+
+    constexpr explicit FlipJob(plane_data* plane,
+                               uint32_t index,
+                               bool async = false) noexcept
+        : m_plane(plane), m_index(index), m_async(async)
+    {}
+
+    void operator()() const
+    {
+        if (m_async)
+            plane_flip_async(m_plane, m_index);
+        else
+            plane_flip(m_plane, m_index);
+    }
+
+    plane_data* m_plane {nullptr};
+    uint32_t m_index{};
+    bool m_async{false};
+};
+
 /**
  * Flip thread queue.
  *
  * This creates a flip queue used for queuing up flip calls when using more
  * than one buffer.
+ *
+ * Jobs are stored in a fixed size single producer, single consumer ring, so
+ * queuing a flip from the event loop never allocates or takes a lock.  The
+ * threads wake each other up with eventfds.
+ *
+ * When an io_context is provided, the time each flip completed is sent back
+ * to the event loop and handed to the completion callback.  If several flips
+ * complete before the event loop gets to run, only the last one is reported.
  */
 struct FlipThread : private NonCopyable<FlipThread>
 {
-    explicit FlipThread(uint32_t max_queue = 0)
-        : m_max_queue(max_queue)
+    using Clock = std::chrono::steady_clock;
+    using CompletionCallback = std::function<void(Clock::time_point)>;
+
+    /**
+     * @param max_queue Number of flips that can be queued before enqueue()
+     *        blocks.  The ring has a fixed size, so unlike a queue there is no
+     *        unlimited setting and this must be at least one.
+     * @param io Event loop the completion callback is invoked from.
+     * @param callback Invoked with the time a flip completed.
+     *
+     * @throws std::runtime_error if max_queue is zero.
+     */
+    explicit FlipThread(uint32_t max_queue = 1,
+                        asio::io_context* io = nullptr,
+                        CompletionCallback callback = nullptr)
+        : m_jobs(ring_size(max_queue)),
+          m_wake(eventfd(0, EFD_CLOEXEC)),
+          m_space(eventfd(0, EFD_CLOEXEC)),
+          m_callback(std::move(callback))
     {
+        if (m_wake < 0 || m_space < 0)
+            throw std::runtime_error("unable to create flip thread eventfd");
+
+        if (io && m_callback)
+        {
+            const auto fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (fd < 0)
+                throw std::runtime_error("unable to create flip thread eventfd");
+
+            m_done = std::make_unique<asio::posix::stream_descriptor>(*io, fd);
+            m_done_fd = fd;
+            read_done();
+        }
+
         m_thread = std::thread(&FlipThread::run, this);
     }
 
     void run()
     {
-        std::function<void()> task;
         while (true)
         {
-            std::unique_lock<std::mutex> lock(m_mutex);
+            FlipJob job;
+            while (!m_stop && dequeue(job))
+            {
+                job();
 
-            while (!m_stop && m_queue.empty())
-                m_condition.wait(lock);
+                m_completed.store(Clock::now().time_since_epoch().count(),
+                                  std::memory_order_release);
+                if (m_done_fd >= 0)
+                    signal(m_done_fd);
+            }
 
             if (m_stop)
                 return;
 
-            task = m_queue.front();
-            m_queue.pop_front();
-            m_condition.notify_one();
-            lock.unlock();
-
-            task();
+            wait(m_wake);
         }
     }
 
-    void enqueue(std::function<void()> job)
+    void enqueue(const FlipJob& job)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
+        const auto head = m_head.load(std::memory_order_relaxed);
+        const auto next = (head + 1) % m_jobs.size();
 
-        while (m_max_queue && m_queue.size() >= m_max_queue)
+        while (next == m_tail.load(std::memory_order_acquire))
         {
             EGTLOG_DEBUG("flip thread blocked");
-            m_condition.wait(lock);
+
+            // check again after announcing we are blocked to not miss a wakeup
+            m_blocked.store(true);
+            if (next == m_tail.load())
+                wait(m_space);
+            m_blocked.store(false);
         }
 
-        m_queue.emplace_back(std::move(job));
-        m_condition.notify_one();
+        m_jobs[head] = job;
+        m_head.store(next, std::memory_order_release);
+        signal(m_wake);
+    }
+
+    /// Returns true if enqueue() would block until a flip completed.
+    bool full() const
+    {
+        const auto next = (m_head.load(std::memory_order_relaxed) + 1) % m_jobs.size();
+        return next == m_tail.load(std::memory_order_acquire);
     }
 
     ~FlipThread()
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
         m_stop = true;
-        m_condition.notify_all();
-        lock.unlock();
+        signal(m_wake);
         m_thread.join();
+
+        // closes m_done_fd
+        m_done.reset();
+        ::close(m_space);
+        ::close(m_wake);
     }
 
-    std::thread m_thread;
-    std::deque<std::function<void()>> m_queue;
-    std::mutex m_mutex;
-    std::condition_variable m_condition;
+protected:
+
+    bool dequeue(FlipJob& job)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+
+        job = m_jobs[tail];
+        m_tail.store((tail + 1) % m_jobs.size());
+
+        if (m_blocked.load())
+            signal(m_space);
+
+        return true;
+    }
+
+    void read_done()
+    {
+        m_done->async_read_some(asio::buffer(&m_done_count, sizeof(m_done_count)),
+                                [this](const asio::error_code & error, std::size_t)
+        {
+            if (error)
+                return;
+
+            m_callback(Clock::time_point(Clock::duration(
+                                             m_completed.load(std::memory_order_acquire))));
+            read_done();
+        });
+    }
+
+    static void signal(int fd)
+    {
+        const uint64_t value = 1;
+        while (::write(fd, &value, sizeof(value)) < 0 && errno == EINTR)
+        {}
+    }
+
+    static void wait(int fd)
+    {
+        uint64_t value;
+        while (::read(fd, &value, sizeof(value)) < 0 && errno == EINTR)
+        {}
+    }
+
+    /// Size of the ring holding max_queue jobs.
+    static size_t ring_size(uint32_t max_queue)
+    {
+        if (!max_queue)
+            throw std::runtime_error("flip thread queue size must be at least one");
+        return size_t(max_queue) + 1;
+    }
+
+    /// Ring of jobs, one slot is always left empty.
+    std::vector<FlipJob> m_jobs;
+    /// Next slot written by the producer.
+    std::atomic<size_t> m_head{0};
+    /// Next slot read by the consumer.
+    std::atomic<size_t> m_tail{0};
+    /// Set while the producer waits for a free slot.
+    std::atomic<bool> m_blocked{false};
+    /// Wakes up the flip thread.
+    int m_wake{-1};
+    /// Wakes up the producer when a slot was freed.
+    int m_space{-1};
+    /// Time of the last completed flip, in Clock ticks.
+    std::atomic<Clock::rep> m_completed{0};
+    /// Signals the event loop that a flip completed.
+    std::unique_ptr<asio::posix::stream_descriptor> m_done;
+    int m_done_fd{-1};
+    uint64_t m_done_count{0};
+    CompletionCallback m_callback;
     std::atomic<bool> m_stop{false};
-    uint32_t m_max_queue{0};
+    std::thread m_thread;
 };
 
+/**
+ * Get the io_context flip completions are delivered to, if there is an
+ * Application instance.
+ */
+inline asio::io_context* flip_io()
+{
+    if (Application::check_instance())
+        return &Application::instance().event().io();
+    return nullptr;
+}
+
 }
 }
 }
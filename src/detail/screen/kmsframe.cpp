@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/screen/kmsframe.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <planes/kms.h>
+#include <planes/plane.h>
+#include <poll.h>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Longest wait for the previous commit, in milliseconds.
+static constexpr int FENCE_TIMEOUT = 1000;
+
+/// Get the part of the buffer of a plane shown.
+static Rect source(plane_data* plane, const Size& pan_size, const Point& pan_pos)
+{
+    if (pan_size.empty())
+        return Rect(0, 0, plane_width(plane), plane_height(plane));
+    return Rect(pan_pos, pan_size);
+}
+
+/// Get the id of a property of a DRM object, or 0.
+static uint32_t property_id(int fd, uint32_t object, uint32_t type, const char* name)
+{
+    auto props = drmModeObjectGetProperties(fd, object, type);
+    if (!props)
+        return 0;
+
+    uint32_t id = 0;
+    for (uint32_t i = 0; i < props->count_props && !id; i++)
+    {
+        auto prop = drmModeGetProperty(fd, props->props[i]);
+        if (!prop)
+            continue;
+
+        if (!strcmp(prop->name, name))
+            id = prop->prop_id;
+
+        drmModeFreeProperty(prop);
+    }
+
+    drmModeFreeObjectProperties(props);
+    return id;
+}
+
+std::unique_ptr<KMSFrame> KMSFrame::create(int fd, asio::io_context* io)
+{
+    const auto value = getenv("EGT_KMS_ATOMIC");
+    if (value && !strcmp(value, "0"))
+        return nullptr;
+
+    if (drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1))
+    {
+        EGTLOG_DEBUG("no atomic commits: {}", strerror(errno));
+        return nullptr;
+    }
+
+    EGTLOG_DEBUG("planes changed by one atomic commit per frame");
+    return std::make_unique<KMSFrame>(fd, io);
+}
+
+KMSFrame::KMSFrame(int fd, asio::io_context* io)
+    : m_fd(fd),
+      m_io(io)
+{}
+
+void KMSFrame::attach(plane_data* plane, uint32_t crtc, bool visible,
+                      CompletionCallback callback)
+{
+    static const char* names[property_count] =
+    {
+        "FB_ID", "CRTC_ID",
+        "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+        "SRC_X", "SRC_Y", "SRC_W", "SRC_H",
+    };
+
+    auto& state = m_planes[plane];
+    state.crtc = crtc;
+    state.callback = std::move(callback);
+    for (size_t i = 0; i < state.properties.size(); ++i)
+    {
+        state.properties[i] = property_id(m_fd, plane->plane->id,
+                                          DRM_MODE_OBJECT_PLANE, names[i]);
+        if (!state.properties[i])
+            detail::warn("plane {} has no {} property", plane->plane->id, names[i]);
+    }
+
+    state.fb = plane->fbs[plane->front_buf]->id;
+    state.visible = visible;
+}
+
+void KMSFrame::detach(plane_data* plane)
+{
+    m_planes.erase(plane);
+
+    for (auto& fence : m_fences)
+    {
+        fence->planes.erase(std::remove(fence->planes.begin(), fence->planes.end(), plane),
+                            fence->planes.end());
+    }
+}
+
+KMSFrame::Plane* KMSFrame::find(plane_data* plane)
+{
+    auto i = m_planes.find(plane);
+    if (i == m_planes.end())
+        return nullptr;
+    return &i->second;
+}
+
+void KMSFrame::framebuffer(plane_data* plane, uint32_t fb)
+{
+    if (auto state = find(plane))
+    {
+        state->fb = fb;
+        state->dirty = state->flipped = true;
+    }
+}
+
+void KMSFrame::position(plane_data* plane, const DisplayPoint& point)
+{
+    if (auto state = find(plane))
+    {
+        if (state->position != point)
+        {
+            state->position = point;
+            state->dirty = true;
+        }
+    }
+}
+
+void KMSFrame::scale(plane_data* plane, float hscale, float vscale)
+{
+    if (auto state = find(plane))
+    {
+        if (!detail::float_equal(state->hscale, hscale) ||
+            !detail::float_equal(state->vscale, vscale))
+        {
+            state->hscale = hscale;
+            state->vscale = vscale;
+            state->dirty = true;
+        }
+    }
+}
+
+void KMSFrame::pan_size(plane_data* plane, const Size& size)
+{
+    if (auto state = find(plane))
+    {
+        state->pan_size = size;
+        state->dirty = true;
+    }
+}
+
+void KMSFrame::pan_pos(plane_data* plane, const Point& point)
+{
+    if (auto state = find(plane))
+    {
+        state->pan_pos = point;
+        state->dirty = true;
+    }
+}
+
+void KMSFrame::show(plane_data* plane)
+{
+    if (auto state = find(plane))
+    {
+        // apply the plane even if it's shown, like plane_apply()
+        state->visible = true;
+        state->dirty = true;
+    }
+}
+
+void KMSFrame::hide(plane_data* plane)
+{
+    if (auto state = find(plane))
+    {
+        if (state->visible)
+        {
+            state->visible = false;
+            state->dirty = true;
+        }
+    }
+}
+
+uint32_t KMSFrame::out_fence_property(uint32_t crtc)
+{
+    auto i = m_out_fence_properties.find(crtc);
+    if (i == m_out_fence_properties.end())
+    {
+        const auto id = property_id(m_fd, crtc, DRM_MODE_OBJECT_CRTC, "OUT_FENCE_PTR");
+        if (!id)
+            EGTLOG_DEBUG("crtc {} has no out-fences", crtc);
+        i = m_out_fence_properties.emplace(crtc, id).first;
+    }
+    return i->second;
+}
+
+bool KMSFrame::ready() const
+{
+    for (const auto& fence : m_fences)
+    {
+        if (fence->signaled)
+            continue;
+
+        pollfd fd{fence->fd, POLLIN, 0};
+        if (::poll(&fd, 1, 0) <= 0)
+            return false;
+    }
+
+    return true;
+}
+
+void KMSFrame::retire(bool wait)
+{
+    const auto now = Clock::now();
+
+    auto i = m_fences.begin();
+    while (i != m_fences.end())
+    {
+        auto& fence = **i;
+        if (!fence.signaled)
+        {
+            pollfd fd{fence.fd, POLLIN, 0};
+            int ret;
+            while ((ret = ::poll(&fd, 1, wait ? FENCE_TIMEOUT : 0)) < 0 && errno == EINTR)
+            {}
+
+            if (ret == 0 && wait)
+                detail::warn("timed out waiting for the previous frame");
+            fence.signaled = ret != 0;
+        }
+
+        if (!fence.signaled && !wait)
+        {
+            ++i;
+            continue;
+        }
+
+        for (auto plane : fence.planes)
+        {
+            auto state = find(plane);
+            if (state && state->callback)
+                state->callback(now);
+        }
+
+        // closing the fence cancels the wait of the event loop, if any
+        i = m_fences.erase(i);
+    }
+}
+
+KMSFrame::Fence::~Fence() noexcept
+{
+    if (!waiter && fd >= 0)
+        ::close(fd);
+}
+
+void KMSFrame::wait_async(Fence& fence)
+{
+    fence.waiter = std::make_unique<asio::posix::stream_descriptor>(*m_io, fence.fd);
+    fence.waiter->async_wait(asio::posix::stream_descriptor::wait_read,
+                             [this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        retire(false);
+    });
+}
+
+void KMSFrame::apply_legacy(plane_data* plane, const Plane& state)
+{
+    int ret;
+    if (state.visible)
+    {
+        const auto src = source(plane, state.pan_size, state.pan_pos);
+
+        ret = drmModeSetPlane(m_fd, plane->plane->id, state.crtc, state.fb, 0,
+                              state.position.x(), state.position.y(),
+                              src.width() * state.hscale, src.height() * state.vscale,
+                              src.x() << 16u, src.y() << 16u,
+                              src.width() << 16u, src.height() << 16u);
+    }
+    else
+    {
+        ret = drmModeSetPlane(m_fd, plane->plane->id, 0, 0, 0,
+                              0, 0, 0, 0, 0, 0, 0, 0);
+    }
+
+    if (ret)
+        detail::warn("unable to apply plane {}: {}", plane->plane->id, strerror(errno));
+}
+
+void KMSFrame::commit()
+{
+    if (std::none_of(m_planes.begin(), m_planes.end(),
+                     [](const std::pair<plane_data* const, Plane>& p) { return p.second.dirty; }))
+        return;
+
+    // a non-blocking commit fails while the previous one is pending
+    retire(true);
+
+    std::unique_ptr<drmModeAtomicReq, decltype(&drmModeAtomicFree)>
+    request(drmModeAtomicAlloc(), drmModeAtomicFree);
+    if (!request)
+        return;
+
+    // one out-fence per CRTC of a flipped plane, written by the commit
+    std::vector<uint32_t> crtcs;
+    for (const auto& p : m_planes)
+    {
+        if (p.second.dirty && p.second.flipped &&
+            std::find(crtcs.begin(), crtcs.end(), p.second.crtc) == crtcs.end())
+            crtcs.push_back(p.second.crtc);
+    }
+    std::vector<int32_t> fences(crtcs.size(), -1);
+
+    bool complete = true;
+    const auto add = [&](uint32_t object, uint32_t property, uint64_t value)
+    {
+        if (!property || drmModeAtomicAddProperty(request.get(), object, property, value) < 0)
+            complete = false;
+    };
+
+    for (const auto& p : m_planes)
+    {
+        const auto& state = p.second;
+        if (!state.dirty)
+            continue;
+
+        const auto id = p.first->plane->id;
+        const auto& prop = state.properties;
+        if (state.visible)
+        {
+            const auto src = source(p.first, state.pan_size, state.pan_pos);
+
+            add(id, prop[fb_id], state.fb);
+            add(id, prop[crtc_id], state.crtc);
+            add(id, prop[crtc_x], static_cast<uint64_t>(static_cast<int64_t>(state.position.x())));
+            add(id, prop[crtc_y], static_cast<uint64_t>(static_cast<int64_t>(state.position.y())));
+            add(id, prop[crtc_w], static_cast<uint64_t>(src.width() * state.hscale));
+            add(id, prop[crtc_h], static_cast<uint64_t>(src.height() * state.vscale));
+            add(id, prop[src_x], static_cast<uint64_t>(src.x()) << 16u);
+            add(id, prop[src_y], static_cast<uint64_t>(src.y()) << 16u);
+            add(id, prop[src_w], static_cast<uint64_t>(src.width()) << 16u);
+            add(id, prop[src_h], static_cast<uint64_t>(src.height()) << 16u);
+        }
+        else
+        {
+            add(id, prop[fb_id], 0);
+            add(id, prop[crtc_id], 0);
+        }
+    }
+
+    for (size_t i = 0; i < crtcs.size(); ++i)
+    {
+        const auto property = out_fence_property(crtcs[i]);
+        if (property)
+            add(crtcs[i], property, reinterpret_cast<uintptr_t>(&fences[i]));
+    }
+
+    if (!complete ||
+        drmModeAtomicCommit(m_fd, request.get(), DRM_MODE_ATOMIC_NONBLOCK, nullptr))
+    {
+        detail::warn("atomic commit failed, applying planes one by one: {}",
+                     complete ? strerror(errno) : "missing property");
+
+        for (const auto& p : m_planes)
+        {
+            if (p.second.dirty)
+                apply_legacy(p.first, p.second);
+        }
+
+        // the flips are done, as far as anyone can tell
+        fences.assign(fences.size(), -1);
+    }
+
+    const auto now = Clock::now();
+    for (size_t i = 0; i < crtcs.size(); ++i)
+    {
+        std::vector<plane_data*> planes;
+        for (const auto& p : m_planes)
+        {
+            if (p.second.dirty && p.second.flipped && p.second.crtc == crtcs[i])
+                planes.push_back(p.first);
+        }
+
+        // without a fence, report the flip now
+        if (fences[i] < 0)
+        {
+            for (auto plane : planes)
+            {
+                auto state = find(plane);
+                if (state->callback)
+                    state->callback(now);
+            }
+            continue;
+        }
+
+        auto fence = std::make_unique<Fence>(fences[i]);
+        fence->planes = std::move(planes);
+        // otherwise, the flip is reported when the next commit waits for it
+        if (m_io)
+            wait_async(*fence);
+        m_fences.push_back(std::move(fence));
+    }
+
+    for (auto& p : m_planes)
+        p.second.dirty = p.second.flipped = false;
+}
+
+KMSFrame::~KMSFrame() noexcept = default;
+
+}
+}
+}
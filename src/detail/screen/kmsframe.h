@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_SCREEN_KMSFRAME_H
+#define EGT_SRC_DETAIL_SCREEN_KMSFRAME_H
+
+#include "egt/detail/meta.h"
+#include "egt/geometry.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+struct plane_data;
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Builder of the atomic commit of a frame.
+ *
+ * Instead of each plane being flipped, moved, scaled, shown or hidden with
+ * its own call to the driver, the changes made while the event loop draws a
+ * frame are recorded here and submitted by commit() in a single non-blocking
+ * atomic commit.  All planes change on the same vertical blank, and the
+ * event loop never waits on the driver, except when the previous commit is
+ * still pending, like a full flip queue.
+ *
+ * The commit asks for an out-fence per CRTC, signaled when the frame is
+ * scanned out, which is when the planes flipped in it are told their flip
+ * completed.
+ *
+ * Only created when the driver supports atomic commits.
+ */
+class KMSFrame : private NonCopyable<KMSFrame>
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+    using CompletionCallback = std::function<void(Clock::time_point)>;
+
+    /**
+     * Create the frame builder of a DRM device.
+     *
+     * @param fd DRM file descriptor.
+     * @param io Where flip completions are delivered to, if not null.
+     * @return nullptr if the driver does not support atomic commits, or the
+     *         EGT_KMS_ATOMIC environment variable disables them.
+     */
+    static std::unique_ptr<KMSFrame> create(int fd, asio::io_context* io);
+
+    KMSFrame(int fd, asio::io_context* io);
+
+    /**
+     * Start recording the changes of a plane.
+     *
+     * @param plane The plane.
+     * @param crtc Id of the CRTC the plane is shown on.
+     * @param visible Is the plane already shown.
+     * @param callback Called when a frame flipping the plane was scanned out.
+     */
+    void attach(plane_data* plane, uint32_t crtc, bool visible,
+                CompletionCallback callback = nullptr);
+
+    /// Stop recording the changes of a plane, before it is freed.
+    void detach(plane_data* plane);
+
+    /// Set the framebuffer shown by a plane, by id.
+    void framebuffer(plane_data* plane, uint32_t fb);
+
+    /// Set the position of a plane on the CRTC.
+    void position(plane_data* plane, const DisplayPoint& point);
+
+    /// Set the scale of a plane.
+    void scale(plane_data* plane, float hscale, float vscale);
+
+    /// Set the size of the part of its buffer a plane shows, empty for all of it.
+    void pan_size(plane_data* plane, const Size& size);
+
+    /// Set the position of the part of its buffer a plane shows.
+    void pan_pos(plane_data* plane, const Point& point);
+
+    /// Show a plane.
+    void show(plane_data* plane);
+
+    /// Hide a plane.
+    void hide(plane_data* plane);
+
+    /// Returns true if a commit would not have to wait for the previous one.
+    EGT_NODISCARD bool ready() const;
+
+    /**
+     * Submit the changes recorded since the last commit, if any.
+     *
+     * Waits for the previous commit to complete first, if it didn't.
+     */
+    void commit();
+
+    ~KMSFrame() noexcept;
+
+private:
+
+    /// Properties of a plane set by a commit, in the order they are looked up.
+    enum Property
+    {
+        fb_id,
+        crtc_id,
+        crtc_x,
+        crtc_y,
+        crtc_w,
+        crtc_h,
+        src_x,
+        src_y,
+        src_w,
+        src_h,
+        property_count
+    };
+
+    /// State of a plane, as of the next commit.
+    struct Plane
+    {
+        uint32_t crtc{0};
+        CompletionCallback callback;
+        std::array<uint32_t, property_count> properties{};
+        uint32_t fb{0};
+        DisplayPoint position;
+        float hscale{1.f};
+        float vscale{1.f};
+        Size pan_size;
+        Point pan_pos;
+        bool visible{false};
+        /// Changed since the last commit.
+        bool dirty{false};
+        /// Flipped since the last commit.
+        bool flipped{false};
+    };
+
+    /// Out-fence of a CRTC of a commit, and the planes it flipped.
+    struct Fence : private NonCopyable<Fence>
+    {
+        explicit Fence(int f) noexcept
+            : fd(f)
+        {}
+
+        ~Fence() noexcept;
+
+        int fd{-1};
+        /// Owns fd, when the event loop waits for it.
+        std::unique_ptr<asio::posix::stream_descriptor> waiter;
+        std::vector<plane_data*> planes;
+        bool signaled{false};
+    };
+
+    Plane* find(plane_data* plane);
+
+    /// Get the id of the OUT_FENCE_PTR property of a CRTC, or 0.
+    uint32_t out_fence_property(uint32_t crtc);
+
+    /// Apply a plane with the legacy API, if the atomic commit failed.
+    void apply_legacy(plane_data* plane, const Plane& state);
+
+    /**
+     * Report the fences signaled and forget them.
+     *
+     * @param wait Wait for the fences not signaled yet.
+     */
+    void retire(bool wait);
+
+    /// Wait for a fence to be signaled, in the event loop.
+    void wait_async(Fence& fence);
+
+    int m_fd{-1};
+    asio::io_context* m_io{nullptr};
+    std::map<plane_data*, Plane> m_planes;
+    std::map<uint32_t, uint32_t> m_out_fence_properties;
+    std::vector<std::unique_ptr<Fence>> m_fences;
+};
+
+}
+}
+}
+
+#endif
@@ -3,12 +3,19 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/egtlog.h"
 #include "detail/screen/flipthread.h"
+#include "detail/screen/kmsframe.h"
 #include "egt/detail/screen/kmsoverlay.h"
 #include "egt/detail/screen/kmsscreen.h"
+#include <cerrno>
+#include <cstring>
 #include <planes/fb.h>
 #include <planes/kms.h>
 #include <planes/plane.h>
+#include <sys/stat.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
 
 namespace egt
 {
@@ -17,25 +24,6 @@ inline namespace v1
 namespace detail
 {
 
-struct FlipJob
-{
-    constexpr explicit FlipJob(plane_data* plane, uint32_t index, bool async = false) noexcept
-        : m_plane(plane), m_index(index), m_async(async)
-    {}
-
-    void operator()()
-    {
-        if (m_async)
-            plane_flip_async(m_plane, m_index);
-        else
-            plane_flip(m_plane, m_index);
-    }
-
-    plane_data* m_plane {nullptr};
-    uint32_t m_index{};
-    bool m_async{false};
-};
-
 KMSOverlay::KMSOverlay(const Size& size, PixelFormat format, WindowHint hint)
     : m_plane(KMSScreen::instance()->allocate_overlay(size, format, hint))
 {
@@ -46,11 +34,37 @@ KMSOverlay::KMSOverlay(const Size& size, PixelFormat format, WindowHint hint)
          Size(plane_width(m_plane.get()), plane_height(m_plane.get())),
          detail::egt_format(plane_format(m_plane.get())));
 
-    m_pool = std::make_unique<FlipThread>(m_plane->buffer_count - 1);
+    // a flip can be queued for every buffer but the one shown; a single
+    // buffer is never flipped
+    const auto max_queue = std::max<uint32_t>(m_plane->buffer_count, 2) - 1;
+    m_pool = std::make_unique<FlipThread>(max_queue, flip_io(),
+                 [this](FlipThread::Clock::time_point when)
+        {
+            flip_completed(when);
+        });
+
+    auto screen = KMSScreen::instance();
+    if (auto f = screen->frame())
+    {
+        f->attach(m_plane.get(), screen->m_device->crtcs[0]->id, false,
+                  [this](KMSFrame::Clock::time_point when)
+        {
+            flip_completed(when);
+        });
+    }
+}
+
+KMSFrame* KMSOverlay::frame() const
+{
+    auto screen = KMSScreen::instance();
+    return screen ? screen->frame() : nullptr;
 }
 
 void KMSOverlay::resize(const Size& size)
 {
+    // imported buffers have the size of the plane
+    release_dmabufs();
+
     auto ret = plane_fb_reallocate(m_plane.get(),
                                    size.width(), size.height(), plane_format(m_plane.get()));
     assert(!ret);
@@ -58,6 +72,9 @@ void KMSOverlay::resize(const Size& size)
     {
         plane_fb_map(m_plane.get());
 
+        if (auto f = frame())
+            f->framebuffer(m_plane.get(), m_plane->fbs[m_plane->front_buf]->id);
+
         init(m_plane->bufs, KMSScreen::max_buffers(),
              Size(plane_width(m_plane.get()), plane_height(m_plane.get())),
              detail::egt_format(plane_format(m_plane.get())));
@@ -66,12 +83,18 @@ void KMSOverlay::resize(const Size& size)
 
 void KMSOverlay::hide()
 {
-    plane_hide(m_plane.get());
+    if (auto f = frame())
+        f->hide(m_plane.get());
+    else
+        plane_hide(m_plane.get());
 }
 
 void KMSOverlay::show()
 {
-    plane_apply(m_plane.get());
+    if (auto f = frame())
+        f->show(m_plane.get());
+    else
+        plane_apply(m_plane.get());
 }
 
 void* KMSOverlay::raw()
@@ -83,7 +106,10 @@ void KMSOverlay::schedule_flip()
 {
     if (m_plane->buffer_count > 1)
     {
-        m_pool->enqueue(FlipJob(m_plane.get(), m_index, m_async));
+        if (auto f = frame())
+            f->framebuffer(m_plane.get(), m_plane->fbs[m_index]->id);
+        else
+            m_pool->enqueue(FlipJob(m_plane.get(), m_index, m_async));
 
         if (++m_index >= m_plane->buffer_count)
             m_index = 0;
@@ -95,6 +121,14 @@ uint32_t KMSOverlay::index()
     return m_index;
 }
 
+bool KMSOverlay::flip_ready() const
+{
+    if (auto f = frame())
+        return f->ready();
+
+    return !m_pool || !m_pool->full();
+}
+
 void KMSOverlay::position(const DisplayPoint& point)
 {
     /*
@@ -108,22 +142,35 @@ void KMSOverlay::position(const DisplayPoint& point)
     /// @todo implement fix to above problem
 
     plane_set_pos(m_plane.get(), point.x(), point.y());
+    m_position = point;
+
+    if (auto f = frame())
+        f->position(m_plane.get(), point);
 }
 
 void KMSOverlay::scale(float hscale, float vscale)
 {
     /// This is only supported on HEO planes.
     plane_set_scale_independent(m_plane.get(), hscale, vscale);
+
+    if (auto f = frame())
+        f->scale(m_plane.get(), hscale, vscale);
 }
 
 void KMSOverlay::pan_size(const Size& size)
 {
     plane_set_pan_size(m_plane.get(), size.width(), size.height());
+
+    if (auto f = frame())
+        f->pan_size(m_plane.get(), size);
 }
 
 void KMSOverlay::pan_pos(const Point& point)
 {
     plane_set_pan_pos(m_plane.get(), point.x(), point.y());
+
+    if (auto f = frame())
+        f->pan_pos(m_plane.get(), point);
 }
 
 float KMSOverlay::hscale() const
@@ -149,7 +196,10 @@ int KMSOverlay::gem()
 
 void KMSOverlay::apply()
 {
-    plane_apply(m_plane.get());
+    if (auto f = frame())
+        f->show(m_plane.get());
+    else
+        plane_apply(m_plane.get());
 }
 
 void KMSOverlay::rotate(uint32_t degrees)
@@ -157,6 +207,103 @@ void KMSOverlay::rotate(uint32_t degrees)
     plane_apply_rotate(m_plane.get(), degrees);
 }
 
+uint32_t KMSOverlay::import_dmabuf(int fd,
+                                   const std::array<uint32_t, 4>& pitches,
+                                   const std::array<uint32_t, 4>& offsets)
+{
+    // fds of a dmabuf differ, and are reused, but not its inode
+    struct stat st {};
+    if (fstat(fd, &st))
+        return 0;
+
+    const auto i = m_dmabufs.find(st.st_ino);
+    if (i != m_dmabufs.end())
+        return i->second.fb;
+
+    const auto drm = KMSScreen::instance()->m_fd;
+
+    Dmabuf dmabuf;
+    if (drmPrimeFDToHandle(drm, fd, &dmabuf.handle))
+    {
+        detail::warn("unable to import dmabuf: {}", strerror(errno));
+        return 0;
+    }
+
+    std::array<uint32_t, 4> handles{};
+    for (size_t plane = 0; plane < handles.size(); ++plane)
+    {
+        if (pitches[plane])
+            handles[plane] = dmabuf.handle;
+    }
+
+    if (drmModeAddFB2(drm, plane_width(m_plane.get()), plane_height(m_plane.get()),
+                      plane_format(m_plane.get()), handles.data(), pitches.data(),
+                      offsets.data(), &dmabuf.fb, 0))
+    {
+        detail::warn("unable to add dmabuf framebuffer: {}", strerror(errno));
+
+        drm_gem_close close{};
+        close.handle = dmabuf.handle;
+        drmIoctl(drm, DRM_IOCTL_GEM_CLOSE, &close);
+        return 0;
+    }
+
+    m_dmabufs[st.st_ino] = dmabuf;
+    return dmabuf.fb;
+}
+
+bool KMSOverlay::flip_framebuffer(uint32_t fb)
+{
+    if (auto f = frame())
+    {
+        f->framebuffer(m_plane.get(), fb);
+        f->show(m_plane.get());
+        return true;
+    }
+
+    auto screen = KMSScreen::instance();
+    const auto width = plane_width(m_plane.get());
+    const auto height = plane_height(m_plane.get());
+
+    // the same geometry as the plane buffers, in 16.16 fixed point for the source
+    if (drmModeSetPlane(screen->m_fd, m_plane->plane->id, screen->m_device->crtcs[0]->id,
+                        fb, 0,
+                        m_position.x(), m_position.y(),
+                        width * hscale(), height * vscale(),
+                        0, 0, width << 16u, height << 16u))
+    {
+        detail::warn("unable to show dmabuf framebuffer: {}", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+void KMSOverlay::release_dmabufs()
+{
+    if (m_dmabufs.empty())
+        return;
+
+    const auto drm = KMSScreen::instance()->m_fd;
+    for (auto& dmabuf : m_dmabufs)
+    {
+        drmModeRmFB(drm, dmabuf.second.fb);
+
+        drm_gem_close close{};
+        close.handle = dmabuf.second.handle;
+        drmIoctl(drm, DRM_IOCTL_GEM_CLOSE, &close);
+    }
+    m_dmabufs.clear();
+}
+
+KMSOverlay::~KMSOverlay() noexcept
+{
+    if (auto f = frame())
+        f->detach(m_plane.get());
+
+    release_dmabufs();
+}
+
 }
 }
 }
@@ -9,22 +9,28 @@
 
 #include "detail/egtlog.h"
 #include "detail/screen/flipthread.h"
+#include "detail/screen/kmsframe.h"
+#include "egt/detail/pixelops.h"
 #include "egt/detail/screen/kmsscreen.h"
 #include "egt/eventloop.h"
 #include "egt/input.h"
 #include "egt/widget.h"
 #include "egt/window.h"
 #include <algorithm>
+#include <array>
 #include <cairo.h>
+#include <cerrno>
 #include <cstring>
 #include <drm_fourcc.h>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <planes/fb.h>
 #include <planes/kms.h>
 #include <planes/plane.h>
 #include <string>
 #include <xf86drm.h>
+#include <xf86drmMode.h>
 
 #if defined(HAVE_CAIRO_GFX2D)
 #include <cairo-gfx2d.h>
@@ -45,69 +51,142 @@ void plane_t_deleter::operator()(plane_data* plane)
     plane_free(plane);
 }
 
-struct FlipJob
+/// Screens of the outputs, in the order they were created.
+static std::vector<KMSScreen*> the_kms;
+
+/**
+ * The DRM device, opened once for the screens of all outputs.
+ *
+ * Only one file descriptor can be the DRM master, so the outputs can't each
+ * open the device.
+ */
+struct KMSDevice
 {
-    constexpr explicit FlipJob(struct plane_data* plane,
-                               uint32_t index,
-                               bool async = false) noexcept
-        : m_plane(plane), m_index(index), m_async(async)
-    {}
+    KMSDevice()
+    {
+        fd = drmOpen("atmel-hlcdc", nullptr);
+        if (fd < 0)
+            throw std::runtime_error("unable to open DRM driver");
+
+        device = kms_device_open(fd);
+        if (!device)
+        {
+            drmClose(fd);
+            throw std::runtime_error("unable to open KMS device");
+        }
+
+        frame = KMSFrame::create(fd, flip_io());
+    }
+
+    KMSDevice(const KMSDevice&) = delete;
+    KMSDevice& operator=(const KMSDevice&) = delete;
+    KMSDevice(KMSDevice&&) = delete;
+    KMSDevice& operator=(KMSDevice&&) = delete;
 
-    void operator()()
+    /// Get the device, opening it if no screen holds it.
+    static std::shared_ptr<KMSDevice> get()
     {
-        if (m_async)
-            plane_flip_async(m_plane, m_index);
-        else
-            plane_flip(m_plane, m_index);
+        static std::weak_ptr<KMSDevice> shared;
+        auto device = shared.lock();
+        if (!device)
+        {
+            device = std::make_shared<KMSDevice>();
+            shared = device;
+        }
+        return device;
     }
 
-    plane_data* m_plane {nullptr};
-    uint32_t m_index{};
-    bool m_async{false};
-};
+    ~KMSDevice() noexcept
+    {
+        frame.reset();
+        kms_device_close(device);
+        drmClose(fd);
+    }
 
-static KMSScreen* the_kms = nullptr;
+    int fd{-1};
+    struct kms_device* device {nullptr};
+    /// Null without atomic commits.
+    std::unique_ptr<KMSFrame> frame;
+};
 
 std::vector<planeid> KMSScreen::m_used;
 
 KMSScreen::KMSScreen(bool allocate_primary_plane,
-                     PixelFormat format)
+                     PixelFormat format,
+                     uint32_t output)
+    : m_output(output)
 {
-    detail::info("DRM/KMS Screen ({} buffers)", max_buffers());
+    detail::info("DRM/KMS Screen {} ({} buffers)", output, max_buffers());
 
 #if defined(HAVE_CAIRO_GFX2D)
     if (getenv("EGT_USE_GFX2D") && strlen(getenv("EGT_USE_GFX2D")))
         m_gfx2d = true;
 #endif
 
-    m_fd = drmOpen("atmel-hlcdc", nullptr);
-    if (m_fd < 0)
-        throw std::runtime_error("unable to open DRM driver");
+    if (instance(output))
+        throw std::runtime_error(fmt::format("output {} already has a screen", output));
 
-    m_device = kms_device_open(m_fd);
-    if (!m_device)
-        throw std::runtime_error("unable to open KMS device");
+    m_shared = KMSDevice::get();
+    m_fd = m_shared->fd;
+    m_device = m_shared->device;
+
+    if (output >= m_device->num_screens)
+        throw std::runtime_error(fmt::format("no output {}", output));
+
+    const auto& screen = *m_device->screens[output];
 
     if (allocate_primary_plane)
     {
+        const auto value = getenv("EGT_SCREEN_FORMAT");
+        if (value && strlen(value))
+            format = detail::enum_from_string<PixelFormat>(value);
+
+        // the 2D engine can't draw to 8 bits per pixel buffers
+        if (format == PixelFormat::l8 ||
+            format == PixelFormat::rgb332 ||
+            format == PixelFormat::c8)
+            m_gfx2d = false;
+
         const auto drmformat = detail::drm_format(format);
 
+        const auto degrees = screen_rotation();
+        const auto hardware = degrees && primary_rotation(degrees);
+        rotation(degrees, hardware);
+        if (degrees)
+        {
+            detail::info("screen rotated {} degrees by {}", degrees,
+                         hardware ? "the display controller" : "software");
+        }
+
+        // the display controller scans out the rotated buffers
+        auto width = screen.width;
+        auto height = screen.height;
+        if (hardware && degrees != 180)
+            std::swap(width, height);
+
+        // each display controller output is scanned out by a primary plane
         m_plane = unique_plane_t(plane_create_buffered(m_device,
                                  DRM_PLANE_TYPE_PRIMARY,
-                                 0,
-                                 m_device->screens[0]->width,
-                                 m_device->screens[0]->height,
+                                 output,
+                                 width,
+                                 height,
                                  drmformat,
                                  KMSScreen::max_buffers()));
         if (!m_plane)
             throw std::runtime_error("unable to create primary plane");
 
         plane_fb_map(m_plane.get());
-        plane_apply(m_plane.get());
+        if (hardware)
+            plane_apply_rotate(m_plane.get(), degrees);
+        else
+            plane_apply(m_plane.get());
 
         EGTLOG_DEBUG("primary plane dumb buffer {},{} {}", plane_width(m_plane.get()),
                      plane_height(m_plane.get()), format);
 
+        if (format == PixelFormat::c8)
+            load_palette();
+
         if (!m_gfx2d)
         {
             init(m_plane->bufs, KMSScreen::max_buffers(),
@@ -118,7 +197,10 @@ KMSScreen::KMSScreen(bool allocate_primary_plane,
         else
         {
             EGTLOG_DEBUG("use gfx2d surfaces");
-            m_size = Size(plane_width(m_plane.get()), plane_height(m_plane.get()));
+            const Size buffer_size(plane_width(m_plane.get()), plane_height(m_plane.get()));
+            m_size = buffer_size;
+            if (software_rotation() && degrees != 180)
+                m_size = Size(buffer_size.height(), buffer_size.width());
 
             cairo_format_t f = detail::cairo_format(format);
             if (f == CAIRO_FORMAT_INVALID)
@@ -132,7 +214,7 @@ KMSScreen::KMSScreen(bool allocate_primary_plane,
                     cairo_gfx2d_surface_create_from_name(
                         m_plane->gem_names[x],
                         f,
-                        m_size.width(), m_size.height()));
+                        buffer_size.width(), buffer_size.height()));
 
                 m_buffers.back().damage.emplace_back(Point(), m_size);
             }
@@ -147,16 +229,115 @@ KMSScreen::KMSScreen(bool allocate_primary_plane,
         }
 #endif
 
-        m_pool = std::make_unique<FlipThread>(m_plane->buffer_count - 1);
+        // a flip can be queued for every buffer but the one shown; a single
+        // buffer is never flipped
+        const auto max_queue = std::max<uint32_t>(m_plane->buffer_count, 2) - 1;
+        m_pool = std::make_unique<FlipThread>(max_queue, flip_io(),
+                 [this](FlipThread::Clock::time_point when)
+        {
+            flip_completed(when);
+        });
+
+        if (auto f = frame())
+        {
+            f->attach(m_plane.get(), m_device->crtcs[output]->id, true,
+                      [this](KMSFrame::Clock::time_point when)
+            {
+                flip_completed(when);
+            });
+        }
+
+        if (getenv("EGT_KMS_ZERO_COPY") && strlen(getenv("EGT_KMS_ZERO_COPY")))
+        {
+            if (zero_copy(true))
+                EGTLOG_DEBUG("rendering directly to {} KMS buffers", m_buffers.size());
+        }
     }
     else
     {
-        init(nullptr, 0, Size(m_device->screens[0]->width,
-                              m_device->screens[0]->height), format);
+        init(nullptr, 0, Size(screen.width, screen.height), format);
+    }
+
+    the_kms.push_back(this);
+}
+
+uint32_t KMSScreen::screen_rotation()
+{
+    const auto value = getenv("EGT_SCREEN_ROTATION");
+    if (value && strlen(value))
+        return std::stoi(value);
+    return 0;
+}
+
+bool KMSScreen::primary_rotation(uint32_t degrees) const
+{
+    const kms_plane* primary = nullptr;
+    uint32_t index = 0;
+    for (uint32_t x = 0; x < m_device->num_planes; x++)
+    {
+        if (m_device->planes[x]->type == DRM_PLANE_TYPE_PRIMARY &&
+            index++ == m_output)
+        {
+            primary = m_device->planes[x];
+            break;
+        }
+    }
+
+    if (!primary)
+        return false;
+
+    auto props = drmModeObjectGetProperties(m_fd, primary->id, DRM_MODE_OBJECT_PLANE);
+    if (!props)
+        return false;
+
+    // rotation is a bitmask property, with a "rotate-<degrees>" bit
+    const auto name = fmt::format("rotate-{}", degrees);
+    bool supported = false;
+    for (uint32_t i = 0; i < props->count_props && !supported; i++)
+    {
+        auto prop = drmModeGetProperty(m_fd, props->props[i]);
+        if (!prop)
+            continue;
+
+        if (!strcmp(prop->name, "rotation") && (prop->flags & DRM_MODE_PROP_BITMASK))
+        {
+            for (auto e = 0; e < prop->count_enums; e++)
+            {
+                if (name == prop->enums[e].name)
+                {
+                    supported = true;
+                    break;
+                }
+            }
+        }
+
+        drmModeFreeProperty(prop);
+    }
+
+    drmModeFreeObjectProperties(props);
+    return supported;
+}
+
+void KMSScreen::load_palette()
+{
+    if (m_output >= static_cast<uint32_t>(m_device->num_crtcs))
+        return;
+
+    // the color lookup table of the CRTC maps each index to its RGB332 color
+    const auto colors = detail::rgb332_palette();
+    std::array<uint16_t, 256> red{};
+    std::array<uint16_t, 256> green{};
+    std::array<uint16_t, 256> blue{};
+    for (size_t i = 0; i < red.size(); ++i)
+    {
+        red[i] = ((colors[i] >> 16) & 0xff) * 257;
+        green[i] = ((colors[i] >> 8) & 0xff) * 257;
+        blue[i] = (colors[i] & 0xff) * 257;
     }
 
-    assert(!the_kms);
-    the_kms = this;
+    if (drmModeCrtcSetGamma(m_fd, m_device->crtcs[m_output]->id, red.size(),
+                            red.data(), green.data(), blue.data()))
+        detail::warn("unable to load the c8 palette: {}", strerror(errno));
 }
 
 uint32_t KMSScreen::max_buffers()
@@ -177,21 +358,70 @@ void KMSScreen::schedule_flip()
 {
     if (m_plane->buffer_count > 1)
     {
-        m_pool->enqueue(FlipJob(m_plane.get(), m_index, m_async));
+        if (auto f = frame())
+            f->framebuffer(m_plane.get(), m_plane->fbs[m_index]->id);
+        else
+            m_pool->enqueue(FlipJob(m_plane.get(), m_index, m_async));
 
         if (++m_index >= m_plane->buffer_count)
             m_index = 0;
     }
 }
 
+void KMSScreen::copy_to_buffer(ScreenBuffer& buffer)
+{
+    /*
+     * GFX2D surfaces are not image surfaces, so they can't be copied by the
+     * CPU.  Instead, let cairo blit the damage from the composition surface,
+     * which the GFX2D backend hands to the 2D engine.
+     */
+    if (m_gfx2d)
+        copy_to_buffer_software(buffer);
+    else
+        Screen::copy_to_buffer(buffer);
+}
+
 uint32_t KMSScreen::index()
 {
     return m_index;
 }
 
+bool KMSScreen::flip_ready() const
+{
+    if (auto f = frame())
+        return f->ready();
+
+    return !m_pool || !m_pool->full();
+}
+
+void KMSScreen::end_frame()
+{
+    if (auto f = frame())
+        f->commit();
+}
+
+KMSFrame* KMSScreen::frame() const
+{
+    return m_shared ? m_shared->frame.get() : nullptr;
+}
+
 KMSScreen* KMSScreen::instance()
 {
-    return the_kms;
+    return instance(0);
+}
+
+KMSScreen* KMSScreen::instance(uint32_t output)
+{
+    auto i = std::find_if(the_kms.begin(), the_kms.end(),
+                          [output](const KMSScreen * screen) { return screen->output() == output; });
+    if (i != the_kms.end())
+        return *i;
+    return nullptr;
+}
+
+uint32_t KMSScreen::outputs() const
+{
+    return m_device ? m_device->num_screens : 0;
 }
 
 struct planeid
@@ -347,20 +577,16 @@ void KMSScreen::deallocate_overlay(plane_data* plane)
 
 void KMSScreen::close()
 {
+    if (auto f = frame())
+        f->detach(m_plane.get());
+
     m_pool.reset();
     m_plane.reset();
 
-    if (m_device)
-    {
-        kms_device_close(m_device);
-        m_device = nullptr;
-    }
-
-    if (m_fd >= 0)
-    {
-        drmClose(m_fd);
-        m_fd = -1;
-    }
+    // the device is closed with the screen of the last output
+    m_device = nullptr;
+    m_fd = -1;
+    m_shared.reset();
 }
 
 static fs::path const get_backlight_dir(std::string const& path)
@@ -405,8 +631,7 @@ KMSScreen::~KMSScreen() noexcept
 {
     close();
 
-    if (the_kms == this)
-        the_kms = nullptr;
+    the_kms.erase(std::remove(the_kms.begin(), the_kms.end(), this), the_kms.end());
 }
 
 }
@@ -10,6 +10,8 @@
 #include "egt/utils.h"
 #include <SDL2/SDL.h>
 #include <cairo.h>
+#include <chrono>
+#include <mutex>
 #include <string>
 
 namespace egt
@@ -48,6 +50,15 @@ struct SDLData
     unique_sdl_window_t window;
     unique_sdl_renderer_t renderer;
     unique_sdl_texture_t texture;
+
+    /// Protects the staging buffer and the pending damage.
+    std::mutex lock;
+    /// Damage of the staging buffer not uploaded to the texture yet.
+    Screen::DamageArray pending;
+    /// Is an upload posted to the SDL thread.
+    bool posted{false};
+    /// Does the renderer present on the vertical blanking.
+    bool vsync{false};
 };
 
 
@@ -59,7 +70,10 @@ SDLScreen::SDLScreen(Application& app, const Size& size, const std::string& name
 
     init(size);
 
-    m_buffers.emplace_back(nullptr);
+    // frames are copied to this staging buffer in the event loop, and
+    // uploaded to the texture from there in the SDL thread
+    m_buffers.emplace_back(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                           size.width(), size.height()));
 
     m_thread = std::thread([size, name, this]()
     {
@@ -80,10 +94,21 @@ SDLScreen::SDLScreen(Application& app, const Size& size, const std::string& name
             throw std::runtime_error(std::string("unable to create window: ") + SDL_GetError());
 
         m_priv->renderer = unique_sdl_renderer_t(
-                               SDL_CreateRenderer(m_priv->window.get(), -1, SDL_RENDERER_SOFTWARE));
+                               SDL_CreateRenderer(m_priv->window.get(), -1,
+                                       SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+        if (!m_priv->renderer)
+            m_priv->renderer = unique_sdl_renderer_t(
+                                   SDL_CreateRenderer(m_priv->window.get(), -1, SDL_RENDERER_SOFTWARE));
         if (!m_priv->renderer)
             throw std::runtime_error(std::string("unable to create renderer: ") + SDL_GetError());
 
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(m_priv->renderer.get(), &info) == 0)
+        {
+            m_priv->vsync = info.flags & SDL_RENDERER_PRESENTVSYNC;
+            detail::debug("SDL renderer {} vsync {}", info.name, m_priv->vsync);
+        }
+
         m_priv->texture = unique_sdl_texture_t(
                               SDL_CreateTexture(m_priv->renderer.get(), SDL_PIXELFORMAT_ARGB8888,
                                                 SDL_TEXTUREACCESS_STREAMING,
@@ -184,29 +209,67 @@ void SDLScreen::key_event(EventId e, const Key& key)
 
 void SDLScreen::flip(const DamageArray& damage)
 {
-    asio::post(m_io, std::bind(&SDLScreen::sdl_draw, this, damage));
+    std::lock_guard<std::mutex> lock(m_priv->lock);
+
+    // the SDL thread never reads the composition buffer the next frame is
+    // drawn to, only the staging buffer
+    Screen::flip(damage);
+
+    // frames flipped before the upload are uploaded together
+    if (!m_priv->posted && !m_priv->pending.empty())
+    {
+        m_priv->posted = true;
+        asio::post(m_io, std::bind(&SDLScreen::sdl_draw, this));
+    }
+}
+
+void SDLScreen::copy_to_buffer(ScreenBuffer& buffer)
+{
+    copy_to_buffer_software(buffer);
+
+    for (const auto& rect : buffer.damage)
+        add_damage(m_priv->pending, rect);
 }
 
-void SDLScreen::sdl_draw(const DamageArray& damage)
+void SDLScreen::sdl_draw()
 {
-    void* pixels{};
-    int pitch{};
+    {
+        std::lock_guard<std::mutex> lock(m_priv->lock);
+        m_priv->posted = false;
 
-    if (SDL_LockTexture(m_priv->texture.get(), nullptr, &pixels, &pitch) != 0)
-        throw std::runtime_error(std::string("failed to lock texture: ") + SDL_GetError());
+        auto surface = m_buffers.front().surface.get();
+        cairo_surface_flush(surface);
+        const auto data = cairo_image_surface_get_data(surface);
+        const auto stride = cairo_image_surface_get_stride(surface);
 
-    ScreenBuffer& buffer = m_buffers.front();
-    buffer.surface = unique_cairo_surface_t(
-                         cairo_image_surface_create_for_data(
-                             static_cast<unsigned char*>(pixels),
-                             CAIRO_FORMAT_ARGB32,
-                             size().width(), size().height(), pitch));
+        // the texture keeps its content, so only the damage is uploaded
+        for (const auto& damage : m_priv->pending)
+        {
+            const auto rect = Rect::intersection(damage, box());
+            if (rect.empty())
+                continue;
+
+            const SDL_Rect r{rect.x(), rect.y(), rect.width(), rect.height()};
+            if (SDL_UpdateTexture(m_priv->texture.get(), &r,
+                                  data + rect.y() * stride + rect.x() * 4, stride) != 0)
+                detail::warn("failed to update texture: {}", SDL_GetError());
+        }
 
-    Screen::flip(damage);
+        m_priv->pending.clear();
+    }
 
-    SDL_UnlockTexture(m_priv->texture.get());
     SDL_RenderCopy(m_priv->renderer.get(), m_priv->texture.get(), nullptr, nullptr);
     SDL_RenderPresent(m_priv->renderer.get());
+
+    // the present waited for the vertical blanking, which can pace the frame clock
+    if (m_priv->vsync)
+    {
+        const auto when = std::chrono::steady_clock::now();
+        asio::post(m_app.event().io(), [this, when]()
+        {
+            flip_completed(when);
+        });
+    }
 }
 
 KeyboardCode SDLScreen::sdl_to_egtkeys(int key)
@@ -0,0 +1,779 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "config.h"
+#include "detail/egtlog.h"
+#include "detail/input/inputkeyboard.h"
+#include "egt/app.h"
+#include "egt/detail/screen/waylandscreen.h"
+#include "egt/eventloop.h"
+#include "egt/keycode.h"
+#include "xdg-shell-client-protocol.h"
+#include <algorithm>
+#include <array>
+#include <cairo.h>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <linux/input-event-codes.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * A Wayland surface drawn to two shared memory buffers.
+ */
+struct WaylandSurface
+{
+    struct Buffer
+    {
+        wl_buffer* buffer{};
+        /// Is the compositor reading the buffer.
+        bool busy{false};
+    };
+
+    WaylandSurface() = default;
+    WaylandSurface(const WaylandSurface&) = delete;
+    WaylandSurface& operator=(const WaylandSurface&) = delete;
+
+    ~WaylandSurface()
+    {
+        destroy();
+    }
+
+    /// Allocate the buffers, returning their pixels.
+    std::array<void*, 2> allocate(wl_shm* shm, const Size& size, uint32_t format);
+
+    /// Release the buffers.
+    void release();
+
+    /// Destroy the surface, before the display is disconnected.
+    void destroy();
+
+    /// Select a buffer to copy the next frame to, if the compositor is ready.
+    bool acquire();
+
+    /// Copy and submit the pending damage, if the compositor is ready.
+    void submit();
+
+    wl_display* display{};
+    wl_surface* surface{};
+    wl_subsurface* subsurface{};
+    /// Can damage be submitted in buffer coordinates.
+    bool damage_buffer{false};
+    /// Position in the window, for the input in subsurfaces.
+    DisplayPoint position;
+    std::array<Buffer, 2> buffers{};
+    /// Mapped memory of the buffers.
+    void* data{MAP_FAILED};
+    size_t size{0};
+    /// Buffer the next frame is copied to.
+    uint32_t index{0};
+    /// Pending frame callback, until the compositor displays the last frame.
+    wl_callback* frame{};
+    /// Damage not submitted yet.
+    Screen::DamageArray pending;
+    bool hidden{false};
+    /// Copies damage of the composition buffer to the selected buffer.
+    std::function<void(const Screen::DamageArray&)> copy;
+    /// Called when the compositor displayed a frame.
+    std::function<void()> frame_done;
+};
+
+static void buffer_release(void* data, wl_buffer* buffer)
+{
+    auto surface = static_cast<WaylandSurface*>(data);
+    for (auto& b : surface->buffers)
+    {
+        if (b.buffer == buffer)
+            b.busy = false;
+    }
+
+    surface->submit();
+}
+
+static const wl_buffer_listener buffer_listener =
+{
+    buffer_release
+};
+
+static void frame_done(void* data, wl_callback* callback, uint32_t)
+{
+    auto surface = static_cast<WaylandSurface*>(data);
+    wl_callback_destroy(callback);
+    surface->frame = nullptr;
+
+    if (surface->frame_done)
+        surface->frame_done();
+
+    surface->submit();
+}
+
+static const wl_callback_listener frame_listener =
+{
+    frame_done
+};
+
+std::array<void*, 2> WaylandSurface::allocate(wl_shm* shm, const Size& size, uint32_t format)
+{
+    release();
+
+    const auto stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, size.width());
+    const size_t buffer_size = stride * size.height();
+    this->size = buffer_size * buffers.size();
+
+    const auto fd = memfd_create("egt-wayland", MFD_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("unable to create wayland buffers");
+
+    if (ftruncate(fd, this->size) < 0)
+    {
+        close(fd);
+        throw std::runtime_error("unable to create wayland buffers");
+    }
+
+    data = mmap(nullptr, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        throw std::runtime_error("unable to map wayland buffers");
+    }
+
+    auto pool = wl_shm_create_pool(shm, fd, this->size);
+    std::array<void*, 2> pixels{};
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        buffers[i].buffer = wl_shm_pool_create_buffer(pool, i * buffer_size,
+                            size.width(), size.height(), stride, format);
+        buffers[i].busy = false;
+        wl_buffer_add_listener(buffers[i].buffer, &buffer_listener, this);
+        pixels[i] = static_cast<unsigned char*>(data) + i * buffer_size;
+    }
+
+    // the buffers keep the pool
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    return pixels;
+}
+
+void WaylandSurface::release()
+{
+    for (auto& b : buffers)
+    {
+        if (b.buffer)
+            wl_buffer_destroy(b.buffer);
+        b = {};
+    }
+
+    if (data != MAP_FAILED)
+        munmap(data, size);
+    data = MAP_FAILED;
+}
+
+void WaylandSurface::destroy()
+{
+    release();
+
+    if (frame)
+        wl_callback_destroy(frame);
+    frame = nullptr;
+    if (subsurface)
+        wl_subsurface_destroy(subsurface);
+    subsurface = nullptr;
+    if (surface)
+        wl_surface_destroy(surface);
+    surface = nullptr;
+}
+
+bool WaylandSurface::acquire()
+{
+    // one frame at a time, once the compositor displayed the last one
+    if (frame || hidden)
+        return false;
+
+    for (uint32_t i = 0; i < buffers.size(); ++i)
+    {
+        if (buffers[i].buffer && !buffers[i].busy)
+        {
+            index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WaylandSurface::submit()
+{
+    if (pending.empty() || !acquire())
+        return;
+
+    Screen::DamageArray damage;
+    std::swap(damage, pending);
+
+    // this also copies what the buffer missed since it was last submitted
+    copy(damage);
+
+    auto& buffer = buffers[index];
+    wl_surface_attach(surface, buffer.buffer, 0, 0);
+    for (const auto& rect : damage)
+    {
+        if (damage_buffer)
+            wl_surface_damage_buffer(surface, rect.x(), rect.y(), rect.width(), rect.height());
+        else
+            wl_surface_damage(surface, rect.x(), rect.y(), rect.width(), rect.height());
+    }
+
+    frame = wl_surface_frame(surface);
+    wl_callback_add_listener(frame, &frame_listener, this);
+    wl_surface_commit(surface);
+    buffer.busy = true;
+
+    wl_display_flush(display);
+}
+
+struct WaylandData
+{
+    wl_display* display{};
+    wl_registry* registry{};
+    wl_compositor* compositor{};
+    uint32_t compositor_version{0};
+    wl_subcompositor* subcompositor{};
+    wl_shm* shm{};
+    xdg_wm_base* wm_base{};
+    xdg_surface* shell_surface{};
+    xdg_toplevel* toplevel{};
+    /// Was the window configured by the compositor.
+    bool configured{false};
+    wl_seat* seat{};
+    wl_pointer* pointer{};
+    wl_keyboard* keyboard{};
+
+    /// The surface of the window.
+    WaylandSurface surface;
+
+    /// Surface the pointer is in.
+    WaylandSurface* focus{};
+    /// Position of the pointer in the window.
+    DisplayPoint point;
+
+    /// Keyboard instance
+    InputKeyboard keys;
+
+    /// Dispatches an event to the input of the screen.
+    std::function<void(Event&)> dispatch;
+};
+
+static void pointer_motion(void* data, wl_pointer*, uint32_t, wl_fixed_t x, wl_fixed_t y)
+{
+    auto priv = static_cast<WaylandData*>(data);
+    priv->point = DisplayPoint(wl_fixed_to_int(x), wl_fixed_to_int(y));
+    if (priv->focus)
+        priv->point += priv->focus->position;
+
+    Event event(EventId::raw_pointer_move, Pointer(priv->point));
+    priv->dispatch(event);
+}
+
+static void pointer_enter(void* data, wl_pointer* pointer, uint32_t serial,
+                          wl_surface* surface, wl_fixed_t x, wl_fixed_t y)
+{
+    auto priv = static_cast<WaylandData*>(data);
+    priv->focus = surface ? static_cast<WaylandSurface*>(wl_surface_get_user_data(surface)) : nullptr;
+    pointer_motion(data, pointer, serial, x, y);
+}
+
+static void pointer_leave(void* data, wl_pointer*, uint32_t, wl_surface*)
+{
+    static_cast<WaylandData*>(data)->focus = nullptr;
+}
+
+static void pointer_button(void* data, wl_pointer*, uint32_t, uint32_t,
+                           uint32_t button, uint32_t state)
+{
+    auto priv = static_cast<WaylandData*>(data);
+    Event event(state == WL_POINTER_BUTTON_STATE_PRESSED ?
+                EventId::raw_pointer_down : EventId::raw_pointer_up,
+                Pointer(priv->point));
+    if (button == BTN_LEFT)
+        event.pointer().btn = Pointer::Button::left;
+    else if (button == BTN_MIDDLE)
+        event.pointer().btn = Pointer::Button::middle;
+    else if (button == BTN_RIGHT)
+        event.pointer().btn = Pointer::Button::right;
+    priv->dispatch(event);
+}
+
+static void pointer_axis(void*, wl_pointer*, uint32_t, uint32_t, wl_fixed_t)
+{}
+
+static void pointer_frame(void*, wl_pointer*)
+{}
+
+static void pointer_axis_source(void*, wl_pointer*, uint32_t)
+{}
+
+static void pointer_axis_stop(void*, wl_pointer*, uint32_t, uint32_t)
+{}
+
+static void pointer_axis_discrete(void*, wl_pointer*, uint32_t, int32_t)
+{}
+
+// the seat is bound with version 5 at most, so later events are not sent
+static const wl_pointer_listener pointer_listener =
+{
+    pointer_enter,
+    pointer_leave,
+    pointer_motion,
+    pointer_button,
+    pointer_axis,
+    pointer_frame,
+    pointer_axis_source,
+    pointer_axis_stop,
+    pointer_axis_discrete,
+};
+
+static void keyboard_keymap(void*, wl_keyboard*, uint32_t, int32_t fd, uint32_t)
+{
+    // keys are mapped like keys from evdev
+    close(fd);
+}
+
+static void keyboard_enter(void*, wl_keyboard*, uint32_t, wl_surface*, wl_array*)
+{}
+
+static void keyboard_leave(void*, wl_keyboard*, uint32_t, wl_surface*)
+{}
+
+static void keyboard_key(void* data, wl_keyboard*, uint32_t, uint32_t,
+                         uint32_t key, uint32_t state)
+{
+    static const auto EVDEV_OFFSET = 8;
+
+    auto priv = static_cast<WaylandData*>(data);
+    const auto id = state == WL_KEYBOARD_KEY_STATE_PRESSED ?
+                    EventId::keyboard_down : EventId::keyboard_up;
+    const auto unicode = priv->keys.on_key(key + EVDEV_OFFSET, id);
+    Event event(id, Key(linux_to_ekey(key), unicode));
+    priv->dispatch(event);
+}
+
+static void keyboard_modifiers(void*, wl_keyboard*, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t)
+{}
+
+static void keyboard_repeat_info(void*, wl_keyboard*, int32_t, int32_t)
+{}
+
+static const wl_keyboard_listener keyboard_listener =
+{
+    keyboard_keymap,
+    keyboard_enter,
+    keyboard_leave,
+    keyboard_key,
+    keyboard_modifiers,
+    keyboard_repeat_info,
+};
+
+static void seat_capabilities(void* data, wl_seat* seat, uint32_t capabilities)
+{
+    auto priv = static_cast<WaylandData*>(data);
+
+    if ((capabilities & WL_SEAT_CAPABILITY_POINTER) && !priv->pointer)
+    {
+        priv->pointer = wl_seat_get_pointer(seat);
+        wl_pointer_add_listener(priv->pointer, &pointer_listener, priv);
+    }
+    else if (!(capabilities & WL_SEAT_CAPABILITY_POINTER) && priv->pointer)
+    {
+        wl_pointer_destroy(priv->pointer);
+        priv->pointer = nullptr;
+        priv->focus = nullptr;
+    }
+
+    if ((capabilities & WL_SEAT_CAPABILITY_KEYBOARD) && !priv->keyboard)
+    {
+        priv->keyboard = wl_seat_get_keyboard(seat);
+        wl_keyboard_add_listener(priv->keyboard, &keyboard_listener, priv);
+    }
+    else if (!(capabilities & WL_SEAT_CAPABILITY_KEYBOARD) && priv->keyboard)
+    {
+        wl_keyboard_destroy(priv->keyboard);
+        priv->keyboard = nullptr;
+    }
+}
+
+static void seat_name(void*, wl_seat*, const char*)
+{}
+
+static const wl_seat_listener seat_listener =
+{
+    seat_capabilities,
+    seat_name,
+};
+
+static void wm_base_ping(void*, xdg_wm_base* wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const xdg_wm_base_listener wm_base_listener =
+{
+    wm_base_ping
+};
+
+static void shell_surface_configure(void* data, xdg_surface* surface, uint32_t serial)
+{
+    xdg_surface_ack_configure(surface, serial);
+    static_cast<WaylandData*>(data)->configured = true;
+}
+
+static const xdg_surface_listener shell_surface_listener =
+{
+    shell_surface_configure
+};
+
+static void toplevel_configure(void*, xdg_toplevel*, int32_t, int32_t, wl_array*)
+{
+    // the window keeps the size of the screen
+}
+
+static void toplevel_close(void*, xdg_toplevel*)
+{
+    Application::instance().event().quit();
+}
+
+// xdg_wm_base is bound with version 1, so later events are not sent
+static const xdg_toplevel_listener toplevel_listener =
+{
+    toplevel_configure,
+    toplevel_close,
+};
+
+static void registry_global(void* data, wl_registry* registry, uint32_t name,
+                            const char* interface, uint32_t version)
+{
+    auto priv = static_cast<WaylandData*>(data);
+
+    if (!strcmp(interface, wl_compositor_interface.name))
+    {
+        // wl_surface_damage_buffer() needs version 4
+        priv->compositor_version = std::min(version, 4U);
+        priv->compositor = static_cast<wl_compositor*>(
+                               wl_registry_bind(registry, name, &wl_compositor_interface,
+                                                priv->compositor_version));
+    }
+    else if (!strcmp(interface, wl_subcompositor_interface.name))
+    {
+        priv->subcompositor = static_cast<wl_subcompositor*>(
+                                  wl_registry_bind(registry, name, &wl_subcompositor_interface, 1));
+    }
+    else if (!strcmp(interface, wl_shm_interface.name))
+    {
+        priv->shm = static_cast<wl_shm*>(
+                        wl_registry_bind(registry, name, &wl_shm_interface, 1));
+    }
+    else if (!strcmp(interface, xdg_wm_base_interface.name))
+    {
+        priv->wm_base = static_cast<xdg_wm_base*>(
+                            wl_registry_bind(registry, name, &xdg_wm_base_interface, 1));
+        xdg_wm_base_add_listener(priv->wm_base, &wm_base_listener, priv);
+    }
+    else if (!strcmp(interface, wl_seat_interface.name) && !priv->seat)
+    {
+        priv->seat = static_cast<wl_seat*>(
+                         wl_registry_bind(registry, name, &wl_seat_interface, std::min(version, 5U)));
+        wl_seat_add_listener(priv->seat, &seat_listener, priv);
+    }
+}
+
+static void registry_global_remove(void*, wl_registry*, uint32_t)
+{}
+
+static const wl_registry_listener registry_listener =
+{
+    registry_global,
+    registry_global_remove,
+};
+
+WaylandScreen::WaylandScreen(Application& app, const Size& size, const std::string& name)
+    : m_app(app),
+      m_priv(std::make_unique<detail::WaylandData>()),
+      m_input(m_app.event().io())
+{
+    detail::info("Wayland Screen");
+
+    m_priv->display = wl_display_connect(nullptr);
+    if (!m_priv->display)
+        throw std::runtime_error("unable to connect to wayland display");
+
+    m_priv->dispatch = [this](Event & event)
+    {
+        m_in.dispatch(event);
+    };
+
+    m_priv->registry = wl_display_get_registry(m_priv->display);
+    wl_registry_add_listener(m_priv->registry, &registry_listener, m_priv.get());
+    wl_display_roundtrip(m_priv->display);
+
+    if (!m_priv->compositor || !m_priv->shm || !m_priv->wm_base)
+        throw std::runtime_error("wayland compositor without wl_compositor, wl_shm or xdg_wm_base");
+
+    auto& surface = m_priv->surface;
+    surface.display = m_priv->display;
+    surface.damage_buffer = m_priv->compositor_version >= 4;
+    surface.surface = wl_compositor_create_surface(m_priv->compositor);
+    wl_surface_set_user_data(surface.surface, &surface);
+
+    m_priv->shell_surface = xdg_wm_base_get_xdg_surface(m_priv->wm_base, surface.surface);
+    xdg_surface_add_listener(m_priv->shell_surface, &shell_surface_listener, m_priv.get());
+    m_priv->toplevel = xdg_surface_get_toplevel(m_priv->shell_surface);
+    xdg_toplevel_add_listener(m_priv->toplevel, &toplevel_listener, m_priv.get());
+
+    const auto title = name.empty() ? std::string("EGT") : name;
+    xdg_toplevel_set_title(m_priv->toplevel, title.c_str());
+    xdg_toplevel_set_app_id(m_priv->toplevel, title.c_str());
+    xdg_toplevel_set_min_size(m_priv->toplevel, size.width(), size.height());
+    xdg_toplevel_set_max_size(m_priv->toplevel, size.width(), size.height());
+
+    // a buffer can only be attached once the window is configured
+    wl_surface_commit(surface.surface);
+    while (!m_priv->configured)
+    {
+        if (wl_display_dispatch(m_priv->display) < 0)
+            throw std::runtime_error("unable to configure wayland window");
+    }
+
+    auto pixels = surface.allocate(m_priv->shm, size, WL_SHM_FORMAT_XRGB8888);
+    init(pixels.data(), pixels.size(), size, PixelFormat::xrgb8888);
+
+    surface.copy = [this](const DamageArray & damage)
+    {
+        Screen::flip(damage);
+    };
+
+    // the compositor displayed the last frame, which paces the frame clock
+    surface.frame_done = [this]()
+    {
+        flip_completed(std::chrono::steady_clock::now());
+    };
+
+    m_input.assign(wl_display_get_fd(m_priv->display));
+
+    dispatch();
+
+    // start the async read from the server
+    asio::async_read(m_input, asio::null_buffers(),
+                     [this](const asio::error_code & error, std::size_t)
+    {
+        handle_read(error);
+    });
+}
+
+void WaylandScreen::flip(const DamageArray& damage)
+{
+    auto& surface = m_priv->surface;
+    for (const auto& rect : damage)
+        add_damage(surface.pending, rect);
+
+    // damage flipped while the compositor is busy goes with the next frame
+    surface.submit();
+}
+
+uint32_t WaylandScreen::index()
+{
+    return m_priv->surface.index;
+}
+
+void WaylandScreen::handle_read(const asio::error_code& error)
+{
+    if (error)
+    {
+        detail::error("{}", error);
+        return;
+    }
+
+    dispatch();
+
+    asio::async_read(m_input, asio::null_buffers(),
+                     [this](const asio::error_code & error, std::size_t)
+    {
+        handle_read(error);
+    });
+}
+
+void WaylandScreen::dispatch()
+{
+    auto display = m_priv->display;
+
+    // read until the socket is drained, which is when the event loop waits again
+    while (true)
+    {
+        while (wl_display_prepare_read(display) != 0)
+            wl_display_dispatch_pending(display);
+
+        wl_display_flush(display);
+
+        pollfd fd{wl_display_get_fd(display), POLLIN, 0};
+        if (poll(&fd, 1, 0) <= 0)
+        {
+            wl_display_cancel_read(display);
+            break;
+        }
+
+        if (wl_display_read_events(display) < 0)
+        {
+            detail::error("lost connection to wayland display");
+            m_app.event().quit();
+            break;
+        }
+
+        wl_display_dispatch_pending(display);
+    }
+}
+
+WaylandScreen::~WaylandScreen() noexcept
+{
+    // closed with the display
+    m_input.release();
+
+    m_priv->surface.destroy();
+
+    if (m_priv->pointer)
+        wl_pointer_destroy(m_priv->pointer);
+    if (m_priv->keyboard)
+        wl_keyboard_destroy(m_priv->keyboard);
+    if (m_priv->seat)
+        wl_seat_destroy(m_priv->seat);
+    if (m_priv->toplevel)
+        xdg_toplevel_destroy(m_priv->toplevel);
+    if (m_priv->shell_surface)
+        xdg_surface_destroy(m_priv->shell_surface);
+    if (m_priv->wm_base)
+        xdg_wm_base_destroy(m_priv->wm_base);
+    if (m_priv->subcompositor)
+        wl_subcompositor_destroy(m_priv->subcompositor);
+    if (m_priv->shm)
+        wl_shm_destroy(m_priv->shm);
+    if (m_priv->compositor)
+        wl_compositor_destroy(m_priv->compositor);
+    if (m_priv->registry)
+        wl_registry_destroy(m_priv->registry);
+    if (m_priv->display)
+        wl_display_disconnect(m_priv->display);
+}
+
+WaylandSubsurface::WaylandSubsurface(WaylandScreen& parent, const Size& size)
+    : m_parent(parent),
+      m_surface(std::make_unique<detail::WaylandSurface>())
+{
+    auto& priv = *m_parent.m_priv;
+    if (!priv.subcompositor)
+        throw std::runtime_error("wayland compositor without wl_subcompositor");
+
+    m_surface->display = priv.display;
+    m_surface->damage_buffer = priv.surface.damage_buffer;
+    m_surface->surface = wl_compositor_create_surface(priv.compositor);
+    wl_surface_set_user_data(m_surface->surface, m_surface.get());
+    m_surface->subsurface = wl_subcompositor_get_subsurface(priv.subcompositor,
+                            m_surface->surface, priv.surface.surface);
+
+    // frames are displayed without waiting for a frame of the window
+    wl_subsurface_set_desync(m_surface->subsurface);
+
+    m_surface->copy = [this](const DamageArray & damage)
+    {
+        Screen::flip(damage);
+    };
+
+    resize(size);
+}
+
+void WaylandSubsurface::flip(const DamageArray& damage)
+{
+    for (const auto& rect : damage)
+        add_damage(m_surface->pending, rect);
+
+    m_surface->submit();
+}
+
+uint32_t WaylandSubsurface::index()
+{
+    return m_surface->index;
+}
+
+void WaylandSubsurface::resize(const Size& size)
+{
+    if (m_surface->data != MAP_FAILED && size == this->size())
+        return;
+
+    auto pixels = m_surface->allocate(m_parent.m_priv->shm, size, WL_SHM_FORMAT_ARGB8888);
+    init(pixels.data(), pixels.size(), size, PixelFormat::argb8888);
+
+    m_surface->pending.clear();
+    add_damage(m_surface->pending, box());
+}
+
+void WaylandSubsurface::position(const DisplayPoint& point)
+{
+    if (point == m_surface->position)
+        return;
+
+    m_surface->position = point;
+    wl_subsurface_set_position(m_surface->subsurface, point.x(), point.y());
+
+    // the position is applied with the next commit of the window
+    wl_surface_commit(m_parent.m_priv->surface.surface);
+    wl_display_flush(m_surface->display);
+}
+
+void WaylandSubsurface::show()
+{
+    if (!m_surface->hidden)
+        return;
+
+    m_surface->hidden = false;
+
+    // the surface has no buffer anymore
+    add_damage(m_surface->pending, box());
+    m_surface->submit();
+}
+
+void WaylandSubsurface::hide()
+{
+    if (m_surface->hidden)
+        return;
+
+    m_surface->hidden = true;
+
+    // frames of a surface without a buffer may never be done
+    if (m_surface->frame)
+        wl_callback_destroy(m_surface->frame);
+    m_surface->frame = nullptr;
+
+    wl_surface_attach(m_surface->surface, nullptr, 0, 0);
+    wl_surface_commit(m_surface->surface);
+    wl_display_flush(m_surface->display);
+}
+
+WaylandSubsurface::~WaylandSubsurface() noexcept
+{
+    m_surface->destroy();
+    wl_display_flush(m_surface->display);
+}
+
+}
+}
+}
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "config.h"
 #include "detail/egtlog.h"
 #include "detail/input/inputkeyboard.h"
 #include "detail/screen/keyboard_code_conversion_x.h"
@@ -14,9 +15,16 @@
 #include "egt/keycode.h"
 #include <cairo-xlib.h>
 #include <cairo.h>
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 
+#ifdef HAVE_XEXT
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
 namespace egt
 {
 inline namespace v1
@@ -32,8 +40,104 @@ struct X11Data
 
     /// Keyboard instance
     InputKeyboard keyboard;
+
+#ifdef HAVE_XEXT
+    /// Image in memory shared with the server, if MIT-SHM is used.
+    XImage* image{};
+    /// Shared memory segment of the image.
+    XShmSegmentInfo shm{};
+    /// Graphics context the image is put with.
+    GC gc{};
+#endif
 };
 
+#ifdef HAVE_XEXT
+static bool shm_error = false;
+
+static int shm_error_handler(Display*, XErrorEvent*)
+{
+    shm_error = true;
+    return 0;
+}
+
+/**
+ * Create an image in memory shared with the server, and a surface to draw
+ * it, if the server supports MIT-SHM and uses the layout of a cairo RGB24
+ * surface.
+ */
+static cairo_surface_t* create_shm_surface(X11Data& priv, int screen, const Size& size)
+{
+    if (std::getenv("EGT_X11_NOSHM") || !XShmQueryExtension(priv.display))
+        return nullptr;
+
+    auto visual = DefaultVisual(priv.display, screen); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+    auto depth = DefaultDepth(priv.display, screen); // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+    if ((depth != 24 && depth != 32) || visual->red_mask != 0xff0000 ||
+        visual->green_mask != 0xff00 || visual->blue_mask != 0xff)
+        return nullptr;
+
+    priv.image = XShmCreateImage(priv.display, visual, depth, ZPixmap, nullptr,
+                                 &priv.shm, size.width(), size.height());
+    if (!priv.image)
+        return nullptr;
+
+    const uint32_t one = 1;
+    const auto lsb_first = *reinterpret_cast<const uint8_t*>(&one) == 1;
+    if (priv.image->bits_per_pixel != 32 ||
+        priv.image->byte_order != (lsb_first ? LSBFirst : MSBFirst))
+    {
+        XDestroyImage(priv.image);
+        priv.image = nullptr;
+        return nullptr;
+    }
+
+    priv.shm.shmid = shmget(IPC_PRIVATE, priv.image->bytes_per_line * priv.image->height,
+                            IPC_CREAT | 0600);
+    if (priv.shm.shmid < 0)
+    {
+        XDestroyImage(priv.image);
+        priv.image = nullptr;
+        return nullptr;
+    }
+
+    priv.shm.shmaddr = priv.image->data = static_cast<char*>(shmat(priv.shm.shmid, nullptr, 0));
+    priv.shm.readOnly = False;
+
+    // a remote server fails to attach, which must not exit the application
+    auto attached = false;
+    if (priv.shm.shmaddr != reinterpret_cast<char*>(-1))
+    {
+        XSync(priv.display, False);
+        shm_error = false;
+        auto handler = XSetErrorHandler(shm_error_handler);
+        XShmAttach(priv.display, &priv.shm);
+        XSync(priv.display, False);
+        XSetErrorHandler(handler);
+        attached = !shm_error;
+    }
+
+    // freed once both the server and the application detach
+    shmctl(priv.shm.shmid, IPC_RMID, nullptr);
+
+    if (!attached)
+    {
+        if (priv.shm.shmaddr != reinterpret_cast<char*>(-1))
+            shmdt(priv.shm.shmaddr);
+        priv.image->data = nullptr;
+        XDestroyImage(priv.image);
+        priv.image = nullptr;
+        return nullptr;
+    }
+
+    priv.gc = XCreateGC(priv.display, priv.window, 0, nullptr);
+
+    return cairo_image_surface_create_for_data(reinterpret_cast<unsigned char*>(priv.image->data),
+            CAIRO_FORMAT_RGB24,
+            size.width(), size.height(),
+            priv.image->bytes_per_line);
+}
+#endif
+
 X11Screen::X11Screen(Application& app, const Size& size, const std::string& name, bool borderless)
     : m_app(app),
       m_priv(std::make_unique<detail::X11Data>()),
@@ -86,12 +190,25 @@ X11Screen::X11Screen(Application& app, const Size& size, const std::string& name
 
     init(size, PixelFormat::rgb565);
 
-    // instead of using init() to create the buffer, create our own using cairo_xlib_surface_create
-    m_buffers.emplace_back(
-        cairo_xlib_surface_create(m_priv->display, m_priv->window,
-                                  DefaultVisual(m_priv->display, screen), // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
-                                  size.width(), size.height()));
-    cairo_xlib_surface_set_size(m_buffers.back().surface.get(), size.width(), size.height());
+#ifdef HAVE_XEXT
+    // frames are copied to memory shared with the server, and only the
+    // damaged rectangles are put to the window
+    auto shm = create_shm_surface(*m_priv, screen, size);
+    if (shm)
+    {
+        detail::info("X11 MIT-SHM");
+        m_buffers.emplace_back(shm);
+    }
+    else
+#endif
+    {
+        // instead of using init() to create the buffer, create our own using cairo_xlib_surface_create
+        m_buffers.emplace_back(
+            cairo_xlib_surface_create(m_priv->display, m_priv->window,
+                                      DefaultVisual(m_priv->display, screen), // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+                                      size.width(), size.height()));
+        cairo_xlib_surface_set_size(m_buffers.back().surface.get(), size.width(), size.height());
+    }
 
     m_buffers.back().damage.emplace_back(0, 0, size.width(), size.height());
 
@@ -138,12 +255,42 @@ void X11Screen::disable_window_decorations()
 void X11Screen::flip(const DamageArray& damage)
 {
     Screen::flip(damage);
+
+#ifdef HAVE_XEXT
+    if (m_priv->image)
+    {
+        // the next frame must not be copied to the image while the server reads it
+        XSync(m_priv->display, False);
+
+        // events read meanwhile would not wake up the event loop
+        if (XEventsQueued(m_priv->display, QueuedAlready))
+            asio::post(m_app.event().io(), [this]() { process_events(); });
+        return;
+    }
+#endif
+
     XFlush(m_priv->display);
 }
 
 void X11Screen::copy_to_buffer(ScreenBuffer& buffer)
 {
     copy_to_buffer_software(buffer);
+
+#ifdef HAVE_XEXT
+    if (m_priv->image)
+    {
+        for (const auto& damage : buffer.damage)
+        {
+            const auto rect = Rect::intersection(damage, box());
+            if (rect.empty())
+                continue;
+
+            XShmPutImage(m_priv->display, m_priv->window, m_priv->gc, m_priv->image,
+                         rect.x(), rect.y(), rect.x(), rect.y(),
+                         rect.width(), rect.height(), False);
+        }
+    }
+#endif
 }
 
 void X11Screen::handle_read(const asio::error_code& error)
@@ -154,6 +301,17 @@ void X11Screen::handle_read(const asio::error_code& error)
         return;
     }
 
+    process_events();
+
+    asio::async_read(m_input, asio::null_buffers(),
+                     [this](const asio::error_code & error, std::size_t)
+    {
+        handle_read(error);
+    });
+}
+
+void X11Screen::process_events()
+{
     while (XPending(m_priv->display))
     {
         XEvent e;
@@ -245,16 +403,21 @@ void X11Screen::handle_read(const asio::error_code& error)
             break;
         }
     }
-
-    asio::async_read(m_input, asio::null_buffers(),
-                     [this](const asio::error_code & error, std::size_t)
-    {
-        handle_read(error);
-    });
 }
 
 X11Screen::~X11Screen() noexcept
 {
+#ifdef HAVE_XEXT
+    if (m_priv->image)
+    {
+        XShmDetach(m_priv->display, &m_priv->shm);
+        XFreeGC(m_priv->display, m_priv->gc);
+        m_priv->image->data = nullptr;
+        XDestroyImage(m_priv->image);
+        shmdt(m_priv->shm.shmaddr);
+    }
+#endif
+
     if (m_priv->display)
         XCloseDisplay(m_priv->display);
 }
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "detail/eraw.h"
+#include "detail/erawimage.h"
+#include "detail/fmt.h"
+#include "egt/detail/sharedstore.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Extension of the files of the store.
+static constexpr auto EXTENSION = ".eraw";
+
+SharedImageStore::SharedImageStore()
+{
+    const auto size = std::getenv("EGT_SHARED_CACHE_SIZE");
+    if (size && strlen(size))
+        m_max_bytes = std::strtoull(size, nullptr, 10);
+
+    const auto value = std::getenv("EGT_SHARED_CACHE_DIR");
+    if (value && strlen(value))
+        dir(value);
+}
+
+SharedImageStore::SharedImageStore(const std::string& dir, size_t max_bytes)
+    : m_max_bytes(max_bytes)
+{
+    this->dir(dir);
+}
+
+void SharedImageStore::dir(const std::string& dir)
+{
+    if (!dir.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec)
+        {
+            detail::warn("unable to create shared cache {}: {}", dir, ec.message());
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dir = dir;
+}
+
+std::string SharedImageStore::dir() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dir;
+}
+
+bool SharedImageStore::enabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_dir.empty();
+}
+
+void SharedImageStore::max_bytes(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_max_bytes = bytes;
+    }
+
+    if (bytes)
+        trim(bytes);
+}
+
+size_t SharedImageStore::max_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_bytes;
+}
+
+uint64_t SharedImageStore::hash(const unsigned char* data, size_t len) noexcept
+{
+    const std::string_view content(reinterpret_cast<const char*>(data), len);
+    // spread a 32 bit hash over the 64 bits, the size tells most images apart anyway
+    return (static_cast<uint64_t>(std::hash<std::string_view>()(content)) *
+            0x9e3779b97f4a7c15ULL) ^ len;
+}
+
+std::string SharedImageStore::path(uint64_t hash, float hscale, float vscale) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dir.empty())
+        return {};
+
+    return fmt::format("{}/{:016x}-{:.4f}x{:.4f}{}", m_dir, hash, hscale, vscale, EXTENSION);
+}
+
+shared_cairo_surface_t SharedImageStore::find(uint64_t hash, float hscale, float vscale) const
+{
+    const auto file = path(hash, hscale, vscale);
+    if (file.empty())
+        return nullptr;
+
+    auto image = load_eraw(file);
+    if (image)
+    {
+        // the modification time orders the files for trim()
+        ::utimensat(AT_FDCWD, file.c_str(), nullptr, 0);
+        EGTLOG_DEBUG("shared image {}", file);
+    }
+    return image;
+}
+
+shared_cairo_surface_t SharedImageStore::publish(uint64_t hash, float hscale, float vscale,
+        const shared_cairo_surface_t& image)
+{
+    if (!image || cairo_surface_get_type(image.get()) != CAIRO_SURFACE_TYPE_IMAGE ||
+        cairo_surface_status(image.get()) != CAIRO_STATUS_SUCCESS)
+        return image;
+
+    const auto format = cairo_image_surface_get_format(image.get());
+    if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+        return image;
+
+    const auto file = path(hash, hscale, vscale);
+    if (file.empty())
+        return image;
+
+    const auto width = cairo_image_surface_get_width(image.get());
+    const auto height = cairo_image_surface_get_height(image.get());
+
+    // ERAW pixels are ARGB32 without padding, RGB24 pixels are made opaque
+    auto pixels = image;
+    if (format != CAIRO_FORMAT_ARGB32 ||
+        cairo_image_surface_get_stride(image.get()) != width * static_cast<int>(sizeof(uint32_t)))
+    {
+        pixels = shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height),
+                                        cairo_surface_destroy);
+        auto cr = shared_cairo_t(cairo_create(pixels.get()), cairo_destroy);
+        cairo_set_source_surface(cr.get(), image.get(), 0, 0);
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_paint(cr.get());
+    }
+    cairo_surface_flush(pixels.get());
+
+    // written aside and renamed, so other processes never map a partial file
+    static std::atomic<uint64_t> counter{0};
+    const auto tmp = fmt::format("{}.{}.{}.tmp", file, ::getpid(), ++counter);
+    ErawImage::save(tmp, cairo_image_surface_get_data(pixels.get()), width, height,
+                    ErawImage::Format::raw);
+
+    std::error_code ec;
+    const auto size = fs::file_size(tmp, ec);
+    if (ec || size < ErawImage::raw_offset() + ErawImage::raw_size(width, height) ||
+        std::rename(tmp.c_str(), file.c_str()))
+    {
+        detail::warn("unable to publish shared image {}", file);
+        fs::remove(tmp, ec);
+        return image;
+    }
+
+    EGTLOG_DEBUG("published shared image {}", file);
+
+    const auto limit = max_bytes();
+    if (limit)
+        trim(limit);
+
+    // the pixels of this process are freed in favor of the shared ones
+    auto shared = load_eraw(file);
+    return shared ? shared : image;
+}
+
+namespace
+{
+struct Entry
+{
+    fs::path path;
+    fs::file_time_type time;
+    size_t size;
+};
+
+/// The files of the store.
+std::vector<Entry> entries(const std::string& dir)
+{
+    std::vector<Entry> result;
+    if (dir.empty())
+        return result;
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec))
+    {
+        if (entry.path().extension() != EXTENSION)
+            continue;
+
+        std::error_code e;
+        const auto size = entry.file_size(e);
+        const auto time = entry.last_write_time(e);
+        if (!e)
+            result.push_back({entry.path(), time, static_cast<size_t>(size)});
+    }
+    return result;
+}
+}
+
+size_t SharedImageStore::bytes() const
+{
+    size_t total = 0;
+    for (const auto& entry : entries(dir()))
+        total += entry.size;
+    return total;
+}
+
+size_t SharedImageStore::trim(size_t bytes)
+{
+    auto files = entries(dir());
+
+    size_t total = 0;
+    for (const auto& entry : files)
+        total += entry.size;
+
+    std::sort(files.begin(), files.end(), [](const Entry & a, const Entry & b)
+    {
+        return a.time < b.time;
+    });
+
+    // processes that mapped a removed file keep their pixels
+    size_t removed = 0;
+    for (const auto& entry : files)
+    {
+        if (total <= bytes)
+            break;
+
+        std::error_code ec;
+        if (fs::remove(entry.path, ec))
+        {
+            total -= entry.size;
+            removed += entry.size;
+        }
+    }
+
+    if (removed)
+        EGTLOG_DEBUG("shared cache: removed {} bytes", removed);
+    return removed;
+}
+
+void SharedImageStore::clear()
+{
+    trim(0);
+}
+
+SharedImageStore& shared_image_store()
+{
+    static SharedImageStore store;
+    return store;
+}
+
+}
+}
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "detail/erawimage.h"
+#include "detail/snapshot.h"
+#include "egt/types.h"
+#include <algorithm>
+#include <cairo.h>
+#include <cstring>
+#include <fstream>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static bool cairo_write_png(const std::string& path, const shared_cairo_surface_t& surface)
+{
+#if CAIRO_HAS_PNG_FUNCTIONS == 1
+    return cairo_surface_write_to_png(surface.get(), path.c_str()) == CAIRO_STATUS_SUCCESS;
+#else
+    detail::ignoreparam(path);
+    detail::ignoreparam(surface);
+    detail::error("png support not available");
+    return false;
+#endif
+}
+
+#ifdef HAVE_ZLIB
+
+static void put32(uint8_t* p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static void write_chunk(std::ostream& o, const char* type,
+                        const uint8_t* data, size_t size)
+{
+    uint8_t header[8];
+    put32(header, size);
+    memcpy(header + 4, type, 4);
+
+    auto crc = crc32(0, header + 4, 4);
+    if (size)
+        crc = crc32(crc, data, size);
+
+    uint8_t footer[4];
+    put32(footer, crc);
+
+    o.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (size)
+        o.write(reinterpret_cast<const char*>(data), size);
+    o.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+}
+
+/// Convert a row to RGBA, or RGB, bytes, after its filter byte.
+static void png_row(const uint32_t* src, uint8_t* dst, int width, bool alpha)
+{
+    *dst++ = 0;
+
+    for (int x = 0; x < width; ++x)
+    {
+        const auto p = src[x];
+        uint32_t a = p >> 24;
+        uint32_t r = (p >> 16) & 0xff;
+        uint32_t g = (p >> 8) & 0xff;
+        uint32_t b = p & 0xff;
+
+        if (!alpha)
+        {
+            *dst++ = r;
+            *dst++ = g;
+            *dst++ = b;
+            continue;
+        }
+
+        if (a && a != 0xff)
+        {
+            r = (r * 0xff + a / 2) / a;
+            g = (g * 0xff + a / 2) / a;
+            b = (b * 0xff + a / 2) / a;
+        }
+
+        *dst++ = r;
+        *dst++ = g;
+        *dst++ = b;
+        *dst++ = a;
+    }
+}
+
+bool write_png(const std::string& path, const shared_cairo_surface_t& surface, int level)
+{
+    const auto format = cairo_image_surface_get_format(surface.get());
+    if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+        return cairo_write_png(path, surface);
+
+    const auto width = cairo_image_surface_get_width(surface.get());
+    const auto height = cairo_image_surface_get_height(surface.get());
+    const auto stride = cairo_image_surface_get_stride(surface.get());
+    const auto data = cairo_image_surface_get_data(surface.get());
+    const auto alpha = format == CAIRO_FORMAT_ARGB32;
+
+    std::ofstream o(path, std::ios_base::binary);
+    if (!o)
+        return false;
+
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    o.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    uint8_t ihdr[13];
+    put32(ihdr, width);
+    put32(ihdr + 4, height);
+    ihdr[8] = 8;
+    // truecolor with alpha, or truecolor
+    ihdr[9] = alpha ? 6 : 2;
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    write_chunk(o, "IHDR", ihdr, sizeof(ihdr));
+
+    z_stream stream{};
+    if (deflateInit(&stream, std::clamp(level, 0, 9)) != Z_OK)
+        return false;
+
+    const auto channels = alpha ? 4 : 3;
+    std::vector<uint8_t> row(1 + static_cast<size_t>(width) * channels);
+    std::vector<uint8_t> out(64 * 1024);
+    stream.next_out = out.data();
+    stream.avail_out = out.size();
+
+    bool ok = true;
+    for (int y = 0; ok && y <= height; ++y)
+    {
+        const auto last = y == height;
+        if (!last)
+        {
+            png_row(reinterpret_cast<const uint32_t*>(data + static_cast<size_t>(y) * stride),
+                    row.data(), width, alpha);
+            stream.next_in = row.data();
+            stream.avail_in = row.size();
+        }
+
+        // one IDAT chunk each time the output buffer is full
+        while (true)
+        {
+            const auto ret = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR)
+            {
+                ok = false;
+                break;
+            }
+
+            const auto full = !stream.avail_out;
+            if (full || (last && ret == Z_STREAM_END))
+            {
+                write_chunk(o, "IDAT", out.data(), out.size() - stream.avail_out);
+                stream.next_out = out.data();
+                stream.avail_out = out.size();
+            }
+
+            if (last ? ret == Z_STREAM_END : (!full && !stream.avail_in))
+                break;
+        }
+    }
+
+    deflateEnd(&stream);
+    if (!ok)
+        return false;
+
+    write_chunk(o, "IEND", nullptr, 0);
+    o.close();
+    return !o.fail();
+}
+
+#else
+
+bool write_png(const std::string& path, const shared_cairo_surface_t& surface, int level)
+{
+    detail::ignoreparam(level);
+    return cairo_write_png(path, surface);
+}
+
+#endif
+
+bool write_eraw(const std::string& path, const shared_cairo_surface_t& surface, bool rle)
+{
+    try
+    {
+        ErawImage::save(path, cairo_image_surface_get_data(surface.get()),
+                        cairo_image_surface_get_width(surface.get()),
+                        cairo_image_surface_get_height(surface.get()),
+                        rle ? ErawImage::Format::rle : ErawImage::Format::raw);
+    }
+    catch (const std::exception& e)
+    {
+        detail::warn("unable to write {}: {}", path, e.what());
+        return false;
+    }
+
+    return std::ifstream(path).good();
+}
+
+}
+}
+}
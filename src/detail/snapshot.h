@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_SNAPSHOT_H
+#define EGT_SRC_DETAIL_SNAPSHOT_H
+
+#include "egt/types.h"
+#include <string>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/*
+ * These take an image surface not drawn to meanwhile, so they can run on a
+ * worker thread while the screen draws the next frames.
+ */
+
+/**
+ * Write an image surface to a PNG file.
+ *
+ * ARGB32 and RGB24 images are written with zlib at the given level, without
+ * filtering, which is what costs the most for little gain on user
+ * interfaces.  Other formats, or all without zlib, go through cairo.
+ *
+ * @param[in] path File to write.
+ * @param[in] surface The image.
+ * @param[in] level zlib compression level, from 0 to 9.
+ * @return false on error.
+ */
+bool write_png(const std::string& path, const shared_cairo_surface_t& surface, int level);
+
+/**
+ * Write an image surface to an eraw file.
+ *
+ * @param[in] path File to write.
+ * @param[in] surface An ARGB32 or RGB24 image, with rows of width * 4 bytes.
+ * @param[in] rle Run length encode the pixels, else write them as is.
+ * @return false on error.
+ */
+bool write_eraw(const std::string& path, const shared_cairo_surface_t& surface, bool rle);
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/spanindex.h"
+#include <algorithm>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+DefaultDim SpanIndex::start(const Rect& rect) const
+{
+    return orientation == Orientation::vertical ? rect.top() : rect.left();
+}
+
+DefaultDim SpanIndex::end(const Rect& rect) const
+{
+    return orientation == Orientation::vertical ? rect.bottom() : rect.right();
+}
+
+void SpanIndex::build(const std::vector<Rect>& boxes, Orientation o)
+{
+    orientation = o;
+    dirty = false;
+
+    m_boxes = boxes;
+    m_entries.clear();
+    m_entries.reserve(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i)
+        m_entries.push_back({start(boxes[i]), static_cast<uint32_t>(i)});
+
+    // content is usually added in order, so this is mostly sorted already
+    std::stable_sort(m_entries.begin(), m_entries.end(),
+                     [](const Entry & lhs, const Entry & rhs) { return lhs.start < rhs.start; });
+
+    m_max_end.clear();
+    m_max_end.reserve(m_entries.size());
+    for (const auto& entry : m_entries)
+    {
+        const auto e = end(m_boxes[entry.index]);
+        m_max_end.push_back(m_max_end.empty() ? e : std::max(m_max_end.back(), e));
+    }
+}
+
+const std::vector<uint32_t>& SpanIndex::query(const Rect& rect)
+{
+    m_result.clear();
+
+    const auto first = start(rect);
+    const auto last = end(rect);
+
+    // skip the entries that all end before the range, then stop at the
+    // first entry starting after it
+    const auto begin = std::partition_point(m_max_end.begin(), m_max_end.end(),
+                                            [first](DefaultDim e) { return e <= first; }) - m_max_end.begin();
+    for (auto i = static_cast<size_t>(begin); i < m_entries.size(); ++i)
+    {
+        if (m_entries[i].start >= last)
+            break;
+
+        if (m_boxes[m_entries[i].index].intersect(rect))
+            m_result.push_back(m_entries[i].index);
+    }
+
+    std::sort(m_result.begin(), m_result.end());
+    return m_result;
+}
+
+}
+}
+}
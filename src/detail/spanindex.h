@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_SPANINDEX_H
+#define EGT_SRC_DETAIL_SPANINDEX_H
+
+#include <cstdint>
+#include <egt/geometry.h>
+#include <egt/widgetflags.h>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Rectangles sorted along one axis, used to find the rectangles in a range
+ * of that axis without testing all of them.
+ *
+ * Rectangles are identified by their index in the array given to build().
+ * This suits content laid out along the axis it scrolls in, like a long list
+ * or form, where a range only overlaps the few rectangles next to each other
+ * in it.
+ */
+class SpanIndex
+{
+public:
+
+    /**
+     * Rebuild the index for a set of rectangles.
+     *
+     * @param[in] boxes The rectangles.
+     * @param[in] orientation Axis the rectangles are sorted along.
+     */
+    void build(const std::vector<Rect>& boxes, Orientation orientation);
+
+    /**
+     * Get the indexes of the rectangles that intersect a rectangle.
+     *
+     * @return The indexes, in increasing order.  Valid until the next call.
+     */
+    const std::vector<uint32_t>& query(const Rect& rect);
+
+    /**
+     * Value of the owner's generation counter when the index was built.
+     */
+    uint32_t generation{0};
+
+    /**
+     * Set when the index needs to be built before use.
+     */
+    bool dirty{true};
+
+    /**
+     * Axis the rectangles were sorted along.
+     */
+    Orientation orientation{Orientation::vertical};
+
+protected:
+
+    struct Entry
+    {
+        /// Start of the rectangle along the axis.
+        DefaultDim start;
+        uint32_t index;
+    };
+
+    /// Start and end of a rectangle along the axis.
+    EGT_NODISCARD DefaultDim start(const Rect& rect) const;
+    EGT_NODISCARD DefaultDim end(const Rect& rect) const;
+
+    std::vector<Rect> m_boxes;
+    /// Sorted by start.
+    std::vector<Entry> m_entries;
+    /// Largest end of the entries up to each one, so it never decreases.
+    std::vector<DefaultDim> m_max_end;
+    std::vector<uint32_t> m_result;
+};
+
+}
+}
+}
+
+#endif
@@ -6,6 +6,9 @@
 #ifndef EGT_SRC_DETAIL_SPRITEIMPL_H
 #define EGT_SRC_DETAIL_SPRITEIMPL_H
 
+#include <algorithm>
+#include <chrono>
+#include <egt/animation.h>
 #include <egt/geometry.h>
 #include <egt/image.h>
 #include <vector>
@@ -33,6 +36,19 @@ public:
     {
         m_image.copy();
         m_strip = add_strip(framecount, frame_point);
+
+        m_animation.add_callback([this](EasingScalar value)
+        {
+            // the animation ended, on the value past the last frame
+            if (!m_animation.running() && m_loop)
+            {
+                m_animation.start();
+                return;
+            }
+
+            show_frame(std::min(static_cast<int>(value),
+                                m_strips[m_strip].framecount - 1));
+        });
     }
 
     // special functions deleted because they are never used
@@ -80,6 +96,38 @@ public:
         return m_strips[m_strip].framecount;
     }
 
+    /**
+     * Animate the frames of the current strip, from the first one.
+     */
+    void play(std::chrono::milliseconds frame_interval, bool loop)
+    {
+        const auto count = m_strips[m_strip].framecount;
+
+        m_animation.stop();
+        m_loop = loop;
+        m_animation.starting(0);
+        m_animation.ending(count);
+        m_animation.duration(frame_interval * count);
+        m_animation.interval(frame_interval);
+        m_animation.start();
+    }
+
+    /**
+     * Stop animating, on the current frame.
+     */
+    void stop()
+    {
+        m_animation.stop();
+    }
+
+    /**
+     * Returns true if the frames are being animated.
+     */
+    bool playing() const
+    {
+        return m_animation.running();
+    }
+
     /**
      * Information about a single sprite strip.
      */
@@ -97,7 +145,12 @@ public:
         if (id < m_strips.size() && id != m_strip)
         {
             m_strip = id;
-            m_index = 0;
+            m_index = -1;
+
+            if (playing())
+                play(m_animation.interval(), m_loop);
+            else
+                show_frame(0);
         }
     }
 
@@ -168,6 +221,16 @@ protected:
      * The current strip being used.
      */
     uint32_t m_strip{0};
+
+    /**
+     * Animation of the frames, stepped by the shared animation ticker.
+     */
+    AutoAnimation m_animation{std::chrono::milliseconds(0)};
+
+    /**
+     * Start again with the first frame after the last one.
+     */
+    bool m_loop{true};
 };
 
 }
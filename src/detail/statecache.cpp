@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/statecache.h"
+#include "egt/detail/surfacepool.h"
+#include "egt/painter.h"
+#include "egt/widget.h"
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+
+using Underlying = Widget::Flags::Underlying;
+
+constexpr Underlying bit(Widget::Flag flag)
+{
+    return static_cast<Underlying>(flag);
+}
+
+/// States a widget may change to with a tap, or by being disabled.
+constexpr uint32_t prerendered[] =
+{
+    0,
+    StateCache::ACTIVE,
+    StateCache::CHECKED,
+    StateCache::CHECKED | StateCache::ACTIVE,
+    StateCache::DISABLED,
+    StateCache::DISABLED | StateCache::CHECKED,
+};
+
+}
+
+/// Gives the state of a widget, without invoking anything.
+class StateCache::Flags
+{
+public:
+
+    Flags(Widget& widget, uint32_t state) noexcept
+        : m_widget(widget),
+          m_flags(widget.flags().raw()),
+          m_focus(widget.m_focus)
+    {
+        auto& flags = widget.flags().raw();
+        flags &= ~(bit(Widget::Flag::active) | bit(Widget::Flag::checked) |
+                   bit(Widget::Flag::disabled));
+        if (state & ACTIVE)
+            flags |= bit(Widget::Flag::active);
+        if (state & CHECKED)
+            flags |= bit(Widget::Flag::checked);
+        if (state & DISABLED)
+            flags |= bit(Widget::Flag::disabled);
+        widget.m_focus = state & FOCUS;
+    }
+
+    Flags(const Flags&) = delete;
+    Flags& operator=(const Flags&) = delete;
+
+    ~Flags() noexcept
+    {
+        m_widget.flags().raw() = m_flags;
+        m_widget.m_focus = m_focus;
+    }
+
+private:
+    Widget& m_widget;
+    Underlying m_flags;
+    bool m_focus;
+};
+
+uint32_t StateCache::state(const Widget& widget)
+{
+    uint32_t state = 0;
+    if (widget.active())
+        state |= ACTIVE;
+    if (widget.checked())
+        state |= CHECKED;
+    if (widget.disabled())
+        state |= DISABLED;
+    if (widget.focus())
+        state |= FOCUS;
+    return state;
+}
+
+void StateCache::draw(Widget& widget, Painter& painter, const Rect& rect)
+{
+    if (m_size != widget.size() || m_theme != &widget.theme())
+    {
+        m_size = widget.size();
+        m_theme = &widget.theme();
+        for (auto& surface : m_surfaces)
+            surface.reset();
+        m_valid = 0;
+    }
+
+    const auto current = state(widget);
+    if (!valid(current))
+    {
+        render(widget, current);
+
+        // the states of a tap are rendered with the one shown, so the
+        // first change of state does not draw the widget either
+        const auto focus = current & FOCUS;
+        for (auto s : prerendered)
+            if (!valid(s | focus))
+                render(widget, s | focus);
+    }
+
+    auto cr = painter.context().get();
+    cairo_set_source_surface(cr, m_surfaces[current].get(), widget.x(), widget.y());
+    cairo_rectangle(cr, rect.x(), rect.y(), rect.width(), rect.height());
+    cairo_fill(cr);
+}
+
+void StateCache::render(Widget& widget, uint32_t state)
+{
+    auto& surface = m_surfaces[state];
+    if (!surface)
+        surface = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, m_size);
+
+    auto cr = shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr.get());
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_OVER);
+
+    {
+        Flags flags(widget, state);
+        m_rendering = true;
+
+        Painter painter(cr);
+        painter.translate(-widget.point());
+        widget.draw(painter, widget.box());
+
+        m_rendering = false;
+    }
+
+    cairo_surface_flush(surface.get());
+    m_valid |= 1u << state;
+}
+
+}
+}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_STATECACHE_H
+#define EGT_SRC_DETAIL_STATECACHE_H
+
+#include "egt/geometry.h"
+#include "egt/types.h"
+#include <array>
+#include <cstdint>
+
+namespace egt
+{
+inline namespace v1
+{
+class Painter;
+class Theme;
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Renderings of a widget in each of its states.
+ *
+ * The widget is drawn once per state, normal, pressed, checked and disabled,
+ * into surfaces of its size, and a change of state only paints the surface
+ * of the new state.  States other than those, like the widget having the
+ * focus, are rendered when first shown.
+ *
+ * The renderings are only valid as long as nothing but the state of the
+ * widget changes, so the widget calls invalidate() for any other damage.
+ */
+class StateCache
+{
+public:
+
+    /// Bits of the state of a widget.
+    enum : uint32_t
+    {
+        ACTIVE = 1u << 0,
+        CHECKED = 1u << 1,
+        DISABLED = 1u << 2,
+        FOCUS = 1u << 3,
+        STATES = 1u << 4,
+    };
+
+    /// Get the state of a widget.
+    static uint32_t state(const Widget& widget);
+
+    /**
+     * Paint the current state of a widget, rendering the states first if
+     * needed.
+     *
+     * The states are rendered with Widget::draw(), which must paint the
+     * widget itself while rendering() is true.
+     */
+    void draw(Widget& widget, Painter& painter, const Rect& rect);
+
+    /// Drop the renderings, after the content of the widget changed.
+    void invalidate() { m_valid = 0; }
+
+    /// Returns true while a state is being rendered.
+    EGT_NODISCARD bool rendering() const { return m_rendering; }
+
+    /// Returns true if a state is rendered.
+    EGT_NODISCARD bool valid(uint32_t state) const { return m_valid & (1u << state); }
+
+private:
+
+    /// Render a state of a widget into its surface.
+    void render(Widget& widget, uint32_t state);
+
+    /// Surface of every state.
+    std::array<shared_cairo_surface_t, STATES> m_surfaces;
+    /// Bit of every state rendered.
+    uint32_t m_valid{0};
+    /// Size of the surfaces.
+    Size m_size;
+    /// Theme the states were rendered with.
+    const Theme* m_theme{nullptr};
+    bool m_rendering{false};
+
+    class Flags;
+};
+
+}
+}
+}
+
+#endif
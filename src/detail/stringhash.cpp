@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/detail/stringhash.h"
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+struct StringViewHash
+{
+    size_t operator()(std::string_view str) const
+    {
+        return hash(str);
+    }
+};
+
+struct StringTable
+{
+    std::mutex mutex;
+    /// Interned strings, which a deque never moves.
+    std::deque<std::string> strings;
+    /// Views of the interned strings, for lookup.
+    std::unordered_set<std::string_view, StringViewHash> index;
+};
+
+StringTable& string_table()
+{
+    // never destroyed, so views stay valid in static destructors
+    static auto* table = new StringTable;
+    return *table;
+}
+}
+
+std::string_view intern(std::string_view str)
+{
+    auto& table = string_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto i = table.index.find(str);
+    if (i != table.index.end())
+        return *i;
+
+    table.strings.emplace_back(str);
+    return *table.index.insert(table.strings.back()).first;
+}
+
+}
+}
+}
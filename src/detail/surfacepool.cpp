@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "egt/detail/surfacepool.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Pixels of a bucket, and the pool to give them back to.
+struct SurfacePool::Buffer
+{
+    std::weak_ptr<Impl> pool;
+    cairo_format_t format;
+    int width;
+    int height;
+    int stride;
+    std::unique_ptr<uint8_t[]> data;
+
+    EGT_NODISCARD size_t bytes() const { return static_cast<size_t>(stride) * height; }
+};
+
+struct SurfacePool::Impl
+{
+    std::mutex mutex;
+    /// Pixels not in use, the most recently used last.
+    std::vector<std::unique_ptr<Buffer>> idle;
+    size_t idle_bytes{0};
+    size_t max_idle_bytes{DEFAULT_MAX_IDLE_BYTES};
+    size_t reused{0};
+
+    /// Free the least recently used pixels over a size.
+    void trim(size_t bytes)
+    {
+        size_t count = 0;
+        while (idle_bytes > bytes && count < idle.size())
+            idle_bytes -= idle[count++]->bytes();
+
+        if (!count)
+            return;
+
+        EGTLOG_TRACE("freeing {} pooled surfaces", count);
+        idle.erase(idle.begin(), idle.begin() + count);
+    }
+};
+
+static const cairo_user_data_key_t buffer_key{};
+
+void SurfacePool::release(void* data)
+{
+    std::unique_ptr<Buffer> buffer(static_cast<Buffer*>(data));
+
+    auto pool = buffer->pool.lock();
+    if (!pool)
+        return;
+
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->idle_bytes += buffer->bytes();
+    pool->idle.push_back(std::move(buffer));
+    pool->trim(pool->max_idle_bytes);
+}
+
+static int bucket(int value)
+{
+    return std::max(1, (value + SurfacePool::BUCKET - 1) / SurfacePool::BUCKET) *
+           SurfacePool::BUCKET;
+}
+
+SurfacePool::SurfacePool()
+    : m_impl(std::make_shared<Impl>())
+{}
+
+shared_cairo_surface_t SurfacePool::acquire(cairo_format_t format, const Size& size)
+{
+    const auto width = bucket(size.width());
+    const auto height = bucket(size.height());
+
+    std::unique_ptr<Buffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+
+        auto& idle = m_impl->idle;
+        auto i = std::find_if(idle.rbegin(), idle.rend(), [&](const std::unique_ptr<Buffer>& b)
+        {
+            return b->format == format && b->width == width && b->height == height;
+        });
+        if (i != idle.rend())
+        {
+            buffer = std::move(*i);
+            idle.erase(std::next(i).base());
+            m_impl->idle_bytes -= buffer->bytes();
+            ++m_impl->reused;
+        }
+    }
+
+    if (buffer)
+    {
+        // only the rows of the surface
+        std::memset(buffer->data.get(), 0,
+                    static_cast<size_t>(buffer->stride) * std::max(size.height(), 0));
+    }
+    else
+    {
+        const auto stride = cairo_format_stride_for_width(format, width);
+        buffer.reset(new Buffer{m_impl, format, width, height, stride,
+                                      std::unique_ptr<uint8_t[]>(new uint8_t[static_cast<size_t>(stride) * height]())});
+    }
+
+    auto surface = cairo_image_surface_create_for_data(buffer->data.get(), format,
+                   size.width(), size.height(), buffer->stride);
+    if (cairo_surface_set_user_data(surface, &buffer_key, buffer.get(), release) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(surface);
+        surface = cairo_image_surface_create(format, size.width(), size.height());
+    }
+    else
+    {
+        // owned by the surface now
+        buffer.release();
+    }
+
+    return {surface, cairo_surface_destroy};
+}
+
+void SurfacePool::clear()
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->idle.clear();
+    m_impl->idle_bytes = 0;
+}
+
+void SurfacePool::trim(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->trim(bytes);
+}
+
+size_t SurfacePool::idle_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->idle_bytes;
+}
+
+size_t SurfacePool::max_idle_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->max_idle_bytes;
+}
+
+void SurfacePool::max_idle_bytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    m_impl->max_idle_bytes = bytes;
+    m_impl->trim(bytes);
+}
+
+size_t SurfacePool::reused() const
+{
+    std::lock_guard<std::mutex> lock(m_impl->mutex);
+    return m_impl->reused;
+}
+
+SurfacePool::~SurfacePool() noexcept = default;
+
+SurfacePool& surface_pool()
+{
+    static SurfacePool pool;
+    return pool;
+}
+
+shared_cairo_t measure_context()
+{
+    static thread_local shared_cairo_t cr = []()
+    {
+        shared_cairo_surface_t surface(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1),
+                                       cairo_surface_destroy);
+        return shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
+    }();
+    return cr;
+}
+
+}
+}
+}
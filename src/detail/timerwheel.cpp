@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/timerwheel.h"
+#include <algorithm>
+#include <limits>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+TimerNode::~TimerNode() noexcept
+{
+    if (m_wheel)
+        m_wheel->cancel(*this);
+}
+
+TimerWheel::TimerWheel(asio::io_context& io)
+    : m_timer(io),
+      m_epoch(Clock::now())
+{
+}
+
+TimerWheel::~TimerWheel() noexcept
+{
+    // nodes may outlive the wheel, so make sure they don't point to it
+    for (auto& level : m_slots)
+    {
+        for (auto& slot : level)
+        {
+            while (slot.head)
+                unlink(*slot.head);
+        }
+    }
+}
+
+uint64_t TimerWheel::tick_of(Clock::time_point time, bool round_up) const
+{
+    if (time <= m_epoch)
+        return 0;
+
+    const auto elapsed = time - m_epoch;
+    const auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    auto tick = static_cast<uint64_t>(ticks.count());
+    if (round_up && ticks < elapsed)
+        tick++;
+    return tick;
+}
+
+void TimerWheel::schedule(TimerNode& node, Clock::time_point expiry)
+{
+    cancel(node);
+
+    // without timers, the wheel does not follow the clock, so catch up now
+    // instead of cascading through all the time that passed
+    if (!m_count)
+        m_now = std::max(m_now, tick_of(Clock::now(), false));
+
+    // ticks up to m_now already fired, so the earliest is the next one
+    node.m_tick = std::max(tick_of(expiry, true), m_now + 1);
+    link(node);
+
+    const auto deadline = m_epoch + std::chrono::milliseconds(node.m_tick) + m_slack;
+    if (deadline < m_armed)
+        rearm();
+}
+
+void TimerWheel::cancel(TimerNode& node) noexcept
+{
+    // the asio timer is left as is, and at worst wakes up for nothing
+    if (node.m_wheel == this)
+        unlink(node);
+}
+
+void TimerWheel::slack(std::chrono::milliseconds slack)
+{
+    m_slack = std::max(slack, std::chrono::milliseconds::zero());
+    rearm();
+}
+
+void TimerWheel::link(TimerNode& node)
+{
+    // timers further than the wheel reaches are parked in the last level, and
+    // cascade back down as time gets closer
+    const auto tick = node.m_tick - m_now >= RANGE ? m_now + RANGE - 1 : node.m_tick;
+    const auto delta = tick - m_now;
+
+    unsigned level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS)))
+        level++;
+
+    const auto slot = static_cast<unsigned>((tick >> (level * SLOT_BITS)) & SLOT_MASK);
+
+    // append, so timers that expire together fire in the order scheduled
+    auto& list = m_slots[level][slot];
+    node.m_wheel = this;
+    node.m_level = level;
+    node.m_slot = slot;
+    node.m_prev = list.tail;
+    node.m_next = nullptr;
+    if (list.tail)
+        list.tail->m_next = &node;
+    else
+        list.head = &node;
+    list.tail = &node;
+
+    m_occupied[level] |= uint64_t(1) << slot;
+    m_count++;
+}
+
+void TimerWheel::unlink(TimerNode& node) noexcept
+{
+    auto& list = m_slots[node.m_level][node.m_slot];
+    if (node.m_prev)
+        node.m_prev->m_next = node.m_next;
+    else
+        list.head = node.m_next;
+    if (node.m_next)
+        node.m_next->m_prev = node.m_prev;
+    else
+        list.tail = node.m_prev;
+
+    if (!list.head)
+        m_occupied[node.m_level] &= ~(uint64_t(1) << node.m_slot);
+
+    node.m_wheel = nullptr;
+    node.m_prev = nullptr;
+    node.m_next = nullptr;
+    m_count--;
+}
+
+void TimerWheel::cascade(unsigned level, unsigned slot)
+{
+    auto node = m_slots[level][slot].head;
+    m_slots[level][slot] = {};
+    m_occupied[level] &= ~(uint64_t(1) << slot);
+
+    while (node)
+    {
+        auto next = node->m_next;
+        m_count--;
+        link(*node);
+        node = next;
+    }
+}
+
+void TimerWheel::expire(Clock::time_point now)
+{
+    const auto target = tick_of(now, false);
+
+    while (m_now < target)
+    {
+        if (!m_count)
+        {
+            m_now = target;
+            break;
+        }
+
+        auto next = m_now + 1;
+
+        // cascades only happen at the start of a level 0 rotation, so skip
+        // straight to the next occupied slot or the end of the rotation
+        if (next & SLOT_MASK)
+        {
+            const auto bits = m_occupied[0] & (~uint64_t(0) << (next & SLOT_MASK));
+            if (bits)
+                next = (next & ~SLOT_MASK) | static_cast<uint64_t>(__builtin_ctzll(bits));
+            else
+                next = (m_now | SLOT_MASK) + 1;
+
+            if (next > target)
+            {
+                m_now = target;
+                break;
+            }
+        }
+
+        m_now = next;
+
+        for (auto level = LEVELS - 1; level > 0; --level)
+        {
+            const auto shift = level * SLOT_BITS;
+            if (!(next & ((uint64_t(1) << shift) - 1)))
+                cascade(level, static_cast<unsigned>((next >> shift) & SLOT_MASK));
+        }
+
+        // callbacks may schedule and cancel timers, so take one at a time
+        auto& list = m_slots[0][next & SLOT_MASK];
+        while (list.head)
+        {
+            auto& node = *list.head;
+            unlink(node);
+            if (node.callback)
+                node.callback();
+        }
+    }
+}
+
+uint64_t TimerWheel::earliest() const
+{
+    auto result = std::numeric_limits<uint64_t>::max();
+
+    for (unsigned level = 0; level < LEVELS; ++level)
+    {
+        if (!m_occupied[level])
+            continue;
+
+        // slots after the current one come first, and the current one last
+        const auto shift = level * SLOT_BITS;
+        const auto start = static_cast<unsigned>(((m_now >> shift) + 1) & SLOT_MASK);
+        const auto bits = m_occupied[level];
+        const auto rotated = (bits >> start) | (start ? bits << (SLOTS - start) : 0);
+        const auto slot = (start + __builtin_ctzll(rotated)) & SLOT_MASK;
+
+        for (auto node = m_slots[level][slot].head; node; node = node->m_next)
+            result = std::min(result, node->m_tick);
+    }
+
+    return result;
+}
+
+void TimerWheel::rearm()
+{
+    if (!m_count)
+    {
+        if (m_armed != Clock::time_point::max())
+        {
+            m_armed = Clock::time_point::max();
+            m_timer.cancel();
+        }
+        return;
+    }
+
+    const auto deadline = m_epoch + std::chrono::milliseconds(earliest()) + m_slack;
+    if (deadline == m_armed)
+        return;
+
+    m_armed = deadline;
+    m_timer.expires_at(deadline);
+    m_timer.async_wait([this](const asio::error_code & error)
+    {
+        // the timer was armed again, and that wait will follow
+        if (error)
+            return;
+
+        m_armed = Clock::time_point::max();
+        expire(Clock::now());
+        rearm();
+    });
+}
+
+}
+}
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_TIMERWHEEL_H
+#define EGT_SRC_DETAIL_TIMERWHEEL_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <egt/asio.hpp>
+#include <egt/detail/meta.h>
+#include <functional>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+class TimerWheel;
+
+/**
+ * A timer scheduled on a TimerWheel.
+ *
+ * The node is owned by whoever schedules it, and is unlinked from the wheel
+ * when destroyed.
+ */
+class TimerNode : private NonCopyable<TimerNode>
+{
+public:
+
+    TimerNode() = default;
+    TimerNode(TimerNode&&) = delete;
+    TimerNode& operator=(TimerNode&&) = delete;
+    ~TimerNode() noexcept;
+
+    /// Called by the wheel when the timer expires.
+    std::function<void()> callback;
+
+    /// Is the timer scheduled.
+    EGT_NODISCARD bool scheduled() const { return m_wheel; }
+
+private:
+
+    TimerWheel* m_wheel{nullptr};
+    TimerNode* m_prev{nullptr};
+    TimerNode* m_next{nullptr};
+    uint64_t m_tick{0};
+    uint8_t m_level{0};
+    uint8_t m_slot{0};
+
+    friend class TimerWheel;
+};
+
+/**
+ * Hierarchical timer wheel.
+ *
+ * Multiplexes any number of timers onto a single asio timer.  Time is
+ * counted in ticks of 1 ms, and every level of the wheel has 64 slots, each
+ * covering 64 times the span of a slot of the level below.  Scheduling and
+ * cancelling are O(1), and only the slots that hold timers are visited.
+ *
+ * With a slack, the asio timer is armed for the earliest expiry plus the
+ * slack, and every timer that expired by then fires in the same wakeup.
+ * Timers may fire late by up to the slack, but never early.
+ */
+class TimerWheel : private NonCopyable<TimerWheel>
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(asio::io_context& io);
+    TimerWheel(TimerWheel&&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+    ~TimerWheel() noexcept;
+
+    /**
+     * Schedule a timer, or reschedule it if already scheduled.
+     *
+     * @param[in] node The timer.
+     * @param[in] expiry When the callback of the timer is called.
+     */
+    void schedule(TimerNode& node, Clock::time_point expiry);
+
+    /**
+     * Unschedule a timer.  Does nothing if it is not scheduled.
+     */
+    void cancel(TimerNode& node) noexcept;
+
+    /**
+     * Set the time the wakeup of a timer may be delayed, to fire it along
+     * with later timers.
+     */
+    void slack(std::chrono::milliseconds slack);
+
+    /// Get the slack.
+    EGT_NODISCARD std::chrono::milliseconds slack() const { return m_slack; }
+
+    /// Number of scheduled timers.
+    EGT_NODISCARD size_t size() const { return m_count; }
+
+    /**
+     * Fire every timer that expired by now.
+     *
+     * Called when the asio timer wakes up.
+     */
+    void expire(Clock::time_point now);
+
+private:
+
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+    /// Ticks past which timers are parked in the last level.
+    static constexpr uint64_t RANGE = uint64_t(1) << (LEVELS * SLOT_BITS);
+
+    EGT_NODISCARD uint64_t tick_of(Clock::time_point time, bool round_up) const;
+    void link(TimerNode& node);
+    void unlink(TimerNode& node) noexcept;
+    void cascade(unsigned level, unsigned slot);
+    EGT_NODISCARD uint64_t earliest() const;
+    void rearm();
+
+    asio::steady_timer m_timer;
+    /// Time of tick 0.
+    Clock::time_point m_epoch;
+    /// Ticks up to and including this one have fired.
+    uint64_t m_now{0};
+    /// Timers of a slot, in the order they were linked.
+    struct Slot
+    {
+        TimerNode* head{nullptr};
+        TimerNode* tail{nullptr};
+    };
+
+    std::array<std::array<Slot, SLOTS>, LEVELS> m_slots{};
+    /// Bit n of a level is set when its slot n holds timers.
+    std::array<uint64_t, LEVELS> m_occupied{};
+    size_t m_count{0};
+    std::chrono::milliseconds m_slack{0};
+    /// When the asio timer is armed for, max() when not armed.
+    Clock::time_point m_armed{Clock::time_point::max()};
+};
+
+}
+}
+}
+
+#endif
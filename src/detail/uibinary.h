@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_UIBINARY_H
+#define EGT_SRC_DETAIL_UIBINARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Compiled UI format.
+ *
+ * A UI XML document compiled by ui-compile, so it can be loaded without
+ * parsing: the elements, attributes and strings are laid out so that the file
+ * is used in place, typically memory mapped.  Every string is stored once,
+ * and references are offsets from the field holding them, so the nodes can be
+ * walked from a pointer to them without knowing where the file starts.
+ *
+ * The nodes and attributes have the interface of the rapidxml ones used by
+ * UiLoader, so the same code loads both formats.
+ */
+namespace ui
+{
+
+/// Magic of a compiled UI file, "EGTU".
+constexpr uint32_t MAGIC = 0x55544745;
+
+/// Version of the format.
+constexpr uint32_t VERSION = 1;
+
+/// Value of the encoding attribute of a resource already decoded.
+constexpr const char* RAW_ENCODING = "raw";
+
+/// Offset from the field itself, or 0 for none.
+using Offset = int32_t;
+
+template<class T>
+inline const T* follow(const Offset& offset)
+{
+    if (!offset)
+        return nullptr;
+    return reinterpret_cast<const T*>(reinterpret_cast<const char*>(&offset) + offset);
+}
+
+struct Attribute
+{
+    Offset m_name;
+    Offset m_value;
+    Offset m_next;
+
+    const char* name() const { return follow<char>(m_name); }
+    const char* value() const { return follow<char>(m_value); }
+    const Attribute* next_attribute() const { return follow<Attribute>(m_next); }
+};
+
+struct Node
+{
+    Offset m_name;
+    Offset m_value;
+    uint32_t m_value_size;
+    Offset m_attribute;
+    Offset m_child;
+    Offset m_sibling;
+
+    const char* name() const { return follow<char>(m_name); }
+    size_t name_size() const { return std::strlen(name()); }
+    const char* value() const { return follow<char>(m_value); }
+    size_t value_size() const { return m_value_size; }
+
+    const Attribute* first_attribute(const char* name = nullptr) const
+    {
+        auto attr = follow<Attribute>(m_attribute);
+        while (attr && name && std::strcmp(attr->name(), name))
+            attr = attr->next_attribute();
+        return attr;
+    }
+
+    const Node* first_node(const char* name = nullptr) const
+    {
+        auto node = follow<Node>(m_child);
+        return (node && name && std::strcmp(node->name(), name)) ?
+               node->next_sibling(name) : node;
+    }
+
+    const Node* next_sibling(const char* name = nullptr) const
+    {
+        auto node = follow<Node>(m_sibling);
+        while (node && name && std::strcmp(node->name(), name))
+            node = follow<Node>(node->m_sibling);
+        return node;
+    }
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    /// Size of the file.
+    uint32_t size;
+    /// The document, whose children are the top level elements.
+    Offset m_document;
+
+    const Node* document() const { return follow<Node>(m_document); }
+};
+
+static_assert(sizeof(Attribute) == 12 && sizeof(Node) == 24 && sizeof(Header) == 16,
+              "compiled UI structures must not be padded");
+
+/**
+ * Check a compiled UI file before using it.
+ *
+ * Every offset must point forward and inside the file, so a corrupted file
+ * cannot be walked out of it or in a loop, and every node and attribute must
+ * be referenced once, so walking a file is linear in its size.
+ *
+ * @param data Start of the file, aligned on 4 bytes.
+ * @param len Size of the file.
+ * @return The header, or nullptr if the file is not a valid compiled UI file.
+ */
+inline const Header* verify(const void* data, size_t len)
+{
+    const auto begin = static_cast<const char*>(data);
+    const auto end = begin + len;
+
+    if (len < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % 4)
+        return nullptr;
+
+    const auto header = static_cast<const Header*>(data);
+    if (header->magic != MAGIC || header->version != VERSION ||
+        header->size != len || end[-1] != '\0')
+        return nullptr;
+
+    // a referenced object must be after its reference, aligned, and fit
+    const auto valid = [begin, end](const Offset & offset, size_t size, bool object)
+    {
+        if (offset <= 0)
+            return !offset;
+        const auto target = reinterpret_cast<const char*>(&offset) + offset;
+        if (target >= end || static_cast<size_t>(end - target) < size)
+            return false;
+        return !object || (target - begin) % 4 == 0;
+    };
+
+    if (!header->m_document || !valid(header->m_document, sizeof(Node), true))
+        return nullptr;
+
+    // nodes and attributes shared by several references would make a walk
+    // exponential, so any object reached twice is rejected
+    std::vector<bool> visited(len / 4);
+    const auto visit = [begin, &visited](const void* object)
+    {
+        const auto index = (static_cast<const char*>(object) - begin) / 4;
+        if (visited[index])
+            return false;
+        visited[index] = true;
+        return true;
+    };
+
+    // strings are terminated, as the file ends with a null character
+    std::vector<const Node*> nodes{header->document()};
+    while (!nodes.empty())
+    {
+        const auto node = nodes.back();
+        nodes.pop_back();
+
+        if (!visit(node))
+            return nullptr;
+
+        if (!valid(node->m_name, 1, false) || !valid(node->m_value, 1, false) ||
+            !valid(node->m_attribute, sizeof(Attribute), true) ||
+            !valid(node->m_child, sizeof(Node), true) ||
+            !valid(node->m_sibling, sizeof(Node), true))
+            return nullptr;
+
+        if (!node->name() || (node->value_size() &&
+                              (!node->value() ||
+                               static_cast<size_t>(end - node->value()) <= node->value_size())))
+            return nullptr;
+
+        for (auto attr = node->first_attribute(); attr; attr = attr->next_attribute())
+        {
+            if (!visit(attr) ||
+                !valid(attr->m_name, 1, false) || !valid(attr->m_value, 1, false) ||
+                !valid(attr->m_next, sizeof(Attribute), true) ||
+                !attr->name() || !attr->value())
+                return nullptr;
+        }
+
+        if (node->m_child)
+            nodes.push_back(follow<Node>(node->m_child));
+        if (node->m_sibling)
+            nodes.push_back(follow<Node>(node->m_sibling));
+    }
+
+    return header;
+}
+
+/**
+ * Write a compiled UI document, one element at a time.
+ *
+ * Elements are written as they begin, followed by whatever is added to them
+ * later, so every offset points forward.  Strings are interned, and written
+ * once at the end.
+ *
+ * @code{.cpp}
+ * Builder builder;
+ * builder.begin("");
+ * builder.begin("egt");
+ * builder.attribute("name", "value");
+ * builder.end();
+ * builder.end();
+ * builder.write(out);
+ * @endcode
+ *
+ * The first element is the document, whose children are the top level
+ * elements.
+ */
+class Builder
+{
+public:
+
+    Builder()
+        : m_data(sizeof(Header))
+    {}
+
+    /// Begin a child of the current element, which becomes the current one.
+    void begin(const std::string& name, const std::string& value = {})
+    {
+        const auto node = add(sizeof(Node));
+        if (m_stack.empty())
+        {
+            link(offsetof(Header, m_document), node);
+        }
+        else
+        {
+            auto& parent = m_stack.back();
+            link(parent.child ? parent.child + offsetof(Node, m_sibling) :
+                 parent.node + offsetof(Node, m_child), node);
+            parent.child = node;
+        }
+
+        m_stack.push_back({node, 0, 0});
+        string(node + offsetof(Node, m_name), name);
+        this->value(value);
+    }
+
+    /// Set the value of the current element.
+    void value(const std::string& value)
+    {
+        const auto node = m_stack.back().node;
+        string(node + offsetof(Node, m_value), value);
+        const auto size = static_cast<uint32_t>(value.size());
+        std::memcpy(&m_data[node + offsetof(Node, m_value_size)], &size, sizeof(size));
+    }
+
+    /// Add an attribute to the current element.
+    void attribute(const std::string& name, const std::string& value)
+    {
+        const auto attr = add(sizeof(Attribute));
+        auto& current = m_stack.back();
+        link(current.attribute ? current.attribute + offsetof(Attribute, m_next) :
+             current.node + offsetof(Node, m_attribute), attr);
+        current.attribute = attr;
+
+        string(attr + offsetof(Attribute, m_name), name);
+        string(attr + offsetof(Attribute, m_value), value);
+    }
+
+    /// End the current element, its parent becomes the current one.
+    void end()
+    {
+        m_stack.pop_back();
+    }
+
+    /// Number of elements begun and not ended.
+    size_t depth() const
+    {
+        return m_stack.size();
+    }
+
+    /// Write the document, which may be continued afterwards.
+    void write(std::ostream& out)
+    {
+        const auto strings = m_data.size();
+        for (const auto& s : m_strings)
+            link(s.first, strings + s.second);
+
+        // the file ends with a null character, even without strings
+        const char* nul = "";
+        const bool terminated = !m_table.empty();
+
+        Header header{};
+        std::memcpy(&header, m_data.data(), sizeof(header));
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.size = strings + m_table.size() + (terminated ? 0 : 1);
+        std::memcpy(m_data.data(), &header, sizeof(header));
+
+        out.write(m_data.data(), m_data.size());
+        out.write(m_table.data(), m_table.size());
+        if (!terminated)
+            out.write(nul, 1);
+    }
+
+private:
+
+    struct Open
+    {
+        size_t node;
+        size_t child;
+        size_t attribute;
+    };
+
+    size_t add(size_t size)
+    {
+        const auto pos = m_data.size();
+        m_data.resize(pos + size);
+        return pos;
+    }
+
+    void link(size_t field, size_t target)
+    {
+        const auto offset = static_cast<Offset>(static_cast<int64_t>(target) -
+                                                static_cast<int64_t>(field));
+        std::memcpy(&m_data[field], &offset, sizeof(offset));
+    }
+
+    /// Point a field to a string, once the strings are placed.
+    void string(size_t field, const std::string& s)
+    {
+        auto i = m_interned.find(s);
+        if (i == m_interned.end())
+        {
+            i = m_interned.emplace(s, m_table.size()).first;
+            m_table.append(s);
+            m_table.push_back('\0');
+        }
+
+        // a field set again, i.e. a value, keeps the last string
+        m_strings[field] = i->second;
+    }
+
+    std::vector<char> m_data;
+    std::vector<Open> m_stack;
+    std::string m_table;
+    std::unordered_map<std::string, size_t> m_interned;
+    /// Fields pointing to strings, and the offset of the string in m_table.
+    std::map<size_t, size_t> m_strings;
+};
+
+/**
+ * Compile a UI document.
+ *
+ * @param document The rapidxml document, or any node with the same interface.
+ * @param out Where to write the compiled document.
+ * @param transform Called with each element before it is written, and may
+ *                  change its value and add attributes, i.e. to decode a
+ *                  resource.
+ */
+template<class T, class F>
+void compile(const T& document, std::ostream& out, F transform)
+{
+    Builder builder;
+
+    const auto add = [&](const auto& self, const auto* node) -> void
+    {
+        std::string name(node->name(), node->name_size());
+        std::string value(node->value(), node->value_size());
+        std::vector<std::pair<std::string, std::string>> attributes;
+        for (auto attr = node->first_attribute(); attr; attr = attr->next_attribute())
+            attributes.emplace_back(attr->name(), attr->value());
+        transform(name, value, attributes);
+
+        builder.begin(name, value);
+        for (const auto& a : attributes)
+            builder.attribute(a.first, a.second);
+        for (auto child = node->first_node(); child; child = child->next_sibling())
+            self(self, child);
+        builder.end();
+    };
+    add(add, &document);
+
+    builder.write(out);
+}
+
+}
+}
+}
+}
+
+#endif
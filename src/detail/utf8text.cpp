@@ -3,9 +3,11 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/glyphatlas.h"
 #include "detail/utf8text.h"
 #include "egt/detail/layout.h"
 #include "egt/image.h"
+#include <tuple>
 
 namespace egt
 {
@@ -62,6 +64,12 @@ static void draw_text_setup(std::vector<detail::LayoutRect>& rects,
                                          delimiters.cend(),
                                          tokens);
     }
+    else if (is_ascii(text))
+    {
+        tokens.reserve(text.size());
+        for (auto c : text)
+            tokens.emplace_back(1, c);
+    }
     else
     {
         for (utf8_const_iterator ch(text.begin(), text.begin(), text.end());
@@ -76,18 +84,18 @@ static void draw_text_setup(std::vector<detail::LayoutRect>& rects,
     uint32_t default_behave = 0;
     uint32_t behave = default_behave;
 
-    for (const auto& t : tokens)
+    for (auto& t : tokens)
     {
         if (t == "\n")
         {
-            rects.emplace_back(behave, Rect(0, 0, 1, fe.height), t);
+            rects.emplace_back(behave, Rect(0, 0, 1, fe.height), std::move(t));
             behave |= LAY_BREAK;
         }
         else
         {
             cairo_text_extents_t te;
-            cairo_text_extents(cr, t.c_str(), &te);
-            rects.emplace_back(behave, Rect(0, 0, te.x_advance, fe.height), t);
+            detail::text_extents(cr, t, te);
+            rects.emplace_back(behave, Rect(0, 0, te.x_advance, fe.height), std::move(t));
             behave = default_behave;
         }
     }
@@ -95,220 +103,289 @@ static void draw_text_setup(std::vector<detail::LayoutRect>& rects,
 
 #define fl(f) static_cast<float>(f)
 
-void draw_text(Painter& painter,
-               const Rect& b,
-               const std::string& text,
-               const Font& font,
-               const TextBox::TextFlags& flags,
-               const AlignFlags& text_align,
-               Justification justify,
-               const Pattern& text_color,
-               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
-               size_t cursor_pos,
-               const Pattern& highlight_color,
-               size_t select_start,
-               size_t select_len)
+bool utf8_sanitize(std::string& str)
 {
-    auto cr = painter.context().get();
+    if (utf8_valid(str))
+        return false;
+
+    std::string valid;
+    valid.reserve(str.size());
+    utf8::replace_invalid(str.begin(), str.end(), std::back_inserter(valid));
+    str = std::move(valid);
+    return true;
+}
 
-    painter.set(font);
-    cairo_font_extents_t fe;
-    cairo_font_extents(cr, &fe);
+void Utf8Index::reset(const std::string& str)
+{
+    m_valid = true;
+    m_offsets.clear();
 
-    std::vector<detail::LayoutRect> rects;
+    const auto ascii = ascii_length(str.data(), str.size());
+    if (ascii == str.size())
+    {
+        m_size = ascii;
+        return;
+    }
 
-    draw_text_setup(rects,
-                    cr,
-                    fe,
-                    text,
-                    flags);
+    m_offsets.reserve(str.size() + 1);
+    for (size_t i = 0; i < ascii; ++i)
+        m_offsets.push_back(i);
 
-    detail::flex_layout(b, rects, justify, Orientation::flex, text_align);
+    for (auto i = str.begin() + ascii; i != str.end(); utf8::unchecked::next(i))
+        m_offsets.push_back(std::distance(str.begin(), i));
 
-    // draw the code points, cursor, and selected box
-    size_t pos = 0;
-    std::string last_char;
-    bool workaround = false;
-    for (const auto& r : rects)
+    m_size = m_offsets.size();
+    m_offsets.push_back(str.size());
+}
+
+/// Shared cache of the layouts of all text runs.
+struct TextLayoutCache
+{
+    /// Parameters of a layout.
+    struct Key
     {
-        float roff = 0.;
-        for (utf8_const_iterator ch(r.str.begin(), r.str.begin(), r.str.end());
-             ch != utf8_const_iterator(r.str.end(), r.str.begin(), r.str.end()); ++ch)
+        std::string text;
+        Font font;
+        Size box;
+        TextBox::TextFlags::Underlying flags;
+        uint32_t text_align;
+        Justification justify;
+        uint32_t image_align;
+        Size image_size;
+    };
+
+    struct KeyCompare
+    {
+        bool operator()(const Key& lhs, const Key& rhs) const
         {
-            float char_width = 0;
-            last_char = utf8_char_to_string(ch.base(), r.str.cend());
-
-            if (*ch != '\n')
-            {
-                cairo_text_extents_t te;
-                cairo_text_extents(cr, last_char.c_str(), &te);
-                char_width = te.x_advance;
+            // most keys differ by their text
+            if (lhs.text != rhs.text)
+                return lhs.text < rhs.text;
+            if (lhs.font.face() != rhs.font.face())
+                return lhs.font.face() < rhs.font.face();
+            if (!detail::float_equal(lhs.font.size(), rhs.font.size()))
+                return lhs.font.size() < rhs.font.size();
+            return std::make_tuple(lhs.font.weight(), lhs.font.slant(),
+                                   lhs.box.width(), lhs.box.height(),
+                                   lhs.flags, lhs.text_align, lhs.justify, lhs.image_align,
+                                   lhs.image_size.width(), lhs.image_size.height()) <
+                   std::make_tuple(rhs.font.weight(), rhs.font.slant(),
+                                   rhs.box.width(), rhs.box.height(),
+                                   rhs.flags, rhs.text_align, rhs.justify, rhs.image_align,
+                                   rhs.image_size.width(), rhs.image_size.height());
+        }
+    };
 
-                auto p = PointF(fl(b.x()) + fl(r.rect.x()) + roff + fl(te.x_bearing),
-                                fl(b.y()) + fl(r.rect.y()) + fl(te.y_bearing) - fl(fe.descent) + fl(fe.height));
+    using Cache = LruCache<Key, std::shared_ptr<const TextRun::Layout>,
+          OrderedIndex<Key, KeyCompare>>;
 
-                if (workaround)
-                    p.y(p.y() + fl(fe.height));
-
-                auto s = SizeF(char_width, r.rect.height());
+    static Cache& cache()
+    {
+        static Cache value{0, TextRun::DEFAULT_LAYOUT_CACHE_SIZE};
+        return value;
+    }
 
-                if (pos >= select_start && pos < select_start + select_len)
-                {
-                    auto p2 = PointF(fl(b.x()) + fl(r.rect.x()) + roff,
-                                     fl(b.y()) + fl(r.rect.y()));
+    /// Lay out text for the parameters of a run.
+    static std::shared_ptr<const TextRun::Layout> create(Painter& painter, const TextRun& run);
+};
 
-                    if (workaround)
-                        p2.y(p2.y() + fl(fe.height));
+std::shared_ptr<const TextRun::Layout> TextLayoutCache::create(Painter& painter, const TextRun& run)
+{
+    auto cr = painter.context().get();
 
-                    auto rect = RectF(p2, s);
-                    if (!rect.empty())
-                    {
-                        painter.set(highlight_color);
-                        painter.draw(rect);
-                        painter.fill();
-                    }
-                }
+    auto layout = std::make_shared<TextRun::Layout>();
+    layout->flags = run.m_flags;
 
-                painter.set(text_color);
-                painter.draw(p);
-                painter.draw(last_char);
+    const auto& image_size = run.m_image_size;
+    const auto& image_align = run.m_image_align;
+    auto& fe = layout->fe;
+    auto& rects = layout->rects;
 
-                roff += char_width;
-            }
-            else
-            {
-                if (!flags.is_set(TextBox::TextFlag::multiline))
-                    break;
+    cairo_font_extents(cr, &fe);
 
-                // if first char is a "\n" layout doesn't respond right
-                if (last_char.empty())
-                    workaround = true;
-            }
+    draw_text_setup(rects, cr, fe, run.m_text, run.m_flags);
 
-            // draw cursor if before current character
-            if (pos == cursor_pos)
-            {
-                if (draw_cursor)
-                {
-                    auto p = Point(b.x() + r.rect.x() + roff - char_width, b.y() + r.rect.y());
-                    draw_cursor(p, fe.height);
-                }
-            }
+    if (!image_size.empty())
+    {
+        if (image_align.is_set(AlignFlag::top))
+        {
+            detail::LayoutRect r(LAY_BREAK, Rect(0, 0, 1, fe.height), "\n");
+            rects.insert(rects.begin(), r);
 
-            pos++;
+            detail::LayoutRect r2(0, Rect(Point(), image_size));
+            rects.insert(rects.begin(), r2);
+        }
+        else if (image_align.is_set(AlignFlag::right))
+        {
+            rects.emplace_back(0, Rect(Point(), image_size));
+        }
+        else if (image_align.is_set(AlignFlag::bottom))
+        {
+            rects.emplace_back(LAY_BREAK, Rect(0, 0, 1, fe.height), "\n");
+            rects.emplace_back(0, Rect(Point(), image_size));
+        }
+        else
+        {
+            detail::LayoutRect r(0, Rect(Point(), image_size));
+            rects.insert(rects.begin(), r);
         }
     }
 
-    // handle cursor after last character
-    if (pos == cursor_pos)
+    detail::flex_layout(Rect(Point(), run.m_box), rects, run.m_justify,
+                        Orientation::flex, run.m_text_align);
+
+    auto& glyphs = layout->glyphs;
+    auto add_glyph = [&glyphs, cr](std::string str)
     {
-        if (draw_cursor)
+        TextRun::Glyph glyph;
+        glyph.str = std::move(str);
+        if (glyph.str != "\n")
+            detail::text_extents(cr, glyph.str, glyph.te);
+        glyphs.emplace_back(std::move(glyph));
+    };
+
+    layout->rect_glyphs.reserve(rects.size());
+    for (const auto& r : rects)
+    {
+        const auto first = glyphs.size();
+        if (is_ascii(r.str))
         {
-            if (!rects.empty())
-            {
-                auto p = b.point() + rects.back().rect.point() + Point(rects.back().rect.width(), 0);
-                if (workaround)
-                {
-                    p.y(p.y() + fe.height);
-                }
-
-                if (last_char == "\n")
-                {
-                    p.x(b.x());
-                    p.y(p.y() + fe.height);
-                }
-
-                draw_cursor(p, fe.height);
-            }
-            else
-                draw_cursor(b.point(), fe.height);
+            for (auto c : r.str)
+                add_glyph(std::string(1, c));
         }
+        else
+        {
+            for (utf8_const_iterator ch(r.str.begin(), r.str.begin(), r.str.end());
+                 ch != utf8_const_iterator(r.str.end(), r.str.begin(), r.str.end()); ++ch)
+                add_glyph(utf8_char_to_string(ch.base(), r.str.cend()));
+        }
+        layout->rect_glyphs.push_back(glyphs.size() - first);
     }
-}
 
+    return layout;
+}
 
-void draw_text(Painter& painter,
-               const Rect& b,
-               const std::string& text,
-               const Font& font,
-               const TextBox::TextFlags& flags,
-               const AlignFlags& text_align,
-               Justification justify,
-               const Pattern& text_color,
-               const AlignFlags& image_align,
-               const Image& image,
-               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
-               size_t cursor_pos,
-               const Pattern& highlight_color,
-               size_t select_start,
-               size_t select_len)
+bool TextRun::layout(Painter& painter,
+                     const Size& box,
+                     const std::string& text,
+                     const Font& font,
+                     const TextBox::TextFlags& flags,
+                     const AlignFlags& text_align,
+                     Justification justify,
+                     const AlignFlags& image_align,
+                     const Size& image_size)
 {
-    auto cr = painter.context().get();
-
     painter.set(font);
-    cairo_font_extents_t fe;
-    cairo_font_extents(cr, &fe);
 
-    std::vector<detail::LayoutRect> rects;
+    if (m_valid &&
+        m_box == box &&
+        m_text == text &&
+        m_font == font &&
+        m_flags == flags &&
+        m_text_align == text_align &&
+        m_justify == justify &&
+        m_image_align == image_align &&
+        m_image_size == image_size)
+        return false;
+
+    m_valid = true;
+    m_box = box;
+    m_text = text;
+    m_font = font;
+    m_flags = flags;
+    m_text_align = text_align;
+    m_justify = justify;
+    m_image_align = image_align;
+    m_image_size = image_size;
+
+    TextLayoutCache::Key key{text, font, box, flags.raw(), text_align.raw(),
+                             justify, image_align.raw(), image_size};
+
+    auto& cache = TextLayoutCache::cache();
+    if (auto cached = cache.find(key))
+    {
+        m_layout = *cached;
+        return true;
+    }
 
-    draw_text_setup(rects,
-                    cr,
-                    fe,
-                    text,
-                    flags);
+    m_layout = TextLayoutCache::create(painter, *this);
+    cache.insert(std::move(key), m_layout);
 
-    if (image_align.is_set(AlignFlag::top))
-    {
-        detail::LayoutRect r(LAY_BREAK, Rect(0, 0, 1, fe.height), "\n");
-        rects.insert(rects.begin(), r);
+    return true;
+}
 
-        detail::LayoutRect r2(0, Rect(Point(), image.size()));
-        rects.insert(rects.begin(), r2);
-    }
-    else if (image_align.is_set(AlignFlag::right))
-    {
-        rects.emplace_back(0, Rect(Point(), image.size()));
-    }
-    else if (image_align.is_set(AlignFlag::bottom))
-    {
-        rects.emplace_back(LAY_BREAK, Rect(0, 0, 1, fe.height), "\n");
-        rects.emplace_back(0, Rect(Point(), image.size()));
-    }
-    else
-    {
-        detail::LayoutRect r(0, Rect(Point(), image.size()));
-        rects.insert(rects.begin(), r);
-    }
+void TextRun::layout_cache_size(size_t layouts)
+{
+    TextLayoutCache::cache().max_entries(layouts);
+}
 
-    detail::flex_layout(b, rects, justify, Orientation::flex, text_align);
+size_t TextRun::layout_cache_size()
+{
+    return TextLayoutCache::cache().max_entries();
+}
+
+CacheStats TextRun::layout_cache_stats()
+{
+    return TextLayoutCache::cache().stats();
+}
+
+void TextRun::layout_cache_clear()
+{
+    TextLayoutCache::cache().clear();
+    TextLayoutCache::cache().reset_stats();
+}
+
+void TextRun::draw(Painter& painter,
+                   const Rect& b,
+                   const Pattern& text_color,
+                   const Image* image,
+                   const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+                   size_t cursor_pos,
+                   const Pattern& highlight_color,
+                   size_t select_start,
+                   size_t select_len) const
+{
+    if (!m_layout)
+        return;
+
+    const auto& fe = m_layout->fe;
+    const auto& rects = m_layout->rects;
+    const auto& flags = m_layout->flags;
 
     // draw the code points, cursor, and selected box
     size_t pos = 0;
-    std::string last_char;
+    static const std::string none;
+    const std::string* last_char = &none;
     bool workaround = false;
+    auto glyph = m_layout->glyphs.begin();
+    auto glyph_count = m_layout->rect_glyphs.begin();
     for (const auto& r : rects)
     {
+        // glyphs of the rect past a newline of a single line are skipped
+        const auto glyphs_end = glyph + *glyph_count++;
+
         if (r.str.empty())
         {
-            auto p = PointF(fl(b.x()) + fl(r.rect.x()),
-                            fl(b.y()) + fl(r.rect.y()));
+            if (image)
+            {
+                auto p = PointF(fl(b.x()) + fl(r.rect.x()),
+                                fl(b.y()) + fl(r.rect.y()));
 
-            painter.draw(p);
-            painter.draw(image);
+                painter.draw(p);
+                painter.draw(*image);
+            }
             continue;
         }
 
         float roff = 0.;
-        for (utf8_const_iterator ch(r.str.begin(), r.str.begin(), r.str.end());
-             ch != utf8_const_iterator(r.str.end(), r.str.begin(), r.str.end()); ++ch)
+        for (; glyph != glyphs_end; ++glyph)
         {
             float char_width = 0;
-            last_char = utf8_char_to_string(ch.base(), r.str.cend());
+            last_char = &glyph->str;
 
-            if (*ch != '\n')
+            if (*last_char != "\n")
             {
-                cairo_text_extents_t te;
-                cairo_text_extents(cr, last_char.c_str(), &te);
+                const cairo_text_extents_t& te = glyph->te;
                 char_width = te.x_advance;
 
                 auto p = PointF(fl(b.x()) + fl(r.rect.x()) + roff + fl(te.x_bearing),
@@ -338,17 +415,20 @@ void draw_text(Painter& painter,
 
                 painter.set(text_color);
                 painter.draw(p);
-                painter.draw(last_char);
+                painter.draw(*last_char);
 
                 roff += char_width;
             }
             else
             {
                 if (!flags.is_set(TextBox::TextFlag::multiline))
+                {
+                    glyph = glyphs_end;
                     break;
+                }
 
                 // if first char is a "\n" layout doesn't respond right
-                if (last_char.empty())
+                if (last_char->empty())
                     workaround = true;
             }
 
@@ -379,7 +459,7 @@ void draw_text(Painter& painter,
                     p.y(p.y() + fe.height);
                 }
 
-                if (last_char == "\n")
+                if (*last_char == "\n")
                 {
                     p.x(b.x());
                     p.y(p.y() + fe.height);
@@ -393,6 +473,107 @@ void draw_text(Painter& painter,
     }
 }
 
+bool TextRun::cached_size(const std::string& text, const Font& font, Size& size) const
+{
+    if (!m_size_valid || m_size_text != text || m_size_font != font)
+        return false;
+
+    size = m_size;
+    return true;
+}
+
+void TextRun::cache_size(const std::string& text, const Font& font, const Size& size)
+{
+    m_size_valid = true;
+    m_size_text = text;
+    m_size_font = font;
+    m_size = size;
+}
+
+void draw_text(Painter& painter,
+               TextRun& run,
+               const Rect& b,
+               const std::string& text,
+               const Font& font,
+               const TextBox::TextFlags& flags,
+               const AlignFlags& text_align,
+               Justification justify,
+               const Pattern& text_color,
+               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+               size_t cursor_pos,
+               const Pattern& highlight_color,
+               size_t select_start,
+               size_t select_len)
+{
+    run.layout(painter, b.size(), text, font, flags, text_align, justify);
+    run.draw(painter, b, text_color, nullptr, draw_cursor, cursor_pos,
+             highlight_color, select_start, select_len);
+}
+
+void draw_text(Painter& painter,
+               const Rect& b,
+               const std::string& text,
+               const Font& font,
+               const TextBox::TextFlags& flags,
+               const AlignFlags& text_align,
+               Justification justify,
+               const Pattern& text_color,
+               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+               size_t cursor_pos,
+               const Pattern& highlight_color,
+               size_t select_start,
+               size_t select_len)
+{
+    TextRun run;
+    draw_text(painter, run, b, text, font, flags, text_align, justify, text_color,
+              draw_cursor, cursor_pos, highlight_color, select_start, select_len);
+}
+
+void draw_text(Painter& painter,
+               TextRun& run,
+               const Rect& b,
+               const std::string& text,
+               const Font& font,
+               const TextBox::TextFlags& flags,
+               const AlignFlags& text_align,
+               Justification justify,
+               const Pattern& text_color,
+               const AlignFlags& image_align,
+               const Image& image,
+               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+               size_t cursor_pos,
+               const Pattern& highlight_color,
+               size_t select_start,
+               size_t select_len)
+{
+    run.layout(painter, b.size(), text, font, flags, text_align, justify,
+               image_align, image.size());
+    run.draw(painter, b, text_color, &image, draw_cursor, cursor_pos,
+             highlight_color, select_start, select_len);
+}
+
+void draw_text(Painter& painter,
+               const Rect& b,
+               const std::string& text,
+               const Font& font,
+               const TextBox::TextFlags& flags,
+               const AlignFlags& text_align,
+               Justification justify,
+               const Pattern& text_color,
+               const AlignFlags& image_align,
+               const Image& image,
+               const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+               size_t cursor_pos,
+               const Pattern& highlight_color,
+               size_t select_start,
+               size_t select_len)
+{
+    TextRun run;
+    draw_text(painter, run, b, text, font, flags, text_align, justify, text_color,
+              image_align, image, draw_cursor, cursor_pos, highlight_color,
+              select_start, select_len);
+}
+
 }
 }
 }
@@ -6,9 +6,14 @@
 #ifndef EGT_SRC_DETAIL_UTF8TEXT_H
 #define EGT_SRC_DETAIL_UTF8TEXT_H
 
+#include "egt/detail/layout.h"
+#include "egt/detail/lrucache.h"
+#include "egt/detail/pixelops.h"
 #include "egt/painter.h"
 #include "egt/text.h"
+#include <cairo.h>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utf8.h>
 #include <vector>
@@ -23,14 +28,91 @@ namespace detail
 using utf8_const_iterator = utf8::iterator<std::string::const_iterator>;
 using utf8_iterator = utf8::iterator<std::string::iterator>;
 
+/**
+ * Returns true if a string is pure ASCII, so has one code point per byte.
+ */
+inline bool is_ascii(const std::string& str)
+{
+    return ascii_length(str.data(), str.size()) == str.size();
+}
+
 /**
  * Returns the length of a utf-8 encoded string.
  */
 inline size_t utf8len(const std::string& str)
 {
-    return utf8::distance(str.begin(), str.end());
+    // the ASCII prefix has one code point per byte
+    const auto ascii = ascii_length(str.data(), str.size());
+    if (ascii == str.size())
+        return ascii;
+    return ascii + utf8::distance(str.begin() + ascii, str.end());
+}
+
+/**
+ * Returns true if a string is valid UTF-8.
+ */
+inline bool utf8_valid(const std::string& str)
+{
+    const auto ascii = ascii_length(str.data(), str.size());
+    return ascii == str.size() || utf8::is_valid(str.begin() + ascii, str.end());
 }
 
+/**
+ * Replace the invalid sequences of a string with U+FFFD.
+ *
+ * Text is validated once with this when it is set, so it is never validated
+ * again when measured or drawn.
+ *
+ * @return true if the string was changed.
+ */
+bool utf8_sanitize(std::string& str);
+
+/**
+ * Byte offsets of the code points of a UTF-8 string.
+ *
+ * Moving a cursor or a selection converts positions in code points to byte
+ * offsets, which otherwise walks the string from its beginning every time.
+ * The table is built once for a string, and not at all for an ASCII string,
+ * where positions are offsets.
+ */
+class Utf8Index
+{
+public:
+
+    /// Index a string, which must be valid UTF-8.
+    void reset(const std::string& str);
+
+    /// Forget the indexed string, after it changed.
+    void invalidate() { m_valid = false; }
+
+    /// Returns true if a string is indexed.
+    EGT_NODISCARD bool valid() const { return m_valid; }
+
+    /// Returns true if the indexed string is pure ASCII.
+    EGT_NODISCARD bool ascii() const { return m_offsets.empty(); }
+
+    /// Number of code points of the indexed string.
+    EGT_NODISCARD size_t size() const { return m_size; }
+
+    /**
+     * Byte offset of a code point, or of the end of the string for a
+     * position past the last code point.
+     */
+    EGT_NODISCARD size_t offset(size_t pos) const
+    {
+        if (pos > m_size)
+            pos = m_size;
+        return m_offsets.empty() ? pos : m_offsets[pos];
+    }
+
+private:
+
+    bool m_valid{false};
+    size_t m_size{0};
+    /// Offset of every code point and of the end, empty for ASCII.
+    std::vector<uint32_t> m_offsets;
+};
+
 /**
  * Convert a UTF-8 iterator to a standalone std::string.
  */
@@ -94,6 +176,137 @@ void tokenize_with_delimiters(T begin, T end,
         tokens.emplace_back(token);
 }
 
+/**
+ * Text laid out in a box, with the metrics of its characters.
+ *
+ * Laying out text measures every word and every character, so widgets keep
+ * a TextRun and lay out again only when the text, the font, the size of the
+ * box, or the alignment changes.
+ *
+ * Layouts are shared by all runs through a bounded cache, keyed on all the
+ * parameters of the layout.  A run laid out with the same parameters as
+ * another one, like the labels of a row of buttons, a label created again,
+ * or text drawn without a run of its own, takes the cached layout instead
+ * of wrapping and measuring the text again.
+ */
+class TextRun
+{
+public:
+
+    /**
+     * Lay out text in a box, unless already laid out with the same
+     * parameters.
+     *
+     * @param[in] painter Painter the text is measured with.
+     * @param[in] box Size of the box.
+     * @param[in] text The text.
+     * @param[in] font The font.
+     * @param[in] flags Text flags.
+     * @param[in] text_align Alignment of the text in the box.
+     * @param[in] justify Justification of the text.
+     * @param[in] image_align Alignment of the image, if any.
+     * @param[in] image_size Size of the image, empty for no image.
+     * @return true if the layout of the run changed.
+     */
+    bool layout(Painter& painter,
+                const Size& box,
+                const std::string& text,
+                const Font& font,
+                const TextBox::TextFlags& flags,
+                const AlignFlags& text_align,
+                Justification justify,
+                const AlignFlags& image_align = {},
+                const Size& image_size = {});
+
+    /**
+     * Draw the laid out text, and the image if any, in a box.
+     *
+     * The arguments are those of detail::draw_text().
+     */
+    void draw(Painter& painter,
+              const Rect& b,
+              const Pattern& text_color,
+              const Image* image,
+              const std::function<void(const Point& offset, size_t height)>& draw_cursor,
+              size_t cursor_pos,
+              const Pattern& highlight_color,
+              size_t select_start,
+              size_t select_len) const;
+
+    /**
+     * Get the size of text measured with a font, if it was the last one
+     * stored with cache_size().
+     */
+    bool cached_size(const std::string& text, const Font& font, Size& size) const;
+
+    /// Store the size of text measured with a font.
+    void cache_size(const std::string& text, const Font& font, const Size& size);
+
+    /**
+     * Set the maximum number of layouts in the shared cache.
+     *
+     * 0 is no limit.  Defaults to DEFAULT_LAYOUT_CACHE_SIZE.
+     */
+    static void layout_cache_size(size_t layouts);
+
+    /// Get the maximum number of layouts in the shared cache.
+    static size_t layout_cache_size();
+
+    /// Get the hit, miss, and eviction counters of the shared cache.
+    static CacheStats layout_cache_stats();
+
+    /// Drop all the layouts of the shared cache, and reset its counters.
+    static void layout_cache_clear();
+
+    /// Default maximum number of layouts in the shared cache.
+    static constexpr size_t DEFAULT_LAYOUT_CACHE_SIZE = 128;
+
+private:
+
+    struct Glyph
+    {
+        /// The character.
+        std::string str;
+        /// Extents of the character, empty for a newline.
+        cairo_text_extents_t te{};
+    };
+
+    /// Result of a layout, shared and never changed once cached.
+    struct Layout
+    {
+        TextBox::TextFlags flags;
+        cairo_font_extents_t fe{};
+        /// Laid out words or characters, and the image if any.
+        std::vector<LayoutRect> rects;
+        /// Characters of every rect, in order.
+        std::vector<Glyph> glyphs;
+        /// Number of characters of every rect.
+        std::vector<size_t> rect_glyphs;
+    };
+
+    friend struct TextLayoutCache;
+
+    /// Was the text laid out.
+    bool m_valid{false};
+    std::string m_text;
+    /// Fonts aren't default constructible without a screen.
+    Font m_font{Font::Size(1)};
+    Size m_box;
+    TextBox::TextFlags m_flags;
+    AlignFlags m_text_align;
+    Justification m_justify{Justification::start};
+    AlignFlags m_image_align;
+    Size m_image_size;
+
+    /// The layout, from the shared cache.
+    std::shared_ptr<const Layout> m_layout;
+
+    bool m_size_valid{false};
+    std::string m_size_text;
+    Font m_size_font{Font::Size(1)};
+    Size m_size;
+};
+
 }
 }
 }
@@ -13,6 +13,8 @@
 #include "egt/app.h"
 #include "egt/types.h"
 #include "egt/uri.h"
+#include <algorithm>
+#include <cstdlib>
 #include <string>
 
 #ifdef HAVE_LIBPLANES
@@ -20,6 +22,10 @@
 #include "egt/detail/screen/kmsscreen.h"
 #endif
 
+#ifdef HAVE_SIMD
+#include "Simd/SimdLib.hpp"
+#endif
+
 namespace egt
 {
 inline namespace v1
@@ -61,50 +67,171 @@ void GstAppSinkImpl::draw(Painter& painter, const Rect& rect)
     /*
      * its a Basic window copying buffer to Cairo surface.
      */
-    if (m_videosample)
+    if (!m_videosample || !frame_caps(gst_sample_get_caps(m_videosample)))
+        return;
+
+    GstBuffer* buffer = gst_sample_get_buffer(m_videosample);
+    if (!buffer)
+        return;
+
+    GstMapInfo map;
+    if (gst_buffer_map(buffer, &map, GST_MAP_READ))
     {
-        GstCaps* caps = gst_sample_get_caps(m_videosample);
-        GstStructure* capsStruct = gst_caps_get_structure(caps, 0);
-        int width = 0;
-        int height = 0;
-        gst_structure_get_int(capsStruct, "width", &width);
-        gst_structure_get_int(capsStruct, "height", &height);
-
-        gst_sample_ref(m_videosample);
-        GstBuffer* buffer = gst_sample_get_buffer(m_videosample);
-        if (buffer)
-        {
-            GstMapInfo map;
-            if (gst_buffer_map(buffer, &map, GST_MAP_READ))
-            {
-                auto box = m_interface.box();
-                auto surface = unique_cairo_surface_t(
-                                   cairo_image_surface_create_for_data(map.data,
-                                           CAIRO_FORMAT_RGB16_565,
-                                           width,
-                                           height,
-                                           cairo_format_stride_for_width(CAIRO_FORMAT_RGB16_565, width)));
-
-                if (cairo_surface_status(surface.get()) == CAIRO_STATUS_SUCCESS)
-                {
-                    auto cr = painter.context().get();
-                    if (width != box.width() || height != box.height())
-                    {
-                        double scalex = static_cast<double>(box.width()) / width;
-                        double scaley = static_cast<double>(box.height()) / height;
-                        cairo_scale(cr, scalex, scaley);
-                    }
-                    cairo_set_source_surface(cr, surface.get(), box.x(), box.y());
-                    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-                    cairo_paint(cr);
-                }
+        auto box = m_interface.box();
+        auto surface = frame_surface(map.data);
+        if (surface && box.size() != m_frame_size)
+            surface = scale_frame(surface, box.size());
 
-                m_position = GST_BUFFER_TIMESTAMP(buffer);
-                gst_buffer_unmap(buffer, &map);
-            }
+        if (surface)
+        {
+            auto cr = painter.context().get();
+            cairo_save(cr);
+            cairo_set_source_surface(cr, surface, box.x(), box.y());
+            cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+            cairo_rectangle(cr, box.x(), box.y(), box.width(), box.height());
+            cairo_fill(cr);
+            cairo_restore(cr);
         }
+
+        m_position = GST_BUFFER_TIMESTAMP(buffer);
+        gst_buffer_unmap(buffer, &map);
+    }
+
+    if (!m_videosample_shown)
+    {
+        m_videosample_shown = true;
+        frame_shown(m_appsink, m_videosample);
+    }
+}
+
+void GstAppSinkImpl::take_pending()
+{
+    GstSample* sample;
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        sample = m_pending;
+        m_pending = nullptr;
+    }
+
+    if (!sample)
+        return;
+
+    if (m_videosample)
+    {
+        if (!m_videosample_shown)
+            ++m_dropped;
         gst_sample_unref(m_videosample);
+    }
+
+    m_videosample = sample;
+    m_videosample_shown = false;
+    m_interface.damage();
+}
+
+bool GstAppSinkImpl::frame_caps(GstCaps* caps)
+{
+    if (!caps)
+        return false;
+
+    if (m_frame_caps && gst_caps_is_equal(m_frame_caps, caps))
+        return !m_frame_size.empty();
+
+    release_frames();
+    m_frame_caps = gst_caps_ref(caps);
+
+    GstStructure* capsStruct = gst_caps_get_structure(caps, 0);
+    int width = 0;
+    int height = 0;
+    gst_structure_get_int(capsStruct, "width", &width);
+    gst_structure_get_int(capsStruct, "height", &height);
+    m_frame_size = Size(width, height);
+
+    return !m_frame_size.empty();
+}
+
+cairo_surface_t* GstAppSinkImpl::frame_surface(unsigned char* data)
+{
+    auto i = std::find_if(m_frame_surfaces.begin(), m_frame_surfaces.end(),
+                          [data](const auto & s) { return s.first == data; });
+    if (i != m_frame_surfaces.end())
+    {
+        cairo_surface_mark_dirty(i->second.get());
+        return i->second.get();
+    }
+
+    auto surface = unique_cairo_surface_t(
+                       cairo_image_surface_create_for_data(data,
+                               m_frame_format,
+                               m_frame_size.width(),
+                               m_frame_size.height(),
+                               cairo_format_stride_for_width(m_frame_format, m_frame_size.width())));
+    if (cairo_surface_status(surface.get()) != CAIRO_STATUS_SUCCESS)
+        return nullptr;
+
+    // more buffers than a decoder pool holds, they are not reused
+    static constexpr size_t MAX_FRAME_SURFACES = 8;
+    if (m_frame_surfaces.size() >= MAX_FRAME_SURFACES)
+        m_frame_surfaces.erase(m_frame_surfaces.begin());
+
+    m_frame_surfaces.emplace_back(data, std::move(surface));
+    return m_frame_surfaces.back().second.get();
+}
+
+cairo_surface_t* GstAppSinkImpl::scale_frame(cairo_surface_t* frame, const Size& size)
+{
+    if (!m_scaled_frame ||
+        cairo_image_surface_get_width(m_scaled_frame.get()) != size.width() ||
+        cairo_image_surface_get_height(m_scaled_frame.get()) != size.height())
+    {
+        m_scaled_frame.reset(cairo_image_surface_create(m_frame_format,
+                             size.width(), size.height()));
+        if (cairo_surface_status(m_scaled_frame.get()) != CAIRO_STATUS_SUCCESS)
+        {
+            m_scaled_frame.reset();
+            return nullptr;
+        }
+    }
+
+    auto dst = m_scaled_frame.get();
+    cairo_surface_flush(dst);
 
+#ifdef HAVE_SIMD
+    // resized as 4 channels of 8 bits
+    if (m_frame_format != CAIRO_FORMAT_RGB16_565)
+    {
+        SimdResizeBilinear(cairo_image_surface_get_data(frame),
+                           m_frame_size.width(), m_frame_size.height(),
+                           cairo_image_surface_get_stride(frame),
+                           cairo_image_surface_get_data(dst),
+                           size.width(), size.height(),
+                           cairo_image_surface_get_stride(dst),
+                           4);
+        cairo_surface_mark_dirty(dst);
+        return dst;
+    }
+#endif
+
+    auto cr = unique_cairo_t(cairo_create(dst));
+    cairo_scale(cr.get(),
+                static_cast<double>(size.width()) / m_frame_size.width(),
+                static_cast<double>(size.height()) / m_frame_size.height());
+    cairo_set_source_surface(cr.get(), frame, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr.get()), CAIRO_FILTER_BILINEAR);
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+    cairo_paint(cr.get());
+
+    return dst;
+}
+
+void GstAppSinkImpl::release_frames()
+{
+    m_frame_surfaces.clear();
+    m_scaled_frame.reset();
+    m_frame_size = {};
+    if (m_frame_caps)
+    {
+        gst_caps_unref(m_frame_caps);
+        m_frame_caps = nullptr;
     }
 }
 
@@ -126,6 +253,9 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
             gst_structure_get_int(capsStruct, "height", &height);
             auto vs = egt::Size(width, height);
             auto b = impl->m_interface.content_area();
+            auto screen =
+                reinterpret_cast<detail::KMSOverlay*>(impl->m_interface.screen());
+            assert(screen);
             /*
              * If scaling is requested, it's normal that the size of the
              * VideoWindow is different from the size of the video. Don't drop
@@ -136,16 +266,21 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
              */
             if (impl->m_interface.hscale() == 1.0 && impl->m_interface.vscale() == 1.0)
             {
-                if (b.size() != vs)
+                // the plane scaler fits the video to the window
+                auto expected = impl->plane_scaled() ? screen->size() : b.size();
+                if (expected != vs)
                 {
                     if (Application::check_instance())
                     {
                         asio::post(Application::instance().event().io(), [impl, vs, b]()
                         {
+                            if (impl->plane_scale(vs, b.size()))
+                                return;
+
                             if (vs.width() < b.width() || vs.height() < b.height())
-                                impl->resize(vs);
+                                impl->scale_caps(vs);
                             else
-                                impl->resize(b.size());
+                                impl->scale_caps(b.size());
                         });
                     }
 
@@ -154,6 +289,25 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
                     return GST_FLOW_OK;
                 }
             }
+            else if (screen->size() != vs)
+            {
+                // frames are copied to the plane, they must have its size
+                if (Application::check_instance())
+                {
+                    auto size = screen->size();
+                    asio::post(Application::instance().event().io(), [impl, size]()
+                    {
+                        impl->scale_caps(size);
+                    });
+                }
+
+                gst_sample_unref(sample);
+                return GST_FLOW_OK;
+            }
+
+            // decoder buffers are shown as they are
+            if (impl->flip_dmabuf(sample))
+                return GST_FLOW_OK;
 
             GstBuffer* buffer = gst_sample_get_buffer(sample);
             if (buffer)
@@ -161,13 +315,11 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
                 GstMapInfo map;
                 if (gst_buffer_map(buffer, &map, GST_MAP_READ))
                 {
-                    auto screen =
-                        reinterpret_cast<detail::KMSOverlay*>(impl->m_interface.screen());
-                    assert(screen);
                     memcpy(screen->raw(), map.data, map.size);
                     screen->schedule_flip();
                     impl->m_position = GST_BUFFER_TIMESTAMP(buffer);
                     gst_buffer_unmap(buffer, &map);
+                    impl->frame_shown(impl->m_appsink, sample);
                 }
             }
             gst_sample_unref(sample);
@@ -175,15 +327,24 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
         else
 #endif
         {
-            if (Application::check_instance())
+            bool post;
             {
-                asio::post(Application::instance().event().io(), [impl, sample]()
+                std::lock_guard<std::mutex> lock(impl->m_pending_mutex);
+                // the event loop did not take the previous sample yet
+                post = !impl->m_pending;
+                if (impl->m_pending)
                 {
-                    if (impl->m_videosample)
-                        gst_sample_unref(impl->m_videosample);
+                    gst_sample_unref(impl->m_pending);
+                    ++impl->m_dropped;
+                }
+                impl->m_pending = sample;
+            }
 
-                    impl->m_videosample = sample;
-                    impl->m_interface.damage();
+            if (post && Application::check_instance())
+            {
+                asio::post(Application::instance().event().io(), [impl]()
+                {
+                    impl->take_pending();
                 });
             }
         }
@@ -192,7 +353,93 @@ GstFlowReturn GstAppSinkImpl::on_new_buffer(GstElement* elt, gpointer data)
     return GST_FLOW_ERROR;
 }
 
+bool GstAppSinkImpl::flip_dmabuf(GstSample* sample)
+{
+#ifdef HAVE_LIBPLANES
+    if (!m_dmabuf)
+        return false;
+
+    auto screen = reinterpret_cast<detail::KMSOverlay*>(m_interface.screen());
+    assert(screen);
+    if (!gstreamer_flip_dmabuf(screen, sample))
+    {
+        // copy the buffers from now on
+        m_dmabuf = false;
+        return false;
+    }
+
+    if (GstBuffer* buffer = gst_sample_get_buffer(sample))
+        m_position = GST_BUFFER_TIMESTAMP(buffer);
+    frame_shown(m_appsink, sample);
+
+    // the previous buffer was replaced once the flip returns, but the current
+    // one is still shown
+    if (m_scanout_prev)
+        gst_sample_unref(m_scanout_prev);
+    m_scanout_prev = m_scanout;
+    m_scanout = sample;
+
+    return true;
+#else
+    detail::ignoreparam(sample);
+    return false;
+#endif
+}
+
+void GstAppSinkImpl::release_scanout()
+{
+    for (auto sample : {&m_scanout, &m_scanout_prev})
+    {
+        if (*sample)
+        {
+            gst_sample_unref(*sample);
+            *sample = nullptr;
+        }
+    }
+}
+
+void GstAppSinkImpl::destroyPipeline()
+{
+    GstDecoderImpl::destroyPipeline();
+
+#ifdef HAVE_LIBPLANES
+    // the imported framebuffers keep the decoder buffers until released
+    if (m_interface.plane_window() && m_interface.screen())
+        reinterpret_cast<detail::KMSOverlay*>(m_interface.screen())->release_dmabufs();
+#endif
+    release_scanout();
+    m_dmabuf = true;
+
+    if (m_videosample)
+    {
+        gst_sample_unref(m_videosample);
+        m_videosample = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (m_pending)
+        {
+            gst_sample_unref(m_pending);
+            m_pending = nullptr;
+        }
+    }
+    release_frames();
+}
+
+GstAppSinkImpl::~GstAppSinkImpl()
+{
+    for (auto& preroll : m_prerolls)
+        release_preroll(preroll.second);
+    release_scanout();
+    release_frames();
+}
+
 std::string GstAppSinkImpl::create_pipeline()
+{
+    return pipeline_description(m_uri, m_audiodevice && m_audiotrack);
+}
+
+std::string GstAppSinkImpl::pipeline_description(const std::string& uri, bool audio)
 {
     std::string vc = " ! videoconvert ! video/x-raw,format=";
 #ifdef HAVE_LIBPLANES
@@ -203,12 +450,22 @@ std::string GstAppSinkImpl::create_pipeline()
         PixelFormat fmt = detail::egt_format(s->get_plane_format());
         EGTLOG_DEBUG("egt_format = {}", fmt);
 
+#ifdef HAVE_GSTREAMER_DMABUF
+        // let dmabufs of the decoder through when already in the plane format
+        vc = " ! videoconvert ! video/x-raw(ANY),format=";
+#endif
         vc += detail::gstreamer_format(fmt);
     }
     else
 #endif
     {
-        vc += "RGB16";
+        // frames in the screen format are painted without a conversion
+        m_frame_format = CAIRO_FORMAT_RGB16_565;
+        if (Application::check_instance() &&
+            Application::instance().screen()->format() != PixelFormat::rgb565)
+            m_frame_format = CAIRO_FORMAT_RGB24;
+
+        vc += detail::gstreamer_format(detail::egt_format(m_frame_format));
     }
 
     std::string a_pipe;
@@ -218,7 +475,7 @@ std::string GstAppSinkImpl::create_pipeline()
      * to contain the inner decoder's caps that have features.
      */
     std::string caps = " caps=video/x-raw(ANY)";
-    if (m_audiodevice && m_audiotrack)
+    if (audio)
     {
         caps += ";audio/x-raw(ANY)";
         a_pipe = "! queue ! audioconvert ! volume name=volume ! autoaudiosink sync=false";
@@ -233,8 +490,13 @@ std::string GstAppSinkImpl::create_pipeline()
         m_interface.resize(Size(32, 32));
     }
 
+    /*
+     * A plane decodes at the size of the video, and the plane scaler fits it
+     * to the window.  The caps are set to the window if it can't.
+     */
     std::string vscapf = " ! capsfilter name=vcaps";
-    if ((m_size.width() > 32) && (m_size.height() > 32))
+    if ((m_size.width() > 32) && (m_size.height() > 32) &&
+        !(m_interface.plane_window() && plane_scaling()))
     {
         vscapf = fmt::format(vscapf + " caps=video/x-raw,width={},height={} ",
                              m_size.width(), m_size.height());
@@ -244,7 +506,97 @@ std::string GstAppSinkImpl::create_pipeline()
         "uridecodebin uri={} expose-all-streams=false name=video " \
         " {} video. {} ! videoscale {} ! appsink name=appsink video. {} ";
 
-    return fmt::format(pipeline, m_uri, caps, vc, vscapf, a_pipe);
+    return fmt::format(pipeline, uri, caps, vc, vscapf, a_pipe);
+}
+
+void GstAppSinkImpl::preload(const std::string& uri)
+{
+    if (uri == m_uri)
+        return;
+
+    for (const auto& preroll : m_prerolls)
+        if (preroll.first == uri)
+            return;
+
+    // the pipeline differs with an audio track
+    auto with_audio = pipeline_description(uri, m_audiodevice);
+    auto without_audio = pipeline_description(uri, false);
+
+    // the discoverer and the preroll block, so don't wait for them here
+    auto preroll = std::async(std::launch::async,
+                              [uri, with_audio, without_audio]()
+    {
+        Preroll result;
+#ifdef HAVE_GSTREAMER_PBUTILS
+        Uri u(uri);
+        if (u.scheme() != "rtsp")
+        {
+            std::string error;
+            if (!discover(uri, result.info, error))
+                return result;
+        }
+#endif
+        result.description = result.info.audiotrack ? with_audio : without_audio;
+
+        result.pipeline = gst_parse_launch(result.description.c_str(), nullptr);
+        if (!result.pipeline)
+            return result;
+
+        if (gst_element_set_state(result.pipeline, GST_STATE_PAUSED) == GST_STATE_CHANGE_FAILURE ||
+            gst_element_get_state(result.pipeline, nullptr, nullptr, 5 * GST_SECOND) == GST_STATE_CHANGE_FAILURE)
+        {
+            gst_element_set_state(result.pipeline, GST_STATE_NULL);
+            gst_object_unref(result.pipeline);
+            result.pipeline = nullptr;
+        }
+
+        return result;
+    });
+
+    static constexpr size_t MAX_PREROLLS = 3;
+    if (m_prerolls.size() >= MAX_PREROLLS)
+    {
+        release_preroll(m_prerolls.front().second);
+        m_prerolls.pop_front();
+    }
+
+    m_prerolls.emplace_back(uri, std::move(preroll));
+}
+
+GstElement* GstAppSinkImpl::take_preroll(const std::string& uri)
+{
+    auto i = std::find_if(m_prerolls.begin(), m_prerolls.end(),
+                          [&uri](const auto & preroll) { return preroll.first == uri; });
+    if (i == m_prerolls.end())
+        return nullptr;
+
+    auto preroll = i->second.get();
+    m_prerolls.erase(i);
+
+    if (!preroll.pipeline)
+        return nullptr;
+
+    // the window changed since the preload
+    if (preroll.description !=
+        pipeline_description(uri, m_audiodevice && preroll.info.audiotrack))
+    {
+        gst_element_set_state(preroll.pipeline, GST_STATE_NULL);
+        gst_object_unref(preroll.pipeline);
+        return nullptr;
+    }
+
+    media_info(preroll.info);
+    return preroll.pipeline;
+}
+
+void GstAppSinkImpl::release_preroll(std::future<Preroll>& preroll)
+{
+    auto pipeline = preroll.get().pipeline;
+    if (pipeline)
+    {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+    }
 }
 
 /* This function takes a textual representation of a pipeline
@@ -257,31 +609,36 @@ bool GstAppSinkImpl::media(const std::string& uri)
         /* Make sure we don't leave orphan references */
         destroyPipeline();
 
-#ifdef HAVE_GSTREAMER_PBUTILS
-        Uri u(m_uri);
-        if (u.scheme() != "rtsp")
+        // a preloaded media is already discovered and pre-rolled
+        m_pipeline = take_preroll(m_uri);
+        if (!m_pipeline)
         {
-            if (!start_discoverer())
+#ifdef HAVE_GSTREAMER_PBUTILS
+            Uri u(m_uri);
+            if (u.scheme() != "rtsp")
             {
-                detail::error("media file discoverer failed");
-                return false;
+                if (!start_discoverer())
+                {
+                    detail::error("media file discoverer failed");
+                    return false;
+                }
             }
-        }
 #endif
 
-        const auto buffer = create_pipeline();
-        EGTLOG_DEBUG("{}", buffer);
+            const auto buffer = create_pipeline();
+            EGTLOG_DEBUG("{}", buffer);
 
-        GError* error = nullptr;
-        m_pipeline = gst_parse_launch(buffer.c_str(), &error);
-        if (!m_pipeline)
-        {
-            if (error && error->message)
+            GError* error = nullptr;
+            m_pipeline = gst_parse_launch(buffer.c_str(), &error);
+            if (!m_pipeline)
             {
-                detail::error("{}", error->message);
-                m_interface.on_error.invoke(error->message);
+                if (error && error->message)
+                {
+                    detail::error("{}", error->message);
+                    m_interface.on_error.invoke(error->message);
+                }
+                return false;
             }
-            return false;
         }
 
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
@@ -323,13 +680,10 @@ bool GstAppSinkImpl::media(const std::string& uri)
         m_bus = gst_pipeline_get_bus(GST_PIPELINE(m_pipeline));
         m_bus_watchid = gst_bus_add_watch(m_bus, &bus_callback, this);
 
-        g_timeout_add(5000, static_cast<GSourceFunc>(&post_position), this);
+        m_eventsource_id = g_timeout_add(5000, static_cast<GSourceFunc>(&post_position), this);
 
         if (!m_gmain_loop)
-        {
-            m_gmain_loop = g_main_loop_new(nullptr, false);
-            m_gmain_thread = std::thread(g_main_loop_run, m_gmain_loop);
-        }
+            m_gmain_loop = GstMainLoop::get();
     }
     return true;
 }
@@ -343,15 +697,9 @@ void GstAppSinkImpl::resize(const Size& size)
 {
     if (size != m_size)
     {
-        if (m_pipeline && m_vcapsfilter)
-        {
-            std::string vs = fmt::format("video/x-raw,width={},height={}", size.width(), size.height());
-            GstCaps* caps = gst_caps_from_string(vs.c_str());
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
-            g_object_set(G_OBJECT(m_vcapsfilter), "caps", caps, NULL);
-            EGTLOG_DEBUG("change gst videoscale element to {}", size);
-            gst_caps_unref(caps);
-        }
+        // the plane scaler is fitted again on the next frame
+        if (!plane_scaled())
+            scale_caps(size);
 
         if (m_size.empty())
         {
@@ -361,6 +709,90 @@ void GstAppSinkImpl::resize(const Size& size)
     }
 }
 
+void GstAppSinkImpl::scale_caps(const Size& size)
+{
+    if (m_pipeline && m_vcapsfilter)
+    {
+        std::string vs = fmt::format("video/x-raw,width={},height={}", size.width(), size.height());
+        GstCaps* caps = gst_caps_from_string(vs.c_str());
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        g_object_set(G_OBJECT(m_vcapsfilter), "caps", caps, NULL);
+        EGTLOG_DEBUG("change gst videoscale element to {}", size);
+        gst_caps_unref(caps);
+    }
+}
+
+bool GstAppSinkImpl::plane_scaling()
+{
+    static const auto value = std::getenv("EGT_VIDEO_PLANE_SCALE");
+    static const bool enabled = !value || std::string(value) != "0";
+    return enabled;
+}
+
+bool GstAppSinkImpl::plane_scale_supported(float scale)
+{
+    // HEO planes of Microchip display controllers scale within these bounds
+    static constexpr auto MIN_PLANE_SCALE = 0.25f;
+    static constexpr auto MAX_PLANE_SCALE = 4.0f;
+    return scale >= MIN_PLANE_SCALE && scale <= MAX_PLANE_SCALE;
+}
+
+bool GstAppSinkImpl::plane_scaled() const
+{
+    std::lock_guard<std::mutex> lock(m_plane_mutex);
+    return m_plane_scaled;
+}
+
+bool GstAppSinkImpl::plane_scale(const Size& video, const Size& box)
+{
+#ifdef HAVE_LIBPLANES
+    if (!m_interface.plane_window() || video.empty() || box.empty())
+        return false;
+
+    auto screen = reinterpret_cast<detail::KMSOverlay*>(m_interface.screen());
+    assert(screen);
+
+    const auto hscale = static_cast<float>(box.width()) / video.width();
+    const auto vscale = static_cast<float>(box.height()) / video.height();
+    const auto supported = plane_scaling() &&
+                           plane_scale_supported(hscale) && plane_scale_supported(vscale);
+
+    if (!supported)
+    {
+        // back to a plane of the size of the window, scaled by videoscale
+        if (plane_scaled())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_plane_mutex);
+                m_plane_scaled = false;
+            }
+            screen->resize(m_interface.box().size());
+            screen->scale(1.0, 1.0);
+            m_interface.damage();
+        }
+        return false;
+    }
+
+    // the plane holds frames of the video, and shows them the window size
+    if (screen->size() != video)
+        screen->resize(video);
+    screen->scale(hscale, vscale);
+    {
+        std::lock_guard<std::mutex> lock(m_plane_mutex);
+        m_plane_scaled = true;
+    }
+    // the plane is updated on the next draw of the window
+    m_interface.damage();
+
+    EGTLOG_DEBUG("plane scales video {} to {}", video, box);
+    return true;
+#else
+    detail::ignoreparam(video);
+    detail::ignoreparam(box);
+    return false;
+#endif
+}
+
 gboolean GstAppSinkImpl::post_position(gpointer data)
 {
     auto impl = static_cast<GstAppSinkImpl*>(data);
@@ -7,8 +7,13 @@
 #define EGT_SRC_DETAIL_VIDEO_GSTAPPSINKIMPL_H
 
 #include "detail/video/gstdecoderimpl.h"
+#include <deque>
+#include <future>
 #include <gst/app/gstappsink.h>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace egt
 {
@@ -28,15 +33,133 @@ public:
 
     std::string create_pipeline() override;
 
+    void preload(const std::string& uri) override;
+
     void scale(float scalex, float scaley) override;
 
     void resize(const Size& size) override;
 
+    void destroyPipeline() override;
+
+    ~GstAppSinkImpl() override;
+
 protected:
     GstElement* m_appsink;
 
+    /// A pipeline pre-rolled in the paused state.
+    struct Preroll
+    {
+        GstElement* pipeline{nullptr};
+        MediaInfo info;
+        /// Description of the pipeline.
+        std::string description;
+    };
+
+    /// Pipelines being pre-rolled by preload(), by URI.
+    std::deque<std::pair<std::string, std::future<Preroll>>> m_prerolls;
+
+    /// Get the description of the pipeline for a media.
+    std::string pipeline_description(const std::string& uri, bool audio);
+
+    /// Take the pipeline pre-rolled for a media, if still usable.
+    GstElement* take_preroll(const std::string& uri);
+
+    /// Release a pre-rolled pipeline.
+    static void release_preroll(std::future<Preroll>& preroll);
+
     GstSample* m_videosample{nullptr};
 
+    /// Was m_videosample drawn.
+    bool m_videosample_shown{false};
+
+    /**
+     * Sample decoded, and not taken by the event loop yet.
+     *
+     * A newer sample replaces it, so at most one sample waits for the event
+     * loop however slow it is.
+     */
+    GstSample* m_pending{nullptr};
+    std::mutex m_pending_mutex;
+
+    /// Take the pending sample to be drawn.
+    void take_pending();
+
+    /**
+     * Samples shown on the plane without a copy: the current one, and the
+     * previous one until the current one replaced it.
+     */
+    GstSample* m_scanout{nullptr};
+    GstSample* m_scanout_prev{nullptr};
+
+    /// Try to show dmabuf samples on the plane without a copy.
+    bool m_dmabuf{true};
+
+    /**
+     * Show a dmabuf sample on the plane without a copy.
+     *
+     * @return true if shown, and the sample is then owned until replaced.
+     */
+    bool flip_dmabuf(GstSample* sample);
+
+    /// Release the samples shown on the plane.
+    void release_scanout();
+
+    /// Format of the frames drawn in the window.
+    cairo_format_t m_frame_format{CAIRO_FORMAT_RGB16_565};
+
+    /// Caps of the frames drawn in the window, and their size.
+    GstCaps* m_frame_caps{nullptr};
+    Size m_frame_size;
+
+    /**
+     * Surfaces wrapping the frames, by address of their data.
+     *
+     * The buffers of the decoder pool are reused, so are their surfaces,
+     * until the caps change.
+     */
+    std::vector<std::pair<const void*, unique_cairo_surface_t>> m_frame_surfaces;
+
+    /// Frame scaled to the size of the window, reused between frames.
+    unique_cairo_surface_t m_scaled_frame;
+
+    /// Update the caps of the frames drawn in the window.
+    bool frame_caps(GstCaps* caps);
+
+    /// Get a surface wrapping the data of a frame.
+    cairo_surface_t* frame_surface(unsigned char* data);
+
+    /// Get the frame scaled to the size of the window.
+    cairo_surface_t* scale_frame(cairo_surface_t* frame, const Size& size);
+
+    /// Release the surfaces of the frames.
+    void release_frames();
+
+    /// Set the size the videoscale element scales the frames to.
+    void scale_caps(const Size& size);
+
+    /// Is the plane scaler used to fit the video to the window.
+    static bool plane_scaling();
+
+    /// Can the plane scaler scale by a factor.
+    static bool plane_scale_supported(float scale);
+
+    /**
+     * Fit frames of the video to the window with the plane scaler.
+     *
+     * The plane is resized to the video and scaled to the window, so frames
+     * are decoded and shown at the size of the video.
+     *
+     * @return false if the plane can't scale, and videoscale has to.
+     */
+    bool plane_scale(const Size& video, const Size& box);
+
+    /// Is the plane scaled to the window by plane_scale().
+    bool plane_scaled() const;
+
+    /// The plane is scaled to the window, protected by m_plane_mutex.
+    bool m_plane_scaled{false};
+    mutable std::mutex m_plane_mutex;
+
     static GstFlowReturn on_new_buffer(GstElement* elt, gpointer data);
 
     static gboolean post_position(gpointer data);
@@ -8,8 +8,10 @@
 #include "detail/video/gstdecoderimpl.h"
 #include "detail/video/gstmeta.h"
 #include "egt/app.h"
+#include <algorithm>
 #include <exception>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -131,6 +133,74 @@ bool GstDecoderImpl::has_audio() const
     return (m_audiodevice && m_audiotrack);
 }
 
+VideoStats GstDecoderImpl::stats() const
+{
+    VideoStats stats;
+    stats.rendered = m_rendered;
+    stats.dropped = m_dropped;
+    stats.late = m_late;
+    stats.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::nanoseconds(m_latency.load()));
+    return stats;
+}
+
+void GstDecoderImpl::reset_stats()
+{
+    m_rendered = 0;
+    m_dropped = 0;
+    m_late = 0;
+    m_latency = 0;
+    m_qos_dropped.clear();
+    m_qos_running = GST_CLOCK_TIME_NONE;
+    m_qos_time = GST_CLOCK_TIME_NONE;
+    m_qos_proportion = 1.0;
+}
+
+void GstDecoderImpl::frame_shown(GstElement* sink, GstSample* sample)
+{
+    ++m_rendered;
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    const GstSegment* segment = gst_sample_get_segment(sample);
+    if (!m_pipeline || !buffer || !segment || !GST_BUFFER_PTS_IS_VALID(buffer) ||
+        GST_STATE(m_pipeline) != GST_STATE_PLAYING)
+        return;
+
+    const auto running = gst_segment_to_running_time(segment, GST_FORMAT_TIME,
+                         GST_BUFFER_PTS(buffer));
+    GstClock* clock = gst_element_get_clock(m_pipeline);
+    if (!clock || !GST_CLOCK_TIME_IS_VALID(running))
+    {
+        if (clock)
+            gst_object_unref(clock);
+        return;
+    }
+
+    const auto now = gst_clock_get_time(clock) - gst_element_get_base_time(m_pipeline);
+    gst_object_unref(clock);
+
+    // positive when shown after the time of the frame
+    const auto jitter = GST_CLOCK_DIFF(running, now);
+    m_latency = (m_latency * 7 + std::max<GstClockTimeDiff>(jitter, 0)) / 8;
+
+    const auto duration = GST_BUFFER_DURATION_IS_VALID(buffer) ?
+                          static_cast<GstClockTimeDiff>(GST_BUFFER_DURATION(buffer)) : 0;
+    if (jitter > duration)
+        ++m_late;
+
+    // how much slower than the stream frames are shown
+    if (GST_CLOCK_TIME_IS_VALID(m_qos_running) && running > m_qos_running && now > m_qos_time)
+    {
+        const auto rate = static_cast<double>(now - m_qos_time) / (running - m_qos_running);
+        m_qos_proportion = std::min(std::max((m_qos_proportion * 7 + rate) / 8, 0.1), 10.0);
+    }
+    m_qos_running = running;
+    m_qos_time = now;
+
+    gst_element_send_event(sink, gst_event_new_qos(GST_QOS_TYPE_OVERFLOW,
+                           m_qos_proportion, jitter, running));
+}
+
 void GstDecoderImpl::destroyPipeline()
 {
     if (m_pipeline)
@@ -145,7 +215,11 @@ void GstDecoderImpl::destroyPipeline()
 
         if (m_bus)
         {
-            g_source_remove(m_bus_watchid);
+            if (m_bus_watchid > 0)
+            {
+                g_source_remove(m_bus_watchid);
+                m_bus_watchid = 0;
+            }
             gst_object_unref(m_bus);
             m_bus = nullptr;
         }
@@ -158,19 +232,13 @@ void GstDecoderImpl::destroyPipeline()
 
         if (m_gmain_loop)
         {
-            /*
-             * check loop is running to avoid race condition when stop is called too early
-             */
-            if (g_main_loop_is_running(m_gmain_loop))
-            {
-                //stop loop and wait
-                g_main_loop_quit(m_gmain_loop);
-            }
-            m_gmain_thread.join();
-            g_main_loop_unref(m_gmain_loop);
-            m_gmain_loop = nullptr;
+            // the loop is shared, only wait for our callbacks to be done
+            m_gmain_loop->sync();
+            m_gmain_loop.reset();
         }
     }
+
+    reset_stats();
 }
 
 GstDecoderImpl::~GstDecoderImpl() = default;
@@ -298,6 +366,24 @@ gboolean GstDecoderImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer
         }
         break;
     }
+    case GST_MESSAGE_QOS:
+    {
+        // frames dropped by the sink, or skipped by the decoder
+        GstFormat format;
+        guint64 processed = 0;
+        guint64 dropped = 0;
+        gst_message_parse_qos_stats(message, &format, &processed, &dropped);
+        if (format == GST_FORMAT_BUFFERS)
+        {
+            auto& previous = impl->m_qos_dropped[GST_MESSAGE_SRC(message)];
+            if (dropped > previous)
+            {
+                impl->m_dropped += dropped - previous;
+                previous = dropped;
+            }
+        }
+        break;
+    }
     default:
         break;
     }
@@ -309,23 +395,60 @@ gboolean GstDecoderImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer
     return true;
 }
 
+void GstDecoderImpl::media_info(const MediaInfo& info)
+{
+    m_vcodec = info.vcodec;
+    m_acodec = info.acodec;
+    m_audiotrack = info.audiotrack;
+    m_container = info.container;
+}
+
 #ifdef HAVE_GSTREAMER_PBUTILS
 bool GstDecoderImpl::start_discoverer()
 {
+    MediaInfo info;
+    std::string error;
+    const auto ret = discover(m_uri, info, error);
+    if (!error.empty())
+    {
+        detail::error("{}", error);
+        m_interface.on_error.invoke(error);
+    }
+
+    if (ret)
+        media_info(info);
+    return ret;
+}
+
+/// Media already discovered, by URI.
+static std::map<std::string, GstDecoderImpl::MediaInfo> discovered;
+static std::mutex discovered_mutex;
+
+bool GstDecoderImpl::discover(const std::string& uri, MediaInfo& media, std::string& error)
+{
+    {
+        std::lock_guard<std::mutex> lock(discovered_mutex);
+        auto i = discovered.find(uri);
+        if (i != discovered.end())
+        {
+            media = i->second;
+            return true;
+        }
+    }
+
     GError* err1 = nullptr;
     std::unique_ptr<GstDiscoverer, GstDeleter<void, g_object_unref>>
             discoverer{gst_discoverer_new(5 * GST_SECOND, &err1)};
     if (!discoverer)
     {
-        detail::error("error creating discoverer instance: {} ", std::string(err1->message));
-        m_interface.on_error.invoke("error creating discoverer instance: " + std::string(err1->message));
+        error = "error creating discoverer instance: " + std::string(err1->message);
         g_clear_error(&err1);
         return false;
     }
 
     GError* err2 = nullptr;
     std::unique_ptr<GstDiscovererInfo, GstDeleter<void, g_object_unref>>
-            info{gst_discoverer_discover_uri(discoverer.get(), m_uri.c_str(), &err2)};
+            info{gst_discoverer_discover_uri(discoverer.get(), uri.c_str(), &err2)};
 
     GstDiscovererResult result = gst_discoverer_info_get_result(info.get());
     EGTLOG_DEBUG("result: {} ", result);
@@ -333,34 +456,29 @@ bool GstDecoderImpl::start_discoverer()
     {
     case GST_DISCOVERER_URI_INVALID:
     {
-        detail::error("invalid URI: {}", m_uri);
-        m_interface.on_error.invoke("invalid URI: " + m_uri);
+        error = "invalid URI: " + uri;
         return false;
     }
     case GST_DISCOVERER_ERROR:
     {
-        detail::error("error: {} ", std::string(err2->message));
-        m_interface.on_error.invoke("error: " + std::string(err2->message));
+        error = "error: " + std::string(err2->message);
         break;
     }
     case GST_DISCOVERER_TIMEOUT:
     {
-
-        detail::error("gst discoverer timeout");
-        m_interface.on_error.invoke("gst discoverer timeout");
+        error = "gst discoverer timeout";
         return false;
     }
     case GST_DISCOVERER_BUSY:
     {
-        detail::error("gst discoverer busy");
-        m_interface.on_error.invoke("gst discoverer busy");
+        error = "gst discoverer busy";
         return false;
     }
     case GST_DISCOVERER_MISSING_PLUGINS:
     {
         const GstStructure* s = gst_discoverer_info_get_misc(info.get());
         GstStringHandle str{gst_structure_to_string(s)};
-        m_interface.on_error.invoke(str.get());
+        error = str.get();
         return false;
     }
     case GST_DISCOVERER_OK:
@@ -372,8 +490,7 @@ bool GstDecoderImpl::start_discoverer()
             sinfo{gst_discoverer_info_get_stream_info(info.get())};
     if (!sinfo)
     {
-        detail::error("failed to get stream info");
-        m_interface.on_error.invoke("failed to get stream info");
+        error = "failed to get stream info";
         return false;
     }
 
@@ -381,8 +498,7 @@ bool GstDecoderImpl::start_discoverer()
             streams{gst_discoverer_container_info_get_streams(GST_DISCOVERER_CONTAINER_INFO(sinfo.get()))};
     if (!streams)
     {
-        detail::error("failed to get stream info list");
-        m_interface.on_error.invoke("failed to get stream info list");
+        error = "failed to get stream info list";
         return false;
     }
 
@@ -390,14 +506,25 @@ bool GstDecoderImpl::start_discoverer()
     while (cinfo)
     {
         GstDiscovererStreamInfo* tmpinf = (GstDiscovererStreamInfo*)cinfo->data;
-        get_stream_info(tmpinf);
+        get_stream_info(tmpinf, media);
         cinfo = cinfo->next;
     }
+
+    // a playlist going through the same media discovers them once
+    if (error.empty())
+    {
+        static constexpr size_t MAX_DISCOVERED = 64;
+        std::lock_guard<std::mutex> lock(discovered_mutex);
+        if (discovered.size() >= MAX_DISCOVERED)
+            discovered.erase(discovered.begin());
+        discovered[uri] = media;
+    }
+
     return true;
 }
 
 /* Print information regarding a stream */
-void GstDecoderImpl::get_stream_info(GstDiscovererStreamInfo* info)
+void GstDecoderImpl::get_stream_info(GstDiscovererStreamInfo* info, MediaInfo& media)
 {
     std::unique_ptr<GstCaps, GstDeleter<GstCaps, gst_caps_unref>>
             caps{gst_discoverer_stream_info_get_caps(info)};
@@ -414,16 +541,16 @@ void GstDecoderImpl::get_stream_info(GstDiscovererStreamInfo* info)
             std::string type = std::string(gst_discoverer_stream_info_get_stream_type_nick(info));
             if (!type.compare("video"))
             {
-                m_vcodec = desc.get();
+                media.vcodec = desc.get();
             }
             else if (!type.compare("audio"))
             {
-                m_acodec = desc.get();
-                m_audiotrack = true;
+                media.acodec = desc.get();
+                media.audiotrack = true;
             }
             else if (!type.compare("container"))
             {
-                m_container = desc.get();
+                media.container = desc.get();
             }
             EGTLOG_DEBUG("{} : {}", type, std::string(desc.get()));
         }
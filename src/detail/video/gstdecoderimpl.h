@@ -19,7 +19,9 @@
 #include <gst/pbutils/pbutils.h>
 #endif
 
-#include <thread>
+#include <atomic>
+#include <map>
+#include <memory>
 
 namespace egt
 {
@@ -28,6 +30,8 @@ inline namespace v1
 namespace detail
 {
 
+class GstMainLoop;
+
 class GstDecoderImpl
 {
 public:
@@ -39,6 +43,15 @@ public:
     GstDecoderImpl(GstDecoderImpl&&) = delete;
     GstDecoderImpl& operator=(GstDecoderImpl&&) = delete;
 
+    /// Streams of a media, found by the discoverer.
+    struct MediaInfo
+    {
+        std::string vcodec;
+        std::string acodec;
+        bool audiotrack{false};
+        std::string container;
+    };
+
     explicit GstDecoderImpl(VideoWindow& iface, const Size& size);
 
     virtual bool media(const std::string& uri) = 0;
@@ -72,6 +85,18 @@ public:
 
     virtual bool has_audio() const;
 
+    virtual VideoStats stats() const;
+
+    /**
+     * Prepare a media to be played next.
+     *
+     * Nothing is prepared by default.
+     */
+    virtual void preload(const std::string& uri)
+    {
+        ignoreparam(uri);
+    }
+
     virtual void destroyPipeline();
 
     virtual ~GstDecoderImpl();
@@ -90,8 +115,7 @@ protected:
     std::string m_uri;
     GstBus* m_bus{nullptr};
     guint m_bus_watchid{0};
-    GMainLoop* m_gmain_loop{nullptr};
-    std::thread m_gmain_thread;
+    std::shared_ptr<GstMainLoop> m_gmain_loop;
     guint m_eventsource_id{0};
     std::string m_vcodec;
     std::string m_acodec;
@@ -99,11 +123,52 @@ protected:
     std::string m_container;
     GstElement* m_vcapsfilter{nullptr};
 
+    /// Frames counted for stats(), updated from the streaming threads.
+    std::atomic<uint64_t> m_rendered{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_late{0};
+    /// Average lateness of the frames shown, in nanoseconds.
+    std::atomic<int64_t> m_latency{0};
+    /// Frames dropped by each element, as posted in its QoS messages.
+    std::map<GstObject*, guint64> m_qos_dropped;
+    /// Running time and clock time of the last frame shown.
+    GstClockTime m_qos_running{GST_CLOCK_TIME_NONE};
+    GstClockTime m_qos_time{GST_CLOCK_TIME_NONE};
+    /// Average rate of showing frames, relative to their rate in the stream.
+    double m_qos_proportion{1.0};
+
+    /**
+     * Account for a frame shown, and report its lateness upstream.
+     *
+     * The QoS event sent from the sink lets the decoder skip frames that
+     * would be late, instead of decoding them for nothing.
+     */
+    void frame_shown(GstElement* sink, GstSample* sample);
+
+    /// Reset the stats() of the frames.
+    void reset_stats();
+
     static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data);
 
+    /// Set the streams of the media.
+    void media_info(const MediaInfo& info);
+
 #ifdef HAVE_GSTREAMER_PBUTILS
     bool start_discoverer();
-    void get_stream_info(GstDiscovererStreamInfo* info);
+
+    /**
+     * Find the streams of a media.
+     *
+     * The streams of a media are cached, so it is only discovered once. Safe
+     * to call from any thread.
+     *
+     * @param[in] uri Media to discover.
+     * @param[out] media Streams of the media.
+     * @param[out] error Error message, even if the media was discovered.
+     * @return true if the media was discovered.
+     */
+    static bool discover(const std::string& uri, MediaInfo& media, std::string& error);
+    static void get_stream_info(GstDiscovererStreamInfo* info, MediaInfo& media);
 #endif
 };
 
@@ -136,7 +136,7 @@ std::string GstKmsSinkImpl::create_pipeline()
     }
 
     static constexpr auto pipeline = "uridecodebin uri={} expose-all-streams=false name=video  {} " \
-                                     " video. {} ! g1kmssink gem-name={} video. {} ";
+                                     " video. {} ! g1kmssink name=vsink gem-name={} video. {} ";
 
     return fmt::format(pipeline, m_uri, caps, v_pipe, m_gem, a_pipe);
 }
@@ -183,18 +183,45 @@ bool GstKmsSinkImpl::media(const std::string& uri)
 
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
         m_bus = gst_pipeline_get_bus(GST_PIPELINE(m_pipeline));
-        gst_bus_add_watch(m_bus, &bus_callback, this);
+        m_bus_watchid = gst_bus_add_watch(m_bus, &bus_callback, this);
 
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
         m_eventsource_id = g_timeout_add(1000, (GSourceFunc) &query_position, this);
 
         if (!m_gmain_loop)
+            m_gmain_loop = GstMainLoop::get();
+    }
+    return true;
+}
+
+VideoStats GstKmsSinkImpl::stats() const
+{
+    auto stats = GstDecoderImpl::stats();
+    if (!m_pipeline)
+        return stats;
+
+    // the sink shows the frames itself, so only it can count them
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(m_pipeline), "vsink");
+    if (sink)
+    {
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(sink), "stats"))
         {
-            m_gmain_loop = g_main_loop_new(nullptr, false);
-            m_gmain_thread = std::thread(g_main_loop_run, m_gmain_loop);
+            GstStructure* structure = nullptr;
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+            g_object_get(G_OBJECT(sink), "stats", &structure, NULL);
+            if (structure)
+            {
+                guint64 rendered = 0;
+                if (gst_structure_get_uint64(structure, "rendered", &rendered))
+                    stats.rendered = rendered;
+                gst_structure_free(structure);
+            }
         }
+        gst_object_unref(sink);
     }
-    return true;
+
+    return stats;
 }
 
 gboolean GstKmsSinkImpl::query_position(gpointer data)
@@ -35,6 +35,8 @@ public:
 
     std::string create_pipeline() override;
 
+    VideoStats stats() const override;
+
 protected:
     int m_gem{-1};
     bool m_hwdecoder{false};
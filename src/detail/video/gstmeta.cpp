@@ -3,15 +3,31 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 
 #include "detail/video/gstmeta.h"
 
+#include <array>
+#include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <gst/gst.h>
 
 #include "detail/egtlog.h"
 
+#ifdef HAVE_LIBPLANES
+#include "egt/detail/screen/kmsoverlay.h"
+#endif
+
+#ifdef HAVE_GSTREAMER_DMABUF
+#include <gst/allocators/gstdmabuf.h>
+#include <gst/video/video.h>
+#endif
+
 
 namespace egt
 {
@@ -20,6 +36,65 @@ inline namespace v1
 namespace detail
 {
 
+std::shared_ptr<GstMainLoop> GstMainLoop::get()
+{
+    static std::mutex mutex;
+    static std::weak_ptr<GstMainLoop> instance;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto loop = instance.lock();
+    if (!loop)
+    {
+        loop = std::make_shared<GstMainLoop>();
+        instance = loop;
+    }
+    return loop;
+}
+
+GstMainLoop::GstMainLoop()
+    : m_loop(g_main_loop_new(nullptr, FALSE)),
+      m_thread(g_main_loop_run, m_loop)
+{}
+
+static gboolean quit_loop(gpointer data)
+{
+    g_main_loop_quit(static_cast<GMainLoop*>(data));
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean wake_up(gpointer data)
+{
+    static_cast<std::promise<void>*>(data)->set_value();
+    return G_SOURCE_REMOVE;
+}
+
+GstMainLoop::~GstMainLoop() noexcept
+{
+    /*
+     * Quit from the loop itself: a g_main_loop_quit() before the loop
+     * started running would be lost.
+     */
+    g_idle_add_full(G_PRIORITY_HIGH, &quit_loop, m_loop, nullptr);
+
+    if (m_thread.get_id() == std::this_thread::get_id())
+        m_thread.detach();
+    else
+        m_thread.join();
+
+    g_main_loop_unref(m_loop);
+}
+
+void GstMainLoop::sync()
+{
+    if (m_thread.get_id() == std::this_thread::get_id())
+        return;
+
+    std::promise<void> done;
+    auto future = done.get_future();
+    g_idle_add_full(G_PRIORITY_HIGH, &wake_up, &done, nullptr);
+    future.wait();
+}
+
 std::string gstreamer_get_device_path(GstDevice* device)
 {
     std::string devnode;
@@ -46,6 +121,116 @@ std::string gstreamer_get_device_path(GstDevice* device)
     return devnode;
 }
 
+/// H.264 encoders in hardware, by preference.
+static constexpr const char* hardware_h264_encoders[] =
+{
+    "v4l2h264enc",
+    "omxh264enc",
+};
+
+std::vector<std::string> gstreamer_video_encoders()
+{
+    std::vector<std::string> encoders;
+    for (const auto& encoder : hardware_h264_encoders)
+    {
+        std::unique_ptr<GstElementFactory, GstDeleter<void, gst_object_unref>>
+                factory{gst_element_factory_find(encoder)};
+        if (factory)
+            encoders.emplace_back(encoder);
+    }
+
+    encoders.emplace_back("avenc_mpeg2video");
+    return encoders;
+}
+
+std::string gstreamer_encoder_pipe(const std::string& encoder, uint32_t kbps,
+                                   bool low_latency)
+{
+    // key frames every half second at 30 fps
+    static constexpr auto low_latency_gop = 15;
+
+    std::string props;
+    if (encoder == "v4l2h264enc")
+    {
+        std::string controls;
+        if (kbps)
+            controls += fmt::format(",video_bitrate={},video_bitrate_mode=1", kbps * 1000);
+        if (low_latency)
+            controls += fmt::format(",h264_i_frame_period={}", low_latency_gop);
+        if (!controls.empty())
+            props = fmt::format(" extra-controls=\"controls{}\"", controls);
+    }
+    else if (encoder == "omxh264enc")
+    {
+        if (kbps)
+            props += fmt::format(" control-rate=constant target-bitrate={}", kbps * 1000);
+        if (low_latency)
+            props += fmt::format(" interval-intraframes={}", low_latency_gop);
+    }
+    else if (encoder == "avenc_mpeg2video")
+    {
+        if (kbps)
+            props += fmt::format(" bitrate={}", kbps * 1000);
+        if (low_latency)
+            props += fmt::format(" gop-size={}", low_latency_gop);
+    }
+
+    std::string pipe = encoder + props + " ! ";
+    if (encoder.find("h264") != std::string::npos)
+        pipe += "h264parse config-interval=-1 ! ";
+
+    return pipe;
+}
+
+bool gstreamer_flip_dmabuf(KMSOverlay* screen, GstSample* sample)
+{
+#if defined(HAVE_LIBPLANES) && defined(HAVE_GSTREAMER_DMABUF)
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    if (!screen || !buffer || gst_buffer_n_memory(buffer) != 1)
+        return false;
+
+    GstMemory* memory = gst_buffer_peek_memory(buffer, 0);
+    if (!gst_is_dmabuf_memory(memory))
+        return false;
+
+    std::array<uint32_t, 4> pitches{};
+    std::array<uint32_t, 4> offsets{};
+    if (auto meta = gst_buffer_get_video_meta(buffer))
+    {
+        for (guint plane = 0; plane < meta->n_planes && plane < pitches.size(); ++plane)
+        {
+            pitches[plane] = meta->stride[plane];
+            offsets[plane] = meta->offset[plane] + memory->offset;
+        }
+    }
+    else
+    {
+        GstVideoInfo info;
+        if (!gst_video_info_from_caps(&info, gst_sample_get_caps(sample)))
+            return false;
+
+        for (guint plane = 0; plane < GST_VIDEO_INFO_N_PLANES(&info) && plane < pitches.size(); ++plane)
+        {
+            pitches[plane] = GST_VIDEO_INFO_PLANE_STRIDE(&info, plane);
+            offsets[plane] = GST_VIDEO_INFO_PLANE_OFFSET(&info, plane) + memory->offset;
+        }
+    }
+
+    const auto fb = screen->import_dmabuf(gst_dmabuf_memory_get_fd(memory), pitches, offsets);
+    if (!fb || !screen->flip_framebuffer(fb))
+    {
+        detail::warn("unable to show dmabuf, copying it instead");
+        return false;
+    }
+
+    return true;
+#else
+    detail::ignoreparam(screen);
+    detail::ignoreparam(sample);
+    return false;
+#endif
+}
+
 }
 }
 }
@@ -11,6 +11,8 @@
 #include <gst/gst.h>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace egt
 {
@@ -104,6 +106,69 @@ inline void gstreamer_init_plugins(T& plugins)
 
 std::string gstreamer_get_device_path(GstDevice* device);
 
+/**
+ * Get the video encoders to try, by preference: the H.264 encoders in hardware
+ * that are available, then the MPEG-2 encoder in software.
+ */
+std::vector<std::string> gstreamer_video_encoders();
+
+/**
+ * Get the description of the encoder part of a pipeline.
+ *
+ * @param encoder The encoder element.
+ * @param kbps Bitrate in kbit/s, or 0 for the encoder default.
+ * @param low_latency Make key frames more frequent.
+ */
+std::string gstreamer_encoder_pipe(const std::string& encoder, uint32_t kbps,
+                                   bool low_latency);
+
+/**
+ * Thread running the GLib main loop, which dispatches the bus watches and
+ * timers of the GStreamer pipelines.
+ *
+ * The loop is shared by all the media objects, started by the first one using
+ * it and stopped when the last one releases it.
+ */
+class GstMainLoop
+{
+public:
+
+    /// Get the main loop, starting it if needed.
+    static std::shared_ptr<GstMainLoop> get();
+
+    GstMainLoop();
+    GstMainLoop(const GstMainLoop&) = delete;
+    GstMainLoop& operator=(const GstMainLoop&) = delete;
+    GstMainLoop(GstMainLoop&&) = delete;
+    GstMainLoop& operator=(GstMainLoop&&) = delete;
+    ~GstMainLoop() noexcept;
+
+    /**
+     * Wait for the callback being dispatched by the loop, if any.
+     *
+     * Once the sources of an object are removed, this makes sure none of
+     * their callbacks still runs, so the object can be destroyed.
+     */
+    void sync();
+
+private:
+    GMainLoop* m_loop;
+    std::thread m_thread;
+};
+
+class KMSOverlay;
+
+/**
+ * Show a dmabuf sample on an overlay plane, without a copy.
+ *
+ * The sample must stay referenced until another buffer replaced it on the
+ * plane, that is until the next flip returned.
+ *
+ * @return false if the sample is not a single dmabuf, or cannot be shown, and
+ * must then be copied.
+ */
+bool gstreamer_flip_dmabuf(KMSOverlay* screen, GstSample* sample);
+
 }
 }
 }
@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "detail/video/gstmeta.h"
+#include "detail/video/gstrecorderimpl.h"
+#include "egt/app.h"
+#include "egt/detail/meta.h"
+#include "egt/detail/pixelops.h"
+#include <algorithm>
+#include <chrono>
+#include <gst/gst.h>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Frame rate of the recording.
+static constexpr auto record_fps = 30;
+
+ScreenRecorderImpl::ScreenRecorderImpl(experimental::ScreenRecorder& iface,
+                                       Screen& screen,
+                                       // NOLINTNEXTLINE(modernize-pass-by-value)
+                                       const std::string& output,
+                                       size_t budget)
+    : m_interface(iface),
+      m_screen(screen),
+      m_output(output),
+      m_budget(budget)
+{
+    static constexpr auto plugins =
+    {
+        "libgstcoreelements.so",
+        "libgstapp.so",
+        "libgstvideoconvert.so",
+        "libgstvideorate.so",
+        "libgstvideo4linux2.so",
+        "libgstmpegtsmux.so",
+        "libgstlibav.so",
+        "libgstvideoparsersbad.so",
+        "libgstomx.so",
+    };
+    detail::gstreamer_init_plugins(plugins);
+
+    m_gmain_loop = GstMainLoop::get();
+}
+
+gboolean ScreenRecorderImpl::bus_callback(GstBus* bus, GstMessage* message, gpointer data)
+{
+    ignoreparam(bus);
+
+    auto impl = static_cast<ScreenRecorderImpl*>(data);
+
+    EGTLOG_TRACE("gst message: {}", GST_MESSAGE_TYPE_NAME(message));
+
+    switch (GST_MESSAGE_TYPE(message))
+    {
+    case GST_MESSAGE_ERROR:
+    {
+        GstErrorHandle error;
+        GstStringHandle debug;
+        gstreamer_message_parse(gst_message_parse_error, message, error, debug);
+        if (error)
+        {
+            EGTLOG_DEBUG("gst error: {} {}",
+                         error->message,
+                         debug ? debug.get() : "");
+
+            if (Application::check_instance())
+            {
+                asio::post(Application::instance().event().io(), [impl, error = std::move(error)]()
+                {
+                    impl->m_interface.on_error.invoke(error->message);
+                });
+            }
+        }
+
+        // there will be no end of stream
+        std::lock_guard<std::mutex> lock(impl->m_mutex);
+        impl->m_eos = true;
+        impl->m_condition.notify_one();
+        break;
+    }
+    case GST_MESSAGE_EOS:
+    {
+        std::lock_guard<std::mutex> lock(impl->m_mutex);
+        impl->m_eos = true;
+        impl->m_condition.notify_one();
+        break;
+    }
+    default:
+        break;
+    }
+
+    return true;
+}
+
+bool ScreenRecorderImpl::launch(const std::string& format, const std::string& encoder, bool report)
+{
+    /*
+     * Frames are timestamped as they are pushed, and videorate turns them
+     * into a constant frame rate for the encoder.  It comes after the
+     * conversion, so it only holds on to converted frames and not to the
+     * frame buffers.
+     */
+    static constexpr auto record_pipe =
+        "appsrc name=src is-live=true do-timestamp=true format=time " \
+        "caps=video/x-raw,format={},width={},height={},framerate=0/1 ! " \
+        "videoconvert ! videorate ! video/x-raw,framerate={}/1 ! " \
+        "{}mpegtsmux ! filesink location={}";
+
+    const auto pipe = fmt::format(record_pipe, format, m_size.width(), m_size.height(),
+                                  record_fps, gstreamer_encoder_pipe(encoder, m_bitrate, false),
+                                  m_output);
+
+    EGTLOG_DEBUG(pipe);
+
+    GError* error = nullptr;
+    m_pipeline = gst_parse_launch(pipe.c_str(), &error);
+    if (!m_pipeline)
+    {
+        if (report)
+            m_interface.on_error.invoke(fmt::format("failed to create pipeline: {}", error->message));
+        return false;
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    m_src = gst_bin_get_by_name(GST_BIN(m_pipeline), "src");
+
+    m_eos = false;
+
+    auto ret = gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+    if (ret != GST_STATE_CHANGE_FAILURE)
+        ret = gst_element_get_state(m_pipeline, nullptr, nullptr, GST_SECOND);
+    if (ret == GST_STATE_CHANGE_FAILURE || !m_src)
+    {
+        if (report)
+            m_interface.on_error.invoke("failed to set pipeline to play state");
+        gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        if (m_src)
+            gst_object_unref(m_src);
+        m_src = nullptr;
+        g_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+        return false;
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+    GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(m_pipeline));
+    gst_bus_add_watch(bus, &bus_callback, this);
+    gst_object_unref(bus);
+
+    return true;
+}
+
+bool ScreenRecorderImpl::start()
+{
+    stop();
+
+    auto target = cairo_get_target(m_screen.context().get());
+    std::string format;
+    switch (cairo_image_surface_get_format(target))
+    {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+        format = "BGRx";
+        m_bpp = 4;
+        break;
+    case CAIRO_FORMAT_RGB16_565:
+        format = "RGB16";
+        m_bpp = 2;
+        break;
+    default:
+        m_interface.on_error.invoke("unsupported screen format");
+        return false;
+    }
+
+    m_size = Size(cairo_image_surface_get_width(target),
+                  cairo_image_surface_get_height(target));
+    m_stride = cairo_image_surface_get_stride(target);
+
+    const auto frame_size = m_stride * m_size.height();
+    const auto count = frame_size ? m_budget / frame_size : 0;
+    if (!count)
+    {
+        m_interface.on_error.invoke("budget does not fit a frame");
+        return false;
+    }
+
+    m_slots.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        auto slot = std::make_shared<Slot>();
+        slot->data = std::make_unique<uint8_t[]>(frame_size);
+        // every buffer starts out undefined
+        slot->damage.emplace_back(Point(), m_size);
+        m_slots.push_back(std::move(slot));
+    }
+
+    const auto encoders = gstreamer_video_encoders();
+    for (const auto& encoder : encoders)
+    {
+        const auto last = &encoder == &encoders.back();
+        if (launch(format, encoder, last))
+        {
+            m_encoder = encoder;
+            EGTLOG_DEBUG("recorder encoder: {} with {} buffers", m_encoder, count);
+
+            m_stats = {};
+            m_damage_handle = m_screen.on_damage([this](const Screen::DamageArray & damage)
+            {
+                m_stats.frames++;
+                frame(damage);
+            });
+
+            // what is on the screen until the next frame
+            frame({});
+            return true;
+        }
+
+        if (!last)
+            detail::warn("recorder encoder {} failed, falling back", encoder);
+    }
+
+    m_encoder.clear();
+    m_slots.clear();
+    return false;
+}
+
+void ScreenRecorderImpl::release(gpointer data)
+{
+    auto slot = static_cast<std::shared_ptr<Slot>*>(data);
+    (*slot)->busy = false;
+    delete slot;
+}
+
+void ScreenRecorderImpl::frame(const Screen::DamageArray& damage)
+{
+    const Rect bounds(Point(), m_size);
+    for (auto& slot : m_slots)
+    {
+        for (const auto& rect : damage)
+        {
+            const auto r = Rect::intersection(rect, bounds);
+            if (!r.empty())
+                Screen::damage_algorithm(slot->damage, r);
+        }
+    }
+
+    // the free buffer filled last missed the least damage
+    std::shared_ptr<Slot> slot;
+    for (auto& s : m_slots)
+    {
+        if (!s->busy && (!slot || s->frame > slot->frame))
+            slot = s;
+    }
+
+    if (!slot)
+    {
+        m_stats.dropped++;
+        return;
+    }
+
+    // the target changes with each frame in zero copy mode
+    auto target = cairo_get_target(m_screen.context().get());
+    cairo_surface_flush(target);
+    const auto src = cairo_image_surface_get_data(target);
+    if (!src || static_cast<size_t>(cairo_image_surface_get_stride(target)) != m_stride)
+        return;
+
+    for (const auto& rect : slot->damage)
+    {
+        const auto offset = rect.y() * m_stride + rect.x() * m_bpp;
+        copy_rect(src + offset, m_stride, slot->data.get() + offset, m_stride,
+                  rect.width() * m_bpp, rect.height());
+        m_stats.copied_pixels += rect.area();
+    }
+
+    slot->damage.clear();
+    slot->frame = ++m_frame;
+    slot->busy = true;
+
+    const auto size = m_stride * m_size.height();
+    auto buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+                  slot->data.get(), size, 0, size,
+                  new std::shared_ptr<Slot>(slot), &release);
+
+    GstFlowReturn ret;
+    g_signal_emit_by_name(m_src, "push-buffer", buffer, &ret);
+    gst_buffer_unref(buffer);
+}
+
+void ScreenRecorderImpl::stop()
+{
+    if (m_damage_handle)
+    {
+        m_screen.on_damage.remove(m_damage_handle);
+        m_damage_handle = 0;
+    }
+
+    if (m_pipeline)
+    {
+        if (GST_STATE(m_pipeline) == GST_STATE_PLAYING)
+        {
+            GstFlowReturn ret;
+            g_signal_emit_by_name(m_src, "end-of-stream", &ret);
+
+            // the encoder may be stuck, do not wait for it forever
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait_for(lock, std::chrono::seconds(5), [this]() { return m_eos; });
+        }
+
+        GstStateChangeReturn ret = gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        if (GST_STATE_CHANGE_FAILURE == ret)
+        {
+            detail::error("set pipeline to NULL state failed");
+        }
+
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        gst_bus_remove_watch(GST_ELEMENT_BUS(m_pipeline));
+
+        gst_object_unref(m_src);
+        m_src = nullptr;
+        g_object_unref(m_pipeline);
+        m_pipeline = nullptr;
+    }
+}
+
+ScreenRecorderImpl::~ScreenRecorderImpl() noexcept
+{
+    stop();
+
+    // the loop is shared, only wait for our callbacks to be done
+    m_gmain_loop->sync();
+}
+
+}
+}
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_VIDEO_GSTRECORDERIMPL_H
+#define EGT_SRC_DETAIL_VIDEO_GSTRECORDERIMPL_H
+
+#include "egt/capture.h"
+#include "egt/screen.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <gst/gst.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+class GstMainLoop;
+
+class ScreenRecorderImpl
+{
+public:
+    ScreenRecorderImpl(experimental::ScreenRecorder& iface, Screen& screen,
+                       const std::string& output, size_t budget);
+
+    // special functions deleted because they are never used
+    ScreenRecorderImpl(const ScreenRecorderImpl&) = delete;
+    ScreenRecorderImpl& operator=(const ScreenRecorderImpl&) = delete;
+    ScreenRecorderImpl(ScreenRecorderImpl&&) = delete;
+    ScreenRecorderImpl& operator=(ScreenRecorderImpl&&) = delete;
+
+    bool start();
+
+    void stop();
+
+    void bitrate(uint32_t kbps) { m_bitrate = kbps; }
+
+    uint32_t bitrate() const { return m_bitrate; }
+
+    std::string encoder() const { return m_encoder; }
+
+    experimental::ScreenRecorderStats stats() const { return m_stats; }
+
+    ~ScreenRecorderImpl() noexcept;
+
+protected:
+
+    /**
+     * Frame buffer handed to the encoder.
+     *
+     * It is shared with the buffers wrapping it, so it outlives them.
+     */
+    struct Slot
+    {
+        std::unique_ptr<uint8_t[]> data;
+        /// Damage flipped since the buffer was last filled.
+        Screen::DamageArray damage;
+        /// Number of the frame the buffer was last filled with.
+        uint64_t frame{0};
+        /// Is the buffer being encoded.
+        std::atomic<bool> busy{false};
+    };
+
+    experimental::ScreenRecorder& m_interface;
+    Screen& m_screen;
+    std::string m_output;
+    size_t m_budget;
+    GstElement* m_pipeline{nullptr};
+    GstElement* m_src{nullptr};
+    std::shared_ptr<GstMainLoop> m_gmain_loop;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_eos{false};
+    uint32_t m_bitrate{0};
+    std::string m_encoder;
+    std::vector<std::shared_ptr<Slot>> m_slots;
+    Size m_size;
+    size_t m_stride{0};
+    size_t m_bpp{0};
+    uint64_t m_frame{0};
+    Signal<const Screen::DamageArray&>::RegisterHandle m_damage_handle{0};
+    experimental::ScreenRecorderStats m_stats{};
+
+    /// Try to start the pipeline with an encoder.
+    bool launch(const std::string& format, const std::string& encoder, bool report);
+
+    /// Record a frame flipped by the screen.
+    void frame(const Screen::DamageArray& damage);
+
+    static void release(gpointer data);
+    static gboolean bus_callback(GstBus* bus, GstMessage* message, gpointer data);
+};
+
+}
+}
+}
+
+#endif
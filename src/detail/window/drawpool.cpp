@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/window/drawpool.h"
+#include <cstdlib>
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+static size_t draw_threads()
+{
+    const auto value = std::getenv("EGT_DRAW_THREADS");
+    if (value && *value)
+        return std::strtoul(value, nullptr, 10);
+
+    const auto cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+}
+
+DrawPool& DrawPool::instance()
+{
+    static const std::unique_ptr<DrawPool> i(new DrawPool(draw_threads()));
+    return *i;
+}
+
+DrawPool::DrawPool(size_t threads)
+{
+    EGTLOG_DEBUG("starting {} draw threads", threads);
+
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back(&DrawPool::work, this);
+}
+
+DrawPool::~DrawPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void DrawPool::run(size_t count, const std::function<void(size_t)>& func)
+{
+    if (!count)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_func = &func;
+    m_count = count;
+    m_next = 0;
+    m_remaining = count;
+    m_error = nullptr;
+
+    if (count > 1)
+        m_wake.notify_all();
+
+    take(lock);
+    m_done.wait(lock, [this]() { return !m_remaining; });
+
+    m_func = nullptr;
+    auto error = std::move(m_error);
+    m_error = nullptr;
+    lock.unlock();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void DrawPool::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || (m_func && m_next < m_count); });
+        if (m_stop)
+            return;
+
+        take(lock);
+    }
+}
+
+void DrawPool::take(std::unique_lock<std::mutex>& lock)
+{
+    while (m_func && m_next < m_count)
+    {
+        const auto index = m_next++;
+        const auto& func = *m_func;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+            func(index);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (error && !m_error)
+            m_error = error;
+        if (!--m_remaining)
+            m_done.notify_all();
+    }
+}
+
+}
+}
+}
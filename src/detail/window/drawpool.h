@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_DRAWPOOL_H
+#define EGT_SRC_DETAIL_WINDOW_DRAWPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <egt/detail/meta.h>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Pool of worker threads used to draw parts of a frame in parallel.
+ *
+ * The pool runs one batch of jobs at a time, and the thread that submits
+ * the batch works on it too, so a pool with no threads runs everything on
+ * the calling thread.
+ */
+class DrawPool : private NonCopyable<DrawPool>
+{
+public:
+
+    /**
+     * Get the shared pool.
+     *
+     * The number of threads is the EGT_DRAW_THREADS environment variable, or
+     * one less than the number of cores.
+     */
+    static DrawPool& instance();
+
+    /**
+     * @param[in] threads Number of worker threads.
+     */
+    explicit DrawPool(size_t threads);
+
+    ~DrawPool() noexcept;
+
+    /**
+     * Number of worker threads, not counting the calling thread.
+     */
+    EGT_NODISCARD size_t size() const { return m_threads.size(); }
+
+    /**
+     * Call func(0) up to func(count - 1), and wait for all of them.
+     *
+     * If any of the calls throws, the first exception is rethrown after all
+     * calls finished.
+     */
+    void run(size_t count, const std::function<void(size_t)>& func);
+
+protected:
+
+    void work();
+
+    /// Run jobs of the current batch until none are left, with the lock held.
+    void take(std::unique_lock<std::mutex>& lock);
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const std::function<void(size_t)>* m_func{nullptr};
+    size_t m_count{0};
+    size_t m_next{0};
+    size_t m_remaining{0};
+    std::exception_ptr m_error;
+    bool m_stop{false};
+    std::vector<std::thread> m_threads;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "detail/window/occlusionpolicy.h"
+#include "detail/window/scanoutpolicy.h"
+#include "egt/screen.h"
+#include "egt/window.h"
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef HAVE_LIBPLANES
+#include "egt/detail/screen/kmsoverlay.h"
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+bool OcclusionPolicy::enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_NO_OCCLUSION_CULLING"))
+            value -= 1;
+        else
+            value += 1;
+    }
+    return value == 1;
+}
+
+/// Rectangle a plane window is shown in, on the display.
+static Rect displayed(Window& window)
+{
+    auto size = window.screen()->size();
+
+#ifdef HAVE_LIBPLANES
+    // a plane is scaled by the display controller
+    if (auto overlay = dynamic_cast<KMSOverlay*>(window.screen()))
+        size = Size(size.width() * overlay->hscale(), size.height() * overlay->vscale());
+#endif
+
+    const auto origin = window.local_to_display(Point());
+    return Rect(Point(origin.x(), origin.y()), size);
+}
+
+void OcclusionPolicy::update(const std::vector<Window*>& windows)
+{
+    for (auto& w : windows)
+    {
+        if (!w->has_screen() || w->plane_window())
+            continue;
+
+        std::vector<Rect> occluders;
+
+        // plane windows are not rotated with the screen
+        if (enabled() && w->visible() && !w->screen()->rotation())
+        {
+            const auto origin = w->local_to_display(Point());
+            const auto bounds = Rect(Point(), w->size());
+
+            for (auto& above : windows)
+            {
+                if (!above->plane_window() || !above->has_screen() ||
+                    !above->visible() || !ScanoutPolicy::opaque(*above))
+                    continue;
+
+                const auto r = Rect::intersection(
+                                   displayed(*above) - Point(origin.x(), origin.y()), bounds);
+                if (!r.empty())
+                    occluders.push_back(r);
+            }
+        }
+
+        if (occluders == w->m_occluders)
+            continue;
+
+        EGTLOG_DEBUG("{} covered by {} planes", w->name(), occluders.size());
+
+        // what is uncovered is drawn, what is still covered is kept aside again
+        w->m_occluders = std::move(occluders);
+        for (const auto& rect : w->m_occluded)
+            w->add_damage(rect);
+        w->m_occluded.clear();
+    }
+}
+
+bool OcclusionPolicy::covered(const Window& window, const Rect& rect)
+{
+    return std::any_of(window.m_occluders.begin(), window.m_occluders.end(),
+                       [&rect](const Rect & occluder) { return occluder.contains(rect); });
+}
+
+}
+}
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_OCCLUSIONPOLICY_H
+#define EGT_SRC_DETAIL_WINDOW_OCCLUSIONPOLICY_H
+
+#include "egt/geometry.h"
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Window;
+
+namespace detail
+{
+
+/**
+ * Skips drawing the parts of windows covered by opaque planes above them.
+ *
+ * Windows on overlay planes are shown above the window of the primary plane
+ * by the display controller.  When such a window is opaque, the part of the
+ * primary window under it is never seen, so the damage there is kept aside
+ * instead of drawn.  Once the plane window moves, is hidden, or stops being
+ * opaque, the damage it uncovers is drawn.
+ *
+ * Windows composed into another window are already skipped by their parent
+ * when covered by an opaque sibling, see Widget::opaque_rect().
+ */
+class OcclusionPolicy
+{
+public:
+
+    /**
+     * Returns false if occlusion culling is disabled, see
+     * EGT_NO_OCCLUSION_CULLING.
+     */
+    static bool enabled();
+
+    /**
+     * Update the parts of the windows covered by planes above them.
+     *
+     * This must be called once per frame, before drawing.
+     */
+    static void update(const std::vector<Window*>& windows);
+
+    /**
+     * Returns true if a rectangle of a window is covered by a plane.
+     *
+     * @param[in] window The window.
+     * @param[in] rect Rectangle relative to the origin of the window.
+     */
+    static bool covered(const Window& window, const Rect& rect);
+};
+
+}
+}
+}
+
+#endif
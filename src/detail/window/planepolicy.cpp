@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/window/planepolicy.h"
+#include "egt/app.h"
+#include "egt/screen.h"
+#include "egt/window.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+constexpr uint32_t PlanePolicy::promote_window;
+constexpr uint32_t PlanePolicy::promote_threshold;
+constexpr uint32_t PlanePolicy::demote_idle;
+
+bool PlanePolicy::enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_AUTO_PLANES") && strlen(std::getenv("EGT_AUTO_PLANES")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+static inline uint32_t damaged_frames(uint32_t history, uint32_t frames)
+{
+    const auto mask = frames >= 32 ? ~0U : ((1U << frames) - 1);
+    return std::bitset<32>(history & mask).count();
+}
+
+void PlanePolicy::update(const std::vector<Window*>& windows)
+{
+    if (!Application::check_instance() ||
+        !Application::instance().screen() ||
+        !Application::instance().screen()->have_planes())
+        return;
+
+    std::vector<std::pair<uint32_t, Window*>> candidates;
+
+    for (auto& w : windows)
+    {
+        // done animating, so back to composition, unless the policy wants it
+        if (w->m_animation_plane && !w->m_animating)
+        {
+            w->m_animation_plane = false;
+            if (!w->m_auto_plane)
+            {
+                EGTLOG_DEBUG("{} done animating, moving back to composition", w->name());
+                w->switch_plane(false);
+            }
+        }
+
+        if (!w->m_auto_plane)
+            continue;
+
+        w->m_damage_history = (w->m_damage_history << 1) | (w->m_damaged ? 1 : 0);
+        w->m_damaged = false;
+
+        if (w->plane_window())
+        {
+            const auto mask = demote_idle >= 32 ? ~0U : ((1U << demote_idle) - 1);
+            if (!(w->m_damage_history & mask) || !w->visible())
+            {
+                EGTLOG_DEBUG("{} idle, moving back to composition", w->name());
+                w->switch_plane(false);
+            }
+            continue;
+        }
+
+        if (!w->visible() || w->box().empty())
+            continue;
+
+        const auto damaged = damaged_frames(w->m_damage_history, promote_window);
+        if (damaged >= promote_threshold)
+            candidates.emplace_back(damaged, w);
+    }
+
+    // the busiest windows get the planes first
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const std::pair<uint32_t, Window*>& a, const std::pair<uint32_t, Window*>& b)
+    {
+        return a.first > b.first;
+    });
+
+    for (auto& c : candidates)
+    {
+        if (c.second->switch_plane(true))
+        {
+            EGTLOG_DEBUG("{} promoted to a plane", c.second->name());
+        }
+        else
+        {
+            // out of planes, wait for a full history before trying again
+            c.second->m_damage_history = 0;
+        }
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_PLANEPOLICY_H
+#define EGT_SRC_DETAIL_WINDOW_PLANEPOLICY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Window;
+
+namespace detail
+{
+
+/**
+ * Moves frequently damaged windows to hardware planes at runtime.
+ *
+ * Every frame, each window that allows it (see Window::auto_plane()) records
+ * whether it was damaged.  A software window damaged in most of the recent
+ * frames is promoted to a free overlay plane, which takes its redraws out of
+ * the composition of its parent.  When no plane is available the window
+ * simply stays composed.  A promoted window that has not been damaged for a
+ * while is demoted back to composition so its plane can be used by another
+ * window.
+ *
+ * Windows moved to a plane for an animation, see Window::animating(), are
+ * moved back to composition once the animation is done.
+ */
+class PlanePolicy
+{
+public:
+
+    /// Frames of history used to decide on promotion.
+    static constexpr uint32_t promote_window = 16;
+
+    /// Number of damaged frames in promote_window to promote a window.
+    static constexpr uint32_t promote_threshold = 12;
+
+    /// Number of frames without damage to demote a promoted window.
+    static constexpr uint32_t demote_idle = 32;
+
+    /**
+     * Returns true if windows created with WindowHint::automatic are
+     * composed and left to the policy, see EGT_AUTO_PLANES.
+     */
+    static bool enabled();
+
+    /**
+     * Sample the damage of the windows and promote or demote them.
+     *
+     * This must be called once per frame, before drawing.
+     */
+    static void update(const std::vector<Window*>& windows);
+};
+
+}
+}
+}
+
+#endif
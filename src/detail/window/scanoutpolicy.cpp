@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/window/scanoutpolicy.h"
+#include "egt/screen.h"
+#include "egt/window.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+constexpr uint32_t ScanoutPolicy::settle_frames;
+constexpr double ScanoutPolicy::slow_readback;
+
+bool ScanoutPolicy::enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_AUTO_ZERO_COPY") && strlen(std::getenv("EGT_AUTO_ZERO_COPY")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+bool ScanoutPolicy::opaque(const Window& window)
+{
+    if (!window.fill_flags().is_set(Theme::FillFlag::solid) || window.alpha() < 1.f)
+        return false;
+
+    const auto& bg = window.color(Palette::ColorId::bg);
+    if (bg.type() == Pattern::Type::solid)
+        return bg.solid().alpha() == 255;
+
+    const auto& steps = bg.steps();
+    return std::all_of(steps.begin(), steps.end(),
+                       [](const std::pair<float, Color>& step) { return step.second.alpha() == 255; });
+}
+
+void ScanoutPolicy::update(const std::vector<Window*>& windows)
+{
+    // windows drawn into the screen of another window
+    const auto composed = std::any_of(windows.begin(), windows.end(),
+                                      [](const Window * w) { return w->visible() && !w->has_screen(); });
+
+    for (auto& w : windows)
+    {
+        if (!w->has_screen() || w->plane_window())
+            continue;
+
+        auto screen = w->screen();
+        if (!enabled() && !screen->auto_zero_copy())
+            continue;
+
+        // pending scrolls move the content of the composition buffer
+        const auto alone = !composed && w->visible() && w->m_scrolls.empty() &&
+                           w->box().contains(screen->box()) && opaque(*w);
+        if (!alone)
+        {
+            w->m_scanout_frames = 0;
+            if (screen->zero_copy())
+            {
+                EGTLOG_DEBUG("{} no longer alone, back to composition", w->name());
+                screen->zero_copy(false);
+            }
+            continue;
+        }
+
+        if (screen->zero_copy() || ++w->m_scanout_frames < settle_frames)
+            continue;
+
+        const auto& readback = screen->readback();
+        if (readback.scanout * slow_readback < readback.composition)
+        {
+            if (w->m_scanout_frames == settle_frames)
+                EGTLOG_DEBUG("{} alone on the screen, but its buffers are slow to read back", w->name());
+            continue;
+        }
+
+        if (screen->zero_copy(true))
+            EGTLOG_DEBUG("{} alone on the screen, rendering to the screen buffers", w->name());
+        else
+            w->m_scanout_frames = 0;
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_SCANOUTPOLICY_H
+#define EGT_SRC_DETAIL_WINDOW_SCANOUTPOLICY_H
+
+#include <cstdint>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+class Window;
+
+namespace detail
+{
+
+/**
+ * Renders directly into the screen buffers while composition is useless.
+ *
+ * When a single opaque window covers its screen, and no other window is
+ * composed, the composition buffer only holds a copy of what is flipped.
+ * The screen is then switched to Screen::zero_copy(), where each buffer is
+ * redrawn with its buffer age damage instead.  Once a Popup, a Dialog, or any
+ * other composed window is shown, the screen goes back to composition.
+ *
+ * Screens whose buffers are much slower to read back than the composition
+ * buffer, like write-combined memory, are not switched, see
+ * Screen::readback().
+ */
+class ScanoutPolicy
+{
+public:
+
+    /// Number of frames the window must stay alone to switch to zero copy.
+    static constexpr uint32_t settle_frames = 8;
+
+    /**
+     * Screen buffers read back this many times slower than the composition
+     * buffer are left alone, drawing on them would cost more than the copy.
+     */
+    static constexpr double slow_readback = 4;
+
+    /**
+     * Returns true if the policy applies to every screen, see
+     * EGT_AUTO_ZERO_COPY.  Otherwise, it only applies to screens with
+     * Screen::auto_zero_copy() enabled.
+     */
+    static bool enabled();
+
+    /**
+     * Returns true if nothing behind a window shows through it.
+     */
+    static bool opaque(const Window& window);
+
+    /**
+     * Switch the screens of the windows to or from zero copy.
+     *
+     * This must be called once per frame, before drawing.
+     */
+    static void update(const std::vector<Window*>& windows);
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/window/subsurfacewindow.h"
+#include "egt/detail/screen/waylandscreen.h"
+#include "egt/image.h"
+#include "egt/painter.h"
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+SubsurfaceWindow::SubsurfaceWindow(Window* inter, WaylandScreen& parent)
+    : BasicWindow(inter),
+      m_parent(parent)
+{
+    if (m_interface->m_box.size().empty())
+        m_interface->m_box.size(Size(32, 32));
+
+    allocate_screen();
+}
+
+void SubsurfaceWindow::resize(const Size& size)
+{
+    if (!size.empty() && m_interface->m_box.size() != size)
+    {
+        if (m_subsurface)
+            m_subsurface->resize(size);
+
+        m_interface->m_box.size(size);
+        m_interface->damage();
+    }
+}
+
+void SubsurfaceWindow::move(const Point& point)
+{
+    if (point != m_interface->box().point())
+    {
+        m_interface->m_box.point(point);
+        m_dirty = true;
+    }
+}
+
+// damage to a subsurface window does not propagate up, unlike a normal frame
+void SubsurfaceWindow::damage(const Rect& rect)
+{
+    auto crect = Rect(rect.point() - m_interface->box().point(), rect.size());
+
+    if (crect.empty())
+        return;
+
+    if (!m_interface->visible())
+        return;
+
+    m_interface->add_damage(crect);
+}
+
+void SubsurfaceWindow::allocate_screen()
+{
+    if (!m_subsurface && !m_interface->box().size().empty())
+    {
+        m_subsurface = std::make_unique<WaylandSubsurface>(m_parent, m_interface->box().size());
+        m_screen = m_subsurface.get();
+    }
+}
+
+void SubsurfaceWindow::begin_draw()
+{
+    if (!m_interface->box().size().empty())
+    {
+        if (m_dirty)
+        {
+            allocate_screen();
+
+            if (m_subsurface)
+            {
+                m_subsurface->position(m_interface->local_to_display(Point()));
+                m_dirty = false;
+            }
+        }
+
+        m_interface->do_draw();
+    }
+}
+
+void SubsurfaceWindow::paint(Painter& painter)
+{
+    if (m_screen)
+    {
+        auto image = Image(shared_cairo_surface_t(
+                               cairo_surface_reference(cairo_get_target(m_screen->context().get())),
+                               cairo_surface_destroy));
+        auto p = m_interface->local_to_display(Point());
+        painter.draw(Point(p.x(), p.y()));
+        painter.draw(image);
+    }
+}
+
+void SubsurfaceWindow::show()
+{
+    m_dirty = true;
+    if (m_subsurface)
+        m_subsurface->show();
+    BasicWindow::show();
+    begin_draw();
+}
+
+void SubsurfaceWindow::hide()
+{
+    if (m_subsurface)
+        m_subsurface->hide();
+
+    BasicWindow::hide();
+}
+
+SubsurfaceWindow::~SubsurfaceWindow() noexcept = default;
+
+}
+}
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_DETAIL_SUBSURFACEWINDOW_H
+#define EGT_DETAIL_SUBSURFACEWINDOW_H
+
+#include "detail/window/basicwindow.h"
+#include <memory>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+class WaylandScreen;
+class WaylandSubsurface;
+
+/**
+ * A SubsurfaceWindow backend uses a Wayland subsurface as a Screen.
+ *
+ * It is the PlaneWindow of a Wayland window: the compositor composes the
+ * subsurface over the window, which does not draw it.  Like a PlaneWindow,
+ * changes of the position are applied in begin_draw().
+ */
+class SubsurfaceWindow : public BasicWindow
+{
+public:
+
+    SubsurfaceWindow(Window* inter, WaylandScreen& parent);
+
+    SubsurfaceWindow(const SubsurfaceWindow&) = delete;
+    SubsurfaceWindow& operator=(const SubsurfaceWindow&) = delete;
+    SubsurfaceWindow(SubsurfaceWindow&&) noexcept = default;
+    SubsurfaceWindow& operator=(SubsurfaceWindow&&) noexcept = default;
+
+    void resize(const Size& size) override;
+
+    void damage(const Rect& rect) override;
+
+    void move(const Point& point) override;
+
+    void begin_draw() override;
+
+    void show() override;
+
+    void hide() override;
+
+    void paint(Painter& painter) override;
+
+    void allocate_screen() override;
+
+    ~SubsurfaceWindow() noexcept override;
+
+protected:
+
+    /**
+     * The screen of the Wayland window.
+     */
+    WaylandScreen& m_parent;
+
+    /**
+     * When true, the position needs to be applied in begin_draw().
+     */
+    bool m_dirty{true};
+
+    /**
+     * The subsurface.
+     */
+    std::unique_ptr<WaylandSubsurface> m_subsurface;
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/window/tiledamage.h"
+#include <algorithm>
+#include <cassert>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+TileDamage::TileDamage(const Size& area, const Size& tile)
+    : m_tile(tile)
+{
+    assert(!m_tile.empty());
+    if (m_tile.empty())
+        m_tile = Size(32, 32);
+
+    resize(area);
+}
+
+void TileDamage::resize(const Size& area)
+{
+    if (area == m_area && !m_bits.empty())
+        return;
+
+    Screen::DamageArray pending;
+    if (m_dirty)
+        extract(pending);
+
+    m_area = area;
+    m_columns = (std::max(area.width(), 0) + m_tile.width() - 1) / m_tile.width();
+    m_rows = (std::max(area.height(), 0) + m_tile.height() - 1) / m_tile.height();
+    m_words = (m_columns + WORD_BITS - 1) / WORD_BITS;
+    m_bits.assign(m_rows * m_words, 0);
+    m_dirty = false;
+
+    for (const auto& rect : pending)
+        damage(rect);
+}
+
+void TileDamage::set_bits(size_t row, size_t first, size_t last)
+{
+    auto words = &m_bits[row * m_words];
+    const auto first_word = first / WORD_BITS;
+    const auto last_word = last / WORD_BITS;
+
+    for (auto w = first_word; w <= last_word; ++w)
+    {
+        const auto lo = (w == first_word) ? first % WORD_BITS : 0;
+        const auto hi = (w == last_word) ? last % WORD_BITS : WORD_BITS - 1;
+        const auto count = hi - lo + 1;
+        const Word mask = (count == WORD_BITS) ? ~Word(0) :
+                          (((Word(1) << count) - 1) << lo);
+        words[w] |= mask;
+    }
+}
+
+void TileDamage::damage(const Rect& rect)
+{
+    const auto r = Rect::intersection(rect, Rect(m_area));
+    if (r.empty())
+        return;
+
+    const size_t first_column = r.left() / m_tile.width();
+    const size_t last_column = (r.right() - 1) / m_tile.width();
+    const size_t first_row = r.top() / m_tile.height();
+    const size_t last_row = (r.bottom() - 1) / m_tile.height();
+
+    for (auto row = first_row; row <= last_row; ++row)
+        set_bits(row, first_column, last_column);
+
+    m_dirty = true;
+}
+
+void TileDamage::clear()
+{
+    if (m_dirty)
+    {
+        std::fill(m_bits.begin(), m_bits.end(), 0);
+        m_dirty = false;
+    }
+}
+
+void TileDamage::extract(Screen::DamageArray& damage)
+{
+    if (!m_dirty)
+        return;
+
+    /*
+     * Runs of dirty tiles from the previous row, as [first, last] columns,
+     * that are still open to be extended downwards.
+     */
+    struct Span
+    {
+        size_t first;
+        size_t last;
+        size_t row;
+    };
+
+    std::vector<Span> open;
+    std::vector<Span> current;
+
+    const auto emit = [this, &damage](const Span & span, size_t end_row)
+    {
+        const Rect rect(span.first * m_tile.width(),
+                        span.row * m_tile.height(),
+                        (span.last - span.first + 1) * m_tile.width(),
+                        (end_row - span.row) * m_tile.height());
+        damage.emplace_back(Rect::intersection(rect, Rect(m_area)));
+    };
+
+    for (size_t row = 0; row < m_rows; ++row)
+    {
+        current.clear();
+
+        const auto words = &m_bits[row * m_words];
+        for (size_t column = 0; column < m_columns;)
+        {
+            // skip whole clean words quickly
+            if (column % WORD_BITS == 0 && !words[column / WORD_BITS])
+            {
+                column += WORD_BITS;
+                continue;
+            }
+
+            if (!test(row, column))
+            {
+                ++column;
+                continue;
+            }
+
+            const auto first = column;
+            while (column < m_columns && test(row, column))
+                ++column;
+
+            Span span{first, column - 1, row};
+
+            // continue an identical span from the previous row
+            auto i = std::find_if(open.begin(), open.end(), [&span](const Span & s)
+            {
+                return s.first == span.first && s.last == span.last;
+            });
+            if (i != open.end())
+            {
+                span.row = i->row;
+                open.erase(i);
+            }
+
+            current.push_back(span);
+        }
+
+        // anything not continued in this row is complete
+        for (const auto& span : open)
+            emit(span, row);
+
+        open.swap(current);
+    }
+
+    for (const auto& span : open)
+        emit(span, m_rows);
+
+    std::fill(m_bits.begin(), m_bits.end(), 0);
+    m_dirty = false;
+}
+
+}
+}
+}
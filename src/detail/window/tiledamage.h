@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_TILEDAMAGE_H
+#define EGT_SRC_DETAIL_WINDOW_TILEDAMAGE_H
+
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <egt/geometry.h>
+#include <egt/screen.h>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Fixed size tile grid used to track damage.
+ *
+ * Instead of maintaining a list of rectangles that has to be merged on every
+ * damage, each damage marks the tiles it covers in a bitmap. Each row of tiles
+ * is a set of 64 bit words, so marking a rectangle costs one mask operation
+ * per tile row and word. At the end of a frame, the bitmap is converted to a
+ * list of rectangles by extracting runs of dirty tiles in each row and
+ * coalescing identical runs in consecutive rows.
+ *
+ * The number of rectangles produced, and the number of pixels they cover, is
+ * bounded by the grid size regardless of how many times damage is called.
+ */
+class EGT_API TileDamage
+{
+public:
+
+    /**
+     * @param area Size of the area being tracked.
+     * @param tile Size of a single tile.
+     */
+    explicit TileDamage(const Size& area, const Size& tile = Size(32, 32));
+
+    /**
+     * Change the size of the area being tracked.
+     *
+     * Any pending damage is preserved, clipped to the new area.
+     */
+    void resize(const Size& area);
+
+    /// Get the size of the area being tracked.
+    EGT_NODISCARD const Size& area() const { return m_area; }
+
+    /// Get the size of a tile.
+    EGT_NODISCARD const Size& tile() const { return m_tile; }
+
+    /// Mark all tiles covered by the rectangle as dirty.
+    void damage(const Rect& rect);
+
+    /// Returns true if no tile is dirty.
+    EGT_NODISCARD bool empty() const { return !m_dirty; }
+
+    /// Mark all tiles as clean.
+    void clear();
+
+    /**
+     * Append the dirty tiles as a list of rectangles and clear the grid.
+     *
+     * @param[out] damage The array the rectangles are appended to.
+     */
+    void extract(Screen::DamageArray& damage);
+
+protected:
+
+    using Word = uint64_t;
+
+    static constexpr size_t WORD_BITS = sizeof(Word) * 8;
+
+    /// Set the bits [first, last] in a row.
+    void set_bits(size_t row, size_t first, size_t last);
+
+    /// Test if a tile is dirty.
+    EGT_NODISCARD bool test(size_t row, size_t column) const
+    {
+        return m_bits[row * m_words + column / WORD_BITS] &
+               (Word(1) << (column % WORD_BITS));
+    }
+
+    /// Size of the tracked area.
+    Size m_area;
+    /// Size of a tile.
+    Size m_tile;
+    /// Number of tile columns.
+    size_t m_columns{0};
+    /// Number of tile rows.
+    size_t m_rows{0};
+    /// Number of words per row.
+    size_t m_words{0};
+    /// Tile bitmap, m_rows * m_words words.
+    std::vector<Word> m_bits;
+    /// True if any tile is dirty.
+    bool m_dirty{false};
+};
+
+}
+}
+}
+
+#endif
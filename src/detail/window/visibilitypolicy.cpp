@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/window/occlusionpolicy.h"
+#include "detail/window/visibilitypolicy.h"
+#include "egt/animation.h"
+#include "egt/timer.h"
+#include "egt/widget.h"
+#include "egt/window.h"
+#include <algorithm>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+namespace
+{
+
+/// A timer or an animation, and the widget it is bound to.
+struct Binding
+{
+    Widget* widget{nullptr};
+    Timer* timer{nullptr};
+    AutoAnimation* animation{nullptr};
+};
+
+std::vector<Binding>& bindings()
+{
+    static std::vector<Binding> value;
+    return value;
+}
+
+template<class F>
+void remove_if(F&& pred)
+{
+    auto& b = bindings();
+    b.erase(std::remove_if(b.begin(), b.end(), std::forward<F>(pred)), b.end());
+}
+
+/// Rectangle of a widget, on the display.
+Rect displayed(const Widget& widget)
+{
+    const auto origin = widget.local_to_display(Point());
+    return Rect(Point(origin.x(), origin.y()), widget.size());
+}
+
+}
+
+void VisibilityPolicy::bind(Timer& timer, Widget& widget)
+{
+    unbind(timer);
+    bindings().push_back({&widget, &timer, nullptr});
+}
+
+void VisibilityPolicy::bind(AutoAnimation& animation, Widget& widget)
+{
+    unbind(animation);
+    bindings().push_back({&widget, nullptr, &animation});
+}
+
+void VisibilityPolicy::unbind(const Timer& timer) noexcept
+{
+    remove_if([&timer](const Binding & b) { return b.timer == &timer; });
+}
+
+void VisibilityPolicy::unbind(const AutoAnimation& animation) noexcept
+{
+    remove_if([&animation](const Binding & b) { return b.animation == &animation; });
+}
+
+void VisibilityPolicy::unbind(const Widget& widget)
+{
+    if (bindings().empty())
+        return;
+
+    // what outlives the widget is not held back by it anymore
+    for (auto& b : bindings())
+    {
+        if (b.widget != &widget)
+            continue;
+
+        if (b.timer)
+            b.timer->suspend(false);
+        if (b.animation)
+            b.animation->suspend(false);
+    }
+
+    remove_if([&widget](const Binding & b) { return b.widget == &widget; });
+}
+
+bool VisibilityPolicy::visible(const Widget& widget)
+{
+    auto rect = displayed(widget);
+
+    for (auto w = &widget; w; w = w->parent())
+    {
+        if (!w->visible())
+            return false;
+
+        // what is outside of a parent is clipped, or scrolled out of view
+        const auto bounds = displayed(*w);
+        rect = Rect::intersection(rect, bounds);
+        if (rect.empty())
+            return false;
+
+        if (w->has_screen())
+        {
+            const auto& window = static_cast<const Window&>(*w);
+            return !OcclusionPolicy::covered(window, rect - bounds.point());
+        }
+    }
+
+    // not in a window on a screen
+    return false;
+}
+
+void VisibilityPolicy::update()
+{
+    for (auto& b : bindings())
+    {
+        const auto suspend = !visible(*b.widget);
+
+        if (b.timer)
+            b.timer->suspend(suspend);
+        if (b.animation)
+            b.animation->suspend(suspend);
+    }
+}
+
+}
+}
+}
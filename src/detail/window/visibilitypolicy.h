@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WINDOW_VISIBILITYPOLICY_H
+#define EGT_SRC_DETAIL_WINDOW_VISIBILITYPOLICY_H
+
+namespace egt
+{
+inline namespace v1
+{
+class AutoAnimation;
+class Timer;
+class Widget;
+
+namespace detail
+{
+
+/**
+ * Suspends the timers and animations bound to widgets that cannot be seen.
+ *
+ * A widget can be seen when it and all of its parents are visible, when it
+ * is not scrolled or clipped out of its parents, like a widget of a hidden
+ * Notebook page or out of the viewport of a ScrolledView, and when it is not
+ * covered by an opaque plane window, see OcclusionPolicy.
+ *
+ * @see Timer::bind(), AutoAnimation::bind()
+ */
+class VisibilityPolicy
+{
+public:
+
+    /// Bind a timer to a widget, instead of any widget it was bound to.
+    static void bind(Timer& timer, Widget& widget);
+
+    /// Bind an animation to a widget, instead of any widget it was bound to.
+    static void bind(AutoAnimation& animation, Widget& widget);
+
+    /// Forget the widget a timer is bound to, if any.
+    static void unbind(const Timer& timer) noexcept;
+
+    /// Forget the widget an animation is bound to, if any.
+    static void unbind(const AutoAnimation& animation) noexcept;
+
+    /// Forget, and resume, the timers and animations bound to a widget being destroyed.
+    static void unbind(const Widget& widget);
+
+    /**
+     * Returns true if a widget can be seen.
+     *
+     * Its position and the positions of its parents must be up to date.
+     */
+    static bool visible(const Widget& widget);
+
+    /**
+     * Suspend or resume the timers and animations bound to widgets.
+     *
+     * This must be called once per frame, after laying out and updating the
+     * occlusion of windows, before drawing.
+     */
+    static void update();
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/workerpool.h"
+#include <algorithm>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    EGTLOG_DEBUG("starting {} worker threads", threads);
+
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        m_threads.emplace_back(&WorkerPool::work, this);
+}
+
+WorkerPool::~WorkerPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_jobs.clear();
+    }
+    m_wake.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void WorkerPool::post(uint64_t id, int priority, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.emplace(std::make_pair(-priority, id), std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+bool WorkerPool::cancel(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto i = std::find_if(m_jobs.begin(), m_jobs.end(),
+                          [id](const std::pair<const std::pair<int, uint64_t>, Job>& job)
+    {
+        return job.first.second == id;
+    });
+
+    if (i == m_jobs.end())
+        return false;
+
+    m_jobs.erase(i);
+    return true;
+}
+
+void WorkerPool::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+        if (m_stop)
+            return;
+
+        auto job = std::move(m_jobs.begin()->second);
+        m_jobs.erase(m_jobs.begin());
+
+        lock.unlock();
+        job();
+        // the job is destroyed without the lock, as it may hold anything
+        job = nullptr;
+        lock.lock();
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef EGT_SRC_DETAIL_WORKERPOOL_H
+#define EGT_SRC_DETAIL_WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <egt/detail/meta.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/**
+ * Pool of worker threads running jobs in the background.
+ *
+ * Unlike the DrawPool, jobs are independent, and the thread posting them
+ * does not wait.  Queued jobs run by priority, and in the order they were
+ * posted for the same priority.
+ */
+class WorkerPool : private NonCopyable<WorkerPool>
+{
+public:
+
+    /// Type of a job.
+    using Job = std::function<void()>;
+
+    /**
+     * @param[in] threads Number of worker threads.
+     */
+    explicit WorkerPool(size_t threads);
+
+    /**
+     * Drop the queued jobs, and wait for the running ones.
+     */
+    ~WorkerPool() noexcept;
+
+    /**
+     * Number of worker threads.
+     */
+    EGT_NODISCARD size_t size() const { return m_threads.size(); }
+
+    /**
+     * Queue a job.
+     *
+     * @param[in] id Id of the job, increasing with each job.
+     * @param[in] priority Jobs of a higher priority run first.
+     * @param[in] job The job.
+     */
+    void post(uint64_t id, int priority, Job job);
+
+    /**
+     * Remove a job from the queue.
+     *
+     * @return true if the job was queued, false if it already started.
+     */
+    bool cancel(uint64_t id);
+
+protected:
+
+    void work();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    /// Queued jobs, by negated priority and id.
+    std::map<std::pair<int, uint64_t>, Job> m_jobs;
+    bool m_stop{false};
+    std::vector<std::thread> m_threads;
+};
+
+}
+}
+}
+
+#endif
@@ -17,7 +17,7 @@ Dialog::Dialog(const Rect& rect) noexcept
       m_button1("OK"),
       m_button2("Cancel")
 {
-    name("Dialog" + std::to_string(m_widgetid));
+    default_name("Dialog", m_widgetid);
     initialize();
 }
 
@@ -124,14 +124,14 @@ void Dialog::widget(const std::shared_ptr<Widget>& widget)
 
 Size Dialog::min_size_hint() const
 {
-    auto min_height = std::max(m_button1.min_size_hint().height(),
-                               m_button2.min_size_hint().height()) / 0.15;
+    auto min_height = std::max(m_button1.cached_min_size_hint().height(),
+                               m_button2.cached_min_size_hint().height()) / 0.15;
 
     if (min_height > Application::instance().screen()->size().height())
         min_height = Application::instance().screen()->size().height();
 
-    auto min_width = std::max(m_button1.min_size_hint().width(),
-                              m_button2.min_size_hint().width()) * 2;
+    auto min_width = std::max(m_button1.cached_min_size_hint().width(),
+                              m_button2.cached_min_size_hint().width()) * 2;
 
     if (min_width > Application::instance().screen()->size().width())
         min_width = Application::instance().screen()->size().width();
@@ -155,7 +155,7 @@ void Dialog::layout()
         // cppcheck-suppress unreadVariable
         auto reset = detail::on_scope_exit([this]() { m_in_layout = false; });
         auto s = size();
-        auto m = min_size_hint();
+        auto m = cached_min_size_hint();
         if (s.width() < m.width())
             s.width(m.width());
         if (s.height() < m.height())
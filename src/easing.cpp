@@ -3,8 +3,11 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "egt/easing.h"
+#include "detail/pixelopsimpl.h"
 #include "egt/detail/math.h"
+#include "egt/detail/pixelops.h"
+#include "egt/easing.h"
+#include <algorithm>
 #include <cmath>
 
 namespace egt
@@ -324,5 +327,27 @@ EasingScalar easing_cubic_bezier::operator()(EasingScalar p)
            std::pow(p, 3.0f) * m_p3;
 }
 
+easing_table::easing_table(const std::function<EasingScalar(EasingScalar)>& func,
+                           size_t samples)
+{
+    samples = std::max<size_t>(samples, 2);
+
+    auto table = std::make_shared<std::vector<EasingScalar>>(samples);
+    for (size_t i = 0; i < samples; ++i)
+        (*table)[i] = func(static_cast<EasingScalar>(i) / static_cast<EasingScalar>(samples - 1));
+
+    m_table = std::move(table);
+}
+
+EasingScalar easing_table::operator()(EasingScalar p) const
+{
+    return detail::sample_table_at(m_table->data(), m_table->size(), p);
+}
+
+void easing_table::operator()(const EasingScalar* p, EasingScalar* out, size_t count) const
+{
+    detail::sample_table(m_table->data(), m_table->size(), p, out, count);
+}
+
 }
 }
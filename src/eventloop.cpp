@@ -3,17 +3,34 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/animationticker.h"
 #include "detail/dump.h"
 #include "detail/egtlog.h"
 #include "detail/priorityqueue.h"
+#include "detail/timerwheel.h"
+#include "detail/window/occlusionpolicy.h"
+#include "detail/window/planepolicy.h"
+#include "detail/window/scanoutpolicy.h"
+#include "detail/window/visibilitypolicy.h"
+#include "detail/workerpool.h"
 #include "egt/app.h"
+#include "egt/detail/drawdiagnostics.h"
 #include "egt/eventloop.h"
+#include "egt/input.h"
+#include "egt/profiler.h"
+#include "egt/screen.h"
 #include "egt/tools.h"
+#include "egt/updatechannel.h"
 #include "egt/widget.h"
 #include "egt/window.h"
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <cstring>
 #include <egt/asio.hpp>
+#include <map>
 #include <numeric>
+#include <thread>
 
 namespace egt
 {
@@ -22,16 +39,88 @@ inline namespace v1
 
 struct EventLoop::EventLoopImpl
 {
+    explicit EventLoopImpl(EventLoop& event)
+        : m_ticker(event, m_wheel, m_queue)
+    {}
+
     asio::io_context m_io;
     asio::executor_work_guard<asio::io_context::executor_type> m_work{egt::asio::make_work_guard(m_io)};
     detail::PriorityQueue m_queue;
+    detail::TimerWheel m_wheel{m_io};
+    detail::AnimationTicker m_ticker;
+    asio::steady_timer m_frame_timer{m_io};
+    asio::steady_timer m_fidelity_timer{m_io};
+    asio::steady_timer m_idle_timer{m_io};
+    /// Updates queued from any thread, last queued first.
+    std::atomic<detail::UpdateState*> m_updates{nullptr};
+    /// Callbacks of the jobs not done yet.
+    std::map<WorkHandle, std::function<void()>> m_work_done;
+    /// Last job handle.
+    WorkHandle m_work_handle{0};
+    /// Worker threads, started by the first job.
+    std::unique_ptr<detail::WorkerPool> m_workers;
 };
 
+static inline bool deferred_layout_enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_DEFERRED_LAYOUT") && strlen(std::getenv("EGT_DEFERRED_LAYOUT")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+static inline bool coalesce_motion_enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_COALESCE_MOTION") && strlen(std::getenv("EGT_COALESCE_MOTION")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+static inline bool adaptive_fidelity_enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_ADAPTIVE_FIDELITY") && strlen(std::getenv("EGT_ADAPTIVE_FIDELITY")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+static inline std::chrono::milliseconds timer_slack_value()
+{
+    static int value = -1;
+    if (value < 0)
+    {
+        value = 0;
+        if (std::getenv("EGT_TIMER_SLACK"))
+            value = std::max(0, std::atoi(std::getenv("EGT_TIMER_SLACK")));
+    }
+    return std::chrono::milliseconds(value);
+}
+
 EventLoop::EventLoop(const Application& app) noexcept
-    : m_impl(std::make_unique<EventLoopImpl>()),
+    : m_impl(std::make_unique<EventLoopImpl>(*this)),
       m_app(app)
 {
     m_exit_value = -1;
+    m_deferred_layout = deferred_layout_enabled();
+    m_coalesce_motion = coalesce_motion_enabled();
+    m_adaptive_fidelity = adaptive_fidelity_enabled();
+    m_impl->m_wheel.slack(timer_slack_value());
 }
 
 asio::io_context& EventLoop::io()
@@ -55,15 +144,36 @@ static inline bool time_event_loop_enabled()
 // maximum number of handlers when in a tight poll loop
 static const auto MAX_POLL_COUNT = 10;
 
+// maximum number of deferred layout passes before a frame
+static const auto MAX_LAYOUT_PASSES = 4;
+
+// number of frames in a row over budget before lowering the fidelity
+static const auto SLOW_FRAMES = 3;
+
 int EventLoop::wait()
 {
     int ret = 0;
 
     detail::code_timer(time_event_loop_enabled(), "wait: ", [this, &ret]()
     {
-        ret = m_impl->m_io.run_one_for(std::chrono::milliseconds(100));
+        Profiler::Scope scope(Profiler::Phase::wait);
+
+        // handlers deferred by the last frame are ready, so don't block
+        const auto block = m_impl->m_queue.empty();
+        if (!block)
+            ret = m_impl->m_io.poll_one() + 1;
+        else if (!m_idle.empty())
+            ret = m_impl->m_io.run_one_for(std::chrono::milliseconds(100));
+        else
+            ret = m_impl->m_io.run_one();
+
         if (ret)
         {
+            if (block)
+                count_wakeup();
+
+            const auto start = std::chrono::steady_clock::now();
+
             // hmm, libinput async_read will always return something on poll_one()
             // until we have satisfied the handler, so we have to give up at
             // some point
@@ -71,9 +181,7 @@ int EventLoop::wait()
             while (m_impl->m_io.poll_one() && count--)
             {}
 
-#ifdef USE_PRIORITY_QUEUE
-            m_impl->m_queue.execute_all();
-#endif
+            execute_queue(start);
         }
     });
 
@@ -90,6 +198,28 @@ int EventLoop::wait()
     return ret;
 }
 
+void EventLoop::count_wakeup()
+{
+    if (m_impl->m_queue.empty())
+    {
+        m_wakeup_stats.other++;
+        return;
+    }
+
+    switch (m_impl->m_queue.top())
+    {
+    case detail::priorities::input:
+        m_wakeup_stats.input++;
+        break;
+    case detail::priorities::timer:
+        m_wakeup_stats.timer++;
+        break;
+    default:
+        m_wakeup_stats.background++;
+        break;
+    }
+}
+
 void EventLoop::quit(int exit_value)
 {
     m_exit_value = exit_value;
@@ -99,8 +229,40 @@ void EventLoop::quit(int exit_value)
 
 void EventLoop::draw()
 {
+    const auto start = std::chrono::steady_clock::now();
+    auto screen = m_app.screen();
+    const auto flips = screen ? screen->flip_stats().frames : 0;
+
+    Input::flush_motion();
+
+    // a layout may change the size of a parent that was already laid out in
+    // the same pass, so run passes until nothing is left
+    const auto& windows = m_app.windows();
+    for (auto pass = 0; pass < MAX_LAYOUT_PASSES; ++pass)
+    {
+        if (std::none_of(windows.begin(), windows.end(),
+                         [](const Window * w) { return w->layout_pending(); }))
+            break;
+
+        Profiler::Scope scope(Profiler::Phase::layout);
+
+        // windows may be created while laying out, so don't hold onto any
+        for (size_t i = 0; i < windows.size(); ++i)
+        {
+            if (windows[i]->layout_pending())
+                windows[i]->flush_layout();
+        }
+    }
+
     detail::code_timer(time_event_loop_enabled(), "draw: ", [this]()
     {
+        Profiler::Scope scope(Profiler::Phase::draw);
+
+        detail::PlanePolicy::update(m_app.windows());
+        detail::ScanoutPolicy::update(m_app.windows());
+        detail::OcclusionPolicy::update(m_app.windows());
+        detail::VisibilityPolicy::update();
+
         for (auto& w : m_app.windows())
         {
             if (!w->visible())
@@ -111,16 +273,203 @@ void EventLoop::draw()
                 w->begin_draw();
         }
     });
+
+    // submit what the screen batched for the frame
+    if (screen)
+        screen->end_frame();
+
+    Profiler::instance().end_frame();
+
+    auto& diagnostics = detail::DrawDiagnostics::instance();
+    if (egt_unlikely(diagnostics.enabled()))
+        diagnostics.end_frame();
+
+    // only frames that were flipped say anything about the load
+    if (m_adaptive_fidelity && screen && screen->flip_stats().frames != flips)
+        govern_fidelity(std::chrono::steady_clock::now() - start);
+}
+
+void EventLoop::adaptive_fidelity(bool enable,
+                                  std::chrono::microseconds budget,
+                                  std::chrono::milliseconds idle)
+{
+    m_fidelity_budget = budget;
+    m_fidelity_idle = idle;
+
+    if (enable == m_adaptive_fidelity)
+        return;
+
+    m_adaptive_fidelity = enable;
+    m_slow_frames = 0;
+
+    if (!enable && m_low_fidelity)
+    {
+        m_impl->m_fidelity_timer.cancel();
+        fidelity(false);
+    }
+}
+
+void EventLoop::idle_timeout(std::chrono::milliseconds timeout, size_t brightness,
+                             IdleStateCallback callback)
+{
+    if (m_idle_state)
+        idle_state(false);
+
+    m_idle_timeout = timeout;
+    m_idle_brightness = brightness;
+    m_idle_callback = std::move(callback);
+
+    m_impl->m_idle_timer.cancel();
+    if (m_idle_handle)
+    {
+        Input::global_input().remove_handler(m_idle_handle);
+        m_idle_handle = 0;
+    }
+
+    if (timeout.count() <= 0)
+        return;
+
+    m_idle_handle = Input::global_input().on_event([this](Event&)
+    {
+        m_last_input = std::chrono::steady_clock::now();
+        if (m_idle_state)
+        {
+            idle_state(false);
+            wait_idle();
+        }
+    }, {EventId::raw_pointer_down, EventId::raw_pointer_up, EventId::raw_pointer_move,
+        EventId::keyboard_down, EventId::keyboard_up, EventId::keyboard_repeat});
+
+    m_last_input = std::chrono::steady_clock::now();
+    wait_idle();
+}
+
+void EventLoop::wait_idle()
+{
+    // input only records its time, so the timer wakes up once per timeout
+    m_impl->m_idle_timer.expires_at(m_last_input + m_idle_timeout);
+    m_impl->m_idle_timer.async_wait([this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        if (std::chrono::steady_clock::now() < m_last_input + m_idle_timeout)
+            wait_idle();
+        else
+            idle_state(true);
+    });
+}
+
+void EventLoop::idle_state(bool idle)
+{
+    EGTLOG_DEBUG("{} idle state", idle ? "entering" : "leaving");
+
+    m_idle_state = idle;
+
+    auto screen = m_app.screen();
+    if (idle)
+    {
+        if (screen)
+        {
+            m_active_brightness = screen->brightness();
+            screen->brightness(m_idle_brightness);
+        }
+
+        m_impl->m_frame_timer.cancel();
+        m_frame_scheduled = false;
+    }
+    else
+    {
+        if (screen)
+            screen->brightness(m_active_brightness);
+
+        if (!m_frame_callbacks.empty())
+            request_frame();
+    }
+
+    if (m_idle_callback)
+        m_idle_callback(idle);
+}
+
+void EventLoop::govern_fidelity(std::chrono::steady_clock::duration elapsed)
+{
+    if (elapsed > m_fidelity_budget)
+        m_slow_frames++;
+    else
+        m_slow_frames = 0;
+
+    if (!m_low_fidelity && m_slow_frames >= SLOW_FRAMES)
+    {
+        EGTLOG_DEBUG("{} slow frames, switching to low fidelity", m_slow_frames);
+        fidelity(true);
+    }
+
+    if (m_low_fidelity)
+    {
+        // restore high fidelity once the motion stops
+        m_impl->m_fidelity_timer.expires_after(m_fidelity_idle);
+        m_impl->m_fidelity_timer.async_wait([this](const asio::error_code & error)
+        {
+            if (error)
+                return;
+
+            EGTLOG_DEBUG("idle, switching to high fidelity");
+            fidelity(false);
+        });
+    }
+}
+
+void EventLoop::fidelity(bool low)
+{
+    m_low_fidelity = low;
+    m_slow_frames = 0;
+
+    auto apply = [low](Screen * screen)
+    {
+        if (low)
+            screen->low_fidelity();
+        else
+            screen->high_fidelity();
+    };
+
+    if (m_app.screen())
+        apply(m_app.screen());
+
+    for (auto& w : m_app.windows())
+    {
+        if (w->plane_window() && w->screen())
+            apply(w->screen());
+
+        // what was drawn in low fidelity is drawn again
+        if (!low && w->visible() && (w->top_level() || w->plane_window()))
+            w->damage();
+    }
+}
+
+void EventLoop::execute_queue(std::chrono::steady_clock::time_point start)
+{
+    const auto deadline = m_dispatch_budget.count() ?
+                          start + m_dispatch_budget :
+                          detail::PriorityQueue::Clock::time_point::max();
+    if (m_impl->m_queue.execute(deadline))
+    {
+        EGTLOG_TRACE("{} handlers deferred to the next frame", m_impl->m_queue.size());
+    }
 }
 
 int EventLoop::poll()
 {
-    int ret = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    int ret = m_impl->m_queue.empty() ? 0 : 1;
     int count = MAX_POLL_COUNT;
     while (m_impl->m_io.poll_one() && count--)
     {
         ret++;
     }
+
+    execute_queue(start);
+
     return ret;
 }
 
@@ -146,10 +495,266 @@ static inline bool show_fps_enabled()
     return value == 1;
 }
 
+static inline bool frame_clock_enabled()
+{
+    static int value = 0;
+    if (value == 0)
+    {
+        if (std::getenv("EGT_FRAME_CLOCK") && strlen(std::getenv("EGT_FRAME_CLOCK")))
+            value += 1;
+        else
+            value -= 1;
+    }
+    return value == 1;
+}
+
+void EventLoop::frame_clock(bool enable, std::chrono::microseconds period)
+{
+    m_frame_period = period;
+
+    if (enable == m_frame_clock)
+        return;
+
+    m_frame_clock = enable;
+
+    auto screen = m_app.screen();
+    if (enable)
+    {
+        if (screen)
+        {
+            screen->on_flip([this](std::chrono::steady_clock::time_point when)
+            {
+                flip_completed(when);
+            });
+        }
+
+        if (!m_frame_callbacks.empty())
+            request_frame();
+    }
+    else
+    {
+        if (screen)
+            screen->on_flip(nullptr);
+
+        m_impl->m_frame_timer.cancel();
+        m_frame_scheduled = false;
+    }
+}
+
+void EventLoop::request_frame()
+{
+    // frames are suspended while idle
+    if (!m_frame_clock || m_frame_scheduled || m_idle_state)
+        return;
+
+    m_frame_scheduled = true;
+
+    const auto now = std::chrono::steady_clock::now();
+    m_impl->m_frame_timer.expires_at(std::max(now, m_last_frame + m_frame_period));
+    m_impl->m_frame_timer.async_wait([this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        frame();
+    });
+}
+
+void EventLoop::flip_completed(std::chrono::steady_clock::time_point when)
+{
+    // The last frame is on the screen, so this is the vertical blanking the
+    // next frame should start at.  Completions that follow a frame too soon
+    // are asynchronous flips that can't be used for pacing.
+    if (!m_frame_scheduled || when < m_last_frame + m_frame_period / 2)
+        return;
+
+    m_impl->m_frame_timer.expires_at(when);
+    m_impl->m_frame_timer.async_wait([this](const asio::error_code & error)
+    {
+        if (error)
+            return;
+
+        frame();
+    });
+}
+
+void EventLoop::frame()
+{
+    m_frame_scheduled = false;
+    m_last_frame = std::chrono::steady_clock::now();
+
+    m_in_frame = true;
+    // callbacks may add callbacks, so don't hold onto any element
+    for (size_t i = 0; i < m_frame_callbacks.size(); ++i)
+    {
+        auto callback = m_frame_callbacks[i].second;
+        if (callback)
+            callback(m_last_frame);
+    }
+    m_in_frame = false;
+
+    m_frame_callbacks.erase(std::remove_if(m_frame_callbacks.begin(),
+                                           m_frame_callbacks.end(),
+                                           [](const std::pair<FrameHandle, FrameCallback>& c)
+    {
+        return !c.second;
+    }), m_frame_callbacks.end());
+
+    draw();
+
+    if (!m_frame_callbacks.empty())
+        request_frame();
+}
+
+EventLoop::FrameHandle EventLoop::add_frame_callback(FrameCallback func)
+{
+    const auto handle = ++m_frame_handle;
+    m_frame_callbacks.emplace_back(handle, std::move(func));
+    request_frame();
+    return handle;
+}
+
+void EventLoop::remove_frame_callback(FrameHandle handle)
+{
+    auto i = std::find_if(m_frame_callbacks.begin(), m_frame_callbacks.end(),
+                          [handle](const std::pair<FrameHandle, FrameCallback>& c)
+    {
+        return c.first == handle;
+    });
+
+    if (i == m_frame_callbacks.end())
+        return;
+
+    if (m_in_frame)
+        i->second = nullptr;
+    else
+        m_frame_callbacks.erase(i);
+}
+
+EventLoop::WorkHandle EventLoop::submit_work(std::function<void()> job,
+        std::function<void()> done,
+        WorkPriority priority)
+{
+    if (!m_impl->m_workers)
+    {
+        // like the draw pool, leave a core for the event loop
+        const auto cores = std::thread::hardware_concurrency();
+        m_impl->m_workers = std::make_unique<detail::WorkerPool>(std::max(cores, 2u) - 1);
+    }
+
+    const auto handle = ++m_impl->m_work_handle;
+    m_impl->m_work_done.emplace(handle, std::move(done));
+
+    m_impl->m_workers->post(handle, static_cast<int>(priority),
+                            [this, handle, job = std::move(job)]()
+    {
+        auto ok = true;
+        try
+        {
+            job();
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("job failed: {}", e.what());
+            ok = false;
+        }
+
+        asio::post(m_impl->m_io, m_impl->m_queue.wrap(detail::priorities::background,
+                   [this, handle, ok]()
+        {
+            auto i = m_impl->m_work_done.find(handle);
+            if (i == m_impl->m_work_done.end())
+                return;
+
+            // the callback may submit or cancel
+            auto callback = std::move(i->second);
+            m_impl->m_work_done.erase(i);
+
+            if (ok && callback)
+                callback();
+        }));
+    });
+
+    return handle;
+}
+
+void EventLoop::cancel(WorkHandle handle)
+{
+    m_impl->m_work_done.erase(handle);
+    if (m_impl->m_workers)
+        m_impl->m_workers->cancel(handle);
+}
+
+void EventLoop::queue_update(const std::shared_ptr<detail::UpdateState>& update)
+{
+    // only the first value posted since the update was applied queues it
+    if (update->queued.exchange(true, std::memory_order_acq_rel))
+        return;
+
+    update->self = update;
+
+    auto head = m_impl->m_updates.load(std::memory_order_relaxed);
+    do
+    {
+        update->next = head;
+    }
+    while (!m_impl->m_updates.compare_exchange_weak(head, update.get(),
+            std::memory_order_release,
+            std::memory_order_relaxed));
+
+    // the first update queued wakes up the event loop, once for all of them
+    if (head)
+        return;
+
+    asio::post(io(), [this]()
+    {
+        if (!m_frame_clock)
+        {
+            apply_updates();
+            return;
+        }
+
+        auto handle = std::make_shared<FrameHandle>(0);
+        *handle = add_frame_callback([this, handle](std::chrono::steady_clock::time_point)
+        {
+            remove_frame_callback(*handle);
+            apply_updates();
+        });
+    });
+}
+
+void EventLoop::apply_updates()
+{
+    auto update = m_impl->m_updates.exchange(nullptr, std::memory_order_acquire);
+
+    // apply them in the order they were queued
+    detail::UpdateState* ordered = nullptr;
+    while (update)
+    {
+        auto next = update->next;
+        update->next = ordered;
+        ordered = update;
+        update = next;
+    }
+
+    while (ordered)
+    {
+        auto next = ordered->next;
+        // from now on, a new value queues the update again
+        auto self = std::move(ordered->self);
+        ordered->queued.store(false, std::memory_order_release);
+        self->apply();
+        ordered = next;
+    }
+}
+
 int EventLoop::run()
 {
     experimental::FramesPerSecond fps;
 
+    if (frame_clock_enabled())
+        frame_clock(true);
+
     // initial draw
     draw();
 
@@ -160,8 +765,9 @@ int EventLoop::run()
         // process events
         if (wait())
         {
-            // draw anything that's changed
-            draw();
+            // draw anything that's changed, unless damage requests frames
+            if (!m_frame_clock)
+                draw();
 
             if (show_fps_enabled())
             {
@@ -175,6 +781,32 @@ int EventLoop::run()
 
     EGTLOG_TRACE("EventLoop::run() exiting");
 
+    const auto trace = std::getenv("EGT_PROFILE");
+    if (trace && strlen(trace) && Profiler::instance().enabled())
+    {
+        try
+        {
+            Profiler::instance().write_trace(trace);
+        }
+        catch (const std::exception& e)
+        {
+            EGTLOG_WARN("{}", e.what());
+        }
+    }
+
+    const auto report = std::getenv("EGT_DRAW_REPORT");
+    if (report && strlen(report) && detail::DrawDiagnostics::instance().report())
+    {
+        try
+        {
+            detail::DrawDiagnostics::instance().write_report(report);
+        }
+        catch (const std::exception& e)
+        {
+            EGTLOG_WARN("{}", e.what());
+        }
+    }
+
     return m_exit_value;
 }
 
@@ -194,7 +826,43 @@ detail::PriorityQueue& EventLoop::queue()
     return m_impl->m_queue;
 }
 
-EventLoop::~EventLoop() noexcept = default;
+detail::TimerWheel& EventLoop::timer_wheel()
+{
+    return m_impl->m_wheel;
+}
+
+detail::AnimationTicker& EventLoop::animation_ticker()
+{
+    return m_impl->m_ticker;
+}
+
+void EventLoop::timer_slack(std::chrono::milliseconds slack)
+{
+    m_impl->m_wheel.slack(slack);
+}
+
+std::chrono::milliseconds EventLoop::timer_slack() const
+{
+    return m_impl->m_wheel.slack();
+}
+
+EventLoop::~EventLoop() noexcept
+{
+    if (m_idle_handle)
+        Input::global_input().remove_handler(m_idle_handle);
+
+    // running jobs post back to the io_context
+    m_impl->m_workers.reset();
+
+    // drop updates never applied
+    auto update = m_impl->m_updates.exchange(nullptr);
+    while (update)
+    {
+        auto next = update->next;
+        update->self.reset();
+        update = next;
+    }
+}
 
 }
 }
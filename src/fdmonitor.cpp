@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/priorityqueue.h"
+#include "egt/app.h"
+#include "egt/fdmonitor.h"
+
+namespace egt
+{
+inline namespace v1
+{
+
+static detail::priorities queue_priority(FdMonitor::Priority priority)
+{
+    switch (priority)
+    {
+    case FdMonitor::Priority::background:
+        return detail::priorities::background;
+    case FdMonitor::Priority::normal:
+        return detail::priorities::timer;
+    case FdMonitor::Priority::input:
+        break;
+    }
+    return detail::priorities::input;
+}
+
+FdMonitor::FdMonitor(int fd, Callback callback, Priority priority, bool own)
+    : m_stream(std::make_unique<asio::posix::stream_descriptor>(
+                   Application::instance().event().io(), fd)),
+      m_callback(std::move(callback)),
+      m_priority(priority),
+      m_own(own)
+{
+    m_stream->non_blocking(true);
+    start();
+}
+
+int FdMonitor::fd() const
+{
+    return m_stream->native_handle();
+}
+
+void FdMonitor::start()
+{
+    m_running = true;
+    if (!m_waiting)
+        wait();
+}
+
+void FdMonitor::stop()
+{
+    m_running = false;
+}
+
+void FdMonitor::wait()
+{
+    m_waiting = true;
+    m_stream->async_wait(asio::posix::stream_descriptor::wait_read,
+                         Application::instance().event().queue().wrap(queue_priority(m_priority),
+                                 [this](const asio::error_code & error)
+    {
+        // aborted when destroyed, so this is gone
+        if (error == asio::error::operation_aborted)
+            return;
+
+        m_waiting = false;
+        if (error)
+        {
+            detail::warn("fd {} failed: {}", fd(), error.message());
+            m_running = false;
+            return;
+        }
+
+        if (!m_running)
+            return;
+
+        if (m_callback)
+            m_callback();
+
+        // the callback may have stopped, and started again
+        if (m_running && !m_waiting)
+            wait();
+    }, this));
+}
+
+FdMonitor::~FdMonitor() noexcept
+{
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+
+    asio::error_code ec;
+    m_stream->cancel(ec);
+    if (!m_own)
+        m_stream->release();
+}
+
+}
+}
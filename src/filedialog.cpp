@@ -3,7 +3,9 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/dirscanner.h"
 #include "detail/egtlog.h"
+#include "egt/app.h"
 #include "egt/embed.h"
 #include "egt/filedialog.h"
 #include <filesystem>
@@ -21,10 +23,10 @@ inline namespace v1
 
 FileDialog::FileDialog(const std::string& filepath, const Rect& rect) noexcept
     : Dialog(rect),
-      m_flist(std::make_shared<egt::ListBox>()),
+      m_flist(std::make_shared<egt::VirtualListBox>()),
       m_filepath(filepath)
 {
-    name("FileDialog" + std::to_string(m_widgetid));
+    default_name("FileDialog", m_widgetid);
     initialize();
 }
 
@@ -41,15 +43,31 @@ void FileDialog::initialize()
 
           widget(expand(m_flist));
 
+    m_scanner = std::make_unique<detail::DirectoryScanner>(Application::instance().event(), [this]()
+    {
+        update_files();
+    });
+
+    m_flist->binder([this](StringItem & item, size_t index)
+    {
+        item.text_align(AlignFlag::left | AlignFlag::center_vertical);
+        if (index < m_fixed_entries)
+            item.text(index ? "../" : "./");
+        else
+            item.text(m_scanner->listing()[index - m_fixed_entries].name);
+    });
+
     m_flist->on_selected([this](size_t index)
     {
         list_item_selected(index);
     });
 }
 
+FileDialog::~FileDialog() noexcept = default;
+
 FileDialog::FileDialog(Serializer::Properties& props, bool is_derived) noexcept
     : Dialog(props, true),
-      m_flist(std::make_shared<egt::ListBox>())
+      m_flist(std::make_shared<egt::VirtualListBox>())
 {
     initialize();
 
@@ -78,40 +96,60 @@ bool FileDialog::list_files(const std::string& filepath)
 
     EGTLOG_DEBUG("FileDialog : file path is {}", m_filepath);
 
-    m_flist->clear();
-
-    if (filepath != "/")
-    {
-        m_flist->add_item(std::make_shared<StringItem>("./", Rect(), AlignFlag::left | AlignFlag::center_vertical));
-
-        m_flist->add_item(std::make_shared<StringItem>("../", Rect(), AlignFlag::left | AlignFlag::center_vertical));
-    }
+    m_fixed_entries = (filepath != "/") ? 2 : 0;
 
-    try
+    std::error_code ec;
+    if (!fs::is_directory(m_filepath, ec))
     {
-        for (auto& dir : fs::directory_iterator(m_filepath))
-        {
-            m_flist->add_item(std::make_shared<StringItem>(dir.path().filename().string(), Rect(), AlignFlag::left | AlignFlag::center_vertical));
-        }
-    }
-    catch (const fs::filesystem_error& ex)
-    {
-        EGTLOG_DEBUG("FileDialog : Error: {}", ex.what());
+        EGTLOG_DEBUG("FileDialog : Error: {} is not a directory", m_filepath);
+        clear_files();
         return false;
     }
 
-    damage();
+    m_flist->scroll_top();
+
+    // entries are added as they are read
+    m_scanner->scan(m_filepath);
 
     return true;
 }
 
+void FileDialog::clear_files()
+{
+    m_scanner->clear();
+    m_fixed_entries = 0;
+    update_files();
+}
+
+void FileDialog::update_files()
+{
+    m_flist->item_count(m_fixed_entries + m_scanner->listing().size());
+}
+
+void FileDialog::filter(const std::string& pattern)
+{
+    m_scanner->filter(pattern);
+}
+
+std::string FileDialog::filter() const
+{
+    return m_scanner->filter();
+}
+
 void FileDialog::list_item_selected(int index)
 {
-    auto item = dynamic_cast<StringItem*>(m_flist->item_at(index).get());
-    if (!item)
+    if (index < 0 || static_cast<size_t>(index) >= m_flist->item_count())
+        return;
+
+    const auto& listing = m_scanner->listing();
+    const auto entry = static_cast<size_t>(index);
+    if (entry >= m_fixed_entries && entry - m_fixed_entries >= listing.size())
         return;
 
-    auto fselect = item->text();
+    const auto fselect = entry < m_fixed_entries ?
+                         std::string(entry ? "../" : "./") :
+                         listing[entry - m_fixed_entries].name;
+    const auto directory = entry >= m_fixed_entries && listing[entry - m_fixed_entries].directory;
 
     EGTLOG_DEBUG("FileDialog : File Selected is : {}", fselect);
 
@@ -127,7 +165,7 @@ void FileDialog::list_item_selected(int index)
         selected("");
         list_files(m_filepath);
     }
-    else if (fs::is_directory(m_filepath + "/" + fselect))
+    else if (directory)
     {
         EGTLOG_DEBUG("FileDialog : {} is a directory", fselect);
         selected("");
@@ -137,7 +175,7 @@ void FileDialog::list_item_selected(int index)
             m_filepath =  m_filepath + "/" + fselect;
         list_files(m_filepath);
     }
-    else if (fs::is_regular_file(m_filepath + "/" + fselect))
+    else
     {
         EGTLOG_DEBUG("FileDialog : {} is a regular file", fselect);
         selected(fselect);
@@ -159,6 +197,8 @@ void FileDialog::show_centered()
 void FileDialog::serialize(Serializer& serializer) const
 {
     serializer.add_property("filepath", m_filepath);
+    if (!filter().empty())
+        serializer.add_property("filter", filter());
     Popup::serialize(serializer);
 }
 
@@ -171,6 +211,11 @@ void FileDialog::deserialize(Serializer::Properties& props)
             list_files(std::get<1>(p));
             return true;
         }
+        else if (std::get<0>(p) == "filter")
+        {
+            filter(std::get<1>(p));
+            return true;
+        }
         return false;
     }), props.end());
 }
@@ -178,7 +223,7 @@ void FileDialog::deserialize(Serializer::Properties& props)
 FileOpenDialog::FileOpenDialog(const std::string& filepath, const Rect& rect) noexcept
     : FileDialog(filepath, rect)
 {
-    name("FileOpenDialog" + std::to_string(m_widgetid));
+    default_name("FileOpenDialog", m_widgetid);
     initialize();
 }
 
@@ -205,7 +250,7 @@ void FileOpenDialog::initialize()
     on_button2_click([this]()
     {
         this->m_fselected = std::string();
-        this->m_flist->clear();
+        this->clear_files();
         this->hide();
     });
 }
@@ -226,7 +271,7 @@ FileSaveDialog::FileSaveDialog(const std::string& filepath, const Rect& rect) no
     : FileDialog(filepath, rect),
       m_fsave_box("", Size(rect.width() * 0.50, rect.height() * 0.15))
 {
-    name("FileSaveDialog" + std::to_string(m_widgetid));
+    default_name("FileSaveDialog", m_widgetid);
     initialize();
 }
 
@@ -277,7 +322,7 @@ void FileSaveDialog::initialize()
     on_button2_click([this]()
     {
         this->m_fsave = std::string();
-        this->m_flist->clear();
+        this->clear_files();
         this->m_fsave_box.text(std::string());
         this->hide();
     });
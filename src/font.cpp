@@ -8,16 +8,37 @@
 #endif
 
 #include "detail/egtlog.h"
+#include "detail/glyphatlas.h"
 #include "egt/app.h"
-#include "egt/canvas.h"
 #include "egt/detail/enum.h"
+#include "egt/detail/filesystem.h"
+#include "egt/detail/string.h"
+#include "egt/detail/surfacepool.h"
 #include "egt/font.h"
 #include "egt/respath.h"
 #include "egt/screen.h"
 #include "egt/serialize.h"
+#include "egt/widget.h"
 #include <cairo-ft.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
+
+#ifdef HAVE_FONTCONFIG
+#include <fontconfig/fcfreetype.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace egt
 {
@@ -27,6 +48,7 @@ inline namespace v1
 constexpr const char* Font::DEFAULT_FACE;
 constexpr Font::Weight Font::DEFAULT_WEIGHT;
 constexpr Font::Slant Font::DEFAULT_SLANT;
+constexpr size_t Font::DEFAULT_FONT_CACHE_SIZE;
 
 static FT_Library ftlib{nullptr};
 
@@ -40,11 +62,13 @@ const Font* global_font()
 void global_font(std::unique_ptr<Font>&& font)
 {
     the_global_font = std::move(font);
+    Widget::invalidate_all_size_hints();
 }
 
 void reset_global_font()
 {
     the_global_font.reset(nullptr);
+    Widget::invalidate_all_size_hints();
 }
 
 static bool init_freetype()
@@ -61,22 +85,185 @@ static bool init_freetype()
     return true;
 }
 
-static void ft_done_face_uncached(void* closure)
+/**
+ * A FreeType face shared by every font of the same file, or of the same data.
+ *
+ * Files are mapped read-only instead of being read by FreeType, so their
+ * pages are the pages of the page cache, shared by every process using the
+ * same file, instead of being copied into each process.
+ */
+struct SharedFace : private detail::NonCopyable<SharedFace>
+{
+    /// Get the face of a font file, loading it if not loaded yet.
+    static std::shared_ptr<SharedFace> file(const std::string& path, long index);
+
+    /// Get the face of font data, which must outlive every font using it.
+    static std::shared_ptr<SharedFace> memory(const unsigned char* data, size_t len);
+
+    SharedFace(FT_Face f, void* map, size_t len) noexcept
+        : face(f),
+          m_map(map),
+          m_len(len)
+    {}
+
+    ~SharedFace() noexcept;
+
+    FT_Face face;
+
+private:
+
+    /// The mapping of the file, if mapped.
+    void* m_map;
+    size_t m_len;
+};
+
+/// FreeType faces of a library can't be created or done concurrently.
+static std::mutex ftlib_mutex;
+
+SharedFace::~SharedFace() noexcept
 {
-    auto face = static_cast<FT_Face>(closure);
+    std::lock_guard<std::mutex> lock(ftlib_mutex);
     FT_Done_Face(face);
+#ifdef HAVE_SYS_MMAN_H
+    if (m_map)
+        munmap(m_map, m_len);
+#endif
+}
+
+/// Erase the faces nothing uses anymore.
+template<class T>
+static void erase_expired(T& faces)
+{
+    for (auto i = faces.begin(); i != faces.end();)
+    {
+        if (i->second.expired())
+            i = faces.erase(i);
+        else
+            ++i;
+    }
+}
+
+std::shared_ptr<SharedFace> SharedFace::file(const std::string& path, long index)
+{
+    static std::map<std::pair<std::string, long>, std::weak_ptr<SharedFace>> faces;
+
+    std::lock_guard<std::mutex> lock(ftlib_mutex);
+
+    auto key = std::make_pair(path, index);
+    auto i = faces.find(key);
+    if (i != faces.end())
+    {
+        if (auto shared = i->second.lock())
+            return shared;
+    }
+
+    if (!init_freetype())
+        return nullptr;
+
+    FT_Face face{};
+    void* map = nullptr;
+    size_t len = 0;
+
+#ifdef HAVE_SYS_MMAN_H
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            len = st.st_size;
+            map = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+            if (map == MAP_FAILED)
+                map = nullptr;
+        }
+        close(fd);
+    }
+
+    if (map)
+    {
+        if (FT_New_Memory_Face(ftlib, static_cast<const FT_Byte*>(map), len, index, &face))
+        {
+            munmap(map, len);
+            return nullptr;
+        }
+    }
+    else
+#endif
+    {
+        // let FreeType read the file
+        if (FT_New_Face(ftlib, path.c_str(), index, &face))
+            return nullptr;
+    }
+
+    auto shared = std::make_shared<SharedFace>(face, map, len);
+    erase_expired(faces);
+    faces[key] = shared;
+    return shared;
+}
+
+std::shared_ptr<SharedFace> SharedFace::memory(const unsigned char* data, size_t len)
+{
+    static std::map<const unsigned char*, std::weak_ptr<SharedFace>> faces;
+
+    std::lock_guard<std::mutex> lock(ftlib_mutex);
+
+    auto i = faces.find(data);
+    if (i != faces.end())
+    {
+        if (auto shared = i->second.lock())
+            return shared;
+    }
+
+    if (!init_freetype())
+        return nullptr;
+
+    FT_Face face{};
+    if (FT_New_Memory_Face(ftlib, static_cast<const FT_Byte*>(data), len, 0, &face))
+        return nullptr;
+
+    auto shared = std::make_shared<SharedFace>(face, nullptr, 0);
+    erase_expired(faces);
+    faces[data] = shared;
+    return shared;
+}
+
+static void release_shared_face(void* closure)
+{
+    delete static_cast<std::shared_ptr<SharedFace>*>(closure);
+}
+
+/**
+ * Keep a shared face for as long as a font face uses it.
+ *
+ * cairo returns the same font face for the same FreeType face, so it may
+ * already hold it.
+ */
+static bool hold_shared_face(cairo_font_face_t* font_face,
+                             const std::shared_ptr<SharedFace>& face)
+{
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    static const cairo_user_data_key_t key{};
+    if (cairo_font_face_get_user_data(font_face, &key))
+        return true;
+
+    auto holder = std::make_unique<std::shared_ptr<SharedFace>>(face);
+    if (cairo_font_face_set_user_data(font_face, &key, holder.get(), release_shared_face))
+        return false;
+    holder.release();
+    return true;
 }
 
 static shared_cairo_scaled_font_t create_ft_font(cairo_t* cr,
-        FT_Face& face,
+        const std::shared_ptr<SharedFace>& face,
         const Font& font)
 {
     std::unique_ptr<cairo_font_face_t, decltype(cairo_font_face_destroy)*>
-    font_face(cairo_ft_font_face_create_for_ft_face(face, FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP),
+    font_face(cairo_ft_font_face_create_for_ft_face(face->face, FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP),
               cairo_font_face_destroy);
 
-    static const cairo_user_data_key_t key{};
-    if (cairo_font_face_set_user_data(font_face.get(), &key, face, ft_done_face_uncached))
+    if (!hold_shared_face(font_face.get(), face))
         return nullptr;
 
     std::unique_ptr<cairo_font_options_t, decltype(cairo_font_options_destroy)*>
@@ -108,12 +295,8 @@ static shared_cairo_scaled_font_t create_ft_scaled_font(cairo_t* cr,
 {
     EGTLOG_DEBUG("allocating font using FreeType: {}", font.face());
 
-    if (!init_freetype())
-        return nullptr;
-
-    FT_Face face{};
-    FT_Error status = FT_New_Face(ftlib, path, 0, &face);
-    if (status != 0)
+    auto face = SharedFace::file(path, 0);
+    if (!face)
     {
         detail::error("error opening font {}", path);
         return nullptr;
@@ -128,31 +311,27 @@ static shared_cairo_scaled_font_t create_ft_scaled_font(cairo_t* cr,
 {
     EGTLOG_DEBUG("allocating memory font using FreeType: {}", font.face());
 
-    if (!init_freetype())
-        return nullptr;
-
-    FT_Face face{};
-    FT_Error status = FT_New_Memory_Face(ftlib, static_cast<const FT_Byte*>(data),
-                                         len, 0, &face);
-    if (status)
+    auto face = SharedFace::memory(data, len);
+    if (!face)
         return nullptr;
 
     return create_ft_font(cr, face, font);
 }
 
 #ifdef HAVE_FONTCONFIG
-static shared_cairo_scaled_font_t create_scaled_font(cairo_t* cr, const Font& font)
+using unique_fc_pattern_t = std::unique_ptr<FcPattern, decltype(FcPatternDestroy)*>;
+
+static unique_fc_pattern_t resolve_pattern(cairo_t* cr, const Font& font)
 {
-    EGTLOG_DEBUG("allocating font using Fontconfig: {}", font.face());
+    EGTLOG_DEBUG("resolving font using Fontconfig: {}", font.face());
 
     std::unique_ptr<cairo_font_options_t, decltype(cairo_font_options_destroy)*>
     font_options(cairo_font_options_create(), cairo_font_options_destroy);
     cairo_get_font_options(cr, font_options.get());
 
-    std::unique_ptr<FcPattern, decltype(FcPatternDestroy)*>
-    pattern(FcPatternCreate(), FcPatternDestroy);
+    unique_fc_pattern_t pattern(FcPatternCreate(), FcPatternDestroy);
     if (!pattern)
-        return nullptr;
+        return {nullptr, FcPatternDestroy};
 
     // NOLINTNEXTLINE
     FcPatternAddString(pattern.get(), FC_FAMILY, (const FcChar8*)(font.face().c_str()));
@@ -188,10 +367,9 @@ static shared_cairo_scaled_font_t create_scaled_font(cairo_t* cr, const Font& fo
     FcDefaultSubstitute(pattern.get());
     FcResult result;
 
-    std::unique_ptr<FcPattern, decltype(FcPatternDestroy)*>
-    resolved(FcFontMatch(nullptr, pattern.get(), &result), FcPatternDestroy);
+    unique_fc_pattern_t resolved(FcFontMatch(nullptr, pattern.get(), &result), FcPatternDestroy);
     if (!resolved)
-        return nullptr;
+        return resolved;
 
     char* face = nullptr;
     if (FcPatternGetString(resolved.get(), FC_FULLNAME, 0, reinterpret_cast<FcChar8**>(&face)) == FcResultMatch)
@@ -200,13 +378,91 @@ static shared_cairo_scaled_font_t create_scaled_font(cairo_t* cr, const Font& fo
             EGTLOG_DEBUG("Font \"{}\" not found: using default {} font", font.face(), face);
     }
 
+    return resolved;
+}
+
+/**
+ * Keep only what creating the font face of a resolved pattern needs, as a
+ * string that fontconfig can parse again.
+ */
+static std::string unparse_resolved(FcPattern* resolved)
+{
+    std::unique_ptr<FcObjectSet, decltype(FcObjectSetDestroy)*>
+    objects(FcObjectSetBuild(FC_FILE, FC_INDEX, FC_PIXEL_SIZE, FC_ANTIALIAS,
+                             FC_HINTING, FC_HINT_STYLE, FC_AUTOHINT, FC_RGBA,
+                             FC_LCD_FILTER, FC_EMBOLDEN, FC_FULLNAME,
+                             static_cast<char*>(nullptr)),
+            FcObjectSetDestroy);
+    if (!objects)
+        return {};
+
+    unique_fc_pattern_t filtered(FcPatternFilter(resolved, objects.get()), FcPatternDestroy);
+    if (!filtered)
+        return {};
+
+    std::unique_ptr<FcChar8, decltype(FcStrFree)*>
+    name(FcNameUnparse(filtered.get()), FcStrFree);
+    if (!name)
+        return {};
+
+    return reinterpret_cast<const char*>(name.get());
+}
+
+/**
+ * Parse a resolution saved by unparse_resolved(), unless the font file it
+ * refers to is gone.
+ */
+static unique_fc_pattern_t parse_resolved(const std::string& str)
+{
+    // NOLINTNEXTLINE
+    unique_fc_pattern_t resolved(FcNameParse((const FcChar8*)(str.c_str())), FcPatternDestroy);
+    if (!resolved)
+        return resolved;
+
+    FcChar8* file = nullptr;
+    if (FcPatternGetString(resolved.get(), FC_FILE, 0, &file) != FcResultMatch ||
+        !detail::exists(reinterpret_cast<const char*>(file)))
+        return {nullptr, FcPatternDestroy};
+
+    return resolved;
+}
+
+static shared_cairo_scaled_font_t create_scaled_font(cairo_t* cr, FcPattern* resolved)
+{
+    std::unique_ptr<cairo_font_options_t, decltype(cairo_font_options_destroy)*>
+    font_options(cairo_font_options_create(), cairo_font_options_destroy);
+    cairo_get_font_options(cr, font_options.get());
+
     double pixel_size;
-    FcPatternGetDouble(resolved.get(), FC_PIXEL_SIZE, 0, &pixel_size);
+    if (FcPatternGetDouble(resolved, FC_PIXEL_SIZE, 0, &pixel_size) != FcResultMatch)
+        return nullptr;
+
+    // use the shared face of the file, instead of cairo loading it again
+    unique_fc_pattern_t pattern(nullptr, FcPatternDestroy);
+    std::shared_ptr<SharedFace> face;
+    FcChar8* file = nullptr;
+    int index = 0;
+    if (FcPatternGetString(resolved, FC_FILE, 0, &file) == FcResultMatch)
+    {
+        FcPatternGetInteger(resolved, FC_INDEX, 0, &index);
+        face = SharedFace::file(reinterpret_cast<const char*>(file), index);
+        if (face)
+        {
+            pattern.reset(FcPatternDuplicate(resolved));
+            if (pattern && FcPatternAddFTFace(pattern.get(), FC_FT_FACE, face->face))
+                resolved = pattern.get();
+            else
+                face.reset();
+        }
+    }
 
     std::unique_ptr<cairo_font_face_t, decltype(cairo_font_face_destroy)*>
-    font_face(cairo_ft_font_face_create_for_pattern(resolved.get()),
+    font_face(cairo_ft_font_face_create_for_pattern(resolved),
               cairo_font_face_destroy);
 
+    if (face && !hold_shared_face(font_face.get(), face))
+        return nullptr;
+
     cairo_matrix_t font_matrix;
     cairo_matrix_init_identity(&font_matrix);
 
@@ -312,7 +568,7 @@ void Font::serialize(const std::string& name, Serializer& serializer) const
     serializer.add_property(name, face(), attrs);
 }
 
-void Font::deserialize(const std::string& name, const std::string& value,
+void Font::deserialize(std::string_view name, const std::string& value,
                        const Serializer::Attributes& attrs)
 {
     detail::ignoreparam(name);
@@ -355,18 +611,35 @@ struct FontCache : private detail::NonCopyable<FontCache>
         }
     };
 
-    std::map<Font, shared_cairo_scaled_font_t, FontCompare> cache;
+    explicit FontCache(size_t max_fonts) noexcept
+        : cache(0, max_fonts)
+#ifdef HAVE_FONTCONFIG
+        , resolutions(0, max_fonts)
+#endif
+    {}
+
+    /// Scaled fonts, evicted when there are more than the limit.
+    detail::LruCache<Font, shared_cairo_scaled_font_t, detail::OrderedIndex<Font, FontCompare>> cache;
+
+#ifdef HAVE_FONTCONFIG
+    /// Fontconfig resolutions, as saved by unparse_resolved().
+    detail::LruCache<Font, std::string, detail::OrderedIndex<Font, FontCompare>> resolutions;
+#endif
+
+    /// Fonts may be created by a thread preloading them.
+    std::mutex mutex;
 
     shared_cairo_scaled_font_t scaled_font(const Font& font)
     {
+        std::lock_guard<std::mutex> lock(mutex);
+
         auto i = cache.find(font);
-        if (i != cache.end())
-            return i->second;
+        if (i)
+            return *i;
 
         EGTLOG_TRACE("creating scaled font {}", font);
 
-        Canvas canvas(Size(100, 100));
-        auto cr = canvas.context();
+        auto cr = detail::measure_context();
 
         shared_cairo_scaled_font_t scaled_font;
 
@@ -383,7 +656,25 @@ struct FontCache : private detail::NonCopyable<FontCache>
         case detail::SchemeType::unknown:
 #ifdef HAVE_FONTCONFIG
         {
-            scaled_font = create_scaled_font(cr.get(), font);
+            EGTLOG_DEBUG("allocating font using Fontconfig: {}", font.face());
+
+            // a saved resolution skips matching, as long as its file is there
+            unique_fc_pattern_t resolved(nullptr, FcPatternDestroy);
+            auto r = resolutions.find(font);
+            if (r)
+                resolved = parse_resolved(*r);
+
+            if (!resolved)
+            {
+                resolved = resolve_pattern(cr.get(), font);
+                if (resolved)
+                    resolutions.insert(font, unparse_resolved(resolved.get()));
+                else
+                    resolutions.erase(font);
+            }
+
+            if (resolved)
+                scaled_font = create_scaled_font(cr.get(), resolved.get());
             break;
         }
 #endif
@@ -394,20 +685,62 @@ struct FontCache : private detail::NonCopyable<FontCache>
         }
 
         if (scaled_font)
-            cache.insert(std::make_pair(font, scaled_font));
+            cache.insert(font, scaled_font);
         return scaled_font;
     }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.clear();
+    }
+
+    /// Size of the glyph atlases of the fonts, with the mutex locked.
+    size_t bytes_locked() const
+    {
+        size_t total = 0;
+        for (const auto& entry : cache)
+            total += detail::GlyphAtlas::bytes(entry.value.get());
+        return total;
+    }
+
+    void trim(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto total = bytes_locked();
+        while (total > bytes && !cache.empty())
+        {
+            total -= detail::GlyphAtlas::bytes(std::prev(cache.end())->value.get());
+            cache.evict_last();
+        }
+    }
 };
 
-static FontCache font_cache;
+static size_t default_font_cache_size()
+{
+    auto value = std::getenv("EGT_FONT_CACHE_SIZE");
+    if (value && strlen(value))
+    {
+        try
+        {
+            return std::stoul(value);
+        }
+        catch (const std::exception&)
+        {
+            detail::warn("invalid EGT_FONT_CACHE_SIZE: {}", value);
+        }
+    }
+
+    return Font::DEFAULT_FONT_CACHE_SIZE;
+}
+
+static FontCache font_cache(default_font_cache_size());
 
 cairo_scaled_font_t* Font::scaled_font() const
 {
     if (m_data && m_len && !m_scaled_font)
     {
-        Canvas canvas(egt::Size(100, 100));
-        auto cr = canvas.context().get();
-        m_scaled_font = create_ft_scaled_font(cr, m_data, m_len, *this);
+        m_scaled_font = create_ft_scaled_font(detail::measure_context().get(), m_data, m_len, *this);
     }
 
     if (m_scaled_font)
@@ -425,17 +758,170 @@ std::ostream& operator<<(std::ostream& os, const Font& font)
 
 void Font::reset_font_cache()
 {
-    font_cache.cache.clear();
+    font_cache.clear();
 }
 
 void Font::shutdown_fonts()
 {
     reset_font_cache();
 #ifdef HAVE_FONTCONFIG
+    {
+        std::lock_guard<std::mutex> lock(font_cache.mutex);
+        font_cache.resolutions.clear();
+    }
     FcFini();
 #endif
 }
 
+size_t Font::preload(const std::vector<Font>& fonts)
+{
+    size_t count = 0;
+    for (const auto& font : fonts)
+    {
+        // in-memory fonts belong to their instance
+        if (font.m_data)
+            continue;
+
+        try
+        {
+            if (font_cache.scaled_font(font))
+                ++count;
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("unable to preload font {}: {}", font, e.what());
+        }
+    }
+
+    return count;
+}
+
+/*
+ * A manifest has one font per line, with tab separated fields: face, size,
+ * weight, slant, and optionally the Fontconfig resolution of the font.
+ * Lines starting with # are comments.
+ */
+bool Font::preload(const std::string& manifest)
+{
+    std::ifstream in(manifest);
+    if (!in.is_open())
+        return false;
+
+    std::vector<Font> fonts;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::vector<std::string> fields;
+        detail::tokenize(line, '\t', fields);
+        if (fields.size() < 4)
+        {
+            detail::warn("invalid font manifest line: {}", line);
+            continue;
+        }
+
+        try
+        {
+            fonts.emplace_back(fields[0], std::stof(fields[1]),
+                               detail::enum_from_string<Font::Weight>(fields[2]),
+                               detail::enum_from_string<Font::Slant>(fields[3]));
+        }
+        catch (const std::exception&)
+        {
+            detail::warn("invalid font manifest line: {}", line);
+            continue;
+        }
+
+#ifdef HAVE_FONTCONFIG
+        if (fields.size() > 4)
+        {
+            std::lock_guard<std::mutex> lock(font_cache.mutex);
+            font_cache.resolutions.insert(fonts.back(), fields[4]);
+        }
+#endif
+    }
+
+    preload(fonts);
+
+    return true;
+}
+
+bool Font::save_manifest(const std::string& manifest)
+{
+    std::ofstream out(manifest, std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    out << "# face\tsize\tweight\tslant\tresolution\n";
+
+    std::lock_guard<std::mutex> lock(font_cache.mutex);
+    for (const auto& font : font_cache.cache)
+    {
+        const auto& f = font.key;
+        out << f.face() << '\t' << f.size() << '\t'
+            << detail::enum_to_string(f.weight()) << '\t'
+            << detail::enum_to_string(f.slant());
+#ifdef HAVE_FONTCONFIG
+        auto r = font_cache.resolutions.find(f);
+        if (r && !r->empty())
+            out << '\t' << *r;
+#endif
+        out << '\n';
+    }
+
+    return out.good();
+}
+
+void Font::font_cache_size(size_t fonts)
+{
+    std::lock_guard<std::mutex> lock(font_cache.mutex);
+    font_cache.cache.max_entries(fonts);
+#ifdef HAVE_FONTCONFIG
+    font_cache.resolutions.max_entries(fonts);
+#endif
+}
+
+size_t Font::font_cache_size()
+{
+    std::lock_guard<std::mutex> lock(font_cache.mutex);
+    return font_cache.cache.max_entries();
+}
+
+detail::CacheStats Font::font_cache_stats()
+{
+    std::lock_guard<std::mutex> lock(font_cache.mutex);
+    return font_cache.cache.stats();
+}
+
+size_t Font::font_cache_bytes()
+{
+    std::lock_guard<std::mutex> lock(font_cache.mutex);
+    return font_cache.bytes_locked();
+}
+
+void Font::trim_font_cache(size_t bytes)
+{
+    font_cache.trim(bytes);
+}
+
+static bool& glyph_atlas_enabled()
+{
+    static bool value = !std::getenv("EGT_NO_GLYPH_ATLAS");
+    return value;
+}
+
+void Font::glyph_atlas(bool enable)
+{
+    glyph_atlas_enabled() = enable;
+}
+
+bool Font::glyph_atlas()
+{
+    return glyph_atlas_enabled();
+}
+
 void Font::direct_allocate()
 {
     m_scaled_font.reset();
@@ -17,7 +17,7 @@ namespace experimental
 Form::Form(const std::string& title) noexcept
     : m_vsizer(Orientation::vertical, Justification::start)
 {
-    name("Form" + std::to_string(m_widgetid));
+    default_name("Form", m_widgetid);
 
     m_vsizer.align(AlignFlag::expand);
     add(m_vsizer);
@@ -77,8 +77,8 @@ void Form::add_option(const std::string& name, const std::shared_ptr<Widget>& wi
     label->text_align(m_name_align);
     auto grid = std::make_shared<StaticGrid>(StaticGrid::GridSize(2, 1));
     auto b = widget->size();
-    if (b.height() < widget->min_size_hint().height())
-        b.height(widget->min_size_hint().height());
+    if (b.height() < widget->cached_min_size_hint().height())
+        b.height(widget->cached_min_size_hint().height());
     if (b.height() < min_option_height())
         b.height(min_option_height());
     grid->resize(Size(0, b.height()));
@@ -99,8 +99,8 @@ void Form::add_option(const std::shared_ptr<Widget>& widget)
     widget->align(AlignFlag::expand);
     auto grid = std::make_shared<StaticGrid>(StaticGrid::GridSize(1, 1));
     auto b = widget->size();
-    if (b.height() < widget->min_size_hint().height())
-        b.height(widget->min_size_hint().height());
+    if (b.height() < widget->cached_min_size_hint().height())
+        b.height(widget->cached_min_size_hint().height());
     if (b.height() < min_option_height())
         b.height(min_option_height());
     grid->resize(Size(0, b.height()));
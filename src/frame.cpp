@@ -5,15 +5,20 @@
  */
 #include "detail/egtlog.h"
 #include "detail/dump.h"
+#include "detail/focuschain.h"
+#include "detail/hitgrid.h"
+#include "detail/snapshot.h"
 #include "egt/app.h"
 #include "egt/detail/layout.h"
 #include "egt/detail/math.h"
 #include "egt/frame.h"
+#include "egt/image.h"
 #include "egt/input.h"
 #include "egt/painter.h"
 #include "egt/screen.h"
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 namespace egt
 {
@@ -23,7 +28,7 @@ inline namespace v1
 Frame::Frame(const Rect& rect, const Widget::Flags& flags) noexcept
     : Widget(rect, flags | Widget::Flag::frame)
 {
-    name("Frame" + std::to_string(m_widgetid));
+    default_name("Frame", m_widgetid);
     m_damage.reserve(10);
 }
 
@@ -50,10 +55,18 @@ void Frame::add(const std::shared_ptr<Widget>& widget)
         return;
 
     widget->set_parent(this);
-    m_subordinates.emplace(m_components_begin, widget);
+    m_subordinates.emplace(m_subordinates.begin() +
+                           static_cast<SubordinatesArray::difference_type>(m_children_count),
+                           widget);
+    ++m_children_count;
     update_subordinates_ranges();
+    detail::FocusChain::attach(*widget);
 
-    layout();
+    // a subtree marked while it had no parent is flushed through this one
+    if (widget->layout_pending())
+        widget->parent_layout_pending();
+
+    request_layout();
 }
 
 bool Frame::is_child(Widget* widget) const
@@ -84,11 +97,12 @@ void Frame::remove(Widget* widget)
     {
         // note order here - damage and then unset parent
         (*i)->damage();
+        detail::FocusChain::detach(**i);
         (*i)->m_parent = nullptr;
         m_subordinates.erase(i);
-        if (i == children().begin())
-            children().begin(m_subordinates.begin());
-        layout();
+        --m_children_count;
+        update_subordinates_ranges();
+        request_layout();
     }
     else if (widget->m_parent == this)
     {
@@ -102,18 +116,19 @@ void Frame::remove_all_basic()
     {
         // note order here - damage and then unset parent
         i->damage();
+        detail::FocusChain::detach(*i);
         i->m_parent = nullptr;
     }
 
     m_subordinates.erase(children().begin(), children().end());
-    m_components_begin = m_subordinates.begin();
+    m_children_count = 0;
     update_subordinates_ranges();
 }
 
 void Frame::remove_all()
 {
     remove_all_basic();
-    layout();
+    request_layout();
 }
 
 Widget* Frame::hit_test(const DisplayPoint& point)
@@ -141,6 +156,51 @@ Widget* Frame::hit_test(const DisplayPoint& point)
     return nullptr;
 }
 
+void Frame::spatial_index(bool enable)
+{
+    if (enable && !m_hit_grid)
+        m_hit_grid = std::make_unique<detail::HitGrid>();
+    else if (!enable)
+        m_hit_grid.reset();
+}
+
+Widget* Frame::subordinate_at(const Point& point)
+{
+    if (!m_hit_grid)
+        return Widget::subordinate_at(point);
+
+    if (m_hit_grid->dirty ||
+        m_hit_grid->generation != subordinates_generation())
+    {
+        std::vector<Rect> boxes;
+        boxes.reserve(m_subordinates.size());
+        for (auto& subordinate : m_subordinates)
+        {
+            boxes.emplace_back(subordinate->box().point() +
+                               point_from_subordinate(*subordinate) - this->point(),
+                               subordinate->size());
+        }
+
+        m_hit_grid->build(boxes);
+        m_hit_grid->generation = subordinates_generation();
+    }
+
+    const auto p = point + this->point();
+    const auto candidates = m_hit_grid->query(point);
+    for (auto i = candidates.second; i != candidates.first;)
+    {
+        auto& subordinate = m_subordinates[*--i];
+        if (!subordinate->can_handle_event())
+            continue;
+
+        const auto p2 = p - point_from_subordinate(*subordinate);
+        if (subordinate->box().intersect(p2))
+            return subordinate.get();
+    }
+
+    return nullptr;
+}
+
 void Frame::walk(const WalkCallback& callback, int level)
 {
     if (!callback(this, level))
@@ -152,18 +212,17 @@ void Frame::walk(const WalkCallback& callback, int level)
 
 void Frame::paint_to_file(const std::string& filename)
 {
-#if CAIRO_HAS_PNG_FUNCTIONS == 1
     /// @todo should this be redirected to parent()?
     std::string name = filename;
     if (name.empty())
         name = fmt::format("{}.png", this->name());
 
-    auto surface = cairo_get_target(screen()->context().get());
-    cairo_surface_write_to_png(surface, name.c_str());
-#else
-    detail::ignoreparam(filename);
-    detail::error("png support not available");
-#endif
+    auto surface = shared_cairo_surface_t(
+                       cairo_surface_reference(cairo_get_target(screen()->context().get())),
+                       cairo_surface_destroy);
+    cairo_surface_flush(surface.get());
+    if (!detail::write_png(name, surface, Application::SnapshotOptions().level))
+        detail::warn("unable to write {}", name);
 }
 
 void Frame::paint_children_to_file()
@@ -202,6 +261,9 @@ void Frame::deserialize_children(const Deserializer& deserializer)
         add(node->parse_widget());
 }
 
+Frame::Frame(Frame&&) noexcept = default;
+Frame& Frame::operator=(Frame&&) noexcept = default;
+
 Frame::~Frame() noexcept
 {
     remove_all_basic();
@@ -3,13 +3,65 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "egt/canvas.h"
+#include "egt/detail/imagecache.h"
 #include "egt/detail/math.h"
 #include "egt/gauge.h"
+#include <cmath>
+#ifdef HAVE_LIBRSVG
+#include "egt/svgimage.h"
+#endif
 
 namespace egt
 {
 inline namespace v1
 {
+
+namespace detail
+{
+/**
+ * Frames of a needle rotated to evenly spread angles, in a grid of cells.
+ *
+ * In each cell, the rotate point of the needle is at (half, half) plus the
+ * fractional part of the needle point, so frames are copied on whole pixels.
+ */
+struct NeedleFrames
+{
+    /// What the frames depend on.
+    struct Key
+    {
+        cairo_surface_t* image{nullptr};
+        PointF center;
+        PointF fraction;
+        float min{0};
+        float max{0};
+        float angle_start{0};
+        float angle_stop{0};
+        bool clockwise{true};
+        size_t steps{0};
+
+        bool operator==(const Key& rhs) const
+        {
+            return image == rhs.image && center == rhs.center &&
+                   fraction == rhs.fraction && float_equal(min, rhs.min) &&
+                   float_equal(max, rhs.max) &&
+                   float_equal(angle_start, rhs.angle_start) &&
+                   float_equal(angle_stop, rhs.angle_stop) &&
+                   clockwise == rhs.clockwise && steps == rhs.steps;
+        }
+    };
+
+    Key key;
+    shared_cairo_surface_t atlas;
+    DefaultDim half{0};
+    DefaultDim columns{1};
+};
+}
+
 namespace experimental
 {
 
@@ -17,7 +69,7 @@ namespace experimental
 GaugeLayer::GaugeLayer(const Image& image) noexcept
     : m_image(image)
 {
-    name("GaugeLayer" + std::to_string(m_widgetid));
+    default_name("GaugeLayer", m_widgetid);
 
     if (!m_image.empty())
         m_box.size(m_image.size());
@@ -29,6 +81,41 @@ GaugeLayer::GaugeLayer(Gauge& gauge, const Image& image) noexcept
     gauge.add(*this);
 }
 
+void GaugeLayer::image(const Image& image)
+{
+    detail::image_cache().cancel(m_render);
+    m_render = 0;
+
+    m_image = image;
+    resize(m_image.size());
+    damage();
+}
+
+#ifdef HAVE_LIBRSVG
+void GaugeLayer::image(const SvgImage& svg, const std::string& id, const RectF& rect)
+{
+    // until rendered, a transparent image of the same size keeps the layout
+    image(Image(Canvas(rect.empty() ? svg.size() : rect.size()).surface()));
+
+    m_render = svg.render_async(id, rect, [this](const Image& image)
+    {
+        m_render = 0;
+
+        // keep the size of the layer, set since like by NeedleLayer::needle_point()
+        if (!image.empty())
+        {
+            m_image = image;
+            damage();
+        }
+    });
+}
+#endif
+
+GaugeLayer::~GaugeLayer() noexcept
+{
+    detail::image_cache().cancel(m_render);
+}
+
 void GaugeLayer::draw(Painter& painter, const Rect&)
 {
     if (m_mask_color == Color(0x00000000))
@@ -58,7 +145,7 @@ NeedleLayer::NeedleLayer(const Image& image,
       m_angle_stop(angle_stop),
       m_clockwise(clockwise)
 {
-    name("NeedleLayer" + std::to_string(m_widgetid));
+    default_name("NeedleLayer", m_widgetid);
     assert(m_max > m_min);
 }
 
@@ -89,8 +176,139 @@ static void draw_image(Painter& painter,
     painter.paint();
 }
 
+/// Half the size of a cell holding the needle rotated to any angle.
+static DefaultDim frame_half(const Image& image, const PointF& center)
+{
+    float radius = 0;
+    for (const auto& corner : {PointF(0, 0), PointF(image.width(), 0),
+                               PointF(image.width(), image.height()),
+                               PointF(0, image.height())
+                              })
+        radius = std::max(radius, center.distance_to(corner));
+    return static_cast<DefaultDim>(std::ceil(radius)) + 1;
+}
+
+void NeedleLayer::prerotate(size_t steps, size_t max_bytes)
+{
+    m_steps = steps;
+    m_max_bytes = max_bytes;
+
+    if (!m_steps)
+        m_frames.reset();
+    else
+        frames();
+
+    damage();
+}
+
+size_t NeedleLayer::frame_steps() const
+{
+    if (!m_steps || m_image.empty())
+        return 0;
+
+    // values are integers, so there is no use for more frames
+    auto steps = std::min(m_steps, static_cast<size_t>(std::round(m_max - m_min)) + 1);
+
+    const auto cell = 2 * static_cast<size_t>(frame_half(m_image, m_center));
+    return std::min<size_t>(steps, m_max_bytes / (cell * cell * 4));
+}
+
+float NeedleLayer::drawn_value() const
+{
+    const auto steps = frame_steps();
+    if (steps < 2)
+        return steps ? m_min : m_value;
+
+    const auto step = (m_max - m_min) / (steps - 1);
+    return m_min + std::round((m_value - m_min) / step) * step;
+}
+
+const detail::NeedleFrames* NeedleLayer::frames()
+{
+    const auto steps = frame_steps();
+    if (!steps)
+    {
+        m_frames.reset();
+        return nullptr;
+    }
+
+    detail::NeedleFrames::Key key;
+    key.image = m_image.surface().get();
+    key.center = m_center;
+    key.fraction = PointF(m_point.x() - std::floor(m_point.x()),
+                          m_point.y() - std::floor(m_point.y()));
+    key.min = m_min;
+    key.max = m_max;
+    key.angle_start = m_angle_start;
+    key.angle_stop = m_angle_stop;
+    key.clockwise = m_clockwise;
+    key.steps = steps;
+
+    if (m_frames && m_frames->key == key)
+        return m_frames.get();
+
+    auto frames = std::make_shared<detail::NeedleFrames>();
+    frames->key = key;
+    frames->half = frame_half(m_image, m_center);
+    frames->columns = static_cast<DefaultDim>(std::ceil(std::sqrt(steps)));
+
+    const auto cell = 2 * frames->half;
+    const auto rows = (static_cast<DefaultDim>(steps) + frames->columns - 1) / frames->columns;
+    frames->atlas = shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                           frames->columns * cell, rows * cell),
+                                           cairo_surface_destroy);
+    if (cairo_surface_status(frames->atlas.get()) != CAIRO_STATUS_SUCCESS)
+    {
+        m_frames.reset();
+        return nullptr;
+    }
+
+    auto cr = shared_cairo_t(cairo_create(frames->atlas.get()), cairo_destroy);
+    Painter painter(cr);
+
+    const auto step = steps > 1 ? (m_max - m_min) / (steps - 1) : 0.f;
+    for (size_t i = 0; i < steps; ++i)
+    {
+        const auto x = static_cast<DefaultDim>(i % frames->columns) * cell;
+        const auto y = static_cast<DefaultDim>(i / frames->columns) * cell;
+        const auto angle = detail::normalize_to_angle(m_min + i * step, m_min, m_max,
+                           m_angle_start, m_angle_stop,
+                           m_clockwise);
+
+        Painter::AutoSaveRestore sr(painter);
+        cairo_rectangle(cr.get(), x, y, cell, cell);
+        cairo_clip(cr.get());
+        draw_image(painter, PointF(x + frames->half + key.fraction.x(),
+                                   y + frames->half + key.fraction.y()),
+                   m_center, m_image, detail::to_radians<float>(0, angle));
+    }
+    cairo_surface_flush(frames->atlas.get());
+
+    m_frames = std::move(frames);
+    return m_frames.get();
+}
+
 void NeedleLayer::draw(Painter& painter, const Rect&)
 {
+    if (const auto f = frames())
+    {
+        const auto steps = f->key.steps;
+        const auto i = steps > 1 ?
+                       static_cast<size_t>(std::round((m_value - m_min) / (m_max - m_min) * (steps - 1))) : 0;
+        const auto cell = 2 * f->half;
+        const auto src = Point(static_cast<DefaultDim>(i % f->columns) * cell,
+                               static_cast<DefaultDim>(i / f->columns) * cell);
+        const auto dst = Point(static_cast<DefaultDim>(std::floor(m_point.x())) - f->half,
+                               static_cast<DefaultDim>(std::floor(m_point.y())) - f->half);
+
+        Painter::AutoSaveRestore sr(painter);
+        auto cr = painter.context().get();
+        cairo_set_source_surface(cr, f->atlas.get(), dst.x() - src.x(), dst.y() - src.y());
+        cairo_rectangle(cr, dst.x(), dst.y(), cell, cell);
+        cairo_fill(cr);
+        return;
+    }
+
     auto angle = detail::normalize_to_angle(m_value, m_min, m_max,
                                             m_angle_start, m_angle_stop,
                                             m_clockwise);
@@ -108,49 +326,54 @@ void NeedleLayer::gauge(Gauge* gauge)
     }
 }
 
-static Point point_calc(const Point& center, const Point& corner, float angle)
+static PointF point_calc(const PointF& center, const PointF& corner, float angle)
 {
     const auto dx1 = corner.x() - center.x();
     const auto dy1 = corner.y() - center.y();
-    return {static_cast<Size::DimType>((center.x() + dx1 * std::cos(angle)) - (dy1 * std::sin(angle))),
-            static_cast<Size::DimType>((center.y() + dx1 * std::sin(angle)) + (dy1 * std::cos(angle)))};
+    return {(center.x() + dx1 * std::cos(angle)) - (dy1 * std::sin(angle)),
+            (center.y() + dx1 * std::sin(angle)) + (dy1 * std::cos(angle))};
 }
 
 /**
  * Take a rectangle, rotate it around point by angle, and return the resulting
  * super rectangle that encompases the rotated rectangle.
+ *
+ * This is the only area that changes when the needle moves, so it is kept
+ * tight: the bounds are computed without rounding, and only grown by the
+ * pixel that antialiasing may touch.
  */
 Rect NeedleLayer::rectangle_of_rotated()
 {
-    const auto rect = Rect(Point(0, 0), m_image.size());
-    const auto angle = detail::to_radians(0.0f, detail::normalize_to_angle(m_value, m_min, m_max,
+    const auto rect = RectF(PointF(0, 0), SizeF(m_image.width(), m_image.height()));
+    const auto angle = detail::to_radians(0.0f, detail::normalize_to_angle(drawn_value(), m_min, m_max,
                                           m_angle_start, m_angle_stop,
                                           m_clockwise));
-    const auto center_point = Point(m_center.x(), m_center.y());
-
-    const auto p1 = point_calc(center_point, rect.top_left(), angle);
-    const auto p2 = point_calc(center_point, rect.top_right(), angle);
-    const auto p3 = point_calc(center_point, rect.bottom_right(), angle);
-    const auto p4 = point_calc(center_point, rect.bottom_left(), angle);
-
-    const auto xmin = std::roundf(std::min(std::min(p1.x(), p2.x()), std::min(p3.x(), p4.x())));
-    const auto ymin = std::roundf(std::min(std::min(p1.y(), p2.y()), std::min(p3.y(), p4.y())));
-
-    const auto xmax = std::roundf(std::max(std::max(p1.x(), p2.x()), std::max(p3.x(), p4.x())));
-    const auto ymax = std::roundf(std::max(std::max(p1.y(), p2.y()), std::max(p3.y(), p4.y())));
-
-    const auto res = Rect(xmin + m_point.x() - m_center.x(),
-                          ymin + m_point.y() - m_center.y(),
-                          xmax - xmin + 1,
-                          ymax - ymin + 1);
 
-    return res;
+    const auto p1 = point_calc(m_center, rect.top_left(), angle);
+    const auto p2 = point_calc(m_center, rect.top_right(), angle);
+    const auto p3 = point_calc(m_center, rect.bottom_right(), angle);
+    const auto p4 = point_calc(m_center, rect.bottom_left(), angle);
+
+    const auto xmin = std::floor(std::min(std::min(p1.x(), p2.x()), std::min(p3.x(), p4.x())) +
+                                 m_point.x() - m_center.x()) - 1;
+    const auto ymin = std::floor(std::min(std::min(p1.y(), p2.y()), std::min(p3.y(), p4.y())) +
+                                 m_point.y() - m_center.y()) - 1;
+
+    const auto xmax = std::ceil(std::max(std::max(p1.x(), p2.x()), std::max(p3.x(), p4.x())) +
+                                m_point.x() - m_center.x()) + 1;
+    const auto ymax = std::ceil(std::max(std::max(p1.y(), p2.y()), std::max(p3.y(), p4.y())) +
+                                m_point.y() - m_center.y()) + 1;
+
+    return {static_cast<DefaultDim>(xmin),
+            static_cast<DefaultDim>(ymin),
+            static_cast<DefaultDim>(xmax - xmin),
+            static_cast<DefaultDim>(ymax - ymin)};
 }
 
 Gauge::Gauge(const Rect& rect, const Widget::Flags& flags) noexcept
     : Frame(rect, flags)
 {
-    name("Gauge" + std::to_string(m_widgetid));
+    default_name("Gauge", m_widgetid);
 }
 
 Gauge::Gauge(Frame& parent, const Rect& rect, const Widget::Flags& flags) noexcept
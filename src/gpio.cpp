@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/priorityqueue.h"
+#include "egt/app.h"
+#include "egt/gpio.h"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace egt
+{
+inline namespace v1
+{
+
+GpioMonitor::GpioMonitor(const std::string& chip, uint32_t line, Callback callback,
+                         Edge edge, std::chrono::microseconds debounce)
+    : m_line(line),
+      m_callback(std::move(callback)),
+      m_edge(edge),
+      m_debounce(debounce)
+{
+    auto fd = open(chip.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("unable to open " + chip + ": " + strerror(errno));
+
+    // both edges are always requested, to know the level when settled
+    gpioevent_request request{};
+    request.lineoffset = line;
+    request.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    request.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+    strncpy(request.consumer_label, "egt", sizeof(request.consumer_label) - 1);
+    const auto ret = ioctl(fd, GPIO_GET_LINEEVENT_IOCTL, &request);
+    const auto error = errno;
+    close(fd);
+    if (ret < 0)
+    {
+        throw std::runtime_error(fmt::format("unable to request line {} of {}: {}",
+                                             line, chip, strerror(error)));
+    }
+
+    m_monitor = std::make_unique<FdMonitor>(request.fd, [this]() { read(); },
+                FdMonitor::Priority::input, true);
+    m_value = read_value();
+
+    if (m_debounce.count())
+        m_timer = std::make_unique<asio::steady_timer>(Application::instance().event().io());
+}
+
+bool GpioMonitor::read_value() const
+{
+    gpiohandle_data data{};
+    if (ioctl(m_monitor->fd(), GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0)
+    {
+        detail::warn("unable to read line {}: {}", m_line, strerror(errno));
+        return m_value;
+    }
+
+    return data.values[0];
+}
+
+void GpioMonitor::read()
+{
+    // the kernel queues edges, all the ones pending are read at once
+    std::array<gpioevent_data, 16> events;
+    while (true)
+    {
+        const auto ret = ::read(m_monitor->fd(), events.data(), sizeof(events));
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN)
+                detail::warn("unable to read line {} events: {}", m_line, strerror(errno));
+            return;
+        }
+
+        const auto count = static_cast<size_t>(ret) / sizeof(gpioevent_data);
+        if (!count)
+            return;
+
+        if (m_timer)
+        {
+            // settled once there is no edge for the debounce time
+            m_edge_time = std::chrono::nanoseconds(events[count - 1].timestamp);
+            m_timer->expires_after(m_debounce);
+            m_timer->async_wait(Application::instance().event().queue().wrap(detail::priorities::input,
+                                [this](const asio::error_code & error)
+            {
+                // aborted when waiting again, or when destroyed
+                if (error)
+                    return;
+                settle();
+            }, this));
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                report(events[i].id == GPIOEVENT_EVENT_RISING_EDGE,
+                       std::chrono::nanoseconds(events[i].timestamp));
+            }
+        }
+
+        if (count < events.size())
+            return;
+    }
+}
+
+void GpioMonitor::settle()
+{
+    report(read_value(), m_edge_time);
+}
+
+void GpioMonitor::report(bool value, std::chrono::nanoseconds timestamp)
+{
+    if (value == m_value)
+        return;
+
+    m_value = value;
+    if ((m_edge == Edge::rising && !value) ||
+        (m_edge == Edge::falling && value))
+        return;
+
+    if (m_callback)
+        m_callback({m_line, value, timestamp});
+}
+
+GpioMonitor::~GpioMonitor() noexcept
+{
+    if (Application::check_instance())
+        Application::instance().event().queue().cancel(this);
+
+    m_timer.reset();
+    m_monitor.reset();
+}
+
+}
+}
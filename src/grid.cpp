@@ -4,9 +4,11 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "egt/detail/alignment.h"
+#include "egt/detail/drawdiagnostics.h"
 #include "egt/detail/enum.h"
 #include "egt/grid.h"
 #include "egt/painter.h"
+#include "egt/profiler.h"
 #include "egt/serialize.h"
 #include <algorithm>
 #include <cassert>
@@ -19,7 +21,7 @@ inline namespace v1
 StaticGrid::StaticGrid(const Rect& rect, const GridSize& size)
     : Frame(rect)
 {
-    name("StaticGrid" + std::to_string(m_widgetid));
+    default_name("StaticGrid", m_widgetid);
 
     reallocate(size);
 }
@@ -41,6 +43,7 @@ void StaticGrid::reallocate(const GridSize& size)
         throw std::invalid_argument("a static grid needs at least one cell i.e. one row and one col");
 
     m_grid_size = size;
+    m_fill_hint = 0;
 
     /// If columns or rows are removed, remove widgets in these cells
     auto current_columns = m_cells.size();
@@ -100,46 +103,103 @@ StaticGrid::StaticGrid(Frame& parent, const GridSize& size)
     parent.add(*this);
 }
 
-namespace detail
-{
-static constexpr DefaultDim round(DefaultDim x, DefaultDim y)
-{
-    return x  / y;
-}
-}
-
 /*
- * Calculates the rectangle for a cell taking into account grid spaces.
+ * Geometry of the cells of a grid.
+ *
+ * All cells have the same size, except the ones of the last column and row
+ * which counterbalance rounding errors, so the rectangle of a cell and the
+ * cell at a point are computed arithmetically, without looking at the other
+ * cells.
  */
-static constexpr Rect cell_rect(int columns, int rows,
-                                DefaultDim width, DefaultDim height,
-                                int column, int row,
-                                DefaultDim h_space, DefaultDim v_space)
+struct CellGeometry
 {
-    auto cell_width = detail::round(width - (columns - 1) * v_space, columns);
-    auto cell_height = detail::round(height - (rows - 1) * h_space, rows);
-    auto cell_x = column * (cell_width + v_space);
-    auto cell_y = row * (cell_height + h_space);
+    CellGeometry(size_t columns, size_t rows, const Size& size,
+                 DefaultDim h_space, DefaultDim v_space)
+        : columns(columns),
+          rows(rows),
+          size(size),
+          h_space(h_space),
+          v_space(v_space)
+    {
+        if (columns)
+            cell.width((size.width() - static_cast<DefaultDim>(columns - 1) * v_space) /
+                       static_cast<DefaultDim>(columns));
+        if (rows)
+            cell.height((size.height() - static_cast<DefaultDim>(rows - 1) * h_space) /
+                        static_cast<DefaultDim>(rows));
+    }
 
     /*
-     * If there are errors due to rounding, use the latest column and row to
-     * counterbalance them.
+     * Calculates the rectangle for a cell taking into account grid spaces,
+     * relative to the content area.
      */
-    if (column == (columns - 1))
+    EGT_NODISCARD Rect rect(size_t column, size_t row) const
     {
-        auto error = width - cell_x - cell_width;
-        if (error)
-            cell_width += error;
+        Rect result(static_cast<DefaultDim>(column) * (cell.width() + v_space),
+                    static_cast<DefaultDim>(row) * (cell.height() + h_space),
+                    cell.width(), cell.height());
+
+        /*
+         * If there are errors due to rounding, use the latest column and row
+         * to counterbalance them.
+         */
+        if (column == columns - 1)
+            result.width(size.width() - result.x());
+        if (row == rows - 1)
+            result.height(size.height() - result.y());
+
+        return result;
     }
 
-    if (row == (rows - 1))
+    /*
+     * Find the cell at a point relative to the content area, edges included.
+     * Returns false if the point is outside of the cells.
+     */
+    bool at(const Point& point, size_t& column, size_t& row) const
     {
-        auto error = height - cell_y - cell_height;
-        if (error)
-            cell_height += error;
+        if (!columns || !rows || point.x() < 0 || point.y() < 0)
+            return false;
+
+        const auto pitch_x = std::max<DefaultDim>(cell.width() + v_space, 1);
+        const auto pitch_y = std::max<DefaultDim>(cell.height() + h_space, 1);
+        column = std::min<size_t>(point.x() / pitch_x, columns - 1);
+        row = std::min<size_t>(point.y() / pitch_y, rows - 1);
+        return rect(column, row).intersect(point);
     }
 
-    return {cell_x, cell_y, cell_width, cell_height};
+    size_t columns;
+    size_t rows;
+    Size size;
+    DefaultDim h_space;
+    DefaultDim v_space;
+    Size cell;
+};
+
+Rect StaticGrid::cell_rect(size_t column, size_t row) const
+{
+    const auto rows = m_cells.empty() ? 0 : m_cells[0].size();
+    const CellGeometry geometry(m_cells.size(), rows, content_area().size(),
+                                horizontal_space(), vertical_space());
+    return geometry.rect(column, row);
+}
+
+bool StaticGrid::cell_at(const Point& point, GridPoint& cell) const
+{
+    const auto rows = m_cells.empty() ? 0 : m_cells[0].size();
+    const CellGeometry geometry(m_cells.size(), rows, content_area().size(),
+                                horizontal_space(), vertical_space());
+    size_t column = 0;
+    size_t row = 0;
+    if (!geometry.at(point, column, row))
+        return false;
+    cell = GridPoint(column, row);
+    return true;
+}
+
+size_t StaticGrid::fill_index(size_t column, size_t row) const
+{
+    return m_column_priority ? column * m_cells[0].size() + row :
+           row * m_cells.size() + column;
 }
 
 void StaticGrid::add(const std::shared_ptr<Widget>& widget)
@@ -155,56 +215,36 @@ void StaticGrid::add(const std::shared_ptr<Widget>& widget)
     if (widget->align().empty())
         widget->align(egt::AlignFlag::center);
 
-    if (m_column_priority)
+    // cells before the hint are known to be used, so filling a grid one
+    // widget at a time does not look at the same cells again and again
+    const auto columns = m_cells.size();
+    const auto rows = m_cells[0].size();
+    const auto count = columns * rows;
+    if (m_fill_priority != m_column_priority)
     {
-        int c = 0;
-        for (auto& column : m_cells)
-        {
-            auto i = std::find_if(column.begin(), column.end(),
-                                  [](const auto & w)
-            {
-                return w.expired();
-            });
-
-            if (i != column.end())
-            {
-                *i = widget;
-
-                Frame::add(widget);
-
-                m_last_add_column = c;
-                m_last_add_row = std::distance(column.begin(), i);
-
-                break;
-            }
-
-            c++;
-        }
+        m_fill_priority = m_column_priority;
+        m_fill_hint = 0;
     }
-    else
-    {
-        for (size_t r = 0; r < m_cells[0].size(); r++)
-        {
-            int c = 0;
-            for (auto& column : m_cells)
-            {
-                auto w = column[r].lock();
-                if (!w)
-                {
-                    column[r] = widget;
 
-                    Frame::add(widget);
+    for (auto index = m_fill_hint; index < count; ++index)
+    {
+        const auto column = m_column_priority ? index / rows : index % columns;
+        const auto row = m_column_priority ? index % rows : index / columns;
+        auto& cell = m_cells[column][row];
+        if (!cell.expired())
+            continue;
 
-                    m_last_add_column = c;
-                    m_last_add_row = r;
+        cell = widget;
+        m_fill_hint = index + 1;
 
-                    return;
-                }
+        Frame::add(widget);
 
-                c++;
-            }
-        }
+        m_last_add_column = column;
+        m_last_add_row = row;
+        return;
     }
+
+    m_fill_hint = count;
 }
 
 void StaticGrid::add(const std::shared_ptr<Widget>& widget, size_t column, size_t row)
@@ -213,12 +253,16 @@ void StaticGrid::add(const std::shared_ptr<Widget>& widget, size_t column, size_
         widget->align(egt::AlignFlag::center);
 
     if (column >= m_cells.size())
-        m_cells.resize(column + 1);
+    {
+        m_cells.resize(column + 1, CellArray::value_type(m_cells[0].size()));
+        m_fill_hint = 0;
+    }
 
     if (row >= m_cells[column].size())
     {
         for (auto& c : m_cells)
             c.resize(row + 1, {});
+        m_fill_hint = 0;
     }
 
     m_cells[column][row] = widget;
@@ -254,12 +298,15 @@ void StaticGrid::remove(Widget* widget)
         return false;
     };
 
-    for (auto& x : m_cells)
+    for (size_t column = 0; column < m_cells.size(); ++column)
     {
+        auto& x = m_cells[column];
         for (auto i = std::find_if(x.begin(), x.end(), predicate); i != x.end();
              i = std::find_if(x.begin(), x.end(), predicate))
         {
             i->reset();
+            const auto row = static_cast<size_t>(std::distance(x.begin(), i));
+            m_fill_hint = std::min(m_fill_hint, fill_index(column, row));
         }
     }
 
@@ -273,18 +320,21 @@ void StaticGrid::reposition()
     if (b.empty())
         return;
 
-    auto columns = m_cells.size();
+    const auto columns = m_cells.size();
+    const auto rows = m_cells[0].size();
+    const CellGeometry geometry(columns, rows, b.size(),
+                                horizontal_space(), vertical_space());
+    const auto origin = b.point() - point();
+
     for (size_t column = 0; column < columns; column++)
     {
-        auto rows = m_cells[column].size();
         for (size_t row = 0; row < rows; row++)
         {
             auto widget = m_cells[column][row].lock();
             if (widget)
             {
-                auto bounding = cell_rect(columns, rows, b.width(), b.height(), column, row,
-                                          horizontal_space(), vertical_space());
-                bounding += b.point() - point();
+                auto bounding = geometry.rect(column, row);
+                bounding += origin;
 
                 if (bounding.size().empty())
                     continue;
@@ -301,6 +351,11 @@ void StaticGrid::reposition()
                                     bounding,
                                     widget->align());
 
+                // cells that did not move are left alone, so a grid of
+                // thousands of cells only pays for the ones that changed
+                if (target == widget->box())
+                    continue;
+
                 // re-position/resize widget
                 widget->box(target);
 
@@ -316,6 +371,8 @@ void StaticGrid::reposition()
 
 void StaticGrid::layout()
 {
+    Profiler::Scope scope(Profiler::Phase::layout);
+
     if (!visible())
         return;
 
@@ -332,6 +389,10 @@ void StaticGrid::layout()
     m_in_layout = true;
     auto reset = detail::on_scope_exit([this]() { m_in_layout = false; });
 
+    auto& diagnostics = detail::DrawDiagnostics::instance();
+    if (egt_unlikely(diagnostics.enabled()))
+        diagnostics.laid_out(*this);
+
     reposition();
 }
 
@@ -417,7 +478,7 @@ void StaticGrid::deserialize(Serializer::Properties& props)
 SelectableGrid::SelectableGrid(const Rect& rect, const GridSize& size)
     : StaticGrid(rect, size)
 {
-    name("SelectableGrid" + std::to_string(widgetid()));
+    default_name("SelectableGrid", widgetid());
 }
 
 SelectableGrid::SelectableGrid(const GridSize& size)
@@ -452,31 +513,12 @@ void SelectableGrid::handle(Event& event)
 
     if (event.id() == EventId::raw_pointer_down)
     {
-        auto b = content_area().size();
-        Point pos = display_to_local(event.pointer().point);
-
-        auto columns = m_cells.size();
-        for (size_t column = 0; column < columns; column++)
-        {
-            auto rows = m_cells[column].size();
-            for (size_t row = 0; row < rows; row++)
-            {
-                // Include the padding region
-                auto bounding = cell_rect(columns, rows, b.width(), b.height(), column, row,
-                                          horizontal_space(), vertical_space());
-                bounding += content_area().point();
-
-                assert(!bounding.size().empty());
-                if (bounding.size().empty())
-                    continue;
-
-                if (bounding.intersect(pos))
-                {
-                    selected(column, row);
-                    break;
-                }
-            }
-        }
+        // Include the padding region
+        const auto pos = display_to_local(event.pointer().point) -
+                         (content_area().point() - point());
+        GridPoint cell;
+        if (cell_at(pos, cell))
+            selected(cell.x(), cell.y());
     }
 }
 
@@ -490,15 +532,8 @@ void SelectableGrid::draw(Painter& painter, const Rect& rect)
         painter.set(color(Palette::ColorId::border));
         painter.line_width(selection_highlight());
 
-        size_t column = m_selected_column;
-        size_t row = m_selected_row;
-        auto columns = m_cells.size();
-        auto rows = m_cells[column].size();
-
         auto b = content_area();
-
-        auto cell = cell_rect(columns, rows, b.width(), b.height(), column, row,
-                              horizontal_space(), vertical_space());
+        auto cell = cell_rect(m_selected_column, m_selected_row);
 
         auto hx = b.x() + cell.x() + selection_highlight() / 2;
         auto hy = b.y() + cell.y() + selection_highlight() / 2;
@@ -519,15 +554,26 @@ void SelectableGrid::selected(size_t column, size_t row)
     if (!columns || row >= m_cells[column].size())
         return;
 
+    const auto previous = selected_box();
     auto c = detail::change_if_diff<>(m_selected_column, column);
     auto r = detail::change_if_diff<>(m_selected_row, row);
     if (c || r)
     {
-        damage();
+        // only the highlight moves, from the old cell to the new one
+        damage(previous);
+        damage(selected_box());
         on_selected_changed.invoke();
     }
 }
 
+Rect SelectableGrid::selected_box() const
+{
+    if (selection_highlight() <= 0)
+        return {};
+
+    return cell_rect(m_selected_column, m_selected_row) + content_area().point();
+}
+
 void SelectableGrid::serialize(Serializer& serializer) const
 {
     serializer.add_property("selected_column", static_cast<int>(m_selected_column));
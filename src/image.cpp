@@ -178,7 +178,7 @@ void Image::serialize(const std::string& name, Serializer& serializer) const
     // TODO: serialize raw image data without uri
 }
 
-void Image::deserialize(const std::string& name, const std::string& value,
+void Image::deserialize(std::string_view name, const std::string& value,
                         const Serializer::Attributes& attrs)
 {
     detail::ignoreparam(name);
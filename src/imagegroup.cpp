@@ -78,7 +78,7 @@ void ImageGroup::serialize(Serializer& serializer) const
         serializer.add_property(std::string("checked_") + m_suffix, m_checked->uri());
 }
 
-bool ImageGroup::deserialize(const std::string& name, const std::string& value)
+bool ImageGroup::deserialize(std::string_view name, const std::string& value)
 {
     Palette::GroupId group;
 
@@ -296,15 +296,19 @@ cairo_status_t cairo_image_surface_write_to_jpeg(cairo_surface_t *sfc, const cha
 
 
 
-/*! This function decompresses a JPEG image from a memory buffer and creates a
- * Cairo image surface.
- * @param data Pointer to JPEG data (i.e. the full contents of a JPEG file read
- * into this buffer).
+/*! This function decompresses a JPEG image from a memory buffer at 1/denom of
+ * its size and creates a Cairo image surface. It is not exported.
+ * @param data Pointer to JPEG data. It becomes the mime data of the surface if
+ * denom is 1, and is freed otherwise.
  * @param len Length of buffer in bytes.
+ * @param denom 1, 2, 4 or 8. The DCT of libjpeg decodes the image at this
+ * reduced size directly, which is much faster than decoding all of it.
+ * @param width If not NULL, returns the full width of the image.
+ * @param height If not NULL, returns the full height of the image.
  * @return Returns a pointer to a cairo_surface_t structure. It should be
  * checked with cairo_surface_status() for errors.
  */
-cairo_surface_t *cairo_image_surface_create_from_jpeg_mem(void *data, size_t len)
+static cairo_surface_t *cj_decompress(void *data, size_t len, unsigned int denom, int *width, int *height)
 {
    struct jpeg_decompress_struct cinfo;
    struct jpeg_error_mgr jerr;
@@ -317,6 +321,14 @@ cairo_surface_t *cairo_image_surface_create_from_jpeg_mem(void *data, size_t len
    jpeg_mem_src(&cinfo, data, len);
    (void) jpeg_read_header(&cinfo, TRUE);
 
+   if (width != NULL)
+      *width = cinfo.image_width;
+   if (height != NULL)
+      *height = cinfo.image_height;
+
+   cinfo.scale_num = 1;
+   cinfo.scale_denom = denom;
+
 #ifdef LIBJPEG_TURBO_VERSION
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
    cinfo.out_color_space = JCS_EXT_BGRA;
@@ -335,6 +347,7 @@ cairo_surface_t *cairo_image_surface_create_from_jpeg_mem(void *data, size_t len
    if (cairo_surface_status(sfc) != CAIRO_STATUS_SUCCESS)
    {
       jpeg_destroy_decompress(&cinfo);
+      free(data);
       return sfc;
    }
 
@@ -355,13 +368,54 @@ cairo_surface_t *cairo_image_surface_create_from_jpeg_mem(void *data, size_t len
    (void) jpeg_finish_decompress(&cinfo);
    jpeg_destroy_decompress(&cinfo);
 
-   // set jpeg mime data
-   cairo_surface_set_mime_data(sfc, CAIRO_MIME_TYPE_JPEG, data, len, free, data);
+   // set jpeg mime data, only valid for the image at its full size
+   if (denom == 1)
+      cairo_surface_set_mime_data(sfc, CAIRO_MIME_TYPE_JPEG, data, len, free, data);
+   else
+      free(data);
 
    return sfc;
 }
 
 
+/*! This function decompresses a JPEG image from a memory buffer and creates a
+ * Cairo image surface.
+ * @param data Pointer to JPEG data (i.e. the full contents of a JPEG file read
+ * into this buffer).
+ * @param len Length of buffer in bytes.
+ * @return Returns a pointer to a cairo_surface_t structure. It should be
+ * checked with cairo_surface_status() for errors.
+ */
+cairo_surface_t *cairo_image_surface_create_from_jpeg_mem(void *data, size_t len)
+{
+   return cj_decompress(data, len, 1, NULL, NULL);
+}
+
+
+/*! This function decompresses a JPEG image from a memory buffer at a reduced
+ * size and creates a Cairo image surface. The image is decoded at 1/8, 1/4 or
+ * 1/2 of its size, the smallest of them at least as large as the scale, or at
+ * its full size.
+ * @param data Pointer to JPEG data (i.e. the full contents of a JPEG file read
+ * into this buffer). It is owned by this function.
+ * @param len Length of buffer in bytes.
+ * @param scale Scale the image is to be shown at, in (0, 1].
+ * @param width If not NULL, returns the full width of the image.
+ * @param height If not NULL, returns the full height of the image.
+ * @return Returns a pointer to a cairo_surface_t structure. It should be
+ * checked with cairo_surface_status() for errors.
+ */
+cairo_surface_t *cairo_image_surface_create_from_jpeg_mem_scaled(void *data, size_t len, double scale, int *width, int *height)
+{
+   unsigned int denom = 8;
+
+   while (denom > 1 && 1.0 / denom < scale)
+      denom /= 2;
+
+   return cj_decompress(data, len, denom, width, height);
+}
+
+
 /*! This function reads an JPEG image from a stream and creates a Cairo image
  * surface.
  * @param read_func Pointer to function which reads data.
@@ -40,6 +40,7 @@ cairo_status_t cairo_image_surface_write_to_jpeg_mem(cairo_surface_t* sfc, unsig
 cairo_status_t cairo_image_surface_write_to_jpeg_stream(cairo_surface_t* sfc, cairo_write_func_t write_func, void* closure, int quality);
 cairo_status_t cairo_image_surface_write_to_jpeg(cairo_surface_t* sfc, const char* filename, int quality);
 cairo_surface_t* cairo_image_surface_create_from_jpeg_mem(void* data, size_t len);
+cairo_surface_t* cairo_image_surface_create_from_jpeg_mem_scaled(void* data, size_t len, double scale, int* width, int* height);
 #ifdef USE_CAIRO_READ_FUNC_LEN_T
 cairo_surface_t* cairo_image_surface_create_from_jpeg_stream(cairo_read_func_len_t read_func, void* closure);
 #else
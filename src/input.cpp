@@ -5,9 +5,15 @@
  */
 #include "egt/app.h"
 #include "detail/egtlog.h"
+#include "detail/focuschain.h"
 #include "egt/input.h"
+#include "egt/profiler.h"
+#include "egt/screen.h"
 #include "egt/window.h"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <egt/detail/input/inputreplay.h>
 #include <egt/detail/mousegesture.h>
 
 namespace egt
@@ -24,6 +30,189 @@ Input::Input()
     });
 }
 
+/// Maximum number of points kept in the motion history.
+static const size_t MAX_MOTION_HISTORY = 256;
+
+/// Inputs holding back motion, in the order the motion started.
+static std::vector<Input*>& pending_motion()
+{
+    static std::vector<Input*> inputs;
+    return inputs;
+}
+
+/// History of the coalesced event being dispatched, if any.
+static const std::vector<DisplayPoint>* motion_history_dispatching = nullptr;
+
+/// Recent pointer motion, used to predict the pointer.
+struct MotionSamples
+{
+    struct Sample
+    {
+        DisplayPoint point;
+        std::chrono::steady_clock::time_point when;
+    };
+
+    /// Number of samples kept.
+    static constexpr size_t COUNT = 8;
+
+    void add(const DisplayPoint& point, std::chrono::steady_clock::time_point when)
+    {
+        samples[next] = {point, when};
+        next = (next + 1) % COUNT;
+        size = std::min(size + 1, COUNT);
+    }
+
+    const Sample& at(size_t age) const
+    {
+        return samples[(next + COUNT - 1 - age) % COUNT];
+    }
+
+    Sample samples[COUNT]{};
+    size_t next{0};
+    size_t size{0};
+};
+
+static MotionSamples motion_samples;
+
+/// Only motion this recent is used for prediction.
+static constexpr std::chrono::milliseconds PREDICTION_WINDOW{100};
+
+/// Predictions are limited to this far ahead.
+static constexpr std::chrono::milliseconds MAX_PREDICTION{100};
+
+DisplayPoint Input::predict_pointer(std::chrono::microseconds ahead)
+{
+    if (!motion_samples.size)
+        return {};
+
+    const auto& last = motion_samples.at(0);
+
+    // the oldest sample in the window gives the least noisy velocity
+    const auto* first = &last;
+    for (size_t age = 1; age < motion_samples.size; ++age)
+    {
+        const auto& sample = motion_samples.at(age);
+        if (last.when - sample.when > PREDICTION_WINDOW)
+            break;
+        first = &sample;
+    }
+
+    const auto span = std::chrono::duration<float>(last.when - first->when).count();
+    if (span <= 0.f)
+        return last.point;
+
+    const auto t = std::chrono::duration<float>(std::min<std::chrono::microseconds>(ahead, MAX_PREDICTION)).count();
+    const auto dx = static_cast<float>(last.point.x() - first->point.x()) / span;
+    const auto dy = static_cast<float>(last.point.y() - first->point.y()) / span;
+    return {last.point.x() + static_cast<DefaultDim>(std::lround(dx * t)),
+            last.point.y() + static_cast<DefaultDim>(std::lround(dy * t))};
+}
+
+static bool coalesce_motion_enabled()
+{
+    return Application::check_instance() &&
+           Application::instance().event().coalesce_motion();
+}
+
+void Input::flush_motion()
+{
+    // dispatching may start motion on other inputs, so don't hold onto any
+    auto& inputs = pending_motion();
+    if (inputs.empty())
+        return;
+
+    Profiler::Scope scope(Profiler::Phase::wait);
+    while (!inputs.empty())
+        inputs.front()->dispatch_motion();
+}
+
+const std::vector<DisplayPoint>& Input::motion_history()
+{
+    static const std::vector<DisplayPoint> empty;
+    return motion_history_dispatching ? *motion_history_dispatching : empty;
+}
+
+void Input::dispatch(Event& event)
+{
+    const auto when = m_timestamp != std::chrono::steady_clock::time_point() ?
+                      m_timestamp : std::chrono::steady_clock::now();
+    m_timestamp = {};
+
+    Profiler::instance().input(when);
+    detail::InputRecorder::capture(event, when);
+
+    // input devices report points of the display, which the screen may rotate
+    const auto screen = Application::instance().screen();
+    if (screen && screen->rotation())
+    {
+        switch (event.id())
+        {
+        case EventId::raw_pointer_down:
+        case EventId::raw_pointer_up:
+        case EventId::raw_pointer_move:
+        case EventId::pointer_dblclick:
+            event.pointer().point = screen->rotate_point(event.pointer().point);
+            break;
+        default:
+            break;
+        }
+    }
+
+    switch (event.id())
+    {
+    case EventId::raw_pointer_down:
+        motion_samples.size = 0;
+        motion_samples.add(event.pointer().point, when);
+        break;
+    case EventId::raw_pointer_move:
+        motion_samples.add(event.pointer().point, when);
+        break;
+    default:
+        break;
+    }
+
+    if (event.id() == EventId::raw_pointer_move && coalesce_motion_enabled())
+    {
+        // only merge motion of the same touch slot
+        if (m_motion_pending && m_motion.pointer().slot != event.pointer().slot)
+            dispatch_motion();
+
+        if (!m_motion_pending)
+        {
+            m_motion_pending = true;
+            m_motion_history.clear();
+            pending_motion().push_back(this);
+            Application::instance().event().request_frame();
+        }
+
+        if (m_motion_history.size() >= MAX_MOTION_HISTORY)
+            m_motion_history.erase(m_motion_history.begin());
+        m_motion_history.push_back(event.pointer().point);
+        m_motion = event;
+        m_motion_time = when;
+        return;
+    }
+
+    // motion that came before this event goes first
+    dispatch_motion();
+    dispatch_now(event, when);
+}
+
+void Input::dispatch_motion()
+{
+    if (!m_motion_pending)
+        return;
+
+    m_motion_pending = false;
+    auto& inputs = pending_motion();
+    inputs.erase(std::remove(inputs.begin(), inputs.end(), this), inputs.end());
+
+    auto event = m_motion;
+    motion_history_dispatching = &m_motion_history;
+    auto reset = detail::on_scope_exit([]() { motion_history_dispatching = nullptr; });
+    dispatch_now(event, m_motion_time);
+}
+
 template<class Callable>
 static bool handler_dispatch(Event& event, Event& eevent,
                              const Callable& handler)
@@ -45,12 +234,46 @@ static bool handler_dispatch(Event& event, Event& eevent,
     return false;
 }
 
+/// Keys moving the keyboard focus, see detail::focus_keys().
+static KeyboardCode focus_next_key = EKEY_TAB;
+static KeyboardCode focus_previous_key = EKEY_TAB;
+
+/// Move the keyboard focus if the event is one of its keys.
+static bool focus_key(const Event& event)
+{
+    if (event.id() != EventId::keyboard_down &&
+        event.id() != EventId::keyboard_up &&
+        event.id() != EventId::keyboard_repeat)
+        return false;
+
+    const auto& key = event.key();
+    bool backward;
+    if (focus_next_key == focus_previous_key)
+    {
+        if (key.keycode != focus_next_key)
+            return false;
+        backward = key.state.is_set(Key::KeyMod::shift);
+    }
+    else if (key.keycode == focus_next_key)
+        backward = false;
+    else if (key.keycode == focus_previous_key)
+        backward = true;
+    else
+        return false;
+
+    // the release of the key is swallowed with its press
+    if (event.id() != EventId::keyboard_up)
+        detail::move_focus(backward);
+
+    return true;
+}
+
 /**
  * @todo No mouse positions should be allowed off the screen box().  This is
  * possible with some input devices currently and we need to limit.  Be careful
  * not to drop events (like pointer up) when correcting.
  */
-void Input::dispatch(Event& event)
+void Input::dispatch_now(Event& event, std::chrono::steady_clock::time_point when)
 {
     // can't support recursive calls into the same dispatch function
     // one potential solution would be to asio::post() the call to dispatch if
@@ -66,7 +289,7 @@ void Input::dispatch(Event& event)
         detail::mouse_grab(nullptr);
     }
 
-    auto eevent = m_mouse->handle(event);
+    auto eevent = m_mouse->handle(event, when);
 
     EGTLOG_TRACE("input event: {}", event);
     if (eevent.id() != EventId::none)
@@ -107,6 +330,9 @@ void Input::dispatch(Event& event)
     if (continue_drag)
         eevent = Event(); // hide this event from handler_dispath()
 
+    if (focus_key(event))
+        return;
+
     if (Application::instance().modal_window())
     {
         // give event to the modal window
@@ -199,7 +425,11 @@ void Input::dispatch(Event& event)
 Input::Input(Input&&) noexcept = default;
 Input& Input::operator=(Input&&) noexcept = default;
 
-Input::~Input() noexcept = default;
+Input::~Input() noexcept
+{
+    auto& inputs = pending_motion();
+    inputs.erase(std::remove(inputs.begin(), inputs.end(), this), inputs.end());
+}
 
 Object Input::m_global_handler;
 
@@ -251,6 +481,63 @@ Widget* keyboard_focus()
     return keyboard_focus_widget;
 }
 
+Widget* next_focus(const Widget& widget, bool backward)
+{
+    return FocusChain::next(widget, backward);
+}
+
+/// Is a widget inside of a window.
+static bool inside(const Widget* widget, const Widget* window)
+{
+    for (; widget; widget = widget->parent())
+    {
+        if (widget == window)
+            return true;
+    }
+    return false;
+}
+
+Widget* move_focus(bool backward)
+{
+    auto modal = Application::instance().modal_window();
+
+    Widget* target = nullptr;
+    if (keyboard_focus_widget && FocusChain::linked(*keyboard_focus_widget) &&
+        (!modal || inside(keyboard_focus_widget, modal)))
+    {
+        target = FocusChain::next(*keyboard_focus_widget, backward);
+    }
+    else
+    {
+        if (modal)
+        {
+            target = FocusChain::first(*modal, backward);
+        }
+        else
+        {
+            for (auto& w : detail::reverse_iterate(Application::instance().windows()))
+            {
+                if (!w->top_level() || !w->visible())
+                    continue;
+
+                target = FocusChain::first(*w, backward);
+                break;
+            }
+        }
+    }
+
+    if (target)
+        keyboard_focus(target);
+
+    return keyboard_focus_widget;
+}
+
+void focus_keys(KeyboardCode next, KeyboardCode previous)
+{
+    focus_next_key = next;
+    focus_previous_key = previous;
+}
+
 Widget* dragged()
 {
     return dragged_widget;
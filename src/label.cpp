@@ -36,7 +36,7 @@ Label::Label(const std::string& text, const AlignFlags& text_align) noexcept
 Label::Label(const std::string& text, const Rect& rect, const AlignFlags& text_align) noexcept
     : TextWidget(text, rect, text_align)
 {
-    name("Label" + std::to_string(m_widgetid));
+    default_name("Label", m_widgetid);
 }
 
 Label::Label(Frame& parent, const std::string& text, const AlignFlags& text_align) noexcept
@@ -69,6 +69,7 @@ void Label::default_draw(const Label& widget, Painter& painter, const Rect&)
     widget.draw_box(painter, Palette::ColorId::label_bg, Palette::ColorId::border);
 
     detail::draw_text(painter,
+                      widget.text_run(),
                       widget.content_area(),
                       widget.text(),
                       widget.font(),
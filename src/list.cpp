@@ -9,6 +9,8 @@
 #include "egt/list.h"
 #include "egt/painter.h"
 #include "egt/string.h"
+#include <algorithm>
+#include <limits>
 
 namespace egt
 {
@@ -28,7 +30,7 @@ ListBox::ListBox(const ItemArray& items, const Rect& rect) noexcept
       m_view(),
       m_sizer(Orientation::vertical, Justification::start)
 {
-    name("ListBox" + std::to_string(m_widgetid));
+    default_name("ListBox", m_widgetid);
 
     add_component(m_view);
 
@@ -312,5 +314,219 @@ void ListBox::deserialize(Serializer::Properties& props)
     }), props.end());
 }
 
+/// Index of the item of a widget not set up for any item.
+static constexpr auto no_item = std::numeric_limits<size_t>::max();
+
+VirtualListBox::VirtualListBox(size_t count, ItemBinder binder, const Rect& rect) noexcept
+    : Widget(rect),
+      m_view(ScrolledView::Policy::never, ScrolledView::Policy::as_needed),
+      m_binder(std::move(binder))
+{
+    default_name("VirtualListBox", m_widgetid);
+
+    add_component(m_view);
+
+    fill_flags(Theme::FillFlag::blend);
+    border(theme().default_border());
+
+    m_view.add(m_canvas);
+    m_view.on_offset_changed([this]()
+    {
+        update_rows(false);
+    });
+
+    auto carea = content_area();
+    if (!carea.empty())
+        m_view.box(to_subordinate(carea));
+
+    item_count(count);
+}
+
+VirtualListBox::VirtualListBox(Frame& parent, size_t count, ItemBinder binder,
+                               const Rect& rect) noexcept
+    : VirtualListBox(count, std::move(binder), rect)
+{
+    parent.add(*this);
+}
+
+void VirtualListBox::resize(const Size& s)
+{
+    if (s != size())
+    {
+        Widget::resize(s);
+        auto carea = content_area();
+        if (!carea.empty())
+        {
+            m_view.box(to_subordinate(carea));
+            update_rows(false);
+        }
+    }
+}
+
+void VirtualListBox::update_rows(bool rebind)
+{
+    const auto carea = m_view.content_area();
+    if (carea.empty() || m_item_height <= 0)
+        return;
+
+    m_canvas.resize(Size(carea.width(), static_cast<DefaultDim>(m_count) * m_item_height));
+
+    // enough widgets to cover the view, even scrolled between two items
+    const auto needed = std::min<size_t>(m_count, carea.height() / m_item_height + 2);
+    if (m_rows.size() < needed)
+    {
+        // the widget of an item depends on the number of widgets
+        rebind = true;
+        while (m_rows.size() < needed)
+        {
+            auto row = std::make_shared<StringItem>();
+            m_canvas.add(row);
+            m_rows.push_back(row);
+            m_bound.push_back(no_item);
+        }
+    }
+
+    const auto pool = m_rows.size();
+    if (!pool)
+        return;
+
+    const auto top = std::max(0, -m_view.offset().y());
+    const size_t first = top / m_item_height;
+
+    // the item at index is always shown by the widget at index % pool
+    for (size_t slot = 0; slot < pool; ++slot)
+    {
+        const auto index = first + (slot + pool - first % pool) % pool;
+        auto& row = m_rows[slot];
+
+        if (index >= m_count)
+        {
+            row->hide();
+            m_bound[slot] = no_item;
+            continue;
+        }
+
+        if (rebind || m_bound[slot] != index)
+        {
+            if (m_binder)
+                m_binder(*row, index);
+            m_bound[slot] = index;
+        }
+
+        row->box(Rect(0, static_cast<DefaultDim>(index) * m_item_height,
+                      carea.width(), m_item_height));
+        row->checked(static_cast<ssize_t>(index) == m_selected);
+        row->show();
+    }
+}
+
+void VirtualListBox::handle(Event& event)
+{
+    switch (event.id())
+    {
+    case EventId::pointer_click:
+    {
+        for (size_t slot = 0; slot < m_rows.size(); slot++)
+        {
+            if (m_bound[slot] != no_item &&
+                m_rows[slot]->hit(event.pointer().point))
+            {
+                selected(m_bound[slot]);
+                break;
+            }
+        }
+
+        event.stop();
+        break;
+    }
+    case EventId::raw_pointer_down:
+    case EventId::raw_pointer_up:
+        return;
+    default:
+        break;
+    }
+
+    Widget::handle(event);
+}
+
+void VirtualListBox::item_count(size_t count)
+{
+    const auto selected = m_selected;
+
+    m_count = count;
+
+    // like ListBox, keep an item selected
+    if (m_selected >= static_cast<ssize_t>(m_count))
+        m_selected = static_cast<ssize_t>(m_count) - 1;
+    if (m_selected < 0 && m_count)
+        m_selected = 0;
+
+    update_rows(true);
+
+    on_items_changed.invoke();
+
+    if (selected >= 0 && selected != m_selected)
+    {
+        damage();
+        on_selected_changed.invoke();
+    }
+}
+
+void VirtualListBox::binder(ItemBinder binder)
+{
+    m_binder = std::move(binder);
+    update_rows(true);
+}
+
+void VirtualListBox::item_height(DefaultDim height)
+{
+    if (detail::change_if_diff<>(m_item_height, height))
+        update_rows(true);
+}
+
+void VirtualListBox::refresh()
+{
+    update_rows(true);
+}
+
+void VirtualListBox::selected(size_t index)
+{
+    if (index >= m_count)
+        return;
+
+    const auto changed = m_selected != static_cast<ssize_t>(index);
+    m_selected = index;
+
+    for (size_t slot = 0; slot < m_rows.size(); slot++)
+    {
+        if (m_bound[slot] != no_item)
+            m_rows[slot]->checked(m_bound[slot] == index);
+    }
+
+    if (changed)
+    {
+        damage();
+        on_selected_changed.invoke();
+    }
+
+    on_selected.invoke(index);
+}
+
+void VirtualListBox::scroll_to(size_t index)
+{
+    index = std::min(index, m_count);
+    m_view.offset(Point(m_view.offset().x(), -static_cast<DefaultDim>(index) * m_item_height));
+}
+
+void VirtualListBox::scroll_top()
+{
+    m_view.offset(Point(m_view.offset().x(), 0));
+}
+
+void VirtualListBox::scroll_bottom()
+{
+    m_view.offset(Point(m_view.offset().x(), m_view.offset_max().y()));
+}
+
 }
 }
@@ -0,0 +1,399 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/glyphatlas.h"
+#include "detail/utf8text.h"
+#include "egt/detail/string.h"
+#include "egt/frame.h"
+#include "egt/logview.h"
+#include "egt/painter.h"
+#include "egt/serialize.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace egt
+{
+inline namespace v1
+{
+
+LogView::LogView(const Rect& rect, size_t max_lines) noexcept
+    : TextWidget({}, rect, AlignFlag::left | AlignFlag::top)
+{
+    default_name("LogView", m_widgetid);
+    initialize(max_lines);
+}
+
+LogView::LogView(Frame& parent, const Rect& rect, size_t max_lines) noexcept
+    : LogView(rect, max_lines)
+{
+    parent.add(*this);
+}
+
+LogView::LogView(Serializer::Properties& props, bool is_derived) noexcept
+    : TextWidget(props, true)
+{
+    initialize(DEFAULT_MAX_LINES);
+
+    deserialize(props);
+
+    // the text property is the initial lines
+    if (!m_text.empty())
+    {
+        auto str = std::move(m_text);
+        m_text.clear();
+        invalidate_text_index();
+        append(str);
+    }
+
+    if (!is_derived)
+        deserialize_leaf(props);
+}
+
+void LogView::initialize(size_t max_lines)
+{
+    border(theme().default_border());
+    fill_flags(Theme::FillFlag::blend);
+    padding(5);
+
+    m_lines.resize(std::max<size_t>(max_lines, 1));
+
+    m_slider.orient(Orientation::vertical);
+    m_slider.slider_flags().set({Slider::SliderFlag::rectangle_handle,
+                                 Slider::SliderFlag::inverted,
+                                 Slider::SliderFlag::consistent_line});
+    m_slider.on_value_changed.on_event([this]() { damage(); });
+    m_slider.live_update(true);
+    m_slider.hide();
+    add_component(m_slider);
+}
+
+void LogView::push_line(std::string str)
+{
+    if (m_count < m_lines.size())
+    {
+        entry(m_count++) = std::move(str);
+    }
+    else
+    {
+        m_lines[m_head] = std::move(str);
+        m_head = (m_head + 1) % m_lines.size();
+    }
+}
+
+void LogView::append(const std::string& str)
+{
+    if (str.empty())
+        return;
+
+    const auto first = first_visible_line();
+    const auto at_end = first + visible_lines() >= m_count;
+    const auto count = m_count;
+    auto changed = m_partial && m_count ? m_count - 1 : m_count;
+    size_t dropped = 0;
+
+    for (size_t start = 0;;)
+    {
+        const auto end = str.find('\n', start);
+        auto piece = str.substr(start, end == std::string::npos ? end : end - start);
+
+        if (m_partial && m_count)
+        {
+            entry(m_count - 1) += piece;
+        }
+        else
+        {
+            if (m_count == m_lines.size())
+                ++dropped;
+            push_line(std::move(piece));
+        }
+
+        m_partial = end == std::string::npos;
+        if (m_partial)
+            break;
+
+        start = end + 1;
+        if (start == str.size())
+            break;
+    }
+
+    m_joined_valid = false;
+    on_text_changed.invoke();
+
+    update_slider();
+
+    if (m_auto_scroll && at_end)
+    {
+        scroll_to_end();
+    }
+    else if (dropped && m_slider.visible())
+    {
+        // keep the same lines in view
+        m_slider.value(m_slider.value() > static_cast<int>(dropped) ?
+                       m_slider.value() - static_cast<int>(dropped) : 0);
+    }
+
+    // lines only moved if the view or the oldest lines did
+    if (dropped || first != first_visible_line())
+        damage(text_area());
+    else if (count != m_count || changed < m_count)
+        damage_lines(changed);
+}
+
+void LogView::text(const std::string& str)
+{
+    clear();
+    append(str);
+}
+
+const std::string& LogView::text() const
+{
+    if (!m_joined_valid)
+    {
+        m_joined.clear();
+        for (size_t i = 0; i < m_count; ++i)
+        {
+            m_joined += line(i);
+            if (i + 1 < m_count || !m_partial)
+                m_joined += '\n';
+        }
+        m_joined_valid = true;
+    }
+
+    return m_joined;
+}
+
+size_t LogView::len() const
+{
+    return detail::utf8len(text());
+}
+
+void LogView::clear()
+{
+    if (!m_count)
+        return;
+
+    for (auto& l : m_lines)
+        l.clear();
+    m_head = 0;
+    m_count = 0;
+    m_partial = false;
+    m_joined_valid = false;
+
+    on_text_changed.invoke();
+    update_slider();
+    damage();
+}
+
+const std::string& LogView::line(size_t index) const
+{
+    if (index >= m_count)
+        throw std::out_of_range("line index out of range");
+
+    return m_lines[(m_head + index) % m_lines.size()];
+}
+
+void LogView::max_lines(size_t max)
+{
+    max = std::max<size_t>(max, 1);
+    if (max == m_lines.size())
+        return;
+
+    // keep the most recent lines, from the oldest one
+    const auto count = std::min(m_count, max);
+    std::vector<std::string> lines(max);
+    for (size_t i = 0; i < count; ++i)
+        lines[i] = std::move(entry(m_count - count + i));
+
+    m_lines = std::move(lines);
+    m_head = 0;
+    if (count != m_count)
+    {
+        m_count = count;
+        m_joined_valid = false;
+        on_text_changed.invoke();
+    }
+
+    update_slider();
+    damage();
+}
+
+void LogView::scroll_to_end()
+{
+    if (m_slider.visible())
+        m_slider.value(m_slider.ending());
+}
+
+size_t LogView::first_visible_line() const
+{
+    return m_slider.visible() ? m_slider.value() : 0;
+}
+
+size_t LogView::visible_lines() const
+{
+    const auto height = line_height();
+    if (height <= 0)
+        return 0;
+
+    return std::max<DefaultDim>(text_area().height(), 0) / height;
+}
+
+Rect LogView::text_area() const
+{
+    auto b = content_area();
+
+    if (m_slider.visible())
+        b.width(std::max<DefaultDim>(b.width() - m_slider_dim, 0));
+
+    return b;
+}
+
+DefaultDim LogView::line_height() const
+{
+    cairo_font_extents_t fe;
+    cairo_scaled_font_extents(font().scaled_font(), &fe);
+    return fe.height;
+}
+
+void LogView::update_slider()
+{
+    const auto visible = visible_lines();
+    const auto hidden = static_cast<int>(m_count > visible ? m_count - visible : 0);
+
+    if (hidden)
+    {
+        if (m_slider.ending() != hidden)
+            m_slider.ending(hidden);
+
+        if (!m_slider.visible())
+        {
+            m_slider.show();
+            damage();
+        }
+    }
+    else if (m_slider.visible())
+    {
+        m_slider.hide();
+        if (m_slider.value())
+            m_slider.value(0);
+        damage();
+    }
+}
+
+void LogView::damage_lines(size_t index)
+{
+    const auto first = first_visible_line();
+    const auto height = line_height();
+    const auto area = text_area();
+
+    if (index < first)
+        index = first;
+
+    const auto top = area.y() + static_cast<DefaultDim>(index - first) * height;
+    if (top >= area.bottom())
+        return;
+
+    damage(Rect(area.x(), top, area.width(), area.bottom() - top));
+}
+
+void LogView::draw(Painter& painter, const Rect& rect)
+{
+    draw_box(painter, Palette::ColorId::bg, Palette::ColorId::border);
+
+    const auto area = text_area();
+    const auto clip = Rect::intersection(area, rect);
+    if (!clip.empty() && m_count)
+    {
+        Painter::AutoSaveRestore sr(painter);
+        painter.draw(clip);
+        painter.clip();
+
+        painter.set(font());
+        painter.set(color(Palette::ColorId::text));
+
+        auto cr = painter.context().get();
+        cairo_font_extents_t fe;
+        cairo_font_extents(cr, &fe);
+
+        const DefaultDim height = fe.height;
+        if (height > 0)
+        {
+            // only the lines crossing the clip
+            const auto first = first_visible_line();
+            const auto begin = first + (clip.top() - area.top()) / height;
+            const auto end = std::min(m_count,
+                                      first + (clip.bottom() - area.top() + height - 1) / height);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                const auto& l = line(i);
+                if (l.empty())
+                    continue;
+
+                const auto y = area.y() + static_cast<DefaultDim>(i - first) * height;
+                detail::show_text(cr, l, area.x(), y + fe.height - fe.descent);
+            }
+        }
+    }
+
+    if (m_slider.visible())
+    {
+        Painter::AutoSaveRestore sr(painter);
+
+        const auto& origin = point();
+        painter.translate(origin);
+        m_slider.draw(painter, rect - origin);
+    }
+}
+
+void LogView::resize(const Size& size)
+{
+    TextWidget::resize(size);
+
+    auto b = content_area();
+    b.x(b.x() + b.width() - m_slider_dim);
+    b.width(m_slider_dim);
+    m_slider.move(b.point() - point());
+    m_slider.resize(b.size());
+
+    const auto at_end = first_visible_line() + visible_lines() >= m_count;
+    update_slider();
+    if (m_auto_scroll && at_end)
+        scroll_to_end();
+}
+
+Size LogView::min_size_hint() const
+{
+    if (!m_min_size.empty())
+        return m_min_size;
+
+    return text_size("Hello World") + Widget::min_size_hint() + Size(m_slider_dim, 0);
+}
+
+void LogView::serialize(Serializer& serializer) const
+{
+    TextWidget::serialize(serializer);
+
+    if (max_lines() != DEFAULT_MAX_LINES)
+        serializer.add_property("max_lines", static_cast<unsigned int>(max_lines()));
+    if (!auto_scroll())
+        serializer.add_property("auto_scroll", auto_scroll());
+}
+
+void LogView::deserialize(Serializer::Properties& props)
+{
+    props.erase(std::remove_if(props.begin(), props.end(), [&](auto & p)
+    {
+        if (std::get<0>(p) == "max_lines")
+            max_lines(std::stoul(std::get<1>(p)));
+        else if (std::get<0>(p) == "auto_scroll")
+            auto_scroll(detail::from_string(std::get<1>(p)));
+        else
+            return false;
+        return true;
+    }), props.end());
+}
+
+}
+}
@@ -18,6 +18,8 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <sys/stat.h>
 #include <thread>
 
 /*
@@ -239,6 +241,67 @@ static void createargtable(lua_State* L, char** argv, int argc, int script)
     lua_setglobal(L, "arg");
 }
 
+static int cache_writer(lua_State* L, const void* p, size_t sz, void* ud)
+{
+    (void)L;
+    return fwrite(p, sz, 1, static_cast<FILE*>(ud)) != 1;
+}
+
+/*
+ * Load a script file, using its compiled chunk cached next to it, i.e.
+ * script.luac for script.lua, if it is newer than the file, and caching it
+ * otherwise.  Compiled chunks, like the output of luac, are loaded as they
+ * are.  Failing to write the cache, i.e. on a read only file system, is not an
+ * error.  Set EGT_LUA_NOCACHE to disable the cache.
+ */
+static int loadfile_cached(lua_State* L, const char* fname)
+{
+    size_t len = fname ? strlen(fname) : 0;
+    if (len < 4 || strcmp(fname + len - 4, ".lua") != 0 || getenv("EGT_LUA_NOCACHE"))
+        return luaL_loadfile(L, fname);
+
+    const std::string cache = std::string(fname) + "c";
+
+    struct stat source;
+    struct stat cached;
+    if (stat(fname, &source) == 0 && stat(cache.c_str(), &cached) == 0 &&
+        (cached.st_mtim.tv_sec > source.st_mtim.tv_sec ||
+         (cached.st_mtim.tv_sec == source.st_mtim.tv_sec &&
+          cached.st_mtim.tv_nsec > source.st_mtim.tv_nsec)))
+    {
+        /* chunk name as if loading the source, for error messages */
+        const std::string chunkname = std::string("@") + fname;
+        FILE* f = fopen(cache.c_str(), "rb");
+        if (f)
+        {
+            std::string buffer;
+            char tmp[4096];
+            size_t n;
+            while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+                buffer.append(tmp, n);
+            fclose(f);
+
+            if (luaL_loadbufferx(L, buffer.data(), buffer.size(),
+                                 chunkname.c_str(), "b") == LUA_OK)
+                return LUA_OK;
+            lua_pop(L, 1);  /* stale or foreign cache, load the source */
+        }
+    }
+
+    int status = luaL_loadfile(L, fname);
+    if (status == LUA_OK)
+    {
+        FILE* f = fopen(cache.c_str(), "wb");
+        if (f)
+        {
+            int err = lua_dump(L, cache_writer, f, 0);
+            if (fclose(f) != 0 || err)
+                remove(cache.c_str());
+        }
+    }
+    return status;
+}
+
 static int dochunk(lua_State* L, int status)
 {
     if (status == LUA_OK) status = docall(L, 0, 0);
@@ -247,7 +310,7 @@ static int dochunk(lua_State* L, int status)
 
 static int dofile(lua_State* L, const char* name)
 {
-    return dochunk(L, luaL_loadfile(L, name));
+    return dochunk(L, loadfile_cached(L, name));
 }
 
 
@@ -471,7 +534,7 @@ static int handle_script(lua_State* L, char** argv)
     const char* fname = argv[0];
     if (strcmp(fname, "-") == 0 && strcmp(argv[-1], "--") != 0)
         fname = NULL;  /* stdin */
-    status = luaL_loadfile(L, fname);
+    status = loadfile_cached(L, fname);
     if (status == LUA_OK)
     {
         int n = pushargs(L);  /* push arguments to script */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/procfile.h"
+#include "egt/app.h"
+#include "egt/eventloop.h"
+#include "egt/metrics.h"
+#include "egt/screen.h"
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+struct MetricsSampler::Impl
+{
+    detail::ProcFile stat{"/proc/stat"};
+    detail::ProcFile meminfo{"/proc/meminfo"};
+    /// fdinfo of the DRM devices open, which report engine usage.
+    std::vector<std::unique_ptr<detail::ProcFile>> drm;
+
+    std::vector<detail::CpuTimes> times;
+    std::vector<detail::CpuTimes> last_times;
+    std::vector<uint64_t> engines;
+    std::vector<uint64_t> last_engines;
+    uint64_t last_frames{0};
+    uint64_t last_damaged{0};
+    uint64_t last_wakeups{0};
+    std::chrono::steady_clock::time_point last{};
+};
+
+/**
+ * Get the busy time of each engine from DRM fdinfo, like
+ * "drm-engine-gfx2d: 123456 ns".
+ */
+static void parse_engines(std::string_view fdinfo, std::vector<uint64_t>& engines)
+{
+    static constexpr std::string_view key = "drm-engine-";
+
+    size_t line = 0;
+    while (line < fdinfo.size())
+    {
+        auto end = fdinfo.find('\n', line);
+        if (end == std::string_view::npos)
+            end = fdinfo.size();
+
+        if (fdinfo.compare(line, key.size(), key) == 0)
+        {
+            auto pos = fdinfo.find(':', line);
+            uint64_t value{};
+            if (pos < end && detail::parse_number(fdinfo, ++pos, value))
+                engines.push_back(value);
+        }
+
+        line = end + 1;
+    }
+}
+
+/// Difference of two counters, when the counter may have been reset.
+static uint64_t delta(uint64_t current, uint64_t last)
+{
+    return current >= last ? current - last : current;
+}
+
+MetricsSampler::MetricsSampler(std::chrono::milliseconds interval)
+    : m_timer(interval),
+      m_impl(std::make_unique<Impl>())
+{
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/fdinfo", ec))
+    {
+        auto fdinfo = std::make_unique<detail::ProcFile>(entry.path().string());
+        if (fdinfo->read().find("drm-engine-") != std::string_view::npos)
+            m_impl->drm.push_back(std::move(fdinfo));
+    }
+
+    EGTLOG_DEBUG("sampling {} drm devices", m_impl->drm.size());
+
+    m_timer.on_timeout([this]()
+    {
+        sample();
+    });
+
+    // so the first sample has usages
+    sample();
+}
+
+void MetricsSampler::start()
+{
+    m_timer.start();
+}
+
+void MetricsSampler::stop()
+{
+    m_timer.cancel();
+}
+
+void MetricsSampler::sample()
+{
+    auto& impl = *m_impl;
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = now - impl.last;
+    const auto first = impl.last == std::chrono::steady_clock::time_point{};
+
+    detail::parse_cpu_times(impl.stat.read(), impl.times);
+    if (!impl.times.empty() && impl.times.size() == impl.last_times.size())
+    {
+        m_metrics.cpu = detail::cpu_usage(impl.last_times.front(), impl.times.front());
+        m_metrics.cores.resize(impl.times.size() - 1);
+        for (size_t i = 1; i < impl.times.size(); ++i)
+            m_metrics.cores[i - 1] = detail::cpu_usage(impl.last_times[i], impl.times[i]);
+    }
+    std::swap(impl.times, impl.last_times);
+
+    const auto meminfo = impl.meminfo.read();
+    uint64_t kb{};
+    if (detail::parse_field(meminfo, "MemTotal:", kb))
+        m_metrics.memory_total = kb * 1024;
+    if (detail::parse_field(meminfo, "MemAvailable:", kb))
+        m_metrics.memory_available = kb * 1024;
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    // only walks the arenas, no system call
+    const auto info = mallinfo2();
+    m_metrics.heap = info.uordblks + info.hblkhd;
+#endif
+
+    impl.engines.clear();
+    for (auto& fdinfo : impl.drm)
+        parse_engines(fdinfo->read(), impl.engines);
+    if (!impl.engines.empty() && impl.engines.size() == impl.last_engines.size() &&
+        !first && elapsed.count() > 0)
+    {
+        double busiest = 0;
+        for (size_t i = 0; i < impl.engines.size(); ++i)
+        {
+            const auto busy = delta(impl.engines[i], impl.last_engines[i]) / 1e9;
+            busiest = std::max(busiest, busy / elapsed.count());
+        }
+        m_metrics.gpu = std::min(100., 100. * busiest);
+    }
+    std::swap(impl.engines, impl.last_engines);
+
+    if (Application::check_instance())
+    {
+        auto& app = Application::instance();
+        uint64_t frames = 0;
+        uint64_t damaged = 0;
+        if (app.screen())
+        {
+            frames = app.screen()->flip_stats().frames;
+            damaged = app.screen()->flip_stats().damaged_pixels;
+        }
+        const auto wakeups = app.event().wakeup_stats().total();
+
+        if (!first && elapsed.count() > 0)
+        {
+            const auto flipped = delta(frames, impl.last_frames);
+            m_metrics.fps = flipped / elapsed.count();
+            m_metrics.damaged_pixels = flipped ?
+                                       static_cast<double>(delta(damaged, impl.last_damaged)) / flipped : 0.;
+            m_metrics.wakeups = delta(wakeups, impl.last_wakeups) / elapsed.count();
+        }
+
+        impl.last_frames = frames;
+        impl.last_damaged = damaged;
+        impl.last_wakeups = wakeups;
+    }
+
+    impl.last = now;
+    m_metrics.when = now;
+
+    on_update.invoke(m_metrics);
+}
+
+MetricsSampler::~MetricsSampler() noexcept = default;
+
+}
+}
+}
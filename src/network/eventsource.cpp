@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "egt/app.h"
+#include "egt/binding.h"
+#include "egt/eventloop.h"
+#include "egt/network/eventsource.h"
+#include "egt/network/http.h"
+#include <algorithm>
+#include <cstdlib>
+#include <egt/asio.hpp>
+#include <map>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+struct EventSourceImpl : public std::enable_shared_from_this<EventSourceImpl>
+{
+    /// Longest line accepted, the stream fails on a longer one.
+    static constexpr size_t MAX_LINE = 1024 * 1024;
+
+    EventSourceImpl(experimental::EventSource& owner, asio::io_context& io)
+        : owner(&owner),
+          io(io),
+          timer(io)
+    {}
+
+    bool alive(uint64_t id) const
+    {
+        return owner && id == generation;
+    }
+
+    void connect();
+    bool accept(uint64_t id);
+    bool feed(uint64_t id, const char* data, size_t size);
+    bool line(uint64_t id, std::string_view line, bool in_chunk);
+    bool dispatch(uint64_t id);
+    void fail(const std::string& message, bool reconnect);
+    void retire();
+
+    experimental::EventSource* owner;
+    asio::io_context& io;
+    std::unique_ptr<experimental::HttpClientRequest> request;
+    /// Counts the requests, so callbacks of a previous one are ignored.
+    uint64_t generation{0};
+    bool opened{false};
+
+    std::string url;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::map<std::string, std::vector<Observable<std::string>*>> bindings;
+
+    asio::steady_timer timer;
+    std::chrono::milliseconds retry{3000};
+
+    /// Line split across received chunks.
+    std::string partial;
+    /// The last chunk ended with '\r', so a leading '\n' is skipped.
+    bool cr{false};
+
+    /// Fields of the event being received.
+    std::string event;
+    std::string id;
+    /// Data of the event, unless held in the received chunk by data_view.
+    std::string data;
+    std::string_view data_view;
+    bool data_in_chunk{false};
+    size_t data_lines{0};
+};
+
+void EventSourceImpl::connect()
+{
+    retire();
+
+    const auto gen = ++generation;
+    opened = false;
+    partial.clear();
+    cr = false;
+    event.clear();
+    data.clear();
+    data_in_chunk = false;
+    data_lines = 0;
+
+    request = std::make_unique<experimental::HttpClientRequest>();
+    request->header("Accept", "text/event-stream");
+    request->header("Cache-Control", "no-cache");
+    if (!id.empty())
+        request->header("Last-Event-ID", id);
+    for (const auto& header : headers)
+        request->header(header.first, header.second);
+    // events may be far apart
+    request->stall_timeout(std::chrono::seconds(0));
+
+    std::weak_ptr<EventSourceImpl> weak = shared_from_this();
+    request->start_stream(url, [weak, gen](const unsigned char* data, size_t len, bool done)
+    {
+        auto self = weak.lock();
+        if (!self || !self->alive(gen))
+            return true;
+
+        if (!self->opened && (data || self->request->status()))
+        {
+            if (!self->accept(gen))
+                return true;
+        }
+
+        if (data && len)
+        {
+            if (!self->feed(gen, reinterpret_cast<const char*>(data), len))
+                return true;
+        }
+
+        if (done)
+        {
+            // a network error, or the server ended the stream
+            self->fail(self->opened ? "stream ended" : "connection failed", true);
+        }
+
+        return true;
+    });
+}
+
+bool EventSourceImpl::accept(uint64_t gen)
+{
+    const auto status = request->status();
+    const auto type = request->response_header("Content-Type");
+
+    // the server does not want it, so it is not opened again
+    if (status != 200)
+    {
+        fail(fmt::format("unexpected status {}", status), false);
+        return false;
+    }
+    if (type.compare(0, 17, "text/event-stream") != 0)
+    {
+        fail("unexpected content type " + type, false);
+        return false;
+    }
+
+    opened = true;
+    owner->on_open.invoke();
+    return alive(gen);
+}
+
+bool EventSourceImpl::feed(uint64_t gen, const char* p, size_t n)
+{
+    size_t i = 0;
+    if (cr)
+    {
+        cr = false;
+        if (p[0] == '\n')
+            i = 1;
+    }
+
+    auto start = i;
+    for (; i < n; ++i)
+    {
+        const auto c = p[i];
+        if (c != '\n' && c != '\r')
+            continue;
+
+        bool ok;
+        if (partial.empty())
+        {
+            ok = line(gen, std::string_view(p + start, i - start), true);
+        }
+        else
+        {
+            partial.append(p + start, i - start);
+            ok = line(gen, partial, false);
+            if (ok)
+                partial.clear();
+        }
+        if (!ok)
+            return false;
+
+        if (c == '\r')
+        {
+            if (i + 1 < n)
+            {
+                if (p[i + 1] == '\n')
+                    ++i;
+            }
+            else
+            {
+                cr = true;
+            }
+        }
+        start = i + 1;
+    }
+
+    partial.append(p + start, n - start);
+    if (partial.size() > MAX_LINE)
+    {
+        fail("line too long", false);
+        return false;
+    }
+
+    // the chunk is not kept by the request
+    if (data_in_chunk)
+    {
+        data.assign(data_view.data(), data_view.size());
+        data_in_chunk = false;
+    }
+
+    return true;
+}
+
+bool EventSourceImpl::line(uint64_t gen, std::string_view line, bool in_chunk)
+{
+    if (line.empty())
+        return dispatch(gen);
+
+    // comment, often sent to keep the connection alive
+    if (line[0] == ':')
+        return true;
+
+    const auto colon = line.find(':');
+    const auto field = line.substr(0, colon);
+    std::string_view value;
+    if (colon != std::string_view::npos)
+    {
+        value = line.substr(colon + 1);
+        if (!value.empty() && value[0] == ' ')
+            value.remove_prefix(1);
+    }
+
+    if (field == "data")
+    {
+        if (data_lines == 0 && in_chunk)
+        {
+            data_view = value;
+            data_in_chunk = true;
+        }
+        else
+        {
+            if (data_in_chunk)
+            {
+                data.assign(data_view.data(), data_view.size());
+                data_in_chunk = false;
+            }
+            if (data_lines)
+                data += '\n';
+            data.append(value.data(), value.size());
+        }
+        ++data_lines;
+    }
+    else if (field == "event")
+    {
+        event.assign(value.data(), value.size());
+    }
+    else if (field == "id")
+    {
+        if (value.find('\0') == std::string_view::npos)
+            id.assign(value.data(), value.size());
+    }
+    else if (field == "retry")
+    {
+        if (!value.empty() &&
+            std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            retry = std::chrono::milliseconds(std::strtoul(std::string(value).c_str(), nullptr, 10));
+    }
+
+    return true;
+}
+
+bool EventSourceImpl::dispatch(uint64_t gen)
+{
+    if (!data_lines)
+    {
+        event.clear();
+        return true;
+    }
+
+    experimental::EventSourceMessage message;
+    message.event = event.empty() ? "message" : event;
+    message.data = data_in_chunk ? data_view : std::string_view(data);
+    message.id = id;
+
+    owner->on_message.invoke(message);
+    if (!alive(gen))
+        return false;
+
+    const auto i = bindings.find(std::string(message.event));
+    if (i != bindings.end())
+    {
+        const std::string value(message.data);
+        for (auto observable : i->second)
+            *observable = value;
+    }
+
+    event.clear();
+    data.clear();
+    data_in_chunk = false;
+    data_lines = 0;
+    return true;
+}
+
+void EventSourceImpl::fail(const std::string& message, bool reconnect)
+{
+    EGTLOG_DEBUG("eventsource {}: {}", url, message);
+
+    ++generation;
+    opened = false;
+    retire();
+
+    const auto gen = generation;
+    if (owner)
+        owner->on_error.invoke(message);
+
+    // closed or opened again by the handler
+    if (!reconnect || !alive(gen))
+        return;
+
+    timer.expires_after(retry);
+    std::weak_ptr<EventSourceImpl> weak = shared_from_this();
+    timer.async_wait([weak, gen](const asio::error_code & ec)
+    {
+        auto self = weak.lock();
+        if (!ec && self && self->alive(gen))
+            self->connect();
+    });
+}
+
+void EventSourceImpl::retire()
+{
+    // this may be called from the callback of the request, so it is
+    // destroyed once the callback returned
+    if (request)
+    {
+        std::shared_ptr<experimental::HttpClientRequest> old(std::move(request));
+        asio::post(io, [old]() {});
+    }
+}
+
+}
+
+namespace experimental
+{
+
+EventSource::EventSource()
+    : m_impl(std::make_shared<detail::EventSourceImpl>(*this, Application::instance().event().io()))
+{}
+
+void EventSource::open(const std::string& url)
+{
+    m_impl->timer.cancel();
+    m_impl->url = url;
+    m_impl->connect();
+}
+
+void EventSource::close()
+{
+    m_impl->timer.cancel();
+    ++m_impl->generation;
+    m_impl->opened = false;
+    m_impl->retire();
+}
+
+bool EventSource::is_open() const
+{
+    return m_impl->opened;
+}
+
+void EventSource::header(const std::string& name, const std::string& value)
+{
+    m_impl->headers.emplace_back(name, value);
+}
+
+void EventSource::bind(const std::string& event, Observable<std::string>& value)
+{
+    m_impl->bindings[event].push_back(&value);
+}
+
+void EventSource::retry(std::chrono::milliseconds delay)
+{
+    m_impl->retry = delay;
+}
+
+std::string EventSource::last_event_id() const
+{
+    return m_impl->id;
+}
+
+EventSource::~EventSource() noexcept
+{
+    m_impl->owner = nullptr;
+    m_impl->timer.cancel();
+    m_impl->retire();
+}
+
+}
+}
+}
@@ -5,13 +5,27 @@
  */
 #include "detail/egtlog.h"
 #include "egt/app.h"
+#include "egt/detail/filesystem.h"
 #include "egt/eventloop.h"
 #include "egt/network/http.h"
+#include "egt/updatechannel.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cctype>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <curl/curl.h>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace egt
 {
@@ -20,27 +34,185 @@ inline namespace v1
 
 namespace detail
 {
-struct HttpClientRequestData
+static std::string& http_cache_dir()
+{
+    static std::string dir = []()
+    {
+        auto value = std::getenv("EGT_HTTP_CACHE_DIR");
+        return std::string(value ? value : "");
+    }();
+    return dir;
+}
+
+static bool& http_network_thread()
+{
+    static bool enabled = []()
+    {
+        auto value = std::getenv("EGT_HTTP_THREAD");
+        return value && std::atoi(value) != 0;
+    }();
+    return enabled;
+}
+
+/// Can a response be cached, event streams never end.
+static bool cacheable(const std::map<std::string, std::string>& headers)
+{
+    const auto control = headers.find("cache-control");
+    if (control != headers.end() && control->second.find("no-store") != std::string::npos)
+        return false;
+
+    const auto type = headers.find("content-type");
+    return type == headers.end() || type->second.find("text/event-stream") == std::string::npos;
+}
+
+/**
+ * State of a request.
+ *
+ * With the network thread, the transfer is run there, and its events are
+ * queued here and applied in the event loop as an update: however many
+ * arrive between two frames, the event loop is woken up once for them.
+ */
+struct HttpClientRequestData : public UpdateState,
+    public std::enable_shared_from_this<HttpClientRequestData>
 {
     std::string url;
     CURL* easy{nullptr};
-    std::unique_ptr<asio::ip::tcp::socket> socket;
-    int last_event{CURL_POLL_NONE};
-    experimental::HttpClientRequest::ReadCallback m_read_callback;
+    experimental::HttpClientRequest::StreamCallback m_read_callback;
+    /// Request of this state, nullptr once destroyed.
+    experimental::HttpClientRequest* owner{nullptr};
+
+    /// Size of the receive buffer, or 0 for the curl default.
+    size_t buffer_size{0};
+    /// The transfer fails if it stalls for this time, 0 to never fail.
+    std::chrono::seconds stall_timeout{3};
+    /// The consumer could not take the last data.
+    bool paused{false};
+
+    /// When the request was started.
+    std::chrono::steady_clock::time_point start;
+
+    /// Headers added to the request, and the list given to curl.
+    std::vector<std::string> headers;
+    curl_slist* header_list{nullptr};
+
+    /// Headers of the response, by lower case name.
+    std::map<std::string, std::string> response_headers;
+
+    /// Result of the transfer and HTTP status code, once done.
+    CURLcode result{CURLE_OK};
+    long status{0};
+    /// Number of connections opened by the transfer, once done.
+    long connects{0};
+
+    /// Path of the cached response, or empty if not cached.
+    std::string cache_path;
+    /// A cached response is being validated with the server.
+    bool validating{false};
+    /// The response is being saved to the cache.
+    std::ofstream cache_out;
+    /// The response was read from the cache.
+    bool cached{false};
+
+    /// The transfer is run by the network thread.
+    bool threaded{false};
+    /// Counts the transfers, so events of a previous one are dropped.
+    uint64_t generation{0};
+    /// Data received by the network thread and not consumed yet, with the
+    /// status code it was received with.
+    std::deque<std::pair<std::vector<unsigned char>, long>> pending;
+    /// The transfer is done once the pending data is consumed.
+    bool done_pending{false};
+
+    /// The transfer, in the network thread.
+    std::shared_ptr<HttpClientRequestData> net_self;
+    CURL* net_easy{nullptr};
+    curl_slist* net_header_list{nullptr};
+    uint64_t net_generation{0};
+    /// Bytes received by the network thread and not consumed yet.
+    std::atomic<size_t> inflight{0};
+    /// The network thread paused the transfer until they are consumed.
+    std::atomic<bool> net_paused{false};
 
-    inline void on_read(const unsigned char* data, size_t len, bool done = false)
+    /// Events of the network thread, applied in the event loop.
+    std::mutex events_mutex;
+    std::vector<std::function<void()>> events;
+
+    inline bool on_read(const unsigned char* data, size_t len, bool done = false)
     {
         EGTLOG_TRACE("http read data len {}", len);
 
         if (m_read_callback)
-            m_read_callback(data, len, done);
+            return m_read_callback(data, len, done);
+
+        return true;
+    }
+
+    /// Most bytes received by the network thread before consumed.
+    size_t max_inflight() const
+    {
+        return 4 * (buffer_size ? buffer_size : CURL_MAX_WRITE_SIZE);
+    }
+
+    /// Write data received to the cache, if needed.
+    void cache(const unsigned char* data, size_t len, long code)
+    {
+        if (!cache_path.empty() && code == 200 && cacheable(response_headers))
+        {
+            if (!cache_out.is_open())
+                cache_out.open(cache_path + ".tmp", std::ios::binary | std::ios::trunc);
+            cache_out.write(reinterpret_cast<const char*>(data), len);
+        }
+    }
+
+    void apply() override
+    {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(events_mutex);
+            ready.swap(events);
+        }
+
+        for (auto& event : ready)
+        {
+            if (!owner)
+                break;
+            event();
+        }
     }
 };
 
+/**
+ * Runs every request on one curl multi handle.
+ *
+ * Connections are owned here rather than by a request, so curl can keep them
+ * alive and reuse them for the next request to the same host, or multiplex
+ * several HTTP/2 requests on one.  Easy handles are pooled for the same reason:
+ * they keep the DNS and TLS session caches between requests.
+ *
+ * With the network thread, curl is only used there: sockets, TLS and the
+ * callbacks of curl run in its own io_context, and the data received is
+ * passed to the event loop.  Otherwise, everything runs in the event loop.
+ */
 class HttpClientRequestManager
 {
 public:
 
+    /// Default maximum number of connections to a host.
+    static constexpr long DEFAULT_MAX_HOST_CONNECTIONS = 6;
+
+    /// Maximum number of idle easy handles kept for reuse.
+    static constexpr size_t MAX_POOLED_HANDLES = 8;
+
+    /// A socket opened by curl, alive as long as its connection.
+    struct Socket
+    {
+        std::unique_ptr<asio::ip::tcp::socket> socket;
+        /// Events curl last asked to wait for.
+        int last_event{CURL_POLL_NONE};
+        /// Events being waited for.
+        int waiting{CURL_POLL_NONE};
+    };
+
     static HttpClientRequestManager* Instance()
     {
         static const std::unique_ptr<HttpClientRequestManager> i(new HttpClientRequestManager());
@@ -53,6 +225,7 @@ public:
                                void* userp,
                                void* socketp)
     {
+        detail::ignoreparam(easy);
         detail::ignoreparam(userp);
         detail::ignoreparam(socketp);
 
@@ -60,8 +233,7 @@ public:
         assert(i != HttpClientRequestManager::Instance()->m_sockets.end());
         if (i != HttpClientRequestManager::Instance()->m_sockets.end())
         {
-            auto request = i->second;
-            request->impl()->last_event = what;
+            i->second.last_event = what;
 
             if (what == CURL_POLL_REMOVE)
             {
@@ -70,28 +242,32 @@ public:
             }
 
             if (what & CURL_POLL_IN)
-            {
-                request->impl()->socket->async_wait(asio::ip::tcp::socket::wait_read,
-                                                    [easy, s, request](const asio::error_code & ec)
-                {
-                    HttpClientRequestManager::asio_socket_callback(ec, easy, s, CURL_POLL_IN, request);
-                });
-            }
+                wait(i->first, i->second, CURL_POLL_IN);
 
             if (what & CURL_POLL_OUT)
-            {
-                request->impl()->socket->async_wait(asio::ip::tcp::socket::wait_write,
-                                                    [easy, s, request](const asio::error_code & ec)
-                {
-                    HttpClientRequestManager::asio_socket_callback(ec, easy, s, CURL_POLL_OUT, request);
-                });
-            }
+                wait(i->first, i->second, CURL_POLL_OUT);
         }
 
         // must return 0
         return 0;
     }
 
+    static void wait(curl_socket_t s, Socket& socket, int what)
+    {
+        // an idle connection may be waited on across several requests
+        if (socket.waiting & what)
+            return;
+
+        socket.waiting |= what;
+        socket.socket->async_wait(what == CURL_POLL_IN ?
+                                  asio::ip::tcp::socket::wait_read :
+                                  asio::ip::tcp::socket::wait_write,
+                                  [s, what](const asio::error_code & ec)
+        {
+            HttpClientRequestManager::asio_socket_callback(ec, s, what);
+        });
+    }
+
     static int timer_callback(CURLM* multi,
                               long timeout_ms,
                               void* userp)
@@ -102,7 +278,8 @@ public:
         asio::steady_timer& timer = HttpClientRequestManager::Instance()->m_timer;
 
         timer.cancel();
-        if (timeout_ms > 0)
+        // even right away, curl must not be called back from its own callback
+        if (timeout_ms >= 0)
         {
             timer.expires_after(std::chrono::milliseconds(timeout_ms));
             timer.async_wait([](const asio::error_code & ec)
@@ -110,11 +287,6 @@ public:
                 asio_timer_callback(ec);
             });
         }
-        else if (timeout_ms == 0)
-        {
-            asio::error_code error;
-            asio_timer_callback(error);
-        }
 
         return 0;
     }
@@ -135,18 +307,20 @@ public:
     }
 
     static void asio_socket_callback(const asio::error_code& ec,
-                                     CURL* easy,
                                      curl_socket_t s,
-                                     int what,
-                                     experimental::HttpClientRequest* request)
+                                     int what)
     {
-        if (ec)
-        {
-            what = CURL_CSELECT_ERR;
-        }
-
         HttpClientRequestManager* multi = HttpClientRequestManager::Instance();
-        CURLMcode rc = curl_multi_socket_action(multi->m_multi, s, what, &multi->m_running);
+
+        auto i = multi->m_sockets.find(s);
+        if (i != multi->m_sockets.end())
+            i->second.waiting &= ~what;
+
+        // the socket was closed by curl
+        if (ec == asio::error::operation_aborted)
+            return;
+
+        CURLMcode rc = curl_multi_socket_action(multi->m_multi, s, ec ? CURL_CSELECT_ERR : what, &multi->m_running);
         if (rc != CURLM_OK)
         {
             detail::warn("curl_multi_socket_action: {}", int(rc));
@@ -155,34 +329,12 @@ public:
         check_multi_info();
 
         if (multi->m_running <= 0)
-        {
             multi->m_timer.cancel();
-            return;
-        }
 
-        if (!ec && multi->m_sockets.find(s) != multi->m_sockets.end())
-        {
-            if (!request->impl())
-                return;
-
-            if (what == CURL_POLL_IN && (request->impl()->last_event & CURL_POLL_IN))
-            {
-                request->impl()->socket->async_wait(asio::ip::tcp::socket::wait_read,
-                                                    [easy, s, request](const asio::error_code & ec)
-                {
-                    HttpClientRequestManager::asio_socket_callback(ec, easy, s, CURL_POLL_IN, request);
-                });
-            }
-
-            if (what == CURL_POLL_OUT && (request->impl()->last_event & CURL_POLL_OUT))
-            {
-                request->impl()->socket->async_wait(asio::ip::tcp::socket::wait_write,
-                                                    [easy, s, request](const asio::error_code & ec)
-                {
-                    HttpClientRequestManager::asio_socket_callback(ec, easy, s, CURL_POLL_OUT, request);
-                });
-            }
-        }
+        // the socket may have been closed meanwhile
+        i = multi->m_sockets.find(s);
+        if (!ec && i != multi->m_sockets.end() && (i->second.last_event & what))
+            wait(s, i->second, what);
     }
 
     static void check_multi_info()
@@ -198,30 +350,239 @@ public:
                 CURL* easy = msg->easy_handle;
                 if (easy)
                 {
-                    experimental::HttpClientRequest* s{nullptr};
+                    HttpClientRequestData* s{nullptr};
                     curl_easy_getinfo(easy, CURLINFO_PRIVATE, &s);
                     if (s)
-                    {
-                        s->finish();
-                    }
+                        done(s, msg->data.result);
                 }
             }
         } while (msg);
     }
 
+    /// Finish a transfer.
+    static void done(HttpClientRequestData* s, CURLcode result)
+    {
+        long status = 0;
+        long connects = 0;
+        curl_easy_getinfo(s->threaded ? s->net_easy : s->easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(s->threaded ? s->net_easy : s->easy, CURLINFO_NUM_CONNECTS, &connects);
+
+        if (!s->threaded)
+        {
+            s->result = result;
+            s->status = status;
+            s->connects = connects;
+            if (s->owner)
+                s->owner->finish();
+            return;
+        }
+
+        auto self = s->net_self;
+        retire(s);
+
+        post(s, [s, result, status, connects]()
+        {
+            // already removed, in the network thread
+            s->easy = nullptr;
+            s->header_list = nullptr;
+            s->result = result;
+            s->status = status;
+            s->connects = connects;
+
+            if (s->pending.empty())
+                s->owner->finish();
+            else
+                s->done_pending = true;
+        });
+    }
+
+    /// Remove a transfer, in the network thread.
+    static void retire(HttpClientRequestData* s)
+    {
+        auto manager = Instance();
+        curl_multi_remove_handle(manager->m_multi, s->net_easy);
+        manager->release(s->net_easy);
+        s->net_easy = nullptr;
+        if (s->net_header_list)
+        {
+            curl_slist_free_all(s->net_header_list);
+            s->net_header_list = nullptr;
+        }
+        s->net_self.reset();
+    }
+
+    /// Queue an event of a transfer, from the network thread.
+    static void post(HttpClientRequestData* s, std::function<void()> event)
+    {
+        const auto generation = s->net_generation;
+        {
+            std::lock_guard<std::mutex> lock(s->events_mutex);
+            s->events.emplace_back([s, generation, event = std::move(event)]()
+            {
+                if (s->generation == generation)
+                    event();
+            });
+        }
+        Application::instance().event().queue_update(s->shared_from_this());
+    }
+
+    /**
+     * Pass data received to the event loop, from the network thread.
+     *
+     * The transfer is paused while the event loop is behind, so the data
+     * held is bounded like without the network thread.
+     */
+    static size_t receive(HttpClientRequestData* s, const char* data, size_t len, long status)
+    {
+        if (s->inflight.load() > s->max_inflight())
+        {
+            // the event loop may have caught up meanwhile, and then it
+            // either sees the flag and resumes, or it is taken back here
+            s->net_paused.store(true);
+            if (s->inflight.load() > s->max_inflight() || !s->net_paused.exchange(false))
+                return CURL_WRITEFUNC_PAUSE;
+        }
+
+        s->inflight += len;
+        std::vector<unsigned char> chunk(data, data + len);
+        post(s, [s, chunk = std::move(chunk), status]() mutable
+        {
+            s->pending.emplace_back(std::move(chunk), status);
+            drain(s);
+        });
+        return len;
+    }
+
+    /// Pass the pending data to the callback, in the event loop.
+    static void drain(HttpClientRequestData* s)
+    {
+        const auto generation = s->generation;
+        while (!s->pending.empty() && !s->paused)
+        {
+            const auto& chunk = s->pending.front();
+            if (!s->on_read(chunk.first.data(), chunk.first.size(), false))
+            {
+                s->paused = true;
+                break;
+            }
+
+            // stopped or started again by the callback
+            if (!s->owner || s->generation != generation)
+                return;
+
+            s->cache(chunk.first.data(), chunk.first.size(), chunk.second);
+            s->inflight -= chunk.first.size();
+            s->pending.pop_front();
+
+            if (s->inflight.load() <= s->max_inflight() && s->net_paused.exchange(false))
+            {
+                asio::post(*Instance()->m_network_io, [data = s->shared_from_this(), generation]()
+                {
+                    if (data->net_easy && data->net_generation == generation)
+                        curl_easy_pause(data->net_easy, CURLPAUSE_CONT);
+                });
+            }
+        }
+
+        if (s->pending.empty() && s->done_pending)
+        {
+            s->done_pending = false;
+            s->owner->finish();
+        }
+    }
+
+    /// The io_context curl runs in.
+    asio::io_context& io()
+    {
+        return m_network_io ? *m_network_io : Application::instance().event().io();
+    }
+
+    /// Is curl run by the network thread.
+    bool threaded() const
+    {
+        return m_network_io != nullptr;
+    }
+
+    /// Get an easy handle, reused from a previous request if possible.
+    CURL* acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_handles_mutex);
+        if (!m_handles.empty())
+        {
+            auto easy = m_handles.back();
+            m_handles.pop_back();
+            // keeps the connection, DNS and TLS session caches
+            curl_easy_reset(easy);
+            return easy;
+        }
+
+        return curl_easy_init();
+    }
+
+    /// Give back an easy handle once its request is removed.
+    void release(CURL* easy)
+    {
+        std::lock_guard<std::mutex> lock(m_handles_mutex);
+        if (m_handles.size() < MAX_POOLED_HANDLES)
+            m_handles.push_back(easy);
+        else
+            curl_easy_cleanup(easy);
+    }
+
+    /// Account a finished request.
+    void record(long connects, std::chrono::steady_clock::duration time)
+    {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(time);
+
+        m_stats.requests++;
+        m_stats.connections += connects;
+        m_stats.total_time += us;
+        m_stats.max_time = std::max(m_stats.max_time, us);
+    }
+
     CURLM* m_multi{};
     int m_running{0};
+    /// io_context of the network thread, if any.
+    std::unique_ptr<asio::io_context> m_network_io;
     asio::steady_timer m_timer;
-    std::unordered_map<curl_socket_t, experimental::HttpClientRequest*> m_sockets;
+    std::unordered_map<curl_socket_t, Socket> m_sockets;
+    /// Released by the network thread, acquired by the event loop.
+    std::mutex m_handles_mutex;
+    std::vector<CURL*> m_handles;
+    experimental::HttpClientStats m_stats;
+    std::thread m_thread;
+
+    ~HttpClientRequestManager() noexcept
+    {
+        if (m_network_io)
+        {
+            m_network_io->stop();
+            m_thread.join();
+        }
+    }
 
 private:
 
     HttpClientRequestManager()
         : m_multi(curl_multi_init()),
-          m_timer(Application::instance().event().io())
+          m_network_io(http_network_thread() ? std::make_unique<asio::io_context>() : nullptr),
+          m_timer(io())
     {
         curl_multi_setopt(m_multi, CURLMOPT_SOCKETFUNCTION, HttpClientRequestManager::socket_callback);
         curl_multi_setopt(m_multi, CURLMOPT_TIMERFUNCTION, HttpClientRequestManager::timer_callback);
+#ifdef CURLPIPE_MULTIPLEX
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, DEFAULT_MAX_HOST_CONNECTIONS);
+
+        if (m_network_io)
+        {
+            m_thread = std::thread([this]()
+            {
+                auto work = asio::make_work_guard(*m_network_io);
+                m_network_io->run();
+            });
+        }
     }
 };
 
@@ -235,53 +596,154 @@ static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdat
     const auto written = size * nmemb;
     auto s = static_cast<detail::HttpClientRequestData*>(userdata);
     if (s)
-        s->on_read(reinterpret_cast<const unsigned char*>(ptr), written, false);
+    {
+        long status = 0;
+        curl_easy_getinfo(s->threaded ? s->net_easy : s->easy, CURLINFO_RESPONSE_CODE, &status);
+
+        // not modified, the cached response is read once done
+        if (s->validating && status == 304)
+            return written;
+
+        if (s->threaded)
+            return detail::HttpClientRequestManager::receive(s, ptr, written, status);
+
+        // curl keeps the data, and passes it again once resumed
+        if (!s->on_read(reinterpret_cast<const unsigned char*>(ptr), written, false))
+        {
+            s->paused = true;
+            return CURL_WRITEFUNC_PAUSE;
+        }
+
+        s->cache(reinterpret_cast<const unsigned char*>(ptr), written, status);
+    }
     return written;
 }
 
-static curl_socket_t opensocket_callback(void* clientp,
-        curlsocktype purpose,
-        struct curl_sockaddr* address)
+static void header_line(detail::HttpClientRequestData* s, const std::string& line)
 {
-    curl_socket_t ret = CURL_SOCKET_BAD;
+    // each response followed, like redirects, starts with its status line
+    if (line.compare(0, 5, "HTTP/") == 0)
+    {
+        s->response_headers.clear();
+        const auto code = line.find(' ');
+        if (code != std::string::npos)
+            s->status = std::strtol(line.c_str() + code + 1, nullptr, 10);
+        return;
+    }
+
+    const auto colon = line.find(':');
+    if (colon != std::string::npos)
+    {
+        auto name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+
+        const auto begin = line.find_first_not_of(" \t", colon + 1);
+        const auto end = line.find_last_not_of(" \t\r\n");
+        s->response_headers[name] =
+            (begin == std::string::npos || end < begin) ? "" : line.substr(begin, end - begin + 1);
+    }
+}
 
-    auto s = static_cast<experimental::HttpClientRequest*>(clientp);
+static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+    const auto len = size * nitems;
+    auto s = static_cast<detail::HttpClientRequestData*>(userdata);
     if (s)
     {
-        if (purpose == CURLSOCKTYPE_IPCXN && address->family == AF_INET)
-        {
-            s->impl()->socket = std::make_unique<asio::ip::tcp::socket>(Application::instance().event().io());
+        std::string line(buffer, len);
 
-            asio::error_code ec;
-            s->impl()->socket->open(asio::ip::tcp::v4(), ec);
-            if (ec)
-            {
-                throw std::runtime_error("failed to open socket");
-            }
-            else
+        if (s->threaded)
+        {
+            detail::HttpClientRequestManager::post(s, [s, line]()
             {
-                ret = s->impl()->socket->native_handle();
-                detail::HttpClientRequestManager::Instance()->m_sockets.insert(std::make_pair(ret, s));
-            }
+                header_line(s, line);
+            });
         }
         else
         {
-            throw std::runtime_error("unsupported socket type");
+            header_line(s, line);
         }
     }
+    return len;
+}
+
+/// Load the validators of a cached response, saved by save_cache_meta().
+static std::map<std::string, std::string> load_cache_meta(const std::string& path)
+{
+    std::map<std::string, std::string> meta;
+
+    std::ifstream in(path + ".meta");
+    std::string name;
+    std::string value;
+    while (in >> name && std::getline(in >> std::ws, value))
+        meta[name] = value;
+
+    return meta;
+}
+
+/// Save the validators of a cached response, one header per line.
+static bool save_cache_meta(const std::string& path, const std::map<std::string, std::string>& headers)
+{
+    // written aside and renamed, so other processes never read a partial file
+    const auto tmp = path + ".meta.tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        for (const auto& name : {"etag", "last-modified"})
+        {
+            const auto i = headers.find(name);
+            if (i != headers.end() && !i->second.empty())
+                out << name << " " << i->second << "\n";
+        }
 
+        if (!out)
+            return false;
+    }
+
+    return !std::rename(tmp.c_str(), (path + ".meta").c_str());
+}
+
+static curl_socket_t opensocket_callback(void* clientp,
+        curlsocktype purpose,
+        struct curl_sockaddr* address)
+{
+    detail::ignoreparam(clientp);
+
+    if (purpose != CURLSOCKTYPE_IPCXN ||
+        (address->family != AF_INET && address->family != AF_INET6))
+    {
+        detail::warn("unsupported socket type");
+        return CURL_SOCKET_BAD;
+    }
+
+    auto socket = std::make_unique<asio::ip::tcp::socket>(detail::HttpClientRequestManager::Instance()->io());
+
+    asio::error_code ec;
+    socket->open(address->family == AF_INET ? asio::ip::tcp::v4() : asio::ip::tcp::v6(), ec);
+    if (ec)
+    {
+        detail::warn("failed to open socket: {}", ec.message());
+        return CURL_SOCKET_BAD;
+    }
+
+    const auto ret = socket->native_handle();
+    detail::HttpClientRequestManager::Socket item;
+    item.socket = std::move(socket);
+    detail::HttpClientRequestManager::Instance()->m_sockets[ret] = std::move(item);
     return ret;
 }
 
 static int closesocket_callback(void* clientp, curl_socket_t item)
 {
-    auto s = static_cast<experimental::HttpClientRequest*>(clientp);
-    if (s)
+    detail::ignoreparam(clientp);
+
+    auto& sockets = detail::HttpClientRequestManager::Instance()->m_sockets;
+    auto i = sockets.find(item);
+    if (i != sockets.end())
     {
         asio::error_code ec;
-        if (s->impl()->socket)
-            s->impl()->socket->close(ec);
-        detail::HttpClientRequestManager::Instance()->m_sockets.erase(item);
+        i->second.socket->close(ec);
+        sockets.erase(i);
         return ec ? ec.value() : 0;
     }
 
@@ -289,40 +751,247 @@ static int closesocket_callback(void* clientp, curl_socket_t item)
 }
 
 HttpClientRequest::HttpClientRequest() noexcept
-    : m_impl(std::make_unique<detail::HttpClientRequestData>())
-{}
+    : m_impl(std::make_shared<detail::HttpClientRequestData>())
+{
+    m_impl->owner = this;
+}
+
+void HttpClientRequest::cache_dir(const std::string& dir)
+{
+    detail::http_cache_dir() = dir;
+}
+
+std::string HttpClientRequest::cache_dir()
+{
+    return detail::http_cache_dir();
+}
+
+void HttpClientRequest::network_thread(bool enable)
+{
+    detail::http_network_thread() = enable;
+}
+
+bool HttpClientRequest::network_thread()
+{
+    return detail::http_network_thread();
+}
+
+void HttpClientRequest::max_host_connections(long max)
+{
+    auto manager = detail::HttpClientRequestManager::Instance();
+    asio::post(manager->io(), [manager, max]()
+    {
+        curl_multi_setopt(manager->m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, max);
+    });
+}
+
+HttpClientStats HttpClientRequest::stats()
+{
+    return detail::HttpClientRequestManager::Instance()->m_stats;
+}
+
+void HttpClientRequest::header(const std::string& name, const std::string& value)
+{
+    m_impl->headers.push_back(name + ": " + value);
+}
+
+long HttpClientRequest::status() const
+{
+    return m_impl->status;
+}
+
+std::string HttpClientRequest::response_header(const std::string& name) const
+{
+    auto key = name;
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    const auto i = m_impl->response_headers.find(key);
+    if (i != m_impl->response_headers.end())
+        return i->second;
+
+    return {};
+}
+
+bool HttpClientRequest::ok() const
+{
+    return m_impl->result == CURLE_OK && m_impl->status < 400;
+}
+
+bool HttpClientRequest::cached() const
+{
+    return m_impl->cached;
+}
+
+void HttpClientRequest::buffer_size(size_t size)
+{
+    m_impl->buffer_size = size;
+}
+
+void HttpClientRequest::stall_timeout(std::chrono::seconds timeout)
+{
+    m_impl->stall_timeout = timeout;
+}
+
+void HttpClientRequest::resume()
+{
+    if (!m_impl->paused)
+        return;
+
+    m_impl->paused = false;
+    if (m_impl->threaded)
+        detail::HttpClientRequestManager::drain(m_impl.get());
+    else if (m_impl->easy)
+        curl_easy_pause(m_impl->easy, CURLPAUSE_CONT);
+}
+
+bool HttpClientRequest::paused() const
+{
+    return m_impl->paused;
+}
 
 void HttpClientRequest::start_async(const std::string& url, ReadCallback callback)
+{
+    start_stream(url, [callback](const unsigned char* data, size_t len, bool done)
+    {
+        if (callback)
+            callback(data, len, done);
+        return true;
+    });
+}
+
+void HttpClientRequest::start_stream(const std::string& url, StreamCallback callback)
 {
     cleanup();
 
     m_impl->url = url;
     m_impl->m_read_callback = std::move(callback);
-    m_impl->easy = curl_easy_init();
+    m_impl->paused = false;
+    m_impl->response_headers.clear();
+    m_impl->result = CURLE_OK;
+    m_impl->status = 0;
+    m_impl->cache_path.clear();
+    m_impl->validating = false;
+    m_impl->cached = false;
+    m_impl->connects = 0;
+    m_impl->start = std::chrono::steady_clock::now();
+    m_impl->threaded = detail::HttpClientRequestManager::Instance()->threaded();
+    m_impl->easy = detail::HttpClientRequestManager::Instance()->acquire();
 
     if (!m_impl->easy)
         throw std::runtime_error("curl_easy_init failed");
 
+    auto headers = m_impl->headers;
+
+    const auto& dir = detail::http_cache_dir();
+    if (!dir.empty() && detail::exists(dir))
+    {
+        m_impl->cache_path = fmt::format("{}/{:016x}", dir, std::hash<std::string>()(url));
+
+        // ask the server if the cached response was modified
+        if (detail::exists(m_impl->cache_path))
+        {
+            const auto meta = load_cache_meta(m_impl->cache_path);
+            const auto etag = meta.find("etag");
+            if (etag != meta.end())
+                headers.push_back("If-None-Match: " + etag->second);
+            const auto modified = meta.find("last-modified");
+            if (modified != meta.end())
+                headers.push_back("If-Modified-Since: " + modified->second);
+            m_impl->validating = !meta.empty();
+        }
+    }
+
+    for (const auto& header : headers)
+        m_impl->header_list = curl_slist_append(m_impl->header_list, header.c_str());
+    if (m_impl->header_list)
+        curl_easy_setopt(m_impl->easy, CURLOPT_HTTPHEADER, m_impl->header_list);
+
     curl_easy_setopt(m_impl->easy, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(m_impl->easy, CURLOPT_URL, m_impl->url.c_str());
     curl_easy_setopt(m_impl->easy, CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(m_impl->easy, CURLOPT_WRITEDATA, m_impl.get());
+    curl_easy_setopt(m_impl->easy, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(m_impl->easy, CURLOPT_HEADERDATA, m_impl.get());
     //curl_easy_setopt(m_impl->easy, CURLOPT_VERBOSE, 1L);
-    curl_easy_setopt(m_impl->easy, CURLOPT_PRIVATE, this);
+    curl_easy_setopt(m_impl->easy, CURLOPT_PRIVATE, m_impl.get());
     curl_easy_setopt(m_impl->easy, CURLOPT_NOPROGRESS, 1L);
-    curl_easy_setopt(m_impl->easy, CURLOPT_LOW_SPEED_TIME, 3L);
-    curl_easy_setopt(m_impl->easy, CURLOPT_LOW_SPEED_LIMIT, 10L);
+    if (m_impl->stall_timeout.count() > 0)
+    {
+        curl_easy_setopt(m_impl->easy, CURLOPT_LOW_SPEED_TIME,
+                         static_cast<long>(m_impl->stall_timeout.count()));
+        curl_easy_setopt(m_impl->easy, CURLOPT_LOW_SPEED_LIMIT, 10L);
+    }
     curl_easy_setopt(m_impl->easy, CURLOPT_OPENSOCKETFUNCTION, opensocket_callback);
-    curl_easy_setopt(m_impl->easy, CURLOPT_OPENSOCKETDATA, this);
     curl_easy_setopt(m_impl->easy, CURLOPT_CLOSESOCKETFUNCTION, closesocket_callback);
-    curl_easy_setopt(m_impl->easy, CURLOPT_CLOSESOCKETDATA, this);
     curl_easy_setopt(m_impl->easy, CURLOPT_CONNECTTIMEOUT, 10);
     curl_easy_setopt(m_impl->easy, CURLOPT_NOSIGNAL, 1);
-    curl_multi_add_handle(detail::HttpClientRequestManager::Instance()->m_multi, m_impl->easy);
+    curl_easy_setopt(m_impl->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (m_impl->buffer_size)
+        curl_easy_setopt(m_impl->easy, CURLOPT_BUFFERSIZE, static_cast<long>(m_impl->buffer_size));
+#ifdef CURLPIPE_MULTIPLEX
+    // negotiate HTTP/2 over TLS, and wait for a connection to multiplex on
+    // rather than opening another one
+    curl_easy_setopt(m_impl->easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(m_impl->easy, CURLOPT_PIPEWAIT, 1L);
+#endif
+
+    auto manager = detail::HttpClientRequestManager::Instance();
+    if (m_impl->threaded)
+    {
+        // the handles are owned by the network thread until removed
+        asio::post(manager->io(), [manager, data = m_impl, easy = m_impl->easy,
+                                   list = m_impl->header_list, generation = m_impl->generation]()
+        {
+            data->net_self = data;
+            data->net_easy = easy;
+            data->net_header_list = list;
+            data->net_generation = generation;
+            data->inflight = 0;
+            data->net_paused = false;
+            curl_multi_add_handle(manager->m_multi, easy);
+        });
+    }
+    else
+    {
+        curl_multi_add_handle(manager->m_multi, m_impl->easy);
+    }
 }
 
 void HttpClientRequest::finish()
 {
+    detail::HttpClientRequestManager::Instance()->record(m_impl->connects,
+            std::chrono::steady_clock::now() - m_impl->start);
+
+    if (m_impl->cache_out.is_open())
+    {
+        m_impl->cache_out.close();
+
+        // without a validator, the response could never be used
+        const auto& headers = m_impl->response_headers;
+        const auto validator = headers.count("etag") || headers.count("last-modified");
+
+        const auto tmp = m_impl->cache_path + ".tmp";
+        if (m_impl->result == CURLE_OK && m_impl->cache_out && validator &&
+            save_cache_meta(m_impl->cache_path, headers))
+        {
+            if (std::rename(tmp.c_str(), m_impl->cache_path.c_str()))
+                detail::warn("unable to save http cache {}", m_impl->cache_path);
+        }
+        else
+        {
+            std::remove(tmp.c_str());
+        }
+    }
+    else if (m_impl->result == CURLE_OK && m_impl->validating && m_impl->status == 304)
+    {
+        std::ifstream in(m_impl->cache_path, std::ios::binary);
+        char buffer[8 * 1024];
+        while (in.read(buffer, sizeof(buffer)) || in.gcount())
+            m_impl->on_read(reinterpret_cast<const unsigned char*>(buffer), in.gcount(), false);
+        m_impl->cached = true;
+    }
+
     m_impl->on_read(nullptr, 0, true);
     cleanup();
 }
@@ -335,26 +1004,107 @@ void HttpClientRequest::finish()
 //    function.
 void HttpClientRequest::cleanup()
 {
-    if (m_impl->socket)
-    {
-        detail::HttpClientRequestManager::Instance()->m_sockets.erase(m_impl->socket->native_handle());
-        m_impl->socket.reset();
-    }
+    if (!m_impl)
+        return;
+
+    // events of the network thread for this transfer are dropped
+    m_impl->generation++;
+    m_impl->pending.clear();
+    m_impl->done_pending = false;
 
+    // the connection is left to curl, to be reused by another request
     if (m_impl->easy)
     {
-        curl_multi_remove_handle(detail::HttpClientRequestManager::Instance()->m_multi, m_impl->easy);
-        curl_easy_cleanup(m_impl->easy);
+        auto manager = detail::HttpClientRequestManager::Instance();
+        if (m_impl->threaded)
+        {
+            // unless the network thread is done with it already
+            asio::post(manager->io(), [data = m_impl, easy = m_impl->easy]()
+            {
+                if (data->net_easy == easy)
+                    detail::HttpClientRequestManager::retire(data.get());
+            });
+            m_impl->header_list = nullptr;
+        }
+        else
+        {
+            curl_multi_remove_handle(manager->m_multi, m_impl->easy);
+            manager->release(m_impl->easy);
+        }
         m_impl->easy = nullptr;
     }
+
+    if (m_impl->header_list)
+    {
+        curl_slist_free_all(m_impl->header_list);
+        m_impl->header_list = nullptr;
+    }
+
+    if (m_impl->cache_out.is_open())
+    {
+        m_impl->cache_out.close();
+        std::remove((m_impl->cache_path + ".tmp").c_str());
+    }
 }
 
-HttpClientRequest::HttpClientRequest(HttpClientRequest&&) noexcept = default;
-HttpClientRequest& HttpClientRequest::operator=(HttpClientRequest&&) noexcept = default;
+HttpClientRequest::HttpClientRequest(HttpClientRequest&& rhs) noexcept
+    : m_impl(std::move(rhs.m_impl))
+{
+    if (m_impl)
+        m_impl->owner = this;
+}
+
+HttpClientRequest& HttpClientRequest::operator=(HttpClientRequest&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        cleanup();
+        if (m_impl)
+            m_impl->owner = nullptr;
+        m_impl = std::move(rhs.m_impl);
+        if (m_impl)
+            m_impl->owner = this;
+    }
+    return *this;
+}
 
 HttpClientRequest::~HttpClientRequest() noexcept
 {
     cleanup();
+    if (m_impl)
+        m_impl->owner = nullptr;
+}
+
+bool save_file_from_network(const std::string& url, const std::string& path)
+{
+    // written aside and renamed, so a failed download leaves nothing behind
+    const auto tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    bool finished = false;
+    HttpClientRequest request;
+    request.start_async(url, [&out, &finished](const unsigned char* data, size_t len, bool done)
+    {
+        if (data && len)
+            out.write(reinterpret_cast<const char*>(data), len);
+
+        if (done)
+            finished = true;
+    });
+
+    while (!finished)
+        Application::instance().event().step();
+
+    out.close();
+    if (!request.ok() || !out || std::rename(tmp.c_str(), path.c_str()))
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
 }
 
 }
@@ -0,0 +1,1121 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/egtlog.h"
+#include "egt/app.h"
+#include "egt/asio.hpp"
+#include "egt/eventloop.h"
+#include "egt/input.h"
+#include "egt/keycode.h"
+#include "egt/network/rfb.h"
+#include "egt/screen.h"
+#include <algorithm>
+#include <array>
+#include <cairo.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+using asio::ip::tcp;
+
+/// Input dispatching the pointer and key events of the clients.
+struct RfbInput : public Input
+{
+    using Input::dispatch;
+};
+
+/// Pixel format of the RFB protocol.
+struct RfbPixelFormat
+{
+    uint8_t bpp{32};
+    uint8_t depth{24};
+    bool big_endian{false};
+    bool true_color{true};
+    uint16_t red_max{255};
+    uint16_t green_max{255};
+    uint16_t blue_max{255};
+    uint8_t red_shift{16};
+    uint8_t green_shift{8};
+    uint8_t blue_shift{0};
+};
+
+static const int32_t RFB_ENCODING_RAW = 0;
+static const int32_t RFB_ENCODING_ZRLE = 16;
+
+/// Width and height of the tiles of ZRLE.
+static const int ZRLE_TILE = 64;
+
+static inline void put8(std::vector<uint8_t>& out, uint8_t value)
+{
+    out.push_back(value);
+}
+
+static inline void put16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static inline void put32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static inline uint16_t get16(const uint8_t* p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/// Write the low bytes of a pixel, in the byte order of the client.
+static inline void put_pixel(std::vector<uint8_t>& out, uint32_t pixel,
+                             size_t bytes, bool big_endian)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        out.push_back(pixel >> (8 * (big_endian ? bytes - 1 - i : i)));
+}
+
+/// Get a pixel of an image surface row as ARGB8888.
+static inline uint32_t source_pixel(const uint8_t* row, int x, cairo_format_t format)
+{
+    if (format == CAIRO_FORMAT_RGB16_565)
+    {
+        const uint32_t p = reinterpret_cast<const uint16_t*>(row)[x];
+        const auto r = (p >> 11) & 0x1f;
+        const auto g = (p >> 5) & 0x3f;
+        const auto b = p & 0x1f;
+        return 0xff000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+    }
+
+    return reinterpret_cast<const uint32_t*>(row)[x];
+}
+
+static inline uint32_t client_pixel(const RfbPixelFormat& format, uint32_t argb)
+{
+    const auto scale = [](uint32_t value, uint32_t max)
+    {
+        return (value * max + 127) / 255;
+    };
+
+    return (scale((argb >> 16) & 0xff, format.red_max) << format.red_shift) |
+           (scale((argb >> 8) & 0xff, format.green_max) << format.green_shift) |
+           (scale(argb & 0xff, format.blue_max) << format.blue_shift);
+}
+
+/// Bytes used to encode a run length in ZRLE.
+static inline size_t run_bytes(size_t length)
+{
+    return (length - 1) / 255 + 1;
+}
+
+static inline void put_run(std::vector<uint8_t>& out, size_t length)
+{
+    length -= 1;
+    while (length >= 255)
+    {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(length);
+}
+
+/// Get a key of the event loop from an X keysym, as sent by the clients.
+static Key keysym_to_key(uint32_t keysym)
+{
+    if (keysym >= 'a' && keysym <= 'z')
+        return Key(static_cast<KeyboardCode>(EKEY_A + keysym - 'a'), keysym);
+    if (keysym >= 'A' && keysym <= 'Z')
+        return Key(static_cast<KeyboardCode>(EKEY_A + keysym - 'A'), keysym);
+    if (keysym >= '0' && keysym <= '9')
+        return Key(static_cast<KeyboardCode>(EKEY_0 + keysym - '0'), keysym);
+    if (keysym == ' ')
+        return Key(EKEY_SPACE, keysym);
+    // latin-1 keysyms are their unicode code point
+    if ((keysym > 0x20 && keysym < 0x7f) || (keysym >= 0xa0 && keysym <= 0xff))
+        return Key(EKEY_UNKNOWN, keysym);
+    // and so are the unicode keysyms, with a flag
+    if ((keysym & 0xff000000) == 0x01000000)
+        return Key(EKEY_UNKNOWN, keysym & 0x00ffffff);
+    if (keysym >= 0xffbe && keysym <= 0xffd5)
+        return Key(static_cast<KeyboardCode>(EKEY_F1 + keysym - 0xffbe));
+
+    static const std::pair<uint32_t, KeyboardCode> keys[] =
+    {
+        {0xff08, EKEY_BACKSPACE},
+        {0xff09, EKEY_TAB},
+        {0xff0d, EKEY_ENTER},
+        {0xff13, EKEY_PAUSE},
+        {0xff1b, EKEY_ESCAPE},
+        {0xff50, EKEY_HOME},
+        {0xff51, EKEY_LEFT},
+        {0xff52, EKEY_UP},
+        {0xff53, EKEY_RIGHT},
+        {0xff54, EKEY_DOWN},
+        {0xff55, EKEY_PAGEUP},
+        {0xff56, EKEY_PAGEDOWN},
+        {0xff57, EKEY_END},
+        {0xff61, EKEY_PRINT},
+        {0xff63, EKEY_INSERT},
+        {0xff8d, EKEY_KPENTER},
+        {0xffe1, EKEY_LSHIFT},
+        {0xffe2, EKEY_RSHIFT},
+        {0xffe3, EKEY_LCONTROL},
+        {0xffe4, EKEY_RCONTROL},
+        {0xffe5, EKEY_CAPSLOCK},
+        {0xffe9, EKEY_LEFTALT},
+        {0xffea, EKEY_RIGHTALT},
+        {0xffff, EKEY_DELETE},
+    };
+
+    for (const auto& k : keys)
+        if (k.first == keysym)
+            return Key(k.second);
+
+    return Key(EKEY_UNKNOWN);
+}
+
+struct RfbServerImpl;
+
+/// Connection of a client, only used in the thread of the server.
+class RfbClient : public std::enable_shared_from_this<RfbClient>
+{
+public:
+
+    RfbClient(RfbServerImpl& server, tcp::socket socket)
+        : m_server(server),
+          m_socket(std::move(socket))
+    {}
+
+    RfbClient(const RfbClient&) = delete;
+    RfbClient& operator=(const RfbClient&) = delete;
+
+    void start();
+
+    /// Add the damage of frames, which are sent with the next update.
+    void damage(const Screen::DamageArray& damage, size_t frames);
+
+    /// Send an update, if the client asked for one and it is not busy.
+    void update();
+
+    void close();
+
+    ~RfbClient() noexcept;
+
+private:
+
+    /// Write data, then continue with next.
+    void send(std::vector<uint8_t> data, std::function<void()> next);
+
+    /// Read size bytes into m_in, then continue with next.
+    void receive(size_t size, std::function<void()> next);
+
+    void read_version();
+    void read_security();
+    void read_client_init();
+    void read_message();
+    void pixel_format(const uint8_t* data);
+    void pointer_event(uint8_t mask, const DisplayPoint& point);
+
+    void encode_raw(const Rect& rect, const uint8_t* data, size_t stride,
+                    cairo_format_t format, std::vector<uint8_t>& out);
+    void encode_zrle(const Rect& rect, const uint8_t* data, size_t stride,
+                     cairo_format_t format, std::vector<uint8_t>& out);
+    void encode_tile(const std::vector<uint32_t>& tile, int width, int height,
+                     std::vector<uint8_t>& out);
+    void compress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out);
+
+    /// Follow the bandwidth of the connection with the compression level.
+    void bandwidth(size_t bytes, std::chrono::steady_clock::duration elapsed);
+
+    RfbServerImpl& m_server;
+    tcp::socket m_socket;
+    std::array<uint8_t, 64> m_in{};
+    std::vector<uint8_t> m_data;
+    unsigned m_minor{8};
+
+    RfbPixelFormat m_format;
+    size_t m_pixel_bytes{4};
+    size_t m_cpixel_bytes{3};
+    unsigned m_cpixel_shift{0};
+    bool m_zrle{false};
+
+    bool m_ready{false};
+    bool m_requested{false};
+    bool m_writing{false};
+    Screen::DamageArray m_damage;
+    std::vector<uint8_t> m_out;
+    std::chrono::steady_clock::time_point m_write_start;
+
+    /// Bytes per second, averaged.
+    double m_rate{0};
+    uint8_t m_buttons{0};
+    DisplayPoint m_point;
+
+#ifdef HAVE_ZLIB
+    std::unique_ptr<z_stream> m_zstream;
+    int m_level{1};
+    int m_applied_level{1};
+#endif
+};
+
+struct RfbServerImpl
+{
+    RfbServerImpl(Screen& s, uint16_t port)
+        : screen(s),
+          size(s.size()),
+          rotation(s.rotation()),
+          acceptor(io, tcp::endpoint(tcp::v4(), port)),
+          input(std::make_shared<RfbInput>())
+    {}
+
+    /// Take the damage shared by the event loop, and update the clients.
+    void take()
+    {
+        Screen::DamageArray d;
+        size_t n;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::swap(d, damage);
+            n = frames;
+            frames = 0;
+            posted = false;
+            frame = surface;
+        }
+
+        for (auto& client : clients)
+            client->damage(d, n);
+    }
+
+    void accept()
+    {
+        acceptor.async_accept([this](const asio::error_code & error, tcp::socket socket)
+        {
+            if (error)
+            {
+                if (error != asio::error::operation_aborted)
+                    detail::warn("rfb: accept: {}", error.message());
+                return;
+            }
+
+            asio::error_code ec;
+            socket.set_option(tcp::no_delay(true), ec);
+            EGTLOG_DEBUG("rfb: client {}", socket.remote_endpoint(ec).address().to_string());
+
+            auto client = std::make_shared<RfbClient>(*this, std::move(socket));
+            clients.push_back(client);
+            client->start();
+            accept();
+        });
+    }
+
+    void remove(RfbClient* client)
+    {
+        clients.remove_if([client](const std::shared_ptr<RfbClient>& c)
+        {
+            return c.get() == client;
+        });
+    }
+
+    /// Dispatch an event of a client in the event loop.
+    void dispatch(Event event)
+    {
+        std::weak_ptr<RfbInput> weak = input;
+        asio::post(Application::instance().event().io(), [weak, event]() mutable
+        {
+            if (auto i = weak.lock())
+                i->dispatch(event);
+        });
+    }
+
+    /// Map a point of the screen to the display, which Input::dispatch() rotates.
+    DisplayPoint display_point(const DisplayPoint& point) const
+    {
+        const auto w = size.width();
+        const auto h = size.height();
+
+        switch (rotation)
+        {
+        case 90:
+            return {h - 1 - point.y(), point.x()};
+        case 180:
+            return {w - 1 - point.x(), h - 1 - point.y()};
+        case 270:
+            return {point.y(), w - 1 - point.x()};
+        default:
+            break;
+        }
+
+        return point;
+    }
+
+    Screen& screen;
+    const Size size;
+    const uint32_t rotation;
+    asio::io_context io;
+    tcp::acceptor acceptor;
+    std::thread thread;
+    std::shared_ptr<RfbInput> input;
+    Signal<const Screen::DamageArray&>::RegisterHandle damage_handle{0};
+
+    /// Shared with the event loop.
+    std::mutex lock;
+    Screen::DamageArray damage;
+    shared_cairo_surface_t surface;
+    size_t frames{0};
+    bool posted{false};
+
+    /// Surface holding the last frame, in the thread of the server.
+    shared_cairo_surface_t frame;
+    std::list<std::shared_ptr<RfbClient>> clients;
+
+    mutable std::mutex stats_lock;
+    experimental::RfbStats stats;
+};
+
+void RfbClient::start()
+{
+#ifdef HAVE_ZLIB
+    m_zstream = std::make_unique<z_stream>();
+    if (deflateInit(m_zstream.get(), m_level) != Z_OK)
+        m_zstream.reset();
+#endif
+
+    {
+        std::lock_guard<std::mutex> guard(m_server.stats_lock);
+        m_server.stats.clients++;
+    }
+
+    static const char version[] = "RFB 003.008\n";
+    send(std::vector<uint8_t>(version, version + 12), [this]() { read_version(); });
+}
+
+void RfbClient::send(std::vector<uint8_t> data, std::function<void()> next)
+{
+    auto buffer = std::make_shared<std::vector<uint8_t>>(std::move(data));
+    auto self = shared_from_this();
+    asio::async_write(m_socket, asio::buffer(*buffer),
+                      [self, buffer, next](const asio::error_code & error, std::size_t)
+    {
+        if (error)
+            self->close();
+        else if (next)
+            next();
+    });
+}
+
+void RfbClient::receive(size_t size, std::function<void()> next)
+{
+    if (size > m_in.size())
+        m_data.resize(size);
+
+    auto self = shared_from_this();
+    auto buffer = size <= m_in.size() ? asio::buffer(m_in.data(), size) : asio::buffer(m_data);
+    asio::async_read(m_socket, buffer,
+                     [self, next](const asio::error_code & error, std::size_t)
+    {
+        if (error)
+            self->close();
+        else
+            next();
+    });
+}
+
+void RfbClient::read_version()
+{
+    receive(12, [this]()
+    {
+        const auto minor = (m_in[8] - '0') * 100 + (m_in[9] - '0') * 10 + (m_in[10] - '0');
+        if (std::memcmp(m_in.data(), "RFB 003.", 8) || minor < 3)
+        {
+            close();
+            return;
+        }
+
+        m_minor = std::min(minor, 8);
+
+        // there is no authentication
+        if (m_minor < 7)
+        {
+            std::vector<uint8_t> security;
+            put32(security, 1);
+            send(std::move(security), [this]() { read_client_init(); });
+        }
+        else
+        {
+            send({1, 1}, [this]() { read_security(); });
+        }
+    });
+}
+
+void RfbClient::read_security()
+{
+    receive(1, [this]()
+    {
+        if (m_in[0] != 1)
+        {
+            close();
+            return;
+        }
+
+        if (m_minor >= 8)
+        {
+            std::vector<uint8_t> result;
+            put32(result, 0);
+            send(std::move(result), [this]() { read_client_init(); });
+        }
+        else
+        {
+            read_client_init();
+        }
+    });
+}
+
+void RfbClient::read_client_init()
+{
+    receive(1, [this]()
+    {
+        static const char name[] = "EGT";
+
+        std::vector<uint8_t> init;
+        put16(init, m_server.size.width());
+        put16(init, m_server.size.height());
+        put8(init, m_format.bpp);
+        put8(init, m_format.depth);
+        put8(init, m_format.big_endian);
+        put8(init, m_format.true_color);
+        put16(init, m_format.red_max);
+        put16(init, m_format.green_max);
+        put16(init, m_format.blue_max);
+        put8(init, m_format.red_shift);
+        put8(init, m_format.green_shift);
+        put8(init, m_format.blue_shift);
+        init.insert(init.end(), 3, 0);
+        put32(init, sizeof(name) - 1);
+        init.insert(init.end(), name, name + sizeof(name) - 1);
+
+        send(std::move(init), [this]()
+        {
+            m_ready = true;
+            read_message();
+        });
+    });
+}
+
+void RfbClient::read_message()
+{
+    receive(1, [this]()
+    {
+        switch (m_in[0])
+        {
+        case 0: // SetPixelFormat
+            receive(19, [this]()
+            {
+                pixel_format(m_in.data() + 3);
+                read_message();
+            });
+            break;
+        case 2: // SetEncodings
+            receive(3, [this]()
+            {
+                const auto count = get16(m_in.data() + 1);
+                receive(count * 4, [this, count]()
+                {
+                    const auto data = count * 4 <= m_in.size() ? m_in.data() : m_data.data();
+                    m_zrle = false;
+#ifdef HAVE_ZLIB
+                    for (auto i = 0; i < count; ++i)
+                        if (static_cast<int32_t>(get32(data + i * 4)) == RFB_ENCODING_ZRLE)
+                            m_zrle = m_zstream != nullptr;
+#else
+                    detail::ignoreparam(data);
+#endif
+                    read_message();
+                });
+            });
+            break;
+        case 3: // FramebufferUpdateRequest
+            receive(9, [this]()
+            {
+                if (!m_in[0])
+                {
+                    // the client does not have the content of the area
+                    const Rect rect(get16(m_in.data() + 1), get16(m_in.data() + 3),
+                                    get16(m_in.data() + 5), get16(m_in.data() + 7));
+                    Screen::damage_algorithm(m_damage,
+                                             Rect::intersection(rect, Rect(Point(), m_server.size)));
+                }
+                m_requested = true;
+                update();
+                read_message();
+            });
+            break;
+        case 4: // KeyEvent
+            receive(7, [this]()
+            {
+                const auto key = keysym_to_key(get32(m_in.data() + 3));
+                if (key.keycode != EKEY_UNKNOWN || key.unicode)
+                    m_server.dispatch(Event(m_in[0] ? EventId::keyboard_down : EventId::keyboard_up, key));
+                read_message();
+            });
+            break;
+        case 5: // PointerEvent
+            receive(5, [this]()
+            {
+                pointer_event(m_in[0], DisplayPoint(get16(m_in.data() + 1), get16(m_in.data() + 3)));
+                read_message();
+            });
+            break;
+        case 6: // ClientCutText, ignored
+            receive(7, [this]()
+            {
+                const auto length = get32(m_in.data() + 3);
+                if (length > 1024 * 1024)
+                {
+                    close();
+                    return;
+                }
+                receive(length, [this]() { read_message(); });
+            });
+            break;
+        default:
+            detail::warn("rfb: unsupported client message {}", m_in[0]);
+            close();
+            break;
+        }
+    });
+}
+
+void RfbClient::pixel_format(const uint8_t* data)
+{
+    RfbPixelFormat format;
+    format.bpp = data[0];
+    format.depth = data[1];
+    format.big_endian = data[2];
+    format.true_color = data[3];
+    format.red_max = get16(data + 4);
+    format.green_max = get16(data + 6);
+    format.blue_max = get16(data + 8);
+    format.red_shift = data[10];
+    format.green_shift = data[11];
+    format.blue_shift = data[12];
+
+    if (!format.true_color || (format.bpp != 8 && format.bpp != 16 && format.bpp != 32))
+    {
+        detail::warn("rfb: unsupported pixel format");
+        close();
+        return;
+    }
+
+    m_format = format;
+    m_pixel_bytes = format.bpp / 8;
+    m_cpixel_bytes = m_pixel_bytes;
+    m_cpixel_shift = 0;
+
+    // ZRLE drops the unused byte of 32 bit pixels
+    if (format.bpp == 32 && format.depth <= 24)
+    {
+        const auto mask = client_pixel(format, 0xffffffff);
+        if (!(mask & 0xff000000))
+            m_cpixel_bytes = 3;
+        else if (!(mask & 0x000000ff))
+        {
+            m_cpixel_bytes = 3;
+            m_cpixel_shift = 8;
+        }
+    }
+}
+
+void RfbClient::pointer_event(uint8_t mask, const DisplayPoint& point)
+{
+    const auto display = m_server.display_point(point);
+
+    if (point != m_point)
+    {
+        m_point = point;
+        m_server.dispatch(Event(EventId::raw_pointer_move, Pointer(display)));
+    }
+
+    static const std::pair<uint8_t, Pointer::Button> buttons[] =
+    {
+        {1, Pointer::Button::left},
+        {2, Pointer::Button::middle},
+        {4, Pointer::Button::right},
+    };
+
+    for (const auto& b : buttons)
+    {
+        if ((mask & b.first) != (m_buttons & b.first))
+        {
+            m_server.dispatch(Event((mask & b.first) ? EventId::raw_pointer_down : EventId::raw_pointer_up,
+                                    Pointer(display, b.second)));
+        }
+    }
+
+    m_buttons = mask;
+}
+
+void RfbClient::damage(const Screen::DamageArray& damage, size_t frames)
+{
+    if (!m_ready || !frames)
+        return;
+
+    // frames that are not sent by themselves are dropped
+    const auto dropped = m_damage.empty() ? frames - 1 : frames;
+    if (dropped)
+    {
+        std::lock_guard<std::mutex> guard(m_server.stats_lock);
+        m_server.stats.dropped += dropped;
+    }
+
+    for (const auto& rect : damage)
+        Screen::damage_algorithm(m_damage, Rect::intersection(rect, Rect(Point(), m_server.size)));
+
+    update();
+}
+
+void RfbClient::update()
+{
+    if (!m_ready || !m_requested || m_writing || m_damage.empty() || !m_server.frame)
+        return;
+
+    auto surface = m_server.frame.get();
+    if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE)
+        return;
+
+    const auto format = cairo_image_surface_get_format(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    if (!data || (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24 &&
+                  format != CAIRO_FORMAT_RGB16_565))
+        return;
+
+    const size_t stride = cairo_image_surface_get_stride(surface);
+    const Rect bounds(0, 0, cairo_image_surface_get_width(surface),
+                      cairo_image_surface_get_height(surface));
+
+    m_out.clear();
+    put8(m_out, 0);
+    put8(m_out, 0);
+    put16(m_out, 0);
+
+    uint16_t count = 0;
+    for (const auto& d : m_damage)
+    {
+        const auto rect = Rect::intersection(d, bounds);
+        if (rect.empty())
+            continue;
+
+        put16(m_out, rect.x());
+        put16(m_out, rect.y());
+        put16(m_out, rect.width());
+        put16(m_out, rect.height());
+
+        const auto row = data + rect.y() * stride;
+        if (m_zrle)
+        {
+            put32(m_out, RFB_ENCODING_ZRLE);
+            encode_zrle(rect, row, stride, format, m_out);
+        }
+        else
+        {
+            put32(m_out, RFB_ENCODING_RAW);
+            encode_raw(rect, row, stride, format, m_out);
+        }
+        count++;
+    }
+
+    m_damage.clear();
+    if (!count)
+        return;
+
+    m_out[2] = count >> 8;
+    m_out[3] = count;
+
+    m_requested = false;
+    m_writing = true;
+    m_write_start = std::chrono::steady_clock::now();
+
+    auto self = shared_from_this();
+    asio::async_write(m_socket, asio::buffer(m_out),
+                      [self](const asio::error_code & error, std::size_t bytes)
+    {
+        self->m_writing = false;
+        if (error)
+        {
+            self->close();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(self->m_server.stats_lock);
+            self->m_server.stats.updates++;
+            self->m_server.stats.bytes += bytes;
+        }
+
+        self->bandwidth(bytes, std::chrono::steady_clock::now() - self->m_write_start);
+        self->update();
+    });
+}
+
+void RfbClient::encode_raw(const Rect& rect, const uint8_t* data, size_t stride,
+                           cairo_format_t format, std::vector<uint8_t>& out)
+{
+    out.reserve(out.size() + rect.width() * rect.height() * m_pixel_bytes);
+    for (auto y = 0; y < rect.height(); ++y, data += stride)
+        for (auto x = rect.x(); x < rect.right(); ++x)
+            put_pixel(out, client_pixel(m_format, source_pixel(data, x, format)),
+                      m_pixel_bytes, m_format.big_endian);
+}
+
+void RfbClient::encode_zrle(const Rect& rect, const uint8_t* data, size_t stride,
+                            cairo_format_t format, std::vector<uint8_t>& out)
+{
+    std::vector<uint8_t> tiles;
+    std::vector<uint32_t> tile;
+    tile.reserve(ZRLE_TILE * ZRLE_TILE);
+
+    for (auto ty = 0; ty < rect.height(); ty += ZRLE_TILE)
+    {
+        const auto th = std::min(ZRLE_TILE, rect.height() - ty);
+        for (auto tx = rect.x(); tx < rect.right(); tx += ZRLE_TILE)
+        {
+            const auto tw = std::min(ZRLE_TILE, rect.right() - tx);
+
+            tile.clear();
+            for (auto y = ty; y < ty + th; ++y)
+            {
+                const auto row = data + y * stride;
+                for (auto x = tx; x < tx + tw; ++x)
+                    tile.push_back(client_pixel(m_format, source_pixel(row, x, format)));
+            }
+
+            encode_tile(tile, tw, th, tiles);
+        }
+    }
+
+    const auto length = out.size();
+    put32(out, 0);
+    compress(tiles, out);
+
+    const uint32_t size = out.size() - length - 4;
+    out[length] = size >> 24;
+    out[length + 1] = size >> 16;
+    out[length + 2] = size >> 8;
+    out[length + 3] = size;
+}
+
+void RfbClient::encode_tile(const std::vector<uint32_t>& tile, int width, int height,
+                            std::vector<uint8_t>& out)
+{
+    const auto cpixel = [this, &out](uint32_t pixel)
+    {
+        put_pixel(out, pixel >> m_cpixel_shift, m_cpixel_bytes, m_format.big_endian);
+    };
+
+    // UIs are mostly flat colors, so look for a small palette and for runs
+    static const size_t max_palette = 16;
+    std::array<uint32_t, max_palette> palette{};
+    size_t colors = 0;
+    size_t runs_cost = 0;
+    size_t palette_runs_cost = 0;
+    for (size_t i = 0; i < tile.size();)
+    {
+        auto j = i + 1;
+        while (j < tile.size() && tile[j] == tile[i])
+            ++j;
+        runs_cost += m_cpixel_bytes + run_bytes(j - i);
+        palette_runs_cost += j - i == 1 ? 1 : 1 + run_bytes(j - i);
+
+        // past max_palette colors, only the count matters
+        const auto end = palette.begin() + std::min(colors, max_palette);
+        if (colors <= max_palette && std::find(palette.begin(), end, tile[i]) == end)
+        {
+            if (colors < max_palette)
+                palette[colors] = tile[i];
+            colors++;
+        }
+
+        i = j;
+    }
+
+    if (colors == 1)
+    {
+        put8(out, 1);
+        cpixel(tile[0]);
+        return;
+    }
+
+    const auto raw_cost = tile.size() * m_cpixel_bytes;
+    size_t packed_cost = SIZE_MAX;
+    size_t bits = 0;
+    if (colors <= max_palette)
+    {
+        bits = colors <= 2 ? 1 : (colors <= 4 ? 2 : 4);
+        packed_cost = colors * m_cpixel_bytes + height * ((width * bits + 7) / 8);
+        palette_runs_cost += colors * m_cpixel_bytes;
+    }
+    else
+    {
+        palette_runs_cost = SIZE_MAX;
+    }
+
+    const auto index = [&palette, colors](uint32_t pixel)
+    {
+        return static_cast<uint8_t>(std::find(palette.begin(), palette.begin() + colors, pixel) -
+                                    palette.begin());
+    };
+
+    const auto best = std::min({raw_cost, runs_cost, packed_cost, palette_runs_cost});
+    if (best == packed_cost)
+    {
+        put8(out, colors);
+        for (size_t c = 0; c < colors; ++c)
+            cpixel(palette[c]);
+
+        for (auto y = 0; y < height; ++y)
+        {
+            uint8_t byte = 0;
+            size_t used = 0;
+            for (auto x = 0; x < width; ++x)
+            {
+                byte = (byte << bits) | index(tile[y * width + x]);
+                used += bits;
+                if (used == 8)
+                {
+                    out.push_back(byte);
+                    byte = 0;
+                    used = 0;
+                }
+            }
+            if (used)
+                out.push_back(byte << (8 - used));
+        }
+    }
+    else if (best == palette_runs_cost)
+    {
+        put8(out, 128 + colors);
+        for (size_t c = 0; c < colors; ++c)
+            cpixel(palette[c]);
+
+        for (size_t i = 0; i < tile.size();)
+        {
+            auto j = i + 1;
+            while (j < tile.size() && tile[j] == tile[i])
+                ++j;
+            if (j - i == 1)
+                put8(out, index(tile[i]));
+            else
+            {
+                put8(out, 128 | index(tile[i]));
+                put_run(out, j - i);
+            }
+            i = j;
+        }
+    }
+    else if (best == runs_cost)
+    {
+        put8(out, 128);
+        for (size_t i = 0; i < tile.size();)
+        {
+            auto j = i + 1;
+            while (j < tile.size() && tile[j] == tile[i])
+                ++j;
+            cpixel(tile[i]);
+            put_run(out, j - i);
+            i = j;
+        }
+    }
+    else
+    {
+        put8(out, 0);
+        for (const auto pixel : tile)
+            cpixel(pixel);
+    }
+}
+
+void RfbClient::compress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+{
+#ifdef HAVE_ZLIB
+    // one stream for the whole connection, as ZRLE requires
+    auto& z = *m_zstream;
+    z.next_in = const_cast<Bytef*>(data.data());
+    z.avail_in = data.size();
+
+    auto params = m_level != m_applied_level;
+    static const size_t chunk = 16 * 1024;
+    do
+    {
+        out.resize(out.size() + chunk);
+        z.next_out = out.data() + out.size() - chunk;
+        z.avail_out = chunk;
+
+        // output of the level change belongs to this rectangle too
+        if (params)
+        {
+            deflateParams(&z, m_level, Z_DEFAULT_STRATEGY);
+            m_applied_level = m_level;
+            params = false;
+        }
+
+        deflate(&z, Z_SYNC_FLUSH);
+        out.resize(out.size() - z.avail_out);
+    }
+    while (z.avail_out == 0 || z.avail_in);
+#else
+    detail::ignoreparam(data);
+    detail::ignoreparam(out);
+#endif
+}
+
+void RfbClient::bandwidth(size_t bytes, std::chrono::steady_clock::duration elapsed)
+{
+    // small updates are all latency
+    const auto seconds = std::chrono::duration<double>(elapsed).count();
+    if (bytes < 16 * 1024 || seconds <= 0)
+        return;
+
+    const auto rate = bytes / seconds;
+    m_rate = m_rate ? m_rate * 0.75 + rate * 0.25 : rate;
+
+#ifdef HAVE_ZLIB
+    // spend CPU on compression only when the network is the bottleneck
+    if (m_rate > 8e6)
+        m_level = 1;
+    else if (m_rate > 1e6)
+        m_level = 3;
+    else
+        m_level = 6;
+#endif
+}
+
+void RfbClient::close()
+{
+    if (!m_socket.is_open())
+        return;
+
+    asio::error_code ec;
+    m_socket.shutdown(tcp::socket::shutdown_both, ec);
+    m_socket.close(ec);
+
+    {
+        std::lock_guard<std::mutex> guard(m_server.stats_lock);
+        m_server.stats.clients--;
+    }
+
+    // may release the last reference
+    auto self = shared_from_this();
+    m_server.remove(this);
+}
+
+RfbClient::~RfbClient() noexcept
+{
+#ifdef HAVE_ZLIB
+    if (m_zstream)
+        deflateEnd(m_zstream.get());
+#endif
+}
+
+}
+
+namespace experimental
+{
+
+RfbServer::RfbServer(Screen& screen, uint16_t port)
+    : m_impl(std::make_unique<detail::RfbServerImpl>(screen, port))
+{
+    auto impl = m_impl.get();
+    detail::info("rfb server on port {}", this->port());
+
+    // what is on the screen until the next frame
+    auto target = cairo_get_target(screen.context().get());
+    impl->surface = shared_cairo_surface_t(cairo_surface_reference(target),
+                                           cairo_surface_destroy);
+    impl->frame = impl->surface;
+
+    impl->damage_handle = screen.on_damage([impl](const Screen::DamageArray & damage)
+    {
+        std::lock_guard<std::mutex> guard(impl->lock);
+        for (const auto& rect : damage)
+            Screen::damage_algorithm(impl->damage, rect);
+        impl->frames++;
+
+        // the surface changes with each frame in zero copy mode
+        auto target = cairo_get_target(impl->screen.context().get());
+        if (impl->surface.get() != target)
+            impl->surface = shared_cairo_surface_t(cairo_surface_reference(target),
+                                                   cairo_surface_destroy);
+
+        if (!impl->posted)
+        {
+            impl->posted = true;
+            asio::post(impl->io, [impl]() { impl->take(); });
+        }
+    });
+
+    impl->accept();
+    impl->thread = std::thread([impl]()
+    {
+        auto work = asio::make_work_guard(impl->io);
+        impl->io.run();
+    });
+}
+
+uint16_t RfbServer::port() const
+{
+    return m_impl->acceptor.local_endpoint().port();
+}
+
+RfbStats RfbServer::stats() const
+{
+    std::lock_guard<std::mutex> guard(m_impl->stats_lock);
+    return m_impl->stats;
+}
+
+RfbServer::~RfbServer() noexcept
+{
+    m_impl->screen.on_damage.remove(m_impl->damage_handle);
+
+    asio::post(m_impl->io, [impl = m_impl.get()]()
+    {
+        asio::error_code ec;
+        impl->acceptor.close(ec);
+        auto clients = impl->clients;
+        for (auto& client : clients)
+            client->close();
+        impl->io.stop();
+    });
+    m_impl->thread.join();
+}
+
+}
+}
+}
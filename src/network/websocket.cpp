@@ -0,0 +1,965 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "detail/base64.h"
+#include "detail/egtlog.h"
+#include "egt/eventloop.h"
+#include "egt/network/websocket.h"
+#include "egt/uri.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <egt/asio.hpp>
+#include <functional>
+#include <map>
+#include <random>
+
+#ifdef HAVE_OPENSSL
+#include <egt/asio/ssl.hpp>
+#endif
+
+namespace egt
+{
+inline namespace v1
+{
+namespace detail
+{
+
+/// Appended to the key of the handshake to compute the accept value, RFC 6455.
+static constexpr auto WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/// SHA-1 digest, only used to check the handshake of the server.
+static std::array<unsigned char, 20> sha1(const std::string& data)
+{
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+    std::string message = data;
+    const auto bits = static_cast<uint64_t>(data.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56)
+        message += '\0';
+    for (int i = 7; i >= 0; --i)
+        message += static_cast<char>((bits >> (i * 8)) & 0xff);
+
+    const auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            const auto p = reinterpret_cast<const unsigned char*>(message.data() + chunk + i * 4);
+            w[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                   (static_cast<uint32_t>(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; ++i)
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        auto a = h[0];
+        auto b = h[1];
+        auto c = h[2];
+        auto d = h[3];
+        auto e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            const auto t = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<unsigned char, 20> digest{};
+    for (size_t i = 0; i < 20; ++i)
+        digest[i] = static_cast<unsigned char>(h[i / 4] >> (24 - (i % 4) * 8));
+    return digest;
+}
+
+/// Byte stream of a connection, over TCP or TLS.
+class WebSocketTransport
+{
+public:
+    using Handler = std::function<void(const asio::error_code&, size_t)>;
+
+    /// Socket to connect and close.
+    virtual asio::ip::tcp::socket& socket() = 0;
+
+    /// Set up the stream once connected.
+    virtual void handshake(const std::string& host,
+                           std::function<void(const asio::error_code&)> handler) = 0;
+
+    /// Read some data.
+    virtual void read(unsigned char* data, size_t size, Handler handler) = 0;
+
+    /// Write all the data.
+    virtual void write(const unsigned char* data, size_t size, Handler handler) = 0;
+
+    virtual ~WebSocketTransport() noexcept = default;
+};
+
+class TcpTransport : public WebSocketTransport
+{
+public:
+    explicit TcpTransport(asio::io_context& io)
+        : m_socket(io)
+    {}
+
+    asio::ip::tcp::socket& socket() override { return m_socket; }
+
+    void handshake(const std::string& host,
+                   std::function<void(const asio::error_code&)> handler) override
+    {
+        detail::ignoreparam(host);
+        asio::post(m_socket.get_executor(), [handler]()
+        {
+            handler({});
+        });
+    }
+
+    void read(unsigned char* data, size_t size, Handler handler) override
+    {
+        m_socket.async_read_some(asio::buffer(data, size), std::move(handler));
+    }
+
+    void write(const unsigned char* data, size_t size, Handler handler) override
+    {
+        asio::async_write(m_socket, asio::buffer(data, size), std::move(handler));
+    }
+
+private:
+    asio::ip::tcp::socket m_socket;
+};
+
+#ifdef HAVE_OPENSSL
+class TlsTransport : public WebSocketTransport
+{
+public:
+    explicit TlsTransport(asio::io_context& io)
+        : m_context(asio::ssl::context::tls_client),
+          m_stream(io, m_context)
+    {
+        m_context.set_default_verify_paths();
+    }
+
+    asio::ip::tcp::socket& socket() override { return m_stream.next_layer(); }
+
+    void handshake(const std::string& host,
+                   std::function<void(const asio::error_code&)> handler) override
+    {
+        // the name is sent for servers hosting several domains, and checked
+        // against the certificate
+        SSL_set_tlsext_host_name(m_stream.native_handle(), host.c_str());
+        m_stream.set_verify_mode(asio::ssl::verify_peer);
+        m_stream.set_verify_callback(asio::ssl::rfc2818_verification(host));
+        m_stream.async_handshake(asio::ssl::stream_base::client, std::move(handler));
+    }
+
+    void read(unsigned char* data, size_t size, Handler handler) override
+    {
+        m_stream.async_read_some(asio::buffer(data, size), std::move(handler));
+    }
+
+    void write(const unsigned char* data, size_t size, Handler handler) override
+    {
+        asio::async_write(m_stream, asio::buffer(data, size), std::move(handler));
+    }
+
+private:
+    asio::ssl::context m_context;
+    asio::ssl::stream<asio::ip::tcp::socket> m_stream;
+};
+#endif
+
+struct WebSocketImpl : public std::enable_shared_from_this<WebSocketImpl>
+{
+    using State = experimental::WebSocket::State;
+
+    /// Frame opcodes.
+    enum Opcode : unsigned char
+    {
+        continuation = 0x0,
+        text = 0x1,
+        binary = 0x2,
+        close = 0x8,
+        ping = 0x9,
+        pong = 0xa,
+    };
+
+    /// Free space wanted in the receive buffer before reading.
+    static constexpr size_t MIN_READ = 4096;
+
+    /// Largest handshake response.
+    static constexpr size_t MAX_HANDSHAKE = 16 * 1024;
+
+    /// Time given to the server to answer a close.
+    static constexpr std::chrono::seconds CLOSE_TIMEOUT{5};
+
+    WebSocketImpl(experimental::WebSocket& owner, asio::io_context& io)
+        : owner(&owner),
+          io(io),
+          resolver(io),
+          timer(io),
+          reconnect_timer(io),
+          random(std::random_device{}())
+    {}
+
+    /// Is a connection still the current one, and its WebSocket alive.
+    bool alive(uint64_t id) const
+    {
+        return owner && id == generation && state != State::closed;
+    }
+
+    void connect();
+    void send_handshake(uint64_t id, const std::string& host);
+    bool check_handshake();
+    void read(uint64_t id);
+    void process(uint64_t id);
+    void frame(uint64_t id, bool fin, unsigned char opcode, const unsigned char* payload, size_t size);
+    void deliver(uint64_t id, const unsigned char* data, size_t size, bool binary);
+    void send(unsigned char opcode, const unsigned char* data, size_t size);
+    void write_next(uint64_t id);
+    void keepalive(uint64_t id);
+    void fail(const std::string& message);
+    void finish(uint16_t code, const std::string& reason);
+
+    experimental::WebSocket* owner;
+    asio::io_context& io;
+    asio::ip::tcp::resolver resolver;
+    std::unique_ptr<WebSocketTransport> transport;
+    State state{State::closed};
+    /// Counts the connections, so handlers of a previous one are ignored.
+    uint64_t generation{0};
+
+    std::string url;
+    std::vector<std::string> protocols;
+    std::vector<std::string> headers;
+    std::string protocol;
+    std::string key;
+    bool handshaken{false};
+
+    /// Received data, from rx_begin to rx_end.
+    std::vector<unsigned char> rx;
+    size_t rx_begin{0};
+    size_t rx_end{0};
+    /// Size of the frame being received, to fit in rx.
+    size_t rx_frame{0};
+    size_t max_message{1024 * 1024};
+
+    /// Fragmented message being assembled.
+    std::vector<unsigned char> fragments;
+    bool fragmented{false};
+    bool fragments_binary{false};
+
+    /// Frames waiting to be written, the first one being written.
+    std::deque<std::vector<unsigned char>> tx;
+    bool writing{false};
+    bool close_sent{false};
+    bool close_received{false};
+    uint16_t close_code{1005};
+    std::string close_reason;
+
+    asio::steady_timer timer;
+    std::chrono::seconds ping_interval{30};
+    std::chrono::steady_clock::time_point last_rx;
+
+    asio::steady_timer reconnect_timer;
+    std::chrono::milliseconds reconnect{0};
+    /// close() was called, so the connection is not opened again.
+    bool closed_by_user{false};
+
+    std::mt19937 random;
+};
+
+void WebSocketImpl::connect()
+{
+    const auto id = ++generation;
+    state = State::connecting;
+    closed_by_user = false;
+    handshaken = false;
+    protocol.clear();
+    rx.resize(MIN_READ * 4);
+    rx_begin = rx_end = rx_frame = 0;
+    fragments.clear();
+    fragmented = false;
+    tx.clear();
+    writing = false;
+    close_sent = false;
+    close_received = false;
+    close_code = 1005;
+    close_reason.clear();
+
+    const Uri uri(url);
+    const auto secure = uri.scheme() == "wss";
+    if (!secure && uri.scheme() != "ws")
+    {
+        fail("unsupported url: " + url);
+        return;
+    }
+
+#ifdef HAVE_OPENSSL
+    if (secure)
+        transport = std::make_unique<TlsTransport>(io);
+    else
+#endif
+    {
+        if (secure)
+        {
+            fail("wss not supported without OpenSSL");
+            return;
+        }
+        transport = std::make_unique<TcpTransport>(io);
+    }
+
+    auto host = uri.host();
+    const auto port = !uri.port().empty() ? uri.port() : (secure ? "443" : "80");
+    auto self = shared_from_this();
+
+    resolver.async_resolve(host, port,
+                           [self, id, host](const asio::error_code & ec,
+                                            const asio::ip::tcp::resolver::results_type & results)
+    {
+        if (!self->alive(id))
+            return;
+        if (ec)
+        {
+            self->fail(fmt::format("can't resolve {}: {}", host, ec.message()));
+            return;
+        }
+
+        asio::async_connect(self->transport->socket(), results,
+                            [self, id, host](const asio::error_code & ec, const asio::ip::tcp::endpoint&)
+        {
+            if (!self->alive(id))
+                return;
+            if (ec)
+            {
+                self->fail(fmt::format("can't connect to {}: {}", host, ec.message()));
+                return;
+            }
+
+            asio::error_code error;
+            self->transport->socket().set_option(asio::ip::tcp::no_delay(true), error);
+
+            self->transport->handshake(host, [self, id, host](const asio::error_code & ec)
+            {
+                if (!self->alive(id))
+                    return;
+                if (ec)
+                {
+                    self->fail(fmt::format("TLS handshake with {} failed: {}", host, ec.message()));
+                    return;
+                }
+
+                self->send_handshake(id, host);
+            });
+        });
+    });
+}
+
+void WebSocketImpl::send_handshake(uint64_t id, const std::string& host)
+{
+    const Uri uri(url);
+
+    std::array<unsigned char, 16> nonce{};
+    for (auto& c : nonce)
+        c = static_cast<unsigned char>(random());
+    key = base64_encode(nonce.data(), nonce.size());
+
+    auto path = uri.path().empty() ? "/" : uri.path();
+    if (!uri.query().empty())
+        path += "?" + uri.query();
+
+    std::string request = fmt::format("GET {} HTTP/1.1\r\n"
+                                      "Host: {}{}\r\n"
+                                      "Upgrade: websocket\r\n"
+                                      "Connection: Upgrade\r\n"
+                                      "Sec-WebSocket-Key: {}\r\n"
+                                      "Sec-WebSocket-Version: 13\r\n",
+                                      path, host, uri.port().empty() ? "" : ":" + uri.port(), key);
+    if (!protocols.empty())
+    {
+        request += "Sec-WebSocket-Protocol: ";
+        for (size_t i = 0; i < protocols.size(); ++i)
+            request += (i ? ", " : "") + protocols[i];
+        request += "\r\n";
+    }
+    for (const auto& header : headers)
+        request += header + "\r\n";
+    request += "\r\n";
+
+    tx.emplace_back(request.begin(), request.end());
+    write_next(id);
+    read(id);
+}
+
+bool WebSocketImpl::check_handshake()
+{
+    const auto begin = reinterpret_cast<const char*>(rx.data());
+    const std::string_view response(begin, rx_end);
+    const auto end = response.find("\r\n\r\n");
+    if (end == std::string_view::npos)
+    {
+        if (rx_end > MAX_HANDSHAKE)
+            fail("handshake response too large");
+        return false;
+    }
+
+    std::map<std::string, std::string> fields;
+    std::string status;
+    size_t pos = 0;
+    while (pos < end)
+    {
+        auto eol = response.find("\r\n", pos);
+        const auto line = response.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        if (status.empty())
+        {
+            status = std::string(line);
+            continue;
+        }
+
+        const auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+
+        std::string name(line.substr(0, colon));
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        auto value = line.substr(colon + 1);
+        const auto first = value.find_first_not_of(" \t");
+        value = first == std::string_view::npos ? std::string_view() : value.substr(first);
+        fields[name] = std::string(value.substr(0, value.find_last_not_of(" \t") + 1));
+    }
+
+    const auto lower = [](std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return s;
+    };
+
+    const auto digest = sha1(key + WEBSOCKET_GUID);
+    const auto accept = base64_encode(digest.data(), digest.size());
+
+    if (status.compare(0, 12, "HTTP/1.1 101") != 0)
+    {
+        fail("handshake refused: " + status);
+        return false;
+    }
+    if (lower(fields["upgrade"]) != "websocket" ||
+        lower(fields["connection"]).find("upgrade") == std::string::npos ||
+        fields["sec-websocket-accept"] != accept)
+    {
+        fail("invalid handshake response");
+        return false;
+    }
+
+    protocol = fields["sec-websocket-protocol"];
+    handshaken = true;
+    // frames sent right after the response are in the buffer already
+    rx_begin = end + 4;
+    return true;
+}
+
+void WebSocketImpl::read(uint64_t id)
+{
+    // the partial frame left is moved to the start, so frames are contiguous
+    if (rx_begin)
+    {
+        std::memmove(rx.data(), rx.data() + rx_begin, rx_end - rx_begin);
+        rx_end -= rx_begin;
+        rx_begin = 0;
+    }
+
+    const auto needed = std::max(rx_frame, rx_end + MIN_READ);
+    if (rx.size() < needed)
+        rx.resize(std::max(needed, rx.size() * 2));
+
+    auto self = shared_from_this();
+    transport->read(rx.data() + rx_end, rx.size() - rx_end,
+                    [self, id](const asio::error_code & ec, size_t size)
+    {
+        if (!self->alive(id))
+            return;
+        if (ec)
+        {
+            self->fail(ec == asio::error::eof ? "connection closed" : ec.message());
+            return;
+        }
+
+        self->rx_end += size;
+        self->last_rx = std::chrono::steady_clock::now();
+
+        if (!self->handshaken)
+        {
+            if (!self->check_handshake())
+            {
+                if (self->alive(id))
+                    self->read(id);
+                return;
+            }
+
+            self->state = State::open;
+            self->keepalive(id);
+            self->owner->on_open.invoke();
+            if (!self->alive(id))
+                return;
+        }
+
+        self->process(id);
+        if (self->alive(id))
+            self->read(id);
+    });
+}
+
+void WebSocketImpl::process(uint64_t id)
+{
+    while (rx_end - rx_begin >= 2)
+    {
+        const auto p = rx.data() + rx_begin;
+        const auto available = rx_end - rx_begin;
+
+        const bool fin = p[0] & 0x80;
+        const unsigned char opcode = p[0] & 0x0f;
+        const bool masked = p[1] & 0x80;
+        uint64_t size = p[1] & 0x7f;
+        size_t header = 2;
+
+        if (size == 126)
+        {
+            header = 4;
+            if (available < header)
+                break;
+            size = (static_cast<uint64_t>(p[2]) << 8) | p[3];
+        }
+        else if (size == 127)
+        {
+            header = 10;
+            if (available < header)
+                break;
+            size = 0;
+            for (size_t i = 0; i < 8; ++i)
+                size = (size << 8) | p[2 + i];
+        }
+
+        if (masked)
+            header += 4;
+
+        if (size > max_message)
+        {
+            fail("message too large");
+            return;
+        }
+
+        if (available < header + size)
+        {
+            rx_frame = header + size;
+            break;
+        }
+        rx_frame = 0;
+
+        // servers don't mask their frames, but it costs nothing to allow it
+        auto payload = p + header;
+        if (masked)
+        {
+            const auto mask = payload - 4;
+            for (size_t i = 0; i < size; ++i)
+                payload[i] ^= mask[i % 4];
+        }
+
+        rx_begin += header + size;
+        frame(id, fin, opcode, payload, size);
+        if (!alive(id))
+            return;
+    }
+
+    if (rx_begin == rx_end)
+        rx_begin = rx_end = 0;
+}
+
+void WebSocketImpl::frame(uint64_t id, bool fin, unsigned char opcode,
+                          const unsigned char* payload, size_t size)
+{
+    switch (opcode)
+    {
+    case Opcode::text:
+    case Opcode::binary:
+        if (fragmented)
+        {
+            fail("unexpected data frame");
+            return;
+        }
+
+        // a whole message is passed straight from the receive buffer
+        if (fin)
+        {
+            deliver(id, payload, size, opcode == Opcode::binary);
+            return;
+        }
+
+        fragments.assign(payload, payload + size);
+        fragmented = true;
+        fragments_binary = opcode == Opcode::binary;
+        break;
+    case Opcode::continuation:
+        if (!fragmented)
+        {
+            fail("unexpected continuation frame");
+            return;
+        }
+        if (fragments.size() + size > max_message)
+        {
+            fail("message too large");
+            return;
+        }
+
+        fragments.insert(fragments.end(), payload, payload + size);
+        if (fin)
+        {
+            fragmented = false;
+            deliver(id, fragments.data(), fragments.size(), fragments_binary);
+            if (alive(id) && !fragmented)
+                fragments.clear();
+        }
+        break;
+    case Opcode::ping:
+        send(Opcode::pong, payload, size);
+        break;
+    case Opcode::pong:
+        break;
+    case Opcode::close:
+    {
+        close_code = size >= 2 ? static_cast<uint16_t>((payload[0] << 8) | payload[1]) : 1005;
+        close_reason = size > 2 ? std::string(reinterpret_cast<const char*>(payload) + 2, size - 2) : "";
+        close_received = true;
+
+        // answered, then closed once written
+        if (!close_sent)
+        {
+            send(Opcode::close, payload, std::min<size_t>(size, 2));
+            close_sent = true;
+            state = State::closing;
+        }
+        else
+        {
+            finish(close_code, close_reason);
+        }
+        break;
+    }
+    default:
+        fail(fmt::format("unknown opcode {}", opcode));
+        break;
+    }
+}
+
+void WebSocketImpl::deliver(uint64_t id, const unsigned char* data, size_t size, bool binary)
+{
+    // messages received while closing are dropped
+    if (!alive(id) || state != State::open)
+        return;
+
+    experimental::WebSocketMessage message;
+    message.data = data;
+    message.size = size;
+    message.binary = binary;
+    owner->on_message.invoke(message);
+}
+
+void WebSocketImpl::send(unsigned char opcode, const unsigned char* data, size_t size)
+{
+    std::vector<unsigned char> frame;
+    frame.reserve(size + 14);
+
+    frame.push_back(0x80 | opcode);
+    if (size < 126)
+    {
+        frame.push_back(0x80 | static_cast<unsigned char>(size));
+    }
+    else if (size <= 0xffff)
+    {
+        frame.push_back(0x80 | 126);
+        frame.push_back(static_cast<unsigned char>(size >> 8));
+        frame.push_back(static_cast<unsigned char>(size));
+    }
+    else
+    {
+        frame.push_back(0x80 | 127);
+        for (int i = 7; i >= 0; --i)
+            frame.push_back(static_cast<unsigned char>(static_cast<uint64_t>(size) >> (i * 8)));
+    }
+
+    // clients must mask their frames
+    const auto mask = static_cast<uint32_t>(random());
+    unsigned char m[4] =
+    {
+        static_cast<unsigned char>(mask >> 24), static_cast<unsigned char>(mask >> 16),
+        static_cast<unsigned char>(mask >> 8), static_cast<unsigned char>(mask)
+    };
+    frame.insert(frame.end(), m, m + 4);
+    for (size_t i = 0; i < size; ++i)
+        frame.push_back(data[i] ^ m[i % 4]);
+
+    tx.push_back(std::move(frame));
+    write_next(generation);
+}
+
+void WebSocketImpl::write_next(uint64_t id)
+{
+    if (writing || tx.empty())
+        return;
+
+    writing = true;
+    auto self = shared_from_this();
+    transport->write(tx.front().data(), tx.front().size(),
+                     [self, id](const asio::error_code & ec, size_t)
+    {
+        if (!self->alive(id))
+            return;
+
+        self->writing = false;
+        self->tx.pop_front();
+        if (ec)
+        {
+            self->fail(ec.message());
+            return;
+        }
+
+        // the close was answered, the connection can go
+        if (self->tx.empty() && self->state == State::closing &&
+            self->close_received)
+        {
+            self->finish(self->close_code, self->close_reason);
+            return;
+        }
+
+        self->write_next(id);
+    });
+}
+
+void WebSocketImpl::keepalive(uint64_t id)
+{
+    timer.cancel();
+    if (ping_interval.count() <= 0)
+        return;
+
+    timer.expires_after(ping_interval);
+    auto self = shared_from_this();
+    timer.async_wait([self, id](const asio::error_code & ec)
+    {
+        if (ec || !self->alive(id) || self->state != State::open)
+            return;
+
+        if (std::chrono::steady_clock::now() - self->last_rx > 2 * self->ping_interval)
+        {
+            self->fail("connection timed out");
+            return;
+        }
+
+        self->send(Opcode::ping, nullptr, 0);
+        self->keepalive(id);
+    });
+}
+
+void WebSocketImpl::fail(const std::string& message)
+{
+    EGTLOG_DEBUG("websocket {}: {}", url, message);
+
+    const auto id = generation;
+    if (owner)
+        owner->on_error.invoke(message);
+
+    // closed or opened again by the handler
+    if (alive(id))
+        finish(1006, message);
+}
+
+void WebSocketImpl::finish(uint16_t code, const std::string& reason)
+{
+    state = State::closed;
+    ++generation;
+    timer.cancel();
+    resolver.cancel();
+    if (transport)
+    {
+        asio::error_code ec;
+        transport->socket().close(ec);
+    }
+    tx.clear();
+    writing = false;
+
+    if (owner)
+        owner->on_close.invoke(code, reason);
+
+    // the handler may have opened it again
+    if (owner && state == State::closed && !closed_by_user && reconnect.count() > 0)
+    {
+        reconnect_timer.expires_after(reconnect);
+        auto self = shared_from_this();
+        const auto id = generation;
+        reconnect_timer.async_wait([self, id](const asio::error_code & ec)
+        {
+            if (!ec && self->owner && self->generation == id && self->state == State::closed)
+                self->connect();
+        });
+    }
+}
+
+}
+
+namespace experimental
+{
+
+WebSocket::WebSocket(EventLoop& loop)
+    : m_impl(std::make_shared<detail::WebSocketImpl>(*this, loop.io()))
+{}
+
+void WebSocket::open(const std::string& url, const std::vector<std::string>& protocols)
+{
+    if (m_impl->state != State::closed)
+    {
+        m_impl->closed_by_user = true;
+        m_impl->finish(1000, {});
+    }
+
+    m_impl->reconnect_timer.cancel();
+    m_impl->url = url;
+    m_impl->protocols = protocols;
+    m_impl->connect();
+}
+
+void WebSocket::header(const std::string& name, const std::string& value)
+{
+    m_impl->headers.push_back(name + ": " + value);
+}
+
+bool WebSocket::send(std::string_view text)
+{
+    if (m_impl->state != State::open)
+        return false;
+
+    m_impl->send(detail::WebSocketImpl::Opcode::text,
+                 reinterpret_cast<const unsigned char*>(text.data()), text.size());
+    return true;
+}
+
+bool WebSocket::send(const void* data, size_t size)
+{
+    if (m_impl->state != State::open)
+        return false;
+
+    m_impl->send(detail::WebSocketImpl::Opcode::binary,
+                 static_cast<const unsigned char*>(data), size);
+    return true;
+}
+
+void WebSocket::close(uint16_t code, const std::string& reason)
+{
+    m_impl->closed_by_user = true;
+    m_impl->reconnect_timer.cancel();
+
+    if (m_impl->state != State::open)
+    {
+        if (m_impl->state == State::connecting)
+            m_impl->finish(code, reason);
+        return;
+    }
+
+    std::vector<unsigned char> payload{static_cast<unsigned char>(code >> 8),
+                                       static_cast<unsigned char>(code)};
+    payload.insert(payload.end(), reason.begin(), reason.begin() + std::min<size_t>(reason.size(), 123));
+    m_impl->send(detail::WebSocketImpl::Opcode::close, payload.data(), payload.size());
+    m_impl->close_sent = true;
+    m_impl->state = State::closing;
+
+    // the server has some time to answer
+    m_impl->timer.cancel();
+    m_impl->timer.expires_after(detail::WebSocketImpl::CLOSE_TIMEOUT);
+    auto impl = m_impl;
+    const auto id = impl->generation;
+    m_impl->timer.async_wait([impl, id, code, reason](const asio::error_code & ec)
+    {
+        if (!ec && impl->alive(id))
+            impl->finish(code, reason);
+    });
+}
+
+WebSocket::State WebSocket::state() const
+{
+    return m_impl->state;
+}
+
+std::string WebSocket::protocol() const
+{
+    return m_impl->protocol;
+}
+
+void WebSocket::ping_interval(std::chrono::seconds interval)
+{
+    m_impl->ping_interval = interval;
+    if (m_impl->state == State::open)
+        m_impl->keepalive(m_impl->generation);
+}
+
+void WebSocket::reconnect(std::chrono::milliseconds delay)
+{
+    m_impl->reconnect = delay;
+}
+
+void WebSocket::max_message_size(size_t size)
+{
+    m_impl->max_message = size;
+}
+
+WebSocket::~WebSocket() noexcept
+{
+    // pending handlers keep the implementation, but no longer call back
+    m_impl->owner = nullptr;
+    m_impl->closed_by_user = true;
+    m_impl->reconnect_timer.cancel();
+    if (m_impl->state != State::closed)
+        m_impl->finish(1001, {});
+}
+
+}
+}
+}
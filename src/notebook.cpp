@@ -3,6 +3,8 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "egt/cachebudget.h"
+#include "egt/detail/lrucache.h"
 #include "egt/notebook.h"
 #include <algorithm>
 #include <string>
@@ -12,6 +14,45 @@ namespace egt
 inline namespace v1
 {
 
+namespace detail
+{
+
+/**
+ * Keeps the subtree cache of a tab while it is in the page cache.
+ */
+struct CachedPage
+{
+    explicit CachedPage(const std::shared_ptr<NotebookTab>& tab)
+        : tab(tab)
+    {
+        tab->cache_subtree(true);
+    }
+
+    CachedPage(const CachedPage&) = delete;
+    CachedPage& operator=(const CachedPage&) = delete;
+    CachedPage(CachedPage&&) noexcept = default;
+    CachedPage& operator=(CachedPage&&) = delete;
+
+    ~CachedPage()
+    {
+        if (auto t = tab.lock())
+            t->cache_subtree(false);
+    }
+
+    std::weak_ptr<NotebookTab> tab;
+};
+
+/**
+ * Tabs keeping their rendering, with the size of their surface as cost.
+ */
+class PageCache : public LruCache<const NotebookTab*, CachedPage>
+{
+public:
+    using LruCache::LruCache;
+};
+
+}
+
 void NotebookTab::select()
 {
     if (parent())
@@ -25,7 +66,7 @@ void NotebookTab::select()
 Notebook::Notebook(const Rect& rect) noexcept
     : Frame(rect)
 {
-    name("Notebook" + std::to_string(m_widgetid));
+    default_name("Notebook", m_widgetid);
 }
 
 Notebook::Notebook(Frame& parent, const Rect& rect) noexcept
@@ -65,6 +106,7 @@ void Notebook::add(const std::shared_ptr<Widget>& widget)
     {
         m_selected = 0;
         widget->show();
+        cache_selected();
     }
     else
     {
@@ -90,6 +132,9 @@ void Notebook::remove(Widget* widget)
     });
     m_cells.erase(i, m_cells.end());
 
+    if (m_page_cache)
+        m_page_cache->erase(dynamic_cast<const NotebookTab*>(widget));
+
     Frame::remove(widget);
 
     if (m_selected >= static_cast<int>(m_cells.size()))
@@ -131,6 +176,8 @@ void Notebook::selected(size_t index)
             to->show();
         }
 
+        cache_selected();
+
         on_selected_changed.invoke();
     }
 }
@@ -169,6 +216,55 @@ void Notebook::post_deserialize(Serializer::Properties& props)
     }), props.end());
 }
 
+void Notebook::page_cache(size_t max_bytes)
+{
+    if (max_bytes == m_page_cache_bytes)
+        return;
+
+    m_page_cache_bytes = max_bytes;
+
+    // dropping the tabs turns their subtree cache off
+    if (m_page_cache_handle)
+        experimental::cache_budget().remove(m_page_cache_handle);
+    m_page_cache_handle = 0;
+    m_page_cache.reset();
+    if (max_bytes)
+    {
+        m_page_cache = std::make_shared<detail::PageCache>(max_bytes);
+        cache_selected();
+
+        auto cache = m_page_cache.get();
+        m_page_cache_handle = experimental::cache_budget().add("notebook pages",
+                              experimental::CacheBudget::Priority::surfaces,
+                              [cache]() { return cache->cost(); },
+                              [cache](size_t bytes) { cache->trim(bytes); });
+    }
+}
+
+void Notebook::cache_selected()
+{
+    if (!m_page_cache || m_selected < 0 ||
+        m_selected >= static_cast<ssize_t>(m_cells.size()))
+        return;
+
+    auto tab = m_cells[m_selected].lock();
+    if (!tab)
+        return;
+
+    // finding the tab makes it the most recent one
+    if (m_page_cache->find(tab.get()))
+        return;
+
+    const auto cost = static_cast<size_t>(tab->width()) * tab->height() * 4;
+    m_page_cache->insert(tab.get(), detail::CachedPage(tab), cost);
+}
+
+Notebook::~Notebook() noexcept
+{
+    if (m_page_cache_handle)
+        experimental::cache_budget().remove(m_page_cache_handle);
+}
+
 NotebookTab* Notebook::get(size_t index) const
 {
     if (index < m_cells.size())
@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "egt/detail/stringhash.h"
 #include "egt/object.h"
 
 namespace egt
@@ -10,25 +11,68 @@ namespace egt
 inline namespace v1
 {
 
+void Object::default_name(std::string_view prefix, uint64_t number)
+{
+    m_name.clear();
+    m_name_prefix = detail::intern(prefix);
+    m_name_number = number;
+}
+
+void Object::build_name() const
+{
+    m_name.reserve(m_name_prefix.size() + 20);
+    m_name.assign(m_name_prefix.data(), m_name_prefix.size());
+    m_name += std::to_string(m_name_number);
+    m_name_prefix = {};
+}
+
 Object::RegisterHandle Object::on_event(const EventCallback& handler,
                                         const FilterFlags& mask)
+{
+    return add_handler(CallbackDelegate(handler), mask);
+}
+
+Object::RegisterHandle Object::add_handler(CallbackDelegate handler,
+        const FilterFlags& mask)
 {
     if (handler)
     {
         // TODO: m_handle_counter can wrap, making the handle non-unique
         auto handle = ++m_handle_counter;
-        m_callbacks->emplace_back(handler, mask, handle);
+        m_callbacks->emplace_back(std::move(handler), mask, handle);
+
+        // no mask means every EventId
+        if (mask.empty())
+            m_handler_mask.raw() = ~FilterFlags::Underlying();
+        else
+            m_handler_mask.raw() |= mask.raw();
+
         return handle;
     }
 
     return 0;
 }
 
-void Object::invoke_handlers(Event& event)
+void Object::update_handler_mask()
 {
+    m_handler_mask.clear();
     if (!m_callbacks)
         return;
 
+    for (const auto& callback : *m_callbacks)
+    {
+        if (callback.mask.empty())
+            m_handler_mask.raw() = ~FilterFlags::Underlying();
+        else
+            m_handler_mask.raw() |= callback.mask.raw();
+    }
+}
+
+void Object::invoke_handlers(Event& event)
+{
+    if (!has_handlers(event.id()))
+        return;
+
     for (auto& callback : *m_callbacks)
     {
         if (callback.mask.empty() ||
@@ -43,6 +87,9 @@ void Object::invoke_handlers(Event& event)
 
 void Object::invoke_handlers(EventId event)
 {
+    if (!has_handlers(event))
+        return;
+
     Event e(event);
     invoke_handlers(e);
 }
@@ -53,6 +100,7 @@ void Object::clear_handlers()
         return;
 
     m_callbacks->clear();
+    m_handler_mask.clear();
 }
 
 void Object::remove_handler(RegisterHandle handle)
@@ -67,7 +115,10 @@ void Object::remove_handler(RegisterHandle handle)
     });
 
     if (i != m_callbacks->end())
+    {
         m_callbacks->erase(i);
+        update_handler_mask();
+    }
 }
 
 }
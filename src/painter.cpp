@@ -3,6 +3,8 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/glyphatlas.h"
+#include "egt/detail/rasterizer.h"
 #include "egt/image.h"
 #include "egt/painter.h"
 #include <cairo.h>
@@ -42,10 +44,46 @@ void Painter::pop_group()
 
 Painter& Painter::set(const Pattern& pattern)
 {
-    cairo_set_source(m_cr.get(), pattern.pattern());
+    auto cr = m_cr.get();
+
+    cairo_matrix_t matrix;
+    auto gradient = pattern.gradient(matrix);
+    if (!gradient)
+    {
+        cairo_set_source(cr, pattern.pattern());
+        return *this;
+    }
+
+    // the middle color of the gradient is much cheaper to fill with
+    const auto& steps = pattern.steps();
+    if (low_fidelity() && !steps.empty())
+    {
+        const auto color = Color::interp_rgba(steps.front().second,
+                                              steps.back().second, 0.5);
+        cairo_set_source_rgba(cr, color.redf(), color.greenf(),
+                              color.bluef(), color.alphaf());
+        return *this;
+    }
+
+    /*
+     * The source is locked to the user space when it is set, so setting it
+     * in the space of the gradient places it without changing the gradient,
+     * which other patterns share.
+     */
+    cairo_matrix_t ctm;
+    cairo_get_matrix(cr, &ctm);
+    cairo_transform(cr, &matrix);
+    cairo_set_source(cr, gradient);
+    cairo_set_matrix(cr, &ctm);
+
     return *this;
 }
 
+bool Painter::low_fidelity() const
+{
+    return cairo_get_antialias(m_cr.get()) == CAIRO_ANTIALIAS_FAST;
+}
+
 Painter& Painter::set(const Font& font)
 {
     cairo_set_scaled_font(m_cr.get(), font.scaled_font());
@@ -74,9 +112,36 @@ Painter& Painter::draw(const Image& image)
     double y;
     cairo_get_current_point(m_cr.get(), &x, &y);
 
+    if (detail::rasterizer().draw(m_cr.get(), image, PointF(x, y)))
+    {
+        // like the cairo path, which fills the rectangle of an opaque image
+        if (image.opaque())
+            cairo_new_path(m_cr.get());
+        return *this;
+    }
+
     cairo_translate(m_cr.get(), x, y);
     cairo_set_source(m_cr.get(), image.pattern());
 
+    // the pattern is shared by the copies of the image
+    const auto filter = cairo_pattern_get_filter(image.pattern());
+    auto restore = detail::on_scope_exit([&image, filter]()
+    {
+        cairo_pattern_set_filter(image.pattern(), filter);
+    });
+    if (low_fidelity())
+        cairo_pattern_set_filter(image.pattern(), CAIRO_FILTER_FAST);
+
+    // an opaque image is copied instead of blended, but only over itself
+    if (image.opaque() && cairo_get_operator(m_cr.get()) == CAIRO_OPERATOR_OVER)
+    {
+        const auto size = image.size();
+        cairo_set_operator(m_cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_rectangle(m_cr.get(), 0, 0, size.width(), size.height());
+        fill();
+        return *this;
+    }
+
     /// @todo no paint here
     paint();
 
@@ -105,11 +170,20 @@ Painter& Painter::draw(const Rect& rect, const Image& image)
     cairo_get_current_point(m_cr.get(), &x, &y);
     cairo_set_source_surface(m_cr.get(), image.surface().get(),
                              x - rect.x(), y - rect.y());
+    if (low_fidelity())
+        cairo_pattern_set_filter(cairo_get_source(m_cr.get()), CAIRO_FILTER_FAST);
     cairo_rectangle(m_cr.get(), x, y, rect.width(), rect.height());
 
+    // an opaque image is copied instead of blended
+    const auto op = cairo_get_operator(m_cr.get());
+    if (image.opaque() && op == CAIRO_OPERATOR_OVER)
+        cairo_set_operator(m_cr.get(), CAIRO_OPERATOR_SOURCE);
+
     /// @todo no fill here
     fill();
 
+    cairo_set_operator(m_cr.get(), op);
+
     return *this;
 }
 
@@ -124,26 +198,24 @@ Painter& Painter::draw(const std::string& str, const TextDrawFlags& flags)
     double x;
     double y;
     cairo_text_extents_t textext;
-    cairo_text_extents(m_cr.get(), str.c_str(), &textext);
+    detail::text_extents(m_cr.get(), str, textext);
 
     cairo_get_current_point(m_cr.get(), &x, &y);
 
-    if (flags.is_set(TextDrawFlag::shadow))
+    if (flags.is_set(TextDrawFlag::shadow) && !low_fidelity())
     {
         AutoSaveRestore sr(*this);
 
-        cairo_move_to(m_cr.get(), x - textext.x_bearing + 5.,
-                      y - textext.y_bearing + 5.);
         cairo_set_source_rgba(m_cr.get(), 0, 0, 0, 0.2);
-        cairo_show_text(m_cr.get(), str.c_str());
+        detail::show_text(m_cr.get(), str, x - textext.x_bearing + 5.,
+                          y - textext.y_bearing + 5.);
         cairo_stroke(m_cr.get());
     }
 
     AutoSaveRestore sr(*this);
 
-    cairo_move_to(m_cr.get(), x - textext.x_bearing,
-                  y - textext.y_bearing);
-    cairo_show_text(m_cr.get(), str.c_str());
+    detail::show_text(m_cr.get(), str, x - textext.x_bearing,
+                      y - textext.y_bearing);
     cairo_stroke(m_cr.get());
 
     return *this;
@@ -179,7 +251,7 @@ Size Painter::text_size(const std::string& text)
         }
 
         cairo_text_extents_t textext;
-        cairo_text_extents(m_cr.get(), line, &textext);
+        detail::text_extents(m_cr.get(), line, textext);
         line_max_width = std::max(line_max_width, textext.width);
         ++n;
 
@@ -200,7 +272,21 @@ Painter& Painter::clip()
 
 Painter& Painter::fill()
 {
-    cairo_fill(m_cr.get());
+    if (!detail::rasterizer().fill(m_cr.get()))
+        cairo_fill(m_cr.get());
+
+    return *this;
+}
+
+Painter& Painter::fill(const RectF& rect)
+{
+    cairo_new_path(m_cr.get());
+
+    if (!detail::rasterizer().fill(m_cr.get(), rect))
+    {
+        cairo_rectangle(m_cr.get(), rect.x(), rect.y(), rect.width(), rect.height());
+        cairo_fill(m_cr.get());
+    }
 
     return *this;
 }
@@ -221,7 +307,8 @@ Painter& Painter::paint(float alpha)
 
 Painter& Painter::stroke()
 {
-    cairo_stroke(m_cr.get());
+    if (!detail::rasterizer().stroke(m_cr.get()))
+        cairo_stroke(m_cr.get());
 
     return *this;
 }
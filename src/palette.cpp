@@ -52,18 +52,15 @@ constexpr T find(T begin, T end, const Key& first)
 Palette& Palette::operator=(const PatternArray& colors)
 {
     m_colors = colors;
+    reindex();
     return *this;
 }
 
 const Pattern& Palette::color(ColorId id, GroupId group) const
 {
-    const auto g = detail::find(m_colors.begin(), m_colors.end(), group);
-    if (g != m_colors.end())
-    {
-        const auto c = detail::find(g->second.begin(), g->second.end(), id);
-        if (c != g->second.end())
-            return c->second;
-    }
+    const auto color = find(id, group);
+    if (color)
+        return *color;
 
     throw std::runtime_error(fmt::format("color not found in palette:{}/{}",
                                          group, id));
@@ -86,6 +83,8 @@ void Palette::set(ColorId id, GroupId group, const Pattern& color)
         m_colors.back().first = group;
         m_colors.back().second.emplace_back(id, color);
     }
+
+    reindex();
 }
 
 void Palette::set(ColorId id, const Pattern& color, GroupId group)
@@ -100,35 +99,31 @@ void Palette::clear(ColorId id, GroupId group)
     {
         const auto c = detail::find(g->second.begin(), g->second.end(), id);
         if (c != g->second.end())
+        {
             g->second.erase(c);
+            reindex();
+        }
     }
 }
 
 void Palette::clear()
 {
     m_colors.clear();
+    reindex();
 }
 
 bool Palette::exists(ColorId id, GroupId group) const
 {
-    const auto g = detail::find(m_colors.begin(), m_colors.end(), group);
-    if (g != m_colors.end())
-        return detail::find(g->second.begin(), g->second.end(), id) != g->second.end();
-
-    return false;
+    return find(id, group);
 }
 
 bool Palette::exists(ColorId id, GroupId group, const Pattern** color) const
 {
-    const auto g = detail::find(m_colors.begin(), m_colors.end(), group);
-    if (g != m_colors.end())
+    const auto c = find(id, group);
+    if (c)
     {
-        auto c = detail::find(g->second.begin(), g->second.end(), id);
-        if (c != g->second.end())
-        {
-            *color = &(c->second);
-            return true;
-        }
+        *color = c;
+        return true;
     }
 
     return false;
@@ -333,7 +328,7 @@ void Palette::serialize(const std::string& name, Serializer& serializer) const
     }
 }
 
-void Palette::deserialize(const std::string& name, const std::string& value,
+void Palette::deserialize(std::string_view name, const std::string& value,
                           const Serializer::Attributes& attrs)
 {
     detail::ignoreparam(name);
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/frame.h"
+#include "egt/painter.h"
+#include "egt/particles.h"
+#include <algorithm>
+#include <cairo.h>
+#include <cmath>
+#include <stdexcept>
+
+namespace egt
+{
+inline namespace v1
+{
+
+ParticleField::ParticleField(const Image& image, const Rect& rect)
+    : Widget(rect),
+      m_image(image)
+{
+    default_name("ParticleField", m_widgetid);
+    fill_flags().clear();
+}
+
+ParticleField::ParticleField(Frame& parent, const Image& image, const Rect& rect)
+    : ParticleField(image, rect)
+{
+    parent.add(*this);
+}
+
+Rect ParticleField::bounds(const Particle& particle) const
+{
+    if (m_image.empty() || particle.alpha <= 0.f || particle.scale <= 0.f)
+        return {};
+
+    const auto w = m_image.size().width() * particle.scale;
+    const auto h = m_image.size().height() * particle.scale;
+    const auto x = std::floor(particle.center.x() - w / 2.f);
+    const auto y = std::floor(particle.center.y() - h / 2.f);
+
+    // one more pixel for the fractional position
+    return {static_cast<DefaultDim>(x), static_cast<DefaultDim>(y),
+            static_cast<DefaultDim>(std::ceil(w)) + 1,
+            static_cast<DefaultDim>(std::ceil(h)) + 1};
+}
+
+void ParticleField::draw(Painter& painter, const Rect& rect)
+{
+    if (m_image.empty() || m_particles.empty())
+        return;
+
+    Painter::AutoSaveRestore sr(painter);
+
+    const auto origin = point();
+    const auto local = rect - origin;
+    const auto size = m_image.size();
+    auto cr = painter.context().get();
+
+    for (const auto& particle : m_particles)
+    {
+        if (!bounds(particle).intersect(local))
+            continue;
+
+        const PointF at(origin.x() + particle.center.x() - size.width() * particle.scale / 2.f,
+                        origin.y() + particle.center.y() - size.height() * particle.scale / 2.f);
+
+        if (particle.alpha >= 1.f && particle.scale == 1.f)
+        {
+            painter.draw(at);
+            painter.draw(m_image);
+            continue;
+        }
+
+        cairo_save(cr);
+        cairo_translate(cr, at.x(), at.y());
+        cairo_scale(cr, particle.scale, particle.scale);
+        cairo_rectangle(cr, 0, 0, size.width(), size.height());
+        cairo_clip(cr);
+        cairo_set_source(cr, m_image.pattern());
+        cairo_paint_with_alpha(cr, std::min(particle.alpha, 1.f));
+        cairo_restore(cr);
+    }
+}
+
+void ParticleField::image(const Image& image)
+{
+    m_image = image;
+
+    // the size of every particle changes
+    if (!m_particles.empty())
+        damage();
+}
+
+void ParticleField::flush_damage(const Screen::DamageArray& rects)
+{
+    const auto origin = point();
+    for (const auto& rect : rects)
+        damage(Rect::intersection(rect, Rect(Point(), box().size())) + origin);
+}
+
+void ParticleField::damage_changes(const std::vector<Particle>& before)
+{
+    Screen::DamageArray damage;
+
+    for (size_t i = 0; i < m_particles.size(); ++i)
+    {
+        const auto& a = before[i];
+        const auto& b = m_particles[i];
+        if (a.center == b.center && a.alpha == b.alpha && a.scale == b.scale)
+            continue;
+
+        const auto from = bounds(a);
+        const auto to = bounds(b);
+        if (!from.empty())
+            Screen::damage_algorithm(damage, from, m_cost);
+        if (!to.empty())
+            Screen::damage_algorithm(damage, to, m_cost);
+    }
+
+    flush_damage(damage);
+}
+
+size_t ParticleField::add(const Particle& particle)
+{
+    m_particles.push_back(particle);
+    Screen::DamageArray damage;
+    const auto to = bounds(particle);
+    if (!to.empty())
+        damage.push_back(to);
+    flush_damage(damage);
+    return m_particles.size() - 1;
+}
+
+void ParticleField::remove(size_t index)
+{
+    if (index >= m_particles.size())
+        return;
+
+    Screen::DamageArray damage;
+    const auto from = bounds(m_particles[index]);
+    if (!from.empty())
+        damage.push_back(from);
+
+    m_particles[index] = m_particles.back();
+    m_particles.pop_back();
+    flush_damage(damage);
+}
+
+void ParticleField::clear()
+{
+    if (m_particles.empty())
+        return;
+
+    Screen::DamageArray damage;
+    for (const auto& particle : m_particles)
+    {
+        const auto from = bounds(particle);
+        if (!from.empty())
+            Screen::damage_algorithm(damage, from, m_cost);
+    }
+
+    m_particles.clear();
+    flush_damage(damage);
+}
+
+void ParticleField::particle(size_t index, const Particle& particle)
+{
+    auto& current = m_particles.at(index);
+
+    Screen::DamageArray damage;
+    const auto from = bounds(current);
+    const auto to = bounds(particle);
+    if (!from.empty())
+        Screen::damage_algorithm(damage, from, m_cost);
+    if (!to.empty())
+        Screen::damage_algorithm(damage, to, m_cost);
+
+    current = particle;
+    flush_damage(damage);
+}
+
+void ParticleField::particles(std::vector<Particle> particles)
+{
+    if (particles.size() != m_particles.size())
+    {
+        clear();
+        m_particles = std::move(particles);
+
+        Screen::DamageArray damage;
+        for (const auto& particle : m_particles)
+        {
+            const auto to = bounds(particle);
+            if (!to.empty())
+                Screen::damage_algorithm(damage, to, m_cost);
+        }
+        flush_damage(damage);
+        return;
+    }
+
+    auto before = std::move(m_particles);
+    m_particles = std::move(particles);
+    damage_changes(before);
+}
+
+void ParticleField::update(const std::function<void(std::vector<Particle>& particles)>& func)
+{
+    const auto before = m_particles;
+    func(m_particles);
+    if (m_particles.size() != before.size())
+        throw std::runtime_error("particles added or removed by update()");
+    damage_changes(before);
+}
+
+}
+}
@@ -57,6 +57,12 @@ struct Pattern::PatternImpl
     Point m_end;
     /// Ending radius of the pattern.
     float m_end_radius{0};
+    /// Gradient of the steps, shared by copies.
+    shared_cairo_pattern_t m_gradient;
+    /// Start circle of a radial m_gradient, with the end one of radius 1 at (0, 0).
+    PointF m_gradient_start;
+    /// Radius of the start circle of a radial m_gradient.
+    float m_gradient_radius{0};
 };
 
 Pattern::Pattern(Type type, const StepArray& steps)
@@ -101,6 +107,9 @@ Pattern::Pattern(const Pattern& rhs)
         m_impl->m_start_radius = rhs.m_impl->m_start_radius;
         m_impl->m_end = rhs.m_impl->m_end;
         m_impl->m_end_radius = rhs.m_impl->m_end_radius;
+        m_impl->m_gradient = rhs.m_impl->m_gradient;
+        m_impl->m_gradient_start = rhs.m_impl->m_gradient_start;
+        m_impl->m_gradient_radius = rhs.m_impl->m_gradient_radius;
     }
 }
 
@@ -131,6 +140,9 @@ Pattern& Pattern::operator=(const Pattern& rhs)
             m_impl->m_start_radius = rhs.m_impl->m_start_radius;
             m_impl->m_end = rhs.m_impl->m_end;
             m_impl->m_end_radius = rhs.m_impl->m_end_radius;
+            m_impl->m_gradient = rhs.m_impl->m_gradient;
+            m_impl->m_gradient_start = rhs.m_impl->m_gradient_start;
+            m_impl->m_gradient_radius = rhs.m_impl->m_gradient_radius;
         }
         m_pattern = rhs.m_pattern;
     }
@@ -176,6 +188,7 @@ Pattern& Pattern::step(StepScaler offset, const Color& color)
     std::sort(m_impl->m_steps.begin(), m_impl->m_steps.end(), sort_by_first);
 
     m_pattern.reset();
+    m_impl->m_gradient.reset();
     return *this;
 }
 
@@ -252,6 +265,75 @@ const Pattern::StepArray& Pattern::steps() const
     throw std::runtime_error("pattern is not a solid color");
 }
 
+static void add_steps(cairo_pattern_t* pattern, const Pattern::StepArray& steps)
+{
+    for (const auto& step : steps)
+    {
+        cairo_pattern_add_color_stop_rgba(pattern,
+                                          step.first,
+                                          step.second.redf(),
+                                          step.second.greenf(),
+                                          step.second.bluef(),
+                                          step.second.alphaf());
+    }
+}
+
+cairo_pattern_t* Pattern::gradient(cairo_matrix_t& matrix) const
+{
+    if (m_type == Type::solid || !m_impl)
+        return nullptr;
+
+    const auto start = starting();
+    const auto end = ending();
+
+    if (m_type == Type::radial)
+    {
+        // the end circle is the unit one, so only the start circle changes it
+        const auto radius = ending_radius();
+        if (detail::float_equal(radius, 0))
+            return nullptr;
+
+        const PointF gradient_start((start.x() - end.x()) / radius,
+                                    (start.y() - end.y()) / radius);
+        const auto gradient_radius = starting_radius() / radius;
+
+        if (!m_impl->m_gradient ||
+            !detail::float_equal(m_impl->m_gradient_start.x(), gradient_start.x()) ||
+            !detail::float_equal(m_impl->m_gradient_start.y(), gradient_start.y()) ||
+            !detail::float_equal(m_impl->m_gradient_radius, gradient_radius))
+        {
+            m_impl->m_gradient =
+                shared_cairo_pattern_t(cairo_pattern_create_radial(gradient_start.x(),
+                                       gradient_start.y(),
+                                       gradient_radius,
+                                       0, 0, 1),
+                                       cairo_pattern_destroy);
+            add_steps(m_impl->m_gradient.get(), steps());
+            m_impl->m_gradient_start = gradient_start;
+            m_impl->m_gradient_radius = gradient_radius;
+        }
+
+        cairo_matrix_init(&matrix, radius, 0, 0, radius, end.x(), end.y());
+        return m_impl->m_gradient.get();
+    }
+
+    // (1, 0) goes to the end, and (0, 1) to the perpendicular of the same length
+    const auto d = end - start;
+    if (d.x() == 0 && d.y() == 0)
+        return nullptr;
+
+    if (!m_impl->m_gradient)
+    {
+        m_impl->m_gradient =
+            shared_cairo_pattern_t(cairo_pattern_create_linear(0, 0, 1, 0),
+                                   cairo_pattern_destroy);
+        add_steps(m_impl->m_gradient.get(), steps());
+    }
+
+    cairo_matrix_init(&matrix, d.x(), d.y(), -d.y(), d.x(), start.x(), start.y());
+    return m_impl->m_gradient.get();
+}
+
 void Pattern::create_pattern() const
 {
     switch (type())
@@ -265,16 +347,7 @@ void Pattern::create_pattern() const
                                    ending().x(),
                                    ending().y()),
                                    cairo_pattern_destroy);
-
-        for (const auto& step : steps())
-        {
-            cairo_pattern_add_color_stop_rgba(m_pattern.get(),
-                                              step.first,
-                                              step.second.redf(),
-                                              step.second.greenf(),
-                                              step.second.bluef(),
-                                              step.second.alphaf());
-        }
+        add_steps(m_pattern.get(), steps());
         break;
     }
     case Pattern::Type::radial:
@@ -287,15 +360,7 @@ void Pattern::create_pattern() const
                                    ending().y(),
                                    ending_radius()),
                                    cairo_pattern_destroy);
-        for (const auto& step : steps())
-        {
-            cairo_pattern_add_color_stop_rgba(m_pattern.get(),
-                                              step.first,
-                                              step.second.redf(),
-                                              step.second.greenf(),
-                                              step.second.bluef(),
-                                              step.second.alphaf());
-        }
+        add_steps(m_pattern.get(), steps());
         break;
     }
     case Pattern::Type::solid:
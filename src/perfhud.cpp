@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/fmt.h"
+#include "egt/app.h"
+#include "egt/painter.h"
+#include "egt/perfhud.h"
+#include "egt/profiler.h"
+#include <algorithm>
+
+namespace egt
+{
+inline namespace v1
+{
+namespace experimental
+{
+
+/// Work time of a frame at 60 fps, where the graph turns red.
+static constexpr float FRAME_BUDGET = 1000.f / 60.f;
+
+PerfHud::PerfHud(const Rect& rect, std::chrono::milliseconds interval)
+    : Window(rect, PixelFormat::argb8888, WindowHint::overlay),
+      m_sampler(interval)
+{
+    name("PerfHud");
+    fill_flags(Theme::FillFlag::solid);
+    color(Palette::ColorId::bg, Color(0x000000c0));
+
+    if (!plane_window())
+    {
+        EGTLOG_DEBUG("no overlay plane, the hud is composed with the main window");
+        if (Application::instance().main_window())
+            Application::instance().main_window()->add(*this);
+    }
+
+    if (!Profiler::instance().enabled())
+    {
+        Profiler::instance().enable(true);
+        m_profiler = true;
+    }
+
+    m_sampler.on_update([this](const SystemMetrics&)
+    {
+        update();
+    });
+    m_sampler.start();
+}
+
+void PerfHud::update()
+{
+    float total = 0;
+    float flip = 0;
+    size_t count = 0;
+    size_t flips = 0;
+    m_frame_max = 0;
+
+    for (const auto& record : Profiler::instance().frames())
+    {
+        if (record.frame <= m_last_frame)
+            continue;
+        m_last_frame = record.frame;
+
+        const std::chrono::duration<float, std::milli> work =
+            record.phase(Profiler::Phase::layout) +
+            record.phase(Profiler::Phase::draw) +
+            record.phase(Profiler::Phase::copy);
+        m_frame_times[m_next] = work.count();
+        m_next = (m_next + 1) % HISTORY;
+
+        total += work.count();
+        m_frame_max = std::max(m_frame_max, work.count());
+        ++count;
+
+        const std::chrono::duration<float, std::milli> latency =
+            record.phase(Profiler::Phase::flip);
+        if (latency.count() > 0)
+        {
+            flip += latency.count();
+            ++flips;
+        }
+    }
+
+    m_frame_mean = count ? total / count : 0;
+    m_flip_mean = flips ? flip / flips : 0;
+
+    damage();
+}
+
+void PerfHud::draw(Painter& painter, const Rect& rect)
+{
+    Window::draw(painter, rect);
+
+    Painter::AutoSaveRestore sr(painter);
+
+    // like Widget::draw(), without a screen the origin is the parent's
+    const auto origin = has_screen() ? Point() : point();
+    const auto& metrics = m_sampler.metrics();
+
+    const std::string lines[] =
+    {
+        fmt::format("{:.0f} fps  frame {:.1f}/{:.1f} ms", metrics.fps, m_frame_mean, m_frame_max),
+        fmt::format("damage {:.1f}k px  flip {:.1f} ms", metrics.damaged_pixels / 1000., m_flip_mean),
+        metrics.gpu < 0 ?
+        fmt::format("cpu {:.0f}%  heap {:.1f} MB", metrics.cpu, metrics.heap / 1048576.) :
+        fmt::format("cpu {:.0f}%  gpu {:.0f}%  heap {:.1f} MB", metrics.cpu, metrics.gpu,
+                    metrics.heap / 1048576.),
+    };
+
+    static const Font font(12);
+    painter.set(font);
+    painter.set(Palette::white);
+
+    auto y = origin.y() + 4;
+    for (const auto& line : lines)
+    {
+        painter.draw(Point(origin.x() + 4, y));
+        painter.draw(line);
+        y += 16;
+    }
+
+    // frame times, oldest first, scaled so twice the budget is full height
+    const auto graph = Rect(origin.x() + 4, y + 2,
+                            width() - 8, origin.y() + height() - y - 6);
+    if (graph.empty())
+        return;
+
+    const auto bar = std::max(1.f, static_cast<float>(graph.width()) / HISTORY);
+    const auto scale = graph.height() / (2 * FRAME_BUDGET);
+    for (size_t i = 0; i < HISTORY; ++i)
+    {
+        const auto time = m_frame_times[(m_next + i) % HISTORY];
+        if (time <= 0)
+            continue;
+
+        const auto h = std::min(static_cast<float>(graph.height()), time * scale);
+        painter.set(time > FRAME_BUDGET ? Palette::red : Palette::green);
+        painter.draw(RectF(graph.x() + i * bar, graph.bottom() - h, bar, h));
+        painter.fill();
+    }
+
+    painter.set(Palette::yellow);
+    painter.line_width(1);
+    const auto budget = graph.bottom() - FRAME_BUDGET * scale;
+    painter.draw(PointF(graph.x(), budget), PointF(graph.right(), budget));
+    painter.stroke();
+}
+
+PerfHud::~PerfHud() noexcept
+{
+    m_sampler.stop();
+
+    if (m_profiler)
+        Profiler::instance().enable(false);
+}
+
+}
+}
+}
@@ -0,0 +1,559 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/alloccount.h"
+#include "detail/egtlog.h"
+#include "detail/fmt.h"
+#include "egt/profiler.h"
+#include "egt/widget.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+namespace egt
+{
+inline namespace v1
+{
+
+namespace
+{
+
+/**
+ * Ring of records written by one thread, and read by any thread.
+ *
+ * Every slot is protected by a sequence count, odd while it is being
+ * written, so readers retry instead of returning a torn record.
+ */
+template<class T, size_t N>
+class SeqRing
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "records must be trivially copyable");
+
+public:
+
+    /// Append a record.
+    void push(const T& value)
+    {
+        const auto index = m_count.load(std::memory_order_relaxed);
+        write(index, value);
+        m_count.store(index + 1, std::memory_order_release);
+    }
+
+    /// Replace a record that is still in the ring.
+    void write(uint64_t index, const T& value)
+    {
+        auto& slot = m_slots[index % N];
+        const auto seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.index = index;
+        std::memcpy(&slot.value, &value, sizeof(T));
+        slot.seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /// Read a record, returns false if it is no longer in the ring.
+    bool read(uint64_t index, T& value) const
+    {
+        const auto& slot = m_slots[index % N];
+        while (true)
+        {
+            const auto seq = slot.seq.load(std::memory_order_acquire);
+            if (seq & 1)
+                continue;
+
+            const auto slot_index = slot.index;
+            std::memcpy(&value, &slot.value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.seq.load(std::memory_order_relaxed) == seq)
+                return slot_index == index;
+        }
+    }
+
+    /// Get all records in the ring, oldest first.
+    std::vector<T> snapshot() const
+    {
+        const auto count = m_count.load(std::memory_order_acquire);
+        const auto first = count > N ? count - N : 0;
+
+        std::vector<T> result;
+        result.reserve(count - first);
+        T value;
+        for (auto i = first; i < count; ++i)
+            if (read(i, value))
+                result.push_back(value);
+        return result;
+    }
+
+    void clear()
+    {
+        m_count.store(0, std::memory_order_release);
+    }
+
+private:
+
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};
+        uint64_t index{0};
+        T value{};
+    };
+
+    std::array<Slot, N> m_slots{};
+    std::atomic<uint64_t> m_count{0};
+};
+
+constexpr const char* phase_name(Profiler::Phase phase)
+{
+    switch (phase)
+    {
+    case Profiler::Phase::wait:
+        return "wait";
+    case Profiler::Phase::layout:
+        return "layout";
+    case Profiler::Phase::draw:
+        return "draw";
+    case Profiler::Phase::copy:
+        return "copy";
+    case Profiler::Phase::flip:
+        return "flip";
+    }
+    return "";
+}
+
+inline size_t phase_index(Profiler::Phase phase)
+{
+    return static_cast<size_t>(phase);
+}
+
+void write_json_string(std::ostream& out, const char* str)
+{
+    out << '"';
+    for (; *str; ++str)
+    {
+        const auto c = *str;
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            out << fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+inline double to_us(Profiler::Clock::time_point t)
+{
+    return std::chrono::duration<double, std::micro>(t.time_since_epoch()).count();
+}
+
+inline double to_us(std::chrono::nanoseconds d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+}
+
+struct Profiler::ProfilerImpl
+{
+    /// A scope that has not ended yet.
+    struct Open
+    {
+        Phase phase;
+        const Widget* widget;
+        Clock::time_point start;
+        uint64_t allocs;
+        uint32_t depth;
+    };
+
+    /// A flip that has not completed yet.
+    struct Pending
+    {
+        const void* source;
+        uint64_t frame;
+        Clock::time_point scheduled;
+    };
+
+    /// Add the time and allocations since the last change of phase to the current phase.
+    void account(Clock::time_point now, uint64_t allocs)
+    {
+        if (!stack.empty())
+        {
+            const auto index = phase_index(stack.back().phase);
+            current.time[index] += now - mark;
+            current.allocs[index] += allocs - alloc_mark;
+        }
+        mark = now;
+        alloc_mark = allocs;
+    }
+
+    /// Do not count the allocations of the profiler itself.
+    void skip_allocations()
+    {
+        alloc_mark = detail::allocation_count();
+    }
+
+    std::vector<Open> stack;
+    std::vector<Pending> pending;
+    Clock::time_point mark{};
+    uint64_t alloc_mark{0};
+    FrameRecord current{};
+    uint64_t frame{1};
+    std::thread::id thread;
+    SeqRing<FrameRecord, 256> frames;
+    SeqRing<Event, 4096> events;
+    std::unordered_map<std::string, Histogram> histograms;
+    Histogram latency;
+};
+
+void Profiler::Histogram::add(std::chrono::nanoseconds duration)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    size_t bucket = 0;
+    while (us > 0 && bucket < BUCKET_COUNT - 1)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+
+    ++buckets[bucket];
+    ++count;
+    total += duration;
+    max = std::max(max, duration);
+}
+
+Profiler& Profiler::instance()
+{
+    static const std::unique_ptr<Profiler> i(new Profiler());
+    return *i;
+}
+
+Profiler::Profiler()
+    : m_impl(std::make_unique<ProfilerImpl>())
+{
+    const auto file = std::getenv("EGT_PROFILE");
+    if (file && strlen(file))
+        enable(true);
+
+    const auto budget = std::getenv("EGT_ALLOC_BUDGET");
+    if (budget && strlen(budget))
+    {
+        char* end = nullptr;
+        const auto count = std::strtoull(budget, &end, 10);
+        const auto action = std::strcmp(end, ":fail") ? BudgetAction::warn : BudgetAction::fail;
+        if (count)
+        {
+            allocation_budget(count, action);
+            enable(true);
+        }
+    }
+}
+
+Profiler::~Profiler() noexcept = default;
+
+void Profiler::enable(bool value)
+{
+    if (value)
+    {
+        m_impl->stack.reserve(64);
+        m_impl->pending.reserve(8);
+        m_impl->thread = std::this_thread::get_id();
+    }
+
+    m_enabled.store(value, std::memory_order_relaxed);
+}
+
+bool Profiler::allocation_counting()
+{
+    return detail::allocation_counting();
+}
+
+void Profiler::allocation_budget(uint64_t count, BudgetAction action)
+{
+    if (count && !allocation_counting())
+        EGTLOG_WARN("allocation budget set, but allocation counting is not built in");
+
+    m_budget = count;
+    m_budget_action = action;
+}
+
+std::vector<Profiler::FrameRecord> Profiler::frames() const
+{
+    return m_impl->frames.snapshot();
+}
+
+std::vector<Profiler::Event> Profiler::events() const
+{
+    return m_impl->events.snapshot();
+}
+
+std::map<std::string, Profiler::Histogram> Profiler::histograms() const
+{
+    return {m_impl->histograms.begin(), m_impl->histograms.end()};
+}
+
+Profiler::Histogram Profiler::input_latency() const
+{
+    return m_impl->latency;
+}
+
+void Profiler::reset()
+{
+    m_impl->latency = {};
+    m_impl->frames.clear();
+    m_impl->events.clear();
+    m_impl->histograms.clear();
+    m_impl->pending.clear();
+    m_impl->current = {};
+    m_impl->frame = 1;
+}
+
+bool Profiler::begin(Phase phase, const Widget* widget)
+{
+    auto& impl = *m_impl;
+    if (std::this_thread::get_id() != impl.thread)
+        return false;
+
+    const auto now = Clock::now();
+    const auto allocs = detail::allocation_count();
+
+    impl.account(now, allocs);
+
+    if (impl.current.start == Clock::time_point())
+        impl.current.start = now;
+
+    // nested scopes of the same phase, like layout, are one event
+    if (!widget && !impl.stack.empty())
+    {
+        auto& top = impl.stack.back();
+        if (top.phase == phase && !top.widget)
+        {
+            ++top.depth;
+            return true;
+        }
+    }
+
+    impl.stack.push_back({phase, widget, now, allocs, 1});
+    impl.skip_allocations();
+    return true;
+}
+
+void Profiler::end()
+{
+    auto& impl = *m_impl;
+    if (impl.stack.empty())
+        return;
+
+    const auto now = Clock::now();
+    const auto allocs = detail::allocation_count();
+    impl.account(now, allocs);
+
+    auto& top = impl.stack.back();
+    if (--top.depth)
+        return;
+
+    Event event;
+    event.frame = impl.frame;
+    event.phase = top.phase;
+    event.start = top.start;
+    event.duration = now - top.start;
+    event.allocs = allocs - top.allocs;
+
+    if (top.widget)
+    {
+        const auto& name = top.widget->name();
+        std::strncpy(event.name, name.c_str(), sizeof(event.name) - 1);
+        impl.histograms[name].add(event.duration);
+        ++impl.current.draws;
+    }
+
+    impl.events.push(event);
+    impl.stack.pop_back();
+    impl.skip_allocations();
+}
+
+void Profiler::end_frame()
+{
+    if (!enabled())
+        return;
+
+    auto& impl = *m_impl;
+
+    // nothing drawn, so this is still waiting for the next frame
+    if (!impl.current.draws &&
+        impl.current.time[phase_index(Phase::copy)] == std::chrono::nanoseconds())
+        return;
+
+    impl.current.frame = impl.frame;
+    impl.current.end = Clock::now();
+
+    // a flip that is still pending ends the latency when it completes
+    if (impl.current.input != Clock::time_point() &&
+        impl.current.latency == std::chrono::nanoseconds())
+    {
+        const auto frame = impl.frame;
+        const auto pending = std::any_of(impl.pending.begin(), impl.pending.end(),
+                                         [frame](const ProfilerImpl::Pending & p)
+        {
+            return p.frame == frame;
+        });
+        if (!pending)
+            impl.current.latency = impl.current.end - impl.current.input;
+    }
+
+    if (impl.current.latency != std::chrono::nanoseconds())
+        impl.latency.add(impl.current.latency);
+
+    ++impl.frame;
+    impl.frames.push(impl.current);
+
+    const auto record = impl.current;
+    impl.current = {};
+
+    if (m_budget && record.allocations() > m_budget)
+    {
+        const auto message =
+            fmt::format("frame {} made {} allocations, over its budget of {} "
+                        "(wait {}, layout {}, draw {}, copy {})",
+                        record.frame, record.allocations(), m_budget,
+                        record.allocations(Phase::wait),
+                        record.allocations(Phase::layout),
+                        record.allocations(Phase::draw),
+                        record.allocations(Phase::copy));
+
+        if (m_budget_action == BudgetAction::fail)
+            throw std::runtime_error(message);
+
+        EGTLOG_WARN("{}", message);
+    }
+}
+
+void Profiler::input(Clock::time_point when)
+{
+    if (!enabled())
+        return;
+
+    auto& impl = *m_impl;
+    if (impl.current.input == Clock::time_point() || when < impl.current.input)
+        impl.current.input = when;
+}
+
+void Profiler::count_size_hint()
+{
+    ++m_impl->current.size_hints;
+}
+
+void Profiler::flip_scheduled(const void* source)
+{
+    if (!enabled())
+        return;
+
+    auto& impl = *m_impl;
+
+    // a source that never completes its flips should not grow this forever
+    if (impl.pending.size() >= 8)
+        impl.pending.erase(impl.pending.begin());
+
+    impl.pending.push_back({source, impl.frame, Clock::now()});
+}
+
+void Profiler::flip_completed(const void* source, Clock::time_point when)
+{
+    if (!enabled())
+        return;
+
+    auto& impl = *m_impl;
+
+    auto i = std::find_if(impl.pending.begin(), impl.pending.end(),
+                          [source](const ProfilerImpl::Pending & p)
+    {
+        return p.source == source;
+    });
+
+    if (i == impl.pending.end())
+        return;
+
+    const auto pending = *i;
+    impl.pending.erase(i);
+
+    const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(when - pending.scheduled);
+
+    Event event;
+    event.frame = pending.frame;
+    event.phase = Phase::flip;
+    event.start = pending.scheduled;
+    event.duration = latency;
+    impl.events.push(event);
+
+    if (pending.frame == impl.frame)
+    {
+        impl.current.time[phase_index(Phase::flip)] += latency;
+        if (impl.current.input != Clock::time_point() &&
+            impl.current.latency == std::chrono::nanoseconds())
+            impl.current.latency = when - impl.current.input;
+        return;
+    }
+
+    // frames are numbered from 1 in the order they are pushed
+    FrameRecord record;
+    if (impl.frames.read(pending.frame - 1, record))
+    {
+        record.time[phase_index(Phase::flip)] += latency;
+        if (record.input != Clock::time_point() &&
+            record.latency == std::chrono::nanoseconds())
+        {
+            record.latency = when - record.input;
+            impl.latency.add(record.latency);
+        }
+        impl.frames.write(pending.frame - 1, record);
+    }
+}
+
+void Profiler::write_trace(std::ostream& out) const
+{
+    out << "{\"traceEvents\":[";
+
+    auto first = true;
+    for (const auto& event : events())
+    {
+        if (!first)
+            out << ',';
+        first = false;
+
+        out << "\n{\"name\":";
+        write_json_string(out, event.name[0] ? event.name : phase_name(event.phase));
+        // flips complete asynchronously, so they get their own track
+        out << fmt::format(",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},"
+                           "\"pid\":1,\"tid\":{},\"args\":{{\"frame\":{},\"allocs\":{}}}}}",
+                           phase_name(event.phase),
+                           to_us(event.start),
+                           to_us(event.duration),
+                           event.phase == Phase::flip ? 2 : 1,
+                           event.frame,
+                           event.allocs);
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void Profiler::write_trace(const std::string& filename) const
+{
+    std::ofstream out(filename);
+    if (!out.is_open())
+        throw std::runtime_error(fmt::format("unable to open trace file: {}", filename));
+
+    write_trace(out);
+    EGTLOG_INFO("wrote profiler trace to {}", filename);
+}
+
+}
+}
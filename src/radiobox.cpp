@@ -18,7 +18,7 @@ RadioBox::RadioBox(const std::string& text,
                    const Rect& rect) noexcept
     : Switch(text, rect)
 {
-    name("RadioBox" + std::to_string(m_widgetid));
+    default_name("RadioBox", m_widgetid);
 }
 
 RadioBox::RadioBox(Frame& parent,
@@ -31,6 +31,9 @@ RadioBox::RadioBox(Frame& parent,
 
 void RadioBox::draw(Painter& painter, const Rect& rect)
 {
+    if (draw_state(painter, rect))
+        return;
+
     Drawer<RadioBox>::draw(*this, painter, rect);
 }
 
@@ -11,6 +11,7 @@
 #include "egt/detail/image.h"
 #include "egt/detail/meta.h"
 #include "egt/resource.h"
+#include <algorithm>
 #include <cstring>
 #include <memory>
 
@@ -23,36 +24,130 @@ namespace egt
 inline namespace v1
 {
 
+struct ResourceStream::StreamImpl
+{
+    const unsigned char* data{nullptr};
+    size_t len{0};
+    size_t offset{0};
+#ifdef HAVE_ZLIB
+    bool compressed{false};
+    bool end{false};
+    z_stream stream{};
+#endif
+};
+
+ResourceStream::ResourceStream(const unsigned char* data, size_t len)
+    : m_impl(std::make_unique<StreamImpl>())
+{
+    m_impl->data = data;
+    m_impl->len = len;
+
+#ifdef HAVE_ZLIB
+    if (detail::get_mime_type(data, len) == "application/gzip")
+    {
+        m_impl->stream.zalloc = Z_NULL;
+        m_impl->stream.zfree = Z_NULL;
+        m_impl->stream.opaque = Z_NULL;
+        if (inflateInit2(&m_impl->stream, 15 + 32) == Z_OK)
+            m_impl->compressed = true;
+        else
+            detail::warn("failed to init zlib inflate");
+    }
+#endif
+
+    reset();
+}
+
+ResourceStream::ResourceStream(ResourceStream&&) noexcept = default;
+ResourceStream& ResourceStream::operator=(ResourceStream&&) noexcept = default;
+
+ResourceStream::~ResourceStream() noexcept
+{
+#ifdef HAVE_ZLIB
+    if (m_impl && m_impl->compressed)
+        inflateEnd(&m_impl->stream);
+#endif
+}
+
+size_t ResourceStream::read(unsigned char* data, size_t length)
+{
+#ifdef HAVE_ZLIB
+    if (m_impl->compressed)
+    {
+        auto& stream = m_impl->stream;
+        stream.next_out = reinterpret_cast<Bytef*>(data);
+        stream.avail_out = length;
+
+        while (stream.avail_out && !m_impl->end)
+        {
+            const auto res = inflate(&stream, Z_NO_FLUSH);
+            if (res == Z_STREAM_END)
+                m_impl->end = true;
+            else if (res != Z_OK)
+                throw std::runtime_error("failed to inflate resource: " + std::to_string(res));
+        }
+
+        return length - stream.avail_out;
+    }
+#endif
+
+    const auto count = std::min(length, m_impl->len - m_impl->offset);
+    memcpy(data, m_impl->data + m_impl->offset, count);
+    m_impl->offset += count;
+    return count;
+}
+
+void ResourceStream::reset()
+{
+    m_impl->offset = 0;
+
+#ifdef HAVE_ZLIB
+    if (m_impl->compressed)
+    {
+        inflateReset(&m_impl->stream);
+        m_impl->stream.next_in = const_cast<Bytef*>(m_impl->data);
+        m_impl->stream.avail_in = m_impl->len;
+        m_impl->end = false;
+    }
+#endif
+}
+
+bool ResourceStream::compressed() const
+{
+#ifdef HAVE_ZLIB
+    return m_impl->compressed;
+#else
+    return false;
+#endif
+}
+
 // NOLINTNEXTLINE(hicpp-special-member-functions, cppcoreguidelines-special-member-functions)
 struct ResourceManager::ResourceItem
 {
     ResourceItem() = delete;
 
     ResourceItem(const unsigned char* data, size_t len) noexcept
-        : m_data(data),
+        : m_raw(data),
+          m_raw_len(len),
+          m_data(data),
           m_len(len)
     {}
 
     explicit ResourceItem(std::vector<unsigned char> data)
         : m_data_copy(std::move(data)),
-          m_data(m_data_copy.data()),
-          m_len(m_data_copy.size())
+          m_raw(m_data_copy.data()),
+          m_raw_len(m_data_copy.size()),
+          m_data(m_raw),
+          m_len(m_raw_len)
     {}
 
     ResourceItem(const ResourceItem& rhs)
-        : m_data_copy(rhs.m_data_copy)
-    {
-        if (!m_data_copy.empty())
-        {
-            m_data = m_data_copy.data();
-            m_len = m_data_copy.size();
-        }
-        else
-        {
-            m_data = rhs.m_data;
-            m_len = rhs.m_len;
-        }
-    }
+        : m_data_copy(rhs.m_data_copy),
+          m_raw(m_data_copy.empty() ? rhs.m_raw : m_data_copy.data()),
+          m_raw_len(rhs.m_raw_len),
+          m_data(m_raw),
+          m_len(m_raw_len)
+    {}
 
     ResourceItem& operator=(const ResourceItem&) = delete;
     ResourceItem(ResourceItem&&) = default;
@@ -70,72 +165,77 @@ struct ResourceManager::ResourceItem
         return m_len;
     }
 
+    /// Is the data compressed, and not decompressed yet.
+    bool compressed()
+    {
+        if (m_inflated)
+            return false;
+
+        if (!m_checked)
+        {
+            m_checked = true;
+            m_compressed = ResourceStream(m_raw, m_raw_len).compressed();
+        }
+
+        return m_compressed;
+    }
+
+    /// Open a stream of the data, decompressed or not.
+    std::unique_ptr<ResourceStream> open() const
+    {
+        return std::make_unique<ResourceStream>(m_data, m_len);
+    }
+
     size_t index{0};
 
+    /// Stream of stream_read() while the data is compressed.
+    std::unique_ptr<ResourceStream> stream;
+
 private:
 
     void do_inflate()
     {
-#ifdef HAVE_ZLIB
         if (m_inflated)
             return;
-        m_inflated = true;
-
-        auto mimetype = detail::get_mime_type(m_data, m_len);
-        if (mimetype != "application/gzip")
-            return;
 
-        z_stream stream{};
-        stream.zalloc = Z_NULL;
-        stream.zfree = Z_NULL;
-        stream.opaque = Z_NULL;
-        if (inflateInit2(&stream, 15 + 32) != Z_OK)
-        {
-            detail::warn("failed to init zlib inflate");
+        const auto inflate = compressed();
+        m_inflated = true;
+        if (!inflate)
             return;
-        }
 
-        stream.next_in = (Bytef*)m_data;
-        stream.avail_in = m_len;
-
-        const size_t BUFSIZE = 8 * 1024;
-        unsigned char buffer[BUFSIZE];
-        int res;
-        do
+        std::vector<unsigned char> buf;
+        try
         {
-            stream.next_out = reinterpret_cast<Bytef*>(buffer);
-            stream.avail_out = BUFSIZE;
-
-            res = inflate(&stream, Z_NO_FLUSH);
-
-            if (m_buf.size() < stream.total_out)
-                m_buf.insert(m_buf.end(),
-                             buffer,
-                             buffer + stream.total_out - m_buf.size());
-
-        } while (res == Z_OK);
+            ResourceStream stream(m_raw, m_raw_len);
 
-        inflateEnd(&stream);
-
-        if (res != Z_STREAM_END)
+            const size_t BUFSIZE = 8 * 1024;
+            unsigned char buffer[BUFSIZE];
+            size_t count;
+            while ((count = stream.read(buffer, BUFSIZE)) > 0)
+                buf.insert(buf.end(), buffer, buffer + count);
+        }
+        catch (const std::exception& e)
         {
-            detail::warn("failed to finish zlib inflate: {}", res);
+            detail::warn("{}", e.what());
             return;
         }
 
+        m_buf = std::move(buf);
         m_data = m_buf.data();
         m_len = m_buf.size();
-        m_data_copy.clear();
-#endif
     }
 
     std::vector<unsigned char> m_data_copy;
+    /// The data as registered, possibly compressed.
+    const unsigned char* m_raw{nullptr};
+    size_t m_raw_len{0};
+    /// The data, decompressed once needed.
     const unsigned char* m_data{nullptr};
     size_t m_len{0};
     std::vector<unsigned char> m_buf;
-#ifdef HAVE_ZLIB
-    bool m_inflated {false};
-#endif
+    bool m_inflated{false};
+    bool m_checked{false};
+    bool m_compressed{false};
 };
 
 ResourceManager::ResourceManager() = default;
@@ -198,11 +298,32 @@ bool ResourceManager::read(const char* name, unsigned char* data,
     return false;
 }
 
+bool ResourceManager::compressed(const char* name)
+{
+    const auto i = m_resources.find(name);
+    if (i != m_resources.end())
+        return i->second.compressed();
+
+    return false;
+}
+
+std::unique_ptr<ResourceStream> ResourceManager::open(const char* name)
+{
+    const auto i = m_resources.find(name);
+    if (i != m_resources.end())
+        return i->second.open();
+
+    return nullptr;
+}
+
 void ResourceManager::stream_reset(const char* name)
 {
     const auto i = m_resources.find(name);
     if (i != m_resources.end())
+    {
         i->second.index = 0;
+        i->second.stream = nullptr;
+    }
 }
 
 bool ResourceManager::stream_read(const char* name, unsigned char* data,
@@ -211,6 +332,18 @@ bool ResourceManager::stream_read(const char* name, unsigned char* data,
     const auto i = m_resources.find(name);
     if (i != m_resources.end())
     {
+        if (i->second.stream || i->second.compressed())
+        {
+            // decompressed as it is read, instead of whole
+            if (!i->second.stream)
+                i->second.stream = i->second.open();
+
+            if (i->second.stream->read(data, length) != length)
+                throw std::runtime_error("read past end of data on resource");
+
+            return true;
+        }
+
         if ((i->second.index + length) > i->second.len())
             throw std::runtime_error("read past end of data on resource");
 
@@ -238,6 +371,15 @@ ResourceManager::ItemArray ResourceManager::list() const
     return extract_keys(m_resources);
 }
 
+ResourceManager::ItemArray ResourceManager::list(const std::string& prefix) const
+{
+    ItemArray ret;
+    for (auto i = m_resources.lower_bound(prefix);
+         i != m_resources.end() && i->first.compare(0, prefix.size(), prefix) == 0; ++i)
+        ret.push_back(i->first);
+    return ret;
+}
+
 void ResourceManager::add(const char* name, const unsigned char* data, size_t len)
 {
     if (exists(name))
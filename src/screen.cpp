@@ -8,11 +8,18 @@
 #endif
 
 #include "detail/dump.h"
+#include "detail/egtlog.h"
 #include "egt/color.h"
+#include "egt/detail/drawdiagnostics.h"
+#include "egt/detail/math.h"
+#include "egt/detail/pixelops.h"
+#include "egt/detail/placement.h"
 #include "egt/palette.h"
+#include "egt/profiler.h"
 #include "egt/screen.h"
 #include "egt/types.h"
 #include "egt/utils.h"
+#include <algorithm>
 #include <cairo.h>
 #include <cassert>
 #include <cstring>
@@ -32,36 +39,110 @@ Screen::Screen() noexcept
 {
     if (getenv("EGT_SCREEN_ASYNC_FLIP"))
         m_async = true;
+
+    const auto mode = getenv("EGT_DAMAGE_MODE");
+    if (mode && std::string(mode) == "cost")
+        m_damage_mode = DamageMode::cost;
+}
+
+/// Formats with 8 bits per pixel, converted from the composition buffer.
+static inline bool is_8bpp(PixelFormat format)
+{
+    return format == PixelFormat::l8 ||
+           format == PixelFormat::rgb332 ||
+           format == PixelFormat::c8;
+}
+
+static inline uint64_t damage_pixels(const Screen::DamageArray& damage)
+{
+    uint64_t pixels = 0;
+    for (const auto& rect : damage)
+        pixels += static_cast<uint64_t>(rect.width()) * rect.height();
+    return pixels;
 }
 
 void Screen::flip(const DamageArray& damage)
 {
-    if (!damage.empty() && index() < m_buffers.size())
-    {
-        // save the damage to all buffers
-        for (auto& b : m_buffers)
-            for (const auto& d : damage)
-                b.add_damage(d);
+    if (!damage.empty())
+        on_damage.invoke(damage);
 
+    if (damage.empty() || index() >= m_buffers.size())
+        return;
+
+    Profiler::Scope scope(Profiler::Phase::copy);
+
+    ScreenBuffer& buffer = m_buffers[index()];
+
+    if (m_zero_copy)
+    {
+        // the frame, including what the buffer missed, is already drawn
+        cairo_surface_flush(m_surface.get());
+    }
+    else
+    {
         detail::code_timer(false, "copy_to_buffer: ", [&]()
         {
-            ScreenBuffer& buffer = m_buffers[index()];
+            buffer.damage.clear();
+            add_missed_damage(buffer.damage, buffer);
+            for (const auto& d : damage)
+                add_damage(buffer.damage, d);
+
             if ((m_format == PixelFormat::rgb565) ||
                 (m_format == PixelFormat::argb8888) ||
                 (m_format == PixelFormat::xrgb8888))
             {
                 copy_to_buffer(buffer);
             }
+            else if (is_8bpp(m_format))
+            {
+                copy_to_buffer_8bpp(buffer);
+            }
             else
             {
                 throw std::runtime_error("invalid pixelformat: cario supports only RGB formats");
             }
-            // delete all damage from current buffer
+
+            m_flip_stats.copied_pixels += damage_pixels(buffer.damage);
             buffer.damage.clear();
         });
+    }
+
+    m_flip_stats.frames++;
+    m_flip_stats.damaged_pixels += damage_pixels(damage);
+
+    // keep the damage of this frame for the buffers that miss it
+    buffer.frame = ++m_frame;
+    m_damage_history.push_front(damage);
+    while (m_damage_history.size() > m_buffers.size())
+        m_damage_history.pop_back();
+
+    Profiler::instance().flip_scheduled(this);
+    schedule_flip();
 
-        schedule_flip();
+    if (m_zero_copy)
+        select_buffer(index());
+}
+
+void Screen::flip_completed(std::chrono::steady_clock::time_point when)
+{
+    m_last_flip = when;
+    Profiler::instance().flip_completed(this, when);
+    if (m_flip_callback)
+        m_flip_callback(when);
+}
+
+void Screen::add_missed_damage(DamageArray& damage, const ScreenBuffer& buffer) const
+{
+    const auto age = buffer_age(buffer);
+    if (!age || age - 1 > m_damage_history.size())
+    {
+        add_damage(damage, box());
+        return;
     }
+
+    for (uint64_t i = 0; i + 1 < age; ++i)
+        for (const auto& d : m_damage_history[i])
+            add_damage(damage, d);
 }
 
 #ifdef HAVE_SIMD
@@ -137,7 +218,12 @@ static void simd_copy(cairo_surface_t* src_surface,
 
 void Screen::copy_to_buffer(ScreenBuffer& buffer)
 {
-    simd_copy(m_surface.get(), buffer.surface.get(), buffer.damage);
+    if (software_rotation())
+        copy_to_buffer_rotated(buffer);
+    else if (detail::DrawDiagnostics::instance().overdraw())
+        copy_to_buffer_software(buffer);
+    else
+        simd_copy(m_surface.get(), buffer.surface.get(), buffer.damage);
 }
 #else
 void Screen::copy_to_buffer(ScreenBuffer& buffer)
@@ -281,6 +367,10 @@ static size_t pixel_bytes(PixelFormat format)
 {
     switch (format)
     {
+    case PixelFormat::l8:
+    case PixelFormat::rgb332:
+    case PixelFormat::c8:
+        return 1;
     case PixelFormat::rgb565:
         return 2;
     case PixelFormat::argb8888:
@@ -293,15 +383,245 @@ static size_t pixel_bytes(PixelFormat format)
     throw std::runtime_error("unable to convert format to bytes");
 }
 
+/**
+ * Copy damage between image surfaces with the pixel kernels.
+ *
+ * @return false if the surfaces are not supported, and nothing was copied.
+ */
+static bool pixelops_copy(cairo_surface_t* src_surface,
+                          cairo_surface_t* dst_surface,
+                          const Screen::DamageArray& damage)
+{
+    if (cairo_surface_get_type(src_surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+        cairo_surface_get_type(dst_surface) != CAIRO_SURFACE_TYPE_IMAGE)
+        return false;
+
+    const auto src_format = cairo_image_surface_get_format(src_surface);
+    const auto dst_format = cairo_image_surface_get_format(dst_surface);
+    const auto src32 = src_format == CAIRO_FORMAT_ARGB32 || src_format == CAIRO_FORMAT_RGB24;
+    const auto convert = src32 && dst_format == CAIRO_FORMAT_RGB16_565;
+
+    if (src_format != dst_format && !convert)
+        return false;
+
+    const auto bpp = src32 ? 4 : (src_format == CAIRO_FORMAT_RGB16_565 ? 2 : 0);
+    const auto dst_bpp = convert ? 2 : bpp;
+    if (!bpp)
+        return false;
+
+    cairo_surface_flush(src_surface);
+    cairo_surface_flush(dst_surface);
+
+    auto src = cairo_image_surface_get_data(src_surface);
+    auto dst = cairo_image_surface_get_data(dst_surface);
+    if (!src || !dst)
+        return false;
+
+    const size_t src_stride = cairo_image_surface_get_stride(src_surface);
+    const size_t dst_stride = cairo_image_surface_get_stride(dst_surface);
+    const auto bounds = Rect::intersection(
+                            Rect(0, 0, cairo_image_surface_get_width(src_surface),
+                                 cairo_image_surface_get_height(src_surface)),
+                            Rect(0, 0, cairo_image_surface_get_width(dst_surface),
+                                 cairo_image_surface_get_height(dst_surface)));
+
+    for (const auto& d : damage)
+    {
+        const auto rect = Rect::intersection(d, bounds);
+        if (rect.empty())
+            continue;
+
+        const auto s = src + rect.y() * src_stride + rect.x() * bpp;
+        const auto t = dst + rect.y() * dst_stride + rect.x() * dst_bpp;
+
+        if (convert)
+            detail::argb8888_to_rgb565(reinterpret_cast<const uint32_t*>(s), src_stride,
+                                       reinterpret_cast<uint16_t*>(t), dst_stride,
+                                       rect.width(), rect.height());
+        else
+            detail::copy_rect(s, src_stride, t, dst_stride,
+                              rect.width() * bpp, rect.height());
+    }
+
+    cairo_surface_mark_dirty(dst_surface);
+
+    return true;
+}
+
+void Screen::copy_to_buffer_rotated(ScreenBuffer& buffer)
+{
+    auto src_surface = m_surface.get();
+    auto dst_surface = buffer.surface.get();
+
+    const auto image = cairo_surface_get_type(src_surface) == CAIRO_SURFACE_TYPE_IMAGE &&
+                       cairo_surface_get_type(dst_surface) == CAIRO_SURFACE_TYPE_IMAGE;
+    const auto format = image ? cairo_image_surface_get_format(src_surface) : CAIRO_FORMAT_INVALID;
+    size_t bpp = 0;
+    if (format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24)
+        bpp = 4;
+    else if (format == CAIRO_FORMAT_RGB16_565)
+        bpp = 2;
+
+    for (auto& rect : buffer.damage)
+        rect = Rect::intersection(rect, box());
+
+    if (bpp && cairo_image_surface_get_format(dst_surface) == format)
+    {
+        cairo_surface_flush(src_surface);
+        cairo_surface_flush(dst_surface);
+
+        const auto src = cairo_image_surface_get_data(src_surface);
+        const auto dst = cairo_image_surface_get_data(dst_surface);
+        const size_t src_stride = cairo_image_surface_get_stride(src_surface);
+        const size_t dst_stride = cairo_image_surface_get_stride(dst_surface);
+
+        for (const auto& rect : buffer.damage)
+        {
+            if (rect.empty())
+                continue;
+
+            const auto target = buffer_rect(rect);
+            detail::rotate_rect(src + rect.y() * src_stride + rect.x() * bpp, src_stride,
+                                dst + target.y() * dst_stride + target.x() * bpp, dst_stride,
+                                rect.width(), rect.height(), bpp, m_rotation);
+        }
+
+        cairo_surface_mark_dirty(dst_surface);
+    }
+    else
+    {
+        // let cairo convert the pixels
+        unique_cairo_t cr(cairo_create(dst_surface));
+
+        for (const auto& rect : buffer.damage)
+        {
+            const auto target = buffer_rect(rect);
+            cairo_rectangle(cr.get(), target.x(), target.y(), target.width(), target.height());
+        }
+        cairo_clip(cr.get());
+
+        switch (m_rotation)
+        {
+        case 90:
+            cairo_translate(cr.get(), m_size.height(), 0);
+            break;
+        case 180:
+            cairo_translate(cr.get(), m_size.width(), m_size.height());
+            break;
+        case 270:
+            cairo_translate(cr.get(), 0, m_size.width());
+            break;
+        }
+        cairo_rotate(cr.get(), detail::to_radians<double>(0, m_rotation));
+
+        cairo_set_source_surface(cr.get(), src_surface, 0, 0);
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_paint(cr.get());
+        cairo_surface_flush(dst_surface);
+    }
+
+    // the damage is now where it is in the buffer
+    for (auto& rect : buffer.damage)
+        rect = buffer_rect(rect);
+}
+
+void Screen::copy_to_buffer_8bpp(ScreenBuffer& buffer)
+{
+    auto src_surface = m_surface.get();
+    auto dst_surface = buffer.surface.get();
+
+    cairo_surface_flush(src_surface);
+    cairo_surface_flush(dst_surface);
+
+    const auto src = cairo_image_surface_get_data(src_surface);
+    const auto dst = cairo_image_surface_get_data(dst_surface);
+    const size_t src_stride = cairo_image_surface_get_stride(src_surface);
+    const size_t dst_stride = cairo_image_surface_get_stride(dst_surface);
+    assert(src);
+    assert(dst);
+
+    for (auto& rect : buffer.damage)
+    {
+        rect = Rect::intersection(rect, box());
+        if (rect.empty())
+            continue;
+
+        const auto s = reinterpret_cast<const uint32_t*>(src + rect.y() * src_stride) + rect.x();
+        const auto target = buffer_rect(rect);
+
+        // convert in place, or to scratch rows first when rotating
+        auto t = dst + target.y() * dst_stride + target.x();
+        auto t_stride = dst_stride;
+        if (software_rotation())
+        {
+            t_stride = rect.width();
+            m_convert.resize(t_stride * rect.height());
+            t = m_convert.data();
+        }
+
+        if (m_format == PixelFormat::l8)
+            detail::argb8888_to_l8(s, src_stride, t, t_stride,
+                                   rect.width(), rect.height());
+        else
+            detail::argb8888_to_rgb332(s, src_stride, t, t_stride,
+                                       rect.width(), rect.height(),
+                                       rect.x(), rect.y(), m_dither);
+
+        if (software_rotation())
+            detail::rotate_rect(t, t_stride,
+                                dst + target.y() * dst_stride + target.x(), dst_stride,
+                                rect.width(), rect.height(), 1, m_rotation);
+
+        if (screen_bandwidth_enable())
+        {
+            bandwidth.end_frame(rect.width() * rect.height());
+            if (bandwidth.ready())
+                fmt::print("screen bandwidth: {}\n", bandwidth.value());
+        }
+    }
+
+    cairo_surface_mark_dirty(dst_surface);
+
+    // the damage is now where it is in the buffer
+    for (auto& rect : buffer.damage)
+        rect = buffer_rect(rect);
+}
+
 void Screen::copy_to_buffer_software(ScreenBuffer& buffer)
 {
+    if (software_rotation())
+    {
+        copy_to_buffer_rotated(buffer);
+        return;
+    }
+
+    const auto& diagnostics = detail::DrawDiagnostics::instance();
+    const auto wireframe = wireframe_enable();
+    const auto overdraw = diagnostics.overdraw();
+
+    if (!wireframe && !overdraw &&
+        pixelops_copy(m_surface.get(), buffer.surface.get(), buffer.damage))
+    {
+        if (screen_bandwidth_enable())
+        {
+            for (const auto& rect : buffer.damage)
+            {
+                bandwidth.end_frame(rect.width() * rect.height() * pixel_bytes(m_format));
+                if (bandwidth.ready())
+                    fmt::print("screen bandwidth: {}\n", bandwidth.value());
+            }
+        }
+
+        return;
+    }
+
     // create a new context for each frame
     unique_cairo_t cr(cairo_create(buffer.surface.get()));
 
     cairo_set_source_surface(cr.get(), m_surface.get(), 0, 0);
     cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
 
-    if (!wireframe_enable())
+    if (!wireframe && !overdraw)
     {
         for (const auto& rect : buffer.damage)
         {
@@ -323,9 +643,12 @@ void Screen::copy_to_buffer_software(ScreenBuffer& buffer)
         // paint whole source surface!
         cairo_paint(cr.get());
 
+        if (overdraw)
+            diagnostics.paint_overdraw(cr.get(), m_surface.get(), buffer.damage);
+
         cairo_set_line_width(cr.get(), 1);
 
-        auto decay = wireframe_decay();
+        auto decay = wireframe ? wireframe_decay() : 0;
         if (decay)
         {
             cairo_set_source_rgba(cr.get(), .36, .67, .93, 1.0);
@@ -363,7 +686,8 @@ void Screen::copy_to_buffer_software(ScreenBuffer& buffer)
         {
             if (decay)
                 history.emplace_back(std::make_pair(start, rect));
-            cairo_rectangle(cr.get(), rect.x(), rect.y(), rect.width(), rect.height());
+            if (wireframe)
+                cairo_rectangle(cr.get(), rect.x(), rect.y(), rect.width(), rect.height());
             if (screen_bandwidth_enable())
             {
                 bandwidth.end_frame(rect.width() * rect.height() * pixel_bytes(m_format));
@@ -371,7 +695,8 @@ void Screen::copy_to_buffer_software(ScreenBuffer& buffer)
                     fmt::print("screen bandwidth: {}\n", bandwidth.value());
             }
         }
-        cairo_stroke(cr.get());
+        if (wireframe)
+            cairo_stroke(cr.get());
     }
 
     cairo_surface_flush(buffer.surface.get());
@@ -406,6 +731,296 @@ void Screen::damage_algorithm(Screen::DamageArray& damage, Rect rect)
     damage.emplace_back(rect);
 }
 
+static inline int64_t damage_area(const Rect& rect)
+{
+    return static_cast<int64_t>(rect.width()) * rect.height();
+}
+
+/*
+ * Number of pixels in the merged rectangle of lhs and rhs that are not part
+ * of either rectangle.
+ */
+static inline int64_t damage_waste(const Rect& lhs, const Rect& rhs)
+{
+    auto covered = damage_area(lhs) + damage_area(rhs);
+    if (lhs.intersect(rhs))
+        covered -= damage_area(Rect::intersection(lhs, rhs));
+
+    return damage_area(Rect::merge(lhs, rhs)) - covered;
+}
+
+static inline bool damage_merge_cheaper(const Rect& lhs, const Rect& rhs,
+                                        const Screen::DamageCost& cost)
+{
+    const auto merged = damage_area(Rect::merge(lhs, rhs));
+    return damage_waste(lhs, rhs) <= static_cast<int64_t>(cost.max_waste * merged);
+}
+
+void Screen::damage_algorithm(Screen::DamageArray& damage, Rect rect,
+                              const DamageCost& cost)
+{
+    if (rect.empty())
+        return;
+
+    // work backwards for a stronger hit chance for existing rectangles
+    for (auto i = damage.rbegin(); i != damage.rend();)
+    {
+        // rectangle is already completely covered; done
+        if (Rect::intersection(*i, rect) == rect)
+            return;
+
+        if (damage_merge_cheaper(*i, rect, cost))
+        {
+            rect = Rect::merge(*i, rect);
+            damage.erase(std::next(i).base());
+            i = damage.rbegin();
+            continue;
+        }
+
+        ++i;
+    }
+
+    if (cost.max_rects && damage.size() >= cost.max_rects)
+    {
+        // over budget, so fold into the rectangle that wastes the least
+        auto best = std::min_element(damage.begin(), damage.end(),
+                                     [&rect](const Rect & a, const Rect & b)
+        {
+            return damage_waste(a, rect) < damage_waste(b, rect);
+        });
+
+        rect = Rect::merge(*best, rect);
+        damage.erase(best);
+        damage_algorithm(damage, rect, cost);
+        return;
+    }
+
+    damage.emplace_back(rect);
+}
+
+void Screen::damage_optimize(Screen::DamageArray& damage, const DamageCost& cost)
+{
+    if (damage.size() < 2)
+        return;
+
+    std::sort(damage.begin(), damage.end(), [](const Rect & a, const Rect & b)
+    {
+        if (a.y() != b.y())
+            return a.y() < b.y();
+        return a.x() < b.x();
+    });
+
+    // only the last few rectangles in sorted order are merge candidates
+    static constexpr size_t window = 4;
+
+    DamageArray result;
+    result.reserve(damage.size());
+    for (auto rect : damage)
+    {
+        if (rect.empty())
+            continue;
+
+        bool merged;
+        do
+        {
+            merged = false;
+            const auto begin = result.size() > window ?
+                               std::prev(result.end(), window) : result.begin();
+            for (auto i = result.end(); i != begin;)
+            {
+                --i;
+                if (damage_merge_cheaper(*i, rect, cost))
+                {
+                    rect = Rect::merge(*i, rect);
+                    result.erase(i);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        while (merged);
+
+        result.emplace_back(rect);
+    }
+
+    // enforce the rectangle budget by merging the cheapest neighbors
+    while (cost.max_rects && result.size() > cost.max_rects)
+    {
+        const auto excess = result.size() - cost.max_rects;
+
+        std::vector<std::pair<int64_t, size_t>> pairs;
+        pairs.reserve(result.size() - 1);
+        for (size_t i = 0; i + 1 < result.size(); ++i)
+            pairs.emplace_back(damage_waste(result[i], result[i + 1]), i);
+        std::sort(pairs.begin(), pairs.end());
+
+        std::vector<bool> used(result.size(), false);
+        size_t merges = 0;
+        for (const auto& pair : pairs)
+        {
+            if (merges >= excess)
+                break;
+
+            const auto i = pair.second;
+            if (used[i] || used[i + 1])
+                continue;
+
+            result[i] = Rect::merge(result[i], result[i + 1]);
+            result[i + 1] = Rect();
+            used[i] = used[i + 1] = true;
+            merges++;
+        }
+
+        result.erase(std::remove_if(result.begin(), result.end(),
+                                    [](const Rect & r) { return r.empty(); }),
+                     result.end());
+    }
+
+    damage.swap(result);
+}
+
+void Screen::add_damage(Screen::DamageArray& damage, const Rect& rect) const
+{
+    if (m_damage_mode == DamageMode::intersect)
+    {
+        damage_algorithm(damage, rect);
+        return;
+    }
+
+    // beyond this size, the incremental algorithm is replaced by batch
+    // compaction; a budget of max_rects within it is kept by the forced
+    // merges of the incremental algorithm
+    static constexpr size_t incremental_limit = 32;
+    const auto max_rects = m_damage_cost.max_rects;
+
+    if (damage.size() < incremental_limit ||
+        (max_rects && max_rects <= incremental_limit))
+    {
+        damage_algorithm(damage, rect, m_damage_cost);
+    }
+    else if (!rect.empty())
+    {
+        damage.emplace_back(rect);
+
+        // compact when over budget or, without one, each time the list
+        // doubles
+        const auto size = damage.size();
+        if (max_rects ? size > max_rects : (size & (size - 1)) == 0)
+            damage_optimize(damage, m_damage_cost);
+    }
+}
+
+static void copy_fidelity(cairo_t* from, cairo_t* to)
+{
+    cairo_font_options_t* cfo = cairo_font_options_create();
+    cairo_get_font_options(from, cfo);
+    cairo_set_font_options(to, cfo);
+    cairo_font_options_destroy(cfo);
+
+    cairo_set_antialias(to, cairo_get_antialias(from));
+}
+
+bool Screen::zero_copy(bool enable)
+{
+    if (enable == m_zero_copy)
+        return m_zero_copy;
+
+    if (enable)
+    {
+        // the buffers are drawn rotated or converted by copying to them
+        if (m_buffers.empty() || software_rotation() || is_8bpp(m_format))
+            return false;
+
+        m_zero_copy = true;
+        select_buffer(index());
+    }
+    else
+    {
+        m_zero_copy = false;
+
+        const auto f = detail::cairo_format(m_format);
+        auto surface = detail::create_surface(f == CAIRO_FORMAT_INVALID ? CAIRO_FORMAT_ARGB32 : f,
+                                              m_size, detail::composition_placement());
+
+        // start from the content of the last drawn buffer
+        const auto last = (index() + m_buffers.size() - 1) % m_buffers.size();
+        unique_cairo_t cr(cairo_create(surface.get()));
+        cairo_set_source_surface(cr.get(), m_buffers[last].surface.get(), 0, 0);
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_paint(cr.get());
+        cr.reset();
+
+        auto previous = m_cr;
+        m_surface = surface;
+        m_cr = shared_cairo_t(cairo_create(m_surface.get()), cairo_destroy);
+        copy_fidelity(previous.get(), m_cr.get());
+
+        // buffers only know what they missed relative to themselves
+        for (auto& b : m_buffers)
+            b.frame = 0;
+    }
+
+    return m_zero_copy;
+}
+
+const Screen::Readback& Screen::readback()
+{
+    if (m_readback.scanout > 0 || m_buffers.empty())
+        return m_readback;
+
+    // the composition buffer is only known while it is drawn to
+    if (m_zero_copy || cairo_surface_get_type(m_surface.get()) != CAIRO_SURFACE_TYPE_IMAGE)
+        return m_readback;
+
+    const auto bytes = [](cairo_surface_t * surface)
+    {
+        return std::min<size_t>(READBACK_BYTES,
+                                static_cast<size_t>(cairo_image_surface_get_stride(surface)) *
+                                cairo_image_surface_get_height(surface));
+    };
+
+    auto surface = m_surface.get();
+    cairo_surface_flush(surface);
+    m_readback.composition = detail::read_throughput(cairo_image_surface_get_data(surface),
+                             bytes(surface));
+
+    surface = m_buffers.front().surface.get();
+    cairo_surface_flush(surface);
+    m_readback.scanout = detail::read_throughput(cairo_image_surface_get_data(surface),
+                         bytes(surface));
+
+    EGTLOG_DEBUG("readback {:.0f} MB/s from the composition buffer ({}), {:.0f} MB/s "
+                 "from the screen buffers", m_readback.composition / 1e6,
+                 detail::placement_name(detail::placement(m_surface.get())),
+                 m_readback.scanout / 1e6);
+
+    return m_readback;
+}
+
+void Screen::add_buffer_damage(DamageArray& damage)
+{
+    if (!m_zero_copy || index() >= m_buffers.size())
+        return;
+
+    add_missed_damage(damage, m_buffers[index()]);
+}
+
+void Screen::select_buffer(uint32_t index)
+{
+    assert(index < m_buffers.size());
+    auto& buffer = m_buffers[index];
+
+    if (!buffer.cr)
+    {
+        buffer.cr = shared_cairo_t(cairo_create(buffer.surface.get()), cairo_destroy);
+        copy_fidelity(m_cr.get(), buffer.cr.get());
+    }
+
+    m_surface = shared_cairo_surface_t(cairo_surface_reference(buffer.surface.get()),
+                                       cairo_surface_destroy);
+    m_cr = buffer.cr;
+}
+
 static inline bool no_composition_buffer()
 {
     static int value = 0;
@@ -419,17 +1034,77 @@ static inline bool no_composition_buffer()
     return value == 1;
 }
 
+void Screen::rotation(uint32_t degrees, bool hardware)
+{
+    if (degrees != 0 && degrees != 90 && degrees != 180 && degrees != 270)
+        throw std::runtime_error(fmt::format("invalid screen rotation: {}", degrees));
+
+    m_rotation = degrees;
+    m_hardware_rotation = hardware && degrees;
+}
+
+DisplayPoint Screen::rotate_point(const DisplayPoint& point) const
+{
+    const auto w = m_size.width();
+    const auto h = m_size.height();
+
+    switch (m_rotation)
+    {
+    case 90:
+        return {point.y(), h - 1 - point.x()};
+    case 180:
+        return {w - 1 - point.x(), h - 1 - point.y()};
+    case 270:
+        return {w - 1 - point.y(), point.x()};
+    default:
+        break;
+    }
+
+    return point;
+}
+
+Rect Screen::buffer_rect(const Rect& rect) const
+{
+    if (!software_rotation())
+        return rect;
+
+    const auto w = m_size.width();
+    const auto h = m_size.height();
+
+    switch (m_rotation)
+    {
+    case 90:
+        return {h - rect.y() - rect.height(), rect.x(), rect.height(), rect.width()};
+    case 180:
+        return {w - rect.x() - rect.width(), h - rect.y() - rect.height(), rect.width(), rect.height()};
+    case 270:
+        return {rect.y(), w - rect.x() - rect.width(), rect.height(), rect.width()};
+    default:
+        break;
+    }
+
+    return rect;
+}
+
 void Screen::init(void** ptr, uint32_t count, const Size& size, PixelFormat format)
 {
+    // the buffers are the size of the display, and the screen is rotated
     m_size = size;
+    if (software_rotation() && m_rotation != 180)
+        m_size = Size(size.height(), size.width());
 
     cairo_format_t f = detail::cairo_format(format);
     if (f == CAIRO_FORMAT_INVALID)
         f = CAIRO_FORMAT_ARGB32;
 
+    // cairo can't draw 8-bit color, so these buffers are only wrapped as
+    // A8 surfaces to be converted to, and the composition stays 32-bit
+    const auto buffer_format = is_8bpp(format) ? CAIRO_FORMAT_A8 : f;
+
     m_buffers.clear();
 
-    if (count == 1 && no_composition_buffer())
+    if (count == 1 && no_composition_buffer() && !software_rotation() &&
+        !is_8bpp(format))
     {
         m_surface = shared_cairo_surface_t(
                         cairo_image_surface_create_for_data(static_cast<unsigned char*>(ptr[0]),
@@ -444,15 +1119,14 @@ void Screen::init(void** ptr, uint32_t count, const Size& size, PixelFormat form
         {
             m_buffers.emplace_back(
                 cairo_image_surface_create_for_data(static_cast<unsigned char*>(ptr[x]),
-                                                    f,
+                                                    buffer_format,
                                                     size.width(), size.height(),
-                                                    cairo_format_stride_for_width(f, size.width())));
+                                                    cairo_format_stride_for_width(buffer_format, size.width())));
 
-            m_buffers.back().damage.emplace_back(Point(), size);
+            m_buffers.back().damage.emplace_back(Point(), m_size);
         }
 
-        m_surface = shared_cairo_surface_t(cairo_image_surface_create(f, size.width(), size.height()),
-                                           cairo_surface_destroy);
+        m_surface = detail::create_surface(f, m_size, detail::composition_placement());
     }
 
     assert(m_surface.get());
@@ -461,34 +1135,44 @@ void Screen::init(void** ptr, uint32_t count, const Size& size, PixelFormat form
     assert(m_cr);
 
     m_format = format;
+
+    if (m_zero_copy)
+    {
+        if (m_buffers.empty())
+            m_zero_copy = false;
+        else
+            select_buffer(index() < m_buffers.size() ? index() : 0);
+    }
 }
 
-void Screen::low_fidelity()
+static void apply_fidelity(cairo_t* cr, bool low)
 {
     // font
     cairo_font_options_t* cfo = cairo_font_options_create();
-    cairo_font_options_set_antialias(cfo, CAIRO_ANTIALIAS_FAST);
-    cairo_font_options_set_hint_style(cfo, CAIRO_HINT_STYLE_NONE);
-    cairo_set_font_options(m_cr.get(), cfo);
+    cairo_font_options_set_antialias(cfo, low ? CAIRO_ANTIALIAS_FAST : CAIRO_ANTIALIAS_GOOD);
+    cairo_font_options_set_hint_style(cfo, low ? CAIRO_HINT_STYLE_NONE : CAIRO_HINT_STYLE_MEDIUM);
+    cairo_set_font_options(cr, cfo);
     cairo_font_options_destroy(cfo);
 
     // shapes
-    cairo_set_antialias(m_cr.get(), CAIRO_ANTIALIAS_FAST);
+    cairo_set_antialias(cr, low ? CAIRO_ANTIALIAS_FAST : CAIRO_ANTIALIAS_GOOD);
 }
 
-void Screen::high_fidelity()
+void Screen::low_fidelity()
 {
-    // font
-    cairo_font_options_t* cfo = cairo_font_options_create();
-    cairo_font_options_set_antialias(cfo, CAIRO_ANTIALIAS_GOOD);
-    cairo_font_options_set_hint_style(cfo, CAIRO_HINT_STYLE_MEDIUM);
-    cairo_set_font_options(m_cr.get(), cfo);
-    cairo_font_options_destroy(cfo);
-
-    // shapes
-    cairo_set_antialias(m_cr.get(), CAIRO_ANTIALIAS_GOOD);
+    apply_fidelity(m_cr.get(), true);
+    for (auto& b : m_buffers)
+        if (b.cr && b.cr != m_cr)
+            apply_fidelity(b.cr.get(), true);
 }
 
+void Screen::high_fidelity()
+{
+    apply_fidelity(m_cr.get(), false);
+    for (auto& b : m_buffers)
+        if (b.cr && b.cr != m_cr)
+            apply_fidelity(b.cr.get(), false);
+}
 
 size_t Screen::max_brightness() const
 {
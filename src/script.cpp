@@ -8,7 +8,12 @@
 #endif
 
 #include "detail/egtlog.h"
+#include "egt/app.h"
+#include "egt/eventloop.h"
 #include "egt/script.h"
+#include <atomic>
+#include <egt/asio.hpp>
+#include <stdexcept>
 
 #ifdef HAVE_LUA
 #include "detail/lua/script.h"
@@ -59,6 +64,145 @@ error:
     return y;
 }
 
+struct ScriptWorker::ScriptWorkerImpl
+{
+    explicit ScriptWorkerImpl(std::chrono::milliseconds t)
+        : timeout(t.count())
+    {}
+
+    /// Evaluate on the worker thread, returning an error message on failure.
+    double evaluate(const std::string& expr, std::string& error);
+
+    ~ScriptWorkerImpl() noexcept
+    {
+        worker.stop();
+        worker.join();
+#ifdef HAVE_LUA
+        if (state)
+            lua_close(state);
+#endif
+    }
+
+    std::atomic<std::chrono::milliseconds::rep> timeout;
+    asio::thread_pool worker{1};
+#ifdef HAVE_LUA
+    lua_State* state{nullptr};
+#endif
+};
+
+#ifdef HAVE_LUA
+/// Deadline of the evaluation running on this thread.
+static thread_local std::chrono::steady_clock::time_point script_deadline;
+
+/// Number of instructions between checks of the deadline.
+static constexpr int SCRIPT_HOOK_COUNT = 1000;
+
+static void script_hook(lua_State* L, lua_Debug* ar)
+{
+    detail::ignoreparam(ar);
+    if (std::chrono::steady_clock::now() > script_deadline)
+        luaL_error(L, "script timed out");
+}
+#endif
+
+double ScriptWorker::ScriptWorkerImpl::evaluate(const std::string& expr, std::string& error)
+{
+#ifdef HAVE_LUA
+    if (!state)
+    {
+        state = luaL_newstate();
+        if (!state)
+        {
+            error = "can't init lua";
+            return 0;
+        }
+        luaL_openlibs(state);
+        lua_sethook(state, script_hook, LUA_MASKCOUNT, SCRIPT_HOOK_COUNT);
+    }
+
+    const auto code = "return " + expr;
+    if (luaL_loadbuffer(state, code.data(), code.size(), "=expr") != LUA_OK)
+    {
+        error = lua_tostring(state, -1);
+        lua_pop(state, 1);
+        return 0;
+    }
+
+    script_deadline = std::chrono::steady_clock::now() +
+                      std::chrono::milliseconds(timeout.load());
+    if (lua_pcall(state, 0, 1, 0) != LUA_OK)
+    {
+        error = lua_tostring(state, -1) ? lua_tostring(state, -1) : "error";
+        lua_pop(state, 1);
+        return 0;
+    }
+
+    double result;
+    if (lua_isboolean(state, -1))
+        result = lua_toboolean(state, -1);
+    else
+        result = lua_tonumber(state, -1);
+    lua_pop(state, 1);
+    return result;
+#else
+    detail::ignoreparam(expr);
+    error = "lua script support not available";
+    return 0;
+#endif
+}
+
+ScriptWorker::ScriptWorker(std::chrono::milliseconds timeout)
+    : m_impl(std::make_unique<ScriptWorkerImpl>(timeout))
+{}
+
+std::future<double> ScriptWorker::evaluate(const std::string& expr)
+{
+    auto promise = std::make_shared<std::promise<double>>();
+    auto future = promise->get_future();
+
+    auto impl = m_impl.get();
+    asio::post(impl->worker, [impl, expr, promise]()
+    {
+        std::string error;
+        const auto result = impl->evaluate(expr, error);
+        if (error.empty())
+            promise->set_value(result);
+        else
+            promise->set_exception(std::make_exception_ptr(std::runtime_error(error)));
+    });
+
+    return future;
+}
+
+void ScriptWorker::evaluate(const std::string& expr, Callback callback)
+{
+    auto& io = Application::instance().event().io();
+
+    auto impl = m_impl.get();
+    asio::post(impl->worker, [impl, &io, expr, callback = std::move(callback)]()
+    {
+        std::string error;
+        const auto result = impl->evaluate(expr, error);
+        asio::post(io, [callback, result, error]()
+        {
+            if (callback)
+                callback(result, error);
+        });
+    });
+}
+
+void ScriptWorker::timeout(std::chrono::milliseconds timeout)
+{
+    m_impl->timeout = timeout.count();
+}
+
+std::chrono::milliseconds ScriptWorker::timeout() const
+{
+    return std::chrono::milliseconds(m_impl->timeout.load());
+}
+
+ScriptWorker::~ScriptWorker() noexcept = default;
+
 }
 }
 }
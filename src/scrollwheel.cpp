@@ -8,6 +8,7 @@
 #include "egt/grid.h"
 #include "egt/scrollwheel.h"
 #include <algorithm>
+#include <cmath>
 #include <memory>
 #include <string>
 
@@ -53,8 +54,13 @@ Scrollwheel::Scrollwheel(const Rect& rect, int min, int max, int step) noexcept
       m_button_up(Image("res:internal_arrow_up")),
       m_button_down(Image("res:internal_arrow_down"))
 {
-    for (auto i = min; i <= max; i += step)
-        m_items.push_back(std::to_string(i));
+    if (step > 0 && max >= min)
+    {
+        items(static_cast<size_t>((max - min) / step) + 1, [min, step](size_t index)
+        {
+            return std::to_string(min + static_cast<int>(index) * step);
+        });
+    }
 
     init();
 }
@@ -116,7 +122,7 @@ void Scrollwheel::init(bool in_deserialize)
 {
     if (!in_deserialize)
     {
-        name("Scrollwheel" + std::to_string(m_widgetid));
+        default_name("Scrollwheel", m_widgetid);
 
         m_grid.horizontal_space(1);
         m_grid.vertical_space(1);
@@ -134,8 +140,13 @@ void Scrollwheel::init(bool in_deserialize)
     m_label.fill_flags().clear();
 
     m_label.text_align(AlignFlag::center);
-    if (!m_items.empty())
-        m_label.text(m_items[m_selected]);
+    if (item_count())
+        m_label.text(item(m_selected));
+
+    m_fling.add_callback([this](EasingScalar value)
+    {
+        scroll(m_fling_start + m_fling_distance * value);
+    });
 
     m_button_up.on_event([this](Event & event)
     {
@@ -143,25 +154,25 @@ void Scrollwheel::init(bool in_deserialize)
         if (event_id != EventId::pointer_hold && event_id != EventId::pointer_click)
             return;
 
-        if (m_items.empty())
+        if (!item_count())
             return;
 
         if (m_reversed)
         {
             if (m_selected == 0)
-                m_selected = m_items.size() - 1;
+                m_selected = item_count() - 1;
             else
                 m_selected--;
         }
         else
         {
-            if (m_selected == m_items.size() - 1)
+            if (m_selected == item_count() - 1)
                 m_selected = 0;
             else
                 m_selected++;
         }
 
-        m_label.text(m_items[m_selected]);
+        m_label.text(item(m_selected));
 
         on_value_changed.invoke();
     });
@@ -172,12 +183,12 @@ void Scrollwheel::init(bool in_deserialize)
         if (event_id != EventId::pointer_hold && event_id != EventId::pointer_click)
             return;
 
-        if (m_items.empty())
+        if (!item_count())
             return;
 
         if (m_reversed)
         {
-            if (m_selected == m_items.size() - 1)
+            if (m_selected == item_count() - 1)
                 m_selected = 0;
             else
                 m_selected++;
@@ -185,12 +196,12 @@ void Scrollwheel::init(bool in_deserialize)
         else
         {
             if (m_selected == 0)
-                m_selected = m_items.size() - 1;
+                m_selected = item_count() - 1;
             else
                 m_selected--;
         }
 
-        m_label.text(m_items[m_selected]);
+        m_label.text(item(m_selected));
 
         on_value_changed.invoke();
     });
@@ -198,14 +209,47 @@ void Scrollwheel::init(bool in_deserialize)
 
 std::string Scrollwheel::value() const
 {
-    if (m_items.empty())
+    if (!item_count())
         return {};
 
-    return m_items[m_selected];
+    return item(m_selected);
+}
+
+void Scrollwheel::items(size_t count, ItemCallback callback)
+{
+    m_items.clear();
+    m_item_callback = std::move(callback);
+    m_item_count = m_item_callback ? count : 0;
+    m_selected = 0;
+    m_label.text(item_count() ? item(m_selected) : "");
+}
+
+std::string Scrollwheel::item(size_t index) const
+{
+    if (m_item_callback)
+        return m_item_callback(index);
+
+    return m_items[index];
+}
+
+void Scrollwheel::materialize()
+{
+    if (!m_item_callback)
+        return;
+
+    ItemArray items;
+    items.reserve(m_item_count);
+    for (size_t index = 0; index < m_item_count; ++index)
+        items.push_back(m_item_callback(index));
+
+    m_items = std::move(items);
+    m_item_callback = nullptr;
+    m_item_count = 0;
 }
 
 void Scrollwheel::add_item(const std::string& item)
 {
+    materialize();
     m_items.push_back(item);
 
     if (m_selected < m_items.size())
@@ -214,6 +258,7 @@ void Scrollwheel::add_item(const std::string& item)
 
 bool Scrollwheel::remove_item(const std::string& item)
 {
+    materialize();
     auto it = std::find(m_items.begin(), m_items.end(), item);
 
     if (it == m_items.end())
@@ -232,6 +277,8 @@ bool Scrollwheel::remove_item(const std::string& item)
 void Scrollwheel::clear_items()
 {
     m_items.clear();
+    m_item_callback = nullptr;
+    m_item_count = 0;
     m_selected = 0;
     m_label.text("");
 }
@@ -243,19 +290,75 @@ size_t Scrollwheel::selected() const
 
 void Scrollwheel::selected(size_t index)
 {
-    if (m_items.empty())
+    if (!item_count())
         return;
 
-    if (index > m_items.size() - 1)
-        index = m_items.size() - 1;
+    if (index > item_count() - 1)
+        index = item_count() - 1;
 
     if (detail::change_if_diff<>(m_selected, index))
     {
-        m_label.text(m_items[m_selected]);
+        m_label.text(item(m_selected));
         on_value_changed.invoke();
     }
 }
 
+void Scrollwheel::handle(Event& event)
+{
+    Widget::handle(event);
+
+    const auto along = [this](const DisplayPoint & point)
+    {
+        return static_cast<float>(m_orient == Orientation::vertical ? point.y() : point.x());
+    };
+
+    switch (event.id())
+    {
+    case EventId::pointer_drag_start:
+        m_fling.stop();
+        m_drag_selected = m_selected;
+        m_drag_offset = 0;
+        break;
+    case EventId::pointer_drag:
+        m_drag_offset = along(event.pointer().point) - along(event.pointer().drag_start);
+        scroll(m_drag_offset);
+        break;
+    case EventId::pointer_drag_stop:
+    {
+        // as ScrolledView, the wheel starts at the speed of the drag, and
+        // moves a third of the duration at that speed
+        const auto& velocity = event.pointer().velocity;
+        const std::chrono::duration<float> duration = std::chrono::milliseconds(750);
+        m_fling_distance = (m_orient == Orientation::vertical ? velocity.y() : velocity.x()) *
+                           duration.count() / 3.f;
+        if (std::abs(m_fling_distance) < 2)
+            break;
+
+        m_fling_start = m_drag_offset;
+        m_fling.start();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Scrollwheel::scroll(float offset)
+{
+    const auto row = m_orient == Orientation::vertical ? m_label.height() : m_label.width();
+    const auto count = static_cast<long>(item_count());
+    if (row <= 0 || !count)
+        return;
+
+    // dragging towards the up button moves as the up button does
+    auto steps = -static_cast<long>(offset / static_cast<float>(row));
+    if (m_reversed)
+        steps = -steps;
+
+    // only the label changes, and is damaged
+    selected(static_cast<size_t>(((static_cast<long>(m_drag_selected) + steps) % count + count) % count));
+}
+
 void Scrollwheel::reversed(bool enabled)
 {
     m_reversed = enabled;
@@ -281,15 +384,12 @@ void Scrollwheel::serialize(Serializer& serializer) const
         serializer.add_property("reversed", reversed());
     serializer.add_property("orient", std::string(detail::enum_to_string(m_orient)));
 
-    size_t index = 0;
-    for (const auto& item : m_items)
+    for (size_t index = 0; index < item_count(); ++index)
     {
         if (index == selected())
-            serializer.add_property("item", item, {{"selected", "true"}});
+            serializer.add_property("item", item(index), {{"selected", "true"}});
         else
-            serializer.add_property("item", item);
-
-        ++index;
+            serializer.add_property("item", item(index));
     }
 }
 
@@ -3,7 +3,9 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <cstdint>
 #include <detail/fmt.h>
+#include <detail/uibinary.h>
 #include <egt/color.h>
 #include <egt/detail/string.h>
 #include <egt/font.h>
@@ -11,9 +13,7 @@
 #include <egt/serialize.h>
 #include <egt/widget.h>
 #include <fstream>
-#include <rapidxml.hpp>
-#include <rapidxml_print.hpp>
-#include <rapidxml_utils.hpp>
+#include <sstream>
 #include <vector>
 
 namespace egt
@@ -282,202 +282,301 @@ void OstreamWidgetSerializer::write(std::ostream& out)
     print_node("", out, m_impl->doc);
 }
 
-struct XmlWidgetSerializer::XmlSerializerImpl
+/**
+ * Writes the elements of a document as they are serialized.
+ */
+struct DocumentWriter
 {
-    rapidxml::xml_document<> doc;
-    rapidxml::xml_node<>* current{nullptr};
+    /// Begin a child of the current element, which becomes the current one.
+    virtual void begin(const std::string& name) = 0;
+    /// Add an attribute to the current element, before any child or value.
+    virtual void attribute(const std::string& name, const std::string& value) = 0;
+    /// Set the value of the current element, before any child.
+    virtual void value(const std::string& value) = 0;
+    /// End the current element.
+    virtual void end() = 0;
+    /// Number of elements begun and not ended.
+    virtual size_t depth() const = 0;
+    virtual ~DocumentWriter() = default;
 };
 
-XmlWidgetSerializer::XmlWidgetSerializer()
-    : m_impl(std::make_unique<XmlSerializerImpl>())
+static Serializer::Context* begin_child(DocumentWriter& writer, const std::string& nodename)
 {
-    reset();
+    // the context is the depth to go back to
+    auto context = reinterpret_cast<Serializer::Context*>(static_cast<uintptr_t>(writer.depth()));
+    writer.begin(nodename);
+    return context;
 }
 
-void XmlWidgetSerializer::reset()
+static void end_child(DocumentWriter& writer, Serializer::Context* context)
 {
-    m_impl->doc.clear();
+    const auto depth = reinterpret_cast<uintptr_t>(context);
+    while (writer.depth() > depth)
+        writer.end();
+}
 
-    auto decl = m_impl->doc.allocate_node(rapidxml::node_declaration);
-    decl->append_attribute(m_impl->doc.allocate_attribute("version", "1.0"));
-    decl->append_attribute(m_impl->doc.allocate_attribute("encoding", "utf-8"));
-    m_impl->doc.append_node(decl);
+/// Begin the document with the global theme, palette, and font.
+static void begin_document(DocumentWriter& writer, Serializer& serializer)
+{
+    writer.begin("egt");
 
-    auto root = m_impl->doc.allocate_node(rapidxml::node_element, "egt");
-    m_impl->doc.append_node(root);
-    m_impl->current = root;
-
-    auto context = begin_child("theme");
-    add_property("type", global_theme().name());
-    end_child(context);
+    auto context = begin_child(writer, "theme");
+    serializer.add_property("type", global_theme().name());
+    end_child(writer, context);
 
     if (global_palette())
     {
-        context = begin_child("palette");
-        global_palette()->serialize("color", *this);
-        end_child(context);
+        context = begin_child(writer, "palette");
+        global_palette()->serialize("color", serializer);
+        end_child(writer, context);
     }
 
     if (global_font())
     {
-        context = begin_child("font");
-        global_font()->serialize("font", *this);
-        end_child(context);
+        context = begin_child(writer, "font");
+        global_font()->serialize("font", serializer);
+        end_child(writer, context);
     }
 
-    auto widgets = m_impl->doc.allocate_node(rapidxml::node_element, "widgets");
-    root->append_node(widgets);
-    m_impl->current = widgets;
+    writer.begin("widgets");
 }
 
-Serializer::Context* XmlWidgetSerializer::begin_child(const std::string& nodename)
+static void add_widget(DocumentWriter& writer, Serializer& serializer, const Widget* widget)
 {
-    auto context = reinterpret_cast<Serializer::Context*>(m_impl->current);
+    auto context = begin_child(writer, "widget");
+    writer.attribute("name", widget->name());
+    writer.attribute("type", widget->type());
 
-    auto str = m_impl->doc.allocate_string(nodename.c_str());
-    auto child = m_impl->doc.allocate_node(rapidxml::node_element, str);
-    m_impl->current->append_node(child);
-    m_impl->current = child;
+    widget->serialize(serializer);
 
-    return context;
+    end_child(writer, context);
 }
 
-void XmlWidgetSerializer::end_child(Context* context)
+static void add_property(DocumentWriter& writer, const std::string& name,
+                         const std::string& value, const Serializer::Attributes& attrs)
 {
-    m_impl->current = reinterpret_cast<rapidxml::xml_node<>*>(context);
+    writer.begin("property");
+    writer.attribute("name", name);
+    for (const auto& a : attrs)
+        writer.attribute(a.first, a.second);
+    writer.value(value);
+    writer.end();
 }
 
-bool XmlWidgetSerializer::add(const Widget* widget)
+static void add_property(DocumentWriter& writer, const std::string& name,
+                         const Pattern& value, const Serializer::Attributes& attrs)
 {
-    auto context = begin_child("widget");
+    if (value.type() == Pattern::Type::solid)
+    {
+        add_property(writer, name, value.first().hex(), attrs);
+        return;
+    }
 
-    m_impl->current->append_attribute(m_impl->doc.allocate_attribute("name",
-                                      m_impl->doc.allocate_string(widget->name().c_str())));
-    m_impl->current->append_attribute(m_impl->doc.allocate_attribute("type",
-                                      m_impl->doc.allocate_string(widget->type().c_str())));
+    writer.begin("property");
+    writer.attribute("name", name);
+    for (const auto& a : attrs)
+        writer.attribute(a.first, a.second);
 
-    widget->serialize(*this);
+    writer.begin("pattern");
 
-    end_child(context);
+    if (value.type() == Pattern::Type::linear)
+        add_property(writer, "type", "linear", {});
+    else if (value.type() == Pattern::Type::linear_vertical)
+        add_property(writer, "type", "linear_vertical", {});
+    else if (value.type() == Pattern::Type::radial)
+        add_property(writer, "type", "radial", {});
 
-    return true;
-}
+    add_property(writer, "start", detail::to_string(value.starting()), {});
+    add_property(writer, "end", detail::to_string(value.ending()), {});
 
-void XmlWidgetSerializer::add_property(const std::string& name,
-                                       const std::string& value,
-                                       const Attributes& attrs)
-{
-    auto node = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-    node->value(m_impl->doc.allocate_string(value.c_str()));
-    node->append_attribute(m_impl->doc.allocate_attribute("name",
-                           m_impl->doc.allocate_string(name.c_str())));
+    const auto& steps = value.steps();
+    if (!steps.empty())
+    {
+        std::string tmp;
+        for (const auto& s : steps)
+        {
+            tmp += "{" + detail::to_string(s.first) + "," + s.second.hex() + "},";
+        }
+        add_property(writer, "steps", tmp, {});
+    }
 
-    for (const auto& a : attrs)
+    if (value.type() == Pattern::Type::radial)
     {
-        node->append_attribute(m_impl->doc.allocate_attribute(m_impl->doc.allocate_string(a.first.c_str()),
-                               m_impl->doc.allocate_string(a.second.c_str())));
+        add_property(writer, "start_radius", detail::to_string(value.starting_radius()), {});
+        add_property(writer, "end_radius", detail::to_string(value.ending_radius()), {});
     }
 
-    m_impl->current->append_node(node);
+    writer.end();
+    writer.end();
 }
 
-void XmlWidgetSerializer::add_property(const std::string& name, const Pattern& value,
-                                       const Attributes& attrs)
+/**
+ * Writes XML text directly, without building a document first.
+ */
+struct XmlWidgetSerializer::XmlSerializerImpl : public DocumentWriter
 {
-    auto node = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-    m_impl->current->append_node(node);
+    struct Element
+    {
+        std::string name;
+        bool children{false};
+    };
 
-    node->append_attribute(m_impl->doc.allocate_attribute("name",
-                           m_impl->doc.allocate_string(name.c_str())));
+    void clear()
+    {
+        text = R"(<?xml version="1.0" encoding="utf-8"?>)";
+        text += '\n';
+        open.clear();
+        start_open = false;
+    }
 
-    for (const auto& a : attrs)
+    void begin(const std::string& name) override
     {
-        node->append_attribute(m_impl->doc.allocate_attribute(m_impl->doc.allocate_string(a.first.c_str()),
-                               m_impl->doc.allocate_string(a.second.c_str())));
+        if (!open.empty())
+        {
+            if (start_open)
+                text += '>';
+            if (!open.back().children)
+                text += '\n';
+            open.back().children = true;
+        }
+
+        text.append(open.size(), '\t');
+        text += '<';
+        text += name;
+        open.push_back({name});
+        start_open = true;
     }
 
-    if (value.type() == Pattern::Type::solid)
+    void attribute(const std::string& name, const std::string& value) override
     {
-        node->value(m_impl->doc.allocate_string(value.first().hex().c_str()));
+        if (!start_open)
+            return;
+
+        text += ' ';
+        text += name;
+        text += "=\"";
+        escape(text, value);
+        text += '"';
     }
-    else
+
+    void value(const std::string& value) override
     {
-        auto patternnode  = m_impl->doc.allocate_node(rapidxml::node_element, "pattern");
-        node->append_node(patternnode);
+        if (start_open)
+        {
+            text += '>';
+            start_open = false;
+        }
+        escape(text, value);
+    }
 
-        auto snode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-        snode->append_attribute(m_impl->doc.allocate_attribute("name", "start"));
-        snode->value(m_impl->doc.allocate_string(detail::to_string(value.starting()).c_str()));
+    void end() override
+    {
+        close(text, open.size() - 1, start_open);
+        open.pop_back();
+        start_open = false;
+    }
 
-        auto enode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-        enode->append_attribute(m_impl->doc.allocate_attribute("name", "end"));
-        enode->value(m_impl->doc.allocate_string(detail::to_string(value.ending()).c_str()));
+    size_t depth() const override
+    {
+        return open.size();
+    }
 
-        const auto& steps = value.steps();
-        std::ostringstream oss;
-        auto stepsnode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-        stepsnode->append_attribute(m_impl->doc.allocate_attribute("name", "steps"));
-        if (!steps.empty())
-        {
-            std::string tmp;
-            for (const auto& s : steps)
-            {
-                tmp += "{" + detail::to_string(s.first) + "," + s.second.hex().c_str() + "},";
-            }
-            stepsnode->value(m_impl->doc.allocate_string(tmp.c_str()));
-        }
+    /// Write the text, and end the elements still open.
+    void write(std::ostream& out) const
+    {
+        std::string tail;
+        for (auto i = open.size(); i > 0; --i)
+            close(tail, i - 1, start_open && i == open.size());
 
-        if (value.type() == Pattern::Type::linear)
+        out << text << tail;
+    }
+
+    void close(std::string& out, size_t index, bool start) const
+    {
+        const auto& element = open[index];
+        if (start)
         {
-            auto pnode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-            pnode->append_attribute(m_impl->doc.allocate_attribute("name", "type"));
-            pnode->value("linear");
-
-            patternnode->append_node(pnode);
-            patternnode->append_node(snode);
-            patternnode->append_node(enode);
-            if (!steps.empty())
-                patternnode->append_node(stepsnode);
+            out += "/>\n";
+            return;
         }
-        else if (value.type() == Pattern::Type::linear_vertical)
+
+        if (element.children)
+            out.append(index, '\t');
+        out += "</";
+        out += element.name;
+        out += ">\n";
+    }
+
+    static void escape(std::string& out, const std::string& value)
+    {
+        for (auto c : value)
         {
-            auto pnode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-            pnode->append_attribute(m_impl->doc.allocate_attribute("name", "type"));
-            pnode->value("linear_vertical");
-
-            patternnode->append_node(pnode);
-            patternnode->append_node(snode);
-            patternnode->append_node(enode);
-            if (!steps.empty())
-                patternnode->append_node(stepsnode);
+            switch (c)
+            {
+            case '&':
+                out += "&amp;";
+                break;
+            case '<':
+                out += "&lt;";
+                break;
+            case '>':
+                out += "&gt;";
+                break;
+            case '"':
+                out += "&quot;";
+                break;
+            default:
+                out += c;
+                break;
+            }
         }
-        else if (value.type() == Pattern::Type::radial)
-        {
-            auto rnode = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-            rnode->append_attribute(m_impl->doc.allocate_attribute("name", "type"));
-            rnode->value("radial");
+    }
+
+    std::string text;
+    std::vector<Element> open;
+    /// Is the start tag of the current element still open for attributes.
+    bool start_open{false};
+};
 
-            patternnode->append_node(rnode);
-            patternnode->append_node(snode);
-            patternnode->append_node(enode);
-            if (!steps.empty())
-                patternnode->append_node(stepsnode);
+XmlWidgetSerializer::XmlWidgetSerializer()
+    : m_impl(std::make_unique<XmlSerializerImpl>())
+{
+    reset();
+}
 
-            auto start_radius = detail::to_string(value.starting_radius());
+void XmlWidgetSerializer::reset()
+{
+    m_impl->clear();
+    begin_document(*m_impl, *this);
+}
 
-            auto sradius = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-            sradius->append_attribute(m_impl->doc.allocate_attribute("name", "start_radius"));
-            sradius->value(m_impl->doc.allocate_string(start_radius.c_str()));
-            patternnode->append_node(sradius);
+Serializer::Context* XmlWidgetSerializer::begin_child(const std::string& nodename)
+{
+    return egt::begin_child(*m_impl, nodename);
+}
 
-            auto end_radius = detail::to_string(value.ending_radius());
+void XmlWidgetSerializer::end_child(Context* context)
+{
+    egt::end_child(*m_impl, context);
+}
 
-            auto eradius = m_impl->doc.allocate_node(rapidxml::node_element, "property");
-            eradius->append_attribute(m_impl->doc.allocate_attribute("name", "end_radius"));
-            eradius->value(m_impl->doc.allocate_string(end_radius.c_str()));
-            patternnode->append_node(eradius);
-        }
-    }
+bool XmlWidgetSerializer::add(const Widget* widget)
+{
+    add_widget(*m_impl, *this, widget);
+    return true;
+}
+
+void XmlWidgetSerializer::add_property(const std::string& name,
+                                       const std::string& value,
+                                       const Attributes& attrs)
+{
+    egt::add_property(*m_impl, name, value, attrs);
+}
+
+void XmlWidgetSerializer::add_property(const std::string& name, const Pattern& value,
+                                       const Attributes& attrs)
+{
+    egt::add_property(*m_impl, name, value, attrs);
 }
 
 void XmlWidgetSerializer::write(const std::string& filename)
@@ -489,10 +588,100 @@ void XmlWidgetSerializer::write(const std::string& filename)
 
 void XmlWidgetSerializer::write(std::ostream& out)
 {
-    out << m_impl->doc;
+    m_impl->write(out);
 }
 
 XmlWidgetSerializer::~XmlWidgetSerializer() noexcept = default;
 
+/**
+ * Writes the compiled UI format directly.
+ */
+struct BinaryWidgetSerializer::BinarySerializerImpl : public DocumentWriter
+{
+    void begin(const std::string& name) override
+    {
+        builder.begin(name);
+    }
+
+    void attribute(const std::string& name, const std::string& value) override
+    {
+        builder.attribute(name, value);
+    }
+
+    void value(const std::string& value) override
+    {
+        builder.value(value);
+    }
+
+    void end() override
+    {
+        builder.end();
+    }
+
+    size_t depth() const override
+    {
+        return builder.depth();
+    }
+
+    detail::ui::Builder builder;
+};
+
+BinaryWidgetSerializer::BinaryWidgetSerializer()
+    : m_impl(std::make_unique<BinarySerializerImpl>())
+{
+    reset();
+}
+
+void BinaryWidgetSerializer::reset()
+{
+    m_impl->builder = {};
+    // the document, whose children are the top level elements
+    m_impl->builder.begin("");
+    begin_document(*m_impl, *this);
+}
+
+Serializer::Context* BinaryWidgetSerializer::begin_child(const std::string& nodename)
+{
+    return egt::begin_child(*m_impl, nodename);
+}
+
+void BinaryWidgetSerializer::end_child(Context* context)
+{
+    egt::end_child(*m_impl, context);
+}
+
+bool BinaryWidgetSerializer::add(const Widget* widget)
+{
+    add_widget(*m_impl, *this, widget);
+    return true;
+}
+
+void BinaryWidgetSerializer::add_property(const std::string& name,
+        const std::string& value,
+        const Attributes& attrs)
+{
+    egt::add_property(*m_impl, name, value, attrs);
+}
+
+void BinaryWidgetSerializer::add_property(const std::string& name, const Pattern& value,
+        const Attributes& attrs)
+{
+    egt::add_property(*m_impl, name, value, attrs);
+}
+
+void BinaryWidgetSerializer::write(const std::string& filename)
+{
+    std::ofstream out(filename.c_str(), std::ios_base::binary);
+    write(out);
+    out.close();
+}
+
+void BinaryWidgetSerializer::write(std::ostream& out)
+{
+    m_impl->builder.write(out);
+}
+
+BinaryWidgetSerializer::~BinaryWidgetSerializer() noexcept = default;
+
 }
 }
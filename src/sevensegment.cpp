@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "egt/detail/surfacepool.h"
+#include "egt/frame.h"
+#include "egt/painter.h"
+#include "egt/sevensegment.h"
+#include <cairo.h>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+namespace egt
+{
+inline namespace v1
+{
+
+/// Width of a cell, relative to its height.
+static constexpr auto CELL_RATIO = 0.6;
+
+/// Bit of the decimal point.
+static constexpr uint8_t DECIMAL_POINT = 0x80;
+
+SevenSegment::SevenSegment(size_t digits, const Rect& rect)
+    : Widget(rect),
+      m_segments(digits)
+{
+    default_name("SevenSegment", m_widgetid);
+    fill_flags().clear();
+}
+
+SevenSegment::SevenSegment(Frame& parent, size_t digits, const Rect& rect)
+    : SevenSegment(digits, rect)
+{
+    parent.add(*this);
+}
+
+/// Segments lit for each character, with both cases for the letters.
+static constexpr std::pair<char, uint8_t> characters[] =
+{
+    {'0', 0x3f}, {'1', 0x06}, {'2', 0x5b}, {'3', 0x4f}, {'4', 0x66},
+    {'5', 0x6d}, {'6', 0x7d}, {'7', 0x07}, {'8', 0x7f}, {'9', 0x6f},
+    {'a', 0x77}, {'b', 0x7c}, {'c', 0x39}, {'d', 0x5e}, {'e', 0x79},
+    {'f', 0x71}, {'h', 0x76}, {'l', 0x38}, {'n', 0x54}, {'o', 0x5c},
+    {'p', 0x73}, {'r', 0x50}, {'u', 0x3e},
+    {'-', 0x40}, {'_', 0x08}, {' ', 0x00},
+    {'.', DECIMAL_POINT}, {',', DECIMAL_POINT},
+};
+
+uint8_t SevenSegment::segments(char c)
+{
+    const auto lower = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    for (const auto& character : characters)
+        if (character.first == lower)
+            return character.second;
+
+    throw std::runtime_error(std::string("unsupported seven segment character: ") + c);
+}
+
+void SevenSegment::text(const std::string& text)
+{
+    std::vector<uint8_t> digits;
+    digits.reserve(text.size());
+    for (auto c : text)
+    {
+        const auto s = segments(c);
+        if (s == DECIMAL_POINT && !digits.empty() && !(digits.back() & DECIMAL_POINT))
+            digits.back() |= DECIMAL_POINT;
+        else
+            digits.push_back(s);
+    }
+
+    m_text = text;
+
+    // aligned to the right, only the changed digits are damaged
+    const auto n = m_segments.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const auto s = i + digits.size() >= n ? digits[i + digits.size() - n] : 0;
+        if (s != m_segments[i])
+        {
+            m_segments[i] = s;
+            damage(cell(i));
+        }
+    }
+}
+
+void SevenSegment::value(double value, int precision)
+{
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    text(buffer);
+}
+
+void SevenSegment::digits(size_t digits)
+{
+    if (digits == m_segments.size())
+        return;
+
+    damage();
+    m_segments.assign(digits, 0);
+    text(m_text);
+    invalidate_size_hint();
+    damage();
+    parent_layout();
+}
+
+void SevenSegment::unlit(const Color& color)
+{
+    if (detail::change_if_diff<>(m_unlit, color))
+        damage();
+}
+
+Size SevenSegment::min_size_hint() const
+{
+    if (!m_min_size.empty())
+        return m_min_size;
+
+    const auto height = static_cast<DefaultDim>(std::ceil(font().size()));
+    const auto width = static_cast<DefaultDim>(std::ceil(height * CELL_RATIO));
+    return Size(width * static_cast<DefaultDim>(m_segments.size()), height) +
+           Widget::min_size_hint();
+}
+
+Rect SevenSegment::cell(size_t index) const
+{
+    const auto content = content_area();
+    const auto n = static_cast<DefaultDim>(m_segments.size());
+    if (!n || content.empty())
+        return {};
+
+    // the cells only depend on the box, so a value never moves them
+    auto height = content.height();
+    auto width = static_cast<DefaultDim>(height * CELL_RATIO);
+    if (width * n > content.width())
+    {
+        width = content.width() / n;
+        height = static_cast<DefaultDim>(width / CELL_RATIO);
+    }
+
+    return {content.x() + (content.width() - width * n) / 2 + width * static_cast<DefaultDim>(index),
+            content.y() + (content.height() - height) / 2,
+            width, height};
+}
+
+cairo_surface_t* SevenSegment::mask(uint8_t segments)
+{
+    const auto size = cell(0).size();
+    if (size != m_mask_size)
+    {
+        m_masks.clear();
+        m_mask_size = size;
+    }
+
+    auto& surface = m_masks[segments];
+    if (surface)
+        return surface.get();
+
+    surface = detail::surface_pool().acquire(CAIRO_FORMAT_A8, size);
+    auto cr = shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
+
+    const auto h = static_cast<double>(size.height());
+    const auto t = h * 0.1;
+    // room is left on the right for the decimal point
+    const auto w = size.width() - t * 1.5;
+    const auto gap = t * 0.15;
+
+    const auto left = t;
+    const auto right = w - t / 2.;
+    const auto top = t / 2.;
+    const auto middle = h / 2.;
+    const auto bottom = h - t / 2.;
+
+    auto horizontal = [&cr, t](double x0, double x1, double y)
+    {
+        cairo_move_to(cr.get(), x0, y);
+        cairo_line_to(cr.get(), x0 + t / 2., y - t / 2.);
+        cairo_line_to(cr.get(), x1 - t / 2., y - t / 2.);
+        cairo_line_to(cr.get(), x1, y);
+        cairo_line_to(cr.get(), x1 - t / 2., y + t / 2.);
+        cairo_line_to(cr.get(), x0 + t / 2., y + t / 2.);
+        cairo_close_path(cr.get());
+    };
+
+    auto vertical = [&cr, t](double x, double y0, double y1)
+    {
+        cairo_move_to(cr.get(), x, y0);
+        cairo_line_to(cr.get(), x + t / 2., y0 + t / 2.);
+        cairo_line_to(cr.get(), x + t / 2., y1 - t / 2.);
+        cairo_line_to(cr.get(), x, y1);
+        cairo_line_to(cr.get(), x - t / 2., y1 - t / 2.);
+        cairo_line_to(cr.get(), x - t / 2., y0 + t / 2.);
+        cairo_close_path(cr.get());
+    };
+
+    if (segments & 0x01)
+        horizontal(left + gap, right - gap, top);
+    if (segments & 0x02)
+        vertical(right, top + gap, middle - gap);
+    if (segments & 0x04)
+        vertical(right, middle + gap, bottom - gap);
+    if (segments & 0x08)
+        horizontal(left + gap, right - gap, bottom);
+    if (segments & 0x10)
+        vertical(left, middle + gap, bottom - gap);
+    if (segments & 0x20)
+        vertical(left, top + gap, middle - gap);
+    if (segments & 0x40)
+        horizontal(left + gap, right - gap, middle);
+    if (segments & DECIMAL_POINT)
+    {
+        cairo_new_sub_path(cr.get());
+        cairo_arc(cr.get(), w + t * 0.75, bottom, t * 0.6, 0, 2 * M_PI);
+    }
+
+    cairo_fill(cr.get());
+    cairo_surface_flush(surface.get());
+
+    return surface.get();
+}
+
+void SevenSegment::draw(Painter& painter, const Rect& rect)
+{
+    draw_box(painter, Palette::ColorId::label_bg, Palette::ColorId::border);
+
+    Painter::AutoSaveRestore sr(painter);
+
+    auto cr = painter.context().get();
+    const auto text_color = color(Palette::ColorId::label_text);
+
+    for (size_t i = 0; i < m_segments.size(); ++i)
+    {
+        const auto c = cell(i);
+        if (c.empty() || !c.intersect(rect))
+            continue;
+
+        const auto lit = m_segments[i];
+        if (m_unlit.alpha())
+        {
+            painter.set(m_unlit);
+            cairo_mask_surface(cr, mask(~lit & 0xff), c.x(), c.y());
+        }
+
+        if (lit)
+        {
+            painter.set(text_color);
+            cairo_mask_surface(cr, mask(lit), c.x(), c.y());
+        }
+    }
+}
+
+}
+}
@@ -17,7 +17,7 @@ CircleWidget::CircleWidget(const Circle& circle)
     : Widget(circle.rect()),
       m_radius(circle.radius())
 {
-    name("CircleWidget" + std::to_string(m_widgetid));
+    default_name("CircleWidget", m_widgetid);
     fill_flags(Theme::FillFlag::blend);
 }
 
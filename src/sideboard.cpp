@@ -69,6 +69,10 @@ void SideBoard::initialize()
 {
     reset_animations();
 
+    // slide on a plane, if one is free, and back to composition when done
+    m_oanim.on_stopped([this]() { animating(false); });
+    m_canim.on_stopped([this]() { animating(false); });
+
     switch (m_position)
     {
     case PositionFlag::left:
@@ -188,6 +192,7 @@ void SideBoard::close()
     if (running)
         m_canim.starting(current);
     m_canim.start();
+    animating(true);
     m_dir = false;
 }
 
@@ -201,6 +206,7 @@ void SideBoard::open()
     if (running)
         m_oanim.starting(current);
     m_oanim.start();
+    animating(true);
     m_dir = true;
 }
 
@@ -3,8 +3,10 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "egt/detail/drawdiagnostics.h"
 #include "egt/detail/enum.h"
 #include "egt/detail/layout.h"
+#include "egt/profiler.h"
 #include "egt/serialize.h"
 #include "egt/sizer.h"
 
@@ -54,6 +56,8 @@ BoxSizer::BoxSizer(Serializer::Properties& props, bool is_derived)
 
 void BoxSizer::layout()
 {
+    Profiler::Scope scope(Profiler::Phase::layout);
+
     if (!visible())
         return;
 
@@ -66,6 +70,10 @@ void BoxSizer::layout()
     m_in_layout = true;
     auto reset = detail::on_scope_exit([this]() { m_in_layout = false; });
 
+    auto& diagnostics = detail::DrawDiagnostics::instance();
+    if (egt_unlikely(diagnostics.enabled()))
+        diagnostics.laid_out(*this);
+
     auto rect = super_rect();
 
     // The purpose of the flex orientation is to automatically position
@@ -94,7 +102,9 @@ void BoxSizer::layout()
 
     resize(rect);
 
-    std::vector<detail::LayoutRect> rects;
+    // reused between layouts to not allocate
+    auto& rects = m_rects;
+    rects.clear();
 
     for (auto& child : children())
     {
@@ -106,10 +116,10 @@ void BoxSizer::layout()
 
         if (child->autoresize())
         {
-            if (min.width() < child->min_size_hint().width())
-                min.width(child->min_size_hint().width());
-            if (min.height() < child->min_size_hint().height())
-                min.height(child->min_size_hint().height());
+            if (min.width() < child->cached_min_size_hint().width())
+                min.width(child->cached_min_size_hint().width());
+            if (min.height() < child->cached_min_size_hint().height())
+                min.height(child->cached_min_size_hint().height());
         }
 
         child->layout();
@@ -133,7 +143,7 @@ void BoxSizer::layout()
         rects.emplace_back(behave, min);
     }
 
-    detail::flex_layout(content_area(), rects, justify(), orient());
+    m_flex.run(content_area(), rects, justify(), orient());
 
     auto child = children().begin();
     for (const auto& r : rects)
@@ -7,18 +7,15 @@
 #include "config.h"
 #endif
 
+#include "detail/audiomixer.h"
 #include "detail/egtlog.h"
 #include "egt/detail/filesystem.h"
 #include "egt/respath.h"
 #include "egt/sound.h"
 #include <alsa/asoundlib.h>
-#include <atomic>
-#include <condition_variable>
-#include <cstdio>
-#include <deque>
+#include <filesystem>
 #include <fstream>
-#include <mutex>
-#include <thread>
+#include <map>
 #include <vector>
 
 #ifdef HAVE_SNDFILE
@@ -29,101 +26,251 @@ namespace egt
 {
 inline namespace v1
 {
+namespace detail
+{
 
-struct PlaybackThread
+struct soundbankimpl
 {
-    PlaybackThread()
-    {
-        m_thread = std::thread(&PlaybackThread::run, this);
-    }
+    std::shared_ptr<AudioMixer> mixer;
+    std::map<std::string, std::shared_ptr<const SoundBuffer>> sounds;
+};
+
+struct soundimpl
+{
+    std::shared_ptr<AudioMixer> mixer;
+    std::shared_ptr<const SoundBuffer> buffer;
+    /// Sound decoded while it plays, instead of in buffer.
+    SoundSourceFactory source;
+    int channels{0};
+    unsigned int rate{0};
+    uint64_t voice{0};
+};
 
-    PlaybackThread(const PlaybackThread&) = delete;
-    PlaybackThread& operator=(const PlaybackThread&) = delete;
-    PlaybackThread(PlaybackThread&&) = delete;
-    PlaybackThread& operator=(PlaybackThread&&) = delete;
+#ifdef HAVE_SNDFILE
+/// Sound file decoded by sndfile.
+class SndfileSource : public SoundSource
+{
+public:
+    explicit SndfileSource(const std::string& path)
+        : m_file(path.c_str())
+    {}
 
-    void run()
+    EGT_NODISCARD bool valid() const
     {
-        std::function<void()> task;
-        while (true)
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
+        return m_file && m_file.samplerate() > 0 && m_file.channels() > 0;
+    }
 
-            while (!m_stop && m_queue.empty())
-                m_condition.wait(lock);
+    EGT_NODISCARD unsigned int rate() const override { return m_file.samplerate(); }
 
-            if (m_stop)
-                return;
+    EGT_NODISCARD unsigned int channels() const override { return m_file.channels(); }
 
-            task = m_queue.front();
-            m_queue.pop_front();
-            m_condition.notify_one();
-            lock.unlock();
+    size_t read(int16_t* data, size_t frames) override
+    {
+        const auto count = m_file.readf(data, frames);
+        return count > 0 ? count : 0;
+    }
 
-            task();
-        }
+    bool rewind() override
+    {
+        return m_file.seek(0, SEEK_SET) == 0;
     }
 
-    void enqueue(std::function<void()> job)
+private:
+    SndfileHandle m_file;
+};
+#else
+/// Raw sound file, in interleaved signed 16 bit frames.
+class RawSource : public SoundSource
+{
+public:
+    RawSource(const std::string& path, unsigned int rate, unsigned int channels)
+        : m_file(path, std::ios::binary | std::ios::in),
+          m_rate(rate),
+          m_channels(channels)
+    {}
+
+    EGT_NODISCARD bool valid() const
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_queue.emplace_back(std::move(job));
-        m_condition.notify_one();
+        return m_file && m_rate && m_channels;
     }
 
-    void quit()
+    EGT_NODISCARD unsigned int rate() const override { return m_rate; }
+
+    EGT_NODISCARD unsigned int channels() const override { return m_channels; }
+
+    size_t read(int16_t* data, size_t frames) override
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_thread.joinable())
-        {
-            m_stop = true;
-            m_condition.notify_all();
-            lock.unlock();
-            m_thread.join();
-        }
+        m_file.read(reinterpret_cast<char*>(data), frames * m_channels * sizeof(int16_t));
+        return static_cast<size_t>(m_file.gcount()) / (m_channels * sizeof(int16_t));
     }
 
-    ~PlaybackThread()
+    bool rewind() override
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_thread.joinable())
-        {
-            m_stop = true;
-            m_condition.notify_all();
-            lock.unlock();
-            m_thread.join();
-        }
+        m_file.clear();
+        return static_cast<bool>(m_file.seekg(0, std::ios::beg));
     }
 
-    std::thread m_thread;
-    std::deque<std::function<void()>> m_queue;
-    std::mutex m_mutex;
-    std::condition_variable m_condition;
-    std::atomic<bool> m_stop{false};
+private:
+    std::ifstream m_file;
+    unsigned int m_rate;
+    unsigned int m_channels;
 };
+#endif
 
-namespace detail
+}
+
+namespace experimental
 {
 
-struct soundimpl
+/**
+ * Decoded sounds larger than this, in bytes, are decoded while they play
+ * instead of being kept in memory.
+ */
+static constexpr size_t MAX_BUFFERED_SOUND = 256 * 1024;
+
+/// Get the path of the file of a sound.
+static std::string sound_path(const std::string& uri)
+{
+    std::string path;
+    const auto type = detail::resolve_path(uri, path);
+
+    if (type == detail::SchemeType::filesystem)
+    {
+        if (!detail::exists(path))
+            throw std::runtime_error("file not found: " + path);
+    }
+    else
+    {
+        throw std::runtime_error("unsupported uri: " + uri);
+    }
+
+    return path;
+}
+
+/// Get the identifier of a sound in the mixer.
+static std::string sound_key(const std::string& path, unsigned int rate, int channels)
 {
-    snd_pcm_t* handle{nullptr};
-    snd_pcm_uframes_t frames{};
-    int channels{0};
-    unsigned int rate{0};
-    PlaybackThread play_thread;
-    std::atomic<bool> interrupt{false};
 #ifdef HAVE_SNDFILE
-    SndfileHandle in;
+    detail::ignoreparam(rate);
+    detail::ignoreparam(channels);
+    return path;
 #else
-    std::ifstream in;
+    return fmt::format("{}:{}:{}", path, rate, channels);
 #endif
-};
+}
 
+/**
+ * Get a function opening a sound to stream it, or nullptr if the sound is
+ * small and uncompressed, and better kept in memory.
+ */
+static detail::SoundSourceFactory stream_sound(const detail::AudioMixer& mixer,
+        const std::string& path, unsigned int rate, int channels)
+{
+#ifdef HAVE_SNDFILE
+    detail::ignoreparam(rate);
+    detail::ignoreparam(channels);
+
+    SndfileHandle in(path.c_str());
+    if (!in || in.frames() <= 0 || in.channels() <= 0 || in.samplerate() <= 0)
+        return nullptr;
+
+    // compressed sounds are larger decoded than in their file
+    const auto subtype = in.format() & SF_FORMAT_SUBMASK;
+    const auto pcm = subtype == SF_FORMAT_PCM_S8 || subtype == SF_FORMAT_PCM_16 ||
+                     subtype == SF_FORMAT_PCM_24 || subtype == SF_FORMAT_PCM_32 ||
+                     subtype == SF_FORMAT_PCM_U8;
+    const auto size = static_cast<uint64_t>(in.frames()) * mixer.rate() / in.samplerate() *
+                      mixer.channels() * sizeof(int16_t);
+    if (pcm && size <= MAX_BUFFERED_SOUND)
+        return nullptr;
+
+    return [path]() -> std::unique_ptr<detail::SoundSource>
+    {
+        auto source = std::make_unique<detail::SndfileSource>(path);
+        if (!source->valid())
+        {
+            detail::error("can't open file: {}", path);
+            return nullptr;
+        }
+        return source;
+    };
+#else
+    if (channels <= 0 || rate == 0)
+        return nullptr;
+
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return nullptr;
+
+    const auto size = file_size * mixer.rate() / rate * mixer.channels() / channels;
+    if (size <= MAX_BUFFERED_SOUND)
+        return nullptr;
+
+    const auto count = static_cast<unsigned int>(channels);
+    return [path, rate, count]() -> std::unique_ptr<detail::SoundSource>
+    {
+        auto source = std::make_unique<detail::RawSource>(path, rate, count);
+        if (!source->valid())
+        {
+            detail::error("can't open file: {}", path);
+            return nullptr;
+        }
+        return source;
+    };
+#endif
 }
 
-namespace experimental
+/**
+ * Get the buffer of a sound, decoded and converted to the format of the mixer
+ * once for all its users.
+ */
+static std::shared_ptr<const detail::SoundBuffer> load_sound(detail::AudioMixer& mixer,
+        const std::string& path, unsigned int rate, int channels)
 {
+    return mixer.load(sound_key(path, rate, channels), [&mixer, &path, rate, channels]()
+    {
+        std::vector<int16_t> data;
+#ifdef HAVE_SNDFILE
+        detail::ignoreparam(rate);
+        detail::ignoreparam(channels);
+
+        SndfileHandle in(path.c_str());
+        if (!in || in.frames() <= 0 || in.channels() <= 0)
+        {
+            detail::error("can't open file: {}", path);
+            return detail::SoundBuffer();
+        }
+
+        data.resize(in.frames() * in.channels());
+        data.resize(in.readf(data.data(), in.frames()) * in.channels());
+
+        return mixer.convert(data.data(), data.size() / in.channels(),
+                             in.samplerate(), in.channels());
+#else
+        if (channels <= 0 || rate == 0)
+        {
+            detail::error("can't play sound file {}: sndfile not available and rate "
+                          "and channel not specified", path);
+            return detail::SoundBuffer();
+        }
+
+        std::ifstream in(path, std::ios::binary | std::ios::in | std::ios::ate);
+        if (!in)
+        {
+            detail::error("can't open file: {}", path);
+            return detail::SoundBuffer();
+        }
+
+        data.resize(static_cast<size_t>(in.tellg()) / sizeof(data[0]));
+        in.seekg(0, std::ios::beg);
+        in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(data[0]));
+
+        const auto count = static_cast<unsigned int>(channels);
+        return mixer.convert(data.data(), data.size() / count, rate, count);
+#endif
+    });
+}
 
 // NOLINTNEXTLINE(modernize-pass-by-value)
 Sound::Sound(const std::string& uri, unsigned int rate, int channels, const std::string& device)
@@ -154,297 +301,116 @@ void Sound::media(const std::string& uri)
 
 void Sound::open_file()
 {
-    std::string path;
-    const auto type = detail::resolve_path(m_uri, path);
+    stop();
+    m_impl->source = nullptr;
 
-    if (type == detail::SchemeType::filesystem)
-    {
-        if (!detail::exists(path))
-            throw std::runtime_error("file not found: " + path);
-    }
-    else
-    {
-        throw std::runtime_error("unsupported uri: " + m_uri);
-    }
-
-#ifdef HAVE_SNDFILE
-    if (m_impl->in)
-        stop();
+    const auto path = sound_path(m_uri);
 
-    m_impl->in = SndfileHandle(path.c_str());
-    init_alsa_params(m_impl->in.samplerate(), m_impl->in.channels());
-    if (m_impl->channels == 0 || m_impl->rate == 0)
-    {
-        detail::error("can't play sound file {}: sndfile not available and rate "
-                      "and channel not specified", path);
+    // a sound already loaded, i.e. by a SoundBank, costs no file access
+    m_impl->buffer = m_impl->mixer->find(sound_key(path, m_impl->rate, m_impl->channels));
+    if (m_impl->buffer)
         return;
-    }
-#else
-    m_impl->in.open(path, std::ios::binary | std::ios::in);
-#endif
 
-    if (!m_impl->in)
-    {
-        detail::error("can't open file: {}", path);
-    }
+    m_impl->source = stream_sound(*m_impl->mixer, path, m_impl->rate, m_impl->channels);
+    if (!m_impl->source)
+        m_impl->buffer = load_sound(*m_impl->mixer, path, m_impl->rate, m_impl->channels);
 }
 
 void Sound::open_alsa_device(const std::string& device)
 {
-    static const auto MAX_RETRIES = 10;
-    int tries = 0;
-    int err;
-
-    do
-    {
-        err = snd_pcm_open(&m_impl->handle, device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
-        if (err == -EBUSY)
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    } while (err == -EBUSY && ++tries <= MAX_RETRIES);
-
-    if (err < 0)
-    {
-        throw std::runtime_error(fmt::format("can't open '{}' PCM device: {}",
-                                             device, snd_strerror(err)));
-
-    }
+    m_impl->mixer = detail::AudioMixer::get(device);
 }
 
-// default period size (number of frames per period)
-static const auto PERIOD = 4096;
-
 void Sound::init_alsa_params(unsigned int rate, int channels)
 {
-    snd_pcm_hw_params_t* params;
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
-    snd_pcm_hw_params_alloca(&params);
-    snd_pcm_hw_params_any(m_impl->handle, params);
-
-    auto err = snd_pcm_hw_params_set_access(m_impl->handle, params,
-                                            SND_PCM_ACCESS_RW_INTERLEAVED);
-    if (err < 0)
-    {
-        detail::error("can't set interleaved mode. {}", snd_strerror(err));
-    }
-
-    err = snd_pcm_hw_params_set_format(m_impl->handle, params,
-                                       SND_PCM_FORMAT_S16_LE);
-    if (err < 0)
-    {
-        detail::error("can't set format. {}", snd_strerror(err));
-    }
-
-    err = snd_pcm_hw_params_set_channels(m_impl->handle, params, channels);
-    if (err < 0)
-    {
-        detail::error("can't set channels number. {}", snd_strerror(err));
-    }
-
-    err = snd_pcm_hw_params_set_rate_near(m_impl->handle, params, &rate, nullptr);
-    if (err < 0)
-    {
-        detail::error("can't set rate. {}", snd_strerror(err));
-    }
-
-    /* write back hw parameters */
-    err = snd_pcm_hw_params(m_impl->handle, params);
-    if (err < 0)
-    {
-        detail::error("can't set hardware parameters. {}", snd_strerror(err));
-    }
-
-    EGTLOG_TRACE("PCM name: {}", snd_pcm_name(m_impl->handle));
-    EGTLOG_TRACE("PCM state: {}", snd_pcm_state_name(snd_pcm_state(m_impl->handle)));
-
-    snd_pcm_hw_params_get_period_size(params, &m_impl->frames, nullptr);
-    m_impl->channels = channels;
+    // the mixer owns the device, this is only the format of the sound file
     m_impl->rate = rate;
+    m_impl->channels = channels;
+}
 
-    EGTLOG_TRACE("PCM frames: {}", m_impl->frames);
-    EGTLOG_TRACE("PCM channels: {}", m_impl->channels);
-
-    snd_pcm_sw_params_t* sw_params;
-
-    err = snd_pcm_sw_params_malloc(&sw_params);
-    if (err < 0)
-    {
-        detail::error("cannot allocate software parameters structure {}",
-                      snd_strerror(err));
-    }
-
-    err = snd_pcm_sw_params_current(m_impl->handle, sw_params);
-    if (err < 0)
-    {
-        detail::error("cannot initialize software parameters structure {}",
-                      snd_strerror(err));
-    }
+void Sound::play(bool repeat)
+{
+    if (!m_impl->buffer && !m_impl->source)
+        return;
 
-    err = snd_pcm_sw_params_set_avail_min(m_impl->handle, sw_params, PERIOD);
-    if (err < 0)
-    {
-        detail::error("cannot set minimum available count {}", snd_strerror(err));
-    }
+    // cancel any pending playback
+    stop();
 
-    err = snd_pcm_sw_params_set_start_threshold(m_impl->handle, sw_params, 0U);
-    if (err < 0)
-    {
-        detail::error("cannot set start mode {}", snd_strerror(err));
-    }
+    if (m_impl->source)
+        m_impl->voice = m_impl->mixer->play(m_impl->source, repeat);
+    else
+        m_impl->voice = m_impl->mixer->play(m_impl->buffer, repeat);
+}
 
-    err = snd_pcm_sw_params(m_impl->handle, sw_params);
-    if (err < 0)
+void Sound::stop()
+{
+    if (m_impl->voice)
     {
-        detail::error("cannot set software parameters {}",  snd_strerror(err));
+        m_impl->mixer->stop(m_impl->voice);
+        m_impl->voice = 0;
     }
-
-    snd_pcm_sw_params_free(sw_params);
 }
 
-void Sound::play(bool repeat)
+SoundStats Sound::stats() const
 {
-    if (!m_impl->in)
-        return;
-
-    /*
-     * So, this is not safe, sorta.  This is better left up to the playback
-     * thread, but on some systems this seems to be the only way to *quickly*
-     * abort the blocking calls in the playback thread.
-     */
-    snd_pcm_drop(m_impl->handle);
+    return m_impl->mixer->stats();
+}
 
-    // interrupt any pending playback
-    m_impl->interrupt = true;
+Sound::Sound(Sound&&) noexcept = default;
+Sound& Sound::operator=(Sound&&) noexcept = default;
 
-    // enqueue new playback
-    m_impl->play_thread.enqueue([this, repeat]()
-    {
-        m_impl->interrupt = false;
+Sound::~Sound() noexcept
+{
+    if (m_impl)
+        stop();
+}
 
-        snd_pcm_prepare(m_impl->handle);
+SoundBank::SoundBank(const std::string& device)
+    : m_impl(std::make_unique<detail::soundbankimpl>())
+{
+    m_impl->mixer = detail::AudioMixer::get(device);
+}
 
-        std::vector<short> buf(PERIOD * m_impl->channels, 0);
+SoundBank::SoundBank(SoundBank&&) noexcept = default;
+SoundBank& SoundBank::operator=(SoundBank&&) noexcept = default;
+SoundBank::~SoundBank() noexcept = default;
 
-        do
-        {
-#ifdef HAVE_SNDFILE
-            m_impl->in.seek(0, SEEK_SET);
-#else
-            m_impl->in.clear();
-            m_impl->in.seekg(0, std::ios::beg);
-#endif
+bool SoundBank::load(const std::string& uri, unsigned int rate, int channels)
+{
+    auto buffer = load_sound(*m_impl->mixer, sound_path(uri), rate, channels);
+    if (!buffer)
+        return false;
 
-            while (true)
-            {
-                if (m_impl->interrupt)
-                {
-                    snd_pcm_drop(m_impl->handle);
-                    return;
-                }
-
-                static const auto timeout_ms = 100;
-                auto err = snd_pcm_wait(m_impl->handle, timeout_ms);
-                if (err == 0)
-                {
-                    // timeout
-                    continue;
-                }
-                else if (err < 0)
-                {
-                    // NOLINTNEXTLINE(misc-lambda-function-name)
-                    EGTLOG_TRACE("PCM wait error");
-                    return;
-                }
-
-                if (m_impl->interrupt)
-                {
-                    snd_pcm_drop(m_impl->handle);
-                    return;
-                }
-
-                snd_pcm_sframes_t frames_to_deliver = snd_pcm_avail_update(m_impl->handle);
-                if (frames_to_deliver < 0)
-                {
-                    if (frames_to_deliver == -EPIPE)
-                    {
-                        detail::error("PCM xrun occurred\n");
-                    }
-                    else
-                    {
-                        detail::error("PCM unknown avail update return value: {}",
-                                      frames_to_deliver);
-                    }
-
-                    break;
-                }
-
-                if (static_cast<snd_pcm_uframes_t>(frames_to_deliver) > m_impl->frames)
-                {
-                    frames_to_deliver = PERIOD;
-                }
+    m_impl->sounds[uri] = std::move(buffer);
+    return true;
+}
 
-#ifdef HAVE_SNDFILE
-                const auto count = m_impl->in.read(buf.data(), frames_to_deliver);
-                if (count <= 0)
-                {
-                    break;
-                }
-#else
-                m_impl->in.read(reinterpret_cast<char*>(buf.data()), frames_to_deliver * sizeof(buf[0]));
-                const auto count = m_impl->in.gcount() / 2;
-                if (!m_impl->in)
-                {
-                    if (!m_impl->in.bad())
-                        m_impl->in.clear();
-                    break;
-                }
-#endif
+void SoundBank::unload(const std::string& uri)
+{
+    m_impl->sounds.erase(uri);
+}
 
-                err = snd_pcm_writei(m_impl->handle, buf.data(), count / m_impl->channels);
-
-                if (m_impl->interrupt)
-                {
-                    snd_pcm_drop(m_impl->handle);
-                    return;
-                }
-
-                if (err == -EPIPE)
-                    detail::error("underrun");
-
-                if (err < 0)
-                    err = snd_pcm_recover(m_impl->handle, err, 0);
-
-                if (err > 0 && err < count / m_impl->channels)
-                {
-                    detail::error("short write to PCM device.");
-                }
-                else if (err < 0)
-                {
-                    detail::error("can't write to PCM device: {}", snd_strerror(err));
-                    //break;
-                }
-            }
-        } while (repeat);
-
-        snd_pcm_drain(m_impl->handle);
-    });
+void SoundBank::clear()
+{
+    m_impl->sounds.clear();
 }
 
-void Sound::stop()
+bool SoundBank::loaded(const std::string& uri) const
 {
-    snd_pcm_drain(m_impl->handle);
-    m_impl->interrupt = true;
+    return m_impl->sounds.find(uri) != m_impl->sounds.end();
 }
 
-Sound::Sound(Sound&&) noexcept = default;
-Sound& Sound::operator=(Sound&&) noexcept = default;
+size_t SoundBank::memory() const
+{
+    size_t total = 0;
+    for (const auto& sound : m_impl->sounds)
+        total += sound.second->size() * sizeof(detail::SoundBuffer::value_type);
+    return total;
+}
 
-Sound::~Sound() noexcept
+SoundStats SoundBank::stats() const
 {
-    m_impl->interrupt = true;
-    m_impl->play_thread.quit();
-    snd_pcm_close(m_impl->handle);
+    return m_impl->mixer->stats();
 }
 
 std::vector<std::string> Sound::enumerate_pcm_devices()
@@ -9,13 +9,11 @@
 
 #include "detail/spriteimpl.h"
 #include "egt/image.h"
-#include "egt/label.h"
 #include "egt/painter.h"
 #include "egt/sprite.h"
 
 #ifdef HAVE_LIBPLANES
 #include "egt/detail/screen/kmsoverlay.h"
-#include <planes/plane.h>
 #endif
 
 namespace egt
@@ -45,7 +43,10 @@ public:
     virtual shared_cairo_surface_t surface() const override;
 
 protected:
-    ImageLabel m_label;
+
+    /// Pan the plane to the current frame.
+    void pan();
+
     Sprite& m_interface;
 };
 #endif
@@ -98,17 +99,18 @@ static shared_cairo_surface_t frame_surface(const Rect& rect, const Image& image
 HardwareSprite::HardwareSprite(Sprite& iface, const Image& image, const Size& frame_size,
                                int frame_count, const Point& frame_point)
     : SpriteImpl(image, frame_size, frame_count, frame_point),
-      m_label(image),
       m_interface(iface)
 {
-    m_label.image_align().clear();
+    m_animation.bind(iface);
+
     iface.resize(m_image.size());
 
     iface.allocate_screen();
 
-    KMSOverlay* s = reinterpret_cast<KMSOverlay*>(iface.screen());
-    plane_set_pan_pos(s->s(), m_strips[m_strip].point.x(), m_strips[m_strip].point.y());
-    plane_set_pan_size(s->s(), m_frame.width(), m_frame.height());
+    pan();
+
+    // the whole sheet is drawn once, and frames are then only shown by panning
+    iface.add_damage(Rect({}, m_image.size()));
 
     // hack to change the size because the screen size and the box size are different
     iface.m_box.size(frame_size);
@@ -116,7 +118,8 @@ HardwareSprite::HardwareSprite(Sprite& iface, const Image& image, const Size& fr
 
 void HardwareSprite::draw(Painter& painter, const Rect& rect)
 {
-    m_label.draw(painter, rect);
+    painter.draw(rect.point());
+    painter.draw(rect, m_image);
 }
 
 void HardwareSprite::show_frame(int index)
@@ -124,17 +127,19 @@ void HardwareSprite::show_frame(int index)
     if (index != m_index)
     {
         m_index = index;
+        pan();
+    }
+}
 
-        Point origin = get_frame_origin(m_index);
+void HardwareSprite::pan()
+{
+    auto s = reinterpret_cast<KMSOverlay*>(m_interface.screen());
+    s->pan_pos(get_frame_origin(m_index));
+    s->pan_size(m_frame);
 
-        if (m_interface.visible())
-        {
-            KMSOverlay* s = reinterpret_cast<KMSOverlay*>(m_interface.screen());
-            plane_set_pan_pos(s->s(), origin.x(), origin.y());
-            plane_set_pan_size(s->s(), m_frame.width(), m_frame.height());
-            plane_apply(s->s());
-        }
-    }
+    // a hidden plane gets the pan position when it is shown again
+    if (m_interface.visible())
+        s->apply();
 }
 
 shared_cairo_surface_t HardwareSprite::surface() const
@@ -156,6 +161,8 @@ SoftwareSprite::SoftwareSprite(Sprite& iface, const Image& image, const Size& fr
     : SpriteImpl(image, frame_size, frame_count, frame_point),
       m_interface(iface)
 {
+    m_animation.bind(iface);
+
     iface.m_box = Rect({}, frame_size);
 }
 
@@ -195,7 +202,7 @@ void SoftwareSprite::paint(Painter& painter)
 Sprite::Sprite(WindowHint hint)
     : Window(PixelFormat::argb8888, hint)
 {
-    name("Sprite" + std::to_string(m_widgetid));
+    default_name("Sprite", m_widgetid);
     fill_flags().clear();
 }
 
@@ -204,7 +211,7 @@ Sprite::Sprite(const Image& image, const Size& frame_size,
                WindowHint hint)
     : Window(Rect({}, image.size()), PixelFormat::argb8888, hint)
 {
-    name("Sprite" + std::to_string(m_widgetid));
+    default_name("Sprite", m_widgetid);
     fill_flags().clear();
     create_impl(image, frame_size, frame_count, frame_point);
 }
@@ -281,6 +288,24 @@ void Sprite::change_strip(uint32_t id)
     m_simpl->change_strip(id);
 }
 
+void Sprite::play(std::chrono::milliseconds frame_interval, bool loop)
+{
+    if (!m_simpl)
+        throw std::runtime_error("no sprite implementation initialized");
+    m_simpl->play(frame_interval, loop);
+}
+
+void Sprite::stop()
+{
+    if (m_simpl)
+        m_simpl->stop();
+}
+
+bool Sprite::playing() const
+{
+    return m_simpl && m_simpl->playing();
+}
+
 uint32_t Sprite::add_strip(int frame_count, const Point& frame_point)
 {
     if (!m_simpl)
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/fmt.h"
+#include "detail/glyphatlas.h"
+#include "egt/detail/math.h"
+#include "egt/detail/string.h"
+#include "egt/detail/surfacepool.h"
+#include "egt/frame.h"
+#include "egt/painter.h"
+#include "egt/serialize.h"
+#include "egt/streamchart.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace egt
+{
+inline namespace v1
+{
+
+/// Space between the labels and the plot area.
+static constexpr DefaultDim LABEL_SPACE = 4;
+
+StreamChart::StreamChart(const Rect& rect, size_t capacity) noexcept
+    : Widget(rect)
+{
+    default_name("StreamChart", m_widgetid);
+    initialize(capacity);
+}
+
+StreamChart::StreamChart(Frame& parent, const Rect& rect, size_t capacity) noexcept
+    : StreamChart(rect, capacity)
+{
+    parent.add(*this);
+}
+
+StreamChart::StreamChart(Serializer::Properties& props, bool is_derived) noexcept
+    : Widget(props, true)
+{
+    initialize(DEFAULT_CAPACITY);
+
+    deserialize(props);
+
+    if (!is_derived)
+        deserialize_leaf(props);
+}
+
+void StreamChart::initialize(size_t capacity)
+{
+    border(theme().default_border());
+    fill_flags(Theme::FillFlag::blend);
+    padding(5);
+
+    m_capacity = std::max<size_t>(capacity, 1);
+    m_samples.resize(m_capacity * series_count());
+}
+
+size_t StreamChart::add_series(const Color& color)
+{
+    m_colors.push_back(color);
+    m_samples.assign(m_capacity * series_count(), 0.0);
+    m_head = 0;
+    m_count = 0;
+    invalidate();
+    return series_count() - 1;
+}
+
+void StreamChart::append(double value)
+{
+    append(std::vector<double> {value});
+}
+
+void StreamChart::append(const std::vector<double>& values)
+{
+    const auto n = series_count();
+    const double* last = m_count ? entry(m_count - 1) : nullptr;
+
+    double* slot;
+    if (m_count < m_capacity)
+    {
+        slot = entry(m_count++);
+    }
+    else
+    {
+        slot = &m_samples[m_head * n];
+        m_head = (m_head + 1) % m_capacity;
+    }
+
+    auto min = m_min;
+    auto max = m_max;
+    for (size_t s = 0; s < n; ++s)
+    {
+        slot[s] = s < values.size() ? values[s] : (last ? last[s] : 0.0);
+        min = std::min(min, slot[s]);
+        max = std::max(max, slot[s]);
+    }
+
+    if (m_auto_range && (min < m_min || max > m_max))
+    {
+        // grow with a margin, so that the range does not change every sample
+        const auto margin = (max - min) * 0.1;
+        range(min < m_min ? min - margin : m_min,
+              max > m_max ? max + margin : m_max);
+        return;
+    }
+
+    if (m_series_valid && m_series)
+    {
+        scroll_series();
+        damage(plot_area());
+    }
+    else
+    {
+        damage();
+    }
+}
+
+double StreamChart::sample(size_t series, size_t index) const
+{
+    if (series >= series_count() || index >= m_count)
+        throw std::out_of_range("sample index out of range");
+
+    return entry(index)[series];
+}
+
+void StreamChart::clear()
+{
+    if (!m_count)
+        return;
+
+    m_head = 0;
+    m_count = 0;
+    m_series_valid = false;
+    damage();
+}
+
+void StreamChart::capacity(size_t capacity)
+{
+    capacity = std::max<size_t>(capacity, 1);
+    if (capacity == m_capacity)
+        return;
+
+    // keep the most recent samples, from the oldest one
+    const auto n = series_count();
+    const auto count = std::min(m_count, capacity);
+    std::vector<double> samples(capacity * n);
+    for (size_t i = 0; i < count; ++i)
+        std::copy_n(entry(m_count - count + i), n, &samples[i * n]);
+
+    m_samples = std::move(samples);
+    m_capacity = capacity;
+    m_head = 0;
+    m_count = count;
+    m_series_valid = false;
+    damage();
+}
+
+void StreamChart::range(double min, double max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    if (detail::float_equal(min, max))
+    {
+        min -= 1.0;
+        max += 1.0;
+    }
+
+    if (detail::float_equal(min, m_min) && detail::float_equal(max, m_max))
+        return;
+
+    m_min = min;
+    m_max = max;
+    invalidate();
+}
+
+void StreamChart::grid(size_t columns, size_t rows)
+{
+    columns = std::max<size_t>(columns, 1);
+    rows = std::max<size_t>(rows, 1);
+    if (columns == m_columns && rows == m_rows)
+        return;
+
+    m_columns = columns;
+    m_rows = rows;
+    m_axes.reset();
+    damage();
+}
+
+void StreamChart::line_width(DefaultDim width)
+{
+    if (detail::change_if_diff<>(m_line_width, width))
+    {
+        m_series_valid = false;
+        damage();
+    }
+}
+
+void StreamChart::invalidate()
+{
+    m_axes.reset();
+    m_series_valid = false;
+    damage();
+}
+
+DefaultDim StreamChart::label_width() const
+{
+    cairo_text_extents_t te;
+    double width = 0;
+    for (size_t i = 0; i <= m_rows; ++i)
+    {
+        const auto value = m_max - (m_max - m_min) * i / m_rows;
+        cairo_scaled_font_text_extents(font().scaled_font(),
+                                       fmt::format("{:g}", value).c_str(), &te);
+        width = std::max(width, te.x_advance);
+    }
+
+    return std::ceil(width) + LABEL_SPACE;
+}
+
+Rect StreamChart::plot_area() const
+{
+    auto b = content_area();
+
+    cairo_font_extents_t fe;
+    cairo_scaled_font_extents(font().scaled_font(), &fe);
+
+    // room for the labels on the left, and half a label above and below
+    const auto left = label_width();
+    const DefaultDim half = std::ceil(fe.height / 2.);
+    return Rect(b.x() + left, b.y() + half,
+                std::max<DefaultDim>(b.width() - left, 0),
+                std::max<DefaultDim>(b.height() - half * 2, 0));
+}
+
+DefaultDim StreamChart::step() const
+{
+    const auto width = plot_area().width();
+    if (m_capacity < 2 || width < 2)
+        return 1;
+
+    return std::max<DefaultDim>(1, (width - 1) / static_cast<DefaultDim>(m_capacity - 1));
+}
+
+double StreamChart::value_y(double value) const
+{
+    const auto height = plot_area().height();
+    return (height - 1) * (m_max - value) / (m_max - m_min);
+}
+
+void StreamChart::draw_axes()
+{
+    const auto b = content_area();
+    const auto area = plot_area() - b.point();
+
+    m_axes = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, b.size());
+    shared_cairo_t cr(cairo_create(m_axes.get()), cairo_destroy);
+
+    // grid, aligned on pixels to stay sharp
+    cairo_set_source_rgba(cr.get(), m_layer_grid.redf(), m_layer_grid.greenf(),
+                          m_layer_grid.bluef(), m_layer_grid.alphaf());
+    cairo_set_line_width(cr.get(), 1);
+    for (size_t i = 0; i <= m_columns; ++i)
+    {
+        const auto x = std::floor(area.x() + (area.width() - 1.) * i / m_columns) + 0.5;
+        cairo_move_to(cr.get(), x, area.y());
+        cairo_line_to(cr.get(), x, area.y() + area.height());
+    }
+    for (size_t i = 0; i <= m_rows; ++i)
+    {
+        const auto y = std::floor(area.y() + (area.height() - 1.) * i / m_rows) + 0.5;
+        cairo_move_to(cr.get(), area.x(), y);
+        cairo_line_to(cr.get(), area.x() + area.width(), y);
+    }
+    cairo_stroke(cr.get());
+
+    // a label for each row, right aligned
+    cairo_set_scaled_font(cr.get(), m_layer_font.scaled_font());
+    cairo_set_source_rgba(cr.get(), m_layer_text.redf(), m_layer_text.greenf(),
+                          m_layer_text.bluef(), m_layer_text.alphaf());
+
+    cairo_font_extents_t fe;
+    cairo_font_extents(cr.get(), &fe);
+
+    for (size_t i = 0; i <= m_rows; ++i)
+    {
+        const auto label = fmt::format("{:g}", m_max - (m_max - m_min) * i / m_rows);
+        cairo_text_extents_t te;
+        cairo_text_extents(cr.get(), label.c_str(), &te);
+
+        const auto x = area.x() - LABEL_SPACE - te.x_advance;
+        const auto y = area.y() + (area.height() - 1.) * i / m_rows + (fe.ascent - fe.descent) / 2.;
+        detail::show_text(cr.get(), label, x, y);
+    }
+}
+
+void StreamChart::draw_series()
+{
+    const auto area = plot_area();
+
+    if (!m_series ||
+        cairo_image_surface_get_width(m_series.get()) != area.width() ||
+        cairo_image_surface_get_height(m_series.get()) != area.height())
+    {
+        m_series = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, area.size());
+    }
+
+    shared_cairo_t cr(cairo_create(m_series.get()), cairo_destroy);
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr.get());
+    cairo_set_operator(cr.get(), CAIRO_OPERATOR_OVER);
+
+    cairo_set_line_width(cr.get(), m_line_width);
+    cairo_set_line_cap(cr.get(), CAIRO_LINE_CAP_ROUND);
+    cairo_set_line_join(cr.get(), CAIRO_LINE_JOIN_ROUND);
+
+    const auto dx = step();
+    const auto right = area.width() - 1.;
+
+    for (size_t s = 0; s < series_count() && m_count > 1; ++s)
+    {
+        const auto& color = s ? m_colors[s - 1] : m_layer_line;
+        cairo_set_source_rgba(cr.get(), color.redf(), color.greenf(),
+                              color.bluef(), color.alphaf());
+
+        for (size_t i = 0; i < m_count; ++i)
+        {
+            const auto x = right - static_cast<double>(m_count - 1 - i) * dx;
+            cairo_line_to(cr.get(), x, value_y(entry(i)[s]));
+        }
+        cairo_stroke(cr.get());
+    }
+
+    m_series_valid = true;
+}
+
+void StreamChart::scroll_series()
+{
+    const auto width = cairo_image_surface_get_width(m_series.get());
+    const auto height = cairo_image_surface_get_height(m_series.get());
+    const auto stride = cairo_image_surface_get_stride(m_series.get());
+    const auto dx = std::min<DefaultDim>(step(), width);
+    constexpr auto bpp = 4;
+
+    cairo_surface_flush(m_series.get());
+    auto data = cairo_image_surface_get_data(m_series.get());
+
+    // the previous sample moves from the right edge to right - dx
+    const auto right = width - 1 - dx;
+    // what is left of the oldest dropped segment
+    const auto left = m_count == m_capacity ?
+                      std::max<DefaultDim>(width - 1 - static_cast<DefaultDim>(m_count - 1) * dx, 0) : 0;
+
+    for (DefaultDim y = 0; y < height; ++y)
+    {
+        auto row = data + y * stride;
+        std::memmove(row, row + dx * bpp, (width - dx) * bpp);
+        std::memset(row + (right + 1) * bpp, 0, (width - right - 1) * bpp);
+        std::memset(row, 0, left * bpp);
+    }
+
+    cairo_surface_mark_dirty(m_series.get());
+
+    if (m_count < 2)
+        return;
+
+    shared_cairo_t cr(cairo_create(m_series.get()), cairo_destroy);
+    cairo_set_line_width(cr.get(), m_line_width);
+    cairo_set_line_cap(cr.get(), CAIRO_LINE_CAP_ROUND);
+
+    const auto previous = entry(m_count - 2);
+    const auto current = entry(m_count - 1);
+    for (size_t s = 0; s < series_count(); ++s)
+    {
+        const auto& color = s ? m_colors[s - 1] : m_layer_line;
+        cairo_set_source_rgba(cr.get(), color.redf(), color.greenf(),
+                              color.bluef(), color.alphaf());
+        cairo_move_to(cr.get(), right, value_y(previous[s]));
+        cairo_line_to(cr.get(), width - 1, value_y(current[s]));
+        cairo_stroke(cr.get());
+    }
+}
+
+void StreamChart::draw(Painter& painter, const Rect& rect)
+{
+    draw_box(painter, Palette::ColorId::bg, Palette::ColorId::border);
+
+    const auto b = content_area();
+    const auto area = plot_area();
+    if (area.empty())
+        return;
+
+    // the layers are drawn again if the font or the palette changed
+    const auto line = color(Palette::ColorId::button_fg).first();
+    const auto grid = color(Palette::ColorId::button_bg).first();
+    const auto text = color(Palette::ColorId::label_text).first();
+    if (m_layer_font != font() || m_layer_line != line ||
+        m_layer_grid != grid || m_layer_text != text)
+    {
+        m_layer_font = font();
+        m_layer_line = line;
+        m_layer_grid = grid;
+        m_layer_text = text;
+        m_axes.reset();
+        m_series_valid = false;
+    }
+
+    if (!m_axes)
+        draw_axes();
+    if (!m_series_valid)
+        draw_series();
+
+    auto cr = painter.context().get();
+    Painter::AutoSaveRestore sr(painter);
+
+    const auto axes = Rect::intersection(b, rect);
+    cairo_set_source_surface(cr, m_axes.get(), b.x(), b.y());
+    cairo_rectangle(cr, axes.x(), axes.y(), axes.width(), axes.height());
+    cairo_fill(cr);
+
+    const auto series = Rect::intersection(area, rect);
+    cairo_set_source_surface(cr, m_series.get(), area.x(), area.y());
+    cairo_rectangle(cr, series.x(), series.y(), series.width(), series.height());
+    cairo_fill(cr);
+}
+
+void StreamChart::resize(const Size& size)
+{
+    if (size != this->size())
+    {
+        Widget::resize(size);
+        invalidate();
+    }
+}
+
+void StreamChart::serialize(Serializer& serializer) const
+{
+    Widget::serialize(serializer);
+
+    if (capacity() != DEFAULT_CAPACITY)
+        serializer.add_property("capacity", static_cast<unsigned int>(capacity()));
+    serializer.add_property("range_min", range_min());
+    serializer.add_property("range_max", range_max());
+    if (!auto_range())
+        serializer.add_property("auto_range", auto_range());
+    serializer.add_property("grid_columns", static_cast<unsigned int>(grid_columns()));
+    serializer.add_property("grid_rows", static_cast<unsigned int>(grid_rows()));
+    serializer.add_property("linewidth", line_width());
+}
+
+void StreamChart::deserialize(Serializer::Properties& props)
+{
+    auto min = m_min;
+    auto max = m_max;
+
+    props.erase(std::remove_if(props.begin(), props.end(), [&](auto & p)
+    {
+        const auto& name = std::get<0>(p);
+        const auto& value = std::get<1>(p);
+
+        if (name == "capacity")
+            capacity(std::stoul(value));
+        else if (name == "range_min")
+            min = std::stod(value);
+        else if (name == "range_max")
+            max = std::stod(value);
+        else if (name == "auto_range")
+            auto_range(detail::from_string(value));
+        else if (name == "grid_columns")
+            grid(std::stoul(value), m_rows);
+        else if (name == "grid_rows")
+            grid(m_columns, std::stoul(value));
+        else if (name == "linewidth")
+            line_width(std::stoi(value));
+        else
+            return false;
+        return true;
+    }), props.end());
+
+    range(min, max);
+}
+
+}
+}
@@ -4,25 +4,382 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/dump.h"
+#include "detail/egtlog.h"
+#include "detail/eraw.h"
+#include "detail/erawimage.h"
 #include "egt/canvas.h"
 #include "egt/detail/filesystem.h"
+#include "egt/detail/imagecache.h"
 #include "egt/detail/meta.h"
+#include "egt/detail/sharedstore.h"
 #include "egt/resource.h"
 #include "egt/respath.h"
 #include "egt/svgimage.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <librsvg/rsvg.h>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <unistd.h>
 
 namespace egt
 {
 inline namespace v1
 {
 
+static std::string& svg_cache_dir()
+{
+    static std::string dir = []()
+    {
+        auto value = std::getenv("EGT_SVG_CACHE_DIR");
+        if (value)
+            return std::string(value);
+
+        // otherwise rendered images are shared with the decoded ones
+        return detail::shared_image_store().dir();
+    }();
+    return dir;
+}
+
+void SvgImage::cache_dir(const std::string& dir)
+{
+    svg_cache_dir() = dir;
+}
+
+std::string SvgImage::cache_dir()
+{
+    return svg_cache_dir();
+}
+
+/// Open an SVG file, or resource data when not null.
+static std::shared_ptr<RsvgHandle> open_svg(const std::string& path,
+        const unsigned char* data, size_t len)
+{
+    RsvgHandle* handle = nullptr;
+
+    if (data)
+    {
+        handle = rsvg_handle_new_from_data(data, len, nullptr);
+        if (!handle)
+            throw std::runtime_error("unable to load svg resource: " + path);
+    }
+    else
+    {
+        handle = rsvg_handle_new_from_file(path.c_str(), nullptr);
+        if (!handle)
+            throw std::runtime_error("unable to load svg file: " + path);
+    }
+
+    return std::shared_ptr<RsvgHandle>(handle,
+    [](RsvgHandle * r) { g_object_unref(r); });
+}
+
+/**
+ * Render an element of an SVG, with dimensions dim, scaled to size and
+ * clipped to rect.
+ *
+ * This only uses its arguments, so it can run on any thread, as long as the
+ * handle is not used by another one.
+ */
+static shared_cairo_surface_t render_svg(RsvgHandle* rsvg, const RsvgDimensionData& dim,
+        const SizeF& size, const std::string& id, const RectF& rect)
+{
+    auto s = size;
+    if (!rect.empty())
+        s = rect.size();
+
+    Canvas canvas(s);
+    auto cr = canvas.context().get();
+
+    detail::code_timer(false, "render " + id + ": ", [&]()
+    {
+        if (!rect.empty())
+        {
+            cairo_translate(cr,
+                            -rect.x(),
+                            -rect.y());
+
+            cairo_rectangle(cr,
+                            rect.x(),
+                            rect.y(),
+                            rect.width(),
+                            rect.height());
+
+            cairo_clip(cr);
+        }
+
+        const auto scaled = size / SizeF(dim.width, dim.height);
+        cairo_scale(cr, scaled.width(), scaled.height());
+
+        /* To avoid getting the edge pixels blended with 0 alpha, which would
+         * occur with the default EXTEND_NONE. Use EXTEND_PAD for 1.2 or newer (2)
+         */
+        cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_PAD);
+
+        /* Replace the destination with the source instead of overlaying */
+        cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+
+        if (id.empty())
+            rsvg_handle_render_cairo(rsvg, cr);
+        else
+            rsvg_handle_render_cairo_sub(rsvg, cr, id.c_str());
+
+    });
+
+    return canvas.surface();
+}
+
+/// Load a rendered image from the cache, or nullptr.
+static shared_cairo_surface_t load_rendered(const std::string& cached)
+{
+    if (cached.empty() || !detail::exists(cached))
+        return nullptr;
+
+    return detail::load_eraw(cached);
+}
+
+/// Save a rendered image to the cache.
+static void save_rendered(const std::string& cached, const shared_cairo_surface_t& surface)
+{
+    if (cached.empty())
+        return;
+
+    cairo_surface_flush(surface.get());
+
+    // written aside and renamed, so other processes never read a partial file
+    const auto tmp = fmt::format("{}.{}.tmp", cached, ::getpid());
+    // uncompressed, so every process maps the same pages
+    detail::ErawImage::save(tmp, cairo_image_surface_get_data(surface.get()),
+                            cairo_image_surface_get_width(surface.get()),
+                            cairo_image_surface_get_height(surface.get()),
+                            detail::ErawImage::Format::raw);
+    if (std::rename(tmp.c_str(), cached.c_str()))
+        detail::warn("unable to save svg cache {}", cached);
+}
+
 struct SvgImage::SvgImpl
 {
     std::shared_ptr<RsvgHandle> rsvg;
     RsvgDimensionData dim{};
+
+    /**
+     * Serializes the use of rsvg, which is shared with the workers of
+     * render_async().
+     */
+    std::shared_ptr<std::mutex> lock{std::make_shared<std::mutex>()};
+
+    /// Where the SVG is loaded from, to parse it when needed.
+    detail::SchemeType type{detail::SchemeType::unknown};
+    std::string path;
+
+    /// Hash of the SVG content, or 0 when not cached.
+    size_t hash{0};
+
+    /// Raw position and dimensions of an element, as rsvg reports them.
+    struct Element
+    {
+        bool exists{false};
+        RsvgPositionData pos{};
+        RsvgDimensionData dim{};
+    };
+
+    /// Elements looked up, from rsvg or the cache.
+    std::map<std::string, Element> elements;
+
+    /// Parse the SVG if not done yet.
+    void parse();
+
+    /// Get an element, looking it up with rsvg and caching it if needed.
+    const Element& element(const std::string& id);
+
+    /// Resource data of the SVG, or nullptr for a file.
+    const unsigned char* data() const;
+
+    /// Path of a cache file, or empty if not cached.
+    std::string cache_path(const std::string& name) const;
+
+    /// Path of the cache file of a rendered image, or empty if not cached.
+    std::string render_path(const std::string& id, const SizeF& size, const RectF& rect) const;
+
+    /// Load the dimensions and elements from the cache.
+    bool load_metadata();
+
+    /// Save the dimensions and elements to the cache.
+    void save_metadata() const;
+
+    /// Render on a worker thread, with everything copied from the event loop.
+    struct RenderJob
+    {
+        void operator()();
+
+        std::shared_ptr<RsvgHandle> rsvg;
+        std::shared_ptr<std::mutex> lock;
+        RsvgDimensionData dim{};
+        std::string path;
+        const unsigned char* data{nullptr};
+        size_t len{0};
+        SizeF size;
+        std::string id;
+        RectF rect;
+        std::string cached;
+
+        /// The rendered image, or nullptr.
+        shared_cairo_surface_t surface;
+        std::string error;
+    };
 };
 
+void SvgImage::SvgImpl::RenderJob::operator()()
+{
+    try
+    {
+        surface = load_rendered(cached);
+        if (surface)
+            return;
+
+        std::unique_lock<std::mutex> guard(*lock, std::try_to_lock);
+        auto handle = rsvg;
+        if (!handle || !guard.owns_lock())
+        {
+            // parsing again is faster than waiting for another worker
+            if (guard.owns_lock())
+                guard.unlock();
+            handle = open_svg(path, data, len);
+        }
+
+        surface = render_svg(handle.get(), dim, size, id, rect);
+        if (guard.owns_lock())
+            guard.unlock();
+
+        save_rendered(cached, surface);
+    }
+    catch (const std::exception& e)
+    {
+        surface.reset();
+        error = e.what();
+    }
+}
+
+void SvgImage::SvgImpl::parse()
+{
+    if (rsvg)
+        return;
+
+    const auto d = data();
+    rsvg = open_svg(path, d, d ? ResourceManager::instance().size(path.c_str()) : 0);
+
+    // this is a somewhat expensive operation, so do it once
+    rsvg_handle_get_dimensions(rsvg.get(), &dim);
+}
+
+const SvgImage::SvgImpl::Element& SvgImage::SvgImpl::element(const std::string& id)
+{
+    auto i = elements.find(id);
+    if (i != elements.end())
+        return i->second;
+
+    parse();
+
+    Element element;
+    {
+        std::lock_guard<std::mutex> guard(*lock);
+        element.exists = rsvg_handle_has_sub(rsvg.get(), id.c_str());
+        if (element.exists)
+        {
+            rsvg_handle_get_position_sub(rsvg.get(), &element.pos, id.c_str());
+            rsvg_handle_get_dimensions_sub(rsvg.get(), &element.dim, id.c_str());
+        }
+    }
+
+    i = elements.emplace(id, element).first;
+    save_metadata();
+    return i->second;
+}
+
+const unsigned char* SvgImage::SvgImpl::data() const
+{
+    if (type != detail::SchemeType::resource)
+        return nullptr;
+
+    return ResourceManager::instance().data(path.c_str());
+}
+
+std::string SvgImage::SvgImpl::cache_path(const std::string& name) const
+{
+    if (!hash)
+        return {};
+
+    return fmt::format("{}/{:016x}{}", svg_cache_dir(), hash, name);
+}
+
+std::string SvgImage::SvgImpl::render_path(const std::string& id, const SizeF& size,
+        const RectF& rect) const
+{
+    return cache_path(fmt::format("-{:016x}.eraw",
+                                  std::hash<std::string>()(
+                                      fmt::format("{}:{}x{}:{},{},{}x{}", id,
+                                                  size.width(), size.height(),
+                                                  rect.x(), rect.y(), rect.width(), rect.height()))));
+}
+
+bool SvgImage::SvgImpl::load_metadata()
+{
+    std::ifstream in(cache_path(".meta"));
+    if (!in)
+        return false;
+
+    // the first line is the size, then one element per line
+    if (!(in >> dim.width >> dim.height))
+        return false;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream ss(line);
+        std::string id;
+        Element element;
+        if (ss >> id >> element.exists >> element.pos.x >> element.pos.y >>
+            element.dim.width >> element.dim.height >> element.dim.em >> element.dim.ex)
+            elements.emplace(id, element);
+    }
+
+    return true;
+}
+
+void SvgImage::SvgImpl::save_metadata() const
+{
+    const auto path = cache_path(".meta");
+    if (path.empty())
+        return;
+
+    // written aside and renamed, so other processes never read a partial file
+    const auto tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out)
+            return;
+
+        out << dim.width << " " << dim.height << "\n";
+        for (const auto& element : elements)
+        {
+            out << element.first << " " << element.second.exists << " " <<
+                element.second.pos.x << " " << element.second.pos.y << " " <<
+                element.second.dim.width << " " << element.second.dim.height << " " <<
+                element.second.dim.em << " " << element.second.dim.ex << "\n";
+        }
+
+        if (!out)
+            return;
+    }
+
+    if (std::rename(tmp.c_str(), path.c_str()))
+        detail::warn("unable to save svg cache {}", path);
+}
+
 SvgImage::SvgImage()
     : m_impl(std::make_unique<SvgImage::SvgImpl>())
 {
@@ -48,6 +405,45 @@ Image SvgImage::render(const std::string& id, const RectF& rect) const
     return Image(do_render(id, rect), m_uri);
 }
 
+uint64_t SvgImage::render_async(const std::string& id, const RectF& rect,
+                                std::function<void(const Image&)> callback) const
+{
+    if (m_impl->path.empty())
+    {
+        if (callback)
+            callback(Image());
+        return 0;
+    }
+
+    auto job = std::make_shared<SvgImpl::RenderJob>();
+    job->rsvg = m_impl->rsvg;
+    job->lock = m_impl->lock;
+    job->dim = m_impl->dim;
+    job->path = m_impl->path;
+    job->data = m_impl->data();
+    if (job->data)
+        job->len = ResourceManager::instance().size(m_impl->path.c_str());
+    job->size = size();
+    job->id = id;
+    job->rect = rect;
+    job->cached = m_impl->render_path(id, job->size, rect);
+
+    return detail::image_cache().post([job]() { (*job)(); },
+                                      [job, uri = m_uri, callback = std::move(callback)]()
+    {
+        if (!job->surface)
+            detail::warn("unable to render svg {}{}: {}", uri, job->id, job->error);
+
+        if (callback)
+            callback(job->surface ? Image(job->surface, uri) : Image());
+    });
+}
+
+void SvgImage::cancel(uint64_t id)
+{
+    detail::image_cache().cancel(id);
+}
+
 RectF SvgImage::id_box(const std::string& id) const
 {
     RectF result;
@@ -55,21 +451,19 @@ RectF SvgImage::id_box(const std::string& id) const
     if (id.empty())
         return size();
 
-    if (m_impl->rsvg)
+    if (!m_impl->path.empty())
     {
         auto s = size();
         auto hfactor = s.width() / m_impl->dim.width;
         auto vfactor = s.height() / m_impl->dim.height;
 
-        RsvgPositionData pos;
-        if (rsvg_handle_get_position_sub(m_impl->rsvg.get(), &pos, id.c_str()))
+        const auto& element = m_impl->element(id);
+        if (element.exists)
         {
+            const auto& pos = element.pos;
             result.point(PointF(pos.x * hfactor, pos.y * vfactor));
-        }
 
-        RsvgDimensionData dim{};
-        if (rsvg_handle_get_dimensions_sub(m_impl->rsvg.get(), &dim, id.c_str()))
-        {
+            const auto& dim = element.dim;
             /*
              * This +1 here in both dimensions is a hack of a workaround.  The
              * existing API in librsvg uses integers for position and dimension
@@ -88,8 +482,8 @@ RectF SvgImage::id_box(const std::string& id) const
 
 bool SvgImage::id_exists(const std::string& id) const
 {
-    if (m_impl->rsvg)
-        return rsvg_handle_has_sub(m_impl->rsvg.get(), id.c_str());
+    if (!m_impl->path.empty())
+        return m_impl->element(id).exists;
 
     return false;
 }
@@ -104,7 +498,7 @@ SizeF SvgImage::size() const
 {
     auto result = m_size;
 
-    if (m_impl->rsvg)
+    if (!m_impl->path.empty())
     {
         if (m_size.width() <= 0 && m_size.height() > 0)
         {
@@ -126,9 +520,14 @@ SizeF SvgImage::size() const
 
 void SvgImage::load()
 {
+    m_impl = std::make_unique<SvgImage::SvgImpl>();
+
     std::string path;
     auto type = detail::resolve_path(m_uri, path);
 
+    std::string_view content;
+    std::vector<unsigned char> file;
+
     switch (type)
     {
     case detail::SchemeType::resource:
@@ -137,18 +536,8 @@ void SvgImage::load()
         if (!data)
             throw std::runtime_error("resource not found: " + path);
 
-        auto handle = rsvg_handle_new_from_data(data,
-                                                ResourceManager::instance().size(path.c_str()),
-                                                nullptr);
-
-        if (!handle)
-            throw std::runtime_error("unable to load svg resource: " + m_uri);
-
-        m_impl->rsvg = std::shared_ptr<RsvgHandle>(handle,
-        [](RsvgHandle * r) { g_object_unref(r); });
-
-        // this is a somewhat expensive operation, so do it once
-        rsvg_handle_get_dimensions(m_impl->rsvg.get(), &m_impl->dim);
+        content = std::string_view(reinterpret_cast<const char*>(data),
+                                   ResourceManager::instance().size(path.c_str()));
         break;
     }
     case detail::SchemeType::filesystem:
@@ -156,16 +545,11 @@ void SvgImage::load()
         if (!detail::exists(path))
             throw std::runtime_error("file not found: " + path);
 
-        auto handle = rsvg_handle_new_from_file(path.c_str(), nullptr);
-
-        if (!handle)
-            throw std::runtime_error("unable to load svg file: " + m_uri);
-
-        m_impl->rsvg = std::shared_ptr<RsvgHandle>(handle,
-        [](RsvgHandle * r) { g_object_unref(r); });
-
-        // this is a somewhat expensive operation, so do it once
-        rsvg_handle_get_dimensions(m_impl->rsvg.get(), &m_impl->dim);
+        if (!svg_cache_dir().empty())
+        {
+            file = detail::read_file(path);
+            content = std::string_view(reinterpret_cast<const char*>(file.data()), file.size());
+        }
         break;
     }
     default:
@@ -173,53 +557,45 @@ void SvgImage::load()
         throw std::runtime_error("unsupported uri: " + m_uri);
     }
     }
-}
 
-shared_cairo_surface_t SvgImage::do_render(const std::string& id, const RectF& rect) const
-{
-    auto s = size();
-    if (!rect.empty())
-        s = rect.size();
+    m_impl->type = type;
+    m_impl->path = path;
 
-    Canvas canvas(s);
-    auto cr = canvas.context().get();
-
-    detail::code_timer(false, "render " + id + ": ", [&]()
+    if (!svg_cache_dir().empty() && !content.empty() &&
+        detail::exists(svg_cache_dir()))
     {
-        if (!rect.empty())
-        {
-            cairo_translate(cr,
-                            -rect.x(),
-                            -rect.y());
+        // the content, not the path, so edited files are not stale
+        m_impl->hash = std::hash<std::string_view>()(content) ^ content.size();
 
-            cairo_rectangle(cr,
-                            rect.x(),
-                            rect.y(),
-                            rect.width(),
-                            rect.height());
+        // a cached SVG is only parsed when something is not in the cache
+        if (m_impl->load_metadata())
+            return;
+    }
 
-            cairo_clip(cr);
-        }
+    m_impl->parse();
+    m_impl->save_metadata();
+}
 
-        const auto scaled = size() / SizeF(m_impl->dim.width, m_impl->dim.height);
-        cairo_scale(cr, scaled.width(), scaled.height());
+shared_cairo_surface_t SvgImage::do_render(const std::string& id, const RectF& rect) const
+{
+    const auto cached = m_impl->render_path(id, size(), rect);
+    if (auto surface = load_rendered(cached))
+        return surface;
 
-        /* To avoid getting the edge pixels blended with 0 alpha, which would
-         * occur with the default EXTEND_NONE. Use EXTEND_PAD for 1.2 or newer (2)
-         */
-        cairo_pattern_set_extend(cairo_get_source(cr), CAIRO_EXTEND_PAD);
+    if (m_impl->path.empty())
+        return Canvas(rect.empty() ? size() : rect.size()).surface();
 
-        /* Replace the destination with the source instead of overlaying */
-        cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    m_impl->parse();
 
-        if (id.empty())
-            rsvg_handle_render_cairo(m_impl->rsvg.get(), cr);
-        else
-            rsvg_handle_render_cairo_sub(m_impl->rsvg.get(), cr, id.c_str());
+    shared_cairo_surface_t surface;
+    {
+        std::lock_guard<std::mutex> guard(*m_impl->lock);
+        surface = render_svg(m_impl->rsvg.get(), m_impl->dim, size(), id, rect);
+    }
 
-    });
+    save_rendered(cached, surface);
 
-    return canvas.surface();
+    return surface;
 }
 
 SvgImage::SvgImage(SvgImage&&) noexcept = default;
@@ -18,6 +18,9 @@
 #include "egt/serialize.h"
 #include "egt/text.h"
 #include "layout.h"
+#include <algorithm>
+#include <iterator>
+#include <string_view>
 
 #ifdef ENABLE_VIRTUALKEYBOARD
 #include "egt/virtualkeyboard.h"
@@ -38,6 +41,7 @@ TextRect& TextRect::consolidate(const TextRect& r, cairo_t* cr) noexcept
     m_text += r.m_text;
     m_rect.width(m_rect.width() + r.m_rect.width());
     cairo_text_extents(cr, m_text.c_str(), &m_te);
+    m_advances.clear();
     return *this;
 }
 
@@ -74,11 +78,50 @@ TextRect TextRect::split(size_t pos, cairo_t* cr) noexcept
     m_text = head_text;
     m_rect.width(head_width);
     m_te = head_te;
+    m_advances.clear();
 
     return tail;
 }
 
+const std::vector<float>& TextRect::advances(cairo_t* cr) const
+{
+    if (m_advances.empty())
+    {
+        m_advances.reserve(m_text.size() + 1);
+        m_advances.push_back(0);
+
+        // a single character is already measured
+        if (length() == 1)
+        {
+            m_advances.push_back(m_te.x_advance);
+            return m_advances;
+        }
+
+        for (detail::utf8_const_iterator ch(m_text.begin(), m_text.begin(), m_text.end());
+             ch != detail::utf8_const_iterator(m_text.end(), m_text.begin(), m_text.end()); ++ch)
+        {
+            const auto txt = detail::utf8_char_to_string(ch.base(), m_text.cend());
+            cairo_text_extents_t te;
+            cairo_text_extents(cr, txt.c_str(), &te);
+            m_advances.push_back(m_advances.back() + static_cast<float>(te.x_advance));
+        }
+    }
+
+    return m_advances;
+}
+
+size_t TextRect::fitting_length(float width, cairo_t* cr) const
+{
+    const auto& a = advances(cr);
+    return std::distance(a.begin() + 1, std::upper_bound(a.begin() + 1, a.end(), width));
+}
+
 void TextBox::tokenize(TextRects& rects)
+{
+    tokenize(m_text, rects, 0);
+}
+
+void TextBox::tokenize(const std::string& text, TextRects& rects, uint32_t behave)
 {
     cairo_t* cr = context();
     cairo_font_extents_t fe;
@@ -88,23 +131,23 @@ void TextBox::tokenize(TextRects& rects)
     static const std::string delimiters = " \t\n\r";
     std::vector<std::string> tokens;
 
-    tokens.reserve(m_text.length());
+    tokens.reserve(text.length());
 
     bool multiline = text_flags().is_set(TextBox::TextFlag::multiline);
     if (multiline && text_flags().is_set(TextBox::TextFlag::word_wrap))
     {
-        detail::tokenize_with_delimiters(m_text.cbegin(),
-                                         m_text.cend(),
+        detail::tokenize_with_delimiters(text.cbegin(),
+                                         text.cend(),
                                          delimiters.cbegin(),
                                          delimiters.cend(),
                                          tokens);
     }
     else
     {
-        for (detail::utf8_const_iterator ch(m_text.begin(), m_text.begin(), m_text.end());
-             ch != detail::utf8_const_iterator(m_text.end(), m_text.begin(), m_text.end()); ++ch)
+        for (detail::utf8_const_iterator ch(text.begin(), text.begin(), text.end());
+             ch != detail::utf8_const_iterator(text.end(), text.begin(), text.end()); ++ch)
         {
-            auto t = detail::utf8_char_to_string(ch.base(), m_text.cend());
+            auto t = detail::utf8_char_to_string(ch.base(), text.cend());
 
             if (!multiline && t == "\n")
                 break;
@@ -114,7 +157,6 @@ void TextBox::tokenize(TextRects& rects)
     }
 
     uint32_t default_behave = 0;
-    uint32_t behave = default_behave;
 
     bool empty_line = true;
     for (const auto& t : tokens)
@@ -147,7 +189,12 @@ void TextBox::tokenize(TextRects& rects)
 
 void TextBox::compute_layout(TextRects& rects)
 {
-    const auto boundaries = text_boundaries();
+    compute_layout(rects.begin(), rects.end(), text_boundaries());
+}
+
+void TextBox::compute_layout(TextRects::iterator begin, TextRects::iterator end,
+                             const Rect& boundaries)
+{
     lay_context ctx;
     lay_init_context(&ctx);
 
@@ -156,7 +203,7 @@ void TextBox::compute_layout(TextRects& rects)
         lay_destroy_context(&ctx);
     });
 
-    lay_reserve_items_capacity(&ctx, rects.size() + 2);
+    lay_reserve_items_capacity(&ctx, std::distance(begin, end) + 2);
 
     lay_id outer_parent = lay_item(&ctx);
     lay_id inner_parent = lay_item(&ctx);
@@ -170,14 +217,14 @@ void TextBox::compute_layout(TextRects& rects)
     lay_set_behave(&ctx, inner_parent, dbehave);
     lay_insert(&ctx, outer_parent, inner_parent);
 
-    for (const auto& r : rects)
+    for (auto r = begin; r != end; ++r)
     {
-        if (r.end_of_non_empty_line())
+        if (r->end_of_non_empty_line())
             continue;
 
         lay_id c = lay_item(&ctx);
-        lay_set_size_xy(&ctx, c, r.rect().width(), r.rect().height());
-        lay_set_behave(&ctx, c, r.behave());
+        lay_set_size_xy(&ctx, c, r->rect().width(), r->rect().height());
+        lay_set_behave(&ctx, c, r->behave());
         lay_insert(&ctx, inner_parent, c);
     }
 
@@ -186,7 +233,7 @@ void TextBox::compute_layout(TextRects& rects)
     DefaultDim line_y = boundaries.y() - 1;
     bool next_is_beginning_of_line = true;
 
-    auto it = rects.begin();
+    auto it = begin;
     auto child = lay_first_child(&ctx, inner_parent);
     while (child != LAY_INVALID_ID)
     {
@@ -210,7 +257,7 @@ void TextBox::compute_layout(TextRects& rects)
         child = pchild->next_sibling;
         ++it;
 
-        if (it != rects.end() && it->end_of_non_empty_line())
+        if (it != end && it->end_of_non_empty_line())
         {
             it->point(Point(x, y));
             next_is_beginning_of_line = true;
@@ -659,8 +706,27 @@ void TextBox::draw_text(Painter& painter, const Rect& rect)
     cairo_font_extents_t fe;
     cairo_font_extents(cr, &fe);
 
-    for (const auto& r : m_rects)
+    auto begin = m_rects.cbegin();
+    if (!m_paragraphs.empty())
     {
+        // start with the first visible paragraph
+        auto paragraph = std::partition_point(m_paragraphs.begin(), m_paragraphs.end(),
+                                              [&clip](const Paragraph & paragraph)
+        {
+            return paragraph.top + paragraph.height <= clip.top();
+        });
+        begin = paragraph != m_paragraphs.end() ? TextRects::const_iterator(paragraph->first) :
+                m_rects.cend();
+    }
+
+    for (auto i = begin; i != m_rects.cend(); ++i)
+    {
+        const auto& r = *i;
+
+        // lines of paragraphs are in order, and the next ones aren't visible
+        if (!m_paragraphs.empty() && r.rect().top() >= clip.bottom())
+            break;
+
         if (r.text() != "\n")
         {
             if (!r.rect().intersect(rect))
@@ -704,6 +770,230 @@ void TextBox::prepare_text(TextRects& rects)
     set_selection(rects);
 }
 
+bool TextBox::paragraph_layout() const
+{
+    // the lines of other alignments depend on the widest or on the last one
+    const auto& align = text_align();
+    return text_flags().is_set(TextFlag::multiline) &&
+           (align.is_set(AlignFlag::expand_horizontal) || align.is_set(AlignFlag::left)) &&
+           (align.is_set(AlignFlag::expand_vertical) || align.is_set(AlignFlag::top));
+}
+
+void TextBox::layout_text(bool tag)
+{
+    m_line_advances.clear();
+
+    if (!paragraph_layout() || m_select_len)
+    {
+        m_paragraphs.clear();
+
+        TextRects rects;
+        prepare_text(rects);
+        if (tag)
+            tag_text(m_rects, rects);
+        m_rects = std::move(rects);
+        return;
+    }
+
+    cairo_set_scaled_font(context(), font().scaled_font());
+
+    const auto boundaries = text_boundaries();
+
+    TextRects prev;
+    if (m_paragraphs.empty() ||
+        m_paragraph_boundaries.width() != boundaries.width() ||
+        m_paragraph_font != font() ||
+        m_paragraph_flags != text_flags())
+    {
+        // start over
+        m_paragraphs.clear();
+        prev.swap(m_rects);
+        m_paragraph_font = font();
+        m_paragraph_flags = text_flags();
+    }
+    else if (m_paragraph_boundaries.point() != boundaries.point())
+    {
+        // scrolled
+        move_text(m_rects.begin(), m_paragraphs.begin(),
+                  boundaries.point() - m_paragraph_boundaries.point());
+    }
+    m_paragraph_boundaries = boundaries;
+
+    std::vector<std::string_view> texts;
+    const std::string_view text(m_text);
+    for (size_t start = 0;;)
+    {
+        const auto end = text.find('\n', start);
+        if (end == std::string_view::npos)
+        {
+            texts.push_back(text.substr(start));
+            break;
+        }
+        texts.push_back(text.substr(start, end + 1 - start));
+        start = end + 1;
+    }
+
+    // only what is between the unchanged paragraphs is laid out again
+    const auto count = m_paragraphs.size();
+    size_t prefix = 0;
+    while (prefix < count && prefix < texts.size() &&
+           m_paragraphs[prefix].text == texts[prefix])
+        ++prefix;
+
+    size_t suffix = 0;
+    while (suffix < count - prefix && suffix < texts.size() - prefix &&
+           m_paragraphs[count - suffix - 1].text == texts[texts.size() - suffix - 1])
+        ++suffix;
+
+    if (prefix == count && count == texts.size())
+        return;
+
+    auto bottom = [&boundaries](const std::vector<Paragraph>& paragraphs, size_t index)
+    {
+        if (index < paragraphs.size())
+            return paragraphs[index].top;
+        if (index)
+            return paragraphs[index - 1].top + paragraphs[index - 1].height;
+        return boundaries.y();
+    };
+
+    const auto first = prefix < count ? m_paragraphs[prefix].first : m_rects.end();
+    const auto last = suffix ? m_paragraphs[count - suffix].first : m_rects.end();
+    const auto old_bottom = bottom(m_paragraphs, count - suffix);
+    prev.splice(prev.end(), m_rects, first, last);
+
+    auto y = bottom(m_paragraphs, prefix);
+    auto pos = prefix ? m_paragraphs[prefix - 1].pos + m_paragraphs[prefix - 1].length : 0;
+
+    TextRects next;
+    std::vector<Paragraph> paragraphs;
+    for (auto i = prefix; i < texts.size() - suffix; ++i)
+    {
+        Paragraph paragraph;
+        paragraph.text = std::string(texts[i]);
+        paragraph.length = detail::utf8len(paragraph.text);
+        paragraph.pos = pos;
+        paragraph.top = y;
+
+        TextRects rects;
+        tokenize(paragraph.text, rects, i ? LAY_BREAK : 0);
+        compute_layout(rects.begin(), rects.end(),
+                       Rect(boundaries.x(), y, boundaries.width(), boundaries.height()));
+
+        for (const auto& r : rects)
+        {
+            if (r.text() == "\n")
+                continue;
+
+            if (paragraph.rect.empty())
+                paragraph.rect = r.rect();
+            else
+                paragraph.rect = Rect::merge(paragraph.rect, r.rect());
+        }
+
+        if (rects.empty())
+        {
+            paragraph.first = last;
+        }
+        else
+        {
+            paragraph.first = rects.begin();
+            paragraph.height = rects.back().rect().bottom() - y;
+        }
+
+        next.splice(next.end(), rects);
+        paragraphs.push_back(std::move(paragraph));
+        y += paragraphs.back().height;
+        pos += paragraphs.back().length;
+    }
+
+    if (tag)
+        tag_text(prev, next);
+
+    m_rects.splice(last, next);
+
+    auto p = m_paragraphs.erase(m_paragraphs.begin() + prefix,
+                                m_paragraphs.begin() + (count - suffix));
+    p = m_paragraphs.insert(p, std::make_move_iterator(paragraphs.begin()),
+                            std::make_move_iterator(paragraphs.end()));
+    p += paragraphs.size();
+
+    for (auto i = p; i != m_paragraphs.end(); ++i)
+    {
+        i->pos = pos;
+        pos += i->length;
+    }
+
+    if (y != old_bottom)
+    {
+        move_text(last, p, Point(0, y - old_bottom));
+
+        // the following lines moved
+        if (tag)
+        {
+            const auto area = text_area();
+            const auto top = std::min(y, old_bottom);
+            if (top < area.bottom())
+                damage_text(Rect(area.x(), top, area.width(), area.bottom() - top));
+        }
+    }
+}
+
+void TextBox::move_text(TextRects::iterator begin,
+                        std::vector<Paragraph>::iterator first,
+                        const Point& offset)
+{
+    for (auto i = begin; i != m_rects.end(); ++i)
+        i->point(i->rect().point() + offset);
+
+    for (auto i = first; i != m_paragraphs.end(); ++i)
+    {
+        i->top += offset.y();
+        if (!i->rect.empty())
+            i->rect.point(i->rect.point() + offset);
+    }
+}
+
+void TextBox::index_paragraphs()
+{
+    if (m_paragraphs.empty())
+        return;
+
+    // paragraphs start at the same positions, in TextRects that may differ
+    auto paragraph = m_paragraphs.begin();
+    size_t pos = 0;
+    for (auto i = m_rects.begin(); i != m_rects.end(); ++i)
+    {
+        while (paragraph != m_paragraphs.end() && paragraph->pos == pos)
+        {
+            paragraph->first = i;
+            ++paragraph;
+        }
+        pos += i->length();
+    }
+
+    for (; paragraph != m_paragraphs.end(); ++paragraph)
+        paragraph->first = m_rects.end();
+}
+
+TextRects::const_iterator TextBox::paragraph_start(size_t cursor_pos, size_t& pos) const
+{
+    pos = 0;
+    if (m_paragraphs.empty())
+        return m_rects.cbegin();
+
+    // the last paragraph starting at or before the position
+    auto paragraph = std::upper_bound(m_paragraphs.begin(), m_paragraphs.end(), cursor_pos,
+                                      [](size_t p, const Paragraph & paragraph)
+    {
+        return p < paragraph.pos;
+    });
+    --paragraph;
+
+    pos = paragraph->pos;
+    return paragraph->first;
+}
+
 constexpr static auto CURSOR_WIDTH = 2;
 constexpr static auto CURSOR_X_MARGIN = 1;
 constexpr static auto CURSOR_RECT_WIDTH = CURSOR_WIDTH + 2 * CURSOR_X_MARGIN;
@@ -719,8 +1009,10 @@ void TextBox::get_cursor_rect()
     Point p(boundaries.point() + Point(-CURSOR_X_MARGIN, 0));
     Size s(CURSOR_RECT_WIDTH, fe.height);
 
-    size_t pos = 0;
-    for (auto itr = m_rects.cbegin(); itr != m_rects.cend(); ++itr)
+    // the cursor may be after the newline ending the previous paragraph
+    size_t pos;
+    for (auto itr = paragraph_start(m_cursor_pos ? m_cursor_pos - 1 : 0, pos);
+         itr != m_rects.cend(); ++itr)
     {
         const auto& r = *itr;
 
@@ -774,7 +1066,7 @@ void TextBox::get_cursor_rect()
 
 void TextBox::refresh_text_area()
 {
-    prepare_text(m_rects);
+    layout_text(false);
     get_cursor_rect();
     invalidate_text_rect();
     update_sliders();
@@ -809,7 +1101,7 @@ void TextBox::init_sliders()
     auto redraw = [this]()
     {
         damage();
-        prepare_text(m_rects);
+        layout_text(false);
         get_cursor_rect();
         invalidate_text_rect();
     };
@@ -1072,7 +1364,7 @@ m_canvas(Size(1, 1)),
 m_cr(m_canvas.context().get()),
 m_text_flags(flags)
 {
-    name("TextBox" + std::to_string(m_widgetid));
+    default_name("TextBox", m_widgetid);
     initialize();
 
     insert(text);
@@ -1122,8 +1414,11 @@ void TextBox::initialize(bool init_inherited_properties)
     }
 
     init_sliders();
+    focusable(true);
 
     m_timer.on_timeout([this]() { cursor_timeout(); });
+    // no blinking for a cursor that cannot be seen
+    m_timer.bind(*this);
 
     m_gain_focus_reg = on_gain_focus([this]()
     {
@@ -1318,7 +1613,7 @@ void TextBox::handle_key(const Key& key)
     /// NOLINTNEXTLINE(bugprone-branch-clone)
     case EKEY_END:
     {
-        auto eol = key.state.is_set(Key::KeyMod::control) ? detail::utf8len(m_text) : end_of_line();
+        auto eol = key.state.is_set(Key::KeyMod::control) ? text_index().size() : end_of_line();
         if (key.state.is_set(Key::KeyMod::shift))
         {
             selection_move(eol - selection_cursor());
@@ -1435,6 +1730,8 @@ void TextBox::text(const std::string& str)
 void TextBox::clear()
 {
     m_rects.clear();
+    m_paragraphs.clear();
+    m_line_advances.clear();
     selection_clear();
     cursor_begin();
     TextWidget::clear();
@@ -1449,12 +1746,11 @@ void TextBox::max_length(size_t len)
     {
         if (m_max_len)
         {
-            const auto length = detail::utf8len(m_text);
-            if (length > m_max_len)
+            const auto& index = text_index();
+            if (index.size() > m_max_len)
             {
-                auto i = m_text.begin();
-                utf8::advance(i, m_max_len, m_text.end());
-                m_text.erase(i, m_text.end());
+                m_text.erase(index.offset(m_max_len));
+                invalidate_text_index();
                 on_text_changed.invoke();
             }
         }
@@ -1492,12 +1788,92 @@ size_t TextBox::width_to_len(const std::string& str) const
     return len;
 }
 
+size_t TextBox::width_to_len(size_t pos, const std::string& str) const
+{
+    const auto& line = line_advances();
+    if (line.size() != text_index().size() + 1 || pos >= line.size())
+    {
+        auto text = m_text;
+        text.insert(text_index().offset(pos), str);
+        return width_to_len(text);
+    }
+
+    const auto b = text_area();
+
+    cairo_set_scaled_font(context(), font().scaled_font());
+
+    std::vector<float> inserted{0};
+    for (detail::utf8_const_iterator ch(str.begin(), str.begin(), str.end());
+         ch != detail::utf8_const_iterator(str.end(), str.begin(), str.end()); ++ch)
+    {
+        const auto txt = detail::utf8_char_to_string(ch.base(), str.cend());
+        cairo_text_extents_t te;
+        cairo_text_extents(context(), txt.c_str(), &te);
+        inserted.push_back(inserted.back() + static_cast<float>(te.x_advance));
+    }
+
+    // advance of the first len characters of the resulting text
+    const auto count = inserted.size() - 1;
+    auto advance = [&](size_t len)
+    {
+        if (len <= pos)
+            return line[len];
+        if (len <= pos + count)
+            return line[pos] + inserted[len - pos];
+        return line[len - count] + inserted.back();
+    };
+
+    // advances only grow, so search the last length that fits
+    size_t low = 0;
+    size_t high = line.size() - 1 + count;
+    while (low < high)
+    {
+        const auto mid = low + (high - low + 1) / 2;
+        if (advance(mid) > b.width())
+            high = mid - 1;
+        else
+            low = mid;
+    }
+
+    return low;
+}
+
+const std::vector<float>& TextBox::line_advances() const
+{
+    if (m_line_advances.empty())
+    {
+        m_line_advances.push_back(0);
+
+        cairo_set_scaled_font(context(), font().scaled_font());
+        for (const auto& r : m_rects)
+        {
+            if (r.text() == "\n")
+                break;
+
+            const auto base = m_line_advances.back();
+            const auto& a = r.advances(context());
+            for (auto i = std::next(a.begin()); i != a.end(); ++i)
+                m_line_advances.push_back(base + *i);
+        }
+    }
+
+    return m_line_advances;
+}
+
 size_t TextBox::insert(const std::string& str)
 {
     if (str.empty())
         return 0;
 
-    const auto current_len = detail::utf8len(m_text);
+    // validated once here, so it is never validated when drawn
+    if (egt_unlikely(!detail::utf8_valid(str)))
+    {
+        auto valid = str;
+        detail::utf8_sanitize(valid);
+        return insert(valid);
+    }
+
+    const auto current_len = text_index().size();
     auto len = detail::utf8len(str);
 
     if (m_max_len)
@@ -1511,19 +1887,13 @@ size_t TextBox::insert(const std::string& str)
         !text_area().empty())
     {
         /*
-         * Have to go through the motions and build the expected string at this
-         * point to see what will fit.
+         * See what will fit of the expected string, with the text inserted at
+         * the cursor position.
          */
-
-        // insert at cursor position
-        auto text = m_text;
-        auto i = text.begin();
-        utf8::advance(i, m_cursor_pos, text.end());
         auto end = str.begin();
         utf8::advance(end, len, str.end());
-        text.insert(i, str.begin(), end);
 
-        const auto maxlen = width_to_len(text);
+        const auto maxlen = width_to_len(m_cursor_pos, std::string(str.begin(), end));
         if (current_len + len > maxlen)
             len = maxlen - current_len;
     }
@@ -1535,19 +1905,16 @@ size_t TextBox::insert(const std::string& str)
     if (len > 0)
     {
         // insert at cursor position
-        auto i = m_text.begin();
-        utf8::advance(i, m_cursor_pos, m_text.end());
         auto end = str.begin();
-        utf8::advance(end, len, str.end());
-        m_text.insert(i, str.begin(), end);
+        utf8::unchecked::advance(end, len);
+        m_text.insert(m_text.begin() + text_index().offset(m_cursor_pos),
+                      str.begin(), end);
+        invalidate_text_index();
         selection_clear();
 
         on_text_changed.invoke();
 
-        TextRects rects;
-        prepare_text(rects);
-        tag_text(m_rects, rects);
-        m_rects = std::move(rects);
+        layout_text(true);
 
         cursor_forward(len);
         continue_show_cursor();
@@ -1572,7 +1939,7 @@ void TextBox::cursor_begin()
 void TextBox::cursor_end()
 {
     // one past end
-    cursor_set(detail::utf8len(m_text));
+    cursor_set(text_index().size());
 }
 
 void TextBox::cursor_forward(size_t count)
@@ -1595,7 +1962,7 @@ void TextBox::cursor_set(size_t pos)
 
 void TextBox::cursor_set(size_t pos, bool save_column)
 {
-    const auto len = detail::utf8len(m_text);
+    const auto len = text_index().size();
     if (pos > len)
         pos = len;
 
@@ -1618,7 +1985,7 @@ void TextBox::change_cursor(size_t pos, bool save_column)
 
 void TextBox::selection_all()
 {
-    selection(0, detail::utf8len(m_text));
+    selection(0, text_index().size());
 }
 
 void TextBox::selection_damage()
@@ -1630,19 +1997,17 @@ void TextBox::selection_damage()
     set_selection(rects);
     tag_text_selection(m_rects, rects);
     m_rects = std::move(rects);
+    index_paragraphs();
 }
 
 void TextBox::selection(size_t pos, size_t length)
 {
-    const auto len = detail::utf8len(m_text);
+    const auto len = text_index().size();
     if (pos > len)
         pos = len;
 
-    auto i = m_text.begin();
-    utf8::advance(i, pos, m_text.end());
-    size_t d = utf8::distance(i, m_text.end());
-    if (length > d)
-        length = d;
+    if (length > len - pos)
+        length = len - pos;
 
     if (pos != m_select_start || length != m_select_len)
     {
@@ -1680,7 +2045,7 @@ void TextBox::selection_move(size_t count, bool save_column)
 
     auto a = m_select_origin;
     auto b = selection_cursor() + count;
-    auto len = detail::utf8len(m_text);
+    auto len = text_index().size();
 
     auto start = std::min(std::max(std::min(a, b), (size_t)0), len);
     auto end = std::min(std::max(std::max(a, b), (size_t)0), len);
@@ -1719,12 +2084,10 @@ std::string TextBox::selected_text() const
 {
     if (m_select_len)
     {
-        auto i = m_text.begin();
-        utf8::advance(i, m_select_start, m_text.end());
-        auto l = i;
-        utf8::advance(l, m_select_len, m_text.end());
-        return m_text.substr(std::distance(m_text.begin(), i),
-                             std::distance(i, l));
+        const auto& index = text_index();
+        const auto begin = index.offset(m_select_start);
+        const auto end = index.offset(m_select_start + m_select_len);
+        return m_text.substr(begin, end - begin);
     }
 
     return std::string();
@@ -1734,19 +2097,16 @@ void TextBox::selection_delete()
 {
     if (m_select_len)
     {
-        auto i = m_text.begin();
-        utf8::advance(i, m_select_start, m_text.end());
-        auto l = i;
-        utf8::advance(l, m_select_len, m_text.end());
+        const auto& index = text_index();
+        const auto begin = index.offset(m_select_start);
+        const auto end = index.offset(m_select_start + m_select_len);
 
-        m_text.erase(i, l);
+        m_text.erase(begin, end - begin);
+        invalidate_text_index();
         selection_clear();
         on_text_changed.invoke();
 
-        TextRects rects;
-        prepare_text(rects);
-        tag_text(m_rects, rects);
-        m_rects = std::move(rects);
+        layout_text(true);
 
         cursor_set(m_select_start);
         invalidate_text_rect();
@@ -1824,8 +2184,25 @@ void TextBox::hide_cursor()
 size_t TextBox::point2pos(const Point& p) const
 {
     size_t pos = 0;
-    for (const auto& r : m_rects)
+    auto begin = m_rects.cbegin();
+    if (!m_paragraphs.empty())
+    {
+        // skip the paragraphs above the point
+        auto paragraph = std::partition_point(m_paragraphs.begin(), m_paragraphs.end(),
+                                              [&p](const Paragraph & paragraph)
+        {
+            return paragraph.top + paragraph.height < p.y();
+        });
+        if (paragraph == m_paragraphs.end())
+            return m_paragraphs.back().pos + m_paragraphs.back().length;
+
+        pos = paragraph->pos;
+        begin = paragraph->first;
+    }
+
+    for (auto i = begin; i != m_rects.cend(); ++i)
     {
+        const auto& r = *i;
         const auto& rect = r.rect();
 
         if (rect.bottom() < p.y())
@@ -1856,20 +2233,7 @@ size_t TextBox::point2pos(const Point& p) const
 
         auto* cr = context();
         cairo_set_scaled_font(cr, font().scaled_font());
-        for (size_t len = r.length(); len > 0; --len)
-        {
-            auto first = r.text().begin();
-            auto last = first;
-            utf8::advance(last, len, r.text().end());
-            auto text = std::string(first, last);
-            cairo_text_extents_t te;
-            cairo_text_extents(cr, text.c_str(), &te);
-            if (te.x_advance <= delta_x)
-            {
-                pos += len;
-                break;
-            }
-        }
+        pos += r.fitting_length(delta_x, cr);
     }
 
     return pos;
@@ -1877,10 +2241,11 @@ size_t TextBox::point2pos(const Point& p) const
 
 size_t TextBox::beginning_of_line(size_t cursor_pos) const
 {
-    size_t pos = 0;
+    size_t pos;
+    auto begin = paragraph_start(cursor_pos, pos);
     size_t bol = pos;
 
-    for (auto it = m_rects.cbegin(); it != m_rects.cend(); ++it)
+    for (auto it = begin; it != m_rects.cend(); ++it)
     {
         if (it->beginning_of_line())
             bol = pos;
@@ -1908,10 +2273,11 @@ size_t TextBox::beginning_of_line(size_t cursor_pos) const
 
 size_t TextBox::end_of_line(size_t cursor_pos) const
 {
-    size_t pos = 0;
+    size_t pos;
+    auto begin = paragraph_start(cursor_pos, pos);
     size_t eol = pos;
 
-    for (auto it = m_rects.cbegin(); it != m_rects.cend(); ++it)
+    for (auto it = begin; it != m_rects.cend(); ++it)
     {
         auto next = std::next(it);
 
@@ -1955,7 +2321,7 @@ size_t TextBox::down(size_t cursor_pos) const
 {
     auto eol = end_of_line(cursor_pos);
 
-    if (eol >= detail::utf8len(m_text))
+    if (eol >= text_index().size())
         return cursor_pos;
 
     auto bol = beginning_of_line(eol + 1);
@@ -1979,17 +2345,33 @@ Rect TextBox::text_rect() const
     {
         m_text_rect.clear();
 
-        for (const auto& rect : m_rects)
+        if (!m_paragraphs.empty())
         {
-            if (rect.text() == "\n")
-                continue;
+            for (const auto& paragraph : m_paragraphs)
+            {
+                if (paragraph.rect.empty())
+                    continue;
+
+                if (m_text_rect.empty())
+                    m_text_rect = paragraph.rect;
+                else
+                    m_text_rect = Rect::merge(m_text_rect, paragraph.rect);
+            }
+        }
+        else
+        {
+            for (const auto& rect : m_rects)
+            {
+                if (rect.text() == "\n")
+                    continue;
 
-            const auto& r = rect.rect();
+                const auto& r = rect.rect();
 
-            if (m_text_rect.empty())
-                m_text_rect = r;
-            else
-                m_text_rect = Rect::merge(m_text_rect, r);
+                if (m_text_rect.empty())
+                    m_text_rect = r;
+                else
+                    m_text_rect = Rect::merge(m_text_rect, r);
+            }
         }
 
         const auto& r = m_cursor_rect;
@@ -4,10 +4,11 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/utf8text.h"
-#include "egt/canvas.h"
+#include "egt/detail/surfacepool.h"
 #include "egt/painter.h"
 #include "egt/serialize.h"
 #include "egt/textwidget.h"
+#include "egt/translator.h"
 #include <deque>
 
 namespace egt
@@ -22,7 +23,9 @@ TextWidget::TextWidget(std::string text,
     : Widget(rect),
       m_text_align(text_align),
       m_text(std::move(text))
-{}
+{
+    detail::utf8_sanitize(m_text);
+}
 
 TextWidget::TextWidget(Serializer::Properties& props, bool is_derived) noexcept
     : Widget(props, true)
@@ -33,11 +36,59 @@ TextWidget::TextWidget(Serializer::Properties& props, bool is_derived) noexcept
         deserialize_leaf(props);
 }
 
+TextWidget::TextWidget(TextWidget&&) noexcept = default;
+TextWidget& TextWidget::operator=(TextWidget&&) noexcept = default;
+TextWidget::~TextWidget() noexcept = default;
+
+detail::TextRun& TextWidget::text_run() const
+{
+    if (!m_text_run)
+        m_text_run = std::make_unique<detail::TextRun>();
+    return *m_text_run;
+}
+
+void TextWidget::layout_cache_size(size_t layouts)
+{
+    detail::TextRun::layout_cache_size(layouts);
+}
+
+size_t TextWidget::layout_cache_size()
+{
+    return detail::TextRun::layout_cache_size();
+}
+
+detail::CacheStats TextWidget::layout_cache_stats()
+{
+    return detail::TextRun::layout_cache_stats();
+}
+
+void TextWidget::reset_layout_cache()
+{
+    detail::TextRun::layout_cache_clear();
+}
+
+const detail::Utf8Index& TextWidget::text_index() const
+{
+    if (!m_text_index)
+        m_text_index = std::make_unique<detail::Utf8Index>();
+    if (!m_text_index->valid())
+        m_text_index->reset(m_text);
+    return *m_text_index;
+}
+
+void TextWidget::invalidate_text_index()
+{
+    if (m_text_index)
+        m_text_index->invalidate();
+}
+
 void TextWidget::clear()
 {
     if (!m_text.empty())
     {
         m_text.clear();
+        invalidate_text_index();
+        invalidate_size_hint();
         on_text_changed.invoke();
         damage();
     }
@@ -45,23 +96,40 @@ void TextWidget::clear()
 
 void TextWidget::text(const std::string& str)
 {
+    // validated once here, so it is never validated when drawn
+    if (egt_unlikely(!detail::utf8_valid(str)))
+    {
+        auto valid = str;
+        detail::utf8_sanitize(valid);
+        TextWidget::text(valid);
+        return;
+    }
+
     if (detail::change_if_diff<>(m_text, str))
     {
+        invalidate_text_index();
         on_text_changed.invoke();
         damage();
-        parent_layout();
+        // i.e. a translation, or a counter, often takes the same space
+        parent_layout_if_hint_changed();
     }
 }
 
+void TextWidget::translate(const std::string& msgid)
+{
+    m_msgid = msgid;
+    if (!m_msgid.empty())
+        text(Translator::instance().translate(m_msgid));
+}
+
 size_t TextWidget::len() const
 {
-    return detail::utf8len(m_text);
+    return text_index().size();
 }
 
 Font TextWidget::scale_font(const Size& target, const std::string& text, const Font& font)
 {
-    Canvas canvas(Size(10, 10));
-    Painter painter(canvas.context());
+    Painter painter(detail::measure_context());
 
     auto nfont = font;
     while (true)
@@ -127,23 +195,36 @@ static SizeCache size_cache;
 
 Size TextWidget::text_size(const std::string& text) const
 {
+    // layout passes ask again and again, so first try what was measured last
+    auto& run = text_run();
+    Size size;
+    if (run.cached_size(text, this->font(), size))
+        return size;
+
     auto i = size_cache.find(text, this->font());
     if (i != size_cache.end())
-        return i->second;
+    {
+        size = i->second;
+    }
+    else
+    {
+        Painter painter(detail::measure_context());
+        painter.set(this->font());
 
-    Canvas canvas(Size(100, 100));
-    Painter painter(canvas.context());
-    painter.set(this->font());
+        size = painter.text_size(text);
+        size_cache.add(std::make_pair(SizeCache::SizeItem{text, this->font()}, size));
+    }
 
-    auto size = painter.text_size(text);
-    size_cache.add(std::make_pair(SizeCache::SizeItem{text, this->font()}, size));
+    run.cache_size(text, this->font(), size);
     return size;
 }
 
 void TextWidget::serialize(Serializer& serializer) const
 {
     Widget::serialize(serializer);
-    if (!text().empty())
+    if (!m_msgid.empty())
+        serializer.add_property("msgid", m_msgid);
+    else if (!text().empty())
         serializer.add_property("text", text());
     if (!text_align().empty())
         serializer.add_property("text_align", text_align());
@@ -155,6 +236,8 @@ void TextWidget::deserialize(Serializer::Properties& props)
     {
         if (std::get<0>(p) == "text")
             text(std::get<1>(p));
+        else if (std::get<0>(p) == "msgid")
+            translate(std::get<1>(p));
         else if (std::get<0>(p) == "text_align")
             text_align(AlignFlags(std::get<1>(p)));
         else
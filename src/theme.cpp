@@ -9,7 +9,12 @@
 #include "egt/painter.h"
 #include "egt/theme.h"
 #include "egt/widget.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <string>
+#include <unordered_map>
 
 namespace egt
 {
@@ -18,6 +23,22 @@ inline namespace v1
 
 std::vector<DrawerReset::ResetFunction> DrawerReset::m_reset_list;
 
+namespace detail
+{
+
+/// Box skins drawn by Theme::draw_box(), by key.
+class BoxSkinCache
+{
+public:
+
+    /// Number of skins beyond which the cache is cleared, instead of growing.
+    static constexpr size_t MAX_SKINS = 256;
+
+    std::unordered_map<std::string, shared_cairo_surface_t> skins;
+};
+
+}
+
 static std::unique_ptr<Theme> the_global_theme;
 
 Theme& global_theme()
@@ -37,6 +58,9 @@ void global_theme(std::unique_ptr<Theme>&& theme)
 
     if (the_global_theme)
         the_global_theme->apply();
+
+    // the theme font is the default font of all widgets
+    Widget::invalidate_all_size_hints();
 }
 
 static Pattern pattern(const Color& color)
@@ -186,6 +210,19 @@ void Theme::draw_box(Painter& painter, const Widget& widget,
              widget.background(group, true));
 }
 
+void Theme::box_cache(bool enable)
+{
+    m_box_cache_enabled = enable;
+    if (!enable)
+        clear_box_cache();
+}
+
+void Theme::clear_box_cache()
+{
+    // copies of the theme keep their own
+    m_box_cache.reset();
+}
+
 void Theme::draw_box(Painter& painter,
                      const FillFlags& type,
                      const Rect& rect,
@@ -200,6 +237,224 @@ void Theme::draw_box(Painter& painter,
     if (type.empty() && !border_width)
         return;
 
+    if (m_box_cache_enabled && !background &&
+        draw_box_cached(painter, type, rect, border, bg, border_width,
+                        margin_width, border_radius, border_flags))
+        return;
+
+    draw_box_direct(painter, type, rect, border, bg, border_width,
+                    margin_width, border_radius, border_flags, background);
+}
+
+template<class T>
+static void append_key(std::string& key, const T& value)
+{
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static bool opaque(const Pattern& pattern)
+{
+    if (pattern.type() == Pattern::Type::solid)
+        return pattern.solid().alpha() == 255;
+
+    const auto& steps = pattern.steps();
+    return !steps.empty() &&
+           std::all_of(steps.begin(), steps.end(), [](const auto & step)
+    {
+        return step.second.alpha() == 255;
+    });
+}
+
+namespace
+{
+/// Part of a skin, and the part of a box it is stretched to.
+struct Slice
+{
+    DefaultDim from;
+    DefaultDim from_size;
+    DefaultDim to;
+    DefaultDim to_size;
+};
+}
+
+/*
+ * Split a skin dimension in the corners and the middle, or keep it whole when
+ * it is not stretched.
+ */
+static size_t slice(DefaultDim skin, DefaultDim corner,
+                    DefaultDim origin, DefaultDim size,
+                    std::array<Slice, 3>& slices)
+{
+    if (skin == size)
+    {
+        slices[0] = {0, skin, origin, size};
+        return 1;
+    }
+
+    slices[0] = {0, corner, origin, corner};
+    slices[1] = {corner, skin - 2 * corner, origin + corner, size - 2 * corner};
+    slices[2] = {skin - corner, corner, origin + size - corner, corner};
+    return 3;
+}
+
+bool Theme::draw_box_cached(Painter& painter,
+                            const FillFlags& type,
+                            const Rect& rect,
+                            const Pattern& border,
+                            const Pattern& bg,
+                            DefaultDim border_width,
+                            DefaultDim margin_width,
+                            float border_radius,
+                            const BorderFlags& border_flags) const
+{
+    if (border_flags.is_set(BorderFlag::drop_shadow))
+        return false;
+
+    // the skin is painted over what is below, which is the same as drawing
+    // the box only when it is opaque
+    const auto fill = type.is_set(FillFlag::blend) || type.is_set(FillFlag::solid);
+    if (fill && !opaque(bg))
+        return false;
+
+    if (border_width && (border.type() != Pattern::Type::solid ||
+                         border.solid().alpha() != 255))
+        return false;
+
+    // copies are pixel exact with a whole pixel translation only
+    auto cr = painter.context().get();
+    cairo_matrix_t matrix;
+    cairo_get_matrix(cr, &matrix);
+    if (matrix.xx != 1. || matrix.yx != 0. || matrix.xy != 0. || matrix.yy != 1. ||
+        matrix.x0 != std::floor(matrix.x0) || matrix.y0 != std::floor(matrix.y0))
+        return false;
+
+    auto box = rect;
+    if (margin_width)
+    {
+        box += Point(margin_width, margin_width);
+        box -= Size(margin_width * 2., margin_width * 2.);
+    }
+
+    if (box.empty())
+        return false;
+
+    // corners hold the radius, the border, and the antialiasing
+    const auto corner = static_cast<DefaultDim>(std::ceil(std::max(border_radius, 0.f))) +
+                        border_width + 1;
+    const auto stretched = 2 * corner + 1;
+
+    // a linear pattern only changes from top to bottom, and a vertical one
+    // from left to right, so they stretch the other way
+    const auto hstretch = !fill || bg.type() == Pattern::Type::solid ||
+                          bg.type() == Pattern::Type::linear;
+    const auto vstretch = !fill || bg.type() == Pattern::Type::solid ||
+                          bg.type() == Pattern::Type::linear_vertical;
+    const Size size(hstretch && box.width() > stretched ? stretched : box.width(),
+                    vstretch && box.height() > stretched ? stretched : box.height());
+
+    // boxes that do not stretch are cached at their size, which is bounded
+    constexpr DefaultDim max_area = 128 * 128;
+    if (size.width() * size.height() > max_area)
+        return false;
+
+    std::string key;
+    append_key(key, (type.is_set(FillFlag::solid) ? 1 : 0) |
+               (type.is_set(FillFlag::blend) ? 2 : 0) |
+               (border_flags.is_set(BorderFlag::top) ? 4 : 0) |
+               (border_flags.is_set(BorderFlag::right) ? 8 : 0) |
+               (border_flags.is_set(BorderFlag::bottom) ? 16 : 0) |
+               (border_flags.is_set(BorderFlag::left) ? 32 : 0));
+    append_key(key, border_width);
+    append_key(key, border_radius);
+    append_key(key, size.width());
+    append_key(key, size.height());
+    if (border_width)
+        append_key(key, border.solid().pixel32());
+    if (fill)
+    {
+        append_key(key, bg.type());
+        if (bg.type() == Pattern::Type::solid)
+        {
+            append_key(key, bg.solid().pixel32());
+        }
+        else
+        {
+            for (const auto& step : bg.steps())
+            {
+                append_key(key, step.first);
+                append_key(key, step.second.pixel32());
+            }
+        }
+    }
+
+    if (!m_box_cache)
+        m_box_cache = std::make_shared<detail::BoxSkinCache>();
+
+    auto& skins = m_box_cache->skins;
+    auto i = skins.find(key);
+    if (i == skins.end())
+    {
+        if (skins.size() >= detail::BoxSkinCache::MAX_SKINS)
+            skins.clear();
+
+        auto surface = shared_cairo_surface_t(
+                           cairo_surface_create_similar(cairo_get_target(cr),
+                                   CAIRO_CONTENT_COLOR_ALPHA,
+                                   size.width(), size.height()),
+                           cairo_surface_destroy);
+        Painter skin(shared_cairo_t(cairo_create(surface.get()), cairo_destroy));
+        draw_box_direct(skin, type, Rect(Point(), size), border, bg, border_width,
+                        0, border_radius, border_flags, nullptr);
+        cairo_surface_flush(surface.get());
+
+        i = skins.emplace(std::move(key), std::move(surface)).first;
+    }
+
+    std::array<Slice, 3> columns{};
+    std::array<Slice, 3> rows{};
+    const auto ncolumns = slice(size.width(), corner, box.x(), box.width(), columns);
+    const auto nrows = slice(size.height(), corner, box.y(), box.height(), rows);
+
+    Painter::AutoSaveRestore sr(painter);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    for (size_t r = 0; r < nrows; ++r)
+    {
+        for (size_t c = 0; c < ncolumns; ++c)
+        {
+            const auto& column = columns[c];
+            const auto& row = rows[r];
+
+            cairo_save(cr);
+            cairo_rectangle(cr, column.to, row.to, column.to_size, row.to_size);
+            cairo_clip(cr);
+            cairo_translate(cr, column.to, row.to);
+            cairo_scale(cr, static_cast<double>(column.to_size) / column.from_size,
+                        static_cast<double>(row.to_size) / row.from_size);
+            cairo_set_source_surface(cr, i->second.get(), -column.from, -row.from);
+            cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+            cairo_paint(cr);
+            cairo_restore(cr);
+        }
+    }
+
+    return true;
+}
+
+void Theme::draw_box_direct(Painter& painter,
+                            const FillFlags& type,
+                            const Rect& rect,
+                            const Pattern& border,
+                            const Pattern& bg,
+                            DefaultDim border_width,
+                            DefaultDim margin_width,
+                            float border_radius,
+                            const BorderFlags& border_flags,
+                            Image* background) const
+{
+    if (type.empty() && !border_width)
+        return;
+
     auto box = rect;
 
     // adjust for margin
@@ -238,14 +493,15 @@ void Theme::draw_box(Painter& painter,
 
     if (border_width && border_flags.is_set(BorderFlag::drop_shadow))
     {
-        auto sbox = box;
-        sbox += Point(border_width, border_width);
-        sbox -= Size(border_width, border_width);
-        painter.set(border);
-
-        rounded_box(painter, sbox, border_radius);
-
-        painter.fill();
+        if (!painter.low_fidelity())
+        {
+            auto sbox = box;
+            sbox += Point(border_width, border_width);
+            sbox -= Size(border_width, border_width);
+            painter.set(border);
+            rounded_box(painter, sbox, border_radius);
+            painter.fill();
+        }
 
         box += Point(border_width / 2., border_width / 2.);
         box -= Size(border_width, border_width);
@@ -285,7 +541,26 @@ void Theme::draw_box(Painter& painter,
             painter.set(bg);
         }
 
-        cairo_fill_preserve(cr);
+        /*
+         * An opaque rectangle looks the same when it replaces what is below
+         * it, and a plain fill is cheaper than blending.  On GFX2D surfaces
+         * this is handed to the 2D engine as a fill.
+         */
+        const auto op = cairo_get_operator(cr);
+        if (bg.type() == Pattern::Type::solid && bg.solid().alpha() == 255 &&
+            (detail::float_equal(border_radius, 0) || border_radius < 0))
+        {
+            // written directly into image surfaces, keeping the path
+            cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+            painter.fill(box);
+            rounded_box(painter, box, border_radius);
+        }
+        else
+        {
+            cairo_fill_preserve(cr);
+        }
+
+        cairo_set_operator(cr, op);
     }
 
     if (!border_flags.is_set(BorderFlag::drop_shadow))
@@ -3,10 +3,13 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "detail/asioallocator.h"
+#include "detail/priorityqueue.h"
+#include "detail/timerwheel.h"
+#include "detail/window/visibilitypolicy.h"
 #include "egt/app.h"
 #include "egt/eventloop.h"
 #include "egt/timer.h"
+#include <algorithm>
 
 namespace egt
 {
@@ -15,19 +18,32 @@ inline namespace v1
 
 struct Timer::TimerImpl
 {
-    detail::HandlerAllocator allocator;
+    /// Entry of the timer in the timer wheel of the event loop.
+    detail::TimerNode node;
+
+    /// When the timer expires, kept while suspended.
+    std::chrono::steady_clock::time_point expiry{};
+
+    /// Suspended while the widget it is bound to cannot be seen.
+    bool suspended{false};
+
+    /// Put the timer in the wheel, unless suspended.
+    void schedule(detail::TimerWheel& wheel, std::chrono::milliseconds duration)
+    {
+        expiry = std::chrono::steady_clock::now() + duration;
+        if (!suspended)
+            wheel.schedule(node, expiry);
+    }
 };
 
 Timer::Timer() noexcept
-    : m_timer(Application::instance().event().io()),
-      m_impl(std::make_unique<TimerImpl>())
+    : m_impl(std::make_unique<TimerImpl>())
 {
     Application::instance().m_timers.push_back(this);
 }
 
 Timer::Timer(std::chrono::milliseconds duration) noexcept
-    : m_timer(Application::instance().event().io()),
-      m_duration(duration),
+    : m_duration(duration),
       m_impl(std::make_unique<TimerImpl>())
 {
     Application::instance().m_timers.push_back(this);
@@ -35,24 +51,19 @@ Timer::Timer(std::chrono::milliseconds duration) noexcept
 
 void Timer::start()
 {
-    // error::operation_aborted occurs when expires_from_now() is called on the
-    // timer while it is pending, we handle this ourselves with m_running
-    m_running = false;
-    m_timer.expires_after(m_duration);
+    auto& event = Application::instance().event();
     m_running = true;
-#ifdef USE_PRIORITY_QUEUE
-    m_timer.async_wait(
-        Application::instance().event().queue().wrap(detail::priorities::high,
-                [this](const asio::error_code & error)
-    {
-        internal_timer_callback(error);
-    }));
-#else
-    m_timer.async_wait(detail::make_custom_alloc_handler(m_impl->allocator, [this](const asio::error_code & error)
+
+    // an expiry that is queued but did not run yet is from before the restart
+    event.queue().cancel(this);
+
+    // the wheel only queues the expiry, so it runs within the dispatch budget
+    m_impl->node.callback = [this]()
     {
-        internal_timer_callback(error);
-    }));
-#endif
+        Application::instance().event().queue().add(detail::priorities::timer,
+                [this]() { internal_timer_callback(); }, this);
+    };
+    m_impl->schedule(event.timer_wheel(), m_duration);
 }
 
 void Timer::start_with_duration(std::chrono::milliseconds duration)
@@ -83,14 +94,52 @@ void Timer::cancel()
 void Timer::do_cancel()
 {
     m_running = false;
-    m_timer.cancel();
+    if (m_impl && m_impl->node.scheduled())
+        Application::instance().event().timer_wheel().cancel(m_impl->node);
+}
+
+void Timer::bind(Widget& widget)
+{
+    detail::VisibilityPolicy::bind(*this, widget);
+}
+
+void Timer::unbind()
+{
+    detail::VisibilityPolicy::unbind(*this);
+    suspend(false);
+}
+
+bool Timer::suspended() const
+{
+    return m_impl && m_impl->suspended;
 }
 
-void Timer::internal_timer_callback(const asio::error_code& error)
+void Timer::suspend(bool suspend)
 {
-    if (error)
+    if (!m_impl || m_impl->suspended == suspend)
         return;
 
+    m_impl->suspended = suspend;
+
+    auto& event = Application::instance().event();
+    if (suspend)
+    {
+        if (m_impl->node.scheduled())
+            event.timer_wheel().cancel(m_impl->node);
+
+        // a queued expiry is past, and fires when resumed instead
+        event.queue().cancel(this);
+    }
+    else if (m_running)
+    {
+        // an expiry missed while suspended fires once, as soon as possible
+        event.timer_wheel().schedule(m_impl->node,
+                                     std::max(m_impl->expiry, std::chrono::steady_clock::now()));
+    }
+}
+
+void Timer::internal_timer_callback()
+{
     // it is possible to call cancel() and have this handler still called
     // which creates a sort of race condition, so we stop an actual
     // callback from continuing if m_running is false
@@ -150,9 +199,13 @@ Timer& Timer::operator=(Timer&&) = default;
 Timer::~Timer() noexcept
 {
     do_cancel();
+    detail::VisibilityPolicy::unbind(*this);
 
     if (Application::check_instance())
     {
+        // a completion may be queued, and must not run anymore
+        Application::instance().event().queue().cancel(this);
+
         auto i = std::find(Application::instance().m_timers.begin(),
                            Application::instance().m_timers.end(), this);
         if (i != Application::instance().m_timers.end())
@@ -162,31 +215,23 @@ Timer::~Timer() noexcept
 
 void PeriodicTimer::start()
 {
-    // error::operation_aborted occurs when expires_from_now() is called on the
-    // timer while it is pending, we handle this ourselves with m_running
-    m_running = false;
-    m_timer.expires_after(m_duration);
+    auto& event = Application::instance().event();
     m_running = true;
 
-#ifdef USE_PRIORITY_QUEUE
-    m_timer.async_wait(Application::instance().event().queue().wrap(detail::priorities::high,
-                       [this](const asio::error_code & error)
-    {
-        internal_timer_callback(error);
-    }))
-#else
-    m_timer.async_wait(detail::make_custom_alloc_handler(m_impl->allocator, [this](const asio::error_code & error)
+    // an expiry that is queued but did not run yet is from before the restart
+    event.queue().cancel(this);
+
+    // the wheel only queues the expiry, so it runs within the dispatch budget
+    m_impl->node.callback = [this]()
     {
-        internal_timer_callback(error);
-    }));
-#endif
+        Application::instance().event().queue().add(detail::priorities::timer,
+                [this]() { internal_timer_callback(); }, this);
+    };
+    m_impl->schedule(event.timer_wheel(), m_duration);
 }
 
-void PeriodicTimer::internal_timer_callback(const asio::error_code& error)
+void PeriodicTimer::internal_timer_callback()
 {
-    if (error)
-        return;
-
     // it is possible to call cancel() and have this handler still called
     // which creates a sort of race condition, so we stop an actual
     // callback from continuing if m_running is false
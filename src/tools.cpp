@@ -3,9 +3,8 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/procfile.h"
 #include "egt/tools.h"
-#include <fstream>
-#include <numeric>
 #include <vector>
 
 namespace egt
@@ -15,44 +14,28 @@ inline namespace v1
 namespace experimental
 {
 
-static void get_cpu_times(std::vector<size_t>& times)
-{
-    std::ifstream in("/proc/stat");
-    if (in.is_open())
-    {
-        in.ignore(5, ' ');
-        size_t time{};
-        while (in >> time)
-            times.push_back(time);
-    }
-}
+CPUMonitorUsage::CPUMonitorUsage()
+    : m_stat(std::make_unique<detail::ProcFile>("/proc/stat"))
+{}
 
-static bool get_cpu_times(size_t& idle_time, size_t& total_time)
-{
-    static std::vector<size_t> times;
-    times.clear();
-    get_cpu_times(times);
-    if (times.size() < 4)
-        return false;
-    idle_time = times[3];
-    total_time = std::accumulate(times.begin(), times.end(), static_cast<size_t>(0));
-    return true;
-}
+CPUMonitorUsage::CPUMonitorUsage(CPUMonitorUsage&&) noexcept = default;
+CPUMonitorUsage& CPUMonitorUsage::operator=(CPUMonitorUsage&&) noexcept = default;
 
 void CPUMonitorUsage::update()
 {
-    size_t idle_time{};
-    size_t total_time{};
-    if (get_cpu_times(idle_time, total_time))
-    {
-        const double idle_time_diff = idle_time - m_last_idle_time;
-        const double total_time_diff = total_time - m_last_total_time;
-        m_cpu_usage = 100.0 * (1.0 - idle_time_diff / total_time_diff);
-        m_last_idle_time = idle_time;
-        m_last_total_time = total_time;
-    }
+    static std::vector<detail::CpuTimes> times;
+    detail::parse_cpu_times(m_stat->read(), times);
+    if (times.empty())
+        return;
+
+    const detail::CpuTimes last{m_last_idle_time, m_last_total_time};
+    m_cpu_usage = detail::cpu_usage(last, times.front());
+    m_last_idle_time = times.front().idle;
+    m_last_total_time = times.front().total;
 }
 
+CPUMonitorUsage::~CPUMonitorUsage() noexcept = default;
+
 }
 }
 }
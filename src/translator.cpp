@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/egtlog.h"
+#include "detail/mocatalog.h"
+#include "egt/app.h"
+#include "egt/detail/filesystem.h"
+#include "egt/textwidget.h"
+#include "egt/translator.h"
+#include "egt/window.h"
+#include <libintl.h>
+#include <stdexcept>
+#include <vector>
+
+namespace egt
+{
+inline namespace v1
+{
+
+Translator& Translator::instance()
+{
+    static const std::unique_ptr<Translator> i(new Translator());
+    return *i;
+}
+
+Translator::Translator() = default;
+
+void Translator::domain(const std::string& domain, const std::string& directory)
+{
+    m_domain = domain;
+    m_directory = directory;
+    m_catalogs.clear();
+
+    // the catalog of the language may not be the same
+    auto language = m_language;
+    m_language.clear();
+    m_catalog.reset();
+    m_cache.clear();
+    if (!language.empty())
+        this->language(language);
+}
+
+std::string Translator::domain() const
+{
+    if (!m_domain.empty())
+        return m_domain;
+
+    auto domain = textdomain(nullptr);
+    return domain ? domain : "";
+}
+
+std::shared_ptr<detail::MoCatalog> Translator::load(const std::string& language)
+{
+    auto i = m_catalogs.find(language);
+    if (i != m_catalogs.end())
+        return i->second;
+
+    const auto domain = this->domain();
+    auto directory = m_directory;
+    if (directory.empty())
+    {
+        auto bound = bindtextdomain(domain.c_str(), nullptr);
+        if (bound)
+            directory = bound;
+    }
+
+    // like gettext: language_territory.codeset, language_territory, language
+    std::vector<std::string> names{language};
+    auto dot = language.find('.');
+    if (dot != std::string::npos)
+        names.push_back(language.substr(0, dot));
+    auto underscore = language.find('_');
+    if (underscore != std::string::npos)
+        names.push_back(language.substr(0, underscore));
+
+    std::shared_ptr<detail::MoCatalog> catalog;
+    for (const auto& name : names)
+    {
+        const auto path = directory + "/" + name + "/LC_MESSAGES/" + domain + ".mo";
+        if (!detail::exists(path))
+            continue;
+
+        try
+        {
+            catalog = std::make_shared<detail::MoCatalog>(path);
+            EGTLOG_DEBUG("loaded {} messages from {}", catalog->size(), path);
+            break;
+        }
+        catch (const std::exception& e)
+        {
+            detail::warn("{}", e.what());
+        }
+    }
+
+    m_catalogs.emplace(language, catalog);
+    return catalog;
+}
+
+bool Translator::language(const std::string& language)
+{
+    if (language == m_language)
+        return language.empty() || m_catalog;
+
+    m_language = language;
+    m_catalog = language.empty() ? nullptr : load(language);
+    m_cache.clear();
+
+    retranslate();
+    on_language_changed.invoke();
+
+    return language.empty() || m_catalog;
+}
+
+const std::string& Translator::translate(const std::string& msgid)
+{
+    auto i = m_cache.find(msgid);
+    if (i != m_cache.end())
+        return i->second;
+
+    std::string translation;
+    if (m_catalog)
+    {
+        std::string_view str;
+        if (m_catalog->find(msgid, str))
+            translation = str;
+        else
+            translation = msgid;
+    }
+    else if (!m_language.empty())
+    {
+        // no catalog for the language
+        translation = msgid;
+    }
+    else
+    {
+        translation = m_domain.empty() ? gettext(msgid.c_str()) :
+                      dgettext(m_domain.c_str(), msgid.c_str());
+    }
+
+    return m_cache.emplace(msgid, std::move(translation)).first->second;
+}
+
+void Translator::retranslate()
+{
+    m_cache.clear();
+
+    if (!Application::check_instance())
+        return;
+
+    // all widgets are marked, then laid out once
+    auto& loop = Application::instance().event();
+    const auto deferred = loop.deferred_layout();
+    loop.deferred_layout(true);
+
+    for (auto& window : Application::instance().windows())
+    {
+        window->walk([this](Widget * widget, int)
+        {
+            auto text = dynamic_cast<TextWidget*>(widget);
+            if (text && !text->msgid().empty())
+                text->text(translate(text->msgid()));
+            return true;
+        });
+    }
+
+    loop.deferred_layout(deferred);
+    if (!deferred)
+    {
+        for (auto& window : Application::instance().windows())
+        {
+            if (window->layout_pending())
+                window->flush_layout();
+        }
+    }
+}
+
+Translator::~Translator() noexcept = default;
+
+const std::string& tr(const std::string& msgid)
+{
+    return Translator::instance().translate(msgid);
+}
+
+}
+}
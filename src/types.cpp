@@ -43,6 +43,9 @@ const std::pair<PixelFormat, char const*> detail::EnumStrings<PixelFormat>::data
     {PixelFormat::nv61, "nv61"},
     {PixelFormat::yuy2, "yuy2"},
     {PixelFormat::uyvy, "uyvy"},
+    {PixelFormat::l8, "l8"},
+    {PixelFormat::rgb332, "rgb332"},
+    {PixelFormat::c8, "c8"},
 };
 
 std::ostream& operator<<(std::ostream& os, const PixelFormat& format)
@@ -81,6 +84,9 @@ static constexpr std::pair<PixelFormat, uint32_t> drm_formats[] =
     {PixelFormat::nv61, DRM_FORMAT_NV61},
     {PixelFormat::yuy2, DRM_FORMAT_YUYV},
     {PixelFormat::uyvy, DRM_FORMAT_UYVY},
+    {PixelFormat::l8, DRM_FORMAT_R8},
+    {PixelFormat::rgb332, DRM_FORMAT_RGB332},
+    {PixelFormat::c8, DRM_FORMAT_C8},
 #else
     {PixelFormat::rgb565, 0},
     {PixelFormat::argb8888, 1},
@@ -92,6 +98,9 @@ static constexpr std::pair<PixelFormat, uint32_t> drm_formats[] =
     {PixelFormat::nv61, 7},
     {PixelFormat::yuy2, 8},
     {PixelFormat::uyvy, 9},
+    {PixelFormat::l8, 10},
+    {PixelFormat::rgb332, 11},
+    {PixelFormat::c8, 12},
 #endif
 };
 
@@ -136,6 +145,7 @@ static constexpr std::pair<PixelFormat, const char*> gstreamer_formats[] =
     {PixelFormat::nv61, "NV61"},
     {PixelFormat::yuy2, "YUY2"},
     {PixelFormat::uyvy, "UYVY"},
+    {PixelFormat::l8, "GRAY8"},
 };
 
 std::string gstreamer_format(PixelFormat format)
@@ -3,8 +3,14 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include "detail/base64.h"
 #include "detail/egtlog.h"
+#include "detail/uibinary.h"
+#include "egt/detail/stringhash.h"
 #include <egt/themes/coconut.h>
 #include <egt/themes/lapis.h>
 #include <egt/themes/midnight.h>
@@ -13,9 +19,22 @@
 #include <egt/themes/ultraviolet.h>
 #include "egt/ui"
 #include "egt/uiloader.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <rapidxml.hpp>
 #include <rapidxml_print.hpp>
 #include <rapidxml_utils.hpp>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace egt
 {
@@ -24,19 +43,25 @@ inline namespace v1
 namespace experimental
 {
 
-class EGT_API XmlDeserializer : public Deserializer
+/**
+ * Deserializer of the nodes of a document.
+ *
+ * Node is either a rapidxml node, or a node of a compiled UI file.
+ */
+template<class Node>
+class NodeDeserializer : public Deserializer
 {
 public:
-    XmlDeserializer(rapidxml::xml_node<>* node)
+    NodeDeserializer(const Node* node)
         : m_node(node)
     {}
 
-    XmlDeserializer() = default;
-    XmlDeserializer(const XmlDeserializer&) = delete;
-    XmlDeserializer& operator=(const XmlDeserializer&) = delete;
-    XmlDeserializer(XmlDeserializer&&) noexcept = default;
-    XmlDeserializer& operator=(XmlDeserializer&&) noexcept = default;
-    ~XmlDeserializer() noexcept override = default;
+    NodeDeserializer() = default;
+    NodeDeserializer(const NodeDeserializer&) = delete;
+    NodeDeserializer& operator=(const NodeDeserializer&) = delete;
+    NodeDeserializer(NodeDeserializer&&) noexcept = default;
+    NodeDeserializer& operator=(NodeDeserializer&&) noexcept = default;
+    ~NodeDeserializer() noexcept override = default;
 
     bool is_valid() const override;
     std::unique_ptr<Deserializer> first_child(const std::string& name = "") const override;
@@ -45,17 +70,19 @@ public:
     bool get_property(const std::string& name, std::string* value, Serializer::Attributes* attrs = nullptr) const override;
 
 private:
-    rapidxml::xml_node<>* m_node{nullptr};
+    const Node* m_node{nullptr};
 };
 
-bool XmlDeserializer::is_valid() const
+template<class Node>
+bool NodeDeserializer<Node>::is_valid() const
 {
     return m_node;
 }
 
-std::unique_ptr<Deserializer> XmlDeserializer::first_child(const std::string& name) const
+template<class Node>
+std::unique_ptr<Deserializer> NodeDeserializer<Node>::first_child(const std::string& name) const
 {
-    auto ret = std::make_unique<XmlDeserializer>();
+    auto ret = std::make_unique<NodeDeserializer>();
 
     if (is_valid())
         ret->m_node = m_node->first_node(name.c_str());
@@ -63,9 +90,10 @@ std::unique_ptr<Deserializer> XmlDeserializer::first_child(const std::string& na
     return ret;
 }
 
-std::unique_ptr<Deserializer> XmlDeserializer::next_sibling(const std::string& name) const
+template<class Node>
+std::unique_ptr<Deserializer> NodeDeserializer<Node>::next_sibling(const std::string& name) const
 {
-    auto ret = std::make_unique<XmlDeserializer>();
+    auto ret = std::make_unique<NodeDeserializer>();
 
     if (is_valid())
         ret->m_node = m_node->next_sibling(name.c_str());
@@ -73,7 +101,8 @@ std::unique_ptr<Deserializer> XmlDeserializer::next_sibling(const std::string& n
     return ret;
 }
 
-bool XmlDeserializer::get_property(const std::string& name, std::string* value, Serializer::Attributes* attrs) const
+template<class Node>
+bool NodeDeserializer<Node>::get_property(const std::string& name, std::string* value, Serializer::Attributes* attrs) const
 {
     for (const auto* prop = m_node->first_node("property");
          prop;
@@ -114,78 +143,91 @@ static const std::pair<const std::string, std::function<std::unique_ptr<egt::The
     {"UltraVioletTheme", []{ return std::make_unique<egt::UltraVioletTheme>(); }}
 };
 
-template <class T>
-static std::shared_ptr<Widget> create_widget(rapidxml::xml_node<>* node,
-        Serializer::Properties& saved_props)
+template<class Node>
+static Serializer::Properties parse_properties(const Node* node)
 {
-    auto wname = node->first_attribute("name");
-
     Serializer::Properties props;
-    if (node->first_node("property"))
+    for (auto prop = node->first_node("property"); prop; prop = prop->next_sibling("property"))
     {
-        for (auto prop = node->first_node("property"); prop; prop = prop->next_sibling("property"))
+        auto name = prop->first_attribute("name");
+        if (!name)
         {
-            auto name = prop->first_attribute("name");
-            if (!name)
-            {
-                detail::warn("property with no name");
-                continue;
-            }
+            detail::warn("property with no name");
+            continue;
+        }
 
-            const std::string pname = name->value();
-            std::string pvalue;
-            Serializer::Attributes attrs;
-            if (pname == "color")
+        const std::string_view pname = name->value();
+        std::string pvalue;
+        Serializer::Attributes attrs;
+        if (pname == "color")
+        {
+            auto pattern = prop->first_node("pattern");
+            if (pattern)
             {
-                auto pattern = prop->first_node("pattern");
-                if (pattern)
+                for (auto pprop = pattern->first_node("property"); pprop; pprop = pprop->next_sibling("property"))
                 {
-                    for (auto pprop = pattern->first_node("property"); pprop; pprop = pprop->next_sibling("property"))
+                    auto ppname = pprop->first_attribute("name");
+                    if (!ppname)
                     {
-                        auto ppname = pprop->first_attribute("name");
-                        if (!ppname)
-                        {
-                            detail::warn("pattern with no name");
-                            continue;
-                        }
-                        attrs.emplace_back(ppname->value(), pprop->value());
+                        detail::warn("pattern with no name");
+                        continue;
                     }
-                }
-                else
-                {
-                    pvalue = prop->value();
+                    attrs.emplace_back(ppname->value(), pprop->value());
                 }
             }
             else
             {
                 pvalue = prop->value();
             }
-            for (const rapidxml::xml_attribute<>* attr = prop->first_attribute(); attr;
-                 attr = attr->next_attribute())
-            {
-                if (attr->name() == std::string("name"))
-                    continue;
-
-                attrs.emplace_back(attr->name(), attr->value());
-            }
+        }
+        else
+        {
+            pvalue = prop->value();
+        }
+        for (auto attr = prop->first_attribute(); attr;
+             attr = attr->next_attribute())
+        {
+            if (attr->name() == std::string("name"))
+                continue;
 
-            props.emplace_back(std::make_tuple(pname, pvalue, attrs));
+            attrs.emplace_back(attr->name(), attr->value());
         }
 
-        auto instance = std::make_shared<T>(props);
-        if (wname)
-            instance->name(wname->value());
+        props.emplace_back(detail::intern(pname), std::move(pvalue), std::move(attrs));
+    }
+
+    return props;
+}
 
-        saved_props = std::move(props);
+/// Arena the widgets created are allocated from, if any.
+static std::shared_ptr<Arena> current_arena;
 
-        return std::static_pointer_cast<Widget>(instance);
+/// Call func with the widgets created allocated from arena.
+template<class F>
+static void with_arena(const std::shared_ptr<Arena>& arena, F func)
+{
+    auto previous = std::exchange(current_arena, arena);
+    try
+    {
+        func();
     }
-    return nullptr;
+    catch (...)
+    {
+        current_arena = std::move(previous);
+        throw;
+    }
+    current_arena = std::move(previous);
 }
 
-using CreateFunction =
-    std::function<std::shared_ptr<Widget>(rapidxml::xml_node<>* widget,
-            Serializer::Properties& saved_props)>;
+template <class T>
+static std::shared_ptr<Widget> create_widget(Serializer::Properties& props)
+{
+    if (current_arena)
+        return current_arena->make_shared<T>(props);
+    return std::make_shared<T>(props);
+}
+
+using CreateFunction = std::shared_ptr<Widget>(*)(Serializer::Properties& props);
 
 static const std::pair<std::string, CreateFunction> allocators[] =
 {
@@ -212,6 +254,7 @@ static const std::pair<std::string, CreateFunction> allocators[] =
     {"egt::v1::LevelMeterF", create_widget<LevelMeterF>},
     {"egt::v1::LineWidget", create_widget<LineWidget>},
     {"egt::v1::ListBox", create_widget<ListBox>},
+    {"egt::v1::LogView", create_widget<LogView>},
     {"egt::v1::Notebook", create_widget<Notebook>},
     {"egt::v1::NotebookTab", create_widget<NotebookTab>},
     //{"egt::v1::PopupVirtualKeyboard", create_widget<PopupVirtualKeyboard>},
@@ -229,6 +272,7 @@ static const std::pair<std::string, CreateFunction> allocators[] =
     {"egt::v1::SpinProgressF", create_widget<SpinProgressF>},
     {"egt::v1::Sprite", create_widget<Sprite>},
     {"egt::v1::StaticGrid", create_widget<StaticGrid>},
+    {"egt::v1::StreamChart", create_widget<StreamChart>},
     {"egt::v1::TextBox", create_widget<TextBox>},
     {"egt::v1::ToggleBox", create_widget<ToggleBox>},
     {"egt::v1::TopWindow", create_widget<TopWindow>},
@@ -256,57 +300,188 @@ static const std::pair<std::string, CreateFunction> allocators[] =
 #endif
 };
 
-static std::shared_ptr<Widget> parse_widget(rapidxml::xml_node<>* node)
+/**
+ * Find the function creating a widget type, by its qualified name, or by its
+ * name if no qualified name matches.
+ */
+static CreateFunction find_allocator(const char* type)
 {
-    std::shared_ptr<Widget> result;
-    Serializer::Properties props;
-    std::string ttype;
+    static const auto index = []()
+    {
+        std::unordered_map<std::string, CreateFunction> result;
+        for (const auto& x : allocators)
+        {
+            const std::size_t i = x.first.find_last_of(':');
+            if (i != std::string::npos)
+                result.emplace(x.first.substr(i + 1), x.second);
+        }
+        for (const auto& x : allocators)
+            result[x.first] = x.second;
+        return result;
+    }();
 
-    auto type = node->first_attribute("type");
-    if (type)
-        ttype = type->value();
-    else
+    auto i = index.find(type);
+    return i != index.end() ? i->second : nullptr;
+}
+
+/**
+ * Children of a lazy widget, not created yet.
+ *
+ * The widget element is kept compiled, so it stays small and does not depend
+ * on the document it was loaded from.
+ */
+struct LazyChildren
+{
+    /// Compiled widget element.
+    std::vector<uint32_t> data;
+    /// Destroy the children when the widget is hidden.
+    bool unload{false};
+    /// Are the children created.
+    bool loaded{false};
+    /// Arena the children are allocated from, if any.
+    std::shared_ptr<Arena> arena;
+};
+
+using PendingLazy = std::vector<std::pair<std::shared_ptr<Widget>, std::shared_ptr<LazyChildren>>>;
+
+/// Lazy widgets found by the load in progress, if any.
+static PendingLazy* pending_lazy = nullptr;
+
+static void load_children(Widget& widget, LazyChildren& lazy);
+
+/**
+ * Call func, then create the children of the lazy widgets it found and left
+ * visible, i.e. the selected tab of a Notebook.
+ */
+template<class F>
+static void with_lazy(F func)
+{
+    PendingLazy pending;
+    auto previous = std::exchange(pending_lazy, &pending);
+    try
     {
-        detail::warn("widget with no type");
-        return nullptr;
+        func();
+    }
+    catch (...)
+    {
+        pending_lazy = previous;
+        throw;
     }
+    pending_lazy = previous;
 
-    bool found = false;
-    for (const auto& i : allocators)
+    for (auto& p : pending)
     {
-        if (i.first == ttype)
-        {
-            result = i.second(node, props);
-            found = true;
-        }
+        if (p.first->visible())
+            load_children(*p.first, *p.second);
     }
+}
+
+static void load_children(Widget& widget, LazyChildren& lazy)
+{
+    if (lazy.loaded)
+        return;
+    lazy.loaded = true;
 
-    if (!found)
+    const auto header = reinterpret_cast<const detail::ui::Header*>(lazy.data.data());
+    with_arena(lazy.arena, [&widget, header]()
     {
-        for (const auto& x : allocators)
+        with_lazy([&widget, header]()
         {
-            auto name = x.first;
-            const std::size_t index = name.find_last_of(':');
-            if (index != std::string::npos)
-                name = name.substr(index + 1);
+            NodeDeserializer<detail::ui::Node> deserializer(header->document());
+            widget.deserialize_children(deserializer);
+        });
+    });
+}
 
-            if (ttype == name)
-            {
-                found = true;
-                result = x.second(node, props);
-                break;
-            }
-        }
+static void unload_children(Widget& widget, LazyChildren& lazy)
+{
+    if (!lazy.loaded)
+        return;
+    lazy.loaded = false;
+
+    if (auto frame = dynamic_cast<Frame*>(&widget))
+        frame->remove_all();
+}
 
-        if (!found)
+/// Keep the children of a widget, to create them when it is shown.
+template<class Node>
+static void defer_children(const std::shared_ptr<Widget>& widget, const Node* node, bool unload)
+{
+    if (unload && !dynamic_cast<Frame*>(widget.get()))
+    {
+        detail::warn("{} cannot unload its children", widget->type());
+        unload = false;
+    }
+
+    std::ostringstream out;
+    detail::ui::compile(*node, out, [](const std::string&, std::string&,
+                                       std::vector<std::pair<std::string, std::string>>&) {});
+    const auto compiled = out.str();
+
+    auto lazy = std::make_shared<LazyChildren>();
+    lazy->data.resize((compiled.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    memcpy(lazy->data.data(), compiled.data(), compiled.size());
+    lazy->unload = unload;
+    lazy->arena = current_arena;
+
+    // the handlers belong to the widget, so they cannot outlive it
+    auto w = widget.get();
+    widget->on_show([w, lazy]()
+    {
+        load_children(*w, *lazy);
+    });
+
+    if (unload)
+    {
+        widget->on_hide([w, lazy]()
         {
-            detail::error("widget type {} unsupported", ttype);
-            return nullptr;
-        }
+            unload_children(*w, *lazy);
+        });
     }
 
-    XmlDeserializer deserializer(node);
-    result->deserialize_children(deserializer);
+    if (pending_lazy)
+        pending_lazy->emplace_back(widget, lazy);
+    else if (widget->visible())
+        load_children(*widget, *lazy);
+}
+
+template<class Node>
+static std::shared_ptr<Widget> parse_widget(const Node* node)
+{
+    auto type = node->first_attribute("type");
+    if (!type)
+    {
+        detail::warn("widget with no type");
+        return nullptr;
+    }
+
+    auto create = find_allocator(type->value());
+    if (!create)
+    {
+        detail::error("widget type {} unsupported", type->value());
+        return nullptr;
+    }
+
+    if (!node->first_node("property"))
+        return nullptr;
+
+    auto props = parse_properties(node);
+    auto result = create(props);
+
+    auto wname = node->first_attribute("name");
+    if (wname)
+        result->name(wname->value());
+
+    auto lazy = node->first_attribute("lazy");
+    if (lazy && (!strcmp(lazy->value(), "true") || !strcmp(lazy->value(), "unload")))
+    {
+        defer_children(result, node, !strcmp(lazy->value(), "unload"));
+    }
+    else
+    {
+        NodeDeserializer<Node> deserializer(node);
+        result->deserialize_children(deserializer);
+    }
 
     result->post_deserialize(props);
 
@@ -321,12 +496,14 @@ static std::shared_ptr<Widget> parse_widget(rapidxml::xml_node<>* node)
     return result;
 }
 
-std::shared_ptr<Widget> XmlDeserializer::parse_widget() const
+template<class Node>
+std::shared_ptr<Widget> NodeDeserializer<Node>::parse_widget() const
 {
     return egt::v1::experimental::parse_widget(m_node);
 }
 
-static void parse_resource(rapidxml::xml_node<>* node)
+template<class Node>
+static void parse_resource(const Node* node)
 {
     std::string name;
 
@@ -339,6 +516,16 @@ static void parse_resource(rapidxml::xml_node<>* node)
         return;
     }
 
+    // resources of a compiled UI file are already decoded
+    auto encoding = node->first_attribute("encoding");
+    if (encoding && !strcmp(encoding->value(), detail::ui::RAW_ENCODING))
+    {
+        auto data = reinterpret_cast<const unsigned char*>(node->value());
+        ResourceManager::instance().add(name.c_str(),
+                                        std::vector<unsigned char>(data, data + node->value_size()));
+        return;
+    }
+
     std::string buffer(node->value(), node->value_size());
     detail::strip(buffer);
     buffer = detail::base64_decode(buffer.data(), buffer.size());
@@ -348,7 +535,7 @@ static void parse_resource(rapidxml::xml_node<>* node)
 }
 
 template<class T>
-static std::shared_ptr<Widget> load_document(T& doc)
+static std::shared_ptr<Widget> load_document(const T& doc)
 {
     auto root = doc.first_node("egt");
     if (!root)
@@ -405,7 +592,7 @@ static std::shared_ptr<Widget> load_document(T& doc)
             Serializer::Attributes pattrs;
             if (pname == "color")
             {
-                for (const rapidxml::xml_attribute<>* attr = pprop->first_attribute(); attr;
+                for (auto attr = pprop->first_attribute(); attr;
                      attr = attr->next_attribute())
                 {
                     pattrs.emplace_back(attr->name(), attr->value());
@@ -460,7 +647,7 @@ static std::shared_ptr<Widget> load_document(T& doc)
             {
                 fontvalue = fprop->value();
 
-                for (const rapidxml::xml_attribute<>* attr = fprop->first_attribute(); attr;
+                for (auto attr = fprop->first_attribute(); attr;
                      attr = attr->next_attribute())
                 {
                     fontattrs.emplace_back(attr->name(), attr->value());
@@ -479,14 +666,80 @@ static std::shared_ptr<Widget> load_document(T& doc)
              widget; widget = widget->next_sibling("widget"))
         {
             // TODO: multiple root widgets not supported
-            return parse_widget(widget);
+            std::shared_ptr<Widget> result;
+            with_lazy([&result, widget]()
+            {
+                result = parse_widget(widget);
+            });
+            return result;
         }
     }
 
     return nullptr;
 }
 
-std::shared_ptr<Widget> UiLoader::load(const std::string& uri)
+static bool is_compiled(const void* data, size_t len)
+{
+    uint32_t magic = 0;
+    if (len >= sizeof(magic))
+        memcpy(&magic, data, sizeof(magic));
+    return magic == detail::ui::MAGIC;
+}
+
+static std::shared_ptr<Widget> load_compiled(const void* data, size_t len)
+{
+    auto header = detail::ui::verify(data, len);
+    if (!header)
+        throw std::runtime_error("invalid compiled ui file");
+
+    return load_document(*header->document());
+}
+
+static std::shared_ptr<Widget> load_file(const std::string& path)
+{
+#ifdef HAVE_SYS_MMAN_H
+    // a compiled file is used in place
+    auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        void* map = nullptr;
+        size_t len = 0;
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            len = st.st_size;
+            map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED)
+                map = nullptr;
+        }
+        close(fd);
+
+        if (map)
+        {
+            std::unique_ptr<void, std::function<void(void*)>> unmap(map,
+                    [len](void* p) { munmap(p, len); });
+
+            if (is_compiled(map, len))
+                return load_compiled(map, len);
+        }
+    }
+#else
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> buffer((std::istreambuf_iterator<char>(in)),
+                                 std::istreambuf_iterator<char>());
+        if (is_compiled(buffer.data(), buffer.size()))
+            return load_compiled(buffer.data(), buffer.size());
+    }
+#endif
+
+    rapidxml::file<> xml_file(path.c_str());
+    rapidxml::xml_document<> doc;
+    doc.parse < rapidxml::parse_declaration_node | rapidxml::parse_no_data_nodes > (xml_file.data());
+    return load_document(doc);
+}
+
+static std::shared_ptr<Widget> load_uri(const std::string& uri)
 {
     std::string path;
     auto type = detail::resolve_path(uri, path);
@@ -495,15 +748,15 @@ std::shared_ptr<Widget> UiLoader::load(const std::string& uri)
     {
     case detail::SchemeType::filesystem:
     {
-        rapidxml::file<> xml_file(path.c_str());
-        rapidxml::xml_document<> doc;
-        doc.parse < rapidxml::parse_declaration_node | rapidxml::parse_no_data_nodes > (xml_file.data());
-        return load_document(doc);
+        return load_file(path);
     }
 #ifdef EGT_HAS_HTTP
     case detail::SchemeType::network:
     {
         auto buffer = experimental::load_file_from_network<std::vector<char>>(path);
+        if (is_compiled(buffer.data(), buffer.size()))
+            return load_compiled(buffer.data(), buffer.size());
+
         if (!buffer.empty())
         {
             rapidxml::xml_document<> doc;
@@ -525,6 +778,280 @@ std::shared_ptr<Widget> UiLoader::load(const std::string& uri)
     return {};
 }
 
+/**
+ * Element of the tree of a WidgetPrototype.
+ *
+ * This is a widget, or another element serialized by its parent, like the
+ * cells of a StaticGrid.
+ */
+struct WidgetPrototype::Node
+{
+    /// Name of the element, "widget" for a widget.
+    std::string element;
+    /// Create the widget.
+    CreateFunction create{nullptr};
+    /// Name of the widget.
+    std::string name;
+    /// Parsed properties, without the palette and font.
+    Serializer::Properties props;
+    /// Widget of the prototype, sharing its palette and font.
+    const Widget* source{nullptr};
+    std::vector<Node> children;
+};
+
+/**
+ * Builds the tree of a WidgetPrototype as the widgets are serialized.
+ */
+class PrototypeSerializer : public Serializer
+{
+public:
+    explicit PrototypeSerializer(WidgetPrototype::Node& root)
+    {
+        m_stack.push_back(&root);
+    }
+
+    bool add(const Widget* widget) override
+    {
+        auto context = begin_child("widget");
+        auto& node = *m_stack.back();
+
+        node.create = find_allocator(widget->type().c_str());
+        if (!node.create)
+            throw std::runtime_error("widget type " + widget->type() + " cannot be created");
+        node.name = widget->name();
+        node.source = widget;
+
+        widget->serialize(*this);
+
+        end_child(context);
+        return true;
+    }
+
+    Context* begin_child(const std::string& nodename) override
+    {
+        // the context is the depth to go back to
+        auto context = reinterpret_cast<Context*>(static_cast<uintptr_t>(m_stack.size()));
+        auto& children = m_stack.back()->children;
+        children.emplace_back();
+        children.back().element = nodename;
+        m_stack.push_back(&children.back());
+        return context;
+    }
+
+    void end_child(Context* context) override
+    {
+        const auto depth = reinterpret_cast<uintptr_t>(context);
+        while (m_stack.size() > depth)
+            m_stack.pop_back();
+    }
+
+    using Serializer::add_property;
+
+    void add_property(const std::string& name, const std::string& value,
+                      const Attributes& attrs = {}) override
+    {
+        // shared instead, see Widget::share_style()
+        if (skip(name))
+            return;
+
+        m_stack.back()->props.emplace_back(detail::intern(name), value, attrs);
+    }
+
+    void add_property(const std::string& name, const Pattern& value,
+                      const Attributes& attrs = {}) override
+    {
+        if (skip(name))
+            return;
+
+        // the properties of a pattern are attributes, like the loader does
+        if (value.type() == Pattern::Type::solid)
+        {
+            add_property(name, value.first().hex(), attrs);
+            return;
+        }
+
+        Attributes pattrs;
+        if (value.type() == Pattern::Type::linear)
+            pattrs.emplace_back("type", "linear");
+        else if (value.type() == Pattern::Type::linear_vertical)
+            pattrs.emplace_back("type", "linear_vertical");
+        else if (value.type() == Pattern::Type::radial)
+            pattrs.emplace_back("type", "radial");
+        pattrs.emplace_back("start", detail::to_string(value.starting()));
+        pattrs.emplace_back("end", detail::to_string(value.ending()));
+        if (!value.steps().empty())
+        {
+            std::string steps;
+            for (const auto& step : value.steps())
+                steps += "{" + detail::to_string(step.first) + "," + step.second.hex() + "},";
+            pattrs.emplace_back("steps", steps);
+        }
+        if (value.type() == Pattern::Type::radial)
+        {
+            pattrs.emplace_back("start_radius", detail::to_string(value.starting_radius()));
+            pattrs.emplace_back("end_radius", detail::to_string(value.ending_radius()));
+        }
+        pattrs.insert(pattrs.end(), attrs.begin(), attrs.end());
+
+        m_stack.back()->props.emplace_back(detail::intern(name), std::string(), std::move(pattrs));
+    }
+
+    void write(std::ostream& out) override
+    {
+        detail::ignoreparam(out);
+    }
+
+private:
+
+    /// Is the property of a widget shared instead of copied.
+    bool skip(const std::string& name) const
+    {
+        return m_stack.back()->element == "widget" && (name == "color" || name == "font");
+    }
+
+    /// Elements being serialized.
+    std::vector<WidgetPrototype::Node*> m_stack;
+};
+
+static std::shared_ptr<Widget> instance(const std::vector<WidgetPrototype::Node>& siblings, size_t index);
+
+/**
+ * Deserializer of the tree of a WidgetPrototype.
+ */
+class PrototypeDeserializer : public Deserializer
+{
+public:
+    PrototypeDeserializer(const std::vector<WidgetPrototype::Node>* siblings, size_t index)
+        : m_siblings(siblings),
+          m_index(index)
+    {}
+
+    bool is_valid() const override
+    {
+        return m_siblings && m_index < m_siblings->size();
+    }
+
+    std::unique_ptr<Deserializer> first_child(const std::string& name = "") const override
+    {
+        if (!is_valid())
+            return std::make_unique<PrototypeDeserializer>(nullptr, 0);
+
+        const auto& children = node().children;
+        return std::make_unique<PrototypeDeserializer>(&children, find(children, 0, name));
+    }
+
+    std::unique_ptr<Deserializer> next_sibling(const std::string& name = "") const override
+    {
+        if (!is_valid())
+            return std::make_unique<PrototypeDeserializer>(nullptr, 0);
+
+        return std::make_unique<PrototypeDeserializer>(m_siblings, find(*m_siblings, m_index + 1, name));
+    }
+
+    std::shared_ptr<Widget> parse_widget() const override
+    {
+        return is_valid() ? instance(*m_siblings, m_index) : nullptr;
+    }
+
+    bool get_property(const std::string& name, std::string* value,
+                      Serializer::Attributes* attrs = nullptr) const override
+    {
+        if (!is_valid())
+            return false;
+
+        for (const auto& prop : node().props)
+        {
+            if (std::get<0>(prop) == name)
+            {
+                if (value)
+                    *value = std::get<1>(prop);
+                if (attrs)
+                    *attrs = std::get<2>(prop);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+
+    const WidgetPrototype::Node& node() const
+    {
+        return (*m_siblings)[m_index];
+    }
+
+    /// Index of the first element named name from index, or the size.
+    static size_t find(const std::vector<WidgetPrototype::Node>& nodes, size_t index,
+                       const std::string& name)
+    {
+        while (index < nodes.size() && !name.empty() && nodes[index].element != name)
+            ++index;
+        return index;
+    }
+
+    const std::vector<WidgetPrototype::Node>* m_siblings;
+    size_t m_index;
+};
+
+static std::shared_ptr<Widget> instance(const std::vector<WidgetPrototype::Node>& siblings, size_t index)
+{
+    const auto& node = siblings[index];
+    auto props = node.props;
+    auto result = node.create(props);
+    if (!node.name.empty())
+        result->name(node.name);
+
+    PrototypeDeserializer deserializer(&siblings, index);
+    result->deserialize_children(deserializer);
+
+    result->post_deserialize(props);
+    result->share_style(*node.source);
+
+    return result;
+}
+
+WidgetPrototype::WidgetPrototype(std::shared_ptr<Widget> widget)
+    : m_widget(std::move(widget))
+{
+    if (!m_widget)
+        throw std::runtime_error("no widget to copy");
+
+    auto root = std::make_shared<Node>();
+    PrototypeSerializer serializer(*root);
+    serializer.add(m_widget.get());
+    m_root = std::move(root);
+}
+
+std::shared_ptr<Widget> WidgetPrototype::instance() const
+{
+    std::shared_ptr<Widget> result;
+    with_arena(m_arena, [this, &result]()
+    {
+        result = experimental::instance(m_root->children, 0);
+    });
+    return result;
+}
+
+WidgetPrototype::~WidgetPrototype() noexcept = default;
+
+WidgetPrototype UiLoader::prototype(const std::string& uri)
+{
+    WidgetPrototype result(load(uri));
+    result.arena(m_arena);
+    return result;
+}
+
+std::shared_ptr<Widget> UiLoader::load(const std::string& uri)
+{
+    std::shared_ptr<Widget> result;
+    with_arena(m_arena, [&uri, &result]()
+    {
+        result = load_uri(uri);
+    });
+    return result;
+}
+
 }
 }
 }
@@ -73,15 +73,6 @@ bool audio_device()
     return false;
 }
 
-WindowHint check_windowhint(WindowHint& hint)
-{
-    if (hint == WindowHint::cursor_overlay)
-    {
-        throw std::runtime_error("Cannot create Videowindow with cursor_overlay hint");
-    }
-    return hint;
-}
-
 } // End of detail.
 
 VideoWindow::VideoWindow(const Rect& rect, PixelFormat format, WindowHint hint)
@@ -146,6 +137,11 @@ int64_t VideoWindow::duration() const
     return m_video_impl->duration();
 }
 
+VideoStats VideoWindow::stats() const
+{
+    return m_video_impl->stats();
+}
+
 bool VideoWindow::media(const std::string& uri)
 {
     auto type = detail::resolve_path(uri, m_uri);
@@ -168,6 +164,24 @@ bool VideoWindow::media(const std::string& uri)
     return false;
 }
 
+void VideoWindow::preload(const std::string& uri)
+{
+    std::string path;
+    auto type = detail::resolve_path(uri, path);
+
+    switch (type)
+    {
+    case detail::SchemeType::network:
+        m_video_impl->preload(path);
+        break;
+    case detail::SchemeType::filesystem:
+        m_video_impl->preload("file://" + path);
+        break;
+    default:
+        throw std::runtime_error("unsupported uri: " + uri);
+    }
+}
+
 bool VideoWindow::pause()
 {
     return m_video_impl->pause();
@@ -4,15 +4,22 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/dump.h"
+#include "detail/spanindex.h"
 #include "egt/detail/math.h"
 #include "egt/input.h"
 #include "egt/painter.h"
 #include "egt/view.h"
+#include "egt/window.h"
+#include <algorithm>
 
 namespace egt
 {
 inline namespace v1
 {
+
+/// Fewer children are as fast to test one at a time.
+static constexpr size_t VIEWPORT_INDEX_MIN = 8;
+
 ScrolledView::ScrolledView(Policy horizontal_policy,
                            Policy vertical_policy) noexcept
     : ScrolledView(Rect(), horizontal_policy, vertical_policy)
@@ -28,7 +35,7 @@ ScrolledView::ScrolledView(const Rect& rect,
       m_horizontal_policy(horizontal_policy),
       m_vertical_policy(vertical_policy)
 {
-    name("ScrolledView" + std::to_string(m_widgetid));
+    default_name("ScrolledView", m_widgetid);
 
     // scrolled views are not transparent by default
     fill_flags(Theme::FillFlag::solid);
@@ -137,17 +144,29 @@ void ScrolledView::draw(Painter& painter, const Rect& rect)
         auto r = Rect::intersection(rect, content);
         auto crect = to_child(r) - m_offset;
 
-        for (auto& child : children())
+        const auto draw_child = [this, &painter, &crect](Widget * child)
         {
             if (!child->visible())
-                continue;
+                return;
 
             // don't draw plane frame as child - this is
             // specifically handled by event loop
             if (child->plane_window())
-                continue;
+                return;
 
-            draw_subordinate(painter, crect, child.get());
+            draw_subordinate(painter, crect, child);
+        };
+
+        // only the children in the rect, in the same order
+        if (auto index = viewport_index())
+        {
+            for (auto i : index->query(crect))
+                draw_child(m_subordinates[i].get());
+        }
+        else
+        {
+            for (auto& child : children())
+                draw_child(child.get());
         }
     }
 
@@ -166,6 +185,9 @@ void ScrolledView::resize(const Size& size)
 
 void ScrolledView::layout()
 {
+    // the viewport may have grown
+    resume_deferred_layout();
+
     Frame::layout();
 
     if (!visible())
@@ -278,6 +300,7 @@ void ScrolledView::handle(Event& event)
     switch (event.id())
     {
     case EventId::pointer_drag_start:
+        m_fling.stop();
         m_start_offset = m_offset;
         break;
     case EventId::pointer_drag:
@@ -287,6 +310,27 @@ void ScrolledView::handle(Event& event)
         offset(m_start_offset + Point(diff.x(), diff.y()));
         break;
     }
+    case EventId::pointer_drag_stop:
+    {
+        if (!m_kinetic)
+            break;
+
+        // a drag that stopped before it ended has no velocity, so does not
+        // move on
+
+        // the content starts at the speed of the drag, and moves a third of
+        // the duration at that speed, as the easing starts three times faster
+        const auto& velocity = event.pointer().velocity;
+        const std::chrono::duration<float> duration = std::chrono::milliseconds(750);
+        const auto scale = duration.count() / 3.f;
+        m_fling_distance = Point(velocity.x() * scale, velocity.y() * scale);
+        if (std::abs(m_fling_distance.x()) < 2 && std::abs(m_fling_distance.y()) < 2)
+            break;
+
+        m_fling_start = m_offset;
+        m_fling.start();
+        break;
+    }
     default:
         break;
     }
@@ -317,15 +361,68 @@ ScrolledView::Policy ScrolledView::str2policy(const std::string& str)
     return Policy::as_needed;
 }
 
+void ScrolledView::kinetic(bool enable)
+{
+    m_kinetic = enable;
+    if (!enable)
+        m_fling.stop();
+}
+
+void ScrolledView::scroll_content(const Point& delta)
+{
+    // the sliders change, and are drawn over the content without moving
+    auto rect = content_area();
+    if (hscrollable())
+    {
+        const auto slider = m_hslider.box() + point();
+        rect.height(std::min(rect.bottom(), slider.y()) - rect.y());
+        damage(slider);
+    }
+    if (vscrollable())
+    {
+        const auto slider = m_vslider.box() + point();
+        rect.width(std::min(rect.right(), slider.x()) - rect.x());
+        damage(slider);
+    }
+
+    // the background moves with the children, so it must be a plain color
+    auto window = dynamic_cast<Window*>(find_screen());
+    if (!window || rect.empty() || cache_subtree() ||
+        !opaque_rect().contains(rect))
+    {
+        damage();
+        return;
+    }
+
+    const auto r = unobscured_rect(rect);
+    if (r.empty())
+    {
+        damage();
+        return;
+    }
+
+    window->scroll(r, delta);
+}
+
 void ScrolledView::init_sliders()
 {
     auto redraw_content = [this]()
     {
+        const auto previous = m_offset;
         m_offset.x(m_hslider.value());
         m_offset.y(m_vslider.value());
-        damage();
+        // children in view may have a deferred layout
+        resume_deferred_layout();
+        scroll_content(m_offset - previous);
+        on_offset_changed.invoke();
     };
 
+    m_fling.add_callback([this](EasingScalar value)
+    {
+        offset(m_fling_start + Point(m_fling_distance.x() * value,
+                                     m_fling_distance.y() * value));
+    });
+
     m_hslider.slider_flags().set({Slider::SliderFlag::rectangle_handle,
                                   Slider::SliderFlag::consistent_line});
     m_hslider.on_value_changed(redraw_content);
@@ -340,16 +437,119 @@ Point ScrolledView::point_from_subordinate(const Widget& subordinate) const
 {
     auto p = Frame::point_from_subordinate(subordinate);
 
-    auto i = std::find_if(children().begin(), children().end(),
-                          [&subordinate](const auto & ptr)
-    {
-        return ptr.get() == &subordinate;
-    });
-    if (i != children().end())
+    // children are moved by the offset, components are not
+    if (subordinate.parent() == this &&
+        &range_from_widget(subordinate) == &children())
         p += m_offset;
 
     return p;
 }
 
+Rect ScrolledView::viewport() const
+{
+    return to_child(content_area()) - m_offset;
+}
+
+detail::SpanIndex* ScrolledView::viewport_index()
+{
+    if (m_children_count < VIEWPORT_INDEX_MIN)
+    {
+        m_viewport_index.reset();
+        return nullptr;
+    }
+
+    // the boxes of the children do not include the offset, so scrolling
+    // leaves the index as is
+    const auto orientation = !hscrollable() || vscrollable() ?
+                             Orientation::vertical : Orientation::horizontal;
+    if (!m_viewport_index)
+        m_viewport_index = std::make_unique<detail::SpanIndex>();
+
+    auto& index = *m_viewport_index;
+    if (index.dirty || index.generation != subordinates_generation() ||
+        index.orientation != orientation)
+    {
+        std::vector<Rect> boxes;
+        boxes.reserve(m_children_count);
+        for (auto& child : children())
+            boxes.push_back(child->box());
+
+        index.build(boxes, orientation);
+        index.generation = subordinates_generation();
+    }
+
+    return &index;
+}
+
+Widget* ScrolledView::subordinate_at(const Point& point)
+{
+    // components are not scrolled, and are above the children
+    for (auto& component : detail::reverse_iterate(components()))
+    {
+        if (component->can_handle_event() && component->box().intersect(point))
+            return component.get();
+    }
+
+    const auto p = point - m_offset;
+    const auto hit = [&p](Widget * child)
+    {
+        return child->can_handle_event() && child->box().intersect(p);
+    };
+
+    if (auto index = viewport_index())
+    {
+        // boxes contain their right and bottom edges, see Rect::intersect()
+        const auto& candidates = index->query(Rect(p - Point(1, 1), Size(2, 2)));
+        for (auto i = candidates.rbegin(); i != candidates.rend(); ++i)
+        {
+            if (hit(m_subordinates[*i].get()))
+                return m_subordinates[*i].get();
+        }
+    }
+    else
+    {
+        for (auto& child : detail::reverse_iterate(children()))
+        {
+            if (hit(child.get()))
+                return child.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void ScrolledView::defer_offscreen_layout(bool enable)
+{
+    if (detail::change_if_diff<>(m_defer_offscreen_layout, enable) && !enable)
+        resume_deferred_layout();
+}
+
+bool ScrolledView::defer_subordinate_layout(const Widget& subordinate)
+{
+    if (!m_defer_offscreen_layout || &range_from_widget(subordinate) != &children())
+        return false;
+
+    // without a size of its own, a child has to be laid out to know where it is
+    const auto& box = subordinate.box();
+    if (box.empty() || box.intersect(viewport()))
+        return false;
+
+    m_layout_deferred = true;
+    return true;
+}
+
+void ScrolledView::resume_deferred_layout()
+{
+    if (!m_layout_deferred)
+        return;
+
+    // flush_layout() decides again which children are in view
+    m_layout_deferred = false;
+    m_child_layout_dirty = true;
+    parent_layout_pending();
+}
+
+ScrolledView::~ScrolledView() noexcept = default;
+
 }
 }
@@ -6,12 +6,15 @@
 #include "detail/utf8text.h"
 #include "egt/app.h"
 #include "egt/button.h"
+#include "egt/canvas.h"
 #include "egt/embed.h"
 #include "egt/input.h"
 #include "egt/keycode.h"
+#include "egt/painter.h"
 #include "egt/popup.h"
 #include "egt/sizer.h"
 #include "egt/virtualkeyboard.h"
+#include <algorithm>
 
 #ifdef SRCDIR
 EGT_EMBED(internal_microphone, SRCDIR "/icons/32px/microphone.png")
@@ -86,11 +89,15 @@ VirtualKeyboard::Key::Key(uint32_t unicode,
 void VirtualKeyboard::Key::color(Palette::ColorId id, const Pattern& color, Palette::GroupId group)
 {
     m_button->color(id, color, group);
+    if (m_panel)
+        m_panel->invalidate();
 }
 
 void VirtualKeyboard::Key::font(const Font& font)
 {
     m_button->font(font);
+    if (m_panel)
+        m_panel->invalidate();
 }
 
 void VirtualKeyboard::initialize(const std::vector<PanelKeys>& keys)
@@ -138,7 +145,7 @@ void VirtualKeyboard::initialize(const std::vector<PanelKeys>& keys)
 VirtualKeyboard::VirtualKeyboard(const std::vector<PanelKeys>& keys, const Rect& rect)
     : Frame(rect)
 {
-    name("VirtualKeyboard" + std::to_string(m_widgetid));
+    default_name("VirtualKeyboard", m_widgetid);
     initialize(keys);
 }
 
@@ -193,14 +200,107 @@ void VirtualKeyboard::key_space(unsigned key_space)
 VirtualKeyboard::Panel::Panel(const PanelKeys& keys)
     : m_keys(keys)
 {
+    default_name("VirtualKeyboardPanel", m_widgetid);
+
     for (auto& row : keys)
-    {
-        auto hsizer = std::make_shared<HorizontalBoxSizer>();
-        hsizer->align(AlignFlag::expand_horizontal | AlignFlag::top);
-        add(hsizer);
+        for (auto& key : row)
+            key->m_panel = this;
+}
 
+VirtualKeyboard::Panel::~Panel()
+{
+    for (auto& row : m_keys)
         for (auto& key : row)
-            hsizer->add(key->m_button);
+            if (key->m_panel == this)
+                key->m_panel = nullptr;
+}
+
+void VirtualKeyboard::Panel::handle(Event& event)
+{
+    Widget::handle(event);
+
+    switch (event.id())
+    {
+    case EventId::raw_pointer_down:
+    case EventId::raw_pointer_up:
+    case EventId::pointer_click:
+    case EventId::pointer_hold:
+    {
+        auto key = key_at(display_to_local(event.pointer().point));
+        if (event.id() == EventId::raw_pointer_down)
+        {
+            // grab without becoming active, which would damage every key
+            press(key);
+            if (key)
+                event.grab(this);
+        }
+        else if (event.id() == EventId::raw_pointer_up)
+            press(nullptr);
+
+        // the handlers of the key are on its button
+        if (key)
+            key->m_button->invoke_handlers(event);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void VirtualKeyboard::Panel::draw(Painter& painter, const Rect& rect)
+{
+    if (!m_atlas)
+    {
+        // the keys released, and below them, pressed
+        Canvas canvas(Size(width(), height() * 2));
+        canvas.zero();
+        Painter atlas(canvas.context());
+        for (auto pressed : {false, true})
+        {
+            for (auto& row : m_keys)
+            {
+                for (auto& key : row)
+                {
+                    key->m_button->active(pressed);
+                    key->m_button->draw(atlas, key->m_button->box());
+                    key->m_button->active(false);
+                }
+            }
+            cairo_translate(canvas.context().get(), 0, height());
+        }
+        cairo_surface_flush(canvas.surface().get());
+        m_atlas = canvas.surface();
+    }
+
+    Painter::AutoSaveRestore sr(painter);
+    auto cr = painter.context().get();
+
+    const auto area = Rect::intersection(rect, box());
+    const auto pressed = m_pressed ?
+                         Rect::intersection(m_pressed->m_button->box() + point(), area) : Rect();
+
+    // everything but the pressed key from the released keys
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
+    cairo_set_source_surface(cr, m_atlas.get(), x(), y());
+    cairo_rectangle(cr, area.x(), area.y(), area.width(), area.height());
+    if (!pressed.empty())
+        cairo_rectangle(cr, pressed.x(), pressed.y(), pressed.width(), pressed.height());
+    cairo_fill(cr);
+
+    if (!pressed.empty())
+    {
+        cairo_set_source_surface(cr, m_atlas.get(), x(), y() - height());
+        cairo_rectangle(cr, pressed.x(), pressed.y(), pressed.width(), pressed.height());
+        cairo_fill(cr);
+    }
+}
+
+void VirtualKeyboard::Panel::resize(const Size& s)
+{
+    if (s != size())
+    {
+        Widget::resize(s);
+        layout_keys();
     }
 }
 
@@ -209,13 +309,91 @@ void VirtualKeyboard::Panel::update_key_space(unsigned key_space)
     for (auto& row : m_keys)
         for (auto& key : row)
             key->m_button->margin(key_space / 2);
+    invalidate();
 }
 
 void VirtualKeyboard::Panel::update_key_size(const Size& s)
 {
+    m_key_size = s;
+
+    // the size of the panel is the size of its keys, unless resized
+    Size content(0, s.height() * static_cast<DefaultDim>(m_keys.size()));
+    for (auto& row : m_keys)
+    {
+        DefaultDim width = 0;
+        for (auto& key : row)
+        {
+            const DefaultDim w = s.width() * key->m_length;
+            width += w;
+        }
+        content.width(std::max(content.width(), width));
+    }
+
+    resize(content);
+    layout_keys();
+}
+
+void VirtualKeyboard::Panel::layout_keys()
+{
+    const auto height = m_key_size.height();
+    m_top = (this->height() - height * static_cast<DefaultDim>(m_keys.size())) / 2;
+
+    auto y = m_top;
     for (auto& row : m_keys)
+    {
+        DefaultDim width = 0;
         for (auto& key : row)
-            key->m_button->resize(Size(s.width() * key->m_length, s.height()));
+        {
+            const DefaultDim w = m_key_size.width() * key->m_length;
+            width += w;
+        }
+
+        auto x = (this->width() - width) / 2;
+        for (auto& key : row)
+        {
+            const DefaultDim w = m_key_size.width() * key->m_length;
+            key->m_button->box(Rect(x, y, w, height));
+            x += w;
+        }
+        y += height;
+    }
+
+    invalidate();
+}
+
+void VirtualKeyboard::Panel::invalidate()
+{
+    m_atlas.reset();
+    damage();
+}
+
+void VirtualKeyboard::Panel::press(const std::shared_ptr<Key>& key)
+{
+    if (key == m_pressed)
+        return;
+
+    if (m_pressed)
+        damage(m_pressed->m_button->box() + point());
+    m_pressed = key;
+    if (m_pressed)
+        damage(m_pressed->m_button->box() + point());
+}
+
+std::shared_ptr<VirtualKeyboard::Key> VirtualKeyboard::Panel::key_at(const Point& point) const
+{
+    if (m_key_size.height() <= 0 || point.y() < m_top)
+        return nullptr;
+
+    // rows all have the height of a key
+    const auto row = static_cast<size_t>((point.y() - m_top) / m_key_size.height());
+    if (row >= m_keys.size())
+        return nullptr;
+
+    for (auto& key : m_keys[row])
+        if (key->m_button->box().intersect(point))
+            return key;
+
+    return nullptr;
 }
 
 void VirtualKeyboard::key_link(const std::shared_ptr<Key>& k)
@@ -265,7 +443,7 @@ void VirtualKeyboard::key_multichoice(const std::shared_ptr<Key>& k)
         m_multichoice_popup->add(k->m_multichoice_panel);
         Application::instance().main_window()->add(m_multichoice_popup);
 
-        auto display_origin = k->m_button->display_origin();
+        auto display_origin = k->m_panel->local_to_display(k->m_button->point());
         auto main_window_origin = Application::instance().main_window()->display_to_local(display_origin);
 
         // Popup on top of the key.
@@ -309,7 +487,7 @@ void VirtualKeyboard::key_multichoice(const std::shared_ptr<Key>& k)
                     up.key().keycode = key_multichoice->m_keycode;
                     m_in.dispatch(up);
                     // the modal popup caught the raw_pointer_up event
-                    k->m_button->active(false);
+                    k->m_panel->press(nullptr);
                 }
                 // User may just move his finger so prefer the raw_pointer_up event to the pointer_click one.
             }, {EventId::raw_pointer_up});
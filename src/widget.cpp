@@ -4,23 +4,35 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "detail/egtlog.h"
+#include "detail/focuschain.h"
+#include "detail/layoutcache.h"
+#include "detail/snapshot.h"
+#include "detail/window/visibilitypolicy.h"
+#include "egt/app.h"
 #include "egt/canvas.h"
 #include "egt/detail/alignment.h"
+#include "egt/detail/drawdiagnostics.h"
 #include "egt/detail/enum.h"
 #include "egt/detail/math.h"
+#include "egt/detail/pixelops.h"
+#include "egt/detail/rectbatch.h"
 #include "egt/detail/string.h"
+#include "egt/detail/surfacepool.h"
 #include "egt/frame.h"
 #include "egt/geometry.h"
 #include "egt/image.h"
 #include "egt/input.h"
 #include "egt/painter.h"
+#include "egt/profiler.h"
 #include "egt/screen.h"
 #include "egt/serialize.h"
 #include "egt/types.h"
 #include "egt/widget.h"
+#include <algorithm>
 #include <cassert>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "detail/dump.h"
 
@@ -47,6 +59,9 @@ const std::pair<Widget::Flag, char const*> detail::EnumStrings<Widget::Flag>::da
     {Widget::Flag::component, "component"},
     {Widget::Flag::user_drag, "user_drag"},
     {Widget::Flag::user_track_drag, "user_track_drag"},
+    {Widget::Flag::cache_subtree, "cache_subtree"},
+    {Widget::Flag::thread_safe_draw, "thread_safe_draw"},
+    {Widget::Flag::focusable, "focusable"},
 };
 
 std::ostream& operator<<(std::ostream& os, const Widget::Flags& flags)
@@ -62,6 +77,113 @@ std::ostream& operator<<(std::ostream& os, const Widget::Flag& flag)
 static Widget::WidgetId global_widget_id{0};
 
 // NOLINTNEXTLINE(modernize-pass-by-value)
+namespace detail
+{
+
+/**
+ * Backdrop drawn by a Widget under one of its subordinates.
+ */
+struct Backdrop
+{
+    /// Subordinate drawn over the backdrop, not used before it is found among the subordinates.
+    const Widget* owner{nullptr};
+
+    /// Color the snapshot is dimmed with.
+    Color dim;
+
+    /// Blur radius of the snapshot.
+    DefaultDim blur{0};
+
+    /// Size of the shadow around the owner.
+    DefaultDim shadow{0};
+
+    /// Rendering of the widget and of the subordinates under the owner, dimmed and blurred.
+    shared_cairo_surface_t snapshot;
+
+    /// Size of snapshot.
+    Size size;
+
+    /// Is snapshot rendered, apart from damage.
+    bool valid{false};
+
+    /// Part of snapshot damaged since it was rendered, relative to the widget.
+    Rect damage;
+
+    /// Is the snapshot being rendered.
+    bool rendering{false};
+
+    /// Is the damage coming from the owner.
+    bool owner_damage{false};
+
+    /// Shadow of the owner, for its current size.
+    shared_cairo_surface_t shadow_mask;
+};
+
+/**
+ * Boxes of the subordinates, kept until they change.
+ */
+struct SubordinateBoxes
+{
+    RectBatch boxes;
+    /// Value of Widget::subordinates_generation() when the boxes were taken.
+    uint32_t generation{0};
+    bool valid{false};
+};
+
+/**
+ * State of a Widget most widgets leave at its default.
+ */
+struct WidgetExtra
+{
+    /**
+     * Palette for the widget.
+     *
+     * This may or may not be a complete palette.  If a color does not exist in
+     * this instance, it will refer to the default_palette().  It may be
+     * shared with other widgets, see Widget::share_style(), so it is copied
+     * before being changed.
+     */
+    std::shared_ptr<Palette> palette;
+
+    /// Font instance for the widget, not set until it is modified.
+    std::shared_ptr<Font> font;
+
+    /// Optional background images.
+    ImageGroup backgrounds{"bg"};
+
+    /// Alignment X ratio.
+    DefaultDim xratio{0};
+    /// Alignment Y ratio.
+    DefaultDim yratio{0};
+    /// Horizontal alignment ratio.
+    DefaultDim horizontal_ratio{0};
+    /// Vertical alignment ratio.
+    DefaultDim vertical_ratio{0};
+
+    /// Used internally for calling the special child draw function.
+    std::function<void(Painter& painter, Widget* widget)> special_child_draw_callback;
+
+    /**
+     * Rendering of the subtree when Widget::Flag::cache_subtree is set or
+     * when alpha is not 1.0.
+     */
+    shared_cairo_surface_t subtree_cache;
+
+    /// Is subtree_cache rendered, apart from subtree_cache_damage.
+    bool subtree_cache_valid{false};
+
+    /// Part of subtree_cache damaged since it was rendered, relative to the widget.
+    Rect subtree_cache_damage;
+
+    /// Backdrop drawn under a subordinate, if any.
+    std::unique_ptr<Backdrop> backdrop;
+
+    /// Boxes of the subordinates for drawing, and for hit testing.
+    SubordinateBoxes subordinate_boxes[2];
+};
+
+}
+
 Widget::Widget(const Rect& rect, const Widget::Flags& flags) noexcept
     : m_box(rect),
       m_user_requested_box(rect),
@@ -90,6 +212,16 @@ Widget::Widget(Frame& parent, const Rect& rect, const Widget::Flags& flags) noex
     parent.add(*this);
 }
 
+Widget::Widget(Widget&&) noexcept = default;
+Widget& Widget::operator=(Widget&&) noexcept = default;
+
+detail::WidgetExtra& Widget::extra()
+{
+    if (!m_extra)
+        m_extra = std::make_unique<detail::WidgetExtra>();
+    return *m_extra;
+}
+
 void Widget::handle(Event& event)
 {
     if (event.quit())
@@ -127,21 +259,11 @@ void Widget::handle(Event& event)
         case EventId::pointer_hold:
         case EventId::pointer_drag_start:
         {
-            const auto p = display_to_local(event.pointer().point) + point();
-
-            for (auto& subordinate : detail::reverse_iterate(m_subordinates))
+            if (auto subordinate = subordinate_at(display_to_local(event.pointer().point)))
             {
-                if (!subordinate->can_handle_event())
-                    continue;
-
-                const auto p2 = p - point_from_subordinate(*subordinate);
-                if (subordinate->box().intersect(p2))
-                {
-                    subordinate->handle(event);
-                    if (event.postponed_quit())
-                        event.stop();
-                    break;
-                }
+                subordinate->handle(event);
+                if (event.postponed_quit())
+                    event.stop();
             }
 
             break;
@@ -151,8 +273,13 @@ void Widget::handle(Event& event)
         case EventId::keyboard_up:
         case EventId::keyboard_repeat:
         {
-            for (auto& subordinate : detail::reverse_iterate(m_subordinates))
+            // handlers may add or remove subordinates
+            for (auto index = m_subordinates.size(); index-- > 0;)
             {
+                if (index >= m_subordinates.size())
+                    continue;
+
+                const auto subordinate = m_subordinates[index];
                 if (!subordinate->can_handle_event())
                     continue;
 
@@ -252,14 +379,17 @@ void Widget::resize(const Size& size)
         m_box.size(size);
         damage();
 
+        if (m_parent)
+            m_parent->subordinates_changed();
+
         // If resize comes from the user
         if (!parent_in_layout() && !in_layout())
             m_user_requested_box.size(size);
 
-        parent_layout();
+        relayout_parent();
 
         if (!m_subordinates.empty())
-            layout();
+            request_layout();
     }
 }
 
@@ -270,6 +400,97 @@ void Widget::resize_by_ratio(DefaultDim hratio, DefaultDim vratio)
     resize(size);
 }
 
+void Widget::ratio(DefaultDim horizontal, DefaultDim vertical)
+{
+    if (!m_extra && !horizontal && !vertical)
+        return;
+
+    auto& state = extra();
+    auto a = detail::change_if_diff<>(state.horizontal_ratio, horizontal);
+    auto b = detail::change_if_diff<>(state.vertical_ratio, vertical);
+    if (a || b)
+        parent_layout();
+}
+
+void Widget::vertical_ratio(DefaultDim vertical)
+{
+    if (!m_extra && !vertical)
+        return;
+
+    if (detail::change_if_diff<>(extra().vertical_ratio, vertical))
+        parent_layout();
+}
+
+DefaultDim Widget::vertical_ratio() const
+{
+    return m_extra ? m_extra->vertical_ratio : 0;
+}
+
+void Widget::horizontal_ratio(DefaultDim horizontal)
+{
+    if (!m_extra && !horizontal)
+        return;
+
+    if (detail::change_if_diff<>(extra().horizontal_ratio, horizontal))
+        parent_layout();
+}
+
+DefaultDim Widget::horizontal_ratio() const
+{
+    return m_extra ? m_extra->horizontal_ratio : 0;
+}
+
+void Widget::yratio(DefaultDim yratio)
+{
+    if (!m_extra && !yratio)
+        return;
+
+    if (detail::change_if_diff<>(extra().yratio, yratio))
+        parent_layout();
+}
+
+DefaultDim Widget::yratio() const
+{
+    return m_extra ? m_extra->yratio : 0;
+}
+
+void Widget::xratio(DefaultDim xratio)
+{
+    if (!m_extra && !xratio)
+        return;
+
+    if (detail::change_if_diff<>(extra().xratio, xratio))
+        parent_layout();
+}
+
+DefaultDim Widget::xratio() const
+{
+    return m_extra ? m_extra->xratio : 0;
+}
+
+Widget::ChildDrawCallback Widget::special_child_draw_callback() const
+{
+    if (!m_extra)
+        return nullptr;
+    return m_extra->special_child_draw_callback;
+}
+
+void Widget::special_child_draw_callback(ChildDrawCallback func)
+{
+    if (!m_extra && !func)
+        return;
+
+    extra().special_child_draw_callback = std::move(func);
+}
+
+void Widget::special_child_draw(Painter& painter, Widget* widget)
+{
+    if (m_extra && m_extra->special_child_draw_callback)
+        m_extra->special_child_draw_callback(painter, widget);
+    else if (parent())
+        parent()->special_child_draw(painter, widget);
+}
+
 void Widget::move(const Point& point)
 {
     if (point != box().point())
@@ -278,11 +499,14 @@ void Widget::move(const Point& point)
         m_box.point(point);
         damage();
 
+        if (m_parent)
+            m_parent->subordinates_changed();
+
         // If move comes from the user
         if (!parent_in_layout())
             m_user_requested_box.point(point);
 
-        parent_layout();
+        relayout_parent();
     }
 }
 
@@ -297,7 +521,9 @@ void Widget::hide()
     if (flags().is_set(Widget::Flag::invisible))
         return;
     // careful attention to ordering
-    damage();
+    damage_placement();
+    detail::FocusChain::detach(*this);
+    detail::LayoutCache::changed();
     flags().set(Widget::Flag::invisible);
     on_hide.invoke();
 }
@@ -308,7 +534,9 @@ void Widget::show()
         return;
     // careful attention to ordering
     flags().clear(Widget::Flag::invisible);
-    damage();
+    detail::FocusChain::attach(*this);
+    detail::LayoutCache::changed();
+    damage_placement();
     on_show.invoke();
 }
 
@@ -336,7 +564,7 @@ void Widget::active(bool value)
             flags().set(Widget::Flag::active);
         else
             flags().clear(Widget::Flag::active);
-        damage();
+        damage_state();
     }
 }
 
@@ -361,7 +589,7 @@ void Widget::disable()
 {
     if (flags().is_set(Widget::Flag::disabled))
         return;
-    damage();
+    damage_state();
     flags().set(Widget::Flag::disabled);
 
     if (detail::keyboard_focus() == this)
@@ -372,7 +600,7 @@ void Widget::enable()
 {
     if (!flags().is_set(Widget::Flag::disabled))
         return;
-    damage();
+    damage_state();
     flags().clear(Widget::Flag::disabled);
 }
 
@@ -428,6 +656,63 @@ bool Widget::no_layout() const
     return flags().is_set(Widget::Flag::no_layout);
 }
 
+void Widget::cache_subtree(bool value)
+{
+    if (flags().is_set(Widget::Flag::cache_subtree) != value)
+    {
+        if (value)
+        {
+            flags().set(Widget::Flag::cache_subtree);
+        }
+        else
+        {
+            flags().clear(Widget::Flag::cache_subtree);
+            if (detail::float_equal(m_alpha, 1.f) && m_extra)
+                m_extra->subtree_cache.reset();
+        }
+    }
+}
+
+bool Widget::cache_subtree() const
+{
+    return flags().is_set(Widget::Flag::cache_subtree);
+}
+
+void Widget::thread_safe_draw(bool value)
+{
+    if (value)
+        flags().set(Widget::Flag::thread_safe_draw);
+    else
+        flags().clear(Widget::Flag::thread_safe_draw);
+}
+
+bool Widget::thread_safe_draw() const
+{
+    return flags().is_set(Widget::Flag::thread_safe_draw);
+}
+
+void Widget::focusable(bool value)
+{
+    if (flags().is_set(Widget::Flag::focusable) != value)
+    {
+        if (value)
+        {
+            flags().set(Widget::Flag::focusable);
+            detail::FocusChain::attach(*this);
+        }
+        else
+        {
+            flags().clear(Widget::Flag::focusable);
+            detail::FocusChain::erase(*this);
+        }
+    }
+}
+
+bool Widget::focusable() const
+{
+    return flags().is_set(Widget::Flag::focusable);
+}
+
 void Widget::grab_mouse(bool value)
 {
     if (flags().is_set(Widget::Flag::grab_mouse) != value)
@@ -449,7 +734,13 @@ void Widget::alpha(float alpha)
     alpha = detail::clamp<>(alpha, 0.f, 1.f);
 
     if (detail::change_if_diff<float>(m_alpha, alpha))
-        damage();
+    {
+        // the layer of the subtree is drawn without alpha, so it stays valid
+        damage_placement();
+
+        if (detail::float_equal(m_alpha, 1.f) && !cache_subtree() && m_extra)
+            m_extra->subtree_cache.reset();
+    }
 }
 
 void Widget::damage()
@@ -457,11 +748,51 @@ void Widget::damage()
     damage(box());
 }
 
+void Widget::damage_placement()
+{
+    if (!m_extra)
+    {
+        damage();
+        return;
+    }
+
+    const auto valid = m_extra->subtree_cache_valid;
+    const auto pending = m_extra->subtree_cache_damage;
+    damage();
+    m_extra->subtree_cache_valid = valid;
+    m_extra->subtree_cache_damage = pending;
+}
+
 void Widget::damage(const Rect& rect)
 {
     if (egt_unlikely(rect.empty()))
         return;
 
+    detail::DrawDiagnostics::DamageScope scope(*this);
+
+    // any damage reaching this widget came from inside its subtree
+    if (m_extra && (m_extra->subtree_cache_valid || m_extra->backdrop))
+    {
+        const auto local = Rect::intersection(has_screen() ? rect : rect - point(),
+                                              Rect({}, size()));
+        if (!local.empty())
+        {
+            if (m_extra->subtree_cache_valid)
+            {
+                auto& pending = m_extra->subtree_cache_damage;
+                pending = pending.empty() ? local : Rect::merge(pending, local);
+            }
+
+            // the owner of the backdrop does not change what is under it
+            auto& backdrop = m_extra->backdrop;
+            if (backdrop && backdrop->valid && !backdrop->owner_damage)
+            {
+                auto& pending = backdrop->damage;
+                pending = pending.empty() ? local : Rect::merge(pending, local);
+            }
+        }
+    }
+
     // don't damage if not even visible
     if (!visible())
         return;
@@ -469,8 +800,19 @@ void Widget::damage(const Rect& rect)
     // damage propagates up to widget with screen
     if (!has_screen())
     {
-        if (parent())
-            parent()->damage_from_subordinate(to_parent(rect));
+        auto p = parent();
+        if (p)
+        {
+            auto backdrop = p->m_extra ? p->m_extra->backdrop.get() : nullptr;
+            if (backdrop && backdrop->owner != this)
+                backdrop = nullptr;
+
+            if (backdrop)
+                backdrop->owner_damage = true;
+            p->damage_from_subordinate(to_parent(rect));
+            if (backdrop)
+                backdrop->owner_damage = false;
+        }
 
         // have no parent or screen - nowhere to put damage
         return;
@@ -501,7 +843,11 @@ void Widget::add_damage(const Rect& rect)
     // to just the part we care about.
     auto r = Rect::intersection(rect, to_subordinate(box()));
 
-    Screen::damage_algorithm(m_damage, r);
+    auto& diagnostics = detail::DrawDiagnostics::instance();
+    if (egt_unlikely(diagnostics.enabled()))
+        diagnostics.damaged(*this, *screen(), r);
+
+    screen()->add_damage(m_damage, r);
 }
 
 Palette::GroupId Widget::group() const
@@ -517,21 +863,37 @@ Palette::GroupId Widget::group() const
     return group;
 }
 
+/*
+ * Number of widgets with their own palette, or more, as a widget moved into
+ * another one does not decrement it.  When none has one, looking up a color
+ * goes to the global palette without walking up the parents.
+ */
+static size_t palette_overrides = 0;
+
 void Widget::palette(const Palette& palette)
 {
-    m_palette = std::make_unique<Palette>(palette);
+    auto& current = extra().palette;
+    if (!current)
+        ++palette_overrides;
+    current = std::make_shared<Palette>(palette);
     damage();
 }
 
 void Widget::reset_palette()
 {
-    if (m_palette)
+    if (has_palette())
     {
-        m_palette.reset();
+        m_extra->palette.reset();
+        --palette_overrides;
         damage();
     }
 }
 
+bool Widget::has_palette() const
+{
+    return m_extra && m_extra->palette;
+}
+
 const Pattern& Widget::color(Palette::ColorId id) const
 {
     return color(id, group());
@@ -539,16 +901,16 @@ const Pattern& Widget::color(Palette::ColorId id) const
 
 const Pattern& Widget::color(Palette::ColorId id, Palette::GroupId group) const
 {
-    if (m_palette)
+    if (palette_overrides)
     {
-        const Pattern* color;
-        if (m_palette->exists(id, group, &color))
-            return *color;
+        for (auto widget = this; widget; widget = widget->parent())
+        {
+            const Pattern* color;
+            if (widget->has_palette() && widget->m_extra->palette->exists(id, group, &color))
+                return *color;
+        }
     }
 
-    if (parent())
-        return parent()->color(id, group);
-
     if (global_palette())
         return global_palette()->color(id, group);
 
@@ -559,17 +921,23 @@ void Widget::color(Palette::ColorId id,
                    const Pattern& color,
                    Palette::GroupId group)
 {
-    if (!m_palette)
-        m_palette = std::make_unique<Palette>();
+    auto& palette = extra().palette;
+    if (!palette)
+    {
+        palette = std::make_shared<Palette>();
+        ++palette_overrides;
+    }
 
     /*
      * Performance improvement: do not update the color if there is no change,
      * otherwise it can cause unexpected redraws.
      */
     const Pattern* current_color;
-    if (!m_palette->exists(id, group, &current_color) || (color != *current_color))
+    if (!palette->exists(id, group, &current_color) || (color != *current_color))
     {
-        m_palette->set(id, group, color);
+        if (palette.use_count() > 1)
+            palette = std::make_shared<Palette>(*palette);
+        palette->set(id, group, color);
         damage();
     }
 }
@@ -581,28 +949,30 @@ Image* Widget::background(bool allow_fallback) const
 
 Image* Widget::background(Palette::GroupId group, bool allow_fallback) const
 {
-    return m_backgrounds.get(group, allow_fallback);
+    if (!m_extra)
+        return nullptr;
+    return m_extra->backgrounds.get(group, allow_fallback);
 }
 
 void Widget::background(const Image& image,
                         Palette::GroupId group)
 {
-    m_backgrounds.set(group, image);
+    extra().backgrounds.set(group, image);
     if (group == this->group())
         damage();
 }
 
 void Widget::reset_background(Palette::GroupId group)
 {
-    auto changed = m_backgrounds.reset(group);
+    auto changed = m_extra && m_extra->backgrounds.reset(group);
     if (changed && group == this->group())
         damage();
 }
 
 const Palette& Widget::palette() const
 {
-    if (m_palette)
-        return *m_palette;
+    if (has_palette())
+        return *m_extra->palette;
 
     if (parent())
         return parent()->palette();
@@ -642,6 +1012,47 @@ Point Widget::to_parent(const Point& r) const
     return r;
 }
 
+Rect Widget::unobscured_rect(Rect rect) const
+{
+    const Widget* widget = this;
+    while (!widget->has_screen())
+    {
+        const auto parent = widget->parent();
+        if (!parent || !detail::float_equal(parent->alpha(), 1.f) ||
+            parent->cache_subtree() ||
+            (parent->m_extra && parent->m_extra->backdrop))
+            return {};
+
+        // same origin change as damage going up to the parent
+        rect += parent->point_from_subordinate(*widget);
+        if (!parent->content_area().contains(rect))
+            return {};
+
+        const auto& subordinates = parent->m_subordinates;
+        auto i = std::find_if(subordinates.begin(), subordinates.end(),
+                              [widget](const auto & ptr) { return ptr.get() == widget; });
+        if (i == subordinates.end())
+            return {};
+
+        // anything drawn after the widget may cover it
+        for (++i; i != subordinates.end(); ++i)
+        {
+            const auto& subordinate = *i;
+            if (!subordinate->visible() || subordinate->plane_window())
+                continue;
+
+            const auto r = subordinate->box() +
+                           parent->point_from_subordinate(*subordinate);
+            if (!Rect::intersection(r, rect).empty())
+                return {};
+        }
+
+        widget = parent;
+    }
+
+    return rect;
+}
+
 DisplayPoint Widget::display_origin()
 {
     DisplayPoint p(x(), y());
@@ -665,6 +1076,48 @@ Size Widget::min_size_hint() const
             static_cast<DefaultDim>(moat() * 2.)};
 }
 
+/// Generation of all cached size hints, never 0.
+static uint32_t size_hint_generation = 1;
+
+Size Widget::cached_min_size_hint() const
+{
+    if (m_size_hint_generation != size_hint_generation)
+    {
+        Profiler::instance().size_hint();
+        m_size_hint = min_size_hint();
+        m_size_hint_generation = size_hint_generation;
+    }
+
+    return m_size_hint;
+}
+
+void Widget::invalidate_size_hint()
+{
+    detail::LayoutCache::changed();
+
+    // a parent may use the hint of any widget below it, cached or not, so
+    // the whole chain is walked
+    for (auto w = this; w; w = w->m_parent)
+        w->m_size_hint_generation = 0;
+}
+
+void Widget::invalidate_all_size_hints()
+{
+    detail::LayoutCache::changed();
+
+    if (++size_hint_generation == 0)
+        size_hint_generation = 1;
+}
+
+void Widget::invalidate_subordinate_size_hints()
+{
+    for (auto& subordinate : m_subordinates)
+    {
+        subordinate->m_size_hint_generation = 0;
+        subordinate->invalidate_subordinate_size_hints();
+    }
+}
+
 void Widget::paint(Painter& painter)
 {
     Painter::AutoSaveRestore sr(painter);
@@ -677,7 +1130,6 @@ void Widget::paint(Painter& painter)
 
 void Widget::paint_to_file(const std::string& filename)
 {
-#if CAIRO_HAS_PNG_FUNCTIONS == 1
     std::string name = filename;
     if (name.empty())
         name = fmt::format("{}.png", this->name());
@@ -691,11 +1143,9 @@ void Widget::paint_to_file(const std::string& filename)
 
     Painter painter(cr);
     paint(painter);
-    cairo_surface_write_to_png(surface.get(), name.c_str());
-#else
-    detail::ignoreparam(filename);
-    detail::error("png support not available");
-#endif
+    cairo_surface_flush(surface.get());
+    if (!detail::write_png(name, surface, Application::SnapshotOptions().level))
+        detail::warn("unable to write {}", name);
 }
 
 void Widget::walk(const WalkCallback& callback, int level)
@@ -774,13 +1224,10 @@ void Widget::zorder_down(const Widget* widget)
         auto to = std::prev(i);
         (*i)->damage();
         (*to)->damage();
+        detail::FocusChain::detach(**i);
         std::iter_swap(i, to);
-        if (to == begin)
-        {
-            if (widget->component())
-                m_components_begin = to;
-            update_subordinates_ranges();
-        }
+        detail::FocusChain::attach(**to);
+        subordinates_changed();
         layout();
     }
 }
@@ -803,13 +1250,10 @@ void Widget::zorder_up(const Widget* widget)
         {
             (*i)->damage();
             (*to)->damage();
+            detail::FocusChain::detach(**i);
             std::iter_swap(i, to);
-            if (i == begin)
-            {
-                if (widget->component())
-                    m_components_begin = i;
-                update_subordinates_ranges();
-            }
+            detail::FocusChain::attach(**to);
+            subordinates_changed();
             layout();
         }
     }
@@ -832,10 +1276,10 @@ void Widget::zorder_bottom(const Widget* widget)
 
     if (i != end && i != begin)
     {
-        m_subordinates.splice(begin, m_subordinates, i, std::next(i));
-        if (widget->component())
-            m_components_begin = i;
-        update_subordinates_ranges();
+        detail::FocusChain::detach(**i);
+        std::rotate(begin, i, std::next(i));
+        detail::FocusChain::attach(**begin);
+        subordinates_changed();
         layout();
     }
 }
@@ -856,13 +1300,10 @@ void Widget::zorder_top(const Widget* widget)
     });
     if (i != end && i != std::prev(end))
     {
-        m_subordinates.splice(end, m_subordinates, i, std::next(i));
-        if (i == begin)
-        {
-            if (widget->component())
-                m_components_begin = std::next(i);
-            update_subordinates_ranges();
-        }
+        detail::FocusChain::detach(**i);
+        std::rotate(i, std::next(i), end);
+        detail::FocusChain::attach(**std::prev(end));
+        subordinates_changed();
         layout();
     }
 }
@@ -900,16 +1341,13 @@ void Widget::zorder(const Widget* widget, size_t rank)
         if (rank != old_rank)
         {
             auto j = std::next(begin, rank);
+            detail::FocusChain::detach(**i);
             if (rank > old_rank)
-                std::advance(j, 1);
-
-            m_subordinates.splice(j, m_subordinates, i, std::next(i));
-            if (i == begin || j == begin)
-            {
-                if (widget->component())
-                    m_components_begin = i;
-                update_subordinates_ranges();
-            }
+                std::rotate(i, std::next(i), std::next(j));
+            else
+                std::rotate(j, i, std::next(i));
+            detail::FocusChain::attach(**j);
+            subordinates_changed();
             layout();
         }
     }
@@ -949,6 +1387,8 @@ Rect Widget::content_area() const
 
 void Widget::layout()
 {
+    Profiler::Scope scope(Profiler::Phase::layout);
+
     if (m_subordinates.empty())
     {
         if (!flags().is_set(Widget::Flag::no_autoresize))
@@ -956,8 +1396,11 @@ void Widget::layout()
             m_in_layout = true;
             // cppcheck-suppress unreadVariable
             auto reset = detail::on_scope_exit([this]() { m_in_layout = false; });
+            auto& diagnostics = detail::DrawDiagnostics::instance();
+            if (egt_unlikely(diagnostics.enabled()))
+                diagnostics.laid_out(*this);
             auto s = size();
-            auto m = min_size_hint();
+            auto m = cached_min_size_hint();
             if (s.width() < m.width())
                 s.width(m.width());
             if (s.height() < m.height())
@@ -979,16 +1422,26 @@ void Widget::layout()
 
         m_in_layout = true;
         auto reset = detail::on_scope_exit([this]() { m_in_layout = false; });
+        auto& diagnostics = detail::DrawDiagnostics::instance();
+        if (egt_unlikely(diagnostics.enabled()))
+            diagnostics.laid_out(*this);
 
         auto area = content_area();
 
-        for (auto& subordinate : m_subordinates)
+        // a layout may add or remove subordinates
+        for (size_t index = 0; index < m_subordinates.size(); ++index)
         {
             auto bounding = to_subordinate(area);
             if (bounding.empty())
                 continue;
 
-            subordinate->layout();
+            auto subordinate = m_subordinates[index].get();
+
+            // left pending instead, see defer_subordinate_layout()
+            if (defer_subordinate_layout(*subordinate))
+                subordinate->m_layout_dirty = true;
+            else
+                subordinate->layout();
 
             auto r = detail::align_algorithm(subordinate->box(),
                                              bounding,
@@ -1011,7 +1464,7 @@ void Widget::checked(bool value)
             flags().set(Widget::Flag::checked);
         else
             flags().clear(Widget::Flag::checked);
-        damage();
+        damage_state();
     }
 }
 
@@ -1035,7 +1488,7 @@ std::string Widget::type() const
 
 void Widget::init(void)
 {
-    m_components_begin = m_subordinates.begin();
+    m_children_count = 0;
     update_subordinates_ranges();
 
     m_align.on_change([this]()
@@ -1097,18 +1550,20 @@ void Widget::serialize(Serializer& serializer) const
         serializer.add_property("ratio:vertical", vertical_ratio());
     if (!fill_flags().empty())
         serializer.add_property("fillflags", fill_flags().to_string());
-    if (m_font)
-        m_font->serialize("font", serializer);
+    if (!m_extra)
+        return;
+    if (m_extra->font)
+        m_extra->font->serialize("font", serializer);
     /**
-     * widget color can be set by theme and using m_palette object.
-     * during draw first m_palette is checked and if m_palette not
+     * widget color can be set by theme and using the palette object.
+     * during draw first the palette is checked and if the palette is not
      * available, then theme is used.
      */
-    if (m_palette)
+    if (m_extra->palette)
     {
-        m_palette->serialize("color", serializer);
+        m_extra->palette->serialize("color", serializer);
     }
-    m_backgrounds.serialize(serializer);
+    m_extra->backgrounds.serialize(serializer);
 }
 
 void Widget::deserialize_leaf(Serializer::Properties& props)
@@ -1136,7 +1591,11 @@ void Widget::deserialize(Serializer::Properties& props)
         auto name = std::get<0>(p);
         auto value = std::get<1>(p);
 
-        if (m_backgrounds.deserialize(name, value))
+        // only background properties, named <group>_bg, allocate the extra state
+        static const std::string bg_suffix = "_bg";
+        if (name.size() > bg_suffix.size() &&
+            !name.compare(name.size() - bg_suffix.size(), bg_suffix.size(), bg_suffix) &&
+            extra().backgrounds.deserialize(name, value))
             return true;
 
         switch (detail::hash(name))
@@ -1212,15 +1671,23 @@ void Widget::deserialize(Serializer::Properties& props)
             break;
         }
         /**
-         * widget color can be set by theme and using m_palette object.
-         * during draw first m_palette is checked and if m_palette not
+         * widget color can be set by theme and using the palette object.
+         * during draw first the palette is checked and if the palette is not
          * available, then theme is used.
          */
         case detail::hash("color"):
         {
-            if (!m_palette)
-                m_palette = std::make_unique<Palette>();
-            m_palette->deserialize(std::get<0>(p), value, std::get<2>(p));
+            auto& palette = extra().palette;
+            if (!palette)
+            {
+                palette = std::make_shared<Palette>();
+                ++palette_overrides;
+            }
+            else if (palette.use_count() > 1)
+            {
+                palette = std::make_shared<Palette>(*palette);
+            }
+            palette->deserialize(std::get<0>(p), value, std::get<2>(p));
             break;
         }
         default:
@@ -1233,6 +1700,9 @@ void Widget::deserialize(Serializer::Properties& props)
 
 Widget::~Widget() noexcept
 {
+    if (has_palette())
+        --palette_overrides;
+
     for (auto& i : components())
         remove_component(i.get());
     detach();
@@ -1243,8 +1713,12 @@ Widget::~Widget() noexcept
     if (detail::keyboard_focus() == this)
         detail::keyboard_focus(nullptr);
 
+    detail::FocusChain::erase(*this);
+
     if (detail::dragged() == this)
         detail::dragged(nullptr);
+
+    detail::VisibilityPolicy::unbind(*this);
 }
 
 void Widget::set_parent(Widget* parent)
@@ -1258,6 +1732,9 @@ void Widget::set_parent(Widget* parent)
         throw std::runtime_error("cannot add a widget to itself");
 
     m_parent = parent;
+    // the font may be inherited from the new parent
+    invalidate_size_hint();
+    invalidate_subordinate_size_hints();
     damage();
 }
 
@@ -1270,6 +1747,22 @@ bool Widget::parent_in_layout()
 }
 
 void Widget::parent_layout()
+{
+    // whatever asks the parent to lay out again may change the size hint
+    invalidate_size_hint();
+    relayout_parent();
+}
+
+void Widget::parent_layout_if_hint_changed()
+{
+    if (m_size_hint_generation == size_hint_generation &&
+        min_size_hint() == m_size_hint)
+        return;
+
+    parent_layout();
+}
+
+void Widget::relayout_parent()
 {
     if (!visible())
         return;
@@ -1278,7 +1771,114 @@ void Widget::parent_layout()
         return;
 
     if (parent())
-        parent()->layout();
+        parent()->request_layout();
+}
+
+void Widget::request_layout()
+{
+    detail::LayoutCache::changed();
+
+    if (!Application::check_instance() ||
+        !Application::instance().event().deferred_layout())
+    {
+        layout();
+        return;
+    }
+
+    // same as layout(), which is ignored while the widget performs layout
+    if (m_in_layout || m_layout_dirty)
+        return;
+
+    m_layout_dirty = true;
+    parent_layout_pending();
+}
+
+void Widget::parent_layout_pending()
+{
+    for (auto p = m_parent; p && !p->m_child_layout_dirty; p = p->m_parent)
+        p->m_child_layout_dirty = true;
+
+    if (Application::check_instance())
+        Application::instance().event().request_frame();
+}
+
+void Widget::flush_layout()
+{
+    // laying out the widget also lays out its children, children still
+    // marked after that are handled below
+    if (m_layout_dirty)
+    {
+        m_layout_dirty = false;
+        layout();
+    }
+
+    if (m_child_layout_dirty)
+    {
+        m_child_layout_dirty = false;
+        for (auto& subordinate : m_subordinates)
+        {
+            if (subordinate->layout_pending() &&
+                !defer_subordinate_layout(*subordinate))
+                subordinate->flush_layout();
+        }
+    }
+}
+
+const detail::RectBatch* Widget::subordinate_boxes(bool hit)
+{
+    // a few boxes are as fast to test one at a time
+    if (m_subordinates.size() < 8)
+        return nullptr;
+
+    auto& cache = extra().subordinate_boxes[hit];
+    if (!cache.valid || cache.generation != subordinates_generation())
+    {
+        cache.boxes.clear();
+        cache.boxes.reserve(m_subordinates.size());
+        for (auto& subordinate : m_subordinates)
+        {
+            if (hit)
+                cache.boxes.push_back(subordinate->box() +
+                                      (point_from_subordinate(*subordinate) - point()));
+            else
+                cache.boxes.push_back(subordinate->box());
+        }
+
+        cache.generation = subordinates_generation();
+        cache.valid = true;
+    }
+
+    return &cache.boxes;
+}
+
+Widget* Widget::subordinate_at(const Point& point)
+{
+    const auto boxes = subordinate_boxes(true);
+    if (boxes)
+    {
+        for (auto i = boxes->last_hit(point); i != detail::RectBatch::npos;
+             i = boxes->last_hit(point, i))
+        {
+            if (m_subordinates[i]->can_handle_event())
+                return m_subordinates[i].get();
+        }
+
+        return nullptr;
+    }
+
+    const auto p = point + this->point();
+
+    for (auto& subordinate : detail::reverse_iterate(m_subordinates))
+    {
+        if (!subordinate->can_handle_event())
+            continue;
+
+        const auto p2 = p - point_from_subordinate(*subordinate);
+        if (subordinate->box().intersect(p2))
+            return subordinate.get();
+    }
+
+    return nullptr;
 }
 
 DisplayPoint Widget::local_to_display(const Point& p) const
@@ -1316,8 +1916,8 @@ Point Widget::display_to_local(const DisplayPoint& p) const
 
 const Font& Widget::font() const
 {
-    if (m_font)
-        return *m_font;
+    if (has_font())
+        return *m_extra->font;
 
     if (parent())
         return parent()->font();
@@ -1328,17 +1928,140 @@ const Font& Widget::font() const
     return global_theme().font();
 }
 
+void Widget::font(const Font& font)
+{
+    if (has_font() && *m_extra->font == font)
+        return;
+
+    extra().font = std::make_shared<Font>(font);
+    invalidate_subordinate_size_hints();
+    damage();
+    layout();
+    parent_layout();
+}
+
+void Widget::reset_font()
+{
+    if (has_font())
+    {
+        m_extra->font.reset();
+        invalidate_subordinate_size_hints();
+        damage();
+        layout();
+        parent_layout();
+    }
+}
+
+bool Widget::has_font() const
+{
+    return m_extra && m_extra->font;
+}
+
+void Widget::share_style(const Widget& widget)
+{
+    if (!widget.m_extra || (!widget.m_extra->palette && !widget.m_extra->font))
+        return;
+
+    auto& mine = extra();
+    if (widget.m_extra->palette && widget.m_extra->palette != mine.palette)
+    {
+        if (!mine.palette)
+            ++palette_overrides;
+        mine.palette = widget.m_extra->palette;
+        damage();
+    }
+
+    if (widget.m_extra->font && widget.m_extra->font != mine.font)
+    {
+        mine.font = widget.m_extra->font;
+        invalidate_subordinate_size_hints();
+        damage();
+        layout();
+        parent_layout();
+    }
+}
+
+bool Widget::resize_font()
+{
+    if (!has_font())
+        return false;
+
+    m_extra->font->on_screen_resized();
+    return true;
+}
+
 void Widget::on_screen_resized()
 {
-    if (m_font)
+    if (resize_font())
     {
-        m_font->on_screen_resized();
         damage();
         layout();
         parent_layout();
     }
 }
 
+/**
+ * Remove the part of rect covered by opaque.
+ *
+ * Only the cases where what is left is still a single rectangle are handled,
+ * otherwise rect is returned unchanged.
+ */
+static Rect occlude(const Rect& rect, const Rect& opaque)
+{
+    if (Rect::intersection(rect, opaque).empty())
+        return rect;
+
+    const auto covers_x = opaque.left() <= rect.left() && opaque.right() >= rect.right();
+    const auto covers_y = opaque.top() <= rect.top() && opaque.bottom() >= rect.bottom();
+
+    if (covers_x && covers_y)
+        return {};
+
+    if (covers_x)
+    {
+        if (opaque.top() <= rect.top())
+            return {rect.left(), opaque.bottom(), rect.width(), rect.bottom() - opaque.bottom()};
+        if (opaque.bottom() >= rect.bottom())
+            return {rect.left(), rect.top(), rect.width(), opaque.top() - rect.top()};
+    }
+    else if (covers_y)
+    {
+        if (opaque.left() <= rect.left())
+            return {opaque.right(), rect.top(), rect.right() - opaque.right(), rect.height()};
+        if (opaque.right() >= rect.right())
+            return {rect.left(), rect.top(), opaque.left() - rect.left(), rect.height()};
+    }
+
+    return rect;
+}
+
+Rect Widget::opaque_rect() const
+{
+    if (!visible() || plane_window() || !detail::float_equal(alpha(), 1.f))
+        return {};
+
+    if (!fill_flags().is_set(Theme::FillFlag::solid) || border_radius() > 0 ||
+        border_flags().is_set(Theme::BorderFlag::drop_shadow) ||
+        background(group(), true))
+        return {};
+
+    const auto& bg = color(Palette::ColorId::bg, group());
+    if (bg.type() != Pattern::Type::solid || bg.solid().alpha() != 255)
+        return {};
+
+    if (border())
+    {
+        const auto& border = color(Palette::ColorId::border, group());
+        if (border.type() != Pattern::Type::solid || border.solid().alpha() != 255)
+            return {};
+    }
+
+    auto r = box();
+    r += Point(margin(), margin());
+    r -= Size(2 * margin(), 2 * margin());
+    return r;
+}
+
 void Widget::draw(Painter& painter, const Rect& rect)
 {
     EGTLOG_TRACE("{} draw {}", name(), rect);
@@ -1354,53 +2077,126 @@ void Widget::draw(Painter& painter, const Rect& rect)
         painter.clip();
     }
 
+    // if this widget does not have a screen, it means the damage rect is in
+    // coordinates of some parent widget, so we have to adjust the physical origin
+    // and take it into account when looking at children, who's coordinates are
+    // respective of this widget
+    const auto origin = has_screen() ? Point() : point();
+
+    // child rect, kept inside our content area
+    auto crect = Rect::intersection(rect - origin, to_subordinate(content_area()));
+
+    // With a backdrop, the widget and the subordinates under its owner are
+    // painted from the snapshot, unless the snapshot is being rendered.
+    size_t first = 0;
+    size_t last = m_subordinates.size();
+    const Widget* backdrop_owner = nullptr;
+    if (m_extra && m_extra->backdrop)
+    {
+        const auto owner = m_extra->backdrop->owner;
+        auto i = std::find_if(m_subordinates.begin(), m_subordinates.end(),
+                              [owner](const auto & ptr) { return ptr.get() == owner; });
+        if (i == m_subordinates.end())
+        {
+            m_extra->backdrop.reset();
+        }
+        else if ((*i)->visible())
+        {
+            const auto index = static_cast<size_t>(i - m_subordinates.begin());
+            if (m_extra->backdrop->rendering)
+            {
+                last = index;
+            }
+            else
+            {
+                first = index;
+                backdrop_owner = owner;
+            }
+        }
+    }
+
+    // with many subordinates, the ones outside of the rect are culled in a
+    // batch instead of one at a time
+    std::vector<uint8_t> inside;
+    const auto boxes = subordinate_boxes(false);
+    if (boxes)
+        boxes->intersect(crect, inside);
+
+    // What each child covers, in child coordinates, so nothing underneath it
+    // is drawn.  Without clipping, children may draw outside of the damage
+    // rect so nothing is culled.
+    std::vector<Rect> opaque;
+    auto box_rect = rect;
+    if (clip())
+    {
+        for (auto index = first; index < last; ++index)
+        {
+            if (!inside.empty() && !inside[index])
+                continue;
+
+            const auto r = Rect::intersection(m_subordinates[index]->opaque_rect(), crect);
+            if (!r.empty())
+            {
+                if (opaque.empty())
+                    opaque.resize(m_subordinates.size());
+                opaque[index] = r;
+                box_rect = occlude(box_rect, r + origin);
+            }
+        }
+    }
+
+    if (backdrop_owner)
+    {
+        if (!box_rect.empty())
+            draw_backdrop(painter, box_rect, *backdrop_owner);
+    }
     // draw our widget box, but now that the physical origin has possibly changed
     // and our box() is relative to our parent, we have to adjust to our local
     // origin
-    if (!fill_flags().empty() || border())
+    else if (!box_rect.empty())
     {
-        draw_box(painter, Palette::ColorId::bg, Palette::ColorId::border);
-    }
-    else if (Application::instance().is_composer())
-    {
-        constexpr static Color composer_border = Palette::black;
-        constexpr static Color composer_bg = Color(0x00000020);
+        Painter::AutoSaveRestore sr2(painter);
+
+        if (box_rect != rect)
+        {
+            painter.draw(box_rect);
+            painter.clip();
+        }
 
-        theme().draw_box(painter,
-        {Theme::FillFlag::blend},
-        box(),
-        composer_border,
-        composer_bg,
-        1,
-        0,
-        0,
-        {});
+        if (!fill_flags().empty() || border())
+        {
+            draw_box(painter, Palette::ColorId::bg, Palette::ColorId::border);
+        }
+        else if (Application::instance().is_composer())
+        {
+            constexpr static Color composer_border = Palette::black;
+            constexpr static Color composer_bg = Color(0x00000020);
+
+            theme().draw_box(painter,
+            {Theme::FillFlag::blend},
+            box(),
+            composer_border,
+            composer_bg,
+            1,
+            0,
+            0,
+            {});
+        }
     }
 
     if (m_subordinates.empty())
         return;
 
-    // child rect
-    auto crect = rect;
-
-    // if this widget does not have a screen, it means the damage rect is in
-    // coordinates of some parent widget, so we have to adjust the physical origin
-    // and take it into account when looking at children, who's coordinates are
-    // respective of this widget
     if (!has_screen())
-    {
-        const auto& origin = point();
         painter.translate(origin);
 
-        // adjust our child rect for comparison's below
-        crect -= origin;
-    }
+    for (auto current = first; current < last; ++current)
+    {
+        if (!inside.empty() && !inside[current])
+            continue;
 
-    // keep the crect inside our content area
-    crect = Rect::intersection(crect, to_subordinate(content_area()));
+        const auto& subordinate = m_subordinates[current];
 
-    for (auto& subordinate : m_subordinates)
-    {
         if (!subordinate->visible())
             continue;
 
@@ -1409,7 +2205,19 @@ void Widget::draw(Painter& painter, const Rect& rect)
         if (subordinate->plane_window())
             continue;
 
-        draw_subordinate(painter, crect, subordinate.get());
+        if (opaque.empty())
+        {
+            draw_subordinate(painter, crect, subordinate.get());
+            continue;
+        }
+
+        // remove what is covered by the siblings drawn after this one
+        auto r = Rect::intersection(crect, subordinate->box());
+        for (auto i = current + 1; i < opaque.size() && !r.empty(); ++i)
+            r = occlude(r, opaque[i]);
+
+        if (!r.empty())
+            draw_subordinate(painter, r, subordinate.get());
     }
 }
 
@@ -1447,39 +2255,264 @@ void Widget::draw_subordinate(Painter& painter, const Rect& crect, Widget* subor
                 painter.clip();
             }
 
-            detail::code_timer(time_subordinate_draw_enabled(), subordinate->name() + " draw: ", [subordinate, &painter, &r]()
+            detail::code_timer(time_subordinate_draw_enabled(), [subordinate]() { return subordinate->name() + " draw: "; },
+                               [subordinate, &painter, &r]()
             {
-                subordinate->draw(painter, r);
+                Profiler::Scope scope(Profiler::Phase::draw, subordinate);
+
+                auto& diagnostics = detail::DrawDiagnostics::instance();
+                if (egt_unlikely(diagnostics.enabled()))
+                    diagnostics.drawn(painter, r, *subordinate);
+
+                if (subordinate->cache_subtree())
+                    subordinate->draw_cached(painter, r);
+                else
+                    subordinate->draw(painter, r);
             });
         }
         else
         {
+            Painter::AutoSaveRestore sr2(painter);
+
+            // the child is drawn into a layer that is kept until the child is
+            // damaged, and the layer is painted with the child alpha
+            detail::code_timer(time_subordinate_draw_enabled(), [subordinate]() { return subordinate->name() + " draw: "; },
+                               [subordinate, &painter, &r]()
             {
-                Painter::AutoGroup group(painter);
-
-                // no matter what the child draws, clip the output to only the
-                // rectangle we care about updating
-                if (clip())
-                {
-                    painter.draw(r);
-                    painter.clip();
-                }
-
-                detail::code_timer(time_subordinate_draw_enabled(), subordinate->name() + " draw: ", [subordinate, &painter, &r]()
-                {
-                    subordinate->draw(painter, r);
-                });
-            }
+                Profiler::Scope scope(Profiler::Phase::draw, subordinate);
+
+                auto& diagnostics = detail::DrawDiagnostics::instance();
+                if (egt_unlikely(diagnostics.enabled()))
+                    diagnostics.drawn(painter, r, *subordinate);
 
-            // we pushed a group for the child to draw into it, now paint that
-            // child with its alpha component
-            painter.paint(subordinate->alpha());
+                subordinate->draw_cached(painter, r, subordinate->alpha());
+            });
         }
 
         special_child_draw(painter, subordinate);
     }
 }
 
+bool Widget::thread_safe_subtree(const Rect& rect) const
+{
+    // the subtree cache is rendered by whoever draws the widget first
+    if (!thread_safe_draw() || cache_subtree() ||
+        !detail::float_equal(alpha(), 1.f) ||
+        (m_extra && m_extra->backdrop))
+        return false;
+
+    const auto crect = has_screen() ? rect : rect - point();
+
+    for (const auto& subordinate : m_subordinates)
+    {
+        if (!subordinate->visible() || subordinate->plane_window())
+            continue;
+
+        if (subordinate->box().intersect(crect) &&
+            !subordinate->thread_safe_subtree(crect))
+            return false;
+    }
+
+    return true;
+}
+
+void Widget::draw_cached(Painter& painter, const Rect& rect, float alpha)
+{
+    auto& state = extra();
+    auto& cache = state.subtree_cache;
+    if (!cache ||
+        Painter::surface_to_size(cache) != size())
+    {
+        // resized often while animated, so the old pixels are reused
+        cache = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, size());
+        state.subtree_cache_valid = false;
+    }
+
+    if (!state.subtree_cache_valid)
+    {
+        EGTLOG_TRACE("{} render subtree cache", name());
+
+        auto cr = shared_cairo_t(cairo_create(cache.get()), cairo_destroy);
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_CLEAR);
+        cairo_paint(cr.get());
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_OVER);
+
+        Painter cache_painter(cr);
+        paint(cache_painter);
+        cairo_surface_flush(cache.get());
+        state.subtree_cache_valid = true;
+        state.subtree_cache_damage = {};
+    }
+    else if (!state.subtree_cache_damage.empty())
+    {
+        EGTLOG_TRACE("{} render subtree cache {}", name(), state.subtree_cache_damage);
+
+        // only the damaged part of the cache is drawn again
+        const auto damage = state.subtree_cache_damage;
+        state.subtree_cache_damage = {};
+
+        auto cr = shared_cairo_t(cairo_create(cache.get()), cairo_destroy);
+        cairo_rectangle(cr.get(), damage.x(), damage.y(), damage.width(), damage.height());
+        cairo_clip(cr.get());
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_CLEAR);
+        cairo_paint(cr.get());
+        cairo_set_operator(cr.get(), CAIRO_OPERATOR_OVER);
+
+        Painter cache_painter(cr);
+        cache_painter.translate(-point());
+        draw(cache_painter, damage + point());
+        cairo_surface_flush(cache.get());
+    }
+
+    auto cr = painter.context().get();
+    cairo_set_source_surface(cr, cache.get(), x(), y());
+    cairo_rectangle(cr, rect.x(), rect.y(), rect.width(), rect.height());
+    if (detail::float_equal(alpha, 1.f))
+    {
+        cairo_fill(cr);
+    }
+    else
+    {
+        cairo_clip(cr);
+        cairo_paint_with_alpha(cr, alpha);
+    }
+}
+
+void Widget::backdrop(const Widget& owner, const Color& dim,
+                      DefaultDim blur, DefaultDim shadow)
+{
+    auto& state = extra();
+    if (!state.backdrop)
+        state.backdrop = std::make_unique<detail::Backdrop>();
+
+    auto& backdrop = *state.backdrop;
+    if (backdrop.owner == &owner && backdrop.dim == dim &&
+        backdrop.blur == blur && backdrop.shadow == shadow)
+        return;
+
+    backdrop.owner = &owner;
+    backdrop.dim = dim;
+    backdrop.blur = blur;
+    backdrop.shadow = shadow;
+    backdrop.valid = false;
+    backdrop.shadow_mask.reset();
+    damage();
+}
+
+void Widget::remove_backdrop(const Widget& owner)
+{
+    if (m_extra && m_extra->backdrop && m_extra->backdrop->owner == &owner)
+    {
+        m_extra->backdrop.reset();
+        damage();
+    }
+}
+
+void Widget::draw_backdrop(Painter& painter, const Rect& rect, const Widget& owner)
+{
+    auto& backdrop = *m_extra->backdrop;
+    auto cr = painter.context().get();
+
+    // similar to the target, so painting it is accelerated on a GFX2D surface
+    if (!backdrop.snapshot || backdrop.size != size())
+    {
+        backdrop.snapshot = shared_cairo_surface_t(
+                                cairo_surface_create_similar(cairo_get_target(cr),
+                                        CAIRO_CONTENT_COLOR_ALPHA,
+                                        width(), height()),
+                                cairo_surface_destroy);
+        backdrop.size = size();
+        backdrop.valid = false;
+    }
+
+    const auto origin = has_screen() ? Point() : point();
+    const auto stale = backdrop.valid ? backdrop.damage : Rect({}, size());
+    backdrop.valid = true;
+    backdrop.damage = {};
+
+    if (!stale.empty())
+    {
+        EGTLOG_TRACE("{} render backdrop {}", name(), stale);
+
+        // the blur reads around the stale part, so that is rendered too
+        const auto blur = std::max<DefaultDim>(backdrop.blur, 0);
+        const auto area = Rect::intersection(Rect(stale.point() - Point(blur, blur),
+                                             stale.size() + Size(blur * 2, blur * 2)),
+                                             Rect({}, size()));
+
+        auto layer = detail::surface_pool().acquire(CAIRO_FORMAT_ARGB32, area.size());
+        {
+            backdrop.rendering = true;
+            // cppcheck-suppress unreadVariable
+            auto reset = detail::on_scope_exit([&backdrop]() { backdrop.rendering = false; });
+
+            auto layer_cr = shared_cairo_t(cairo_create(layer.get()), cairo_destroy);
+            Painter layer_painter(layer_cr);
+            layer_painter.translate(-(area.point() + origin));
+            draw(layer_painter, area + origin);
+        }
+        cairo_surface_flush(layer.get());
+
+        if (blur)
+        {
+            detail::box_blur(reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(layer.get())),
+                             cairo_image_surface_get_stride(layer.get()),
+                             area.width(), area.height(), blur);
+            cairo_surface_mark_dirty(layer.get());
+        }
+
+        auto snapshot_cr = shared_cairo_t(cairo_create(backdrop.snapshot.get()), cairo_destroy);
+        cairo_rectangle(snapshot_cr.get(), stale.x(), stale.y(), stale.width(), stale.height());
+        cairo_clip(snapshot_cr.get());
+        cairo_set_operator(snapshot_cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(snapshot_cr.get(), layer.get(), area.x(), area.y());
+        cairo_paint(snapshot_cr.get());
+        cairo_set_operator(snapshot_cr.get(), CAIRO_OPERATOR_OVER);
+        cairo_set_source_rgba(snapshot_cr.get(), backdrop.dim.redf(), backdrop.dim.greenf(),
+                              backdrop.dim.bluef(), backdrop.dim.alphaf());
+        cairo_paint(snapshot_cr.get());
+        cairo_surface_flush(backdrop.snapshot.get());
+    }
+
+    Painter::AutoSaveRestore sr(painter);
+
+    cairo_rectangle(cr, rect.x(), rect.y(), rect.width(), rect.height());
+    cairo_clip(cr);
+    cairo_set_source_surface(cr, backdrop.snapshot.get(), origin.x(), origin.y());
+    cairo_paint(cr);
+
+    // the shadow moves with the owner, so it is painted over the snapshot
+    const auto shadow = backdrop.shadow;
+    if (shadow <= 0 || owner.plane_window())
+        return;
+
+    const auto mask_size = owner.size() + Size(shadow * 2, shadow * 2);
+    if (!backdrop.shadow_mask ||
+        Painter::surface_to_size(backdrop.shadow_mask) != mask_size)
+    {
+        backdrop.shadow_mask = shared_cairo_surface_t(
+                                   cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                           mask_size.width(), mask_size.height()),
+                                   cairo_surface_destroy);
+
+        auto mask_cr = shared_cairo_t(cairo_create(backdrop.shadow_mask.get()), cairo_destroy);
+        cairo_set_source_rgba(mask_cr.get(), 0, 0, 0, 0.5);
+        cairo_rectangle(mask_cr.get(), shadow, shadow, owner.width(), owner.height());
+        cairo_fill(mask_cr.get());
+        cairo_surface_flush(backdrop.shadow_mask.get());
+
+        detail::box_blur(reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(backdrop.shadow_mask.get())),
+                         cairo_image_surface_get_stride(backdrop.shadow_mask.get()),
+                         mask_size.width(), mask_size.height(), shadow / 2);
+        cairo_surface_mark_dirty(backdrop.shadow_mask.get());
+    }
+
+    // a little lower than the owner, as if lit from above
+    const auto p = owner.point() + origin - Point(shadow, shadow / 2);
+    cairo_set_source_surface(cr, backdrop.shadow_mask.get(), p.x(), p.y());
+    cairo_paint(cr);
+}
+
 Point Widget::to_panel(const Point& p)
 {
     if (has_screen())
@@ -1505,10 +2538,9 @@ void Widget::remove_component(Widget* widget)
     {
         // note order here - damage and then unset parent
         (*i)->damage();
+        detail::FocusChain::detach(**i);
         (*i)->m_parent = nullptr;
         (*i)->component(false);
-        if (i == m_components_begin)
-            m_components_begin = std::next(m_components_begin);
         m_subordinates.erase(i);
         update_subordinates_ranges();
     }
@@ -1525,15 +2557,11 @@ void Widget::add_component(Widget& widget)
     // will not delete it.
     auto w = std::shared_ptr<Widget>(&widget, [](Widget*) {});
 
-    bool first_component = components().empty();
-
     w->set_parent(this);
     w->component(true);
     m_subordinates.emplace_back(w);
-
-    if (first_component)
-        m_components_begin = std::prev(m_subordinates.end());
     update_subordinates_ranges();
+    detail::FocusChain::attach(widget);
 }
 
 void Widget::component(bool value)
@@ -10,8 +10,16 @@
 #include "detail/egtlog.h"
 #include "detail/dump.h"
 #include "detail/window/basicwindow.h"
+#include "detail/window/drawpool.h"
+#include "detail/window/planepolicy.h"
 #include "detail/window/planewindow.h"
+#ifdef HAVE_WAYLAND
+#include "detail/window/subsurfacewindow.h"
+#include "egt/detail/screen/waylandscreen.h"
+#endif
+#include "detail/window/tiledamage.h"
 #include "egt/app.h"
+#include "egt/detail/drawdiagnostics.h"
 #include "egt/detail/math.h"
 #include "egt/detail/meta.h"
 #include "egt/detail/screen/kmsscreen.h"
@@ -19,8 +27,10 @@
 #include "egt/input.h"
 #include "egt/label.h"
 #include "egt/painter.h"
+#include "egt/profiler.h"
 #include "egt/window.h"
 #include <algorithm>
+#include <cstring>
 
 #ifdef SRCDIR
 EGT_EMBED(internal_cursor, SRCDIR "/icons/16px/cursor.png")
@@ -39,7 +49,7 @@ Window::Window(const Rect& rect,
 // by default, windows are hidden
     : Frame(rect, {Widget::Flag::window, Widget::Flag::invisible})
 {
-    name("Window" + std::to_string(m_widgetid));
+    default_name("Window", m_widgetid);
 
     // windows are not transparent by default
     fill_flags(Theme::FillFlag::solid);
@@ -95,6 +105,8 @@ Window::Window(Frame& parent,
 
 void Window::damage(const Rect& rect)
 {
+    m_damaged = true;
+
     if (m_impl)
         m_impl->damage(rect);
 }
@@ -113,13 +125,30 @@ bool Window::has_screen() const
     return false;
 }
 
+void Window::output(Screen& screen)
+{
+    if (parent() || Application::instance().m_main_window == this)
+        throw std::runtime_error("only a window without a parent can change output");
+
+    m_impl = std::make_unique<detail::BasicWindow>(this, &screen);
+    flags().clear(Widget::Flag::plane_window);
+    m_auto_plane = false;
+    m_box = screen.box();
+    m_user_requested_box = m_box;
+
+    parent_layout();
+    damage();
+}
+
 void Window::move(const Point& point)
 {
     if (point != box().point())
     {
         if (m_impl)
         {
+            damage_shadow();
             m_impl->move(point);
+            damage_shadow();
             if (!parent_in_layout())
                 m_user_requested_box.point(m_box.point());
         }
@@ -132,12 +161,56 @@ void Window::show()
 {
     if (m_impl)
         m_impl->show();
+
+    update_backdrop();
 }
 
 void Window::hide()
 {
     if (m_impl)
         m_impl->hide();
+
+    update_backdrop();
+}
+
+void Window::backdrop(const Color& dim, DefaultDim blur, DefaultDim shadow)
+{
+    damage_shadow();
+
+    m_backdrop_dim = dim;
+    m_backdrop_blur = blur;
+    m_backdrop_shadow = shadow;
+
+    update_backdrop();
+}
+
+void Window::set_parent(Widget* parent)
+{
+    Frame::set_parent(parent);
+
+    update_backdrop();
+}
+
+void Window::update_backdrop()
+{
+    Widget* p = parent();
+    if (!p)
+        return;
+
+    if (visible() && backdrop())
+        p->backdrop(*this, m_backdrop_dim, m_backdrop_blur, m_backdrop_shadow);
+    else
+        p->remove_backdrop(*this);
+}
+
+void Window::damage_shadow()
+{
+    if (m_backdrop_shadow <= 0 || !visible() || !parent() || plane_window())
+        return;
+
+    // the parent draws the shadow, but it does not change what is under it
+    const auto s = m_backdrop_shadow;
+    damage(Rect(box().point() - Point(s, s), box().size() + Size(s * 2, s * 2)));
 }
 
 void Window::paint(Painter& painter)
@@ -173,29 +246,401 @@ static inline bool time_child_draw_enabled()
     return value == 1;
 }
 
+void Window::add_damage(const Rect& rect)
+{
+    // with the frame clock, damage is drawn on the next frame
+    if (!rect.empty() && Application::check_instance())
+        Application::instance().event().request_frame();
+
+    if (!m_tile_damage)
+    {
+        Frame::add_damage(rect);
+        return;
+    }
+
+    if (egt_unlikely(rect.empty()))
+        return;
+
+    // not allowed to damage() in draw()
+    assert(!m_in_draw);
+    if (m_in_draw)
+        return;
+
+    EGTLOG_TRACE("{} damage:{}", name(), rect);
+
+    m_tile_damage->resize(size());
+    m_tile_damage->damage(Rect::intersection(rect, to_subordinate(box())));
+}
+
+void Window::damage_tiles(const Size& tile)
+{
+    if (tile.empty())
+    {
+        if (m_tile_damage)
+        {
+            m_tile_damage->extract(m_damage);
+            m_tile_damage.reset();
+        }
+        return;
+    }
+
+    if (m_tile_damage && m_tile_damage->tile() == tile)
+        return;
+
+    auto tiles = std::make_unique<detail::TileDamage>(size(), tile);
+    for (const auto& rect : m_damage)
+        tiles->damage(rect);
+    m_damage.clear();
+
+    if (m_tile_damage)
+    {
+        Screen::DamageArray pending;
+        m_tile_damage->extract(pending);
+        for (const auto& rect : pending)
+            tiles->damage(rect);
+    }
+
+    m_tile_damage = std::move(tiles);
+}
+
+Size Window::damage_tiles() const
+{
+    if (m_tile_damage)
+        return m_tile_damage->tile();
+    return {};
+}
+
 void Window::do_draw()
 {
+    if (m_tile_damage)
+        m_tile_damage->extract(m_damage);
+
+    if (!m_occluders.empty())
+        occlude_damage();
+
     if (m_damage.empty())
         return;
 
+    // keep the damage until the display catches up, instead of blocking
+    if (!screen()->flip_ready())
+    {
+        if (Application::check_instance())
+            Application::instance().event().request_frame();
+        return;
+    }
+
     // bookkeeping to make sure we don't damage() in draw()
     m_in_draw = true;
     auto reset = detail::on_scope_exit([this]() { m_in_draw = false; });
 
     EGTLOG_TRACE("{} do draw", name());
 
-    detail::code_timer(time_child_draw_enabled(), name() + " draw: ", [this]()
+    detail::code_timer(time_child_draw_enabled(), [this]() { return name() + " draw: "; }, [this]()
     {
+        Profiler::Scope scope(Profiler::Phase::draw, this);
+
+        // when drawing directly to a screen buffer, it may hold stale content
+        screen()->add_buffer_damage(m_damage);
+
+        Screen::DamageArray moved;
+        move_scrolled(moved);
+
         Painter painter(screen()->context());
 
+        auto& diagnostics = detail::DrawDiagnostics::instance();
+        const auto diagnose = diagnostics.enabled();
+        if (egt_unlikely(diagnose))
+            diagnostics.begin_draw(*screen());
+
         for (auto& damage : m_damage)
-            draw(painter, damage);
+        {
+            if (egt_unlikely(diagnose))
+                diagnostics.drawn(painter, damage, *this);
+
+            if (!m_parallel_draw || !draw_bands(painter, damage))
+                draw(painter, damage);
+        }
 
-        screen()->flip(m_damage);
+        if (egt_unlikely(diagnose))
+            diagnostics.end_draw(*screen());
+
+        if (moved.empty())
+        {
+            screen()->flip(m_damage);
+        }
+        else
+        {
+            for (const auto& rect : m_damage)
+                screen()->add_damage(moved, rect);
+            screen()->flip(moved);
+        }
         m_damage.clear();
     });
 }
 
+/**
+ * Add the parts of rect outside of hole to the array, as up to four
+ * rectangles.
+ */
+static void subtract(const Rect& rect, const Rect& hole, Screen::DamageArray& result)
+{
+    const auto covered = Rect::intersection(rect, hole);
+    if (covered.empty())
+    {
+        result.push_back(rect);
+        return;
+    }
+
+    // bands above and below the hole, then the sides next to it
+    if (covered.top() > rect.top())
+        result.emplace_back(rect.left(), rect.top(), rect.width(), covered.top() - rect.top());
+    if (covered.bottom() < rect.bottom())
+        result.emplace_back(rect.left(), covered.bottom(), rect.width(), rect.bottom() - covered.bottom());
+    if (covered.left() > rect.left())
+        result.emplace_back(rect.left(), covered.top(), covered.left() - rect.left(), covered.height());
+    if (covered.right() < rect.right())
+        result.emplace_back(covered.right(), covered.top(), rect.right() - covered.right(), covered.height());
+}
+
+void Window::occlude_damage()
+{
+    Screen::DamageArray visible;
+    for (const auto& occluder : m_occluders)
+    {
+        for (const auto& rect : m_damage)
+        {
+            const auto covered = Rect::intersection(rect, occluder);
+            if (!covered.empty())
+                Screen::damage_algorithm(m_occluded, covered);
+
+            subtract(rect, occluder, visible);
+        }
+
+        m_damage.swap(visible);
+        visible.clear();
+    }
+}
+
+static bool identity_matrix(cairo_t* cr)
+{
+    cairo_matrix_t matrix;
+    cairo_get_matrix(cr, &matrix);
+    return matrix.xx == 1. && matrix.yx == 0. && matrix.xy == 0. &&
+           matrix.yy == 1. && matrix.x0 == 0. && matrix.y0 == 0.;
+}
+
+/*
+ * Move the pixels of a rectangle of the target of a context by delta, clipped
+ * to the rectangle.
+ */
+static bool move_pixels(cairo_t* cr, const Rect& rect, const Point& delta)
+{
+    if (!identity_matrix(cr))
+        return false;
+
+    // the part of the rectangle still covered once moved, and where it comes from
+    const auto dst = Rect::intersection(rect + delta, rect);
+    const auto src = dst - delta;
+    if (dst.empty())
+        return false;
+
+    auto target = cairo_get_target(cr);
+    if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE)
+    {
+        // i.e. a GFX2D surface, where a copy to another surface is accelerated
+        auto copy = shared_cairo_surface_t(
+                        cairo_surface_create_similar(target,
+                                cairo_surface_get_content(target),
+                                dst.width(), dst.height()),
+                        cairo_surface_destroy);
+        auto copy_cr = shared_cairo_t(cairo_create(copy.get()), cairo_destroy);
+        cairo_set_operator(copy_cr.get(), CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(copy_cr.get(), target, -src.x(), -src.y());
+        cairo_paint(copy_cr.get());
+
+        cairo_save(cr);
+        cairo_reset_clip(cr);
+        cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+        cairo_set_source_surface(cr, copy.get(), dst.x(), dst.y());
+        cairo_rectangle(cr, dst.x(), dst.y(), dst.width(), dst.height());
+        cairo_fill(cr);
+        cairo_restore(cr);
+        return true;
+    }
+
+    const auto width = cairo_image_surface_get_width(target);
+    if (!Rect(0, 0, width, cairo_image_surface_get_height(target)).contains(rect))
+        return false;
+
+    size_t bpp;
+    switch (cairo_image_surface_get_format(target))
+    {
+    case CAIRO_FORMAT_ARGB32:
+    case CAIRO_FORMAT_RGB24:
+    case CAIRO_FORMAT_RGB30:
+        bpp = 4;
+        break;
+    case CAIRO_FORMAT_RGB16_565:
+        bpp = 2;
+        break;
+    case CAIRO_FORMAT_A8:
+        bpp = 1;
+        break;
+    default:
+        return false;
+    }
+
+    cairo_surface_flush(target);
+
+    const auto data = cairo_image_surface_get_data(target);
+    const auto stride = cairo_image_surface_get_stride(target);
+    const auto row = [&](const Rect & r, DefaultDim y)
+    {
+        return data + (r.y() + y) * stride + r.x() * bpp;
+    };
+
+    // rows are copied in the order that does not overwrite the ones to copy
+    if (delta.y() > 0)
+    {
+        for (auto y = dst.height() - 1; y >= 0; --y)
+            std::memmove(row(dst, y), row(src, y), dst.width() * bpp);
+    }
+    else
+    {
+        for (DefaultDim y = 0; y < dst.height(); ++y)
+            std::memmove(row(dst, y), row(src, y), dst.width() * bpp);
+    }
+
+    cairo_surface_mark_dirty_rectangle(target, dst.x(), dst.y(),
+                                       dst.width(), dst.height());
+
+    return true;
+}
+
+void Window::scroll(const Rect& rect, const Point& delta)
+{
+    if (!visible() || delta == Point())
+        return;
+
+    const auto r = Rect::intersection(rect, to_subordinate(box()));
+    if (r.empty())
+        return;
+
+    // composed windows only, where the screen buffer is kept between frames
+    if (!has_screen() || plane_window() || screen()->zero_copy() ||
+        std::abs(delta.x()) >= r.width() || std::abs(delta.y()) >= r.height())
+    {
+        damage(r);
+        return;
+    }
+
+    m_scrolls.emplace_back(r, delta);
+
+    // the strips left uncovered
+    if (delta.x() > 0)
+        damage(Rect(r.x(), r.y(), delta.x(), r.height()));
+    else if (delta.x() < 0)
+        damage(Rect(r.right() + delta.x(), r.y(), -delta.x(), r.height()));
+
+    if (delta.y() > 0)
+        damage(Rect(r.x(), r.y(), r.width(), delta.y()));
+    else if (delta.y() < 0)
+        damage(Rect(r.x(), r.bottom() + delta.y(), r.width(), -delta.y()));
+}
+
+void Window::move_scrolled(Screen::DamageArray& moved)
+{
+    if (m_scrolls.empty())
+        return;
+
+    auto cr = screen()->context().get();
+
+    for (const auto& scroll : m_scrolls)
+    {
+        const auto& rect = scroll.first;
+        const auto& delta = scroll.second;
+
+        // damage in the rectangle is not drawn yet, so it is moved too
+        const auto pending = m_damage;
+        for (const auto& damage : pending)
+        {
+            const auto r = Rect::intersection(damage, rect);
+            if (!r.empty())
+                screen()->add_damage(m_damage, Rect::intersection(r + delta, rect));
+        }
+
+        EGTLOG_TRACE("{} scroll {} by {}", name(), rect, delta);
+
+        if (move_pixels(cr, rect, delta))
+            screen()->add_damage(moved, rect);
+        else
+            screen()->add_damage(m_damage, rect);
+    }
+
+    m_scrolls.clear();
+}
+
+bool Window::draw_bands(Painter& painter, const Rect& rect)
+{
+    // bands smaller than this cost more to set up than they save
+    constexpr DefaultDim min_band_height = 32;
+    constexpr DefaultDim min_area = 320 * 240;
+
+    if (rect.area() < min_area)
+        return false;
+
+    auto& pool = detail::DrawPool::instance();
+    const auto bands = std::min<DefaultDim>(pool.size() + 1,
+                                            rect.height() / min_band_height);
+    if (bands < 2)
+        return false;
+
+    auto cr = painter.context().get();
+    auto target = cairo_get_target(cr);
+    if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE)
+        return false;
+
+    // bands are drawn with their own contexts, which only know about rows
+    if (!identity_matrix(cr))
+        return false;
+
+    const auto width = cairo_image_surface_get_width(target);
+    if (!Rect(0, 0, width, cairo_image_surface_get_height(target)).contains(rect))
+        return false;
+
+    if (!thread_safe_subtree(rect))
+        return false;
+
+    cairo_surface_flush(target);
+
+    const auto data = cairo_image_surface_get_data(target);
+    const auto stride = cairo_image_surface_get_stride(target);
+    const auto format = cairo_image_surface_get_format(target);
+
+    EGTLOG_TRACE("{} draw {} in {} bands", name(), rect, bands);
+
+    detail::DrawPool::instance().run(bands, [&](size_t band)
+    {
+        const auto top = rect.y() + rect.height() * static_cast<DefaultDim>(band) / bands;
+        const auto bottom = rect.y() + rect.height() * static_cast<DefaultDim>(band + 1) / bands;
+
+        // the rows of the band, as a surface of their own
+        auto rows = shared_cairo_surface_t(
+                        cairo_image_surface_create_for_data(data + top * stride,
+                                format, width, bottom - top, stride),
+                        cairo_surface_destroy);
+        auto band_cr = shared_cairo_t(cairo_create(rows.get()), cairo_destroy);
+        cairo_translate(band_cr.get(), 0, -top);
+
+        Painter band_painter(band_cr);
+        draw(band_painter, Rect(rect.x(), top, rect.width(), bottom - top));
+    });
+
+    cairo_surface_mark_dirty(target);
+
+    return true;
+}
+
 void Window::resize(const Size& size)
 {
     // cannot resize if we are screen
@@ -205,7 +650,9 @@ void Window::resize(const Size& size)
 
     if (m_impl)
     {
+        damage_shadow();
         m_impl->resize(size);
+        damage_shadow();
         if (!parent_in_layout() && !in_layout())
             m_user_requested_box.size(size);
     }
@@ -221,6 +668,18 @@ void Window::scale(float hscale, float vscale)
         m_impl->scale(hscale, vscale);
 }
 
+#ifdef HAVE_WAYLAND
+/// A plane window of a Wayland window is in a subsurface.
+static std::unique_ptr<detail::WindowImpl> subsurface_window(Window* window)
+{
+    auto screen = dynamic_cast<detail::WaylandScreen*>(Application::instance().screen());
+    if (!screen)
+        return nullptr;
+
+    return std::make_unique<detail::SubsurfaceWindow>(window, *screen);
+}
+#endif
+
 void Window::create_impl(const Rect& rect,
                          PixelFormat format_hint,
                          WindowHint hint)
@@ -262,6 +721,14 @@ void Window::create_impl(const Rect& rect,
                     m_impl = std::make_unique<detail::PlaneWindow>(this, format_hint, hint);
                     flags().set(Widget::Flag::plane_window);
                 }
+#endif
+#ifdef HAVE_WAYLAND
+                if (!m_impl)
+                {
+                    m_impl = subsurface_window(this);
+                    if (m_impl)
+                        flags().set(Widget::Flag::plane_window);
+                }
 #endif
                 break;
             default:
@@ -273,6 +740,13 @@ void Window::create_impl(const Rect& rect,
             EGTLOG_DEBUG("non-fatal exception: {}", e.what());
         }
 
+        if (!m_impl && hint == WindowHint::automatic && detail::PlanePolicy::enabled())
+        {
+            // start composed, and let the policy decide about planes
+            m_impl = std::make_unique<detail::BasicWindow>(this);
+            m_auto_plane = true;
+        }
+
         if (!m_impl)
         {
 #ifdef HAVE_LIBPLANES
@@ -307,6 +781,84 @@ void Window::create_impl(const Rect& rect,
                  plane_window() ? "PlaneWindow" : "BasicWindow");
 }
 
+void Window::animating(bool active)
+{
+    m_animating = active;
+
+    if (!active || plane_window() || m_hint == WindowHint::software)
+        return;
+
+    if (!Application::instance().screen())
+        return;
+
+    if (switch_plane(true))
+    {
+        EGTLOG_DEBUG("{} moved to a plane while animated", name());
+        m_animation_plane = true;
+    }
+}
+
+bool Window::switch_plane(bool enable)
+{
+    if (enable == plane_window())
+        return true;
+
+    if (Application::instance().m_main_window == this)
+        return false;
+
+    std::unique_ptr<detail::WindowImpl> impl;
+    if (enable)
+    {
+        try
+        {
+#ifdef HAVE_LIBPLANES
+            if (Application::instance().screen()->have_planes())
+                impl = std::make_unique<detail::PlaneWindow>(this, m_format_hint, WindowHint::overlay);
+#endif
+#ifdef HAVE_WAYLAND
+            if (!impl)
+                impl = subsurface_window(this);
+#endif
+        }
+        catch (std::exception& e)
+        {
+            EGTLOG_DEBUG("{} no plane available: {}", name(), e.what());
+            return false;
+        }
+
+        if (!impl)
+            return false;
+
+        // the parent no longer composes the window
+        damage();
+    }
+    else
+    {
+        impl = std::make_unique<detail::BasicWindow>(this);
+    }
+
+    m_impl = std::move(impl);
+
+    if (enable)
+    {
+        flags().set(Widget::Flag::plane_window);
+        if (visible())
+            m_impl->show();
+    }
+    else
+    {
+        flags().clear(Widget::Flag::plane_window);
+        m_damage.clear();
+        if (m_tile_damage)
+            m_tile_damage->clear();
+    }
+
+    // draw everything with the new backend
+    damage();
+
+    return true;
+}
+
 void Window::main_window()
 {
     if (!Application::check_instance())
@@ -357,6 +909,10 @@ Window::~Window() noexcept
             Application::instance().m_modal_window = nullptr;
         }
     }
+
+    Widget* p = parent();
+    if (p)
+        p->remove_backdrop(*this);
 }
 
 /**
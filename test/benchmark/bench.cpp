@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <egt/detail/imagecache.h>
+#include <egt/detail/rasterizer.h>
+#include <egt/ui>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+/*
+ * Headless rendering benchmark.
+ *
+ * Every scene runs a fixed number of frames on the in-memory screen backend,
+ * so results are reproducible and can be compared across EGT versions.  For
+ * each scene this reports frames per second, pixels painted per frame, heap
+ * allocations per frame, and the peak RSS of the process so far.  The size of
+ * the objects of common widgets is reported first.
+ *
+ * Usage: bench [--frames N] [--rasterizer NAME] [scene...]
+ *
+ * The scenes run with each rasterizer built in, or only the one given, so
+ * they can be compared.  The in-memory screen is used unless EGT_BACKEND
+ * selects another one, like the screen of the board.
+ *
+ * Scenes are dashboard, listbox, textbox, grid, sizers1, sizers4, sizers8,
+ * gauge, png, and svg.  The sizers scenes relayout nested box sizers of the
+ * given depth.
+ *
+ * Image scenes load icon:battery.png;64 and file:home.svg, so when the icons
+ * are not installed EGT_ICONS_DIRECTORY and EGT_SEARCH_PATH need to point to
+ * them.
+ */
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+struct Bench
+{
+    egt::Application& app;
+    egt::TopWindow& window;
+    int frames;
+    std::vector<std::string> filter;
+
+    /**
+     * Run a scene, calling step before drawing every frame.
+     */
+    void run(const char* name, const std::function<void(int)>& step)
+    {
+        if (!filter.empty() &&
+            std::find(filter.begin(), filter.end(), name) == filter.end())
+            return;
+
+        auto screen = app.screen();
+
+        // draw the scene once, so setup is not measured
+        window.damage();
+        app.event().draw();
+        screen->reset_flip_stats();
+
+        const auto start_allocations = allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (auto frame = 0; frame < frames; ++frame)
+        {
+            step(frame);
+            app.event().draw();
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const auto allocated = allocations.load() - start_allocations;
+        const auto seconds = std::chrono::duration<double>(end - start).count();
+        const auto& stats = screen->flip_stats();
+
+        struct rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+
+        std::printf("%-20s %10.1f %14.0f %12.1f %12ld\n", name,
+                    frames / seconds,
+                    static_cast<double>(stats.copied_pixels) / frames,
+                    static_cast<double>(allocated) / frames,
+                    usage.ru_maxrss);
+    }
+};
+
+static void dashboard(Bench& bench)
+{
+    auto frame = std::make_shared<egt::Frame>(bench.window.box());
+    frame->fill_flags(egt::Theme::FillFlag::solid);
+    bench.window.add(frame);
+
+    for (auto i = 0; i < 40; ++i)
+    {
+        auto label = std::make_shared<egt::Label>("label " + std::to_string(i),
+                     egt::Rect((i % 5) * 160, (i / 5) * 30, 150, 30));
+        frame->add(label);
+    }
+
+    std::vector<std::shared_ptr<egt::AnalogMeter>> meters;
+    for (auto i = 0; i < 4; ++i)
+    {
+        auto meter = std::make_shared<egt::AnalogMeter>(egt::Rect(i * 200, 240, 200, 200));
+        frame->add(meter);
+        meters.push_back(meter);
+    }
+
+    bench.run("dashboard", [&](int n)
+    {
+        for (auto& meter : meters)
+            meter->value(n % 100);
+        bench.window.damage();
+    });
+
+    bench.window.remove_all();
+}
+
+static void listbox(Bench& bench)
+{
+    // the view is protected, so scroll it from a subclass
+    struct ScrollingListBox : public egt::ListBox
+    {
+        using egt::ListBox::ListBox;
+
+        void scroll(int offset)
+        {
+            const auto range = -m_view.offset_min().y();
+            m_view.voffset(range ? -(offset % range) : 0);
+        }
+    };
+
+    auto list = std::make_shared<ScrollingListBox>(bench.window.box());
+    for (auto i = 0; i < 200; ++i)
+        list->add_item(std::make_shared<egt::StringItem>("item " + std::to_string(i)));
+    bench.window.add(list);
+
+    bench.run("listbox", [&](int n)
+    {
+        list->scroll(n * 4);
+    });
+
+    bench.window.remove_all();
+}
+
+static void textbox(Bench& bench)
+{
+    auto text = std::make_shared<egt::TextBox>("", bench.window.box(),
+                egt::AlignFlag::left | egt::AlignFlag::top,
+                egt::TextBox::TextFlags({egt::TextBox::TextFlag::multiline,
+                                         egt::TextBox::TextFlag::word_wrap}));
+    bench.window.add(text);
+
+    bench.run("textbox", [&](int n)
+    {
+        if (n % 400 == 0)
+            text->clear();
+        text->insert(n % 40 == 39 ? "\n" : "a");
+    });
+
+    bench.window.remove_all();
+}
+
+static void grid(Bench& bench)
+{
+    auto grid = std::make_shared<egt::StaticGrid>(bench.window.box(), egt::StaticGrid::GridSize(10, 10));
+    for (auto i = 0; i < 100; ++i)
+        grid->add(egt::expand(std::make_shared<egt::Button>(std::to_string(i))));
+    bench.window.add(grid);
+
+    const auto full = bench.window.size();
+    const auto half = egt::Size(full.width() / 2, full.height() / 2);
+
+    bench.run("grid", [&](int n)
+    {
+        grid->resize(n % 2 ? full : half);
+    });
+
+    bench.window.remove_all();
+}
+
+static void sizers(Bench& bench, int depth)
+{
+    // alternate orientations, with leaves at every level
+    std::function<std::shared_ptr<egt::BoxSizer>(int)> build = [&](int level)
+    {
+        auto sizer = std::make_shared<egt::BoxSizer>(level % 2 ?
+                     egt::Orientation::horizontal : egt::Orientation::vertical);
+        for (auto i = 0; i < 4; ++i)
+            sizer->add(egt::expand(std::make_shared<egt::Label>(std::to_string(i))));
+        if (level + 1 < depth)
+        {
+            for (auto i = 0; i < 2; ++i)
+                sizer->add(egt::expand(build(level + 1)));
+        }
+        return sizer;
+    };
+
+    auto root = build(0);
+    bench.window.add(egt::expand(root));
+
+    const auto full = bench.window.size();
+    const auto half = egt::Size(full.width() / 2, full.height() / 2);
+
+    const auto name = "sizers" + std::to_string(depth);
+    bench.run(name.c_str(), [&](int n)
+    {
+        root->resize(n % 2 ? full : half);
+    });
+
+    bench.window.remove_all();
+}
+
+static void gauge(Bench& bench)
+{
+    const auto size = bench.window.height();
+    auto meter = std::make_shared<egt::AnalogMeter>(egt::Rect(0, 0, size, size));
+    bench.window.add(center(meter));
+
+    bench.run("gauge", [&](int n)
+    {
+        meter->value(n % 100);
+    });
+
+    bench.window.remove_all();
+}
+
+static void image(Bench& bench, const char* name, const std::function<egt::Image()>& load)
+{
+    auto label = std::make_shared<egt::ImageLabel>();
+    bench.window.add(center(label));
+
+    try
+    {
+        label->image(load());
+
+        bench.run(name, [&](int)
+        {
+            egt::detail::image_cache().clear();
+            label->image(load());
+        });
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%-20s skipped: %s\n", name, e.what());
+    }
+
+    bench.window.remove_all();
+}
+
+static void sizes()
+{
+    std::printf("%-20s %10s\n", "object", "bytes");
+    std::printf("%-20s %10zu\n", "Widget", sizeof(egt::Widget));
+    std::printf("%-20s %10zu\n", "Frame", sizeof(egt::Frame));
+    std::printf("%-20s %10zu\n", "Label", sizeof(egt::Label));
+    std::printf("%-20s %10zu\n", "Button", sizeof(egt::Button));
+    std::printf("%-20s %10zu\n", "ImageLabel", sizeof(egt::ImageLabel));
+    std::printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    setenv("EGT_BACKEND", "memory", 0);
+
+    auto frames = 300;
+    std::vector<std::string> filter;
+    auto rasterizers = egt::detail::rasterizers();
+    for (auto i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--rasterizer") && i + 1 < argc)
+            rasterizers = {argv[++i]};
+        else
+            filter.emplace_back(argv[i]);
+    }
+
+    egt::Application app(argc, argv);
+    egt::TopWindow window;
+    window.show();
+
+    Bench bench{app, window, frames, filter};
+
+    sizes();
+
+    for (const auto& rasterizer : rasterizers)
+    {
+        egt::detail::rasterizer(rasterizer);
+
+        std::printf("rasterizer %s\n", rasterizer.c_str());
+        std::printf("%-20s %10s %14s %12s %12s\n", "scene", "fps",
+                    "pixels/frame", "allocs/frame", "peak rss kB");
+
+        dashboard(bench);
+        listbox(bench);
+        textbox(bench);
+        grid(bench);
+        sizers(bench, 1);
+        sizers(bench, 4);
+        sizers(bench, 8);
+        gauge(bench);
+        image(bench, "png", []() { return egt::Image("icon:battery.png;64"); });
+#ifdef EGT_HAS_SVG
+        image(bench, "svg", []() { return egt::Image(egt::SvgImage("file:home.svg", egt::SizeF(128, 128))); });
+#endif
+        std::printf("\n");
+    }
+
+    return 0;
+}
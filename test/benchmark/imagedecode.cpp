@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "detail/erawimage.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <egt/canvas.h>
+#include <egt/detail/image.h>
+#include <egt/detail/imagecache.h>
+#include <functional>
+#include <string>
+#include <sys/stat.h>
+
+/*
+ * Benchmark of image decoding.
+ *
+ * Every image given is converted to the eraw formats, and then the time to
+ * decode the original, each eraw format, and the center quarter of the image
+ * is reported along with the size of each file.
+ *
+ * Usage: benchmark_imagedecode FILE...
+ *
+ * For example, with the example assets:
+ *
+ *   benchmark_imagedecode examples/motorcycledash/bkgrd.png examples/space/background.png
+ */
+
+static const int iterations = 20;
+
+static long file_size(const std::string& path)
+{
+    struct stat st {};
+    if (stat(path.c_str(), &st))
+        return 0;
+    return st.st_size;
+}
+
+static void report(const char* name, const std::string& path,
+                   const std::function<egt::shared_cairo_surface_t()>& func)
+{
+    // warm up, and the file is in the page cache
+    if (!func())
+    {
+        std::printf("  %-24s failed\n", name);
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < iterations; i++)
+        func();
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+    std::printf("  %-24s %10.2f ms %12ld bytes\n", name, ms, file_size(path));
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s FILE...\n", argv[0]);
+        return 1;
+    }
+
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string dir = tmp ? tmp : "/tmp";
+
+    for (auto arg = 1; arg < argc; ++arg)
+    {
+        const std::string path = argv[arg];
+
+        egt::shared_cairo_surface_t original;
+        try
+        {
+            original = egt::detail::load_image_from_filesystem(path);
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "%s: %s\n", path.c_str(), e.what());
+            continue;
+        }
+
+        // eraw is always 32 bit premultiplied ARGB
+        const egt::Size size(cairo_image_surface_get_width(original.get()),
+                             cairo_image_surface_get_height(original.get()));
+        egt::Canvas canvas(size);
+        canvas.copy(original);
+        const auto data = cairo_image_surface_get_data(canvas.surface().get());
+
+        const auto rle = dir + "/benchmark_imagedecode_rle.eraw";
+        const auto raw = dir + "/benchmark_imagedecode_raw.eraw";
+        const auto tiled = dir + "/benchmark_imagedecode_tiled.eraw";
+        egt::detail::ErawImage::save(rle, data, size.width(), size.height(),
+                                     egt::detail::ErawImage::Format::rle);
+        egt::detail::ErawImage::save(raw, data, size.width(), size.height(),
+                                     egt::detail::ErawImage::Format::raw);
+        egt::detail::ErawImage::save(tiled, data, size.width(), size.height(),
+                                     egt::detail::ErawImage::Format::tiled);
+
+        const egt::Rect quarter(size.width() / 4, size.height() / 4,
+                                size.width() / 2, size.height() / 2);
+
+        std::printf("%s %dx%d\n", path.c_str(), size.width(), size.height());
+
+        report("original", path, [&]() { return egt::detail::load_image_from_filesystem(path); });
+        report("eraw", rle, [&]() { return egt::detail::load_image_from_filesystem(rle); });
+        report("eraw uncompressed", raw, [&]() { return egt::detail::load_image_from_filesystem(raw); });
+        report("eraw tiled", tiled, [&]() { return egt::detail::load_image_from_filesystem(tiled); });
+        report("original quarter", path, [&]()
+        {
+            egt::detail::image_cache().clear();
+            return egt::detail::load_image_region("file:" + path, quarter);
+        });
+        report("eraw tiled quarter", tiled, [&]()
+        {
+            return egt::detail::load_image_region("file:" + tiled, quarter);
+        });
+
+        std::remove(rle.c_str());
+        std::remove(raw.c_str());
+        std::remove(tiled.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <benchmark/benchmark.h>
+#include <cairo.h>
+#include <cstdio>
+#include <cstdlib>
+#include <egt/detail/imagecache.h>
+#include <egt/detail/layout.h>
+#include <egt/ui>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Micro-benchmarks of the core primitives, with Google Benchmark.
+ *
+ * Unlike bench, which renders whole scenes, each benchmark here times a
+ * single primitive: damage merging, rectangle operations, signals and event
+ * handlers, cache lookups, text and flex layout, and color interpolation.
+ *
+ * All Google Benchmark options are supported.  To keep the results of a run,
+ * for example to track them per commit:
+ *
+ *   benchmark_micro --benchmark_out=micro.json --benchmark_out_format=json
+ *
+ * The in-memory screen is used unless EGT_BACKEND selects another one.
+ */
+
+/// Random rectangles within an 800x480 screen, always the same ones.
+static std::vector<egt::Rect> random_rects(size_t count, int max_size)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> size(1, max_size);
+    std::vector<egt::Rect> rects;
+    rects.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto w = size(gen);
+        const auto h = size(gen);
+        rects.emplace_back(std::uniform_int_distribution<int>(0, 800 - w)(gen),
+                           std::uniform_int_distribution<int>(0, 480 - h)(gen),
+                           w, h);
+    }
+    return rects;
+}
+
+/**
+ * Damage of a frame, as added to a screen.
+ *
+ * - widgets: scattered widgets updating, like labels of a dashboard.
+ * - sprite: a sprite moving, damaging its old and new positions.
+ * - list: rows of a scrolling list, adjacent to each other.
+ * - fullscreen: small updates, and then the whole screen.
+ */
+static const std::vector<egt::Rect>& damage_pattern(int64_t pattern)
+{
+    static const std::vector<std::vector<egt::Rect>> patterns = []()
+    {
+        std::vector<std::vector<egt::Rect>> result;
+
+        result.push_back(random_rects(32, 96));
+
+        std::vector<egt::Rect> sprite;
+        for (auto i = 0; i < 32; ++i)
+        {
+            sprite.emplace_back(100 + i * 8, 100 + i * 4, 64, 64);
+            sprite.emplace_back(100 + (i + 1) * 8, 100 + (i + 1) * 4, 64, 64);
+        }
+        result.push_back(std::move(sprite));
+
+        std::vector<egt::Rect> list;
+        for (auto i = 0; i < 12; ++i)
+            list.emplace_back(0, i * 40, 800, 40);
+        result.push_back(std::move(list));
+
+        auto fullscreen = random_rects(16, 48);
+        fullscreen.emplace_back(0, 0, 800, 480);
+        result.push_back(std::move(fullscreen));
+
+        return result;
+    }();
+
+    return patterns[pattern];
+}
+
+static const char* damage_pattern_name(int64_t pattern)
+{
+    static const char* names[] = {"widgets", "sprite", "list", "fullscreen"};
+    return names[pattern];
+}
+
+static void BM_DamageAlgorithm(benchmark::State& state)
+{
+    const auto& rects = damage_pattern(state.range(0));
+    egt::Screen::DamageArray damage;
+
+    for (auto _ : state)
+    {
+        damage.clear();
+        for (const auto& rect : rects)
+            egt::Screen::damage_algorithm(damage, rect);
+        benchmark::DoNotOptimize(damage.data());
+    }
+
+    state.SetLabel(damage_pattern_name(state.range(0)));
+    state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_DamageAlgorithm)->DenseRange(0, 3);
+
+static void BM_DamageAlgorithmCost(benchmark::State& state)
+{
+    const auto& rects = damage_pattern(state.range(0));
+    const egt::Screen::DamageCost cost;
+    egt::Screen::DamageArray damage;
+
+    for (auto _ : state)
+    {
+        damage.clear();
+        for (const auto& rect : rects)
+            egt::Screen::damage_algorithm(damage, rect, cost);
+        benchmark::DoNotOptimize(damage.data());
+    }
+
+    state.SetLabel(damage_pattern_name(state.range(0)));
+    state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_DamageAlgorithmCost)->DenseRange(0, 3);
+
+static void BM_RectIntersect(benchmark::State& state)
+{
+    const auto rects = random_rects(256, 200);
+
+    for (auto _ : state)
+    {
+        for (size_t i = 1; i < rects.size(); ++i)
+        {
+            benchmark::DoNotOptimize(rects[i - 1].intersect(rects[i]));
+            benchmark::DoNotOptimize(egt::Rect::intersection(rects[i - 1], rects[i]));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * (rects.size() - 1));
+}
+BENCHMARK(BM_RectIntersect);
+
+static void BM_RectMerge(benchmark::State& state)
+{
+    const auto rects = random_rects(256, 200);
+
+    for (auto _ : state)
+    {
+        for (size_t i = 1; i < rects.size(); ++i)
+            benchmark::DoNotOptimize(egt::Rect::merge(rects[i - 1], rects[i]));
+    }
+
+    state.SetItemsProcessed(state.iterations() * (rects.size() - 1));
+}
+BENCHMARK(BM_RectMerge);
+
+static void BM_SignalInvoke(benchmark::State& state)
+{
+    egt::Signal<int> signal;
+    int sum = 0;
+    for (auto i = 0; i < state.range(0); ++i)
+        signal.on_event([&sum](int value) { sum += value; });
+
+    for (auto _ : state)
+        signal.invoke(1);
+
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SignalInvoke)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_ObjectInvokeHandlers(benchmark::State& state)
+{
+    egt::Object object;
+    int count = 0;
+    for (auto i = 0; i < state.range(0); ++i)
+        object.on_event([&count](egt::Event&) { ++count; }, {egt::EventId::pointer_click});
+
+    for (auto _ : state)
+    {
+        egt::Event event(egt::EventId::pointer_click);
+        object.invoke_handlers(event);
+        // an event nobody handles
+        object.invoke_handlers(egt::EventId::pointer_drag);
+    }
+
+    benchmark::DoNotOptimize(count);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ObjectInvokeHandlers)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_ImageCacheGet(benchmark::State& state)
+{
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string path = std::string(tmp ? tmp : "/tmp") + "/egt_benchmark_micro.png";
+
+    auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 64, 64);
+    const auto status = cairo_surface_write_to_png(surface, path.c_str());
+    cairo_surface_destroy(surface);
+    if (status != CAIRO_STATUS_SUCCESS)
+    {
+        state.SkipWithError("unable to write the image");
+        return;
+    }
+
+    const std::string uri = "file:" + path;
+    auto& cache = egt::detail::image_cache();
+    try
+    {
+        cache.get(uri);
+    }
+    catch (const std::exception& e)
+    {
+        std::remove(path.c_str());
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.get(uri));
+
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ImageCacheGet);
+
+static void BM_FontCacheLookup(benchmark::State& state)
+{
+    std::vector<egt::Font> fonts;
+    for (auto i = 0; i < state.range(0); ++i)
+        fonts.emplace_back(egt::Font::DEFAULT_FACE, 10 + i);
+
+    try
+    {
+        for (auto& font : fonts)
+            benchmark::DoNotOptimize(font.scaled_font());
+    }
+    catch (const std::exception& e)
+    {
+        state.SkipWithError(e.what());
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        for (auto& font : fonts)
+            benchmark::DoNotOptimize(font.scaled_font());
+    }
+
+    state.SetItemsProcessed(state.iterations() * fonts.size());
+}
+BENCHMARK(BM_FontCacheLookup)->Arg(1)->Arg(8)->Arg(32);
+
+/// Exposes the layout steps of TextBox.
+class LayoutTextBox : public egt::TextBox
+{
+public:
+    using egt::TextBox::TextBox;
+
+    void prepare(egt::TextRects& rects)
+    {
+        cairo_set_scaled_font(context(), font().scaled_font());
+        rects.clear();
+        tokenize(rects);
+    }
+
+    using egt::TextBox::compute_layout;
+};
+
+static void BM_TextBoxComputeLayout(benchmark::State& state)
+{
+    std::string text;
+    for (auto i = 0; i < state.range(0); ++i)
+        text += "The quick brown fox jumps over the lazy dog. ";
+
+    LayoutTextBox textbox(text, egt::Rect(0, 0, 400, 300),
+                          egt::AlignFlag::left | egt::AlignFlag::top,
+    {egt::TextBox::TextFlag::multiline, egt::TextBox::TextFlag::word_wrap});
+
+    egt::TextRects rects;
+    textbox.prepare(rects);
+
+    for (auto _ : state)
+    {
+        textbox.compute_layout(rects);
+        benchmark::DoNotOptimize(rects.back().rect());
+    }
+
+    state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_TextBoxComputeLayout)->Arg(1)->Arg(8)->Arg(64);
+
+static std::vector<egt::detail::LayoutRect> layout_children(int64_t count)
+{
+    const auto behave = egt::detail::align_to_behave(egt::AlignFlag::expand_vertical);
+    std::vector<egt::detail::LayoutRect> children;
+    for (auto i = 0; i < count; ++i)
+        children.emplace_back(behave, egt::Rect(0, 0, 20 + i % 7, 20), 2, 2, 2, 2);
+    return children;
+}
+
+static void BM_FlexLayout(benchmark::State& state)
+{
+    const egt::Rect parent(0, 0, 800, 480);
+    auto children = layout_children(state.range(0));
+
+    for (auto _ : state)
+    {
+        egt::detail::flex_layout(parent, children, egt::Justification::start,
+                                 egt::Orientation::flex);
+        benchmark::DoNotOptimize(children.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * children.size());
+}
+BENCHMARK(BM_FlexLayout)->Arg(4)->Arg(32)->Arg(256);
+
+static void BM_FlexLayoutReuse(benchmark::State& state)
+{
+    const egt::Rect parent(0, 0, 800, 480);
+    auto children = layout_children(state.range(0));
+    egt::detail::FlexLayout layout;
+
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        // one child changes between runs, so the layout is not skipped
+        auto& child = children[i++ % children.size()];
+        child.rect.width(child.rect.width() == 20 ? 21 : 20);
+        layout.run(parent, children, egt::Justification::start,
+                   egt::Orientation::flex);
+        benchmark::DoNotOptimize(children.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * children.size());
+}
+BENCHMARK(BM_FlexLayoutReuse)->Arg(4)->Arg(32)->Arg(256);
+
+static void BM_ColorInterp(benchmark::State& state)
+{
+    const egt::Color a(egt::Palette::red);
+    const egt::Color b(egt::Palette::blue, 128);
+    const auto interp = state.range(0);
+
+    float t = 0;
+    for (auto _ : state)
+    {
+        t += 0.001f;
+        if (t > 1.f)
+            t = 0;
+
+        switch (interp)
+        {
+        case 0:
+            benchmark::DoNotOptimize(egt::Color::interp_rgba(a, b, t));
+            break;
+        case 1:
+            benchmark::DoNotOptimize(egt::Color::interp_hsv(a, b, t));
+            break;
+        default:
+            benchmark::DoNotOptimize(egt::Color::interp_hsl(a, b, t));
+            break;
+        }
+    }
+
+    static const char* names[] = {"rgba", "hsv", "hsl"};
+    state.SetLabel(names[interp]);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ColorInterp)->DenseRange(0, 2);
+
+static void BM_ColorMapInterp(benchmark::State& state)
+{
+    const egt::experimental::ColorMap map({egt::Palette::red, egt::Palette::green, egt::Palette::blue},
+                                          egt::experimental::ColorMap::Interpolation::hsv);
+
+    float t = 0;
+    for (auto _ : state)
+    {
+        t += 0.001f;
+        if (t > 1.f)
+            t = 0;
+
+        if (state.range(0))
+            benchmark::DoNotOptimize(map.interp_cached(t));
+        else
+            benchmark::DoNotOptimize(map.interp(t));
+    }
+
+    state.SetLabel(state.range(0) ? "cached" : "interp");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ColorMapInterp)->Arg(0)->Arg(1);
+
+int main(int argc, char** argv)
+{
+    setenv("EGT_BACKEND", "memory", 0);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    egt::Application app(argc, argv);
+
+    benchmark::AddCustomContext("egt_version", EGT_VERSION);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
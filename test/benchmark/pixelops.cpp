@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <cairo.h>
+#include <chrono>
+#include <cstdio>
+#include <egt/detail/pixelops.h>
+#include <egt/detail/placement.h>
+#include <egt/image.h>
+#include <egt/painter.h>
+#include <egt/palette.h>
+#include <functional>
+#include <vector>
+
+/*
+ * Micro-benchmark of the pixel kernels against the cairo paths they replace.
+ *
+ * Every test works on a full 800x480 screen and reports the throughput in
+ * megapixels per second.
+ *
+ * The "painter" tests draw with egt::Painter, which blits images and fills
+ * solid rectangles with the kernels when they are not transformed, to
+ * compare with the cairo tests before them.
+ *
+ * The "readback" and "blend" tests read and blend on a buffer in each memory
+ * a composition buffer can be placed in, when it is available.
+ */
+
+static const int width = 800;
+static const int height = 480;
+static const int iterations = 100;
+
+static void report(const char* name, const std::function<void()>& func)
+{
+    // warm up
+    func();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto i = 0; i < iterations; i++)
+        func();
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto seconds = std::chrono::duration<double>(end - start).count();
+    const auto mpixels = static_cast<double>(width) * height * iterations / 1e6;
+    std::printf("%-32s %10.1f Mpixel/s\n", name, mpixels / seconds);
+}
+
+static void cairo_copy(cairo_surface_t* src, cairo_surface_t* dst, cairo_operator_t op)
+{
+    auto cr = cairo_create(dst);
+    cairo_set_source_surface(cr, src, 0, 0);
+    cairo_set_operator(cr, op);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_flush(dst);
+}
+
+int main()
+{
+    auto src = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    auto dst = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    auto dst16 = cairo_image_surface_create(CAIRO_FORMAT_RGB16_565, width, height);
+
+    // half transparent gradient, so blending does real work
+    auto cr = cairo_create(src);
+    auto pattern = cairo_pattern_create_linear(0, 0, width, height);
+    cairo_pattern_add_color_stop_rgba(pattern, 0, 1, 0, 0, 0.2);
+    cairo_pattern_add_color_stop_rgba(pattern, 1, 0, 0, 1, 0.8);
+    cairo_set_source(cr, pattern);
+    cairo_paint(cr);
+    cairo_pattern_destroy(pattern);
+    cairo_destroy(cr);
+    cairo_surface_flush(src);
+
+    auto src_data = cairo_image_surface_get_data(src);
+    auto dst_data = cairo_image_surface_get_data(dst);
+    auto dst16_data = cairo_image_surface_get_data(dst16);
+    const auto stride = cairo_image_surface_get_stride(src);
+    const auto stride16 = cairo_image_surface_get_stride(dst16);
+
+    report("cairo copy", [&]() { cairo_copy(src, dst, CAIRO_OPERATOR_SOURCE); });
+    report("cairo argb8888 to rgb565", [&]() { cairo_copy(src, dst16, CAIRO_OPERATOR_SOURCE); });
+    report("cairo blend over", [&]() { cairo_copy(src, dst, CAIRO_OPERATOR_OVER); });
+
+    const bool modes[] = {false, true};
+    for (auto neon : modes)
+    {
+        if (egt::detail::pixelops_neon(neon) != neon)
+            continue;
+
+        const auto prefix = neon ? "neon" : "generic";
+        char name[64];
+
+        std::snprintf(name, sizeof(name), "%s copy", prefix);
+        report(name, [&]()
+        {
+            egt::detail::copy_rect(src_data, stride, dst_data, stride,
+                                   width * 4, height);
+        });
+
+        std::snprintf(name, sizeof(name), "%s argb8888 to rgb565", prefix);
+        report(name, [&]()
+        {
+            egt::detail::argb8888_to_rgb565(reinterpret_cast<const uint32_t*>(src_data), stride,
+                                            reinterpret_cast<uint16_t*>(dst16_data), stride16,
+                                            width, height);
+        });
+
+        std::snprintf(name, sizeof(name), "%s blend over", prefix);
+        report(name, [&]()
+        {
+            egt::detail::blend_over(reinterpret_cast<const uint32_t*>(src_data), stride,
+                                    reinterpret_cast<uint32_t*>(dst_data), stride,
+                                    width, height);
+        });
+    }
+
+    // an opaque image is copied, over a target of the same format
+    auto src24 = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    auto dst24 = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+
+    report("cairo opaque image", [&]() { cairo_copy(src24, dst24, CAIRO_OPERATOR_OVER); });
+
+    const egt::Image image(egt::shared_cairo_surface_t(cairo_surface_reference(src),
+                           cairo_surface_destroy));
+    const egt::Image opaque(egt::shared_cairo_surface_t(cairo_surface_reference(src24),
+                            cairo_surface_destroy));
+
+    const auto painter_draw = [](cairo_surface_t* target, const egt::Image & img)
+    {
+        egt::Painter painter(egt::shared_cairo_t(cairo_create(target), cairo_destroy));
+        painter.draw(egt::Point());
+        painter.draw(img);
+        cairo_surface_flush(target);
+    };
+
+    report("painter image over", [&]() { painter_draw(dst, image); });
+    report("painter opaque image", [&]() { painter_draw(dst24, opaque); });
+
+    // an opaque solid rectangle, like the background of a frame
+    report("cairo fill", [&]()
+    {
+        auto cr = cairo_create(dst);
+        cairo_set_source_rgb(cr, 0, 0, 1);
+        cairo_rectangle(cr, 0, 0, width, height);
+        cairo_fill(cr);
+        cairo_destroy(cr);
+        cairo_surface_flush(dst);
+    });
+
+    report("painter fill", [&]()
+    {
+        egt::Painter painter(egt::shared_cairo_t(cairo_create(dst), cairo_destroy));
+        painter.set(egt::Palette::blue);
+        painter.fill(egt::Rect(0, 0, width, height));
+        cairo_surface_flush(dst);
+    });
+
+    // blending reads back the target, which depends on where it is placed
+    const egt::detail::Placement placements[] =
+    {
+        egt::detail::Placement::cached,
+        egt::detail::Placement::hugepage,
+        egt::detail::Placement::cma,
+    };
+    for (auto p : placements)
+    {
+        auto target = egt::detail::create_surface(CAIRO_FORMAT_ARGB32,
+                      egt::Size(width, height), p);
+        if (egt::detail::placement(target.get()) != p)
+        {
+            std::printf("%-32s %10s\n", egt::detail::placement_name(p), "n/a");
+            continue;
+        }
+
+        auto target_data = cairo_image_surface_get_data(target.get());
+        char name[64];
+
+        std::snprintf(name, sizeof(name), "%s readback", egt::detail::placement_name(p));
+        report(name, [&]()
+        {
+            egt::detail::read_throughput(target_data, static_cast<size_t>(stride) * height);
+        });
+
+        std::snprintf(name, sizeof(name), "%s blend over", egt::detail::placement_name(p));
+        report(name, [&]()
+        {
+            egt::detail::blend_over(reinterpret_cast<const uint32_t*>(src_data), stride,
+                                    reinterpret_cast<uint32_t*>(target_data), stride,
+                                    width, height);
+        });
+    }
+
+    cairo_surface_destroy(dst24);
+    cairo_surface_destroy(src24);
+    cairo_surface_destroy(dst16);
+    cairo_surface_destroy(dst);
+    cairo_surface_destroy(src);
+
+    return 0;
+}
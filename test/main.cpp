@@ -3,9 +3,50 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include "detail/uibinary.h"
+#include "detail/window/tiledamage.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <egt/asio.hpp>
+#include <egt/detail/drawdiagnostics.h>
+#include <egt/detail/filesystem.h>
+#include <egt/detail/fixed.h>
+#include <egt/detail/image.h>
+#include <egt/detail/input/inputreplay.h>
+#include <egt/detail/lrucache.h>
+#include <egt/detail/pixelops.h>
+#include <egt/detail/placement.h>
+#include <egt/detail/rasterizer.h>
+#include <egt/detail/rectbatch.h>
+#include <egt/detail/screen/composerscreen.h>
+#include <egt/detail/screen/epdscreen.h>
+#include <egt/detail/sharedstore.h>
+#include <egt/detail/stringhash.h>
+#include <egt/detail/surfacepool.h>
 #include <egt/ui>
+#include <egt/uiloader.h>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <rapidxml.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+#ifdef EGT_HAS_CHART
+#include "detail/charts/decimator.h"
+#endif
 
 static constexpr float calculate(float start, float decrement, int count)
 {
@@ -93,102 +134,4155 @@ TEST(Color, Basic)
     EXPECT_EQ(c7.blue(), 0xffU);
     EXPECT_EQ(c7.alpha(), 0xffU);
 
-    egt::Color c8 = egt::Color::css("aa22ff");
-    EXPECT_EQ(c8.red(), 0xaaU);
-    EXPECT_EQ(c8.green(), 0x22U);
-    EXPECT_EQ(c8.blue(), 0xffU);
-    EXPECT_EQ(c8.alpha(), 0xffU);
-}
+    egt::Color c8 = egt::Color::css("aa22ff");
+    EXPECT_EQ(c8.red(), 0xaaU);
+    EXPECT_EQ(c8.green(), 0x22U);
+    EXPECT_EQ(c8.blue(), 0xffU);
+    EXPECT_EQ(c8.alpha(), 0xffU);
+}
+
+TEST(ColorMap, Baked)
+{
+    egt::experimental::ColorMap colors({egt::Palette::red, egt::Palette::blue},
+                                       egt::experimental::ColorMap::Interpolation::hsv);
+
+    // the table holds the interpolated colors, and map() reads the nearest one
+    colors.bake(5);
+    const std::vector<float> offsets = {0.f, 0.25f, 0.6f, 1.f, 2.f};
+    std::vector<uint32_t> pixels(offsets.size());
+    colors.map(offsets.data(), pixels.data(), pixels.size());
+    EXPECT_EQ(pixels[0], colors.interp(0.f).pixel32());
+    EXPECT_EQ(pixels[1], colors.interp(0.25f).pixel32());
+    EXPECT_EQ(pixels[2], colors.interp(0.5f).pixel32());
+    EXPECT_EQ(pixels[3], egt::Palette::blue.pixel32());
+    EXPECT_EQ(pixels[4], egt::Palette::blue.pixel32());
+
+    EXPECT_EQ(colors.interp_cached(0.5f, 10), colors.interp(0.5f));
+
+    // new steps invalidate the tables
+    colors.step(egt::Palette::green);
+    colors.map(offsets.data(), pixels.data(), pixels.size());
+    EXPECT_EQ(pixels[2], colors.interp(0.5f).pixel32());
+    EXPECT_EQ(pixels[3], egt::Palette::green.pixel32());
+}
+
+TEST(TextBox, Basic)
+{
+    egt::Application app;
+
+    std::string str1 = "hello world\nthis is EGT";
+    std::string str2 = "howdy";
+
+    egt::TextBox text1(str1);
+    ASSERT_EQ(str1, text1.text());
+    text1.text(str2);
+    ASSERT_EQ(str2, text1.text());
+    ASSERT_EQ(str2.size(), text1.len());
+    text1.append(str1);
+    ASSERT_EQ(str2 + str1, text1.text());
+    text1.cursor_begin();
+    text1.insert(str1);
+    ASSERT_EQ(str1 + str2 + str1, text1.text());
+    text1.cursor_end();
+    text1.insert(str1);
+    ASSERT_EQ(str1 + str2 + str1 + str1, text1.text());
+    text1.selection_all();
+    ASSERT_EQ(str1 + str2 + str1 + str1, text1.selected_text());
+    text1.selection(str1.size(), 5);
+    ASSERT_EQ(str2, text1.selected_text());
+    text1.selection_clear();
+    ASSERT_EQ("", text1.selected_text());
+    text1.selection_all();
+    text1.selection_delete();
+    ASSERT_EQ("", text1.text());
+}
+
+TEST(Widget, SizeHintCache)
+{
+    egt::Application app;
+
+    egt::Label label("12.5 Hz");
+    const auto size = label.cached_min_size_hint();
+    EXPECT_EQ(size, label.min_size_hint());
+
+    // the content, the font and the moat are part of the hint
+    label.text("12345.5 Hz");
+    const auto wider = label.cached_min_size_hint();
+    EXPECT_GT(wider.width(), size.width());
+
+    label.font(egt::Font(label.font().size() * 2));
+    const auto bigger = label.cached_min_size_hint();
+    EXPECT_GT(bigger.height(), wider.height());
+
+    label.padding(10);
+    EXPECT_EQ(label.cached_min_size_hint(), label.min_size_hint());
+    EXPECT_GT(label.cached_min_size_hint().width(), bigger.width());
+
+    // and so is the font inherited from a parent
+    egt::Label child("12.5 Hz");
+    egt::Frame frame;
+    frame.add(child);
+    const auto inherited = child.cached_min_size_hint();
+    frame.font(egt::Font(frame.font().size() * 2));
+    EXPECT_GT(child.cached_min_size_hint().height(), inherited.height());
+    EXPECT_EQ(child.cached_min_size_hint(), child.min_size_hint());
+
+    // and default sizes shared by a type of widgets
+    egt::Slider slider;
+    const auto previous = egt::Slider::default_size();
+    egt::Slider::default_size(egt::Size(301, 33));
+    EXPECT_EQ(slider.cached_min_size_hint(), slider.min_size_hint());
+    egt::Slider::default_size(previous);
+}
+
+TEST(Palette, Lookup)
+{
+    using egt::Palette;
+
+    // every color of every group has its own slot
+    std::vector<size_t> slots;
+    for (size_t g = 1; g <= Palette::GROUP_COUNT; ++g)
+        for (size_t c = 1; c <= Palette::COLOR_COUNT; ++c)
+            slots.push_back(Palette::index(static_cast<Palette::ColorId>(c),
+                                           static_cast<Palette::GroupId>(g)));
+    std::sort(slots.begin(), slots.end());
+    EXPECT_EQ(std::adjacent_find(slots.begin(), slots.end()), slots.end());
+    EXPECT_LT(slots.back(), Palette::COLOR_COUNT * Palette::GROUP_COUNT);
+    EXPECT_EQ(Palette::index(static_cast<Palette::ColorId>(0), Palette::GroupId::normal),
+              Palette::COLOR_COUNT * Palette::GROUP_COUNT);
+
+    const auto color = [](size_t c, size_t g)
+    {
+        return egt::Color(static_cast<egt::Color::RGBAType>(0xff000000 | g << 8 | c));
+    };
+
+    Palette palette;
+    for (size_t g = 1; g <= Palette::GROUP_COUNT; ++g)
+        for (size_t c = 1; c <= Palette::COLOR_COUNT; ++c)
+            palette.set(static_cast<Palette::ColorId>(c), static_cast<Palette::GroupId>(g),
+                        color(c, g));
+
+    const auto check = [&color](const Palette & palette)
+    {
+        for (size_t g = 1; g <= Palette::GROUP_COUNT; ++g)
+            for (size_t c = 1; c <= Palette::COLOR_COUNT; ++c)
+                EXPECT_EQ(palette.color(static_cast<Palette::ColorId>(c),
+                                        static_cast<Palette::GroupId>(g)).first(),
+                          color(c, g));
+    };
+    check(palette);
+
+    // copies keep their index
+    const Palette copy = palette;
+    check(copy);
+
+    // changes update the index
+    palette.set(Palette::ColorId::text, Palette::GroupId::active, egt::Palette::red);
+    EXPECT_EQ(palette.color(Palette::ColorId::text, Palette::GroupId::active).first(),
+              egt::Palette::red);
+    palette.clear(Palette::ColorId::bg, Palette::GroupId::normal);
+    EXPECT_FALSE(palette.exists(Palette::ColorId::bg, Palette::GroupId::normal));
+    EXPECT_THROW(static_cast<void>(palette.color(Palette::ColorId::bg)), std::runtime_error);
+    const egt::Pattern* pattern = nullptr;
+    EXPECT_TRUE(palette.exists(Palette::ColorId::text, Palette::GroupId::normal, &pattern));
+    ASSERT_NE(pattern, nullptr);
+    EXPECT_EQ(pattern->first(), color(2, 1));
+
+    palette.clear();
+    EXPECT_TRUE(palette.empty());
+    EXPECT_FALSE(palette.exists(Palette::ColorId::text, Palette::GroupId::normal));
+
+    palette = Palette::PatternArray{};
+    EXPECT_FALSE(palette.exists(Palette::ColorId::text));
+}
+
+TEST(Palette, WidgetOverrides)
+{
+    egt::Application app;
+
+    const auto id = egt::Palette::ColorId::button_bg;
+
+    egt::Frame frame;
+    auto button = std::make_shared<egt::Button>("button");
+    frame.add(button);
+    const auto global = button->color(id).first();
+
+    // without a palette of its own, a widget gets the colors of its parents
+    frame.color(id, egt::Palette::red);
+    EXPECT_EQ(button->color(id).first(), egt::Palette::red);
+
+    button->color(id, egt::Palette::blue);
+    EXPECT_EQ(button->color(id).first(), egt::Palette::blue);
+    EXPECT_EQ(frame.color(id).first(), egt::Palette::red);
+
+    button->reset_palette();
+    EXPECT_EQ(button->color(id).first(), egt::Palette::red);
+
+    {
+        egt::Label label;
+        label.palette(egt::Palette());
+        frame.reset_palette();
+        EXPECT_EQ(button->color(id).first(), global);
+    }
+
+    // and the global palette once no widget has a palette any longer
+    EXPECT_EQ(button->color(id).first(), global);
+    egt::Label label;
+    EXPECT_EQ(label.color(id).first(), global);
+}
+
+TEST(WidgetPrototype, Instance)
+{
+    egt::Application app;
+
+    auto tile = std::make_shared<egt::Frame>(egt::Rect(0, 0, 100, 50));
+    tile->name("tile");
+    auto button = std::make_shared<egt::Button>("7", egt::Rect(10, 10, 80, 30));
+    button->name("key");
+    button->font(egt::Font(30));
+    button->color(egt::Palette::ColorId::button_bg, egt::Palette::red);
+    tile->add(button);
+
+    egt::experimental::WidgetPrototype prototype(tile);
+    auto first = prototype.instance<egt::Frame>();
+    auto second = prototype.instance<egt::Frame>();
+    ASSERT_TRUE(first && second);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first->name(), "tile");
+    EXPECT_EQ(first->box(), tile->box());
+
+    auto key = first->find_child<egt::Button>("key");
+    auto other = second->find_child<egt::Button>("key");
+    ASSERT_TRUE(key && other);
+    EXPECT_EQ(key->text(), "7");
+    EXPECT_EQ(key->box(), button->box());
+
+    // the font and palette are shared, until changed
+    EXPECT_EQ(&key->font(), &button->font());
+    EXPECT_EQ(&key->palette(), &other->palette());
+    key->color(egt::Palette::ColorId::button_bg, egt::Palette::blue);
+    EXPECT_EQ(key->color(egt::Palette::ColorId::button_bg).first(), egt::Palette::blue);
+    EXPECT_EQ(other->color(egt::Palette::ColorId::button_bg).first(), egt::Palette::red);
+    EXPECT_EQ(button->color(egt::Palette::ColorId::button_bg).first(), egt::Palette::red);
+}
+
+TEST(Label, TextSizeCache)
+{
+    egt::Application app;
+
+    egt::Label label("12.5 Hz");
+    const auto size = label.min_size_hint();
+    EXPECT_EQ(label.min_size_hint(), size);
+
+    // the text and the font are part of what was measured
+    label.text("12345.5 Hz");
+    const auto wider = label.min_size_hint();
+    EXPECT_GT(wider.width(), size.width());
+
+    label.font(egt::Font(label.font().size() * 2));
+    const auto bigger = label.min_size_hint();
+    EXPECT_GT(bigger.width(), wider.width());
+    EXPECT_GT(bigger.height(), wider.height());
+
+    label.text("12.5 Hz");
+    EXPECT_LT(label.min_size_hint().width(), bigger.width());
+}
+
+TEST(Label, LayoutCache)
+{
+    egt::Application app;
+
+    egt::Canvas canvas(egt::Size(200, 100));
+    egt::Painter painter(canvas.context());
+
+    egt::TextWidget::reset_layout_cache();
+
+    const std::string text = "a label wrapped\non several lines";
+    egt::Label first(text, egt::Rect(0, 0, 100, 80));
+    egt::Label second(text, egt::Rect(0, 0, 100, 80));
+
+    first.draw(painter, first.box());
+    auto stats = egt::TextWidget::layout_cache_stats();
+    EXPECT_EQ(stats.misses, 1U);
+    EXPECT_EQ(stats.hits, 0U);
+
+    // the same text in the same box takes the layout of the first label
+    second.draw(painter, second.box());
+    stats = egt::TextWidget::layout_cache_stats();
+    EXPECT_EQ(stats.misses, 1U);
+    EXPECT_EQ(stats.hits, 1U);
+
+    // drawing again does not even look the layout up
+    first.draw(painter, first.box());
+    second.draw(painter, second.box());
+    stats = egt::TextWidget::layout_cache_stats();
+    EXPECT_EQ(stats.misses, 1U);
+    EXPECT_EQ(stats.hits, 1U);
+
+    // a different width is laid out again, and the first width is kept
+    second.resize(egt::Size(150, 80));
+    second.draw(painter, second.box());
+    second.resize(egt::Size(100, 80));
+    second.draw(painter, second.box());
+    stats = egt::TextWidget::layout_cache_stats();
+    EXPECT_EQ(stats.misses, 2U);
+    EXPECT_EQ(stats.hits, 2U);
+
+    const auto size = egt::TextWidget::layout_cache_size();
+    egt::TextWidget::layout_cache_size(1);
+    EXPECT_EQ(egt::TextWidget::layout_cache_size(), 1U);
+    EXPECT_GT(egt::TextWidget::layout_cache_stats().evictions, 0U);
+    egt::TextWidget::layout_cache_size(size);
+
+    egt::TextWidget::reset_layout_cache();
+    EXPECT_EQ(egt::TextWidget::layout_cache_stats().misses, 0U);
+}
+
+TEST(Button, CacheStates)
+{
+    egt::Application app;
+
+    egt::Canvas canvas(egt::Size(200, 100));
+    egt::Painter painter(canvas.context());
+
+    static int draws;
+    draws = 0;
+    egt::Drawer<egt::Button>::draw([](egt::Button & widget, egt::Painter & painter, const egt::Rect & rect)
+    {
+        ++draws;
+        egt::Button::default_draw(widget, painter, rect);
+    });
+
+    egt::Button button("OK", egt::Rect(0, 0, 100, 50));
+    EXPECT_FALSE(button.cache_states());
+    button.cache_states(true);
+    EXPECT_TRUE(button.cache_states());
+
+    // the states of a tap, and disabled, are drawn with the first one
+    button.draw(painter, button.box());
+    EXPECT_EQ(draws, 6);
+
+    button.active(true);
+    button.draw(painter, button.box());
+    button.checked(true);
+    button.active(false);
+    button.draw(painter, button.box());
+    button.disable();
+    button.draw(painter, button.box());
+    EXPECT_EQ(draws, 6);
+
+    // any other change draws the states again
+    button.text("Cancel");
+    button.draw(painter, button.box());
+    EXPECT_EQ(draws, 12);
+
+    button.cache_states(false);
+    button.draw(painter, button.box());
+    EXPECT_EQ(draws, 13);
+
+    egt::Drawer<egt::Button>::draw(egt::Button::default_draw);
+}
+
+TEST(Translator, Language)
+{
+    egt::Application app;
+
+    // a message catalog, as written by msgfmt
+    const std::vector<std::pair<std::string, std::string>> messages =
+    {
+        {"", "Content-Type: text/plain; charset=UTF-8\n"},
+        {"Hello", "Bonjour"},
+        {"Yes", "Oui"},
+    };
+
+    std::vector<uint32_t> header{0x950412de, 0, static_cast<uint32_t>(messages.size()),
+                                 28, static_cast<uint32_t>(28 + messages.size() * 8), 0, 0};
+    std::string strings;
+    auto offset = static_cast<uint32_t>(28 + messages.size() * 16);
+    std::vector<uint32_t> originals;
+    std::vector<uint32_t> translations;
+    for (const auto& message : messages)
+    {
+        originals.push_back(message.first.size());
+        originals.push_back(offset + strings.size());
+        strings += message.first + '\0';
+    }
+    for (const auto& message : messages)
+    {
+        translations.push_back(message.second.size());
+        translations.push_back(offset + strings.size());
+        strings += message.second + '\0';
+    }
+
+    const auto path = "/tmp/egt-locale-" + std::to_string(getpid());
+    mkdir(path.c_str(), 0700);
+    mkdir((path + "/fr").c_str(), 0700);
+    mkdir((path + "/fr/LC_MESSAGES").c_str(), 0700);
+    {
+        std::ofstream out(path + "/fr/LC_MESSAGES/egt-test.mo", std::ios_base::binary);
+        for (const auto* words : {&header, &originals, &translations})
+            out.write(reinterpret_cast<const char*>(words->data()), words->size() * 4);
+        out << strings;
+    }
+
+    egt::TopWindow window;
+    auto label = std::make_shared<egt::Label>();
+    label->translate("Hello");
+    window.add(label);
+    EXPECT_EQ(label->text(), "Hello");
+
+    auto& translator = egt::Translator::instance();
+    translator.domain("egt-test", path);
+
+    // the most specific catalog of the language
+    EXPECT_TRUE(translator.language("fr_FR.UTF-8"));
+    EXPECT_EQ(label->text(), "Bonjour");
+    EXPECT_EQ(egt::tr("Yes"), "Oui");
+    EXPECT_EQ(egt::tr("No"), "No");
+
+    EXPECT_FALSE(translator.language("de"));
+    EXPECT_EQ(label->text(), "Hello");
+
+    EXPECT_TRUE(translator.language("fr"));
+    EXPECT_EQ(label->text(), "Bonjour");
+
+    translator.language({});
+    translator.domain({});
+    EXPECT_EQ(label->text(), "Hello");
+
+    unlink((path + "/fr/LC_MESSAGES/egt-test.mo").c_str());
+    rmdir((path + "/fr/LC_MESSAGES").c_str());
+    rmdir((path + "/fr").c_str());
+    rmdir(path.c_str());
+}
+
+TEST(TextBox, MultilineEdits)
+{
+    egt::Application app;
+
+    const egt::TextBox::TextFlags flags{egt::TextBox::TextFlag::multiline,
+                                        egt::TextBox::TextFlag::word_wrap};
+
+    egt::TextBox text1("first line\nsecond line\nthird line", egt::Rect(0, 0, 200, 200),
+                       egt::AlignFlag::expand, flags);
+    text1.cursor_set(18);
+    text1.insert("and a half ");
+    text1.cursor_end();
+    text1.insert("\n");
+    text1.selection(0, 6);
+    text1.selection_delete();
+
+    const std::string str = "line\nsecond and a half line\nthird line\n";
+    ASSERT_EQ(str, text1.text());
+    ASSERT_EQ(0U, text1.cursor());
+
+    text1.selection(5, 6);
+    ASSERT_EQ("second", text1.selected_text());
+    text1.cursor_set(28);
+    text1.insert("the ");
+    ASSERT_EQ("line\nsecond and a half line\nthe third line\n", text1.text());
+    text1.selection_all();
+    text1.selection_delete();
+    ASSERT_EQ("", text1.text());
+}
+
+TEST(TextBox, Utf8Edits)
+{
+    egt::Application app;
+
+    // positions are in code points, whatever the bytes of the characters
+    egt::TextBox text1("caf\xc3\xa9 cr\xc3\xa8me", egt::Rect(0, 0, 200, 50));
+    ASSERT_EQ(10U, text1.len());
+    text1.selection(5, 5);
+    ASSERT_EQ("cr\xc3\xa8me", text1.selected_text());
+    text1.selection_delete();
+    text1.cursor_set(3);
+    text1.insert("\xe2\x82\xac");
+    ASSERT_EQ("caf\xe2\x82\xac\xc3\xa9 ", text1.text());
+    ASSERT_EQ(6U, text1.len());
+
+    // invalid sequences are replaced when the text is set
+    text1.text("ab\xff");
+    ASSERT_EQ("ab\xef\xbf\xbd", text1.text());
+    egt::Label label("\xc3");
+    ASSERT_EQ("\xef\xbf\xbd", label.text());
+    ASSERT_EQ(1U, label.len());
+
+    const std::string ascii = "the quick brown fox jumps";
+    ASSERT_EQ(ascii.size(), egt::detail::ascii_length(ascii.data(), ascii.size()));
+    const std::string mixed = ascii + "\xc3\xa9" + ascii;
+    ASSERT_EQ(ascii.size(), egt::detail::ascii_length(mixed.data(), mixed.size()));
+}
+
+namespace
+{
+class MeasuredTextBox : public egt::TextBox
+{
+public:
+    using egt::TextBox::TextBox;
+    using egt::TextBox::point2pos;
+    using egt::TextBox::width_to_len;
+    using egt::TextBox::line_advances;
+
+    const egt::TextRects& rects() const { return m_rects; }
+};
+}
+
+TEST(TextBox, PointToPos)
+{
+    egt::Application app;
+
+    const egt::TextBox::TextFlags flags{egt::TextBox::TextFlag::multiline,
+                                        egt::TextBox::TextFlag::word_wrap};
+    MeasuredTextBox text("the quick brown fox\njumps over the lazy dog",
+                         egt::Rect(0, 0, 300, 100), egt::AlignFlag::expand, flags);
+    ASSERT_FALSE(text.rects().empty());
+
+    auto surface = egt::shared_cairo_surface_t(
+                       cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1),
+                       cairo_surface_destroy);
+    auto cr = egt::shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
+    cairo_set_scaled_font(cr.get(), text.font().scaled_font());
+
+    // a point inside of a character is at the position of the character
+    size_t pos = 0;
+    for (const auto& r : text.rects())
+    {
+        if (r.text() != "\n")
+        {
+            double advance = 0;
+            for (size_t i = 0; i < r.text().size(); ++i)
+            {
+                const egt::Point p(r.rect().x() + static_cast<int>(advance) + 1,
+                                   r.rect().center().y());
+                EXPECT_EQ(text.point2pos(p), pos + i) << r.text() << " " << i;
+
+                cairo_text_extents_t te;
+                cairo_text_extents(cr.get(), r.text().substr(i, 1).c_str(), &te);
+                advance += te.x_advance;
+            }
+        }
+        pos += r.text().size();
+    }
+
+    // below the text is the end of the text
+    EXPECT_EQ(text.point2pos(egt::Point(0, 1000)), text.len());
+}
+
+TEST(TextBox, WidthToLen)
+{
+    egt::Application app;
+
+    MeasuredTextBox text("the quick brown fox", egt::Rect(0, 0, 100, 40));
+    ASSERT_EQ(text.line_advances().size(), text.len() + 1);
+
+    // measuring only the inserted text fits as many characters as measuring
+    // the whole result
+    for (const std::string str : {"x", "jumps over", "the lazy dog"})
+    {
+        for (size_t pos = 0; pos <= text.len(); ++pos)
+        {
+            auto full = text.text();
+            full.insert(pos, str);
+            EXPECT_EQ(text.width_to_len(pos, str), text.width_to_len(full))
+                    << str << " " << pos;
+        }
+    }
+}
+
+TEST(LogView, Basic)
+{
+    egt::Application app;
+
+    egt::LogView log(egt::Rect(0, 0, 200, 100), 3);
+    ASSERT_EQ(0U, log.line_count());
+    log.append("first\nsec");
+    log.append("ond\n");
+    ASSERT_EQ(2U, log.line_count());
+    ASSERT_EQ("second", log.line(1));
+    ASSERT_EQ("first\nsecond\n", log.text());
+
+    // the oldest lines are dropped when full
+    log.append("third\nfourth\nfifth");
+    ASSERT_EQ(3U, log.line_count());
+    ASSERT_EQ("third", log.line(0));
+    ASSERT_EQ("third\nfourth\nfifth", log.text());
+    std::string line;
+    ASSERT_THROW(line = log.line(3), std::out_of_range);
+
+    log.max_lines(2);
+    ASSERT_EQ(2U, log.line_count());
+    ASSERT_EQ("fourth", log.line(0));
+
+    log.clear();
+    ASSERT_EQ(0U, log.line_count());
+    ASSERT_EQ("", log.text());
+}
+
+TEST(StreamChart, Basic)
+{
+    egt::Application app;
+
+    egt::StreamChart chart(egt::Rect(0, 0, 200, 100), 3);
+    ASSERT_EQ(1U, chart.series_count());
+    ASSERT_EQ(0U, chart.sample_count());
+    chart.append(0.5);
+    chart.append(0.25);
+    ASSERT_EQ(2U, chart.sample_count());
+    ASSERT_DOUBLE_EQ(0.25, chart.sample(0, 1));
+
+    // the oldest samples are dropped when full
+    chart.append(0.75);
+    chart.append(0.0);
+    ASSERT_EQ(3U, chart.sample_count());
+    ASSERT_DOUBLE_EQ(0.25, chart.sample(0, 0));
+    ASSERT_DOUBLE_EQ(0.0, chart.sample(0, 2));
+    double value;
+    ASSERT_THROW(value = chart.sample(0, 3), std::out_of_range);
+    ASSERT_THROW(value = chart.sample(1, 0), std::out_of_range);
+
+    chart.capacity(2);
+    ASSERT_EQ(2U, chart.sample_count());
+    ASSERT_DOUBLE_EQ(0.75, chart.sample(0, 0));
+
+    // series without a value repeat their last sample
+    ASSERT_EQ(1U, chart.add_series(egt::Palette::red));
+    ASSERT_EQ(0U, chart.sample_count());
+    chart.append({0.5, 0.25});
+    chart.append(0.75);
+    ASSERT_DOUBLE_EQ(0.25, chart.sample(1, 1));
+
+    // the range grows to show all the samples
+    chart.append(2.0);
+    ASSERT_LE(2.0, chart.range_max());
+    ASSERT_DOUBLE_EQ(0.0, chart.range_min());
+    chart.auto_range(false);
+    chart.range(0, 1);
+    chart.append(3.0);
+    ASSERT_DOUBLE_EQ(1.0, chart.range_max());
+
+    chart.clear();
+    ASSERT_EQ(0U, chart.sample_count());
+}
+
+#ifdef EGT_HAS_CHART
+TEST(Chart, Transition)
+{
+    egt::Application app;
+
+    struct TestBarChart : public egt::BarChart
+    {
+        using egt::BarChart::BarChart;
+        using egt::BarChart::damage;
+
+        void damage(const egt::Rect& rect) override
+        {
+            damaged.push_back(rect);
+        }
+
+        std::vector<egt::Rect> damaged;
+    };
+
+    struct TestPieChart : public egt::PieChart
+    {
+        using egt::PieChart::PieChart;
+        using egt::PieChart::damage;
+
+        void damage(const egt::Rect& rect) override
+        {
+            damaged.push_back(rect);
+        }
+
+        std::vector<egt::Rect> damaged;
+    };
+
+    egt::Canvas canvas(egt::Size(400, 300));
+    egt::Painter painter(canvas.context());
+
+    auto items = [](double a, double b, double c)
+    {
+        egt::ChartItemArray data;
+        data.add(a, "a");
+        data.add(b, "b");
+        data.add(c, "c");
+        return data;
+    };
+
+    // only the bar that changed is damaged, when the axes stay the same
+    TestBarChart bars(egt::Rect(0, 0, 400, 300));
+    bars.transition(std::chrono::milliseconds(0));
+    EXPECT_EQ(bars.transition(), std::chrono::milliseconds(0));
+    bars.data(items(10, 50, 30));
+    bars.draw(painter, bars.box());
+    bars.damaged.clear();
+    bars.data(items(10, 50, 20));
+    ASSERT_EQ(bars.damaged.size(), 1U);
+    EXPECT_LT(bars.damaged[0].width(), bars.content_area().width() / 2);
+
+    // a new range damages the whole chart
+    bars.damaged.clear();
+    bars.data(items(10, 80, 20));
+    ASSERT_EQ(bars.damaged.size(), 1U);
+    EXPECT_EQ(bars.damaged[0], bars.box());
+
+    // only the slices that moved are damaged
+    TestPieChart pie(egt::Rect(0, 0, 400, 300));
+    pie.transition(std::chrono::milliseconds(0));
+    pie.data(items(30, 20, 10));
+    pie.draw(painter, pie.box());
+    pie.damaged.clear();
+    pie.data(items(30, 20, 25));
+    ASSERT_EQ(pie.damaged.size(), 1U);
+    EXPECT_FALSE(pie.damaged[0].contains(pie.content_area()));
+    EXPECT_EQ(pie.data_size(), 3U);
+}
+
+namespace
+{
+/// Samples with a spike of each sign, twice as many as needed per column.
+void decimation_samples(std::vector<double>& x, std::vector<double>& y, size_t n)
+{
+    x.clear();
+    y.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        x.push_back(i);
+        y.push_back(std::sin(i * 0.01) * 10 + (i % 7));
+    }
+    y[777] = -1000;
+    y[4321] = 1000;
+}
+}
+
+TEST(Chart, DecimateMinMax)
+{
+    // 128 samples per column, so buckets never straddle columns
+    const size_t columns = 100;
+    const size_t n = 12800;
+    std::vector<double> x;
+    std::vector<double> y;
+    decimation_samples(x, y, n);
+
+    egt::detail::Decimator decimator;
+    std::vector<double> outx;
+    std::vector<double> outy;
+    ASSERT_TRUE(decimator.decimate(x, y, 0, 0, n, columns,
+                                   egt::ChartBase::Decimation::minmax, outx, outy));
+    ASSERT_EQ(outx.size(), outy.size());
+    EXPECT_LE(outx.size(), columns * 4);
+    EXPECT_TRUE(std::is_sorted(outx.begin(), outx.end()));
+    EXPECT_EQ(outx.front(), 0);
+    EXPECT_EQ(outx.back(), n - 1);
+
+    // every column keeps the extremes of its samples
+    for (size_t c = 0; c < columns; ++c)
+    {
+        const auto begin = y.begin() + c * 128;
+        const auto end = begin + 128;
+        auto low = std::numeric_limits<double>::max();
+        auto high = std::numeric_limits<double>::lowest();
+        for (size_t i = 0; i < outx.size(); ++i)
+        {
+            if (static_cast<size_t>(outx[i]) / 128 == c)
+            {
+                EXPECT_EQ(outy[i], y[static_cast<size_t>(outx[i])]);
+                low = std::min(low, outy[i]);
+                high = std::max(high, outy[i]);
+            }
+        }
+        EXPECT_EQ(low, *std::min_element(begin, end)) << c;
+        EXPECT_EQ(high, *std::max_element(begin, end)) << c;
+    }
+}
+
+TEST(Chart, DecimateIncremental)
+{
+    const size_t columns = 100;
+    std::vector<double> x;
+    std::vector<double> y;
+    decimation_samples(x, y, 12800);
+
+    // appended samples extend the pyramid
+    egt::detail::Decimator decimator;
+    std::vector<double> outx;
+    std::vector<double> outy;
+    std::vector<double> partx(x.begin(), x.begin() + 6000);
+    std::vector<double> party(y.begin(), y.begin() + 6000);
+    ASSERT_TRUE(decimator.decimate(partx, party, 0, 0, x.size(), columns,
+                                   egt::ChartBase::Decimation::minmax, outx, outy));
+    ASSERT_TRUE(decimator.decimate(x, y, 0, 0, x.size(), columns,
+                                   egt::ChartBase::Decimation::minmax, outx, outy));
+
+    egt::detail::Decimator fresh;
+    std::vector<double> expectx;
+    std::vector<double> expecty;
+    ASSERT_TRUE(fresh.decimate(x, y, 0, 0, x.size(), columns,
+                               egt::ChartBase::Decimation::minmax, expectx, expecty));
+    EXPECT_EQ(outx, expectx);
+    EXPECT_EQ(outy, expecty);
+
+    // a changed sample is only seen after invalidate()
+    y[9000] = 2000;
+    decimator.invalidate(9000);
+    ASSERT_TRUE(decimator.decimate(x, y, 0, 0, x.size(), columns,
+                                   egt::ChartBase::Decimation::minmax, outx, outy));
+    EXPECT_NE(std::find(outx.begin(), outx.end(), 9000), outx.end());
+
+    // lttb keeps about a point per column, with the first and last one
+    ASSERT_TRUE(decimator.decimate(x, y, 0, 0, x.size(), columns,
+                                   egt::ChartBase::Decimation::lttb, outx, outy));
+    EXPECT_LE(outx.size(), columns);
+    EXPECT_EQ(outx.front(), 0);
+    EXPECT_EQ(outx.back(), x.size() - 1);
+}
+
+TEST(Chart, DecimateNone)
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    decimation_samples(x, y, 12800);
+
+    egt::detail::Decimator decimator;
+    std::vector<double> outx;
+    std::vector<double> outy;
+    EXPECT_FALSE(decimator.decimate(x, y, 0, 0, x.size(), 100,
+                                    egt::ChartBase::Decimation::none, outx, outy));
+
+    // too few points per column
+    EXPECT_FALSE(decimator.decimate(x, y, 0, 0, x.size(), 4000,
+                                    egt::ChartBase::Decimation::minmax, outx, outy));
+
+    // not sorted by x
+    std::swap(x[10], x[11]);
+    decimator.invalidate();
+    EXPECT_FALSE(decimator.decimate(x, y, 0, 0, x.size(), 100,
+                                    egt::ChartBase::Decimation::minmax, outx, outy));
+    EXPECT_TRUE(outx.empty());
+}
+#endif
+
+TEST(VirtualListBox, Basic)
+{
+    egt::Application app;
+
+    size_t bound = 0;
+    egt::VirtualListBox list(10000, [&bound](egt::StringItem & item, size_t index)
+    {
+        item.text(std::to_string(index));
+        bound++;
+    }, egt::Rect(0, 0, 200, 200));
+    ASSERT_EQ(10000U, list.item_count());
+    ASSERT_EQ(0, list.selected());
+
+    // only the items shown are set up
+    ASSERT_GT(bound, 0U);
+    ASSERT_LE(bound, 20U);
+
+    list.selected(5000);
+    ASSERT_EQ(5000, list.selected());
+    list.scroll_to(5000);
+    ASSERT_LE(bound, 40U);
+
+    list.item_count(10);
+    ASSERT_EQ(9, list.selected());
+    list.item_count(0);
+    ASSERT_EQ(-1, list.selected());
+}
+
+TEST(ComboBox, SharedPopup)
+{
+    egt::Application app;
+    egt::TopWindow win;
+
+    std::vector<std::unique_ptr<egt::ComboBox>> combos;
+    for (auto c = 0; c < 20; ++c)
+    {
+        egt::ComboBox::ItemArray items;
+        for (auto i = 0; i < 100; ++i)
+            items.push_back(std::make_shared<egt::StringItem>(std::to_string(i)));
+        combos.push_back(std::make_unique<egt::ComboBox>(win, items));
+    }
+
+    // no popup until one is shown
+    ASSERT_EQ(win.count_children(), combos.size());
+    ASSERT_EQ(combos[0]->selected(), 0);
+
+    combos[0]->show_popup();
+    combos[1]->show_popup();
+    ASSERT_EQ(win.count_children(), combos.size() + 1);
+
+    combos[1]->selected(42);
+    ASSERT_EQ(combos[1]->selected(), 42);
+    combos[1]->remove_item(combos[1]->item_at(0).get());
+    ASSERT_EQ(combos[1]->selected(), 41);
+    combos[1]->hide_popup();
+}
+
+TEST(TextBoxFixed, Basic)
+{
+    egt::Application app;
+
+    std::string str1 = "hello world\nthis is EGT";
+    std::string str2 = "howdy";
+
+    egt::TextBox text1(str1, egt::Size(1000, 1000), {}, egt::TextBox::TextFlag::fit_to_width);
+    ASSERT_EQ(str1, text1.text());
+    text1.text(str2);
+    ASSERT_EQ(str2, text1.text());
+    ASSERT_EQ(str2.size(), text1.len());
+    text1.append(str1);
+    ASSERT_EQ(str2 + str1, text1.text());
+    text1.cursor_begin();
+    text1.insert(str1);
+    ASSERT_EQ(str1 + str2 + str1, text1.text());
+    text1.cursor_end();
+    text1.insert(str1);
+    ASSERT_EQ(str1 + str2 + str1 + str1, text1.text());
+    text1.selection_all();
+    ASSERT_EQ(str1 + str2 + str1 + str1, text1.selected_text());
+    text1.selection(str1.size(), 5);
+    ASSERT_EQ(str2, text1.selected_text());
+    text1.selection_clear();
+    ASSERT_EQ("", text1.selected_text());
+    text1.selection_all();
+    text1.selection_delete();
+    ASSERT_EQ("", text1.text());
+}
+
+TEST(EventLoop, FrameClock)
+{
+    egt::Application app;
+
+    const auto period = std::chrono::milliseconds(10);
+    app.event().frame_clock(true, period);
+    EXPECT_TRUE(app.event().frame_clock());
+
+    std::vector<std::chrono::steady_clock::time_point> frames;
+    auto handle = app.event().add_frame_callback([&](std::chrono::steady_clock::time_point when)
+    {
+        frames.push_back(when);
+        if (frames.size() == 3)
+            app.event().quit();
+    });
+
+    app.run();
+    app.event().remove_frame_callback(handle);
+
+    ASSERT_EQ(frames.size(), 3U);
+    EXPECT_GE(frames[1] - frames[0], period);
+    EXPECT_GE(frames[2] - frames[1], period);
+}
+
+TEST(Profiler, Basic)
+{
+    auto& profiler = egt::Profiler::instance();
+    profiler.reset();
+    profiler.enable(true);
+
+    egt::Label label;
+    label.name("needle");
+
+    {
+        egt::Profiler::Scope draw(egt::Profiler::Phase::draw);
+        {
+            egt::Profiler::Scope widget(egt::Profiler::Phase::draw, &label);
+            egt::Profiler::Scope copy(egt::Profiler::Phase::copy);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    profiler.flip_scheduled(&profiler);
+    profiler.end_frame();
+    profiler.flip_completed(&profiler, egt::Profiler::Clock::now());
+
+    // nothing drawn, so no frame
+    profiler.end_frame();
+    profiler.enable(false);
+
+    const auto frames = profiler.frames();
+    ASSERT_EQ(frames.size(), 1U);
+    EXPECT_EQ(frames[0].frame, 1U);
+    EXPECT_EQ(frames[0].draws, 1U);
+    EXPECT_GE(frames[0].phase(egt::Profiler::Phase::copy), std::chrono::milliseconds(2));
+    EXPECT_LT(frames[0].phase(egt::Profiler::Phase::draw), std::chrono::milliseconds(2));
+    EXPECT_GT(frames[0].phase(egt::Profiler::Phase::flip), std::chrono::nanoseconds());
+
+    // draw, widget, copy, and flip
+    EXPECT_EQ(profiler.events().size(), 4U);
+
+    const auto histograms = profiler.histograms();
+    ASSERT_EQ(histograms.count("needle"), 1U);
+    EXPECT_EQ(histograms.at("needle").count, 1U);
+    EXPECT_GE(histograms.at("needle").max, std::chrono::milliseconds(2));
+
+    std::ostringstream trace;
+    profiler.write_trace(trace);
+    EXPECT_NE(trace.str().find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(trace.str().find("\"needle\""), std::string::npos);
+
+    profiler.reset();
+    EXPECT_TRUE(profiler.frames().empty());
+}
+
+TEST(Profiler, InputLatency)
+{
+    auto& profiler = egt::Profiler::instance();
+    profiler.reset();
+    profiler.enable(true);
+
+    egt::Label label;
+
+    // no flip reported, so the latency ends with the frame
+    profiler.input(egt::Profiler::Clock::now() - std::chrono::milliseconds(5));
+    {
+        egt::Profiler::Scope draw(egt::Profiler::Phase::draw, &label);
+    }
+    profiler.end_frame();
+
+    // it ends with the flip when one is pending
+    profiler.input(egt::Profiler::Clock::now());
+    {
+        egt::Profiler::Scope draw(egt::Profiler::Phase::draw, &label);
+    }
+    profiler.flip_scheduled(&profiler);
+    profiler.end_frame();
+    EXPECT_EQ(profiler.frames().back().latency, std::chrono::nanoseconds());
+    profiler.flip_completed(&profiler, egt::Profiler::Clock::now() + std::chrono::milliseconds(3));
+
+    // no input, no latency
+    {
+        egt::Profiler::Scope draw(egt::Profiler::Phase::draw, &label);
+    }
+    profiler.end_frame();
+    profiler.enable(false);
+
+    const auto frames = profiler.frames();
+    ASSERT_EQ(frames.size(), 3U);
+    EXPECT_GE(frames[0].latency, std::chrono::milliseconds(5));
+    EXPECT_GE(frames[1].latency, std::chrono::milliseconds(3));
+    EXPECT_EQ(frames[2].latency, std::chrono::nanoseconds());
+    EXPECT_EQ(profiler.input_latency().count, 2U);
+
+    profiler.reset();
+    EXPECT_EQ(profiler.input_latency().count, 0U);
+}
+
+TEST(Profiler, AllocationBudget)
+{
+    auto& profiler = egt::Profiler::instance();
+    profiler.reset();
+    profiler.enable(true);
+    profiler.allocation_budget(1, egt::Profiler::BudgetAction::fail);
+
+    egt::Label label;
+    auto frame = [&]()
+    {
+        egt::Profiler::Scope draw(egt::Profiler::Phase::draw, &label);
+        egt::Profiler::Scope layout(egt::Profiler::Phase::layout);
+        std::vector<std::unique_ptr<int>> values;
+        for (auto i = 0; i < 4; ++i)
+            values.push_back(std::make_unique<int>(i));
+    };
+
+    frame();
+    if (egt::Profiler::allocation_counting())
+        EXPECT_THROW(profiler.end_frame(), std::runtime_error);
+    else
+        EXPECT_NO_THROW(profiler.end_frame());
+
+    profiler.allocation_budget(0);
+    frame();
+    EXPECT_NO_THROW(profiler.end_frame());
+    profiler.enable(false);
+
+    const auto frames = profiler.frames();
+    ASSERT_EQ(frames.size(), 2U);
+    for (const auto& f : frames)
+    {
+        if (egt::Profiler::allocation_counting())
+            EXPECT_GE(f.allocations(egt::Profiler::Phase::layout), 4U);
+        else
+            EXPECT_EQ(f.allocations(), 0U);
+        EXPECT_EQ(f.allocations(egt::Profiler::Phase::draw), 0U);
+    }
+
+    profiler.reset();
+}
+
+TEST(DrawDiagnostics, Report)
+{
+    egt::Application app;
+    egt::TopWindow window;
+    auto label = std::make_shared<egt::Label>("label", egt::Rect(10, 10, 100, 40));
+    label->name("unchanged");
+    window.add(label);
+    window.show();
+    app.event().draw();
+
+    auto& diagnostics = egt::detail::DrawDiagnostics::instance();
+    diagnostics.reset();
+    diagnostics.report(true);
+
+    // drawn again, but nothing looks different
+    label->damage();
+    app.event().draw();
+
+    diagnostics.report(false);
+
+    const auto& widgets = diagnostics.widgets();
+    const auto i = widgets.find("unchanged");
+    ASSERT_NE(i, widgets.end());
+    EXPECT_EQ(i->second.unchanged_damage, 1U);
+    EXPECT_EQ(i->second.unchanged_pixels, 100U * 40U);
+    EXPECT_EQ(i->second.hidden_draws, 0U);
+    EXPECT_EQ(diagnostics.frames(), 1U);
+    // the window, and then the label
+    EXPECT_EQ(diagnostics.max_overdraw(), 2U);
+
+    std::ostringstream report;
+    diagnostics.write_report(report);
+    EXPECT_NE(report.str().find("unchanged"), std::string::npos);
+
+    diagnostics.reset();
+}
+
+TEST(EpdRefresh, Coalesce)
+{
+    using egt::detail::EpdRefresh;
+    using egt::detail::EpdWaveform;
+
+    EpdRefresh::Config config;
+    config.full_interval = 4;
+    EpdRefresh refresh(egt::Size(800, 600), config);
+
+    // the first refresh clears the whole display
+    refresh.add(egt::Rect(10, 10, 20, 20), true);
+    auto updates = refresh.take();
+    ASSERT_EQ(updates.size(), 1U);
+    EXPECT_TRUE(updates[0].full);
+    EXPECT_FALSE(refresh.pending());
+
+    // small text changes coalesce into one fast refresh
+    for (auto x = 0; x < 50; x += 10)
+        refresh.add(egt::Rect(100 + x, 100, 15, 20), true);
+    refresh.add(egt::Rect(400, 400, 100, 100), false);
+    updates = refresh.take();
+    ASSERT_EQ(updates.size(), 2U);
+    EXPECT_EQ(updates[0].rect, egt::Rect(100, 100, 55, 20));
+    EXPECT_EQ(updates[0].waveform, EpdWaveform::fast);
+    EXPECT_EQ(updates[1].waveform, EpdWaveform::quality);
+    EXPECT_FALSE(updates[1].full);
+
+    // black and white regions over gray ones take the quality waveform
+    refresh.add(egt::Rect(0, 0, 10, 10), true);
+    refresh.add(egt::Rect(5, 5, 10, 10), false);
+    updates = refresh.take();
+    ASSERT_EQ(updates.size(), 1U);
+    EXPECT_EQ(updates[0].waveform, EpdWaveform::quality);
+    EXPECT_EQ(refresh.partials(), 3U);
+
+    // past the interval, the whole display is refreshed
+    refresh.add(egt::Rect(0, 0, 10, 10), true);
+    refresh.add(egt::Rect(200, 0, 10, 10), true);
+    updates = refresh.take();
+    ASSERT_EQ(updates.size(), 1U);
+    EXPECT_TRUE(updates[0].full);
+    EXPECT_EQ(refresh.partials(), 0U);
+
+    // and also when most of it changed
+    refresh.add(egt::Rect(0, 0, 800, 400), false);
+    updates = refresh.take();
+    ASSERT_EQ(updates.size(), 1U);
+    EXPECT_TRUE(updates[0].full);
+
+    // black text on white is monochrome, gray is not
+    egt::Canvas canvas(egt::Size(64, 32));
+    auto cr = cairo_create(canvas.surface().get());
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_paint(cr);
+    cairo_set_source_rgb(cr, 0, 0, 0);
+    cairo_rectangle(cr, 4, 4, 8, 8);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 0.5, 0.5, 0.5);
+    cairo_rectangle(cr, 40, 4, 8, 8);
+    cairo_fill(cr);
+    cairo_destroy(cr);
+    EXPECT_TRUE(EpdRefresh::monochrome(canvas.surface().get(), egt::Rect(0, 0, 32, 32)));
+    EXPECT_FALSE(EpdRefresh::monochrome(canvas.surface().get(), egt::Rect(32, 0, 32, 32)));
+}
+
+TEST(Screen, DamageAlgorithm)
+{
+    egt::Screen::DamageArray damage;
+    egt::Screen::damage_algorithm(damage, egt::Rect(0, 0, 100, 100));
+    EXPECT_EQ(damage.front(), egt::Rect(0, 0, 100, 100));
+    egt::Screen::damage_algorithm(damage, egt::Rect(0, 0, 200, 200));
+    EXPECT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage.front(), egt::Rect(0, 0, 200, 200));
+}
+
+TEST(Screen, DamageAlgorithmCost)
+{
+    egt::Screen::DamageCost cost;
+    egt::Screen::DamageArray damage;
+
+    // two far apart rectangles sharing a small overlapping one stay separate
+    egt::Screen::damage_algorithm(damage, egt::Rect(0, 0, 50, 50), cost);
+    egt::Screen::damage_algorithm(damage, egt::Rect(950, 550, 50, 50), cost);
+    egt::Screen::damage_algorithm(damage, egt::Rect(40, 40, 920, 20), cost);
+    EXPECT_EQ(damage.size(), 3U);
+
+    // a covered rectangle is dropped
+    egt::Screen::damage_algorithm(damage, egt::Rect(10, 10, 10, 10), cost);
+    EXPECT_EQ(damage.size(), 3U);
+
+    // adjacent rectangles merge without waste
+    egt::Screen::damage_algorithm(damage, egt::Rect(50, 0, 50, 50), cost);
+    EXPECT_EQ(damage.size(), 3U);
+
+    cost.max_rects = 4;
+    damage.clear();
+    for (auto i = 0; i < 10; i++)
+        egt::Screen::damage_algorithm(damage, egt::Rect(i * 100, i * 50, 10, 10), cost);
+    EXPECT_LE(damage.size(), 4U);
+
+    damage.clear();
+    for (auto i = 0; i < 100; i++)
+        damage.emplace_back(i * 10, (i % 10) * 60, 10, 10);
+    egt::Screen::damage_optimize(damage, cost);
+    EXPECT_LE(damage.size(), 4U);
+}
+
+namespace
+{
+class BufferedScreen : public egt::Screen
+{
+public:
+    explicit BufferedScreen(uint32_t count, uint32_t degrees = 0,
+                            egt::PixelFormat format = egt::PixelFormat::argb8888)
+        : m_memory(count, std::vector<uint32_t>(100 * 100))
+    {
+        std::vector<void*> ptrs;
+        for (auto& m : m_memory)
+            ptrs.push_back(m.data());
+        rotation(degrees, false);
+        init(ptrs.data(), count, egt::Size(100, 100), format);
+    }
+
+    uint32_t pixel(uint32_t buffer, int x, int y) const
+    {
+        return m_memory[buffer][y * 100 + x];
+    }
+
+    /// Pixel of a buffer with 8 bits per pixel.
+    uint8_t pixel8(uint32_t buffer, int x, int y) const
+    {
+        return reinterpret_cast<const uint8_t*>(m_memory[buffer].data())[y * 100 + x];
+    }
+
+    void schedule_flip() override
+    {
+        m_index = (m_index + 1) % m_memory.size();
+    }
+
+    uint32_t index() override { return m_index; }
+
+    bool flip_ready() const override { return !busy; }
+
+    /// Pretend every buffer waits to be flipped.
+    bool busy{false};
+
+private:
+    std::vector<std::vector<uint32_t>> m_memory;
+    uint32_t m_index{0};
+};
+}
+
+TEST(TileDamage, Extract)
+{
+    egt::detail::TileDamage tiles(egt::Size(100, 100), egt::Size(10, 10));
+    EXPECT_TRUE(tiles.empty());
+
+    // a rectangle marks every tile it touches
+    tiles.damage(egt::Rect(5, 5, 10, 2));
+    EXPECT_FALSE(tiles.empty());
+
+    egt::Screen::DamageArray damage;
+    tiles.extract(damage);
+    ASSERT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage[0], egt::Rect(0, 0, 20, 10));
+
+    // extracting clears the grid
+    EXPECT_TRUE(tiles.empty());
+    damage.clear();
+    tiles.extract(damage);
+    EXPECT_TRUE(damage.empty());
+
+    tiles.damage(egt::Rect(0, 0, 10, 10));
+    tiles.clear();
+    EXPECT_TRUE(tiles.empty());
+    tiles.extract(damage);
+    EXPECT_TRUE(damage.empty());
+}
+
+TEST(TileDamage, Coalesce)
+{
+    egt::detail::TileDamage tiles(egt::Size(100, 100), egt::Size(10, 10));
+
+    // identical runs in consecutive rows become one rectangle, and a run
+    // that differs starts another
+    tiles.damage(egt::Rect(10, 10, 30, 30));
+    tiles.damage(egt::Rect(10, 40, 10, 10));
+    tiles.damage(egt::Rect(70, 10, 10, 10));
+
+    egt::Screen::DamageArray damage;
+    tiles.extract(damage);
+    ASSERT_EQ(damage.size(), 3U);
+    std::sort(damage.begin(), damage.end(), [](const egt::Rect & a, const egt::Rect & b)
+    {
+        return std::make_tuple(a.y(), a.x()) < std::make_tuple(b.y(), b.x());
+    });
+    EXPECT_EQ(damage[0], egt::Rect(10, 10, 30, 30));
+    EXPECT_EQ(damage[1], egt::Rect(70, 10, 10, 10));
+    EXPECT_EQ(damage[2], egt::Rect(10, 40, 10, 10));
+
+    // runs crossing a word of the bitmap are not split
+    egt::detail::TileDamage wide(egt::Size(1000, 10), egt::Size(10, 10));
+    wide.damage(egt::Rect(600, 0, 100, 10));
+    damage.clear();
+    wide.extract(damage);
+    ASSERT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage[0], egt::Rect(600, 0, 100, 10));
+}
+
+TEST(TileDamage, Edges)
+{
+    // the last column and row of tiles are partial
+    egt::detail::TileDamage tiles(egt::Size(95, 45), egt::Size(10, 10));
+
+    tiles.damage(egt::Rect(80, 30, 100, 100));
+    tiles.damage(egt::Rect(-10, -10, 5, 5));
+
+    egt::Screen::DamageArray damage;
+    tiles.extract(damage);
+    ASSERT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage[0], egt::Rect(80, 30, 15, 15));
+}
+
+TEST(TileDamage, Resize)
+{
+    egt::detail::TileDamage tiles(egt::Size(100, 100), egt::Size(10, 10));
+    tiles.damage(egt::Rect(20, 20, 10, 10));
+    tiles.damage(egt::Rect(80, 80, 10, 10));
+
+    // pending damage survives a resize, clipped to the new area
+    tiles.resize(egt::Size(50, 200));
+    EXPECT_EQ(tiles.area(), egt::Size(50, 200));
+
+    egt::Screen::DamageArray damage;
+    tiles.extract(damage);
+    ASSERT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage[0], egt::Rect(20, 20, 10, 10));
+
+    // the new area can be damaged in full
+    tiles.damage(egt::Rect(0, 0, 50, 200));
+    damage.clear();
+    tiles.extract(damage);
+    ASSERT_EQ(damage.size(), 1U);
+    EXPECT_EQ(damage[0], egt::Rect(0, 0, 50, 200));
+}
+
+TEST(Screen, BufferAge)
+{
+    BufferedScreen screen(3);
+
+    // every buffer starts out undefined and gets a full copy
+    for (auto i = 0; i < 3; i++)
+        screen.flip({egt::Rect(0, 0, 10, 10)});
+    EXPECT_EQ(screen.flip_stats().frames, 3U);
+    EXPECT_EQ(screen.flip_stats().damaged_pixels, 300U);
+    EXPECT_EQ(screen.flip_stats().copied_pixels, 30000U);
+
+    // afterwards, only the damage of the frames a buffer missed is copied
+    screen.reset_flip_stats();
+    screen.flip({egt::Rect(50, 50, 10, 10)});
+    EXPECT_EQ(screen.flip_stats().damaged_pixels, 100U);
+    EXPECT_EQ(screen.flip_stats().copied_pixels, 200U);
+
+    screen.flip({egt::Rect(50, 50, 10, 10)});
+    EXPECT_EQ(screen.flip_stats().copied_pixels, 400U);
+}
+
+TEST(Screen, AddDamageBatch)
+{
+    BufferedScreen screen(1);
+    screen.damage_mode(egt::Screen::DamageMode::cost);
+
+    const auto covered = [](const egt::Screen::DamageArray & damage,
+                            const egt::Rect & rect)
+    {
+        for (const auto& d : damage)
+            if (egt::Rect::intersection(d, rect) == rect)
+                return true;
+        return false;
+    };
+
+    // a budget beyond the incremental limit is kept by batch compaction
+    egt::Screen::DamageCost cost;
+    cost.max_rects = 40;
+    screen.damage_cost(cost);
+
+    egt::Screen::DamageArray damage;
+    for (auto i = 0; i < 100; i++)
+    {
+        const egt::Rect rect(i * 10, (i % 10) * 60, 5, 5);
+        screen.add_damage(damage, rect);
+        EXPECT_LE(damage.size(), 40U);
+    }
+    for (auto i = 0; i < 100; i++)
+        EXPECT_TRUE(covered(damage, egt::Rect(i * 10, (i % 10) * 60, 5, 5)));
+
+    // without a budget, compaction only merges what is cheap to merge
+    cost.max_rects = 0;
+    screen.damage_cost(cost);
+    damage.clear();
+    for (auto i = 0; i < 100; i++)
+        screen.add_damage(damage, egt::Rect(i * 10, (i % 10) * 60, 5, 5));
+    EXPECT_EQ(damage.size(), 100U);
+    for (auto i = 0; i < 100; i++)
+        EXPECT_TRUE(covered(damage, egt::Rect(i * 10, (i % 10) * 60, 5, 5)));
+}
+
+TEST(ComposerScreen, Export)
+{
+    const auto path = "/tmp/egt-composer-" + std::to_string(getpid());
+    egt::detail::ComposerScreen screen(egt::Size(20, 10));
+    ASSERT_TRUE(screen.export_to(path));
+    auto header = screen.export_header();
+    ASSERT_NE(header, nullptr);
+    EXPECT_EQ(header->magic, egt::detail::ComposerScreen::ExportHeader::MAGIC);
+    EXPECT_EQ(header->width, 20U);
+    EXPECT_EQ(header->height, 10U);
+
+    // the first frame is published whole
+    auto cr = screen.context().get();
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    cairo_paint(cr);
+    screen.flip({screen.box()});
+    EXPECT_EQ(header->sequence.load(), 2U);
+    EXPECT_EQ(header->damage_count, 0U);
+
+    cairo_set_source_rgb(cr, 0, 0, 1);
+    cairo_rectangle(cr, 2, 2, 3, 3);
+    cairo_fill(cr);
+    screen.flip({egt::Rect(2, 2, 3, 3)});
+    EXPECT_EQ(header->sequence.load(), 4U);
+    ASSERT_EQ(header->damage_count, 1U);
+    EXPECT_EQ(header->damage[0][0], 2);
+    EXPECT_EQ(header->damage[0][3], 3);
+
+    // what another process sees in the file
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_GE(file.size(), header->offset + header->stride * 10);
+    const auto pixel = [&](int x, int y)
+    {
+        uint32_t value;
+        std::memcpy(&value, file.data() + header->offset + y * header->stride + x * 4, 4);
+        return value;
+    };
+    EXPECT_EQ(pixel(0, 0), 0xffff0000);
+    EXPECT_EQ(pixel(3, 3), 0xff0000ff);
+
+    EXPECT_TRUE(screen.export_to(""));
+    EXPECT_EQ(screen.export_header(), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(ComposerScreen, LayoutCache)
+{
+    egt::Application app;
+    egt::TopWindow window;
+
+    struct CountingSizer : public egt::VerticalBoxSizer
+    {
+        using egt::VerticalBoxSizer::VerticalBoxSizer;
+
+        void layout() override
+        {
+            ++layouts;
+            egt::VerticalBoxSizer::layout();
+        }
+
+        size_t layouts{0};
+    };
+
+    auto sizer = std::make_shared<CountingSizer>();
+    window.add(egt::expand(sizer));
+    auto label = std::make_shared<egt::Label>("label");
+    // a local font following the screen size
+    label->font(egt::Font());
+    sizer->add(label);
+    window.show();
+    app.event().draw();
+
+    egt::detail::ComposerScreen screen(egt::Size(800, 480));
+    screen.resize(egt::Size(480, 800));
+    EXPECT_GT(sizer->layouts, 0U);
+    const auto portrait = label->box();
+
+    // coming back to a size restores its layout
+    sizer->layouts = 0;
+    screen.resize(egt::Size(800, 480));
+    EXPECT_EQ(sizer->layouts, 0U);
+    screen.resize(egt::Size(480, 800));
+    EXPECT_EQ(sizer->layouts, 0U);
+    EXPECT_EQ(label->box(), portrait);
+
+    // a change to the tree lays it out again
+    sizer->add(std::make_shared<egt::Label>("other"));
+    app.event().draw();
+    sizer->layouts = 0;
+    screen.resize(egt::Size(800, 480));
+    EXPECT_GT(sizer->layouts, 0U);
+}
+
+TEST(Screen, Rotation)
+{
+    BufferedScreen screen(1, 90);
+    EXPECT_EQ(screen.rotation(), 90U);
+    EXPECT_FALSE(screen.hardware_rotation());
+    EXPECT_EQ(screen.rotate_point(egt::DisplayPoint(99, 10)), egt::DisplayPoint(10, 0));
+    EXPECT_EQ(screen.buffer_rect(egt::Rect(0, 0, 10, 20)), egt::Rect(80, 0, 20, 10));
+
+    // the top left corner of the screen lands in the top right of the buffer
+    auto cr = screen.context().get();
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    cairo_rectangle(cr, 0, 0, 1, 1);
+    cairo_fill(cr);
+    screen.flip({egt::Rect(0, 0, 1, 1)});
+    EXPECT_EQ(screen.pixel(0, 99, 0), 0xffff0000);
+    EXPECT_NE(screen.pixel(0, 0, 0), 0xffff0000);
+}
+
+TEST(Screen, Format8bpp)
+{
+    BufferedScreen screen(1, 90, egt::PixelFormat::rgb332);
+    EXPECT_FALSE(screen.zero_copy(true));
+
+    // composed in 32 bits, and converted while rotated to the buffer
+    auto cr = screen.context().get();
+    EXPECT_EQ(cairo_image_surface_get_format(cairo_get_target(cr)), CAIRO_FORMAT_ARGB32);
+    cairo_set_source_rgb(cr, 1, 0, 0);
+    cairo_rectangle(cr, 0, 0, 1, 1);
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_rectangle(cr, 1, 0, 1, 1);
+    cairo_fill(cr);
+    screen.flip({egt::Rect(0, 0, 2, 1)});
+    EXPECT_EQ(screen.pixel8(0, 99, 0), 0xe0);
+    EXPECT_EQ(screen.pixel8(0, 99, 1), 0xff);
+}
+
+TEST(RfbServer, Update)
+{
+    BufferedScreen screen(1);
+    egt::experimental::RfbServer server(screen, 0);
+
+    egt::asio::io_context io;
+    egt::asio::ip::tcp::socket socket(io);
+    socket.connect({egt::asio::ip::address_v4::loopback(), server.port()});
+
+    char version[12];
+    egt::asio::read(socket, egt::asio::buffer(version));
+    EXPECT_EQ(std::string(version, sizeof(version)), "RFB 003.008\n");
+    egt::asio::write(socket, egt::asio::buffer(version));
+
+    // security type None, then a shared session
+    uint8_t security[2];
+    egt::asio::read(socket, egt::asio::buffer(security));
+    EXPECT_EQ(security[0], 1);
+    EXPECT_EQ(security[1], 1);
+    const uint8_t none = 1;
+    egt::asio::write(socket, egt::asio::buffer(&none, 1));
+    uint8_t result[4];
+    egt::asio::read(socket, egt::asio::buffer(result));
+    EXPECT_EQ(result[3], 0);
+    const uint8_t shared = 1;
+    egt::asio::write(socket, egt::asio::buffer(&shared, 1));
+
+    uint8_t init[24];
+    egt::asio::read(socket, egt::asio::buffer(init));
+    EXPECT_EQ((init[0] << 8) | init[1], 100);
+    EXPECT_EQ((init[2] << 8) | init[3], 100);
+    EXPECT_EQ(init[4], 32);
+    std::vector<uint8_t> name((init[20] << 24) | (init[21] << 16) |
+                              (init[22] << 8) | init[23]);
+    egt::asio::read(socket, egt::asio::buffer(name));
+
+    // without SetEncodings, a full update comes back raw
+    const uint8_t request[10] = {3, 0, 0, 0, 0, 0, 0, 100, 0, 100};
+    egt::asio::write(socket, egt::asio::buffer(request));
+    uint8_t header[4];
+    egt::asio::read(socket, egt::asio::buffer(header));
+    EXPECT_EQ(header[0], 0);
+    EXPECT_GE((header[2] << 8) | header[3], 1);
+}
+
+TEST(Window, Output)
+{
+    egt::Application app;
+    egt::TopWindow top;
+    top.show();
+
+    BufferedScreen screen(1);
+    egt::Window window;
+    window.output(screen);
+    EXPECT_EQ(window.screen(), &screen);
+    EXPECT_EQ(window.box(), screen.box());
+    window.color(egt::Palette::ColorId::bg, egt::Palette::red);
+    window.show();
+
+    // a busy output keeps the damage of its windows for a later frame
+    screen.busy = true;
+    app.event().draw();
+    EXPECT_EQ(screen.flip_stats().frames, 0U);
+
+    screen.busy = false;
+    app.event().draw();
+    EXPECT_EQ(screen.flip_stats().frames, 1U);
+    EXPECT_EQ(screen.pixel(0, 50, 50), 0xffff0000);
+
+    EXPECT_THROW(top.output(screen), std::runtime_error);
+}
+
+TEST(Window, AutoZeroCopy)
+{
+    egt::Application app;
+    egt::TopWindow top;
+    top.show();
+
+    BufferedScreen screen(2);
+    screen.auto_zero_copy(true);
+    egt::Window window;
+    window.output(screen);
+    window.color(egt::Palette::ColorId::bg, egt::Palette::red);
+    window.show();
+
+    // alone and opaque on its screen for a while
+    for (auto i = 0; i < 10; i++)
+    {
+        window.damage();
+        app.event().draw();
+    }
+    EXPECT_TRUE(screen.zero_copy());
+
+    // a composed window on top of it brings the composition back
+    egt::Window popup(window, egt::Rect(10, 10, 20, 20));
+    popup.show();
+    app.event().draw();
+    EXPECT_FALSE(screen.zero_copy());
+    EXPECT_EQ(screen.pixel(1, 50, 50), 0xffff0000);
+}
+
+namespace
+{
+struct CountingFrame : public egt::Frame
+{
+    using egt::Frame::Frame;
+
+    void draw(egt::Painter& painter, const egt::Rect& rect) override
+    {
+        ++draws;
+        egt::Frame::draw(painter, rect);
+    }
+
+    int draws{0};
+};
+}
+
+TEST(Window, Backdrop)
+{
+    egt::Application app;
+    egt::TopWindow top;
+    top.show();
+
+    BufferedScreen screen(1);
+    egt::Window window;
+    window.output(screen);
+    window.color(egt::Palette::ColorId::bg, egt::Palette::white);
+    CountingFrame behind(egt::Rect(0, 0, 40, 40));
+    behind.fill_flags(egt::Theme::FillFlag::solid);
+    behind.color(egt::Palette::ColorId::bg, egt::Palette::red);
+    window.add(behind);
+    window.show();
+
+    egt::Popup popup(egt::Size(20, 20), egt::Point(50, 50));
+    popup.backdrop(egt::Color(0, 0, 0, 0x80));
+    window.add(popup);
+    popup.show();
+    app.event().draw();
+    EXPECT_EQ(screen.pixel(0, 5, 5), 0xff7f0000);
+    EXPECT_EQ(screen.pixel(0, 80, 80), 0xff7f7f7f);
+
+    // moving the popup paints what was under it from the snapshot
+    const auto draws = behind.draws;
+    popup.move(egt::Point(30, 30));
+    app.event().draw();
+    EXPECT_EQ(behind.draws, draws);
+    EXPECT_EQ(screen.pixel(0, 60, 60), 0xff7f7f7f);
+
+    // damage under the popup is rendered again
+    behind.color(egt::Palette::ColorId::bg, egt::Palette::blue);
+    app.event().draw();
+    EXPECT_GT(behind.draws, draws);
+    EXPECT_EQ(screen.pixel(0, 5, 5), 0xff00007f);
+
+    popup.hide();
+    app.event().draw();
+    EXPECT_EQ(screen.pixel(0, 5, 5), 0xff0000ff);
+}
+
+TEST(Window, Animating)
+{
+    egt::Application app;
+    egt::TopWindow top;
+    top.show();
+
+    // without a free plane the board slides composed
+    egt::SideBoard board;
+    board.show();
+    board.open();
+    EXPECT_TRUE(board.animating());
+    EXPECT_FALSE(board.plane_window());
+
+    board.close();
+    EXPECT_TRUE(board.animating());
+
+    // the main window is never moved to a plane
+    top.animating(true);
+    EXPECT_FALSE(top.plane_window());
+    top.animating(false);
+    EXPECT_FALSE(top.animating());
+}
+
+TEST(PixelOps, Kernels)
+{
+    // odd widths exercise both the vector and the scalar tails
+    const size_t width = 13;
+    const size_t height = 3;
+    std::vector<uint32_t> src(width * height);
+    for (size_t i = 0; i < src.size(); i++)
+        src[i] = 0x80000000 | (i * 0x0a0b0c);
+
+    std::vector<uint32_t> copy(width * height);
+    egt::detail::copy_rect(reinterpret_cast<const uint8_t*>(src.data()), width * 4,
+                           reinterpret_cast<uint8_t*>(copy.data()), width * 4,
+                           width * 4, height);
+    EXPECT_EQ(src, copy);
+
+    const std::vector<uint16_t> grid = {1, 2, 3, 4, 5, 6};
+    std::vector<uint16_t> rotated(grid.size());
+    egt::detail::rotate_rect(reinterpret_cast<const uint8_t*>(grid.data()), 3 * 2,
+                             reinterpret_cast<uint8_t*>(rotated.data()), 2 * 2,
+                             3, 2, 2, 90);
+    EXPECT_EQ(rotated, std::vector<uint16_t>({4, 1, 5, 2, 6, 3}));
+    egt::detail::rotate_rect(reinterpret_cast<const uint8_t*>(grid.data()), 3 * 2,
+                             reinterpret_cast<uint8_t*>(rotated.data()), 2 * 2,
+                             3, 2, 2, 270);
+    EXPECT_EQ(rotated, std::vector<uint16_t>({3, 6, 2, 5, 1, 4}));
+
+    std::vector<uint32_t> rgb = {0xffff0000, 0xff00ff00, 0xff0000ff, 0x00ffffff, 0xff000000};
+    std::vector<uint16_t> rgb565(rgb.size());
+    egt::detail::argb8888_to_rgb565(rgb.data(), rgb.size() * 4,
+                                    rgb565.data(), rgb565.size() * 2, rgb.size(), 1);
+    EXPECT_EQ(rgb565, std::vector<uint16_t>({0xf800, 0x07e0, 0x001f, 0xffff, 0x0000}));
+
+    std::vector<uint8_t> l8(rgb.size());
+    egt::detail::argb8888_to_l8(rgb.data(), rgb.size() * 4, l8.data(), l8.size(), rgb.size(), 1);
+    EXPECT_EQ(l8, std::vector<uint8_t>({77, 149, 29, 255, 0}));
+
+    std::vector<uint8_t> rgb332(rgb.size());
+    egt::detail::argb8888_to_rgb332(rgb.data(), rgb.size() * 4, rgb332.data(), rgb332.size(),
+                                    rgb.size(), 1, 0, 0, false);
+    EXPECT_EQ(rgb332, std::vector<uint8_t>({0xe0, 0x1c, 0x03, 0xff, 0x00}));
+    EXPECT_EQ(egt::detail::rgb332_palette()[0xe0], 0xffff0000);
+    EXPECT_EQ(egt::detail::rgb332_palette()[0xff], 0xffffffff);
+
+    // the dither pattern follows the position in the frame, so converting
+    // pixel by pixel matches converting whole rows
+    std::vector<uint8_t> dithered(width * height);
+    egt::detail::argb8888_to_rgb332(src.data(), width * 4, dithered.data(), width,
+                                    width, height, 5, 6, true);
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            uint8_t one = 0;
+            egt::detail::argb8888_to_rgb332(&src[y * width + x], 4, &one, 1,
+                                            1, 1, 5 + x, 6 + y, true);
+            EXPECT_EQ(dithered[y * width + x], one);
+        }
+    }
+
+    // premultiplied 50% white over opaque blue, opaque over anything, and nothing
+    std::vector<uint32_t> over = {0x80808080, 0xff123456, 0x00000000};
+    std::vector<uint32_t> dst = {0xff0000ff, 0xff0000ff, 0xff0000ff};
+    egt::detail::blend_over(over.data(), over.size() * 4, dst.data(), dst.size() * 4, dst.size(), 1);
+    EXPECT_EQ(dst, std::vector<uint32_t>({0xff8080ff, 0xff123456, 0xff0000ff}));
+
+    // a blur keeps a flat color, and spreads a single pixel evenly
+    std::vector<uint32_t> flat(5 * 5, 0xff204060);
+    egt::detail::box_blur(flat.data(), 5 * 4, 5, 5, 2);
+    EXPECT_EQ(flat, std::vector<uint32_t>(5 * 5, 0xff204060));
+    std::vector<uint32_t> dot(3, 0);
+    dot[1] = 0xffffffff;
+    egt::detail::box_blur(dot.data(), 3 * 4, 3, 1, 1);
+    EXPECT_EQ(dot, std::vector<uint32_t>({0x55555555, 0x55555555, 0x55555555}));
+
+    // the ends of a mix are exact
+    std::vector<uint32_t> from(5, 0xff0000ff);
+    std::vector<uint32_t> to(5, 0x80ff0000);
+    std::vector<uint32_t> mixed(5);
+    egt::detail::mix_argb8888(from.data(), to.data(), mixed.data(), mixed.size(), 0);
+    EXPECT_EQ(mixed, from);
+    egt::detail::mix_argb8888(from.data(), to.data(), mixed.data(), mixed.size(), 256);
+    EXPECT_EQ(mixed, to);
+    egt::detail::mix_argb8888(from.data(), to.data(), mixed.data(), mixed.size(), 128);
+    EXPECT_EQ(mixed, std::vector<uint32_t>(5, 0xbf7f007f));
+
+    const std::vector<uint32_t> lut = {1, 2, 3};
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    const std::vector<float> positions = {0.f, 0.2f, 0.3f, 0.7f, 1.f, 2.f, -1.f, nan};
+    std::vector<uint32_t> looked(positions.size());
+    egt::detail::lut_lookup(lut.data(), lut.size(), positions.data(), looked.data(), looked.size());
+    EXPECT_EQ(looked, std::vector<uint32_t>({1, 1, 2, 2, 3, 3, 1, 1}));
+}
+
+TEST(Easing, Table)
+{
+    const egt::easing_table bounce(egt::easing_bounce, 1024);
+    EXPECT_EQ(bounce.samples(), 1024U);
+    EXPECT_FLOAT_EQ(bounce(0), egt::easing_bounce(0));
+    EXPECT_FLOAT_EQ(bounce(1), egt::easing_bounce(1));
+
+    // odd count exercises both the vector and the scalar tails
+    std::vector<egt::EasingScalar> progress;
+    for (auto i = -2; i <= 102; ++i)
+        progress.push_back(i / 100.f);
+    std::vector<egt::EasingScalar> values(progress.size());
+    bounce(progress.data(), values.data(), progress.size());
+
+    for (size_t i = 0; i < progress.size(); ++i)
+    {
+        const auto p = std::min(std::max(progress[i], 0.f), 1.f);
+        EXPECT_NEAR(values[i], egt::easing_bounce(p), 0.01f);
+        EXPECT_NEAR(values[i], bounce(progress[i]), 1e-6f);
+    }
+
+    // usable anywhere an easing function is
+    egt::EasingFunc func = bounce;
+    EXPECT_FLOAT_EQ(func(0.5f), bounce(0.5f));
+}
+
+TEST(Fixed, Accuracy)
+{
+    using egt::detail::Fixed;
+
+    EXPECT_EQ(Fixed::from_int(3).raw(), 3 * Fixed::ONE);
+    EXPECT_FLOAT_EQ((Fixed::from_float(1.5f) * Fixed::from_float(-2.25f)).to_float(), -3.375f);
+    EXPECT_FLOAT_EQ((Fixed::from_int(7) / Fixed::from_int(2)).to_float(), 3.5f);
+    EXPECT_EQ(Fixed::ratio(1, 3).raw(), Fixed::ONE / 3);
+
+    // rounds like std::round()
+    for (auto v = -10.f; v <= 10.f; v += 0.25f)
+        EXPECT_EQ(Fixed::from_float(v).to_int(), static_cast<int>(std::round(v))) << v;
+
+    // integer percentages truncate like the floating point path
+    for (auto length = 0; length <= 1920; length += 7)
+    {
+        for (auto percent = 0; percent <= 100; ++percent)
+        {
+            const auto expected = static_cast<int>(static_cast<float>(length) *
+                                                   (static_cast<float>(percent) / 100.0f));
+            EXPECT_NEAR(egt::detail::percent_of(length, percent), expected, 1);
+        }
+    }
+
+    const std::pair<const char*, egt::EasingScalar(*)(egt::EasingScalar)> funcs[] =
+    {
+        {"linear", egt::easing_linear},
+        {"easy", egt::easing_easy},
+        {"extend", egt::easing_extend},
+        {"bounce", egt::easing_bounce},
+        {"rubber", egt::easing_rubber},
+        {"spring", egt::easing_spring},
+        {"boing", egt::easing_boing},
+        {"cubic_easeinout", egt::easing_cubic_easeinout},
+        {"sine_easeinout", egt::easing_sine_easeinout},
+        {"circular_easeout", egt::easing_circular_easeout},
+        {"exponential_easeinout", egt::easing_exponential_easeinout},
+    };
+
+    for (const auto& func : funcs)
+    {
+        const auto table = egt::detail::FixedEasing::cached(func.second);
+        ASSERT_NE(table, nullptr);
+        EXPECT_EQ(table, egt::detail::FixedEasing::cached(func.second));
+
+        for (auto i = 0; i <= 200; ++i)
+        {
+            const auto p = i / 200.f;
+            EXPECT_NEAR((*table)(Fixed::from_float(p)).to_float(), func.second(p), 0.005f)
+                    << func.first << " at " << p;
+
+            // what an animation from 0 to 800 gets, rounded
+            const auto eased = (*table)(Fixed::from_float(p));
+            const auto value = (Fixed::from_int(800) * eased).to_int();
+            EXPECT_NEAR(value, std::round(egt::detail::interpolate(func.second, p, 0.f, 800.f)), 2)
+                    << func.first << " at " << p;
+        }
+    }
+
+    // functors are not the same curve every time
+    EXPECT_EQ(egt::detail::FixedEasing::cached(egt::easing_cubic_bezier()), nullptr);
+}
+
+TEST(Canvas, Basic)
+{
+    egt::Canvas canvas1(egt::Size(100, 100));
+    EXPECT_EQ(canvas1.size(), egt::Size(100, 100));
+    EXPECT_EQ(canvas1.format(), egt::PixelFormat::argb8888);
+    egt::Canvas canvas2(canvas1.surface());
+    EXPECT_EQ(canvas2.size(), egt::Size(100, 100));
+    EXPECT_EQ(canvas2.format(), egt::PixelFormat::argb8888);
+
+    egt::Canvas canvas3(egt::Size(100, 100), egt::PixelFormat::rgb565);
+    EXPECT_EQ(canvas3.size(), egt::Size(100, 100));
+    EXPECT_EQ(canvas3.format(), egt::PixelFormat::rgb565);
+
+    egt::Canvas canvas4(canvas3.surface());
+    EXPECT_EQ(canvas4.size(), egt::Size(100, 100));
+    EXPECT_EQ(canvas4.format(), egt::PixelFormat::rgb565);
+}
+
+TEST(Canvas, DisplayList)
+{
+    egt::DisplayList list(egt::Size(100, 100), 3);
+
+    auto square = [&list](const egt::Rect & rect, const egt::Color & color)
+    {
+        return list.record([rect, color](egt::Painter & painter)
+        {
+            painter.set(color);
+            painter.draw(rect);
+            painter.fill();
+        });
+    };
+
+    EXPECT_EQ(square(egt::Rect(10, 10, 20, 20), egt::Palette::red), egt::Rect(10, 10, 20, 20));
+    EXPECT_EQ(square(egt::Rect(90, 90, 20, 20), egt::Palette::blue), egt::Rect(90, 90, 10, 10));
+    EXPECT_TRUE(square(egt::Rect(200, 200, 20, 20), egt::Palette::blue).empty());
+    EXPECT_EQ(list.size(), 2U);
+    EXPECT_EQ(list.bounding_box(), egt::Rect(10, 10, 90, 90));
+
+    // only the damaged area is drawn
+    const auto pixel = [&list](const egt::Rect & rect, const egt::Point & point)
+    {
+        egt::Canvas canvas(egt::Size(100, 100));
+        canvas.zero();
+        egt::Painter painter(canvas.context());
+        list.draw(painter, rect);
+        cairo_surface_flush(canvas.surface().get());
+        const auto data = cairo_image_surface_get_data(canvas.surface().get());
+        const auto stride = cairo_image_surface_get_stride(canvas.surface().get());
+        return *reinterpret_cast<uint32_t*>(data + point.y() * stride + point.x() * 4);
+    };
+
+    EXPECT_EQ(pixel(egt::Rect(0, 0, 100, 100), egt::Point(15, 15)), 0xffff0000);
+    EXPECT_EQ(pixel(egt::Rect(0, 0, 100, 100), egt::Point(95, 95)), 0xff0000ff);
+    EXPECT_EQ(pixel(egt::Rect(50, 50, 50, 50), egt::Point(15, 15)), 0U);
+
+    // the threshold flattens to the bitmap layer, which draws the same
+    square(egt::Rect(40, 40, 10, 10), egt::Palette::red);
+    square(egt::Rect(60, 60, 10, 10), egt::Palette::red);
+    EXPECT_EQ(list.size(), 1U);
+    EXPECT_EQ(pixel(egt::Rect(0, 0, 100, 100), egt::Point(15, 15)), 0xffff0000);
+    EXPECT_EQ(pixel(egt::Rect(0, 0, 100, 100), egt::Point(65, 65)), 0xffff0000);
+
+    list.clear();
+    EXPECT_EQ(list.size(), 0U);
+    EXPECT_TRUE(list.bounding_box().empty());
+    EXPECT_EQ(pixel(egt::Rect(0, 0, 100, 100), egt::Point(15, 15)), 0U);
+}
+
+TEST(Canvas, DrawImage)
+{
+    // half transparent red, premultiplied
+    egt::Canvas source(egt::Size(20, 20));
+    {
+        egt::Painter painter(source.context());
+        cairo_set_operator(painter.context().get(), CAIRO_OPERATOR_SOURCE);
+        painter.set(egt::Color(0xff000080));
+        painter.paint();
+    }
+    const egt::Image image(source.surface());
+
+    egt::Canvas canvas(egt::Size(100, 100));
+    egt::Painter painter(canvas.context());
+    painter.set(egt::Palette::white);
+    painter.paint();
+
+    const auto pixel = [&canvas](int x, int y)
+    {
+        cairo_surface_flush(canvas.surface().get());
+        const auto data = cairo_image_surface_get_data(canvas.surface().get());
+        const auto stride = cairo_image_surface_get_stride(canvas.surface().get());
+        return *reinterpret_cast<uint32_t*>(data + y * stride + x * 4);
+    };
+
+    // translated by whole pixels and clipped, so blitted
+    {
+        egt::Painter::AutoSaveRestore sr(painter);
+        cairo_translate(painter.context().get(), 10, 10);
+        painter.draw(egt::Rect(0, 0, 15, 15));
+        painter.clip();
+        painter.draw(egt::Point(5, 5));
+        painter.draw(image);
+    }
+    EXPECT_EQ(pixel(16, 16), 0xffff7f7fU);
+    EXPECT_EQ(pixel(27, 27), 0xffffffffU);
+    EXPECT_EQ(pixel(14, 14), 0xffffffffU);
+
+    // same result through cairo, at half a pixel
+    {
+        egt::Painter::AutoSaveRestore sr(painter);
+        painter.draw(egt::PointF(60.5, 60));
+        painter.draw(image);
+    }
+    EXPECT_EQ(pixel(70, 70), 0xffff7f7fU);
+}
+
+TEST(Canvas, FillRect)
+{
+    for (auto format : {egt::PixelFormat::argb8888, egt::PixelFormat::rgb565})
+    {
+        egt::Canvas canvas(egt::Size(100, 100), format);
+        canvas.zero();
+        egt::Painter painter(canvas.context());
+
+        const auto pixel = [&canvas](int x, int y) -> uint32_t
+        {
+            cairo_surface_flush(canvas.surface().get());
+            const auto data = cairo_image_surface_get_data(canvas.surface().get());
+            const auto stride = cairo_image_surface_get_stride(canvas.surface().get());
+            if (canvas.format() == egt::PixelFormat::rgb565)
+                return *reinterpret_cast<uint16_t*>(data + y * stride + x * 2);
+            return *reinterpret_cast<uint32_t*>(data + y * stride + x * 4);
+        };
+
+        const uint32_t blue = format == egt::PixelFormat::rgb565 ? 0x001f : 0xff0000ff;
+        const uint32_t green = format == egt::PixelFormat::rgb565 ? 0x07e0 : 0xff00ff00;
+
+        // translated and clipped, so written directly
+        {
+            egt::Painter::AutoSaveRestore sr(painter);
+            cairo_translate(painter.context().get(), 10, 10);
+            painter.draw(egt::Rect(0, 0, 20, 20));
+            painter.clip();
+            painter.set(egt::Palette::blue);
+            painter.fill(egt::Rect(5, 5, 30, 30));
+        }
+        EXPECT_EQ(pixel(15, 15), blue);
+        EXPECT_EQ(pixel(29, 29), blue);
+        EXPECT_EQ(pixel(30, 30), 0U);
+        EXPECT_EQ(pixel(14, 14), 0U);
+
+        // on half pixels it is left to cairo
+        painter.set(egt::Palette::green);
+        painter.fill(egt::RectF(50.5, 50, 20, 20));
+        EXPECT_EQ(pixel(60, 60), green);
+        EXPECT_EQ(pixel(60, 49), 0U);
+    }
+}
+
+TEST(Canvas, Rasterizer)
+{
+    const auto names = egt::detail::rasterizers();
+    ASSERT_FALSE(names.empty());
+    const std::string initial = egt::detail::rasterizer().name();
+    EXPECT_THROW(egt::detail::rasterizer("unknown"), std::runtime_error);
+
+    // every rasterizer draws the same pixels
+    std::vector<uint32_t> expected;
+    for (const auto& name : names)
+    {
+        egt::detail::rasterizer(name);
+        EXPECT_EQ(egt::detail::rasterizer().name(), name);
+
+        egt::Canvas canvas(egt::Size(40, 40));
+        canvas.zero();
+        egt::Painter painter(canvas.context());
+        painter.set(egt::Palette::red);
+        painter.fill(egt::Rect(5, 5, 20, 20));
+        painter.set(egt::Palette::blue);
+        painter.draw(egt::Circle(egt::Point(25, 25), 10));
+        painter.fill();
+
+        cairo_surface_flush(canvas.surface().get());
+        const auto data = reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(canvas.surface().get()));
+        std::vector<uint32_t> pixels(data, data + 40 * 40);
+        if (expected.empty())
+            expected = pixels;
+        EXPECT_EQ(pixels, expected);
+    }
+
+    egt::detail::rasterizer(initial);
+}
+
+namespace
+{
+class SkinTheme : public egt::Theme
+{
+public:
+    using egt::Theme::draw_box_cached;
+};
+
+/// Pixels of a box drawn by a theme.
+std::vector<uint32_t> box_pixels(const egt::Theme& theme, const egt::Rect& rect,
+                                 const egt::Pattern& border, const egt::Pattern& bg,
+                                 egt::DefaultDim border_width, float radius)
+{
+    egt::Canvas canvas(egt::Size(200, 100));
+    canvas.zero();
+    {
+        egt::Painter painter(canvas.context());
+        theme.draw_box(painter, egt::Theme::FillFlag::solid, rect, border, bg,
+                       border_width, 0, radius);
+    }
+
+    const auto surface = canvas.surface().get();
+    cairo_surface_flush(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    const auto stride = cairo_image_surface_get_stride(surface);
+    std::vector<uint32_t> pixels;
+    for (auto y = 0; y < 100; ++y)
+    {
+        const auto row = reinterpret_cast<const uint32_t*>(data + y * stride);
+        pixels.insert(pixels.end(), row, row + 200);
+    }
+    return pixels;
+}
+}
+
+TEST(Theme, BoxCache)
+{
+    egt::Application app;
+
+    SkinTheme theme;
+    EXPECT_TRUE(theme.box_cache());
+    egt::Theme direct;
+    direct.box_cache(false);
+    EXPECT_FALSE(direct.box_cache());
+
+    const egt::Pattern linear(egt::Pattern::Type::linear,
+    {{0, egt::Palette::red}, {1, egt::Palette::blue}});
+    const egt::Pattern vertical(egt::Pattern::Type::linear_vertical,
+    {{0, egt::Palette::green}, {1, egt::Palette::white}});
+
+    // boxes of any size stretched from a skin look the same as drawn
+    // directly, and so does a box drawn again from the cache
+    for (auto i = 0; i < 2; ++i)
+    {
+        for (const auto& rect : {egt::Rect(10, 10, 60, 30), egt::Rect(5, 20, 180, 70),
+                                 egt::Rect(3, 4, 7, 7)
+                                })
+        {
+            for (const auto& color : {egt::Palette::red, egt::Palette::blue})
+            {
+                EXPECT_EQ(box_pixels(theme, rect, egt::Palette::black, color, 2, 8),
+                          box_pixels(direct, rect, egt::Palette::black, color, 2, 8));
+                EXPECT_EQ(box_pixels(theme, rect, color, egt::Palette::gray, 0, 0),
+                          box_pixels(direct, rect, color, egt::Palette::gray, 0, 0));
+            }
+            EXPECT_EQ(box_pixels(theme, rect, egt::Palette::black, linear, 1, 4),
+                      box_pixels(direct, rect, egt::Palette::black, linear, 1, 4));
+            EXPECT_EQ(box_pixels(theme, rect, egt::Palette::black, vertical, 1, 4),
+                      box_pixels(direct, rect, egt::Palette::black, vertical, 1, 4));
+        }
+
+        theme.clear_box_cache();
+    }
+
+    // boxes that cannot be copied pixel exact are not cached
+    egt::Canvas canvas(egt::Size(100, 100));
+    egt::Painter painter(canvas.context());
+    const egt::Theme::FillFlags solid{egt::Theme::FillFlag::solid};
+    const egt::Rect rect(10, 10, 50, 30);
+    EXPECT_TRUE(theme.draw_box_cached(painter, solid, rect, egt::Palette::black,
+                                      egt::Palette::red, 1, 0, 4, {}));
+    EXPECT_FALSE(theme.draw_box_cached(painter, solid, rect, egt::Palette::black,
+                                       egt::Color(egt::Palette::red, 128), 1, 0, 4, {}));
+    EXPECT_FALSE(theme.draw_box_cached(painter, solid, rect,
+                                       egt::Color(egt::Palette::black, 128),
+                                       egt::Palette::red, 1, 0, 4, {}));
+    EXPECT_FALSE(theme.draw_box_cached(painter, solid, rect, egt::Palette::black,
+                                       egt::Palette::red, 1, 0, 4,
+                                       egt::Theme::BorderFlag::drop_shadow));
+    {
+        egt::Painter::AutoSaveRestore sr(painter);
+        cairo_scale(painter.context().get(), 2, 2);
+        EXPECT_FALSE(theme.draw_box_cached(painter, solid, rect, egt::Palette::black,
+                                           egt::Palette::red, 1, 0, 4, {}));
+    }
+}
+
+TEST(Font, GlyphAtlas)
+{
+    egt::Application app;
+
+    const egt::Font font(egt::Font::DEFAULT_FACE, 24);
+    const std::string text = "123.45 Hz\n-67.8 \xc2\xb0""C";
+
+    auto render = [&font, &text](bool atlas, egt::Size & size)
+    {
+        egt::Font::glyph_atlas(atlas);
+        egt::Canvas canvas(egt::Size(200, 40));
+        egt::Painter painter(canvas.context());
+        painter.set(font);
+        painter.set(egt::Pattern(egt::Palette::black));
+        painter.translate(egt::PointF(0.5, 0.25));
+        size = painter.text_size(text);
+        painter.draw(egt::Point(5, 5));
+        painter.draw(text.substr(0, text.find('\n')));
+        cairo_surface_flush(canvas.surface().get());
+
+        auto data = cairo_image_surface_get_data(canvas.surface().get());
+        const auto bytes = cairo_image_surface_get_stride(canvas.surface().get()) * 40;
+        uint64_t ink = 0;
+        for (auto i = 3; i < bytes; i += 4)
+            ink += data[i];
+        return ink;
+    };
+
+    egt::Size atlas_size;
+    egt::Size cairo_size;
+    const auto atlas_ink = render(true, atlas_size);
+    const auto cairo_ink = render(false, cairo_size);
+    egt::Font::glyph_atlas(true);
+
+    // glyphs may be positioned differently within a pixel, but not measured
+    EXPECT_EQ(atlas_size, cairo_size);
+    EXPECT_GT(atlas_ink, 0U);
+    EXPECT_NEAR(static_cast<double>(atlas_ink), static_cast<double>(cairo_ink), cairo_ink * 0.05);
+}
+
+TEST(Font, Preload)
+{
+    egt::Application app;
+
+    const std::vector<egt::Font> fonts =
+    {
+        egt::Font(egt::Font::DEFAULT_FACE, 18),
+        egt::Font(egt::Font::DEFAULT_FACE, 24, egt::Font::Weight::bold),
+    };
+
+    size_t count = 0;
+    std::thread warmup([&fonts, &count]() { count = egt::Font::preload(fonts); });
+    warmup.join();
+    EXPECT_EQ(count, fonts.size());
+
+    const auto manifest = ::testing::TempDir() + "egt_font_manifest";
+    ASSERT_TRUE(egt::Font::save_manifest(manifest));
+
+    egt::Font::reset_font_cache();
+    EXPECT_TRUE(egt::Font::preload(manifest));
+    for (const auto& font : fonts)
+        EXPECT_NE(font.scaled_font(), nullptr);
+
+    std::remove(manifest.c_str());
+    EXPECT_FALSE(egt::Font::preload(manifest));
+}
+
+TEST(Font, SharedFace)
+{
+    egt::Application app;
+
+    // one face of the file for every size
+    const egt::Font small(egt::Font::DEFAULT_FACE, 18);
+    const egt::Font large(egt::Font::DEFAULT_FACE, 30);
+    ASSERT_NE(small.scaled_font(), nullptr);
+    ASSERT_NE(large.scaled_font(), nullptr);
+    EXPECT_NE(small.scaled_font(), large.scaled_font());
+    EXPECT_EQ(cairo_scaled_font_get_font_face(small.scaled_font()),
+              cairo_scaled_font_get_font_face(large.scaled_font()));
+}
+
+TEST(LruCache, Evict)
+{
+    egt::detail::LruCache<std::string, int> cache(10, 3);
+
+    cache.insert("a", 1, 4);
+    cache.insert("b", 2, 4);
+    ASSERT_NE(cache.find("a"), nullptr);
+    EXPECT_EQ(*cache.find("a"), 1);
+
+    // over the cost, the least recently used goes first
+    cache.insert("c", 3, 4);
+    EXPECT_EQ(cache.find("b"), nullptr);
+    EXPECT_NE(cache.find("a"), nullptr);
+    EXPECT_NE(cache.find("c"), nullptr);
+    EXPECT_EQ(cache.cost(), 8U);
+
+    // over the number of entries
+    cache.insert("d", 4, 0);
+    cache.insert("e", 5, 0);
+    EXPECT_EQ(cache.size(), 3U);
+    EXPECT_EQ(cache.find("a"), nullptr);
+
+    // the newest entry stays, even over the limit on its own
+    cache.insert("f", 6, 20);
+    EXPECT_EQ(cache.size(), 1U);
+    EXPECT_EQ(cache.begin()->key, "f");
+
+    EXPECT_EQ(cache.stats().hits, 4U);
+    EXPECT_EQ(cache.stats().misses, 2U);
+    EXPECT_EQ(cache.stats().evictions, 5U);
+
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.cost(), 0U);
+}
+
+TEST(LruCache, HashedIndex)
+{
+    // looked up by views of the keys, without allocating a key
+    egt::detail::LruCache<std::string, int,
+        egt::detail::HashedIndex<std::string, std::string_view>> cache(0, 2);
+
+    cache.insert("first", 1);
+    cache.insert("second", 2);
+    ASSERT_NE(cache.find(std::string_view("first")), nullptr);
+    EXPECT_EQ(*cache.find(std::string_view("first")), 1);
+
+    cache.insert("third", 3);
+    EXPECT_EQ(cache.find(std::string_view("second")), nullptr);
+    EXPECT_NE(cache.find(std::string_view("third")), nullptr);
+
+    // replacing an entry keeps the index on the new key
+    cache.insert("third", 4);
+    EXPECT_EQ(cache.size(), 2U);
+    EXPECT_EQ(*cache.find(std::string_view("third")), 4);
+
+    cache.erase(std::string_view("first"));
+    EXPECT_EQ(cache.size(), 1U);
+}
+
+TEST(ImageCache, Prefetch)
+{
+    egt::Application app;
+
+    // a missing image fails on a worker thread, not on the event loop
+    egt::ImageLabel label;
+    const egt::Image placeholder(egt::Canvas(egt::Size(10, 10)).surface());
+    label.image_async("file:missing.png", 1.0, 1.0, placeholder);
+    EXPECT_TRUE(label.image_loading());
+    EXPECT_EQ(label.image().size(), egt::Size(10, 10));
+
+    bool called = false;
+    bool cancelled = false;
+    egt::detail::image_cache().prefetch("file:missing.png", 1.0, 1.0, false,
+                                        [&called](const egt::shared_cairo_surface_t & surface)
+    {
+        called = true;
+        EXPECT_FALSE(surface);
+    });
+    auto id = egt::detail::image_cache().prefetch("file:missing.png", 1.0, 1.0, false,
+              [&cancelled](const egt::shared_cairo_surface_t&) { cancelled = true; });
+    egt::detail::image_cache().cancel(id);
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((!called || label.image_loading()) && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_TRUE(called);
+    EXPECT_FALSE(cancelled);
+    EXPECT_FALSE(label.image_loading());
+    EXPECT_EQ(label.image().size(), egt::Size(10, 10));
+}
+
+TEST(ResourceManager, Compressed)
+{
+    // a 2x2 PNG, compressed with gzip
+    static const unsigned char data[] =
+    {
+        0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xeb, 0x0c,
+        0xf0, 0x73, 0xe7, 0xe5, 0x92, 0xe2, 0x62, 0x60, 0x60, 0xe0, 0xf5, 0xf4,
+        0x70, 0x09, 0x02, 0xd2, 0x4c, 0x20, 0xcc, 0xc1, 0x06, 0x24, 0x8b, 0xb6,
+        0xf1, 0xaa, 0x00, 0x29, 0x41, 0x4f, 0x17, 0xc7, 0x90, 0x8a, 0x5b, 0xc9,
+        0x3f, 0xce, 0x1f, 0xf8, 0x20, 0xdf, 0x22, 0x99, 0xc0, 0xc3, 0xe0, 0x7e,
+        0x8a, 0xfd, 0xa7, 0xd4, 0xb6, 0x8f, 0x2b, 0x81, 0x92, 0x0c, 0x9e, 0xae,
+        0x7e, 0x2e, 0xeb, 0x9c, 0x12, 0x9a, 0x00, 0x66, 0x51, 0xc7, 0x23, 0x4a,
+        0x00, 0x00, 0x00
+    };
+    auto& resources = egt::ResourceManager::instance();
+    resources.add("compressed_png", data, sizeof(data));
+
+    // without zlib, resources are used as they are
+    if (!resources.compressed("compressed_png"))
+    {
+        resources.remove("compressed_png");
+        return;
+    }
+
+    // decoded while decompressed, without keeping the decompressed resource
+    const egt::Image image("res:compressed_png");
+    EXPECT_EQ(image.size(), egt::Size(2, 2));
+    EXPECT_TRUE(resources.compressed("compressed_png"));
+
+    unsigned char png[128];
+    auto stream = resources.open("compressed_png");
+    ASSERT_TRUE(stream);
+    EXPECT_EQ(stream->read(png, sizeof(png)), 74u);
+    EXPECT_EQ(stream->read(png, sizeof(png)), 0u);
+
+    // decompressed for good once needed whole
+    EXPECT_EQ(resources.size("compressed_png"), 74u);
+    EXPECT_FALSE(resources.compressed("compressed_png"));
+    EXPECT_EQ(std::memcmp(resources.data("compressed_png"), png, 74), 0);
+
+    egt::detail::image_cache().clear();
+    resources.remove("compressed_png");
+}
+
+TEST(Image, UncompressedEraw)
+{
+    const auto path = ::testing::TempDir() + "egt_uncompressed.eraw";
+
+    // header, padding to 64 bytes, and the pixels of a 2x2 image
+    const uint32_t header[] = {0x50502AA2, 2, 2, 0, 0, 0, 1};
+    const uint32_t pixels[] = {0xff0000ff, 0xff00ff00, 0xffff0000, 0x80000000};
+    {
+        std::ofstream o(path, std::ios_base::binary);
+        o.write(reinterpret_cast<const char*>(header), sizeof(header));
+        const char padding[64 - sizeof(header)] = {};
+        o.write(padding, sizeof(padding));
+        o.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+    }
+
+    egt::Image image("file:" + path);
+    ASSERT_EQ(image.size(), egt::Size(2, 2));
+    const auto data = reinterpret_cast<const uint32_t*>(
+                          cairo_image_surface_get_data(image.surface().get()));
+    EXPECT_EQ(std::vector<uint32_t>(data, data + 4),
+              std::vector<uint32_t>(std::begin(pixels), std::end(pixels)));
+
+    egt::detail::image_cache().clear();
+    std::remove(path.c_str());
+}
+
+TEST(Image, TiledErawRegion)
+{
+    const auto path = ::testing::TempDir() + "egt_tiled.eraw";
+
+    // a 2x2 image of 1x1 tiles, each a block of one pixel
+    const uint32_t header[] = {0x50502AA2, 2, 2, 0, 0, 0, 2};
+    const uint32_t tiles[] = {1, 52, 58, 64, 70, 76};
+    const uint32_t pixels[] = {0xff0000ff, 0xff00ff00, 0xffff0000, 0x80000000};
+    {
+        std::ofstream o(path, std::ios_base::binary);
+        o.write(reinterpret_cast<const char*>(header), sizeof(header));
+        o.write(reinterpret_cast<const char*>(tiles), sizeof(tiles));
+        for (const auto& pixel : pixels)
+        {
+            const uint16_t block = 1;
+            o.write(reinterpret_cast<const char*>(&block), sizeof(block));
+            o.write(reinterpret_cast<const char*>(&pixel), sizeof(pixel));
+        }
+    }
+
+    egt::Image image("file:" + path);
+    ASSERT_EQ(image.size(), egt::Size(2, 2));
+    auto data = reinterpret_cast<const uint32_t*>(
+                    cairo_image_surface_get_data(image.surface().get()));
+    EXPECT_EQ(std::vector<uint32_t>(data, data + 4),
+              std::vector<uint32_t>(std::begin(pixels), std::end(pixels)));
+
+    // the right column only
+    auto region = egt::detail::load_image_region("file:" + path, egt::Rect(1, 0, 1, 2));
+    ASSERT_EQ(cairo_image_surface_get_width(region.get()), 1);
+    ASSERT_EQ(cairo_image_surface_get_height(region.get()), 2);
+    const auto stride = cairo_image_surface_get_stride(region.get()) / sizeof(uint32_t);
+    data = reinterpret_cast<const uint32_t*>(cairo_image_surface_get_data(region.get()));
+    EXPECT_EQ(data[0], pixels[1]);
+    EXPECT_EQ(data[stride], pixels[3]);
+
+    egt::detail::image_cache().clear();
+    std::remove(path.c_str());
+}
+
+TEST(Image, ScaledDecode)
+{
+    const auto path = ::testing::TempDir() + "egt_scaled.png";
+
+    // left half red, right half blue
+    {
+        egt::Canvas canvas(egt::Size(64, 32), egt::PixelFormat::argb8888);
+        egt::Painter painter(canvas.context());
+        painter.set(egt::Pattern(egt::Palette::red));
+        painter.draw(egt::Rect(0, 0, 32, 32));
+        painter.fill();
+        painter.set(egt::Pattern(egt::Palette::blue));
+        painter.draw(egt::Rect(32, 0, 32, 32));
+        painter.fill();
+        ASSERT_EQ(cairo_surface_write_to_png(canvas.surface().get(), path.c_str()),
+                  CAIRO_STATUS_SUCCESS);
+    }
+
+    // without libpng, the image is decoded whole
+    auto image = egt::detail::load_scaled_image_from_filesystem(path, 0.25, 0.5);
+    if (image)
+    {
+        ASSERT_EQ(cairo_image_surface_get_width(image.get()), 16);
+        ASSERT_EQ(cairo_image_surface_get_height(image.get()), 16);
+        const auto data = reinterpret_cast<const uint32_t*>(
+                              cairo_image_surface_get_data(image.get()));
+        EXPECT_EQ(data[0], 0xffff0000);
+        EXPECT_EQ(data[15], 0xff0000ff);
+    }
+
+    // either way, the cache gets the image at its scale
+    egt::Image scaled("file:" + path, 0.25);
+    EXPECT_EQ(scaled.size(), egt::Size(16, 8));
+
+    EXPECT_EQ(egt::detail::load_scaled_image_from_filesystem(path, 2.0, 2.0), nullptr);
+
+    egt::detail::image_cache().clear();
+    std::remove(path.c_str());
+}
+
+/// An uncompressed eraw image of one color.
+static std::vector<unsigned char> solid_eraw(uint32_t width, uint32_t height, uint32_t color)
+{
+    const uint32_t header[] = {0x50502AA2, width, height, 0, 0, 0, 1};
+    std::vector<unsigned char> data(64 + width * height * sizeof(uint32_t));
+    std::memcpy(data.data(), header, sizeof(header));
+    for (size_t i = 0; i < width * height; ++i)
+        std::memcpy(data.data() + 64 + i * sizeof(color), &color, sizeof(color));
+    return data;
+}
+
+TEST(ImageCache, BakedScales)
+{
+    egt::ResourceManager::instance().add("baked_png", solid_eraw(8, 8, 0xffff0000));
+    egt::ResourceManager::instance().add("baked_png@0.5", solid_eraw(4, 4, 0xff00ff00));
+    egt::ResourceManager::instance().add("baked_png@bad", solid_eraw(1, 1, 0xff0000ff));
+
+    // the variant as is
+    egt::Image half("res:baked_png", 0.5);
+    EXPECT_EQ(half.size(), egt::Size(4, 4));
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(
+                  cairo_image_surface_get_data(half.surface().get())), 0xff00ff00);
+
+    // scaled down from the variant
+    egt::Image quarter("res:baked_png", 0.25);
+    EXPECT_EQ(quarter.size(), egt::Size(2, 2));
+
+    // no variant is large enough, scaled up from the original
+    egt::Image twice("res:baked_png", 2.0);
+    EXPECT_EQ(twice.size(), egt::Size(16, 16));
+
+    egt::detail::image_cache().clear();
+    egt::ResourceManager::instance().remove("baked_png");
+    egt::ResourceManager::instance().remove("baked_png@0.5");
+    egt::ResourceManager::instance().remove("baked_png@bad");
+}
+
+TEST(ImageCache, NativeFormat)
+{
+    egt::ResourceManager::instance().add("opaque_png", solid_eraw(4, 4, 0xffff0000));
+    egt::ResourceManager::instance().add("clear_png", solid_eraw(4, 4, 0x80800000));
+
+    // opaque images lose their alpha, not their pixels
+    egt::Image opaque("res:opaque_png");
+    EXPECT_TRUE(opaque.opaque());
+    EXPECT_EQ(cairo_image_surface_get_format(opaque.surface().get()), CAIRO_FORMAT_RGB24);
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(
+                  cairo_image_surface_get_data(opaque.surface().get())), 0xffff0000);
+
+    egt::Image clear("res:clear_png");
+    EXPECT_FALSE(clear.opaque());
+    EXPECT_EQ(cairo_image_surface_get_format(clear.surface().get()), CAIRO_FORMAT_ARGB32);
+
+    // and are converted for a 16 bpp screen, scaled or not
+    egt::detail::image_cache().format(egt::PixelFormat::rgb565);
+    egt::Image native("res:opaque_png");
+    EXPECT_EQ(cairo_image_surface_get_format(native.surface().get()), CAIRO_FORMAT_RGB16_565);
+    EXPECT_EQ(*reinterpret_cast<const uint16_t*>(
+                  cairo_image_surface_get_data(native.surface().get())), 0xf800);
+    egt::Image scaled("res:opaque_png", 2.0);
+    EXPECT_EQ(scaled.size(), egt::Size(8, 8));
+    EXPECT_EQ(cairo_image_surface_get_format(scaled.surface().get()), CAIRO_FORMAT_RGB16_565);
+    EXPECT_EQ(cairo_image_surface_get_format(egt::Image("res:clear_png").surface().get()),
+              CAIRO_FORMAT_ARGB32);
+
+    // drawing an opaque image only replaces what is under it
+    egt::Canvas canvas(egt::Size(8, 8));
+    egt::Painter painter(canvas.context());
+    painter.set(egt::Pattern(egt::Palette::blue));
+    painter.paint();
+    painter.draw(egt::Point(2, 2));
+    painter.draw(native);
+    const auto surface = canvas.surface().get();
+    cairo_surface_flush(surface);
+    const auto data = cairo_image_surface_get_data(surface);
+    const auto stride = cairo_image_surface_get_stride(surface);
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(data), 0xff0000ff);
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(data + 3 * stride + 3 * 4), 0xffff0000);
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(data + 7 * stride + 7 * 4), 0xff0000ff);
+
+    egt::detail::image_cache().format(egt::PixelFormat::argb8888);
+    egt::ResourceManager::instance().remove("opaque_png");
+    egt::ResourceManager::instance().remove("clear_png");
+}
+
+TEST(ImageCache, ConcurrentLoads)
+{
+    const auto path = ::testing::TempDir() + "egt_concurrent.eraw";
+    {
+        const auto data = solid_eraw(16, 16, 0xff00ff00);
+        std::ofstream o(path, std::ios_base::binary);
+        o.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    // threads asking for the same image share one load
+    std::vector<egt::shared_cairo_surface_t> images(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        threads.emplace_back([&images, &path, i]()
+        {
+            images[i] = egt::detail::image_cache().get("file:" + path, 0.5);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_TRUE(images[0]);
+    EXPECT_EQ(cairo_image_surface_get_width(images[0].get()), 8);
+    for (const auto& image : images)
+        EXPECT_EQ(image, images[0]);
+
+    // errors are shared with the future
+    auto future = egt::detail::image_cache().load("file:missing.eraw");
+    EXPECT_THROW(future.get(), std::runtime_error);
+
+    egt::detail::image_cache().clear();
+    std::remove(path.c_str());
+}
+
+TEST(SharedImageStore, Publish)
+{
+    egt::detail::SharedImageStore store(::testing::TempDir() + "egt_shared");
+    ASSERT_TRUE(store.enabled());
+    store.clear();
+
+    const unsigned char content[] = "encoded image";
+    const auto hash = egt::detail::SharedImageStore::hash(content, sizeof(content));
+    EXPECT_FALSE(store.find(hash, 1.0, 1.0));
+
+    // published once, then mapped by every process
+    size_t decodes = 0;
+    auto decode = [&decodes]()
+    {
+        ++decodes;
+        return egt::shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_RGB24, 10, 5),
+                                           cairo_surface_destroy);
+    };
+    auto image = store.get(content, sizeof(content), 1.0, 1.0, decode);
+    ASSERT_TRUE(image);
+    EXPECT_EQ(cairo_image_surface_get_format(image.get()), CAIRO_FORMAT_ARGB32);
+    EXPECT_EQ(cairo_image_surface_get_width(image.get()), 10);
+    EXPECT_EQ(reinterpret_cast<uint32_t*>(cairo_image_surface_get_data(image.get()))[0],
+              0xff000000);
+
+    auto again = store.get(content, sizeof(content), 1.0, 1.0, decode);
+    EXPECT_EQ(decodes, 1U);
+    ASSERT_TRUE(again);
+    EXPECT_EQ(cairo_image_surface_get_height(again.get()), 5);
+
+    // each scale is its own image
+    EXPECT_FALSE(store.find(hash, 0.5, 0.5));
+
+    // removing files does not affect mapped images
+    EXPECT_GT(store.bytes(), 0U);
+    store.clear();
+    EXPECT_EQ(store.bytes(), 0U);
+    EXPECT_FALSE(store.find(hash, 1.0, 1.0));
+    EXPECT_EQ(cairo_image_surface_get_width(again.get()), 10);
+}
+
+TEST(SurfacePool, Reuse)
+{
+    egt::detail::SurfacePool pool;
+
+    auto surface = pool.acquire(CAIRO_FORMAT_ARGB32, egt::Size(100, 50));
+    EXPECT_EQ(cairo_image_surface_get_width(surface.get()), 100);
+    EXPECT_EQ(cairo_image_surface_get_height(surface.get()), 50);
+    auto data = cairo_image_surface_get_data(surface.get());
+    data[0] = 0xff;
+
+    // a pattern keeps the pixels until cairo destroys the surface
+    auto pattern = cairo_pattern_create_for_surface(surface.get());
+    surface.reset();
+    EXPECT_EQ(pool.idle_bytes(), 0U);
+    cairo_pattern_destroy(pattern);
+    EXPECT_GT(pool.idle_bytes(), 0U);
+
+    // same bucket, same pixels, cleared
+    surface = pool.acquire(CAIRO_FORMAT_ARGB32, egt::Size(90, 60));
+    EXPECT_EQ(pool.reused(), 1U);
+    EXPECT_EQ(pool.idle_bytes(), 0U);
+    EXPECT_EQ(cairo_image_surface_get_data(surface.get()), data);
+    EXPECT_EQ(data[0], 0);
+
+    // pixels not in use are bounded
+    surface.reset();
+    pool.max_idle_bytes(0);
+    EXPECT_EQ(pool.idle_bytes(), 0U);
+}
+
+TEST(CacheBudget, Enforce)
+{
+    using Priority = egt::experimental::CacheBudget::Priority;
+    auto& budget = egt::experimental::cache_budget();
+
+    size_t pages = 200;
+    size_t images = 300;
+    const auto a = budget.add("pages", Priority::surfaces,
+    [&pages]() { return pages; },
+    [&pages](size_t bytes) { pages = std::min(pages, bytes); });
+    const auto b = budget.add("decoded", Priority::images,
+    [&images]() { return images; },
+    [&images](size_t bytes) { images = std::min(images, bytes); });
+
+    const auto usage = budget.usage();
+    EXPECT_TRUE(std::any_of(usage.begin(), usage.end(),
+                            [](const egt::experimental::CacheBudget::Usage & u)
+    {
+        return u.name == "decoded" && u.bytes == 300;
+    }));
+
+    // over the budget, surfaces give up their pixels before images
+    budget.purge(Priority::surfaces);
+    pages = 200;
+    budget.budget(budget.bytes() - 100);
+    EXPECT_EQ(pages, 100U);
+    EXPECT_EQ(images, 300U);
+
+    budget.budget(0);
+    budget.purge(Priority::images);
+    EXPECT_EQ(pages, 0U);
+    EXPECT_EQ(images, 0U);
+
+    budget.remove(a);
+    budget.remove(b);
+}
+
+TEST(ParticleField, Damage)
+{
+    egt::Application app;
+
+    struct TestField : public egt::ParticleField
+    {
+        using egt::ParticleField::ParticleField;
+        using egt::ParticleField::damage;
+
+        void damage(const egt::Rect& rect) override
+        {
+            damaged.push_back(rect);
+        }
+
+        std::vector<egt::Rect> damaged;
+    };
+
+    egt::Image image(egt::shared_cairo_surface_t(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 8, 8),
+                     cairo_surface_destroy));
+    TestField field(image, egt::Rect(100, 100, 400, 400));
+
+    for (auto i = 0; i < 100; ++i)
+        field.add({egt::PointF(10 + i * 2, 50), 1.f, 1.f});
+    EXPECT_EQ(field.count(), 100U);
+    EXPECT_EQ(field.damaged.size(), 100U);
+
+    // moving all of them together is merged into a few rectangles
+    field.damaged.clear();
+    field.update([](std::vector<egt::Particle>& particles)
+    {
+        for (auto& particle : particles)
+            particle.center += egt::PointF(0, 4);
+    });
+    ASSERT_FALSE(field.damaged.empty());
+    EXPECT_LE(field.damaged.size(), field.damage_cost().max_rects);
+    for (const auto& rect : field.damaged)
+        EXPECT_TRUE(egt::Rect(100, 100, 400, 400).contains(rect));
+
+    // particles not changed are not damaged
+    field.damaged.clear();
+    field.update([](std::vector<egt::Particle>& particles)
+    {
+        particles[3].alpha = 0.5f;
+    });
+    ASSERT_EQ(field.damaged.size(), 1U);
+    EXPECT_TRUE(field.damaged[0].intersect(egt::Point(100 + 16, 100 + 54)));
+
+    field.remove(0);
+    EXPECT_EQ(field.count(), 99U);
+    EXPECT_EQ(field.particle(0).center, egt::PointF(10 + 99 * 2, 54));
+
+    EXPECT_THROW(field.update([](std::vector<egt::Particle>& particles)
+    {
+        particles.clear();
+    }), std::runtime_error);
+}
+
+TEST(SevenSegment, Digits)
+{
+    struct TestSevenSegment : public egt::SevenSegment
+    {
+        using egt::SevenSegment::SevenSegment;
+        using egt::SevenSegment::damage;
+
+        void damage(const egt::Rect& rect) override
+        {
+            damaged.push_back(rect);
+        }
+
+        std::vector<egt::Rect> damaged;
+    };
+
+    egt::Application app;
+
+    EXPECT_EQ(egt::SevenSegment::segments('8'), 0x7f);
+    EXPECT_EQ(egt::SevenSegment::segments('F'), egt::SevenSegment::segments('f'));
+    EXPECT_EQ(egt::SevenSegment::segments('.'), 0x80);
+
+    TestSevenSegment display(4, egt::Rect(0, 0, 120, 50));
+    const auto hint = display.min_size_hint();
+
+    display.text("123");
+    EXPECT_EQ(display.damaged.size(), 3U);
+
+    // only the cell of the digit that changed is damaged
+    display.damaged.clear();
+    display.text("128");
+    ASSERT_EQ(display.damaged.size(), 1U);
+    EXPECT_EQ(display.damaged[0], egt::Rect(90, 0, 30, 50));
+
+    // the decimal point belongs to the digit before it
+    display.damaged.clear();
+    display.value(12.5, 1);
+    EXPECT_EQ(display.text(), "12.5");
+    EXPECT_EQ(display.damaged.size(), 2U);
+    EXPECT_EQ(display.min_size_hint(), hint);
+
+    EXPECT_THROW(display.text("12x"), std::runtime_error);
+    EXPECT_EQ(display.text(), "12.5");
+
+    const auto pixel = [&display](const egt::Point & point)
+    {
+        egt::Canvas canvas(egt::Size(120, 50));
+        canvas.zero();
+        egt::Painter painter(canvas.context());
+        display.draw(painter, display.box());
+        cairo_surface_flush(canvas.surface().get());
+        const auto data = cairo_image_surface_get_data(canvas.surface().get());
+        const auto stride = cairo_image_surface_get_stride(canvas.surface().get());
+        return *reinterpret_cast<uint32_t*>(data + point.y() * stride + point.x() * 4);
+    };
+
+    // the middle segment of the last digit
+    display.text("8");
+    EXPECT_NE(pixel(egt::Point(102, 25)), 0U);
+    display.text("1");
+    EXPECT_EQ(pixel(egt::Point(102, 25)), 0U);
+
+    display.digits(6);
+    EXPECT_EQ(display.digits(), 6U);
+    EXPECT_GT(display.min_size_hint().width(), hint.width());
+}
+
+TEST(Placement, Surface)
+{
+    const egt::detail::Placement placements[] =
+    {
+        egt::detail::Placement::cached,
+        egt::detail::Placement::hugepage,
+        egt::detail::Placement::cma,
+    };
+
+    for (auto p : placements)
+    {
+        auto surface = egt::detail::create_surface(CAIRO_FORMAT_ARGB32, egt::Size(1024, 600), p);
+        ASSERT_EQ(cairo_surface_status(surface.get()), CAIRO_STATUS_SUCCESS);
+        EXPECT_EQ(cairo_image_surface_get_width(surface.get()), 1024);
+        EXPECT_EQ(cairo_image_surface_get_height(surface.get()), 600);
+
+        // the memory asked for, or cached memory when it's not available
+        const auto placed = egt::detail::placement(surface.get());
+        EXPECT_TRUE(placed == p || placed == egt::detail::Placement::cached);
+
+        const auto data = cairo_image_surface_get_data(surface.get());
+        const auto bytes = static_cast<size_t>(cairo_image_surface_get_stride(surface.get())) * 600;
+        EXPECT_TRUE(std::all_of(data, data + bytes, [](uint8_t b) { return b == 0; }));
+        EXPECT_GT(egt::detail::read_throughput(data, bytes), 0);
+    }
+
+    // small buffers are not worth a huge page
+    auto small = egt::detail::create_surface(CAIRO_FORMAT_ARGB32, egt::Size(10, 10));
+    EXPECT_EQ(egt::detail::placement(small.get()), egt::detail::Placement::cached);
+}
+
+TEST(Notebook, PageCache)
+{
+    egt::Application app;
+
+    egt::Notebook notebook(egt::Rect(0, 0, 100, 100));
+    std::vector<std::shared_ptr<egt::NotebookTab>> tabs;
+    for (auto i = 0; i < 3; ++i)
+    {
+        tabs.push_back(std::make_shared<egt::NotebookTab>());
+        tabs.back()->resize(egt::Size(100, 100));
+        notebook.add(tabs.back());
+    }
+
+    // room for two tabs
+    notebook.page_cache(2 * 100 * 100 * 4);
+    EXPECT_TRUE(tabs[0]->cache_subtree());
+
+    notebook.selected(1);
+    EXPECT_TRUE(tabs[0]->cache_subtree());
+    EXPECT_TRUE(tabs[1]->cache_subtree());
+
+    // the tab shown least recently is dropped
+    notebook.selected(2);
+    EXPECT_FALSE(tabs[0]->cache_subtree());
+    EXPECT_TRUE(tabs[1]->cache_subtree());
+    EXPECT_TRUE(tabs[2]->cache_subtree());
+
+    notebook.page_cache(0);
+    EXPECT_FALSE(tabs[1]->cache_subtree());
+    EXPECT_FALSE(tabs[2]->cache_subtree());
+}
+
+TEST(ScrolledView, DeferOffscreenLayout)
+{
+    egt::Application app;
+    egt::TopWindow win;
+    egt::ScrolledView view(win, egt::Rect(0, 0, 100, 100),
+                           egt::ScrolledView::Policy::never,
+                           egt::ScrolledView::Policy::as_needed);
+    view.defer_offscreen_layout(true);
+
+    std::vector<std::shared_ptr<egt::Label>> labels;
+    for (auto i = 0; i < 20; ++i)
+        labels.push_back(view.spawn<egt::Label>("label", egt::Rect(0, i * 50, 100, 50)));
+    win.show();
+    app.event().draw();
+
+    EXPECT_FALSE(labels.front()->layout_pending());
+    EXPECT_TRUE(labels.back()->layout_pending());
+
+    // scrolled into view, the last label is laid out before it is drawn
+    view.voffset(view.offset_min().y());
+    app.event().draw();
+    EXPECT_FALSE(labels.back()->layout_pending());
+}
+
+TEST(Scrollwheel, RangeItems)
+{
+    egt::Application app;
+
+    egt::Scrollwheel wheel(egt::Rect(0, 0, 50, 100), 1900, 2100, 1);
+    EXPECT_EQ(wheel.item_count(), 201U);
+    EXPECT_EQ(wheel.value(), "1900");
+
+    wheel.selected(100);
+    EXPECT_EQ(wheel.value(), "2000");
+
+    // adding an item keeps the range
+    wheel.add_item("later");
+    EXPECT_EQ(wheel.item_count(), 202U);
+    EXPECT_EQ(wheel.item(200), "2100");
+    EXPECT_EQ(wheel.value(), "2000");
+}
+
+TEST(SelectableGrid, CellLayout)
+{
+    egt::Application app;
+
+    egt::SelectableGrid grid(egt::Rect(0, 0, 100, 100), egt::StaticGrid::GridSize(10, 10));
+    grid.margin(0);
+    grid.padding(0);
+    grid.border(0);
+
+    std::vector<std::shared_ptr<egt::Frame>> cells;
+    for (auto i = 0; i < 100; ++i)
+    {
+        cells.push_back(std::make_shared<egt::Frame>(egt::Rect(0, 0, 4, 4)));
+        grid.add(cells.back());
+    }
+    EXPECT_EQ(grid.last_add_column(), 9);
+    EXPECT_EQ(grid.last_add_row(), 9);
+
+    // a removed cell is filled again first
+    grid.remove(cells[23].get());
+    auto cell = std::make_shared<egt::Frame>(egt::Rect(0, 0, 4, 4));
+    grid.add(cell);
+    EXPECT_EQ(grid.last_add_column(), 3);
+    EXPECT_EQ(grid.last_add_row(), 2);
+    EXPECT_EQ(grid.get(egt::StaticGrid::GridPoint(3, 2)), cell.get());
+
+    grid.layout();
+    EXPECT_EQ(cell->box(), egt::Rect(33, 23, 4, 4));
+
+    egt::Event event(egt::EventId::raw_pointer_down, egt::Pointer(egt::DisplayPoint(25, 35)));
+    grid.handle(event);
+    EXPECT_EQ(grid.selected(), egt::StaticGrid::GridPoint(2, 3));
+}
+
+TEST(EventLoop, UpdateChannel)
+{
+    egt::Application app;
+
+    std::vector<int> applied;
+    egt::UpdateChannel<int> channel(app.event(), [&applied](const int& value)
+    {
+        applied.push_back(value);
+    });
+
+    std::thread producer([&channel]()
+    {
+        for (auto i = 1; i <= 1000; ++i)
+            channel.post(i);
+    });
+    producer.join();
+
+    // only the last value is applied
+    app.event().poll();
+    ASSERT_EQ(applied.size(), 1U);
+    EXPECT_EQ(applied.back(), 1000);
+
+    channel.post(1001);
+    app.event().poll();
+    ASSERT_EQ(applied.size(), 2U);
+    EXPECT_EQ(applied.back(), 1001);
+}
+
+TEST(Binding, Coalesce)
+{
+    egt::Application app;
+
+    egt::Observable<int> voltage(12);
+    egt::Observable<int> current(2);
+    auto computed = 0;
+    egt::Computed<int> power([&]()
+    {
+        ++computed;
+        return voltage * current;
+    }, voltage, current);
+    computed = 0;
+
+    egt::Slider slider;
+    std::vector<int> notified;
+    slider.on_value_changed([&slider, &notified]() { notified.push_back(slider.value()); });
+    egt::bind(power, slider);
+    notified.clear();
+
+    // one notification, with the last value, and one computation per flush
+    voltage = 10;
+    voltage = 20;
+    current = 3;
+    EXPECT_TRUE(notified.empty());
+    app.event().poll();
+    ASSERT_EQ(notified.size(), 1U);
+    EXPECT_EQ(notified.back(), 60);
+    EXPECT_EQ(computed, 1);
+
+    // set back to the notified value before the flush
+    voltage = 30;
+    voltage = 20;
+    app.event().poll();
+    EXPECT_EQ(notified.size(), 1U);
+    EXPECT_EQ(computed, 1);
+}
+
+TEST(Metrics, Sample)
+{
+    egt::experimental::CPUMonitorUsage cpu;
+    cpu.update();
+    cpu.update();
+    EXPECT_GE(cpu.usage(), 0.);
+    EXPECT_LE(cpu.usage(), 100.);
+
+    egt::experimental::MetricsSampler sampler;
+    auto updates = 0;
+    sampler.on_update([&updates](const egt::experimental::SystemMetrics & metrics)
+    {
+        ++updates;
+        EXPECT_GT(metrics.memory_total, 0U);
+        EXPECT_LE(metrics.memory_available, metrics.memory_total);
+        EXPECT_FALSE(metrics.cores.empty());
+        for (auto core : metrics.cores)
+        {
+            EXPECT_GE(core, 0.);
+            EXPECT_LE(core, 100.);
+        }
+    });
+    sampler.sample();
+    EXPECT_EQ(updates, 1);
+}
+
+TEST(Metrics, PerfHud)
+{
+    egt::Application app;
+    egt::TopWindow win;
+
+    const auto enabled = egt::Profiler::instance().enabled();
+    {
+        egt::experimental::PerfHud hud;
+        // composed with the main window without an overlay plane
+        if (!hud.plane_window())
+        {
+            EXPECT_EQ(hud.parent(), &win);
+        }
+        EXPECT_TRUE(egt::Profiler::instance().enabled());
+
+        hud.show();
+        hud.sampler().sample();
+        app.event().draw();
+    }
+    EXPECT_EQ(egt::Profiler::instance().enabled(), enabled);
+}
+
+TEST(EventLoop, Submit)
+{
+    egt::Application app;
+
+    auto result = 0;
+    app.event().submit([]() { return 6 * 7; }, [&result](int value) { result = value; });
+
+    auto cancelled = false;
+    const auto handle = app.event().submit([]() {}, [&cancelled]() { cancelled = true; },
+                                           egt::EventLoop::WorkPriority::low);
+    app.event().cancel(handle);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!result && std::chrono::steady_clock::now() < deadline)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(result, 42);
+    EXPECT_FALSE(cancelled);
+}
+
+TEST(FdMonitor, Readable)
+{
+    egt::Application app;
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    std::string received;
+    egt::FdMonitor monitor(fds[0], [&received, &fds]()
+    {
+        char buffer[16];
+        ssize_t ret;
+        while ((ret = read(fds[0], buffer, sizeof(buffer))) > 0)
+            received.append(buffer, ret);
+    }, egt::FdMonitor::Priority::input, true);
+
+    auto wait = [&app, &received](size_t size)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (received.size() < size && std::chrono::steady_clock::now() < deadline)
+        {
+            app.event().poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    ASSERT_EQ(write(fds[1], "egt", 3), 3);
+    wait(3);
+    EXPECT_EQ(received, "egt");
+
+    // nothing is read while stopped
+    monitor.stop();
+    ASSERT_EQ(write(fds[1], "gpio", 4), 4);
+    for (auto i = 0; i < 10; i++)
+        app.event().poll();
+    EXPECT_EQ(received, "egt");
+
+    monitor.start();
+    wait(7);
+    EXPECT_EQ(received, "egtgpio");
+
+    close(fds[1]);
+}
+
+#ifdef EGT_HAS_CAN
+TEST(Can, SignalDecode)
+{
+    egt::CanFrame frame;
+    frame.size = 4;
+    frame.data = {0x34, 0x12, 0xff, 0x80};
+
+    double value = 0;
+
+    // little endian, 16 bits from bit 0
+    egt::CanSignal rpm;
+    rpm.length = 16;
+    ASSERT_TRUE(rpm.decode(frame, value));
+    EXPECT_EQ(value, 0x1234);
+
+    // big endian, 16 bits with the most significant bit 7
+    rpm.big_endian = true;
+    rpm.start = 7;
+    ASSERT_TRUE(rpm.decode(frame, value));
+    EXPECT_EQ(value, 0x3412);
+
+    // signed, scaled, and offset
+    egt::CanSignal temperature;
+    temperature.start = 16;
+    temperature.length = 8;
+    temperature.is_signed = true;
+    temperature.scale = 0.5;
+    temperature.offset = 10;
+    ASSERT_TRUE(temperature.decode(frame, value));
+    EXPECT_EQ(value, 9.5);
+
+    // past the data of the frame
+    temperature.start = 32;
+    EXPECT_FALSE(temperature.decode(frame, value));
+}
+
+TEST(Can, Binding)
+{
+    egt::Application app;
+
+    std::vector<double> applied;
+    egt::CanBinding binding(app.event());
+    egt::CanSignal speed;
+    speed.id = 0x100;
+    binding.bind(speed, [&applied](const double & value) { applied.push_back(value); });
+
+    std::vector<egt::CanFrame> frames(100);
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        frames[i].id = i % 2 ? 0x100 : 0x200;
+        frames[i].size = 1;
+        frames[i].data[0] = i;
+    }
+
+    // only the latest value is applied
+    binding.feed(frames.data(), frames.size());
+    binding.feed(frames.data(), frames.size() - 2);
+    app.event().poll();
+    ASSERT_EQ(applied.size(), 1U);
+    EXPECT_EQ(applied.back(), 97);
+
+    const auto filters = binding.filters();
+    ASSERT_EQ(filters.size(), 1U);
+    EXPECT_EQ(filters[0].id, 0x100U);
+}
+#endif
+
+TEST(FileDialog, AsyncListing)
+{
+    egt::Application app;
+
+    const auto path = "/tmp/egt-files-" + std::to_string(getpid());
+    mkdir(path.c_str(), 0700);
+    mkdir((path + "/sub").c_str(), 0700);
+    for (auto i = 0; i < 300; i++)
+        std::ofstream(path + "/file" + std::to_string(i) + ".txt");
+    std::ofstream(path + "/image.png");
+
+    struct Dialog : public egt::FileOpenDialog
+    {
+        using egt::FileOpenDialog::FileOpenDialog;
+        size_t count() const { return m_flist->item_count(); }
+    };
+
+    Dialog dialog(path);
+    dialog.show();
+
+    auto wait_count = [&app, &dialog](size_t count)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (dialog.count() != count && std::chrono::steady_clock::now() < deadline)
+        {
+            app.event().poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return dialog.count();
+    };
+
+    // "./", "../", the directory, and the files
+    EXPECT_EQ(wait_count(2 + 1 + 301), 2U + 1 + 301);
+
+    // directories are always listed
+    dialog.filter("*.png");
+    EXPECT_EQ(wait_count(2 + 1 + 1), 2U + 1 + 1);
+
+    // a change in the directory lists it again
+    std::ofstream(path + "/other.png");
+    EXPECT_EQ(wait_count(2 + 1 + 2), 2U + 1 + 2);
+
+    dialog.hide();
+    for (auto i = 0; i < 300; i++)
+        unlink((path + "/file" + std::to_string(i) + ".txt").c_str());
+    unlink((path + "/image.png").c_str());
+    unlink((path + "/other.png").c_str());
+    rmdir((path + "/sub").c_str());
+    rmdir(path.c_str());
+}
+
+TEST(Application, Snapshot)
+{
+    egt::Application app;
+    egt::TopWindow window;
+    egt::Button button(window, "Snapshot", egt::Rect(10, 10, 100, 40));
+    window.show();
+    app.event().draw();
+
+    auto wait = [&app](const std::string & path, egt::Application::SnapshotOptions options)
+    {
+        int result = -1;
+        app.snapshot(path, options, [&result](bool ok) { result = ok; });
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (result < 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            app.event().poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return result;
+    };
+
+    const auto path = "/tmp/egt-snapshot-" + std::to_string(getpid());
+
+    egt::Application::SnapshotOptions options;
+    options.region = egt::Rect(0, 0, 64, 32);
+    ASSERT_EQ(wait(path + ".png", options), 1);
+
+    char signature[8] = {};
+    std::ifstream(path + ".png", std::ios_base::binary).read(signature, sizeof(signature));
+    EXPECT_EQ(std::string(signature + 1, 3), "PNG");
+
+    auto image = egt::shared_cairo_surface_t(
+                     cairo_image_surface_create_from_png((path + ".png").c_str()),
+                     cairo_surface_destroy);
+    EXPECT_EQ(cairo_image_surface_get_width(image.get()), 64);
+    EXPECT_EQ(cairo_image_surface_get_height(image.get()), 32);
+
+    options.format = egt::Application::SnapshotFormat::eraw_raw;
+    EXPECT_EQ(wait(path + ".eraw", options), 1);
+    EXPECT_TRUE(egt::detail::exists(path + ".eraw"));
+
+    // nothing of the screen in the region
+    options.region = egt::Rect(-100, -100, 10, 10);
+    EXPECT_EQ(wait(path + ".none", options), 0);
+
+    unlink((path + ".png").c_str());
+    unlink((path + ".eraw").c_str());
+}
+
+TEST(Animation, OnStopped)
+{
+    egt::Application app;
+
+    auto stopped = 0;
+    egt::PropertyAnimatorF animation(0, 1, std::chrono::milliseconds(20));
+    animation.on_stopped([&stopped]() { stopped++; });
+    animation.start();
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!stopped && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(stopped, 1);
+    EXPECT_FALSE(animation.running());
+
+    // stopping a stopped animation does not invoke it again
+    animation.stop();
+    EXPECT_EQ(stopped, 1);
+
+    animation.start();
+    animation.stop();
+    EXPECT_EQ(stopped, 2);
+}
+
+TEST(Animation, Batch)
+{
+    egt::Application app;
+
+    egt::AnimationBatch batch;
+    std::vector<egt::AnimationBatch::Index> indexes;
+    for (auto i = 0; i < 1000; ++i)
+        indexes.push_back(batch.add(0, i, std::chrono::milliseconds(1000)));
+    EXPECT_EQ(batch.size(), 1000U);
+    EXPECT_EQ(batch.pending(), 1000U);
+
+    size_t steps = 0;
+    size_t changes = 0;
+    batch.on_change([&](const std::vector<egt::AnimationBatch::Index>& changed)
+    {
+        steps++;
+        changes = changed.size();
+    });
+    batch.start();
+
+    // one callback per step, for all of the values that moved
+    const auto t0 = std::chrono::steady_clock::now();
+    EXPECT_TRUE(batch.advance(t0 + std::chrono::milliseconds(500)));
+    EXPECT_EQ(steps, 1U);
+    EXPECT_EQ(changes, 999U);
+    EXPECT_NEAR(batch.value(indexes[999]), 999 * 0.5f, 10.f);
+
+    // indexes are reused
+    batch.remove(indexes[10]);
+    EXPECT_EQ(batch.size(), 999U);
+    EXPECT_EQ(batch.add(5, 5, std::chrono::milliseconds(0)), indexes[10]);
+    EXPECT_TRUE(batch.done(indexes[10]));
+
+    EXPECT_FALSE(batch.advance(t0 + std::chrono::milliseconds(1500)));
+    EXPECT_EQ(steps, 2U);
+    EXPECT_EQ(batch.pending(), 0U);
+    EXPECT_FLOAT_EQ(batch.value(indexes[999]), 999.f);
+    EXPECT_FLOAT_EQ(batch.value(indexes[10]), 5.f);
+
+    // eased values follow the function of the batch
+    egt::AnimationBatch eased(egt::easing_bounce);
+    const auto index = eased.add(0, 100, std::chrono::milliseconds(1000),
+                                 std::chrono::milliseconds(1000));
+    eased.start();
+    const auto t1 = std::chrono::steady_clock::now();
+    EXPECT_TRUE(eased.advance(t1 + std::chrono::milliseconds(500)));
+    EXPECT_FLOAT_EQ(eased.value(index), 0.f);
+    EXPECT_TRUE(eased.advance(t1 + std::chrono::milliseconds(1500)));
+    EXPECT_NEAR(eased.value(index), 100 * egt::easing_bounce(0.5f), 2.f);
+}
+
+TEST(Arena, Widgets)
+{
+    egt::Application app;
+
+    egt::experimental::Arena arena(1024);
+    {
+        egt::Frame frame;
+        for (auto i = 0; i < 20; i++)
+            frame.add(arena.make_shared<egt::Label>("label"));
+
+        const auto stats = arena.stats();
+        EXPECT_EQ(stats.allocations, 20U);
+        EXPECT_EQ(stats.total_allocations, 20U);
+        EXPECT_GE(stats.bytes, 20 * sizeof(egt::Label));
+        EXPECT_GE(stats.reserved, stats.bytes);
+    }
+
+    // the blocks are reclaimed once all the widgets are released
+    const auto stats = arena.stats();
+    EXPECT_EQ(stats.allocations, 0U);
+    EXPECT_EQ(stats.bytes, 0U);
+    EXPECT_EQ(stats.reserved, 1024U);
+}
+
+namespace
+{
+/// A compiled UI file, aligned like a memory mapped one.
+class CompiledUi
+{
+public:
+    explicit CompiledUi(const std::string& bytes)
+        : m_size(bytes.size()),
+          m_words((bytes.size() + 3) / 4)
+    {
+        std::memcpy(m_words.data(), bytes.data(), bytes.size());
+    }
+
+    char* data() { return reinterpret_cast<char*>(m_words.data()); }
+
+    size_t size() const { return m_size; }
+
+    const egt::detail::ui::Header* verify() const
+    {
+        return egt::detail::ui::verify(m_words.data(), m_size);
+    }
+
+    /// Position of an object of the file.
+    size_t pos(const void* object)
+    {
+        return static_cast<const char*>(object) - data();
+    }
+
+    /// Set a 32 bit field of the file.
+    void set(size_t pos, uint32_t value)
+    {
+        std::memcpy(data() + pos, &value, sizeof(value));
+    }
+
+    /// Point an offset field of the file to a position.
+    void link(size_t field, size_t target)
+    {
+        set(field, static_cast<uint32_t>(target - field));
+    }
+
+private:
+    size_t m_size;
+    std::vector<uint32_t> m_words;
+};
+
+/// A document with an element holding attributes and two children.
+std::string compiled_document()
+{
+    egt::detail::ui::Builder builder;
+    builder.begin("");
+    builder.begin("egt");
+    builder.attribute("a", "1");
+    builder.attribute("b", "2");
+    builder.begin("widget", "text");
+    builder.attribute("name", "first");
+    builder.end();
+    builder.begin("widget");
+    builder.end();
+    builder.end();
+    builder.end();
+    EXPECT_EQ(builder.depth(), 0U);
+
+    std::ostringstream out;
+    builder.write(out);
+    return out.str();
+}
+
+std::string serialize(const egt::Widget& widget)
+{
+    egt::XmlWidgetSerializer xml;
+    xml.add(&widget);
+    std::ostringstream out;
+    xml.write(out);
+    return out.str();
+}
+}
+
+TEST(UiBinary, RoundTrip)
+{
+    CompiledUi file(compiled_document());
+    EXPECT_EQ(file.data()[file.size() - 1], '\0');
+
+    auto header = file.verify();
+    ASSERT_NE(header, nullptr);
+    EXPECT_EQ(header->size, file.size());
+
+    auto document = header->document();
+    ASSERT_NE(document, nullptr);
+    EXPECT_STREQ(document->name(), "");
+    EXPECT_EQ(document->next_sibling(), nullptr);
+
+    auto egt = document->first_node("egt");
+    ASSERT_NE(egt, nullptr);
+    EXPECT_EQ(egt->first_node("nothing"), nullptr);
+    EXPECT_EQ(egt->next_sibling(), nullptr);
+    ASSERT_NE(egt->first_attribute("b"), nullptr);
+    EXPECT_STREQ(egt->first_attribute("b")->value(), "2");
+    EXPECT_STREQ(egt->first_attribute()->name(), "a");
+    EXPECT_EQ(egt->first_attribute("c"), nullptr);
+
+    auto first = egt->first_node("widget");
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(std::string(first->value(), first->value_size()), "text");
+    EXPECT_STREQ(first->first_attribute("name")->value(), "first");
+
+    auto second = first->next_sibling("widget");
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(second->value_size(), 0U);
+    EXPECT_EQ(second->first_attribute(), nullptr);
+    EXPECT_EQ(second->first_node(), nullptr);
+    EXPECT_EQ(second->next_sibling(), nullptr);
+
+    // strings are stored once
+    EXPECT_EQ(first->name(), second->name());
+}
+
+TEST(UiBinary, Verify)
+{
+    using egt::detail::ui::Attribute;
+    using egt::detail::ui::Header;
+    using egt::detail::ui::Node;
+
+    const auto bytes = compiled_document();
+
+    // positions of the objects in the file
+    CompiledUi original(bytes);
+    auto header = original.verify();
+    ASSERT_NE(header, nullptr);
+    const auto egt = header->document()->first_node();
+    const auto b = original.pos(egt->first_attribute("b"));
+    const auto first = original.pos(egt->first_node());
+    const auto first_name = original.pos(egt->first_node()->first_attribute());
+    const auto second = original.pos(egt->first_node()->next_sibling());
+    const auto node = original.pos(egt);
+
+    const auto rejected = [&bytes](const std::function<void(CompiledUi&)>& change)
+    {
+        CompiledUi file(bytes);
+        change(file);
+        return file.verify() == nullptr;
+    };
+
+    EXPECT_FALSE(rejected([](CompiledUi&) {}));
+
+    // header
+    EXPECT_TRUE(rejected([](CompiledUi & file)
+    {
+        file.set(offsetof(Header, magic), 0);
+    }));
+    EXPECT_TRUE(rejected([](CompiledUi & file)
+    {
+        file.set(offsetof(Header, version), egt::detail::ui::VERSION + 1);
+    }));
+    EXPECT_TRUE(rejected([](CompiledUi & file)
+    {
+        file.set(offsetof(Header, size), file.size() + 4);
+    }));
+    EXPECT_TRUE(rejected([](CompiledUi & file)
+    {
+        file.data()[file.size() - 1] = 'x';
+    }));
+    EXPECT_EQ(egt::detail::ui::verify(original.data(), sizeof(Header) - 4), nullptr);
+    EXPECT_EQ(egt::detail::ui::verify(original.data() + 1, original.size() - 1), nullptr);
+
+    // offsets pointing backward, out of the file, or misaligned
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(second + offsetof(Node, m_child), node);
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(second + offsetof(Node, m_child), file.size() + 4);
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(second + offsetof(Node, m_child), file.size() - 8);
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(second + offsetof(Node, m_name), file.size());
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(node + offsetof(Node, m_child), first + 2);
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.set(first + offsetof(Node, m_value_size), file.size());
+    }));
+
+    // a node or an attribute referenced twice
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(node + offsetof(Node, m_sibling), first);
+    }));
+    EXPECT_TRUE(rejected([&](CompiledUi & file)
+    {
+        file.link(b + offsetof(Attribute, m_next), first_name);
+    }));
+}
+
+TEST(UiLoader, Compiled)
+{
+    egt::Application app;
+
+    const auto path = "/tmp/egt-ui-" + std::to_string(getpid());
+    const std::string xml =
+        "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "<egt>\n"
+        "  <widgets>\n"
+        "    <widget name=\"Window0\" type=\"Window\">\n"
+        "      <property name=\"width\">200</property>\n"
+        "      <property name=\"height\">100</property>\n"
+        "      <widget name=\"Label0\" type=\"Label\">\n"
+        "        <property name=\"x\">10</property>\n"
+        "        <property name=\"text\">compiled</property>\n"
+        "      </widget>\n"
+        "      <widget name=\"Button0\" type=\"Button\">\n"
+        "        <property name=\"y\">50</property>\n"
+        "        <property name=\"text\">ok</property>\n"
+        "      </widget>\n"
+        "    </widget>\n"
+        "  </widgets>\n"
+        "</egt>\n";
+
+    {
+        std::ofstream out(path + ".xml");
+        out << xml;
+    }
+
+    // compiled the same way as ui-compile does
+    {
+        std::vector<char> buffer(xml.begin(), xml.end());
+        buffer.push_back('\0');
+        rapidxml::xml_document<> doc;
+        doc.parse<rapidxml::parse_no_data_nodes>(buffer.data());
+
+        std::ofstream out(path + ".eui", std::ios_base::binary);
+        egt::detail::ui::compile(doc, out, [](const std::string&, std::string&,
+                                              std::vector<std::pair<std::string, std::string>>&) {});
+    }
+
+    egt::experimental::UiLoader loader;
+    auto from_xml = loader.load("file:" + path + ".xml");
+    auto from_compiled = loader.load("file:" + path + ".eui");
+    ASSERT_NE(from_xml, nullptr);
+    ASSERT_NE(from_compiled, nullptr);
+    EXPECT_EQ(serialize(*from_xml), serialize(*from_compiled));
+    EXPECT_NE(serialize(*from_compiled).find("compiled"), std::string::npos);
+
+    // a corrupted compiled file is not loaded
+    {
+        std::fstream file(path + ".eui", std::ios_base::binary | std::ios_base::in |
+                          std::ios_base::out);
+        file.seekp(offsetof(egt::detail::ui::Header, version));
+        file.put('\x7f');
+    }
+    EXPECT_THROW(loader.load("file:" + path + ".eui"), std::runtime_error);
+
+    unlink((path + ".xml").c_str());
+    unlink((path + ".eui").c_str());
+}
+
+TEST(UiLoader, BinarySerializer)
+{
+    egt::Application app;
+
+    const auto path = "/tmp/egt-serializer-" + std::to_string(getpid());
+
+    egt::Window window(egt::Size(200, 100));
+    window.name("Window0");
+    auto label = std::make_shared<egt::Label>("serialized", egt::Rect(10, 10, 100, 30));
+    label->name("Label0");
+    window.add(label);
+    auto button = std::make_shared<egt::Button>("ok", egt::Rect(10, 50, 80, 30));
+    button->name("Button0");
+    window.add(button);
+
+    egt::XmlWidgetSerializer xml;
+    xml.add(&window);
+    xml.write(path + ".xml");
+
+    egt::BinaryWidgetSerializer binary;
+    binary.add(&window);
+    binary.write(path + ".eui");
+
+    // the binary output is a valid compiled file
+    std::ifstream in(path + ".eui", std::ios_base::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    CompiledUi file(bytes);
+    ASSERT_NE(file.verify(), nullptr);
+
+    // and loads to the same widgets as the XML
+    egt::experimental::UiLoader loader;
+    auto from_xml = loader.load("file:" + path + ".xml");
+    auto from_binary = loader.load("file:" + path + ".eui");
+    ASSERT_NE(from_xml, nullptr);
+    ASSERT_NE(from_binary, nullptr);
+    EXPECT_EQ(serialize(*from_xml), serialize(*from_binary));
+    EXPECT_NE(serialize(*from_binary).find("serialized"), std::string::npos);
+    EXPECT_EQ(from_binary->name(), "Window0");
+
+    unlink((path + ".xml").c_str());
+    unlink((path + ".eui").c_str());
+}
+
+TEST(Application, StartupTimeline)
+{
+    egt::Application app;
+
+    std::vector<std::string> names;
+    for (const auto& stage : app.startup_timeline())
+        names.push_back(stage.name);
+
+    EXPECT_NE(std::find(names.begin(), names.end(), "backend"), names.end());
+    EXPECT_NE(std::find(names.begin(), names.end(), "inputs"), names.end());
+    EXPECT_TRUE(std::is_sorted(app.startup_timeline().begin(), app.startup_timeline().end(),
+                               [](const auto & lhs, const auto & rhs) { return lhs.start < rhs.start; }));
+}
+
+TEST(NeedleLayer, Prerotate)
+{
+    egt::Application app;
+
+    egt::Canvas needle(egt::Size(30, 4));
+    {
+        egt::Painter painter(needle.context());
+        painter.set(egt::Palette::red);
+        painter.paint();
+    }
+
+    egt::experimental::NeedleLayer layer(egt::Image(needle.surface()), 0, 90, 0, 90);
+    layer.needle_center(egt::PointF(0, 2));
+    layer.needle_point(egt::PointF(50.5, 50));
+    layer.value(30);
+
+    auto render = [&layer]()
+    {
+        egt::Canvas canvas(egt::Size(100, 100));
+        canvas.zero();
+        egt::Painter painter(canvas.context());
+        layer.draw(painter, egt::Rect(0, 0, 100, 100));
+        cairo_surface_flush(canvas.surface().get());
+        const auto data = cairo_image_surface_get_data(canvas.surface().get());
+        return std::vector<unsigned char>(data, data + cairo_image_surface_get_stride(canvas.surface().get()) * 100);
+    };
+
+    const auto rotated = render();
+
+    // a frame for every value draws the same needle
+    layer.prerotate(91);
+    EXPECT_EQ(layer.prerotate(), 91U);
+    const auto frame = render();
+    ASSERT_EQ(rotated.size(), frame.size());
+    size_t different = 0;
+    for (size_t i = 0; i < rotated.size(); ++i)
+        different += std::abs(rotated[i] - frame[i]) > 1;
+    EXPECT_EQ(different, 0U);
+
+    // with fewer frames, the nearest one is drawn
+    layer.prerotate(4);
+    layer.value(40);
+    const auto nearest = render();
+    layer.prerotate(0);
+    layer.value(30);
+    different = 0;
+    for (size_t i = 0; i < rotated.size(); ++i)
+        different += std::abs(rotated[i] - nearest[i]) > 1;
+    EXPECT_EQ(different, 0U);
+}
+
+#ifdef EGT_HAS_SVG
+TEST(SvgImage, Cache)
+{
+    const auto dir = ::testing::TempDir() + "egt_svg_cache";
+    mkdir(dir.c_str(), 0755);
+    const auto path = ::testing::TempDir() + "egt_cache.svg";
+    {
+        std::ofstream o(path);
+        o << R"(<svg xmlns="http://www.w3.org/2000/svg" width="20" height="10">)"
+          << R"(<rect id="box" x="10" y="0" width="10" height="10" fill="#ff0000"/></svg>)";
+    }
+
+    egt::SvgImage::cache_dir(dir);
+
+    egt::SvgImage first("file:" + path);
+    const auto rendered = first.render("#box", first.id_box("#box"));
+    EXPECT_FALSE(egt::detail::glob(dir + "/*.eraw").empty());
+
+    // the second time comes from the cache
+    egt::SvgImage second("file:" + path);
+    EXPECT_EQ(second.size(), egt::SizeF(20, 10));
+    EXPECT_TRUE(second.id_exists("#box"));
+    EXPECT_FALSE(second.id_exists("#missing"));
+    const auto cached = second.render("#box", second.id_box("#box"));
+    ASSERT_EQ(cached.size(), rendered.size());
+    EXPECT_EQ(std::memcmp(cairo_image_surface_get_data(cached.surface().get()),
+                          cairo_image_surface_get_data(rendered.surface().get()),
+                          cairo_image_surface_get_stride(rendered.surface().get()) *
+                          rendered.size().height()), 0);
+
+    egt::SvgImage::cache_dir({});
+    for (const auto& file : egt::detail::glob(dir + "/*"))
+        std::remove(file.c_str());
+    rmdir(dir.c_str());
+    std::remove(path.c_str());
+}
+
+TEST(GaugeLayer, RenderAsync)
+{
+    egt::Application app;
+
+    const auto path = ::testing::TempDir() + "egt_gauge.svg";
+    {
+        std::ofstream o(path);
+        o << R"(<svg xmlns="http://www.w3.org/2000/svg" width="20" height="10">)"
+          << R"(<rect id="box" x="10" y="0" width="10" height="10" fill="#ff0000"/></svg>)";
+    }
+
+    egt::experimental::Gauge gauge;
+    auto background = std::make_shared<egt::experimental::GaugeLayer>();
+    auto box = std::make_shared<egt::experimental::GaugeLayer>();
+    {
+        // the svg does not have to outlive the rendering
+        egt::SvgImage svg("file:" + path);
+        background->image(svg);
+        box->image(svg, "#box", svg.id_box("#box"));
+        gauge.add(background);
+        gauge.add(box);
+    }
+
+    // the layers are sized before they are rendered
+    EXPECT_EQ(background->size(), egt::Size(20, 10));
+    EXPECT_EQ(gauge.size().width(), 20);
+    const auto placeholder = box->image().surface();
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (box->image().surface() == placeholder && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_NE(box->image().surface(), placeholder);
+    const auto surface = box->image().surface().get();
+    cairo_surface_flush(surface);
+    EXPECT_EQ(*reinterpret_cast<const uint32_t*>(cairo_image_surface_get_data(surface)), 0xffff0000);
+
+    std::remove(path.c_str());
+}
+#endif
+
+#ifdef EGT_HAS_HTTP
+/// Answer the next HTTP request with a canned response, keeping the request.
+static void serve_http(egt::asio::ip::tcp::acceptor& acceptor, const std::string& response,
+                       std::string& request)
+{
+    auto socket = std::make_shared<egt::asio::ip::tcp::socket>(egt::Application::instance().event().io());
+    acceptor.async_accept(*socket, [socket, response, &request](const egt::asio::error_code & ec)
+    {
+        if (ec)
+            return;
+
+        auto buffer = std::make_shared<egt::asio::streambuf>();
+        egt::asio::async_read_until(*socket, *buffer, "\r\n\r\n",
+                               [socket, buffer, response, &request](const egt::asio::error_code & ec, size_t)
+        {
+            if (ec)
+                return;
+
+            request.assign(egt::asio::buffers_begin(buffer->data()), egt::asio::buffers_end(buffer->data()));
+            auto data = std::make_shared<std::string>(response);
+            egt::asio::async_write(*socket, egt::asio::buffer(*data), [socket, data](const egt::asio::error_code&, size_t)
+            {
+                egt::asio::error_code ignored;
+                socket->shutdown(egt::asio::ip::tcp::socket::shutdown_both, ignored);
+            });
+        });
+    });
+}
+
+/// Answer every HTTP request on the connection, keeping it alive.
+static void serve_http_keepalive(std::shared_ptr<egt::asio::ip::tcp::socket> socket,
+                                 std::shared_ptr<egt::asio::streambuf> buffer)
+{
+    egt::asio::async_read_until(*socket, *buffer, "\r\n\r\n",
+                                [socket, buffer](const egt::asio::error_code & ec, size_t len)
+    {
+        if (ec)
+            return;
+
+        buffer->consume(len);
+        auto data = std::make_shared<std::string>("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+        egt::asio::async_write(*socket, egt::asio::buffer(*data),
+                               [socket, buffer, data](const egt::asio::error_code & ec, size_t)
+        {
+            if (!ec)
+                serve_http_keepalive(socket, buffer);
+        });
+    });
+}
+
+TEST(HttpClientRequest, Cache)
+{
+    egt::Application app;
+
+    const auto dir = ::testing::TempDir() + "egt_http_cache";
+    mkdir(dir.c_str(), 0755);
+    egt::experimental::HttpClientRequest::cache_dir(dir);
+
+    egt::asio::ip::tcp::acceptor acceptor(app.event().io(),
+                                     egt::asio::ip::tcp::endpoint(egt::asio::ip::address_v4::loopback(), 0));
+    const auto url = "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/image";
+
+    auto fetch = [&](const std::string & response, std::string & request, bool & cached)
+    {
+        serve_http(acceptor, response, request);
+
+        std::string body;
+        bool finished = false;
+        egt::experimental::HttpClientRequest client;
+        client.start_async(url, [&body, &finished](const unsigned char* data, size_t len, bool done)
+        {
+            if (data && len)
+                body.append(reinterpret_cast<const char*>(data), len);
+            finished = done;
+        });
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!finished && std::chrono::steady_clock::now() < end)
+        {
+            app.event().poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_TRUE(finished);
+        EXPECT_TRUE(client.ok());
+        cached = client.cached();
+        return body;
+    };
+
+    std::string request;
+    bool cached = false;
+    EXPECT_EQ(fetch("HTTP/1.1 200 OK\r\nETag: \"v1\"\r\nContent-Length: 5\r\n"
+                    "Connection: close\r\n\r\nhello", request, cached), "hello");
+    EXPECT_EQ(request.find("If-None-Match"), std::string::npos);
+    EXPECT_FALSE(cached);
+
+    // not modified, so read from the cache
+    EXPECT_EQ(fetch("HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\n"
+                    "Connection: close\r\n\r\n", request, cached), "hello");
+    EXPECT_NE(request.find("If-None-Match: \"v1\""), std::string::npos);
+    EXPECT_TRUE(cached);
+
+    // requests share the connection manager, bound to this application, so
+    // connection reuse is checked here too
+    auto socket = std::make_shared<egt::asio::ip::tcp::socket>(app.event().io());
+    acceptor.async_accept(*socket, [socket](const egt::asio::error_code & ec)
+    {
+        if (!ec)
+            serve_http_keepalive(socket, std::make_shared<egt::asio::streambuf>());
+    });
+
+    const auto before = egt::experimental::HttpClientRequest::stats();
+
+    // every request after the first reuses its connection
+    for (auto i = 0; i < 3; i++)
+    {
+        std::string body;
+        bool finished = false;
+        egt::experimental::HttpClientRequest client;
+        client.start_async(url, [&body, &finished](const unsigned char* data, size_t len, bool done)
+        {
+            if (data && len)
+                body.append(reinterpret_cast<const char*>(data), len);
+            finished = done;
+        });
+
+        const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!finished && std::chrono::steady_clock::now() < end)
+        {
+            app.event().poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        EXPECT_TRUE(client.ok());
+        EXPECT_EQ(body, "ok");
+    }
+
+    const auto after = egt::experimental::HttpClientRequest::stats();
+    EXPECT_EQ(after.requests - before.requests, 3U);
+    EXPECT_EQ(after.connections - before.connections, 1U);
+    EXPECT_GE(after.max_time, after.total_time / static_cast<long>(after.requests));
+
+    // the data refused while paused is passed again once resumed
+    std::string body;
+    bool finished = false;
+    egt::experimental::HttpClientRequest client;
+    client.start_stream(url, [&body, &finished, &client](const unsigned char* data, size_t len, bool done)
+    {
+        if (data && len)
+        {
+            if (body.empty() && !client.paused())
+                return false;
+            body.append(reinterpret_cast<const char*>(data), len);
+        }
+        finished = done;
+        return true;
+    });
 
-TEST(TextBox, Basic)
-{
-    egt::Application app;
+    bool paused = false;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!finished && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        if (client.paused())
+        {
+            paused = true;
+            client.resume();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
 
-    std::string str1 = "hello world\nthis is EGT";
-    std::string str2 = "howdy";
+    EXPECT_TRUE(paused);
+    EXPECT_EQ(body, "ok");
 
-    egt::TextBox text1(str1);
-    ASSERT_EQ(str1, text1.text());
-    text1.text(str2);
-    ASSERT_EQ(str2, text1.text());
-    ASSERT_EQ(str2.size(), text1.len());
-    text1.append(str1);
-    ASSERT_EQ(str2 + str1, text1.text());
-    text1.cursor_begin();
-    text1.insert(str1);
-    ASSERT_EQ(str1 + str2 + str1, text1.text());
-    text1.cursor_end();
-    text1.insert(str1);
-    ASSERT_EQ(str1 + str2 + str1 + str1, text1.text());
-    text1.selection_all();
-    ASSERT_EQ(str1 + str2 + str1 + str1, text1.selected_text());
-    text1.selection(str1.size(), 5);
-    ASSERT_EQ(str2, text1.selected_text());
-    text1.selection_clear();
-    ASSERT_EQ("", text1.selected_text());
-    text1.selection_all();
-    text1.selection_delete();
-    ASSERT_EQ("", text1.text());
+    egt::experimental::HttpClientRequest::cache_dir({});
+    for (const auto& file : egt::detail::glob(dir + "/*"))
+        std::remove(file.c_str());
+    rmdir(dir.c_str());
 }
 
-TEST(TextBoxFixed, Basic)
+TEST(EventSource, Parse)
 {
     egt::Application app;
 
-    std::string str1 = "hello world\nthis is EGT";
-    std::string str2 = "howdy";
+    egt::asio::ip::tcp::acceptor acceptor(app.event().io(),
+                                     egt::asio::ip::tcp::endpoint(egt::asio::ip::address_v4::loopback(), 0));
+    const auto url = "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/events";
 
-    egt::TextBox text1(str1, egt::Size(1000, 1000), {}, egt::TextBox::TextFlag::fit_to_width);
-    ASSERT_EQ(str1, text1.text());
-    text1.text(str2);
-    ASSERT_EQ(str2, text1.text());
-    ASSERT_EQ(str2.size(), text1.len());
-    text1.append(str1);
-    ASSERT_EQ(str2 + str1, text1.text());
-    text1.cursor_begin();
-    text1.insert(str1);
-    ASSERT_EQ(str1 + str2 + str1, text1.text());
-    text1.cursor_end();
-    text1.insert(str1);
-    ASSERT_EQ(str1 + str2 + str1 + str1, text1.text());
-    text1.selection_all();
-    ASSERT_EQ(str1 + str2 + str1 + str1, text1.selected_text());
-    text1.selection(str1.size(), 5);
-    ASSERT_EQ(str2, text1.selected_text());
-    text1.selection_clear();
-    ASSERT_EQ("", text1.selected_text());
-    text1.selection_all();
-    text1.selection_delete();
-    ASSERT_EQ("", text1.text());
-}
+    std::string request;
+    serve_http(acceptor, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+               "Connection: close\r\n\r\n"
+               ": keepalive\r\n"
+               "data: one\r\n\r\n"
+               "event: temperature\nid: 7\ndata: 20\ndata:21\n\n"
+               "retry: 60000\r\n\r\n", request);
 
-TEST(Screen, DamageAlgorithm)
-{
-    egt::Screen::DamageArray damage;
-    egt::Screen::damage_algorithm(damage, egt::Rect(0, 0, 100, 100));
-    EXPECT_EQ(damage.front(), egt::Rect(0, 0, 100, 100));
-    egt::Screen::damage_algorithm(damage, egt::Rect(0, 0, 200, 200));
-    EXPECT_EQ(damage.size(), 1U);
-    EXPECT_EQ(damage.front(), egt::Rect(0, 0, 200, 200));
-}
+    std::vector<std::tuple<std::string, std::string, std::string>> events;
+    bool opened = false;
+    bool failed = false;
 
-TEST(Canvas, Basic)
-{
-    egt::Canvas canvas1(egt::Size(100, 100));
-    EXPECT_EQ(canvas1.size(), egt::Size(100, 100));
-    EXPECT_EQ(canvas1.format(), egt::PixelFormat::argb8888);
-    egt::Canvas canvas2(canvas1.surface());
-    EXPECT_EQ(canvas2.size(), egt::Size(100, 100));
-    EXPECT_EQ(canvas2.format(), egt::PixelFormat::argb8888);
+    egt::experimental::EventSource source;
+    source.on_open([&opened]() { opened = true; });
+    source.on_message([&events](const egt::experimental::EventSourceMessage & message)
+    {
+        events.emplace_back(message.event, message.data, message.id);
+    });
+    source.on_error([&failed](const std::string&) { failed = true; });
+    source.open(url);
 
-    egt::Canvas canvas3(egt::Size(100, 100), egt::PixelFormat::rgb565);
-    EXPECT_EQ(canvas3.size(), egt::Size(100, 100));
-    EXPECT_EQ(canvas3.format(), egt::PixelFormat::rgb565);
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!failed && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    source.close();
 
-    egt::Canvas canvas4(canvas3.surface());
-    EXPECT_EQ(canvas4.size(), egt::Size(100, 100));
-    EXPECT_EQ(canvas4.format(), egt::PixelFormat::rgb565);
+    EXPECT_TRUE(opened);
+    EXPECT_NE(request.find("Accept: text/event-stream"), std::string::npos);
+    ASSERT_EQ(events.size(), 2U);
+    EXPECT_EQ(events[0], std::make_tuple(std::string("message"), std::string("one"), std::string()));
+    EXPECT_EQ(events[1], std::make_tuple(std::string("temperature"), std::string("20\n21"), std::string("7")));
+    EXPECT_EQ(source.last_event_id(), "7");
 }
+#endif
 
 TEST(Geometry, Basic)
 {
@@ -245,6 +4339,58 @@ TEST(Geometry, Circless)
     EXPECT_TRUE(c1.empty());
 }
 
+TEST(Geometry, RectBatch)
+{
+    egt::detail::RectBatch batch;
+    EXPECT_EQ(batch.bounds(), egt::Rect());
+    EXPECT_EQ(batch.last_hit(egt::Point()), egt::detail::RectBatch::npos);
+
+    // a count that is not a multiple of the vector width exercises the tails
+    std::vector<egt::Rect> rects;
+    for (auto i = 0; i < 13; i++)
+        rects.emplace_back(i * 7 % 50, i * 11 % 40, 5 + i % 4, 6 + i % 3);
+    rects.emplace_back(0, 0, 0, 0);
+    for (const auto& rect : rects)
+        batch.push_back(rect);
+    ASSERT_EQ(batch.size(), rects.size());
+    EXPECT_EQ(batch.at(3), rects[3]);
+
+    auto bounds = rects.front();
+    for (const auto& rect : rects)
+        bounds = egt::Rect::merge(bounds, rect);
+    EXPECT_EQ(batch.bounds(), bounds);
+
+    const egt::Rect test(10, 10, 20, 15);
+    std::vector<uint8_t> mask;
+    const auto hits = batch.intersect(test, mask);
+    ASSERT_EQ(mask.size(), rects.size());
+    size_t expected = 0;
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        EXPECT_EQ(mask[i], rects[i].intersect(test)) << i;
+        expected += rects[i].intersect(test);
+    }
+    EXPECT_EQ(hits, expected);
+
+    for (auto y = -1; y < 50; y += 3)
+    {
+        for (auto x = -1; x < 60; x += 3)
+        {
+            const egt::Point point(x, y);
+            auto end = egt::detail::RectBatch::npos;
+            for (auto i = rects.size(); i--;)
+            {
+                if (rects[i].intersect(point))
+                {
+                    end = batch.last_hit(point, end);
+                    EXPECT_EQ(end, i);
+                }
+            }
+            EXPECT_EQ(batch.last_hit(point, end), egt::detail::RectBatch::npos);
+        }
+    }
+}
+
 template <class T>
 class Widgets : public testing::Test
 {
@@ -654,6 +4800,574 @@ TEST_F(SizerLayout, ChildCenter)
     EXPECT_EQ(widget.box().size(), egt::Size(100, 100));
 }
 
+TEST(Input, FocusChain)
+{
+    egt::Application app;
+    egt::TopWindow top;
+
+    egt::Frame form;
+    egt::TextBox a("a");
+    egt::Label label("label");
+    egt::TextBox b("b");
+    egt::TextBox c("c");
+    form.add(a);
+    form.add(label);
+    form.add(b);
+    form.add(c);
+
+    egt::Button button("ok");
+    button.focusable(true);
+
+    // the subtree joins the window at once
+    top.add(form);
+    top.add(button);
+    top.show();
+
+    EXPECT_EQ(egt::detail::next_focus(a), &b);
+    EXPECT_EQ(egt::detail::next_focus(b), &c);
+    EXPECT_EQ(egt::detail::next_focus(c), &button);
+    EXPECT_EQ(egt::detail::next_focus(button), &a);
+    EXPECT_EQ(egt::detail::next_focus(a, true), &button);
+    EXPECT_EQ(egt::detail::next_focus(label), nullptr);
+
+    b.hide();
+    EXPECT_EQ(egt::detail::next_focus(a), &c);
+    b.show();
+    EXPECT_EQ(egt::detail::next_focus(a), &b);
+
+    form.hide();
+    EXPECT_EQ(egt::detail::next_focus(button), nullptr);
+    form.show();
+    EXPECT_EQ(egt::detail::next_focus(button), &a);
+
+    c.disable();
+    EXPECT_EQ(egt::detail::next_focus(b), &button);
+    c.enable();
+
+    c.zorder_bottom();
+    EXPECT_EQ(egt::detail::next_focus(button), &c);
+    EXPECT_EQ(egt::detail::next_focus(c), &a);
+    EXPECT_EQ(egt::detail::next_focus(b), &button);
+
+    form.remove(&a);
+    EXPECT_EQ(egt::detail::next_focus(c), &b);
+    EXPECT_EQ(egt::detail::next_focus(a), nullptr);
+
+    egt::detail::keyboard_focus(nullptr);
+    EXPECT_EQ(egt::detail::move_focus(), &c);
+    EXPECT_EQ(egt::detail::move_focus(), &b);
+    EXPECT_EQ(egt::detail::move_focus(true), &c);
+
+    // a key press moves the focus instead of reaching the widget
+    egt::Event down(egt::EventId::keyboard_down, egt::Key(egt::EKEY_TAB));
+    egt::Event up(egt::EventId::keyboard_up, egt::Key(egt::EKEY_TAB));
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+    } input;
+    input.dispatch(down);
+    input.dispatch(up);
+    EXPECT_EQ(egt::detail::keyboard_focus(), &b);
+
+    egt::detail::keyboard_focus(nullptr);
+}
+
+TEST(Input, CoalesceMotion)
+{
+    egt::Application app;
+    egt::TopWindow window;
+    window.show();
+
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+    } input;
+
+    auto dispatch = [&input](egt::EventId id, int position)
+    {
+        egt::Event event(id, egt::Pointer(egt::DisplayPoint(position, position)));
+        input.dispatch(event);
+    };
+
+    std::vector<egt::EventId> ids;
+    std::vector<egt::DisplayPoint> points;
+    std::vector<size_t> history;
+    auto handle = egt::Input::global_input().on_event([&](egt::Event & event)
+    {
+        ids.push_back(event.id());
+        points.push_back(event.pointer().point);
+        history.push_back(egt::Input::motion_history().size());
+    }, {egt::EventId::raw_pointer_move, egt::EventId::raw_pointer_down, egt::EventId::raw_pointer_up});
+
+    // merged until the next frame
+    app.event().coalesce_motion(true);
+    for (auto i = 1; i <= 10; ++i)
+        dispatch(egt::EventId::raw_pointer_move, i);
+    EXPECT_TRUE(ids.empty());
+    app.event().draw();
+    EXPECT_EQ(ids, (std::vector<egt::EventId> {egt::EventId::raw_pointer_move}));
+    EXPECT_EQ(points.back(), egt::DisplayPoint(10, 10));
+    EXPECT_EQ(history.back(), 10U);
+
+    // flushed before any other event
+    for (auto i = 11; i <= 13; ++i)
+        dispatch(egt::EventId::raw_pointer_move, i);
+    dispatch(egt::EventId::raw_pointer_down, 13);
+    EXPECT_EQ(ids.size(), 3U);
+    EXPECT_EQ(ids[1], egt::EventId::raw_pointer_move);
+    EXPECT_EQ(points[1], egt::DisplayPoint(13, 13));
+    EXPECT_EQ(history[1], 3U);
+    EXPECT_EQ(ids[2], egt::EventId::raw_pointer_down);
+    EXPECT_EQ(history[2], 0U);
+
+    // dispatched right away without coalescing
+    app.event().coalesce_motion(false);
+    dispatch(egt::EventId::raw_pointer_move, 14);
+    dispatch(egt::EventId::raw_pointer_move, 15);
+    dispatch(egt::EventId::raw_pointer_up, 15);
+    EXPECT_EQ(ids.size(), 6U);
+    EXPECT_EQ(points[4], egt::DisplayPoint(15, 15));
+
+    egt::Input::global_input().remove_handler(handle);
+}
+
+TEST(EventLoop, AdaptiveFidelity)
+{
+    egt::Application app;
+    egt::TopWindow window;
+    window.show();
+    egt::Painter painter(app.screen()->context());
+
+    // with no budget, every frame drawn is slow
+    app.event().adaptive_fidelity(true, std::chrono::microseconds(0),
+                                  std::chrono::milliseconds(10));
+    for (auto i = 0; i < 3; ++i)
+    {
+        window.damage();
+        app.event().draw();
+    }
+    EXPECT_TRUE(painter.low_fidelity());
+
+    // high fidelity is back once idle
+    const auto start = std::chrono::steady_clock::now();
+    while (painter.low_fidelity() &&
+           std::chrono::steady_clock::now() < start + std::chrono::seconds(1))
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(painter.low_fidelity());
+
+    app.event().adaptive_fidelity(false);
+}
+
+TEST(EventLoop, IdleState)
+{
+    egt::Application app;
+
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+    } input;
+
+    std::vector<bool> states;
+    app.event().idle_timeout(std::chrono::milliseconds(10), 0, [&](bool idle)
+    {
+        states.push_back(idle);
+        if (idle)
+            app.event().quit();
+    });
+
+    app.event().reset_wakeup_stats();
+    app.run();
+    EXPECT_TRUE(app.event().idle());
+    EXPECT_EQ(states, (std::vector<bool> {true}));
+    EXPECT_GE(app.event().wakeup_stats().total(), 1U);
+
+    // input leaves the idle state
+    egt::Event event(egt::EventId::raw_pointer_down, egt::Pointer(egt::DisplayPoint(1, 1)));
+    input.dispatch(event);
+    EXPECT_FALSE(app.event().idle());
+    EXPECT_EQ(states, (std::vector<bool> {true, false}));
+
+    app.event().idle_timeout(std::chrono::milliseconds(0));
+}
+
+TEST(EventLoop, DispatchBudget)
+{
+    egt::Application app;
+    app.event().dispatch_budget(std::chrono::milliseconds(1));
+
+    std::vector<int> fired;
+    egt::Timer first(std::chrono::milliseconds(0));
+    egt::Timer second(std::chrono::milliseconds(0));
+    auto third = std::make_unique<egt::Timer>(std::chrono::milliseconds(0));
+    first.on_timeout([&fired]()
+    {
+        fired.push_back(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    });
+    second.on_timeout([&fired]() { fired.push_back(2); });
+    third->on_timeout([&fired]() { fired.push_back(3); });
+
+    first.start();
+    second.start();
+    third->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    // the first timer uses up the budget, so the others wait
+    app.event().poll();
+    EXPECT_EQ(fired, (std::vector<int> {1}));
+
+    // a destroyed timer never fires
+    third.reset();
+    app.event().poll();
+    EXPECT_EQ(fired, (std::vector<int> {1, 2}));
+}
+
+TEST(Timer, Wheel)
+{
+    egt::Application app;
+
+    // timers fire in order of expiry, however many there are
+    std::vector<int> fired;
+    std::vector<std::unique_ptr<egt::Timer>> timers;
+    for (auto i = 0; i < 200; ++i)
+    {
+        const auto duration = (i * 7) % 50;
+        timers.push_back(std::make_unique<egt::Timer>(std::chrono::milliseconds(duration)));
+        timers.back()->on_timeout([&fired, duration]() { fired.push_back(duration); });
+    }
+    for (auto& timer : timers)
+        timer->start();
+
+    // a cancelled timer never fires
+    timers[1]->cancel();
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (fired.size() < timers.size() - 1 && std::chrono::steady_clock::now() < end)
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_EQ(fired.size(), timers.size() - 1);
+    EXPECT_TRUE(std::is_sorted(fired.begin(), fired.end()));
+    EXPECT_EQ(std::count(fired.begin(), fired.end(), 7), 3);
+}
+
+TEST(Timer, Slack)
+{
+    egt::Application app;
+    app.event().timer_slack(std::chrono::milliseconds(50));
+
+    std::vector<int> fired;
+    egt::Timer first(std::chrono::milliseconds(1));
+    egt::Timer second(std::chrono::milliseconds(20));
+    first.on_timeout([&fired]() { fired.push_back(1); });
+    second.on_timeout([&fired]() { fired.push_back(2); });
+
+    const auto start = std::chrono::steady_clock::now();
+    first.start();
+    second.start();
+
+    while (fired.empty() &&
+           std::chrono::steady_clock::now() < start + std::chrono::seconds(1))
+    {
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // both expire within the slack, so they fire in the same wakeup, but
+    // never early
+    EXPECT_EQ(fired, (std::vector<int> {1, 2}));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+TEST(Timer, BindVisibility)
+{
+    egt::Application app;
+    egt::TopWindow win;
+    egt::Frame page(egt::Rect(0, 0, 100, 100));
+    win.add(page);
+    egt::Frame child(egt::Rect(10, 10, 20, 20));
+    page.add(child);
+    win.show();
+
+    auto fired = 0;
+    egt::Timer timer(std::chrono::milliseconds(1));
+    timer.on_timeout([&fired]() { ++fired; });
+    timer.bind(child);
+    egt::PropertyAnimatorF animation(0, 100, std::chrono::milliseconds(20));
+    animation.bind(child);
+
+    const auto run = [&app](std::chrono::milliseconds duration)
+    {
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            app.event().step();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // a hidden parent suspends the timer, which keeps running
+    page.hide();
+    app.event().draw();
+    timer.start();
+    animation.start();
+    run(std::chrono::milliseconds(40));
+    EXPECT_TRUE(timer.suspended());
+    EXPECT_TRUE(timer.running());
+    EXPECT_EQ(fired, 0);
+    EXPECT_TRUE(animation.suspended());
+    EXPECT_FLOAT_EQ(animation.current(), 0);
+
+    // shown again, the expiry missed fires once, and the animation catches up
+    page.show();
+    app.event().draw();
+    run(std::chrono::milliseconds(10));
+    EXPECT_FALSE(timer.suspended());
+    EXPECT_EQ(fired, 1);
+    EXPECT_FALSE(animation.running());
+    EXPECT_FLOAT_EQ(animation.current(), 100);
+
+    // clipped out of its parent is not seen either
+    child.move(egt::Point(200, 200));
+    app.event().draw();
+    EXPECT_TRUE(timer.suspended());
+
+    timer.unbind();
+    EXPECT_FALSE(timer.suspended());
+}
+
+TEST(Animation, Ticker)
+{
+    egt::Application app;
+
+    // animations step together, so both see the same polls
+    auto poll = 0;
+    std::vector<int> first_polls;
+    std::vector<int> second_polls;
+    egt::PropertyAnimatorF first(0, 1000, std::chrono::milliseconds(100));
+    egt::PropertyAnimatorF second(0, 1000, std::chrono::milliseconds(100));
+    first.on_change([&](float) { first_polls.push_back(poll); });
+    second.on_change([&](float) { second_polls.push_back(poll); });
+    first.start();
+    second.start();
+
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while ((first.running() || second.running()) &&
+           std::chrono::steady_clock::now() < end)
+    {
+        ++poll;
+        app.event().poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_FALSE(first.running());
+    EXPECT_FALSE(second.running());
+    EXPECT_FLOAT_EQ(first.current(), 1000);
+    EXPECT_GT(first_polls.size(), 2U);
+    EXPECT_EQ(first_polls, second_polls);
+}
+
+TEST(Object, HandlerMask)
+{
+    egt::Object object;
+    EXPECT_FALSE(object.has_handlers(egt::EventId::pointer_click));
+
+    auto clicks = 0;
+    const auto handle = object.on_event([&clicks](egt::Event&) { clicks++; },
+                                        {egt::EventId::pointer_click});
+    EXPECT_TRUE(object.has_handlers(egt::EventId::pointer_click));
+    EXPECT_FALSE(object.has_handlers(egt::EventId::keyboard_down));
+
+    object.invoke_handlers(egt::EventId::pointer_click);
+    object.invoke_handlers(egt::EventId::keyboard_down);
+    EXPECT_EQ(clicks, 1);
+
+    // a handler without a mask gets everything
+    const egt::Object::EventCallback any = [](egt::Event&) {};
+    const auto any_handle = object.on_event(any);
+    EXPECT_TRUE(object.has_handlers(egt::EventId::keyboard_down));
+
+    object.remove_handler(any_handle);
+    EXPECT_FALSE(object.has_handlers(egt::EventId::keyboard_down));
+    object.remove_handler(handle);
+    EXPECT_FALSE(object.has_handlers(egt::EventId::pointer_click));
+
+    egt::Signal<int> signal;
+    auto total = 0;
+    signal.on_event([&total](int value) { total += value; });
+    signal.invoke(3);
+    EXPECT_EQ(total, 3);
+}
+
+TEST(Object, Names)
+{
+    egt::Application app;
+
+    // equal strings share one copy
+    const std::string key = "background";
+    const auto a = egt::detail::intern(key);
+    const auto b = egt::detail::intern(std::string("back") + "ground");
+    EXPECT_EQ(a, key);
+    EXPECT_EQ(a.data(), b.data());
+    EXPECT_EQ(egt::detail::hash(a), egt::detail::hash("background"));
+
+    // default names are built when asked for
+    egt::Label label;
+    EXPECT_EQ(label.name(), "Label" + std::to_string(label.widgetid()));
+    label.name("title");
+    EXPECT_EQ(label.name(), "title");
+}
+
+TEST(Input, PredictPointer)
+{
+    egt::Application app;
+
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+        using egt::Input::timestamp;
+    } input;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto dispatch = [&](egt::EventId id, int x, int ms)
+    {
+        egt::Event event(id, egt::Pointer(egt::DisplayPoint(x, 0)));
+        input.timestamp(start + std::chrono::milliseconds(ms));
+        input.dispatch(event);
+    };
+
+    dispatch(egt::EventId::raw_pointer_down, 0, 0);
+    EXPECT_EQ(egt::Input::predict_pointer(std::chrono::milliseconds(10)), egt::DisplayPoint(0, 0));
+
+    // 1 pixel per millisecond
+    dispatch(egt::EventId::raw_pointer_move, 10, 10);
+    dispatch(egt::EventId::raw_pointer_move, 20, 20);
+    EXPECT_EQ(egt::Input::predict_pointer(std::chrono::milliseconds(10)), egt::DisplayPoint(30, 0));
+    EXPECT_EQ(egt::Input::predict_pointer(std::chrono::seconds(1)), egt::DisplayPoint(120, 0));
+
+    dispatch(egt::EventId::raw_pointer_up, 20, 30);
+}
+
+TEST(Input, RecordReplay)
+{
+    egt::Application app;
+    const auto path = "/tmp/egt-input-" + std::to_string(getpid());
+
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+        using egt::Input::timestamp;
+    } input;
+
+    {
+        egt::detail::InputRecorder recorder(path);
+        const auto start = std::chrono::steady_clock::now();
+        auto dispatch = [&](egt::Event event, int ms)
+        {
+            input.timestamp(start + std::chrono::milliseconds(ms));
+            input.dispatch(event);
+        };
+        dispatch(egt::Event(egt::EventId::raw_pointer_down,
+                            egt::Pointer(egt::DisplayPoint(10, 20), egt::Pointer::Button::left)), 0);
+        dispatch(egt::Event(egt::EventId::raw_pointer_up,
+                            egt::Pointer(egt::DisplayPoint(10, 20), egt::Pointer::Button::left)), 5);
+        dispatch(egt::Event(egt::EventId::keyboard_down,
+                            egt::Key(egt::EKEY_A, 'a', egt::Key::KeyMod::shift)), 10);
+        // synthesized events, like the click of the up event, are not recorded
+        EXPECT_EQ(recorder.count(), 3U);
+    }
+
+    std::vector<egt::Event> events;
+    auto handle = egt::Input::global_input().on_event([&](egt::Event & event)
+    {
+        events.push_back(event);
+    }, {egt::EventId::raw_pointer_down, egt::EventId::raw_pointer_up, egt::EventId::keyboard_down});
+
+    egt::detail::InputReplay replay(app, path);
+    EXPECT_EQ(replay.count(), 3U);
+    replay.speed(10);
+    bool finished = false;
+    replay.on_finished([&finished]() { finished = true; });
+    replay.start();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!finished && std::chrono::steady_clock::now() < deadline)
+        app.event().poll();
+
+    egt::Input::global_input().remove_handler(handle);
+    unlink(path.c_str());
+
+    ASSERT_TRUE(finished);
+    EXPECT_EQ(replay.stats().events, 3U);
+    ASSERT_EQ(events.size(), 3U);
+    EXPECT_EQ(events[0].id(), egt::EventId::raw_pointer_down);
+    EXPECT_EQ(events[0].pointer().point, egt::DisplayPoint(10, 20));
+    EXPECT_EQ(events[0].pointer().btn, egt::Pointer::Button::left);
+    EXPECT_EQ(events[1].id(), egt::EventId::raw_pointer_up);
+    EXPECT_EQ(events[2].key().keycode, egt::EKEY_A);
+    EXPECT_EQ(events[2].key().unicode, static_cast<uint32_t>('a'));
+    EXPECT_TRUE(events[2].key().state.is_set(egt::Key::KeyMod::shift));
+}
+
+TEST(Input, FlingVelocity)
+{
+    egt::Application app;
+
+    struct TestInput : public egt::Input
+    {
+        using egt::Input::dispatch;
+        using egt::Input::timestamp;
+    } input;
+
+    std::vector<egt::Event> events;
+    auto handle = egt::Input::global_input().on_event([&](egt::Event & event)
+    {
+        events.push_back(event);
+    }, {egt::EventId::pointer_drag_stop, egt::EventId::pointer_hold});
+
+    const auto start = std::chrono::steady_clock::now();
+    auto dispatch = [&](egt::EventId id, int x, int ms)
+    {
+        egt::Event event(id, egt::Pointer(egt::DisplayPoint(x, 0)));
+        input.timestamp(start + std::chrono::milliseconds(ms));
+        input.dispatch(event);
+    };
+
+    // 1 pixel per millisecond
+    dispatch(egt::EventId::raw_pointer_down, 0, 0);
+    dispatch(egt::EventId::raw_pointer_move, 10, 10);
+    dispatch(egt::EventId::raw_pointer_move, 20, 20);
+    dispatch(egt::EventId::raw_pointer_up, 20, 25);
+    ASSERT_EQ(events.size(), 1U);
+    EXPECT_EQ(events[0].id(), egt::EventId::pointer_drag_stop);
+    EXPECT_FLOAT_EQ(events[0].pointer().velocity.x(), 1000.f);
+    EXPECT_FLOAT_EQ(events[0].pointer().velocity.y(), 0.f);
+
+    // a drag that paused before it ended has no velocity
+    events.clear();
+    dispatch(egt::EventId::raw_pointer_down, 0, 100);
+    dispatch(egt::EventId::raw_pointer_move, 20, 110);
+    dispatch(egt::EventId::raw_pointer_up, 20, 400);
+    ASSERT_EQ(events.size(), 1U);
+    EXPECT_EQ(events[0].pointer().velocity, egt::PointF());
+
+    // the long click is due from when the pointer went down
+    events.clear();
+    dispatch(egt::EventId::raw_pointer_down, 0, -1000);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (events.empty() && std::chrono::steady_clock::now() < deadline)
+        app.event().poll();
+    ASSERT_EQ(events.size(), 1U);
+    EXPECT_EQ(events[0].id(), egt::EventId::pointer_hold);
+    dispatch(egt::EventId::raw_pointer_up, 0, 0);
+
+    egt::Input::global_input().remove_handler(handle);
+}
 
 int main(int argc, char** argv)
 {
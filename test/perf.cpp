@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <cstdlib>
+#include <egt/profiler.h>
+#include <egt/ui>
+#include <fstream>
+#include <functional>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+/*
+ * Performance regression gates.
+ *
+ * Each test runs a scripted interaction on the in-memory screen, and counts
+ * what the frames drawn for it cost: damage rectangles, damaged and copied
+ * pixels, widgets drawn, layout passes, size hints computed, and heap
+ * allocations when the library counts them.  Unlike times, these counts are
+ * the same on every run, so a test fails as soon as one of them goes over the
+ * baseline, catching overdraw and layout storms.
+ *
+ * The baseline is perf_baseline.txt, or the file EGT_PERF_BASELINE names.
+ * When EGT_PERF_UPDATE names a file, the counts measured are appended to it,
+ * in the format of the baseline.
+ */
+
+using PerfCounts = std::map<std::string, uint64_t>;
+
+/// Maximum counts of each scenario.
+static const std::map<std::string, PerfCounts>& perf_baseline()
+{
+    static const auto baseline = []()
+    {
+        std::map<std::string, PerfCounts> result;
+
+        const char* path = std::getenv("EGT_PERF_BASELINE");
+        std::ifstream in(path && *path ? path : EGT_PERF_BASELINE_FILE);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream ss(line);
+            std::string scenario;
+            std::string metric;
+            uint64_t value;
+            if (ss >> scenario >> metric >> value)
+                result[scenario][metric] = value;
+        }
+
+        return result;
+    }();
+
+    return baseline;
+}
+
+class PerfTest : public testing::Test
+{
+protected:
+
+    void SetUp() override
+    {
+        // counts only compare on the same screen
+        const char* backend = std::getenv("EGT_BACKEND");
+        if (backend)
+            m_backend = std::make_unique<std::string>(backend);
+        setenv("EGT_BACKEND", "memory", 1);
+
+        m_app = std::make_unique<egt::Application>();
+        m_window = std::make_unique<egt::TopWindow>();
+    }
+
+    void TearDown() override
+    {
+        m_window.reset();
+        m_app.reset();
+
+        if (m_backend)
+            setenv("EGT_BACKEND", m_backend->c_str(), 1);
+        else
+            unsetenv("EGT_BACKEND");
+    }
+
+    /**
+     * Draw the window, and then count the frames drawn after the interaction.
+     */
+    PerfCounts measure(const std::function<void()>& interaction)
+    {
+        auto screen = m_app->screen();
+        auto& profiler = egt::Profiler::instance();
+
+        m_window->show();
+        m_app->event().draw();
+
+        uint64_t damage_rects = 0;
+        const auto handle = screen->on_damage([&damage_rects](const egt::Screen::DamageArray & damage)
+        {
+            damage_rects += damage.size();
+        });
+        screen->reset_flip_stats();
+        profiler.reset();
+        profiler.enable(true);
+
+        interaction();
+        m_app->event().draw();
+
+        profiler.enable(false);
+        screen->on_damage.remove(handle);
+
+        PerfCounts counts;
+        counts["damage_rects"] = damage_rects;
+        counts["damaged_pixels"] = screen->flip_stats().damaged_pixels;
+        counts["copied_pixels"] = screen->flip_stats().copied_pixels;
+
+        uint64_t draws = 0;
+        uint64_t size_hints = 0;
+        uint64_t allocations = 0;
+        for (const auto& frame : profiler.frames())
+        {
+            draws += frame.draws;
+            size_hints += frame.size_hints;
+            allocations += frame.allocations();
+        }
+        counts["draws"] = draws;
+        counts["size_hints"] = size_hints;
+        if (egt::Profiler::allocation_counting())
+            counts["allocations"] = allocations;
+
+        // nested layouts are part of the same pass
+        uint64_t layouts = 0;
+        for (const auto& event : profiler.events())
+        {
+            if (event.phase == egt::Profiler::Phase::layout)
+                ++layouts;
+        }
+        counts["layouts"] = layouts;
+
+        return counts;
+    }
+
+    /**
+     * Compare the counts of a scenario with its baseline.
+     */
+    static void check(const std::string& scenario, const PerfCounts& counts)
+    {
+        const char* update = std::getenv("EGT_PERF_UPDATE");
+        if (update && *update)
+        {
+            std::ofstream out(update, std::ios::app);
+            for (const auto& count : counts)
+                out << scenario << ' ' << count.first << ' ' << count.second << '\n';
+        }
+
+        const auto& baseline = perf_baseline();
+        const auto i = baseline.find(scenario);
+        if (i == baseline.end())
+        {
+            std::cout << "no baseline for " << scenario << std::endl;
+            return;
+        }
+
+        for (const auto& max : i->second)
+        {
+            const auto count = counts.find(max.first);
+            if (count == counts.end())
+                continue;
+
+            EXPECT_LE(count->second, max.second) << scenario << " " << max.first
+                                                 << " regressed past the baseline";
+        }
+    }
+
+    std::unique_ptr<std::string> m_backend;
+    std::unique_ptr<egt::Application> m_app;
+    std::unique_ptr<egt::TopWindow> m_window;
+};
+
+TEST_F(PerfTest, SliderValue)
+{
+    auto slider = std::make_shared<egt::Slider>(egt::Rect(100, 100, 200, 40), 0, 100, 10);
+    m_window->add(slider);
+
+    // away from the slider, so not drawn again
+    auto label = std::make_shared<egt::Label>("label", egt::Rect(100, 300, 200, 40));
+    m_window->add(label);
+
+    const auto counts = measure([&slider]()
+    {
+        slider->value(60);
+    });
+
+    check("slider_value", counts);
+}
+
+TEST_F(PerfTest, NotebookPage)
+{
+    auto notebook = std::make_shared<egt::Notebook>(egt::Rect(0, 0, 400, 240));
+    m_window->add(notebook);
+
+    for (auto i = 0; i < 2; ++i)
+    {
+        auto page = std::make_shared<egt::NotebookTab>();
+        page->add(std::make_shared<egt::Label>("page " + std::to_string(i),
+                                               egt::Rect(10, 10, 200, 40)));
+        notebook->add(page);
+    }
+
+    const auto counts = measure([&notebook]()
+    {
+        notebook->selected(1);
+    });
+
+    check("notebook_page", counts);
+}
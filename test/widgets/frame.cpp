@@ -3,8 +3,10 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <cstring>
 #include <egt/ui>
 #include <gtest/gtest.h>
+#include <vector>
 
 using ::testing::Combine;
 using ::testing::TestWithParam;
@@ -64,3 +66,224 @@ TEST_P(FrameTest, TestWidget)
 }
 
 INSTANTIATE_TEST_SUITE_P(FrameTestGroup, FrameTest, testing::Values(1, 2, 4));
+
+static std::vector<unsigned char> render(egt::Widget& widget)
+{
+    auto surface = egt::shared_cairo_surface_t(
+                       cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                               widget.width(), widget.height()),
+                       cairo_surface_destroy);
+    auto cr = egt::shared_cairo_t(cairo_create(surface.get()), cairo_destroy);
+    egt::Painter painter(cr);
+    widget.paint(painter);
+    cairo_surface_flush(surface.get());
+
+    auto data = cairo_image_surface_get_data(surface.get());
+    auto size = cairo_image_surface_get_stride(surface.get()) * widget.height();
+    return {data, data + size};
+}
+
+TEST(Frame, SubtreeCache)
+{
+    egt::Application app;
+    egt::Frame frame(egt::Rect(0, 0, 100, 100));
+    frame.fill_flags(egt::Theme::FillFlag::solid);
+    auto inner = std::make_shared<egt::Frame>(egt::Rect(10, 10, 80, 80));
+    inner->fill_flags(egt::Theme::FillFlag::solid);
+    inner->color(egt::Palette::ColorId::bg, egt::Palette::blue);
+    frame.add(inner);
+    auto label = std::make_shared<egt::Label>(*inner, "one", egt::Rect(0, 0, 80, 40));
+
+    const auto expected = render(frame);
+    inner->cache_subtree(true);
+    EXPECT_TRUE(inner->cache_subtree());
+    EXPECT_EQ(render(frame), expected);
+    // second render comes from the cache
+    EXPECT_EQ(render(frame), expected);
+
+    // damage from inside the subtree invalidates the cache
+    label->text("two");
+    const auto cached = render(frame);
+    EXPECT_NE(cached, expected);
+    inner->cache_subtree(false);
+    EXPECT_EQ(render(frame), cached);
+}
+
+TEST(Frame, OpaqueRect)
+{
+    egt::Application app;
+    egt::Frame frame(egt::Rect(0, 0, 100, 100));
+    frame.fill_flags(egt::Theme::FillFlag::solid);
+    frame.color(egt::Palette::ColorId::bg, egt::Palette::red);
+
+    auto bottom = std::make_shared<egt::Frame>(egt::Rect(0, 0, 100, 50));
+    bottom->fill_flags(egt::Theme::FillFlag::solid);
+    bottom->color(egt::Palette::ColorId::bg, egt::Palette::green);
+    frame.add(bottom);
+
+    auto top = std::make_shared<egt::Frame>(egt::Rect(0, 0, 100, 50));
+    top->fill_flags(egt::Theme::FillFlag::solid);
+    top->color(egt::Palette::ColorId::bg, egt::Palette::blue);
+    frame.add(top);
+
+    EXPECT_EQ(top->opaque_rect(), egt::Rect(0, 0, 100, 50));
+    top->margin(5);
+    EXPECT_EQ(top->opaque_rect(), egt::Rect(5, 5, 90, 40));
+    top->margin(0);
+
+    const auto pixels = render(frame);
+    auto color_at = [&pixels](int x, int y)
+    {
+        uint32_t pixel;
+        std::memcpy(&pixel, &pixels[(y * 100 + x) * 4], sizeof(pixel));
+        return pixel;
+    };
+    EXPECT_EQ(color_at(50, 25), egt::Palette::blue.pixel32());
+    EXPECT_EQ(color_at(50, 75), egt::Palette::red.pixel32());
+
+    top->alpha(0.5);
+    EXPECT_TRUE(top->opaque_rect().empty());
+    top->alpha(1.0);
+    top->border_radius(4);
+    EXPECT_TRUE(top->opaque_rect().empty());
+    top->border_radius(0);
+    top->color(egt::Palette::ColorId::bg, egt::Color(0x0000ff80));
+    EXPECT_TRUE(top->opaque_rect().empty());
+    top->hide();
+    EXPECT_TRUE(top->opaque_rect().empty());
+}
+
+TEST(Frame, AlphaLayer)
+{
+    egt::Application app;
+    egt::Frame frame(egt::Rect(0, 0, 100, 100));
+    frame.fill_flags(egt::Theme::FillFlag::solid);
+    frame.color(egt::Palette::ColorId::bg, egt::Palette::red);
+
+    auto child = std::make_shared<egt::Frame>(egt::Rect(0, 0, 100, 100));
+    child->fill_flags(egt::Theme::FillFlag::solid);
+    child->color(egt::Palette::ColorId::bg, egt::Palette::blue);
+    frame.add(child);
+
+    auto blue_at_center = [&frame]()
+    {
+        const auto pixels = render(frame);
+        uint32_t pixel;
+        std::memcpy(&pixel, &pixels[(50 * 100 + 50) * 4], sizeof(pixel));
+        return static_cast<int>(pixel & 0xff);
+    };
+
+    child->alpha(0.5);
+    EXPECT_NEAR(blue_at_center(), 128, 1);
+    // the layer is reused when only alpha changes
+    child->alpha(0.25);
+    EXPECT_NEAR(blue_at_center(), 64, 1);
+    child->color(egt::Palette::ColorId::bg, egt::Palette::black);
+    EXPECT_NEAR(blue_at_center(), 0, 1);
+}
+
+TEST(Frame, ZOrder)
+{
+    egt::Application app;
+    egt::Frame frame(egt::Rect(0, 0, 100, 100));
+
+    std::vector<std::shared_ptr<egt::Frame>> children;
+    for (auto i = 0; i < 5; ++i)
+    {
+        children.push_back(std::make_shared<egt::Frame>(egt::Rect(i, i, 10, 10)));
+        frame.add(children.back());
+    }
+
+    auto order = [&children]()
+    {
+        std::vector<size_t> result;
+        for (auto& child : children)
+            result.push_back(child->zorder());
+        return result;
+    };
+
+    EXPECT_EQ(order(), (std::vector<size_t> {0, 1, 2, 3, 4}));
+
+    children[1]->zorder_top();
+    EXPECT_EQ(order(), (std::vector<size_t> {0, 4, 1, 2, 3}));
+
+    children[3]->zorder_bottom();
+    EXPECT_EQ(order(), (std::vector<size_t> {1, 4, 2, 0, 3}));
+
+    children[2]->zorder_up();
+    EXPECT_EQ(order(), (std::vector<size_t> {1, 4, 3, 0, 2}));
+
+    children[2]->zorder_down();
+    EXPECT_EQ(order(), (std::vector<size_t> {1, 4, 2, 0, 3}));
+
+    children[3]->zorder(3);
+    EXPECT_EQ(order(), (std::vector<size_t> {0, 4, 1, 3, 2}));
+
+    children[1]->zorder(0);
+    EXPECT_EQ(order(), (std::vector<size_t> {1, 0, 2, 4, 3}));
+
+    frame.remove(children[0].get());
+    EXPECT_EQ(frame.count_children(), 4U);
+    EXPECT_EQ(children[1]->zorder(), 0U);
+    EXPECT_EQ(children[3]->zorder(), 3U);
+
+    frame.remove_all();
+    EXPECT_EQ(frame.count_children(), 0U);
+}
+
+TEST(Frame, SpatialIndex)
+{
+    egt::Application app;
+    egt::Frame frame(egt::Rect(0, 0, 400, 400));
+
+    egt::Widget* hit = nullptr;
+    std::vector<std::shared_ptr<egt::Frame>> widgets;
+    for (auto i = 0; i < 120; i++)
+    {
+        // overlapping boxes of different sizes, some of them disabled
+        auto widget = std::make_shared<egt::Frame>(egt::Rect((i * 37) % 360, (i * 53) % 360,
+                      20 + i % 5 * 10, 20 + i % 3 * 15));
+        auto w = widget.get();
+        widget->on_event([&hit, w](egt::Event&)
+        {
+            hit = w;
+        }, {egt::EventId::raw_pointer_down});
+        if (i % 7 == 0)
+            widget->disable();
+        frame.add(widget);
+        widgets.push_back(widget);
+    }
+
+    auto targets = [&]()
+    {
+        std::vector<egt::Widget*> result;
+        for (auto y = -10; y < 410; y += 7)
+        {
+            for (auto x = -10; x < 410; x += 7)
+            {
+                hit = nullptr;
+                egt::Event event(egt::EventId::raw_pointer_down,
+                                 egt::Pointer(egt::DisplayPoint(x, y)));
+                frame.handle(event);
+                result.push_back(hit);
+            }
+        }
+        return result;
+    };
+
+    EXPECT_FALSE(frame.spatial_index());
+    auto expected = targets();
+    frame.spatial_index(true);
+    EXPECT_TRUE(frame.spatial_index());
+    EXPECT_EQ(targets(), expected);
+
+    // the index follows geometry and z-order changes
+    widgets[3]->move(egt::Point(100, 100));
+    widgets[50]->resize(egt::Size(200, 200));
+    widgets[10]->zorder_top();
+    widgets[20]->zorder_bottom();
+    frame.remove(widgets[30].get());
+    auto indexed = targets();
+    frame.spatial_index(false);
+    EXPECT_EQ(indexed, targets());
+}
@@ -3,8 +3,10 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <egt/detail/layout.h>
 #include <egt/ui>
 #include <gtest/gtest.h>
+#include <vector>
 
 class Layout : public ::testing::Test
 {
@@ -426,3 +428,54 @@ TEST_F(Layout, FlexSizerExpandedAndExpendedChild)
     EXPECT_EQ(fsizer.display_origin(), egt::DisplayPoint(0, 0));
     EXPECT_EQ(fsizer.box().size(), egt::Size(400, 400));
 }
+
+TEST(FlexLayout, MatchesFlexLayout)
+{
+    egt::detail::FlexLayout layout;
+
+    const egt::Orientation orients[] =
+    {
+        egt::Orientation::horizontal,
+        egt::Orientation::vertical,
+        egt::Orientation::flex,
+    };
+
+    for (auto orient : orients)
+    {
+        std::vector<egt::detail::LayoutRect> children;
+        for (auto i = 0; i < 20; ++i)
+            children.emplace_back(0, egt::Rect(0, 0, 30 + i, 20 + i % 3));
+
+        // widths change which children wrap to a new line
+        for (auto width : {400, 150, 400, 400, 90})
+        {
+            const auto parent = egt::Rect(0, 0, width, 300);
+
+            auto expected = children;
+            egt::detail::flex_layout(parent, expected, egt::Justification::start, orient);
+
+            auto result = children;
+            layout.run(parent, result, egt::Justification::start, orient);
+
+            for (size_t i = 0; i < children.size(); ++i)
+                EXPECT_EQ(result[i].rect, expected[i].rect);
+        }
+
+        children[3].rect.width(80);
+        children[5].behave = 0x0a0;
+
+        auto expected = children;
+        egt::detail::flex_layout(egt::Rect(0, 0, 90, 300), expected, egt::Justification::start, orient);
+
+        auto result = children;
+        layout.run(egt::Rect(0, 0, 90, 300), result, egt::Justification::start, orient);
+
+        for (size_t i = 0; i < children.size(); ++i)
+            EXPECT_EQ(result[i].rect, expected[i].rect);
+    }
+
+    // the context is only rebuilt for the first run, and a run of the same
+    // layout twice is skipped
+    EXPECT_EQ(layout.rebuilds(), 1U);
+    EXPECT_EQ(layout.skips(), 3U);
+}
@@ -5,6 +5,10 @@
  */
 #include <egt/ui>
 #include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 using ::testing::Combine;
 using ::testing::TestWithParam;
@@ -52,3 +56,60 @@ TEST_P(SizerTest, TestWidget)
 }
 
 INSTANTIATE_TEST_SUITE_P(SizerTestGroup, SizerTest, Values(1, 2, 4, 8));
+
+TEST(BoxSizer, DeferredLayout)
+{
+    struct CountingSizer : public egt::VerticalBoxSizer
+    {
+        void layout() override
+        {
+            ++layouts;
+            egt::VerticalBoxSizer::layout();
+        }
+
+        int layouts{0};
+    };
+
+    egt::Application app;
+    egt::TopWindow win;
+
+    auto build = [&win](bool deferred)
+    {
+        egt::Application::instance().event().deferred_layout(deferred);
+
+        auto sizer = std::make_shared<CountingSizer>();
+        win.add(sizer);
+
+        std::vector<std::shared_ptr<egt::Label>> labels;
+        for (auto i = 0; i < 50; ++i)
+        {
+            auto label = std::make_shared<egt::Label>();
+            sizer->add(label);
+            labels.push_back(label);
+        }
+
+        sizer->layouts = 0;
+        for (auto i = 0; i < 50; ++i)
+            labels[i]->text("label " + std::to_string(i));
+
+        return std::make_pair(sizer, labels);
+    };
+
+    auto eager = build(false);
+    EXPECT_GE(eager.first->layouts, 50);
+    EXPECT_FALSE(win.layout_pending());
+
+    auto deferred = build(true);
+    EXPECT_EQ(deferred.first->layouts, 0);
+    EXPECT_TRUE(win.layout_pending());
+
+    app.event().draw();
+    EXPECT_FALSE(win.layout_pending());
+    EXPECT_LE(deferred.first->layouts, 4);
+
+    EXPECT_EQ(deferred.first->size(), eager.first->size());
+    for (auto i = 0; i < 50; ++i)
+        EXPECT_EQ(deferred.second[i]->size(), eager.second[i]->size());
+
+    app.event().deferred_layout(false);
+}
@@ -5,6 +5,8 @@
  */
 #include <egt/ui>
 #include <gtest/gtest.h>
+#include <memory>
+#include <vector>
 
 using ::testing::AssertionResult;
 using ::testing::Range;
@@ -42,3 +44,61 @@ TEST_P(CreateWindowTest, DefaultWindow)
 
 INSTANTIATE_TEST_SUITE_P(CreateWindowTestGroup, CreateWindowTest, Range(1, 11));
 
+
+static std::vector<unsigned char> screen_pixels(egt::Application& app)
+{
+    auto surface = cairo_get_target(app.screen()->context().get());
+    cairo_surface_flush(surface);
+
+    auto data = cairo_image_surface_get_data(surface);
+    if (!data)
+        return {};
+    auto size = cairo_image_surface_get_stride(surface) *
+                cairo_image_surface_get_height(surface);
+    return {data, data + size};
+}
+
+TEST(Window, ParallelDraw)
+{
+    egt::Application app;
+    egt::TopWindow win;
+    win.thread_safe_draw(true);
+    win.fill_flags(egt::Theme::FillFlag::solid);
+    win.color(egt::Palette::ColorId::bg, egt::Palette::blue);
+
+    // round corners and borders are anti-aliased across band edges
+    for (auto i = 0; i < 8; ++i)
+    {
+        auto frame = std::make_shared<egt::Frame>(egt::Rect(i * 37, i * 29, 200, 150));
+        frame->thread_safe_draw(true);
+        frame->fill_flags(egt::Theme::FillFlag::solid);
+        frame->color(egt::Palette::ColorId::bg, egt::Color(0x10203040 * (i + 1)));
+        frame->border(3);
+        frame->border_radius(20);
+        win.add(frame);
+    }
+
+    win.show();
+
+    win.damage();
+    app.event().draw();
+    const auto expected = screen_pixels(app);
+
+    win.parallel_draw(true);
+    EXPECT_TRUE(win.parallel_draw());
+    win.damage();
+    app.event().draw();
+    EXPECT_EQ(screen_pixels(app), expected);
+
+    // a widget that is not thread safe draws everything on this thread
+    auto label = std::make_shared<egt::Label>("label", egt::Rect(10, 10, 100, 40));
+    win.add(label);
+    win.damage();
+    app.event().draw();
+    const auto with_label = screen_pixels(app);
+
+    win.parallel_draw(false);
+    win.damage();
+    app.event().draw();
+    EXPECT_EQ(screen_pixels(app), with_label);
+}
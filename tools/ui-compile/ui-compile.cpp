@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 Microchip Technology Inc.  All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <algorithm>
+#include <cctype>
+#include <cxxopts.hpp>
+#include <detail/base64.h>
+#include <detail/uibinary.h>
+#include <fstream>
+#include <iostream>
+#include <rapidxml.hpp>
+#include <rapidxml_utils.hpp>
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("ui-compile", "UI XML compiler");
+    options.add_options()
+    ("h,help", "help")
+    ("positional", "SOURCE DEST", cxxopts::value<std::vector<std::string>>())
+    ;
+    options.positional_help("SOURCE DEST");
+
+    options.parse_positional({"positional"});
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    if (result.count("positional") != 2)
+    {
+        std::cerr << options.help() << std::endl;
+        return 1;
+    }
+
+    auto& positional = result["positional"].as<std::vector<std::string>>();
+
+    std::string in = positional[0];
+    std::string out = positional[1];
+
+    try
+    {
+        rapidxml::file<> xml_file(in.c_str());
+        rapidxml::xml_document<> doc;
+        doc.parse<rapidxml::parse_no_data_nodes>(xml_file.data());
+
+        if (!doc.first_node("egt"))
+        {
+            std::cerr << "error: no egt element in " << in << std::endl;
+            return 1;
+        }
+
+        std::ofstream o(out, std::ios_base::binary);
+        if (!o.is_open())
+        {
+            std::cerr << "error: unable to write to file " << out << std::endl;
+            return 1;
+        }
+
+        // decode the resources now, instead of when loading
+        egt::detail::ui::compile(doc, o, [](const std::string & name, std::string & value,
+                                            std::vector<std::pair<std::string, std::string>>& attributes)
+        {
+            if (name != "resource")
+                return;
+
+            value.erase(std::remove_if(value.begin(), value.end(),
+                                       [](unsigned char c) { return std::isspace(c); }),
+                        value.end());
+            value = egt::detail::base64_decode(value.data(), value.size());
+            attributes.emplace_back("encoding", egt::detail::ui::RAW_ENCODING);
+        });
+
+        if (!o)
+        {
+            std::cerr << "error: unable to write to file " << out << std::endl;
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "error: " << in << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}